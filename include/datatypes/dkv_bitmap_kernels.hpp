@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dkv {
+
+// 多个位图按位合并的运算
+enum class BitmapOp {
+    AND,
+    OR,
+    XOR
+};
+
+// 一组位图运算核心，处理任意长度的连续字节
+struct BitmapKernels {
+    const char* name;
+    // data中值为1的位数
+    size_t (*popcount)(const uint8_t* data, size_t len);
+    // dst[i] = srcs[0][i] op srcs[1][i] op ...，count至少为1。每个位置一次读取所有输入，结果只写一次
+    void (*combine)(BitmapOp op, uint8_t* dst, const uint8_t* const* srcs, size_t count, size_t len);
+    // dst[i] = ~src[i]，dst可以就是src
+    void (*invert)(uint8_t* dst, const uint8_t* src, size_t len);
+    // 第一个不等于skip的字节的下标，没有时返回len。BITPOS找置位时skip为0x00，找清零位时为0xff
+    size_t (*find)(const uint8_t* data, size_t len, uint8_t skip);
+};
+
+// 当前CPU支持的全部实现，按速度从快到慢排列，最后一个是按64位字处理的通用实现
+const std::vector<BitmapKernels>& supportedBitmapKernels();
+
+// 运行时按CPU特性选用的实现（AVX-512BW、AVX2、NEON或通用实现），第一次调用时确定
+const BitmapKernels& bitmapKernels();
+
+// 把长度不同的位图按位合并到dst，较短的位图视为末尾补0，结果长度为最长输入的长度。
+// 按输入长度分段，每段只读取覆盖该段的输入，所有输入只遍历一次。dst不能是输入之一
+void bitmapCombine(BitmapOp op, std::vector<uint8_t>& dst, const std::vector<const std::vector<uint8_t>*>& srcs);
+
+} // namespace dkv
@@ -13,15 +13,25 @@ namespace dkv {
 class UndoLog;
 
 // 基础数据项接口
+// 头部只保留紧凑的元数据：32位LRU时钟、8位对数LFU计数器和标志位。
+// 过期时间只为设置了TTL的数据项存放在旁路表中，读写锁来自按地址散列的锁池。
 class DataItem {
 public:
-    virtual ~DataItem() = default;
+    virtual ~DataItem();
     virtual DataType getType() const = 0;
     virtual std::string serialize() const = 0;
     virtual void deserialize(const std::string& data) = 0;
     
     // 用于MVCC的克隆方法
     virtual std::unique_ptr<DataItem> clone() const = 0;
+    // 创建同类型的空数据项，用于MVCC的删除标记和增量版本，不复制元数据
+    virtual std::unique_ptr<DataItem> cloneEmpty() const = 0;
+
+    // 估算数据项占用的内存字节数，含对象自身和值的堆内存，不含键、MVCC历史版本和锁池。
+    // 大集合只计算前samples个元素并按元素总数外推，samples为0时计算全部元素
+    virtual size_t memoryUsage(size_t samples) const = 0;
+    // 当前内部编码的名称，如listpack、hashtable
+    virtual const char* encodingName() const = 0;
 
     // 构造函数
     DataItem();
@@ -30,6 +40,10 @@ public:
 
     DataItem& operator=(const DataItem& other) = delete;
 
+    // 数据项对象从SlabAllocator按大小级别分配
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+
     // TTL方法
     bool isExpired() const;
     void setExpiration(Timestamp expire_time);
@@ -37,12 +51,14 @@ public:
     bool hasExpiration() const;
     
     // 用于淘汰策略的方法
+    // LRU时钟精度为毫秒，按当前时间推算空闲时长，回绕周期约49天
+    // LFU计数器为对数计数（与Redis相同），按空闲分钟数衰减
     void touch();
     Timestamp getLastAccessed() const;
     void incrementFrequency();
     uint64_t getAccessFrequency() const;
     
-    // 锁操作方法
+    // 锁操作方法，同一锁池条目可能被多个数据项共享，不要同时持有两个数据项的锁
     std::unique_lock<std::shared_mutex> lock();
     std::shared_lock<std::shared_mutex> rlock();
     std::shared_mutex& getMutex();
@@ -65,35 +81,59 @@ public:
     }
     // Deleted: 用于用户删除键值对，在相应MVCC版本中记录已删除（是有效记录）
     bool isDeleted() const {
-        return deleted_;
+        return (flags_.load(std::memory_order_relaxed) & FLAG_DELETED) != 0;
     }
     void setDeleted(bool deleted) {
-        deleted_ = deleted;
+        if (deleted) {
+            flags_.fetch_or(FLAG_DELETED, std::memory_order_relaxed);
+        } else {
+            flags_.fetch_and(static_cast<uint8_t>(~FLAG_DELETED), std::memory_order_relaxed);
+        }
     }
     // Discard: 用于事务回滚，相应MVCC版本失效，记录失效，稍后purge
     bool isDiscard() const {
-        return discard_;
+        return (flags_.load(std::memory_order_relaxed) & FLAG_DISCARD) != 0;
     }
     void setDiscard() {
-        discard_ = true;
+        flags_.fetch_or(FLAG_DISCARD, std::memory_order_relaxed);
+    }
+    // Spilled: 值已移到分层存储的磁盘日志，内存中只保留键和元数据，见SpilledItem
+    bool isSpilled() const {
+        return (flags_.load(std::memory_order_relaxed) & FLAG_SPILLED) != 0;
+    }
+    // 接管另一个数据项的LRU时钟与LFU计数，用于值在内存与磁盘之间移动
+    void assignAccessStats(const DataItem& other) {
+        lru_clock_.store(other.lru_clock_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        lfu_counter_.store(other.lfu_counter_.load(std::memory_order_relaxed), std::memory_order_relaxed);
     }
+    // 接管另一个版本的事务ID与删除、丢弃标记，用于增量版本回退
+    void assignVersion(const DataItem& other) {
+        const uint8_t mask = FLAG_DELETED | FLAG_DISCARD;
+        const uint8_t other_flags = other.flags_.load(std::memory_order_relaxed) & mask;
+        uint8_t flags = flags_.load(std::memory_order_relaxed);
+        while (!flags_.compare_exchange_weak(flags, static_cast<uint8_t>((flags & ~mask) | other_flags),
+                                             std::memory_order_relaxed)) {
+        }
+        transaction_id_ = other.getTransactionId();
+    }
+
+    // 新数据项的LFU计数初值，避免刚写入就被淘汰
+    static constexpr uint8_t LFU_INIT_VAL = 5;
     
 protected:
-    // TTL
-    std::atomic<Timestamp> expire_time_;
+    static constexpr uint8_t FLAG_DELETED = 1 << 0;
+    static constexpr uint8_t FLAG_DISCARD = 1 << 1;
+    static constexpr uint8_t FLAG_VOLATILE = 1 << 2; // 旁路表中有过期时间
+    static constexpr uint8_t FLAG_SPILLED = 1 << 3;  // SpilledItem
 
     // 淘汰策略
-    std::atomic<Timestamp> last_accessed_; // 最后访问时间
-    std::atomic<uint64_t> access_frequency_ = {0}; // 访问频率
-    
-    // 读写锁，用于保护数据项的并发访问
-    mutable std::shared_mutex item_mutex_;
+    std::atomic<uint32_t> lru_clock_; // 最后访问时间，毫秒精度的32位时钟
+    std::atomic<uint8_t> lfu_counter_ = {LFU_INIT_VAL}; // 对数访问频率
+    std::atomic<uint8_t> flags_ = {0};
 
     // MVCC
     std::atomic<uint64_t> transaction_id_ = {0};
     std::unique_ptr<UndoLog> undo_log_;
-    bool deleted_ = {false};
-    bool discard_ = {false};
 };
 
 // 前向声明
@@ -104,4 +144,62 @@ class SetItem;
 class ZSetItem;
 class BitmapItem;
 class HyperLogLogItem;
+class BloomFilterItem;
+
+// 内存估算辅助函数，按libstdc++的布局估算，用于MEMORY USAGE和键空间内存采样
+
+// 字符串的堆内存，不超过短字符串优化的容量时为0
+inline size_t stringHeapBytes(const std::string& value) {
+    static const size_t sso_capacity = std::string().capacity();
+    return value.capacity() > sso_capacity ? value.capacity() + 1 : 0;
+}
+
+// 无序容器的桶数组和节点开销（next指针、元素本身和缓存的哈希值），不含元素的堆内存
+template <typename Container>
+size_t hashTableBytes(const Container& container) {
+    return container.bucket_count() * sizeof(void*) +
+           container.size() * (sizeof(void*) + sizeof(typename Container::value_type) + sizeof(size_t));
+}
+
+// 从first起计算至多samples个元素的element_bytes之和，按元素总数count外推；samples为0时计算全部元素
+template <typename Iterator, typename Fn>
+size_t sampledBytes(Iterator first, Iterator last, size_t count, size_t samples, Fn&& element_bytes) {
+    size_t visited = 0;
+    size_t bytes = 0;
+    for (; first != last && (samples == 0 || visited < samples); ++first) {
+        bytes += element_bytes(*first);
+        visited++;
+    }
+    if (visited == 0 || visited >= count) {
+        return bytes;
+    }
+    return static_cast<size_t>(static_cast<double>(bytes) / visited * count);
+}
+
+// 按桶游标遍历无序容器，供HSCAN/SSCAN/ZSCAN使用，返回下一次调用的游标，0表示遍历结束。
+// 游标高32位记录遍历时的桶数，低32位为下一个桶的下标；两次调用之间容器发生rehash（桶数变化）时
+// 从头重新遍历，元素可能重复返回但不会遗漏。count为期望返回的元素数，空桶最多再多访问count*10个。
+template <typename Container, typename Fn>
+size_t scanBuckets(const Container& container, size_t cursor, size_t count, Fn&& fn) {
+    const size_t buckets = container.bucket_count();
+    size_t bucket = (cursor >> 32) == buckets ? (cursor & 0xFFFFFFFFu) : 0;
+    size_t emitted = 0;
+    size_t empty_visits = count * 10;
+    while (bucket < buckets && emitted < count) {
+        if (container.bucket_size(bucket) == 0) {
+            if (empty_visits-- == 0) {
+                break;
+            }
+        }
+        for (auto it = container.begin(bucket); it != container.end(bucket); ++it) {
+            fn(*it);
+            emitted++;
+        }
+        bucket++;
+    }
+    if (bucket >= buckets) {
+        return 0;
+    }
+    return (static_cast<size_t>(buckets) << 32) | bucket;
+}
 } // namespace dkv
\ No newline at end of file
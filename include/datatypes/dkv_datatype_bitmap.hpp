@@ -1,17 +1,52 @@
 #pragma once
 
 #include "dkv_datatype_base.hpp"
+#include "dkv_bitmap_kernels.hpp"
+#include "dkv_roaring.hpp"
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include <optional>
 
 namespace dkv {
 
+// BITFIELD的一个子命令。位域占[offset, offset + bits)，最高位在offset处
+struct BitFieldOp {
+    enum class Type {
+        GET,
+        SET,
+        INCRBY
+    };
+    // 结果超出位域范围时的处理：WRAP截断为低bits位，SAT取边界值，FAIL不修改并返回空
+    enum class Overflow {
+        WRAP,
+        SAT,
+        FAIL
+    };
+    Type type = Type::GET;
+    Overflow overflow = Overflow::WRAP;
+    bool is_signed = false;
+    uint32_t bits = 0; // 有符号最多64位，无符号最多63位
+    uint64_t offset = 0;
+    int64_t value = 0; // SET的新值或INCRBY的增量
+};
+
 // 位图数据项
+// 默认为稠密的字节数组；置位稀疏时（如只在很大的偏移上置位）改用Roaring压缩编码，
+// 压缩后的内存超过稠密大小时再转换回字节数组
 class BitmapItem : public DataItem {
 private:
-    std::vector<uint8_t> bits_; // 位图数据，使用uint8_t数组存储
+    std::vector<uint8_t> bits_; // 稠密编码的位图数据，使用uint8_t数组存储
+    std::unique_ptr<RoaringBitmap> sparse_; // 稀疏编码，非空时bits_为空
+    size_t sparse_size_ = 0; // 稀疏编码时位图的字节数
+
+    // 小于该字节数的位图始终使用稠密编码
+    static constexpr size_t SPARSE_MIN_BYTES = 4096;
 
 public:
+    // 位偏移上限，与Redis一致，位图最大512MB
+    static constexpr uint64_t MAX_BIT_OFFSET = (1ULL << 32) - 1;
+
     BitmapItem();
     BitmapItem(Timestamp expire_time);
     BitmapItem(const BitmapItem& other);
@@ -21,6 +56,9 @@ public:
     std::string serialize() const override;
     void deserialize(const std::string& data) override;
     std::unique_ptr<DataItem> clone() const override;
+    std::unique_ptr<DataItem> cloneEmpty() const override;
+    size_t memoryUsage(size_t samples) const override;
+    const char* encodingName() const override;
 
     // Bitmap特有操作
     // 设置指定位的值
@@ -29,11 +67,18 @@ public:
     // 获取指定位的值
     bool getBit(uint64_t offset) const;
     
-    // 统计位图中值为1的位的数量
+    // 统计位图中值为1的位的数量，按运行时选用的SIMD实现计数
     size_t bitCount() const;
     
     // 统计指定位范围内值为1的位的数量
     size_t bitCount(uint64_t start, uint64_t end) const;
+
+    // 字节范围[start, end]内第一个值为bit的位，没有时返回-1。
+    // 找清零位且没有指定end时，全部置位的位图返回末尾之后的第一位
+    int64_t bitPos(bool bit, uint64_t start = 0, std::optional<uint64_t> end = std::nullopt) const;
+
+    // 依次执行BITFIELD的子命令。GET和SET返回原值，INCRBY返回新值，FAIL策略下溢出时为空
+    std::vector<std::optional<int64_t>> bitField(const std::vector<BitFieldOp>& ops);
     
     // 获取位图数据大小（字节数）
     size_t size() const;
@@ -43,6 +88,9 @@ public:
     
     // 检查位图是否为空
     bool empty() const;
+
+    // 是否为稀疏编码
+    bool isSparse() const { return sparse_ != nullptr; }
     
     // 位图操作方法
     // 执行多个位图的按位与操作
@@ -56,6 +104,19 @@ public:
     
     // 执行位图的按位非操作
     bool bitOpNot(BitmapItem* bitmap_item);
+
+private:
+    // 位图按位合并，较短的位图视为末尾补0，所有输入在一次遍历中合并
+    bool bitOp(BitmapOp op, const std::vector<BitmapItem*>& bitmap_items);
+
+    // 读写位域的原始位，最高位在offset处
+    uint64_t getField(uint64_t offset, uint32_t bits) const;
+    void setField(uint64_t offset, uint32_t bits, uint64_t raw);
+
+    void toSparse();
+    void toDense();
+    // 按当前内容选用内存更小的编码：压缩后不到稠密大小的一半时转为稀疏编码，超过稠密大小时转回
+    void chooseEncoding();
 };
 
 } // namespace dkv
\ No newline at end of file
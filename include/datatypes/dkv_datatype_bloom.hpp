@@ -0,0 +1,96 @@
+#pragma once
+
+#include "dkv_datatype_base.hpp"
+#include <vector>
+#include <cstdint>
+#include <string>
+#include <memory>
+
+namespace dkv {
+
+// 可扩展布隆过滤器数据项
+// 由若干层分块布隆过滤器组成：当前层插入数达到容量后追加一层，容量乘以扩展因子，误判率减半，
+// 总误判率不超过初始误判率的两倍。每个元素只落在每层的一个64字节块中，
+// 检查和设置一个元素只访问一条缓存行，块内按8个64位字整体与/或，便于编译器向量化
+class BloomFilterItem : public DataItem {
+public:
+    // 默认参数，与BF.ADD自动创建过滤器时相同
+    static constexpr double kDefaultErrorRate = 0.01;
+    static constexpr uint64_t kDefaultCapacity = 100;
+    static constexpr uint32_t kDefaultExpansion = 2;
+    static constexpr size_t kBlockWords = 8; // 每块512位
+    static constexpr size_t kBlockBits = kBlockWords * 64;
+
+    // add的结果
+    enum AddResult {
+        ADD_FULL = -1,   // 不扩展的过滤器已满
+        ADD_EXISTS = 0,  // 元素可能已存在
+        ADD_ADDED = 1
+    };
+
+private:
+    // 一层过滤器
+    struct Layer {
+        double error_rate = 0;
+        uint64_t capacity = 0;
+        uint64_t count = 0;
+        uint32_t hashes = 0;
+        std::vector<uint64_t> words; // 块数 * kBlockWords
+
+        uint64_t blockCount() const { return words.size() / kBlockWords; }
+    };
+
+    std::vector<Layer> layers_;
+    uint32_t expansion_; // 0表示不扩展
+    uint64_t count_;     // 所有层的插入数
+
+    // 64位MurmurHash64A，每个元素只计算一次，各层由它派生位置
+    static uint64_t hash(const Value& value);
+    static Layer makeLayer(double error_rate, uint64_t capacity);
+    // 元素在某层所在块的起始字下标；mask不为空时填入块内要设置的kBlockWords个字的位掩码
+    static size_t locate(const Layer& layer, size_t level, uint64_t hash_value, uint64_t* mask);
+    bool layerContains(size_t level, uint64_t hash_value) const;
+    bool containsHash(uint64_t hash_value) const;
+    int addHash(uint64_t hash_value);
+
+public:
+    BloomFilterItem();
+    BloomFilterItem(Timestamp expire_time);
+    // 指定初始误判率、容量和扩展因子，扩展因子为0时过滤器满后拒绝插入
+    BloomFilterItem(double error_rate, uint64_t capacity, uint32_t expansion);
+    BloomFilterItem(const BloomFilterItem& other);
+
+    // 从DataItem继承的方法
+    DataType getType() const override;
+    std::string serialize() const override;
+    void deserialize(const std::string& data) override;
+    std::unique_ptr<DataItem> clone() const override;
+    std::unique_ptr<DataItem> cloneEmpty() const override;
+    size_t memoryUsage(size_t samples) const override;
+    const char* encodingName() const override;
+
+    // 布隆过滤器特有操作
+    // 添加元素，返回AddResult
+    int add(const Value& element);
+    // 批量添加：先集中计算哈希并预取当前层的块，结果写入results（AddResult）
+    void add(const Value* elements, size_t count, std::vector<int>& results);
+
+    // 元素是否可能存在
+    bool exists(const Value& element) const;
+    // 批量检查：每层先预取所有元素的块再逐个检查
+    void exists(const Value* elements, size_t count, std::vector<bool>& results) const;
+
+    // 插入的元素数（不含判定为已存在的重复元素）
+    uint64_t count() const { return count_; }
+    // 层数与所有层的位数组字节数
+    size_t layerCount() const { return layers_.size(); }
+    size_t bytes() const;
+    uint64_t capacity() const;
+    uint32_t expansion() const { return expansion_; }
+};
+
+// 全局工厂函数声明
+dkv::DataItem* createBloomFilterItem();
+dkv::DataItem* createBloomFilterItem(dkv::Timestamp expire_time);
+
+} // namespace dkv
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "dkv_datatype_base.hpp"
+#include "dkv_listpack.hpp"
 #include <unordered_map>
 #include <vector>
 
@@ -9,7 +10,11 @@ namespace dkv {
 // 哈希数据项
 class HashItem : public DataItem {
 private:
-    std::unordered_map<Value, Value> fields_;  // 字段-值映射
+    // 字段数和字段长度较小时以listpack紧凑存储（字段、值交替），超过阈值后转换为哈希表
+    Listpack packed_;
+    std::unique_ptr<std::unordered_map<Value, Value>> fields_;  // 字段-值映射
+
+    void convertToDict();
 
 public:
     HashItem();
@@ -21,6 +26,9 @@ public:
     std::string serialize() const override;
     void deserialize(const std::string& data) override;
     std::unique_ptr<DataItem> clone() const override;
+    std::unique_ptr<DataItem> cloneEmpty() const override;
+    size_t memoryUsage(size_t samples) const override;
+    const char* encodingName() const override;
     
     // 哈希特有操作
     bool setField(const Value& field, const Value& value);
@@ -30,8 +38,12 @@ public:
     std::vector<Value> getKeys() const;
     std::vector<Value> getValues() const;
     std::vector<std::pair<Value, Value>> getAll() const;
+    // 游标遍历字段，返回下一次调用的游标；紧凑编码时一次返回全部字段并返回0
+    size_t scan(size_t cursor, size_t count, std::vector<std::pair<Value, Value>>& out) const;
     size_t size() const;
     void clear();
+    // 是否为紧凑编码
+    bool isPacked() const { return fields_ == nullptr; }
 };
 
 } // namespace dkv
\ No newline at end of file
@@ -9,25 +9,48 @@
 namespace dkv {
 
 // HyperLogLog数据项
+// 寄存器较少时使用稀疏编码，只保存非零寄存器；非零寄存器超过kSparseMaxEntries个后转为稠密编码，
+// 每个寄存器6位紧凑排列，共12KB
 class HyperLogLogItem : public DataItem {
 private:
-    // HyperLogLog寄存器数组
-    std::vector<uint8_t> registers_;
+    // 稀疏编码：按寄存器下标排序的非零寄存器，每项为 下标 << 8 | 值
+    std::vector<uint32_t> sparse_;
+    // 稠密编码：第i个寄存器占第6i位起的6位（低位起），为空时使用稀疏编码
+    std::vector<uint8_t> dense_;
     // 存储基数估计值的缓存
     mutable uint64_t cardinality_; 
     mutable bool cache_valid_; 
 
+public:
     // HyperLogLog参数
     static constexpr uint8_t kPrecision = 14; // 精度参数
     static constexpr size_t kRegisterCount = 1 << kPrecision; // 寄存器数量
     static constexpr double kAlpha = 0.7213 / (1 + 1.079 / kRegisterCount); // 常数因子
+    static constexpr size_t kDenseBytes = kRegisterCount * 6 / 8; // 稠密编码的字节数
+    static constexpr size_t kSparseMaxEntries = 750; // 稀疏编码最多3000字节
 
+private:
     // MurmurHash3哈希函数
     uint64_t hash(const Value& value) const;
+    // 哈希值对应的寄存器更新：下标 << 8 | 值，与稀疏编码的项格式相同
+    static uint32_t registerEntry(uint64_t hash_value);
+    // 把一批寄存器更新合并到稀疏编码，超过kSparseMaxEntries时转为稠密编码后更新
+    bool addSparse(uint32_t* entries, size_t count);
+    bool addDense(const uint32_t* entries, size_t count);
     
     // 更新缓存的基数估计值
     void updateCardinality() const;
 
+    uint8_t getDenseRegister(size_t index) const;
+    void setDenseRegister(size_t index, uint8_t value);
+    void toDense();
+    // 把寄存器按最大值并入raw（kRegisterCount个字节，每个寄存器一个字节）
+    void maxInto(uint8_t* raw) const;
+    // 从raw寄存器重建，非零寄存器不多且当前为稀疏编码时保持稀疏编码
+    void loadRaw(const uint8_t* raw);
+    // 按寄存器值的直方图计算估计值：调和平均数只需对64个值查表求和
+    static uint64_t estimate(const uint32_t* histogram);
+
 public:
     HyperLogLogItem();
     HyperLogLogItem(Timestamp expire_time);
@@ -38,13 +61,22 @@ public:
     std::string serialize() const override;
     void deserialize(const std::string& data) override;
     std::unique_ptr<DataItem> clone() const override;
+    std::unique_ptr<DataItem> cloneEmpty() const override;
+    size_t memoryUsage(size_t samples) const override;
+    const char* encodingName() const override;
 
     // HyperLogLog特有操作
     // 添加元素到HyperLogLog
     bool add(const Value& element);
+
+    // 批量添加元素：每批先集中计算哈希，再预取寄存器并更新，基数缓存只失效一次
+    bool add(const Value* elements, size_t count);
     
     // 获取基数估计值
     uint64_t count() const;
+
+    // 多个HyperLogLog并集的基数估计值，在栈上的寄存器缓冲区中合并，不修改输入
+    static uint64_t countUnion(const std::vector<const HyperLogLogItem*>& hll_items);
     
     // 合并多个HyperLogLog
     bool merge(const std::vector<HyperLogLogItem*>& hll_items);
@@ -54,6 +86,9 @@ public:
     
     // 检查HyperLogLog是否为空
     bool empty() const;
+
+    // 是否为稀疏编码
+    bool isSparse() const { return dense_.empty(); }
 };
 
 // 全局工厂函数声明
@@ -2,7 +2,7 @@
 #define DKV_DATATYPE_LIST_HPP
 
 #include "dkv_datatype_base.hpp"
-#include <list>
+#include "dkv_quicklist.hpp"
 #include <vector>
 #include <string>
 
@@ -11,7 +11,7 @@ namespace dkv {
 // 列表数据项
 class ListItem : public DataItem {
 private:
-    std::list<Value> elements_;  // 链表
+    QuickList elements_;  // 分块存储的快速列表
 
 public:
     ListItem();
@@ -23,6 +23,9 @@ public:
     std::string serialize() const override;
     void deserialize(const std::string& data) override;
     std::unique_ptr<DataItem> clone() const override;
+    std::unique_ptr<DataItem> cloneEmpty() const override;
+    size_t memoryUsage(size_t samples) const override;
+    const char* encodingName() const override;
     
     // 列表特有操作
     // 在列表左侧插入元素
@@ -37,6 +40,10 @@ public:
     size_t size() const;
     // 获取列表指定范围的元素
     std::vector<Value> lrange(size_t start, size_t stop) const;
+    // 获取指定下标的元素，负数从末尾计数
+    bool lindex(int64_t index, Value& value) const;
+    // 设置指定下标的元素，下标越界返回false
+    bool lset(int64_t index, const Value& value);
     // 清空列表
     void clear();
     // 判断列表是否为空
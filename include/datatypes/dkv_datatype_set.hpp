@@ -2,16 +2,40 @@
 #define DKV_DATATYPE_SET_HPP
 
 #include "dkv_datatype_base.hpp"
+#include "dkv_listpack.hpp"
+#include "dkv_intset.hpp"
 #include <unordered_set>
 #include <vector>
 #include <string>
 
 namespace dkv {
 
+// 集合的编码方式
+enum class SetEncoding : uint8_t {
+    INTSET,   // 元素全是规范形式的整数时存为有序整数数组
+    LISTPACK, // 元素较少且较短
+    HASHTABLE // 哈希集合
+};
+
+// 多个集合的运算
+enum class SetOp {
+    INTER,
+    UNION,
+    DIFF // 第一个集合减去其余集合
+};
+
 // 集合数据项
 class SetItem : public DataItem {
 private:
-    std::unordered_set<Value> elements_;  // 集合元素
+    // 元素全是整数且不超过set_max_intset_entries个时以有序整数数组存储；
+    // 加入非整数后，元素较少且较短时转换为listpack，否则转换为哈希集合。编码只升级不降级
+    IntSet ints_;
+    Listpack packed_;
+    std::unique_ptr<std::unordered_set<Value>> elements_;  // 集合元素
+    SetEncoding encoding_ = SetEncoding::INTSET;
+
+    void convertToListpack();
+    void convertToDict();
 
 public:
     SetItem();
@@ -23,6 +47,9 @@ public:
     std::string serialize() const override;
     void deserialize(const std::string& data) override;
     std::unique_ptr<DataItem> clone() const override;
+    std::unique_ptr<DataItem> cloneEmpty() const override;
+    size_t memoryUsage(size_t samples) const override;
+    const char* encodingName() const override;
     
     // 集合特有操作
     // 向集合添加一个元素
@@ -35,6 +62,8 @@ public:
     size_t srem(const std::vector<Value>& members);
     // 获取集合中所有元素
     std::vector<Value> smembers() const;
+    // 游标遍历元素，返回下一次调用的游标；紧凑编码时一次返回全部元素并返回0
+    size_t scan(size_t cursor, size_t count, std::vector<Value>& out) const;
     // 判断元素是否在集合中
     bool sismember(const Value& member) const;
     // 获取集合的大小
@@ -43,6 +72,13 @@ public:
     void clear();
     // 判断集合是否为空
     bool empty() const;
+    // 是否为紧凑编码（整数数组或listpack）
+    bool isPacked() const { return elements_ == nullptr; }
+    SetEncoding getEncoding() const { return encoding_; }
+
+    // 多个集合的运算结果，nullptr视为空集合。交集按基数从小到大排列集合，逐个取最小集合的元素在其余集合中查找，
+    // 最小的两个集合都是整数数组时先做有序合并；差集逐个检查第一个集合的元素
+    static std::unique_ptr<SetItem> combine(SetOp op, const std::vector<const SetItem*>& sets);
 };
 
 } // namespace dkv
@@ -4,25 +4,78 @@
 
 namespace dkv {
 
+// 字符串值的编码方式
+enum class StringEncoding : uint8_t {
+    INT,    // 规范形式的整数，直接存为int64
+    EMBSTR, // 短字符串，嵌入数据项内部
+    RAW,        // 长字符串，单独分配
+    COMPRESSED  // 开启字符串压缩后，不小于阈值且压缩收益足够的长字符串按LZF压缩后单独分配
+};
+
+// 字符串值压缩配置，启动时设置
+struct StringCompressionConfig {
+    bool enabled = false;
+    // 参与压缩的最小字符串长度
+    size_t min_bytes = 1024;
+    // 原长与压缩后长度之比不低于该值时才保存压缩形式
+    double min_ratio = 1.25;
+};
+
+StringCompressionConfig& stringCompressionConfig();
+
 // 字符串数据项
 class StringItem : public DataItem {
+public:
+    // 嵌入数据项内部的最大字符串长度，使StringItem恰好占64字节
+    static constexpr size_t EMBSTR_MAX_LEN = 22;
+
 private:
-    Value value_;
+    union {
+        int64_t int_value_;
+        char embstr_[EMBSTR_MAX_LEN];
+        Value* raw_;
+        struct {
+            Value* data;      // 压缩后的字节
+            uint32_t raw_len; // 原长
+        } compressed_;
+    };
+    uint8_t embstr_len_ = 0;
+    StringEncoding encoding_ = StringEncoding::EMBSTR;
+
+    // 按值选择编码并写入，调用前需已释放旧的RAW或COMPRESSED值
+    void encode(const Value& value);
+    // 按配置尝试压缩，成功时返回压缩后的字节
+    static bool tryCompress(const Value& value, Value& out);
+    void releaseRaw();
 
 public:
     explicit StringItem(const Value& value = "");
     StringItem(const Value& value, Timestamp expire_time);
     StringItem(const StringItem& other);
+    ~StringItem() override;
 
     // 从DataItem继承的方法
     DataType getType() const override;
     std::string serialize() const override;
     void deserialize(const std::string& data) override;
     std::unique_ptr<DataItem> clone() const override;
+    std::unique_ptr<DataItem> cloneEmpty() const override;
+    size_t memoryUsage(size_t samples) const override;
+    const char* encodingName() const override;
 
     // String特有操作
-    const Value& getValue() const;
+    // 按需将编码后的值还原为字符串，COMPRESSED编码在此时解压
+    Value getValue() const;
     void setValue(const Value& value);
+
+    StringEncoding getEncoding() const { return encoding_; }
+    // 值可以按整数解释时返回true
+    bool getInt(int64_t& out) const;
+    // 整数加减，值不是整数或结果溢出时返回false
+    bool incrBy(int64_t delta, int64_t& result);
+
+    // 规范形式的整数字符串（无前导零、无正号、不溢出）
+    static bool tryParseInt(const Value& value, int64_t& out);
 };
 
-} // namespace dkv
\ No newline at end of file
+} // namespace dkv
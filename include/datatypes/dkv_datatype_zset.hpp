@@ -2,22 +2,53 @@
 #define DKV_DATATYPE_ZSET_HPP
 
 #include "dkv_datatype_base.hpp"
+#include "dkv_skiplist.hpp"
+#include "dkv_listpack.hpp"
+#include "dkv_datatype_set.hpp"
 #include <unordered_map>
-#include <unordered_set>
-#include <map>
 #include <vector>
 #include <string>
 #include <algorithm>
 
 namespace dkv {
 
+// ZUNIONSTORE/ZINTERSTORE中同一成员的分数合并方式
+enum class ZSetAggregate {
+    SUM,
+    MIN,
+    MAX
+};
+
+// ZRANGESTORE的范围：按排名[start, stop]或按分数[min, max]，rev时从大到小计排名
+struct ZRangeSpec {
+    bool by_score = false;
+    bool rev = false;
+    size_t start = 0;
+    size_t stop = 0;
+    double min = 0;
+    double max = 0;
+};
+
 // 有序集合数据项
 class ZSetItem : public DataItem {
 private:
-    // 使用map按分数排序元素（分数 -> 元素列表）
-    std::map<double, std::unordered_set<Value>> elements_by_score_;
-    // 使用unordered_map快速查找元素的分数
-    std::unordered_map<Value, double> scores_;
+    // 元素较少且较短时以listpack紧凑存储（成员、分数交替，按 (分数, 成员) 排序），
+    // 超过阈值后转换为跳表加哈希表
+    Listpack packed_;
+
+    struct SortedDict {
+        // 跳表按 (分数, 成员) 排序元素，支持O(log N)的排名和范围查询
+        ZSkipList zsl;
+        // 使用unordered_map快速查找元素的分数
+        std::unordered_map<Value, double> scores;
+    };
+    std::unique_ptr<SortedDict> dict_;
+
+    void convertToDict();
+    // 紧凑编码下查找成员条目的偏移
+    size_t packedFind(const Value& member) const;
+    void packedInsert(const Value& member, double score);
+    double packedScore(size_t member_pos) const;
 
 public:
     ZSetItem();
@@ -29,6 +60,9 @@ public:
     std::string serialize() const override;
     void deserialize(const std::string& data) override;
     std::unique_ptr<DataItem> clone() const override;
+    std::unique_ptr<DataItem> cloneEmpty() const override;
+    size_t memoryUsage(size_t samples) const override;
+    const char* encodingName() const override;
     
     // 有序集合特有操作
     // 向有序集合添加元素及其分数
@@ -57,12 +91,25 @@ public:
     std::vector<std::pair<Value, double>> zrevrangebyscore(double max, double min) const;
     // 获取指定分数范围内的元素个数
     size_t zcount(double min, double max) const;
+    // 游标遍历成员及分数，返回下一次调用的游标；紧凑编码时一次返回全部成员并返回0
+    size_t scan(size_t cursor, size_t count, std::vector<std::pair<Value, double>>& out) const;
     // 获取有序集合的大小
     size_t zcard() const;
     // 清空有序集合
     void clear();
     // 判断有序集合是否为空
     bool empty() const;
+    // 是否为紧凑编码
+    bool isPacked() const { return dict_ == nullptr; }
+
+    // 清空后整体载入，entries已按 (分数, 成员) 排序且成员不重复。
+    // 满足紧凑编码阈值时依次追加到listpack，否则顺序构建跳表，不逐个查找插入位置
+    void assignSorted(std::vector<std::pair<Value, double>>&& entries);
+    // 有序集合的并集或交集（op为UNION或INTER），nullptr视为空集合，weights与sets一一对应。
+    // 各输入先按成员排序，再用最小堆做k路归并，相同成员的分数乘以权重后按aggregate合并；
+    // 元素总数较多时按成员区间分成多段并行归并，各段按 (分数, 成员) 排序后再归并为结果
+    static std::unique_ptr<ZSetItem> combine(SetOp op, const std::vector<const ZSetItem*>& sets,
+                                             const std::vector<double>& weights, ZSetAggregate aggregate);
 };
 
 } // namespace dkv
@@ -0,0 +1,47 @@
+#ifndef DKV_INTSET_HPP
+#define DKV_INTSET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dkv {
+
+// 有序整数数组：元素按值升序连续存放，宽度取能容纳全部元素的最小值（2、4或8字节）。
+// 插入超出当前宽度的值时整体升级宽度，删除不降级。查找为二分查找
+class IntSet {
+public:
+    size_t size() const { return data_.size() / width_; }
+    bool empty() const { return data_.empty(); }
+    size_t bytes() const { return data_.size(); }
+    // 底层字节数组，用于内存估算
+    const std::string& raw() const { return data_; }
+    uint8_t width() const { return width_; }
+    void clear();
+
+    int64_t get(size_t index) const;
+    bool contains(int64_t value) const;
+    // 插入，已存在时返回false
+    bool insert(int64_t value);
+    // 删除，不存在时返回false
+    bool erase(int64_t value);
+
+    // 两个整数集合的交集，按升序追加到out。较小的集合的元素依次在较大的集合中定位：
+    // 大小相差悬殊时二分查找，否则在较大的集合中按块推进，块内用SIMD一次比较一个寄存器宽的元素（AVX2可用时）
+    static void intersect(const IntSet& a, const IntSet& b, std::vector<int64_t>& out);
+
+private:
+    static uint8_t widthOf(int64_t value);
+    // 第一个不小于value的下标
+    size_t lowerBound(int64_t value) const;
+    void set(size_t index, int64_t value);
+    void upgrade(uint8_t width);
+
+    std::string data_;
+    uint8_t width_ = sizeof(int16_t);
+};
+
+} // namespace dkv
+
+#endif // DKV_INTSET_HPP
@@ -0,0 +1,79 @@
+#ifndef DKV_LISTPACK_HPP
+#define DKV_LISTPACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace dkv {
+
+// 小集合的紧凑编码阈值，由服务器配置设置
+// 元素个数或任一元素长度超过阈值时转换为普通编码
+struct ListpackConfig {
+    size_t hash_max_entries = 128;
+    size_t hash_max_value = 64;
+    size_t set_max_entries = 128;
+    size_t set_max_value = 64;
+    // 元素全是整数的集合以有序整数数组存储的最大元素个数
+    size_t set_max_intset_entries = 512;
+    size_t zset_max_entries = 128;
+    size_t zset_max_value = 64;
+    // 快速列表每个节点的最大字节数
+    size_t list_max_bytes = 8192;
+    // 快速列表两端各保留多少个不压缩的节点，0表示不压缩
+    size_t list_compress_depth = 0;
+};
+
+ListpackConfig& listpackConfig();
+
+// 连续内存中依次存放的变长条目
+// 每个条目为 [长度][内容][回退长度]，回退长度从末尾反向读取，用于反向遍历。
+// 条目以字节偏移定位，end()为末尾之后的偏移。
+class Listpack {
+public:
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    size_t bytes() const { return data_.size(); }
+    void clear();
+
+    // 原始编码，用于整体压缩和还原
+    const std::string& raw() const { return data_; }
+    void assign(std::string data, size_t count);
+
+    // 偏移量遍历
+    size_t begin() const { return 0; }
+    size_t end() const { return data_.size(); }
+    size_t next(size_t pos) const;
+    size_t prev(size_t pos) const;
+    // 最后一个条目的偏移，空时返回end()
+    size_t last() const;
+    std::string_view get(size_t pos) const;
+
+    void append(std::string_view value);
+    void prepend(std::string_view value);
+    // 在pos之前插入，返回新条目的偏移
+    size_t insert(size_t pos, std::string_view value);
+    // 删除pos处的条目，返回下一个条目的偏移
+    size_t erase(size_t pos);
+    // 删除从pos开始的count个条目，返回下一个条目的偏移
+    size_t erase(size_t pos, size_t count);
+    // 替换pos处的条目，返回该条目的偏移
+    size_t replace(size_t pos, std::string_view value);
+
+    // 从pos开始、每隔skip个条目比较一次，返回第一个相等条目的偏移，找不到返回end()
+    size_t find(std::string_view value, size_t skip = 0, size_t pos = 0) const;
+    // 第index个条目的偏移，负数从末尾计数，越界返回end()
+    size_t seek(int64_t index) const;
+
+private:
+    static size_t encodedSize(size_t length);
+    static void encodeEntry(std::string& out, std::string_view value);
+
+    std::string data_;
+    size_t count_ = 0;
+};
+
+} // namespace dkv
+
+#endif // DKV_LISTPACK_HPP
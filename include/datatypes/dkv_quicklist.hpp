@@ -0,0 +1,69 @@
+#ifndef DKV_QUICKLIST_HPP
+#define DKV_QUICKLIST_HPP
+
+#include "dkv_listpack.hpp"
+#include "../dkv_core.hpp"
+#include <list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dkv {
+
+// 快速列表：由listpack节点组成的双向链表
+// 每个节点存放多个连续元素，节点字节数受list_max_bytes限制，两端插入只需偶尔新建节点；
+// 范围和下标访问按节点元素数整块跳过。list_compress_depth大于0时，
+// 两端各depth个节点保持原样，中间节点用LZF压缩，访问时临时解压。
+class QuickList {
+public:
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    void clear();
+
+    void pushFront(std::string_view value);
+    void pushBack(std::string_view value);
+    bool popFront(Value& value);
+    bool popBack(Value& value);
+
+    // 闭区间[start, stop]内的元素，stop超出范围时截断
+    std::vector<Value> range(size_t start, size_t stop) const;
+    // 下标访问，负数从末尾计数，越界返回false
+    bool index(int64_t index, Value& value) const;
+    bool set(int64_t index, std::string_view value);
+
+    // 统计信息
+    size_t nodeCount() const { return nodes_.size(); }
+    size_t compressedNodeCount() const;
+    // 估算节点占用的内存字节数，只计算前samples个节点并按节点数外推，samples为0时计算全部节点
+    size_t memoryUsage(size_t samples) const;
+
+private:
+    struct Node {
+        Listpack entries;        // 未压缩时的元素
+        std::string compressed;  // 压缩后的数据
+        size_t count = 0;        // 元素个数，压缩后仍然有效
+        size_t raw_bytes = 0;    // 压缩前的字节数
+        bool is_compressed = false;
+    };
+
+    using NodeList = std::list<Node>;
+
+    // 新元素能否放入节点
+    static bool fits(const Node& node, std::string_view value);
+    static void compressNode(Node& node);
+    static void decompressNode(Node& node);
+    // 只读访问时返回可直接读取的listpack，压缩节点解压到scratch中
+    static const Listpack& view(const Node& node, Listpack& scratch);
+    // 定位下标所在节点，offset为节点内偏移
+    NodeList::iterator locate(size_t index, size_t& offset);
+    NodeList::const_iterator locate(size_t index, size_t& offset) const;
+    // 两端修改后调整压缩边界，只检查两端depth+1个节点
+    void rebalanceCompression();
+
+    NodeList nodes_;
+    size_t count_ = 0;
+};
+
+} // namespace dkv
+
+#endif // DKV_QUICKLIST_HPP
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "dkv_bitmap_kernels.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dkv {
+
+// Roaring压缩位图。位号按高位分块，每块65536位，块内按内容选用容器：
+// 数组容器保存有序的块内位号（不超过4096个），位集容器为8KB的位数组，游程容器保存连续置位的区间。
+// 内存与置位数和置位的分布有关，与最大位号无关。位号与稠密字节数组的对应关系为第i字节的第j位（低位起）是i*8+j
+class RoaringBitmap {
+public:
+    static constexpr uint64_t CHUNK_BITS = 65536;
+    static constexpr size_t BITSET_WORDS = CHUNK_BITS / 64;
+    // 数组容器的最大元素数，更多时位集容器更小
+    static constexpr uint32_t ARRAY_MAX = 4096;
+    // 每个块的固定开销（映射节点和容器头部），用于估算内存
+    static constexpr size_t CHUNK_OVERHEAD = 80;
+
+    // 设置位并返回原来的值
+    bool set(uint64_t pos, bool value);
+    bool get(uint64_t pos) const;
+    // 置位总数
+    uint64_t cardinality() const;
+    // [begin, end)内的置位数
+    uint64_t rangeCardinality(uint64_t begin, uint64_t end) const;
+    // [begin, end)内第一个值为bit的位，没有时返回end。找置位时跳过不存在的块，找清零位时跳过整块置位的块
+    uint64_t nextBit(bool bit, uint64_t begin, uint64_t end) const;
+    // 估算占用的内存（字节）
+    size_t memoryUsage() const { return memory_bytes_; }
+    bool empty() const { return chunks_.empty(); }
+    void clear();
+
+    // 多个位图按位合并。各块在一个位集缓冲区中依次合并所有输入后按内容选用最小的容器，
+    // 与运算只处理所有输入都有的块
+    static RoaringBitmap combine(BitmapOp op, const std::vector<const RoaringBitmap*>& inputs);
+    // [0, bits)内按位取反
+    static RoaringBitmap invert(const RoaringBitmap& input, uint64_t bits);
+
+    // 把置位写入稠密字节数组，数组需已清零且足够长
+    void toDense(std::vector<uint8_t>& bytes) const;
+    static RoaringBitmap fromDense(const std::vector<uint8_t>& bytes);
+    // 稠密字节数组转换后的内存估算，不实际构建
+    static size_t estimateMemory(const std::vector<uint8_t>& bytes);
+
+    // 序列化时每个块选用编码最短的容器：[块数] 之后每块为 [块号][容器类型][元素数][内容]
+    void serialize(std::string& out) const;
+    // 数据不完整或格式错误时返回false，此时位图为空
+    bool deserialize(std::string_view data);
+
+private:
+    struct Container {
+        enum class Type : uint8_t {
+            ARRAY = 0,
+            BITSET = 1,
+            RUN = 2
+        };
+        Type type = Type::ARRAY;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> values; // 数组容器为有序的块内位号，游程容器为起点与长度减1交替排列
+        std::vector<uint64_t> words;  // 位集容器的位数组
+
+        size_t memoryUsage() const;
+        bool get(uint16_t low) const;
+        bool set(uint16_t low, bool value);
+        uint32_t rangeCardinality(uint32_t begin, uint32_t end) const;
+        // 从from起第一个值为bit的块内位号，没有时返回CHUNK_BITS
+        uint32_t next(uint32_t from, bool bit) const;
+        // 把置位并入words（BITSET_WORDS个字）
+        void toWords(uint64_t* out) const;
+        // 按内容选用数组、位集和游程中最小的一种；allow_run为false时不使用游程容器
+        static Container fromWords(const uint64_t* in, bool allow_run);
+        // 整块置位的游程容器
+        static Container full();
+    };
+
+    void addChunk(uint64_t key, Container container);
+
+    std::map<uint64_t, Container> chunks_;
+    size_t memory_bytes_ = 0;
+};
+
+} // namespace dkv
+
+
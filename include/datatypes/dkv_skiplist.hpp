@@ -0,0 +1,74 @@
+#ifndef DKV_SKIPLIST_HPP
+#define DKV_SKIPLIST_HPP
+
+#include "../dkv_core.hpp"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace dkv {
+
+// 有序集合使用的跳表，按 (分数, 成员字典序) 排序
+// 每层指针记录跨越的节点数（span），排名与按排名定位均为O(log N)
+class ZSkipList {
+public:
+    static constexpr int MAX_LEVEL = 32;
+
+    struct Node {
+        struct Level {
+            Node* forward;
+            size_t span;
+        };
+
+        Value member;
+        double score;
+        Node* backward;
+        int level;
+
+        Node* next() const { return levels()[0].forward; }
+        Node* prev() const { return backward; }
+        // 各层指针紧跟在节点之后分配
+        Level* levels() const { return reinterpret_cast<Level*>(const_cast<Node*>(this) + 1); }
+    };
+
+    ZSkipList();
+    ZSkipList(const ZSkipList& other);
+    ZSkipList& operator=(const ZSkipList&) = delete;
+    ~ZSkipList();
+
+    // 插入节点，调用方保证成员不存在
+    Node* insert(double score, const Value& member);
+    // 清空后按顺序整体构建，entries已按 (分数, 成员) 排序且成员不重复。
+    // 节点依次追加在各层末尾，不做查找，O(N)
+    void assignSorted(std::vector<std::pair<Value, double>>&& entries);
+    // 删除节点，不存在时返回false
+    bool erase(double score, const Value& member);
+    void clear();
+
+    // 成员的排名，从1开始，不存在时返回0
+    size_t getRank(double score, const Value& member) const;
+    // 按排名（从1开始）定位节点
+    Node* getByRank(size_t rank) const;
+    // 分数在[min, max]内的第一个和最后一个节点
+    Node* firstInRange(double min, double max) const;
+    Node* lastInRange(double min, double max) const;
+
+    Node* first() const { return header_->next(); }
+    Node* last() const { return tail_; }
+    size_t size() const { return length_; }
+
+private:
+    static Node* createNode(int level, double score, Value member);
+    static void destroyNode(Node* node);
+    static int randomLevel();
+    void deleteNode(Node* node, Node** update);
+
+    Node* header_;
+    Node* tail_ = nullptr;
+    size_t length_ = 0;
+    int level_ = 1;
+};
+
+} // namespace dkv
+
+#endif // DKV_SKIPLIST_HPP
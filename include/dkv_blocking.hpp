@@ -0,0 +1,78 @@
+#pragma once
+
+#include "dkv_core.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace dkv {
+
+// 阻塞在列表键上的客户端。BLPOP/BRPOP/BLMOVE在列表为空时登记到所等待的每个键的队列，
+// 推入元素的命令把键标记为就绪，执行完成后按登记顺序重新执行等待者的命令，最早登记的等待者先得到元素。
+// 等待期间不占用任何线程：回调由推入元素的线程、超时所在的SubReactor或取消方调用。
+class BlockedClients {
+public:
+    // 在本机执行命令，不阻塞
+    using Executor = std::function<Response(const Command& command)>;
+    using Callback = std::function<void(const Response& response)>;
+
+    struct Client {
+        Command command;
+        Callback done;
+        // 以下由BlockedClients::mutex_保护
+        bool finished = false;
+        // 命令正在执行时超时或取消只做标记，由执行完的服务线程根据结果处理
+        bool serving = false;
+        bool timed_out = false;
+        bool cancelled = false;
+        std::vector<std::list<std::shared_ptr<Client>>::iterator> positions; // 在各键队列中的位置，与command.keys()一一对应
+    };
+
+    explicit BlockedClients(Executor executor) : executor_(std::move(executor)) {}
+
+    // 登记等待command的键，返回的句柄用于超时和取消。登记后立即尝试一次，
+    // 检查与登记之间推入的元素不会被错过，此时done在返回前已被调用
+    std::shared_ptr<Client> block(const Command& command, Callback done);
+    // 键上推入了元素，只在有客户端等待时记录，可在持有存储锁时调用
+    void signalKeyReady(const Key& key);
+    // 为就绪的键依次服务等待者，不能在持有存储锁时调用
+    void serveReadyKeys();
+    // 等待超时，回复空结果
+    void timeout(const std::weak_ptr<Client>& client);
+    // 连接断开，放弃等待且不回复
+    void cancel(const std::weak_ptr<Client>& client);
+
+    size_t size() const { return blocked_count_.load(std::memory_order_relaxed); }
+
+    // 解析以秒为单位的超时参数，可以带小数，0表示一直等待；不是非负数时返回false
+    static bool parseTimeout(const std::string& arg, std::chrono::milliseconds& timeout);
+
+private:
+    using Queue = std::list<std::shared_ptr<Client>>;
+
+    // 从所有键的队列中移除，调用时需持有mutex_
+    void unlinkLocked(Client& client);
+
+    Executor executor_;
+    // 服务等待者时一直持有，同一时刻只有一个线程按登记顺序服务等待者
+    std::mutex serve_mutex_;
+    // 保护各键的等待队列和Client中的状态，执行命令时不持有：命令可能写AOF并等待刷盘
+    std::mutex mutex_;
+    std::unordered_map<Key, Queue> queues_;
+    std::atomic<size_t> blocked_count_{0};
+
+    // 就绪的键，由ready_mutex_保护。推入元素的命令可能在脚本中持有全部分段锁，不能获取mutex_
+    std::mutex ready_mutex_;
+    std::vector<Key> ready_keys_;
+    std::unordered_set<Key> ready_set_;
+    std::atomic<bool> has_ready_{false};
+};
+
+} // namespace dkv
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "dkv_core.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace dkv {
+
+// 服务器级缓存时钟（与Redis的server.mstime相同）
+// 更新线程每毫秒读取一次系统时钟并缓存，LRU/LFU时钟和过期判断读取缓存值，只需一次原子读。
+// 缓存值最多落后系统时钟一个更新间隔；TTL回复、设置过期时间等需要精确时间的地方仍使用Utils::getCurrentTime。
+// 更新线程按引用计数启停，未运行时退回读取系统时钟，单独使用StorageEngine时行为不变。
+class CachedClock {
+public:
+    // 更新间隔
+    static constexpr std::chrono::milliseconds RESOLUTION{1};
+
+    // 启动更新线程，可多次调用，与stop成对使用
+    static void start();
+    static void stop();
+    static bool running() { return now_ms_.load(std::memory_order_relaxed) != 0; }
+
+    // 当前时间，毫秒精度
+    static Timestamp now() { return Timestamp(std::chrono::milliseconds(nowMs())); }
+    // 当前时间距纪元的毫秒数
+    static int64_t nowMs() {
+        int64_t cached = now_ms_.load(std::memory_order_relaxed);
+        return cached != 0 ? cached : systemMs();
+    }
+
+private:
+    static int64_t systemMs();
+    static void run();
+
+    // 缓存的毫秒时间，0表示更新线程未运行
+    static std::atomic<int64_t> now_ms_;
+};
+
+} // namespace dkv
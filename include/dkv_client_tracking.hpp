@@ -0,0 +1,84 @@
+#pragma once
+
+#include "dkv_core.hpp"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dkv {
+
+class SubReactor;
+
+// 开启CLIENT TRACKING的连接，失效通知经它所在的SubReactor写出
+struct TrackingClient {
+    SubReactor* reactor = nullptr;
+    int fd = -1;
+    uint64_t connection_id = 0;
+};
+
+// 发给一个连接的失效通知，flush_all为true时通知其清空全部缓存
+struct TrackingInvalidation {
+    TrackingClient client;
+    bool flush_all = false;
+    std::vector<Key> keys;
+};
+
+// 客户端缓存的失效通知表：记录开启跟踪的连接读过哪些键，键被修改时通知这些连接。
+// 表中只保存键的64位哈希到连接槽位位图的映射，不保存键本身，哈希冲突只会产生多余的通知。
+// 与Redis相同，一个键通知一次后清除记录，连接再次读取时重新登记。
+// 修改键的命令只记下待发送的通知，可在持有存储锁时调用；通知由命令完成后的调用方取出并写出，
+// 写出需要获取连接所在SubReactor的锁
+class ClientTracking {
+public:
+    static constexpr size_t DEFAULT_MAX_KEYS = 1000000;
+
+    // 开启跟踪，已开启时不变
+    void enable(const TrackingClient& client);
+    // 关闭跟踪并清除该连接的全部记录和待发送的通知，连接断开时同样调用
+    void disable(SubReactor* reactor, uint64_t connection_id);
+    bool isTracking(SubReactor* reactor, uint64_t connection_id) const;
+    size_t clients() const { return client_count_.load(std::memory_order_relaxed); }
+    size_t keys() const;
+
+    // 登记连接读取了keys，没有开启跟踪时忽略。表超出上限时淘汰记录，
+    // 被淘汰记录的连接无法再收到这些键的通知，改为通知其清空全部缓存
+    void recordRead(SubReactor* reactor, uint64_t connection_id, const std::vector<Key>& keys);
+    // keys被修改，记下需要通知的连接并清除这些键的记录
+    void invalidate(const std::vector<Key>& keys);
+    // 整个键空间被清空，通知所有开启跟踪的连接清空全部缓存并清除全部记录
+    void invalidateAll();
+    // 取出待发送的通知，同一连接的通知合并为一条
+    std::vector<TrackingInvalidation> takeInvalidations();
+
+    // 表中最多记录的键哈希数，至少为1
+    void setMaxKeys(size_t max_keys);
+
+private:
+    using Bitmap = std::vector<uint64_t>;
+
+    static uint64_t keyHash(const Key& key);
+    // 以下调用时需持有mutex_
+    // 清除位图中的槽位
+    void clearSlotLocked(size_t slot);
+    // 为位图中的每个槽位记下通知，key为nullptr时通知清空全部缓存
+    void notifyLocked(const Bitmap& bitmap, const Key* key);
+    void notifySlotLocked(size_t slot, const Key* key);
+
+    mutable std::mutex mutex_;
+    std::vector<TrackingClient> slots_;
+    std::vector<bool> slot_used_;
+    std::vector<size_t> free_slots_;
+    std::map<std::pair<SubReactor*, uint64_t>, size_t> slot_index_;
+    std::unordered_map<uint64_t, Bitmap> table_;
+    size_t max_keys_ = DEFAULT_MAX_KEYS;
+    // 待发送的通知，按槽位索引
+    std::map<size_t, TrackingInvalidation> pending_;
+    std::atomic<size_t> client_count_{0};
+    std::atomic<bool> has_pending_{false};
+};
+
+} // namespace dkv
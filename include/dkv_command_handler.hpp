@@ -4,6 +4,7 @@
 #include "dkv_core.hpp"
 #include "storage/dkv_storage.hpp"
 #include "persist/dkv_aof.hpp"
+#include "dkv_script_cache.hpp"
 #include <memory>
 #include <functional>
 
@@ -11,8 +12,8 @@ namespace dkv {
 
 class DKVServer;
 
-// 脚本命令执行回调类型
-using ScriptCommandExecutor = std::function<std::string(const std::string& command, TransactionID tx_id)>;
+// 脚本命令执行回调类型：脚本中的命令解析后直接执行，不再经过RESP编码
+using ScriptCommandExecutor = std::function<Response(const Command& command, TransactionID tx_id)>;
 
 // 命令处理器类，负责处理各种Redis命令
 class CommandHandler {
@@ -22,12 +23,19 @@ public:
     
     // 设置脚本命令执行回调
     void setScriptCommandCallback(ScriptCommandExecutor callback);
+    // 编译后脚本的缓存，EVALX、EVALSHA和SCRIPT命令共用
+    ScriptCache& scriptCache() { return script_cache_; }
     
     // 基本命令处理
     Response handleSetCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     Response handleGetCommand(TransactionID tx_id, const Command& command);
     Response handleDelCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
+    // 与DEL相同，但较大的值交给后台线程释放
+    Response handleUnlinkCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     Response handleExistsCommand(TransactionID tx_id, const Command& command);
+    Response handleMGetCommand(TransactionID tx_id, const Command& command);
+    // nx为true时处理MSETNX
+    Response handleMSetCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty, bool nx);
     Response handleIncrCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     Response handleDecrCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     Response handleExpireCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
@@ -36,6 +44,8 @@ public:
     // 哈希命令处理
     Response handleHSetCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     Response handleHGetCommand(TransactionID tx_id, const Command& command);
+    Response handleHMSetCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
+    Response handleHMGetCommand(TransactionID tx_id, const Command& command);
     Response handleHGetAllCommand(TransactionID tx_id, const Command& command);
     Response handleHDeldCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     Response handleHExistsCommand(TransactionID tx_id, const Command& command);
@@ -50,6 +60,12 @@ public:
     Response handleRPopCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     Response handleLLenCommand(TransactionID tx_id, const Command& command);
     Response handleLRangeCommand(TransactionID tx_id, const Command& command);
+    Response handleLIndexCommand(TransactionID tx_id, const Command& command);
+    Response handleLSetCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
+    // BLPOP/BRPOP/BLMOVE的一次非阻塞尝试，列表都为空时返回NOT_FOUND，由调用方决定是否等待
+    Response handleBlockingPopCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty, bool left);
+    Response handleBLMoveCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
+    Response handleLMoveCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     
     // 集合命令处理
     Response handleSAddCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
@@ -57,6 +73,10 @@ public:
     Response handleSMembersCommand(TransactionID tx_id, const Command& command);
     Response handleSIsMemberCommand(TransactionID tx_id, const Command& command);
     Response handleSCardCommand(TransactionID tx_id, const Command& command);
+    // SINTER/SUNION/SDIFF，op由命令类型决定
+    Response handleSetOpCommand(TransactionID tx_id, const Command& command, SetOp op);
+    // SINTERSTORE/SUNIONSTORE/SDIFFSTORE
+    Response handleSetOpStoreCommand(TransactionID tx_id, const Command& command, SetOp op, bool& need_inc_dirty);
     
     // 有序集合命令处理
     Response handleZAddCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
@@ -71,24 +91,50 @@ public:
     Response handleZRevRangeByScoreCommand(TransactionID tx_id, const Command& command);
     Response handleZCountCommand(TransactionID tx_id, const Command& command);
     Response handleZCardCommand(TransactionID tx_id, const Command& command);
+    // ZUNIONSTORE/ZINTERSTORE
+    Response handleZSetOpStoreCommand(TransactionID tx_id, const Command& command, SetOp op, bool& need_inc_dirty);
+    Response handleZRangeStoreCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     
     // 位图命令处理
     Response handleSetBitCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     Response handleGetBitCommand(TransactionID tx_id, const Command& command);
     Response handleBitCountCommand(TransactionID tx_id, const Command& command);
     Response handleBitOpCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
+    Response handleBitPosCommand(TransactionID tx_id, const Command& command);
+    Response handleBitFieldCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     
     // HyperLogLog命令处理
     Response handlePFAddCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
     Response handlePFCountCommand(TransactionID tx_id, const Command& command);
     Response handlePFMergeCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
+
+    // 布隆过滤器命令处理
+    // BF.RESERVE key error_rate capacity [EXPANSION expansion] [NONSCALING]
+    Response handleBFReserveCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
+    // BF.ADD key item 与 BF.MADD key item [item ...]，后者逐个返回结果
+    Response handleBFAddCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty);
+    // BF.EXISTS key item 与 BF.MEXISTS key item [item ...]
+    Response handleBFExistsCommand(TransactionID tx_id, const Command& command);
+    Response handleBFCardCommand(TransactionID tx_id, const Command& command);
     
     // 脚本命令处理
     Response handleEvalXCommand(TransactionID tx_id, const Command& command);
+    // EVALSHA sha1：执行SCRIPT LOAD或EVALX缓存过的脚本
+    Response handleEvalShaCommand(TransactionID tx_id, const Command& command);
+    // SCRIPT LOAD script(base64 encoded) | SCRIPT EXISTS sha1 [sha1 ...] | SCRIPT FLUSH
+    Response handleScriptCommand(const Command& command);
     Response handleRestoreHLLCommand(const Command& command, bool& need_inc_dirty);
+    Response handleRestoreBatchCommand(const Command& command, bool& need_inc_dirty);
+    
+    // 游标遍历命令处理，回复为[下一次的游标, 本次返回的元素数组]
+    Response handleScanCommand(const Command& command);
+    Response handleHScanCommand(TransactionID tx_id, const Command& command);
+    Response handleSScanCommand(TransactionID tx_id, const Command& command);
+    Response handleZScanCommand(TransactionID tx_id, const Command& command);
     
     // 服务器管理命令处理
-    Response handleFlushDBCommand(bool& need_inc_dirty);
+    // FLUSHDB [ASYNC|SYNC]，不带参数时按lazyfree_lazy_user_flush配置选择
+    Response handleFlushDBCommand(const Command& command, bool& need_inc_dirty);
     Response handleDBSizeCommand();
     Response handleInfoCommand(size_t key_count, size_t expired_keys, size_t total_keys, 
                               size_t memory_usage, size_t max_memory);
@@ -109,6 +155,21 @@ private:
     AOFPersistence* aof_persistence_;  // AOF持久化指针
     bool enable_aof_;  // 是否启用AOF
     ScriptCommandExecutor script_command_executor_;  // 脚本命令执行回调
+    ScriptCache script_cache_;  // 按SHA1缓存的脚本编译结果
+    
+    // 执行编译好的脚本，脚本中的command()调用在tx_id事务中执行。
+    // 执行期间持有全部分段锁，脚本中的命令不再逐个加锁，其他客户端看不到脚本的中间状态
+    Response runScript(TransactionID tx_id, const CompiledScript& script);
+    
+    // 游标遍历命令的选项
+    struct ScanOptions {
+        size_t cursor = 0;
+        size_t count = 10;        // 期望每次返回的元素数，只是提示
+        std::string pattern;      // MATCH模式，为空表示不过滤
+    };
+    // 解析args[cursor_index]处的游标及其后的MATCH/COUNT选项，失败时返回false并填写错误回复
+    bool parseScanOptions(const Command& command, size_t cursor_index, ScanOptions& options, Response& error);
+    static Response scanReply(size_t cursor, std::vector<std::string>&& items);
     
     // 通用参数验证
     bool validateParamCount(const Command& command, size_t min_count);
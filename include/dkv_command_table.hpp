@@ -0,0 +1,335 @@
+#pragma once
+
+#include "dkv_core.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace dkv {
+
+// 命令属性
+constexpr uint32_t CMD_READONLY = 1 << 0;     // 不修改键空间，不写AOF
+constexpr uint32_t CMD_NO_TX = 1 << 1;        // 不能在事务中执行，执行前自动提交当前事务；也不能在脚本中执行
+constexpr uint32_t CMD_NO_SCRIPT = 1 << 2;    // 不能在脚本中执行
+constexpr uint32_t CMD_LONG_RUNNING = 1 << 3; // 耗时较长，run-to-completion模式下仍交给工作线程池执行
+constexpr uint32_t CMD_BLOCKING = 1 << 4;     // 列表为空时等待其他客户端推入元素
+constexpr uint32_t CMD_DENY_OOM = 1 << 5;     // 可能占用更多内存，内存达到上限且无法淘汰时拒绝执行
+constexpr uint32_t CMD_NO_AOF = 1 << 6;       // 本身不写AOF，脚本中执行的写命令各自记录
+constexpr uint32_t CMD_TX_CONTROL = 1 << 7;   // 事务控制命令，AOF重放时跳过
+constexpr uint32_t CMD_LOCAL_STATE = 1 << 8;  // 读取本机的服务器状态而不是数据，Raft模式下不需要ReadIndex
+constexpr uint32_t CMD_SCATTER = 1 << 9;      // 各键互不影响，键分布在多个分片时按键拆分执行再合并结果
+constexpr uint32_t CMD_ALL_SHARDS = 1 << 10;  // 没有键，分片模式下发送到所有分片
+constexpr uint32_t CMD_NUMKEYS = 1 << 11;     // first_key为目标键，其后一个参数为源键个数，再往后是源键；last_key与key_step不使用
+constexpr uint32_t CMD_SIZE_COST = 1 << 12;   // 遍历或返回整个集合，耗时随键中的元素个数增长，工作线程池按键的大小估计开销
+
+// 命令表中的一项。arity与Redis相同，包含命令名本身：正数表示参数个数固定，负数表示至少-arity个。
+// 键的位置为参数下标（不含命令名），last_key为负数时从末尾倒数，-1为最后一个参数；first_key为-1表示没有键
+struct CommandSpec {
+    std::string_view name;
+    CommandType type;
+    int arity;
+    uint32_t flags;
+    int first_key;
+    int last_key;
+    int key_step;
+
+    constexpr bool hasFlag(uint32_t flag) const { return (flags & flag) != 0; }
+
+    // arg_count不含命令名
+    constexpr bool arityMatches(size_t arg_count) const {
+        return arity >= 0 ? arg_count + 1 == static_cast<size_t>(arity)
+                          : arg_count + 1 >= static_cast<size_t>(-arity);
+    }
+};
+
+// 按CommandType的值排列，commandSpec直接以类型为下标
+inline constexpr CommandSpec COMMAND_TABLE[] = {
+    {"SET", CommandType::SET, -3, CMD_DENY_OOM, 0, 0, 1},
+    {"GET", CommandType::GET, 2, CMD_READONLY, 0, 0, 1},
+    {"DEL", CommandType::DEL, -2, CMD_SCATTER, 0, -1, 1},
+    {"EXISTS", CommandType::EXISTS, -2, CMD_READONLY | CMD_SCATTER, 0, -1, 1},
+    {"EXPIRE", CommandType::EXPIRE, 3, 0, 0, 0, 1},
+    {"TTL", CommandType::TTL, 2, 0, 0, 0, 1},
+    {"INCR", CommandType::INCR, 2, CMD_DENY_OOM, 0, 0, 1},
+    {"DECR", CommandType::DECR, 2, CMD_DENY_OOM, 0, 0, 1},
+    // 哈希命令
+    {"HSET", CommandType::HSET, -4, CMD_DENY_OOM, 0, 0, 1},
+    {"HGET", CommandType::HGET, 3, CMD_READONLY, 0, 0, 1},
+    {"HGETALL", CommandType::HGETALL, 2, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    {"HDEL", CommandType::HDEL, -3, 0, 0, 0, 1},
+    {"HEXISTS", CommandType::HEXISTS, 3, CMD_READONLY, 0, 0, 1},
+    {"HKEYS", CommandType::HKEYS, 2, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    {"HVALS", CommandType::HVALS, 2, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    {"HLEN", CommandType::HLEN, 2, CMD_READONLY, 0, 0, 1},
+    // 列表命令
+    {"LPUSH", CommandType::LPUSH, -3, CMD_DENY_OOM, 0, 0, 1},
+    {"RPUSH", CommandType::RPUSH, -3, CMD_DENY_OOM, 0, 0, 1},
+    {"LPOP", CommandType::LPOP, -2, 0, 0, 0, 1},
+    {"RPOP", CommandType::RPOP, -2, 0, 0, 0, 1},
+    {"LLEN", CommandType::LLEN, 2, CMD_READONLY, 0, 0, 1},
+    {"LRANGE", CommandType::LRANGE, 4, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    // 集合命令
+    {"SADD", CommandType::SADD, -3, CMD_DENY_OOM, 0, 0, 1},
+    {"SREM", CommandType::SREM, -3, 0, 0, 0, 1},
+    {"SMEMBERS", CommandType::SMEMBERS, 2, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    {"SISMEMBER", CommandType::SISMEMBER, 3, CMD_READONLY, 0, 0, 1},
+    {"SCARD", CommandType::SCARD, 2, CMD_READONLY, 0, 0, 1},
+    // 服务器管理命令
+    {"FLUSHDB", CommandType::FLUSHDB, -1, CMD_NO_TX | CMD_LONG_RUNNING | CMD_ALL_SHARDS, -1, -1, 0},
+    {"DBSIZE", CommandType::DBSIZE, 1, CMD_READONLY | CMD_ALL_SHARDS, -1, -1, 0},
+    // INFO读取RDB和MVCC统计时会等待其他线程获取分段锁
+    {"INFO", CommandType::INFO, -1, CMD_READONLY | CMD_NO_SCRIPT | CMD_LOCAL_STATE | CMD_ALL_SHARDS, -1, -1, 0},
+    {"SHUTDOWN", CommandType::SHUTDOWN, -1, CMD_READONLY | CMD_NO_TX | CMD_LONG_RUNNING | CMD_LOCAL_STATE, -1, -1, 0},
+    {"SAVE", CommandType::SAVE, 1, CMD_NO_TX | CMD_LONG_RUNNING, -1, -1, 0},
+    {"BGSAVE", CommandType::BGSAVE, -1, CMD_NO_TX | CMD_LONG_RUNNING, -1, -1, 0},
+    // 有序集合命令
+    {"ZADD", CommandType::ZADD, -4, CMD_DENY_OOM, 0, 0, 1},
+    {"ZREM", CommandType::ZREM, -3, 0, 0, 0, 1},
+    {"ZSCORE", CommandType::ZSCORE, 3, CMD_READONLY, 0, 0, 1},
+    {"ZISMEMBER", CommandType::ZISMEMBER, 3, CMD_READONLY, 0, 0, 1},
+    {"ZRANK", CommandType::ZRANK, 3, CMD_READONLY, 0, 0, 1},
+    {"ZREVRANK", CommandType::ZREVRANK, 3, CMD_READONLY, 0, 0, 1},
+    {"ZRANGE", CommandType::ZRANGE, -4, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    {"ZREVRANGE", CommandType::ZREVRANGE, -4, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    {"ZRANGEBYSCORE", CommandType::ZRANGEBYSCORE, -4, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    {"ZREVRANGEBYSCORE", CommandType::ZREVRANGEBYSCORE, -4, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    {"ZCOUNT", CommandType::ZCOUNT, 4, CMD_READONLY, 0, 0, 1},
+    {"ZCARD", CommandType::ZCARD, 2, CMD_READONLY, 0, 0, 1},
+    // 位图命令
+    {"SETBIT", CommandType::SETBIT, 4, CMD_DENY_OOM, 0, 0, 1},
+    {"GETBIT", CommandType::GETBIT, 3, CMD_READONLY, 0, 0, 1},
+    {"BITCOUNT", CommandType::BITCOUNT, -2, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    // BITOP operation destkey key [key ...]
+    {"BITOP", CommandType::BITOP, -5, CMD_LONG_RUNNING | CMD_DENY_OOM, 1, -1, 1},
+    // HyperLogLog命令，PFMERGE的第一个参数为目标键
+    {"PFADD", CommandType::PFADD, -3, CMD_DENY_OOM, 0, 0, 1},
+    {"PFCOUNT", CommandType::PFCOUNT, -2, CMD_READONLY, 0, -1, 1},
+    {"PFMERGE", CommandType::PFMERGE, -3, CMD_LONG_RUNNING | CMD_DENY_OOM, 0, -1, 1},
+    // AOF重写专用命令
+    {"RESTORE_HLL", CommandType::RESTORE_HLL, -3, CMD_NO_TX | CMD_DENY_OOM, 0, 0, 1},
+    // 事务命令
+    {"MULTI", CommandType::MULTI, -1, CMD_NO_TX | CMD_TX_CONTROL, -1, -1, 0},
+    // EXEC不接受参数，带参数的EXEC是Raft日志中编码的事务，见RaftCommand::EncodeTransaction
+    {"EXEC", CommandType::EXEC, 1, CMD_NO_SCRIPT | CMD_TX_CONTROL, -1, -1, 0},
+    {"DISCARD", CommandType::DISCARD, 1, CMD_NO_SCRIPT | CMD_TX_CONTROL, -1, -1, 0},
+    // 脚本命令，脚本读写的键在执行时才确定
+    {"EVALX", CommandType::EVALX, -2, CMD_NO_TX | CMD_LONG_RUNNING | CMD_DENY_OOM | CMD_NO_AOF, -1, -1, 0},
+    // 列表下标命令
+    {"LINDEX", CommandType::LINDEX, 3, CMD_READONLY, 0, 0, 1},
+    {"LSET", CommandType::LSET, 4, CMD_DENY_OOM, 0, 0, 1},
+    // 游标遍历命令
+    {"SCAN", CommandType::SCAN, -2, CMD_READONLY, -1, -1, 0},
+    {"HSCAN", CommandType::HSCAN, -3, CMD_READONLY, 0, 0, 1},
+    {"SSCAN", CommandType::SSCAN, -3, CMD_READONLY, 0, 0, 1},
+    {"ZSCAN", CommandType::ZSCAN, -3, CMD_READONLY, 0, 0, 1},
+    // 乐观事务命令
+    {"WATCH", CommandType::WATCH, -2, CMD_READONLY | CMD_NO_SCRIPT | CMD_TX_CONTROL | CMD_LOCAL_STATE, 0, -1, 1},
+    {"UNWATCH", CommandType::UNWATCH, 1, CMD_READONLY | CMD_NO_SCRIPT | CMD_TX_CONTROL | CMD_LOCAL_STATE, -1, -1, 0},
+    // 分片迁移专用命令
+    {"RESTORE_BATCH", CommandType::RESTORE_BATCH, 2, CMD_NO_TX | CMD_LONG_RUNNING | CMD_DENY_OOM, -1, -1, 0},
+    // 位图查找与位域命令
+    {"BITPOS", CommandType::BITPOS, -3, CMD_READONLY | CMD_SIZE_COST, 0, 0, 1},
+    {"BITFIELD", CommandType::BITFIELD, -2, CMD_DENY_OOM, 0, 0, 1},
+    // 批量读写命令，MSET key value [key value ...]
+    {"MGET", CommandType::MGET, -2, CMD_READONLY | CMD_SCATTER, 0, -1, 1},
+    {"MSET", CommandType::MSET, -3, CMD_DENY_OOM | CMD_SCATTER, 0, -1, 2},
+    {"MSETNX", CommandType::MSETNX, -3, CMD_DENY_OOM, 0, -1, 2},
+    {"HMGET", CommandType::HMGET, -3, CMD_READONLY, 0, 0, 1},
+    {"HMSET", CommandType::HMSET, -4, CMD_DENY_OOM, 0, 0, 1},
+    // 脚本缓存命令
+    {"SCRIPT", CommandType::SCRIPT, -2, CMD_NO_SCRIPT | CMD_LONG_RUNNING | CMD_ALL_SHARDS, -1, -1, 0},
+    {"EVALSHA", CommandType::EVALSHA, -2, CMD_NO_TX | CMD_LONG_RUNNING | CMD_DENY_OOM | CMD_NO_AOF, -1, -1, 0},
+    // 阻塞列表命令：BLPOP key [key ...] timeout，BLMOVE source destination LEFT|RIGHT LEFT|RIGHT timeout
+    {"BLPOP", CommandType::BLPOP, -3, CMD_BLOCKING, 0, -2, 1},
+    {"BRPOP", CommandType::BRPOP, -3, CMD_BLOCKING, 0, -2, 1},
+    {"BLMOVE", CommandType::BLMOVE, 6, CMD_BLOCKING | CMD_DENY_OOM, 0, 1, 1},
+    // 连接管理命令
+    {"CLIENT", CommandType::CLIENT, -2, CMD_READONLY | CMD_NO_SCRIPT | CMD_LOCAL_STATE, -1, -1, 0},
+    // 延迟统计命令
+    {"LATENCY", CommandType::LATENCY, -2, CMD_READONLY | CMD_LOCAL_STATE, -1, -1, 0},
+    {"SLOWLOG", CommandType::SLOWLOG, -2, CMD_READONLY | CMD_LOCAL_STATE, -1, -1, 0},
+    // 异步删除命令
+    {"UNLINK", CommandType::UNLINK, -2, CMD_SCATTER, 0, -1, 1},
+    // 布隆过滤器命令，BF.RESERVE key error_rate capacity [EXPANSION expansion] [NONSCALING]
+    {"BF.RESERVE", CommandType::BF_RESERVE, -4, CMD_DENY_OOM, 0, 0, 1},
+    {"BF.ADD", CommandType::BF_ADD, 3, CMD_DENY_OOM, 0, 0, 1},
+    {"BF.MADD", CommandType::BF_MADD, -3, CMD_DENY_OOM, 0, 0, 1},
+    {"BF.EXISTS", CommandType::BF_EXISTS, 3, CMD_READONLY, 0, 0, 1},
+    {"BF.MEXISTS", CommandType::BF_MEXISTS, -3, CMD_READONLY, 0, 0, 1},
+    {"BF.CARD", CommandType::BF_CARD, 2, CMD_READONLY, 0, 0, 1},
+    // 发布订阅命令，订阅状态属于连接，不涉及键
+    {"SUBSCRIBE", CommandType::SUBSCRIBE, -2, CMD_READONLY | CMD_NO_SCRIPT | CMD_LOCAL_STATE, -1, -1, 0},
+    {"UNSUBSCRIBE", CommandType::UNSUBSCRIBE, -1, CMD_READONLY | CMD_NO_SCRIPT | CMD_LOCAL_STATE, -1, -1, 0},
+    {"PSUBSCRIBE", CommandType::PSUBSCRIBE, -2, CMD_READONLY | CMD_NO_SCRIPT | CMD_LOCAL_STATE, -1, -1, 0},
+    {"PUNSUBSCRIBE", CommandType::PUNSUBSCRIBE, -1, CMD_READONLY | CMD_NO_SCRIPT | CMD_LOCAL_STATE, -1, -1, 0},
+    {"PUBLISH", CommandType::PUBLISH, 3, CMD_READONLY | CMD_LOCAL_STATE, -1, -1, 0},
+    // 连接的副本读模式，Raft跟随者在有界陈旧范围内直接回答读命令
+    {"READONLY", CommandType::READONLY, 1, CMD_READONLY | CMD_NO_SCRIPT | CMD_LOCAL_STATE, -1, -1, 0},
+    {"READWRITE", CommandType::READWRITE, 1, CMD_READONLY | CMD_NO_SCRIPT | CMD_LOCAL_STATE, -1, -1, 0},
+    // 集合运算命令，*STORE的第一个参数为目标键
+    {"SINTER", CommandType::SINTER, -2, CMD_READONLY | CMD_SIZE_COST, 0, -1, 1},
+    {"SUNION", CommandType::SUNION, -2, CMD_READONLY | CMD_SIZE_COST, 0, -1, 1},
+    {"SDIFF", CommandType::SDIFF, -2, CMD_READONLY | CMD_SIZE_COST, 0, -1, 1},
+    {"SINTERSTORE", CommandType::SINTERSTORE, -3, CMD_DENY_OOM | CMD_SIZE_COST, 0, -1, 1},
+    {"SUNIONSTORE", CommandType::SUNIONSTORE, -3, CMD_DENY_OOM | CMD_SIZE_COST, 0, -1, 1},
+    {"SDIFFSTORE", CommandType::SDIFFSTORE, -3, CMD_DENY_OOM | CMD_SIZE_COST, 0, -1, 1},
+    // ZUNIONSTORE/ZINTERSTORE destination numkeys key [key ...] [WEIGHTS weight ...] [AGGREGATE SUM|MIN|MAX]
+    {"ZUNIONSTORE", CommandType::ZUNIONSTORE, -4, CMD_LONG_RUNNING | CMD_DENY_OOM | CMD_NUMKEYS, 0, -1, 1},
+    {"ZINTERSTORE", CommandType::ZINTERSTORE, -4, CMD_LONG_RUNNING | CMD_DENY_OOM | CMD_NUMKEYS, 0, -1, 1},
+    // ZRANGESTORE dst src min max [BYSCORE] [REV]
+    {"ZRANGESTORE", CommandType::ZRANGESTORE, -5, CMD_DENY_OOM | CMD_SIZE_COST, 0, 1, 1},
+    // 调试命令：DEBUG TRACE SAMPLE|DUMP|RESET
+    {"DEBUG", CommandType::DEBUG, -2, CMD_READONLY | CMD_NO_SCRIPT | CMD_LOCAL_STATE, -1, -1, 0},
+    // 内存分析：MEMORY USAGE key [SAMPLES count]、MEMORY STATS，只有USAGE带键
+    {"MEMORY", CommandType::MEMORY, -2, CMD_READONLY, 1, 1, 1},
+    // LMOVE source destination LEFT|RIGHT LEFT|RIGHT，BLMOVE成功后也改写为LMOVE写入AOF
+    {"LMOVE", CommandType::LMOVE, 5, CMD_DENY_OOM, 0, 1, 1},
+};
+
+inline constexpr size_t COMMAND_COUNT = sizeof(COMMAND_TABLE) / sizeof(COMMAND_TABLE[0]);
+
+inline constexpr CommandSpec UNKNOWN_COMMAND_SPEC = {"UNKNOWN", CommandType::UNKNOWN, -1, 0, -1, -1, 0};
+
+namespace command_table_detail {
+
+constexpr char asciiUpper(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// FNV-1a，按大写字母计算，命令名不区分大小写
+constexpr uint32_t hashName(std::string_view name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(asciiUpper(c))) * 16777619u;
+    }
+    return hash ^ (hash >> 16);
+}
+
+constexpr bool equalsIgnoreCase(std::string_view upper, std::string_view name) {
+    if (upper.size() != name.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (upper[i] != asciiUpper(name[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr size_t SLOT_COUNT = 1024;
+constexpr uint8_t EMPTY_SLOT = 0xFF;
+static_assert(COMMAND_COUNT < EMPTY_SLOT, "command index must fit in a slot");
+
+using SlotTable = std::array<uint8_t, SLOT_COUNT>;
+
+// 把每个命令放入hashName(name, seed)对应的槽，有冲突时返回false
+constexpr bool placeCommands(uint32_t seed, SlotTable& slots) {
+    for (auto& slot : slots) {
+        slot = EMPTY_SLOT;
+    }
+    for (size_t i = 0; i < COMMAND_COUNT; ++i) {
+        uint8_t& slot = slots[hashName(COMMAND_TABLE[i].name, seed) % SLOT_COUNT];
+        if (slot != EMPTY_SLOT) {
+            return false;
+        }
+        slot = static_cast<uint8_t>(i);
+    }
+    return true;
+}
+
+// 编译期搜索使所有命令名互不冲突的种子，得到完美哈希
+constexpr uint32_t findSeed() {
+    SlotTable slots{};
+    for (uint32_t seed = 0; seed < 4096; ++seed) {
+        if (placeCommands(seed, slots)) {
+            return seed;
+        }
+    }
+    return UINT32_MAX;
+}
+
+constexpr uint32_t SEED = findSeed();
+static_assert(SEED != UINT32_MAX, "no collision-free seed for the command table");
+
+constexpr SlotTable buildSlots() {
+    SlotTable slots{};
+    placeCommands(SEED, slots);
+    return slots;
+}
+
+constexpr SlotTable SLOTS = buildSlots();
+
+constexpr size_t maxNameLength() {
+    size_t length = 0;
+    for (const auto& spec : COMMAND_TABLE) {
+        length = spec.name.size() > length ? spec.name.size() : length;
+    }
+    return length;
+}
+
+constexpr size_t MAX_NAME_LENGTH = maxNameLength();
+
+constexpr bool tableMatchesTypes() {
+    for (size_t i = 0; i < COMMAND_COUNT; ++i) {
+        if (static_cast<size_t>(COMMAND_TABLE[i].type) != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(tableMatchesTypes(), "COMMAND_TABLE must be ordered by CommandType");
+static_assert(COMMAND_COUNT == static_cast<size_t>(CommandType::LMOVE) + 1, "COMMAND_TABLE is missing commands");
+
+} // namespace command_table_detail
+
+// 按命令名查找，不区分大小写，不分配内存；未知命令返回nullptr
+constexpr const CommandSpec* findCommand(std::string_view name) {
+    using namespace command_table_detail;
+    if (name.empty() || name.size() > MAX_NAME_LENGTH) {
+        return nullptr;
+    }
+    uint8_t index = SLOTS[hashName(name, SEED) % SLOT_COUNT];
+    if (index == EMPTY_SLOT || !equalsIgnoreCase(COMMAND_TABLE[index].name, name)) {
+        return nullptr;
+    }
+    return &COMMAND_TABLE[index];
+}
+
+constexpr const CommandSpec& commandSpec(CommandType type) {
+    size_t index = static_cast<size_t>(type);
+    return type == CommandType::UNKNOWN || index >= COMMAND_COUNT ? UNKNOWN_COMMAND_SPEC : COMMAND_TABLE[index];
+}
+
+inline bool isReadOnlyCommand(CommandType type) {
+    return commandSpec(type).hasFlag(CMD_READONLY);
+}
+
+inline bool commandNotAllowedInTx(CommandType type) {
+    return commandSpec(type).hasFlag(CMD_NO_TX);
+}
+
+// 脚本执行期间持有全部分段锁，不能在脚本中执行的命令：会等待其他线程获取分段锁（SAVE、BGSAVE、
+// INFO读取RDB和MVCC统计），或者是事务和脚本本身
+inline bool commandNotAllowedInScript(CommandType type) {
+    return commandSpec(type).hasFlag(CMD_NO_SCRIPT | CMD_NO_TX);
+}
+
+// 耗时较长或会阻塞当前线程的命令，run-to-completion模式下仍交给工作线程池执行
+inline bool isLongRunningCommand(CommandType type) {
+    return commandSpec(type).hasFlag(CMD_LONG_RUNNING);
+}
+
+// 耗时随键中的元素个数增长的命令
+inline bool isSizeCostCommand(CommandType type) {
+    return commandSpec(type).hasFlag(CMD_SIZE_COST);
+}
+
+// 列表为空时等待其他客户端推入元素的命令。事务和脚本中以及Raft、分片模式下不阻塞，列表为空时立即返回空回复
+inline bool isBlockingCommand(CommandType type) {
+    return commandSpec(type).hasFlag(CMD_BLOCKING);
+}
+
+} // namespace dkv
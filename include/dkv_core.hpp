@@ -5,6 +5,7 @@
 #include <vector>
 #include <memory>
 #include <chrono>
+#include <mutex>
 
 namespace dkv {
 
@@ -21,7 +22,8 @@ enum class DataType {
     SET = 3,
     ZSET = 4,
     BITMAP = 5,
-    HYPERLOGLOG = 6
+    HYPERLOGLOG = 6,
+    BLOOM = 7
 };
 
 // 命令类型枚举
@@ -94,61 +96,78 @@ enum class CommandType {
     EXEC = 54,
     DISCARD = 55,
     // 脚本命令
-    EVALX = 56
+    EVALX = 56,
+    // 列表下标命令
+    LINDEX = 57,
+    LSET = 58,
+    // 游标遍历命令
+    SCAN = 59,
+    HSCAN = 60,
+    SSCAN = 61,
+    ZSCAN = 62,
+    // 乐观事务命令
+    WATCH = 63,
+    UNWATCH = 64,
+    // 分片迁移专用命令：参数为一批键值对的RDB数据，追加写入存储引擎
+    RESTORE_BATCH = 65,
+    // 位图查找与位域命令
+    BITPOS = 66,
+    BITFIELD = 67,
+    // 批量读写命令
+    MGET = 68,
+    MSET = 69,
+    MSETNX = 70,
+    HMGET = 71,
+    HMSET = 72,
+    // 脚本缓存命令
+    SCRIPT = 73,
+    EVALSHA = 74,
+    // 阻塞列表命令
+    BLPOP = 75,
+    BRPOP = 76,
+    BLMOVE = 77,
+    // 连接管理命令
+    CLIENT = 78,
+    // 延迟统计命令
+    LATENCY = 79,
+    SLOWLOG = 80,
+    // 异步删除命令
+    UNLINK = 81,
+    // 布隆过滤器命令
+    BF_RESERVE = 82,
+    BF_ADD = 83,
+    BF_MADD = 84,
+    BF_EXISTS = 85,
+    BF_MEXISTS = 86,
+    BF_CARD = 87,
+    // 发布订阅命令
+    SUBSCRIBE = 88,
+    UNSUBSCRIBE = 89,
+    PSUBSCRIBE = 90,
+    PUNSUBSCRIBE = 91,
+    PUBLISH = 92,
+    // 副本读命令
+    READONLY = 93,
+    READWRITE = 94,
+    // 集合运算命令
+    SINTER = 95,
+    SUNION = 96,
+    SDIFF = 97,
+    SINTERSTORE = 98,
+    SUNIONSTORE = 99,
+    SDIFFSTORE = 100,
+    // 有序集合运算命令
+    ZUNIONSTORE = 101,
+    ZINTERSTORE = 102,
+    ZRANGESTORE = 103,
+    // 调试命令
+    DEBUG = 104,
+    // 内存分析命令
+    MEMORY = 105,
+    // 非阻塞列表移动命令
+    LMOVE = 106
 };
 
-inline bool isReadOnlyCommand(CommandType type) {
-    switch (type) {
-        case CommandType::GET:
-        case CommandType::EXISTS:
-        case CommandType::HGET:
-        case CommandType::HGETALL:
-        case CommandType::HEXISTS:
-        case CommandType::HKEYS:
-        case CommandType::HVALS:
-        case CommandType::HLEN:
-        case CommandType::LLEN:
-        case CommandType::LRANGE:
-        case CommandType::SMEMBERS:
-        case CommandType::SISMEMBER:
-        case CommandType::SCARD:
-        case CommandType::ZSCORE:
-        case CommandType::ZISMEMBER:
-        case CommandType::ZRANK:
-        case CommandType::ZREVRANK:
-        case CommandType::ZRANGE:
-        case CommandType::ZREVRANGE:
-        case CommandType::ZRANGEBYSCORE:
-        case CommandType::ZREVRANGEBYSCORE:
-        case CommandType::ZCOUNT:
-        case CommandType::ZCARD:
-        case CommandType::GETBIT:
-        case CommandType::BITCOUNT:
-        case CommandType::PFCOUNT:
-        case CommandType::DBSIZE:
-        case CommandType::INFO:
-        case CommandType::SHUTDOWN:
-            return true;
-        default:
-            return false;
-    }
-}
-
-inline bool commandNotAllowedInTx(CommandType type) {
-    switch (type) {
-        case CommandType::FLUSHDB:
-        case CommandType::SHUTDOWN:
-        case CommandType::SAVE:
-        case CommandType::BGSAVE:
-        case CommandType::RESTORE_HLL:
-        case CommandType::MULTI:
-        case CommandType::EVALX:
-            return true;
-        default:
-            return false;
-    }
-}
-
 // 响应状态枚举
 enum class ResponseStatus {
     OK = 0,
@@ -174,7 +193,13 @@ enum class TransactionIsolationLevel {
     READ_UNCOMMITTED = 0,     // 读未提交：允许事务读取其他事务尚未提交的数据
     READ_COMMITTED = 1,       // 读已提交：只允许事务读取其他事务已提交的数据
     REPEATABLE_READ = 2,      // 可重复读：确保事务多次读取同一数据时得到相同结果
-    SERIALIZABLE = 3          // 串行化：最高隔离级别，强制事务串行执行
+    SERIALIZABLE = 3          // 串行化：最高隔离级别，提交时校验读写冲突，结果等价于事务串行执行
+};
+
+// RDB数据块压缩算法枚举，编号写入RDB文件头
+enum class RDBCompression : int64_t {
+    NONE = 0,                 // 不压缩
+    LZF = 1                   // LZF压缩，速度优先
 };
 
 // 命令结构
@@ -184,9 +209,13 @@ struct Command {
     
     Command() : type(CommandType::UNKNOWN) {}
     Command(CommandType t, const std::vector<std::string>& a) : type(t), args(a) {}
+    Command(CommandType t, std::vector<std::string>&& a) : type(t), args(std::move(a)) {}
 
     std::string desc() const;
 
+    // 命令读写的键。服务器管理、事务、脚本和遍历整个键空间的命令返回空
+    std::vector<Key> keys() const;
+
     void serialize(std::vector<char>& buffer) const;
 
     bool deserialize(const std::vector<char>& buffer);
@@ -203,27 +232,95 @@ struct Response {
     ResponseStatus status;
     std::string message;
     std::string data;
+    // 数组回复的元素，由网络层直接编码进输出缓冲区，不再先序列化到data
+    std::vector<std::string> elements;
+    bool is_array = false;
     
     Response() : status(ResponseStatus::OK) {}
     Response(ResponseStatus s, const std::string& m = "", const std::string& d = "") 
         : status(s), message(m), data(d) {}
+
+    void setArray(std::vector<std::string>&& values) {
+        elements = std::move(values);
+        is_array = true;
+    }
 };
 
 
 class DataItem;
 enum class UndoLogType {
     SET,
-    DELETE
+    DELETE,
+    DELTA // 增量版本，只记录逆操作
 };
 
 using TransactionID = uint64_t;
 const TransactionID NO_TX = 0;
 
+// 集合类型的增量回滚记录，描述如何把较新版本的内容还原为上一个版本。
+// 按修改顺序追加，还原时逆序应用
+struct UndoDelta {
+    enum class Op : uint8_t {
+        RESTORE_FIELD,  // 哈希：existed时把字段member恢复为value，否则删除字段
+        RESTORE_MEMBER, // 集合：existed时加回member，否则删除member
+        RESTORE_SCORE,  // 有序集合：existed时把member的分数恢复为score，否则删除member
+        POP_FRONT,      // 列表：撤销左侧插入
+        POP_BACK,       // 列表：撤销右侧插入
+        PUSH_FRONT,     // 列表：撤销左侧弹出，把value插回左侧
+        PUSH_BACK,      // 列表：撤销右侧弹出，把value插回右侧
+        RESTORE_INDEX   // 列表：把下标index处的元素恢复为value
+    };
+    Op op = Op::RESTORE_FIELD;
+    bool existed = false;
+    int64_t index = 0;
+    double score = 0;
+    Value member{};
+    Value value{};
+
+    static UndoDelta restoreField(const Value& field, const Value& old_value, bool existed) {
+        UndoDelta delta;
+        delta.op = Op::RESTORE_FIELD;
+        delta.member = field;
+        delta.value = old_value;
+        delta.existed = existed;
+        return delta;
+    }
+    static UndoDelta restoreMember(const Value& member, bool existed) {
+        UndoDelta delta;
+        delta.op = Op::RESTORE_MEMBER;
+        delta.member = member;
+        delta.existed = existed;
+        return delta;
+    }
+    static UndoDelta restoreScore(const Value& member, double old_score, bool existed) {
+        UndoDelta delta;
+        delta.op = Op::RESTORE_SCORE;
+        delta.member = member;
+        delta.score = old_score;
+        delta.existed = existed;
+        return delta;
+    }
+    static UndoDelta list(Op op, const Value& value = Value(), int64_t index = 0) {
+        UndoDelta delta;
+        delta.op = op;
+        delta.value = value;
+        delta.index = index;
+        return delta;
+    }
+};
+
+// 版本链节点。SET/DELETE类型的old_value是上一个版本的完整内容；
+// DELTA类型的old_value只有元数据（事务ID、标志和更早的UndoLog），内容由较新版本逆序应用deltas得到，
+// 旧读取视图第一次读到时物化到materialized中，之后复用
 struct UndoLog {
     UndoLogType ty;
     std::unique_ptr<DataItem> old_value;
+    std::vector<UndoDelta> deltas;
+    std::unique_ptr<DataItem> materialized; // 由materialize_mutex保护
+    std::mutex materialize_mutex;
 };
 
 } // namespace dkv
 
+#include "dkv_command_table.hpp"
 #include "dkv_utils.hpp"
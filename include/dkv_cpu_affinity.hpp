@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dkv {
+
+// 线程绑核配置，CPU列表为空表示不绑定
+struct CpuAffinityConfig {
+    std::vector<int> reactor_cpus;  // SubReactor线程依次各绑定一个CPU
+    std::vector<int> worker_cpus;   // 工作线程可用的CPU
+    bool numa_aware = false;        // 工作线程与其服务的SubReactor放在同一NUMA节点
+};
+
+// 各线程分配到的CPU集合，空集合表示该线程不绑定
+struct CpuPlacement {
+    std::vector<std::vector<int>> reactors;
+    std::vector<std::vector<int>> workers;
+};
+
+// 解析"0-3,8,10-11"格式的CPU列表，格式错误时返回false
+bool parseCpuList(const std::string& text, std::vector<int>& cpus);
+
+// 各NUMA节点的CPU列表，读取不到拓扑时把当前进程可用的全部CPU视为一个节点
+std::vector<std::vector<int>> numaNodeCpus();
+
+// 根据配置为SubReactor和工作线程分配CPU
+// worker_groups[i]为第i个工作线程所属的组，组号与SubReactor编号对应
+// nodes为NUMA拓扑，仅在numa_aware时使用
+CpuPlacement planCpuPlacement(const CpuAffinityConfig& config, size_t num_reactors,
+                              const std::vector<size_t>& worker_groups,
+                              const std::vector<std::vector<int>>& nodes);
+
+// 把线程绑定到cpus，空集合时不做任何事
+bool pinThread(std::thread& thread, const std::vector<int>& cpus);
+
+// 调整调用线程的nice值（Linux上nice值按线程生效），增量为正表示降低优先级，失败时返回false
+bool setCurrentThreadNice(int increment);
+
+} // namespace dkv
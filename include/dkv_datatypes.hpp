@@ -8,3 +8,4 @@
 #include "datatypes/dkv_datatype_zset.hpp"
 #include "datatypes/dkv_datatype_bitmap.hpp"
 #include "datatypes/dkv_datatype_hyperloglog.hpp"
+#include "datatypes/dkv_datatype_bloom.hpp"
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "dkv_core.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dkv {
+
+// 对数线性分桶的延迟直方图（HDR风格），单位为微秒。
+// 小于16的值各占一个桶，之后每个2的幂区间再均分为16个桶，相对误差不超过1/16。
+// 记录只做一次relaxed原子加，可在任意线程并发调用；读取时各计数不是同一时刻的快照
+class HdrHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    // 超过约2^40微秒（约12天）的值计入最后一个桶
+    static constexpr unsigned MAX_MAGNITUDE = 40;
+    static constexpr size_t BUCKETS = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    void record(uint64_t usec);
+    void reset();
+    // 把other的记录累加到本直方图，用于合并各线程分别记录的直方图
+    void merge(const HdrHistogram& other);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    // 不小于percentile%的记录值的上界，没有记录时返回0
+    uint64_t percentile(double percentile) const;
+    // 按2的幂合并的累计分布：每项为(2的幂, 小于它的记录数)，到包含全部记录为止
+    std::vector<std::pair<uint64_t, uint64_t>> cumulativePowersOfTwo() const;
+
+    static size_t bucketIndex(uint64_t usec);
+    // 桶内最大的值
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// 请求处理的各阶段
+enum class LatencyStage {
+    PARSE = 0,   // SubReactor解析一次读取到的命令
+    QUEUE = 1,   // 任务提交到工作线程开始执行之间的等待
+    EXECUTE = 2, // 在本机执行一条命令，包括等待存储锁
+    WRITE = 3,   // 编码一批回复并写出
+    COUNT = 4
+};
+
+// 慢查询日志中的一条记录
+struct SlowLogEntry {
+    uint64_t id = 0;
+    int64_t timestamp = 0;    // 开始执行时的Unix时间（秒）
+    uint64_t duration_us = 0; // 执行耗时（微秒）
+    std::vector<std::string> args; // 命令名和参数，过长时截断
+};
+
+// 命令延迟统计：各CommandType的执行耗时直方图、各处理阶段的直方图和慢查询日志
+class LatencyMonitor {
+public:
+    static constexpr int64_t DEFAULT_SLOWLOG_THRESHOLD_US = 10000;
+    static constexpr size_t DEFAULT_SLOWLOG_MAX_LEN = 128;
+    // 慢查询日志每条记录最多保存的参数个数和每个参数的最大长度
+    static constexpr size_t SLOWLOG_MAX_ARGS = 32;
+    static constexpr size_t SLOWLOG_MAX_ARG_LEN = 128;
+
+    using Clock = std::chrono::steady_clock;
+
+    static uint64_t elapsedUs(Clock::time_point start, Clock::time_point end = Clock::now()) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    }
+
+    void recordStage(LatencyStage stage, uint64_t usec);
+    // 记录一条命令的执行耗时，超过阈值时同时写入慢查询日志
+    void recordCommand(const Command& command, uint64_t usec);
+
+    const HdrHistogram& stage(LatencyStage stage) const { return stages_[static_cast<size_t>(stage)]; }
+    const HdrHistogram& command(CommandType type) const;
+    void resetStats();
+
+    // 执行耗时不小于threshold_us的命令写入慢查询日志，负数表示不记录
+    void setSlowLogThreshold(int64_t threshold_us) { slowlog_threshold_us_.store(threshold_us); }
+    int64_t slowLogThreshold() const { return slowlog_threshold_us_.load(); }
+    void setSlowLogMaxLen(size_t max_len);
+    // 最近的count条慢查询，最新的在前
+    std::vector<SlowLogEntry> slowLog(size_t count) const;
+    size_t slowLogLen() const;
+    void resetSlowLog();
+
+    // INFO commandstats的内容：各命令的调用次数、耗时和延迟分位数，以及各处理阶段的延迟分位数
+    std::string commandStatsInfo() const;
+    // LATENCY HISTOGRAM：每个命令一项，包含调用次数和按2的幂合并的累计分布。types为空时列出所有调用过的命令
+    std::vector<std::string> histogramReply(const std::vector<CommandType>& types) const;
+
+private:
+    static constexpr size_t COMMAND_TYPES = COMMAND_COUNT;
+
+    std::array<HdrHistogram, COMMAND_TYPES> commands_;
+    std::array<HdrHistogram, static_cast<size_t>(LatencyStage::COUNT)> stages_;
+
+    std::atomic<int64_t> slowlog_threshold_us_{DEFAULT_SLOWLOG_THRESHOLD_US};
+    mutable std::mutex slowlog_mutex_;
+    std::deque<SlowLogEntry> slowlog_; // 最新的在前
+    size_t slowlog_max_len_ = DEFAULT_SLOWLOG_MAX_LEN;
+    uint64_t next_slowlog_id_ = 0;
+};
+
+} // namespace dkv
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "dkv_latency.hpp"
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dkv {
+
+// 键在键空间中的分布
+enum class KeyDistribution {
+    UNIFORM, // 均匀分布
+    ZIPFIAN  // Zipf分布，少数热点键占大部分访问
+};
+
+// 在键空间[0, keyspace)中生成键序号。Zipf分布采用YCSB的生成方法，
+// 排名再经哈希打散到整个键空间，热点键不会集中在序号最小的一段
+class KeyGenerator {
+public:
+    static constexpr double DEFAULT_ZIPF_THETA = 0.99;
+
+    // Zipf分布在构造时计算zeta(keyspace)，耗时与键空间大小成正比；各线程复制同一个生成器后调用seed
+    KeyGenerator(uint64_t keyspace, KeyDistribution distribution, double theta = DEFAULT_ZIPF_THETA,
+                 uint64_t seed = 1);
+
+    void seed(uint64_t seed) { rng_.seed(seed); }
+    uint64_t next();
+    uint64_t keyspace() const { return keyspace_; }
+
+private:
+    uint64_t nextZipfRank();
+
+    uint64_t keyspace_;
+    KeyDistribution distribution_;
+    std::mt19937_64 rng_;
+    // Zipf分布的参数
+    double theta_ = 0;
+    double alpha_ = 0;
+    double zetan_ = 0;
+    double eta_ = 0;
+    double half_pow_theta_ = 0;
+};
+
+// 命令组合中的一项，weight为相对权重
+struct CommandMixEntry {
+    std::string name;
+    unsigned weight = 1;
+};
+
+// 压测配置
+struct LoadConfig {
+    std::string host = "127.0.0.1";
+    int port = 6379;
+    size_t connections = 50;
+    size_t threads = 1;             // 每个线程用poll驱动分到的连接
+    size_t pipeline = 1;            // 每个连接一次发送的命令数，收齐回复后再发送下一批
+    uint64_t requests = 100000;     // 总请求数，duration_seconds大于0时忽略
+    double duration_seconds = 0;    // 按时长压测
+    uint64_t keyspace = 100000;
+    KeyDistribution distribution = KeyDistribution::UNIFORM;
+    double zipf_theta = KeyGenerator::DEFAULT_ZIPF_THETA;
+    size_t value_size = 64;
+    size_t value_size_max = 0;      // 大于value_size时值的长度在[value_size, value_size_max]中均匀选取
+    std::vector<CommandMixEntry> mix = {{"set", 1}, {"get", 1}};
+    std::string key_prefix = "bench:";
+    bool preload = false;           // 压测前写入键空间中的全部字符串键，使GET命中
+    uint64_t seed = 1;
+};
+
+// 一类命令的压测结果，延迟单位为微秒，从一批命令发出到收到该命令的回复
+struct CommandLoadStats {
+    std::string name;
+    uint64_t errors = 0;
+    std::unique_ptr<HdrHistogram> latency = std::make_unique<HdrHistogram>();
+};
+
+// 压测结果
+struct LoadReport {
+    uint64_t requests = 0;  // 收到回复的请求数
+    uint64_t errors = 0;    // 错误回复数
+    uint64_t failed_connections = 0; // 中途断开的连接数
+    double elapsed_seconds = 0;
+    HdrHistogram latency;
+    std::vector<CommandLoadStats> commands; // 与LoadConfig::mix中的顺序一致
+
+    double throughput() const { return elapsed_seconds > 0 ? requests / elapsed_seconds : 0; }
+    // 可读的汇总：吞吐量和p50/p99/p99.9延迟，以及每类命令的结果
+    std::string format(const LoadConfig& config) const;
+};
+
+// 基于RESP的端到端压测客户端
+class LoadGenerator {
+public:
+    // 支持的命令，不同数据类型的命令使用不同的键前缀，避免WRONGTYPE错误
+    static const std::vector<std::string>& supportedCommands();
+    // 解析"get:9,set:1"形式的命令组合，省略权重时为1
+    static bool parseMix(const std::string& text, std::vector<CommandMixEntry>& mix, std::string& error);
+
+    // 回复的解析结果
+    enum class ReplyStatus {
+        COMPLETE,   // 解析出一条完整回复
+        INCOMPLETE, // 需要更多数据
+        INVALID     // 协议错误
+    };
+    // 从data[pos]开始解析一条回复，完整时把pos移到回复之后，is_error表示回复为错误
+    static ReplyStatus parseReply(std::string_view data, size_t& pos, bool& is_error);
+
+    explicit LoadGenerator(LoadConfig config);
+
+    // 执行压测，无法连接服务器或配置无效时返回false
+    bool run(LoadReport& report);
+    const std::string& error() const { return error_; }
+    // 校验后实际使用的配置，线程数不超过连接数
+    const LoadConfig& config() const { return config_; }
+
+private:
+    struct Worker;
+
+    bool validate();
+    bool preload();
+    int connect() const;
+
+    LoadConfig config_;
+    std::string error_;
+};
+
+} // namespace dkv
@@ -1,13 +1,30 @@
 #ifndef DKV_LOGGER_HPP
 #define DKV_LOGGER_HPP
 
+#include "dkv_mpmc_queue.hpp"
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <chrono>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <iomanip>
 
+// 编译期保留的最低日志等级，低于它的日志宏展开为空语句，参数不会被求值。
+// 发布构建默认去掉DEBUG日志，可用-DDKV_LOG_MIN_LEVEL=0保留
+#ifndef DKV_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define DKV_LOG_MIN_LEVEL 1
+#else
+#define DKV_LOG_MIN_LEVEL 0
+#endif
+#endif
+
 namespace dkv {
 
 // 日志等级枚举
@@ -19,9 +36,20 @@ enum class LogLevel {
     CRITICAL = 4
 };
 
+// 异步模式下线程的日志缓冲区已满时的处理方式
+enum class LogOverflowPolicy {
+    BLOCK, // 等待后台线程写出，不丢日志
+    DROP   // 丢弃该条日志并计数，不阻塞调用线程
+};
+
 // 日志系统类
+// 异步模式（默认）下，每个线程把格式化好的日志放入自己的无锁缓冲区，由后台线程成批写出，
+// 调用线程不获取全局锁，也不等待IO；同步模式下在调用线程上加锁写出。
 class Logger {
 public:
+    // 每个线程日志缓冲区的默认条数
+    static constexpr size_t DEFAULT_BUFFER_ENTRIES = 4096;
+
     // 获取单例实例
     static Logger& getInstance() {
         static Logger instance;
@@ -35,6 +63,7 @@ public:
 
     // 设置日志文件路径
     void setLogFile(const std::string& file_path) {
+        flush();
         std::lock_guard<std::mutex> lock(mutex_);
         if (log_file_.is_open()) {
             log_file_.close();
@@ -45,6 +74,7 @@ public:
 
     // 关闭日志文件
     void closeLogFile() {
+        flush();
         std::lock_guard<std::mutex> lock(mutex_);
         if (log_file_.is_open()) {
             log_file_.close();
@@ -57,25 +87,25 @@ public:
         console_output_ = enable;
     }
 
+    // 切换异步或同步模式，关闭异步模式前写出所有已缓冲的日志
+    void setAsync(bool enabled);
+    bool isAsync() const { return async_.load(std::memory_order_relaxed); }
+    // 缓冲区已满时的处理方式
+    void setOverflowPolicy(LogOverflowPolicy policy) { overflow_policy_ = policy; }
+    // 之后新建的线程缓冲区的条数
+    void setBufferEntries(size_t entries) { buffer_entries_ = entries; }
+    // 等待调用前已缓冲的日志全部写出
+    void flush();
+    // DROP策略下丢弃的日志条数
+    uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
     // 日志输出方法
     template<typename... Args>
     void log(LogLevel level, Args&&... args) {
         if (level < log_level_) {
             return;
         }
-
-        std::string log_entry = sprintLogEntry(level, std::forward<Args>(args)...);
-
-        std::lock_guard<std::mutex> lock(mutex_);
-        
-        if (console_output_) {
-            std::ostream& out = (level >= LogLevel::ERROR) ? std::cerr : std::cout;
-            out << log_entry << std::endl;
-        }
-
-        if (log_to_file_ && log_file_.is_open()) {
-            log_file_ << log_entry << std::endl;
-        }
+        write(level, sprintLogEntry(level, std::forward<Args>(args)...));
     }
 
     // 便捷日志方法
@@ -111,18 +141,7 @@ public:
             return;
         }
 
-        std::string log_entry = formatLogEntry(level, format, std::forward<Args>(args)...);
-
-        std::lock_guard<std::mutex> lock(mutex_);
-        
-        if (console_output_) {
-            std::ostream& out = (level >= LogLevel::ERROR) ? std::cerr : std::cout;
-            out << log_entry << std::endl;
-        }
-
-        if (log_to_file_ && log_file_.is_open()) {
-            log_file_ << log_entry << std::endl;
-        }
+        write(level, formatLogEntry(level, format, std::forward<Args>(args)...));
     }
 
     // 便捷格式化日志方法
@@ -154,15 +173,42 @@ public:
     
 
 private:
-    Logger() : log_level_(LogLevel::INFO), console_output_(true), log_to_file_(false) {
-        // 默认构造函数
-    }
-
-    ~Logger() {
-        if (log_file_.is_open()) {
-            log_file_.close();
+    struct LogRecord {
+        LogLevel level = LogLevel::INFO;
+        std::string text;
+    };
+    using LogBuffer = BoundedMPMCQueue<LogRecord>;
+
+    // 线程退出时标记其缓冲区，后台线程写完剩余日志后回收
+    struct ThreadBuffer {
+        std::shared_ptr<LogBuffer> buffer;
+        std::shared_ptr<std::atomic<bool>> closed;
+        ~ThreadBuffer() {
+            if (closed) {
+                closed->store(true, std::memory_order_release);
+            }
         }
-    }
+    };
+    struct RegisteredBuffer {
+        std::shared_ptr<LogBuffer> buffer;
+        std::shared_ptr<std::atomic<bool>> closed;
+    };
+
+    Logger();
+    ~Logger();
+
+    // 写出一条格式化好的日志
+    void write(LogLevel level, std::string&& entry);
+    // 同步写出，调用时需持有mutex_
+    void writeLocked(LogLevel level, const std::string& entry);
+    // 当前线程的缓冲区，首次调用时创建并登记
+    LogBuffer& threadBuffer();
+    // 后台线程：取出各线程缓冲区中的日志，按输出目标合并后一次写出
+    void sinkLoop();
+    // 取出并写出所有缓冲的日志，返回是否写出了日志
+    bool drainBuffers();
+    void startSink();
+    void stopSink();
 
     // 格式化日志条目
     template<typename... Args>
@@ -279,22 +325,49 @@ private:
     bool console_output_;
     bool log_to_file_;
     std::ofstream log_file_;
-    std::mutex mutex_;
+    std::mutex mutex_; // 保护输出目标，同步模式下写出与后台线程写出互斥
+
+    // 异步模式
+    std::atomic<bool> async_{false};
+    std::mutex async_mutex_;        // 串行化模式切换
+    LogOverflowPolicy overflow_policy_ = LogOverflowPolicy::BLOCK;
+    size_t buffer_entries_ = DEFAULT_BUFFER_ENTRIES;
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t dropped_reported_ = 0; // 只在后台线程访问
+    std::mutex buffers_mutex_;      // 保护buffers_，线程首次写日志时登记
+    std::vector<RegisteredBuffer> buffers_;
+    std::thread sink_thread_;       // 只在持有async_mutex_时启动和回收
+    std::mutex sink_mutex_;
+    std::condition_variable sink_cv_;
+    std::condition_variable flushed_cv_;
+    std::atomic<bool> sink_sleeping_{false};
+    // 以下由sink_mutex_保护
+    bool sink_stop_ = true;
+    std::thread::id sink_id_;
+    uint64_t flush_requested_ = 0;
+    uint64_t flush_done_ = 0;
 };
 
-// 全局日志宏，方便使用
-#define DKV_LOG_DEBUG(...) Logger::getInstance().debug(__VA_ARGS__)
-#define DKV_LOG_INFO(...) Logger::getInstance().info(__VA_ARGS__)
-#define DKV_LOG_WARNING(...) Logger::getInstance().warning(__VA_ARGS__)
-#define DKV_LOG_ERROR(...) Logger::getInstance().error(__VA_ARGS__)
-#define DKV_LOG_CRITICAL(...) Logger::getInstance().critical(__VA_ARGS__)
+// 全局日志宏，方便使用。低于DKV_LOG_MIN_LEVEL的等级在编译期去掉
+#define DKV_LOG_AT_LEVEL(level, method, ...) \
+    do { \
+        if (static_cast<int>(level) >= DKV_LOG_MIN_LEVEL) { \
+            Logger::getInstance().method(__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define DKV_LOG_DEBUG(...) DKV_LOG_AT_LEVEL(0, debug, __VA_ARGS__)
+#define DKV_LOG_INFO(...) DKV_LOG_AT_LEVEL(1, info, __VA_ARGS__)
+#define DKV_LOG_WARNING(...) DKV_LOG_AT_LEVEL(2, warning, __VA_ARGS__)
+#define DKV_LOG_ERROR(...) DKV_LOG_AT_LEVEL(3, error, __VA_ARGS__)
+#define DKV_LOG_CRITICAL(...) DKV_LOG_AT_LEVEL(4, critical, __VA_ARGS__)
 
 // 格式化版本日志宏
-#define DKV_LOG_DEBUGF(...) Logger::getInstance().debugf(__VA_ARGS__)
-#define DKV_LOG_INFOF(...) Logger::getInstance().infof(__VA_ARGS__)
-#define DKV_LOG_WARNINGF(...) Logger::getInstance().warningf(__VA_ARGS__)
-#define DKV_LOG_ERRORF(...) Logger::getInstance().errorf(__VA_ARGS__)
-#define DKV_LOG_CRITICALF(...) Logger::getInstance().criticalf(__VA_ARGS__)
+#define DKV_LOG_DEBUGF(...) DKV_LOG_AT_LEVEL(0, debugf, __VA_ARGS__)
+#define DKV_LOG_INFOF(...) DKV_LOG_AT_LEVEL(1, infof, __VA_ARGS__)
+#define DKV_LOG_WARNINGF(...) DKV_LOG_AT_LEVEL(2, warningf, __VA_ARGS__)
+#define DKV_LOG_ERRORF(...) DKV_LOG_AT_LEVEL(3, errorf, __VA_ARGS__)
+#define DKV_LOG_CRITICALF(...) DKV_LOG_AT_LEVEL(4, criticalf, __VA_ARGS__)
 
 } // namespace dkv
 
@@ -0,0 +1,21 @@
+#ifndef DKV_LZF_HPP
+#define DKV_LZF_HPP
+
+#include <cstddef>
+
+namespace dkv {
+
+// LZF格式的轻量压缩，速度优先，压缩率一般
+// 格式与liblzf兼容：000LLLLL为L+1字节字面量；LLLooooo oooooooo为回溯引用
+namespace lzf {
+
+// 压缩输入，输出空间不足（压缩后不比原数据小）时返回0
+size_t compress(const void* in, size_t in_len, void* out, size_t out_len);
+// 解压输入，数据损坏或输出空间不足时返回0
+size_t decompress(const void* in, size_t in_len, void* out, size_t out_len);
+
+} // namespace lzf
+
+} // namespace dkv
+
+#endif // DKV_LZF_HPP
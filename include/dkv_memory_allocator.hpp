@@ -2,6 +2,7 @@
 #define DKV_MEMORY_ALLOCATOR_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <mutex>
 #include <atomic>
 #include <unordered_map>
@@ -9,10 +10,14 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <typeinfo>
+#include "dkv_slab_allocator.hpp"
 
 namespace dkv {
 
 // 自定义内存分配器，用于跟踪所有内存分配、重分配和释放操作
+// 默认只统计用量：每个内存块前附带记录大小的块头，计数先累加到线程本地，超过阈值后才合并到全局计数，
+// 分配路径上没有锁和全局映射表。逐块记录分配类型的映射表作为调试模式按需开启。
 class MemoryAllocator {
 public:
     // 获取单例实例
@@ -29,6 +34,11 @@ public:
     
     // 重新分配内存
     void* reallocate(void* ptr, size_t new_size, const char* allocation_type = "unknown");
+
+    // 计入不经过allocate/deallocate的内存用量（如SlabAllocator切分出的对象）
+    void recordUsage(int64_t usage_delta, int64_t allocations, int64_t deallocations) {
+        record(usage_delta, allocations, deallocations);
+    }
     
     // 获取当前内存使用量
     size_t getCurrentUsage() const;
@@ -45,9 +55,18 @@ public:
     // 重置统计信息
     void resetStats();
 
+    // 调试模式：逐块记录分配类型，getStats输出按类型汇总的信息
+    // 只记录开启之后分配的内存块
+    void setDebugTracking(bool enabled);
+    bool isDebugTracking() const;
+
+    // 线程本地计数合并到全局计数的阈值
+    static constexpr int64_t FLUSH_BYTES = 64 * 1024;
+    static constexpr int64_t FLUSH_OPS = 256;
+
 private:
     // 私有构造函数（单例模式）
-    MemoryAllocator() = default;
+    MemoryAllocator();
     
     // 禁止拷贝和移动
     MemoryAllocator(const MemoryAllocator&) = delete;
@@ -62,16 +81,29 @@ private:
         uint64_t allocation_id;// 分配ID
     };
     
-    // 同步锁
+    // 累加计数到线程本地，超过阈值时合并到全局
+    void record(int64_t usage_delta, int64_t allocations, int64_t deallocations);
+    // 将当前线程的本地计数合并到全局
+    void flushLocal();
+    friend struct ThreadCountersFlusher;
+
+    // 调试模式下记录和移除内存块
+    void trackBlock(void* ptr, size_t size, const char* allocation_type);
+    void untrackBlock(void* ptr);
+
+    // 同步锁，仅保护调试模式的映射表
     mutable std::mutex mutex_;
     
-    // 内存使用统计
-    std::atomic<size_t> current_usage_{0};
-    std::atomic<uint64_t> total_allocations_{0};
-    std::atomic<uint64_t> total_deallocations_{0};
+    // 内存使用统计（已合并的全局部分）
+    std::atomic<int64_t> current_usage_{0};
+    std::atomic<int64_t> total_allocations_{0};
+    std::atomic<int64_t> total_deallocations_{0};
     std::atomic<uint64_t> allocation_counter_{0};
+    // 统计周期，resetStats时递增，之前周期分配的内存块释放时不再计入
+    std::atomic<uint32_t> epoch_{1};
     
-    // 内存块映射表
+    // 内存块映射表，仅在调试模式下使用
+    std::atomic<bool> debug_tracking_{false};
     std::unordered_map<void*, MemoryBlockInfo> memory_blocks_;
 };
 
@@ -97,12 +129,24 @@ public:
     template<typename U>
     TrackedAllocator(const TrackedAllocator<U>&) {}
     
+    // 小块内存走SlabAllocator，其余走MemoryAllocator
+    static constexpr bool slabEligible(size_type n) {
+        return n * sizeof(T) <= SlabAllocator::MAX_SIZE && alignof(T) <= 16;
+    }
+
     pointer allocate(size_type n) {
+        if (slabEligible(n)) {
+            return static_cast<pointer>(SlabAllocator::getInstance().allocate(n * sizeof(T)));
+        }
         void* ptr = MemoryAllocator::getInstance().allocate(n * sizeof(T), typeid(T).name());
         return static_cast<pointer>(ptr);
     }
     
-    void deallocate(pointer p, size_type) {
+    void deallocate(pointer p, size_type n) {
+        if (slabEligible(n)) {
+            SlabAllocator::getInstance().deallocate(p, n * sizeof(T));
+            return;
+        }
         MemoryAllocator::getInstance().deallocate(p);
     }
     
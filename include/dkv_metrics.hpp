@@ -0,0 +1,74 @@
+#pragma once
+
+#include "dkv_latency.hpp"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dkv {
+
+// 一个指标样本。suffix追加在指标名之后（如summary的_sum、_count），labels为Prometheus格式的标签，如cmd="get"
+struct MetricSample {
+    std::string suffix;
+    std::string labels;
+    double value = 0;
+};
+
+enum class MetricType { COUNTER, GAUGE, SUMMARY };
+
+// 指标注册表。服务器启动时注册全部指标，开始导出之后不再修改，导出时不需要加锁。
+// 读取函数只能读取原子变量，不能获取存储锁或其他会被命令执行持有的锁，导出不影响命令执行
+class MetricsRegistry {
+public:
+    using Reader = std::function<double()>;
+    using FamilyReader = std::function<void(std::vector<MetricSample>&)>;
+
+    void addCounter(const std::string& name, const std::string& help, Reader reader);
+    void addGauge(const std::string& name, const std::string& help, Reader reader);
+    // 一组带标签的样本，reader每次导出时填入样本
+    void addFamily(const std::string& name, const std::string& help, MetricType type, FamilyReader reader);
+    // 以summary导出直方图的p50/p99/p99.9、总和与次数，histogram须在注册表之后销毁
+    void addSummary(const std::string& name, const std::string& help, const HdrHistogram& histogram);
+
+    // Prometheus文本格式（0.0.4）
+    std::string render() const;
+
+private:
+    struct Family {
+        std::string name;
+        std::string help;
+        MetricType type;
+        FamilyReader reader;
+    };
+    std::vector<Family> families_;
+};
+
+// 在单独的端口上以HTTP提供GET /metrics，由自己的线程逐个处理连接，不经过SubReactor和工作线程池
+class MetricsExporter {
+public:
+    // 读取请求头的超时和请求头的最大长度
+    static constexpr int REQUEST_TIMEOUT_MS = 1000;
+    static constexpr size_t MAX_REQUEST_BYTES = 8192;
+
+    explicit MetricsExporter(const MetricsRegistry& registry) : registry_(registry) {}
+    ~MetricsExporter();
+
+    // port为0时由系统分配端口，之后用port()获取
+    bool start(int port);
+    void stop();
+    int port() const { return port_; }
+
+private:
+    void serveLoop();
+    void handleConnection(int fd);
+
+    const MetricsRegistry& registry_;
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+} // namespace dkv
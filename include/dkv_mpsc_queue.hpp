@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace dkv {
+
+// 无界无锁多生产者单消费者队列
+// 生产者用CAS把节点压入链表头部；消费者一次交换取走整条链表，反转后按入队顺序处理。
+// 同一生产者入队的元素保持先后顺序。push返回入队前队列是否为空，
+// 生产者只在这时唤醒消费者，消费者取走链表后到达的元素会再次触发唤醒。
+template <typename T>
+class MPSCQueue {
+public:
+    MPSCQueue() = default;
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    ~MPSCQueue() {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        while (node) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    // 可在任意线程调用，返回入队前队列是否为空
+    bool push(T&& value) {
+        Node* node = new Node{std::move(value), nullptr};
+        Node* head = head_.load(std::memory_order_relaxed);
+        do {
+            node->next = head;
+        } while (!head_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    // 只能由消费者调用：取出当前全部元素，按入队顺序依次交给fn(T&)，返回处理的个数
+    template <typename Fn>
+    size_t consumeAll(Fn&& fn) {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        // 链表头是最后入队的元素，反转后从最早的开始处理
+        Node* ordered = nullptr;
+        while (node) {
+            Node* next = node->next;
+            node->next = ordered;
+            ordered = node;
+            node = next;
+        }
+        size_t count = 0;
+        while (ordered) {
+            Node* next = ordered->next;
+            fn(ordered->value);
+            delete ordered;
+            ordered = next;
+            count++;
+        }
+        return count;
+    }
+
+    // 近似判断
+    bool empty() const { return head_.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    alignas(64) std::atomic<Node*> head_{nullptr};
+};
+
+} // namespace dkv
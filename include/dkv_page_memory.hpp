@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dkv {
+
+// 大页模式
+enum class HugePageMode {
+    OFF,         // 普通4KB页
+    TRANSPARENT, // 按2MB对齐映射并以MADV_HUGEPAGE建议内核使用透明大页
+    EXPLICIT     // MAP_HUGETLB使用预留的2MB大页，预留不足时退回透明大页
+};
+
+// 页内存统计
+struct PageMemoryStats {
+    size_t mapped_bytes = 0;         // 当前映射的字节数
+    size_t huge_page_bytes = 0;      // 其中以大页映射（MAP_HUGETLB）或建议使用透明大页的字节数
+    uint64_t hugetlb_fallbacks = 0;  // MAP_HUGETLB失败后退回普通映射的次数
+    std::vector<size_t> node_bytes;  // 各NUMA节点上绑定映射的字节数，下标为节点序号
+};
+
+// 按页映射的大块内存，供slab和键空间哈希表使用。
+// 开启NUMA分区后，map可把内存优先放在指定节点（mbind MPOL_PREFERRED），节点序号对应numaNodeCpus的顺序；
+// 读取不到NUMA拓扑时只有一个节点，不做绑定。configure应在启动时、大量分配之前调用
+class PageMemory {
+public:
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    // 参与分区的NUMA节点数上限，超出的节点与前面的节点共用分区
+    static constexpr size_t MAX_NODES = 8;
+
+    static void configure(HugePageMode mode, bool numa_arenas);
+    static HugePageMode hugePageMode();
+    static bool numaArenas();
+    // NUMA节点数，未开启NUMA分区时为1
+    static size_t nodeCount();
+    // 调用线程当前所在CPU的节点序号，未开启NUMA分区时为0。
+    // 线程第一次调用时确定并缓存，绑核的线程（见CpuAffinityConfig）始终得到所在节点
+    static size_t currentNode();
+
+    // 映射bytes字节，大页模式下按2MB取整；不小于2MB的映射按2MB对齐。node小于0或未开启NUMA分区时不绑定节点。失败时返回nullptr
+    static void* map(size_t bytes, int node = -1);
+    // 释放map返回的内存，bytes与映射时相同
+    static void unmap(void* ptr, size_t bytes);
+    // 映射时实际占用的字节数
+    static size_t mappedSize(size_t bytes);
+
+    static PageMemoryStats stats();
+
+    static bool parseHugePageMode(const std::string& text, HugePageMode& mode);
+    static const char* hugePageModeName(HugePageMode mode);
+};
+
+} // namespace dkv
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "dkv_core.hpp"
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace dkv {
+
+class SubReactor;
+
+// 订阅者在其SubReactor中的fd与连接ID
+using Subscriber = std::pair<int, uint64_t>;
+
+// 模式订阅的前缀树：glob模式（* ? [abc] [^a-z] 与\转义，与Redis相同）按记号编译为树中的路径，
+// 共享前缀的模式共享节点。匹配时把树当作NFA，按频道名逐字节推进当前状态集合，
+// 代价与频道名长度和同时活跃的状态数成正比，与模式总数无关
+class PatternTrie {
+public:
+    PatternTrie();
+    ~PatternTrie();
+
+    PatternTrie(const PatternTrie&) = delete;
+    PatternTrie& operator=(const PatternTrie&) = delete;
+
+    // 登记订阅，已订阅时返回false
+    bool add(const std::string& pattern, const Subscriber& subscriber);
+    // 取消订阅并剪除不再使用的节点，未订阅时返回false
+    bool remove(const std::string& pattern, const Subscriber& subscriber);
+    // 对与channel匹配的每个模式调用fn(pattern, subscribers)
+    void match(std::string_view channel,
+               const std::function<void(const std::string&, const std::vector<Subscriber>&)>& fn) const;
+
+    size_t patterns() const { return pattern_count_; }
+    bool empty() const { return pattern_count_ == 0; }
+
+private:
+    struct Token {
+        enum Kind : uint8_t { LITERAL, ANY, STAR, CLASS } kind = LITERAL;
+        char ch = 0;
+        std::bitset<256> set; // CLASS：可匹配的字节，取反已展开
+
+        bool operator==(const Token& other) const {
+            return kind == other.kind && ch == other.ch && set == other.set;
+        }
+    };
+    struct Node;
+
+    static std::vector<Token> compile(const std::string& pattern);
+    // 找到或创建（create为true时）记号序列对应的路径，path[0]为根
+    bool walk(const std::vector<Token>& tokens, bool create, std::vector<Node*>& path);
+    // 把node及其后经*可达的节点加入状态集合
+    void addState(const Node* node, std::vector<const Node*>& states) const;
+
+    std::unique_ptr<Node> root_;
+    size_t pattern_count_ = 0;
+    mutable uint64_t epoch_ = 0; // 匹配时给访问过的节点打标记，调用方持有外部锁
+};
+
+// 发布订阅：频道到订阅者的映射按SubReactor分片，每个分片只登记该SubReactor上的连接，
+// 各分片有自己的锁，订阅与取消订阅只在所在分片加锁。
+// PUBLISH把消息编码一次为引用计数的缓冲区，逐个分片取出订阅者后在锁外交给所在SubReactor，
+// 所有订阅者的输出链共享这块缓冲区；模式订阅按匹配到的模式各编码一次
+class PubSub {
+public:
+    // 为每个SubReactor建立一个分片，在接受连接之前调用
+    void init(const std::vector<SubReactor*>& reactors);
+
+    // 订阅或模式订阅，返回该连接订阅的频道与模式总数
+    size_t subscribe(SubReactor* reactor, int fd, uint64_t connection_id, const std::string& channel);
+    size_t psubscribe(SubReactor* reactor, int fd, uint64_t connection_id, const std::string& pattern);
+    // 取消订阅，返回该连接剩余的订阅总数
+    size_t unsubscribe(SubReactor* reactor, uint64_t connection_id, const std::string& channel);
+    size_t punsubscribe(SubReactor* reactor, uint64_t connection_id, const std::string& pattern);
+    // 该连接订阅的全部频道或模式，用于不带参数的UNSUBSCRIBE/PUNSUBSCRIBE
+    std::vector<std::string> channelsOf(SubReactor* reactor, uint64_t connection_id) const;
+    std::vector<std::string> patternsOf(SubReactor* reactor, uint64_t connection_id) const;
+    // 连接断开时清除它的全部订阅
+    void removeClient(SubReactor* reactor, uint64_t connection_id);
+
+    // 发布消息，返回收到消息的订阅者数（模式订阅按匹配的模式计数）
+    size_t publish(const std::string& channel, const std::string& message);
+
+    // 有订阅者的频道数与模式订阅数
+    size_t channels() const;
+    size_t patterns() const;
+
+private:
+    struct ClientSubscriptions {
+        int fd = -1;
+        std::unordered_set<std::string> channels;
+        std::unordered_set<std::string> patterns;
+    };
+    struct Shard {
+        SubReactor* reactor = nullptr;
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::vector<Subscriber>> channels;
+        PatternTrie patterns;
+        std::unordered_map<uint64_t, ClientSubscriptions> clients;
+    };
+
+    Shard* shardOf(SubReactor* reactor) const;
+    // 从频道的订阅者中移除，频道没有订阅者后删除，调用时需持有分片的锁
+    static void removeChannelSubscriber_locked(Shard& shard, const std::string& channel, const Subscriber& subscriber);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace dkv
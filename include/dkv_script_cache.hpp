@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct DkvScriptCompileResult;
+
+namespace dkv {
+
+// 脚本中command()调用的处理函数，参数为命令文本，返回值交回脚本
+using ScriptCommandCallback = std::function<std::string(const std::string& command)>;
+
+// 编译后的脚本字节码。同一脚本的多次执行共享编译结果，每次执行从它创建一个VM：
+// 创建VM只复制字节码，远比编译便宜；VM执行后操作数栈有残留，不能重复使用
+class CompiledScript {
+public:
+    explicit CompiledScript(DkvScriptCompileResult* result) : result_(result) {}
+    ~CompiledScript();
+
+    CompiledScript(const CompiledScript&) = delete;
+    CompiledScript& operator=(const CompiledScript&) = delete;
+
+    // 编译失败时抛出std::runtime_error
+    static std::shared_ptr<const CompiledScript> compile(const std::string& source);
+    // 执行失败时抛出std::runtime_error，可在多个线程中同时执行
+    void run(const ScriptCommandCallback& callback) const;
+
+private:
+    DkvScriptCompileResult* result_;
+};
+
+struct ScriptCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t scripts = 0;
+    size_t capacity = 0;
+};
+
+// 按源码SHA1缓存编译结果，超过容量时淘汰最久未使用的脚本。
+// 正在执行的脚本持有编译结果的引用，被淘汰或清空后仍可执行完
+class ScriptCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    explicit ScriptCache(size_t capacity = DEFAULT_CAPACITY) : capacity_(capacity) {}
+
+    // SCRIPT LOAD：编译并缓存，返回SHA1，已缓存时不重新编译。编译失败时抛出std::runtime_error
+    std::string load(const std::string& source);
+    // EVALX：按源码的SHA1查找，未命中时编译并缓存
+    std::shared_ptr<const CompiledScript> getOrCompile(const std::string& source);
+    // EVALSHA：按SHA1查找，未缓存时返回nullptr
+    std::shared_ptr<const CompiledScript> find(const std::string& sha1);
+    bool exists(const std::string& sha1) const;
+    void flush();
+
+    // 容量至少为1，缩小时立即淘汰多出的脚本
+    void setCapacity(size_t capacity);
+    ScriptCacheStats stats() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const CompiledScript> script;
+        std::list<std::string>::iterator lru_pos;
+    };
+
+    // 编译在锁外进行，插入时若其他线程已缓存同一脚本则使用已有的结果
+    std::shared_ptr<const CompiledScript> insert(const std::string& sha1, const std::string& source);
+    // 调用者持有mutex_
+    std::shared_ptr<const CompiledScript> touchLocked(const std::string& sha1);
+    void evictLocked();
+
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    std::list<std::string> lru_; // 表头为最近使用
+    std::unordered_map<std::string, Entry> scripts_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+} // namespace dkv
@@ -2,9 +2,17 @@
 
 #include "dkv_core.hpp"
 #include "storage/dkv_storage.hpp"
+#include "storage/dkv_eviction_pool.hpp"
 #include "net/dkv_network.hpp"
 #include "persist/dkv_aof.hpp"
 #include "dkv_command_handler.hpp"
+#include "dkv_blocking.hpp"
+#include "dkv_client_tracking.hpp"
+#include "dkv_pubsub.hpp"
+#include "dkv_latency.hpp"
+#include "dkv_metrics.hpp"
+#include "dkv_cpu_affinity.hpp"
+#include "dkv_page_memory.hpp"
 #include "transaction/dkv_transaction.hpp"
 #include "transaction/dkv_transaction_manager.hpp"
 #include "multinode/raft/dkv_raft.hpp"
@@ -15,10 +23,12 @@ namespace dkv {
     struct ShardConfig;
 }
 #include <memory>
+#include <set>
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <shared_mutex>
+#include <functional>
 
 namespace dkv {
 
@@ -34,6 +44,10 @@ private:
     // 清理线程
     std::thread cleanup_thread_;
     std::atomic<bool> cleanup_running_;
+
+    // MVCC历史版本回收线程，与清理线程共用cleanup_running_
+    std::thread purge_thread_;
+    uint64_t mvcc_purge_interval_ms_ = 100; // 回收间隔（毫秒），0表示不回收
     
     // 配置参数
     std::string config_file_;
@@ -41,6 +55,14 @@ private:
     size_t max_memory_; // 最大内存限制（字节）
     size_t num_sub_reactors_; // 子Reactor数量
     size_t num_workers_;      // 工作线程数量
+    size_t storage_segments_; // 键空间分段数量
+    size_t rdb_threads_ = 0;  // RDB并行保存/加载与AOF并行重放的线程数，0表示按CPU核数
+    RDBCompression rdb_compression_ = RDBCompression::LZF; // RDB数据块压缩算法
+    bool rdb_background_load_ = false; // 启动时在后台加载RDB，加载期间即处理命令
+    size_t script_cache_size_ = ScriptCache::DEFAULT_CAPACITY; // 缓存的脚本编译结果数量上限
+    size_t tracking_table_max_keys_ = ClientTracking::DEFAULT_MAX_KEYS; // 客户端缓存失效表最多记录的键数
+    LazyFreeConfig lazyfree_config_; // 哪些删除交给后台线程释放
+    TieredConfig tiered_config_;     // 分层存储，启用后maxmemory是内存中热数据的容量
     
     // RDB持久化相关配置
     bool enable_rdb_;         // 是否启用RDB持久化
@@ -60,16 +82,45 @@ private:
     std::string aof_fsync_policy_; // AOF fsync策略
     int auto_aof_rewrite_percentage_; // AOF自动重写百分比
     int auto_aof_rewrite_min_size_; // AOF自动重写最小大小
+    size_t aof_rewrite_rate_limit_mb_; // AOF重写每秒最多写入的MB数，0表示不限速
     std::unique_ptr<AOFPersistence> aof_persistence_; // AOF持久化管理器
     
+    // 客户端输出缓冲区限制
+    ClientOutputLimit client_output_limit_;
+
+    // 是否在SubReactor线程上直接执行命令（run-to-completion模式）
+    bool run_to_completion_ = false;
+    // 工作线程池的慢命令通道
+    SlowLaneConfig slow_lane_;
+
+    // 是否由各SubReactor通过SO_REUSEPORT各自接受连接
+    bool reuseport_ = false;
+    // SubReactor使用的网络IO后端
+    IoBackend io_backend_ = IoBackend::EPOLL;
+    // SubReactor与工作线程绑核配置
+    CpuAffinityConfig cpu_affinity_;
+    // slab与键空间哈希表的大页模式，以及slab是否按NUMA节点分区，读取配置文件后生效
+    HugePageMode huge_pages_ = HugePageMode::OFF;
+    bool numa_arenas_ = false;
+    // 主动碎片整理：slab占用超过已用字节的(100+threshold)%且多出的字节数超过ignore_bytes时，
+    // 在每个主动过期周期之后执行一次碎片整理周期
+    bool active_defrag_ = false;
+    size_t active_defrag_ignore_bytes_ = 100 * 1024 * 1024;
+    uint32_t active_defrag_threshold_ = 10;
+    // 键空间内存采样：每隔interval秒完整遍历一轮，0表示关闭，结果见MEMORY STATS
+    uint32_t memory_sample_interval_ = 0;
+
     // 内存淘汰策略
     EvictionPolicy eviction_policy_ = EvictionPolicy::NOEVICTION; // 默认使用noeviction策略
+    size_t maxmemory_samples_ = 5; // 近似淘汰每轮采样的键数
+    EvictionPool eviction_pool_;   // 淘汰候选池，跨命令保留
+    std::mutex eviction_mutex_;    // 保护淘汰候选池
     
     // 事务配置
     TransactionIsolationLevel transaction_isolation_level_ = TransactionIsolationLevel::READ_COMMITTED; // 默认使用读已提交隔离级别
     mutable std::shared_mutex transaction_mutex_; // 事务锁
     std::unordered_map<int, uint64_t> client_transaction_ids_; // 客户端事务ID映射
-    mutable std::mutex serializable_mutex_; // 可序列化锁
+    std::unordered_map<int, WatchedKeys> client_watched_keys_; // 客户端WATCH的键，同样由transaction_mutex_保护
     
     // RAFT配置
     bool enable_raft_;             // 是否启用RAFT
@@ -78,6 +129,20 @@ private:
     std::vector<std::string> raft_peers_; // RAFT集群节点列表
     std::string raft_data_dir_;    // RAFT数据目录
     int max_raft_state_;           // RAFT日志最大大小（超过则创建快照）
+    size_t raft_snapshot_rate_limit_ = 0; // 向跟随者发送快照每秒最多的字节数，0表示不限速
+    // RAFT模式下读命令的一致性：LOCAL直接读本机数据；READ_INDEX经ReadIndex确认后读本机数据，
+    // 跟随者也可以提供读；LEASE在READ_INDEX基础上允许领导者在租约内跳过心跳确认
+    enum class RaftReadMode { LOCAL, READ_INDEX, LEASE };
+    RaftReadMode raft_read_mode_ = RaftReadMode::READ_INDEX;
+    // READONLY连接在跟随者上读取时允许的最大落后：已应用索引落后领导者提交索引的条数，
+    // 以及距最近一次收到领导者消息的毫秒数；超出时退回raft_read_mode的读取方式，负数表示不检查
+    int raft_replica_max_lag_entries_ = 100;
+    int raft_replica_max_lag_ms_ = 500;
+    std::set<std::pair<SubReactor*, uint64_t>> readonly_clients_; // 开启READONLY的连接
+    std::mutex readonly_clients_mutex_;
+    size_t raft_max_batch_entries_ = RAFT_DEFAULT_MAX_BATCH_ENTRIES; // 每个AppendEntries请求最多携带的日志条目数
+    size_t raft_max_batch_bytes_ = RAFT_DEFAULT_MAX_BATCH_BYTES;     // 每个AppendEntries请求最多携带的命令字节数
+    size_t raft_apply_workers_ = 1; // 并行应用已提交日志的线程数，1表示在应用线程上逐条执行
     
     // RAFT组件
     std::shared_ptr<dkv::Raft> raft_; // RAFT实例
@@ -92,6 +157,24 @@ private:
     std::string shard_raft_data_dir_; // 分片RAFT数据目录
     std::vector<std::vector<std::string>> shard_peers_; // 分片RAFT节点列表 [分片ID][节点ID]
 
+    // 阻塞在空列表上的BLPOP/BRPOP/BLMOVE
+    BlockedClients blocked_clients_;
+    // 开启CLIENT TRACKING的连接读过的键
+    ClientTracking client_tracking_;
+    // 发布订阅，按SubReactor分片
+    PubSub pubsub_;
+    // 各命令和各处理阶段的延迟直方图与慢查询日志
+    LatencyMonitor latency_monitor_;
+
+    // 监控指标导出，端口为0时不启用
+    int metrics_port_ = 0;
+    std::unique_ptr<MetricsRegistry> metrics_registry_;
+    std::unique_ptr<MetricsExporter> metrics_exporter_;
+    std::atomic<uint64_t> evicted_keys_{0}; // 累计淘汰的键数
+
+    // 注册监控指标，在各组件创建之后调用
+    void registerMetrics();
+
 public:
     DKVServer(int port = 6379, size_t num_sub_reactors = 4, size_t num_workers = 8);
     ~DKVServer();
@@ -115,9 +198,52 @@ public:
     bool isRunning() const;
     
     // 执行命令
+    // 异步版本完成时调用done：Raft写命令在日志应用后由Raft线程回调，其余命令在调用线程上直接回调。
+    // 阻塞命令在列表为空时由推入元素的线程或reactor的事件循环线程（超时）回调；没有reactor时不阻塞
+    using CommandCallback = std::function<void(const Response&)>;
+    void OnClientCommand(int client_fd, const Command& command, CommandCallback done,
+                         SubReactor* reactor = nullptr, uint64_t connection_id = 0);
     Response OnClientCommand(int client_fd, const Command& command);
+    // replica_read为true时命令来自READONLY连接，Raft跟随者在有界陈旧范围内直接读本机数据
+    void executeCommand(const Command& command, TransactionID tx_id, CommandCallback done, bool replica_read = false);
     Response executeCommand(const Command& command, TransactionID tx_id);
     Response doCommandNative(const Command& command, TransactionID tx_id);
+    // 在指定的存储引擎上执行命令，分片的Raft状态机用它把命令应用到分片自己的存储引擎。
+    // 不是服务器自身的存储引擎时不记录RDB变更，SAVE、BGSAVE、SHUTDOWN不可用
+    Response doCommandNative(StorageEngine* storage_engine, CommandHandler* command_handler, const Command& command, TransactionID tx_id);
+    // 在本机执行命令并记录延迟，完成后服务阻塞的客户端和写出失效通知
+    void executeNative(const Command& command, TransactionID tx_id, CommandCallback done);
+    // 恢复时重放持久化文件中的命令，跳过内存上限检查和Raft
+    Response replayCommand(const Command& command);
+    // WATCH/UNWATCH只修改连接的监视状态，不经过Raft复制
+    Response handleWatchCommand(int client_fd, const Command& command, TransactionID tx_id);
+    void unwatchClient(int client_fd);
+    // 先尝试一次，列表都为空时登记等待，超时定时器和连接断开的取消由reactor负责
+    void executeBlockingCommand(const Command& command, SubReactor* reactor, int client_fd, uint64_t connection_id,
+                                CommandCallback done);
+    // 推入列表的命令执行成功后标记目标键就绪，由executeCommand在命令完成后服务等待者
+    void signalListPush(const Command& command);
+    // CLIENT TRACKING ON|OFF，只修改连接的跟踪状态，需要连接所在的reactor
+    Response handleClientCommand(const Command& command, SubReactor* reactor, int client_fd, uint64_t connection_id);
+    // 处理READONLY/READWRITE，开启或关闭连接的副本读模式
+    Response handleReplicaReadCommand(const Command& command, SubReactor* reactor, uint64_t connection_id);
+    // 处理SUBSCRIBE/UNSUBSCRIBE/PSUBSCRIBE/PUNSUBSCRIBE，订阅状态属于连接
+    Response handleSubscribeCommand(const Command& command, SubReactor* reactor, int client_fd, uint64_t connection_id);
+    // 写出命令执行期间记下的失效通知，不能在持有存储锁或SubReactor的锁时调用
+    void pushInvalidations();
+    // LATENCY HISTOGRAM [command ...] 与 LATENCY RESET
+    Response handleLatencyCommand(const Command& command);
+    // SLOWLOG GET [count]、SLOWLOG LEN 与 SLOWLOG RESET
+    Response handleSlowLogCommand(const Command& command);
+    // DEBUG TRACE SAMPLE <every>、DEBUG TRACE DUMP [filename] 与 DEBUG TRACE RESET
+    Response handleDebugCommand(const Command& command);
+    // MEMORY USAGE <key> [SAMPLES count] 与 MEMORY STATS
+    Response handleMemoryCommand(const Command& command);
+
+    // 命令延迟统计，工作线程记录排队耗时时使用
+    LatencyMonitor& latencyMonitor() { return latency_monitor_; }
+    // 估计遍历集合的命令要处理的元素个数，工作线程池据此选择通道。在提交任务的线程上调用，只获取键所在分段的读锁
+    size_t estimateCommandCost(const Command& command) const;
     
     // 获取内存使用量
     size_t getMemoryUsage() const;
@@ -127,18 +253,25 @@ public:
     
     // 设置内存淘汰策略
     void setEvictionPolicy(EvictionPolicy policy);
+    // 设置近似淘汰每轮采样的键数
+    void setMaxMemorySamples(size_t samples);
     
     // 获取内存淘汰策略
     EvictionPolicy getEvictionPolicy() const;
     
+    // 设置MVCC历史版本回收间隔（毫秒），0表示不回收，在start之前设置
+    void setMVCCPurgeInterval(uint64_t interval_ms);
+    
     // 设置事务隔离等级
     void setTransactionIsolationLevel(TransactionIsolationLevel level);
 
     // 获取事务隔离等级
     TransactionIsolationLevel getTransactionIsolationLevel() const;
     
-    // 根据淘汰策略淘汰键
+    // 根据淘汰策略淘汰键；启用分层存储时改为把选中的键的值移到磁盘
     void evictKeys(TransactionID tx_id);
+    // 单次淘汰调用最多执行的采样轮数（每轮至多淘汰一个键），限制单条写命令承担的淘汰开销
+    static constexpr size_t MAX_EVICTION_ROUNDS = 64;
 
     // 获取存储引擎（用于AOF重写）
     StorageEngine* getStorageEngine() const {
@@ -150,7 +283,37 @@ public:
     void setRDBFilename(const std::string& filename);
     void setRDBSaveInterval(uint64_t interval);
     void setRDBSaveChanges(uint64_t changes);
+    // 持久化数据并行保存/加载的线程数，在start之前设置
+    void setRDBThreads(size_t threads);
+    // RDB数据块压缩算法，在start之前设置
+    void setRDBCompression(RDBCompression compression);
+    // 启动时在后台加载RDB文件，在start之前设置。只在未启用AOF和RAFT时生效
+    void setRDBBackgroundLoad(bool enabled);
     
+    // 客户端输出缓冲区限制，在start之前设置
+    void setClientOutputLimit(const ClientOutputLimit& limit);
+
+    // run-to-completion模式，在start之前设置
+    void setRunToCompletion(bool enabled);
+
+    // 工作线程池的慢命令通道，在start之前设置
+    void setSlowLane(const SlowLaneConfig& config);
+
+    // 分层存储：超过maxmemory时把冷数据的值移到磁盘日志而不是删除键，在start之前设置
+    void setTieredStorage(const TieredConfig& config);
+
+    // SO_REUSEPORT多监听socket模式与线程绑核，在start之前设置
+    void setReusePort(bool enabled);
+    void setCpuAffinity(const CpuAffinityConfig& config);
+
+    // 监控指标的HTTP导出端口，0表示不启用，在start之前设置
+    void setMetricsPort(int port);
+    // 实际监听的导出端口，没有启用时返回0
+    int getMetricsPort() const;
+
+    // 设置SubReactor的网络IO后端，io_uring不可用时退回epoll，在start之前设置
+    void setIoBackend(IoBackend backend);
+
     // AOF持久化配置方法
     void setAOFEnabled(bool enabled);
     void setAOFFilename(const std::string& filename);
@@ -166,14 +329,17 @@ private:
     // 清理过期键的线程函数
     void cleanupExpiredKeys();
     
+    // 回收MVCC历史版本的线程函数
+    void purgeMVCCVersions();
+    
     // 解析配置文件
     bool parseConfigFile(const std::string& config_file);
     
     // 初始化分片默认配置
     void InitializeDefaultShardConfig();
     
-    // RDB持久化辅助方法
-    void loadRDBFromConfig();
+    // RDB持久化辅助方法。background为true时文件支持后台加载则在后台载入，否则同步加载
+    void loadRDBFromConfig(bool background = false);
     void saveRDBFromConfig();
     
     // RDB自动保存线程函数
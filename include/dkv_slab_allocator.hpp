@@ -0,0 +1,143 @@
+#ifndef DKV_SLAB_ALLOCATOR_HPP
+#define DKV_SLAB_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace dkv {
+
+// 按大小分级的slab分配器，用于DataItem对象和小块容器内存
+// 每个大小级别从64KB的slab中切分对象，线程本地缓存空闲对象，批量与slab交换。
+// slab按自身大小对齐，开头是记录表，对象按地址找到所属slab并归还到该slab的空闲链表；
+// 有空闲对象的slab串成链表，刚从满变为有空闲的slab放在表头，取对象时从表头开始，使对象集中在较满的slab中。
+// 每个大小级别最多保留一个全空的slab，其余全空的slab归还系统。
+// 内存用量按对象所属大小级别计入MemoryAllocator，因此释放对象后used_memory随之下降。
+// 开启大页或NUMA分区（见PageMemory）后，slab从2MB的页内存块中切分；每个NUMA节点有一组独立的空闲链表，
+// 线程从所在节点的分区取对象，新slab的页面优先分配在该节点上。线程释放的对象归入释放线程所在节点的分区
+class SlabAllocator {
+public:
+    // 可由slab分配的最大对象大小
+    static constexpr size_t MAX_SIZE = 512;
+    // 每个slab的大小
+    static constexpr size_t SLAB_SIZE = 64 * 1024;
+    // 大小级别数量
+    static constexpr size_t NUM_CLASSES = 16;
+    // 线程本地缓存与slab之间每次交换的对象数
+    static constexpr size_t BATCH_SIZE = 32;
+    // slab开头记录表的大小，对象从其后开始
+    static constexpr size_t SLAB_HEADER_SIZE = 64;
+    // 开启页内存后每次映射的字节数，切分为多个slab
+    static constexpr size_t CHUNK_SIZE = 2 * 1024 * 1024;
+
+    // 获取单例实例，实例不会析构，保证静态对象析构阶段释放DataItem仍然安全
+    static SlabAllocator& getInstance();
+
+    // 分配size字节，size超过MAX_SIZE时退回MemoryAllocator
+    void* allocate(size_t size);
+    // 释放内存，size必须与分配时一致
+    void deallocate(void* ptr, size_t size);
+
+    // 大小级别
+    static size_t classIndex(size_t size);
+    static size_t classSize(size_t index);
+
+    // 统计信息
+    size_t getSlabCount() const;
+    // 某个NUMA节点分区的slab数
+    size_t getSlabCount(size_t node) const;
+    size_t getReservedBytes() const;
+    // 已从slab取出的对象字节数，含线程本地缓存中的空闲对象
+    size_t getUsedBytes() const;
+    // slab碎片率：slab占用的字节数与已取出对象字节数之比，没有对象时为1
+    double getFragmentationRatio() const;
+    std::string getStats() const;
+
+    // 碎片整理：对象所在slab的使用率低于同级别slab的平均值，且不是下一次分配的slab时返回true，
+    // 此时把对象搬到新分配的内存中可以腾空稀疏的slab。ptr必须是从slab切分的对象（大小不超过MAX_SIZE）
+    bool shouldRelocate(const void* ptr) const;
+
+    // 作用域内本线程的分配与释放绕过线程本地缓存：分配从最满的slab取对象，释放直接归还所属slab。
+    // 碎片整理搬移对象时使用，保证新对象落在较满的slab中、旧slab尽快腾空
+    class DefragScope {
+    public:
+        DefragScope();
+        ~DefragScope();
+        DefragScope(const DefragScope&) = delete;
+        DefragScope& operator=(const DefragScope&) = delete;
+
+    private:
+        bool previous_;
+    };
+
+private:
+    SlabAllocator() = default;
+
+    // 禁止拷贝和移动
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    // 空闲对象，以对象自身的前8字节作为链表指针
+    struct FreeObject {
+        FreeObject* next;
+    };
+
+    // slab开头的记录表，由所属大小级别的锁保护
+    struct Slab {
+        FreeObject* free_list = nullptr;
+        Slab* prev = nullptr; // 有空闲对象的slab链表
+        Slab* next = nullptr;
+        uint32_t free_count = 0;
+        uint32_t capacity = 0;
+        uint8_t arena = 0;
+        uint8_t index = 0;
+        bool mapped = false; // 从页内存块切分
+        bool listed = false; // 在有空闲对象的slab链表中
+    };
+    static_assert(sizeof(Slab) <= SLAB_HEADER_SIZE, "slab记录表超出预留空间");
+
+    // 每个大小级别有空闲对象的slab链表
+    struct SizeClass {
+        mutable std::mutex mutex;
+        Slab* partial_head = nullptr;
+        Slab* partial_tail = nullptr;
+        size_t empty_slabs = 0; // 全空的slab数，最多保留一个
+        std::atomic<size_t> slab_count{0};
+        std::atomic<size_t> used_count{0}; // 已取出的对象数
+    };
+    // 一个NUMA节点的分区，未开启NUMA分区时只使用第0个
+    struct Arena {
+        SizeClass classes[NUM_CLASSES];
+        std::mutex chunk_mutex; // 保护当前切分中的页内存块和归还的slab
+        char* chunk = nullptr;
+        size_t chunk_left = 0;
+        std::vector<char*> free_slabs; // 从页内存块切分、已归还物理页的slab，优先复用
+    };
+    static constexpr size_t MAX_ARENAS = 8;
+    Arena arenas_[MAX_ARENAS];
+
+    friend struct SlabThreadCache;
+
+    static Slab* slabOf(const void* ptr) {
+        return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(ptr) & ~(SLAB_SIZE - 1));
+    }
+    static void linkFront(SizeClass& size_class, Slab* slab);
+    static void linkBack(SizeClass& size_class, Slab* slab);
+    static void unlink(SizeClass& size_class, Slab* slab);
+
+    // 分配一个按SLAB_SIZE对齐的slab并切分为空闲对象：开启页内存时从节点的页内存块切分，否则从堆上分配
+    Slab* newSlab(size_t arena, size_t index);
+    // 把全空的slab归还系统，调用时持有所属大小级别的锁
+    void freeSlab(Slab* slab);
+    // 从有空闲对象的slab中取出至多want个对象，没有时切分新slab
+    FreeObject* refill(size_t arena, size_t index, size_t want, size_t& count);
+    // 把以nullptr结尾的链表中的对象逐个归还所属slab
+    void release(size_t index, FreeObject* head);
+};
+
+} // namespace dkv
+
+#endif // DKV_SLAB_ALLOCATOR_HPP
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace dkv {
+
+// 按采样追踪请求在各处理阶段的耗时，导出为Chrome trace（Perfetto可直接打开）的JSON。
+// SubReactor解析完一批命令时按采样率决定是否追踪，被追踪的批次带着追踪ID经过线程池、执行、Raft提交和写出；
+// 执行线程上的追踪ID保存在线程局部变量中，存储锁、MVCC版本链等深处的阶段由TraceSpan读取，不必逐层传参。
+// 每个线程的事件写入自己的环形缓冲区，写满后覆盖最旧的事件。采样关闭时每批命令只多一次relaxed原子读，
+// 各阶段只多一次线程局部变量读取
+class RequestTracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 每个线程的环形缓冲区保留的事件数
+    static constexpr size_t RING_CAPACITY = 8192;
+
+    // 每every批命令追踪一批，0表示关闭
+    static void setSampleRate(uint32_t every) { sample_every_.store(every, std::memory_order_relaxed); }
+    static uint32_t sampleRate() { return sample_every_.load(std::memory_order_relaxed); }
+    // 按采样率决定是否追踪新的一批命令，返回追踪ID，不追踪时返回0
+    static uint64_t sample() {
+        uint32_t every = sample_every_.load(std::memory_order_relaxed);
+        return every == 0 ? 0 : sampleSlow(every);
+    }
+
+    // 当前线程正在执行的追踪ID，0表示未被追踪
+    static uint64_t current() { return current_trace_; }
+
+    // 记录在当前线程上执行的一个阶段。name与detail须为静态字符串，detail可为空
+    static void record(uint64_t trace_id, const char* name, const char* detail,
+                       Clock::time_point start, Clock::time_point end);
+    // 记录跨线程或不占用线程的阶段（如排队、等待Raft提交），导出为异步事件
+    static void recordAsync(uint64_t trace_id, const char* name, const char* detail,
+                            Clock::time_point start, Clock::time_point end);
+
+    // 全部线程缓冲区中的事件，按开始时间排序的Chrome trace JSON
+    static std::string dumpJSON();
+    static bool dumpToFile(const std::string& filename);
+    // 清空所有缓冲区
+    static void reset();
+    // 各缓冲区当前保留的事件数之和
+    static size_t eventCount();
+
+private:
+    friend class TraceScope;
+
+    static uint64_t sampleSlow(uint32_t every);
+    static void append(uint64_t trace_id, const char* name, const char* detail,
+                       Clock::time_point start, Clock::time_point end, bool async);
+
+    static std::atomic<uint32_t> sample_every_;
+    static inline thread_local uint64_t current_trace_ = 0;
+};
+
+// 在作用域内把当前线程的追踪ID设为trace_id，退出时恢复
+class TraceScope {
+public:
+    explicit TraceScope(uint64_t trace_id) : previous_(RequestTracer::current_trace_) {
+        RequestTracer::current_trace_ = trace_id;
+    }
+    ~TraceScope() { RequestTracer::current_trace_ = previous_; }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    uint64_t previous_;
+};
+
+// 当前线程被追踪时，把构造到析构之间记录为一个阶段
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const char* detail = nullptr)
+        : trace_id_(RequestTracer::current()), name_(name), detail_(detail) {
+        if (trace_id_ != 0) {
+            start_ = RequestTracer::Clock::now();
+        }
+    }
+    ~TraceSpan() {
+        if (trace_id_ != 0) {
+            RequestTracer::record(trace_id_, name_, detail_, start_, RequestTracer::Clock::now());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    uint64_t trace_id_;
+    const char* name_;
+    const char* detail_;
+    RequestTracer::Clock::time_point start_{};
+};
+
+} // namespace dkv
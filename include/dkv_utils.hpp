@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <chrono>
 #include "dkv_core.hpp"
 
@@ -9,8 +10,8 @@ namespace dkv {
 // 工具函数
 class Utils {
 public:
-    // 将字符串转换为命令类型
-    static CommandType stringToCommandType(const std::string& cmd);
+    // 将字符串转换为命令类型，不区分大小写
+    static CommandType stringToCommandType(std::string_view cmd);
     
     // 将命令类型转换为字符串
     static std::string commandTypeToString(CommandType type);
@@ -27,8 +28,17 @@ public:
     // 整数转字符串
     static std::string intToString(int64_t value);
     
+    // glob风格模式匹配，支持*、?、[...]（含范围和^取反）及反斜杠转义
+    static bool matchPattern(const std::string& pattern, std::string_view str);
+    
     // Base64解码
     static std::string base64Decode(const std::string& encoded);
+    
+    // CRC32校验和（IEEE多项式，与zlib相同），crc为之前数据的校验和，用于分段计算
+    static uint32_t crc32(const char* data, size_t length, uint32_t crc = 0);
+
+    // SHA1摘要的40位小写十六进制表示，用作脚本缓存的键
+    static std::string sha1Hex(const std::string& data);
 };
 
 void printBacktrace();
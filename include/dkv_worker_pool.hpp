@@ -1,54 +1,141 @@
 #pragma once
 
 #include "dkv_core.hpp"
+#include "dkv_mpmc_queue.hpp"
 #include <vector>
 #include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
 
 namespace dkv {
 
 class SubReactor;
 class Command;
+struct CommandBatch;
 
 // 命令任务，用于线程池执行
+// 同一连接一次读取解析出的全部命令组成一个任务，按顺序执行，回复合并后一次写出
 struct CommandTask {
-    SubReactor* sub_reactor;
-    Command command;
-    int client_fd;
-    std::string client_read_buffer;
-    size_t parsed_pos;
+    SubReactor* sub_reactor = nullptr;
+    std::vector<Command> commands;
+    int client_fd = -1;
+    uint64_t connection_id = 0;  // 区分复用同一fd的不同连接
+    size_t reactor_index = 0;    // 提交任务的SubReactor编号，用于选择工作线程组
+    std::shared_ptr<CommandBatch> batch;  // 非空表示继续执行因等待异步命令而暂停的批次
+    std::chrono::steady_clock::time_point enqueue_time{};  // 提交到线程池的时间，直接执行的任务为空
+    bool slow = false;           // 由慢命令通道执行，首次提交时确定，暂停后继续执行的批次沿用
+    uint64_t trace_id = 0;       // 被采样追踪时的追踪ID，见RequestTracer
+};
+
+// 慢命令通道：估计开销达到阈值的任务（耗时命令，或遍历元素很多的集合）由单独的一组线程执行，
+// 不在普通任务的队列中排队，避免挡住后面的小命令
+struct SlowLaneConfig {
+    size_t threads = 1;         // 慢命令线程数，0表示不区分通道
+    size_t threshold = 10000;   // 估计开销（元素个数）达到该值的命令走慢命令通道
+    int nice = 5;               // 慢命令线程的nice值增量，CPU紧张时让出给普通工作线程
 };
 
 class DKVServer;
 
 // 工作线程池，执行命令
+// 每个工作线程有一个无锁本地队列，空闲时从同组及其他线程的队列窃取任务。
+// 工作线程按SubReactor分组，同一连接的任务总是先投递到同一个线程，保持缓存局部性。
+// 慢命令进入共享的慢命令队列，只由慢命令线程执行；慢命令线程在慢命令队列为空时也窃取普通任务。
 class WorkerThreadPool {
+public:
+    // 每个工作线程本地队列的容量，全部写满时落入共享的溢出队列
+    static constexpr size_t LOCAL_QUEUE_CAPACITY = 1024;
+
 private:
+    struct Worker {
+        Worker() : queue(LOCAL_QUEUE_CAPACITY) {}
+        BoundedMPMCQueue<CommandTask> queue;
+        // 以下仅用于休眠与唤醒
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::atomic<bool> sleeping{false};
+        bool wake_pending = false;  // 由mutex保护
+        std::thread thread;
+    };
+
     DKVServer* server_;
     std::atomic<bool> stop_;
 
-    std::vector<std::thread> workers_;
-    std::queue<CommandTask> task_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable condition_;
+    // 前num_workers_个为普通工作线程，其后为慢命令线程
+    std::vector<std::unique_ptr<Worker>> workers_;
+    size_t num_workers_;
+    size_t num_groups_;
+    std::atomic<size_t> idle_workers_{0};
+    SlowLaneConfig slow_lane_;
+
+    // 慢命令通道，任务开销大，加锁的代价可以忽略
+    std::deque<CommandTask> slow_queue_;
+    std::mutex slow_mutex_;
+    std::atomic<size_t> slow_size_{0};
+
+    // 本地队列全部写满时的兜底队列
+    std::queue<CommandTask> overflow_queue_;
+    std::mutex overflow_mutex_;
+    std::atomic<size_t> overflow_size_{0};
 public:
-    WorkerThreadPool(DKVServer* server, size_t num_threads = 4);
+    // num_groups通常等于SubReactor数量，每组工作线程优先处理对应SubReactor的任务。
+    // 另外创建slow_lane.threads个慢命令线程
+    WorkerThreadPool(DKVServer* server, size_t num_threads = 4, size_t num_groups = 1,
+                     const SlowLaneConfig& slow_lane = SlowLaneConfig());
     ~WorkerThreadPool();
-    
+
     // 提交任务到线程池
     void enqueue(const CommandTask& task);
-    
+    void enqueue(CommandTask&& task);
+
     // 停止线程池
     void stop();
 
+    // 全部线程数，包括慢命令线程
+    size_t size() const { return workers_.size(); }
+    // 各队列中等待执行的任务数之和，近似值
+    size_t queuedTasks() const;
+    // 慢命令队列中等待执行的任务数
+    size_t queuedSlowTasks() const { return slow_size_.load(std::memory_order_relaxed); }
+    // 一批命令中是否有估计开销达到慢命令阈值的命令，未启用慢命令通道时也按同一阈值判断
+    bool isSlowBatch(const std::vector<Command>& commands) const;
+    // 工作线程所属的组
+    size_t groupOf(size_t index) const;
+    // 把工作线程绑定到cpus
+    bool pinWorker(size_t index, const std::vector<int>& cpus);
+
+    // 在调用线程上按顺序执行一批命令，供run-to-completion模式的SubReactor使用。
+    // Raft写命令提交后不等待应用，最后一条命令完成时把整批回复交给SubReactor，可能发生在其他线程上
+    void executeTask(CommandTask&& task);
+
 private:
     // 工作线程函数
-    void workerThread();
+    void workerThread(size_t index);
+
+    bool isSlowWorker(size_t index) const { return index >= num_workers_; }
+    // 第group组的第一个工作线程
+    size_t groupBegin(size_t group) const { return group * num_workers_ / num_groups_; }
+    // 任务所属的工作线程：先按SubReactor选组，再按连接在组内选线程
+    size_t homeWorker(const CommandTask& task) const;
+    // 依次尝试本地队列、其他线程的队列和溢出队列；慢命令线程先尝试慢命令队列
+    bool tryDequeue(size_t index, CommandTask& task);
+    void enqueueSlow(CommandTask&& task);
+    // 没有可执行的任务时休眠，直到被唤醒或超时
+    void waitForWork(size_t index);
+    // 任务入队后按需唤醒线程：目标线程休眠时唤醒它，目标线程忙且积压时唤醒一个空闲线程来窃取
+    void notifyAfterPush(size_t index);
+    void wakeWorker(size_t index);
 
-    Response executeCommand(int client_fd,const Command& command);
+    // 执行批次中剩余的命令，遇到需要等待的命令时暂停，由完成的命令重新提交
+    void runBatch(const std::shared_ptr<CommandBatch>& batch);
+    // 一条命令完成；整批完成时交付回复，暂停的批次在前面的命令全部完成后继续执行
+    void completeCommand(const std::shared_ptr<CommandBatch>& batch);
+    void finishBatch(CommandBatch& batch);
 };
 
-} // namespace dkv
\ No newline at end of file
+} // namespace dkv
@@ -7,6 +7,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 #include <queue>
 #include <thread>
 #include <unordered_map>
@@ -25,12 +26,30 @@ static constexpr int RAFT_INVALID_TERM = -1;
 static constexpr int RAFT_INVALID_INDEX = -1;
 static constexpr int RAFT_DEFAULT_ELECTION_TIMEOUT = 500; // 默认选举超时时间（毫秒）
 static constexpr int RAFT_DEFAULT_HEARTBEAT_INTERVAL = 100; // 默认心跳间隔（毫秒）
+static constexpr size_t RAFT_SNAPSHOT_CHUNK_SIZE = 1024 * 1024; // InstallSnapshot每个数据块的字节数
+static constexpr size_t RAFT_SNAPSHOT_MAX_BYTES_PER_ROUND = 16 * 1024 * 1024; // 每轮复制向一个节点发送的快照字节上限
+static constexpr int RAFT_MIN_ELECTION_TIMEOUT = 150; // 最短选举超时（毫秒）
+static constexpr int RAFT_LEASE_DURATION = 120; // 领导者读租约（毫秒），小于最短选举超时，留出时钟漂移余量
+static constexpr size_t RAFT_DEFAULT_MAX_BATCH_ENTRIES = 1024; // 每个AppendEntries请求默认最多携带的日志条目数
+static constexpr size_t RAFT_MAX_APPLY_BATCH = 1024; // 应用线程每批交给状态机的最多条目数
+static constexpr size_t RAFT_DEFAULT_MAX_BATCH_BYTES = 1024 * 1024; // 每个AppendEntries请求默认最多携带的命令字节数
 
 struct RaftCommand {
     RaftCommand(TransactionID tx_id, const Command& db_command)
         : tx_id(tx_id), db_command(db_command) {}
     TransactionID tx_id;
     Command db_command;
+
+    // 事务的写命令集合编码为一条不带事务ID的EXEC命令，整个事务只占一条日志、一轮复制，
+    // 各节点应用时在一个新事务中依次执行后提交。参数依次为每条子命令的 类型 参数个数 参数...，
+    // 日志记录格式不变；客户端的EXEC不带参数，不会与之混淆
+    static Command EncodeTransaction(const std::vector<Command>& commands);
+    // 是否为EncodeTransaction编码的事务
+    static bool IsTransaction(const Command& command) {
+        return command.type == CommandType::EXEC && !command.args.empty();
+    }
+    // 解出事务的子命令，编码损坏时返回false
+    static bool DecodeTransaction(const Command& command, std::vector<Command>& commands);
 };
 
 // RAFT节点状态枚举
@@ -45,6 +64,8 @@ struct RaftLogEntry {
     int term;                 // 日志的任期
     std::shared_ptr<RaftCommand> command;  // 日志命令
     int index;                // 日志索引
+    // 编码后的日志记录（见dkv_raft_log_codec.hpp），写日志段和发送AppendEntries时直接使用，为空时按需编码
+    std::shared_ptr<const std::string> record;
 };
 
 // RAFT RPC请求和响应结构
@@ -55,6 +76,7 @@ struct AppendEntriesRequest {
     int prevLogTerm;          // 前一个日志的任期
     std::vector<RaftLogEntry> entries; // 要追加的日志条目
     int leaderCommit;         // 领导者的已提交索引
+    bool quiesce = false;     // 领导者所在组已静默，跟随者在领导者节点存活时不发起选举
 };
 
 struct AppendEntriesResponse {
@@ -75,18 +97,41 @@ struct RequestVoteResponse {
     bool voteGranted;         // 是否授予选票
 };
 
+// 快照按数据块分多次发送（与RAFT论文相同）：offset为本块在快照中的偏移，done表示最后一块
 struct InstallSnapshotRequest {
     int term;                 // 领导者的任期
     int leaderId;             // 领导者ID
     int lastIncludedIndex;    // 快照包含的最后一个日志索引
     int lastIncludedTerm;     // 快照包含的最后一个日志任期
-    std::vector<char> snapshot; // 快照数据
+    std::vector<char> snapshot; // 本块的快照数据
     int leaderCommit;         // 领导者的已提交索引
+    uint64_t offset = 0;      // 本块在快照中的偏移
+    bool done = true;         // 是否为最后一块
 };
 
 struct InstallSnapshotResponse {
     int term;                 // 当前节点的任期
     bool success;             // 请求是否成功
+    uint64_t nextOffset = 0;  // 跟随者已收到的字节数，偏移不连续时领导者从这里续传
+};
+
+// ReadIndex请求：跟随者向领导者请求线性一致读的读取索引
+struct ReadIndexRequest {
+    int term;                 // 跟随者的任期
+    int followerId;           // 跟随者ID
+};
+
+struct ReadIndexResponse {
+    int term = 0;             // 领导者的任期
+    bool success = false;     // 领导者是否确认了自己的领导地位
+    int readIndex = 0;        // 读取索引：确认时领导者的提交索引
+};
+
+// 日志复制与应用进度，供监控读取
+struct RaftProgress {
+    int lastLogIndex = 0; // 本机最后一条日志的索引
+    int commitIndex = 0;  // 已提交的索引
+    int lastApplied = 0;  // 已应用到状态机的索引
 };
 
 // RAFT状态机接口
@@ -96,10 +141,27 @@ public:
     
     // 执行命令并返回结果
     virtual Response DoOp(const RaftCommand& command) = 0;
+
+    // 按日志顺序执行一批命令，结果依次写入results。默认逐条调用DoOp，
+    // 实现可以在整批上只获取一次锁，或并行执行互不冲突的命令
+    virtual void DoOps(const std::vector<const RaftCommand*>& commands, std::vector<Response>& results) {
+        results.clear();
+        results.reserve(commands.size());
+        for (const RaftCommand* command : commands) {
+            results.push_back(DoOp(*command));
+        }
+    }
     
     // 创建快照
     virtual std::vector<char> Snapshot() = 0;
     
+    // 开始创建快照：在应用线程上调用，返回时快照内容已经固定，返回的函数在后台线程生成快照数据，
+    // 期间可以继续应用日志。返回空函数表示暂时不能创建快照。默认在调用时直接生成
+    virtual std::function<std::vector<char>()> BeginSnapshot() {
+        auto snapshot = std::make_shared<std::vector<char>>(Snapshot());
+        return [snapshot]() { return std::move(*snapshot); };
+    }
+    
     // 从快照恢复
     virtual void Restore(const std::vector<char>& snapshot) = 0;
 };
@@ -112,8 +174,17 @@ public:
     // 保存RAFT状态
     virtual void SaveState(int term, int votedFor) = 0;
     
-    // 保存日志
-    virtual void SaveLog(const std::vector<RaftLogEntry>& log) = 0;
+    // 追加日志条目，只写入不保证落盘
+    virtual void AppendLog(const std::vector<RaftLogEntry>& entries) = 0;
+    
+    // 删除索引>=index的日志条目（与领导者的日志冲突）
+    virtual void TruncateLogSuffix(int index) = 0;
+    
+    // 删除索引<=index的日志条目（已被快照包含）
+    virtual void CompactLog(int index) = 0;
+    
+    // 把之前追加、删除的日志落盘，没有未落盘的修改时直接返回；可以与AppendLog并发调用
+    virtual void SyncLog() = 0;
     
     // 保存快照
     virtual void SaveSnapshot(const std::vector<char>& snapshot) = 0;
@@ -124,11 +195,15 @@ public:
     // 读取投票给谁
     virtual int ReadVotedFor() = 0;
     
-    // 读取日志
-    virtual std::vector<RaftLogEntry> ReadLog() = 0;
+    // 按索引顺序把持久化的日志条目逐条交给fn，返回已被快照包含的最后索引（没有压缩过时为0）
+    virtual int ReplayLog(const std::function<void(RaftLogEntry&&)>& fn) = 0;
     
     // 读取快照
     virtual std::vector<char> ReadSnapshot() = 0;
+    
+    // 读取快照中从offset开始最多length字节，total返回快照总字节数。
+    // 默认实现读取整个快照后截取，实现可以覆盖为按偏移读取
+    virtual std::vector<char> ReadSnapshotChunk(uint64_t offset, size_t length, uint64_t& total);
 };
 
 // RAFT网络接口
@@ -144,6 +219,12 @@ public:
     
     // 发送InstallSnapshot请求
     virtual InstallSnapshotResponse SendInstallSnapshot(int serverId, const InstallSnapshotRequest& request) = 0;
+    
+    // 发送ReadIndex请求，默认实现返回失败，即跟随者不能提供线性一致读
+    virtual ReadIndexResponse SendReadIndex(int serverId, const ReadIndexRequest& request);
+    
+    // 最近within_ms毫秒内是否收到过节点serverId的消息，用于静默组判断领导者存活；默认不支持，返回false
+    virtual bool IsPeerAlive(int serverId, int within_ms);
 };
 
 // RAFT核心类
@@ -164,12 +245,22 @@ public:
     // 停止RAFT
     void Stop();
     
+    // 把日志应用线程绑定到cpus，需在Start之后调用
+    bool PinApplyThread(const std::vector<int>& cpus);
+    
     // 提交命令到RAFT日志
     bool StartCommand(const RaftCommand& command, int& index, int& term) {
         return StartCommand(std::make_shared<RaftCommand>(command), index, term);
     }
     bool StartCommand(const std::shared_ptr<RaftCommand>& command, int& index, int& term);
 
+    // 命令应用到状态机、任期不一致、超时或Raft停止时调用，每条命令恰好调用一次
+    using CommandCallback = std::function<void(const Response&)>;
+    // 异步提交命令，不阻塞调用线程：回调在入日志的同时登记，由应用线程完成，超时由Raft线程完成。
+    // 回调运行在Raft内部线程上，只应转交结果，不能阻塞或等待其他Raft操作；返回false时不取走回调
+    bool StartCommand(const std::shared_ptr<RaftCommand>& command, int& index, int& term,
+                      CommandCallback&& callback, int timeout_ms);
+
     // 等待命令结果
     Response waitForCommandResult(int index, int expected_term, int timeout_ms);
 
@@ -187,9 +278,30 @@ public:
     
     // 获取提交索引
     int GetCommitIndex() const;
+
+    // 日志、提交和应用进度，不获取锁，三项不是同一时刻的快照
+    RaftProgress GetProgress() const;
     
     // 获取当前节点认为的领导者ID
     int GetCurrentLeaderId() const;
+    
+    // 线性一致读：返回true时状态机已应用到读取索引，此时读取本机数据不会读到旧值，读取不写日志。
+    // 领导者在租约有效时直接以提交索引为读取索引，否则发出一轮心跳并等待多数节点确认；
+    // 跟随者向领导者请求读取索引。超时、没有领导者或失去领导地位时返回false
+    bool ReadIndex(int timeout_ms);
+
+    // 有界陈旧读：跟随者最近max_lag_ms毫秒内接受过领导者的AppendEntries，且已应用的索引落后于
+    // 领导者告知的提交索引不超过max_lag_entries条时返回true，此时可以不经领导者直接读取本机数据。
+    // 参数为负表示不检查该项；领导者和候选者返回false
+    bool StaleReadAllowed(int max_lag_entries, int max_lag_ms) const;
+    
+    // 开启租约读。集群中所有节点的设置需要一致：开启后节点在最近收到领导者消息的最短选举超时内拒绝投票，
+    // 保证租约期间不会选出新领导者
+    void SetLeaseRead(bool enabled) { leaseRead_ = enabled; }
+    
+    // 开启静默：日志全部提交且所有跟随者都已确认后，领导者停止向确认过的跟随者发送心跳，
+    // 跟随者在网络层报告领导者节点存活时不发起选举。需要网络实现IsPeerAlive，否则跟随者会超时选举
+    void SetQuiesce(bool enabled) { quiesceEnabled_ = enabled; }
 
     // 处理AppendEntries请求
     AppendEntriesResponse OnAppendEntries(const AppendEntriesRequest& request);
@@ -200,12 +312,24 @@ public:
     // 处理InstallSnapshot请求
     InstallSnapshotResponse OnInstallSnapshot(const InstallSnapshotRequest& request);
     
+    // 处理跟随者的ReadIndex请求
+    ReadIndexResponse OnReadIndex(const ReadIndexRequest& request);
+    
     // 创建快照
     void Snapshot(int index, const std::vector<char>& snapshot);
     
     // 获取持久化字节数（用于快照决策）
     size_t PersistBytes() const;
     
+    // 设置发送快照每秒最多的字节数，0表示不限速（每轮仍不超过RAFT_SNAPSHOT_MAX_BYTES_PER_ROUND）
+    void SetSnapshotRateLimit(size_t bytes_per_sec) { snapshotRateLimit_ = bytes_per_sec; }
+    
+    // 设置每个AppendEntries请求最多携带的日志条目数和命令字节数，0表示不限制；至少携带一条
+    void SetReplicationBatchLimits(size_t max_entries, size_t max_bytes) {
+        maxBatchEntries_ = max_entries;
+        maxBatchBytes_ = max_bytes;
+    }
+    
 private:
     // 重置选举计时器
     void ResetElectionTimer();
@@ -213,8 +337,8 @@ private:
     // 开始选举
     void StartElection();
     
-    // 发送心跳
-    void SendHeartbeats();
+    // 获得多数投票后成为领导者，调用方持有mutex_
+    void BecomeLeaderLocked(int votes);
     
     // 处理选举超时
     void HandleElectionTimeout();
@@ -222,23 +346,55 @@ private:
     // 应用日志到状态机
     void ApplyLogs();
     
-    // 更新提交索引
+    // 更新提交索引，领导者自己的日志落盘后才计入多数
     void UpdateCommitIndex();
     
+    // 日志刷盘线程：把已追加的日志成批落盘，期间不持有mutex_。领导者的刷盘与向跟随者发送并行，
+    // 落盘后推进提交索引；跟随者回复AppendEntries前等待落盘，并发到达的请求共享一次fdatasync
+    void WalLoop();
+    
     // 检查日志一致性
     bool IsLogConsistent(int prevLogIndex, int prevLogTerm);
     
     // 验证并添加日志条目
     bool ValidateAndAppendEntries(const std::vector<RaftLogEntry>& entries, int prevLogIndex);
     
-    // 复制日志条目到follower
+    // 通知各跟随者的复制线程发送一轮AppendEntries（没有新日志时即为心跳）
     void ReplicateLogs();
     
+    // 同上，调用时持有mutex_
+    void NotifyReplicators();
+    
+    // 跟随者server的复制线程：同一跟随者同一时间只有一个请求在途，
+    // 在途期间新提交的命令合并到下一个请求，各跟随者之间并行复制
+    void ReplicatorLoop(int server);
+    
+    // 向跟随者server发送一批日志或快照数据块。调用时持有lock，发送期间释放；
+    // 成功且还有未发送的日志时返回true，由调用方立即发送下一批
+    bool ReplicateTo(int server, std::unique_lock<std::mutex>& lock);
+    
+    // 向节点server按块发送快照，从上次中断的偏移续传，受限速和每轮字节上限约束。
+    // 调用时持有lock，发送期间释放；任期过期转为FOLLOWER时返回false
+    bool SendSnapshotChunks(int server, std::unique_lock<std::mutex>& lock);
+    
+    // 领导者确认读取索引：等待当前任期的日志提交后取提交索引，租约无效时等待多数节点确认一轮心跳。
+    // 调用时持有lock
+    bool ConfirmReadIndex(std::unique_lock<std::mutex>& lock, int& readIndex, std::chrono::steady_clock::time_point deadline);
+    
+    // 确认了本轮ReadIndex的节点数（包括自己）
+    int ReadAckCount(uint64_t round) const;
+    
+    // 多数节点最近一次确认的请求的发送时间，租约从这里开始计算
+    std::chrono::steady_clock::time_point QuorumAckTime() const;
+    
     // 持久化状态
     void PersistState();
     
-    // 持久化日志
-    void PersistLog();
+    // 追加持久化日志条目，不刷盘
+    void PersistLog(const std::vector<RaftLogEntry>& entries);
+    
+    // 持久化日志刷盘，由刷盘线程调用
+    void SyncPersistedLog();
     
     // 从持久化恢复
     void RestoreFromPersist();
@@ -257,6 +413,9 @@ private:
     int votedFor_;
     std::vector<RaftLogEntry> log_;
     
+    // 日志条目编码后的总字节数，随追加和删除累计
+    size_t logBytes_ = 0;
+    
     // 提交和应用相关
     int commitIndex_;
     int lastApplied_;
@@ -265,6 +424,40 @@ private:
     std::vector<int> nextIndex_;
     std::vector<int> matchIndex_;
     
+    // 向各节点发送快照的进度，快照被新快照替换时从头发送
+    std::vector<int> snapshotSendIndex_;       // 正在发送的快照的lastIncludedIndex
+    std::vector<uint64_t> snapshotSendOffset_; // 下一块的偏移
+    // 快照发送限速（令牌桶，所有节点共享）
+    std::atomic<size_t> snapshotRateLimit_;
+    double snapshotTokens_;
+    std::chrono::steady_clock::time_point snapshotTokensTime_;
+    
+    // 各跟随者的复制线程，replicatePending_标记有待发送的一轮复制
+    std::vector<std::thread> replicatorThreads_;
+    std::vector<bool> replicatePending_;
+    std::condition_variable replicateCond_;
+    std::atomic<size_t> maxBatchEntries_;
+    std::atomic<size_t> maxBatchBytes_;
+    
+    // ReadIndex确认：每次确认一个新轮次，复制线程收到同任期的响应后记录节点确认到的轮次和对应请求的发送时间
+    uint64_t readRound_;
+    std::vector<uint64_t> ackedRound_;
+    std::vector<std::chrono::steady_clock::time_point> ackTime_;
+    std::condition_variable readCond_; // 确认轮次、提交索引或应用索引变化时通知
+    std::atomic<bool> leaseRead_;
+    std::chrono::steady_clock::time_point lastLeaderContact_; // 最近一次接受领导者AppendEntries的时间
+    int leaderCommit_; // 跟随者收到的领导者提交索引，可能大于本机日志的最后索引
+    
+    // 静默：领导者进入静默后只向尚未确认静默的跟随者发送心跳；跟随者记录领导者静默时的任期
+    std::atomic<bool> quiesceEnabled_;
+    bool quiesced_;
+    std::vector<bool> quiesceAcked_;
+    int quiescedLeaderTerm_;
+    
+    // 跟随者正在接收的快照
+    std::vector<char> pendingSnapshot_;
+    int pendingSnapshotIndex_;
+    
     // 计时器
     std::atomic<int> electionTimeout_;
     std::atomic<int64_t> lastElectionTime_;
@@ -284,9 +477,27 @@ private:
     // 内部线程
     std::thread raftThread_;
     std::thread applyThread_;
+    std::thread walThread_;
+    // 后台生成快照数据的线程，snapshotting_为true时不再开始新的快照
+    std::thread snapshotThread_;
+    bool snapshotting_ = false;
+    
+    // 日志落盘进度：durableIndex_及之前的日志已经落盘；日志后缀被删除时logTruncations_加一，
+    // 刷盘期间发生删除的那一轮不推进durableIndex_
+    int durableIndex_;
+    uint64_t logTruncations_;
+    std::condition_variable walCond_;     // 有待刷盘的日志时通知刷盘线程
+    std::condition_variable durableCond_; // durableIndex_推进时通知等待的跟随者请求
     
     // 日志起始索引
     int logStartIndex_;
+
+    // 日志、提交和应用进度的副本，修改后由PublishProgress更新，供不持有锁的读取
+    std::atomic<int> publishedLastLogIndex_{0};
+    std::atomic<int> publishedCommitIndex_{0};
+    std::atomic<int> publishedLastApplied_{0};
+    // 调用时持有mutex_
+    void PublishProgress();
     
     // 快照配置
     int max_raft_state_; // 日志最大大小，超过则创建快照
@@ -301,6 +512,8 @@ private:
         bool done;
         Response result;
         int expected_term; // 记录startcommand返回的term值，用于一致性检查
+        CommandCallback callback; // 非空表示异步提交，完成时调用而不是唤醒等待者
+        std::chrono::steady_clock::time_point deadline;
         CommandResult() : done(false), expected_term(0) {}
     };
     
@@ -312,6 +525,9 @@ private:
     
     // 设置命令结果
     void setCommandResult(int index, int actual_term, const Response& result);
+
+    // 以超时错误完成已过期的异步命令；all为true时完成全部异步命令，用于停止
+    void ExpireCommandResults(bool all);
     
 };
 
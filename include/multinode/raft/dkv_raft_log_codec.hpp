@@ -0,0 +1,38 @@
+#pragma once
+
+#include "dkv_raft.hpp"
+#include "../../persist/dkv_mapped_file.hpp"
+#include <memory>
+#include <string>
+
+namespace dkv {
+
+// Raft日志记录编码，日志段和AppendEntries请求使用同一格式：条目编码一次，写盘和发送都直接使用这份字节
+// 记录：载荷长度(uint32) 载荷CRC32(uint32) 载荷
+// 载荷：索引(int32) 任期(int32) 事务ID(uint64) 命令类型(int32) 参数个数(uint32) {参数长度(uint32) 参数}
+constexpr size_t RAFT_LOG_RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+// 把条目编码为一条记录追加到out
+void EncodeRaftLogRecord(std::string& out, const RaftLogEntry& entry);
+
+// 编码条目并保存到entry.record，已有编码时不重复编码
+void AttachRaftLogRecord(RaftLogEntry& entry);
+
+// 条目的编码：有entry.record时直接返回，否则编码到scratch中
+const std::string& RaftLogRecordOf(const RaftLogEntry& entry, std::string& scratch);
+
+// 读取一条记录，不完整、校验失败或格式错误时返回false。keepRecord为true时把记录字节保存到entry.record，
+// 只解出索引和任期，命令留到应用时由RaftLogCommandOf解码；否则解码命令到entry.command
+bool ReadRaftLogRecord(ByteReader& reader, RaftLogEntry& entry, bool keepRecord = false);
+
+// 把条目压缩为只保存编码：没有编码时先编码，之后释放entry.command。日志中的条目都是这种形式，
+// 每条只占一块连续内存，不再为每个参数单独分配
+void CompactRaftLogEntry(RaftLogEntry& entry);
+
+// 条目的命令：有entry.command时直接返回，否则从entry.record解码；编码损坏时返回nullptr
+std::shared_ptr<RaftCommand> RaftLogCommandOf(const RaftLogEntry& entry);
+
+// 条目编码后的字节数，用于日志大小统计和复制批次的字节限制
+size_t RaftLogEntryBytes(const RaftLogEntry& entry);
+
+} // namespace dkv
@@ -10,6 +10,9 @@
 #include <thread>
 #include <condition_variable>
 #include <chrono>
+#include <deque>
+#include <string_view>
+#include <sys/uio.h>
 
 namespace dkv {
 
@@ -31,8 +34,20 @@ struct ConnectionInfo {
 };
 
 // RAFT网络实现类
+// 每个请求和响应是一帧：帧长度(uint32，网络字节序) 类型(1字节) 消息体，到每个节点保持一条长连接。
+// AppendEntries的消息体在固定字段之后直接拼接条目已编码的日志记录，用scatter-gather一次写出，不再重新编码；
+// 接收端用一个epoll线程处理所有节点的连接。
+// 一个节点上的所有Raft组共享同一个实例，请求带组ID：发往同一节点的AppendEntries由该节点的发送线程
+// 合并成一个批量帧，各组对齐发出的心跳因此每个心跳间隔只占一次往返；没有待发请求时发送空批量帧探测节点存活。
 class RaftTcpNetwork : public RaftNetwork {
 public:
+    // 单个RPC收发的超时时间（毫秒）
+    static constexpr int RPC_TIMEOUT_MS = 1000;
+    // 帧长度上限，超过时认为连接数据损坏
+    static constexpr uint32_t MAX_FRAME_SIZE = 256 * 1024 * 1024;
+    // 一个批量帧携带的日志记录字节数上限，至少携带一个请求
+    static constexpr size_t MAX_BATCH_BYTES = 4 * 1024 * 1024;
+
     // 构造函数
     RaftTcpNetwork(int me, const std::vector<std::string>& peers);
     
@@ -48,16 +63,54 @@ public:
     // 发送InstallSnapshot请求
     InstallSnapshotResponse SendInstallSnapshot(int serverId, const InstallSnapshotRequest& request) override;
     
+    // 发送ReadIndex请求
+    ReadIndexResponse SendReadIndex(int serverId, const ReadIndexRequest& request) override;
+    
+    // 以上请求发往指定Raft组；不带组ID的版本发往组0
+    AppendEntriesResponse SendAppendEntries(uint32_t groupId, int serverId, const AppendEntriesRequest& request);
+    RequestVoteResponse SendRequestVote(uint32_t groupId, int serverId, const RequestVoteRequest& request);
+    InstallSnapshotResponse SendInstallSnapshot(uint32_t groupId, int serverId, const InstallSnapshotRequest& request);
+    ReadIndexResponse SendReadIndex(uint32_t groupId, int serverId, const ReadIndexRequest& request);
+    
+    // 最近within_ms毫秒内是否与节点serverId完成过一次请求
+    bool IsPeerAlive(int serverId, int within_ms) override;
+    
     // 启动网络监听
     void StartListener();
     
     // 停止网络监听
     void StopListener();
     
-    // 设置Raft实例指针
-    void SetRaft(std::shared_ptr<Raft> raft) { raft_ = raft; }
+    // 注册和注销Raft组，发往未注册组的请求得到失败响应
+    void RegisterGroup(uint32_t groupId, std::shared_ptr<Raft> raft);
+    void UnregisterGroup(uint32_t groupId);
+    
+    // 设置Raft实例指针，即注册组0
+    void SetRaft(std::shared_ptr<Raft> raft) { RegisterGroup(0, raft); }
+    
+    // 当前节点ID和集群节点列表
+    int GetMe() const { return me_; }
+    const std::vector<std::string>& GetPeers() const { return peers_; }
     
 private:
+    // 等待发送线程合并发送的AppendEntries请求，由调用方线程持有
+    struct PendingAppend {
+        uint32_t groupId;
+        const AppendEntriesRequest* request;
+        AppendEntriesResponse response;
+        bool done;
+    };
+    
+    // 到一个节点的发送线程和待发队列
+    struct PeerChannel {
+        std::mutex mutex;
+        std::condition_variable cv; // 队列非空或请求完成时通知
+        std::deque<PendingAppend*> queue;
+        std::thread sender;
+        std::atomic<int64_t> lastHeard{0}; // 最近一次请求成功的时间（steady_clock毫秒）
+    };
+    
+
     // 当前节点ID
     int me_;
     
@@ -70,8 +123,16 @@ private:
     // 连接状态锁
     std::mutex connections_mutex_;
     
-    // Raft实例指针
-    std::weak_ptr<Raft> raft_;
+    // 每个节点一把RPC锁，同一连接上的请求与响应不交错；构造后不再增删
+    std::unordered_map<int, std::unique_ptr<std::mutex>> rpc_mutexes_;
+    
+    // 已注册的Raft组
+    std::unordered_map<uint32_t, std::weak_ptr<Raft>> groups_;
+    std::mutex groups_mutex_;
+    
+    // 每个节点一个发送通道；构造后不再增删
+    std::unordered_map<int, std::unique_ptr<PeerChannel>> channels_;
+    std::atomic<bool> senders_running_{false};
     
     // 监听线程
     std::thread listener_thread_;
@@ -100,14 +161,32 @@ private:
     // 关闭连接
     void CloseConnection(int serverId);
     
-    // 发送数据
-    bool SendData(int sockfd, const std::vector<char>& data);
+    // 查找Raft组，未注册或已销毁时返回空
+    std::shared_ptr<Raft> FindGroup(uint32_t groupId);
+    
+    // 节点serverId的发送线程：取出待发的AppendEntries合并成批量帧发送，空闲时发送空批量帧
+    void SenderLoop(int serverId);
+    
+    // 发送一个批量帧并填写各请求的响应，失败时各请求保持失败响应
+    void SendAppendBatch(int serverId, const std::vector<PendingAppend*>& batch);
+    
+    // 处理批量AppendEntries帧，生成批量响应
+    bool HandleAppendBatch(std::string_view payload, std::vector<char>& response_data);
+    
+    // 停止发送线程，未发送的请求以失败结束
+    void StopSenders();
     
-    // 接收数据
+    // 在到serverId的连接上发送一帧请求并接收响应帧，失败时关闭连接
+    bool Call(int serverId, char type, const std::vector<struct iovec>& body, std::vector<char>& response);
+    
+    // 发送一帧，body为消息体的各个片段（含类型字节）
+    bool SendData(int sockfd, const std::vector<struct iovec>& body);
+    
+    // 接收一帧，返回消息体
     std::vector<char> ReceiveData(int sockfd);
     
-    // 序列化AppendEntries请求
-    std::vector<char> SerializeAppendEntries(const AppendEntriesRequest& request);
+    // 序列化AppendEntries请求的固定字段，日志条目由调用方按记录追加
+    std::vector<char> SerializeAppendEntriesHeader(const AppendEntriesRequest& request);
     
     // 反序列化AppendEntries响应
     AppendEntriesResponse DeserializeAppendEntriesResponse(const std::vector<char>& data);
@@ -127,11 +206,14 @@ private:
     // 监听连接
     void Listen();
     
-    // 处理连接
-    void HandleConnection(int client_fd);
+    // 读取连接上到达的数据并处理其中完整的帧，连接关闭或出错时返回false
+    bool HandleReadable(int client_fd, std::vector<char>& buffer);
     
-    // 反序列化AppendEntries请求
-    AppendEntriesRequest DeserializeAppendEntries(const std::vector<char>& data);
+    // 处理一帧请求并写回响应
+    bool HandleRequest(int client_fd, std::string_view frame);
+    
+    // 反序列化AppendEntries请求，日志记录不完整或校验失败时返回false
+    bool DeserializeAppendEntries(std::string_view data, AppendEntriesRequest& request);
     
     // 反序列化RequestVote请求
     RequestVoteRequest DeserializeRequestVote(const std::vector<char>& data);
@@ -148,6 +230,12 @@ private:
     // 序列化InstallSnapshot响应
     std::vector<char> SerializeInstallSnapshotResponse(const InstallSnapshotResponse& response);
     
+    // ReadIndex请求与响应的序列化
+    std::vector<char> SerializeReadIndex(const ReadIndexRequest& request);
+    ReadIndexRequest DeserializeReadIndex(const std::vector<char>& data);
+    std::vector<char> SerializeReadIndexResponse(const ReadIndexResponse& response);
+    ReadIndexResponse DeserializeReadIndexResponse(const std::vector<char>& data);
+    
     // 连接维护线程函数
     void ConnectionMaintenance();
     
@@ -164,4 +252,23 @@ private:
     void CheckAndUpdateConnections();
 };
 
+// 共享传输上一个Raft组的网络接口，请求都带上组ID
+class RaftGroupNetwork : public RaftNetwork {
+public:
+    RaftGroupNetwork(std::shared_ptr<RaftTcpNetwork> transport, uint32_t groupId)
+        : transport_(std::move(transport)), groupId_(groupId) {}
+    
+    AppendEntriesResponse SendAppendEntries(int serverId, const AppendEntriesRequest& request) override;
+    RequestVoteResponse SendRequestVote(int serverId, const RequestVoteRequest& request) override;
+    InstallSnapshotResponse SendInstallSnapshot(int serverId, const InstallSnapshotRequest& request) override;
+    ReadIndexResponse SendReadIndex(int serverId, const ReadIndexRequest& request) override;
+    bool IsPeerAlive(int serverId, int within_ms) override;
+    
+    uint32_t GetGroupId() const { return groupId_; }
+    
+private:
+    std::shared_ptr<RaftTcpNetwork> transport_;
+    uint32_t groupId_;
+};
+
 } // namespace dkv
@@ -7,16 +7,34 @@
 namespace dkv {
 
 // RAFT持久化实现
+// 日志按段追加写入<dir>/raft_log.<序号>，每条记录带长度和CRC32，追加时只写新条目，不再重写整个日志。
+// AppendLog只写入页缓存，SyncLog一次fdatasync覆盖此前的全部追加，由调用方在回复或发送前批量刷盘。
+// SyncLog在fdatasync期间不持有锁，刷盘与之后的追加并行。
+// 当前段超过LOG_SEGMENT_SIZE后切换到新段；快照压缩时先记录压缩点，再整段删除已被快照包含的旧段。
+// 恢复时按段顺序流式解析，遇到不完整或校验失败的记录时截断该处之后的内容。
 class RaftFilePersister : public RaftPersister {
 public:
+    // 每个日志段的大小上限
+    static constexpr uint64_t LOG_SEGMENT_SIZE = 64 * 1024 * 1024;
+
     // 构造函数
     explicit RaftFilePersister(const std::string& dir);
+    ~RaftFilePersister() override;
     
     // 保存状态
     void SaveState(int term, int votedFor) override;
     
-    // 保存日志
-    void SaveLog(const std::vector<RaftLogEntry>& log) override;
+    // 追加日志条目
+    void AppendLog(const std::vector<RaftLogEntry>& entries) override;
+    
+    // 删除索引>=index的日志条目
+    void TruncateLogSuffix(int index) override;
+    
+    // 删除索引<=index的日志条目
+    void CompactLog(int index) override;
+    
+    // 刷盘已追加的日志
+    void SyncLog() override;
     
     // 保存快照
     void SaveSnapshot(const std::vector<char>& snapshot) override;
@@ -27,13 +45,40 @@ public:
     // 读取投票给谁
     int ReadVotedFor() override;
     
-    // 读取日志
-    std::vector<RaftLogEntry> ReadLog() override;
+    // 回放日志
+    int ReplayLog(const std::function<void(RaftLogEntry&&)>& fn) override;
     
     // 读取快照
     std::vector<char> ReadSnapshot() override;
     
+    // 按偏移读取快照的一部分
+    std::vector<char> ReadSnapshotChunk(uint64_t offset, size_t length, uint64_t& total) override;
+    
 private:
+    // 日志段，没有条目时firstIndex和lastIndex为0
+    struct LogSegment {
+        uint64_t seq = 0;
+        int firstIndex = 0;
+        int lastIndex = 0;
+        uint64_t size = 0;
+    };
+    
+    std::string segmentPath(uint64_t seq) const;
+    // 首次访问日志前扫描日志段
+    void ensureLogLoaded();
+    // 扫描日志段，fn非空时把压缩点之后的条目按顺序交给fn；截断损坏的尾部并打开最后一段用于追加
+    void loadSegments(const std::function<void(RaftLogEntry&&)>* fn);
+    // 没有日志段时把旧版文本日志转换为日志段
+    void migrateLegacyLog(const std::function<void(RaftLogEntry&&)>* fn);
+    // 需要时打开新段用于追加
+    bool prepareSegment(size_t appendSize);
+    // 以追加方式重新打开最后一段
+    void reopenLastSegment();
+    void appendLocked(const std::vector<RaftLogEntry>& entries);
+    void syncLocked();
+    int readCompactIndex() const;
+    bool writeCompactIndex(int index) const;
+    
     // 持久化目录
     std::string dir_;
     
@@ -43,11 +88,23 @@ private:
     // 状态文件路径
     std::string stateFilePath_;
     
-    // 日志文件路径
-    std::string logFilePath_;
+    // 旧版文本日志文件路径，只在升级时读取
+    std::string legacyLogFilePath_;
+    
+    // 日志压缩点文件路径
+    std::string logMetaFilePath_;
     
     // 快照文件路径
     std::string snapshotFilePath_;
+    
+    // 日志段，由mutex_保护
+    std::vector<LogSegment> segments_;
+    int logFd_;           // 最后一段的追加描述符，没有段时为-1
+    bool logLoaded_;      // 已扫描过日志段
+    bool logDirty_;       // 有未fdatasync的追加或截断
+    bool dirDirty_;       // 有未同步到目录的段创建或删除
+    int compactIndex_;    // 已被快照包含的最后索引
+    uint64_t nextSeq_;    // 下一个新段的序号
 };
 
 } // namespace dkv
@@ -2,8 +2,13 @@
 
 #include "dkv_raft.hpp"
 #include "../../storage/dkv_storage.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace dkv {
 
@@ -14,13 +19,26 @@ class RaftStateMachineManager : public RaftStateMachine {
 public:
     // 构造函数
     RaftStateMachineManager();
+    ~RaftStateMachineManager() override;
     
     // 执行命令
     Response DoOp(const RaftCommand& command) override;
     
+    // 整批命令只获取一次锁。设置了多个应用线程时，键落在同一线程的命令分给该线程按日志顺序执行，
+    // 同一个键的命令总在同一线程上，保持顺序；事务中的命令、没有键的命令和键分属多个线程的命令
+    // 作为屏障，等之前的命令全部完成后在调用线程上单独执行
+    void DoOps(const std::vector<const RaftCommand*>& commands, std::vector<Response>& results) override;
+    
+    // 设置并行应用的线程数，0或1表示逐条执行；在开始应用日志之前调用
+    void SetApplyWorkers(size_t workers);
+    
     // 创建快照
     std::vector<char> Snapshot() override;
     
+    // 在存储引擎上开始写时复制快照后立即返回，返回的函数在后台把快照写入内存缓冲区，
+    // 期间应用线程继续执行命令；存储引擎已有快照在保存时返回空函数
+    std::function<std::vector<char>()> BeginSnapshot() override;
+    
     // 从快照恢复
     void Restore(const std::vector<char>& snapshot) override;
     
@@ -34,6 +52,21 @@ public:
     void SetDKVServer(DKVServer* server);
     
 private:
+    // 一个并行应用线程，entries为本段分给它的命令下标，按日志顺序排列
+    struct ApplyWorker {
+        std::thread thread;
+        std::vector<size_t> entries;
+    };
+    
+    // 执行一条命令，调用时需持有mutex_
+    Response Apply(const RaftCommand& command);
+    // 命令所有键所在的应用线程，不能并行执行时返回-1
+    int WorkerOf(const RaftCommand& command) const;
+    // 由各应用线程执行本段分配的命令并等待全部完成
+    void RunSegment(const std::vector<const RaftCommand*>& commands, std::vector<Response>& results);
+    void WorkerLoop(size_t worker);
+    void StopWorkers();
+    
     // 命令处理器指针
     void* commandHandler_;
     
@@ -45,6 +78,17 @@ private:
     
     // 互斥锁
     mutable std::mutex mutex_;
+    
+    // 并行应用线程，pool_mutex_保护下面的段状态
+    std::vector<std::unique_ptr<ApplyWorker>> workers_;
+    std::mutex pool_mutex_;
+    std::condition_variable pool_cond_;
+    std::condition_variable segment_done_cond_;
+    uint64_t segment_ = 0;      // 段的序号，变化时应用线程开始执行
+    size_t running_workers_ = 0; // 本段尚未完成的线程数
+    bool stopping_ = false;
+    const std::vector<const RaftCommand*>* segment_commands_ = nullptr;
+    std::vector<Response>* segment_results_ = nullptr;
 };
 
 } // namespace dkv
@@ -2,11 +2,11 @@
 
 #include <vector>
 #include <string>
-#include <unordered_map>
-#include <functional>
 #include <mutex>
 #include <memory>
 #include <set>
+#include <cstdint>
+#include <string_view>
 
 namespace dkv {
 
@@ -18,22 +18,17 @@ enum class HashFunctionType {
     MURMUR3   // Murmur3哈希函数
 };
 
-// 虚拟节点结构体
+// 哈希环：虚拟节点位置的升序数组和对应的物理节点，位置相同时按物理节点排序。
+// 节点或配置变化时整体重建后替换（类似RCU），已发布的哈希环不再修改
 template <typename NodeType>
-struct VirtualNode {
-    std::string hash_key;    // 虚拟节点的哈希键
-    NodeType physical_node;  // 对应的物理节点
-    
-    VirtualNode(const std::string& hash_key, const NodeType& physical_node)
-        : hash_key(hash_key), physical_node(physical_node) {}
-    
-    // 重载比较运算符，用于排序
-    bool operator<(const VirtualNode& other) const {
-        return hash_key < other.hash_key;
-    }
+struct HashRing {
+    uint64_t (*hash)(std::string_view);  // 构建时使用的哈希函数，查询键用同一个函数
+    std::vector<uint64_t> positions;   // 虚拟节点在环上的位置
+    std::vector<NodeType> nodes;       // positions[i]对应的物理节点
 };
 
 // 一致性哈希算法实现
+// 查询只读取当前发布的哈希环，不加锁；增删节点和修改配置由mutex_串行化
 template <typename NodeType>
 class ConsistentHash {
 public:
@@ -50,7 +45,7 @@ public:
     void RemoveNode(const NodeType& node);
     
     // 获取key对应的节点
-    NodeType GetNode(const std::string& key) const;
+    NodeType GetNode(std::string_view key) const;
     
     // 获取所有节点
     std::set<NodeType> GetAllNodes() const;
@@ -71,33 +66,28 @@ public:
     void RebuildRing();
     
 private:
-    // 计算哈希值
-    std::string Hash(const std::string& key) const;
-    
-    // 生成虚拟节点
-    void GenerateVirtualNodes(const NodeType& node);
-    
-    // 删除节点的虚拟节点
-    void RemoveVirtualNodes(const NodeType& node);
+    // 按当前节点和配置重建哈希环并发布，调用方持有mutex_
+    void RebuildRingLocked();
     
     int num_replicas_;  // 每个物理节点对应的虚拟节点数量
     HashFunctionType hash_type_;  // 哈希函数类型
     
-    // 哈希函数映射
-    std::function<std::string(const std::string&)> hash_func_;
+    // 哈希函数
+    uint64_t (*hash_func_)(std::string_view);
     
-    // 哈希环，存储虚拟节点，按哈希值排序
-    std::vector<VirtualNode<NodeType>> hash_ring_;
+    // 当前发布的哈希环，通过std::atomic_load/atomic_store读写
+    std::shared_ptr<const HashRing<NodeType>> ring_;
     
-    // 物理节点到虚拟节点的映射，用于快速删除
-    std::unordered_map<NodeType, std::vector<std::string>> node_to_virtual_;
+    // 物理节点集合
+    std::set<NodeType> nodes_;
     
-    // 互斥锁，保证线程安全
+    // 互斥锁，串行化修改
     mutable std::mutex mutex_;
 };
 
 // 哈希函数实现
-std::string CRC32Hash(const std::string& key);
-std::string Murmur3Hash(const std::string& key);
+// 返回64位哈希值，作为键和虚拟节点在环上的位置
+uint64_t CRC32Hash(std::string_view key);
+uint64_t Murmur3Hash(std::string_view key);
 
 } // namespace dkv
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace dkv {
+
+// 哈希槽数量，与Redis Cluster一致
+constexpr int HASH_SLOT_COUNT = 16384;
+
+// 没有分片负责或没有迁移目标时的分片ID
+constexpr int NO_SHARD = -1;
+
+// CRC16（XMODEM，多项式0x1021），与Redis Cluster的键槽计算相同
+uint16_t CRC16(std::string_view data);
+
+// 计算键所在的哈希槽。键中第一个'{'之后到下一个'}'之间的内容非空时只对这部分计算（hash tag），
+// 使相关的键落在同一个槽
+int KeyHashSlot(std::string_view key);
+
+// 查询槽的结果：redirect为ASK时请求在迁移目标分片上执行，只对这一次请求有效；
+// 为MOVED时槽已经属于shard_id，调用方应更新自己的路由
+enum class SlotRedirect {
+    NONE,
+    ASK,
+    MOVED
+};
+
+// 槽到分片的映射表。每个槽记录负责的分片和迁移目标，迁移期间槽由源分片负责，
+// 源分片上已不存在的键由目标分片处理（ASK），迁移完成后整个槽切换到目标分片。
+// 查询只读原子变量，不加锁；修改由mutex_串行化
+class SlotTable {
+public:
+    SlotTable();
+
+    // 把槽[begin, end]分配给分片，取消其中槽的迁移
+    void AssignRange(int begin, int end, int shard_id);
+
+    // 把所有槽按连续区间平均分配给各分片
+    void AssignEvenly(const std::vector<int>& shard_ids);
+
+    // 槽当前负责的分片，未分配时返回NO_SHARD
+    int GetOwner(int slot) const { return owners_[slot].load(std::memory_order_acquire); }
+
+    // 槽的迁移目标，没有迁移时返回NO_SHARD
+    int GetMigrationTarget(int slot) const { return targets_[slot].load(std::memory_order_acquire); }
+
+    // 开始把槽迁移到目标分片，槽未分配、已在迁移或目标就是当前分片时返回false
+    bool BeginMigration(int slot, int target_shard_id);
+
+    // 完成迁移，槽切换到迁移目标
+    bool CompleteMigration(int slot);
+
+    // 取消迁移，槽仍由源分片负责
+    void CancelMigration(int slot);
+
+    // 分片负责的所有槽
+    std::vector<int> SlotsOf(int shard_id) const;
+
+    // 正在迁移的所有槽
+    std::vector<int> MigratingSlots() const;
+
+private:
+    std::array<std::atomic<int>, HASH_SLOT_COUNT> owners_;
+    std::array<std::atomic<int>, HASH_SLOT_COUNT> targets_;
+    std::mutex mutex_;
+};
+
+} // namespace dkv
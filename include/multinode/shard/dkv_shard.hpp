@@ -1,6 +1,8 @@
 #pragma once
 
 #include "dkv_consistent_hash.hpp"
+#include "dkv_hash_slot.hpp"
+#include "dkv_shard_stats.hpp"
 #include "../raft/dkv_raft.hpp"
 #include "../../dkv_server.hpp"
 #include <atomic>
@@ -8,12 +10,17 @@
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
 #include <condition_variable>
 #include <thread>
 #include <chrono>
+#include <functional>
 
 namespace dkv {
 
+class RaftTcpNetwork;
+class CommandHandler;
+
 // 分片状态枚举
 enum class ShardState {
     ACTIVE,     // 活跃状态
@@ -22,6 +29,12 @@ enum class ShardState {
     FAILED      // 故障状态
 };
 
+// 键到分片的路由方式
+enum class ShardRoutingMode {
+    CONSISTENT_HASH,  // 一致性哈希环，增删分片时按环上位置重新分布
+    HASH_SLOT         // 16384个哈希槽（CRC16），按槽分配给分片并以槽为单位迁移
+};
+
 // 分片统计信息结构体
 struct ShardStats {
     int shard_id;               // 分片ID
@@ -30,7 +43,11 @@ struct ShardStats {
     size_t memory_usage;        // 内存使用量（字节）
     int raft_group_size;        // Raft组大小
     int raft_leader_id;         // Raft领导者ID
-    uint64_t operations_per_second; // 每秒操作数
+    uint64_t operations_per_second; // 上一个统计窗口的每秒操作数
+    uint64_t total_operations;      // 累计操作数
+    uint64_t latency_p50_us;        // 上一个统计窗口的延迟中位数（微秒）
+    uint64_t latency_p99_us;        // 上一个统计窗口的99分位延迟（微秒）
+    std::vector<std::pair<std::string, uint64_t>> hot_keys; // 上一个统计窗口访问最多的键及近似次数
     uint64_t migration_progress;    // 迁移进度（0-100）
     uint64_t last_heartbeat;        // 最后心跳时间戳
 };
@@ -40,6 +57,7 @@ struct ShardConfig {
     bool enable_sharding;       // 是否启用分片功能
     int num_shards;             // 分片数量
     HashFunctionType hash_type; // 哈希函数类型
+    ShardRoutingMode routing_mode = ShardRoutingMode::CONSISTENT_HASH; // 路由方式
     int num_virtual_nodes;      // 虚拟节点数量
     int heartbeat_interval_ms;  // 心跳间隔（毫秒）
     int migration_batch_size;   // 迁移批次大小
@@ -48,12 +66,14 @@ struct ShardConfig {
     bool enable_auto_migration; // 是否启用自动迁移
     int health_check_interval_ms; // 健康检查间隔（毫秒）
     int monitoring_interval_ms; // 监控间隔（毫秒）
+    std::vector<int> shard_cpus; // 分片的Raft应用线程依次各绑定一个CPU，为空时不绑定
 };
 
 // 分片迁移任务结构体
 struct ShardMigrationTask {
     int source_shard_id;        // 源分片ID
     int target_shard_id;        // 目标分片ID
+    int slot = NO_SHARD;        // 迁移的哈希槽，按键范围迁移时为NO_SHARD
     std::string start_key;      // 起始键
     std::string end_key;        // 结束键
     uint64_t total_keys;        // 总键数
@@ -64,11 +84,16 @@ struct ShardMigrationTask {
 };
 
 // 分片类，每个分片对应一个独立的Raft group
+// 同一节点上的所有分片共享一个Raft网络传输，分片的Raft组ID为shard_id + 1，组0留给服务器自身的Raft
 class Shard {
 public:
-    // 构造函数
-    Shard(int shard_id, const std::vector<std::string>& raft_peers, 
-          const std::string& raft_data_dir, int max_raft_state);
+    // 每个统计窗口报告的热点键数量
+    static constexpr size_t HOT_KEYS_REPORTED = 10;
+    
+    // 构造函数，节点ID和集群节点列表取自transport。server非空时分片创建自己的存储引擎，
+    // Raft日志由分片的应用线程经server的命令分发应用到其中，分片之间不共享键空间和分段锁
+    Shard(int shard_id, std::shared_ptr<RaftTcpNetwork> transport,
+          const std::string& raft_data_dir, int max_raft_state, DKVServer* server = nullptr);
     
     // 析构函数
     ~Shard();
@@ -79,7 +104,13 @@ public:
     // 停止分片
     void Stop();
     
-    // 执行命令
+    // 命令完成、失败或超时时调用，每条命令恰好调用一次
+    using CommandCallback = std::function<void(const Response&)>;
+    
+    // 异步执行命令：提交到Raft后立即返回，日志应用后由应用线程调用done，调用线程不等待提交
+    void ExecuteCommandAsync(const Command& command, TransactionID tx_id, CommandCallback done);
+    
+    // 执行命令并等待结果，供迁移线程等可以阻塞的调用方使用
     Response ExecuteCommand(const Command& command, TransactionID tx_id);
     
     // 获取分片ID
@@ -94,10 +125,20 @@ public:
     // 获取Raft实例
     std::shared_ptr<Raft> GetRaft() const { return raft_; }
     
+    // 分片自己的存储引擎，迁移时从中遍历键；没有时返回空
+    StorageEngine* GetStorageEngine() const { return storage_engine_.get(); }
+    
+    // 把Raft应用线程绑定到cpus。分片的数据都由这个线程写入，绑核后分配的内存落在该CPU的NUMA节点上，
+    // slab分配器的线程本地缓存也只服务这一个分片
+    bool PinApplyThread(const std::vector<int>& cpus);
+    
+    // 存储引擎的后台维护：清理一轮过期键，回收不再可见的MVCC版本
+    void RunMaintenance();
+    
     // 获取分片统计信息
     ShardStats GetStats() const;
     
-    // 执行心跳检查
+    // 执行心跳检查，结束当前统计窗口：计算每秒操作数、延迟分位数和热点键，之后开始新窗口
     bool Heartbeat();
     
     // 开始迁移数据到目标分片
@@ -114,7 +155,13 @@ private:
     ShardState state_;          // 分片状态
     mutable std::mutex state_mutex_; // 状态锁
     
+    // 分片的存储引擎和命令处理器，在Raft之前声明，析构时Raft先停止
+    std::unique_ptr<StorageEngine> storage_engine_;
+    std::unique_ptr<CommandHandler> command_handler_;
+    
     // Raft相关组件
+    std::shared_ptr<RaftTcpNetwork> raft_transport_;
+    uint32_t raft_group_id_;
     std::shared_ptr<RaftPersister> raft_persister_;
     std::shared_ptr<RaftNetwork> raft_network_;
     std::shared_ptr<RaftStateMachine> raft_state_machine_;
@@ -129,7 +176,17 @@ private:
     mutable std::mutex stats_mutex_;
     uint64_t key_count_;        // 键数量
     size_t memory_usage_;       // 内存使用量
-    uint64_t operations_per_second_; // 每秒操作数
+    uint64_t operations_per_second_; // 上一个窗口的每秒操作数
+    uint64_t latency_p50_us_;        // 上一个窗口的延迟中位数
+    uint64_t latency_p99_us_;        // 上一个窗口的99分位延迟
+    std::vector<std::pair<std::string, uint64_t>> hot_keys_; // 上一个窗口的热点键
+    uint64_t window_start_;          // 当前窗口的开始时间
+    
+    // 命令路径上更新的计数，不经过stats_mutex_
+    std::atomic<uint64_t> total_ops_;
+    std::atomic<uint64_t> window_ops_;
+    LatencyHistogram latency_;
+    HotKeySketch hot_key_sketch_;
     uint64_t migration_progress_;    // 迁移进度
     uint64_t last_heartbeat_;        // 最后心跳时间
     
@@ -143,6 +200,15 @@ private:
 // 分片管理器类，用于管理多个分片
 class ShardManager {
 public:
+    // 自动重新平衡：最忙分片的每秒操作数达到平均值的这个倍数且不低于下限时迁移热点槽
+    static constexpr uint64_t REBALANCE_LOAD_RATIO = 2;
+    static constexpr uint64_t REBALANCE_MIN_OPS = 1000;
+    
+    // 槽迁移的批次间隔（毫秒）：源分片上一个统计窗口的99分位延迟超过上限时间隔加倍，直到最大值，恢复后逐步减半
+    static constexpr int MIGRATION_BATCH_INTERVAL_MS = 10;
+    static constexpr int MIGRATION_MAX_BATCH_INTERVAL_MS = 1000;
+    static constexpr uint64_t MIGRATION_P99_LIMIT_US = 20000;
+    
     // 构造函数
     ShardManager(DKVServer* server);
     
@@ -158,17 +224,40 @@ public:
     // 停止分片管理器
     void Stop();
     
-    // 处理命令，根据key路由到对应的分片
+    using CommandCallback = Shard::CommandCallback;
+    
+    // 处理命令，根据key路由到对应的分片。结果在最后一个相关分片应用日志后由其应用线程交给done，
+    // 调用线程不等待Raft提交，拆分到多个分片的命令也不为每个子命令占用线程
+    void HandleCommandAsync(const Command& command, TransactionID tx_id, CommandCallback done);
+    
+    // 处理命令并等待结果
     Response HandleCommand(const Command& command, TransactionID tx_id);
     
     // 获取key对应的分片ID
     int GetShardId(const std::string& key) const;
     
+    // 开始把哈希槽迁移到目标分片。迁移期间槽内的命令先交给源分片，键在源分片上不存在时
+    // 转到目标分片执行（ASK），新写入的键因此落在目标分片。迁移线程分批把键搬到目标分片，
+    // 全部搬完后切换槽
+    bool MigrateSlot(int slot, int target_shard_id);
+    
+    // 完成槽迁移，之后槽内的所有命令都由目标分片处理。迁移线程搬完键后调用
+    bool FinishSlotMigration(int slot);
+    
+    // 取消槽迁移
+    void CancelSlotMigration(int slot);
+    
+    // 哈希槽分配表，只在HASH_SLOT路由方式下使用
+    const SlotTable& GetSlotTable() const { return slot_table_; }
+    
     // 获取分片实例
     std::shared_ptr<Shard> GetShard(int shard_id) const;
     
-    // 添加分片
-    bool AddShard(int shard_id, const std::vector<std::string>& raft_peers);
+    // 设置分片共享的Raft网络传输和数据目录，需在Start之前调用；transport为空时使用默认的本机三节点集群
+    void SetRaftTransport(std::shared_ptr<RaftTcpNetwork> transport, const std::string& raft_data_dir);
+    
+    // 添加分片，Raft组使用本节点的集群节点列表
+    bool AddShard(int shard_id);
     
     // 删除分片
     bool RemoveShard(int shard_id);
@@ -199,6 +288,9 @@ private:
     // 初始化分片
     bool InitializeShards();
     
+    // 分片启动后按配置绑定其Raft应用线程
+    void PinShard(Shard& shard);
+    
     // 重新平衡分片
     bool RebalanceShards();
     
@@ -211,11 +303,42 @@ private:
     // 检查分片是否需要故障转移
     void CheckFailover();
     
-    // 更新一致性哈希环
+    // 更新一致性哈希环，调用方持有shards_mutex_
     void UpdateConsistentHash();
     
+    // 按哈希槽路由命令，命令的所有键必须在同一个槽。槽正在迁移时持迁移锁同步执行
+    void HandleSlotCommand(const Command& command, const std::vector<Key>& keys, TransactionID tx_id, CommandCallback done);
+    
+    // 键分布在多个分片上的DEL、EXISTS、MGET、MSET：按分片拆成子命令并行执行，
+    // DEL、EXISTS结果求和，MGET按原始键顺序合并。MSETNX需要原子性，不拆分
+    void ScatterKeys(const Command& command, const std::vector<Key>& keys, TransactionID tx_id, CommandCallback done);
+    
+    // 不带键的DBSIZE、FLUSHDB、INFO、SCRIPT：在所有分片上并行执行后合并
+    void BroadcastCommand(const Command& command, TransactionID tx_id, CommandCallback done);
+    
+    // 持迁移锁时同步执行迁移中的槽上的命令
+    Response ExecuteMigratingSlotCommand(const Command& command, const std::vector<Key>& keys, int slot,
+                                         int owner, int target, TransactionID tx_id);
+    
+    // 槽不由本节点的分片服务时的MOVED或CLUSTERDOWN错误
+    static Response SlotNotServed(int slot, int owner);
+    
+    // 子任务收到回调后开始执行，完成时调用回调一次
+    using SubTask = std::function<void(CommandCallback)>;
+    // 同时发起各子任务，最后一个完成的子任务按任务顺序把全部结果交给done，在其完成线程上运行
+    static void FanOut(std::vector<SubTask> tasks, std::function<void(std::vector<Response>&)> done);
+    
+    // 执行迁移任务队列中的一个槽迁移：用游标遍历源分片的存储引擎，每批把槽内的键编码为RDB数据，
+    // 作为RESTORE_BATCH命令经目标分片的Raft写入，再经源分片的Raft删除，最后切换槽。
+    // 中途失败时槽保持迁移状态，已搬走的键仍可经ASK访问
+    void RunSlotMigration(size_t task_index);
+    
     DKVServer* server_;         // 指向服务器实例
     
+    // 所有分片共享的Raft网络传输和Raft数据目录
+    std::shared_ptr<RaftTcpNetwork> raft_transport_;
+    std::string raft_data_dir_;
+    
     // 分片配置
     ShardConfig config_;
     mutable std::mutex config_mutex_;
@@ -226,7 +349,13 @@ private:
     
     // 一致性哈希实例
     std::unique_ptr<ConsistentHash<int>> consistent_hash_;
-    mutable std::mutex hash_mutex_;
+    mutable std::mutex hash_mutex_; // 串行化哈希环的更新，查询不需要
+    
+    // 哈希槽分配表
+    SlotTable slot_table_;
+    
+    // 迁移中的槽上的命令持读锁，迁移线程搬迁一批键时持写锁，命令不会看到搬了一半的键
+    std::shared_mutex slot_migration_mutex_;
     
     // 运行状态
     std::atomic<bool> is_running_;
@@ -237,8 +366,9 @@ private:
     // 迁移线程
     std::thread migration_thread_;
     
-    // 迁移任务队列
+    // 迁移任务队列，完成和失败的任务保留在队列中供GetMigrationTasks查询
     std::vector<ShardMigrationTask> migration_tasks_;
+    size_t next_migration_task_ = 0; // 下一个待执行的任务
     mutable std::mutex migration_mutex_;
     std::condition_variable migration_cv_;
     
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dkv {
+
+// 延迟直方图：按微秒数的二进制位数分桶，第i个桶记录[2^(i-1), 2^i)微秒的请求。
+// 记录只做一次原子加，分位数取所在桶的上界，误差在两倍以内
+class LatencyHistogram {
+public:
+    static constexpr int BUCKETS = 40;
+
+    void Record(uint64_t micros);
+
+    // 近似分位数（微秒），p取0到100；没有记录时返回0
+    uint64_t Percentile(double p) const;
+
+    uint64_t Count() const;
+
+    // 清空所有桶，开始新的统计窗口
+    void Reset();
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+};
+
+// 热点键统计，Space-Saving算法：最多跟踪capacity个键，新键替换计数最小的键并继承其计数，
+// 计数是频率的上界，频率超过总数1/capacity的键一定在其中。
+// Offer在锁被占用时直接放弃本次记录（相当于采样），命令路径上不会阻塞
+class HotKeySketch {
+public:
+    explicit HotKeySketch(size_t capacity = 64) : capacity_(capacity) {}
+
+    void Offer(std::string_view key);
+
+    // 按计数降序返回前k个键
+    std::vector<std::pair<std::string, uint64_t>> TopK(size_t k) const;
+
+    // 清空，开始新的统计窗口
+    void Reset();
+
+private:
+    struct Counter {
+        std::string key;
+        uint64_t count;
+    };
+
+    size_t capacity_;
+    std::vector<Counter> counters_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace dkv
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace dkv {
+
+// io_uring的最小封装，直接使用系统调用，不依赖liburing
+// 只应在一个线程中使用：提交队列和完成队列都没有加锁。
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // 创建ring并映射提交队列与完成队列
+    bool init(unsigned entries);
+    bool valid() const { return ring_fd_ >= 0; }
+
+    // 获取一个空闲的提交项，队列已满时先提交已有的提交项再获取
+    io_uring_sqe* getSqe();
+    // 提交所有待提交的提交项，wait_nr大于0时等待至少wait_nr个完成事件
+    int submitAndWait(unsigned wait_nr);
+
+    // 依次处理所有已到达的完成事件，返回处理的个数
+    template <typename F>
+    unsigned forEachCqe(F&& handler) {
+        unsigned head = cq_head_->load(std::memory_order_relaxed);
+        unsigned tail = cq_tail_->load(std::memory_order_acquire);
+        unsigned count = 0;
+        while (head != tail) {
+            handler(cqes_[head & cq_mask_]);
+            head++;
+            count++;
+            // 逐个推进，回调中产生的完成事件也能在本轮处理
+            cq_head_->store(head, std::memory_order_release);
+            if (head == tail) {
+                tail = cq_tail_->load(std::memory_order_acquire);
+            }
+        }
+        return count;
+    }
+
+    // 注册提供给内核的接收缓冲区环，count须为2的幂
+    bool setupBufferRing(uint16_t group, unsigned count, unsigned buffer_size);
+    char* buffer(uint16_t bid) const { return buffers_ + static_cast<size_t>(bid) * buffer_size_; }
+    // 数据处理完后把缓冲区还给内核
+    void recycleBuffer(uint16_t bid);
+
+    // 检查内核是否支持本后端用到的功能
+    static bool probe();
+
+private:
+    int ring_fd_ = -1;
+    io_uring_params params_{};
+
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    std::atomic<unsigned>* sq_head_ = nullptr;
+    std::atomic<unsigned>* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_tail_ = 0;  // 本地已填写的提交项位置，提交时同步给内核
+
+    std::atomic<unsigned>* cq_head_ = nullptr;
+    std::atomic<unsigned>* cq_tail_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned cq_mask_ = 0;
+
+    io_uring_buf_ring* buf_ring_ = nullptr;
+    size_t buf_ring_size_ = 0;
+    char* buffers_ = nullptr;
+    unsigned buffer_count_ = 0;
+    unsigned buffer_size_ = 0;
+    uint16_t buf_tail_ = 0;
+};
+
+} // namespace dkv
@@ -3,28 +3,83 @@
 #include "../dkv_core.hpp"
 #include "../storage/dkv_storage.hpp"
 #include "../net/dkv_resp.hpp"
+#include "../net/dkv_ring_buffer.hpp"
+#include "../net/dkv_io_uring.hpp"
 #include "../dkv_worker_pool.hpp"
+#include "../dkv_latency.hpp"
+#include "../dkv_mpsc_queue.hpp"
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/uio.h>
 #include <vector>
 #include <queue>
+#include <deque>
+#include <chrono>
 #include <thread>
 #include <condition_variable>
 #include <atomic>
+#include <functional>
 
 namespace dkv {
 
-// 客户端连接信息
+// 客户端输出缓冲区限制，0表示不限制
+// 待发送字节数超过hard_bytes立即断开；持续超过soft_bytes达soft_seconds秒后断开
+struct ClientOutputLimit {
+    size_t hard_bytes = 256 * 1024 * 1024;
+    size_t soft_bytes = 0;
+    uint64_t soft_seconds = 0;
+};
+
+// 网络IO后端
+enum class IoBackend {
+    EPOLL,      // epoll边沿触发，读写各自发起系统调用
+    IO_URING    // io_uring多次触发的accept/recv与批量提交的写
+};
+
+// 输出链中的一段数据。命令回复由连接独占；PUBLISH的消息只编码一次，
+// 所有订阅者的输出链引用同一块缓冲区，最后一个订阅者写完后释放
+class OutputChunk {
+public:
+    OutputChunk(std::string&& data) : owned_(std::move(data)) {}
+    OutputChunk(std::shared_ptr<const std::string> shared) : shared_(std::move(shared)) {}
+
+    const char* data() const { return shared_ ? shared_->data() : owned_.data(); }
+    size_t size() const { return shared_ ? shared_->size() : owned_.size(); }
+
+private:
+    std::string owned_;
+    std::shared_ptr<const std::string> shared_;
+};
+
+// 客户端连接信息，只在所属SubReactor的事件循环线程访问
 struct ClientConnection {
     int fd;
+    uint64_t id = 0;
     sockaddr_in addr;
-    std::string read_buffer;
-    std::string write_buffer;
+    RingBuffer read_buffer;
+    RESPStreamParser parser;
+    std::vector<std::string_view> parsed_args;  // 复用的参数视图
     bool connected;
+    // 同一连接同时最多一个任务在执行，执行期间解析出的命令暂存于此，保证按顺序执行和回复
+    bool in_flight = false;
+    std::vector<Command> pending_commands;
+    // 待发送的回复链，socket不可写时暂存于此，等待可写后继续写出
+    std::deque<OutputChunk> output_chain;
+    size_t output_offset = 0;   // 队首回复已写出的字节数
+    size_t output_bytes = 0;    // 待发送的总字节数
+    bool want_write = false;    // epoll后端：是否已注册EPOLLOUT
+    bool over_soft_limit = false;
+    std::chrono::steady_clock::time_point soft_limit_since;
+    // io_uring后端：同一连接同时最多一个写请求，msghdr和iovec在请求完成前须保持有效
+    bool send_in_flight = false;
+    struct msghdr send_msg{};
+    std::vector<struct iovec> send_iov;
+    // 连接断开时调用，用于取消阻塞中的命令。同一连接同时最多阻塞一条命令
+    std::function<void()> on_disconnect;
     
     ClientConnection(int socket_fd, const sockaddr_in& address) 
         : fd(socket_fd), addr(address), connected(true) {}
@@ -41,45 +96,249 @@ class DKVServer;
 class CommandTask;
 
 // 子Reactor，处理IO事件
+// 连接管理、命令解析与提交、回复排队等与IO方式无关的逻辑在基类中，
+// 事件循环、注册连接和写出回复由EpollSubReactor或IoUringSubReactor实现。
+// 连接状态只由事件循环线程访问，不加锁：其他线程（主Reactor、工作线程、发布者）把新连接、
+// 命令回复和推送数据放入无锁消息队列并唤醒事件循环，由事件循环线程依次处理。
 class SubReactor {
-private:
-    int epoll_fd_;
+protected:
+    // 其他线程交给事件循环线程处理的消息
+    struct ReactorMessage {
+        enum class Kind {
+            ADD_CLIENT,         // 主Reactor分配的新连接
+            REPLIES,            // 一批命令的回复，交付后提交该连接暂存的命令
+            PUSH,               // 不属于命令回复的数据
+            BROADCAST,          // 同一块数据推送给多个连接
+            DISCONNECT_HOOK     // 设置连接断开时的回调
+        };
+        Kind kind = Kind::PUSH;
+        int fd = -1;
+        uint64_t connection_id = 0;
+        sockaddr_in addr{};
+        std::string data;
+        std::shared_ptr<const std::string> shared;
+        std::vector<std::pair<int, uint64_t>> targets;
+        std::function<void()> hook;
+        uint64_t encode_us = 0;     // 工作线程编码回复的耗时
+        uint64_t trace_id = 0;      // 被追踪的批次的追踪ID
+    };
+
     std::atomic<bool> running_;
     std::thread event_loop_thread_;
-    std::unordered_map<int, std::unique_ptr<ClientConnection>> clients_;
-    std::mutex clients_mutex_;
-    std::queue<CommandTask> task_queue_;
-    std::mutex task_queue_mutex_;
+    // 按fd索引的连接表，只在事件循环线程访问
+    std::vector<std::unique_ptr<ClientConnection>> connections_;
+    MPSCQueue<ReactorMessage> mailbox_;
     WorkerThreadPool* worker_pool_;
+    size_t index_;  // 在NetworkServer中的编号，决定任务投递到哪组工作线程
+    std::atomic<uint64_t> next_connection_id_{1};
+    // 连接表中的连接数，事件循环线程修改后更新，供其他线程读取
+    std::atomic<size_t> connected_clients_{0};
+    ClientOutputLimit output_limit_;
+    // run-to-completion模式：在事件循环线程上直接执行命令，仅耗时命令交给工作线程池
+    bool run_to_completion_ = false;
+    // SO_REUSEPORT模式下本SubReactor自己的监听socket，-1表示由主Reactor分配连接
+    int listen_fd_ = -1;
+    std::vector<int> cpus_;  // 事件循环线程绑定的CPU，空表示不绑定
+    // 任一连接断开时调用，在事件循环线程上调用
+    std::function<void(SubReactor*, uint64_t)> disconnect_listener_;
+    // 记录解析和写出回复的耗时，为空时不记录
+    LatencyMonitor* latency_monitor_ = nullptr;
+
+    // 定时器最小堆，到期时间相同的按登记顺序触发
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t seq;
+        std::function<void()> callback;
+        bool operator>(const Timer& other) const {
+            return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+        }
+    };
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    uint64_t next_timer_seq_ = 0;
+    std::mutex timers_mutex_;
 
 public:
-    SubReactor(WorkerThreadPool* worker_pool);
-    ~SubReactor();
+    SubReactor(WorkerThreadPool* worker_pool, size_t index = 0);
+    virtual ~SubReactor();
+
+    // 按配置创建SubReactor，io_uring不可用时退回epoll
+    static std::unique_ptr<SubReactor> create(IoBackend backend, WorkerThreadPool* worker_pool, size_t index);
+
+    // 在start之前设置
+    void setClientOutputLimit(const ClientOutputLimit& limit) { output_limit_ = limit; }
+    void setRunToCompletion(bool enabled) { run_to_completion_ = enabled; }
+    void setCpuAffinity(const std::vector<int>& cpus) { cpus_ = cpus; }
+    void setDisconnectListener(std::function<void(SubReactor*, uint64_t)> listener) {
+        disconnect_listener_ = std::move(listener);
+    }
+    void setLatencyMonitor(LatencyMonitor* monitor) { latency_monitor_ = monitor; }
 
-    void setWorkerPool(WorkerThreadPool* worker_pool);
+    size_t index() const { return index_; }
+    // 当前连接数和累计接受的连接数，不获取锁
+    size_t connectedClients() const { return connected_clients_.load(std::memory_order_relaxed); }
+    uint64_t connectionsReceived() const { return next_connection_id_.load(std::memory_order_relaxed) - 1; }
+    // 用SO_REUSEPORT创建自己的监听socket，由内核在各SubReactor间分配新连接
+    bool listenOn(const sockaddr_in& addr);
     bool start();
     void stop();
-    int getEpollFd() const { return epoll_fd_; }
     
-    // 添加客户端连接到子Reactor
+    // 添加客户端连接到子Reactor，可在任意线程调用
     void addClient(int client_fd, const sockaddr_in& client_addr);
     
-    // 处理命令结果
-    void handleCommandResult(int client_fd, const Response& response);
+    // 处理一批命令的结果，合并写出后提交该连接暂存的命令。
+    // 可在任意线程调用：回复在调用线程上编码，其他线程调用时交给事件循环线程写出。
+    // trace_id非0时记录编码与写出阶段，见RequestTracer
+    void handleCommandResults(int client_fd, uint64_t connection_id, const std::vector<Response>& responses,
+                              uint64_t trace_id = 0);
+
+    // 向连接推送不属于任何命令回复的数据，如失效通知，连接已关闭时丢弃。可在任意线程调用
+    void pushToClient(int client_fd, uint64_t connection_id, std::string&& data);
+    // 向一批连接推送同一块数据，各连接的输出链共享该缓冲区。可在任意线程调用。
+    // 在事件循环线程调用时返回仍在连接中的连接数，其他线程调用时返回目标连接数
+    size_t pushToClients(const std::vector<std::pair<int, uint64_t>>& clients,
+                         const std::shared_ptr<const std::string>& data);
+
+    // 登记定时器，到期后在事件循环线程上调用callback，可在任意线程调用
+    void addTimer(std::chrono::steady_clock::time_point deadline, std::function<void()> callback);
+    // 设置连接断开时的回调，替换之前设置的回调；连接已断开时在事件循环线程上调用
+    void setDisconnectHook(int client_fd, uint64_t connection_id, std::function<void()> hook);
     
+protected:
+    virtual void eventLoop() = 0;
+    // 唤醒阻塞中的事件循环
+    virtual void wakeup() = 0;
+    // 开始接受监听socket上的连接，在start之前调用
+    virtual bool registerListener(int fd) = 0;
+    // 以下方法只在事件循环线程调用
+    // 开始接收新连接的数据
+    virtual bool registerClient(ClientConnection* client) = 0;
+    // 写出输出链，出错返回false
+    virtual bool flushOutput(ClientConnection* client) = 0;
+    // 移除并释放连接
+    virtual void handleClientDisconnect(int client_fd);
+
+    bool onEventLoopThread() const { return std::this_thread::get_id() == event_loop_thread_.get_id(); }
+    // fd对应的连接，不存在时返回nullptr
+    ClientConnection* findClient(int client_fd) const {
+        return client_fd >= 0 && static_cast<size_t>(client_fd) < connections_.size()
+            ? connections_[client_fd].get() : nullptr;
+    }
+    // fd对应且id相同的连接，连接已关闭或fd已被新连接复用时返回nullptr
+    ClientConnection* findClient(int client_fd, uint64_t connection_id) const {
+        ClientConnection* client = findClient(client_fd);
+        return client && client->id == connection_id ? client : nullptr;
+    }
+    // 把消息交给事件循环线程，队列原本为空时唤醒事件循环
+    void post(ReactorMessage&& message);
+    // 处理其他线程交来的全部消息，事件循环每一轮调用一次
+    void drainMailbox();
+    void acceptClient(int client_fd, const sockaddr_in& client_addr);
+    void deliverReplies(int client_fd, uint64_t connection_id, std::string&& replies, uint64_t encode_us,
+                        uint64_t trace_id);
+    size_t deliverBroadcast(const std::vector<std::pair<int, uint64_t>>& clients,
+                            const std::shared_ptr<const std::string>& data);
+    void applyDisconnectHook(int client_fd, uint64_t connection_id, std::function<void()>&& hook);
+    // 解析缓冲区中的完整命令并提交，协议错误时断开连接并返回false
+    bool processClientBuffer(int client_fd, ClientConnection* client);
+    // 提交一批命令
+    void dispatchCommands(ClientConnection* client, std::vector<Command>&& commands, uint64_t trace_id = 0);
+    // run-to-completion模式下该批命令能否在事件循环线程上直接执行：耗时命令和估计开销达到慢命令阈值的命令交给工作线程池
+    bool canExecuteInline(const std::vector<Command>& commands) const;
+    // 按写出的字节数推进输出链
+    static void consumeOutput(ClientConnection* client, size_t written);
+    // 检查输出缓冲区是否超出限制
+    bool exceedsOutputLimit(ClientConnection* client);
+    // 把数据追加到输出链并尝试写出，出错或超出限制时关闭连接并返回false
+    bool appendOutput(int client_fd, ClientConnection* client, OutputChunk&& data);
+    static bool setNonBlocking(int fd);
+    // 最近的定时器到期时间，没有定时器时返回time_point::max()
+    std::chrono::steady_clock::time_point nextTimerDeadline();
+    // 事件循环等待的毫秒数，不超过max_wait_ms，且不晚于最近的定时器到期
+    int timerWaitMs(int max_wait_ms);
+    // 在事件循环线程上调用所有已到期的定时器
+    void runExpiredTimers();
+};
+
+// 基于epoll的SubReactor
+class EpollSubReactor : public SubReactor {
+private:
+    int epoll_fd_;
+    int wakeup_fd_ = -1;  // 其他线程投递消息、登记定时器或停止事件循环时写入
+
+public:
+    EpollSubReactor(WorkerThreadPool* worker_pool, size_t index = 0);
+    ~EpollSubReactor() override;
+
+protected:
+    void eventLoop() override;
+    void wakeup() override;
+    bool registerListener(int fd) override;
+    bool registerClient(ClientConnection* client) override;
+    // 用writev尽量写出输出链，写不完时注册EPOLLOUT
+    bool flushOutput(ClientConnection* client) override;
+    void handleClientDisconnect(int client_fd) override;
+
 private:
-    void eventLoop();
+    // 接受自己监听socket上的新连接
+    void acceptClients();
     void handleClientData(int client_fd);
-    void handleClientDisconnect(int client_fd);
-    void handleClientDisconnect_locked(int client_fd);
-    void sendResponse(int client_fd, const Response& response);
-    bool setNonBlocking(int fd);
+    // socket可写时继续写出输出链
+    void handleClientWritable(int client_fd);
     bool addEpollEvent(int fd, uint32_t events);
     bool modifyEpollEvent(int fd, uint32_t events);
     bool removeEpollEvent(int fd);
 };
 
+// 基于io_uring的SubReactor
+// 监听socket与每个连接各挂一个多次触发的accept/recv请求，数据写入内核从缓冲区环中选取的缓冲区，
+// 写请求在事件循环每一轮统一提交，一次io_uring_enter同时完成提交与等待。
+// 提交队列与连接一样只由事件循环线程操作。
+class IoUringSubReactor : public SubReactor {
+private:
+    IoUring ring_;
+    int wakeup_fd_ = -1;
+    uint64_t wakeup_value_ = 0;              // eventfd读请求的目标
+    std::atomic<bool> wakeup_pending_{false};
+    // 为最近的定时器发起的超时请求，只在事件循环线程访问
+    struct __kernel_timespec timer_ts_{};
+    std::chrono::steady_clock::time_point timer_armed_ = std::chrono::steady_clock::time_point::max();
+
+    // 已断开但写请求仍未完成的连接，写请求完成后释放，只在事件循环线程访问
+    std::unordered_map<int, std::unique_ptr<ClientConnection>> closing_;
+
+public:
+    IoUringSubReactor(WorkerThreadPool* worker_pool, size_t index = 0);
+    ~IoUringSubReactor() override;
 
+    // 创建ring和接收缓冲区环，失败时不能使用
+    bool init();
+
+protected:
+    void eventLoop() override;
+    void wakeup() override;
+    bool registerListener(int fd) override;
+    bool registerClient(ClientConnection* client) override;
+    // 发起写请求，上一个写请求未完成时由其完成后接着写出
+    bool flushOutput(ClientConnection* client) override;
+    void handleClientDisconnect(int client_fd) override;
+
+private:
+    void handleCompletion(const io_uring_cqe& cqe);
+    void handleAccept(const io_uring_cqe& cqe);
+    void handleRecv(const io_uring_cqe& cqe);
+    void handleSend(const io_uring_cqe& cqe);
+    void armAccept();
+    void armWakeup();
+    // 最近的定时器早于已发起的超时请求时发起新的超时请求
+    void armTimer();
+    bool armRecv(ClientConnection* client);
+    // poll_first为true时内核先等待socket可写再发送
+    bool submitSend(ClientConnection* client, bool poll_first = false);
+    // 停止前等待进行中的写请求结束，避免内核访问已释放的输出链
+    void drainSends();
+    // 找到user_data对应的连接，连接已关闭或fd被复用时返回nullptr
+    ClientConnection* findRequestClient(uint64_t user_data);
+};
 
 // 网络服务器
 class NetworkServer {
@@ -88,6 +347,8 @@ private:
     int epoll_fd_;
     sockaddr_in server_addr_;
     std::atomic<bool> running_;
+    // 每个SubReactor各自监听同一端口，不使用主Reactor
+    bool reuseport_ = false;
     
     // 多线程Reactor相关
     std::vector<std::unique_ptr<SubReactor>> sub_reactors_;
@@ -96,7 +357,8 @@ private:
     std::thread main_event_loop_thread_;
     
 public:
-    NetworkServer(WorkerThreadPool* worker_pool, int port = 6379, size_t num_sub_reactors = 4);
+    NetworkServer(WorkerThreadPool* worker_pool, int port = 6379, size_t num_sub_reactors = 4,
+                  IoBackend backend = IoBackend::EPOLL);
     ~NetworkServer();
     
     // 启动和停止服务器
@@ -106,6 +368,28 @@ public:
     // 设置DKV服务器
     void setDKVServer(DKVServer* server);
 
+    // 设置客户端输出缓冲区限制，在start之前调用
+    void setClientOutputLimit(const ClientOutputLimit& limit);
+
+    // 设置是否在SubReactor线程上直接执行命令，在start之前调用
+    void setRunToCompletion(bool enabled);
+
+    // 设置是否由各SubReactor通过SO_REUSEPORT各自接受连接，在start之前调用
+    void setReusePort(bool enabled) { reuseport_ = enabled; }
+
+    // 设置各SubReactor线程绑定的CPU，在start之前调用
+    void setReactorCpus(const std::vector<std::vector<int>>& cpus);
+
+    // 设置连接断开时的回调，在start之前调用
+    void setDisconnectListener(const std::function<void(SubReactor*, uint64_t)>& listener);
+
+    // 设置记录解析和写出耗时的统计，在start之前调用
+    void setLatencyMonitor(LatencyMonitor* monitor);
+
+    size_t reactorCount() const { return sub_reactors_.size(); }
+    const SubReactor& reactor(size_t index) const { return *sub_reactors_[index]; }
+    SubReactor& reactor(size_t index) { return *sub_reactors_[index]; }
+
 private:
     // 初始化服务器
     bool initializeServer(int port);
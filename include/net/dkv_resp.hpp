@@ -2,6 +2,7 @@
 
 #include "../dkv_core.hpp"
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace dkv {
@@ -15,14 +16,72 @@ enum class RESPType {
     ARRAY = '*'           // *
 };
 
+// 增量RESP命令解析器
+// 每次传入连接缓冲区中全部未读数据（起点不变、只在末尾增长），已解析的参数和位置跨调用保留，
+// 数据不完整时下次从中断处继续，不重复扫描。解析完成时args为指向data的视图，
+// 调用方处理完后丢弃consumed()字节再继续解析下一条命令。
+class RESPStreamParser {
+public:
+    enum class Result {
+        COMPLETE,    // 解析出一条命令，args可能为空（空行或空数组）
+        INCOMPLETE,  // 需要更多数据
+        ERROR        // 协议错误，连接应当关闭
+    };
+
+    // 单个批量字符串的最大长度
+    static constexpr int64_t MAX_BULK_LEN = 512LL * 1024 * 1024;
+    // 单条命令的最大参数个数
+    static constexpr int64_t MAX_MULTIBULK_LEN = 1024 * 1024;
+    // 内联命令的最大长度
+    static constexpr size_t MAX_INLINE_LEN = 64 * 1024;
+
+    Result parse(std::string_view data, std::vector<std::string_view>& args);
+    // 上一条完整命令占用的字节数
+    size_t consumed() const { return consumed_; }
+    const std::string& error() const { return error_; }
+    void reset();
+    // 内联命令按空格切分参数，忽略连续空格
+    static void splitInline(std::string_view line, std::vector<std::string_view>& args);
+
+private:
+    enum class State { START, INLINE, MULTIBULK };
+
+    Result parseInline(std::string_view data, std::vector<std::string_view>& args);
+    Result parseMultibulk(std::string_view data, std::vector<std::string_view>& args);
+    Result fail(const char* message);
+    // 在data[from, ...)中查找CRLF，找不到返回npos
+    static size_t findCRLF(std::string_view data, size_t from);
+    static bool parseLength(std::string_view text, int64_t& value);
+
+    State state_ = State::START;
+    size_t pos_ = 0;              // 已扫描到的位置
+    int64_t multibulk_len_ = 0;   // 命令参数个数
+    int64_t bulk_len_ = -1;       // 当前批量字符串长度，-1表示尚未读取长度行
+    std::vector<std::pair<size_t, size_t>> slices_;  // 已解析参数的偏移和长度
+    size_t consumed_ = 0;
+    std::string error_;
+};
+
 // RESP协议解析器
 class RESPProtocol {
 public:
+    // 共享的常量回复，直接追加到输出缓冲区，不需要分配
+    static constexpr std::string_view OK_REPLY = "+OK\r\n";
+    static constexpr std::string_view NULL_REPLY = "$-1\r\n";
+    static constexpr std::string_view ZERO_REPLY = "$1\r\n0\r\n";
+    static constexpr std::string_view ONE_REPLY = "$1\r\n1\r\n";
+
+    // 由参数视图构造命令，每个参数只复制一次
+    static Command buildCommand(const std::vector<std::string_view>& args);
+
+
     // 解析命令
-    static Command parseCommand(const std::string& data, size_t& pos);
-    static Command parseCommand(const std::string& data, size_t&& pos) {
+    static Command parseCommand(std::string_view data, size_t& pos);
+    static Command parseCommand(std::string_view data, size_t&& pos) {
         return parseCommand(data, pos);
     }
+    // 解析一行内联命令，行结束符可以省略
+    static Command parseInlineCommand(std::string_view line);
     // 序列化响应
     static std::string serializeResponse(const Response& response);
     
@@ -43,19 +102,40 @@ public:
     
     // 序列化空值
     static std::string serializeNull();
+};
+
+// RESP回复编码器，直接追加到调用方的缓冲区，不为单个回复或数组元素构造临时字符串
+class RESPWriter {
+public:
+    explicit RESPWriter(std::string& out) : out_(out) {}
+
+    void writeSimpleString(std::string_view str);
+    void writeError(std::string_view error);
+    void writeInteger(int64_t value);
+    // 空串按空值编码，与serializeBulkString一致
+    void writeBulkString(std::string_view str);
+    void writeNull() { out_.append(RESPProtocol::NULL_REPLY); }
+    void writeArray(const std::vector<std::string>& array);
+    // 只按状态编码，与serializeResponse一致
+    void writeStatus(const Response& response);
+    // 按服务器的回复格式编码命令执行结果：有数据时返回批量字符串，数组回复编码后作为批量字符串返回
+    void writeResponse(const Response& response);
+    // CLIENT TRACKING的失效通知，RESP3推送类型：>2 invalidate [key ...]；keys为nullptr时编码为空值，表示清空全部缓存
+    void writeInvalidation(const std::vector<std::string>* keys);
+    // 发布的消息，RESP3推送类型：>3 message channel payload；pattern不为空时为 >4 pmessage pattern channel payload
+    void writePubSubMessage(const std::string* pattern, std::string_view channel, std::string_view message);
+
+    // 编码后的字节数
+    static size_t bulkStringSize(std::string_view str);
+    static size_t arraySize(const std::vector<std::string>& array);
 
 private:
-    // 解析数组
-    static std::vector<std::string> parseArray(const std::string& data, size_t& pos);
-    
-    // 解析批量字符串
-    static std::string parseBulkString(const std::string& data, size_t& pos);
-    
-    // 跳过CRLF
-    static void skipCRLF(const std::string& data, size_t& pos);
-    
-    // 读取直到CRLF
-    static std::string readUntilCRLF(const std::string& data, size_t& pos);
+    // 写入类型前缀、十进制长度和CRLF
+    void writeHeader(char prefix, int64_t value);
+    // 写入数组，调用方已预留空间
+    void writeArrayElements(const std::vector<std::string>& array);
+
+    std::string& out_;
 };
 
 } // namespace dkv
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace dkv {
+
+// 连接读缓冲区
+// 读写指针在同一块内存中循环推进，数据读完后指针归零；可写空间用尽时把未读数据移回开头，
+// 保证每条未解析的命令在内存中连续，解析器可以直接返回指向缓冲区的视图。
+// 内存在第一次写入时分配，为大请求扩容后在数据读完时释放。
+class RingBuffer {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 16 * 1024;
+
+    explicit RingBuffer(size_t initial_capacity = DEFAULT_CAPACITY);
+
+    // 未读数据，视图在下一次写入或消费前有效
+    std::string_view readable() const { return std::string_view(data_.get() + head_, tail_ - head_); }
+    size_t size() const { return tail_ - head_; }
+    bool empty() const { return head_ == tail_; }
+    size_t capacity() const { return capacity_; }
+
+    // 准备至少min_bytes的连续可写空间，返回写入位置
+    char* prepareWrite(size_t min_bytes);
+    // 当前连续可写空间大小
+    size_t writableBytes() const { return capacity_ - tail_; }
+    // 确认写入n字节
+    void commitWrite(size_t n) { tail_ += n; }
+    // 追加数据
+    void append(const char* data, size_t len);
+    // 丢弃开头n字节已处理的数据
+    void consume(size_t n);
+
+private:
+    std::unique_ptr<char[]> data_;
+    size_t capacity_ = 0;
+    size_t initial_capacity_;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+};
+
+} // namespace dkv
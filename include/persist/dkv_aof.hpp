@@ -2,6 +2,8 @@
 #define DKV_AOF_HPP
 
 #include "dkv_core.hpp"
+#include "dkv_mpmc_queue.hpp"
+#include "dkv_latency.hpp"
 #include <fstream>
 #include <string>
 #include <mutex>
@@ -13,7 +15,31 @@ namespace dkv {
 class DKVServer;
 class StorageEngine;
 
+// AOF清单中的一个文件
+struct AOFFileInfo {
+    enum class Type : char {
+        BASE = 'b', // 基础文件，RDB格式（旧版单文件AOF升级时为RESP格式）
+        INCR = 'i'  // 增量文件，RESP格式的命令日志
+    };
+    std::string name; // 文件名，相对于清单所在目录
+    uint64_t seq = 0;
+    Type type = Type::INCR;
+};
+
+// AOF清单：一个基础文件加按顺序排列的增量文件
+struct AOFManifest {
+    AOFFileInfo base;                  // name为空表示没有基础文件
+    std::vector<AOFFileInfo> incrs;    // 按序号升序，最后一个是当前追加的文件
+};
+
 // AOF文件操作相关类
+// 多文件布局：清单（<filename>.manifest）列出基础文件和增量文件。
+// 加载时先用RDB加载器批量恢复基础文件，再按顺序重放增量文件中的命令。
+// 工作线程把命令序列化后放入无锁追加缓冲区，由专门的写线程批量取出，一次write写入当前增量文件。
+// ALWAYS策略下写线程每批调用一次fdatasync（组提交），调用方阻塞到所在批次落盘后才返回，
+// 多个工作线程的命令共享一次fdatasync，不再各自串行刷盘。
+// 重写时先切换到新的增量文件，再按MVCC读取视图把快照保存为新的RDB基础文件，
+// 完成后原子替换清单并删除旧文件；重写期间的追加直接写入新增量文件，不需要额外缓冲。
 class AOFPersistence {
 public:
     // AOF持久化策略
@@ -25,11 +51,11 @@ public:
 
     AOFPersistence();
     ~AOFPersistence();
-    
+
     // 设置服务器引用
     void setServer(DKVServer* server);
 
-    // 初始化AOF文件
+    // 初始化AOF文件：读取清单并打开当前增量文件；没有清单时把旧版单文件AOF作为基础文件升级
     bool initialize(const std::string& filename, FsyncPolicy fsync_policy = FsyncPolicy::EVERYSEC);
 
     // 关闭AOF文件
@@ -37,19 +63,26 @@ public:
 
     // 写入命令到AOF文件
     bool appendCommand(const Command& command);
+    // 写入一个事务的命令，多条命令用MULTI/EXEC包围作为一条记录，重放时全部执行或全部丢弃
     bool appendCommands(const std::vector<Command>& commands);
 
     // 从AOF文件恢复数据
     bool loadFromFile(DKVServer* server);
 
-    // 执行AOF重写
-    bool rewrite(StorageEngine* storage_engine, const std::string& temp_filename);
-    
+    // 执行AOF重写，不阻塞命令执行；已有重写在进行时返回false
+    bool rewrite(StorageEngine* storage_engine);
+
     // 异步执行AOF重写
     void asyncRewrite(DKVServer* server);
 
     // 获取AOF当前状态
     bool isEnabled() const { return enabled_; }
+    bool isRewriting() const { return rewriting_; }
+    // 每次fdatasync的耗时（微秒）
+    const HdrHistogram& fsyncLatency() const { return fsync_latency_; }
+
+    // 设置重写每秒最多写入的字节数，0表示不限速
+    void setRewriteRateLimit(size_t bytes_per_sec) { rewrite_rate_limit_ = bytes_per_sec; }
 
     // 设置自动重写参数
     void setAutoRewriteParams(double percentage, size_t min_size_mb);
@@ -57,53 +90,116 @@ public:
     // 检查是否需要自动重写
     bool shouldRewrite();
 
-    // 获取当前AOF文件大小
+    // 获取当前AOF文件总大小（基础文件与全部增量文件）
     size_t getFileSize();
 
+    // 清单文件路径与当前清单中文件的路径
+    std::string getManifestFilename() const { return filename_ + ".manifest"; }
+    std::string getBaseFilename();
+    std::string getIncrFilename();
+
+    // 追加缓冲区容量（条目数）
+    static constexpr size_t APPEND_BUFFER_CAPACITY = 16384;
+    // 写线程每批最多合并的条目数
+    static constexpr size_t WRITE_BATCH_ENTRIES = 1024;
+    // 并行重放时每批分组的命令数，达到后等待本批重放完再继续解析，限制内存占用
+    static constexpr size_t REPLAY_BATCH_COMMANDS = 65536;
+    // 重放时每次提示内核预读的字节数
+    static constexpr size_t REPLAY_PREFETCH_BYTES = 8 * 1024 * 1024;
+
 private:
+    // 等待所在批次落盘的调用方，位于调用方栈上，由sync_mutex_保护
+    struct SyncWaiter {
+        bool done = false;
+        bool ok = false;
+    };
+    // 追加缓冲区条目：序列化后的RESP文本，ALWAYS策略下附带等待者
+    struct AppendEntry {
+        std::string data;
+        SyncWaiter* waiter = nullptr;
+    };
+
     // 服务器引用
     DKVServer* server_;
     // AOF文件相关
-    std::ofstream aof_file_;
+    int aof_fd_;
     std::string filename_;
-    bool enabled_, recovering; 
-    std::mutex file_mutex_; // 保护文件操作
+    AOFManifest manifest_;   // 当前清单，由file_mutex_保护
+    std::atomic<bool> enabled_;
+    bool recovering;
+    std::mutex file_mutex_; // 保护文件描述符与清单
 
     // Fsync策略
     FsyncPolicy fsync_policy_;
     std::atomic<Timestamp> last_fsync_time_;
-    
-    // 后台fsync线程相关
-    std::thread bg_fsync_thread_;
+    bool dirty_; // 有已写入但未fdatasync的数据，只由写线程访问
+    HdrHistogram fsync_latency_;
+
+    // 追加缓冲区与写线程
+    BoundedMPMCQueue<AppendEntry> append_buffer_;
+    std::thread writer_thread_;
     std::atomic<bool> running_;
-    
+    std::atomic<bool> writer_sleeping_;
+    std::mutex writer_mutex_;
+    std::condition_variable writer_cv_;
+
+    // 批次落盘通知
+    std::mutex sync_mutex_;
+    std::condition_variable sync_cv_;
+
+    // 重写相关
+    std::atomic<bool> rewriting_;
+    std::thread rewrite_thread_;
+    std::atomic<size_t> rewrite_rate_limit_;
+
     // 后台重写检查线程相关
     std::thread bg_rewrite_check_thread_;
     std::atomic<bool> rewrite_check_running_;
     std::condition_variable rewrite_check_cv_;
     std::mutex rewrite_check_mutex_;
-    
+
     // 自动重写相关参数
     double auto_rewrite_percentage_;  // 自动重写百分比阈值
     size_t auto_rewrite_min_size_mb_; // 自动重写最小文件大小(MB)
     size_t last_rewrite_size_;        // 上次重写后的文件大小(字节)
 
-    // 同步文件到磁盘
-    void fsyncIfNeeded();
-
-    // 将命令序列化为RESP格式并写入文件
-    bool writeCommandToFile(const Command& command);
+    // 将命令序列化为RESP格式
+    static std::string serializeCommand(const Command& command);
+
+    // 放入追加缓冲区，ALWAYS策略下等待所在批次落盘
+    bool enqueue(std::string data);
+    void wakeWriter();
+
+    // 写线程函数
+    void writerThreadFunc();
+    // 取出一批条目写入文件，缓冲区为空时返回false
+    bool writeNextBatch(std::string& batch, std::vector<SyncWaiter*>& waiters);
+    // 写入文件，sync为true时随后调用fdatasync
+    bool writeToFile(const std::string& data, bool sync);
+    // EVERYSEC策略下距上次fdatasync超过一秒时刷盘
+    void syncIfDue();
+    // 写入全部数据，处理部分写入与EINTR
+    static bool writeAll(int fd, const char* data, size_t size);
+
+    // 清单中文件名对应的路径
+    std::string pathOf(const std::string& name) const;
+    // 解析清单文件，格式错误时返回false
+    bool readManifest(AOFManifest& manifest) const;
+    // 写入临时文件、fsync后rename替换清单，并同步所在目录
+    bool persistManifest(const AOFManifest& manifest) const;
+    // 打开增量文件用于追加
+    int openIncrFile(const AOFFileInfo& info) const;
+
+    // 切换到新的增量文件，再按读取视图保存RDB基础文件并替换清单
+    bool doRewrite(StorageEngine* storage_engine);
+
+    // 重放RESP格式文件中的命令，单键命令按分段并行重放
+    bool replayFile(DKVServer* server, const std::string& path);
 
-    // 解析AOF文件中的命令
-    Command parseCommandFromFile(std::ifstream& file);
-    
-    // 后台fsync线程函数
-    void bgFsyncThreadFunc();
-    
     // 后台重写检查线程函数
     void bgRewriteCheckThreadFunc();
 };
 
 } // namespace dkv
 
-#endif // DKV_AOF_HPP
\ No newline at end of file
+#endif // DKV_AOF_HPP
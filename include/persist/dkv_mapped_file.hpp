@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace dkv {
+
+// 只读映射的持久化文件，加载RDB/AOF时直接在映射内存上解析，不再经过ifstream的逐次小读取。
+// 映射后提示内核按顺序预读；无法映射时（如特殊文件系统）退回一次性读入内存，接口不变。
+// 映射期间文件不应被截断，调用方只在加载阶段使用。
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 打开并映射文件，失败时返回false
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+    // 提示内核异步预读[offset, offset + length)，超出文件的部分被忽略
+    void prefetch(size_t offset, size_t length) const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;     // data_指向mmap映射，否则指向fallback_
+    std::string fallback_;
+};
+
+// 内存中二进制数据的顺序读取游标，越界时置为失败状态，之后的读取都返回空值
+class ByteReader {
+public:
+    explicit ByteReader(std::string_view data) : data_(data) {}
+
+    // 读取本机字节序的定长整数
+    template <typename T>
+    T read() {
+        T value{};
+        if (!ok_ || data_.size() - pos_ < sizeof(T)) {
+            ok_ = false;
+            return value;
+        }
+        std::memcpy(&value, data_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    // 读取length字节，返回指向原数据的视图，不复制
+    std::string_view readBytes(size_t length) {
+        if (!ok_ || data_.size() - pos_ < length) {
+            ok_ = false;
+            return std::string_view();
+        }
+        std::string_view bytes = data_.substr(pos_, length);
+        pos_ += length;
+        return bytes;
+    }
+
+    void seek(size_t pos) {
+        if (pos > data_.size()) {
+            ok_ = false;
+            return;
+        }
+        pos_ = pos;
+    }
+
+    void fail() { ok_ = false; }
+    bool ok() const { return ok_; }
+    explicit operator bool() const { return ok_; }
+    size_t position() const { return pos_; }
+    size_t remaining() const { return data_.size() - pos_; }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+} // namespace dkv
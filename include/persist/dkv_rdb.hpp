@@ -1,51 +1,117 @@
 #pragma once
 
 #include "dkv_core.hpp"
+#include "persist/dkv_mapped_file.hpp"
 #include "storage/dkv_storage.hpp"
+#include "transaction/dkv_transaction.hpp"
+#include <atomic>
 #include <fstream>
+#include <memory>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace dkv {
 
 // RDB文件格式的魔数和版本号
-constexpr const char* RDB_MAGIC_STRING = "REDIS0009";
-constexpr uint32_t RDB_VERSION = 9;
+// 版本9为顺序格式：文件头 | 键值对数量 | 键值对...，只能单线程顺序读取，仍支持加载
+// 版本10为分块格式：文件头 | 数据块... | 块索引 | 索引偏移(8字节) | 块数量(8字节)
+// 每个数据块由同一分段的若干键值对组成（编码与版本9相同），可以独立解析；
+// 块索引记录每块的偏移、长度、键数和CRC32校验和，保存和加载都按块分给多个线程并行处理
+// 版本11在版本号后记录压缩算法（RDBCompression），每个数据块单独压缩，块索引增加原始长度；
+// 压缩后不比原数据小的块按原样保存（长度等于原始长度）。校验和针对文件中保存的字节，解压前即可校验
+// 版本12在块索引之前写入键索引：每个数据块的各个键按块内顺序各有一个32位指纹（键的CRC32），
+// 块索引项增加该块指纹的偏移。后台加载时据此找到键所在的数据块，不必先解析数据块
+constexpr const char* RDB_LEGACY_MAGIC_STRING = "REDIS0009";
+constexpr uint32_t RDB_LEGACY_VERSION = 9;
+constexpr const char* RDB_UNCOMPRESSED_MAGIC_STRING = "REDIS0010";
+constexpr uint32_t RDB_UNCOMPRESSED_VERSION = 10;
+constexpr const char* RDB_COMPRESSED_MAGIC_STRING = "REDIS0011";
+constexpr uint32_t RDB_COMPRESSED_VERSION = 11;
+constexpr const char* RDB_MAGIC_STRING = "REDIS0012";
+constexpr uint32_t RDB_VERSION = 12;
+// 每个数据块最多包含的键数
+constexpr size_t RDB_KEYS_PER_CHUNK = 4096;
+
+// 块索引项
+struct RDBChunkInfo {
+    uint64_t offset = 0; // 数据块在文件中的偏移
+    uint64_t length = 0; // 数据块字节数
+    uint64_t keys = 0;   // 数据块中的键数
+    uint32_t crc = 0;    // 数据块内容的CRC32校验和
+    uint64_t raw_length = 0; // 压缩前的字节数，与length相等表示未压缩
+    uint64_t key_index_offset = 0; // 该块键指纹在文件中的偏移，每个键4字节（版本12）
+};
 
 class StorageEngine;
 
 // RDB文件操作相关函数
 class RDBPersistence {
 public:
-    // 将存储引擎的数据保存到RDB文件
-    static bool saveToFile(StorageEngine* storage_engine, const std::string& filename);
+    // 将存储引擎中read_view可见的数据以分块格式保存到RDB文件。
+    // 多个线程各自认领分段，在分段读锁内分批序列化到内存，释放锁后把数据块追加到文件；
+    // 先写入临时文件，完成后重命名为filename。saved_keys非空时累加已写入的键数；
+    // max_bytes_per_sec非0时限制写入速度（AOF重写生成基础文件时使用）
+    static bool saveToFile(StorageEngine* storage_engine, const std::string& filename, const ReadView& read_view,
+                           std::atomic<uint64_t>* saved_keys = nullptr, size_t max_bytes_per_sec = 0);
+    // 以相同格式写入任意输出流（内存缓冲区、文件或套接字），只顺序写入，不要求流支持定位
+    static bool saveToStream(StorageEngine* storage_engine, std::ostream& out, const ReadView& read_view,
+                             std::atomic<uint64_t>* saved_keys = nullptr, size_t max_bytes_per_sec = 0);
     
-    // 从RDB文件加载数据到存储引擎
+    // 从RDB文件加载数据到存储引擎。分块格式先由多个线程并行读取、校验和解析数据块，
+    // 按目标分段归类后每个线程批量写入各自负责的分段；任一数据块校验失败时不写入任何数据
     static bool loadFromFile(StorageEngine* storage_engine, const std::string& filename);
+    // 直接从内存中的RDB数据加载（如RAFT快照），name只用于日志
+    static bool loadFromMemory(StorageEngine* storage_engine, std::string_view data, const std::string& name);
+    
+    // 分片迁移的批量数据：顺序格式（版本9）的RDB数据，由loadFromMemory追加写入目标存储引擎，不清空已有数据。
+    // 先用writeBatchItem把键值对逐个写入items，再由finishBatch加上文件头和键数
+    static void writeBatchItem(std::ostream& items, std::string_view key, const DataItem& item);
+    static std::string finishBatch(const std::string& items, size_t count);
+    
+    // 读取分块格式（版本10至12）的文件头和块索引，version为文件的版本号；顺序格式或格式错误时返回false
+    static bool readChunkIndex(std::string_view file, const std::string& name, uint32_t& version,
+                               std::vector<RDBChunkInfo>& chunks);
+    // 校验、解压并解析一个数据块，追加到items，保存后已过期的键跳过。buffer用于解压，可在多次调用间复用
+    static bool parseChunk(std::string_view file, const RDBChunkInfo& info, Timestamp now, std::string& buffer,
+                           std::vector<std::pair<Key, std::unique_ptr<DataItem>>>& items);
+    // 键在键索引中的指纹
+    static uint32_t keyFingerprint(std::string_view key);
     
 private:
     // 写入RDB文件头部
-    static bool writeHeader(std::ofstream& file);
+    static bool writeHeader(std::ostream& file, RDBCompression compression);
     
     // 写入单个键值对
-    static bool writeKeyValue(std::ofstream& file, const Key& key, DataItem* item);
+    static void writeKeyValue(std::ostream& file, std::string_view key, const DataItem& item);
+    
+    // 读取RDB文件头部，返回版本号，格式错误时返回0
+    static uint32_t readHeader(ByteReader& reader);
     
-    // 读取RDB文件头部
-    static bool readHeader(std::ifstream& file);
+    // 加载顺序格式（版本9）
+    static bool loadLegacy(ByteReader& reader, StorageEngine* storage_engine);
+    // 加载分块格式（版本10至12），file为整个文件的内容
+    static bool loadChunked(std::string_view file, const std::string& filename, const std::vector<RDBChunkInfo>& chunks,
+                            StorageEngine* storage_engine);
     
-    // 读取单个键值对
-    static bool readKeyValue(std::ifstream& file, StorageEngine* storage_engine);
+    // 读取单个键值对并逐条写入存储引擎（版本9）
+    static bool readKeyValue(ByteReader& reader, StorageEngine* storage_engine);
+    // 解析单个键值对为数据项，不支持的类型返回false
+    static bool readItem(ByteReader& reader, Key& key, std::unique_ptr<DataItem>& item);
     
     // 写入字符串（长度前缀）
-    static void writeString(std::ofstream& file, const std::string& str);
+    static void writeString(std::ostream& file, std::string_view str);
     
-    // 读取字符串（长度前缀）
-    static std::string readString(std::ifstream& file);
+    // 读取字符串（长度前缀），直接由映射中的字节构造
+    static std::string readString(ByteReader& reader);
     
     // 写入整数
-    static void writeInt(std::ofstream& file, int64_t value);
+    static void writeInt(std::ostream& file, int64_t value);
     
     // 读取整数
-    static int64_t readInt(std::ifstream& file);
+    static int64_t readInt(ByteReader& reader);
 };
 
 } // namespace dkv
\ No newline at end of file
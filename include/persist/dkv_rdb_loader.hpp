@@ -0,0 +1,99 @@
+#pragma once
+
+#include "dkv_core.hpp"
+#include "persist/dkv_mapped_file.hpp"
+#include "persist/dkv_rdb.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dkv {
+
+class StorageEngine;
+
+// RDB后台加载进度
+struct RDBLoadStats {
+    bool loading = false;          // 是否还有数据块未载入
+    uint64_t total_chunks = 0;     // 文件中的数据块数
+    uint64_t loaded_chunks = 0;    // 已载入的数据块数
+    uint64_t demand_chunks = 0;    // 其中因命令访问而提前载入的数据块数
+    uint64_t failed_chunks = 0;    // 校验或解析失败而跳过的数据块数
+    uint64_t total_keys = 0;       // 文件中的键数
+    uint64_t loaded_keys = 0;      // 已载入的数据块中的键数，含保存后已过期而跳过的键
+    uint64_t elapsed_ms = 0;       // 开始加载至今（加载完成后为总耗时）的毫秒数
+};
+
+// 后台加载RDB文件（版本12）。start只读取块索引和键索引，之后服务器即可处理命令，
+// 后台线程按文件顺序逐块载入。命令执行前由loadKeys按键指纹找到键所在的数据块并先行载入；
+// 每个数据块恰好载入一次，载入之后对其中的键的修改不会被后台加载覆盖。
+// 与同步加载不同，损坏的数据块只跳过该块，其余数据块照常载入
+class RDBLoader {
+public:
+    explicit RDBLoader(StorageEngine* storage_engine);
+    // 停止后台线程，未载入的数据块不再载入
+    ~RDBLoader();
+
+    RDBLoader(const RDBLoader&) = delete;
+    RDBLoader& operator=(const RDBLoader&) = delete;
+
+    // 打开文件、读取索引并启动threads个后台线程。文件无法打开、格式错误或不是版本12时返回false，
+    // 调用方改为同步加载。需在恢复模式之外调用，载入时获取分段写锁
+    bool start(const std::string& filename, size_t threads);
+    // 载入keys所在的、尚未载入的数据块，正由其他线程载入的等待其完成
+    void loadKeys(const std::vector<Key>& keys);
+    // 在调用线程载入剩余的数据块，并等待后台线程结束
+    void finish();
+    bool loading() const { return loading_.load(std::memory_order_acquire); }
+    RDBLoadStats getStats() const;
+
+private:
+    enum ChunkState : uint8_t {
+        CHUNK_PENDING,
+        CHUNK_LOADING,
+        CHUNK_LOADED
+    };
+
+    // 认领并载入一个数据块，已被其他线程认领时等待其载入完成
+    void loadChunk(size_t index, bool on_demand);
+    // 最后一个数据块载入后释放索引和文件映射
+    void complete();
+    void backgroundThread();
+    void joinThreads();
+
+    StorageEngine* storage_engine_;
+    std::string filename_;
+    MappedFile file_;
+    std::vector<RDBChunkInfo> chunks_;
+    std::unique_ptr<std::atomic<uint8_t>[]> states_;
+    // 键指纹到数据块下标，按指纹排序。加载完成后释放，查找与释放由index_mutex_隔开
+    std::vector<std::pair<uint32_t, uint32_t>> key_index_;
+    mutable std::shared_mutex index_mutex_;
+    // 等待其他线程正在载入的数据块
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+    std::mutex threads_mutex_;
+    std::vector<std::thread> threads_;
+
+    Timestamp now_; // 保存后已过期的键按开始加载的时间判断
+    std::chrono::steady_clock::time_point start_time_;
+    std::atomic<size_t> next_chunk_{0};
+    std::atomic<size_t> remaining_{0};
+    std::atomic<bool> loading_{false};
+    std::atomic<bool> stopping_{false};
+    uint64_t total_keys_ = 0;
+    std::atomic<uint64_t> loaded_chunks_{0};
+    std::atomic<uint64_t> demand_chunks_{0};
+    std::atomic<uint64_t> failed_chunks_{0};
+    std::atomic<uint64_t> loaded_keys_{0};
+    std::atomic<uint64_t> elapsed_ms_{0};
+};
+
+} // namespace dkv
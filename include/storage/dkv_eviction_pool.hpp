@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../dkv_core.hpp"
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dkv {
+
+// 近似淘汰的候选池（与Redis的evictionPool相同）
+// 每轮只随机采样少量键，把其中最适合淘汰的键按分数保留在池中，跨轮次累积，
+// 淘汰时取分数最高的候选。分数由调用方按策略计算：LRU为空闲毫秒数，LFU为255减对数计数，
+// TTL为距最大时间戳的差值，分数越大越优先淘汰。池中的键可能已被删除或再次访问，取出后需由调用方复核。
+// 不是线程安全的，调用方负责加锁。
+class EvictionPool {
+public:
+    // 默认候选数量
+    static constexpr size_t DEFAULT_CAPACITY = 16;
+
+    explicit EvictionPool(size_t capacity = DEFAULT_CAPACITY);
+
+    // 加入候选键，键已在池中时更新分数；池满且分数不高于池中最小值时丢弃
+    void offer(std::string_view key, uint64_t score);
+    // 取出分数最高的候选键，池为空时返回false
+    bool pop(Key& key);
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    void clear() { entries_.clear(); }
+
+private:
+    size_t capacity_;
+    std::vector<std::pair<uint64_t, Key>> entries_; // 按分数升序排列
+};
+
+} // namespace dkv
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../dkv_core.hpp"
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace dkv {
+
+// 过期索引，只记录设置了过期时间的键，按过期时间排序
+// 主动过期只需从最早到期的一端取键，工作量与到期键数成正比，与键空间大小无关。
+// 索引中的过期时间可能已经失效（键被删除、覆盖或移除了过期时间），取出后需由调用方复核数据项。
+// 不是线程安全的，调用方负责加锁。
+class ExpireIndex {
+public:
+    // 记录键的过期时间，键已在索引中时替换原有的过期时间
+    void add(const Key& key, Timestamp expire_time);
+    void remove(const Key& key);
+    // 取出最早到期的键，没有早于now的过期时间时返回false
+    bool popDue(Timestamp now, Key& key);
+    // 是否有早于now的过期时间
+    bool hasDue(Timestamp now) const { return !order_.empty() && order_.begin()->first < now; }
+
+    size_t size() const { return deadlines_.size(); }
+    bool empty() const { return deadlines_.empty(); }
+    void clear();
+
+private:
+    std::set<std::pair<Timestamp, Key>> order_;       // 按过期时间升序
+    std::unordered_map<Key, Timestamp> deadlines_;    // 键当前在order_中的过期时间
+};
+
+} // namespace dkv
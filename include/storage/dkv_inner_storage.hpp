@@ -4,62 +4,186 @@
 #include "../dkv_datatypes.hpp"
 #include "../transaction/dkv_mvcc.hpp"
 #include "../transaction/dkv_transaction_manager.hpp"
+#include "dkv_expire_index.hpp"
+#include "dkv_key_table.hpp"
+#include "dkv_lazy_free.hpp"
+#include "dkv_segment_mutex.hpp"
+#include "dkv_tiered_storage.hpp"
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <shared_mutex>
-#include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace dkv {
 
+// 键空间统计信息
+struct KeyspaceStats {
+    size_t segments = 0;             // 分段数量
+    size_t capacity = 0;             // 各分段哈希表槽位总数
+    size_t rehashing_segments = 0;   // 正在渐进式rehash的分段数
+    size_t rehash_pending_slots = 0; // 旧表中尚未迁移的槽位总数
+    size_t volatile_keys = 0;        // 过期索引中的键数
+};
+
 // InnerStorage类
+// 键空间按键哈希划分为多个分段，每个分段拥有独立的数据表和读写锁。
+// 分段读写锁的读锁不修改共享的锁字（见SegmentMutex），读多写少时读者之间没有缓存行争用。
+// 单键操作只需持有键所在分段的锁；多键操作通过wlockKeys/rlockKeys按分段序号升序加锁，避免死锁。
 class InnerStorage {
+public:
+    using DataMap = KeyTable;
+    // 写时复制快照中被写者先保存的键在快照时刻的内容，空指针表示当时不存在
+    using SavedItems = std::unordered_map<SharedKey, std::unique_ptr<DataItem>>;
+
+    // 默认分段数量
+    static constexpr size_t DEFAULT_SEGMENT_COUNT = 16;
+
 private:
-    // 数据存储，用于存储实际数据项
-    std::unordered_map<Key, std::unique_ptr<DataItem>> data_;
-    mutable std::shared_mutex mutex_;
+    // 分段在写时复制快照中的状态，由分段写锁保护
+    enum class CaptureState : uint8_t {
+        NONE,    // 没有进行中的快照，或快照已遍历完本分段
+        PENDING  // 快照尚未遍历完本分段，写者首次修改某个键前先保存它
+    };
+
+    // 键空间分段
+    struct Segment {
+        DataMap data;
+        ExpireIndex expires; // 本分段设置了过期时间的键
+        mutable SegmentMutex mutex;
+        CaptureState capture = CaptureState::NONE;
+        SavedItems saved;
+        // 快照线程已从数据表输出的键：写者不必再保存，rehash后重复遍历到时跳过。快照线程持有读锁时插入
+        std::unordered_set<SharedKey> emitted;
+    };
+    std::vector<std::unique_ptr<Segment>> segments_;
+
+    // 写时复制快照：进行中时写锁函数先保存要修改的键，capture_view_为快照的读取视图
+    std::atomic<bool> capture_active_{false};
+    ReadView capture_view_;
 
     // MVCC管理器，用于处理多版本并发控制
     MVCC mvcc_;
+
+    // 恢复模式下加锁函数不获取分段锁，见setRecoveryMode
+    std::atomic<bool> recovery_mode_{false};
+    // 当前线程通过KeyspaceLock持有全部分段写锁的InnerStorage
+    static thread_local const InnerStorage* keyspace_holder_;
+    friend class KeyspaceLock;
+
+    // 恢复模式下或当前线程已持有全部分段锁时，加锁函数返回未持有锁的对象
+    bool lockElided() const { return keyspace_holder_ == this || inRecoveryMode(); }
+
+    Segment& segmentOf(std::string_view key) { return *segments_[segmentIndex(key)]; }
+    const Segment& segmentOf(std::string_view key) const { return *segments_[segmentIndex(key)]; }
+    // 持有分段写锁时调用：快照进行中、键既未输出也未保存时，把它在capture_view_下可见的内容复制到saved
+    void captureKey(size_t index, std::string_view key) const;
+    // 对分段中的全部键调用captureKey，用于不指定键的整体修改（清空键空间）
+    void captureSegment(size_t index) const;
+    // 按序号获取全部分段写锁，不保存快照内容
+    std::vector<std::unique_lock<SegmentMutex>> lockAllSegments() const;
 public:
-    InnerStorage() : mvcc_(*this) {}
+    explicit InnerStorage(size_t segment_count = DEFAULT_SEGMENT_COUNT);
     ~InnerStorage() = default;
-    
+
     // 禁止拷贝和移动
     InnerStorage(const InnerStorage&) = delete;
     InnerStorage& operator=(const InnerStorage&) = delete;
     InnerStorage(InnerStorage&&) = delete;
     InnerStorage& operator=(InnerStorage&&) = delete;
 
-    // 获取数据项
-    DataItem* get(const Key& key) const;
-    DataItem* get(const Key& key, const ReadView& read_view) const;
+    // 以下单键操作要求调用方持有键所在分段的锁
+    // 获取数据项，按string_view查找，不构造临时字符串
+    DataItem* get(std::string_view key) const;
+    DataItem* get(std::string_view key, const ReadView& read_view) const;
     bool set(TransactionID tx_id, const Key& key, std::unique_ptr<DataItem> item);
     bool del(TransactionID tx_id, const Key& key);
-    bool exists(const Key& key) const;
-    bool exists(const Key& key, const ReadView& read_view) const;
+    // 从键空间和过期索引中摘下键的数据项，不支持事务，键不存在时返回空。数据项由调用方释放
+    std::unique_ptr<DataItem> detach(const Key& key);
+    bool exists(std::string_view key) const;
+    bool exists(std::string_view key, const ReadView& read_view) const;
+    // 事务内原地修改集合类型前获取要修改的版本，见MVCC::prepareWrite
+    DataItem* prepareWrite(TransactionID tx_id, const Key& key, const ReadView& read_view,
+                           DataType type, UndoLog*& delta);
     // 获取数据项引用，不支持事务
     std::unique_ptr<DataItem>& getRefOrInsert(const Key& key);
+    // 插入或覆盖数据项，不支持事务，返回是否为新键
+    bool insert_or_assign(const Key& key, std::unique_ptr<DataItem> item);
+
+    // 把键的过期时间登记到过期索引。写入带过期时间的数据项时set/insert_or_assign会自动登记，
+    // 对已有数据项调用setExpiration后需由调用方登记
+    void trackExpiration(const Key& key, Timestamp expire_time);
 
-    // 容器操作，不支持事务
+    // 容器操作，不支持事务，要求调用方持有全部分段的锁
     void clear();
+    // 把各分段的数据表换成空表，返回换下的表，由调用方释放
+    std::vector<std::unique_ptr<DataMap>> detachAll();
     size_t size() const;
-    std::vector<Key> getAllKeys() const;
+    // 返回键的句柄，不复制键的字符串
+    std::vector<SharedKey> getAllKeys() const;
 
-    // 迭代器相关操作，不支持事务
-    std::unordered_map<Key, std::unique_ptr<DataItem>>::const_iterator find(const Key& key) const;
-    std::unordered_map<Key, std::unique_ptr<DataItem>>::const_iterator begin() const;
-    std::unordered_map<Key, std::unique_ptr<DataItem>>::const_iterator end() const;
-    std::unique_ptr<DataItem>& operator[](const Key& key);
-    std::unordered_map<Key, std::unique_ptr<DataItem>>::iterator erase(std::unordered_map<Key, std::unique_ptr<DataItem>>::iterator it);
-    std::unordered_map<Key, std::unique_ptr<DataItem>>::iterator erase(std::unordered_map<Key, std::unique_ptr<DataItem>>::const_iterator it);
-    std::pair<std::unordered_map<Key, std::unique_ptr<DataItem>>::iterator, bool> insert_or_assign(const Key& key, std::unique_ptr<DataItem> item);
+    // 渐进式rehash，要求调用方持有对应分段的写锁，返回迁移后是否仍在rehash
+    bool rehashStep(size_t index, size_t groups);
+    // 主动过期，要求调用方持有对应分段的写锁。从过期索引中取出至多max_keys个早于now到期的键，
+    // 复核后删除已过期的键，expired累加删除的键数；freer非空时删除的数据项交给它释放。返回分段中是否仍有到期的键
+    bool expireStep(size_t index, Timestamp now, size_t max_keys, size_t& expired, LazyFreer* freer = nullptr);
+    // 键空间统计，内部逐个分段加读锁
+    KeyspaceStats getKeyspaceStats() const;
+
+    // 分段访问，要求调用方持有对应分段的锁
+    size_t segmentCount() const { return segments_.size(); }
+    size_t segmentIndex(std::string_view key) const;
+    DataMap& segmentData(size_t index) { return segments_[index]->data; }
+    const DataMap& segmentData(size_t index) const { return segments_[index]->data; }
 
     // 锁操作方法
-    std::unique_lock<std::shared_mutex> wlock() const;
-    std::shared_lock<std::shared_mutex> rlock() const;
-    std::unique_lock<std::shared_mutex> wlock_deferred() const;
-    std::shared_lock<std::shared_mutex> rlock_deferred() const;
-    std::shared_mutex& getMutex() const;
+    // 恢复模式：启动加载数据时没有客户端和后台线程访问存储，调用方保证每个分段同一时刻只有一个线程写入，
+    // 加锁函数返回未持有锁的对象，省去分段锁的开销。持有KeyspaceLock的线程同样不再加锁
+    void setRecoveryMode(bool enabled) { recovery_mode_.store(enabled); }
+    bool inRecoveryMode() const { return recovery_mode_.load(std::memory_order_relaxed); }
+    // 单键加锁
+    std::unique_lock<SegmentMutex> wlock(const Key& key) const;
+    std::shared_lock<SegmentMutex> rlock(const Key& key) const;
+    // 单个分段加锁。写锁不保存快照内容，只能用于不改变快照可见内容的维护：
+    // rehash、删除已到期的键（快照不包含到期的键）、回收历史版本、碎片整理和启动加载
+    std::unique_lock<SegmentMutex> wlockSegment(size_t index) const;
+    std::shared_lock<SegmentMutex> rlockSegment(size_t index) const;
+    // 多键加锁，按分段序号升序加锁，同一分段只加锁一次
+    std::vector<std::unique_lock<SegmentMutex>> wlockKeys(const std::vector<Key>& keys) const;
+    std::vector<std::shared_lock<SegmentMutex>> rlockKeys(const std::vector<Key>& keys) const;
+    // 全部分段加锁
+    std::vector<std::unique_lock<SegmentMutex>> wlockAll() const;
+    std::vector<std::shared_lock<SegmentMutex>> rlockAll() const;
+
+    // 写时复制快照：beginCapture持有全部分段写锁把各分段标记为待遍历后返回，开销与键数无关。
+    // 此后wlock/wlockKeys在键首次被修改前复制它在read_view下可见的版本，写者的停顿与单个数据项大小成正比；
+    // wlockAll复制分段中的全部键。快照期间read_view所属的事务需保持活跃。同一时刻只有一个快照，由调用方保证
+    void beginCapture(const ReadView& read_view);
+    // 由快照线程逐个分段遍历快照时刻的内容，cursor为0时开始。每次持有读锁输出至多count个数据表中未被修改的键，
+    // 数据表遍历完后取走写者保存的键并在锁外输出。返回下一次调用的游标，0表示该分段遍历结束
+    size_t scanCapture(size_t index, size_t cursor, size_t count,
+                       const std::function<void(const SharedKey&, const DataItem&)>& fn) const;
+    // 结束快照，释放尚未取走的内容
+    void endCapture();
+    bool capturing() const { return capture_active_.load(std::memory_order_acquire); }
+};
+
+// 持有全部分段的写锁，期间本线程对该InnerStorage的加锁函数不再获取分段锁：
+// 多条命令在一次加锁内执行，其他线程看不到中间状态（脚本）。持有期间不能等待其他会获取分段锁的线程
+class KeyspaceLock {
+public:
+    explicit KeyspaceLock(const InnerStorage& storage);
+    ~KeyspaceLock();
+
+    KeyspaceLock(const KeyspaceLock&) = delete;
+    KeyspaceLock& operator=(const KeyspaceLock&) = delete;
+
+private:
+    const InnerStorage* previous_holder_;
+    std::vector<std::unique_lock<SegmentMutex>> locks_;
 };
 
-} // namespace dkv
\ No newline at end of file
+} // namespace dkv
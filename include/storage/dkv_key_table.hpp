@@ -0,0 +1,158 @@
+#pragma once
+
+#include "../dkv_core.hpp"
+#include "../datatypes/dkv_datatype_base.hpp"
+#include "dkv_shared_key.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+
+namespace dkv {
+
+// 键空间主哈希表
+// 开放寻址，SwissTable风格：每个槽位对应一个控制字节，保存键哈希的低7位或空/删除标记，
+// 以16个槽位为一组探测。查找时先批量比较控制字节，命中后才比较键，避免链表节点的指针追逐。
+// 扩容采用渐进式rehash：扩容时保留旧表，之后每次写操作（以及rehashStep）迁移固定数量的组，
+// 迁移完成前查找会同时检查新旧两张表。
+// 删除和查找不迁移元素，迭代中按迭代器删除是安全的；插入可能迁移或扩容，使所有迭代器和引用失效。
+// 需要分多次、跨越写操作遍历时使用scan，游标不持有任何状态。
+// 键以SharedKey保存，槽位为两个指针；查找按string_view比较，调用方不必构造临时字符串。
+class KeyTable {
+public:
+    using value_type = std::pair<SharedKey, std::unique_ptr<DataItem>>;
+
+    // 每组槽位数
+    static constexpr size_t GROUP_WIDTH = 16;
+
+    template <bool Const>
+    class Iterator {
+        using Owner = typename std::conditional<Const, const KeyTable, KeyTable>::type;
+        using Ref = typename std::conditional<Const, const KeyTable::value_type&, KeyTable::value_type&>::type;
+        using Ptr = typename std::conditional<Const, const KeyTable::value_type*, KeyTable::value_type*>::type;
+        Owner* table_ = nullptr;
+        size_t index_ = 0;
+        friend class KeyTable;
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Ptr;
+        using reference = Ref;
+
+        Iterator() = default;
+        Iterator(Owner* table, size_t index) : table_(table), index_(index) {}
+        // 允许非const迭代器转换为const迭代器
+        template <bool C = Const, typename = typename std::enable_if<C>::type>
+        Iterator(const Iterator<false>& other) : table_(other.table_), index_(other.index_) {}
+
+        Ref operator*() const { return table_->slotAt(index_); }
+        Ptr operator->() const { return &table_->slotAt(index_); }
+        Iterator& operator++() {
+            index_ = table_->nextFull(index_ + 1);
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        bool operator==(const Iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    KeyTable() = default;
+    ~KeyTable();
+
+    // 禁止拷贝和移动
+    KeyTable(const KeyTable&) = delete;
+    KeyTable& operator=(const KeyTable&) = delete;
+    KeyTable(KeyTable&&) = delete;
+    KeyTable& operator=(KeyTable&&) = delete;
+
+    // 每次写操作迁移的组数
+    static constexpr size_t REHASH_GROUPS_PER_OP = 1;
+
+    size_t size() const { return table_.size + old_.size; }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return table_.capacity; }
+
+    iterator begin() { return iterator(this, nextFull(0)); }
+    iterator end() { return iterator(this, endIndex()); }
+    const_iterator begin() const { return const_iterator(this, nextFull(0)); }
+    const_iterator end() const { return const_iterator(this, endIndex()); }
+
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    // 查找键，不存在时插入空数据项
+    std::unique_ptr<DataItem>& operator[](std::string_view key);
+    // 插入或覆盖，返回是否为新键
+    bool insert_or_assign(std::string_view key, std::unique_ptr<DataItem> item);
+    size_t erase(std::string_view key);
+    iterator erase(iterator it);
+    void clear();
+    // 交换两张表的全部内容（包括进行中的rehash），O(1)
+    void swap(KeyTable& other) noexcept;
+    // 预留至少可容纳n个键的空间，会立即完成迁移
+    void reserve(size_t n);
+
+    // 渐进式rehash
+    bool isRehashing() const { return old_.capacity != 0; }
+    // 迁移至多groups个组，返回迁移后是否仍在rehash
+    bool rehashStep(size_t groups);
+    // 旧表中尚未迁移的槽位数
+    size_t rehashPendingSlots() const {
+        return isRehashing() ? old_.capacity - migrate_group_ * GROUP_WIDTH : 0;
+    }
+
+    // 游标遍历：每次调用访问一个主组（键哈希定位到的组），对主组为该组的键调用fn，
+    // 返回下一次调用的游标，返回0表示遍历结束。游标按组号的反向二进制位递增，
+    // 两次调用之间发生扩容或rehash时，遍历开始前已存在且未删除的键仍至少返回一次，但可能重复返回。
+    size_t scan(size_t cursor, const std::function<void(const value_type&)>& fn) const;
+
+private:
+    // 控制字节：空槽、已删除槽，非负值为已占用槽的7位哈希
+    static constexpr int8_t CTRL_EMPTY = -128;
+    static constexpr int8_t CTRL_DELETED = -2;
+    static constexpr size_t MIN_CAPACITY = GROUP_WIDTH;
+
+    struct Table {
+        std::unique_ptr<int8_t[]> ctrl;
+        value_type* slots = nullptr;
+        size_t capacity = 0;    // 槽位数，为GROUP_WIDTH的2次幂倍
+        size_t size = 0;        // 已占用槽位数
+        size_t growth_left = 0; // 扩容前还可占用的空槽数（删除标记不计入）
+        bool mapped = false;    // 槽位数组由PageMemory映射（开启大页且数组不小于一个大页时）
+    };
+    Table table_;              // 当前表，新键总是写入此表
+    Table old_;                // rehash中的旧表，capacity为0表示未在rehash
+    size_t migrate_group_ = 0; // 旧表中下一个待迁移的组
+
+    static size_t hashKey(std::string_view key);
+    static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+    static size_t findIndex(const Table& table, std::string_view key, size_t hash);
+    static size_t findInsertSlot(const Table& table, size_t hash);
+    static void allocate(Table& table, size_t capacity);
+    static void release(Table& table);
+    static void eraseAt(Table& table, size_t index);
+
+    // 迭代器下标：[0, table_.capacity)为当前表，之后为旧表
+    size_t endIndex() const { return table_.capacity + old_.capacity; }
+    // 沿group的探测链访问主组为group的键
+    static void scanGroup(const Table& table, size_t group, const std::function<void(const value_type&)>& fn);
+    size_t nextFull(size_t from) const;
+    value_type& slotAt(size_t index) const;
+    // 查找键，返回迭代器下标，不存在时返回endIndex()
+    size_t locate(std::string_view key, size_t hash) const;
+    size_t insertNew(SharedKey key, size_t hash);
+    void startRehash(size_t new_capacity);
+    void finishRehash();
+    void eraseIndex(size_t index);
+};
+
+} // namespace dkv
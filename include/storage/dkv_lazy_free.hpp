@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../dkv_core.hpp"
+#include "../datatypes/dkv_datatype_base.hpp"
+#include "dkv_key_table.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dkv {
+
+// 哪些删除交给后台线程释放，对应配置项lazyfree_lazy_*
+struct LazyFreeConfig {
+    bool lazy_eviction = false;   // 内存淘汰删除的键
+    bool lazy_expire = false;     // 主动过期删除的键
+    bool lazy_user_del = false;   // DEL与UNLINK相同
+    bool lazy_user_flush = false; // 不带SYNC/ASYNC的FLUSHDB按ASYNC执行
+};
+
+// 后台释放已从键空间摘下的数据项和整张键表。删除集合元素很多的键时，
+// 调用方在分段锁内只摘下指针，逐个元素的析构在后台线程上进行，不阻塞其他客户端
+class LazyFreer {
+public:
+    // 元素数不超过该值的数据项直接释放，入队和唤醒后台线程的开销比析构本身更大
+    static constexpr size_t LAZYFREE_THRESHOLD = 64;
+
+    LazyFreer() = default;
+    // 释放队列中剩余的对象后回收后台线程
+    ~LazyFreer();
+
+    LazyFreer(const LazyFreer&) = delete;
+    LazyFreer& operator=(const LazyFreer&) = delete;
+
+    // 元素数超过阈值时交给后台线程释放，否则在调用线程上直接释放。后台线程在第一次入队时启动
+    void free(std::unique_ptr<DataItem> item);
+    void free(std::unique_ptr<KeyTable> table);
+    // 等待已入队的对象全部释放
+    void drain();
+
+    // 等待释放的对象数与累计在后台释放的对象数（一张键表计为一个对象）
+    size_t pendingObjects() const { return pending_.load(std::memory_order_relaxed); }
+    uint64_t freedObjects() const { return freed_.load(std::memory_order_relaxed); }
+
+    // 释放数据项需要析构的元素数估计
+    static size_t freeEffort(const DataItem& item);
+
+private:
+    void enqueue_locked();
+    void run();
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;      // 有新对象入队或需要退出
+    std::condition_variable idle_cv_; // 队列已清空，唤醒drain
+    std::vector<std::unique_ptr<DataItem>> items_;
+    std::vector<std::unique_ptr<KeyTable>> tables_;
+    bool stopping_ = false;
+    std::thread thread_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<uint64_t> freed_{0};
+};
+
+} // namespace dkv
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <shared_mutex>
+
+namespace dkv {
+
+// 键空间分段的读写锁，读锁不修改锁本身（被动读锁）
+// std::shared_mutex加读锁要对同一个锁字做原子读改写，即使没有写者，所有读线程也在争用这条缓存行。
+// 这里每个线程拥有一个独占缓存行的读者槽位：读者在槽位中登记正在读取的锁，再检查写标志，
+// 没有写者时直接进入临界区；写者先获取内部互斥锁并设置写标志，再等待登记了该锁的读者全部退出。
+// 写标志已设置时读者退回内部shared_mutex，等待写者完成。
+// 读路径只写本线程的槽位，没有写者时读线程之间不传递缓存行；代价是写者加锁时要检查所有读者槽位。
+// 一个线程同一时刻只能被动持有一把锁，同时读取其他分段时退回内部shared_mutex；
+// 同一线程重复对同一把锁加读锁是允许的。
+// 满足SharedMutex要求，配合std::unique_lock/std::shared_lock使用。
+class SegmentMutex {
+public:
+    // 读者槽位数量，超出的线程总是使用内部shared_mutex
+    static constexpr size_t MAX_READER_SLOTS = 256;
+
+    SegmentMutex() = default;
+    SegmentMutex(const SegmentMutex&) = delete;
+    SegmentMutex& operator=(const SegmentMutex&) = delete;
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    void lock_shared();
+    bool try_lock_shared();
+    void unlock_shared();
+
+private:
+    // 是否有读者登记了本锁
+    bool hasReaders() const;
+    void waitForReaders() const;
+
+    std::shared_mutex mutex_;
+    std::atomic<bool> writer_{false}; // 写者持有内部互斥锁期间为true
+};
+
+} // namespace dkv
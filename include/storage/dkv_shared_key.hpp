@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace dkv {
+
+// 键空间中的键：引用计数的不可变字符串，计数、长度与键的字节放在同一次分配中（小于512字节时来自SlabAllocator）。
+// 哈希表槽位只保存一个指针；事务记录、快照复制和按键遍历都复制句柄而不复制字符串。
+// 计数为原子操作，句柄可以在持有分段锁之外的线程上释放
+class SharedKey {
+public:
+    SharedKey() = default;
+    explicit SharedKey(std::string_view key);
+    SharedKey(const SharedKey& other) noexcept : rep_(other.rep_) {
+        if (rep_) {
+            rep_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    SharedKey(SharedKey&& other) noexcept : rep_(other.rep_) { other.rep_ = nullptr; }
+    SharedKey& operator=(const SharedKey& other) noexcept {
+        SharedKey copy(other);
+        std::swap(rep_, copy.rep_);
+        return *this;
+    }
+    SharedKey& operator=(SharedKey&& other) noexcept {
+        std::swap(rep_, other.rep_);
+        return *this;
+    }
+    ~SharedKey() {
+        if (rep_ && rep_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            destroy(rep_);
+        }
+    }
+
+    std::string_view view() const { return rep_ ? std::string_view(rep_->bytes(), rep_->length) : std::string_view(); }
+    operator std::string_view() const { return view(); }
+    std::string str() const { return std::string(view()); }
+    const char* data() const { return view().data(); }
+    size_t size() const { return rep_ ? rep_->length : 0; }
+    bool empty() const { return size() == 0; }
+    // 共享同一字符串的句柄数
+    size_t useCount() const { return rep_ ? rep_->refs.load(std::memory_order_relaxed) : 0; }
+    // 长度为length的键字符串占用的字节数（含引用计数头部），用于内存估算
+    static size_t allocatedBytes(size_t length) { return sizeof(Rep) + length; }
+
+    friend bool operator==(const SharedKey& a, const SharedKey& b) { return a.rep_ == b.rep_ || a.view() == b.view(); }
+    friend bool operator==(const SharedKey& a, std::string_view b) { return a.view() == b; }
+    friend bool operator==(std::string_view a, const SharedKey& b) { return a == b.view(); }
+    friend bool operator!=(const SharedKey& a, const SharedKey& b) { return !(a == b); }
+    friend bool operator!=(const SharedKey& a, std::string_view b) { return !(a == b); }
+    friend bool operator!=(std::string_view a, const SharedKey& b) { return !(a == b); }
+
+private:
+    struct Rep {
+        std::atomic<uint32_t> refs;
+        uint32_t length;
+        char* bytes() { return reinterpret_cast<char*>(this + 1); }
+    };
+    static void destroy(Rep* rep);
+
+    Rep* rep_ = nullptr;
+};
+
+} // namespace dkv
+
+namespace std {
+template <>
+struct hash<dkv::SharedKey> {
+    size_t operator()(const dkv::SharedKey& key) const { return hash<string_view>{}(key.view()); }
+};
+} // namespace std
@@ -6,26 +6,150 @@
 #include "../persist/dkv_rdb.hpp"
 #include "../transaction/dkv_transaction_manager.hpp"
 #include "dkv_inner_storage.hpp"
+#include <array>
+#include <chrono>
 #include <unordered_map>
 #include <shared_mutex>
 #include <memory>
+#include <optional>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 namespace dkv {
 
+class RDBLoader;
+struct RDBLoadStats;
+
+// RDB快照进度
+struct RDBSaveStats {
+    bool in_progress = false;      // 是否正在保存
+    uint64_t saved_keys = 0;       // 当前（或上一次）快照已写入的键数
+    uint64_t snapshot_keys = 0;    // 快照开始时的键数，用于估算进度
+    bool last_status_ok = true;    // 上一次保存是否成功
+    int64_t last_save_time = 0;    // 上一次成功保存的时间（秒）
+    uint64_t last_duration_ms = 0; // 上一次保存的耗时
+};
+
+// 主动碎片整理进度
+struct DefragStats {
+    uint64_t relocated = 0;  // 累计搬到较满slab中的数据项数
+    uint64_t skipped = 0;    // 累计检查后未搬移的数据项数
+    uint64_t passes = 0;     // 已完成的完整遍历轮数
+};
+
+// 数据类型的小写名称，用于内存报告
+const char* dataTypeName(DataType type);
+
+// 键空间内存采样找到的大键
+struct BigKeyInfo {
+    std::string key;
+    size_t bytes = 0;            // 估算的内存字节数
+    const char* encoding = "";   // 内部编码，见DataItem::encodingName
+};
+
+// 键空间内存采样结果，按数据类型汇总
+struct MemorySampleReport {
+    static constexpr size_t TYPE_COUNT = static_cast<size_t>(DataType::BLOOM) + 1;
+    // 每种数据类型保留的最大键数
+    static constexpr size_t BIGKEYS_PER_TYPE = 5;
+
+    struct TypeStats {
+        uint64_t keys = 0;
+        uint64_t bytes = 0;
+        std::vector<BigKeyInfo> biggest; // 按字节数降序
+    };
+    std::array<TypeStats, TYPE_COUNT> types; // 以DataType为下标
+    uint64_t passes = 0;     // 已完成的完整遍历轮数
+    int64_t finished_at = 0; // 上一轮遍历结束的时间（秒），0表示尚未完成过
+};
+
 // 存储引擎
 class StorageEngine {
+public:
+    // 每次清理周期中每个分段迁移的组数
+    static constexpr size_t REHASH_GROUPS_PER_TICK = 1024;
+    // 每次历史版本回收访问的组数
+    static constexpr size_t PURGE_GROUPS_PER_TICK = 256;
+    // RDB快照每次持有分段读锁序列化的键数
+    static constexpr size_t RDB_SAVE_KEYS_PER_LOCK = 128;
+    // 每次主动过期周期的默认时间预算
+    static constexpr std::chrono::microseconds EXPIRE_CYCLE_BUDGET{1000};
+    // 主动过期每批从过期索引中取出的键数，每批之间释放分段写锁并检查时间预算
+    static constexpr size_t EXPIRE_KEYS_PER_BATCH = 20;
+    // 每次主动碎片整理周期的默认时间预算
+    static constexpr std::chrono::microseconds DEFRAG_CYCLE_BUDGET{1000};
+    // 碎片整理每次持有分段写锁访问的组数，之间释放写锁并检查时间预算
+    static constexpr size_t DEFRAG_GROUPS_PER_LOCK = 16;
+    // 需要析构的元素数超过该值的数据项不搬移，避免复制大集合时长时间持有分段写锁
+    static constexpr size_t DEFRAG_MAX_EFFORT = 1024;
+    // MEMORY USAGE默认计算的集合元素数，与Redis相同
+    static constexpr size_t MEMORY_USAGE_SAMPLES = 5;
+    // 每次键空间内存采样周期的默认时间预算
+    static constexpr std::chrono::microseconds MEMORY_SAMPLE_CYCLE_BUDGET{1000};
+    // 内存采样每次持有分段读锁访问的组数
+    static constexpr size_t MEMORY_SAMPLE_GROUPS_PER_LOCK = 16;
+
 private:
+    // 分层存储，未启用时为空。键空间和后台释放线程中的SpilledItem引用它，须在它们之后析构
+    std::unique_ptr<TieredStore> tier_;
+
     // 内部存储
     InnerStorage inner_storage_;
     
     // 统计信息
     std::atomic<uint64_t> total_keys_{0};
     std::atomic<uint64_t> expired_keys_{0};
+    // 下一次主动过期开始的分段，预算用尽时下一周期从未处理的分段继续
+    std::atomic<size_t> expire_cursor_{0};
     
     // 内存使用统计
     std::atomic<size_t> memory_usage_;
 
     std::unique_ptr<TransactionManager> transaction_manager_; // 事务管理器
+
+    // 历史版本回收状态，由purge_mutex_保护
+    mutable std::mutex purge_mutex_;
+    size_t purge_cursor_ = 0;                           // 下一次回收的游标，0表示开始新一轮遍历
+    std::vector<TransactionID> purge_pass_rollbacks_;   // 本轮开始时已回滚的事务，本轮结束后其版本已全部清理
+    size_t pass_versioned_keys_ = 0;                    // 本轮累计的统计，遍历结束时写入purge_stats_
+    size_t pass_history_versions_ = 0;
+    size_t pass_max_chain_length_ = 0;
+    MVCCStats purge_stats_;
+    // purge_stats_中版本链统计的副本，读取时不必等待进行中的回收
+    std::atomic<size_t> mvcc_max_chain_length_{0};
+    std::atomic<size_t> mvcc_history_versions_{0};
+
+    // 主动碎片整理状态，由defrag_mutex_保护
+    mutable std::mutex defrag_mutex_;
+    size_t defrag_cursor_ = 0; // 编码方式与purge_cursor_相同，0表示开始新一轮遍历
+    DefragStats defrag_stats_;
+
+    // 键空间内存采样状态，由memory_sample_mutex_保护
+    mutable std::mutex memory_sample_mutex_;
+    size_t memory_sample_cursor_ = 0;          // 编码方式与purge_cursor_相同，0表示开始新一轮遍历
+    MemorySampleReport memory_sample_pass_;    // 本轮累计的结果
+    MemorySampleReport memory_sample_report_;  // 上一轮完整遍历的结果
+
+    // RDB快照状态，由rdb_save_mutex_保护。同一时刻只有一个快照在保存
+    mutable std::mutex rdb_save_mutex_;
+    std::condition_variable rdb_save_cv_;
+    bool rdb_saving_ = false;
+    RDBSaveStats rdb_save_stats_;
+    std::atomic<uint64_t> rdb_saved_keys_{0};
+    std::thread rdb_save_thread_; // 后台保存线程
+    std::atomic<size_t> rdb_threads_{0}; // RDB并行保存/加载的线程数，0表示按CPU核数
+    std::atomic<RDBCompression> rdb_compression_{RDBCompression::LZF}; // 保存RDB时数据块的压缩算法
+    // RDB后台加载，启动时创建，之后不再替换；析构时先于键空间停止
+    std::unique_ptr<RDBLoader> rdb_loader_;
+    // 进行中的写时复制快照固定读取视图的事务与开始时间，见beginSnapshot
+    TransactionID cow_snapshot_tx_ = NO_TX;
+    std::chrono::steady_clock::time_point cow_snapshot_start_;
+
+    // 后台释放删除的大键和FLUSHDB ASYNC换下的键表
+    LazyFreer lazy_freer_;
+    LazyFreeConfig lazyfree_config_;
     
     // 获取内存使用量
     size_t getCurrentMemoryUsage() const;
@@ -38,7 +162,8 @@ private:
 
 public:
     // 构造函数
-    StorageEngine(TransactionIsolationLevel tx_isolation_level = TransactionIsolationLevel::READ_COMMITTED);
+    StorageEngine(TransactionIsolationLevel tx_isolation_level = TransactionIsolationLevel::READ_COMMITTED,
+                  size_t segment_count = InnerStorage::DEFAULT_SEGMENT_COUNT);
     ~StorageEngine();
 
     // 事务管理器
@@ -55,7 +180,16 @@ public:
     bool set(TransactionID tx_id, const Key& key, const Value& value, int64_t expire_seconds);
     std::string get(TransactionID tx_id, const Key& key);
     bool del(TransactionID tx_id, const Key& key);
+    // 与del相同，但非事务删除时只在分段锁内摘下数据项，元素较多的集合交给后台线程释放
+    bool unlink(TransactionID tx_id, const Key& key);
     bool exists(TransactionID tx_id, const Key& key);
+    // 估计命令开销用的键大小：集合类型为元素个数，位图按每64字节计一个，其他类型为1，键不存在时为0。不更新访问时间
+    size_t elementCount(TransactionID tx_id, const Key& key);
+    // 批量读写：所有键所在分段的锁只获取一次。不存在或不是字符串的键返回空串
+    std::vector<Value> mget(TransactionID tx_id, const std::vector<Key>& keys);
+    bool mset(TransactionID tx_id, const std::vector<std::pair<Key, Value>>& pairs);
+    // 任一键已存在时不写入任何键并返回false
+    bool msetnx(TransactionID tx_id, const std::vector<std::pair<Key, Value>>& pairs);
     bool expire(TransactionID tx_id, const Key& key, int64_t seconds);
     int64_t ttl(TransactionID tx_id, const Key& key);
     
@@ -64,39 +198,142 @@ public:
     int64_t decr(TransactionID tx_id, const Key& key);
     
     // 数据库管理
-    void flush();
+    // async为true时把各分段换成空表，旧表交给后台线程释放，持有全部分段锁的时间与键数无关
+    void flush(bool async = false);
     size_t size() const;
     std::vector<Key> keys() const;
+    // 游标遍历键空间，不支持事务。游标低位为分段序号，其余位为分段内哈希表的游标，
+    // 每个分段只在访问期间持有读锁；对未过期的键调用fn（持锁期间调用，fn内不要再访问存储引擎），
+    // 返回数量达到count或已访问count*10个组后返回。返回下一次调用的游标，0表示遍历结束
+    size_t scan(size_t cursor, size_t count, const std::function<void(const SharedKey&, const DataItem&)>& fn) const;
+    // 按读取视图遍历，对每个键在read_view下可见且未过期的版本调用fn，游标与返回值同上
+    size_t scan(const ReadView& read_view, size_t cursor, size_t count,
+                const std::function<void(const SharedKey&, const DataItem&)>& fn) const;
+    // 只遍历一个分段，cursor为分段内游标，返回0表示该分段遍历结束。不同分段可以由多个线程并行遍历。
+    // 写时复制快照进行中时遍历的是快照时刻复制的内容，只供保存快照使用
+    size_t scanSegment(const ReadView& read_view, size_t segment, size_t cursor, size_t count,
+                       const std::function<void(const SharedKey&, const DataItem&)>& fn) const;
+    size_t segmentCount() const { return inner_storage_.segmentCount(); }
+    size_t segmentIndex(const Key& key) const { return inner_storage_.segmentIndex(key); }
+    // 从随机位置游标遍历一次，用于近似淘汰的采样；键空间较小时返回的键可能少于count，也可能多于count
+    void sampleKeys(size_t count, const std::function<void(const SharedKey&, const DataItem&)>& fn) const;
     
+    // 持有全部分段写锁直到返回的对象析构，期间本线程执行的命令不再逐个加锁，见KeyspaceLock
+    KeyspaceLock lockKeyspace() const { return KeyspaceLock(inner_storage_); }
+
     // 统计信息
     uint64_t getTotalKeys() const;
     uint64_t getExpiredKeys() const;
+    KeyspaceStats getKeyspaceStats() const;
     
-    // 清理过期键和空键
-    void cleanupExpiredKeys();
-    void cleanupEmptyKey();
+    // 主动过期：顺带推进各分段的渐进式rehash，再从各分段的过期索引中删除已到期的键，
+    // 工作量与到期键数成正比。时间预算用尽且仍有到期键时返回true，调用方据此加大清理力度
+    bool cleanupExpiredKeys(std::chrono::microseconds budget = EXPIRE_CYCLE_BUDGET);
+
+    // 渐进式回收MVCC历史版本，从上次的游标继续访问至多groups个组，逐个分段持有写锁。
+    // 释放回收水位线之前的旧版本和已回滚事务的版本，移除对所有读取视图都已删除的键。返回释放的版本数
+    size_t purgeVersions(size_t groups = PURGE_GROUPS_PER_TICK);
+    MVCCStats getMVCCStats() const;
+
+    // 主动碎片整理：从上次的游标继续遍历键空间，把位于稀疏slab中的数据项（见SlabAllocator::shouldRelocate）
+    // 复制到最满的slab中并替换原对象，使稀疏的slab腾空后归还系统。逐个分段持有写锁，
+    // 只搬移没有历史版本、未溢出到磁盘、不属于进行中事务的数据项。时间预算用尽时返回true
+    bool activeDefragCycle(std::chrono::microseconds budget = DEFRAG_CYCLE_BUDGET);
+    DefragStats getDefragStats() const;
+
+    // 估算键占用的内存字节数：键空间槽位、键名、数据项及其MVCC历史版本、过期时间旁路表中的条目。
+    // 大集合只计算前samples个元素并按元素数外推，samples为0时计算全部元素。键不存在时返回空
+    std::optional<size_t> memoryUsage(const Key& key, size_t samples = MEMORY_USAGE_SAMPLES) const;
+    // 键空间内存采样：从上次的游标继续遍历键空间，按数据类型累计键数与估算的内存并记录每种类型最大的键，
+    // 一轮遍历结束时发布结果。逐个分段持有读锁，时间预算用尽时返回true
+    bool memorySampleCycle(std::chrono::microseconds budget = MEMORY_SAMPLE_CYCLE_BUDGET);
+    MemorySampleReport getMemorySampleReport() const;
+    // 上一轮遍历结束时最长的版本链与保留的历史版本总数，不获取锁，供监控读取
+    size_t getMVCCMaxChainLength() const { return mvcc_max_chain_length_.load(std::memory_order_relaxed); }
+    size_t getMVCCHistoryVersions() const { return mvcc_history_versions_.load(std::memory_order_relaxed); }
     
     // RDB持久化
+    // 保存快照，已有快照在保存时等待其完成。快照以开始时的读取视图为准，期间提交的事务不会写入；
+    // 按块遍历键空间，每块只在访问期间持有一个分段的读锁，写文件时不持有锁
     bool saveRDB(const std::string& filename);
+    // 在后台线程保存快照，已有快照在保存时返回false
+    bool saveRDBInBackground(const std::string& filename);
+    RDBSaveStats getRDBSaveStats() const;
     bool loadRDB(const std::string& filename);
+    // 把快照写入输出流（如RAFT快照的内存缓冲区），不经过磁盘
+    bool saveRDBToStream(std::ostream& out);
+    // 写时复制快照：beginSnapshot固定当前内容后立即返回，已有快照在保存时返回false；
+    // 之后的写入在首次修改某个键前复制该键（见InnerStorage::beginCapture），不影响快照内容。
+    // beginSnapshot成功后必须调用一次saveSnapshot，可以在其他线程把固定的内容写入输出流并结束快照
+    bool beginSnapshot();
+    bool saveSnapshot(std::ostream& out);
+    // 从内存中的RDB数据加载
+    bool loadRDBFromMemory(std::string_view data);
+    // 后台加载RDB文件：读取索引后立即返回，数据块由threads个后台线程载入（见RDBLoader）。
+    // 文件不是版本12时返回false，由调用方同步加载。在处理命令之前、恢复模式之外调用
+    bool loadRDBInBackground(const std::string& filename, size_t threads);
+    // 后台加载尚未完成时键空间不完整，遍历整个键空间的命令应拒绝执行
+    bool rdbLoading() const;
+    // 载入keys所在的、尚未载入的数据块，后台加载期间在命令执行前调用
+    void loadRDBKeys(const std::vector<Key>& keys);
+    // 在调用线程载入剩余的数据块，保存快照前调用
+    void finishRDBLoad();
+    RDBLoadStats getRDBLoadStats() const;
+    // RDB并行保存/加载与AOF并行重放的线程数，0表示按CPU核数，实际线程数不超过分段数
+    void setRDBThreads(size_t threads);
+    size_t getRDBThreads() const;
+    // 保存RDB（含RAFT快照）时数据块的压缩算法，加载时按文件头自动识别
+    void setRDBCompression(RDBCompression compression) { rdb_compression_ = compression; }
+    RDBCompression getRDBCompression() const { return rdb_compression_; }
+    // 哪些删除交给后台线程释放，在处理命令之前设置
+    void setLazyFreeConfig(const LazyFreeConfig& config) { lazyfree_config_ = config; }
+    const LazyFreeConfig& getLazyFreeConfig() const { return lazyfree_config_; }
+    LazyFreer& lazyFreer() { return lazy_freer_; }
+
+    // 分层存储：冷数据的值移到磁盘日志，键和元数据留在内存。在处理命令之前启用，创建日志文件失败时返回false
+    bool enableTieredStorage(const TieredConfig& config);
+    bool tieredEnabled() const { return tier_ != nullptr; }
+    TieredStats getTieredStats() const;
+    // 把键的值移到磁盘。键不存在、已在磁盘上、有未清理的历史版本或属于未结束的事务、
+    // 空闲时间不足或值太小时返回false
+    bool spill(const Key& key);
+    // 把键中值在磁盘上的同步载入内存，返回载入的键数。命令执行前调用，保证命令看到原类型的数据项
+    size_t loadSpilled(const std::vector<Key>& keys);
+    // 键中有值在磁盘上时交给后台线程读取，载入后在该线程上调用done并返回true；都在内存中时返回false，不调用done
+    bool loadSpilledAsync(const std::vector<Key>& keys, std::function<void()> done);
+    // 恢复模式，启动时加载RDB/AOF期间打开：分段锁不再加锁，调用方保证每个分段同一时刻只有一个线程写入
+    void setRecoveryMode(bool enabled) { inner_storage_.setRecoveryMode(enabled); }
+    bool inRecoveryMode() const { return inner_storage_.inRecoveryMode(); }
+    // 批量写入同一分段的数据项（RDB加载专用），只加一次分段写锁。items中的键必须都属于segment，调用后被清空
+    void loadSegment(size_t segment, std::vector<std::pair<Key, std::unique_ptr<DataItem>>>& items);
     
     // 哈希操作
     bool hset(TransactionID tx_id, const Key& key, const Value& field, const Value& value);
     std::string hget(TransactionID tx_id, const Key& key, const Value& field);
+    // 在一次加锁内设置多个字段，返回成功写入的字段数
+    size_t hmset(TransactionID tx_id, const Key& key, const std::vector<std::pair<Value, Value>>& fields);
+    std::vector<Value> hmget(TransactionID tx_id, const Key& key, const std::vector<Value>& fields);
     std::vector<std::pair<Value, Value>> hgetall(TransactionID tx_id, const Key& key);
     bool hdel(TransactionID tx_id, const Key& key, const Value& field);
     bool hexists(TransactionID tx_id, const Key& key, const Value& field);
     std::vector<Value> hkeys(TransactionID tx_id, const Key& key);
     std::vector<Value> hvals(TransactionID tx_id, const Key& key);
     size_t hlen(TransactionID tx_id, const Key& key);
+    // 游标遍历字段，键不存在或类型不符时返回0
+    size_t hscan(TransactionID tx_id, const Key& key, size_t cursor, size_t count, std::vector<std::pair<Value, Value>>& out);
     
     // 列表操作
     size_t lpush(TransactionID tx_id, const Key& key, const Value& value);
     size_t rpush(TransactionID tx_id, const Key& key, const Value& value);
     std::string lpop(TransactionID tx_id, const Key& key);
     std::string rpop(TransactionID tx_id, const Key& key);
+    // 从source的一端弹出元素推入destination的一端，返回移动的元素，source为空或destination不是列表时返回空串。
+    // 两个键在同一批锁内修改，其他客户端看不到元素已弹出但尚未推入的状态
+    std::string lmove(TransactionID tx_id, const Key& source, const Key& destination, bool from_left, bool to_left);
     size_t llen(TransactionID tx_id, const Key& key);
     std::vector<Value> lrange(TransactionID tx_id, const Key& key, size_t start, size_t stop);
+    bool lindex(TransactionID tx_id, const Key& key, int64_t index, Value& value);
+    bool lset(TransactionID tx_id, const Key& key, int64_t index, const Value& value);
     
     // 集合操作
     size_t sadd(TransactionID tx_id, const Key& key, const std::vector<Value>& members);
@@ -104,6 +341,11 @@ public:
     std::vector<Value> smembers(TransactionID tx_id, const Key& key);
     bool sismember(TransactionID tx_id, const Key& key, const Value& member);
     size_t scard(TransactionID tx_id, const Key& key);
+    size_t sscan(TransactionID tx_id, const Key& key, size_t cursor, size_t count, std::vector<Value>& out);
+    // 多个集合的交集、并集或差集，不存在的键视为空集合；有键不是集合时返回false
+    bool setOp(TransactionID tx_id, SetOp op, const std::vector<Key>& keys, std::vector<Value>& members);
+    // 把运算结果保存到destkey，count为结果的元素个数，结果为空时删除destkey；有源键不是集合时返回false
+    bool setOpStore(TransactionID tx_id, SetOp op, const Key& destkey, const std::vector<Key>& keys, size_t& count);
     
     // 有序集合操作
     size_t zadd(TransactionID tx_id, const Key& key, const std::vector<std::pair<Value, double>>& members_with_scores);
@@ -118,18 +360,40 @@ public:
     std::vector<std::pair<Value, double>> zrevrangebyscore(TransactionID tx_id, const Key& key, double max, double min);
     size_t zcount(TransactionID tx_id, const Key& key, double min, double max);
     size_t zcard(TransactionID tx_id, const Key& key);
+    size_t zscan(TransactionID tx_id, const Key& key, size_t cursor, size_t count, std::vector<std::pair<Value, double>>& out);
+    // 有序集合的并集或交集（op为UNION或INTER）保存到destkey，weights与keys一一对应，不存在的键视为空集合。
+    // count为结果的元素个数，结果为空时删除destkey；有源键不是有序集合时返回false
+    bool zsetOpStore(TransactionID tx_id, SetOp op, const Key& destkey, const std::vector<Key>& keys,
+                     const std::vector<double>& weights, ZSetAggregate aggregate, size_t& count);
+    // 把source中range范围内的元素保存到destkey，规则同zsetOpStore
+    bool zrangestore(TransactionID tx_id, const Key& destkey, const Key& source, const ZRangeSpec& range, size_t& count);
     
     // 位图操作
     bool setBit(TransactionID tx_id, const Key& key, size_t offset, bool value);
     bool getBit(TransactionID tx_id, const Key& key, size_t offset);
     size_t bitCount(TransactionID tx_id, const Key& key);
     size_t bitCount(TransactionID tx_id, const Key& key, size_t start, size_t end);
+    int64_t bitPos(TransactionID tx_id, const Key& key, bool bit, size_t start, std::optional<size_t> end);
+    // 在同一次加锁中依次执行所有子命令，只有GET时加读锁
+    std::vector<std::optional<int64_t>> bitField(TransactionID tx_id, const Key& key, const std::vector<BitFieldOp>& ops);
     bool bitOp(TransactionID tx_id, const std::string& operation, const Key& destkey, const std::vector<Key>& keys);
     
     // HyperLogLog操作
     bool pfadd(TransactionID tx_id, const Key& key, const std::vector<Value>& elements);
+    bool pfadd(TransactionID tx_id, const Key& key, const Value* elements, size_t count);
     uint64_t pfcount(TransactionID tx_id, const Key& key);
+    // 多个键并集的基数估计值，不存在的键视为空
+    uint64_t pfcount(TransactionID tx_id, const std::vector<Key>& keys);
     bool pfmerge(TransactionID tx_id, const Key& destkey, const std::vector<Key>& sourcekeys);
+
+    // 布隆过滤器操作
+    // 按指定参数创建过滤器，expansion为0时不扩展；键已存在时返回false
+    bool bfreserve(TransactionID tx_id, const Key& key, double error_rate, uint64_t capacity, uint32_t expansion);
+    // 键不存在时按默认参数创建，结果为BloomFilterItem::AddResult；键不是布隆过滤器时返回false
+    bool bfadd(TransactionID tx_id, const Key& key, const Value* elements, size_t count, std::vector<int>& results);
+    // 不存在的键视为空过滤器；键不是布隆过滤器时返回false
+    bool bfexists(TransactionID tx_id, const Key& key, const Value* elements, size_t count, std::vector<bool>& results);
+    uint64_t bfcard(TransactionID tx_id, const Key& key);
     
     // 获取数据项
     DataItem* getDataItem(TransactionID tx_id, const Key& key);
@@ -138,12 +402,12 @@ public:
     void setDataItem(const Key& key, std::unique_ptr<DataItem> item);
     
     // 淘汰策略相关方法
-    std::vector<Key> getAllKeys() const; // 获取所有键
+    std::vector<SharedKey> getAllKeys() const; // 获取所有键的句柄
     bool hasExpiration(const Key& key) const; // 检查键是否有过期时间
     Timestamp getLastAccessed(const Key& key) const; // 获取键的最后访问时间
     int getAccessFrequency(const Key& key) const; // 获取键的访问频率
     Timestamp getExpiration(const Key& key) const; // 获取键的过期时间
-    size_t getKeySize(const Key& key) const; // 获取键的大小
+    size_t getKeySize(const Key& key) const; // 获取键占用的内存，见memoryUsage
     
 private:
     // 内部辅助方法
@@ -164,6 +428,24 @@ private:
     std::unique_ptr<DataItem> createHyperLogLogItem();
     std::unique_ptr<DataItem> createHyperLogLogItem(Timestamp expire_time);
     ReadView getReadView(TransactionID tx_id) const;
+    // read_view为空时访问各键的最新版本
+    size_t scanImpl(const ReadView* read_view, size_t cursor, size_t count,
+                    const std::function<void(const SharedKey&, const DataItem&)>& fn) const;
+    // 持有分段读锁从table_cursor继续遍历，emitted达到count或visits用尽后返回分段内游标
+    size_t scanSegmentImpl(const ReadView* read_view, size_t segment, size_t table_cursor, size_t count,
+                           size_t& emitted, size_t& visits,
+                           const std::function<void(const SharedKey&, const DataItem&)>& fn) const;
+    // 标记开始保存快照，wait为false且已有快照在保存时返回false
+    bool beginRDBSave(bool wait);
+    // 固定读取视图调用save保存快照，并在结束时清除保存标记
+    bool doSaveRDB(const std::function<bool(const ReadView&)>& save);
+    // 记录保存结果并清除保存标记
+    bool endRDBSave(bool success, std::chrono::steady_clock::time_point start);
+    // 获取要修改的集合类型数据项。非事务操作直接修改可见版本；
+    // 事务操作修改当前事务的最新版本，delta非空时需在修改前把逆操作追加到delta->deltas
+    DataItem* getWritableItem(TransactionID tx_id, const Key& key, DataType type, UndoLog*& delta);
+    // 删除元素后集合类型数据项为空时，在同一次写入中删除键。调用方持有键的写锁，删除后item不再可用
+    void removeIfEmpty(TransactionID tx_id, const Key& key, const DataItem* item);
 };
 
 // 数据项工厂
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "../dkv_core.hpp"
+#include "../datatypes/dkv_datatype_base.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dkv {
+
+// 分层存储配置，对应配置项tiered_*
+struct TieredConfig {
+    bool enabled = false;
+    std::string path = "dkv_tier.log"; // 冷数据日志文件，每次启动时重建，持久化仍由RDB/AOF负责
+    size_t min_spill_size = 128;       // 序列化后小于该字节数的值留在内存，移出省下的内存不够抵消元数据
+    uint32_t min_idle_ms = 1000;       // 空闲不足该时长的值不移出，避免移出刚为命令载入的值
+};
+
+// 分层存储统计信息
+struct TieredStats {
+    size_t spilled_keys = 0;  // 值在磁盘上的键数
+    size_t live_bytes = 0;    // 日志中仍被引用的字节数
+    uint64_t log_bytes = 0;   // 日志已写入的字节数，已释放的记录在文件中打洞回收空间
+    uint64_t spills = 0;      // 累计移出次数
+    uint64_t loads = 0;       // 累计载入次数
+    uint64_t async_loads = 0; // 其中经后台读取线程载入的次数
+    uint64_t load_errors = 0; // 读取失败次数
+};
+
+// 日志中的一条记录。偏移只增不减，同一偏移不会被两条记录使用
+struct SpillRef {
+    uint64_t offset = 0;
+    uint32_t length = 0;
+};
+
+class TieredStore;
+class IoUring;
+
+// 值在磁盘上的数据项：保留类型、过期时间、LRU/LFU和事务ID，值本身在TieredStore的日志中。
+// 命令执行前由StorageEngine::loadSpilled换回原类型的数据项；serialize从日志读取，
+// RDB保存和分片迁移不必先载入。析构时释放日志中的记录
+class SpilledItem : public DataItem {
+public:
+    SpilledItem(const DataItem& original, SpillRef ref, TieredStore* store);
+    ~SpilledItem() override;
+
+    DataType getType() const override { return type_; }
+    // 从日志读取值，读取失败时抛出std::runtime_error，RDB保存和分片迁移因此中止
+    std::string serialize() const override;
+    void deserialize(const std::string& data) override;
+    // 克隆得到载入后的原类型数据项
+    std::unique_ptr<DataItem> clone() const override;
+    std::unique_ptr<DataItem> cloneEmpty() const override;
+    size_t memoryUsage(size_t samples) const override;
+    const char* encodingName() const override;
+
+    const SpillRef& ref() const { return ref_; }
+
+private:
+    DataType type_;
+    SpillRef ref_;
+    TieredStore* store_;
+};
+
+// 分层存储：把冷数据的值追加写入磁盘上的日志文件，内存中的键空间只保留SpilledItem。
+// 同步读取用pread；异步读取交给后台线程，优先用io_uring批量提交，不支持时退回pread。
+// 必须比引用它的SpilledItem活得久
+class TieredStore {
+public:
+    using ReadCallback = std::function<void(std::vector<std::string>& data, std::vector<bool>& ok)>;
+
+    explicit TieredStore(const TieredConfig& config);
+    ~TieredStore();
+
+    TieredStore(const TieredStore&) = delete;
+    TieredStore& operator=(const TieredStore&) = delete;
+
+    // 创建（或清空）日志文件
+    bool open();
+    const TieredConfig& config() const { return config_; }
+
+    // 把数据项的值写入日志并返回替代它的SpilledItem；值太小、序列化后达到4GiB或写入失败时返回空
+    std::unique_ptr<DataItem> spill(const DataItem& item);
+    // 同步读取SpilledItem的值，返回原类型的数据项，读取失败时返回空
+    std::unique_ptr<DataItem> load(const SpilledItem& item);
+    // 用读到的值构造原类型的数据项，接管SpilledItem的元数据
+    std::unique_ptr<DataItem> materialize(const SpilledItem& item, const std::string& data);
+    // 在后台线程读取多条记录，全部完成后在该线程上调用done
+    void readAsync(std::vector<SpillRef> refs, ReadCallback done);
+
+    bool read(const SpillRef& ref, std::string& data);
+    // 记录不再被引用，在文件中打洞释放磁盘空间
+    void release(const SpillRef& ref);
+
+    TieredStats stats() const;
+    void recordAsyncLoad() { async_loads_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    struct ReadRequest {
+        std::vector<SpillRef> refs;
+        ReadCallback done;
+    };
+
+    void readerThread();
+    // 用io_uring读取一批请求，ring为空或读取不完整时逐条pread。返回ring之后是否仍可使用
+    bool readBatch(std::vector<ReadRequest>& batch, IoUring* ring);
+
+    TieredConfig config_;
+    int fd_ = -1;
+
+    mutable std::mutex append_mutex_;
+    uint64_t end_ = 0; // 由append_mutex_保护
+
+    std::atomic<size_t> live_records_{0};
+    std::atomic<size_t> live_bytes_{0};
+    std::atomic<uint64_t> spills_{0};
+    std::atomic<uint64_t> loads_{0};
+    std::atomic<uint64_t> async_loads_{0};
+    std::atomic<uint64_t> load_errors_{0};
+
+    // 后台读取线程，第一次异步读取时启动
+    std::mutex read_mutex_;
+    std::condition_variable read_cv_;
+    std::deque<ReadRequest> requests_;
+    bool stopping_ = false;
+    std::thread reader_;
+};
+
+} // namespace dkv
@@ -6,6 +6,7 @@
 #include "dkv_transaction_manager.hpp"
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <atomic>
 
@@ -13,11 +14,29 @@ namespace dkv {
 class StorageEngine;
 class InnerStorage;
 
+// 单个键的历史版本回收结果
+struct PurgeResult {
+    size_t chain_length = 0; // 回收后的版本链长度（含最新版本）
+    size_t purged = 0;       // 释放的版本数
+    bool removable = false;  // 只剩对所有读取视图可见的删除标记，键可以整体移除
+};
+
+// MVCC历史版本统计
+struct MVCCStats {
+    uint64_t purged_versions = 0;    // 累计释放的版本数
+    uint64_t purge_passes = 0;       // 已完成的完整遍历轮数
+    size_t versioned_keys = 0;       // 上一轮遍历结束时带有历史版本的键数
+    size_t history_versions = 0;     // 上一轮遍历结束时保留的历史版本总数（不含最新版本）
+    size_t max_chain_length = 0;     // 上一轮遍历结束时最长的版本链
+    TransactionID purge_horizon = 0; // 当前回收水位线
+    uint64_t purge_lag = 0;          // 下一个事务ID与回收水位线之差，长事务会使其持续增大
+    size_t pending_rollbacks = 0;    // 仍计入读取视图的已回滚事务数
+};
+
 // MVCC类，提供多版本并发控制
 class MVCC {
 private:
     InnerStorage& inner_storage_; // 内部存储引用
-    std::unordered_map<Key, UndoLog> undo_log_;
 public:
     // 构造函数，接收InnerStorage作为参数
     explicit MVCC(InnerStorage& inner_storage)
@@ -33,13 +52,34 @@ public:
     MVCC& operator=(MVCC&&) = delete;
 
     // 获取指定事务可见的版本
-    DataItem* get(const ReadView& read_view, const Key& key) const;
+    DataItem* get(const ReadView& read_view, std::string_view key) const;
 
     // 设置键值，并记录到UNDOLOG
     bool set(TransactionID tx_id, const Key& key, std::unique_ptr<DataItem> item);
 
     // 删除键，并记录到UNDOLOG
     bool del(TransactionID tx_id, const Key& key);
+
+    // 事务内原地修改集合类型前调用，返回要修改的版本，键对事务不可见时返回nullptr，类型不符时原样返回。
+    // 最新版本已提交时由当前事务接管为新版本，上一个版本只保留元数据；
+    // delta非空时调用方需要在修改前把逆操作追加到delta->deltas，旧读取视图据此还原内容
+    DataItem* prepareWrite(TransactionID tx_id, const Key& key, const ReadView& read_view,
+                           DataType type, UndoLog*& delta);
+
+    // 逆序应用增量记录，把较新版本的内容还原为上一个版本
+    static void applyUndo(DataItem& item, const std::vector<UndoDelta>& deltas);
+
+    // 回收一个键的历史版本，要求调用方持有键所在分段的写锁。
+    // 已回滚事务（带丢弃标记或在rolledback中）写入的版本直接摘除；
+    // 从最新版本向旧版本找到第一个事务ID小于horizon的版本，所有读取视图最多读到它，更旧的版本全部释放
+    static PurgeResult purge(std::unique_ptr<DataItem>& entry, TransactionID horizon,
+                             const std::unordered_set<TransactionID>& rolledback);
+
+private:
+    // 原地撤销item的增量版本，使其成为上一个版本，要求调用方持有写锁
+    static void rewind(DataItem& item);
+    // 以base为起点依次应用pending中的增量，结果缓存在最后一条UndoLog中
+    static DataItem* materialize(const DataItem& base, const std::vector<UndoLog*>& pending);
 };
 
 } // namespace dkv
@@ -51,8 +91,10 @@ inline std::ostream& operator<<(std::ostream& os, const dkv::ReadView& read_view
        << ", low=" << read_view.low
        << ", high=" << read_view.high
        << ", actives=[";
-    for (auto tx_id : read_view.actives) {
-        os << tx_id << " ";
+    if (read_view.actives) {
+        for (auto tx_id : *read_view.actives) {
+            os << tx_id << " ";
+        }
     }
     os << "]";
     return os;
@@ -63,8 +105,10 @@ inline std::stringstream& operator<<(std::stringstream& os, const dkv::ReadView&
        << ", low=" << read_view.low
        << ", high=" << read_view.high
        << ", actives=[";
-    for (auto tx_id : read_view.actives) {
-        os << tx_id << " ";
+    if (read_view.actives) {
+        for (auto tx_id : *read_view.actives) {
+            os << tx_id << " ";
+        }
     }
     os << "]";
     return os;
@@ -1,21 +1,32 @@
 #ifndef DKV_TRANSACTION_HPP
 #define DKV_TRANSACTION_HPP
 #include "../dkv_core.hpp"
+#include "../storage/dkv_shared_key.hpp"
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace dkv {
 
+// 读取视图。actives指向事务管理器发布的不可变快照（升序），多个读取视图共享同一份快照，创建时不复制。
+// low为actives中的最小值，actives为空时等于high
 struct ReadView {
-    TransactionID creator;
-    TransactionID low, high;
-    std::vector<TransactionID> actives;
+    TransactionID creator = NO_TX;
+    TransactionID low = 0, high = 0;
+    std::shared_ptr<const std::vector<TransactionID>> actives;
     bool isVisible(TransactionID tx_id) const;
 };
 
+// WATCH监视的键。since为开始监视时的提交序号，之后提交的修改会使EXEC失败
+struct WatchedKeys {
+    uint64_t since = 0;
+    std::vector<Key> keys;
+};
+
 struct TransactionRecordVersion {
-    std::string key;
+    SharedKey key; // 与键空间共享同一份键
     DataItem* item; // Safety: Dont access version if storage is destroyed or transaction is rolled back and purged.
 };
 
@@ -23,18 +34,36 @@ class Transaction {
 public:
     Transaction(TransactionID transaction_id, ReadView read_view);
     ~Transaction();
-    void push_version(const std::string& key, DataItem* item);
+    void push_version(const SharedKey& key, DataItem* item);
     const std::vector<TransactionRecordVersion>& get_versions() const;
     void push_command(const Command& command);
     const std::vector<Command>& get_commands() const;
     const ReadView& get_read_view() const;
 
+    // 可串行化隔离下提交时校验冲突用的读写集合
+    void record_read(const Key& key);
+    void record_write(const Key& key);
+    void record_keyspace_read();
+    const std::unordered_set<Key>& get_read_keys() const { return read_keys_; }
+    const std::unordered_set<Key>& get_write_keys() const { return write_keys_; }
+    bool reads_keyspace() const { return reads_keyspace_; }
+    uint64_t get_start_seq() const { return start_seq_; }
+    void set_start_seq(uint64_t seq) { start_seq_ = seq; }
+
+    // MULTI之前WATCH的键，提交时与提交校验在同一临界区内检查
+    void set_watched_keys(WatchedKeys watched_keys) { watched_keys_ = std::move(watched_keys); }
+    const WatchedKeys& get_watched_keys() const { return watched_keys_; }
+
 private:
     TransactionID transaction_id_;               // 事务ID，用于MVCC
     Timestamp start_timestamp_;                   // 事务开始时间戳
     ReadView read_view_; // 事务开始时的读取视图
     std::vector<TransactionRecordVersion> versions_; // 本事务更新的所有数据项版本。
     std::vector<Command> commands_; // 本事务执行的所有命令。
+    uint64_t start_seq_ = 0; // 事务开始时的提交序号，之后提交的写入对本事务的读取视图不可见
+    std::unordered_set<Key> read_keys_, write_keys_; // 本事务读取和写入的键
+    bool reads_keyspace_ = false; // 是否执行过遍历整个键空间的读取（SCAN、DBSIZE）
+    WatchedKeys watched_keys_; // 本事务开始前客户端监视的键
 };
 
 } // namespace dkv
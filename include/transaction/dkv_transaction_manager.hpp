@@ -6,9 +6,12 @@
 #include "dkv_mvcc.hpp"
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <set>
 #include <mutex>
 #include <atomic>
 #include <algorithm>
+#include <memory>
 namespace dkv {
 
 class StorageEngine;
@@ -26,9 +29,21 @@ public:
     // 开始事务
     TransactionID begin();
 
-    // 提交/回滚事务
+    // 提交/回滚事务。可串行化隔离下提交前校验读写集合，事务监视的键被修改过时同样回滚，
+    // 冲突时回滚并返回false
     bool commit(TransactionID transaction_id);
     bool rollback(TransactionID transaction_id);
+
+    // 记录命令访问的键，在命令执行后调用。事务内的写命令记入事务的写集合，可串行化隔离下读命令记入读集合；
+    // 可串行化隔离或存在WATCH时，非事务的写命令直接登记为一次提交
+    void trackCommand(TransactionID transaction_id, const Command& command);
+
+    // WATCH：返回当前提交序号作为监视起点。监视期间每次写入提交都会记录写入键的提交序号，
+    // 直到对应的unwatch
+    uint64_t watch();
+    void unwatch(uint64_t since);
+    // 监视的键自开始监视以来是否被修改过
+    bool isWatchedKeysModified(const WatchedKeys& watched_keys) const;
     
     const Transaction& getTransaction(TransactionID transaction_id) const;
     Transaction& getTransactionMut(TransactionID transaction_id);
@@ -39,6 +54,12 @@ public:
     // 查询事务是否已回滚
     bool isRolledback(TransactionID transaction_id) const;
     std::vector<TransactionID> getRolledbackTransactions() const;
+    // 历史版本已全部清理后，不再把这些回滚事务计入读取视图
+    void forgetRolledbackTransactions(const std::vector<TransactionID>& transaction_ids);
+
+    // 回收水位线：事务ID小于它的已提交版本对所有现存和将来的读取视图都可见，
+    // 更早的历史版本可以被清理。取活跃事务ID与活跃事务读取视图下界中的最小值，没有活跃事务时为下一个事务ID
+    TransactionID getPurgeHorizon() const;
 
     TransactionID peekNextTransactionID() const {
         return transaction_id_generator_.load();
@@ -47,8 +68,17 @@ public:
     // 获取事务的读取视图
     ReadView getReadView(TransactionID transaction_id) const;
 
+    // 基于当前发布的活跃事务快照创建读取视图，不加锁、不复制活跃事务集合
     ReadView createReadView(TransactionID transaction_id) const;
 private:
+    // 活跃事务快照：活跃与已回滚事务ID的升序数组及发布时的下一个事务ID。
+    // 事务开始、提交和回滚事务被清除时复制修改后整体替换（类似RCU），已发布的快照不再修改，
+    // 读取视图持有快照的引用计数，旧快照在最后一个读取视图释放后回收
+    struct ActiveSnapshot {
+        std::vector<TransactionID> ids;
+        TransactionID high = 0;
+    };
+
     StorageEngine* storage_engine_;              // 存储引擎指针
 
     const TransactionIsolationLevel isolation_level_;
@@ -57,6 +87,39 @@ private:
     mutable std::mutex active_transactions_mutex_, rollback_transactions_mutex_;
     std::unordered_map<TransactionID, Transaction> active_transactions_, rollback_transactions_;
 
+    // 当前发布的快照，通过std::atomic_load/atomic_store读写，修改方持有active_transactions_mutex_
+    std::shared_ptr<const ActiveSnapshot> snapshot_;
+
+    // 可串行化隔离的提交校验（乐观并发控制），均由active_transactions_mutex_保护。
+    // 每次写入提交分配递增的提交序号并记录到写入的键上，事务提交时若读写过的键在其开始之后
+    // 被其他提交修改过则判定冲突。只对同一个键的访问互相排斥，访问不相交键的事务可以并发执行
+    static constexpr size_t KEY_COMMIT_SEQS_PRUNE_THRESHOLD = 1024;
+    uint64_t commit_seq_ = 0;     // 最近一次写入提交的序号
+    uint64_t flush_seq_ = 0;      // 最近一次修改整个键空间（FLUSHDB、EVALX、EVALSHA）的提交序号
+    std::unordered_map<Key, uint64_t> key_commit_seqs_; // 键最近一次被修改的提交序号
+    size_t key_commit_seqs_prune_threshold_ = KEY_COMMIT_SEQS_PRUNE_THRESHOLD;
+    // 各客户端开始监视时的提交序号。不为空时其他隔离级别也记录键的提交序号，
+    // 计数供非事务写入在不加锁的情况下判断是否需要登记
+    std::multiset<uint64_t> watch_seqs_;
+    std::atomic<size_t> watch_count_{0};
+
+    // 以下函数要求调用方持有active_transactions_mutex_
+    bool rollbackLocked(TransactionID transaction_id);
+    bool validateLocked(const Transaction& transaction) const;
+    bool isModifiedSinceLocked(const Key& key, uint64_t since) const;
+    bool isWatchedKeysModifiedLocked(const WatchedKeys& watched_keys) const;
+    // 是否需要记录写入键的提交序号
+    bool tracksCommitSeqsLocked() const {
+        return isolation_level_ == TransactionIsolationLevel::SERIALIZABLE || !watch_seqs_.empty();
+    }
+    void recordCommitLocked(const std::unordered_set<Key>& keys, bool whole_keyspace);
+    // 删除序号不大于所有活跃事务开始序号和监视起点的记录，它们不会再与任何事务冲突
+    void pruneCommitSeqsLocked();
+
+    // 以当前快照为基础插入或删除事务ID后发布新快照，要求调用方持有active_transactions_mutex_
+    void publishSnapshotLocked(TransactionID added, const std::vector<TransactionID>& removed);
+    static ReadView makeReadView(const std::shared_ptr<const ActiveSnapshot>& snapshot, TransactionID transaction_id);
+
     TransactionID nextTransactionId() {
         return transaction_id_generator_.fetch_add(1);
     }
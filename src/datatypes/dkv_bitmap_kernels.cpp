@@ -0,0 +1,345 @@
+#include "datatypes/dkv_bitmap_kernels.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DKV_BITMAP_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DKV_BITMAP_NEON 1
+#endif
+
+namespace dkv {
+
+namespace {
+
+inline uint64_t loadWord(const uint8_t* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+inline uint64_t applyOp(BitmapOp op, uint64_t a, uint64_t b) {
+    switch (op) {
+        case BitmapOp::AND: return a & b;
+        case BitmapOp::OR:  return a | b;
+        default:            return a ^ b;
+    }
+}
+
+// 通用实现：按64位字处理，不足一个字的尾部按字节处理
+
+size_t popcountScalar(const uint8_t* data, size_t len) {
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        count += __builtin_popcountll(loadWord(data + i));
+    }
+    for (; i < len; ++i) {
+        count += __builtin_popcount(data[i]);
+    }
+    return count;
+}
+
+// 从offset开始按字节合并，用于各SIMD实现处理尾部
+void combineTail(BitmapOp op, uint8_t* dst, const uint8_t* const* srcs, size_t count, size_t offset, size_t len) {
+    for (size_t i = offset; i < len; ++i) {
+        uint8_t value = srcs[0][i];
+        for (size_t k = 1; k < count; ++k) {
+            value = static_cast<uint8_t>(applyOp(op, value, srcs[k][i]));
+        }
+        dst[i] = value;
+    }
+}
+
+void combineScalar(BitmapOp op, uint8_t* dst, const uint8_t* const* srcs, size_t count, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t value = loadWord(srcs[0] + i);
+        for (size_t k = 1; k < count; ++k) {
+            value = applyOp(op, value, loadWord(srcs[k] + i));
+        }
+        std::memcpy(dst + i, &value, sizeof(value));
+    }
+    combineTail(op, dst, srcs, count, i, len);
+}
+
+void invertScalar(uint8_t* dst, const uint8_t* src, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const uint64_t value = ~loadWord(src + i);
+        std::memcpy(dst + i, &value, sizeof(value));
+    }
+    for (; i < len; ++i) {
+        dst[i] = static_cast<uint8_t>(~src[i]);
+    }
+}
+
+size_t findScalar(const uint8_t* data, size_t len, uint8_t skip) {
+    const uint64_t pattern = 0x0101010101010101ULL * skip;
+    size_t i = 0;
+    while (i + 8 <= len && loadWord(data + i) == pattern) {
+        i += 8;
+    }
+    for (; i < len; ++i) {
+        if (data[i] != skip) {
+            return i;
+        }
+    }
+    return len;
+}
+
+#ifdef DKV_BITMAP_X86
+
+// AVX2：popcount按半字节查表（vpshufb），每个字节的计数最多累加8轮后用vpsadbw归约到64位
+
+__attribute__((target("avx2")))
+size_t popcountAvx2(const uint8_t* data, size_t len) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i total = zero;
+    size_t i = 0;
+    while (i + 32 <= len) {
+        __m256i local = zero;
+        for (int round = 0; round < 8 && i + 32 <= len; ++round, i += 32) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            const __m256i lo = _mm256_and_si256(v, low_mask);
+            const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+            local = _mm256_add_epi8(local, _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                                           _mm256_shuffle_epi8(lookup, hi)));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(local, zero));
+    }
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + popcountScalar(data + i, len - i);
+}
+
+__attribute__((target("avx2")))
+void combineAvx2(BitmapOp op, uint8_t* dst, const uint8_t* const* srcs, size_t count, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcs[0] + i));
+        for (size_t k = 1; k < count; ++k) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcs[k] + i));
+            value = op == BitmapOp::AND ? _mm256_and_si256(value, v)
+                  : op == BitmapOp::OR  ? _mm256_or_si256(value, v)
+                                        : _mm256_xor_si256(value, v);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), value);
+    }
+    combineTail(op, dst, srcs, count, i, len);
+}
+
+__attribute__((target("avx2")))
+void invertAvx2(uint8_t* dst, const uint8_t* src, size_t len) {
+    const __m256i ones = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(v, ones));
+    }
+    invertScalar(dst + i, src + i, len - i);
+}
+
+__attribute__((target("avx2")))
+size_t findAvx2(const uint8_t* data, size_t len, uint8_t skip) {
+    const __m256i pattern = _mm256_set1_epi8(static_cast<char>(skip));
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const uint32_t equal = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, pattern)));
+        if (equal != 0xffffffffu) {
+            return i + __builtin_ctz(~equal);
+        }
+    }
+    return i + findScalar(data + i, len - i, skip);
+}
+
+// AVX-512BW：与AVX2相同的查表方法，每次处理64字节。不依赖VPOPCNTDQ，Skylake-SP起的CPU都可用
+
+__attribute__((target("avx512f,avx512bw")))
+size_t popcountAvx512(const uint8_t* data, size_t len) {
+    // 每个128位通道放一份半字节查找表{0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4}。GCC的broadcast和reduce内建函数
+    // 以未定义值作直通操作数，会引发-Wuninitialized，这里直接按64位整数构造查找表并经内存求和
+    const __m512i lookup = _mm512_set4_epi64(0x0403030203020201LL, 0x0302020102010100LL,
+                                             0x0403030203020201LL, 0x0302020102010100LL);
+    const __m512i low_mask = _mm512_set1_epi8(0x0f);
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i total = zero;
+    size_t i = 0;
+    while (i + 64 <= len) {
+        __m512i local = zero;
+        for (int round = 0; round < 8 && i + 64 <= len; ++round, i += 64) {
+            const __m512i v = _mm512_loadu_si512(data + i);
+            const __m512i lo = _mm512_and_si512(v, low_mask);
+            const __m512i hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), low_mask);
+            local = _mm512_add_epi8(local, _mm512_add_epi8(_mm512_shuffle_epi8(lookup, lo),
+                                                           _mm512_shuffle_epi8(lookup, hi)));
+        }
+        total = _mm512_add_epi64(total, _mm512_sad_epu8(local, zero));
+    }
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7] +
+           popcountScalar(data + i, len - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void combineAvx512(BitmapOp op, uint8_t* dst, const uint8_t* const* srcs, size_t count, size_t len) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m512i value = _mm512_loadu_si512(srcs[0] + i);
+        for (size_t k = 1; k < count; ++k) {
+            const __m512i v = _mm512_loadu_si512(srcs[k] + i);
+            value = op == BitmapOp::AND ? _mm512_and_si512(value, v)
+                  : op == BitmapOp::OR  ? _mm512_or_si512(value, v)
+                                        : _mm512_xor_si512(value, v);
+        }
+        _mm512_storeu_si512(dst + i, value);
+    }
+    combineTail(op, dst, srcs, count, i, len);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void invertAvx512(uint8_t* dst, const uint8_t* src, size_t len) {
+    const __m512i ones = _mm512_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        _mm512_storeu_si512(dst + i, _mm512_xor_si512(_mm512_loadu_si512(src + i), ones));
+    }
+    invertScalar(dst + i, src + i, len - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+size_t findAvx512(const uint8_t* data, size_t len, uint8_t skip) {
+    const __m512i pattern = _mm512_set1_epi8(static_cast<char>(skip));
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        const __mmask64 differ = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(data + i), pattern);
+        if (differ != 0) {
+            return i + __builtin_ctzll(differ);
+        }
+    }
+    return i + findScalar(data + i, len - i, skip);
+}
+
+#endif // DKV_BITMAP_X86
+
+#ifdef DKV_BITMAP_NEON
+
+// NEON：vcnt逐字节计数，最多累加31轮后逐级两两相加到64位
+
+size_t popcountNeon(const uint8_t* data, size_t len) {
+    uint64x2_t total = vdupq_n_u64(0);
+    size_t i = 0;
+    while (i + 16 <= len) {
+        uint8x16_t local = vdupq_n_u8(0);
+        for (int round = 0; round < 31 && i + 16 <= len; ++round, i += 16) {
+            local = vaddq_u8(local, vcntq_u8(vld1q_u8(data + i)));
+        }
+        total = vpadalq_u32(total, vpaddlq_u16(vpaddlq_u8(local)));
+    }
+    return vaddvq_u64(total) + popcountScalar(data + i, len - i);
+}
+
+void combineNeon(BitmapOp op, uint8_t* dst, const uint8_t* const* srcs, size_t count, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t value = vld1q_u8(srcs[0] + i);
+        for (size_t k = 1; k < count; ++k) {
+            const uint8x16_t v = vld1q_u8(srcs[k] + i);
+            value = op == BitmapOp::AND ? vandq_u8(value, v)
+                  : op == BitmapOp::OR  ? vorrq_u8(value, v)
+                                        : veorq_u8(value, v);
+        }
+        vst1q_u8(dst + i, value);
+    }
+    combineTail(op, dst, srcs, count, i, len);
+}
+
+void invertNeon(uint8_t* dst, const uint8_t* src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        vst1q_u8(dst + i, vmvnq_u8(vld1q_u8(src + i)));
+    }
+    invertScalar(dst + i, src + i, len - i);
+}
+
+// 16字节中有不同的字节时再逐字节定位
+size_t findNeon(const uint8_t* data, size_t len, uint8_t skip) {
+    const uint8x16_t pattern = vdupq_n_u8(skip);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        if (vminvq_u8(vceqq_u8(vld1q_u8(data + i), pattern)) == 0) {
+            return i + findScalar(data + i, 16, skip);
+        }
+    }
+    return i + findScalar(data + i, len - i, skip);
+}
+
+#endif // DKV_BITMAP_NEON
+
+} // namespace
+
+const std::vector<BitmapKernels>& supportedBitmapKernels() {
+    static const std::vector<BitmapKernels> kernels = []() {
+        std::vector<BitmapKernels> list;
+#ifdef DKV_BITMAP_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+            list.push_back({"avx512", popcountAvx512, combineAvx512, invertAvx512, findAvx512});
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            list.push_back({"avx2", popcountAvx2, combineAvx2, invertAvx2, findAvx2});
+        }
+#endif
+#ifdef DKV_BITMAP_NEON
+        // AArch64上NEON总是可用
+        list.push_back({"neon", popcountNeon, combineNeon, invertNeon, findNeon});
+#endif
+        list.push_back({"scalar", popcountScalar, combineScalar, invertScalar, findScalar});
+        return list;
+    }();
+    return kernels;
+}
+
+const BitmapKernels& bitmapKernels() {
+    static const BitmapKernels& kernels = supportedBitmapKernels().front();
+    return kernels;
+}
+
+void bitmapCombine(BitmapOp op, std::vector<uint8_t>& dst, const std::vector<const std::vector<uint8_t>*>& srcs) {
+    // 按长度从长到短排列，前n个输入覆盖[0, 第n个的长度)
+    std::vector<const std::vector<uint8_t>*> sorted(srcs);
+    std::sort(sorted.begin(), sorted.end(), [](const std::vector<uint8_t>* a, const std::vector<uint8_t>* b) {
+        return a->size() > b->size();
+    });
+    const size_t max_size = sorted.empty() ? 0 : sorted.front()->size();
+    dst.resize(max_size);
+
+    const BitmapKernels& kernels = bitmapKernels();
+    std::vector<const uint8_t*> ptrs(sorted.size());
+    size_t begin = 0;
+    for (size_t n = sorted.size(); n > 0 && begin < max_size; --n) {
+        const size_t end = sorted[n - 1]->size();
+        if (end <= begin) {
+            continue;
+        }
+        if (op == BitmapOp::AND && n < sorted.size()) {
+            // 已有输入结束，与运算的结果从这里起全为0
+            std::fill(dst.begin() + begin, dst.end(), 0);
+            return;
+        }
+        for (size_t k = 0; k < n; ++k) {
+            ptrs[k] = sorted[k]->data() + begin;
+        }
+        kernels.combine(op, dst.data() + begin, ptrs.data(), n, end - begin);
+        begin = end;
+    }
+}
+
+} // namespace dkv
@@ -1,62 +1,193 @@
 #include "datatypes/dkv_datatype_base.hpp"
-#include "dkv_utils.hpp"
+#include "dkv_cached_clock.hpp"
+#include "dkv_slab_allocator.hpp"
 #include <shared_mutex>
+#include <unordered_map>
 
 namespace dkv {
 
-DataItem::DataItem() 
-    : expire_time_(Timestamp::min()) {
+namespace {
+
+// LFU参数，与Redis默认值相同
+constexpr double LFU_LOG_FACTOR = 10;
+constexpr uint32_t LFU_DECAY_MS = 60 * 1000;
+
+// 数据项读写锁池大小
+constexpr size_t LOCK_POOL_SIZE = 1024;
+// 过期时间旁路表分片数
+constexpr size_t EXPIRE_STRIPES = 64;
+
+// 毫秒精度的32位LRU时钟，读取缓存时钟
+inline uint32_t lruClockNow() {
+    return static_cast<uint32_t>(CachedClock::nowMs());
 }
 
-DataItem::DataItem(Timestamp expire_time) 
-    : expire_time_(expire_time) {
+inline double randomUnit() {
+    thread_local uint32_t state = 0x9E3779B9u ^ static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&state));
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return static_cast<double>(state) / UINT32_MAX;
+}
+
+// 过期时间旁路表，只记录设置了TTL的数据项，按数据项地址分片加锁
+class ExpireTable {
+public:
+    void set(const DataItem* item, Timestamp expire_time) {
+        Stripe& stripe = stripeOf(item);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        stripe.expires[item] = expire_time;
+    }
+
+    Timestamp get(const DataItem* item) {
+        Stripe& stripe = stripeOf(item);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        auto it = stripe.expires.find(item);
+        return it != stripe.expires.end() ? it->second : Timestamp::min();
+    }
+
+    void erase(const DataItem* item) {
+        Stripe& stripe = stripeOf(item);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        stripe.expires.erase(item);
+    }
+
+private:
+    struct Stripe {
+        std::mutex mutex;
+        std::unordered_map<const DataItem*, Timestamp> expires;
+    };
+
+    Stripe& stripeOf(const DataItem* item) {
+        return stripes_[(reinterpret_cast<uintptr_t>(item) >> 4) % EXPIRE_STRIPES];
+    }
+
+    Stripe stripes_[EXPIRE_STRIPES];
+};
+
+// 不析构，保证静态对象析构阶段释放数据项仍然安全
+ExpireTable& expireTable() {
+    static ExpireTable* table = new ExpireTable();
+    return *table;
+}
+
+std::shared_mutex* lockPool() {
+    static std::shared_mutex* pool = new std::shared_mutex[LOCK_POOL_SIZE];
+    return pool;
+}
+
+} // namespace
+
+void* DataItem::operator new(std::size_t size) {
+    return SlabAllocator::getInstance().allocate(size);
+}
+
+void DataItem::operator delete(void* ptr, std::size_t size) {
+    SlabAllocator::getInstance().deallocate(ptr, size);
+}
+
+DataItem::DataItem()
+    : lru_clock_(lruClockNow()) {
+}
+
+DataItem::DataItem(Timestamp expire_time)
+    : lru_clock_(lruClockNow()) {
+    setExpiration(expire_time);
 }
 
 DataItem::DataItem(const DataItem& other)
-    : expire_time_(other.expire_time_.load()),
-      last_accessed_(other.last_accessed_.load()),
-      access_frequency_(other.access_frequency_.load()) {
+    : lru_clock_(other.lru_clock_.load(std::memory_order_relaxed)),
+      lfu_counter_(other.lfu_counter_.load(std::memory_order_relaxed)) {
+    if (other.hasExpiration()) {
+        setExpiration(other.getExpiration());
+    }
 }
 
+DataItem::~DataItem() {
+    if (flags_.load(std::memory_order_relaxed) & FLAG_VOLATILE) {
+        expireTable().erase(this);
+    }
+}
 
 // TTL方法实现
 bool DataItem::isExpired() const {
     if (!hasExpiration()) {
         return false;
     }
-    return getExpiration() < Utils::getCurrentTime();
+    return getExpiration() < CachedClock::now();
 }
 
 void DataItem::setExpiration(Timestamp expire_time) {
-    expire_time_ = expire_time;
+    if (expire_time == Timestamp::min()) {
+        if (flags_.fetch_and(static_cast<uint8_t>(~FLAG_VOLATILE)) & FLAG_VOLATILE) {
+            expireTable().erase(this);
+        }
+        return;
+    }
+    expireTable().set(this, expire_time);
+    flags_.fetch_or(FLAG_VOLATILE);
 }
 
 Timestamp DataItem::getExpiration() const {
-    return expire_time_;
+    if (!(flags_.load(std::memory_order_relaxed) & FLAG_VOLATILE)) {
+        return Timestamp::min();
+    }
+    return expireTable().get(this);
 }
 
 bool DataItem::hasExpiration() const {
-    return expire_time_.load() != Timestamp::min();
+    return getExpiration() != Timestamp::min();
 }
 
 // 淘汰策略方法实现
-void DataItem::touch() { last_accessed_ = Utils::getCurrentTime(); }
-Timestamp DataItem::getLastAccessed() const { return last_accessed_; }
-void DataItem::incrementFrequency() { access_frequency_++; }
-uint64_t DataItem::getAccessFrequency() const { return access_frequency_; }
+void DataItem::touch() {
+    uint32_t now = lruClockNow();
+    uint32_t idle_ms = now - lru_clock_.load(std::memory_order_relaxed);
+    // 距上次访问每满一分钟，LFU计数减一
+    uint32_t periods = idle_ms / LFU_DECAY_MS;
+    if (periods > 0) {
+        uint8_t counter = lfu_counter_.load(std::memory_order_relaxed);
+        lfu_counter_.store(periods > counter ? 0 : static_cast<uint8_t>(counter - periods), std::memory_order_relaxed);
+    }
+    lru_clock_.store(now, std::memory_order_relaxed);
+}
+
+Timestamp DataItem::getLastAccessed() const {
+    uint32_t idle_ms = lruClockNow() - lru_clock_.load(std::memory_order_relaxed);
+    return CachedClock::now() - std::chrono::milliseconds(idle_ms);
+}
+
+void DataItem::incrementFrequency() {
+    uint8_t counter = lfu_counter_.load(std::memory_order_relaxed);
+    if (counter == UINT8_MAX) {
+        return;
+    }
+    // 对数计数：计数越大，递增概率越低
+    double base = counter > LFU_INIT_VAL ? counter - LFU_INIT_VAL : 0;
+    double p = 1.0 / (base * LFU_LOG_FACTOR + 1);
+    if (randomUnit() < p) {
+        lfu_counter_.store(counter + 1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t DataItem::getAccessFrequency() const {
+    uint32_t periods = (lruClockNow() - lru_clock_.load(std::memory_order_relaxed)) / LFU_DECAY_MS;
+    uint8_t counter = lfu_counter_.load(std::memory_order_relaxed);
+    return periods > counter ? 0 : counter - periods;
+}
 
 
 // 锁操作方法实现
 std::unique_lock<std::shared_mutex> DataItem::lock() {
-    return std::unique_lock<std::shared_mutex>(item_mutex_);
+    return std::unique_lock<std::shared_mutex>(getMutex());
 }
 
 std::shared_lock<std::shared_mutex> DataItem::rlock() {
-    return std::shared_lock<std::shared_mutex>(item_mutex_);
+    return std::shared_lock<std::shared_mutex>(getMutex());
 }
 
 std::shared_mutex& DataItem::getMutex() {
-    return item_mutex_;
+    return lockPool()[(reinterpret_cast<uintptr_t>(this) >> 4) % LOCK_POOL_SIZE];
 }
 
 } // namespace dkv
@@ -1,4 +1,5 @@
 #include "datatypes/dkv_datatype_bitmap.hpp"
+#include "datatypes/dkv_bitmap_kernels.hpp"
 #include "dkv_utils.hpp"
 #include <sstream>
 #include <algorithm>
@@ -17,6 +18,10 @@ BitmapItem::BitmapItem(Timestamp expire_time)
 BitmapItem::BitmapItem(const BitmapItem& other)
     : DataItem(other) {
     bits_ = other.bits_; // 深拷贝位图数据
+    if (other.sparse_) {
+        sparse_ = std::make_unique<RoaringBitmap>(*other.sparse_);
+        sparse_size_ = other.sparse_size_;
+    }
 }
 
 std::unique_ptr<DataItem> BitmapItem::clone() const {
@@ -24,17 +29,39 @@ std::unique_ptr<DataItem> BitmapItem::clone() const {
     return cloned;
 }
 
+std::unique_ptr<DataItem> BitmapItem::cloneEmpty() const {
+    return std::make_unique<BitmapItem>();
+}
+
+size_t BitmapItem::memoryUsage(size_t) const {
+    if (sparse_) {
+        return sizeof(BitmapItem) + sizeof(RoaringBitmap) + sparse_->memoryUsage();
+    }
+    return sizeof(BitmapItem) + bits_.capacity();
+}
+
+const char* BitmapItem::encodingName() const {
+    return sparse_ ? "roaring" : "raw";
+}
+
 DataType BitmapItem::getType() const {
     return DataType::BITMAP;
 }
 
 std::string BitmapItem::serialize() const {
     std::ostringstream oss;
-    oss << "BITMAP:" << bits_.size() << ":";
-    
-    // 序列化位图数据
-    for (uint8_t byte : bits_) {
-        oss << static_cast<char>(byte);
+    if (isSparse()) {
+        // 稀疏编码：RBITMAP:<字节数>:<压缩数据长度>:<压缩数据>
+        std::string payload;
+        sparse_->serialize(payload);
+        oss << "RBITMAP:" << sparse_size_ << ":" << payload.size() << ":" << payload;
+    } else {
+        oss << "BITMAP:" << bits_.size() << ":";
+
+        // 序列化位图数据
+        for (uint8_t byte : bits_) {
+            oss << static_cast<char>(byte);
+        }
     }
     
     // 序列化过期时间
@@ -50,9 +77,29 @@ std::string BitmapItem::serialize() const {
 void BitmapItem::deserialize(const std::string& data) {
     std::istringstream iss(data);
     std::string type, size_str;
-    
-    if (std::getline(iss, type, ':') && type == "BITMAP" &&
+    clear();
+
+    if (std::getline(iss, type, ':') && type == "RBITMAP" &&
         std::getline(iss, size_str, ':')) {
+        std::string payload_len_str;
+        if (!std::getline(iss, payload_len_str, ':')) {
+            return;
+        }
+        std::string payload(std::stoul(payload_len_str), '\0');
+        iss.read(&payload[0], payload.size());
+        auto sparse = std::make_unique<RoaringBitmap>();
+        if (!iss || !sparse->deserialize(payload)) {
+            return;
+        }
+        sparse_ = std::move(sparse);
+        sparse_size_ = std::stoul(size_str);
+
+        std::string expire_str;
+        if (iss.get() == ':' && std::getline(iss, expire_str)) {
+            int64_t seconds = std::stoll(expire_str);
+            setExpiration(Timestamp(std::chrono::seconds(seconds)));
+        }
+    } else if (type == "BITMAP" && std::getline(iss, size_str, ':')) {
         
         size_t size = std::stoul(size_str);
         bits_.resize(size);
@@ -71,9 +118,10 @@ void BitmapItem::deserialize(const std::string& data) {
         std::string expire_str;
         if (std::getline(iss, expire_str)) {
             int64_t seconds = std::stoll(expire_str);
-            expire_time_ = Timestamp(std::chrono::seconds(seconds));
-            setExpiration(expire_time_);
+            setExpiration(Timestamp(std::chrono::seconds(seconds)));
         }
+        // 旧数据全部为稠密编码，加载时按内容重新选择
+        chooseEncoding();
     }
 }
 
@@ -81,10 +129,28 @@ bool BitmapItem::setBit(uint64_t offset, bool value) {
     // 计算需要的字节数
     size_t byte_index = offset / 8;
     uint8_t bit_index = offset % 8;
+
+    if (isSparse()) {
+        sparse_size_ = std::max(sparse_size_, byte_index + 1);
+        const bool old_value = sparse_->set(offset, value);
+        if (sparse_->memoryUsage() > sparse_size_) {
+            toDense();
+        }
+        return old_value != value;
+    }
     
     // 如果需要扩展位图大小
     if (byte_index >= bits_.size()) {
-        bits_.resize(byte_index + 1, 0);
+        // 扩展到原来的两倍以上时，先估算稀疏编码的大小，避免为一个很大的偏移分配整块内存
+        const size_t new_size = byte_index + 1;
+        if (new_size >= SPARSE_MIN_BYTES && new_size >= bits_.size() * 2 &&
+            RoaringBitmap::estimateMemory(bits_) + RoaringBitmap::CHUNK_OVERHEAD < new_size / 2) {
+            toSparse();
+            sparse_size_ = new_size;
+            sparse_->set(offset, value);
+            return value;
+        }
+        bits_.resize(new_size, 0);
     }
     
     // 获取当前位的值
@@ -105,6 +171,10 @@ bool BitmapItem::getBit(uint64_t offset) const {
     // 计算字节索引和位索引
     size_t byte_index = offset / 8;
     uint8_t bit_index = offset % 8;
+
+    if (isSparse()) {
+        return byte_index < sparse_size_ && sparse_->get(offset);
+    }
     
     // 如果偏移量超出范围，返回false
     if (byte_index >= bits_.size()) {
@@ -116,130 +186,192 @@ bool BitmapItem::getBit(uint64_t offset) const {
 }
 
 size_t BitmapItem::bitCount() const {
-    size_t count = 0;
-    
-    // 统计所有字节中1的个数
-    for (uint8_t byte : bits_) {
-        // 使用内置函数计算单个字节中1的个数
-        count += __builtin_popcount(byte);
+    if (isSparse()) {
+        return sparse_->cardinality();
     }
-    
-    return count;
+    return bitmapKernels().popcount(bits_.data(), bits_.size());
 }
 
 size_t BitmapItem::bitCount(uint64_t start, uint64_t end) const {
-    if (start > end) {
-        return 0;
-    }
-    
-    size_t count = 0;
-    
     // 如果范围完全超出位图大小，返回0
-    if (start >= bits_.size()) {
+    if (start > end || start >= size()) {
         return 0;
     }
+    const uint64_t last = std::min<uint64_t>(end, size() - 1);
+    if (isSparse()) {
+        return sparse_->rangeCardinality(start * 8, (last + 1) * 8);
+    }
+    return bitmapKernels().popcount(bits_.data() + start, last - start + 1);
+}
+
+int64_t BitmapItem::bitPos(bool bit, uint64_t start, std::optional<uint64_t> end) const {
+    const size_t bytes = size();
+    if (bytes == 0) {
+        return bit ? -1 : 0;
+    }
+    if (start >= bytes || (end && start > *end)) {
+        return -1;
+    }
+    const uint64_t last = end ? std::min<uint64_t>(*end, bytes - 1) : bytes - 1;
+    if (isSparse()) {
+        const uint64_t range_end = (last + 1) * 8;
+        const uint64_t pos = sparse_->nextBit(bit, start * 8, range_end);
+        if (pos < range_end) {
+            return static_cast<int64_t>(pos);
+        }
+    } else {
+        // 先按字整块跳过全0（或全1）的字节，再在字节内定位
+        const size_t index = start + bitmapKernels().find(bits_.data() + start, last - start + 1, bit ? 0x00 : 0xff);
+        if (index <= last) {
+            const uint8_t byte = bit ? bits_[index] : static_cast<uint8_t>(~bits_[index]);
+            return static_cast<int64_t>(index * 8 + __builtin_ctz(byte));
+        }
+    }
+    return !bit && !end ? static_cast<int64_t>((last + 1) * 8) : -1;
+}
+
+uint64_t BitmapItem::getField(uint64_t offset, uint32_t bits) const {
+    uint64_t raw = 0;
+    for (uint32_t i = 0; i < bits; ++i) {
+        raw = (raw << 1) | (getBit(offset + i) ? 1 : 0);
+    }
+    return raw;
+}
+
+void BitmapItem::setField(uint64_t offset, uint32_t bits, uint64_t raw) {
+    // 从最后一位开始写，位图只在第一次写入时扩展
+    for (uint32_t i = bits; i > 0; --i) {
+        setBit(offset + i - 1, (raw >> (bits - i)) & 1);
+    }
+}
+
+std::vector<std::optional<int64_t>> BitmapItem::bitField(const std::vector<BitFieldOp>& ops) {
+    std::vector<std::optional<int64_t>> results;
+    results.reserve(ops.size());
+    for (const auto& op : ops) {
+        const uint64_t mask = op.bits == 64 ? ~uint64_t(0) : (uint64_t(1) << op.bits) - 1;
+        // 有符号位域按最高位做符号扩展
+        auto toValue = [&op, mask](uint64_t raw) {
+            if (op.is_signed && op.bits < 64 && ((raw >> (op.bits - 1)) & 1)) {
+                raw |= ~mask;
+            }
+            return static_cast<int64_t>(raw);
+        };
+        const int64_t old_value = toValue(getField(op.offset, op.bits));
+        if (op.type == BitFieldOp::Type::GET) {
+            results.push_back(old_value);
+            continue;
+        }
 
-    for (size_t i = start; i <= end && i < bits_.size(); ++i) {
-        count += __builtin_popcount(bits_[i]);
+        __int128 target = op.type == BitFieldOp::Type::SET ? __int128(op.value) : __int128(old_value) + op.value;
+        const __int128 min = op.is_signed ? -(__int128(1) << (op.bits - 1)) : 0;
+        const __int128 max = op.is_signed ? (__int128(1) << (op.bits - 1)) - 1 : (__int128(1) << op.bits) - 1;
+        if (target < min || target > max) {
+            if (op.overflow == BitFieldOp::Overflow::FAIL) {
+                results.push_back(std::nullopt);
+                continue;
+            }
+            target = op.overflow == BitFieldOp::Overflow::SAT ? (target < min ? min : max)
+                                                              : toValue(static_cast<uint64_t>(target) & mask);
+        }
+        setField(op.offset, op.bits, static_cast<uint64_t>(target) & mask);
+        results.push_back(op.type == BitFieldOp::Type::SET ? old_value : static_cast<int64_t>(target));
     }
-    return count;
+    return results;
 }
 
 size_t BitmapItem::size() const {
-    return bits_.size();
+    return isSparse() ? sparse_size_ : bits_.size();
 }
 
 void BitmapItem::clear() {
     bits_.clear();
+    sparse_.reset();
+    sparse_size_ = 0;
 }
 
 bool BitmapItem::empty() const {
-    return bits_.empty();
+    return size() == 0;
 }
 
-bool BitmapItem::bitOpAnd(const std::vector<BitmapItem*>& bitmap_items) {
+void BitmapItem::toSparse() {
+    sparse_ = std::make_unique<RoaringBitmap>(RoaringBitmap::fromDense(bits_));
+    sparse_size_ = bits_.size();
+    std::vector<uint8_t>().swap(bits_);
+}
+
+void BitmapItem::toDense() {
+    bits_.assign(sparse_size_, 0);
+    sparse_->toDense(bits_);
+    sparse_.reset();
+    sparse_size_ = 0;
+}
+
+void BitmapItem::chooseEncoding() {
+    if (isSparse()) {
+        if (sparse_->memoryUsage() > sparse_size_) {
+            toDense();
+        }
+    } else if (bits_.size() >= SPARSE_MIN_BYTES &&
+               RoaringBitmap::estimateMemory(bits_) < bits_.size() / 2) {
+        toSparse();
+    }
+}
+
+// 多个位图合并：结果先写入新的缓冲区，当前位图本身也可以是输入之一
+bool BitmapItem::bitOp(BitmapOp op, const std::vector<BitmapItem*>& bitmap_items) {
     if (bitmap_items.empty()) {
         return false;
     }
-    
-    // 找出最大的位图大小
-    size_t max_size = 0;
-    for (const auto& item : bitmap_items) {
-        if (item->size() > max_size) {
-            max_size = item->size();
+    const bool all_sparse = std::all_of(bitmap_items.begin(), bitmap_items.end(),
+                                        [](const BitmapItem* item) { return item->isSparse(); });
+    if (all_sparse) {
+        // 全部为稀疏编码时直接按块合并，不展开为字节数组
+        std::vector<const RoaringBitmap*> inputs;
+        size_t result_size = 0;
+        for (const auto& item : bitmap_items) {
+            inputs.push_back(item->sparse_.get());
+            result_size = std::max(result_size, item->sparse_size_);
         }
-    }
-    
-    // 调整当前位图大小
-    bits_.resize(max_size, 0xFF); // 初始化为全1，因为AND操作中全1是中性元素
-    
-    // 对每个位图执行AND操作
-    for (const auto& item : bitmap_items) {
-        size_t item_size = item->size();
-        for (size_t i = 0; i < max_size; ++i) {
-            if (i < item_size) {
-                bits_[i] &= item->bits_[i];
+        auto result = std::make_unique<RoaringBitmap>(RoaringBitmap::combine(op, inputs));
+        bits_.clear();
+        sparse_ = std::move(result);
+        sparse_size_ = result_size;
+    } else {
+        // 稀疏编码的输入先展开为字节数组
+        std::vector<std::vector<uint8_t>> expanded;
+        expanded.reserve(bitmap_items.size());
+        std::vector<const std::vector<uint8_t>*> srcs;
+        srcs.reserve(bitmap_items.size());
+        for (const auto& item : bitmap_items) {
+            if (item->isSparse()) {
+                expanded.emplace_back(item->sparse_size_, 0);
+                item->sparse_->toDense(expanded.back());
+                srcs.push_back(&expanded.back());
             } else {
-                bits_[i] = 0; // 如果其他位图没有这个字节，结果就是0
+                srcs.push_back(&item->bits_);
             }
         }
+        std::vector<uint8_t> result;
+        bitmapCombine(op, result, srcs);
+        bits_.swap(result);
+        sparse_.reset();
+        sparse_size_ = 0;
     }
-    
+    chooseEncoding();
     return true;
 }
 
+bool BitmapItem::bitOpAnd(const std::vector<BitmapItem*>& bitmap_items) {
+    return bitOp(BitmapOp::AND, bitmap_items);
+}
+
 bool BitmapItem::bitOpOr(const std::vector<BitmapItem*>& bitmap_items) {
-    if (bitmap_items.empty()) {
-        return false;
-    }
-    
-    // 找出最大的位图大小
-    size_t max_size = 0;
-    for (const auto& item : bitmap_items) {
-        if (item->size() > max_size) {
-            max_size = item->size();
-        }
-    }
-    
-    // 调整当前位图大小
-    bits_.resize(max_size, 0); // 初始化为全0，因为OR操作中全0是中性元素
-    
-    // 对每个位图执行OR操作
-    for (const auto& item : bitmap_items) {
-        size_t item_size = item->size();
-        for (size_t i = 0; i < item_size; ++i) {
-            bits_[i] |= item->bits_[i];
-        }
-    }
-    
-    return true;
+    return bitOp(BitmapOp::OR, bitmap_items);
 }
 
 bool BitmapItem::bitOpXor(const std::vector<BitmapItem*>& bitmap_items) {
-    if (bitmap_items.empty()) {
-        return false;
-    }
-    
-    // 找出最大的位图大小
-    size_t max_size = 0;
-    for (const auto& item : bitmap_items) {
-        if (item->size() > max_size) {
-            max_size = item->size();
-        }
-    }
-    
-    // 调整当前位图大小
-    bits_.resize(max_size, 0); // 初始化为全0，因为XOR操作中全0是中性元素
-    
-    // 对每个位图执行XOR操作
-    for (const auto& item : bitmap_items) {
-        size_t item_size = item->size();
-        for (size_t i = 0; i < item_size; ++i) {
-            bits_[i] ^= item->bits_[i];
-        }
-    }
-    
-    return true;
+    return bitOp(BitmapOp::XOR, bitmap_items);
 }
 
 bool BitmapItem::bitOpNot(BitmapItem* bitmap_item) {
@@ -247,15 +379,24 @@ bool BitmapItem::bitOpNot(BitmapItem* bitmap_item) {
         return false;
     }
     
-    // 调整当前位图大小与源位图相同
-    size_t size = bitmap_item->size();
-    bits_.resize(size);
-    
-    // 对每个字节执行NOT操作
-    for (size_t i = 0; i < size; ++i) {
-        bits_[i] = ~bitmap_item->bits_[i];
+    if (bitmap_item->isSparse()) {
+        // 稀疏位图取反后大部分是连续的置位，用游程容器保存
+        auto result = std::make_unique<RoaringBitmap>(
+            RoaringBitmap::invert(*bitmap_item->sparse_, uint64_t(bitmap_item->sparse_size_) * 8));
+        const size_t result_size = bitmap_item->sparse_size_;
+        bits_.clear();
+        sparse_ = std::move(result);
+        sparse_size_ = result_size;
+    } else {
+        // 调整当前位图大小与源位图相同
+        const size_t size = bitmap_item->size();
+        std::vector<uint8_t> result(size);
+        bitmapKernels().invert(result.data(), bitmap_item->bits_.data(), size);
+        bits_.swap(result);
+        sparse_.reset();
+        sparse_size_ = 0;
     }
-    
+    chooseEncoding();
     return true;
 }
 
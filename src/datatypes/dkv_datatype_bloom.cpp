@@ -0,0 +1,345 @@
+#include "datatypes/dkv_datatype_bloom.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace dkv {
+
+namespace {
+
+uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+// 序列化辅助：按本机字节序写入/读取定长字段
+template <typename T>
+void appendRaw(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readRaw(const std::string& data, size_t& pos, T& value) {
+    if (data.size() - pos < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+// 新一层的误判率收紧比例，各层误判率之和不超过初始误判率的两倍
+constexpr double kTighteningRatio = 0.5;
+constexpr char kMagic[] = "BLOOM:";
+constexpr size_t kMagicLength = sizeof(kMagic) - 1;
+
+} // namespace
+
+// BloomFilterItem实现
+BloomFilterItem::BloomFilterItem()
+    : BloomFilterItem(kDefaultErrorRate, kDefaultCapacity, kDefaultExpansion) {
+}
+
+BloomFilterItem::BloomFilterItem(Timestamp expire_time)
+    : DataItem(expire_time), expansion_(kDefaultExpansion), count_(0) {
+    layers_.push_back(makeLayer(kDefaultErrorRate, kDefaultCapacity));
+}
+
+BloomFilterItem::BloomFilterItem(double error_rate, uint64_t capacity, uint32_t expansion)
+    : DataItem(), expansion_(expansion), count_(0) {
+    layers_.push_back(makeLayer(error_rate, capacity));
+}
+
+BloomFilterItem::BloomFilterItem(const BloomFilterItem& other)
+    : DataItem(other), layers_(other.layers_), expansion_(other.expansion_), count_(other.count_) {
+}
+
+std::unique_ptr<DataItem> BloomFilterItem::clone() const {
+    return std::make_unique<BloomFilterItem>(*this);
+}
+
+std::unique_ptr<DataItem> BloomFilterItem::cloneEmpty() const {
+    // 保留第一层的参数，与原过滤器的容量和误判率一致
+    const Layer& first = layers_.front();
+    return std::make_unique<BloomFilterItem>(first.error_rate, first.capacity, expansion_);
+}
+
+size_t BloomFilterItem::memoryUsage(size_t) const {
+    size_t bytes = sizeof(BloomFilterItem) + layers_.capacity() * sizeof(Layer);
+    for (const auto& layer : layers_) {
+        bytes += layer.words.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+const char* BloomFilterItem::encodingName() const {
+    return "bloom";
+}
+
+DataType BloomFilterItem::getType() const {
+    return DataType::BLOOM;
+}
+
+// MurmurHash64A
+uint64_t BloomFilterItem::hash(const Value& value) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    const size_t len = value.size();
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(value.data());
+    uint64_t h = 0x5bd1e9955bd1e995ULL ^ (len * m);
+
+    const size_t nblocks = len / 8;
+    for (size_t i = 0; i < nblocks; ++i) {
+        uint64_t k;
+        std::memcpy(&k, data + i * 8, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    const unsigned char* tail = data + nblocks * 8;
+    switch (len & 7) {
+        case 7: h ^= static_cast<uint64_t>(tail[6]) << 48;
+                [[fallthrough]];
+        case 6: h ^= static_cast<uint64_t>(tail[5]) << 40;
+                [[fallthrough]];
+        case 5: h ^= static_cast<uint64_t>(tail[4]) << 32;
+                [[fallthrough]];
+        case 4: h ^= static_cast<uint64_t>(tail[3]) << 24;
+                [[fallthrough]];
+        case 3: h ^= static_cast<uint64_t>(tail[2]) << 16;
+                [[fallthrough]];
+        case 2: h ^= static_cast<uint64_t>(tail[1]) << 8;
+                [[fallthrough]];
+        case 1: h ^= static_cast<uint64_t>(tail[0]);
+                h *= m;
+                break;
+        default: break;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+// 位数按 n * -ln(p) / ln(2)^2 取整到整块，1%误判率约为每个元素9.6位；哈希函数个数为 -log2(p)
+BloomFilterItem::Layer BloomFilterItem::makeLayer(double error_rate, uint64_t capacity) {
+    Layer layer;
+    layer.error_rate = error_rate;
+    layer.capacity = std::max<uint64_t>(capacity, 1);
+    const double ln2 = std::log(2.0);
+    const double bits = std::ceil(static_cast<double>(layer.capacity) * -std::log(error_rate) / (ln2 * ln2));
+    const size_t blocks = std::max<size_t>(1, static_cast<size_t>(std::ceil(bits / kBlockBits)));
+    layer.hashes = std::max<uint32_t>(1, static_cast<uint32_t>(std::ceil(-std::log2(error_rate))));
+    layer.words.assign(blocks * kBlockWords, 0);
+    return layer;
+}
+
+// 每层用层号扰动元素哈希：高32位按乘法取模选块，再混合一次得到双重哈希的两个32位因子，
+// 第i个位为 (a + i*b) 的高9位，全部落在同一块内
+size_t BloomFilterItem::locate(const Layer& layer, size_t level, uint64_t hash_value, uint64_t* mask) {
+    const uint64_t g = fmix64(hash_value + level * 0x9E3779B97F4A7C15ULL);
+    const size_t block = static_cast<size_t>(((g >> 32) * layer.blockCount()) >> 32);
+    if (mask) {
+        std::fill(mask, mask + kBlockWords, 0);
+        const uint64_t h2 = fmix64(g);
+        uint32_t a = static_cast<uint32_t>(h2);
+        const uint32_t b = static_cast<uint32_t>(h2 >> 32) | 1;
+        for (uint32_t i = 0; i < layer.hashes; ++i) {
+            const uint32_t bit = a >> 23;
+            mask[bit / 64] |= 1ULL << (bit % 64);
+            a += b;
+        }
+    }
+    return block * kBlockWords;
+}
+
+bool BloomFilterItem::layerContains(size_t level, uint64_t hash_value) const {
+    const Layer& layer = layers_[level];
+    uint64_t mask[kBlockWords];
+    const uint64_t* block = layer.words.data() + locate(layer, level, hash_value, mask);
+    // 固定8个字的与运算，不提前退出，便于向量化
+    uint64_t missing = 0;
+    for (size_t w = 0; w < kBlockWords; ++w) {
+        missing |= mask[w] & ~block[w];
+    }
+    return missing == 0;
+}
+
+bool BloomFilterItem::containsHash(uint64_t hash_value) const {
+    // 新层元素最多，从后往前检查
+    for (size_t level = layers_.size(); level-- > 0;) {
+        if (layerContains(level, hash_value)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int BloomFilterItem::addHash(uint64_t hash_value) {
+    if (containsHash(hash_value)) {
+        return ADD_EXISTS;
+    }
+    if (layers_.back().count >= layers_.back().capacity) {
+        if (expansion_ == 0) {
+            return ADD_FULL;
+        }
+        const Layer& last = layers_.back();
+        layers_.push_back(makeLayer(last.error_rate * kTighteningRatio, last.capacity * expansion_));
+    }
+    const size_t level = layers_.size() - 1;
+    Layer& layer = layers_[level];
+    uint64_t mask[kBlockWords];
+    uint64_t* block = layer.words.data() + locate(layer, level, hash_value, mask);
+    for (size_t w = 0; w < kBlockWords; ++w) {
+        block[w] |= mask[w];
+    }
+    layer.count++;
+    count_++;
+    return ADD_ADDED;
+}
+
+int BloomFilterItem::add(const Value& element) {
+    return addHash(hash(element));
+}
+
+void BloomFilterItem::add(const Value* elements, size_t count, std::vector<int>& results) {
+    std::vector<uint64_t> hashes(count);
+    for (size_t i = 0; i < count; ++i) {
+        hashes[i] = hash(elements[i]);
+    }
+    // 插入通常落在最后一层，先预取这些块；层扩展后的新层是刚分配的，不需要预取
+    const size_t level = layers_.size() - 1;
+    const Layer& last = layers_[level];
+    for (size_t i = 0; i < count; ++i) {
+        __builtin_prefetch(last.words.data() + locate(last, level, hashes[i], nullptr), 1);
+    }
+    results.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        results[i] = addHash(hashes[i]);
+    }
+}
+
+bool BloomFilterItem::exists(const Value& element) const {
+    return containsHash(hash(element));
+}
+
+void BloomFilterItem::exists(const Value* elements, size_t count, std::vector<bool>& results) const {
+    std::vector<uint64_t> hashes(count);
+    for (size_t i = 0; i < count; ++i) {
+        hashes[i] = hash(elements[i]);
+    }
+    results.assign(count, false);
+    for (size_t level = layers_.size(); level-- > 0;) {
+        const Layer& layer = layers_[level];
+        for (size_t i = 0; i < count; ++i) {
+            if (!results[i]) {
+                __builtin_prefetch(layer.words.data() + locate(layer, level, hashes[i], nullptr));
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (!results[i]) {
+                results[i] = layerContains(level, hashes[i]);
+            }
+        }
+    }
+}
+
+size_t BloomFilterItem::bytes() const {
+    size_t total = 0;
+    for (const auto& layer : layers_) {
+        total += layer.words.size() * sizeof(uint64_t);
+    }
+    return total;
+}
+
+uint64_t BloomFilterItem::capacity() const {
+    uint64_t total = 0;
+    for (const auto& layer : layers_) {
+        total += layer.capacity;
+    }
+    return total;
+}
+
+// BLOOM:<扩展因子><插入数><层数>，每层<误判率><容量><插入数><哈希函数个数><字数><位数组>，
+// 定长字段按本机字节序写入；有过期时间时追加 :<秒数>
+std::string BloomFilterItem::serialize() const {
+    std::string out(kMagic, kMagicLength);
+    out.reserve(kMagicLength + 32 + bytes() + layers_.size() * 40);
+    appendRaw(out, expansion_);
+    appendRaw(out, count_);
+    appendRaw(out, static_cast<uint32_t>(layers_.size()));
+    for (const auto& layer : layers_) {
+        appendRaw(out, layer.error_rate);
+        appendRaw(out, layer.capacity);
+        appendRaw(out, layer.count);
+        appendRaw(out, layer.hashes);
+        appendRaw(out, static_cast<uint64_t>(layer.words.size()));
+        out.append(reinterpret_cast<const char*>(layer.words.data()), layer.words.size() * sizeof(uint64_t));
+    }
+
+    // 序列化过期时间
+    if (hasExpiration()) {
+        auto duration = getExpiration().time_since_epoch();
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
+        out += ":" + std::to_string(seconds);
+    }
+    return out;
+}
+
+void BloomFilterItem::deserialize(const std::string& data) {
+    if (data.compare(0, kMagicLength, kMagic) != 0) {
+        return;
+    }
+    size_t pos = kMagicLength;
+    uint32_t expansion = 0;
+    uint64_t total = 0;
+    uint32_t layer_count = 0;
+    if (!readRaw(data, pos, expansion) || !readRaw(data, pos, total) || !readRaw(data, pos, layer_count) ||
+        layer_count == 0) {
+        return;
+    }
+    std::vector<Layer> layers(layer_count);
+    for (auto& layer : layers) {
+        uint64_t word_count = 0;
+        if (!readRaw(data, pos, layer.error_rate) || !readRaw(data, pos, layer.capacity) ||
+            !readRaw(data, pos, layer.count) || !readRaw(data, pos, layer.hashes) ||
+            !readRaw(data, pos, word_count)) {
+            return;
+        }
+        if (word_count == 0 || word_count % kBlockWords != 0 ||
+            word_count > (data.size() - pos) / sizeof(uint64_t)) {
+            return;
+        }
+        layer.words.resize(word_count);
+        std::memcpy(layer.words.data(), data.data() + pos, word_count * sizeof(uint64_t));
+        pos += word_count * sizeof(uint64_t);
+    }
+    layers_ = std::move(layers);
+    expansion_ = expansion;
+    count_ = total;
+
+    // 读取过期时间
+    if (pos < data.size() && data[pos] == ':') {
+        uint64_t seconds = std::stoull(data.substr(pos + 1));
+        setExpiration(std::chrono::system_clock::time_point(std::chrono::seconds(seconds)));
+    }
+}
+
+// 全局工厂函数
+dkv::DataItem* createBloomFilterItem() {
+    return new BloomFilterItem();
+}
+
+dkv::DataItem* createBloomFilterItem(dkv::Timestamp expire_time) {
+    return new BloomFilterItem(expire_time);
+}
+
+} // namespace dkv
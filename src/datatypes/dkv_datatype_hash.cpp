@@ -16,8 +16,22 @@ HashItem::HashItem(Timestamp expire_time)
 }
 
 HashItem::HashItem(const HashItem& other)
-    : DataItem(other) {
-    fields_ = other.fields_; // 深拷贝哈希字段
+    : DataItem(other), packed_(other.packed_) {
+    if (other.fields_) {
+        fields_ = std::make_unique<std::unordered_map<Value, Value>>(*other.fields_); // 深拷贝哈希字段
+    }
+}
+
+void HashItem::convertToDict() {
+    auto fields = std::make_unique<std::unordered_map<Value, Value>>();
+    fields->reserve(packed_.size() / 2);
+    for (size_t pos = packed_.begin(); pos != packed_.end(); ) {
+        size_t value_pos = packed_.next(pos);
+        fields->emplace(Value(packed_.get(pos)), Value(packed_.get(value_pos)));
+        pos = packed_.next(value_pos);
+    }
+    packed_.clear();
+    fields_ = std::move(fields);
 }
 
 std::unique_ptr<DataItem> HashItem::clone() const {
@@ -25,21 +39,40 @@ std::unique_ptr<DataItem> HashItem::clone() const {
     return cloned;
 }
 
+std::unique_ptr<DataItem> HashItem::cloneEmpty() const {
+    return std::make_unique<HashItem>();
+}
+
+size_t HashItem::memoryUsage(size_t samples) const {
+    size_t bytes = sizeof(HashItem) + stringHeapBytes(packed_.raw());
+    if (fields_) {
+        bytes += sizeof(*fields_) + hashTableBytes(*fields_);
+        bytes += sampledBytes(fields_->begin(), fields_->end(), fields_->size(), samples, [](const auto& entry) {
+            return stringHeapBytes(entry.first) + stringHeapBytes(entry.second);
+        });
+    }
+    return bytes;
+}
+
+const char* HashItem::encodingName() const {
+    return fields_ ? "hashtable" : "listpack";
+}
+
 DataType HashItem::getType() const {
     return DataType::HASH;
 }
 
 std::string HashItem::serialize() const {
     std::ostringstream oss;
-    oss << "HASH:" << fields_.size() << ":";
+    oss << "HASH:" << size() << ":";
     
-    for (const auto& pair : fields_) {
+    for (const auto& pair : getAll()) {
         oss << pair.first.length() << ":" << pair.first << ":";
         oss << pair.second.length() << ":" << pair.second << ":";
     }
     
     if (hasExpiration()) {
-        auto duration = expire_time_.load().time_since_epoch();
+        auto duration = getExpiration().time_since_epoch();
         auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
         oss << "E:" << seconds;
     }
@@ -65,7 +98,7 @@ void HashItem::deserialize(const std::string& data) {
                 
                 size_t field_len = std::stoul(field_len_str);
                 size_t value_len = std::stoul(value_len_str);
-                fields_[field.substr(0, field_len)] = value.substr(0, value_len);
+                setField(field.substr(0, field_len), value.substr(0, value_len));
             }
         }
         
@@ -74,21 +107,45 @@ void HashItem::deserialize(const std::string& data) {
         if (std::getline(iss, next_part)) {
             if (next_part.substr(0, 2) == "E:") {
                 int64_t seconds = std::stoll(next_part.substr(2));
-                expire_time_ = Timestamp(std::chrono::seconds(seconds));
-                setExpiration(expire_time_);
+                setExpiration(Timestamp(std::chrono::seconds(seconds)));
             }
         }
     }
 }
 
 bool HashItem::setField(const Value& field, const Value& value) {
-    fields_[field] = value;
+    const ListpackConfig& config = listpackConfig();
+    if (isPacked() && (field.size() > config.hash_max_value || value.size() > config.hash_max_value)) {
+        convertToDict();
+    }
+    if (!isPacked()) {
+        (*fields_)[field] = value;
+        return true;
+    }
+    size_t pos = packed_.find(field, 1);
+    if (pos != packed_.end()) {
+        packed_.replace(packed_.next(pos), value);
+        return true;
+    }
+    packed_.append(field);
+    packed_.append(value);
+    if (packed_.size() / 2 > config.hash_max_entries) {
+        convertToDict();
+    }
     return true;
 }
 
 bool HashItem::getField(const Value& field, Value& value) const {
-    auto it = fields_.find(field);
-    if (it != fields_.end()) {
+    if (isPacked()) {
+        size_t pos = packed_.find(field, 1);
+        if (pos == packed_.end()) {
+            return false;
+        }
+        value = Value(packed_.get(packed_.next(pos)));
+        return true;
+    }
+    auto it = fields_->find(field);
+    if (it != fields_->end()) {
         value = it->second;
         return true;
     }
@@ -96,22 +153,39 @@ bool HashItem::getField(const Value& field, Value& value) const {
 }
 
 bool HashItem::delField(const Value& field) {
-    auto it = fields_.find(field);
-    if (it != fields_.end()) {
-        fields_.erase(it);
+    if (isPacked()) {
+        size_t pos = packed_.find(field, 1);
+        if (pos == packed_.end()) {
+            return false;
+        }
+        packed_.erase(pos, 2);
+        return true;
+    }
+    auto it = fields_->find(field);
+    if (it != fields_->end()) {
+        fields_->erase(it);
         return true;
     }
     return false;
 }
 
 bool HashItem::existsField(const Value& field) const {
-    return fields_.find(field) != fields_.end();
+    if (isPacked()) {
+        return packed_.find(field, 1) != packed_.end();
+    }
+    return fields_->find(field) != fields_->end();
 }
 
 std::vector<Value> HashItem::getKeys() const {
     std::vector<Value> keys;
-    keys.reserve(fields_.size());
-    for (const auto& pair : fields_) {
+    keys.reserve(size());
+    if (isPacked()) {
+        for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(packed_.next(pos))) {
+            keys.emplace_back(packed_.get(pos));
+        }
+        return keys;
+    }
+    for (const auto& pair : *fields_) {
         keys.push_back(pair.first);
     }
     return keys;
@@ -119,8 +193,15 @@ std::vector<Value> HashItem::getKeys() const {
 
 std::vector<Value> HashItem::getValues() const {
     std::vector<Value> values;
-    values.reserve(fields_.size());
-    for (const auto& pair : fields_) {
+    values.reserve(size());
+    if (isPacked()) {
+        for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(pos)) {
+            pos = packed_.next(pos);
+            values.emplace_back(packed_.get(pos));
+        }
+        return values;
+    }
+    for (const auto& pair : *fields_) {
         values.push_back(pair.second);
     }
     return values;
@@ -128,19 +209,42 @@ std::vector<Value> HashItem::getValues() const {
 
 std::vector<std::pair<Value, Value>> HashItem::getAll() const {
     std::vector<std::pair<Value, Value>> all;
-    all.reserve(fields_.size());
-    for (const auto& pair : fields_) {
+    all.reserve(size());
+    if (isPacked()) {
+        for (size_t pos = packed_.begin(); pos != packed_.end(); ) {
+            size_t value_pos = packed_.next(pos);
+            all.emplace_back(Value(packed_.get(pos)), Value(packed_.get(value_pos)));
+            pos = packed_.next(value_pos);
+        }
+        return all;
+    }
+    for (const auto& pair : *fields_) {
         all.push_back(pair);
     }
     return all;
 }
 
+size_t HashItem::scan(size_t cursor, size_t count, std::vector<std::pair<Value, Value>>& out) const {
+    if (isPacked()) {
+        for (size_t pos = packed_.begin(); pos != packed_.end(); ) {
+            size_t value_pos = packed_.next(pos);
+            out.emplace_back(Value(packed_.get(pos)), Value(packed_.get(value_pos)));
+            pos = packed_.next(value_pos);
+        }
+        return 0;
+    }
+    return scanBuckets(*fields_, cursor, count, [&out](const std::pair<const Value, Value>& pair) {
+        out.emplace_back(pair.first, pair.second);
+    });
+}
+
 size_t HashItem::size() const {
-    return fields_.size();
+    return isPacked() ? packed_.size() / 2 : fields_->size();
 }
 
 void HashItem::clear() {
-    fields_.clear();
+    packed_.clear();
+    fields_.reset();
 }
 
 } // namespace dkv
\ No newline at end of file
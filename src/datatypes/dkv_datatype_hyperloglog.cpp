@@ -2,7 +2,17 @@
 #include "dkv_utils.hpp"
 #include <sstream>
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DKV_HLL_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DKV_HLL_NEON 1
+#endif
 
 namespace dkv {
 
@@ -93,15 +103,91 @@ static uint64_t murmurHash3(const void* key, int len, uint32_t seed) {
     return h1;
 }
 
+namespace {
+
+// 寄存器按字节逐个取最大值：dst[i] = max(dst[i], src[i])
+
+void maxRegistersScalar(uint8_t* dst, const uint8_t* src, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] = std::max(dst[i], src[i]);
+    }
+}
+
+#ifdef DKV_HLL_X86
+__attribute__((target("avx2")))
+void maxRegistersAvx2(uint8_t* dst, const uint8_t* src, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_max_epu8(a, b));
+    }
+    maxRegistersScalar(dst + i, src + i, len - i);
+}
+#endif
+
+#ifdef DKV_HLL_NEON
+void maxRegistersNeon(uint8_t* dst, const uint8_t* src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        vst1q_u8(dst + i, vmaxq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+    }
+    maxRegistersScalar(dst + i, src + i, len - i);
+}
+#endif
+
+// 运行时按CPU特性选用，第一次调用时确定
+void maxRegisters(uint8_t* dst, const uint8_t* src, size_t len) {
+    using MaxFn = void (*)(uint8_t*, const uint8_t*, size_t);
+    static const MaxFn impl = []() -> MaxFn {
+#ifdef DKV_HLL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return maxRegistersAvx2;
+        }
+#endif
+#ifdef DKV_HLL_NEON
+        return maxRegistersNeon;
+#endif
+        return maxRegistersScalar;
+    }();
+    impl(dst, src, len);
+}
+
+// 每3个字节解出4个6位寄存器
+inline void unpackGroup(const uint8_t* in, uint8_t* out) {
+    out[0] = in[0] & 63;
+    out[1] = static_cast<uint8_t>((in[0] >> 6) | (in[1] << 2)) & 63;
+    out[2] = static_cast<uint8_t>((in[1] >> 4) | (in[2] << 4)) & 63;
+    out[3] = in[2] >> 2;
+}
+
+// 寄存器值最大为64 - kPrecision + 1
+constexpr size_t kHistogramSize = 64;
+
+// 2^-r的查表
+const std::array<double, kHistogramSize>& inversePowers() {
+    static const std::array<double, kHistogramSize> table = []() {
+        std::array<double, kHistogramSize> values{};
+        for (size_t r = 0; r < kHistogramSize; ++r) {
+            values[r] = std::ldexp(1.0, -static_cast<int>(r));
+        }
+        return values;
+    }();
+    return table;
+}
+
+} // namespace
+
 // HyperLogLogItem实现
 HyperLogLogItem::HyperLogLogItem() 
-    : registers_(kRegisterCount, 0), cardinality_(0), cache_valid_(false),
-      DataItem() {
+    : DataItem(), cardinality_(0), cache_valid_(false) {
 }
 
 HyperLogLogItem::HyperLogLogItem(const HyperLogLogItem& other)
     : DataItem(other) {
-    registers_ = other.registers_; // 深拷贝寄存器数组
+    sparse_ = other.sparse_; // 深拷贝寄存器数据
+    dense_ = other.dense_;
     cardinality_ = other.cardinality_;
     cache_valid_ = other.cache_valid_;
 }
@@ -111,27 +197,41 @@ std::unique_ptr<DataItem> HyperLogLogItem::clone() const {
     return cloned;
 }
 
+std::unique_ptr<DataItem> HyperLogLogItem::cloneEmpty() const {
+    return std::make_unique<HyperLogLogItem>();
+}
+
 HyperLogLogItem::HyperLogLogItem(Timestamp expire_time)
-    : registers_(kRegisterCount, 0), cardinality_(0), cache_valid_(false),
-      DataItem(expire_time) {
+    : DataItem(expire_time), cardinality_(0), cache_valid_(false) {
+}
+
+size_t HyperLogLogItem::memoryUsage(size_t) const {
+    return sizeof(HyperLogLogItem) + sparse_.capacity() * sizeof(uint32_t) + dense_.capacity();
+}
+
+const char* HyperLogLogItem::encodingName() const {
+    return dense_.empty() ? "sparse" : "dense";
 }
 
 DataType HyperLogLogItem::getType() const {
     return DataType::HYPERLOGLOG;
 }
 
+// 稀疏编码：HLLSPARSE:<项数>:<每项4字节>；稠密编码：HLLDENSE:<12KB寄存器>。
+// 早期版本的HYPERLOGLOG:<每个寄存器一个字节>仍可读取
 std::string HyperLogLogItem::serialize() const {
     std::ostringstream oss;
-    oss << "HYPERLOGLOG:";
-    
-    // 序列化寄存器数据
-    for (uint8_t reg : registers_) {
-        oss << static_cast<char>(reg);
+    if (isSparse()) {
+        oss << "HLLSPARSE:" << sparse_.size() << ":";
+        oss.write(reinterpret_cast<const char*>(sparse_.data()), sparse_.size() * sizeof(uint32_t));
+    } else {
+        oss << "HLLDENSE:";
+        oss.write(reinterpret_cast<const char*>(dense_.data()), dense_.size());
     }
     
     // 序列化过期时间
     if (hasExpiration()) {
-        auto duration = expire_time_.load().time_since_epoch();
+        auto duration = getExpiration().time_since_epoch();
         auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
         oss << ":" << seconds;
     }
@@ -142,54 +242,131 @@ std::string HyperLogLogItem::serialize() const {
 void HyperLogLogItem::deserialize(const std::string& data) {
     std::istringstream iss(data);
     std::string type;
-    
-    if (std::getline(iss, type, ':') && type == "HYPERLOGLOG") {
+    if (!std::getline(iss, type, ':')) {
+        return;
+    }
+
+    if (type == "HLLSPARSE") {
+        std::string count_str;
+        if (!std::getline(iss, count_str, ':')) {
+            return;
+        }
+        const size_t count = std::stoul(count_str);
+        if (count > kRegisterCount) {
+            return;
+        }
+        std::vector<uint32_t> entries(count);
+        iss.read(reinterpret_cast<char*>(entries.data()), count * sizeof(uint32_t));
+        if (!iss) {
+            return;
+        }
+        sparse_ = std::move(entries);
+        dense_.clear();
+    } else if (type == "HLLDENSE") {
+        std::vector<uint8_t> registers(kDenseBytes);
+        iss.read(reinterpret_cast<char*>(registers.data()), kDenseBytes);
+        if (!iss) {
+            return;
+        }
+        dense_ = std::move(registers);
+        sparse_.clear();
+    } else if (type == "HYPERLOGLOG") {
         // 读取寄存器数据
-        registers_.resize(kRegisterCount);
+        std::vector<uint8_t> raw(kRegisterCount, 0);
         for (size_t i = 0; i < kRegisterCount; ++i) {
             char byte;
             if (iss.get(byte)) {
-                registers_[i] = static_cast<uint8_t>(byte);
-            } else {
-                registers_[i] = 0;
+                raw[i] = std::min<uint8_t>(static_cast<uint8_t>(byte), 63);
             }
         }
+        clear();
+        loadRaw(raw.data());
+    } else {
+        return;
+    }
         
-        // 读取过期时间
-        std::string expire_str;
-        if (std::getline(iss, expire_str)) {
-            uint64_t seconds = std::stoull(expire_str);
-            auto duration = std::chrono::seconds(seconds);
-            setExpiration(std::chrono::system_clock::time_point(duration));
-        }
-        
-        // 重置缓存
-        cache_valid_ = false;
+    // 读取过期时间
+    std::string expire_str;
+    if (iss.get() == ':' && std::getline(iss, expire_str)) {
+        uint64_t seconds = std::stoull(expire_str);
+        auto duration = std::chrono::seconds(seconds);
+        setExpiration(std::chrono::system_clock::time_point(duration));
     }
+    
+    // 重置缓存
+    cache_valid_ = false;
 }
 
 uint64_t HyperLogLogItem::hash(const Value& value) const {
     return murmurHash3(value.data(), value.size(), 0x12345678);
 }
 
-bool HyperLogLogItem::add(const Value& element) {
-    uint64_t hash_value = hash(element);
-    
+uint8_t HyperLogLogItem::getDenseRegister(size_t index) const {
+    const size_t bit = index * 6;
+    const size_t byte = bit / 8;
+    const unsigned shift = bit % 8;
+    unsigned value = dense_[byte] >> shift;
+    if (shift > 2) {
+        value |= static_cast<unsigned>(dense_[byte + 1]) << (8 - shift);
+    }
+    return static_cast<uint8_t>(value & 63);
+}
+
+void HyperLogLogItem::setDenseRegister(size_t index, uint8_t value) {
+    const size_t bit = index * 6;
+    const size_t byte = bit / 8;
+    const unsigned shift = bit % 8;
+    dense_[byte] = static_cast<uint8_t>((dense_[byte] & ~(63u << shift)) | (value << shift));
+    if (shift > 2) {
+        const unsigned high = 8 - shift;
+        dense_[byte + 1] = static_cast<uint8_t>((dense_[byte + 1] & ~(63u >> high)) | (value >> high));
+    }
+}
+
+void HyperLogLogItem::toDense() {
+    dense_.assign(kDenseBytes, 0);
+    for (uint32_t entry : sparse_) {
+        setDenseRegister(entry >> 8, entry & 0xff);
+    }
+    std::vector<uint32_t>().swap(sparse_);
+}
+
+uint32_t HyperLogLogItem::registerEntry(uint64_t hash_value) {
     // 提取桶索引（kPrecision位）
-    uint32_t index = hash_value & ((1 << kPrecision) - 1);
+    const uint32_t index = hash_value & ((1 << kPrecision) - 1);
     
-    // 剩余位中的前导零个数+1
-    uint8_t leading_zeros = 1;
+    // 剩余位中末尾连续0的个数+1
     hash_value >>= kPrecision;
-    
-    while (hash_value > 0 && (hash_value & 1) == 0) {
-        leading_zeros++;
-        hash_value >>= 1;
+    const uint32_t rank = hash_value == 0 ? 64 - kPrecision + 1 : __builtin_ctzll(hash_value) + 1;
+    return index << 8 | rank;
+}
+
+bool HyperLogLogItem::add(const Value& element) {
+    const uint32_t entry = registerEntry(hash(element));
+    const uint32_t index = entry >> 8;
+    const uint8_t rank = entry & 0xff;
+
+    if (isSparse()) {
+        auto it = std::lower_bound(sparse_.begin(), sparse_.end(), index << 8);
+        if (it != sparse_.end() && (*it >> 8) == index) {
+            if ((*it & 0xff) >= rank) {
+                return false;
+            }
+            *it = index << 8 | rank;
+            cache_valid_ = false;
+            return true;
+        }
+        if (sparse_.size() < kSparseMaxEntries) {
+            sparse_.insert(it, index << 8 | rank);
+            cache_valid_ = false;
+            return true;
+        }
+        toDense();
     }
     
-    // 如果当前前导零个数大于寄存器中的值，则更新
-    if (leading_zeros > registers_[index]) {
-        registers_[index] = leading_zeros;
+    // 如果当前值大于寄存器中的值，则更新
+    if (rank > getDenseRegister(index)) {
+        setDenseRegister(index, rank);
         cache_valid_ = false; // 缓存失效
         return true;
     }
@@ -197,32 +374,152 @@ bool HyperLogLogItem::add(const Value& element) {
     return false;
 }
 
-void HyperLogLogItem::updateCardinality() const {
-    double estimate = 0.0;
-    
+bool HyperLogLogItem::add(const Value* elements, size_t count) {
+    constexpr size_t kBatch = 64;
+    uint32_t entries[kBatch];
+    bool modified = false;
+    for (size_t begin = 0; begin < count; begin += kBatch) {
+        const size_t n = std::min(kBatch, count - begin);
+        // 哈希计算之间没有依赖，集中计算便于流水线并行
+        for (size_t i = 0; i < n; ++i) {
+            entries[i] = registerEntry(hash(elements[begin + i]));
+        }
+        if (isSparse() ? addSparse(entries, n) : addDense(entries, n)) {
+            modified = true;
+        }
+    }
+    if (modified) {
+        cache_valid_ = false;
+    }
+    return modified;
+}
+
+bool HyperLogLogItem::addDense(const uint32_t* entries, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        __builtin_prefetch(dense_.data() + (entries[i] >> 8) * 6 / 8, 1);
+    }
+    bool modified = false;
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t index = entries[i] >> 8;
+        const uint8_t rank = entries[i] & 0xff;
+        if (rank > getDenseRegister(index)) {
+            setDenseRegister(index, rank);
+            modified = true;
+        }
+    }
+    return modified;
+}
+
+bool HyperLogLogItem::addSparse(uint32_t* entries, size_t count) {
+    // 排序后同一寄存器的更新相邻，值最大的在最后
+    std::sort(entries, entries + count);
+    std::vector<uint32_t> merged;
+    merged.reserve(sparse_.size() + count);
+    bool modified = false;
+    size_t i = 0;
+    for (size_t j = 0; j < count; ++j) {
+        if (j + 1 < count && (entries[j + 1] >> 8) == (entries[j] >> 8)) {
+            continue;
+        }
+        const uint32_t index = entries[j] >> 8;
+        while (i < sparse_.size() && (sparse_[i] >> 8) < index) {
+            merged.push_back(sparse_[i++]);
+        }
+        if (i < sparse_.size() && (sparse_[i] >> 8) == index) {
+            if (entries[j] > sparse_[i]) {
+                modified = true;
+            }
+            merged.push_back(std::max(entries[j], sparse_[i++]));
+        } else {
+            merged.push_back(entries[j]);
+            modified = true;
+        }
+    }
+    merged.insert(merged.end(), sparse_.begin() + i, sparse_.end());
+    if (merged.size() > kSparseMaxEntries) {
+        toDense();
+        return addDense(entries, count);
+    }
+    sparse_.swap(merged);
+    return modified;
+}
+
+void HyperLogLogItem::maxInto(uint8_t* raw) const {
+    if (isSparse()) {
+        for (uint32_t entry : sparse_) {
+            uint8_t& reg = raw[entry >> 8];
+            reg = std::max<uint8_t>(reg, entry & 0xff);
+        }
+        return;
+    }
+    // 先解包到字节数组，再按SIMD取最大值
+    uint8_t unpacked[kRegisterCount];
+    for (size_t group = 0; group < kRegisterCount / 4; ++group) {
+        unpackGroup(dense_.data() + group * 3, unpacked + group * 4);
+    }
+    maxRegisters(raw, unpacked, kRegisterCount);
+}
+
+void HyperLogLogItem::loadRaw(const uint8_t* raw) {
+    const size_t nonzero = kRegisterCount - std::count(raw, raw + kRegisterCount, 0);
+    if (isSparse() && nonzero <= kSparseMaxEntries) {
+        sparse_.clear();
+        sparse_.reserve(nonzero);
+        for (uint32_t i = 0; i < kRegisterCount; ++i) {
+            if (raw[i] != 0) {
+                sparse_.push_back(i << 8 | raw[i]);
+            }
+        }
+        return;
+    }
+    std::vector<uint32_t>().swap(sparse_);
+    dense_.assign(kDenseBytes, 0);
+    for (size_t group = 0; group < kRegisterCount / 4; ++group) {
+        const uint8_t* r = raw + group * 4;
+        uint8_t* out = dense_.data() + group * 3;
+        out[0] = static_cast<uint8_t>(r[0] | (r[1] << 6));
+        out[1] = static_cast<uint8_t>((r[1] >> 2) | (r[2] << 4));
+        out[2] = static_cast<uint8_t>((r[2] >> 4) | (r[3] << 2));
+    }
+}
+
+uint64_t HyperLogLogItem::estimate(const uint32_t* histogram) {
     // 计算调和平均数
+    const auto& powers = inversePowers();
     double sum = 0.0;
-    for (uint8_t reg : registers_) {
-        sum += 1.0 / (1ULL << reg);
+    for (size_t r = 0; r < kHistogramSize; ++r) {
+        sum += histogram[r] * powers[r];
     }
     
-    estimate = kAlpha * kRegisterCount * kRegisterCount / sum;
+    double estimate = kAlpha * kRegisterCount * kRegisterCount / sum;
     
     // 小基数修正
-    if (estimate <= 5.0 * kRegisterCount / 2.0) {
-        uint64_t zeros = 0;
-        for (uint8_t reg : registers_) {
-            if (reg == 0) {
-                zeros++;
-            }
+    const uint32_t zeros = histogram[0];
+    if (estimate <= 5.0 * kRegisterCount / 2.0 && zeros > 0) {
+        estimate = kRegisterCount * log(static_cast<double>(kRegisterCount) / zeros);
+    }
+    
+    return static_cast<uint64_t>(estimate);
+}
+
+void HyperLogLogItem::updateCardinality() const {
+    uint32_t histogram[kHistogramSize] = {};
+    if (isSparse()) {
+        histogram[0] = static_cast<uint32_t>(kRegisterCount - sparse_.size());
+        for (uint32_t entry : sparse_) {
+            histogram[entry & 0xff]++;
         }
-        
-        if (zeros > 0) {
-            estimate = kRegisterCount * log(static_cast<double>(kRegisterCount) / zeros);
+    } else {
+        uint8_t regs[4];
+        for (size_t group = 0; group < kRegisterCount / 4; ++group) {
+            unpackGroup(dense_.data() + group * 3, regs);
+            histogram[regs[0]]++;
+            histogram[regs[1]]++;
+            histogram[regs[2]]++;
+            histogram[regs[3]]++;
         }
     }
-    
-    cardinality_ = static_cast<uint64_t>(estimate);
+    cardinality_ = estimate(histogram);
     cache_valid_ = true;
 }
 
@@ -234,48 +531,48 @@ uint64_t HyperLogLogItem::count() const {
     return cardinality_;
 }
 
+uint64_t HyperLogLogItem::countUnion(const std::vector<const HyperLogLogItem*>& hll_items) {
+    uint8_t raw[kRegisterCount] = {};
+    for (const auto* item : hll_items) {
+        item->maxInto(raw);
+    }
+    uint32_t histogram[kHistogramSize] = {};
+    for (uint8_t reg : raw) {
+        histogram[reg]++;
+    }
+    return estimate(histogram);
+}
+
 bool HyperLogLogItem::merge(const std::vector<HyperLogLogItem*>& hll_items) {
     if (hll_items.empty()) {
         return false;
     }
     
-    bool modified = false;
-    
-    // 对每个寄存器，取最大值
-    for (size_t i = 0; i < kRegisterCount; ++i) {
-        uint8_t max_val = registers_[i];
-        
-        for (const auto& item : hll_items) {
-            if (item->registers_[i] > max_val) {
-                max_val = item->registers_[i];
-            }
-        }
-        
-        if (max_val != registers_[i]) {
-            registers_[i] = max_val;
-            modified = true;
-        }
+    // 在栈上的寄存器缓冲区中对每个寄存器取最大值
+    uint8_t before[kRegisterCount] = {};
+    maxInto(before);
+    uint8_t merged[kRegisterCount];
+    std::memcpy(merged, before, kRegisterCount);
+    for (const auto& item : hll_items) {
+        item->maxInto(merged);
     }
     
-    if (modified) {
-        cache_valid_ = false;
+    if (std::memcmp(before, merged, kRegisterCount) == 0) {
+        return false;
     }
-    
-    return modified;
+    loadRaw(merged);
+    cache_valid_ = false;
+    return true;
 }
 
 void HyperLogLogItem::clear() {
-    std::fill(registers_.begin(), registers_.end(), 0);
+    std::vector<uint32_t>().swap(sparse_);
+    std::vector<uint8_t>().swap(dense_);
     cache_valid_ = false;
 }
 
 bool HyperLogLogItem::empty() const {
-    for (uint8_t reg : registers_) {
-        if (reg != 0) {
-            return false;
-        }
-    }
-    return true;
+    return isSparse() && sparse_.empty();
 }
 
 // 全局工厂函数实现
@@ -287,4 +584,4 @@ dkv::DataItem* createHyperLogLogItem(dkv::Timestamp expire_time) {
     return new HyperLogLogItem(expire_time);
 }
 
-} // namespace dkv
\ No newline at end of file
+} // namespace dkv
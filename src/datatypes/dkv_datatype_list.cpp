@@ -24,6 +24,18 @@ std::unique_ptr<DataItem> ListItem::clone() const {
     return cloned;
 }
 
+std::unique_ptr<DataItem> ListItem::cloneEmpty() const {
+    return std::make_unique<ListItem>();
+}
+
+size_t ListItem::memoryUsage(size_t samples) const {
+    return sizeof(ListItem) + elements_.memoryUsage(samples);
+}
+
+const char* ListItem::encodingName() const {
+    return "quicklist";
+}
+
 DataType ListItem::getType() const {
     return DataType::LIST;
 }
@@ -32,7 +44,7 @@ std::string ListItem::serialize() const {
     std::ostringstream oss;
     oss << "LIST:" << elements_.size() << ":";
     
-    for (const auto& element : elements_) {
+    for (const auto& element : elements_.range(0, elements_.size())) {
         oss << element.length() << ":" << element << ":";
     }
     
@@ -61,7 +73,7 @@ void ListItem::deserialize(const std::string& data) {
                 std::getline(iss, element, ':')) {
                 
                 size_t len = std::stoul(len_str);
-                elements_.push_back(element.substr(0, len));
+                elements_.pushBack(std::string_view(element).substr(0, len));
             }
         }
         
@@ -79,31 +91,21 @@ void ListItem::deserialize(const std::string& data) {
 // 列表特有操作实现
 
 size_t ListItem::lpush(const Value& value) {
-    elements_.insert(elements_.begin(), value);
+    elements_.pushFront(value);
     return elements_.size();
 }
 
 size_t ListItem::rpush(const Value& value) {
-    elements_.push_back(value);
+    elements_.pushBack(value);
     return elements_.size();
 }
 
 bool ListItem::lpop(Value& value) {
-    if (elements_.empty()) {
-        return false;
-    }
-    value = elements_.front();
-    elements_.erase(elements_.begin());
-    return true;
+    return elements_.popFront(value);
 }
 
 bool ListItem::rpop(Value& value) {
-    if (elements_.empty()) {
-        return false;
-    }
-    value = elements_.back();
-    elements_.pop_back();
-    return true;
+    return elements_.popBack(value);
 }
 
 size_t ListItem::size() const {
@@ -111,39 +113,16 @@ size_t ListItem::size() const {
 }
 
 std::vector<Value> ListItem::lrange(size_t start, size_t stop) const {
-    std::vector<Value> result;
-    
-    if (elements_.empty()) {
-        return result;
-    }
-    
-    // 处理负数索引（Redis风格）
-    if (stop >= elements_.size()) {
-        stop = elements_.size() - 1;
-    }
-    
-    if (start > stop) {
-        return result;
-    }
-    
-    // 预分配结果空间
-    result.reserve(stop - start + 1);
-    
-    // 使用迭代器遍历指定范围的元素
-    auto it = elements_.begin();
-    
-    // 移动到起始位置
-    std::advance(it, start);
-    
-    // 收集范围内的元素
-    size_t count = 0;
-    while (it != elements_.end() && count <= (stop - start)) {
-        result.push_back(*it);
-        ++it;
-        ++count;
-    }
-    
-    return result;
+    // 超出范围的stop由快速列表截断，起始位置按节点整块跳过
+    return elements_.range(start, stop);
+}
+
+bool ListItem::lindex(int64_t index, Value& value) const {
+    return elements_.index(index, value);
+}
+
+bool ListItem::lset(int64_t index, const Value& value) {
+    return elements_.set(index, value);
 }
 
 void ListItem::clear() {
@@ -1,4 +1,5 @@
 #include "datatypes/dkv_datatype_set.hpp"
+#include "datatypes/dkv_datatype_string.hpp"
 #include <sstream>
 #include <algorithm>
 
@@ -11,8 +12,33 @@ SetItem::SetItem(Timestamp expire_time) : DataItem(expire_time) {
 }
 
 SetItem::SetItem(const SetItem& other)
-    : DataItem(other) {
-    elements_ = other.elements_; // 深拷贝集合元素
+    : DataItem(other), ints_(other.ints_), packed_(other.packed_), encoding_(other.encoding_) {
+    if (other.elements_) {
+        elements_ = std::make_unique<std::unordered_set<Value>>(*other.elements_); // 深拷贝集合元素
+    }
+}
+
+void SetItem::convertToListpack() {
+    for (size_t i = 0; i < ints_.size(); ++i) {
+        packed_.append(std::to_string(ints_.get(i)));
+    }
+    ints_.clear();
+    encoding_ = SetEncoding::LISTPACK;
+}
+
+void SetItem::convertToDict() {
+    auto elements = std::make_unique<std::unordered_set<Value>>();
+    elements->reserve(scard());
+    for (size_t i = 0; i < ints_.size(); ++i) {
+        elements->emplace(std::to_string(ints_.get(i)));
+    }
+    for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(pos)) {
+        elements->emplace(packed_.get(pos));
+    }
+    ints_.clear();
+    packed_.clear();
+    elements_ = std::move(elements);
+    encoding_ = SetEncoding::HASHTABLE;
 }
 
 std::unique_ptr<DataItem> SetItem::clone() const {
@@ -20,6 +46,31 @@ std::unique_ptr<DataItem> SetItem::clone() const {
     return cloned;
 }
 
+std::unique_ptr<DataItem> SetItem::cloneEmpty() const {
+    return std::make_unique<SetItem>();
+}
+
+size_t SetItem::memoryUsage(size_t samples) const {
+    size_t bytes = sizeof(SetItem) + stringHeapBytes(ints_.raw()) + stringHeapBytes(packed_.raw());
+    if (elements_) {
+        bytes += sizeof(*elements_) + hashTableBytes(*elements_);
+        bytes += sampledBytes(elements_->begin(), elements_->end(), elements_->size(), samples,
+                              [](const Value& member) { return stringHeapBytes(member); });
+    }
+    return bytes;
+}
+
+const char* SetItem::encodingName() const {
+    switch (encoding_) {
+        case SetEncoding::INTSET:
+            return "intset";
+        case SetEncoding::LISTPACK:
+            return "listpack";
+        default:
+            return "hashtable";
+    }
+}
+
 DataType SetItem::getType() const {
     return DataType::SET;
 }
@@ -31,15 +82,15 @@ std::string SetItem::serialize() const {
     ss << (hasExpiration() ? "1" : "0") << "\n";
     if (hasExpiration()) {
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-            expire_time_.load().time_since_epoch());
+            getExpiration().time_since_epoch());
         ss << duration.count() << "\n";
     }
     
     // 序列化集合大小
-    ss << elements_.size() << "\n";
+    ss << scard() << "\n";
     
     // 序列化每个元素
-    for (const auto& element : elements_) {
+    for (const auto& element : smembers()) {
         ss << element.size() << "\n" << element << "\n";
     }
     
@@ -61,7 +112,7 @@ void SetItem::deserialize(const std::string& data) {
     }
     
     // 清空现有元素
-    elements_.clear();
+    clear();
     
     // 反序列化集合大小
     std::getline(ss, line);
@@ -81,13 +132,39 @@ void SetItem::deserialize(const std::string& data) {
         // 跳过换行符
         ss.ignore();
         
-        elements_.insert(element);
+        sadd(element);
     }
 }
 
 bool SetItem::sadd(const Value& member) {
+    const ListpackConfig& config = listpackConfig();
+    if (encoding_ == SetEncoding::INTSET) {
+        int64_t value;
+        const bool is_int = StringItem::tryParseInt(member, value);
+        if (is_int && ints_.contains(value)) {
+            return false;
+        }
+        if (is_int && ints_.size() < config.set_max_intset_entries) {
+            return ints_.insert(value);
+        }
+        if (!is_int && ints_.size() < config.set_max_entries && member.size() <= config.set_max_value) {
+            convertToListpack();
+        } else {
+            convertToDict();
+        }
+    }
+    if (encoding_ == SetEncoding::LISTPACK) {
+        if (packed_.find(member) != packed_.end()) {
+            return false;
+        }
+        if (member.size() <= config.set_max_value && packed_.size() < config.set_max_entries) {
+            packed_.append(member);
+            return true;
+        }
+        convertToDict();
+    }
     // 插入元素，如果元素已经存在则返回false
-    auto [it, inserted] = elements_.insert(member);
+    auto [it, inserted] = elements_->insert(member);
     return inserted;
 }
 
@@ -103,8 +180,20 @@ size_t SetItem::sadd(const std::vector<Value>& members) {
 }
 
 bool SetItem::srem(const Value& member) {
+    if (encoding_ == SetEncoding::INTSET) {
+        int64_t value;
+        return StringItem::tryParseInt(member, value) && ints_.erase(value);
+    }
+    if (isPacked()) {
+        size_t pos = packed_.find(member);
+        if (pos == packed_.end()) {
+            return false;
+        }
+        packed_.erase(pos);
+        return true;
+    }
     // 删除元素，如果元素不存在则返回false
-    return elements_.erase(member) > 0;
+    return elements_->erase(member) > 0;
 }
 
 size_t SetItem::srem(const std::vector<Value>& members) {
@@ -120,27 +209,142 @@ size_t SetItem::srem(const std::vector<Value>& members) {
 
 std::vector<Value> SetItem::smembers() const {
     std::vector<Value> members;
-    members.reserve(elements_.size());
-    for (const auto& element : elements_) {
+    members.reserve(scard());
+    if (encoding_ == SetEncoding::INTSET) {
+        for (size_t i = 0; i < ints_.size(); ++i) {
+            members.push_back(std::to_string(ints_.get(i)));
+        }
+        return members;
+    }
+    if (isPacked()) {
+        for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(pos)) {
+            members.emplace_back(packed_.get(pos));
+        }
+        return members;
+    }
+    for (const auto& element : *elements_) {
         members.push_back(element);
     }
     return members;
 }
 
+size_t SetItem::scan(size_t cursor, size_t count, std::vector<Value>& out) const {
+    if (encoding_ == SetEncoding::INTSET) {
+        for (size_t i = 0; i < ints_.size(); ++i) {
+            out.push_back(std::to_string(ints_.get(i)));
+        }
+        return 0;
+    }
+    if (isPacked()) {
+        for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(pos)) {
+            out.emplace_back(packed_.get(pos));
+        }
+        return 0;
+    }
+    return scanBuckets(*elements_, cursor, count, [&out](const Value& element) {
+        out.push_back(element);
+    });
+}
+
 bool SetItem::sismember(const Value& member) const {
-    return elements_.count(member) > 0;
+    if (encoding_ == SetEncoding::INTSET) {
+        int64_t value;
+        return StringItem::tryParseInt(member, value) && ints_.contains(value);
+    }
+    if (isPacked()) {
+        return packed_.find(member) != packed_.end();
+    }
+    return elements_->count(member) > 0;
 }
 
 size_t SetItem::scard() const {
-    return elements_.size();
+    switch (encoding_) {
+        case SetEncoding::INTSET:
+            return ints_.size();
+        case SetEncoding::LISTPACK:
+            return packed_.size();
+        default:
+            return elements_->size();
+    }
 }
 
 void SetItem::clear() {
-    elements_.clear();
+    ints_.clear();
+    packed_.clear();
+    elements_.reset();
+    encoding_ = SetEncoding::INTSET;
 }
 
 bool SetItem::empty() const {
-    return elements_.empty();
+    return scard() == 0;
+}
+
+std::unique_ptr<SetItem> SetItem::combine(SetOp op, const std::vector<const SetItem*>& sets) {
+    auto result = std::make_unique<SetItem>();
+    if (sets.empty()) {
+        return result;
+    }
+    if (op == SetOp::UNION) {
+        for (const SetItem* set : sets) {
+            if (set) {
+                result->sadd(set->smembers());
+            }
+        }
+        return result;
+    }
+    if (op == SetOp::DIFF) {
+        if (!sets[0]) {
+            return result;
+        }
+        for (const Value& member : sets[0]->smembers()) {
+            bool found = false;
+            for (size_t i = 1; i < sets.size() && !found; ++i) {
+                found = sets[i] && sets[i]->sismember(member);
+            }
+            if (!found) {
+                result->sadd(member);
+            }
+        }
+        return result;
+    }
+
+    // 交集：有一个集合为空则结果为空
+    std::vector<const SetItem*> ordered(sets);
+    for (const SetItem* set : ordered) {
+        if (!set || set->empty()) {
+            return result;
+        }
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const SetItem* a, const SetItem* b) {
+        return a->scard() < b->scard();
+    });
+    if (ordered.size() > 1 && ordered[0]->encoding_ == SetEncoding::INTSET &&
+        ordered[1]->encoding_ == SetEncoding::INTSET) {
+        std::vector<int64_t> common;
+        IntSet::intersect(ordered[0]->ints_, ordered[1]->ints_, common);
+        for (int64_t value : common) {
+            bool found = true;
+            for (size_t i = 2; i < ordered.size() && found; ++i) {
+                found = ordered[i]->encoding_ == SetEncoding::INTSET ? ordered[i]->ints_.contains(value)
+                                                                     : ordered[i]->sismember(std::to_string(value));
+            }
+            if (found) {
+                // 结果不多于最小的集合，仍是整数数组
+                result->ints_.insert(value);
+            }
+        }
+        return result;
+    }
+    for (const Value& member : ordered[0]->smembers()) {
+        bool found = true;
+        for (size_t i = 1; i < ordered.size() && found; ++i) {
+            found = ordered[i]->sismember(member);
+        }
+        if (found) {
+            result->sadd(member);
+        }
+    }
+    return result;
 }
 
 } // namespace dkv
\ No newline at end of file
@@ -1,23 +1,122 @@
 #include "datatypes/dkv_datatype_string.hpp"
 #include "dkv_utils.hpp"
+#include "dkv_lzf.hpp"
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstring>
 
 namespace dkv {
 
+StringCompressionConfig& stringCompressionConfig() {
+    static StringCompressionConfig config;
+    return config;
+}
+
 // StringItem 实现
 StringItem::StringItem(const Value& value) 
-    : value_(value), DataItem() {
+    : DataItem() {
+    encode(value);
 }
 
 StringItem::StringItem(const Value& value, Timestamp expire_time)
-    : value_(value), DataItem(expire_time) {
+    : DataItem(expire_time) {
+    encode(value);
 }
 
 StringItem::StringItem(const StringItem& other)
-    : DataItem(other) {
-    value_ = other.value_; // 深拷贝字符串值
+    : DataItem(other), embstr_len_(other.embstr_len_), encoding_(other.encoding_) {
+    switch (other.encoding_) {
+        case StringEncoding::INT:
+            int_value_ = other.int_value_;
+            break;
+        case StringEncoding::EMBSTR:
+            std::memcpy(embstr_, other.embstr_, other.embstr_len_);
+            break;
+        case StringEncoding::RAW:
+            raw_ = new Value(*other.raw_); // 深拷贝字符串值
+            break;
+        case StringEncoding::COMPRESSED:
+            compressed_.data = new Value(*other.compressed_.data); // 拷贝压缩形式，不解压
+            compressed_.raw_len = other.compressed_.raw_len;
+            break;
+    }
+}
+
+StringItem::~StringItem() {
+    releaseRaw();
+}
+
+void StringItem::releaseRaw() {
+    if (encoding_ == StringEncoding::RAW) {
+        delete raw_;
+    } else if (encoding_ == StringEncoding::COMPRESSED) {
+        delete compressed_.data;
+    } else {
+        return;
+    }
+    encoding_ = StringEncoding::EMBSTR;
+    embstr_len_ = 0;
+}
+
+bool StringItem::tryParseInt(const Value& value, int64_t& out) {
+    // int64最长20个字符
+    if (value.empty() || value.size() > 20) {
+        return false;
+    }
+    const char* begin = value.data();
+    const char* end = begin + value.size();
+    const char* digits = value[0] == '-' ? begin + 1 : begin;
+    // 拒绝前导零和"-0"，保证还原后与原字符串一致
+    if (digits == end || (*digits == '0' && (end - digits > 1 || digits != begin))) {
+        return false;
+    }
+    auto result = std::from_chars(begin, end, out);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+void StringItem::encode(const Value& value) {
+    int64_t int_value;
+    if (tryParseInt(value, int_value)) {
+        int_value_ = int_value;
+        encoding_ = StringEncoding::INT;
+    } else if (value.size() <= EMBSTR_MAX_LEN) {
+        std::memcpy(embstr_, value.data(), value.size());
+        embstr_len_ = static_cast<uint8_t>(value.size());
+        encoding_ = StringEncoding::EMBSTR;
+    } else {
+        Value compressed;
+        if (tryCompress(value, compressed)) {
+            compressed_.data = new Value(std::move(compressed));
+            compressed_.raw_len = static_cast<uint32_t>(value.size());
+            encoding_ = StringEncoding::COMPRESSED;
+            return;
+        }
+        raw_ = new Value(value);
+        encoding_ = StringEncoding::RAW;
+    }
+}
+
+bool StringItem::tryCompress(const Value& value, Value& out) {
+    const StringCompressionConfig& config = stringCompressionConfig();
+    if (!config.enabled || value.size() < config.min_bytes || value.size() > UINT32_MAX) {
+        return false;
+    }
+    // 输出缓冲区只留到满足最小压缩比的长度，放不下即收益不足，lzf返回0
+    const double ratio = std::max(config.min_ratio, 1.0);
+    const size_t limit = static_cast<size_t>(static_cast<double>(value.size()) / ratio);
+    if (limit == 0) {
+        return false;
+    }
+    out.resize(limit);
+    const size_t length = lzf::compress(value.data(), value.size(), &out[0], limit);
+    if (length == 0) {
+        return false;
+    }
+    out.resize(length);
+    out.shrink_to_fit();
+    return true;
 }
 
 std::unique_ptr<DataItem> StringItem::clone() const {
@@ -25,15 +124,50 @@ std::unique_ptr<DataItem> StringItem::clone() const {
     return cloned;
 }
 
+std::unique_ptr<DataItem> StringItem::cloneEmpty() const {
+    return std::make_unique<StringItem>();
+}
+
+size_t StringItem::memoryUsage(size_t) const {
+    switch (encoding_) {
+        case StringEncoding::RAW:
+            return sizeof(StringItem) + sizeof(Value) + stringHeapBytes(*raw_);
+        case StringEncoding::COMPRESSED:
+            return sizeof(StringItem) + sizeof(Value) + stringHeapBytes(*compressed_.data);
+        default:
+            return sizeof(StringItem);
+    }
+}
+
+const char* StringItem::encodingName() const {
+    switch (encoding_) {
+        case StringEncoding::INT:
+            return "int";
+        case StringEncoding::EMBSTR:
+            return "embstr";
+        case StringEncoding::RAW:
+            return "raw";
+        default:
+            return "compressed";
+    }
+}
+
 DataType StringItem::getType() const {
     return DataType::STRING;
 }
 
 std::string StringItem::serialize() const {
     std::ostringstream oss;
-    oss << "STRING:" << value_.length() << ":" << value_;
+    if (encoding_ == StringEncoding::COMPRESSED) {
+        // 保留压缩形式：STRINGZ:原长:压缩长度:压缩字节
+        const Value& data = *compressed_.data;
+        oss << "STRINGZ:" << compressed_.raw_len << ":" << data.size() << ":" << data;
+    } else {
+        Value value = getValue();
+        oss << "STRING:" << value.length() << ":" << value;
+    }
     if (hasExpiration()) {
-        auto duration = expire_time_.load().time_since_epoch();
+        auto duration = getExpiration().time_since_epoch();
         auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
         oss << ":" << seconds;
     }
@@ -41,6 +175,34 @@ std::string StringItem::serialize() const {
 }
 
 void StringItem::deserialize(const std::string& data) {
+    if (data.compare(0, 8, "STRINGZ:") == 0) {
+        // 压缩字节中可能含有':'，按长度截取
+        size_t pos = 8;
+        size_t end = data.find(':', pos);
+        if (end == std::string::npos) {
+            return;
+        }
+        const size_t raw_len = std::stoul(data.substr(pos, end - pos));
+        pos = end + 1;
+        end = data.find(':', pos);
+        if (end == std::string::npos) {
+            return;
+        }
+        const size_t length = std::stoul(data.substr(pos, end - pos));
+        pos = end + 1;
+        if (pos + length > data.size() || raw_len > UINT32_MAX) {
+            return;
+        }
+        releaseRaw();
+        compressed_.data = new Value(data, pos, length);
+        compressed_.raw_len = static_cast<uint32_t>(raw_len);
+        encoding_ = StringEncoding::COMPRESSED;
+        pos += length;
+        if (pos < data.size() && data[pos] == ':') {
+            setExpiration(Timestamp(std::chrono::seconds(std::stoll(data.substr(pos + 1)))));
+        }
+        return;
+    }
     std::istringstream iss(data);
     std::string type, length_str, value_str;
     
@@ -49,7 +211,7 @@ void StringItem::deserialize(const std::string& data) {
         std::getline(iss, value_str, ':')) {
         
         size_t length = std::stoul(length_str);
-        value_ = value_str.substr(0, length);
+        setValue(value_str.substr(0, length));
         
         // 检查是否有过期时间
         std::string expire_str;
@@ -60,12 +222,64 @@ void StringItem::deserialize(const std::string& data) {
     }
 }
 
-const Value& StringItem::getValue() const {
-    return value_;
+Value StringItem::getValue() const {
+    switch (encoding_) {
+        case StringEncoding::INT:
+            return std::to_string(int_value_);
+        case StringEncoding::EMBSTR:
+            return Value(embstr_, embstr_len_);
+        case StringEncoding::RAW:
+            return *raw_;
+        case StringEncoding::COMPRESSED: {
+            Value value(compressed_.raw_len, '\0');
+            const Value& data = *compressed_.data;
+            if (lzf::decompress(data.data(), data.size(), &value[0], value.size()) != value.size()) {
+                return Value();
+            }
+            return value;
+        }
+    }
+    return Value();
 }
 
 void StringItem::setValue(const Value& value) {
-    value_ = value;
+    // 长字符串覆盖长字符串且不需压缩时复用已有的分配
+    if (encoding_ == StringEncoding::RAW && value.size() > EMBSTR_MAX_LEN &&
+        (!stringCompressionConfig().enabled || value.size() < stringCompressionConfig().min_bytes)) {
+        *raw_ = value;
+        return;
+    }
+    releaseRaw();
+    encode(value);
+}
+
+bool StringItem::getInt(int64_t& out) const {
+    if (encoding_ == StringEncoding::INT) {
+        out = int_value_;
+        return true;
+    }
+    // 非规范形式的数值（如"007"）沿用原有的解析规则
+    Value value = getValue();
+    if (!Utils::isNumeric(value)) {
+        return false;
+    }
+    try {
+        out = Utils::stringToInt(value);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool StringItem::incrBy(int64_t delta, int64_t& result) {
+    int64_t current;
+    if (!getInt(current) || __builtin_add_overflow(current, delta, &result)) {
+        return false;
+    }
+    releaseRaw();
+    int_value_ = result;
+    encoding_ = StringEncoding::INT;
+    return true;
 }
 
-} // namespace dkv
\ No newline at end of file
+} // namespace dkv
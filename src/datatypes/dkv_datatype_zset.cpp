@@ -2,10 +2,123 @@
 #include "dkv_utils.hpp"
 #include <sstream>
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <thread>
 
 namespace dkv {
 
+namespace {
+
+// 分数以8字节原始表示存入listpack
+inline std::string_view encodeScore(double score, char* buffer) {
+    std::memcpy(buffer, &score, sizeof(score));
+    return std::string_view(buffer, sizeof(score));
+}
+
+inline bool scoreEqual(double a, double b) {
+    return std::abs(a - b) <= 1e-9;
+}
+
+// 元素总数达到该值时按成员区间并行归并
+constexpr size_t PARALLEL_MERGE_MIN_ELEMENTS = 256 * 1024;
+constexpr size_t MAX_MERGE_PARTITIONS = 8;
+
+// 归并时引用输入中的成员，结果写入目标时才复制
+using ScoredView = std::pair<std::string_view, double>;
+
+// 一个输入中按成员排序的一段
+struct MergeRange {
+    const ScoredView* begin;
+    const ScoredView* end;
+};
+
+// 与Redis相同，0乘以无穷等得到NaN时记为0
+inline double weightedScore(double score, double weight) {
+    const double result = score * weight;
+    return std::isnan(result) ? 0 : result;
+}
+
+inline double aggregateScore(ZSetAggregate aggregate, double a, double b) {
+    switch (aggregate) {
+        case ZSetAggregate::MIN:
+            return std::min(a, b);
+        case ZSetAggregate::MAX:
+            return std::max(a, b);
+        default: {
+            const double sum = a + b;
+            return std::isnan(sum) ? 0 : sum;
+        }
+    }
+}
+
+inline bool scoredBefore(const std::pair<Value, double>& a, const std::pair<Value, double>& b) {
+    return a.second < b.second || (a.second == b.second && a.first < b.first);
+}
+
+// 在threads个线程上执行fn(0) ... fn(tasks - 1)，调用线程也参与
+void runParallel(size_t tasks, size_t threads, const std::function<void(size_t)>& fn) {
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t task = next++; task < tasks; task = next++) {
+            fn(task);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < std::min(threads, tasks); ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+// k路归并：最小堆按成员取出各输入的当前元素，相同成员连续出堆后合并分数。
+// 交集只保留在全部输入中都出现的成员
+void mergeByMember(const std::vector<MergeRange>& ranges, SetOp op, ZSetAggregate aggregate,
+                   std::vector<std::pair<Value, double>>& out) {
+    using Cursor = const ScoredView*;
+    std::vector<Cursor> ends(ranges.size());
+    auto later = [](const std::pair<Cursor, size_t>& a, const std::pair<Cursor, size_t>& b) {
+        return a.first->first > b.first->first;
+    };
+    std::priority_queue<std::pair<Cursor, size_t>, std::vector<std::pair<Cursor, size_t>>, decltype(later)> heap(later);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        ends[i] = ranges[i].end;
+        if (ranges[i].begin != ranges[i].end) {
+            heap.emplace(ranges[i].begin, i);
+        }
+    }
+    while (!heap.empty()) {
+        auto [cursor, input] = heap.top();
+        heap.pop();
+        const std::string_view member = cursor->first;
+        double score = cursor->second;
+        size_t count = 1;
+        if (++cursor != ends[input]) {
+            heap.emplace(cursor, input);
+        }
+        while (!heap.empty() && heap.top().first->first == member) {
+            auto [other, other_input] = heap.top();
+            heap.pop();
+            score = aggregateScore(aggregate, score, other->second);
+            count++;
+            if (++other != ends[other_input]) {
+                heap.emplace(other, other_input);
+            }
+        }
+        if (op == SetOp::UNION || count == ranges.size()) {
+            out.emplace_back(Value(member), score);
+        }
+    }
+}
+
+} // namespace
+
 ZSetItem::ZSetItem() : DataItem() {
 }
 
@@ -13,9 +126,10 @@ ZSetItem::ZSetItem(Timestamp expire_time) : DataItem(expire_time) {
 }
 
 ZSetItem::ZSetItem(const ZSetItem& other)
-    : DataItem(other) {
-    elements_by_score_ = other.elements_by_score_; // 深拷贝按分数排序的元素
-    scores_ = other.scores_; // 深拷贝元素分数映射
+    : DataItem(other), packed_(other.packed_) {
+    if (other.dict_) {
+        dict_ = std::make_unique<SortedDict>(*other.dict_); // 深拷贝跳表和元素分数映射
+    }
 }
 
 std::unique_ptr<DataItem> ZSetItem::clone() const {
@@ -23,10 +137,77 @@ std::unique_ptr<DataItem> ZSetItem::clone() const {
     return cloned;
 }
 
+std::unique_ptr<DataItem> ZSetItem::cloneEmpty() const {
+    return std::make_unique<ZSetItem>();
+}
+
+size_t ZSetItem::memoryUsage(size_t samples) const {
+    size_t bytes = sizeof(ZSetItem) + stringHeapBytes(packed_.raw());
+    if (dict_) {
+        // 跳表头节点带满层指针；成员在跳表节点和哈希表中各存一份
+        bytes += sizeof(SortedDict) + sizeof(ZSkipList::Node) + ZSkipList::MAX_LEVEL * sizeof(ZSkipList::Node::Level);
+        bytes += hashTableBytes(dict_->scores);
+        const ZSkipList& zsl = dict_->zsl;
+        size_t visited = 0;
+        size_t node_bytes = 0;
+        for (ZSkipList::Node* node = zsl.first(); node && (samples == 0 || visited < samples); node = node->next()) {
+            node_bytes += sizeof(ZSkipList::Node) + node->level * sizeof(ZSkipList::Node::Level) +
+                          2 * stringHeapBytes(node->member);
+            visited++;
+        }
+        if (visited > 0) {
+            bytes += static_cast<size_t>(static_cast<double>(node_bytes) / visited * zsl.size());
+        }
+    }
+    return bytes;
+}
+
+const char* ZSetItem::encodingName() const {
+    return dict_ ? "skiplist" : "listpack";
+}
+
 DataType ZSetItem::getType() const {
     return DataType::ZSET;
 }
 
+void ZSetItem::convertToDict() {
+    auto dict = std::make_unique<SortedDict>();
+    dict->scores.reserve(packed_.size() / 2);
+    for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(packed_.next(pos))) {
+        Value member(packed_.get(pos));
+        double score = packedScore(pos);
+        dict->zsl.insert(score, member);
+        dict->scores.emplace(std::move(member), score);
+    }
+    packed_.clear();
+    dict_ = std::move(dict);
+}
+
+double ZSetItem::packedScore(size_t member_pos) const {
+    double score;
+    std::memcpy(&score, packed_.get(packed_.next(member_pos)).data(), sizeof(score));
+    return score;
+}
+
+size_t ZSetItem::packedFind(const Value& member) const {
+    return packed_.find(member, 1);
+}
+
+void ZSetItem::packedInsert(const Value& member, double score) {
+    // 找到第一个排在新元素之后的位置
+    size_t pos = packed_.begin();
+    while (pos != packed_.end()) {
+        double current = packedScore(pos);
+        if (current > score || (current == score && packed_.get(pos) > member)) {
+            break;
+        }
+        pos = packed_.next(packed_.next(pos));
+    }
+    char buffer[sizeof(double)];
+    pos = packed_.insert(pos, encodeScore(score, buffer));
+    packed_.insert(pos, member);
+}
+
 std::string ZSetItem::serialize() const {
     std::stringstream ss;
     
@@ -39,10 +220,10 @@ std::string ZSetItem::serialize() const {
     }
     
     // 序列化元素数量
-    ss << scores_.size() << "\n";
+    ss << zcard() << "\n";
     
-    // 序列化每个元素及其分数
-    for (const auto& pair : scores_) {
+    // 按顺序序列化每个元素及其分数
+    for (const auto& pair : zrange(0, zcard())) {
         ss << pair.first.size() << "\n" << pair.first << "\n";
         ss << pair.second << "\n";
     }
@@ -64,8 +245,7 @@ void ZSetItem::deserialize(const std::string& data) {
     }
     
     // 清空现有元素
-    elements_by_score_.clear();
-    scores_.clear();
+    clear();
     
     // 反序列化元素数量
     std::getline(ss, line);
@@ -95,28 +275,38 @@ void ZSetItem::deserialize(const std::string& data) {
 }
 
 bool ZSetItem::zadd(const Value& member, double score) {
-    // 检查元素是否已存在
-    bool updated = false;
-    auto it = scores_.find(member);
-    if (it != scores_.end()) {
-        // 如果分数不同，先从旧分数集合中移除
-        if (std::abs(it->second - score) > 1e-9) {
-            elements_by_score_[it->second].erase(member);
-            if (elements_by_score_[it->second].empty()) {
-                elements_by_score_.erase(it->second);
+    if (isPacked()) {
+        size_t pos = packedFind(member);
+        if (pos != packed_.end()) {
+            if (scoreEqual(packedScore(pos), score)) {
+                return false; // 分数相同，不需要更新
             }
-            updated = true;
-        } else {
+            packed_.erase(pos, 2);
+            packedInsert(member, score);
+            return true;
+        }
+        const ListpackConfig& config = listpackConfig();
+        if (member.size() <= config.zset_max_value && packed_.size() / 2 < config.zset_max_entries) {
+            packedInsert(member, score);
+            return true;
+        }
+        convertToDict();
+    }
+
+    auto it = dict_->scores.find(member);
+    if (it != dict_->scores.end()) {
+        if (scoreEqual(it->second, score)) {
             return false; // 分数相同，不需要更新
         }
-    } else {
-        updated = true;
+        // 分数不同，从跳表中移除旧位置后重新插入
+        dict_->zsl.erase(it->second, member);
+        dict_->zsl.insert(score, member);
+        it->second = score;
+        return true;
     }
-    
-    // 添加到新分数集合中
-    elements_by_score_[score].insert(member);
-    scores_[member] = score;
-    return updated;
+    dict_->zsl.insert(score, member);
+    dict_->scores.emplace(member, score);
+    return true;
 }
 
 size_t ZSetItem::zadd(const std::vector<std::pair<Value, double>>& members_with_scores) {
@@ -130,14 +320,18 @@ size_t ZSetItem::zadd(const std::vector<std::pair<Value, double>>& members_with_
 }
 
 bool ZSetItem::zrem(const Value& member) {
-    auto it = scores_.find(member);
-    if (it != scores_.end()) {
-        double score = it->second;
-        elements_by_score_[score].erase(member);
-        if (elements_by_score_[score].empty()) {
-            elements_by_score_.erase(score);
-        }
-        scores_.erase(it);
+    if (isPacked()) {
+        size_t pos = packedFind(member);
+        if (pos == packed_.end()) {
+            return false;
+        }
+        packed_.erase(pos, 2);
+        return true;
+    }
+    auto it = dict_->scores.find(member);
+    if (it != dict_->scores.end()) {
+        dict_->zsl.erase(it->second, member);
+        dict_->scores.erase(it);
         return true;
     }
     return false;
@@ -154,8 +348,16 @@ size_t ZSetItem::zrem(const std::vector<Value>& members) {
 }
 
 bool ZSetItem::zscore(const Value& member, double& score) const {
-    auto it = scores_.find(member);
-    if (it != scores_.end()) {
+    if (isPacked()) {
+        size_t pos = packedFind(member);
+        if (pos == packed_.end()) {
+            return false;
+        }
+        score = packedScore(pos);
+        return true;
+    }
+    auto it = dict_->scores.find(member);
+    if (it != dict_->scores.end()) {
         score = it->second;
         return true;
     }
@@ -163,174 +365,305 @@ bool ZSetItem::zscore(const Value& member, double& score) const {
 }
 
 bool ZSetItem::zismember(const Value& member) const {
-    return scores_.count(member) > 0;
+    if (isPacked()) {
+        return packedFind(member) != packed_.end();
+    }
+    return dict_->scores.count(member) > 0;
 }
 
 bool ZSetItem::zrank(const Value& member, size_t& rank) const {
-    auto it = scores_.find(member);
-    if (it == scores_.end()) {
-        return false;
-    }
-    
-    double target_score = it->second;
-    size_t count = 0;
-    
-    // 计算排名（从小到大）
-    for (const auto& score_group : elements_by_score_) {
-        if (score_group.first == target_score) {
-            // 找到相同分数的组，计算组内排名
-            for (const auto& m : score_group.second) {
-                if (m == member) {
-                    rank = count;
-                    return true;
-                }
-                count++;
+    if (isPacked()) {
+        size_t index = 0;
+        for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(packed_.next(pos)), ++index) {
+            if (packed_.get(pos) == member) {
+                rank = index;
+                return true;
             }
-        } else if (score_group.first < target_score) {
-            count += score_group.second.size();
-        } else {
-            // 已经超过目标分数，可以退出循环
-            break;
         }
+        return false;
     }
-    
-    return false;
+    auto it = dict_->scores.find(member);
+    if (it == dict_->scores.end()) {
+        return false;
+    }
+    rank = dict_->zsl.getRank(it->second, member) - 1;
+    return true;
 }
 
 bool ZSetItem::zrevrank(const Value& member, size_t& rank) const {
-    auto it = scores_.find(member);
-    if (it == scores_.end()) {
+    if (!zrank(member, rank)) {
         return false;
     }
-    
-    double target_score = it->second;
-    size_t count = 0;
-    
-    // 计算逆序排名（从大到小）
-    for (auto it_score = elements_by_score_.rbegin(); it_score != elements_by_score_.rend(); ++it_score) {
-        if (it_score->first == target_score) {
-            // 找到相同分数的组，计算组内排名
-            for (const auto& m : it_score->second) {
-                if (m == member) {
-                    rank = count;
-                    return true;
-                }
-                count++;
-            }
-        } else if (it_score->first > target_score) {
-            count += it_score->second.size();
-        } else {
-            // 已经小于目标分数，可以退出循环
-            break;
-        }
-    }
-    
-    return false;
+    rank = zcard() - 1 - rank;
+    return true;
 }
 
 std::vector<std::pair<Value, double>> ZSetItem::zrange(size_t start, size_t stop) const {
     std::vector<std::pair<Value, double>> result;
-    size_t count = 0;
-    
-    // 从前往后遍历（从小到大）
-    for (const auto& score_group : elements_by_score_) {
-        for (const auto& member : score_group.second) {
-            if (count >= start && count <= stop) {
-                result.push_back({member, score_group.first});
-            }
-            count++;
-            if (count > stop) {
-                return result;
-            }
+    size_t size = zcard();
+    if (start >= size || start > stop) {
+        return result;
+    }
+    stop = std::min(stop, size - 1);
+    result.reserve(stop - start + 1);
+
+    if (isPacked()) {
+        size_t pos = packed_.seek(static_cast<int64_t>(start * 2));
+        for (size_t i = start; i <= stop; ++i, pos = packed_.next(packed_.next(pos))) {
+            result.emplace_back(Value(packed_.get(pos)), packedScore(pos));
         }
+        return result;
+    }
+
+    // 定位到第start个元素后顺序遍历（从小到大）
+    auto* node = dict_->zsl.getByRank(start + 1);
+    for (size_t i = start; i <= stop && node != nullptr; ++i, node = node->next()) {
+        result.push_back({node->member, node->score});
     }
-    
     return result;
 }
 
 std::vector<std::pair<Value, double>> ZSetItem::zrevrange(size_t start, size_t stop) const {
     std::vector<std::pair<Value, double>> result;
-    size_t count = 0;
-    
-    // 从后往前遍历（从大到小）
-    for (auto it_score = elements_by_score_.rbegin(); it_score != elements_by_score_.rend(); ++it_score) {
-        for (const auto& member : it_score->second) {
-            if (count >= start && count <= stop) {
-                result.push_back({member, it_score->first});
-            }
-            count++;
-            if (count > stop) {
-                return result;
+    size_t size = zcard();
+    if (start >= size || start > stop) {
+        return result;
+    }
+    stop = std::min(stop, size - 1);
+    result.reserve(stop - start + 1);
+
+    if (isPacked()) {
+        // 从末尾的成员条目开始反向遍历
+        size_t pos = packed_.seek(static_cast<int64_t>((size - 1 - start) * 2));
+        for (size_t i = start; i <= stop; ++i) {
+            result.emplace_back(Value(packed_.get(pos)), packedScore(pos));
+            if (pos != packed_.begin()) {
+                pos = packed_.prev(packed_.prev(pos));
             }
         }
+        return result;
+    }
+
+    // 定位到倒数第start个元素后反向遍历（从大到小）
+    auto* node = dict_->zsl.getByRank(size - start);
+    for (size_t i = start; i <= stop && node != nullptr; ++i, node = node->prev()) {
+        result.push_back({node->member, node->score});
     }
-    
     return result;
 }
 
 std::vector<std::pair<Value, double>> ZSetItem::zrangebyscore(double min, double max) const {
     std::vector<std::pair<Value, double>> result;
-    
-    // 遍历分数在[min, max]范围内的元素
-    for (const auto& score_group : elements_by_score_) {
-        if (score_group.first > max) {
-            break; // 由于map是有序的，后面的分数更大，可以退出循环
-        }
-        if (score_group.first >= min) {
-            for (const auto& member : score_group.second) {
-                result.push_back({member, score_group.first});
+    if (isPacked()) {
+        for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(packed_.next(pos))) {
+            double score = packedScore(pos);
+            if (score > max) {
+                break;
+            }
+            if (score >= min) {
+                result.emplace_back(Value(packed_.get(pos)), score);
             }
         }
+        return result;
+    }
+    // 遍历分数在[min, max]范围内的元素
+    for (auto* node = dict_->zsl.firstInRange(min, max); node != nullptr && node->score <= max; node = node->next()) {
+        result.push_back({node->member, node->score});
     }
-    
     return result;
 }
 
 std::vector<std::pair<Value, double>> ZSetItem::zrevrangebyscore(double max, double min) const {
     std::vector<std::pair<Value, double>> result;
-    
+    if (isPacked()) {
+        result = zrangebyscore(min, max);
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
     // 遍历分数在[min, max]范围内的元素（从大到小）
-    for (auto it_score = elements_by_score_.rbegin(); it_score != elements_by_score_.rend(); ++it_score) {
-        if (it_score->first < min) {
-            break; // 由于map是有序的，后面的分数更小，可以退出循环
-        }
-        if (it_score->first <= max) {
-            for (const auto& member : it_score->second) {
-                result.push_back({member, it_score->first});
-            }
-        }
+    for (auto* node = dict_->zsl.lastInRange(min, max); node != nullptr && node->score >= min; node = node->prev()) {
+        result.push_back({node->member, node->score});
     }
-    
     return result;
 }
 
 size_t ZSetItem::zcount(double min, double max) const {
-    size_t count = 0;
-    
-    // 统计分数在[min, max]范围内的元素个数
-    for (const auto& score_group : elements_by_score_) {
-        if (score_group.first > max) {
-            break;
+    if (isPacked()) {
+        size_t count = 0;
+        for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(packed_.next(pos))) {
+            double score = packedScore(pos);
+            if (score > max) {
+                break;
+            }
+            if (score >= min) {
+                count++;
+            }
         }
-        if (score_group.first >= min) {
-            count += score_group.second.size();
+        return count;
+    }
+    // 区间首尾节点的排名之差即为元素个数
+    auto* first = dict_->zsl.firstInRange(min, max);
+    if (first == nullptr) {
+        return 0;
+    }
+    auto* last = dict_->zsl.lastInRange(min, max);
+    return dict_->zsl.getRank(last->score, last->member) - dict_->zsl.getRank(first->score, first->member) + 1;
+}
+
+size_t ZSetItem::scan(size_t cursor, size_t count, std::vector<std::pair<Value, double>>& out) const {
+    if (isPacked()) {
+        for (size_t pos = packed_.begin(); pos != packed_.end(); pos = packed_.next(packed_.next(pos))) {
+            out.emplace_back(Value(packed_.get(pos)), packedScore(pos));
         }
+        return 0;
     }
-    
-    return count;
+    return scanBuckets(dict_->scores, cursor, count, [&out](const std::pair<const Value, double>& pair) {
+        out.emplace_back(pair.first, pair.second);
+    });
 }
 
 size_t ZSetItem::zcard() const {
-    return scores_.size();
+    return isPacked() ? packed_.size() / 2 : dict_->scores.size();
 }
 
 void ZSetItem::clear() {
-    elements_by_score_.clear();
-    scores_.clear();
+    packed_.clear();
+    dict_.reset();
 }
 
 bool ZSetItem::empty() const {
-    return scores_.empty();
+    return zcard() == 0;
+}
+
+void ZSetItem::assignSorted(std::vector<std::pair<Value, double>>&& entries) {
+    clear();
+    const ListpackConfig& config = listpackConfig();
+    bool packable = entries.size() <= config.zset_max_entries;
+    for (size_t i = 0; i < entries.size() && packable; ++i) {
+        packable = entries[i].first.size() <= config.zset_max_value;
+    }
+    if (packable) {
+        char buffer[sizeof(double)];
+        for (const auto& entry : entries) {
+            packed_.append(entry.first);
+            packed_.append(encodeScore(entry.second, buffer));
+        }
+        return;
+    }
+    auto dict = std::make_unique<SortedDict>();
+    dict->scores.reserve(entries.size());
+    for (const auto& entry : entries) {
+        dict->scores.emplace(entry.first, entry.second);
+    }
+    dict->zsl.assignSorted(std::move(entries));
+    dict_ = std::move(dict);
+}
+
+std::unique_ptr<ZSetItem> ZSetItem::combine(SetOp op, const std::vector<const ZSetItem*>& sets,
+                                            const std::vector<double>& weights, ZSetAggregate aggregate) {
+    auto result = std::make_unique<ZSetItem>();
+    if (sets.empty()) {
+        return result;
+    }
+    size_t total = 0;
+    for (const ZSetItem* set : sets) {
+        const size_t size = set ? set->zcard() : 0;
+        if (size == 0 && op == SetOp::INTER) {
+            return result;
+        }
+        total += size;
+    }
+    const size_t partitions = total >= PARALLEL_MERGE_MIN_ELEMENTS
+        ? std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), MAX_MERGE_PARTITIONS)
+        : 1;
+
+    // 各输入乘以权重后按成员排序，成员引用输入中的存储
+    std::vector<std::vector<ScoredView>> inputs(sets.size());
+    runParallel(sets.size(), partitions, [&](size_t i) {
+        const ZSetItem* set = sets[i];
+        if (!set) {
+            return;
+        }
+        const double weight = i < weights.size() ? weights[i] : 1.0;
+        std::vector<ScoredView>& input = inputs[i];
+        input.reserve(set->zcard());
+        if (set->isPacked()) {
+            const Listpack& packed = set->packed_;
+            for (size_t pos = packed.begin(); pos != packed.end(); pos = packed.next(packed.next(pos))) {
+                input.emplace_back(packed.get(pos), weightedScore(set->packedScore(pos), weight));
+            }
+        } else {
+            for (auto* node = set->dict_->zsl.first(); node != nullptr; node = node->next()) {
+                input.emplace_back(node->member, weightedScore(node->score, weight));
+            }
+        }
+        std::sort(input.begin(), input.end(), [](const ScoredView& a, const ScoredView& b) {
+            return a.first < b.first;
+        });
+    });
+
+    // 从最大的输入中等距取成员作为分段边界，各段在所有输入中对应的区间互不重叠
+    size_t largest = 0;
+    for (size_t i = 1; i < inputs.size(); ++i) {
+        if (inputs[i].size() > inputs[largest].size()) {
+            largest = i;
+        }
+    }
+    std::vector<std::string_view> bounds;
+    for (size_t part = 1; part < partitions; ++part) {
+        const std::string_view bound = inputs[largest][inputs[largest].size() * part / partitions].first;
+        if (bounds.empty() || bound > bounds.back()) {
+            bounds.push_back(bound);
+        }
+    }
+    const size_t parts = bounds.size() + 1;
+    std::vector<std::vector<std::pair<Value, double>>> merged(parts);
+    runParallel(parts, parts, [&](size_t part) {
+        auto byMember = [](const ScoredView& entry, std::string_view member) { return entry.first < member; };
+        std::vector<MergeRange> ranges;
+        ranges.reserve(inputs.size());
+        for (const auto& input : inputs) {
+            const ScoredView* first = input.data();
+            const ScoredView* last = input.data() + input.size();
+            const ScoredView* begin = part == 0 ? first : std::lower_bound(first, last, bounds[part - 1], byMember);
+            const ScoredView* end = part == parts - 1 ? last : std::lower_bound(first, last, bounds[part], byMember);
+            ranges.push_back({begin, end});
+        }
+        mergeByMember(ranges, op, aggregate, merged[part]);
+        std::sort(merged[part].begin(), merged[part].end(), scoredBefore);
+    });
+
+    // 各段已按 (分数, 成员) 排序，再做一次k路归并得到整体顺序
+    std::vector<std::pair<Value, double>> entries;
+    if (parts == 1) {
+        entries = std::move(merged[0]);
+    } else {
+        size_t count = 0;
+        for (const auto& part : merged) {
+            count += part.size();
+        }
+        entries.reserve(count);
+        using Cursor = std::pair<size_t, size_t>; // 段序号，段内下标
+        auto later = [&merged](const Cursor& a, const Cursor& b) {
+            return scoredBefore(merged[b.first][b.second], merged[a.first][a.second]);
+        };
+        std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heap(later);
+        for (size_t part = 0; part < parts; ++part) {
+            if (!merged[part].empty()) {
+                heap.emplace(part, 0);
+            }
+        }
+        while (!heap.empty()) {
+            auto [part, index] = heap.top();
+            heap.pop();
+            entries.push_back(std::move(merged[part][index]));
+            if (index + 1 < merged[part].size()) {
+                heap.emplace(part, index + 1);
+            }
+        }
+    }
+    result->assignSorted(std::move(entries));
+    return result;
 }
 
-} // namespace dkv
\ No newline at end of file
+} // namespace dkv
@@ -0,0 +1,284 @@
+#include "datatypes/dkv_intset.hpp"
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DKV_INTSET_X86 1
+#endif
+
+namespace dkv {
+
+namespace {
+
+// 较大的集合是较小的集合的这么多倍以上时，逐个二分查找比顺序推进更快
+constexpr size_t BINARY_SEARCH_RATIO = 64;
+
+int64_t loadAt(const char* data, uint8_t width, size_t index) {
+    const char* p = data + index * width;
+    switch (width) {
+        case sizeof(int16_t): {
+            int16_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        case sizeof(int32_t): {
+            int32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        default: {
+            int64_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+    }
+}
+
+void storeAt(char* data, uint8_t width, size_t index, int64_t value) {
+    char* p = data + index * width;
+    switch (width) {
+        case sizeof(int16_t): {
+            const int16_t narrow = static_cast<int16_t>(value);
+            std::memcpy(p, &narrow, sizeof(narrow));
+            break;
+        }
+        case sizeof(int32_t): {
+            const int32_t narrow = static_cast<int32_t>(value);
+            std::memcpy(p, &narrow, sizeof(narrow));
+            break;
+        }
+        default:
+            std::memcpy(p, &value, sizeof(value));
+            break;
+    }
+}
+
+template <typename T>
+inline T loadElement(const char* data, size_t index) {
+    T value;
+    std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+// 每块的元素数，与一个256位寄存器容纳的元素数相同
+template <typename T>
+constexpr size_t blockSize() {
+    return 32 / sizeof(T);
+}
+
+// 从pos开始跳过末尾元素小于value的整块，返回第一个可能含有value的块的起点
+template <typename T>
+inline size_t advanceBlocks(const char* data, size_t count, size_t pos, int64_t value) {
+    constexpr size_t block = blockSize<T>();
+    while (pos + block <= count && loadElement<T>(data, pos + block - 1) < value) {
+        pos += block;
+    }
+    return pos;
+}
+
+// 不足一块的尾部逐个比较
+template <typename T>
+inline bool probeTail(const char* data, size_t count, size_t& pos, int64_t value) {
+    while (pos < count && loadElement<T>(data, pos) < value) {
+        pos++;
+    }
+    return pos < count && loadElement<T>(data, pos) == value;
+}
+
+// 通用实现：块内逐个比较
+template <typename T>
+void intersectBlocksScalar(const IntSet& small, const char* data, size_t count, std::vector<int64_t>& out) {
+    constexpr size_t block = blockSize<T>();
+    size_t pos = 0;
+    for (size_t i = 0; i < small.size(); ++i) {
+        const int64_t value = small.get(i);
+        pos = advanceBlocks<T>(data, count, pos, value);
+        if (pos + block > count) {
+            if (probeTail<T>(data, count, pos, value)) {
+                out.push_back(value);
+            }
+            continue;
+        }
+        for (size_t k = 0; k < block; ++k) {
+            if (loadElement<T>(data, pos + k) == value) {
+                out.push_back(value);
+                break;
+            }
+        }
+    }
+}
+
+#ifdef DKV_INTSET_X86
+
+// AVX2：把value广播到整个寄存器，与一块元素逐通道比较，任一通道相等即命中。
+// value超出较大集合的宽度时不可能命中，只推进位置
+template <typename T>
+__attribute__((target("avx2")))
+void intersectBlocksAvx2(const IntSet& small, const char* data, size_t count, std::vector<int64_t>& out) {
+    constexpr size_t block = blockSize<T>();
+    size_t pos = 0;
+    for (size_t i = 0; i < small.size(); ++i) {
+        const int64_t value = small.get(i);
+        pos = advanceBlocks<T>(data, count, pos, value);
+        if (pos + block > count) {
+            if (probeTail<T>(data, count, pos, value)) {
+                out.push_back(value);
+            }
+            continue;
+        }
+        if (value < std::numeric_limits<T>::min() || value > std::numeric_limits<T>::max()) {
+            continue;
+        }
+        const __m256i elements = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos * sizeof(T)));
+        __m256i equal;
+        if constexpr (sizeof(T) == sizeof(int16_t)) {
+            equal = _mm256_cmpeq_epi16(elements, _mm256_set1_epi16(static_cast<int16_t>(value)));
+        } else if constexpr (sizeof(T) == sizeof(int32_t)) {
+            equal = _mm256_cmpeq_epi32(elements, _mm256_set1_epi32(static_cast<int32_t>(value)));
+        } else {
+            equal = _mm256_cmpeq_epi64(elements, _mm256_set1_epi64x(value));
+        }
+        if (_mm256_movemask_epi8(equal) != 0) {
+            out.push_back(value);
+        }
+    }
+}
+
+bool avx2Supported() {
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported;
+}
+
+#endif // DKV_INTSET_X86
+
+template <typename T>
+void intersectBlocks(const IntSet& small, const char* data, size_t count, std::vector<int64_t>& out) {
+#ifdef DKV_INTSET_X86
+    if (avx2Supported()) {
+        intersectBlocksAvx2<T>(small, data, count, out);
+        return;
+    }
+#endif
+    intersectBlocksScalar<T>(small, data, count, out);
+}
+
+} // namespace
+
+void IntSet::clear() {
+    std::string().swap(data_);
+    width_ = sizeof(int16_t);
+}
+
+uint8_t IntSet::widthOf(int64_t value) {
+    if (value >= std::numeric_limits<int16_t>::min() && value <= std::numeric_limits<int16_t>::max()) {
+        return sizeof(int16_t);
+    }
+    if (value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max()) {
+        return sizeof(int32_t);
+    }
+    return sizeof(int64_t);
+}
+
+int64_t IntSet::get(size_t index) const {
+    return loadAt(data_.data(), width_, index);
+}
+
+void IntSet::set(size_t index, int64_t value) {
+    storeAt(&data_[0], width_, index, value);
+}
+
+size_t IntSet::lowerBound(int64_t value) const {
+    size_t low = 0;
+    size_t high = size();
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if (get(mid) < value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void IntSet::upgrade(uint8_t width) {
+    const size_t count = size();
+    std::string upgraded(count * width, '\0');
+    for (size_t i = 0; i < count; ++i) {
+        storeAt(&upgraded[0], width, i, get(i));
+    }
+    data_.swap(upgraded);
+    width_ = width;
+}
+
+bool IntSet::contains(int64_t value) const {
+    if (widthOf(value) > width_) {
+        return false;
+    }
+    const size_t index = lowerBound(value);
+    return index < size() && get(index) == value;
+}
+
+bool IntSet::insert(int64_t value) {
+    size_t index;
+    if (widthOf(value) > width_) {
+        // 超出当前宽度的值小于或大于全部已有元素
+        upgrade(widthOf(value));
+        index = value < 0 ? 0 : size();
+    } else {
+        index = lowerBound(value);
+        if (index < size() && get(index) == value) {
+            return false;
+        }
+    }
+    data_.insert(index * width_, width_, '\0');
+    set(index, value);
+    return true;
+}
+
+bool IntSet::erase(int64_t value) {
+    if (widthOf(value) > width_) {
+        return false;
+    }
+    const size_t index = lowerBound(value);
+    if (index >= size() || get(index) != value) {
+        return false;
+    }
+    data_.erase(index * width_, width_);
+    return true;
+}
+
+void IntSet::intersect(const IntSet& a, const IntSet& b, std::vector<int64_t>& out) {
+    const IntSet& small = a.size() <= b.size() ? a : b;
+    const IntSet& large = a.size() <= b.size() ? b : a;
+    if (small.empty()) {
+        return;
+    }
+    if (large.size() / small.size() >= BINARY_SEARCH_RATIO) {
+        for (size_t i = 0; i < small.size(); ++i) {
+            const int64_t value = small.get(i);
+            if (large.contains(value)) {
+                out.push_back(value);
+            }
+        }
+        return;
+    }
+    const char* data = large.data_.data();
+    switch (large.width_) {
+        case sizeof(int16_t):
+            intersectBlocks<int16_t>(small, data, large.size(), out);
+            break;
+        case sizeof(int32_t):
+            intersectBlocks<int32_t>(small, data, large.size(), out);
+            break;
+        default:
+            intersectBlocks<int64_t>(small, data, large.size(), out);
+            break;
+    }
+}
+
+} // namespace dkv
@@ -0,0 +1,211 @@
+#include "datatypes/dkv_listpack.hpp"
+#include <utility>
+
+namespace dkv {
+
+namespace {
+
+// 正向变长整数，每字节7位，最高位表示后面还有字节
+inline size_t varintSize(size_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+inline void writeVarint(std::string& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline size_t readVarint(const char* p, size_t& value) {
+    value = 0;
+    size_t shift = 0;
+    size_t i = 0;
+    while (true) {
+        uint8_t byte = static_cast<uint8_t>(p[i++]);
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return i;
+        }
+        shift += 7;
+    }
+}
+
+// 回退长度：字节顺序与正向变长整数相反，从条目末尾向前读取
+inline void writeBackVarint(std::string& out, size_t value) {
+    size_t size = varintSize(value);
+    size_t start = out.size();
+    out.resize(start + size);
+    for (size_t i = 0; i < size; ++i) {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if (i + 1 < size) {
+            byte |= 0x80;
+        }
+        out[start + size - 1 - i] = static_cast<char>(byte);
+    }
+}
+
+// end指向回退长度最后一个字节之后，返回回退长度占用的字节数
+inline size_t readBackVarint(const char* end, size_t& value) {
+    value = 0;
+    size_t shift = 0;
+    size_t i = 0;
+    while (true) {
+        uint8_t byte = static_cast<uint8_t>(*(end - 1 - i));
+        i++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return i;
+        }
+        shift += 7;
+    }
+}
+
+} // namespace
+
+ListpackConfig& listpackConfig() {
+    static ListpackConfig config;
+    return config;
+}
+
+size_t Listpack::encodedSize(size_t length) {
+    size_t body = varintSize(length) + length;
+    return body + varintSize(body);
+}
+
+void Listpack::encodeEntry(std::string& out, std::string_view value) {
+    size_t start = out.size();
+    writeVarint(out, value.size());
+    out.append(value.data(), value.size());
+    writeBackVarint(out, out.size() - start);
+}
+
+void Listpack::clear() {
+    data_.clear();
+    data_.shrink_to_fit();
+    count_ = 0;
+}
+
+void Listpack::assign(std::string data, size_t count) {
+    data_ = std::move(data);
+    count_ = count;
+}
+
+size_t Listpack::next(size_t pos) const {
+    size_t length;
+    size_t header = readVarint(data_.data() + pos, length);
+    size_t body = header + length;
+    return pos + body + varintSize(body);
+}
+
+size_t Listpack::prev(size_t pos) const {
+    if (pos == 0) {
+        return end();
+    }
+    size_t body;
+    size_t back = readBackVarint(data_.data() + pos, body);
+    return pos - back - body;
+}
+
+size_t Listpack::last() const {
+    return count_ == 0 ? end() : prev(end());
+}
+
+std::string_view Listpack::get(size_t pos) const {
+    size_t length;
+    size_t header = readVarint(data_.data() + pos, length);
+    return std::string_view(data_.data() + pos + header, length);
+}
+
+void Listpack::append(std::string_view value) {
+    encodeEntry(data_, value);
+    count_++;
+}
+
+void Listpack::prepend(std::string_view value) {
+    insert(0, value);
+}
+
+size_t Listpack::insert(size_t pos, std::string_view value) {
+    if (pos == end()) {
+        append(value);
+        return pos;
+    }
+    std::string entry;
+    entry.reserve(encodedSize(value.size()));
+    encodeEntry(entry, value);
+    data_.insert(pos, entry);
+    count_++;
+    return pos;
+}
+
+size_t Listpack::erase(size_t pos) {
+    return erase(pos, 1);
+}
+
+size_t Listpack::erase(size_t pos, size_t count) {
+    size_t stop = pos;
+    size_t removed = 0;
+    while (removed < count && stop < end()) {
+        stop = next(stop);
+        removed++;
+    }
+    data_.erase(pos, stop - pos);
+    count_ -= removed;
+    return pos;
+}
+
+size_t Listpack::replace(size_t pos, std::string_view value) {
+    std::string entry;
+    entry.reserve(encodedSize(value.size()));
+    encodeEntry(entry, value);
+    data_.replace(pos, next(pos) - pos, entry);
+    return pos;
+}
+
+size_t Listpack::find(std::string_view value, size_t skip, size_t pos) const {
+    size_t skipped = 0;
+    while (pos < end()) {
+        if (skipped == 0) {
+            if (get(pos) == value) {
+                return pos;
+            }
+            skipped = skip;
+        } else {
+            skipped--;
+        }
+        pos = next(pos);
+    }
+    return end();
+}
+
+size_t Listpack::seek(int64_t index) const {
+    if (index < 0) {
+        index += static_cast<int64_t>(count_);
+    }
+    if (index < 0 || static_cast<size_t>(index) >= count_) {
+        return end();
+    }
+    // 从较近的一端开始遍历
+    if (static_cast<size_t>(index) < count_ / 2) {
+        size_t pos = begin();
+        for (int64_t i = 0; i < index; ++i) {
+            pos = next(pos);
+        }
+        return pos;
+    }
+    size_t pos = last();
+    for (size_t i = count_ - 1; i > static_cast<size_t>(index); --i) {
+        pos = prev(pos);
+    }
+    return pos;
+}
+
+} // namespace dkv
@@ -0,0 +1,262 @@
+#include "datatypes/dkv_quicklist.hpp"
+#include "datatypes/dkv_datatype_base.hpp"
+#include "dkv_lzf.hpp"
+#include <iterator>
+
+namespace dkv {
+
+namespace {
+
+// 小于该字节数的节点不值得压缩
+constexpr size_t MIN_COMPRESS_BYTES = 48;
+// 压缩至少节省的字节数
+constexpr size_t MIN_COMPRESS_GAIN = 8;
+// 条目长度字段的估算开销（两个变长整数）
+constexpr size_t ENTRY_OVERHEAD = 4;
+
+} // namespace
+
+void QuickList::clear() {
+    nodes_.clear();
+    count_ = 0;
+}
+
+bool QuickList::fits(const Node& node, std::string_view value) {
+    if (node.count == 0) {
+        return true;
+    }
+    size_t bytes = node.is_compressed ? node.raw_bytes : node.entries.bytes();
+    return bytes + value.size() + ENTRY_OVERHEAD <= listpackConfig().list_max_bytes;
+}
+
+void QuickList::compressNode(Node& node) {
+    if (node.is_compressed) {
+        return;
+    }
+    const std::string& raw = node.entries.raw();
+    if (raw.size() < MIN_COMPRESS_BYTES) {
+        return;
+    }
+    std::string out(raw.size() - MIN_COMPRESS_GAIN, '\0');
+    size_t len = lzf::compress(raw.data(), raw.size(), &out[0], out.size());
+    if (len == 0) {
+        return; // 压缩收益不足，保持原样
+    }
+    out.resize(len);
+    out.shrink_to_fit();
+    node.raw_bytes = raw.size();
+    node.compressed = std::move(out);
+    node.entries.clear();
+    node.is_compressed = true;
+}
+
+void QuickList::decompressNode(Node& node) {
+    if (!node.is_compressed) {
+        return;
+    }
+    std::string raw(node.raw_bytes, '\0');
+    lzf::decompress(node.compressed.data(), node.compressed.size(), &raw[0], raw.size());
+    node.entries.assign(std::move(raw), node.count);
+    node.compressed.clear();
+    node.compressed.shrink_to_fit();
+    node.is_compressed = false;
+}
+
+const Listpack& QuickList::view(const Node& node, Listpack& scratch) {
+    if (!node.is_compressed) {
+        return node.entries;
+    }
+    std::string raw(node.raw_bytes, '\0');
+    lzf::decompress(node.compressed.data(), node.compressed.size(), &raw[0], raw.size());
+    scratch.assign(std::move(raw), node.count);
+    return scratch;
+}
+
+void QuickList::rebalanceCompression() {
+    size_t depth = listpackConfig().list_compress_depth;
+    if (depth == 0) {
+        return;
+    }
+    // 两端depth个节点解压
+    size_t n = nodes_.size();
+    auto front = nodes_.begin();
+    auto back = nodes_.rbegin();
+    for (size_t i = 0; i < depth && i < n; ++i, ++front, ++back) {
+        decompressNode(*front);
+        decompressNode(*back);
+    }
+    // 紧邻保留区的内部节点压缩，更内侧的节点在之前已处理过
+    if (n > 2 * depth) {
+        compressNode(*front);
+        compressNode(*back);
+    }
+}
+
+void QuickList::pushFront(std::string_view value) {
+    if (nodes_.empty() || !fits(nodes_.front(), value)) {
+        nodes_.emplace_front();
+    }
+    Node& node = nodes_.front();
+    decompressNode(node);
+    node.entries.prepend(value);
+    node.count++;
+    count_++;
+    rebalanceCompression();
+}
+
+void QuickList::pushBack(std::string_view value) {
+    if (nodes_.empty() || !fits(nodes_.back(), value)) {
+        nodes_.emplace_back();
+    }
+    Node& node = nodes_.back();
+    decompressNode(node);
+    node.entries.append(value);
+    node.count++;
+    count_++;
+    rebalanceCompression();
+}
+
+bool QuickList::popFront(Value& value) {
+    if (nodes_.empty()) {
+        return false;
+    }
+    Node& node = nodes_.front();
+    decompressNode(node);
+    value = Value(node.entries.get(node.entries.begin()));
+    node.entries.erase(node.entries.begin());
+    node.count--;
+    count_--;
+    if (node.count == 0) {
+        nodes_.pop_front();
+    }
+    rebalanceCompression();
+    return true;
+}
+
+bool QuickList::popBack(Value& value) {
+    if (nodes_.empty()) {
+        return false;
+    }
+    Node& node = nodes_.back();
+    decompressNode(node);
+    size_t pos = node.entries.last();
+    value = Value(node.entries.get(pos));
+    node.entries.erase(pos);
+    node.count--;
+    count_--;
+    if (node.count == 0) {
+        nodes_.pop_back();
+    }
+    rebalanceCompression();
+    return true;
+}
+
+QuickList::NodeList::iterator QuickList::locate(size_t index, size_t& offset) {
+    // 从较近的一端按节点元素数跳过
+    if (index < count_ / 2) {
+        for (auto it = nodes_.begin(); it != nodes_.end(); ++it) {
+            if (index < it->count) {
+                offset = index;
+                return it;
+            }
+            index -= it->count;
+        }
+        return nodes_.end();
+    }
+    size_t remaining = count_ - index; // 从末尾数的第几个，从1开始
+    for (auto it = nodes_.end(); it != nodes_.begin();) {
+        --it;
+        if (remaining <= it->count) {
+            offset = it->count - remaining;
+            return it;
+        }
+        remaining -= it->count;
+    }
+    return nodes_.end();
+}
+
+QuickList::NodeList::const_iterator QuickList::locate(size_t index, size_t& offset) const {
+    return const_cast<QuickList*>(this)->locate(index, offset);
+}
+
+std::vector<Value> QuickList::range(size_t start, size_t stop) const {
+    std::vector<Value> result;
+    if (count_ == 0) {
+        return result;
+    }
+    if (stop >= count_) {
+        stop = count_ - 1;
+    }
+    if (start > stop) {
+        return result;
+    }
+    result.reserve(stop - start + 1);
+
+    size_t offset = 0;
+    auto it = locate(start, offset);
+    size_t remaining = stop - start + 1;
+    Listpack scratch;
+    for (; it != nodes_.end() && remaining > 0; ++it) {
+        const Listpack& entries = view(*it, scratch);
+        size_t pos = entries.seek(static_cast<int64_t>(offset));
+        for (; pos != entries.end() && remaining > 0; pos = entries.next(pos)) {
+            result.emplace_back(entries.get(pos));
+            remaining--;
+        }
+        offset = 0;
+    }
+    return result;
+}
+
+bool QuickList::index(int64_t index, Value& value) const {
+    if (index < 0) {
+        index += static_cast<int64_t>(count_);
+    }
+    if (index < 0 || static_cast<size_t>(index) >= count_) {
+        return false;
+    }
+    size_t offset = 0;
+    auto it = locate(static_cast<size_t>(index), offset);
+    Listpack scratch;
+    const Listpack& entries = view(*it, scratch);
+    value = Value(entries.get(entries.seek(static_cast<int64_t>(offset))));
+    return true;
+}
+
+bool QuickList::set(int64_t index, std::string_view value) {
+    if (index < 0) {
+        index += static_cast<int64_t>(count_);
+    }
+    if (index < 0 || static_cast<size_t>(index) >= count_) {
+        return false;
+    }
+    size_t offset = 0;
+    auto it = locate(static_cast<size_t>(index), offset);
+    bool was_compressed = it->is_compressed;
+    decompressNode(*it);
+    it->entries.replace(it->entries.seek(static_cast<int64_t>(offset)), value);
+    if (was_compressed) {
+        compressNode(*it);
+    }
+    return true;
+}
+
+size_t QuickList::compressedNodeCount() const {
+    size_t total = 0;
+    for (const auto& node : nodes_) {
+        if (node.is_compressed) {
+            total++;
+        }
+    }
+    return total;
+}
+
+size_t QuickList::memoryUsage(size_t samples) const {
+    // std::list的每个节点另有前后两个指针
+    return sampledBytes(nodes_.begin(), nodes_.end(), nodes_.size(), samples, [](const Node& node) {
+        return 2 * sizeof(void*) + sizeof(Node) + stringHeapBytes(node.entries.raw()) +
+               stringHeapBytes(node.compressed);
+    });
+}
+
+} // namespace dkv
@@ -0,0 +1,659 @@
+#include "datatypes/dkv_roaring.hpp"
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+namespace dkv {
+
+namespace {
+
+constexpr size_t CHUNK_BYTES = RoaringBitmap::CHUNK_BITS / 8;
+
+// 块内的置位数和游程数
+void chunkStats(const uint64_t* words, uint32_t& cardinality, uint32_t& runs) {
+    cardinality = 0;
+    runs = 0;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < RoaringBitmap::BITSET_WORDS; ++i) {
+        const uint64_t w = words[i];
+        cardinality += __builtin_popcountll(w);
+        // 前一位为0的置位是一个游程的起点
+        runs += __builtin_popcountll(w & ~((w << 1) | carry));
+        carry = w >> 63;
+    }
+}
+
+// 各容器内容的字节数
+size_t arrayBytes(uint32_t cardinality) { return cardinality * sizeof(uint16_t); }
+size_t runBytes(uint32_t runs) { return runs * 2 * sizeof(uint16_t); }
+constexpr size_t BITSET_BYTES = RoaringBitmap::BITSET_WORDS * sizeof(uint64_t);
+
+// 把[begin, end)内的位置1
+void setRange(uint64_t* words, uint32_t begin, uint32_t end) {
+    while (begin < end) {
+        const uint32_t bit = begin & 63;
+        const uint32_t n = std::min<uint32_t>(64 - bit, end - begin);
+        const uint64_t mask = n == 64 ? ~uint64_t(0) : ((uint64_t(1) << n) - 1) << bit;
+        words[begin >> 6] |= mask;
+        begin += n;
+    }
+}
+
+// 从from起第一个值为value的位，没有时返回CHUNK_BITS
+uint32_t nextWordBit(const uint64_t* words, uint32_t from, bool value) {
+    size_t index = from >> 6;
+    if (index >= RoaringBitmap::BITSET_WORDS) {
+        return RoaringBitmap::CHUNK_BITS;
+    }
+    uint64_t w = (value ? words[index] : ~words[index]) & (~uint64_t(0) << (from & 63));
+    while (w == 0) {
+        if (++index == RoaringBitmap::BITSET_WORDS) {
+            return RoaringBitmap::CHUNK_BITS;
+        }
+        w = value ? words[index] : ~words[index];
+    }
+    return static_cast<uint32_t>(index * 64 + __builtin_ctzll(w));
+}
+
+template <typename T>
+void appendRaw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} // namespace
+
+// 容器实现
+
+size_t RoaringBitmap::Container::memoryUsage() const {
+    return CHUNK_OVERHEAD + values.size() * sizeof(uint16_t) + words.size() * sizeof(uint64_t);
+}
+
+bool RoaringBitmap::Container::get(uint16_t low) const {
+    switch (type) {
+        case Type::ARRAY:
+            return std::binary_search(values.begin(), values.end(), low);
+        case Type::BITSET:
+            return (words[low >> 6] >> (low & 63)) & 1;
+        case Type::RUN: {
+            // 最后一个起点不大于low的游程
+            size_t lo = 0, hi = values.size() / 2;
+            while (lo < hi) {
+                const size_t mid = (lo + hi) / 2;
+                if (values[2 * mid] <= low) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo > 0 && low <= uint32_t(values[2 * (lo - 1)]) + values[2 * (lo - 1) + 1];
+        }
+    }
+    return false;
+}
+
+bool RoaringBitmap::Container::set(uint16_t low, bool value) {
+    if (type == Type::RUN) {
+        if (get(low) == value) {
+            return value;
+        }
+        // 游程容器被修改时展开为数组或位集容器，序列化和位运算时再重新选择
+        std::vector<uint64_t> buffer(BITSET_WORDS, 0);
+        toWords(buffer.data());
+        *this = fromWords(buffer.data(), false);
+    }
+    if (type == Type::ARRAY) {
+        auto it = std::lower_bound(values.begin(), values.end(), low);
+        const bool old = it != values.end() && *it == low;
+        if (old == value) {
+            return old;
+        }
+        if (!value) {
+            values.erase(it);
+            cardinality--;
+            return old;
+        }
+        if (cardinality < ARRAY_MAX) {
+            values.insert(it, low);
+            cardinality++;
+            return old;
+        }
+        // 数组已满，转换为位集容器
+        words.assign(BITSET_WORDS, 0);
+        for (uint16_t v : values) {
+            words[v >> 6] |= uint64_t(1) << (v & 63);
+        }
+        values.clear();
+        values.shrink_to_fit();
+        type = Type::BITSET;
+    }
+    uint64_t& word = words[low >> 6];
+    const uint64_t mask = uint64_t(1) << (low & 63);
+    const bool old = (word & mask) != 0;
+    if (old == value) {
+        return old;
+    }
+    if (value) {
+        word |= mask;
+        cardinality++;
+    } else {
+        word &= ~mask;
+        cardinality--;
+        // 降到数组容器上限的一半以下才转换回去，避免在上限附近反复转换
+        if (cardinality < ARRAY_MAX / 2) {
+            *this = fromWords(words.data(), false);
+        }
+    }
+    return old;
+}
+
+uint32_t RoaringBitmap::Container::rangeCardinality(uint32_t begin, uint32_t end) const {
+    if (begin >= end) {
+        return 0;
+    }
+    switch (type) {
+        case Type::ARRAY: {
+            auto less = [](uint16_t a, uint32_t b) { return a < b; };
+            auto first = std::lower_bound(values.begin(), values.end(), begin, less);
+            auto last = std::lower_bound(first, values.end(), end, less);
+            return static_cast<uint32_t>(last - first);
+        }
+        case Type::BITSET: {
+            uint32_t count = 0;
+            const uint32_t first = begin >> 6, last = (end - 1) >> 6;
+            for (uint32_t i = first; i <= last; ++i) {
+                uint64_t w = words[i];
+                if (i == first) {
+                    w &= ~uint64_t(0) << (begin & 63);
+                }
+                if (i == last && (end & 63) != 0) {
+                    w &= (uint64_t(1) << (end & 63)) - 1;
+                }
+                count += __builtin_popcountll(w);
+            }
+            return count;
+        }
+        case Type::RUN: {
+            uint32_t count = 0;
+            for (size_t i = 0; i < values.size(); i += 2) {
+                const uint32_t run_begin = std::max<uint32_t>(values[i], begin);
+                const uint32_t run_end = std::min<uint32_t>(uint32_t(values[i]) + values[i + 1] + 1, end);
+                if (run_begin < run_end) {
+                    count += run_end - run_begin;
+                }
+            }
+            return count;
+        }
+    }
+    return 0;
+}
+
+uint32_t RoaringBitmap::Container::next(uint32_t from, bool bit) const {
+    if (from >= CHUNK_BITS) {
+        return CHUNK_BITS;
+    }
+    switch (type) {
+        case Type::ARRAY: {
+            auto it = std::lower_bound(values.begin(), values.end(), from,
+                                       [](uint16_t a, uint32_t b) { return a < b; });
+            if (bit) {
+                return it == values.end() ? CHUNK_BITS : *it;
+            }
+            // 跳过从from起连续出现的位号
+            uint32_t candidate = from;
+            for (; it != values.end() && *it == candidate; ++it) {
+                ++candidate;
+            }
+            return candidate;
+        }
+        case Type::BITSET:
+            return nextWordBit(words.data(), from, bit);
+        case Type::RUN: {
+            uint32_t candidate = from;
+            for (size_t i = 0; i < values.size(); i += 2) {
+                const uint32_t run_end = uint32_t(values[i]) + values[i + 1] + 1;
+                if (run_end <= candidate) {
+                    continue;
+                }
+                if (bit) {
+                    return std::max<uint32_t>(values[i], candidate);
+                }
+                if (values[i] > candidate) {
+                    break;
+                }
+                candidate = run_end;
+            }
+            return bit ? CHUNK_BITS : candidate;
+        }
+    }
+    return CHUNK_BITS;
+}
+
+void RoaringBitmap::Container::toWords(uint64_t* out) const {
+    switch (type) {
+        case Type::ARRAY:
+            for (uint16_t v : values) {
+                out[v >> 6] |= uint64_t(1) << (v & 63);
+            }
+            break;
+        case Type::BITSET:
+            for (size_t i = 0; i < BITSET_WORDS; ++i) {
+                out[i] |= words[i];
+            }
+            break;
+        case Type::RUN:
+            for (size_t i = 0; i < values.size(); i += 2) {
+                setRange(out, values[i], uint32_t(values[i]) + values[i + 1] + 1);
+            }
+            break;
+    }
+}
+
+RoaringBitmap::Container RoaringBitmap::Container::fromWords(const uint64_t* in, bool allow_run) {
+    Container container;
+    uint32_t runs;
+    chunkStats(in, container.cardinality, runs);
+    if (container.cardinality == 0) {
+        return container;
+    }
+    const size_t best_plain = container.cardinality <= ARRAY_MAX ? arrayBytes(container.cardinality) : BITSET_BYTES;
+    if (allow_run && runBytes(runs) < best_plain) {
+        container.type = Type::RUN;
+        container.values.reserve(runs * 2);
+        uint32_t pos = 0;
+        while (pos < CHUNK_BITS) {
+            const uint32_t begin = nextWordBit(in, pos, true);
+            if (begin >= CHUNK_BITS) {
+                break;
+            }
+            const uint32_t end = nextWordBit(in, begin, false);
+            container.values.push_back(static_cast<uint16_t>(begin));
+            container.values.push_back(static_cast<uint16_t>(end - begin - 1));
+            pos = end;
+        }
+    } else if (container.cardinality <= ARRAY_MAX) {
+        container.type = Type::ARRAY;
+        container.values.reserve(container.cardinality);
+        for (size_t i = 0; i < BITSET_WORDS; ++i) {
+            for (uint64_t w = in[i]; w != 0; w &= w - 1) {
+                container.values.push_back(static_cast<uint16_t>(i * 64 + __builtin_ctzll(w)));
+            }
+        }
+    } else {
+        container.type = Type::BITSET;
+        container.words.assign(in, in + BITSET_WORDS);
+    }
+    return container;
+}
+
+RoaringBitmap::Container RoaringBitmap::Container::full() {
+    Container container;
+    container.type = Type::RUN;
+    container.cardinality = CHUNK_BITS;
+    container.values = {0, static_cast<uint16_t>(CHUNK_BITS - 1)};
+    return container;
+}
+
+// 位图实现
+
+void RoaringBitmap::addChunk(uint64_t key, Container container) {
+    memory_bytes_ += container.memoryUsage();
+    chunks_.emplace(key, std::move(container));
+}
+
+bool RoaringBitmap::set(uint64_t pos, bool value) {
+    const uint64_t key = pos / CHUNK_BITS;
+    const uint16_t low = static_cast<uint16_t>(pos % CHUNK_BITS);
+    auto it = chunks_.find(key);
+    if (it == chunks_.end()) {
+        if (value) {
+            Container container;
+            container.set(low, true);
+            addChunk(key, std::move(container));
+        }
+        return false;
+    }
+    memory_bytes_ -= it->second.memoryUsage();
+    const bool old = it->second.set(low, value);
+    if (it->second.cardinality == 0) {
+        chunks_.erase(it);
+    } else {
+        memory_bytes_ += it->second.memoryUsage();
+    }
+    return old;
+}
+
+bool RoaringBitmap::get(uint64_t pos) const {
+    auto it = chunks_.find(pos / CHUNK_BITS);
+    return it != chunks_.end() && it->second.get(static_cast<uint16_t>(pos % CHUNK_BITS));
+}
+
+uint64_t RoaringBitmap::cardinality() const {
+    uint64_t count = 0;
+    for (const auto& chunk : chunks_) {
+        count += chunk.second.cardinality;
+    }
+    return count;
+}
+
+uint64_t RoaringBitmap::rangeCardinality(uint64_t begin, uint64_t end) const {
+    if (begin >= end) {
+        return 0;
+    }
+    uint64_t count = 0;
+    for (auto it = chunks_.lower_bound(begin / CHUNK_BITS); it != chunks_.end() && it->first <= (end - 1) / CHUNK_BITS; ++it) {
+        const uint64_t chunk_begin = it->first * CHUNK_BITS;
+        const uint64_t local_begin = std::max(begin, chunk_begin) - chunk_begin;
+        const uint64_t local_end = std::min(end, chunk_begin + CHUNK_BITS) - chunk_begin;
+        count += it->second.rangeCardinality(static_cast<uint32_t>(local_begin), static_cast<uint32_t>(local_end));
+    }
+    return count;
+}
+
+uint64_t RoaringBitmap::nextBit(bool bit, uint64_t begin, uint64_t end) const {
+    if (bit) {
+        for (auto it = chunks_.lower_bound(begin / CHUNK_BITS); it != chunks_.end() && it->first * CHUNK_BITS < end; ++it) {
+            const uint64_t chunk_begin = it->first * CHUNK_BITS;
+            const uint32_t local = it->second.next(static_cast<uint32_t>(std::max(begin, chunk_begin) - chunk_begin), true);
+            if (local < CHUNK_BITS) {
+                return std::min(end, chunk_begin + local);
+            }
+        }
+        return end;
+    }
+    uint64_t pos = begin;
+    auto it = chunks_.lower_bound(begin / CHUNK_BITS);
+    while (pos < end) {
+        const uint64_t key = pos / CHUNK_BITS;
+        if (it == chunks_.end() || it->first != key) {
+            // 不存在的块全为0
+            return pos;
+        }
+        const uint32_t local = it->second.next(static_cast<uint32_t>(pos % CHUNK_BITS), false);
+        if (local < CHUNK_BITS) {
+            return std::min(end, key * CHUNK_BITS + local);
+        }
+        pos = (key + 1) * CHUNK_BITS;
+        ++it;
+    }
+    return end;
+}
+
+void RoaringBitmap::clear() {
+    chunks_.clear();
+    memory_bytes_ = 0;
+}
+
+RoaringBitmap RoaringBitmap::combine(BitmapOp op, const std::vector<const RoaringBitmap*>& inputs) {
+    RoaringBitmap result;
+    if (inputs.empty()) {
+        return result;
+    }
+    std::vector<uint64_t> acc(BITSET_WORDS);
+    std::vector<uint64_t> scratch(BITSET_WORDS);
+    // 块号在key上的输入依次合并到acc
+    auto combineChunk = [&](uint64_t key) {
+        std::fill(acc.begin(), acc.end(), op == BitmapOp::AND ? ~uint64_t(0) : 0);
+        for (const RoaringBitmap* input : inputs) {
+            auto it = input->chunks_.find(key);
+            if (it == input->chunks_.end()) {
+                if (op == BitmapOp::AND) {
+                    return;
+                }
+                continue;
+            }
+            std::fill(scratch.begin(), scratch.end(), 0);
+            it->second.toWords(scratch.data());
+            for (size_t i = 0; i < BITSET_WORDS; ++i) {
+                acc[i] = op == BitmapOp::AND ? acc[i] & scratch[i]
+                       : op == BitmapOp::OR  ? acc[i] | scratch[i]
+                                             : acc[i] ^ scratch[i];
+            }
+        }
+        Container container = Container::fromWords(acc.data(), true);
+        if (container.cardinality > 0) {
+            result.addChunk(key, std::move(container));
+        }
+    };
+
+    if (op == BitmapOp::AND) {
+        // 只有所有输入都有的块才可能有置位，从块最少的输入开始
+        const RoaringBitmap* smallest = *std::min_element(inputs.begin(), inputs.end(),
+            [](const RoaringBitmap* a, const RoaringBitmap* b) { return a->chunks_.size() < b->chunks_.size(); });
+        for (const auto& chunk : smallest->chunks_) {
+            combineChunk(chunk.first);
+        }
+    } else {
+        std::set<uint64_t> keys;
+        for (const RoaringBitmap* input : inputs) {
+            for (const auto& chunk : input->chunks_) {
+                keys.insert(chunk.first);
+            }
+        }
+        for (uint64_t key : keys) {
+            combineChunk(key);
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::invert(const RoaringBitmap& input, uint64_t bits) {
+    RoaringBitmap result;
+    std::vector<uint64_t> acc(BITSET_WORDS);
+    auto it = input.chunks_.begin();
+    for (uint64_t key = 0; key * CHUNK_BITS < bits; ++key) {
+        const uint64_t chunk_bits = std::min<uint64_t>(CHUNK_BITS, bits - key * CHUNK_BITS);
+        while (it != input.chunks_.end() && it->first < key) {
+            ++it;
+        }
+        const bool present = it != input.chunks_.end() && it->first == key;
+        if (!present && chunk_bits == CHUNK_BITS) {
+            result.addChunk(key, Container::full());
+            continue;
+        }
+        std::fill(acc.begin(), acc.end(), 0);
+        if (present) {
+            it->second.toWords(acc.data());
+        }
+        for (auto& w : acc) {
+            w = ~w;
+        }
+        // 清除bits之后的位
+        for (size_t i = chunk_bits / 64; i < BITSET_WORDS; ++i) {
+            acc[i] = i == chunk_bits / 64 && (chunk_bits & 63) != 0
+                ? acc[i] & ((uint64_t(1) << (chunk_bits & 63)) - 1) : 0;
+        }
+        Container container = Container::fromWords(acc.data(), true);
+        if (container.cardinality > 0) {
+            result.addChunk(key, std::move(container));
+        }
+    }
+    return result;
+}
+
+void RoaringBitmap::toDense(std::vector<uint8_t>& bytes) const {
+    std::vector<uint64_t> words(BITSET_WORDS);
+    for (const auto& chunk : chunks_) {
+        std::fill(words.begin(), words.end(), 0);
+        chunk.second.toWords(words.data());
+        const size_t base = chunk.first * CHUNK_BYTES;
+        for (size_t i = 0; i < BITSET_WORDS; ++i) {
+            for (uint64_t w = words[i], b = 0; w != 0; w >>= 8, ++b) {
+                const size_t index = base + i * 8 + b;
+                if (index < bytes.size()) {
+                    bytes[index] |= static_cast<uint8_t>(w);
+                }
+            }
+        }
+    }
+}
+
+namespace {
+
+// 把稠密字节数组中第chunk块读入words，块内全为0时返回false
+bool loadDenseChunk(const std::vector<uint8_t>& bytes, size_t chunk, uint64_t* words) {
+    const size_t begin = chunk * CHUNK_BYTES;
+    const size_t end = std::min(bytes.size(), begin + CHUNK_BYTES);
+    bool any = false;
+    std::fill(words, words + RoaringBitmap::BITSET_WORDS, 0);
+    for (size_t offset = begin; offset < end; offset += 8) {
+        const size_t n = std::min<size_t>(8, end - offset);
+        uint64_t w = 0;
+        for (size_t b = 0; b < n; ++b) {
+            w |= uint64_t(bytes[offset + b]) << (8 * b);
+        }
+        if (w != 0) {
+            words[(offset - begin) / 8] = w;
+            any = true;
+        }
+    }
+    return any;
+}
+
+} // namespace
+
+RoaringBitmap RoaringBitmap::fromDense(const std::vector<uint8_t>& bytes) {
+    RoaringBitmap result;
+    std::vector<uint64_t> words(BITSET_WORDS);
+    for (size_t chunk = 0; chunk * CHUNK_BYTES < bytes.size(); ++chunk) {
+        if (loadDenseChunk(bytes, chunk, words.data())) {
+            result.addChunk(chunk, Container::fromWords(words.data(), true));
+        }
+    }
+    return result;
+}
+
+size_t RoaringBitmap::estimateMemory(const std::vector<uint8_t>& bytes) {
+    size_t total = 0;
+    std::vector<uint64_t> words(BITSET_WORDS);
+    for (size_t chunk = 0; chunk * CHUNK_BYTES < bytes.size(); ++chunk) {
+        if (!loadDenseChunk(bytes, chunk, words.data())) {
+            continue;
+        }
+        uint32_t cardinality, runs;
+        chunkStats(words.data(), cardinality, runs);
+        const size_t plain = cardinality <= ARRAY_MAX ? arrayBytes(cardinality) : BITSET_BYTES;
+        total += CHUNK_OVERHEAD + std::min(plain, runBytes(runs));
+    }
+    return total;
+}
+
+void RoaringBitmap::serialize(std::string& out) const {
+    appendRaw<uint32_t>(out, static_cast<uint32_t>(chunks_.size()));
+    std::vector<uint64_t> words(BITSET_WORDS);
+    for (const auto& chunk : chunks_) {
+        std::fill(words.begin(), words.end(), 0);
+        chunk.second.toWords(words.data());
+        const Container best = Container::fromWords(words.data(), true);
+        appendRaw<uint64_t>(out, chunk.first);
+        appendRaw<uint8_t>(out, static_cast<uint8_t>(best.type));
+        switch (best.type) {
+            case Container::Type::ARRAY:
+                appendRaw<uint32_t>(out, static_cast<uint32_t>(best.values.size()));
+                out.append(reinterpret_cast<const char*>(best.values.data()), best.values.size() * sizeof(uint16_t));
+                break;
+            case Container::Type::BITSET:
+                appendRaw<uint32_t>(out, static_cast<uint32_t>(BITSET_WORDS));
+                out.append(reinterpret_cast<const char*>(best.words.data()), BITSET_BYTES);
+                break;
+            case Container::Type::RUN:
+                appendRaw<uint32_t>(out, static_cast<uint32_t>(best.values.size() / 2));
+                out.append(reinterpret_cast<const char*>(best.values.data()), best.values.size() * sizeof(uint16_t));
+                break;
+        }
+    }
+}
+
+bool RoaringBitmap::deserialize(std::string_view data) {
+    clear();
+    size_t pos = 0;
+    auto read = [&](void* dst, size_t n) {
+        if (data.size() - pos < n) {
+            return false;
+        }
+        std::memcpy(dst, data.data() + pos, n);
+        pos += n;
+        return true;
+    };
+    auto fail = [this]() {
+        clear();
+        return false;
+    };
+
+    uint32_t count;
+    if (!read(&count, sizeof(count))) {
+        return fail();
+    }
+    bool first = true;
+    uint64_t prev_key = 0;
+    for (uint32_t c = 0; c < count; ++c) {
+        uint64_t key;
+        uint8_t type;
+        uint32_t n;
+        if (!read(&key, sizeof(key)) || !read(&type, sizeof(type)) || !read(&n, sizeof(n)) ||
+            (!first && key <= prev_key) || key > UINT64_MAX / CHUNK_BITS) {
+            return fail();
+        }
+        first = false;
+        prev_key = key;
+
+        Container container;
+        container.type = static_cast<Container::Type>(type);
+        switch (container.type) {
+            case Container::Type::ARRAY: {
+                if (n == 0 || n > ARRAY_MAX) {
+                    return fail();
+                }
+                container.values.resize(n);
+                if (!read(container.values.data(), n * sizeof(uint16_t)) ||
+                    std::adjacent_find(container.values.begin(), container.values.end(),
+                                       [](uint16_t a, uint16_t b) { return a >= b; }) != container.values.end()) {
+                    return fail();
+                }
+                container.cardinality = n;
+                break;
+            }
+            case Container::Type::BITSET: {
+                if (n != BITSET_WORDS) {
+                    return fail();
+                }
+                container.words.resize(BITSET_WORDS);
+                if (!read(container.words.data(), BITSET_BYTES)) {
+                    return fail();
+                }
+                for (uint64_t w : container.words) {
+                    container.cardinality += __builtin_popcountll(w);
+                }
+                if (container.cardinality == 0) {
+                    return fail();
+                }
+                break;
+            }
+            case Container::Type::RUN: {
+                if (n == 0 || n > CHUNK_BITS / 2) {
+                    return fail();
+                }
+                container.values.resize(size_t(n) * 2);
+                if (!read(container.values.data(), container.values.size() * sizeof(uint16_t))) {
+                    return fail();
+                }
+                // 游程按起点递增且互不重叠
+                uint32_t next_begin = 0;
+                for (size_t i = 0; i < container.values.size(); i += 2) {
+                    const uint32_t end = uint32_t(container.values[i]) + container.values[i + 1] + 1;
+                    if (container.values[i] < next_begin || end > CHUNK_BITS) {
+                        return fail();
+                    }
+                    container.cardinality += end - container.values[i];
+                    next_begin = end;
+                }
+                break;
+            }
+            default:
+                return fail();
+        }
+        addChunk(key, std::move(container));
+    }
+    return pos == data.size() || fail();
+}
+
+} // namespace dkv
@@ -0,0 +1,248 @@
+#include "datatypes/dkv_skiplist.hpp"
+#include <algorithm>
+#include <new>
+#include <random>
+
+namespace dkv {
+
+namespace {
+
+// 每层晋升概率为1/4，与Redis相同
+constexpr uint32_t LEVEL_P_INV = 4;
+
+// 节点是否排在 (score, member) 之前
+inline bool before(const ZSkipList::Node* node, double score, const Value& member) {
+    return node->score < score || (node->score == score && node->member < member);
+}
+
+} // namespace
+
+ZSkipList::ZSkipList() : header_(createNode(MAX_LEVEL, 0, Value())) {
+}
+
+ZSkipList::ZSkipList(const ZSkipList& other) : ZSkipList() {
+    for (Node* node = other.first(); node != nullptr; node = node->next()) {
+        insert(node->score, node->member);
+    }
+}
+
+ZSkipList::~ZSkipList() {
+    clear();
+    destroyNode(header_);
+}
+
+ZSkipList::Node* ZSkipList::createNode(int level, double score, Value member) {
+    void* memory = ::operator new(sizeof(Node) + level * sizeof(Node::Level));
+    Node* node = new (memory) Node{std::move(member), score, nullptr, level};
+    for (int i = 0; i < level; ++i) {
+        node->levels()[i] = Node::Level{nullptr, 0};
+    }
+    return node;
+}
+
+void ZSkipList::destroyNode(Node* node) {
+    node->~Node();
+    ::operator delete(node);
+}
+
+int ZSkipList::randomLevel() {
+    thread_local std::minstd_rand rng(std::random_device{}());
+    int level = 1;
+    while (level < MAX_LEVEL && rng() % LEVEL_P_INV == 0) {
+        level++;
+    }
+    return level;
+}
+
+void ZSkipList::clear() {
+    Node* node = header_->next();
+    while (node != nullptr) {
+        Node* next = node->next();
+        destroyNode(node);
+        node = next;
+    }
+    for (int i = 0; i < MAX_LEVEL; ++i) {
+        header_->levels()[i] = Node::Level{nullptr, 0};
+    }
+    tail_ = nullptr;
+    length_ = 0;
+    level_ = 1;
+}
+
+ZSkipList::Node* ZSkipList::insert(double score, const Value& member) {
+    Node* update[MAX_LEVEL];
+    size_t rank[MAX_LEVEL];
+    Node* x = header_;
+    for (int i = level_ - 1; i >= 0; --i) {
+        // rank[i]为update[i]的排名
+        rank[i] = i == level_ - 1 ? 0 : rank[i + 1];
+        while (x->levels()[i].forward && before(x->levels()[i].forward, score, member)) {
+            rank[i] += x->levels()[i].span;
+            x = x->levels()[i].forward;
+        }
+        update[i] = x;
+    }
+
+    int level = randomLevel();
+    if (level > level_) {
+        for (int i = level_; i < level; ++i) {
+            rank[i] = 0;
+            update[i] = header_;
+            header_->levels()[i].span = length_;
+        }
+        level_ = level;
+    }
+
+    x = createNode(level, score, member);
+    for (int i = 0; i < level; ++i) {
+        Node::Level& prev = update[i]->levels()[i];
+        x->levels()[i].forward = prev.forward;
+        prev.forward = x;
+        x->levels()[i].span = prev.span - (rank[0] - rank[i]);
+        prev.span = (rank[0] - rank[i]) + 1;
+    }
+    // 更高层的指针多跨越了一个新节点
+    for (int i = level; i < level_; ++i) {
+        update[i]->levels()[i].span++;
+    }
+
+    x->backward = update[0] == header_ ? nullptr : update[0];
+    if (x->next()) {
+        x->next()->backward = x;
+    } else {
+        tail_ = x;
+    }
+    length_++;
+    return x;
+}
+
+void ZSkipList::assignSorted(std::vector<std::pair<Value, double>>&& entries) {
+    clear();
+    // last[i]为第i层当前的最后一个节点，rank[i]为它的排名
+    Node* last[MAX_LEVEL];
+    size_t rank[MAX_LEVEL];
+    for (int i = 0; i < MAX_LEVEL; ++i) {
+        last[i] = header_;
+        rank[i] = 0;
+    }
+    Node* prev = nullptr;
+    for (auto& entry : entries) {
+        const int level = randomLevel();
+        level_ = std::max(level_, level);
+        Node* x = createNode(level, entry.second, std::move(entry.first));
+        length_++;
+        for (int i = 0; i < level; ++i) {
+            last[i]->levels()[i].forward = x;
+            last[i]->levels()[i].span = length_ - rank[i];
+            last[i] = x;
+            rank[i] = length_;
+        }
+        x->backward = prev;
+        prev = x;
+    }
+    // 各层最后一个节点的span与insert保持一致：记录其后的节点数
+    for (int i = 0; i < level_; ++i) {
+        last[i]->levels()[i].span = length_ - rank[i];
+    }
+    tail_ = prev;
+}
+
+void ZSkipList::deleteNode(Node* node, Node** update) {
+    for (int i = 0; i < level_; ++i) {
+        Node::Level& prev = update[i]->levels()[i];
+        if (prev.forward == node) {
+            prev.span += node->levels()[i].span - 1;
+            prev.forward = node->levels()[i].forward;
+        } else {
+            prev.span -= 1;
+        }
+    }
+    if (node->next()) {
+        node->next()->backward = node->backward;
+    } else {
+        tail_ = node->backward;
+    }
+    while (level_ > 1 && header_->levels()[level_ - 1].forward == nullptr) {
+        level_--;
+    }
+    length_--;
+}
+
+bool ZSkipList::erase(double score, const Value& member) {
+    Node* update[MAX_LEVEL];
+    Node* x = header_;
+    for (int i = level_ - 1; i >= 0; --i) {
+        while (x->levels()[i].forward && before(x->levels()[i].forward, score, member)) {
+            x = x->levels()[i].forward;
+        }
+        update[i] = x;
+    }
+    x = x->next();
+    if (x == nullptr || x->score != score || x->member != member) {
+        return false;
+    }
+    deleteNode(x, update);
+    destroyNode(x);
+    return true;
+}
+
+size_t ZSkipList::getRank(double score, const Value& member) const {
+    size_t rank = 0;
+    Node* x = header_;
+    for (int i = level_ - 1; i >= 0; --i) {
+        while (x->levels()[i].forward &&
+               (before(x->levels()[i].forward, score, member) ||
+                (x->levels()[i].forward->score == score && x->levels()[i].forward->member == member))) {
+            rank += x->levels()[i].span;
+            x = x->levels()[i].forward;
+        }
+        if (x != header_ && x->score == score && x->member == member) {
+            return rank;
+        }
+    }
+    return 0;
+}
+
+ZSkipList::Node* ZSkipList::getByRank(size_t rank) const {
+    size_t traversed = 0;
+    Node* x = header_;
+    for (int i = level_ - 1; i >= 0; --i) {
+        while (x->levels()[i].forward && traversed + x->levels()[i].span <= rank) {
+            traversed += x->levels()[i].span;
+            x = x->levels()[i].forward;
+        }
+        if (traversed == rank) {
+            return x == header_ ? nullptr : x;
+        }
+    }
+    return nullptr;
+}
+
+ZSkipList::Node* ZSkipList::firstInRange(double min, double max) const {
+    if (length_ == 0 || min > max || tail_->score < min || first()->score > max) {
+        return nullptr;
+    }
+    Node* x = header_;
+    for (int i = level_ - 1; i >= 0; --i) {
+        while (x->levels()[i].forward && x->levels()[i].forward->score < min) {
+            x = x->levels()[i].forward;
+        }
+    }
+    x = x->next();
+    return x != nullptr && x->score <= max ? x : nullptr;
+}
+
+ZSkipList::Node* ZSkipList::lastInRange(double min, double max) const {
+    if (length_ == 0 || min > max || tail_->score < min || first()->score > max) {
+        return nullptr;
+    }
+    Node* x = header_;
+    for (int i = level_ - 1; i >= 0; --i) {
+        while (x->levels()[i].forward && x->levels()[i].forward->score <= max) {
+            x = x->levels()[i].forward;
+        }
+    }
+    return x != header_ && x->score >= min ? x : nullptr;
+}
+
+} // namespace dkv
@@ -0,0 +1,152 @@
+#include "dkv_load_generator.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace dkv {
+
+// 打印帮助信息
+void printBenchmarkHelp() {
+    std::cout << "dkv-benchmark - DKV端到端压测工具\n" << std::endl;
+    std::cout << "用法: dkv-benchmark [选项]\n" << std::endl;
+    std::cout << "选项:" << std::endl;
+    std::cout << "  -H, --host <host>         服务器地址（默认：127.0.0.1）" << std::endl;
+    std::cout << "  -p, --port <port>         服务器端口（默认：6379）" << std::endl;
+    std::cout << "  -c, --connections <n>     连接数（默认：50）" << std::endl;
+    std::cout << "      --threads <n>         压测线程数，连接平均分配到各线程（默认：1）" << std::endl;
+    std::cout << "  -P, --pipeline <n>        每个连接一次发送的命令数（默认：1）" << std::endl;
+    std::cout << "  -n, --requests <n>        总请求数（默认：100000）" << std::endl;
+    std::cout << "      --duration <seconds>  按时长压测，指定后忽略请求数" << std::endl;
+    std::cout << "  -r, --keyspace <n>        键空间大小（默认：100000）" << std::endl;
+    std::cout << "      --distribution <d>    键的分布：uniform或zipfian（默认：uniform）" << std::endl;
+    std::cout << "      --zipf-theta <theta>  zipfian分布的参数，在(0, 1)之间（默认：0.99）" << std::endl;
+    std::cout << "  -d, --value-size <size>   值的字节数，min-max表示在范围内均匀选取（默认：64）" << std::endl;
+    std::cout << "  -m, --mix <mix>           命令组合及权重，如get:9,set:1（默认：set:1,get:1）" << std::endl;
+    std::cout << "      --key-prefix <prefix> 键前缀（默认：bench:）" << std::endl;
+    std::cout << "      --preload             压测前写入键空间中的全部字符串键" << std::endl;
+    std::cout << "      --seed <n>            随机数种子（默认：1）" << std::endl;
+    std::cout << "  -h, --help                显示帮助信息" << std::endl;
+    std::cout << "\n支持的命令:";
+    for (const auto& name : LoadGenerator::supportedCommands()) {
+        std::cout << " " << name;
+    }
+    std::cout << "\n\n示例:" << std::endl;
+    std::cout << "  dkv-benchmark -c 100 -P 16 -n 1000000 -m get:9,set:1" << std::endl;
+    std::cout << "  dkv-benchmark --distribution zipfian --duration 30 --preload -d 16-1024" << std::endl;
+}
+
+namespace {
+
+[[noreturn]] void usageError(const std::string& message) {
+    std::cerr << "错误: " << message << std::endl;
+    std::cerr << "使用 -h 或 --help 查看帮助信息" << std::endl;
+    exit(1);
+}
+
+uint64_t parseNumber(const std::string& option, const std::string& text) {
+    try {
+        size_t used = 0;
+        unsigned long long value = std::stoull(text, &used);
+        if (used == text.size() && text[0] != '-') {
+            return value;
+        }
+    } catch (const std::exception&) {
+    }
+    usageError(option + " 需要非负整数: " + text);
+}
+
+double parseDouble(const std::string& option, const std::string& text) {
+    try {
+        size_t used = 0;
+        double value = std::stod(text, &used);
+        if (used == text.size()) {
+            return value;
+        }
+    } catch (const std::exception&) {
+    }
+    usageError(option + " 需要数字: " + text);
+}
+
+} // namespace
+
+// 解析命令行参数，返回false表示只需打印帮助
+bool parseBenchmarkArguments(int argc, char* argv[], LoadConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        }
+        if (arg == "--preload") {
+            config.preload = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usageError(arg + " 需要参数");
+        }
+        std::string value = argv[++i];
+        if (arg == "-H" || arg == "--host") {
+            config.host = value;
+        } else if (arg == "-p" || arg == "--port") {
+            config.port = static_cast<int>(parseNumber(arg, value));
+        } else if (arg == "-c" || arg == "--connections") {
+            config.connections = parseNumber(arg, value);
+        } else if (arg == "--threads") {
+            config.threads = parseNumber(arg, value);
+        } else if (arg == "-P" || arg == "--pipeline") {
+            config.pipeline = parseNumber(arg, value);
+        } else if (arg == "-n" || arg == "--requests") {
+            config.requests = parseNumber(arg, value);
+        } else if (arg == "--duration") {
+            config.duration_seconds = parseDouble(arg, value);
+        } else if (arg == "-r" || arg == "--keyspace") {
+            config.keyspace = parseNumber(arg, value);
+        } else if (arg == "--distribution") {
+            if (value == "uniform") {
+                config.distribution = KeyDistribution::UNIFORM;
+            } else if (value == "zipfian") {
+                config.distribution = KeyDistribution::ZIPFIAN;
+            } else {
+                usageError("未知的键分布: " + value);
+            }
+        } else if (arg == "--zipf-theta") {
+            config.zipf_theta = parseDouble(arg, value);
+        } else if (arg == "-d" || arg == "--value-size") {
+            size_t dash = value.find('-');
+            config.value_size = parseNumber(arg, value.substr(0, dash));
+            config.value_size_max = dash == std::string::npos ? 0 : parseNumber(arg, value.substr(dash + 1));
+        } else if (arg == "-m" || arg == "--mix") {
+            std::string error;
+            if (!LoadGenerator::parseMix(value, config.mix, error)) {
+                usageError(error);
+            }
+        } else if (arg == "--key-prefix") {
+            config.key_prefix = value;
+        } else if (arg == "--seed") {
+            config.seed = parseNumber(arg, value);
+        } else {
+            usageError("未知参数: " + arg);
+        }
+    }
+    return true;
+}
+
+} // namespace dkv
+
+int main(int argc, char* argv[]) {
+    using namespace dkv;
+
+    LoadConfig config;
+    if (!parseBenchmarkArguments(argc, argv, config)) {
+        printBenchmarkHelp();
+        return 0;
+    }
+
+    LoadGenerator generator(config);
+    LoadReport report;
+    if (!generator.run(report)) {
+        std::cerr << "压测失败: " << generator.error() << std::endl;
+        return 1;
+    }
+    std::cout << report.format(generator.config());
+    return report.failed_connections == 0 ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include "dkv_blocking.hpp"
+#include <cmath>
+#include <cstdlib>
+
+namespace dkv {
+
+namespace {
+// 超时参数的上限，换算成毫秒后不会溢出
+constexpr double MAX_TIMEOUT_SECONDS = 1e12;
+} // namespace
+
+std::shared_ptr<BlockedClients::Client> BlockedClients::block(const Command& command, Callback done) {
+    auto client = std::make_shared<Client>();
+    client->command = command;
+    client->done = std::move(done);
+    std::vector<Key> keys = command.keys();
+    {   std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& key : keys) {
+            Queue& queue = queues_[key];
+            client->positions.push_back(queue.insert(queue.end(), client));
+        }
+        blocked_count_.fetch_add(1);
+    }
+    for (const auto& key : keys) {
+        signalKeyReady(key);
+    }
+    serveReadyKeys();
+    return client;
+}
+
+void BlockedClients::signalKeyReady(const Key& key) {
+    if (blocked_count_.load() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(ready_mutex_);
+    if (ready_set_.insert(key).second) {
+        ready_keys_.push_back(key);
+    }
+    has_ready_.store(true);
+}
+
+void BlockedClients::serveReadyKeys() {
+    if (!has_ready_.load()) {
+        return;
+    }
+    // 回调在释放serve_mutex_后调用，回调中写出回复需要获取连接所在SubReactor的锁
+    std::vector<std::pair<std::shared_ptr<Client>, Response>> served;
+    {   std::lock_guard<std::mutex> serve_lock(serve_mutex_);
+        while (true) {
+            std::vector<Key> ready;
+            {   std::lock_guard<std::mutex> ready_lock(ready_mutex_);
+                ready.swap(ready_keys_);
+                ready_set_.clear();
+                has_ready_.store(false);
+            }
+            if (ready.empty()) {
+                break;
+            }
+            // BLMOVE推入的目标键会再次标记为就绪，由下一轮处理
+            for (const auto& key : ready) {
+                while (true) {
+                    std::shared_ptr<Client> client;
+                    {   std::lock_guard<std::mutex> lock(mutex_);
+                        auto it = queues_.find(key);
+                        if (it == queues_.end()) {
+                            break;
+                        }
+                        client = it->second.front();
+                        client->serving = true;
+                    }
+                    Response response = executor_(client->command);
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    client->serving = false;
+                    const bool found = response.status != ResponseStatus::NOT_FOUND;
+                    if (!found && !client->timed_out && !client->cancelled) {
+                        break; // 元素已被取走，继续等待下一次推入
+                    }
+                    // 取到元素时即使已经超时也回复结果，元素不会丢失；已取消的连接不回复
+                    unlinkLocked(*client);
+                    if (!client->cancelled) {
+                        served.emplace_back(std::move(client), found ? std::move(response)
+                                                                     : Response(ResponseStatus::NOT_FOUND));
+                    }
+                }
+            }
+        }
+    }
+    for (auto& entry : served) {
+        entry.first->done(entry.second);
+    }
+}
+
+void BlockedClients::timeout(const std::weak_ptr<Client>& client) {
+    std::shared_ptr<Client> locked = client.lock();
+    if (!locked) {
+        return;
+    }
+    {   std::lock_guard<std::mutex> lock(mutex_);
+        if (locked->finished) {
+            return;
+        }
+        if (locked->serving) {
+            locked->timed_out = true;
+            return;
+        }
+        unlinkLocked(*locked);
+    }
+    locked->done(Response(ResponseStatus::NOT_FOUND));
+}
+
+void BlockedClients::cancel(const std::weak_ptr<Client>& client) {
+    std::shared_ptr<Client> locked = client.lock();
+    if (!locked) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (locked->serving) {
+        locked->cancelled = true;
+    } else if (!locked->finished) {
+        unlinkLocked(*locked);
+    }
+}
+
+void BlockedClients::unlinkLocked(Client& client) {
+    client.finished = true;
+    std::vector<Key> keys = client.command.keys();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto it = queues_.find(keys[i]);
+        it->second.erase(client.positions[i]);
+        if (it->second.empty()) {
+            queues_.erase(it);
+        }
+    }
+    client.positions.clear();
+    blocked_count_.fetch_sub(1);
+}
+
+bool BlockedClients::parseTimeout(const std::string& arg, std::chrono::milliseconds& timeout) {
+    if (arg.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    double seconds = std::strtod(arg.c_str(), &end);
+    if (*end != '\0' || !std::isfinite(seconds) || seconds < 0 || seconds > MAX_TIMEOUT_SECONDS) {
+        return false;
+    }
+    long long ms = std::llround(seconds * 1000);
+    // 不足1毫秒的正数仍然表示有限的等待
+    timeout = std::chrono::milliseconds(seconds > 0 && ms == 0 ? 1 : ms);
+    return true;
+}
+
+} // namespace dkv
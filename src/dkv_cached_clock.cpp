@@ -0,0 +1,54 @@
+#include "dkv_cached_clock.hpp"
+#include <mutex>
+#include <thread>
+
+namespace dkv {
+
+std::atomic<int64_t> CachedClock::now_ms_{0};
+
+namespace {
+
+// 更新线程的启停状态，由clock_mutex保护
+std::mutex clock_mutex;
+size_t clock_refs = 0;
+std::thread clock_thread;
+std::atomic<bool> clock_running{false};
+
+} // namespace
+
+int64_t CachedClock::systemMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void CachedClock::start() {
+    std::lock_guard<std::mutex> lock(clock_mutex);
+    if (clock_refs++ > 0) {
+        return;
+    }
+    // 先写入当前时间，start返回后读者即可使用缓存值
+    now_ms_.store(systemMs(), std::memory_order_relaxed);
+    clock_running = true;
+    clock_thread = std::thread(&CachedClock::run);
+}
+
+void CachedClock::stop() {
+    std::lock_guard<std::mutex> lock(clock_mutex);
+    if (clock_refs == 0 || --clock_refs > 0) {
+        return;
+    }
+    clock_running = false;
+    if (clock_thread.joinable()) {
+        clock_thread.join();
+    }
+    now_ms_.store(0, std::memory_order_relaxed);
+}
+
+void CachedClock::run() {
+    while (clock_running.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(RESOLUTION);
+        now_ms_.store(systemMs(), std::memory_order_relaxed);
+    }
+}
+
+} // namespace dkv
@@ -0,0 +1,172 @@
+#include "dkv_client_tracking.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace dkv {
+
+namespace {
+constexpr size_t BITS_PER_WORD = 64;
+} // namespace
+
+void ClientTracking::enable(const TrackingClient& client) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto id = std::make_pair(client.reactor, client.connection_id);
+    if (slot_index_.count(id)) {
+        return;
+    }
+    size_t slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        slots_[slot] = client;
+        slot_used_[slot] = true;
+    } else {
+        slot = slots_.size();
+        slots_.push_back(client);
+        slot_used_.push_back(true);
+    }
+    slot_index_[id] = slot;
+    client_count_.fetch_add(1);
+}
+
+void ClientTracking::disable(SubReactor* reactor, uint64_t connection_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = slot_index_.find(std::make_pair(reactor, connection_id));
+    if (it == slot_index_.end()) {
+        return;
+    }
+    size_t slot = it->second;
+    slot_index_.erase(it);
+    // 槽位复用前必须清除旧记录，否则新连接会收到旧连接读过的键的通知
+    clearSlotLocked(slot);
+    pending_.erase(slot);
+    slot_used_[slot] = false;
+    free_slots_.push_back(slot);
+    client_count_.fetch_sub(1);
+}
+
+bool ClientTracking::isTracking(SubReactor* reactor, uint64_t connection_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slot_index_.count(std::make_pair(reactor, connection_id)) > 0;
+}
+
+size_t ClientTracking::keys() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return table_.size();
+}
+
+void ClientTracking::recordRead(SubReactor* reactor, uint64_t connection_id, const std::vector<Key>& keys) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = slot_index_.find(std::make_pair(reactor, connection_id));
+    if (it == slot_index_.end()) {
+        return;
+    }
+    size_t slot = it->second;
+    size_t word = slot / BITS_PER_WORD;
+    uint64_t bit = uint64_t(1) << (slot % BITS_PER_WORD);
+    for (const auto& key : keys) {
+        uint64_t hash = keyHash(key);
+        auto entry = table_.find(hash);
+        if (entry == table_.end()) {
+            // 超出上限时淘汰任意一条记录
+            while (table_.size() >= max_keys_) {
+                auto victim = table_.begin();
+                notifyLocked(victim->second, nullptr);
+                table_.erase(victim);
+            }
+            entry = table_.emplace(hash, Bitmap()).first;
+        }
+        Bitmap& bitmap = entry->second;
+        if (bitmap.size() <= word) {
+            bitmap.resize(word + 1, 0);
+        }
+        bitmap[word] |= bit;
+    }
+}
+
+void ClientTracking::invalidate(const std::vector<Key>& keys) {
+    if (client_count_.load() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& key : keys) {
+        auto entry = table_.find(keyHash(key));
+        if (entry == table_.end()) {
+            continue;
+        }
+        notifyLocked(entry->second, &key);
+        table_.erase(entry);
+    }
+}
+
+void ClientTracking::invalidateAll() {
+    if (client_count_.load() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    table_.clear();
+    for (size_t slot = 0; slot < slots_.size(); ++slot) {
+        if (slot_used_[slot]) {
+            notifySlotLocked(slot, nullptr);
+        }
+    }
+}
+
+std::vector<TrackingInvalidation> ClientTracking::takeInvalidations() {
+    std::vector<TrackingInvalidation> result;
+    if (!has_pending_.load()) {
+        return result;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    result.reserve(pending_.size());
+    for (auto& entry : pending_) {
+        result.push_back(std::move(entry.second));
+    }
+    pending_.clear();
+    has_pending_.store(false);
+    return result;
+}
+
+void ClientTracking::setMaxKeys(size_t max_keys) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_keys_ = std::max<size_t>(1, max_keys);
+}
+
+uint64_t ClientTracking::keyHash(const Key& key) {
+    return static_cast<uint64_t>(std::hash<Key>()(key));
+}
+
+void ClientTracking::clearSlotLocked(size_t slot) {
+    size_t word = slot / BITS_PER_WORD;
+    uint64_t mask = ~(uint64_t(1) << (slot % BITS_PER_WORD));
+    for (auto it = table_.begin(); it != table_.end();) {
+        Bitmap& bitmap = it->second;
+        if (word < bitmap.size()) {
+            bitmap[word] &= mask;
+        }
+        bool empty = std::all_of(bitmap.begin(), bitmap.end(), [](uint64_t bits) { return bits == 0; });
+        it = empty ? table_.erase(it) : std::next(it);
+    }
+}
+
+void ClientTracking::notifyLocked(const Bitmap& bitmap, const Key* key) {
+    for (size_t w = 0; w < bitmap.size(); ++w) {
+        for (uint64_t bits = bitmap[w]; bits; bits &= bits - 1) {
+            notifySlotLocked(w * BITS_PER_WORD + __builtin_ctzll(bits), key);
+        }
+    }
+}
+
+void ClientTracking::notifySlotLocked(size_t slot, const Key* key) {
+    TrackingInvalidation& pending = pending_[slot];
+    pending.client = slots_[slot];
+    if (!key) {
+        pending.flush_all = true;
+        pending.keys.clear();
+    } else if (!pending.flush_all) {
+        pending.keys.push_back(*key);
+    }
+    has_pending_.store(true);
+}
+
+} // namespace dkv
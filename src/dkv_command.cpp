@@ -3,15 +3,53 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <cstring>
+#include <charconv>
 #include "dkv_core.hpp"
 #include "dkv_utils.hpp"
 
 namespace dkv {
 
 std::string Command::desc() const {
+    if (args.empty()) {
+        return Utils::commandTypeToString(type);
+    }
     return Utils::commandTypeToString(type) + " " + args[0];
 }
 
+std::vector<Key> Command::keys() const {
+    const CommandSpec& spec = commandSpec(type);
+    if (spec.first_key < 0) {
+        return {};
+    }
+    if (spec.hasFlag(CMD_NUMKEYS)) {
+        // 目标键、源键个数、源键
+        const size_t dest = static_cast<size_t>(spec.first_key);
+        if (args.size() < dest + 2) {
+            return {};
+        }
+        const std::string& text = args[dest + 1];
+        size_t numkeys = 0;
+        auto parsed = std::from_chars(text.data(), text.data() + text.size(), numkeys);
+        if (parsed.ec != std::errc() || parsed.ptr != text.data() + text.size() ||
+            numkeys == 0 || numkeys > args.size() - dest - 2) {
+            return {};
+        }
+        std::vector<Key> result(args.begin() + dest, args.begin() + dest + 1);
+        result.insert(result.end(), args.begin() + dest + 2, args.begin() + dest + 2 + numkeys);
+        return result;
+    }
+    int arg_count = static_cast<int>(args.size());
+    int last_key = spec.last_key < 0 ? arg_count + spec.last_key : spec.last_key;
+    if (last_key >= arg_count) {
+        return {};
+    }
+    std::vector<Key> result;
+    for (int i = spec.first_key; i <= last_key; i += spec.key_step) {
+        result.push_back(args[i]);
+    }
+    return result;
+}
+
 void Command::serialize(std::vector<char>& buffer) const {
     // 1. 序列化CommandType类型
     uint32_t commandType = htonl(static_cast<uint32_t>(type));
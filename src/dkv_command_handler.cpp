@@ -3,13 +3,32 @@
 #include "dkv_logger.hpp"
 #include "net/dkv_resp.hpp"
 #include "dkv_datatypes.hpp"
-#include "dkv_script.hpp"
+#include "persist/dkv_rdb.hpp"
+#include "persist/dkv_rdb_loader.hpp"
+#include "dkv_blocking.hpp"
+#include "dkv_page_memory.hpp"
 
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 
 namespace dkv {
 
+namespace {
+
+// 解析非负的十进制位偏移，不接受负号，超过BitmapItem::MAX_BIT_OFFSET时返回false
+bool parseBitOffset(const std::string& text, uint64_t& offset) {
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, offset);
+    return !text.empty() && ec == std::errc() && ptr == end && offset <= BitmapItem::MAX_BIT_OFFSET;
+}
+
+const char* const BIT_OFFSET_ERROR = "位偏移不是整数或超出范围";
+
+} // namespace
+
 CommandHandler::CommandHandler(StorageEngine* storage_engine, AOFPersistence* aof_persistence, bool enable_aof)
     : storage_engine_(storage_engine), aof_persistence_(aof_persistence), enable_aof_(enable_aof) {
 }
@@ -94,6 +113,54 @@ Response CommandHandler::handleDelCommand(TransactionID tx_id, const Command& co
     return Response(ResponseStatus::OK, "", std::to_string(deleted_count));
 }
 
+Response CommandHandler::handleUnlinkCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
+    if (command.args.empty()) {
+        return Response(ResponseStatus::ERROR, "UNLINK命令需要至少1个参数");
+    }
+
+    int deleted_count = 0;
+    for (const auto& key : command.args) {
+        if (storage_engine_->unlink(tx_id, key)) {
+            deleted_count++;
+            need_inc_dirty = true;
+        }
+    }
+
+    return Response(ResponseStatus::OK, "", std::to_string(deleted_count));
+}
+
+Response CommandHandler::handleMGetCommand(TransactionID tx_id, const Command& command) {
+    if (command.args.empty()) {
+        return Response(ResponseStatus::ERROR, "MGET命令需要至少1个参数");
+    }
+    Response response;
+    response.status = ResponseStatus::OK;
+    // 不存在的键为空串，由网络层编码为空值
+    response.setArray(storage_engine_->mget(tx_id, command.args));
+    return response;
+}
+
+Response CommandHandler::handleMSetCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty, bool nx) {
+    if (command.args.empty() || command.args.size() % 2 != 0) {
+        return Response(ResponseStatus::ERROR, nx ? "MSETNX命令需要偶数个参数" : "MSET命令需要偶数个参数");
+    }
+    std::vector<std::pair<Key, Value>> pairs;
+    pairs.reserve(command.args.size() / 2);
+    for (size_t i = 0; i < command.args.size(); i += 2) {
+        pairs.emplace_back(command.args[i], command.args[i + 1]);
+    }
+    if (nx) {
+        bool success = storage_engine_->msetnx(tx_id, pairs);
+        need_inc_dirty = success;
+        return Response(ResponseStatus::OK, "", success ? "1" : "0");
+    }
+    if (!storage_engine_->mset(tx_id, pairs)) {
+        return Response(ResponseStatus::ERROR, "设置键值失败");
+    }
+    need_inc_dirty = true;
+    return Response(ResponseStatus::OK, "OK");
+}
+
 Response CommandHandler::handleExistsCommand(TransactionID tx_id, const Command& command) {
     if (command.args.empty()) {
         return Response(ResponseStatus::ERROR, "EXISTS命令需要至少1个参数");
@@ -160,24 +227,36 @@ Response CommandHandler::handleHSetCommand(TransactionID tx_id, const Command& c
         return Response(ResponseStatus::ERROR, "HSET命令需要奇数个参数(至少3个)");
     }
     
-    int added_count = 0;
-    const std::string& key = command.args[0];
-    
-    // 遍历所有字段值对
+    // 所有字段在一次加锁内写入
+    std::vector<std::pair<Value, Value>> fields;
+    fields.reserve(command.args.size() / 2);
     for (size_t i = 1; i < command.args.size(); i += 2) {
-        const std::string& field = command.args[i];
-        const std::string& value = command.args[i + 1];
-        
-        bool success = storage_engine_->hset(tx_id, key, field, value);
-        if (success) {
-            added_count++;
-            need_inc_dirty = true;
-        }
+        fields.emplace_back(command.args[i], command.args[i + 1]);
+    }
+    size_t added_count = storage_engine_->hmset(tx_id, command.args[0], fields);
+    if (added_count > 0) {
+        need_inc_dirty = true;
     }
     
     return Response(ResponseStatus::OK, "", std::to_string(added_count));
 }
 
+Response CommandHandler::handleHMSetCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
+    if (command.args.size() < 3 || command.args.size() % 2 == 0) {
+        return Response(ResponseStatus::ERROR, "HMSET命令需要奇数个参数(至少3个)");
+    }
+    std::vector<std::pair<Value, Value>> fields;
+    fields.reserve(command.args.size() / 2);
+    for (size_t i = 1; i < command.args.size(); i += 2) {
+        fields.emplace_back(command.args[i], command.args[i + 1]);
+    }
+    if (storage_engine_->hmset(tx_id, command.args[0], fields) == 0) {
+        return Response(ResponseStatus::ERROR, "设置哈希字段失败");
+    }
+    need_inc_dirty = true;
+    return Response(ResponseStatus::OK, "OK");
+}
+
 Response CommandHandler::handleHGetCommand(TransactionID tx_id, const Command& command) {
     if (command.args.size() < 2) {
         return Response(ResponseStatus::ERROR, "HGET命令需要至少2个参数");
@@ -189,22 +268,35 @@ Response CommandHandler::handleHGetCommand(TransactionID tx_id, const Command& c
     return Response(ResponseStatus::OK, "", value);
 }
 
+Response CommandHandler::handleHMGetCommand(TransactionID tx_id, const Command& command) {
+    if (command.args.size() < 2) {
+        return Response(ResponseStatus::ERROR, "HMGET命令需要至少2个参数");
+    }
+    std::vector<Value> fields(command.args.begin() + 1, command.args.end());
+    Response response;
+    response.status = ResponseStatus::OK;
+    // 不存在的字段为空串，由网络层编码为空值
+    response.setArray(storage_engine_->hmget(tx_id, command.args[0], fields));
+    return response;
+}
+
 Response CommandHandler::handleHGetAllCommand(TransactionID tx_id, const Command& command) {
     if (command.args.empty()) {
         return Response(ResponseStatus::ERROR, "HGETALL命令需要1个参数");
     }
     std::vector<std::pair<Value, Value>> all = storage_engine_->hgetall(tx_id, command.args[0]);
     
-    // 将结果转换为RESP协议数组格式
+    // 字段和值依次排列，由网络层直接编码
     std::vector<std::string> result;
-    for (const auto& pair : all) {
-        result.push_back(pair.first);
-        result.push_back(pair.second);
+    result.reserve(all.size() * 2);
+    for (auto& pair : all) {
+        result.push_back(std::move(pair.first));
+        result.push_back(std::move(pair.second));
     }
     
     Response response;
     response.status = ResponseStatus::OK;
-    response.data = RESPProtocol::serializeArray(result);
+    response.setArray(std::move(result));
     return response;
 }
 
@@ -243,7 +335,7 @@ Response CommandHandler::handleHKeysCommand(TransactionID tx_id, const Command&
     
     Response response;
     response.status = ResponseStatus::OK;
-    response.data = RESPProtocol::serializeArray(keys);
+    response.setArray(std::move(keys));
     return response;
 }
 
@@ -255,7 +347,7 @@ Response CommandHandler::handleHValsCommand(TransactionID tx_id, const Command&
     
     Response response;
     response.status = ResponseStatus::OK;
-    response.data = RESPProtocol::serializeArray(values);
+    response.setArray(std::move(values));
     return response;
 }
 
@@ -339,7 +431,7 @@ Response CommandHandler::handleLPopCommand(TransactionID tx_id, const Command& c
         
         // 返回列表格式的响应
         Response response(ResponseStatus::OK);
-        response.data = RESPProtocol::serializeArray(values);
+        response.setArray(std::move(values));
         return response;
     } catch (const std::invalid_argument&) {
         return Response(ResponseStatus::ERROR, "count参数必须是正整数");
@@ -387,7 +479,7 @@ Response CommandHandler::handleRPopCommand(TransactionID tx_id, const Command& c
         
         // 返回列表格式的响应
         Response response(ResponseStatus::OK);
-        response.data = RESPProtocol::serializeArray(values);
+        response.setArray(std::move(values));
         return response;
     } catch (const std::invalid_argument&) {
         return Response(ResponseStatus::ERROR, "count参数必须是正整数");
@@ -415,13 +507,109 @@ Response CommandHandler::handleLRangeCommand(TransactionID tx_id, const Command&
         
         Response response;
         response.status = ResponseStatus::OK;
-        response.data = RESPProtocol::serializeArray(values);
+        response.setArray(std::move(values));
         return response;
     } catch (const std::invalid_argument&) {
         return Response(ResponseStatus::ERROR, "无效的范围参数");
     }
 }
 
+Response CommandHandler::handleLIndexCommand(TransactionID tx_id, const Command& command) {
+    if (command.args.size() < 2) {
+        return Response(ResponseStatus::ERROR, "LINDEX命令需要2个参数");
+    }
+    try {
+        int64_t index = std::stoll(command.args[1]);
+        Value value;
+        if (!storage_engine_->lindex(tx_id, command.args[0], index, value)) {
+            return Response(ResponseStatus::NOT_FOUND);
+        }
+        return Response(ResponseStatus::OK, "", value);
+    } catch (const std::invalid_argument&) {
+        return Response(ResponseStatus::ERROR, "无效的下标参数");
+    } catch (const std::out_of_range&) {
+        return Response(ResponseStatus::ERROR, "下标参数超出范围");
+    }
+}
+
+Response CommandHandler::handleLSetCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
+    if (command.args.size() < 3) {
+        return Response(ResponseStatus::ERROR, "LSET命令需要3个参数");
+    }
+    try {
+        int64_t index = std::stoll(command.args[1]);
+        if (!storage_engine_->lset(tx_id, command.args[0], index, command.args[2])) {
+            // 空列表会被删除，长度为0即键不存在
+            if (storage_engine_->llen(tx_id, command.args[0]) == 0) {
+                return Response(ResponseStatus::ERROR, "键不存在");
+            }
+            return Response(ResponseStatus::ERROR, "下标超出范围");
+        }
+        need_inc_dirty = true;
+        return Response(ResponseStatus::OK);
+    } catch (const std::invalid_argument&) {
+        return Response(ResponseStatus::ERROR, "无效的下标参数");
+    } catch (const std::out_of_range&) {
+        return Response(ResponseStatus::ERROR, "下标参数超出范围");
+    }
+}
+
+Response CommandHandler::handleBlockingPopCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty, bool left) {
+    const char* name = left ? "BLPOP" : "BRPOP";
+    if (command.args.size() < 2) {
+        return Response(ResponseStatus::ERROR, std::string(name) + "命令需要至少2个参数");
+    }
+    std::chrono::milliseconds timeout;
+    if (!BlockedClients::parseTimeout(command.args.back(), timeout)) {
+        return Response(ResponseStatus::ERROR, "timeout参数必须是非负数");
+    }
+    // 按参数顺序从第一个非空列表弹出
+    for (size_t i = 0; i + 1 < command.args.size(); ++i) {
+        const Key& key = command.args[i];
+        std::string value = left ? storage_engine_->lpop(tx_id, key) : storage_engine_->rpop(tx_id, key);
+        if (!value.empty()) {
+            need_inc_dirty = true;
+            Response response(ResponseStatus::OK);
+            response.setArray({key, std::move(value)});
+            return response;
+        }
+    }
+    return Response(ResponseStatus::NOT_FOUND);
+}
+
+Response CommandHandler::handleBLMoveCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
+    if (command.args.size() != 5) {
+        return Response(ResponseStatus::ERROR, "BLMOVE命令需要5个参数");
+    }
+    std::chrono::milliseconds timeout;
+    if (!BlockedClients::parseTimeout(command.args[4], timeout)) {
+        return Response(ResponseStatus::ERROR, "timeout参数必须是非负数");
+    }
+    return handleLMoveCommand(tx_id, command, need_inc_dirty);
+}
+
+// LMOVE只使用前4个参数，BLMOVE检查超时参数后复用
+Response CommandHandler::handleLMoveCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
+    if (command.args.size() < 4) {
+        return Response(ResponseStatus::ERROR, "LMOVE命令需要4个参数");
+    }
+    auto parseSide = [](std::string side, bool& left) {
+        std::transform(side.begin(), side.end(), side.begin(), ::toupper);
+        left = side == "LEFT";
+        return left || side == "RIGHT";
+    };
+    bool from_left, to_left;
+    if (!parseSide(command.args[2], from_left) || !parseSide(command.args[3], to_left)) {
+        return Response(ResponseStatus::ERROR, "方向参数必须是LEFT或RIGHT");
+    }
+    std::string value = storage_engine_->lmove(tx_id, command.args[0], command.args[1], from_left, to_left);
+    if (value.empty()) {
+        return Response(ResponseStatus::NOT_FOUND);
+    }
+    need_inc_dirty = true;
+    return Response(ResponseStatus::OK, "", value);
+}
+
 // 集合命令处理
 Response CommandHandler::handleSAddCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
     if (command.args.size() < 2) {
@@ -459,7 +647,7 @@ Response CommandHandler::handleSMembersCommand(TransactionID tx_id, const Comman
     
     Response response;
     response.status = ResponseStatus::OK;
-    response.data = RESPProtocol::serializeArray(members);
+    response.setArray(std::move(members));
     return response;
 }
 
@@ -479,6 +667,34 @@ Response CommandHandler::handleSCardCommand(TransactionID tx_id, const Command&
     return Response(ResponseStatus::OK, "", std::to_string(count));
 }
 
+Response CommandHandler::handleSetOpCommand(TransactionID tx_id, const Command& command, SetOp op) {
+    if (command.args.empty()) {
+        return Response(ResponseStatus::ERROR, "集合运算命令需要至少1个参数");
+    }
+    std::vector<Key> keys(command.args.begin(), command.args.end());
+    std::vector<Value> members;
+    if (!storage_engine_->setOp(tx_id, op, keys, members)) {
+        return Response(ResponseStatus::ERROR, "键存在但不是集合类型");
+    }
+    Response response;
+    response.status = ResponseStatus::OK;
+    response.setArray(std::move(members));
+    return response;
+}
+
+Response CommandHandler::handleSetOpStoreCommand(TransactionID tx_id, const Command& command, SetOp op, bool& need_inc_dirty) {
+    if (command.args.size() < 2) {
+        return Response(ResponseStatus::ERROR, "集合运算存储命令需要至少2个参数");
+    }
+    std::vector<Key> keys(command.args.begin() + 1, command.args.end());
+    size_t count = 0;
+    if (!storage_engine_->setOpStore(tx_id, op, command.args[0], keys, count)) {
+        return Response(ResponseStatus::ERROR, "键存在但不是集合类型");
+    }
+    need_inc_dirty = true;
+    return Response(ResponseStatus::OK, "", std::to_string(count));
+}
+
 // 有序集合命令处理
 Response CommandHandler::handleZAddCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
     if (command.args.size() < 3 || command.args.size() % 2 != 1) {
@@ -598,17 +814,19 @@ Response CommandHandler::handleZRangeCommand(TransactionID tx_id, const Command&
         
         if (withScores) {
             std::vector<std::string> result;
-            for (const auto& pair : members) {
-                result.push_back(pair.first);
+            result.reserve(members.size() * 2);
+            for (auto& pair : members) {
+                result.push_back(std::move(pair.first));
                 result.push_back(std::to_string(pair.second));
             }
-            response.data = RESPProtocol::serializeArray(result);
+            response.setArray(std::move(result));
         } else {
             std::vector<std::string> result;
-            for (const auto& pair : members) {
-                result.push_back(pair.first);
+            result.reserve(members.size());
+            for (auto& pair : members) {
+                result.push_back(std::move(pair.first));
             }
-            response.data = RESPProtocol::serializeArray(result);
+            response.setArray(std::move(result));
         }
         
         return response;
@@ -634,17 +852,19 @@ Response CommandHandler::handleZRevRangeCommand(TransactionID tx_id, const Comma
         
         if (withScores) {
             std::vector<std::string> result;
-            for (const auto& pair : members) {
-                result.push_back(pair.first);
+            result.reserve(members.size() * 2);
+            for (auto& pair : members) {
+                result.push_back(std::move(pair.first));
                 result.push_back(std::to_string(pair.second));
             }
-            response.data = RESPProtocol::serializeArray(result);
+            response.setArray(std::move(result));
         } else {
             std::vector<std::string> result;
-            for (const auto& pair : members) {
-                result.push_back(pair.first);
+            result.reserve(members.size());
+            for (auto& pair : members) {
+                result.push_back(std::move(pair.first));
             }
-            response.data = RESPProtocol::serializeArray(result);
+            response.setArray(std::move(result));
         }
         
         return response;
@@ -671,17 +891,19 @@ Response CommandHandler::handleZRangeByScoreCommand(TransactionID tx_id, const C
         
         if (withScores) {
             std::vector<std::string> result;
-            for (const auto& pair : members) {
-                result.push_back(pair.first);
+            result.reserve(members.size() * 2);
+            for (auto& pair : members) {
+                result.push_back(std::move(pair.first));
                 result.push_back(std::to_string(pair.second));
             }
-            response.data = RESPProtocol::serializeArray(result);
+            response.setArray(std::move(result));
         } else {
             std::vector<std::string> result;
-            for (const auto& pair : members) {
-                result.push_back(pair.first);
+            result.reserve(members.size());
+            for (auto& pair : members) {
+                result.push_back(std::move(pair.first));
             }
-            response.data = RESPProtocol::serializeArray(result);
+            response.setArray(std::move(result));
         }
         
         return response;
@@ -708,17 +930,19 @@ Response CommandHandler::handleZRevRangeByScoreCommand(TransactionID tx_id, cons
         
         if (withScores) {
             std::vector<std::string> result;
-            for (const auto& pair : members) {
-                result.push_back(pair.first);
+            result.reserve(members.size() * 2);
+            for (auto& pair : members) {
+                result.push_back(std::move(pair.first));
                 result.push_back(std::to_string(pair.second));
             }
-            response.data = RESPProtocol::serializeArray(result);
+            response.setArray(std::move(result));
         } else {
             std::vector<std::string> result;
-            for (const auto& pair : members) {
-                result.push_back(pair.first);
+            result.reserve(members.size());
+            for (auto& pair : members) {
+                result.push_back(std::move(pair.first));
             }
-            response.data = RESPProtocol::serializeArray(result);
+            response.setArray(std::move(result));
         }
         
         return response;
@@ -751,6 +975,91 @@ Response CommandHandler::handleZCardCommand(TransactionID tx_id, const Command&
     return Response(ResponseStatus::OK, "", std::to_string(count));
 }
 
+Response CommandHandler::handleZSetOpStoreCommand(TransactionID tx_id, const Command& command, SetOp op, bool& need_inc_dirty) {
+    const char* name = op == SetOp::UNION ? "ZUNIONSTORE" : "ZINTERSTORE";
+    if (command.args.size() < 3) {
+        return Response(ResponseStatus::ERROR, std::string(name) + "命令需要至少3个参数");
+    }
+    std::vector<Key> keys;
+    std::vector<double> weights;
+    ZSetAggregate aggregate = ZSetAggregate::SUM;
+    try {
+        const size_t numkeys = std::stoull(command.args[1]);
+        if (numkeys == 0 || numkeys > command.args.size() - 2) {
+            return Response(ResponseStatus::ERROR, "键的个数必须为正数且不超过参数个数");
+        }
+        keys.assign(command.args.begin() + 2, command.args.begin() + 2 + numkeys);
+        weights.assign(numkeys, 1.0);
+        for (size_t i = 2 + numkeys; i < command.args.size(); ++i) {
+            std::string option = command.args[i];
+            std::transform(option.begin(), option.end(), option.begin(), ::toupper);
+            if (option == "WEIGHTS" && i + numkeys < command.args.size()) {
+                for (size_t k = 0; k < numkeys; ++k) {
+                    weights[k] = std::stod(command.args[++i]);
+                }
+            } else if (option == "AGGREGATE" && i + 1 < command.args.size()) {
+                std::string type = command.args[++i];
+                std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+                if (type == "SUM") {
+                    aggregate = ZSetAggregate::SUM;
+                } else if (type == "MIN") {
+                    aggregate = ZSetAggregate::MIN;
+                } else if (type == "MAX") {
+                    aggregate = ZSetAggregate::MAX;
+                } else {
+                    return Response(ResponseStatus::ERROR, "AGGREGATE只支持SUM、MIN和MAX");
+                }
+            } else {
+                return Response(ResponseStatus::ERROR, "未知的" + std::string(name) + "选项: " + command.args[i]);
+            }
+        }
+    } catch (const std::exception&) {
+        return Response(ResponseStatus::ERROR, "无效的键个数或权重参数");
+    }
+    size_t count = 0;
+    if (!storage_engine_->zsetOpStore(tx_id, op, command.args[0], keys, weights, aggregate, count)) {
+        return Response(ResponseStatus::ERROR, "键存在但不是有序集合类型");
+    }
+    need_inc_dirty = true;
+    return Response(ResponseStatus::OK, "", std::to_string(count));
+}
+
+Response CommandHandler::handleZRangeStoreCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
+    if (command.args.size() < 4) {
+        return Response(ResponseStatus::ERROR, "ZRANGESTORE命令需要至少4个参数");
+    }
+    ZRangeSpec range;
+    for (size_t i = 4; i < command.args.size(); ++i) {
+        std::string option = command.args[i];
+        std::transform(option.begin(), option.end(), option.begin(), ::toupper);
+        if (option == "BYSCORE") {
+            range.by_score = true;
+        } else if (option == "REV") {
+            range.rev = true;
+        } else {
+            return Response(ResponseStatus::ERROR, "未知的ZRANGESTORE选项: " + command.args[i]);
+        }
+    }
+    try {
+        if (range.by_score) {
+            // 与ZREVRANGEBYSCORE相同，REV时先给出上界
+            range.min = std::stod(command.args[range.rev ? 3 : 2]);
+            range.max = std::stod(command.args[range.rev ? 2 : 3]);
+        } else {
+            range.start = std::stoull(command.args[2]);
+            range.stop = std::stoull(command.args[3]);
+        }
+    } catch (const std::exception&) {
+        return Response(ResponseStatus::ERROR, "无效的范围参数");
+    }
+    size_t count = 0;
+    if (!storage_engine_->zrangestore(tx_id, command.args[0], command.args[1], range, count)) {
+        return Response(ResponseStatus::ERROR, "键存在但不是有序集合类型");
+    }
+    need_inc_dirty = true;
+    return Response(ResponseStatus::OK, "", std::to_string(count));
+}
+
 // 位图命令处理
 Response CommandHandler::handleSetBitCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
     if (command.args.size() < 3) {
@@ -758,7 +1067,10 @@ Response CommandHandler::handleSetBitCommand(TransactionID tx_id, const Command&
     }
     try {
         Key key(command.args[0]);
-        uint64_t offset = std::stoull(command.args[1]);
+        uint64_t offset = 0;
+        if (!parseBitOffset(command.args[1], offset)) {
+            return Response(ResponseStatus::ERROR, BIT_OFFSET_ERROR);
+        }
         int bit = std::stoi(command.args[2]);
         
         bool oldBit = storage_engine_->getBit(tx_id, key, offset);
@@ -776,7 +1088,10 @@ Response CommandHandler::handleGetBitCommand(TransactionID tx_id, const Command&
     }
     try {
         Key key(command.args[0]);
-        uint64_t offset = std::stoull(command.args[1]);
+        uint64_t offset = 0;
+        if (!parseBitOffset(command.args[1], offset)) {
+            return Response(ResponseStatus::ERROR, BIT_OFFSET_ERROR);
+        }
         
         bool bit = storage_engine_->getBit(tx_id, key, offset);
         return Response(ResponseStatus::OK, "", std::to_string(bit ? 1 : 0));
@@ -834,19 +1149,135 @@ Response CommandHandler::handleBitOpCommand(TransactionID tx_id, const Command&
     }
 }
 
+Response CommandHandler::handleBitPosCommand(TransactionID tx_id, const Command& command) {
+    if (command.args.size() < 2 || command.args.size() > 4) {
+        return Response(ResponseStatus::ERROR, "BITPOS命令参数数量不正确");
+    }
+    if (command.args[1] != "0" && command.args[1] != "1") {
+        return Response(ResponseStatus::ERROR, "BITPOS的bit参数必须为0或1");
+    }
+    try {
+        // start和end为字节索引
+        const size_t start = command.args.size() > 2 ? std::stoull(command.args[2]) : 0;
+        std::optional<size_t> end;
+        if (command.args.size() > 3) {
+            end = std::stoull(command.args[3]);
+        }
+        int64_t pos = storage_engine_->bitPos(tx_id, command.args[0], command.args[1] == "1", start, end);
+        return Response(ResponseStatus::OK, "", std::to_string(pos));
+    } catch (const std::logic_error&) {
+        return Response(ResponseStatus::ERROR, "无效的参数类型");
+    }
+}
+
+// BITFIELD key [GET type offset] [SET type offset value] [INCRBY type offset increment] [OVERFLOW WRAP|SAT|FAIL]
+// type为i<位数>或u<位数>，offset前加#时按位域宽度计算
+Response CommandHandler::handleBitFieldCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
+    if (command.args.empty()) {
+        return Response(ResponseStatus::ERROR, "BITFIELD命令需要至少1个参数");
+    }
+    std::vector<BitFieldOp> ops;
+    BitFieldOp::Overflow overflow = BitFieldOp::Overflow::WRAP;
+    try {
+        for (size_t i = 1; i < command.args.size();) {
+            std::string subcommand = command.args[i];
+            std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+            if (subcommand == "OVERFLOW") {
+                if (i + 1 >= command.args.size()) {
+                    return Response(ResponseStatus::ERROR, "语法错误");
+                }
+                std::string policy = command.args[i + 1];
+                std::transform(policy.begin(), policy.end(), policy.begin(), ::toupper);
+                if (policy == "WRAP") {
+                    overflow = BitFieldOp::Overflow::WRAP;
+                } else if (policy == "SAT") {
+                    overflow = BitFieldOp::Overflow::SAT;
+                } else if (policy == "FAIL") {
+                    overflow = BitFieldOp::Overflow::FAIL;
+                } else {
+                    return Response(ResponseStatus::ERROR, "无效的OVERFLOW策略");
+                }
+                i += 2;
+                continue;
+            }
+
+            BitFieldOp op;
+            size_t argc;
+            if (subcommand == "GET") {
+                op.type = BitFieldOp::Type::GET;
+                argc = 3;
+            } else if (subcommand == "SET") {
+                op.type = BitFieldOp::Type::SET;
+                argc = 4;
+            } else if (subcommand == "INCRBY") {
+                op.type = BitFieldOp::Type::INCRBY;
+                argc = 4;
+            } else {
+                return Response(ResponseStatus::ERROR, "语法错误");
+            }
+            if (i + argc > command.args.size()) {
+                return Response(ResponseStatus::ERROR, "语法错误");
+            }
+
+            const std::string& type = command.args[i + 1];
+            if (type.size() < 2 || (type[0] != 'i' && type[0] != 'u') ||
+                !std::all_of(type.begin() + 1, type.end(), ::isdigit)) {
+                return Response(ResponseStatus::ERROR, "无效的位域类型");
+            }
+            op.is_signed = type[0] == 'i';
+            op.bits = static_cast<uint32_t>(std::stoul(type.substr(1)));
+            if (op.bits == 0 || op.bits > (op.is_signed ? 64u : 63u)) {
+                return Response(ResponseStatus::ERROR, "无效的位域类型");
+            }
+
+            const std::string& offset = command.args[i + 2];
+            if (!offset.empty() && offset[0] == '#') {
+                uint64_t index = 0;
+                if (!parseBitOffset(offset.substr(1), index) || index > BitmapItem::MAX_BIT_OFFSET / op.bits) {
+                    return Response(ResponseStatus::ERROR, BIT_OFFSET_ERROR);
+                }
+                op.offset = index * op.bits;
+            } else if (!parseBitOffset(offset, op.offset)) {
+                return Response(ResponseStatus::ERROR, BIT_OFFSET_ERROR);
+            }
+            if (argc == 4) {
+                op.value = std::stoll(command.args[i + 3]);
+            }
+            op.overflow = overflow;
+            ops.push_back(op);
+            i += argc;
+        }
+    } catch (const std::logic_error&) {
+        return Response(ResponseStatus::ERROR, "无效的参数类型");
+    }
+
+    std::vector<std::optional<int64_t>> results = storage_engine_->bitField(tx_id, command.args[0], ops);
+    if (results.size() != ops.size()) {
+        return Response(ResponseStatus::ERROR, "键存在但不是位图类型");
+    }
+    std::vector<std::string> values;
+    values.reserve(results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        // FAIL策略下溢出的子命令回复空值
+        values.push_back(results[i] ? std::to_string(*results[i]) : "");
+        if (ops[i].type != BitFieldOp::Type::GET && results[i]) {
+            need_inc_dirty = true;
+        }
+    }
+    Response response;
+    response.status = ResponseStatus::OK;
+    response.setArray(std::move(values));
+    return response;
+}
+
 // HyperLogLog命令处理
 Response CommandHandler::handlePFAddCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
     if (command.args.size() < 2) {
         return Response(ResponseStatus::ERROR, "PFADD命令需要至少2个参数");
     }
     
-    Key key(command.args[0]);
-    std::vector<Value> elements;
-    for (size_t i = 1; i < command.args.size(); ++i) {
-        elements.push_back(Value(command.args[i]));
-    }
-    
-    bool success = storage_engine_->pfadd(tx_id, key, elements);
+    // 元素直接引用命令参数，不再复制
+    bool success = storage_engine_->pfadd(tx_id, command.args[0], command.args.data() + 1, command.args.size() - 1);
     
     if (success) {
         need_inc_dirty = true;
@@ -865,10 +1296,8 @@ Response CommandHandler::handlePFCountCommand(TransactionID tx_id, const Command
         // 单个键
         count = storage_engine_->pfcount(tx_id, command.args[0]);
     } else {
-        // 多个键，需要创建临时合并后的HyperLogLog
-        // 注意：此实现简化了Redis的PFCOUNT多个键的处理，实际应合并后再计数
-        // 这里仅返回第一个键的计数作为示例
-        count = storage_engine_->pfcount(tx_id, command.args[0]);
+        // 多个键，返回并集的基数估计值
+        count = storage_engine_->pfcount(tx_id, command.args);
     }
     
     return Response(ResponseStatus::OK, "", std::to_string(count));
@@ -895,6 +1324,112 @@ Response CommandHandler::handlePFMergeCommand(TransactionID tx_id, const Command
     }
 }
 
+// 布隆过滤器命令处理
+Response CommandHandler::handleBFReserveCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
+    if (command.args.size() < 3) {
+        return Response(ResponseStatus::ERROR, "BF.RESERVE命令需要至少3个参数");
+    }
+    double error_rate = 0;
+    uint64_t capacity = 0;
+    uint32_t expansion = BloomFilterItem::kDefaultExpansion;
+    try {
+        error_rate = std::stod(command.args[1]);
+        capacity = std::stoull(command.args[2]);
+        for (size_t i = 3; i < command.args.size(); ++i) {
+            std::string option = command.args[i];
+            std::transform(option.begin(), option.end(), option.begin(), ::toupper);
+            if (option == "NONSCALING") {
+                expansion = 0;
+            } else if (option == "EXPANSION" && i + 1 < command.args.size()) {
+                const unsigned long value = std::stoul(command.args[++i]);
+                if (value == 0 || value > UINT32_MAX) {
+                    return Response(ResponseStatus::ERROR, "扩展因子必须为正整数");
+                }
+                if (expansion != 0) {
+                    expansion = static_cast<uint32_t>(value);
+                }
+            } else {
+                return Response(ResponseStatus::ERROR, "未知的BF.RESERVE选项: " + command.args[i]);
+            }
+        }
+    } catch (const std::exception&) {
+        return Response(ResponseStatus::ERROR, "无效的误判率、容量或扩展因子参数");
+    }
+    if (!(error_rate > 0 && error_rate < 1)) {
+        return Response(ResponseStatus::ERROR, "误判率必须在0和1之间");
+    }
+    if (capacity == 0) {
+        return Response(ResponseStatus::ERROR, "容量必须为正整数");
+    }
+    if (!storage_engine_->bfreserve(tx_id, command.args[0], error_rate, capacity, expansion)) {
+        return Response(ResponseStatus::ERROR, "键已存在");
+    }
+    need_inc_dirty = true;
+    return Response(ResponseStatus::OK, "OK");
+}
+
+Response CommandHandler::handleBFAddCommand(TransactionID tx_id, const Command& command, bool& need_inc_dirty) {
+    const bool multi = command.type == CommandType::BF_MADD;
+    if (command.args.size() < 2 || (!multi && command.args.size() != 2)) {
+        return Response(ResponseStatus::ERROR, multi ? "BF.MADD命令需要至少2个参数" : "BF.ADD命令需要2个参数");
+    }
+    std::vector<int> results;
+    if (!storage_engine_->bfadd(tx_id, command.args[0], command.args.data() + 1, command.args.size() - 1, results)) {
+        return Response(ResponseStatus::ERROR, "键的类型不是布隆过滤器");
+    }
+    for (int result : results) {
+        if (result == BloomFilterItem::ADD_ADDED) {
+            need_inc_dirty = true;
+        }
+    }
+    if (!multi) {
+        if (results[0] == BloomFilterItem::ADD_FULL) {
+            return Response(ResponseStatus::ERROR, "布隆过滤器已满");
+        }
+        return Response(ResponseStatus::OK, "", std::to_string(results[0]));
+    }
+    std::vector<std::string> values;
+    values.reserve(results.size());
+    for (int result : results) {
+        // 已满的元素返回空值
+        values.push_back(result == BloomFilterItem::ADD_FULL ? "" : std::to_string(result));
+    }
+    Response response;
+    response.status = ResponseStatus::OK;
+    response.setArray(std::move(values));
+    return response;
+}
+
+Response CommandHandler::handleBFExistsCommand(TransactionID tx_id, const Command& command) {
+    const bool multi = command.type == CommandType::BF_MEXISTS;
+    if (command.args.size() < 2 || (!multi && command.args.size() != 2)) {
+        return Response(ResponseStatus::ERROR, multi ? "BF.MEXISTS命令需要至少2个参数" : "BF.EXISTS命令需要2个参数");
+    }
+    std::vector<bool> results;
+    if (!storage_engine_->bfexists(tx_id, command.args[0], command.args.data() + 1, command.args.size() - 1, results)) {
+        return Response(ResponseStatus::ERROR, "键的类型不是布隆过滤器");
+    }
+    if (!multi) {
+        return Response(ResponseStatus::OK, "", results[0] ? "1" : "0");
+    }
+    std::vector<std::string> values;
+    values.reserve(results.size());
+    for (bool result : results) {
+        values.push_back(result ? "1" : "0");
+    }
+    Response response;
+    response.status = ResponseStatus::OK;
+    response.setArray(std::move(values));
+    return response;
+}
+
+Response CommandHandler::handleBFCardCommand(TransactionID tx_id, const Command& command) {
+    if (command.args.size() != 1) {
+        return Response(ResponseStatus::ERROR, "BF.CARD命令需要1个参数");
+    }
+    return Response(ResponseStatus::OK, "", std::to_string(storage_engine_->bfcard(tx_id, command.args[0])));
+}
+
 Response CommandHandler::handleEvalXCommand(TransactionID tx_id, const Command& command) {
     if (command.args.size() < 1) {
         return Response(ResponseStatus::ERROR, "EVALX命令需要至少1个参数: 脚本(base64 encoded)");
@@ -904,14 +1439,87 @@ Response CommandHandler::handleEvalXCommand(TransactionID tx_id, const Command&
     const std::string& script = Utils::base64Decode(script_base64);
 
     try {
-        dkv_script::DkvScript vm;
-        vm.setDkvCommandHandler([this, tx_id](const std::string& cmd_str) -> std::string {
+        // 相同的脚本只编译一次
+        return runScript(tx_id, *script_cache_.getOrCompile(script));
+    } catch (const std::exception& e) {
+        DKV_LOG_ERROR("Script error: {}", e.what());
+        return Response(ResponseStatus::ERROR, std::string("Script error: ") + e.what());
+    }
+}
+
+Response CommandHandler::handleEvalShaCommand(TransactionID tx_id, const Command& command) {
+    if (command.args.size() < 1) {
+        return Response(ResponseStatus::ERROR, "EVALSHA命令需要至少1个参数: 脚本的SHA1");
+    }
+    std::string sha1 = command.args[0];
+    std::transform(sha1.begin(), sha1.end(), sha1.begin(), ::tolower);
+    std::shared_ptr<const CompiledScript> script = script_cache_.find(sha1);
+    if (!script) {
+        return Response(ResponseStatus::ERROR, "NOSCRIPT No matching script. Please use SCRIPT LOAD.");
+    }
+    return runScript(tx_id, *script);
+}
+
+Response CommandHandler::handleScriptCommand(const Command& command) {
+    if (command.args.empty()) {
+        return Response(ResponseStatus::ERROR, "SCRIPT命令需要子命令: LOAD、EXISTS或FLUSH");
+    }
+    std::string subcommand = command.args[0];
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    if (subcommand == "LOAD") {
+        if (command.args.size() != 2) {
+            return Response(ResponseStatus::ERROR, "SCRIPT LOAD需要1个参数: 脚本(base64 encoded)");
+        }
+        try {
+            return Response(ResponseStatus::OK, "", script_cache_.load(Utils::base64Decode(command.args[1])));
+        } catch (const std::exception& e) {
+            return Response(ResponseStatus::ERROR, std::string("Script error: ") + e.what());
+        }
+    }
+    if (subcommand == "EXISTS") {
+        if (command.args.size() < 2) {
+            return Response(ResponseStatus::ERROR, "SCRIPT EXISTS需要至少1个参数");
+        }
+        std::vector<std::string> result;
+        result.reserve(command.args.size() - 1);
+        for (size_t i = 1; i < command.args.size(); ++i) {
+            std::string sha1 = command.args[i];
+            std::transform(sha1.begin(), sha1.end(), sha1.begin(), ::tolower);
+            result.push_back(script_cache_.exists(sha1) ? "1" : "0");
+        }
+        Response response;
+        response.status = ResponseStatus::OK;
+        response.setArray(std::move(result));
+        return response;
+    }
+    if (subcommand == "FLUSH") {
+        script_cache_.flush();
+        return Response(ResponseStatus::OK, "OK");
+    }
+    return Response(ResponseStatus::ERROR, "未知的SCRIPT子命令: " + command.args[0]);
+}
+
+Response CommandHandler::runScript(TransactionID tx_id, const CompiledScript& script) {
+    try {
+        auto keyspace_lock = storage_engine_->lockKeyspace();
+        script.run([this, tx_id](const std::string& cmd_str) -> std::string {
             if (!script_command_executor_) {
                 return "(error) ERR script command callback not set";
             }
-            return script_command_executor_(cmd_str, tx_id);
+            // VM只能以文本传递命令和结果，这里直接切分参数构造命令，结果也只在交回VM时转换一次
+            Command cmd = RESPProtocol::parseInlineCommand(cmd_str);
+            if (cmd.type == CommandType::UNKNOWN) {
+                return "(error) ERR unknown command";
+            }
+            if (commandNotAllowedInScript(cmd.type)) {
+                return "(error) ERR command not allowed from script";
+            }
+            Response resp = script_command_executor_(cmd, tx_id);
+            if (resp.is_array) {
+                return RESPProtocol::serializeArray(resp.elements);
+            }
+            return resp.message.empty() ? resp.data : resp.message;
         });
-        vm.execute(script);
         return Response(ResponseStatus::OK, "", "OK");
     } catch (const std::exception& e) {
         DKV_LOG_ERROR("Script error: {}", e.what());
@@ -938,9 +1546,173 @@ Response CommandHandler::handleRestoreHLLCommand(const Command& command, bool& n
     return Response(ResponseStatus::OK);
 }
 
+// 分片迁移：把源分片发来的一批键值对写入存储引擎，已存在的键被覆盖
+Response CommandHandler::handleRestoreBatchCommand(const Command& command, bool& need_inc_dirty) {
+    if (command.args.size() != 1) {
+        return Response(ResponseStatus::ERROR, "RESTORE_BATCH命令需要1个参数");
+    }
+    if (!RDBPersistence::loadFromMemory(storage_engine_, command.args[0], "migration batch")) {
+        return Response(ResponseStatus::ERROR, "RESTORE_BATCH数据损坏");
+    }
+    need_inc_dirty = true;
+    return Response(ResponseStatus::OK, "OK");
+}
+
+// 游标遍历命令处理
+bool CommandHandler::parseScanOptions(const Command& command, size_t cursor_index, ScanOptions& options, Response& error) {
+    const std::string& cursor = command.args[cursor_index];
+    if (cursor.empty() || !std::all_of(cursor.begin(), cursor.end(), ::isdigit)) {
+        error = Response(ResponseStatus::ERROR, "无效的游标");
+        return false;
+    }
+    try {
+        options.cursor = std::stoull(cursor);
+    } catch (const std::out_of_range&) {
+        error = Response(ResponseStatus::ERROR, "无效的游标");
+        return false;
+    }
+    for (size_t i = cursor_index + 1; i < command.args.size(); i += 2) {
+        if (i + 1 >= command.args.size()) {
+            error = Response(ResponseStatus::ERROR, "语法错误");
+            return false;
+        }
+        std::string option = command.args[i];
+        std::transform(option.begin(), option.end(), option.begin(), ::toupper);
+        const std::string& value = command.args[i + 1];
+        if (option == "MATCH") {
+            // 匹配所有键的模式等同于不过滤
+            options.pattern = value == "*" ? "" : value;
+        } else if (option == "COUNT") {
+            if (value.empty() || !std::all_of(value.begin(), value.end(), ::isdigit)) {
+                error = Response(ResponseStatus::ERROR, "COUNT参数必须为正整数");
+                return false;
+            }
+            try {
+                options.count = std::stoull(value);
+            } catch (const std::out_of_range&) {
+                options.count = 0;
+            }
+            if (options.count == 0) {
+                error = Response(ResponseStatus::ERROR, "COUNT参数必须为正整数");
+                return false;
+            }
+        } else {
+            error = Response(ResponseStatus::ERROR, "语法错误");
+            return false;
+        }
+    }
+    return true;
+}
+
+Response CommandHandler::scanReply(size_t cursor, std::vector<std::string>&& items) {
+    Response response;
+    response.status = ResponseStatus::OK;
+    response.setArray({std::to_string(cursor), RESPProtocol::serializeArray(items)});
+    return response;
+}
+
+Response CommandHandler::handleScanCommand(const Command& command) {
+    if (command.args.empty()) {
+        return Response(ResponseStatus::ERROR, "SCAN命令需要至少1个参数");
+    }
+    ScanOptions options;
+    Response error;
+    if (!parseScanOptions(command, 0, options, error)) {
+        return error;
+    }
+    std::vector<std::string> keys;
+    size_t cursor = storage_engine_->scan(options.cursor, options.count, [&](const SharedKey& key, const DataItem&) {
+        // 模式在持锁期间过滤，只复制匹配的键
+        if (options.pattern.empty() || Utils::matchPattern(options.pattern, key)) {
+            keys.push_back(key.str());
+        }
+    });
+    return scanReply(cursor, std::move(keys));
+}
+
+Response CommandHandler::handleHScanCommand(TransactionID tx_id, const Command& command) {
+    if (command.args.size() < 2) {
+        return Response(ResponseStatus::ERROR, "HSCAN命令需要至少2个参数");
+    }
+    ScanOptions options;
+    Response error;
+    if (!parseScanOptions(command, 1, options, error)) {
+        return error;
+    }
+    std::vector<std::pair<Value, Value>> fields;
+    size_t cursor = storage_engine_->hscan(tx_id, command.args[0], options.cursor, options.count, fields);
+    // 字段和值依次排列
+    std::vector<std::string> items;
+    items.reserve(fields.size() * 2);
+    for (auto& pair : fields) {
+        if (options.pattern.empty() || Utils::matchPattern(options.pattern, pair.first)) {
+            items.push_back(std::move(pair.first));
+            items.push_back(std::move(pair.second));
+        }
+    }
+    return scanReply(cursor, std::move(items));
+}
+
+Response CommandHandler::handleSScanCommand(TransactionID tx_id, const Command& command) {
+    if (command.args.size() < 2) {
+        return Response(ResponseStatus::ERROR, "SSCAN命令需要至少2个参数");
+    }
+    ScanOptions options;
+    Response error;
+    if (!parseScanOptions(command, 1, options, error)) {
+        return error;
+    }
+    std::vector<Value> members;
+    size_t cursor = storage_engine_->sscan(tx_id, command.args[0], options.cursor, options.count, members);
+    if (!options.pattern.empty()) {
+        members.erase(std::remove_if(members.begin(), members.end(), [&](const Value& member) {
+            return !Utils::matchPattern(options.pattern, member);
+        }), members.end());
+    }
+    return scanReply(cursor, std::move(members));
+}
+
+Response CommandHandler::handleZScanCommand(TransactionID tx_id, const Command& command) {
+    if (command.args.size() < 2) {
+        return Response(ResponseStatus::ERROR, "ZSCAN命令需要至少2个参数");
+    }
+    ScanOptions options;
+    Response error;
+    if (!parseScanOptions(command, 1, options, error)) {
+        return error;
+    }
+    std::vector<std::pair<Value, double>> members;
+    size_t cursor = storage_engine_->zscan(tx_id, command.args[0], options.cursor, options.count, members);
+    // 成员和分数依次排列
+    std::vector<std::string> items;
+    items.reserve(members.size() * 2);
+    for (auto& pair : members) {
+        if (options.pattern.empty() || Utils::matchPattern(options.pattern, pair.first)) {
+            items.push_back(std::move(pair.first));
+            items.push_back(std::to_string(pair.second));
+        }
+    }
+    return scanReply(cursor, std::move(items));
+}
+
 // 服务器管理命令处理
-Response CommandHandler::handleFlushDBCommand(bool& need_inc_dirty) {
-    storage_engine_->flush();
+Response CommandHandler::handleFlushDBCommand(const Command& command, bool& need_inc_dirty) {
+    bool async = storage_engine_->getLazyFreeConfig().lazy_user_flush;
+    if (command.args.size() > 1) {
+        return Response(ResponseStatus::ERROR, "syntax error");
+    }
+    if (!command.args.empty()) {
+        std::string mode = command.args[0];
+        std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+        if (mode == "ASYNC") {
+            async = true;
+        } else if (mode == "SYNC") {
+            async = false;
+        } else {
+            return Response(ResponseStatus::ERROR, "syntax error");
+        }
+    }
+    storage_engine_->flush(async);
     need_inc_dirty = true;
     return Response(ResponseStatus::OK, "OK");
 }
@@ -959,9 +1731,103 @@ Response CommandHandler::handleInfoCommand(size_t key_count, size_t expired_keys
     info += "version:1.0.0\r\n";
     info += "used_memory:" + std::to_string(memory_usage) + "\r\n";
     info += "max_memory:" + std::to_string(max_memory) + "\r\n";
+
+    // 大页与NUMA分区
+    PageMemoryStats pages = PageMemory::stats();
+    info += std::string("mem_huge_pages:") + PageMemory::hugePageModeName(PageMemory::hugePageMode()) + "\r\n";
+    info += std::string("mem_numa_arenas:") + (PageMemory::numaArenas() ? "yes" : "no") + "\r\n";
+    info += "mem_numa_nodes:" + std::to_string(PageMemory::nodeCount()) + "\r\n";
+    info += "mem_mapped_bytes:" + std::to_string(pages.mapped_bytes) + "\r\n";
+    info += "mem_huge_page_bytes:" + std::to_string(pages.huge_page_bytes) + "\r\n";
+    info += "mem_hugetlb_fallbacks:" + std::to_string(pages.hugetlb_fallbacks) + "\r\n";
+    info += "slab_reserved_bytes:" + std::to_string(SlabAllocator::getInstance().getReservedBytes()) + "\r\n";
+    info += "slab_used_bytes:" + std::to_string(SlabAllocator::getInstance().getUsedBytes()) + "\r\n";
+    char fragmentation[16];
+    snprintf(fragmentation, sizeof(fragmentation), "%.2f", SlabAllocator::getInstance().getFragmentationRatio());
+    info += std::string("slab_fragmentation_ratio:") + fragmentation + "\r\n";
+    DefragStats defrag = storage_engine_->getDefragStats();
+    info += "active_defrag_relocated:" + std::to_string(defrag.relocated) + "\r\n";
+    info += "active_defrag_skipped:" + std::to_string(defrag.skipped) + "\r\n";
+    info += "active_defrag_passes:" + std::to_string(defrag.passes) + "\r\n";
+    if (PageMemory::numaArenas()) {
+        for (size_t node = 0; node < pages.node_bytes.size(); ++node) {
+            info += "mem_node" + std::to_string(node) + "_bytes:" + std::to_string(pages.node_bytes[node]) + "\r\n";
+        }
+    }
+
+    // 脚本编译缓存
+    ScriptCacheStats scripts = script_cache_.stats();
+    const uint64_t lookups = scripts.hits + scripts.misses;
+    char hit_rate[16];
+    snprintf(hit_rate, sizeof(hit_rate), "%.2f", lookups ? 100.0 * scripts.hits / lookups : 0.0);
+    info += "script_cache_scripts:" + std::to_string(scripts.scripts) + "\r\n";
+    info += "script_cache_capacity:" + std::to_string(scripts.capacity) + "\r\n";
+    info += "script_cache_hits:" + std::to_string(scripts.hits) + "\r\n";
+    info += "script_cache_misses:" + std::to_string(scripts.misses) + "\r\n";
+    info += "script_cache_evictions:" + std::to_string(scripts.evictions) + "\r\n";
+    info += std::string("script_cache_hit_rate:") + hit_rate + "\r\n";
+
+    // 键空间分段与渐进式rehash进度
+    KeyspaceStats keyspace = storage_engine_->getKeyspaceStats();
+    info += "keyspace_segments:" + std::to_string(keyspace.segments) + "\r\n";
+    info += "keyspace_capacity:" + std::to_string(keyspace.capacity) + "\r\n";
+    info += "keyspace_rehashing_segments:" + std::to_string(keyspace.rehashing_segments) + "\r\n";
+    info += "keyspace_rehash_pending_slots:" + std::to_string(keyspace.rehash_pending_slots) + "\r\n";
+    info += "keyspace_volatile_keys:" + std::to_string(keyspace.volatile_keys) + "\r\n";
+
+    // 后台释放进度
+    const LazyFreer& freer = storage_engine_->lazyFreer();
+    info += "lazyfree_pending_objects:" + std::to_string(freer.pendingObjects()) + "\r\n";
+    info += "lazyfreed_objects:" + std::to_string(freer.freedObjects()) + "\r\n";
+
+    // 分层存储
+    if (storage_engine_->tieredEnabled()) {
+        TieredStats tier = storage_engine_->getTieredStats();
+        info += "tiered_spilled_keys:" + std::to_string(tier.spilled_keys) + "\r\n";
+        info += "tiered_live_bytes:" + std::to_string(tier.live_bytes) + "\r\n";
+        info += "tiered_log_bytes:" + std::to_string(tier.log_bytes) + "\r\n";
+        info += "tiered_spills:" + std::to_string(tier.spills) + "\r\n";
+        info += "tiered_loads:" + std::to_string(tier.loads) + "\r\n";
+        info += "tiered_async_loads:" + std::to_string(tier.async_loads) + "\r\n";
+        info += "tiered_load_errors:" + std::to_string(tier.load_errors) + "\r\n";
+    }
+
+    // MVCC历史版本链长度与回收进度
+    MVCCStats mvcc = storage_engine_->getMVCCStats();
+    info += "mvcc_purged_versions:" + std::to_string(mvcc.purged_versions) + "\r\n";
+    info += "mvcc_purge_passes:" + std::to_string(mvcc.purge_passes) + "\r\n";
+    info += "mvcc_versioned_keys:" + std::to_string(mvcc.versioned_keys) + "\r\n";
+    info += "mvcc_history_versions:" + std::to_string(mvcc.history_versions) + "\r\n";
+    info += "mvcc_max_chain_length:" + std::to_string(mvcc.max_chain_length) + "\r\n";
+    info += "mvcc_purge_horizon:" + std::to_string(mvcc.purge_horizon) + "\r\n";
+    info += "mvcc_purge_lag:" + std::to_string(mvcc.purge_lag) + "\r\n";
+    info += "mvcc_pending_rollbacks:" + std::to_string(mvcc.pending_rollbacks) + "\r\n";
+    
+    // RDB快照进度
+    RDBSaveStats rdb = storage_engine_->getRDBSaveStats();
+    info += "rdb_bgsave_in_progress:" + std::to_string(rdb.in_progress ? 1 : 0) + "\r\n";
+    info += "rdb_saved_keys:" + std::to_string(rdb.saved_keys) + "\r\n";
+    info += "rdb_snapshot_keys:" + std::to_string(rdb.snapshot_keys) + "\r\n";
+    info += std::string("rdb_last_bgsave_status:") + (rdb.last_status_ok ? "ok" : "err") + "\r\n";
+    info += "rdb_last_save_time:" + std::to_string(rdb.last_save_time) + "\r\n";
+    info += "rdb_last_bgsave_time_ms:" + std::to_string(rdb.last_duration_ms) + "\r\n";
+
+    // RDB后台加载进度
+    RDBLoadStats load = storage_engine_->getRDBLoadStats();
+    info += "loading:" + std::to_string(load.loading ? 1 : 0) + "\r\n";
+    info += "loading_total_keys:" + std::to_string(load.total_keys) + "\r\n";
+    info += "loading_loaded_keys:" + std::to_string(load.loaded_keys) + "\r\n";
+    info += "loading_loaded_perc:" +
+            std::to_string(load.total_keys == 0 ? 100 : load.loaded_keys * 100 / load.total_keys) + "\r\n";
+    info += "loading_total_chunks:" + std::to_string(load.total_chunks) + "\r\n";
+    info += "loading_loaded_chunks:" + std::to_string(load.loaded_chunks) + "\r\n";
+    info += "loading_demand_chunks:" + std::to_string(load.demand_chunks) + "\r\n";
+    info += "loading_failed_chunks:" + std::to_string(load.failed_chunks) + "\r\n";
+    info += "loading_elapsed_ms:" + std::to_string(load.elapsed_ms) + "\r\n";
     
     // 详细内存统计信息，按行分割并添加到响应中
     std::string memory_stats = dkv::MemoryAllocator::getInstance().getStats();
+    memory_stats += dkv::SlabAllocator::getInstance().getStats();
     std::istringstream stats_stream(memory_stats);
     std::string line;
     while (std::getline(stats_stream, line)) {
@@ -995,16 +1861,10 @@ Response CommandHandler::handleSaveCommand(const std::string& rdb_filename) {
 }
 
 Response CommandHandler::handleBgSaveCommand(const std::string& rdb_filename) {
-    // 异步保存数据到RDB文件
-    std::thread save_thread([this, rdb_filename]() {
-        bool success = storage_engine_->saveRDB(rdb_filename);
-        if (success) {
-            DKV_LOG_INFO("异步RDB保存成功");
-        } else {
-            DKV_LOG_ERROR("异步RDB保存失败");
-        }
-    });
-    save_thread.detach();
+    // 异步保存数据到RDB文件，同一时刻只允许一个快照
+    if (!storage_engine_->saveRDBInBackground(rdb_filename)) {
+        return Response(ResponseStatus::ERROR, "Background save already in progress");
+    }
     return Response(ResponseStatus::OK, "Background saving started");
 }
 
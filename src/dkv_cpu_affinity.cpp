@@ -0,0 +1,170 @@
+#include "dkv_cpu_affinity.hpp"
+#include "dkv_logger.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace dkv {
+
+bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    std::vector<int> result;
+    std::stringstream ss(text);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        try {
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            if (first < 0 || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                result.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    cpus = std::move(result);
+    return true;
+}
+
+std::vector<std::vector<int>> numaNodeCpus() {
+    std::vector<std::vector<int>> nodes;
+    // 节点编号可能不连续，依次尝试直到连续多个节点不存在
+    for (int node = 0, missing = 0; missing < 8; ++node) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string line;
+        if (!file.is_open() || !std::getline(file, line)) {
+            missing++;
+            continue;
+        }
+        missing = 0;
+        std::vector<int> cpus;
+        if (parseCpuList(line, cpus) && !cpus.empty()) {
+            nodes.push_back(std::move(cpus));
+        }
+    }
+    if (nodes.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        std::vector<int> cpus;
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        nodes.push_back(std::move(cpus));
+    }
+    return nodes;
+}
+
+CpuPlacement planCpuPlacement(const CpuAffinityConfig& config, size_t num_reactors,
+                              const std::vector<size_t>& worker_groups,
+                              const std::vector<std::vector<int>>& nodes) {
+    CpuPlacement placement;
+    placement.reactors.resize(num_reactors);
+    placement.workers.resize(worker_groups.size());
+    bool numa = config.numa_aware && !nodes.empty();
+
+    auto nodeOf = [&](int cpu) -> size_t {
+        for (size_t n = 0; n < nodes.size(); ++n) {
+            if (std::find(nodes[n].begin(), nodes[n].end(), cpu) != nodes[n].end()) {
+                return n;
+            }
+        }
+        return 0;
+    };
+
+    // SubReactor：指定了CPU时每个绑定一个，否则NUMA模式下轮流绑定到各节点
+    std::vector<size_t> reactor_nodes(num_reactors, 0);
+    for (size_t i = 0; i < num_reactors; ++i) {
+        if (!config.reactor_cpus.empty()) {
+            int cpu = config.reactor_cpus[i % config.reactor_cpus.size()];
+            placement.reactors[i] = {cpu};
+            if (numa) {
+                reactor_nodes[i] = nodeOf(cpu);
+            }
+        } else if (numa) {
+            reactor_nodes[i] = i % nodes.size();
+            placement.reactors[i] = nodes[reactor_nodes[i]];
+        }
+    }
+
+    // 工作线程：依次各绑定一个CPU，NUMA模式下优先使用所服务SubReactor所在节点的CPU
+    std::vector<int> available = config.worker_cpus;
+    if (available.empty() && numa) {
+        for (const auto& node : nodes) {
+            available.insert(available.end(), node.begin(), node.end());
+        }
+    }
+    if (available.empty()) {
+        return placement;
+    }
+    std::vector<std::vector<int>> local(nodes.size());
+    if (numa) {
+        for (int cpu : available) {
+            local[nodeOf(cpu)].push_back(cpu);
+        }
+    }
+    std::vector<size_t> next_local(nodes.size(), 0);
+    size_t next_any = 0;
+    for (size_t w = 0; w < worker_groups.size(); ++w) {
+        if (numa && num_reactors > 0) {
+            size_t node = reactor_nodes[worker_groups[w] % num_reactors];
+            if (!local[node].empty()) {
+                placement.workers[w] = {local[node][next_local[node]++ % local[node].size()]};
+                continue;
+            }
+        }
+        placement.workers[w] = {available[next_any++ % available.size()]};
+    }
+    return placement;
+}
+
+bool pinThread(std::thread& thread, const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    int err = pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+    if (err != 0) {
+        DKV_LOG_WARNING("绑定CPU失败: ", strerror(err));
+        return false;
+    }
+    return true;
+}
+
+bool setCurrentThreadNice(int increment) {
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    errno = 0;
+    int current = getpriority(PRIO_PROCESS, tid);
+    if (current == -1 && errno != 0) {
+        return false;
+    }
+    if (setpriority(PRIO_PROCESS, tid, current + increment) != 0) {
+        DKV_LOG_WARNING("调整线程优先级失败: ", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+} // namespace dkv
@@ -0,0 +1,289 @@
+#include "dkv_latency.hpp"
+#include "dkv_utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+namespace dkv {
+
+namespace {
+
+std::string lowerName(CommandType type) {
+    std::string name = Utils::commandTypeToString(type);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    return name;
+}
+
+std::string formatDouble(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.2f", value);
+    return buf;
+}
+
+// p50/p99/p99.9三个分位数
+std::string percentilesLine(const HdrHistogram& histogram) {
+    return "p50=" + std::to_string(histogram.percentile(50.0)) +
+           ",p99=" + std::to_string(histogram.percentile(99.0)) +
+           ",p99.9=" + std::to_string(histogram.percentile(99.9));
+}
+
+const char* stageName(size_t stage) {
+    static const char* NAMES[] = {"parse", "queue", "execute", "write"};
+    return NAMES[stage];
+}
+
+} // namespace
+
+void HdrHistogram::record(uint64_t usec) {
+    buckets_[bucketIndex(usec)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(usec, std::memory_order_relaxed);
+    uint64_t current = max_.load(std::memory_order_relaxed);
+    while (usec > current && !max_.compare_exchange_weak(current, usec, std::memory_order_relaxed)) {
+    }
+}
+
+void HdrHistogram::merge(const HdrHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        uint64_t count = other.buckets_[i].load(std::memory_order_relaxed);
+        if (count != 0) {
+            buckets_[i].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    count_.fetch_add(other.count(), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum(), std::memory_order_relaxed);
+    uint64_t other_max = other.max();
+    uint64_t current = max_.load(std::memory_order_relaxed);
+    while (other_max > current && !max_.compare_exchange_weak(current, other_max, std::memory_order_relaxed)) {
+    }
+}
+
+void HdrHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t HdrHistogram::percentile(double percentile) const {
+    // 以各桶计数之和为准，并发记录时count_可能与桶计数不一致
+    std::array<uint64_t, BUCKETS> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(std::ceil(static_cast<double>(total) * percentile / 100.0));
+    target = std::max<uint64_t>(1, std::min(target, total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= target) {
+            // 桶上界可能大于实际的最大记录值
+            return std::min(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> HdrHistogram::cumulativePowersOfTwo() const {
+    std::array<uint64_t, BUCKETS> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> result;
+    if (total == 0) {
+        return result;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i + 1 < BUCKETS; ++i) {
+        seen += counts[i];
+        // 下一个桶从2的幂开始时，前面的桶恰好是小于这个2的幂的全部值
+        uint64_t next = bucketUpperBound(i) + 1;
+        if ((next & (next - 1)) == 0) {
+            result.emplace_back(next, seen);
+            if (seen == total) {
+                break;
+            }
+        }
+    }
+    seen += counts[BUCKETS - 1];
+    if (result.back().second != seen) {
+        // 最后一个桶没有上界
+        result.emplace_back(UINT64_MAX, seen);
+    }
+    return result;
+}
+
+size_t HdrHistogram::bucketIndex(uint64_t usec) {
+    if (usec < SUB_BUCKETS) {
+        return static_cast<size_t>(usec);
+    }
+    unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(usec));
+    unsigned shift = msb - SUB_BUCKET_BITS;
+    size_t top = static_cast<size_t>(usec >> shift); // [SUB_BUCKETS, 2*SUB_BUCKETS)
+    size_t index = (shift + 1) * SUB_BUCKETS + (top - SUB_BUCKETS);
+    return std::min(index, BUCKETS - 1);
+}
+
+uint64_t HdrHistogram::bucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    if (index >= BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS - 1);
+    uint64_t top = SUB_BUCKETS + index % SUB_BUCKETS;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyMonitor::recordStage(LatencyStage stage, uint64_t usec) {
+    stages_[static_cast<size_t>(stage)].record(usec);
+}
+
+void LatencyMonitor::recordCommand(const Command& command, uint64_t usec) {
+    int type = static_cast<int>(command.type);
+    if (type >= 0 && static_cast<size_t>(type) < COMMAND_TYPES) {
+        commands_[static_cast<size_t>(type)].record(usec);
+    }
+    stages_[static_cast<size_t>(LatencyStage::EXECUTE)].record(usec);
+
+    int64_t threshold = slowlog_threshold_us_.load(std::memory_order_relaxed);
+    if (threshold < 0 || usec < static_cast<uint64_t>(threshold)) {
+        return;
+    }
+    SlowLogEntry entry;
+    entry.timestamp = static_cast<int64_t>(std::time(nullptr)) - static_cast<int64_t>(usec / 1000000);
+    entry.duration_us = usec;
+    entry.args.push_back(Utils::commandTypeToString(command.type));
+    size_t kept = std::min(command.args.size(), SLOWLOG_MAX_ARGS - 1);
+    for (size_t i = 0; i < kept; ++i) {
+        const std::string& arg = command.args[i];
+        if (arg.size() > SLOWLOG_MAX_ARG_LEN) {
+            entry.args.push_back(arg.substr(0, SLOWLOG_MAX_ARG_LEN) + "... (" +
+                                 std::to_string(arg.size() - SLOWLOG_MAX_ARG_LEN) + " more bytes)");
+        } else {
+            entry.args.push_back(arg);
+        }
+    }
+    if (kept < command.args.size()) {
+        entry.args.back() = "... (" + std::to_string(command.args.size() - kept + 1) + " more arguments)";
+    }
+
+    std::lock_guard<std::mutex> lock(slowlog_mutex_);
+    if (slowlog_max_len_ == 0) {
+        return;
+    }
+    entry.id = next_slowlog_id_++;
+    slowlog_.push_front(std::move(entry));
+    while (slowlog_.size() > slowlog_max_len_) {
+        slowlog_.pop_back();
+    }
+}
+
+const HdrHistogram& LatencyMonitor::command(CommandType type) const {
+    int index = static_cast<int>(type);
+    if (index < 0 || static_cast<size_t>(index) >= COMMAND_TYPES) {
+        // UNKNOWN等不统计的类型返回一个始终为空的直方图
+        static const HdrHistogram EMPTY;
+        return EMPTY;
+    }
+    return commands_[static_cast<size_t>(index)];
+}
+
+void LatencyMonitor::resetStats() {
+    for (auto& histogram : commands_) {
+        histogram.reset();
+    }
+    for (auto& histogram : stages_) {
+        histogram.reset();
+    }
+}
+
+void LatencyMonitor::setSlowLogMaxLen(size_t max_len) {
+    std::lock_guard<std::mutex> lock(slowlog_mutex_);
+    slowlog_max_len_ = max_len;
+    while (slowlog_.size() > slowlog_max_len_) {
+        slowlog_.pop_back();
+    }
+}
+
+std::vector<SlowLogEntry> LatencyMonitor::slowLog(size_t count) const {
+    std::lock_guard<std::mutex> lock(slowlog_mutex_);
+    count = std::min(count, slowlog_.size());
+    return std::vector<SlowLogEntry>(slowlog_.begin(), slowlog_.begin() + static_cast<std::ptrdiff_t>(count));
+}
+
+size_t LatencyMonitor::slowLogLen() const {
+    std::lock_guard<std::mutex> lock(slowlog_mutex_);
+    return slowlog_.size();
+}
+
+void LatencyMonitor::resetSlowLog() {
+    std::lock_guard<std::mutex> lock(slowlog_mutex_);
+    slowlog_.clear();
+}
+
+std::string LatencyMonitor::commandStatsInfo() const {
+    std::string info;
+    for (size_t i = 0; i < COMMAND_TYPES; ++i) {
+        const HdrHistogram& histogram = commands_[i];
+        uint64_t calls = histogram.count();
+        if (calls == 0) {
+            continue;
+        }
+        std::string name = lowerName(static_cast<CommandType>(i));
+        uint64_t usec = histogram.sum();
+        info += "cmdstat_" + name + ":calls=" + std::to_string(calls) + ",usec=" + std::to_string(usec) +
+                ",usec_per_call=" + formatDouble(static_cast<double>(usec) / static_cast<double>(calls)) + "\r\n";
+        info += "latency_percentiles_usec_" + name + ":" + percentilesLine(histogram) + "\r\n";
+    }
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        const HdrHistogram& histogram = stages_[i];
+        info += std::string("latency_stage_") + stageName(i) + ":calls=" + std::to_string(histogram.count()) +
+                ",usec=" + std::to_string(histogram.sum()) + "," + percentilesLine(histogram) +
+                ",max=" + std::to_string(histogram.max()) + "\r\n";
+    }
+    return info;
+}
+
+std::vector<std::string> LatencyMonitor::histogramReply(const std::vector<CommandType>& types) const {
+    std::vector<CommandType> selected = types;
+    if (selected.empty()) {
+        for (size_t i = 0; i < COMMAND_TYPES; ++i) {
+            if (commands_[i].count() > 0) {
+                selected.push_back(static_cast<CommandType>(i));
+            }
+        }
+    }
+    std::vector<std::string> reply;
+    for (CommandType type : selected) {
+        const HdrHistogram& histogram = command(type);
+        if (histogram.count() == 0) {
+            continue;
+        }
+        std::string line = lowerName(type) + " calls=" + std::to_string(histogram.count()) + " histogram_usec=";
+        bool first = true;
+        for (const auto& point : histogram.cumulativePowersOfTwo()) {
+            if (!first) {
+                line += ",";
+            }
+            first = false;
+            line += (point.first == UINT64_MAX ? std::string("inf") : std::to_string(point.first)) + ":" +
+                    std::to_string(point.second);
+        }
+        reply.push_back(std::move(line));
+    }
+    return reply;
+}
+
+} // namespace dkv
@@ -0,0 +1,714 @@
+#include "dkv_load_generator.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace dkv {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 集合、哈希、有序集合和HyperLogLog中成员的取值个数，键的大小随之有上限
+constexpr uint64_t MEMBER_COUNT = 1000;
+// 预写入时每批发送的命令数
+constexpr size_t PRELOAD_BATCH = 1000;
+// 嵌套数组的最大深度
+constexpr int MAX_REPLY_DEPTH = 32;
+
+// 支持的命令：名称、键的类型前缀和参数形式
+enum class ArgForm {
+    KEY,              // CMD key
+    KEY_VALUE,        // CMD key value
+    KEY_MEMBER,       // CMD key member
+    KEY_FIELD_VALUE,  // CMD key field value
+    KEY_SCORE_MEMBER  // CMD key score member
+};
+
+struct LoadCommandSpec {
+    const char* name;
+    const char* command;
+    const char* type;
+    ArgForm form;
+};
+
+const LoadCommandSpec LOAD_COMMAND_SPECS[] = {
+    {"get", "GET", "string", ArgForm::KEY},
+    {"set", "SET", "string", ArgForm::KEY_VALUE},
+    {"incr", "INCR", "counter", ArgForm::KEY},
+    {"lpush", "LPUSH", "list", ArgForm::KEY_VALUE},
+    {"rpush", "RPUSH", "list", ArgForm::KEY_VALUE},
+    {"lpop", "LPOP", "list", ArgForm::KEY},
+    {"rpop", "RPOP", "list", ArgForm::KEY},
+    {"sadd", "SADD", "set", ArgForm::KEY_MEMBER},
+    {"hset", "HSET", "hash", ArgForm::KEY_FIELD_VALUE},
+    {"hget", "HGET", "hash", ArgForm::KEY_MEMBER},
+    {"zadd", "ZADD", "zset", ArgForm::KEY_SCORE_MEMBER},
+    {"pfadd", "PFADD", "hll", ArgForm::KEY_MEMBER},
+};
+
+const LoadCommandSpec* findSpec(const std::string& name) {
+    for (const auto& spec : LOAD_COMMAND_SPECS) {
+        if (name == spec.name) {
+            return &spec;
+        }
+    }
+    return nullptr;
+}
+
+// 按ascii小写比较，命令组合中的名称不区分大小写
+std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+uint64_t fnv1a(uint64_t value) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+double zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; ++i) {
+        sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+}
+
+void appendArg(std::string& out, std::string_view arg) {
+    out.push_back('$');
+    out.append(std::to_string(arg.size()));
+    out.append("\r\n");
+    out.append(arg);
+    out.append("\r\n");
+}
+
+void appendHeader(std::string& out, size_t args) {
+    out.push_back('*');
+    out.append(std::to_string(args));
+    out.append("\r\n");
+}
+
+std::string keyName(const std::string& prefix, const LoadCommandSpec& spec, uint64_t index) {
+    return prefix + spec.type + ":" + std::to_string(index);
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool parseLength(std::string_view text, int64_t& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+LoadGenerator::ReplyStatus parseValue(std::string_view data, size_t& pos, bool& is_error, int depth) {
+    using ReplyStatus = LoadGenerator::ReplyStatus;
+    if (depth > MAX_REPLY_DEPTH) {
+        return ReplyStatus::INVALID;
+    }
+    size_t crlf = data.find("\r\n", pos);
+    if (crlf == std::string_view::npos) {
+        return ReplyStatus::INCOMPLETE;
+    }
+    char type = data[pos];
+    std::string_view line = data.substr(pos + 1, crlf - pos - 1);
+    size_t next = crlf + 2;
+    int64_t length = 0;
+    switch (type) {
+    case '-':
+        is_error = true;
+        [[fallthrough]];
+    case '+':
+    case ':':
+    case ',':
+    case '#':
+    case '_':
+    case '(':
+        pos = next;
+        return ReplyStatus::COMPLETE;
+    case '!':
+        is_error = true;
+        [[fallthrough]];
+    case '$':
+    case '=':
+        if (!parseLength(line, length)) {
+            return ReplyStatus::INVALID;
+        }
+        if (length >= 0) {
+            if (data.size() < next + static_cast<size_t>(length) + 2) {
+                return ReplyStatus::INCOMPLETE;
+            }
+            next += static_cast<size_t>(length) + 2;
+        }
+        pos = next;
+        return ReplyStatus::COMPLETE;
+    case '*':
+    case '~':
+    case '%':
+    case '>': {
+        if (!parseLength(line, length)) {
+            return ReplyStatus::INVALID;
+        }
+        int64_t elements = type == '%' ? length * 2 : length;
+        for (int64_t i = 0; i < elements; ++i) {
+            ReplyStatus status = parseValue(data, next, is_error, depth + 1);
+            if (status != ReplyStatus::COMPLETE) {
+                return status;
+            }
+        }
+        pos = next;
+        return ReplyStatus::COMPLETE;
+    }
+    default:
+        return ReplyStatus::INVALID;
+    }
+}
+
+std::string formatMs(uint64_t usec) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.3f", usec / 1000.0);
+    return buf;
+}
+
+} // namespace
+
+KeyGenerator::KeyGenerator(uint64_t keyspace, KeyDistribution distribution, double theta, uint64_t seed)
+    : keyspace_(std::max<uint64_t>(1, keyspace)), distribution_(distribution), rng_(seed), theta_(theta) {
+    if (distribution_ == KeyDistribution::ZIPFIAN) {
+        zetan_ = zeta(keyspace_, theta_);
+        alpha_ = 1.0 / (1.0 - theta_);
+        half_pow_theta_ = 1.0 + std::pow(0.5, theta_);
+        double zeta2 = zeta(2, theta_);
+        eta_ = (1.0 - std::pow(2.0 / keyspace_, 1.0 - theta_)) / (1.0 - zeta2 / zetan_);
+    }
+}
+
+uint64_t KeyGenerator::next() {
+    if (distribution_ == KeyDistribution::UNIFORM) {
+        return rng_() % keyspace_;
+    }
+    return fnv1a(nextZipfRank()) % keyspace_;
+}
+
+uint64_t KeyGenerator::nextZipfRank() {
+    double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
+    double uz = u * zetan_;
+    if (uz < 1.0) {
+        return 0;
+    }
+    if (uz < half_pow_theta_) {
+        return 1;
+    }
+    uint64_t rank = static_cast<uint64_t>(keyspace_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return std::min(rank, keyspace_ - 1);
+}
+
+std::string LoadReport::format(const LoadConfig& config) const {
+    std::ostringstream out;
+    char line[256];
+    out << "====== dkv-benchmark ======\n";
+    out << "  目标: " << config.host << ":" << config.port << "\n";
+    out << "  连接: " << config.connections << "（线程 " << config.threads << "），流水线深度: " << config.pipeline << "\n";
+    out << "  键空间: " << config.keyspace;
+    if (config.distribution == KeyDistribution::ZIPFIAN) {
+        out << "（zipfian, theta=" << config.zipf_theta << "）";
+    } else {
+        out << "（uniform）";
+    }
+    out << "，值大小: " << config.value_size;
+    if (config.value_size_max > config.value_size) {
+        out << "-" << config.value_size_max;
+    }
+    out << "字节\n";
+    std::snprintf(line, sizeof(line), "  请求: %llu，错误: %llu，断开的连接: %llu，耗时: %.3f秒\n",
+                  static_cast<unsigned long long>(requests), static_cast<unsigned long long>(errors),
+                  static_cast<unsigned long long>(failed_connections), elapsed_seconds);
+    out << line;
+    std::snprintf(line, sizeof(line), "  吞吐量: %.2f 请求/秒\n", throughput());
+    out << line;
+    uint64_t avg = latency.count() ? latency.sum() / latency.count() : 0;
+    out << "  延迟（毫秒，下同）: avg=" << formatMs(avg) << " p50=" << formatMs(latency.percentile(50.0))
+        << " p99=" << formatMs(latency.percentile(99.0)) << " p99.9=" << formatMs(latency.percentile(99.9))
+        << " max=" << formatMs(latency.max()) << "\n\n";
+    std::snprintf(line, sizeof(line), "  %-8s %12s %14s %10s %10s %10s %10s %8s\n", "command", "requests", "req/s",
+                  "p50", "p99", "p99.9", "max", "errors");
+    out << line;
+    for (const auto& command : commands) {
+        const HdrHistogram& histogram = *command.latency;
+        double rate = elapsed_seconds > 0 ? histogram.count() / elapsed_seconds : 0;
+        std::snprintf(line, sizeof(line), "  %-8s %12llu %14.2f %10s %10s %10s %10s %8llu\n", command.name.c_str(),
+                      static_cast<unsigned long long>(histogram.count()), rate,
+                      formatMs(histogram.percentile(50.0)).c_str(), formatMs(histogram.percentile(99.0)).c_str(),
+                      formatMs(histogram.percentile(99.9)).c_str(), formatMs(histogram.max()).c_str(),
+                      static_cast<unsigned long long>(command.errors));
+        out << line;
+    }
+    return out.str();
+}
+
+const std::vector<std::string>& LoadGenerator::supportedCommands() {
+    static const std::vector<std::string> names = [] {
+        std::vector<std::string> result;
+        for (const auto& spec : LOAD_COMMAND_SPECS) {
+            result.push_back(spec.name);
+        }
+        return result;
+    }();
+    return names;
+}
+
+bool LoadGenerator::parseMix(const std::string& text, std::vector<CommandMixEntry>& mix, std::string& error) {
+    mix.clear();
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        CommandMixEntry entry;
+        size_t colon = item.find(':');
+        entry.name = toLower(item.substr(0, colon));
+        if (!findSpec(entry.name)) {
+            error = "不支持的命令: " + entry.name;
+            return false;
+        }
+        if (colon != std::string::npos) {
+            int64_t weight = 0;
+            if (!parseLength(std::string_view(item).substr(colon + 1), weight) || weight < 0) {
+                error = "无效的权重: " + item;
+                return false;
+            }
+            entry.weight = static_cast<unsigned>(weight);
+        }
+        mix.push_back(entry);
+    }
+    if (mix.empty()) {
+        error = "命令组合为空";
+        return false;
+    }
+    return true;
+}
+
+LoadGenerator::ReplyStatus LoadGenerator::parseReply(std::string_view data, size_t& pos, bool& is_error) {
+    is_error = false;
+    size_t next = pos;
+    ReplyStatus status = parseValue(data, next, is_error, 0);
+    if (status == ReplyStatus::COMPLETE) {
+        pos = next;
+    }
+    return status;
+}
+
+// 一个压测线程及其连接：每个连接发出一批命令，收齐这批回复后再发出下一批
+struct LoadGenerator::Worker {
+    struct Connection {
+        int fd = -1;
+        std::string in;
+        size_t parsed = 0;
+        std::vector<size_t> batch; // 当前批次中各命令在命令组合中的下标
+        size_t replied = 0;        // 当前批次已收到的回复数
+        Clock::time_point sent;
+    };
+
+    Worker(const LoadGenerator& generator, const KeyGenerator& keys, size_t index)
+        : config(generator.config_), keys(keys), rng(config.seed * 0x9e3779b97f4a7c15ULL + index) {
+        this->keys.seed(rng());
+        value.assign(std::max(config.value_size, config.value_size_max), 'x');
+        for (const auto& entry : config.mix) {
+            specs.push_back(findSpec(entry.name));
+            total_weight += entry.weight;
+            cumulative.push_back(total_weight);
+            stats.push_back(CommandLoadStats{entry.name});
+        }
+    }
+
+    // 申请发送count条命令的额度，返回实际可发送的条数
+    size_t claim(size_t count) {
+        if (config.duration_seconds > 0) {
+            return Clock::now() < deadline ? count : 0;
+        }
+        uint64_t start = issued->fetch_add(count);
+        if (start >= config.requests) {
+            return 0;
+        }
+        return static_cast<size_t>(std::min<uint64_t>(count, config.requests - start));
+    }
+
+    void appendCommand(std::string& out, size_t kind) {
+        const LoadCommandSpec& spec = *specs[kind];
+        std::string key = keyName(config.key_prefix, spec, keys.next());
+        std::string_view val(value.data(), config.value_size_max > config.value_size
+                                               ? config.value_size + rng() % (config.value_size_max - config.value_size + 1)
+                                               : config.value_size);
+        std::string member = "member:" + std::to_string(rng() % MEMBER_COUNT);
+        switch (spec.form) {
+        case ArgForm::KEY:
+            appendHeader(out, 2);
+            appendArg(out, spec.command);
+            appendArg(out, key);
+            break;
+        case ArgForm::KEY_VALUE:
+            appendHeader(out, 3);
+            appendArg(out, spec.command);
+            appendArg(out, key);
+            appendArg(out, val);
+            break;
+        case ArgForm::KEY_MEMBER:
+            appendHeader(out, 3);
+            appendArg(out, spec.command);
+            appendArg(out, key);
+            appendArg(out, member);
+            break;
+        case ArgForm::KEY_FIELD_VALUE:
+            appendHeader(out, 4);
+            appendArg(out, spec.command);
+            appendArg(out, key);
+            appendArg(out, member);
+            appendArg(out, val);
+            break;
+        case ArgForm::KEY_SCORE_MEMBER:
+            appendHeader(out, 4);
+            appendArg(out, spec.command);
+            appendArg(out, key);
+            appendArg(out, std::to_string(rng() % MEMBER_COUNT));
+            appendArg(out, member);
+            break;
+        }
+    }
+
+    size_t pickCommand() {
+        if (specs.size() == 1) {
+            return 0;
+        }
+        uint64_t point = rng() % total_weight;
+        return std::upper_bound(cumulative.begin(), cumulative.end(), point) - cumulative.begin();
+    }
+
+    // 发出下一批命令，没有额度时批次为空；发送失败时返回false
+    bool sendBatch(Connection& conn) {
+        size_t count = claim(config.pipeline);
+        conn.batch.clear();
+        conn.replied = 0;
+        if (count == 0) {
+            return true;
+        }
+        out.clear();
+        for (size_t i = 0; i < count; ++i) {
+            size_t kind = pickCommand();
+            conn.batch.push_back(kind);
+            appendCommand(out, kind);
+        }
+        conn.sent = Clock::now();
+        return sendAll(conn.fd, out);
+    }
+
+    // 发出下一批命令，额度用完或发送失败时关闭连接
+    void next(Connection& conn) {
+        bool sent = sendBatch(conn);
+        if (!sent || conn.batch.empty()) {
+            closeConnection(conn, !sent);
+        }
+    }
+
+    // 解析已收到的回复，出现协议错误时返回false
+    bool consumeReplies(Connection& conn) {
+        Clock::time_point now = Clock::now();
+        while (conn.replied < conn.batch.size()) {
+            bool is_error = false;
+            ReplyStatus status = parseReply(conn.in, conn.parsed, is_error);
+            if (status == ReplyStatus::INCOMPLETE) {
+                break;
+            }
+            if (status == ReplyStatus::INVALID) {
+                return false;
+            }
+            uint64_t usec = LatencyMonitor::elapsedUs(conn.sent, now);
+            CommandLoadStats& command = stats[conn.batch[conn.replied++]];
+            command.latency->record(usec);
+            latency.record(usec);
+            if (is_error) {
+                command.errors++;
+                errors++;
+            }
+        }
+        if (conn.replied == conn.batch.size()) {
+            conn.in.erase(0, conn.parsed);
+            conn.parsed = 0;
+        }
+        return true;
+    }
+
+    void closeConnection(Connection& conn, bool failed) {
+        close(conn.fd);
+        conn.fd = -1;
+        if (failed) {
+            failed_connections++;
+        }
+    }
+
+    void run() {
+        for (auto& conn : connections) {
+            next(conn);
+        }
+        std::vector<pollfd> fds;
+        std::vector<Connection*> polled;
+        char buffer[64 * 1024];
+        while (true) {
+            fds.clear();
+            polled.clear();
+            for (auto& conn : connections) {
+                if (conn.fd >= 0) {
+                    fds.push_back(pollfd{conn.fd, POLLIN, 0});
+                    polled.push_back(&conn);
+                }
+            }
+            if (fds.empty()) {
+                break;
+            }
+            int ready = poll(fds.data(), fds.size(), 100);
+            if (ready < 0 && errno != EINTR) {
+                break;
+            }
+            for (size_t i = 0; i < fds.size() && ready > 0; ++i) {
+                if (fds[i].revents == 0) {
+                    continue;
+                }
+                Connection& conn = *polled[i];
+                ssize_t n = recv(conn.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                    continue;
+                }
+                if (n <= 0) {
+                    closeConnection(conn, true);
+                    continue;
+                }
+                conn.in.append(buffer, static_cast<size_t>(n));
+                if (!consumeReplies(conn)) {
+                    closeConnection(conn, true);
+                    continue;
+                }
+                if (conn.replied == conn.batch.size()) {
+                    next(conn);
+                }
+            }
+        }
+    }
+
+    const LoadConfig& config;
+    KeyGenerator keys;
+    std::mt19937_64 rng;
+    std::string value;
+    std::string out;
+    std::vector<const LoadCommandSpec*> specs;
+    std::vector<uint64_t> cumulative;
+    uint64_t total_weight = 0;
+
+    std::atomic<uint64_t>* issued = nullptr;
+    Clock::time_point deadline;
+    std::vector<Connection> connections;
+
+    std::vector<CommandLoadStats> stats;
+    HdrHistogram latency;
+    uint64_t errors = 0;
+    uint64_t failed_connections = 0;
+};
+
+LoadGenerator::LoadGenerator(LoadConfig config) : config_(std::move(config)) {}
+
+bool LoadGenerator::validate() {
+    if (config_.connections == 0 || config_.pipeline == 0 || config_.keyspace == 0) {
+        error_ = "连接数、流水线深度和键空间大小必须大于0";
+        return false;
+    }
+    if (config_.requests == 0 && config_.duration_seconds <= 0) {
+        error_ = "需要指定请求数或压测时长";
+        return false;
+    }
+    if (config_.distribution == KeyDistribution::ZIPFIAN && !(config_.zipf_theta > 0 && config_.zipf_theta < 1)) {
+        error_ = "zipf theta必须在(0, 1)之间";
+        return false;
+    }
+    if (config_.value_size_max != 0 && config_.value_size_max < config_.value_size) {
+        error_ = "值的最大长度小于最小长度";
+        return false;
+    }
+    uint64_t total_weight = 0;
+    for (const auto& entry : config_.mix) {
+        if (!findSpec(entry.name)) {
+            error_ = "不支持的命令: " + entry.name;
+            return false;
+        }
+        total_weight += entry.weight;
+    }
+    if (total_weight == 0) {
+        error_ = "命令组合的权重之和必须大于0";
+        return false;
+    }
+    config_.threads = std::max<size_t>(1, std::min(config_.threads, config_.connections));
+    return true;
+}
+
+int LoadGenerator::connect() const {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(config_.host.c_str(), std::to_string(config_.port).c_str(), &hints, &result) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo* ai = result; ai != nullptr; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd >= 0) {
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    }
+    return fd;
+}
+
+bool LoadGenerator::preload() {
+    int fd = connect();
+    if (fd < 0) {
+        error_ = "无法连接 " + config_.host + ":" + std::to_string(config_.port);
+        return false;
+    }
+    const LoadCommandSpec& spec = *findSpec("set");
+    const std::string value(config_.value_size, 'x');
+    std::string out;
+    std::string in;
+    char buffer[64 * 1024];
+    bool ok = true;
+    for (uint64_t start = 0; ok && start < config_.keyspace; start += PRELOAD_BATCH) {
+        uint64_t end = std::min<uint64_t>(config_.keyspace, start + PRELOAD_BATCH);
+        out.clear();
+        for (uint64_t i = start; i < end; ++i) {
+            appendHeader(out, 3);
+            appendArg(out, spec.command);
+            appendArg(out, keyName(config_.key_prefix, spec, i));
+            appendArg(out, value);
+        }
+        ok = sendAll(fd, out);
+        size_t pos = 0;
+        for (uint64_t replied = start; ok && replied < end;) {
+            bool is_error = false;
+            ReplyStatus status = parseReply(in, pos, is_error);
+            if (status == ReplyStatus::COMPLETE) {
+                ok = !is_error;
+                replied++;
+                continue;
+            }
+            ssize_t n = status == ReplyStatus::INCOMPLETE ? recv(fd, buffer, sizeof(buffer), 0) : -1;
+            if (n <= 0) {
+                ok = false;
+                break;
+            }
+            in.append(buffer, static_cast<size_t>(n));
+        }
+        in.erase(0, pos);
+    }
+    close(fd);
+    if (!ok) {
+        error_ = "预写入键空间失败";
+    }
+    return ok;
+}
+
+bool LoadGenerator::run(LoadReport& report) {
+    if (!validate()) {
+        return false;
+    }
+    if (config_.preload && !preload()) {
+        return false;
+    }
+    KeyGenerator keys(config_.keyspace, config_.distribution, config_.zipf_theta, config_.seed);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (size_t i = 0; i < config_.threads; ++i) {
+        workers.push_back(std::make_unique<Worker>(*this, keys, i));
+    }
+    // 全部连接建立后再开始计时
+    for (size_t i = 0; i < config_.connections; ++i) {
+        Worker::Connection conn;
+        conn.fd = connect();
+        if (conn.fd < 0) {
+            error_ = "无法连接 " + config_.host + ":" + std::to_string(config_.port);
+            for (auto& worker : workers) {
+                for (auto& opened : worker->connections) {
+                    close(opened.fd);
+                }
+            }
+            return false;
+        }
+        workers[i % workers.size()]->connections.push_back(std::move(conn));
+    }
+    std::atomic<uint64_t> issued{0};
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline =
+        start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config_.duration_seconds));
+    std::vector<std::thread> threads;
+    for (auto& worker : workers) {
+        worker->issued = &issued;
+        worker->deadline = deadline;
+        threads.emplace_back([&worker] { worker->run(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    report.elapsed_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    report.commands.clear();
+    for (const auto& entry : config_.mix) {
+        report.commands.push_back(CommandLoadStats{entry.name});
+    }
+    for (const auto& worker : workers) {
+        report.latency.merge(worker->latency);
+        report.errors += worker->errors;
+        report.failed_connections += worker->failed_connections;
+        for (size_t i = 0; i < report.commands.size(); ++i) {
+            report.commands[i].latency->merge(*worker->stats[i].latency);
+            report.commands[i].errors += worker->stats[i].errors;
+        }
+    }
+    report.requests = report.latency.count();
+    return true;
+}
+
+} // namespace dkv
@@ -0,0 +1,204 @@
+#include "dkv_logger.hpp"
+
+namespace dkv {
+
+namespace {
+// 后台线程没有日志可写时的最长等待时间，生产者错过唤醒时最多延迟这么久
+constexpr auto SINK_IDLE_WAIT = std::chrono::milliseconds(50);
+} // namespace
+
+Logger::Logger() : log_level_(LogLevel::INFO), console_output_(true), log_to_file_(false) {
+    setAsync(true);
+}
+
+Logger::~Logger() {
+    setAsync(false);
+    if (log_file_.is_open()) {
+        log_file_.close();
+    }
+}
+
+void Logger::setAsync(bool enabled) {
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    if (enabled == async_.load()) {
+        return;
+    }
+    if (enabled) {
+        startSink();
+        async_.store(true);
+    } else {
+        // 先停止接收新日志，停止后台线程时写完剩余的日志
+        async_.store(false);
+        stopSink();
+    }
+}
+
+void Logger::flush() {
+    if (!async_.load()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(sink_mutex_);
+    if (sink_stop_ || sink_id_ == std::this_thread::get_id()) {
+        return;
+    }
+    uint64_t target = ++flush_requested_;
+    sink_cv_.notify_one();
+    flushed_cv_.wait(lock, [&] { return flush_done_ >= target || sink_stop_; });
+}
+
+void Logger::write(LogLevel level, std::string&& entry) {
+    if (!async_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writeLocked(level, entry);
+        return;
+    }
+    LogBuffer& buffer = threadBuffer();
+    LogRecord record{level, std::move(entry)};
+    while (!buffer.tryPush(std::move(record))) {
+        if (overflow_policy_ == LogOverflowPolicy::DROP) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        sink_cv_.notify_one();
+        std::this_thread::yield();
+    }
+    if (sink_sleeping_.load(std::memory_order_acquire)) {
+        sink_cv_.notify_one();
+    }
+    // 错误日志可能紧接着进程退出，等它写出后再返回
+    if (level >= LogLevel::ERROR) {
+        flush();
+    }
+}
+
+void Logger::writeLocked(LogLevel level, const std::string& entry) {
+    if (console_output_) {
+        std::ostream& out = (level >= LogLevel::ERROR) ? std::cerr : std::cout;
+        out << entry << std::endl;
+    }
+    if (log_to_file_ && log_file_.is_open()) {
+        log_file_ << entry << std::endl;
+    }
+}
+
+Logger::LogBuffer& Logger::threadBuffer() {
+    thread_local ThreadBuffer local;
+    if (!local.buffer) {
+        local.buffer = std::make_shared<LogBuffer>(buffer_entries_);
+        local.closed = std::make_shared<std::atomic<bool>>(false);
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(RegisteredBuffer{local.buffer, local.closed});
+    }
+    return *local.buffer;
+}
+
+void Logger::startSink() {
+    std::lock_guard<std::mutex> lock(sink_mutex_);
+    sink_stop_ = false;
+    sink_thread_ = std::thread(&Logger::sinkLoop, this);
+    sink_id_ = sink_thread_.get_id();
+}
+
+void Logger::stopSink() {
+    {   std::lock_guard<std::mutex> lock(sink_mutex_);
+        sink_stop_ = true;
+    }
+    sink_cv_.notify_one();
+    if (sink_thread_.joinable()) {
+        sink_thread_.join();
+    }
+    // 停止前刚放入缓冲区的日志
+    drainBuffers();
+    flushed_cv_.notify_all();
+}
+
+void Logger::sinkLoop() {
+    while (true) {
+        uint64_t requested;
+        bool stop;
+        {   std::lock_guard<std::mutex> lock(sink_mutex_);
+            requested = flush_requested_;
+            stop = sink_stop_;
+        }
+        bool wrote = drainBuffers();
+        if (requested != 0) {
+            std::lock_guard<std::mutex> lock(sink_mutex_);
+            if (flush_done_ < requested) {
+                flush_done_ = requested;
+                flushed_cv_.notify_all();
+            }
+        }
+        if (stop) {
+            // 停止前再写一次，包括停止请求之前最后一刻放入的日志
+            drainBuffers();
+            return;
+        }
+        if (wrote) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sink_mutex_);
+        sink_sleeping_.store(true);
+        sink_cv_.wait_for(lock, SINK_IDLE_WAIT, [&] { return sink_stop_ || flush_requested_ != flush_done_; });
+        sink_sleeping_.store(false);
+    }
+}
+
+bool Logger::drainBuffers() {
+    std::vector<RegisteredBuffer> buffers;
+    {   std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers = buffers_;
+    }
+    // 同一输出目标的日志合并成一次写入，每批只刷新一次
+    std::string out_batch;
+    std::string err_batch;
+    std::string file_batch;
+    bool wrote = false;
+    bool has_closed = false;
+    LogRecord record;
+    for (const auto& registered : buffers) {
+        // 先读关闭标记再取日志，线程退出前放入的日志不会漏掉
+        bool closed = registered.closed->load(std::memory_order_acquire);
+        has_closed = has_closed || closed;
+        while (registered.buffer->tryPop(record)) {
+            std::string& batch = record.level >= LogLevel::ERROR ? err_batch : out_batch;
+            batch.append(record.text).push_back('\n');
+            file_batch.append(record.text).push_back('\n');
+            wrote = true;
+        }
+    }
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != dropped_reported_) {
+        std::string notice = "[WARNING] 日志缓冲区已满，丢弃了" + std::to_string(dropped - dropped_reported_) + "条日志\n";
+        out_batch.append(notice);
+        file_batch.append(notice);
+        dropped_reported_ = dropped;
+        wrote = true;
+    }
+    if (wrote) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (console_output_) {
+            if (!out_batch.empty()) {
+                std::cout.write(out_batch.data(), static_cast<std::streamsize>(out_batch.size()));
+                std::cout.flush();
+            }
+            if (!err_batch.empty()) {
+                std::cerr.write(err_batch.data(), static_cast<std::streamsize>(err_batch.size()));
+            }
+        }
+        if (log_to_file_ && log_file_.is_open()) {
+            log_file_.write(file_batch.data(), static_cast<std::streamsize>(file_batch.size()));
+            log_file_.flush();
+        }
+    }
+    if (has_closed) {
+        // 回收已退出线程且已写空的缓冲区
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (auto it = buffers_.begin(); it != buffers_.end();) {
+            bool reclaim = it->closed->load(std::memory_order_acquire) && it->buffer->empty();
+            it = reclaim ? buffers_.erase(it) : std::next(it);
+        }
+    }
+    return wrote;
+}
+
+} // namespace dkv
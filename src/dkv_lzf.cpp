@@ -0,0 +1,156 @@
+#include "dkv_lzf.hpp"
+#include <cstdint>
+#include <cstring>
+
+namespace dkv {
+namespace lzf {
+
+namespace {
+
+constexpr unsigned HASH_LOG = 13;
+constexpr size_t HASH_SIZE = size_t(1) << HASH_LOG;
+constexpr size_t MAX_LITERAL = 1 << 5;
+constexpr size_t MAX_OFFSET = 1 << 13;
+constexpr size_t MAX_REF = (1 << 8) + (1 << 3);
+
+inline size_t hash3(const uint8_t* p) {
+    uint32_t v = (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2];
+    return ((v * 2654435761u) >> (32 - HASH_LOG)) & (HASH_SIZE - 1);
+}
+
+} // namespace
+
+size_t compress(const void* in, size_t in_len, void* out, size_t out_len) {
+    if (in_len == 0 || out_len == 0) {
+        return 0;
+    }
+    const uint8_t* ip = static_cast<const uint8_t*>(in);
+    const uint8_t* const in_begin = ip;
+    const uint8_t* const in_end = ip + in_len;
+    uint8_t* op = static_cast<uint8_t*>(out);
+    uint8_t* const out_end = op + out_len;
+
+    // 记录三字节序列最近一次出现的位置（相对输入起点的偏移+1，0表示未出现）
+    uint32_t table[HASH_SIZE];
+    std::memset(table, 0, sizeof(table));
+
+    size_t lit = 0;
+    op++; // 预留第一段字面量的控制字节
+
+    while (ip + 2 < in_end) {
+        size_t h = hash3(ip);
+        const uint8_t* ref = table[h] ? in_begin + table[h] - 1 : nullptr;
+        table[h] = static_cast<uint32_t>(ip - in_begin + 1);
+
+        size_t off = ref ? static_cast<size_t>(ip - ref - 1) : MAX_OFFSET;
+        if (ref && off < MAX_OFFSET && ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2]) {
+            size_t len = 2;
+            size_t maxlen = static_cast<size_t>(in_end - ip) - len;
+            if (maxlen > MAX_REF) {
+                maxlen = MAX_REF;
+            }
+            do {
+                len++;
+            } while (len < maxlen && ref[len] == ip[len]);
+
+            // 回溯引用最多3字节，之后还要开始新的字面量
+            if (op - !lit + 3 + 1 >= out_end) {
+                return 0;
+            }
+            // 结束当前字面量，空字面量则收回控制字节
+            op[-static_cast<ptrdiff_t>(lit) - 1] = static_cast<uint8_t>(lit - 1);
+            op -= !lit;
+
+            len -= 2;
+            if (len < 7) {
+                *op++ = static_cast<uint8_t>((off >> 8) + (len << 5));
+            } else {
+                *op++ = static_cast<uint8_t>((off >> 8) + (7 << 5));
+                *op++ = static_cast<uint8_t>(len - 7);
+            }
+            *op++ = static_cast<uint8_t>(off);
+
+            lit = 0;
+            op++;
+            ip += len + 2;
+        } else {
+            if (op >= out_end) {
+                return 0;
+            }
+            lit++;
+            *op++ = *ip++;
+            if (lit == MAX_LITERAL) {
+                op[-static_cast<ptrdiff_t>(lit) - 1] = static_cast<uint8_t>(lit - 1);
+                lit = 0;
+                op++;
+            }
+        }
+    }
+
+    // 剩余不足三字节的部分作为字面量
+    while (ip < in_end) {
+        if (op >= out_end) {
+            return 0;
+        }
+        lit++;
+        *op++ = *ip++;
+        if (lit == MAX_LITERAL) {
+            op[-static_cast<ptrdiff_t>(lit) - 1] = static_cast<uint8_t>(lit - 1);
+            lit = 0;
+            op++;
+        }
+    }
+    if (op > out_end) {
+        return 0;
+    }
+    op[-static_cast<ptrdiff_t>(lit) - 1] = static_cast<uint8_t>(lit - 1);
+    op -= !lit;
+    return static_cast<size_t>(op - static_cast<uint8_t*>(out));
+}
+
+size_t decompress(const void* in, size_t in_len, void* out, size_t out_len) {
+    const uint8_t* ip = static_cast<const uint8_t*>(in);
+    const uint8_t* const in_end = ip + in_len;
+    uint8_t* op = static_cast<uint8_t*>(out);
+    uint8_t* const out_begin = op;
+    uint8_t* const out_end = op + out_len;
+
+    while (ip < in_end) {
+        size_t ctrl = *ip++;
+        if (ctrl < MAX_LITERAL) {
+            size_t len = ctrl + 1;
+            if (op + len > out_end || ip + len > in_end) {
+                return 0;
+            }
+            std::memcpy(op, ip, len);
+            op += len;
+            ip += len;
+        } else {
+            size_t len = ctrl >> 5;
+            if (len == 7) {
+                if (ip >= in_end) {
+                    return 0;
+                }
+                len += *ip++;
+            }
+            if (ip >= in_end) {
+                return 0;
+            }
+            size_t back = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+            len += 2;
+            if (op + len > out_end || back > static_cast<size_t>(op - out_begin)) {
+                return 0;
+            }
+            // 引用可能与输出重叠，逐字节复制
+            const uint8_t* ref = op - back;
+            for (size_t i = 0; i < len; ++i) {
+                op[i] = ref[i];
+            }
+            op += len;
+        }
+    }
+    return static_cast<size_t>(op - out_begin);
+}
+
+} // namespace lzf
+} // namespace dkv
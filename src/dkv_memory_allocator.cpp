@@ -3,6 +3,9 @@
 #include <iostream>
 #include <sstream>
 #include <new>
+#include <cstring>
+#include <algorithm>
+#include <malloc.h>
 
 // 全局操作符重载，使用自定义MemoryAllocator
 // 1. 基本单对象分配和释放
@@ -104,33 +107,150 @@ private:
     EnterGuard& operator=(const EnterGuard&) = delete;
 };
 
-void* MemoryAllocator::allocate(size_t size, const char* allocation_type) {
-    if (size == 0) {
-        return nullptr;
+namespace {
+
+// 内存块头，位于返回给调用方的指针之前，保持16字节对齐
+struct BlockHeader {
+    uint64_t size;  // 用户请求的大小
+    uint32_t epoch; // 分配时的统计周期
+    uint32_t magic; // 校验值
+};
+static_assert(sizeof(BlockHeader) == 16, "BlockHeader必须为16字节以保持对齐");
+
+constexpr uint32_t BLOCK_MAGIC = 0xD1CEB10C;
+
+inline BlockHeader* headerOf(void* ptr) {
+    return reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) - sizeof(BlockHeader));
+}
+
+inline void* userPtrOf(BlockHeader* header) {
+    return reinterpret_cast<char*>(header) + sizeof(BlockHeader);
+}
+
+} // namespace
+
+namespace {
+
+// 线程本地计数，常量初始化且可平凡析构，访问时没有初始化检查
+struct ThreadCounters {
+    int64_t usage_delta;
+    int64_t allocations;
+    int64_t deallocations;
+    uint32_t epoch;  // 累计计数所属的统计周期
+    bool registered; // 是否已注册线程退出时的合并
+    bool exited;     // 线程已退出，之后的计数直接写入全局
+};
+
+thread_local ThreadCounters tls_counters = {0, 0, 0, 0, false, false};
+
+} // namespace
+
+// 线程退出时把剩余的线程本地计数合并到全局
+struct ThreadCountersFlusher {
+    void touch() {}
+    ~ThreadCountersFlusher() {
+        MemoryAllocator::getInstance().flushLocal();
+        tls_counters.exited = true;
+    }
+};
+
+static thread_local ThreadCountersFlusher tls_flusher;
+
+MemoryAllocator::MemoryAllocator() {
+    const char* debug = std::getenv("DKV_MEMORY_DEBUG");
+    if (debug && (std::strcmp(debug, "1") == 0 || std::strcmp(debug, "yes") == 0)) {
+        debug_tracking_ = true;
+    }
+}
+
+void MemoryAllocator::flushLocal() {
+    ThreadCounters& counters = tls_counters;
+    if (counters.epoch == epoch_.load(std::memory_order_relaxed)) {
+        if (counters.usage_delta != 0) {
+            current_usage_.fetch_add(counters.usage_delta, std::memory_order_relaxed);
+        }
+        if (counters.allocations != 0) {
+            total_allocations_.fetch_add(counters.allocations, std::memory_order_relaxed);
+        }
+        if (counters.deallocations != 0) {
+            total_deallocations_.fetch_add(counters.deallocations, std::memory_order_relaxed);
+        }
+    }
+    counters.usage_delta = 0;
+    counters.allocations = 0;
+    counters.deallocations = 0;
+}
+
+void MemoryAllocator::record(int64_t usage_delta, int64_t allocations, int64_t deallocations) {
+    ThreadCounters& counters = tls_counters;
+    if (counters.exited) {
+        // 线程本地存储已销毁，直接写入全局
+        current_usage_.fetch_add(usage_delta, std::memory_order_relaxed);
+        total_allocations_.fetch_add(allocations, std::memory_order_relaxed);
+        total_deallocations_.fetch_add(deallocations, std::memory_order_relaxed);
+        return;
+    }
+    if (!counters.registered) {
+        counters.registered = true;
+        // 首次访问时构造，注册线程退出时的合并
+        tls_flusher.touch();
+    }
+    uint32_t epoch = epoch_.load(std::memory_order_relaxed);
+    if (counters.epoch != epoch) {
+        // 统计已重置，丢弃之前周期的本地计数
+        counters.usage_delta = 0;
+        counters.allocations = 0;
+        counters.deallocations = 0;
+        counters.epoch = epoch;
     }
+    counters.usage_delta += usage_delta;
+    counters.allocations += allocations;
+    counters.deallocations += deallocations;
+    if (counters.usage_delta >= FLUSH_BYTES || counters.usage_delta <= -FLUSH_BYTES ||
+        counters.allocations + counters.deallocations >= FLUSH_OPS) {
+        flushLocal();
+    }
+}
+
+void MemoryAllocator::trackBlock(void* ptr, size_t size, const char* allocation_type) {
     EnterGuard guard;
-    // 如果是递归调用，直接分配内存而不进行统计
+    // 映射表自身的分配会递归进入，此时不再记录
     if (!guard.isFirst()) {
-        void* ptr = std::malloc(size);
-        if (!ptr) {
-            throw std::bad_alloc();
-        }
-        return ptr;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t allocation_id = ++allocation_counter_;
+    memory_blocks_[ptr] = {size, allocation_type ? allocation_type : "unknown", allocation_id};
+}
+
+void MemoryAllocator::untrackBlock(void* ptr) {
+    EnterGuard guard;
+    if (!guard.isFirst()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    memory_blocks_.erase(ptr);
+}
+
+void* MemoryAllocator::allocate(size_t size, const char* allocation_type) {
+    if (size == 0) {
+        return nullptr;
     }
     
-    // 分配内存
-    void* ptr = std::malloc(size);
-    if (!ptr) {
+    // 分配内存，块头记录大小和统计周期
+    BlockHeader* header = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size));
+    if (!header) {
         throw std::bad_alloc();
     }
+    header->size = size;
+    header->epoch = epoch_.load(std::memory_order_relaxed);
+    header->magic = BLOCK_MAGIC;
+    void* ptr = userPtrOf(header);
     
     // 记录内存使用情况
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        uint64_t allocation_id = ++allocation_counter_;
-        memory_blocks_[ptr] = {size, allocation_type, allocation_id};
-        current_usage_ += size;
-        total_allocations_++;
+    record(static_cast<int64_t>(size), 1, 0);
+    if (debug_tracking_.load(std::memory_order_relaxed)) {
+        trackBlock(ptr, size, allocation_type);
     }
     
     return ptr;
@@ -140,25 +260,23 @@ void MemoryAllocator::deallocate(void* ptr) {
     if (!ptr) {
         return;
     }
-    EnterGuard guard;
-    // 如果是递归调用，直接释放内存而不进行统计更新
-    if (!guard.isFirst()) {
+    BlockHeader* header = headerOf(ptr);
+    if (header->magic != BLOCK_MAGIC) {
+        // 不是本分配器分配的内存块，直接释放
         std::free(ptr);
         return;
     }
 
-    // 释放内存并更新统计信息
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = memory_blocks_.find(ptr);
-        if (it != memory_blocks_.end()) {
-            current_usage_ -= it->second.size;
-            memory_blocks_.erase(it);
-            total_deallocations_++;
-        }
+    // 只统计当前周期分配的内存块
+    if (header->epoch == epoch_.load(std::memory_order_relaxed)) {
+        record(-static_cast<int64_t>(header->size), 0, 1);
+    }
+    if (debug_tracking_.load(std::memory_order_relaxed)) {
+        untrackBlock(ptr);
     }
     
-    std::free(ptr);
+    header->magic = 0;
+    std::free(header);
 }
 
 void* MemoryAllocator::reallocate(void* ptr, size_t new_size, const char* allocation_type) {
@@ -170,72 +288,69 @@ void* MemoryAllocator::reallocate(void* ptr, size_t new_size, const char* alloca
     if (!ptr) {
         return allocate(new_size, allocation_type);
     }
-    EnterGuard guard;
-    // 如果是递归调用，直接重新分配内存而不进行统计更新
-    if (!guard.isFirst()) {
-        return std::realloc(ptr, new_size);
-    }
 
-    // 计算新旧内存块的大小差异
-    size_t old_size = 0;
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = memory_blocks_.find(ptr);
-        if (it != memory_blocks_.end()) {
-            old_size = it->second.size;
-        }
+    BlockHeader* header = headerOf(ptr);
+    if (header->magic != BLOCK_MAGIC) {
+        // 不是本分配器分配的内存块，按新分配处理
+        void* new_ptr = allocate(new_size, allocation_type);
+        std::memcpy(new_ptr, ptr, std::min(new_size, malloc_usable_size(ptr)));
+        std::free(ptr);
+        return new_ptr;
     }
+    size_t old_size = header->size;
+    bool current_epoch = header->epoch == epoch_.load(std::memory_order_relaxed);
     
     // 重新分配内存
-    void* new_ptr = std::realloc(ptr, new_size);
-    if (!new_ptr) {
+    BlockHeader* new_header = static_cast<BlockHeader*>(std::realloc(header, sizeof(BlockHeader) + new_size));
+    if (!new_header) {
         throw std::bad_alloc();
     }
+    new_header->size = new_size;
+    new_header->epoch = epoch_.load(std::memory_order_relaxed);
+    void* new_ptr = userPtrOf(new_header);
     
     // 更新内存使用统计
-    if (new_ptr != ptr) {
-        // 如果返回新指针，需要从旧指针记录中移除并添加新指针记录
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            auto it = memory_blocks_.find(ptr);
-            if (it != memory_blocks_.end()) {
-                memory_blocks_.erase(it);
-            }
-            
-            uint64_t allocation_id = ++allocation_counter_;
-            memory_blocks_[new_ptr] = {new_size, allocation_type, allocation_id};
-            current_usage_ = current_usage_ - old_size + new_size;
-            total_allocations_++;
-            total_deallocations_++;
-        }
+    if (current_epoch) {
+        // 如果返回新指针，计为一次释放和一次分配
+        int64_t moved = new_ptr != ptr ? 1 : 0;
+        record(static_cast<int64_t>(new_size) - static_cast<int64_t>(old_size), moved, moved);
     } else {
-        // 如果返回相同指针，只需更新记录
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            auto it = memory_blocks_.find(ptr);
-            if (it != memory_blocks_.end()) {
-                current_usage_ = current_usage_ - old_size + new_size;
-                it->second.size = new_size;
-                if (allocation_type) {
-                    it->second.type = allocation_type;
-                }
-            }
+        // 重置前分配的内存块，按新分配计入当前周期
+        record(static_cast<int64_t>(new_size), 1, 0);
+    }
+    if (debug_tracking_.load(std::memory_order_relaxed)) {
+        if (new_ptr != ptr) {
+            untrackBlock(ptr);
         }
+        trackBlock(new_ptr, new_size, allocation_type);
     }
     
     return new_ptr;
 }
 
 size_t MemoryAllocator::getCurrentUsage() const {
-    return current_usage_.load();
+    // 全局计数加上当前线程尚未合并的部分，其它线程的未合并部分不超过FLUSH_BYTES
+    int64_t usage = current_usage_.load(std::memory_order_relaxed);
+    if (tls_counters.epoch == epoch_.load(std::memory_order_relaxed)) {
+        usage += tls_counters.usage_delta;
+    }
+    return usage > 0 ? static_cast<size_t>(usage) : 0;
 }
 
 uint64_t MemoryAllocator::getTotalAllocations() const {
-    return total_allocations_.load();
+    int64_t count = total_allocations_.load(std::memory_order_relaxed);
+    if (tls_counters.epoch == epoch_.load(std::memory_order_relaxed)) {
+        count += tls_counters.allocations;
+    }
+    return count > 0 ? static_cast<uint64_t>(count) : 0;
 }
 
 uint64_t MemoryAllocator::getTotalDeallocations() const {
-    return total_deallocations_.load();
+    int64_t count = total_deallocations_.load(std::memory_order_relaxed);
+    if (tls_counters.epoch == epoch_.load(std::memory_order_relaxed)) {
+        count += tls_counters.deallocations;
+    }
+    return count > 0 ? static_cast<uint64_t>(count) : 0;
 }
 
 std::string MemoryAllocator::getStats() const {
@@ -247,9 +362,10 @@ std::string MemoryAllocator::getStats() const {
     oss << "total_allocations:" << getTotalAllocations() << "\n";
     oss << "total_deallocations:" << getTotalDeallocations() << "\n";
     oss << "active_allocations:" << (getTotalAllocations() - getTotalDeallocations()) << "\n";
+    oss << "debug_tracking:" << (isDebugTracking() ? "yes" : "no") << "\n";
     
-    // 可以在这里添加更详细的统计信息
-    {
+    // 按分配类型汇总，仅调试模式下可用
+    if (isDebugTracking()) {
         std::lock_guard<std::mutex> lock(mutex_);
         oss << "allocation_types:";
         std::unordered_map<std::string, size_t> type_counts;
@@ -278,6 +394,8 @@ void MemoryAllocator::resetStats() {
     EnterGuard guard;
 
     std::lock_guard<std::mutex> lock(mutex_);
+    // 进入新周期，各线程的本地计数在下次访问时丢弃
+    epoch_++;
     current_usage_ = 0;
     total_allocations_ = 0;
     total_deallocations_ = 0;
@@ -285,4 +403,18 @@ void MemoryAllocator::resetStats() {
     memory_blocks_.clear();
 }
 
-} // namespace dkv
\ No newline at end of file
+void MemoryAllocator::setDebugTracking(bool enabled) {
+    EnterGuard guard;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled) {
+        memory_blocks_.clear();
+    }
+    debug_tracking_ = enabled;
+}
+
+bool MemoryAllocator::isDebugTracking() const {
+    return debug_tracking_.load(std::memory_order_relaxed);
+}
+
+} // namespace dkv
@@ -0,0 +1,204 @@
+#include "dkv_metrics.hpp"
+#include "dkv_logger.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace dkv {
+
+namespace {
+
+// 等待新连接的超时，停止时最多延迟这么久
+constexpr int ACCEPT_POLL_MS = 100;
+
+const char* typeName(MetricType type) {
+    switch (type) {
+        case MetricType::COUNTER:
+            return "counter";
+        case MetricType::GAUGE:
+            return "gauge";
+        case MetricType::SUMMARY:
+            return "summary";
+    }
+    return "untyped";
+}
+
+std::string formatValue(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.17g", value);
+    return buf;
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string httpResponse(const std::string& status, const std::string& content_type, const std::string& body) {
+    return "HTTP/1.1 " + status + "\r\nContent-Type: " + content_type + "\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+
+} // namespace
+
+void MetricsRegistry::addCounter(const std::string& name, const std::string& help, Reader reader) {
+    addFamily(name, help, MetricType::COUNTER, [reader](std::vector<MetricSample>& samples) {
+        samples.push_back(MetricSample{"", "", reader()});
+    });
+}
+
+void MetricsRegistry::addGauge(const std::string& name, const std::string& help, Reader reader) {
+    addFamily(name, help, MetricType::GAUGE, [reader](std::vector<MetricSample>& samples) {
+        samples.push_back(MetricSample{"", "", reader()});
+    });
+}
+
+void MetricsRegistry::addFamily(const std::string& name, const std::string& help, MetricType type,
+                                FamilyReader reader) {
+    families_.push_back(Family{name, help, type, std::move(reader)});
+}
+
+void MetricsRegistry::addSummary(const std::string& name, const std::string& help, const HdrHistogram& histogram) {
+    addFamily(name, help, MetricType::SUMMARY, [&histogram](std::vector<MetricSample>& samples) {
+        samples.push_back(MetricSample{"", "quantile=\"0.5\"", static_cast<double>(histogram.percentile(50.0))});
+        samples.push_back(MetricSample{"", "quantile=\"0.99\"", static_cast<double>(histogram.percentile(99.0))});
+        samples.push_back(MetricSample{"", "quantile=\"0.999\"", static_cast<double>(histogram.percentile(99.9))});
+        samples.push_back(MetricSample{"_sum", "", static_cast<double>(histogram.sum())});
+        samples.push_back(MetricSample{"_count", "", static_cast<double>(histogram.count())});
+    });
+}
+
+std::string MetricsRegistry::render() const {
+    std::string out;
+    std::vector<MetricSample> samples;
+    for (const auto& family : families_) {
+        samples.clear();
+        family.reader(samples);
+        out += "# HELP " + family.name + " " + family.help + "\n";
+        out += "# TYPE " + family.name + " " + typeName(family.type) + "\n";
+        for (const auto& sample : samples) {
+            out += family.name + sample.suffix;
+            if (!sample.labels.empty()) {
+                out += "{" + sample.labels + "}";
+            }
+            out += " " + formatValue(sample.value) + "\n";
+        }
+    }
+    return out;
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+bool MetricsExporter::start(int port) {
+    if (running_) {
+        return true;
+    }
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        DKV_LOG_ERROR("创建监控端口socket失败: ", std::strerror(errno));
+        return false;
+    }
+    int opt = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, 16) < 0) {
+        DKV_LOG_ERROR("监听监控端口", port, "失败: ", std::strerror(errno));
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+    running_ = true;
+    thread_ = std::thread(&MetricsExporter::serveLoop, this);
+    DKV_LOG_INFO("监控指标导出端口: ", port_);
+    return true;
+}
+
+void MetricsExporter::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+}
+
+void MetricsExporter::serveLoop() {
+    while (running_) {
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, ACCEPT_POLL_MS);
+        if (ready <= 0) {
+            continue;
+        }
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        handleConnection(fd);
+        ::close(fd);
+    }
+}
+
+void MetricsExporter::handleConnection(int fd) {
+    // 只读取请求头，不支持请求体和长连接
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_BYTES) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (::poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0) {
+            return;
+        }
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+    size_t line_end = request.find("\r\n");
+    std::string line = request.substr(0, line_end);
+    size_t method_end = line.find(' ');
+    size_t path_end = method_end == std::string::npos ? std::string::npos : line.find(' ', method_end + 1);
+    if (path_end == std::string::npos) {
+        sendAll(fd, httpResponse("400 Bad Request", "text/plain", "bad request\n"));
+        return;
+    }
+    std::string method = line.substr(0, method_end);
+    std::string path = line.substr(method_end + 1, path_end - method_end - 1);
+    path = path.substr(0, path.find('?'));
+    if (method != "GET") {
+        sendAll(fd, httpResponse("405 Method Not Allowed", "text/plain", "method not allowed\n"));
+    } else if (path != "/metrics") {
+        sendAll(fd, httpResponse("404 Not Found", "text/plain", "not found\n"));
+    } else {
+        sendAll(fd, httpResponse("200 OK", "text/plain; version=0.0.4; charset=utf-8", registry_.render()));
+    }
+}
+
+} // namespace dkv
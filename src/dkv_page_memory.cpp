@@ -0,0 +1,270 @@
+#include "dkv_page_memory.hpp"
+#include "dkv_cpu_affinity.hpp"
+#include "dkv_logger.hpp"
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+namespace dkv {
+
+namespace {
+
+// mbind的策略：优先在指定节点分配，节点内存不足时使用其他节点
+constexpr int MPOL_PREFERRED_POLICY = 1;
+constexpr size_t SMALL_PAGE_SIZE = 4096;
+
+// 一次映射的记录
+struct Mapping {
+    size_t bytes = 0;
+    bool huge = false;
+    int node = -1;
+};
+
+struct PageMemoryState {
+    std::atomic<HugePageMode> mode{HugePageMode::OFF};
+    std::atomic<bool> numa{false};
+    // NUMA拓扑：节点序号对应的系统节点号，以及CPU到节点序号的映射，configure时确定
+    std::vector<int> node_ids;
+    std::vector<int> cpu_nodes;
+
+    std::mutex mutex; // 保护下面的映射记录与统计
+    std::unordered_map<void*, Mapping> mappings;
+    PageMemoryStats stats;
+};
+
+PageMemoryState& state() {
+    // 不析构，静态对象析构阶段仍可释放映射
+    static PageMemoryState* instance = new PageMemoryState();
+    return *instance;
+}
+
+// 读取NUMA拓扑，节点号可能不连续
+void loadTopology(PageMemoryState& s) {
+    s.node_ids.clear();
+    s.cpu_nodes.clear();
+    for (int node = 0, missing = 0; missing < 8; ++node) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string line;
+        if (!file.is_open() || !std::getline(file, line)) {
+            missing++;
+            continue;
+        }
+        missing = 0;
+        std::vector<int> cpus;
+        if (!parseCpuList(line, cpus) || cpus.empty()) {
+            continue;
+        }
+        const int index = static_cast<int>(s.node_ids.size());
+        s.node_ids.push_back(node);
+        for (int cpu : cpus) {
+            if (static_cast<size_t>(cpu) >= s.cpu_nodes.size()) {
+                s.cpu_nodes.resize(cpu + 1, 0);
+            }
+            s.cpu_nodes[cpu] = index;
+        }
+    }
+}
+
+size_t roundUp(size_t value, size_t unit) {
+    return (value + unit - 1) / unit * unit;
+}
+
+// 映射按2MB对齐的区域：多映射一个大页再裁掉首尾
+void* mapAligned(size_t bytes) {
+    const size_t total = bytes + PageMemory::HUGE_PAGE_SIZE;
+    void* raw = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    const uintptr_t aligned = roundUp(start, PageMemory::HUGE_PAGE_SIZE);
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    const size_t tail = total - (aligned - start) - bytes;
+    if (tail > 0) {
+        munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+
+} // namespace
+
+void PageMemory::configure(HugePageMode mode, bool numa_arenas) {
+    PageMemoryState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.mode = mode;
+    if (numa_arenas) {
+        loadTopology(s);
+    }
+    // 读取不到拓扑或只有一个节点时没有可分的区
+    s.numa = numa_arenas && s.node_ids.size() > 1;
+    s.stats.node_bytes.assign(s.numa ? std::min(s.node_ids.size(), MAX_NODES) : 1, 0);
+    if (numa_arenas && !s.numa) {
+        DKV_LOG_INFO("未检测到多个NUMA节点，不按节点分区");
+    }
+    DKV_LOG_INFO("页内存配置：大页模式 ", hugePageModeName(mode), "，NUMA节点数 ", nodeCount());
+}
+
+HugePageMode PageMemory::hugePageMode() {
+    return state().mode.load(std::memory_order_relaxed);
+}
+
+bool PageMemory::numaArenas() {
+    return state().numa.load(std::memory_order_relaxed);
+}
+
+size_t PageMemory::nodeCount() {
+    PageMemoryState& s = state();
+    return s.numa.load(std::memory_order_acquire) ? std::min(s.node_ids.size(), MAX_NODES) : 1;
+}
+
+size_t PageMemory::currentNode() {
+    PageMemoryState& s = state();
+    if (!s.numa.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    thread_local int cached = -1;
+    if (cached < 0) {
+        const int cpu = sched_getcpu();
+        cached = cpu >= 0 && static_cast<size_t>(cpu) < s.cpu_nodes.size() ? s.cpu_nodes[cpu] : 0;
+    }
+    return static_cast<size_t>(cached) % MAX_NODES;
+}
+
+size_t PageMemory::mappedSize(size_t bytes) {
+    return roundUp(bytes, hugePageMode() == HugePageMode::OFF ? SMALL_PAGE_SIZE : HUGE_PAGE_SIZE);
+}
+
+void* PageMemory::map(size_t bytes, int node) {
+    PageMemoryState& s = state();
+    const HugePageMode mode = hugePageMode();
+    const size_t size = mappedSize(bytes);
+    void* ptr = nullptr;
+    bool huge = false;
+    bool fallback = false;
+    if (mode == HugePageMode::EXPLICIT) {
+        ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr == MAP_FAILED) {
+            ptr = nullptr;
+            fallback = true;
+        } else {
+            huge = true;
+        }
+    }
+    if (!ptr && mode != HugePageMode::OFF) {
+        ptr = mapAligned(size);
+        if (ptr && madvise(ptr, size, MADV_HUGEPAGE) == 0) {
+            huge = true;
+        }
+    }
+    if (!ptr && mode == HugePageMode::OFF) {
+        // 不小于2MB的映射同样按2MB对齐，slab按页内存块内的偏移对齐
+        if (size >= HUGE_PAGE_SIZE) {
+            ptr = mapAligned(size);
+        } else {
+            ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) {
+                ptr = nullptr;
+            }
+        }
+    }
+    if (!ptr) {
+        return nullptr;
+    }
+
+    // 在第一次访问之前设置节点策略，页面在首次写入时按策略分配
+    int bound = -1;
+    if (node >= 0 && s.numa.load(std::memory_order_acquire)) {
+        const size_t index = static_cast<size_t>(node) % nodeCount();
+        const int node_id = s.node_ids[index];
+        if (node_id < static_cast<int>(sizeof(unsigned long) * 8)) {
+            unsigned long mask = 1UL << node_id;
+            if (syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_POLICY, &mask, sizeof(mask) * 8, 0) == 0) {
+                bound = static_cast<int>(index);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.mappings[ptr] = Mapping{size, huge, bound};
+    s.stats.mapped_bytes += size;
+    if (huge) {
+        s.stats.huge_page_bytes += size;
+    }
+    if (fallback) {
+        s.stats.hugetlb_fallbacks++;
+    }
+    if (bound >= 0 && static_cast<size_t>(bound) < s.stats.node_bytes.size()) {
+        s.stats.node_bytes[bound] += size;
+    }
+    return ptr;
+}
+
+void PageMemory::unmap(void* ptr, size_t bytes) {
+    if (!ptr) {
+        return;
+    }
+    PageMemoryState& s = state();
+    Mapping mapping;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.mappings.find(ptr);
+        if (it == s.mappings.end()) {
+            DKV_LOG_ERROR("释放未映射的页内存，大小 ", bytes);
+            return;
+        }
+        mapping = it->second;
+        s.mappings.erase(it);
+        s.stats.mapped_bytes -= mapping.bytes;
+        if (mapping.huge) {
+            s.stats.huge_page_bytes -= mapping.bytes;
+        }
+        if (mapping.node >= 0 && static_cast<size_t>(mapping.node) < s.stats.node_bytes.size()) {
+            s.stats.node_bytes[mapping.node] -= mapping.bytes;
+        }
+    }
+    munmap(ptr, mapping.bytes);
+}
+
+PageMemoryStats PageMemory::stats() {
+    PageMemoryState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    PageMemoryStats result = s.stats;
+    if (result.node_bytes.empty()) {
+        result.node_bytes.assign(1, 0);
+    }
+    return result;
+}
+
+bool PageMemory::parseHugePageMode(const std::string& text, HugePageMode& mode) {
+    if (text == "no" || text == "off" || text == "never") {
+        mode = HugePageMode::OFF;
+    } else if (text == "transparent" || text == "madvise" || text == "yes") {
+        mode = HugePageMode::TRANSPARENT;
+    } else if (text == "explicit" || text == "hugetlb") {
+        mode = HugePageMode::EXPLICIT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* PageMemory::hugePageModeName(HugePageMode mode) {
+    switch (mode) {
+        case HugePageMode::TRANSPARENT:
+            return "transparent";
+        case HugePageMode::EXPLICIT:
+            return "explicit";
+        default:
+            return "no";
+    }
+}
+
+} // namespace dkv
@@ -0,0 +1,443 @@
+#include "dkv_pubsub.hpp"
+#include "net/dkv_network.hpp"
+#include "net/dkv_resp.hpp"
+#include <algorithm>
+
+namespace dkv {
+
+struct PatternTrie::Node {
+    std::unordered_map<char, std::unique_ptr<Node>> literals;
+    std::vector<std::pair<Token, std::unique_ptr<Node>>> wildcards; // ?、*和字符类
+    bool star = false; // 经*到达：可以继续吸收任意字节
+    // 在此结束的模式及其订阅者。转义写法不同的模式编译为同一路径，按原样分别记录
+    std::vector<std::pair<std::string, std::vector<Subscriber>>> entries;
+    mutable uint64_t mark = 0;
+
+    bool unused() const { return literals.empty() && wildcards.empty() && entries.empty(); }
+};
+
+PatternTrie::PatternTrie() : root_(std::make_unique<Node>()) {
+}
+
+PatternTrie::~PatternTrie() = default;
+
+std::vector<PatternTrie::Token> PatternTrie::compile(const std::string& pattern) {
+    std::vector<Token> tokens;
+    const size_t n = pattern.size();
+    for (size_t i = 0; i < n; ++i) {
+        Token token;
+        switch (pattern[i]) {
+            case '*':
+                // 连续的*等价于一个
+                if (!tokens.empty() && tokens.back().kind == Token::STAR) {
+                    continue;
+                }
+                token.kind = Token::STAR;
+                break;
+            case '?':
+                token.kind = Token::ANY;
+                break;
+            case '[': {
+                token.kind = Token::CLASS;
+                ++i;
+                const bool negate = i < n && pattern[i] == '^';
+                if (negate) {
+                    ++i;
+                }
+                for (; i < n && pattern[i] != ']'; ++i) {
+                    if (pattern[i] == '\\' && i + 1 < n) {
+                        token.set.set(static_cast<uint8_t>(pattern[++i]));
+                    } else if (i + 2 < n && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+                        uint8_t start = static_cast<uint8_t>(pattern[i]);
+                        uint8_t end = static_cast<uint8_t>(pattern[i + 2]);
+                        if (start > end) {
+                            std::swap(start, end);
+                        }
+                        for (unsigned c = start; c <= end; ++c) {
+                            token.set.set(c);
+                        }
+                        i += 2;
+                    } else {
+                        token.set.set(static_cast<uint8_t>(pattern[i]));
+                    }
+                }
+                if (negate) {
+                    token.set.flip();
+                }
+                break;
+            }
+            case '\\':
+                token.ch = i + 1 < n ? pattern[++i] : '\\';
+                break;
+            default:
+                token.ch = pattern[i];
+                break;
+        }
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+bool PatternTrie::walk(const std::vector<Token>& tokens, bool create, std::vector<Node*>& path) {
+    Node* node = root_.get();
+    path.push_back(node);
+    for (const auto& token : tokens) {
+        Node* next = nullptr;
+        if (token.kind == Token::LITERAL) {
+            auto it = node->literals.find(token.ch);
+            if (it != node->literals.end()) {
+                next = it->second.get();
+            } else if (create) {
+                next = (node->literals[token.ch] = std::make_unique<Node>()).get();
+            }
+        } else {
+            for (auto& [child_token, child] : node->wildcards) {
+                if (child_token == token) {
+                    next = child.get();
+                    break;
+                }
+            }
+            if (!next && create) {
+                node->wildcards.emplace_back(token, std::make_unique<Node>());
+                next = node->wildcards.back().second.get();
+                next->star = token.kind == Token::STAR;
+            }
+        }
+        if (!next) {
+            return false;
+        }
+        node = next;
+        path.push_back(node);
+    }
+    return true;
+}
+
+bool PatternTrie::add(const std::string& pattern, const Subscriber& subscriber) {
+    std::vector<Node*> path;
+    walk(compile(pattern), true, path);
+    auto& entries = path.back()->entries;
+    auto entry = std::find_if(entries.begin(), entries.end(), [&](const auto& e) { return e.first == pattern; });
+    if (entry == entries.end()) {
+        entries.emplace_back(pattern, std::vector<Subscriber>{subscriber});
+        pattern_count_++;
+        return true;
+    }
+    if (std::find(entry->second.begin(), entry->second.end(), subscriber) != entry->second.end()) {
+        return false;
+    }
+    entry->second.push_back(subscriber);
+    return true;
+}
+
+bool PatternTrie::remove(const std::string& pattern, const Subscriber& subscriber) {
+    const std::vector<Token> tokens = compile(pattern);
+    std::vector<Node*> path;
+    if (!walk(tokens, false, path)) {
+        return false;
+    }
+    auto& entries = path.back()->entries;
+    auto entry = std::find_if(entries.begin(), entries.end(), [&](const auto& e) { return e.first == pattern; });
+    if (entry == entries.end()) {
+        return false;
+    }
+    auto& subscribers = entry->second;
+    auto it = std::find(subscribers.begin(), subscribers.end(), subscriber);
+    if (it == subscribers.end()) {
+        return false;
+    }
+    *it = subscribers.back();
+    subscribers.pop_back();
+    if (subscribers.empty()) {
+        entries.erase(entry);
+        pattern_count_--;
+    }
+    // 自下而上剪除没有模式经过的节点
+    for (size_t i = path.size() - 1; i > 0 && path[i]->unused(); --i) {
+        Node* parent = path[i - 1];
+        const Token& token = tokens[i - 1];
+        if (token.kind == Token::LITERAL) {
+            parent->literals.erase(token.ch);
+        } else {
+            auto child = std::find_if(parent->wildcards.begin(), parent->wildcards.end(),
+                                      [&](const auto& w) { return w.second.get() == path[i]; });
+            parent->wildcards.erase(child);
+        }
+    }
+    return true;
+}
+
+void PatternTrie::addState(const Node* node, std::vector<const Node*>& states) const {
+    if (node->mark == epoch_) {
+        return;
+    }
+    node->mark = epoch_;
+    states.push_back(node);
+    // *可以匹配空串，其后的节点同时可达
+    for (const auto& [token, child] : node->wildcards) {
+        if (token.kind == Token::STAR) {
+            addState(child.get(), states);
+        }
+    }
+}
+
+void PatternTrie::match(std::string_view channel,
+                        const std::function<void(const std::string&, const std::vector<Subscriber>&)>& fn) const {
+    if (pattern_count_ == 0) {
+        return;
+    }
+    std::vector<const Node*> states;
+    std::vector<const Node*> next;
+    ++epoch_;
+    addState(root_.get(), states);
+    for (char c : channel) {
+        ++epoch_;
+        next.clear();
+        for (const Node* node : states) {
+            if (node->star) {
+                addState(node, next);
+            }
+            auto it = node->literals.find(c);
+            if (it != node->literals.end()) {
+                addState(it->second.get(), next);
+            }
+            for (const auto& [token, child] : node->wildcards) {
+                if (token.kind == Token::ANY ||
+                    (token.kind == Token::CLASS && token.set.test(static_cast<uint8_t>(c)))) {
+                    addState(child.get(), next);
+                }
+            }
+        }
+        states.swap(next);
+        if (states.empty()) {
+            return;
+        }
+    }
+    for (const Node* node : states) {
+        for (const auto& [pattern, subscribers] : node->entries) {
+            fn(pattern, subscribers);
+        }
+    }
+}
+
+void PubSub::init(const std::vector<SubReactor*>& reactors) {
+    shards_.clear();
+    for (SubReactor* reactor : reactors) {
+        if (shards_.size() <= reactor->index()) {
+            shards_.resize(reactor->index() + 1);
+        }
+        shards_[reactor->index()] = std::make_unique<Shard>();
+        shards_[reactor->index()]->reactor = reactor;
+    }
+}
+
+PubSub::Shard* PubSub::shardOf(SubReactor* reactor) const {
+    if (!reactor || reactor->index() >= shards_.size()) {
+        return nullptr;
+    }
+    Shard* shard = shards_[reactor->index()].get();
+    return shard && shard->reactor == reactor ? shard : nullptr;
+}
+
+void PubSub::removeChannelSubscriber_locked(Shard& shard, const std::string& channel, const Subscriber& subscriber) {
+    auto it = shard.channels.find(channel);
+    if (it == shard.channels.end()) {
+        return;
+    }
+    auto& subscribers = it->second;
+    auto pos = std::find(subscribers.begin(), subscribers.end(), subscriber);
+    if (pos != subscribers.end()) {
+        *pos = subscribers.back();
+        subscribers.pop_back();
+    }
+    if (subscribers.empty()) {
+        shard.channels.erase(it);
+    }
+}
+
+size_t PubSub::subscribe(SubReactor* reactor, int fd, uint64_t connection_id, const std::string& channel) {
+    Shard* shard = shardOf(reactor);
+    if (!shard) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    ClientSubscriptions& client = shard->clients[connection_id];
+    client.fd = fd;
+    if (client.channels.insert(channel).second) {
+        shard->channels[channel].emplace_back(fd, connection_id);
+    }
+    return client.channels.size() + client.patterns.size();
+}
+
+size_t PubSub::psubscribe(SubReactor* reactor, int fd, uint64_t connection_id, const std::string& pattern) {
+    Shard* shard = shardOf(reactor);
+    if (!shard) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    ClientSubscriptions& client = shard->clients[connection_id];
+    client.fd = fd;
+    if (client.patterns.insert(pattern).second) {
+        shard->patterns.add(pattern, Subscriber(fd, connection_id));
+    }
+    return client.channels.size() + client.patterns.size();
+}
+
+size_t PubSub::unsubscribe(SubReactor* reactor, uint64_t connection_id, const std::string& channel) {
+    Shard* shard = shardOf(reactor);
+    if (!shard) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto it = shard->clients.find(connection_id);
+    if (it == shard->clients.end()) {
+        return 0;
+    }
+    ClientSubscriptions& client = it->second;
+    if (client.channels.erase(channel)) {
+        removeChannelSubscriber_locked(*shard, channel, Subscriber(client.fd, connection_id));
+    }
+    size_t remaining = client.channels.size() + client.patterns.size();
+    if (remaining == 0) {
+        shard->clients.erase(it);
+    }
+    return remaining;
+}
+
+size_t PubSub::punsubscribe(SubReactor* reactor, uint64_t connection_id, const std::string& pattern) {
+    Shard* shard = shardOf(reactor);
+    if (!shard) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto it = shard->clients.find(connection_id);
+    if (it == shard->clients.end()) {
+        return 0;
+    }
+    ClientSubscriptions& client = it->second;
+    if (client.patterns.erase(pattern)) {
+        shard->patterns.remove(pattern, Subscriber(client.fd, connection_id));
+    }
+    size_t remaining = client.channels.size() + client.patterns.size();
+    if (remaining == 0) {
+        shard->clients.erase(it);
+    }
+    return remaining;
+}
+
+std::vector<std::string> PubSub::channelsOf(SubReactor* reactor, uint64_t connection_id) const {
+    Shard* shard = shardOf(reactor);
+    if (!shard) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto it = shard->clients.find(connection_id);
+    if (it == shard->clients.end()) {
+        return {};
+    }
+    return std::vector<std::string>(it->second.channels.begin(), it->second.channels.end());
+}
+
+std::vector<std::string> PubSub::patternsOf(SubReactor* reactor, uint64_t connection_id) const {
+    Shard* shard = shardOf(reactor);
+    if (!shard) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto it = shard->clients.find(connection_id);
+    if (it == shard->clients.end()) {
+        return {};
+    }
+    return std::vector<std::string>(it->second.patterns.begin(), it->second.patterns.end());
+}
+
+void PubSub::removeClient(SubReactor* reactor, uint64_t connection_id) {
+    Shard* shard = shardOf(reactor);
+    if (!shard) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto it = shard->clients.find(connection_id);
+    if (it == shard->clients.end()) {
+        return;
+    }
+    const Subscriber subscriber(it->second.fd, connection_id);
+    for (const auto& channel : it->second.channels) {
+        removeChannelSubscriber_locked(*shard, channel, subscriber);
+    }
+    for (const auto& pattern : it->second.patterns) {
+        shard->patterns.remove(pattern, subscriber);
+    }
+    shard->clients.erase(it);
+}
+
+size_t PubSub::publish(const std::string& channel, const std::string& message) {
+    // 频道订阅者共享同一块缓冲区，第一次有订阅者时才编码；同一模式在各分片也只编码一次
+    std::shared_ptr<const std::string> payload;
+    std::unordered_map<std::string, std::shared_ptr<const std::string>> pattern_payloads;
+    auto encode = [&](const std::string* pattern) {
+        auto buffer = std::make_shared<std::string>();
+        RESPWriter(*buffer).writePubSubMessage(pattern, channel, message);
+        return std::shared_ptr<const std::string>(std::move(buffer));
+    };
+
+    size_t receivers = 0;
+    std::vector<Subscriber> targets;
+    std::vector<std::pair<std::string, std::vector<Subscriber>>> pattern_targets;
+    for (const auto& shard : shards_) {
+        if (!shard) {
+            continue;
+        }
+        targets.clear();
+        pattern_targets.clear();
+        {
+            // 只在锁内复制订阅者，写入输出链需要SubReactor的锁，在锁外进行
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            auto it = shard->channels.find(channel);
+            if (it != shard->channels.end()) {
+                targets = it->second;
+            }
+            shard->patterns.match(channel, [&](const std::string& pattern, const std::vector<Subscriber>& subscribers) {
+                pattern_targets.emplace_back(pattern, subscribers);
+            });
+        }
+        if (!targets.empty()) {
+            if (!payload) {
+                payload = encode(nullptr);
+            }
+            receivers += shard->reactor->pushToClients(targets, payload);
+        }
+        for (const auto& [pattern, subscribers] : pattern_targets) {
+            auto& buffer = pattern_payloads[pattern];
+            if (!buffer) {
+                buffer = encode(&pattern);
+            }
+            receivers += shard->reactor->pushToClients(subscribers, buffer);
+        }
+    }
+    return receivers;
+}
+
+size_t PubSub::channels() const {
+    // 同一频道在多个分片都有订阅者时分别计数
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        if (shard) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            total += shard->channels.size();
+        }
+    }
+    return total;
+}
+
+size_t PubSub::patterns() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        if (shard) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            total += shard->patterns.patterns();
+        }
+    }
+    return total;
+}
+
+} // namespace dkv
@@ -0,0 +1,151 @@
+#include "dkv_script_cache.hpp"
+#include "dkv_utils.hpp"
+#include "dkv_script.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace dkv {
+
+namespace {
+
+// 转发脚本的command()调用，返回的字符串由VM释放
+char* scriptCommandTrampoline(const char* command, void* user_data) {
+    if (!command || !user_data) {
+        return strdup("Error: Invalid parameters");
+    }
+    const auto& callback = *static_cast<const ScriptCommandCallback*>(user_data);
+    try {
+        return strdup(callback(command).c_str());
+    } catch (const std::exception& e) {
+        return strdup(("Error: " + std::string(e.what())).c_str());
+    } catch (...) {
+        return strdup("Error: Unknown exception");
+    }
+}
+
+struct VMDeleter {
+    void operator()(DkvScriptVM* vm) const { dkv_script_free_vm(vm); }
+};
+
+} // namespace
+
+CompiledScript::~CompiledScript() {
+    dkv_script_free_compile_result(result_);
+}
+
+std::shared_ptr<const CompiledScript> CompiledScript::compile(const std::string& source) {
+    DkvScriptCompileResult* result = nullptr;
+    if (dkv_script_compile(source.c_str(), &result) != SUCCESS || !result) {
+        throw std::runtime_error("Failed to compile script");
+    }
+    return std::make_shared<const CompiledScript>(result);
+}
+
+void CompiledScript::run(const ScriptCommandCallback& callback) const {
+    DkvScriptVM* raw_vm = nullptr;
+    if (dkv_script_create_vm(result_, &raw_vm) != SUCCESS || !raw_vm) {
+        throw std::runtime_error("Failed to create VM");
+    }
+    std::unique_ptr<DkvScriptVM, VMDeleter> vm(raw_vm);
+    if (callback && dkv_script_set_dkv_command_handler(vm.get(), &scriptCommandTrampoline,
+                                                       const_cast<ScriptCommandCallback*>(&callback)) != SUCCESS) {
+        throw std::runtime_error("Failed to set DKV command handler");
+    }
+    if (dkv_script_run_vm(vm.get()) != SUCCESS) {
+        throw std::runtime_error("Failed to run VM");
+    }
+}
+
+std::string ScriptCache::load(const std::string& source) {
+    std::string sha1 = Utils::sha1Hex(source);
+    {   std::lock_guard<std::mutex> lock(mutex_);
+        if (touchLocked(sha1)) {
+            return sha1;
+        }
+    }
+    insert(sha1, source);
+    return sha1;
+}
+
+std::shared_ptr<const CompiledScript> ScriptCache::getOrCompile(const std::string& source) {
+    std::string sha1 = Utils::sha1Hex(source);
+    {   std::lock_guard<std::mutex> lock(mutex_);
+        if (auto script = touchLocked(sha1)) {
+            hits_++;
+            return script;
+        }
+        misses_++;
+    }
+    return insert(sha1, source);
+}
+
+std::shared_ptr<const CompiledScript> ScriptCache::find(const std::string& sha1) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto script = touchLocked(sha1);
+    if (script) {
+        hits_++;
+    } else {
+        misses_++;
+    }
+    return script;
+}
+
+bool ScriptCache::exists(const std::string& sha1) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return scripts_.count(sha1) > 0;
+}
+
+void ScriptCache::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    scripts_.clear();
+    lru_.clear();
+}
+
+void ScriptCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = std::max<size_t>(1, capacity);
+    evictLocked();
+}
+
+ScriptCacheStats ScriptCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ScriptCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.scripts = scripts_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+std::shared_ptr<const CompiledScript> ScriptCache::insert(const std::string& sha1, const std::string& source) {
+    std::shared_ptr<const CompiledScript> script = CompiledScript::compile(source);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto existing = touchLocked(sha1)) {
+        return existing;
+    }
+    lru_.push_front(sha1);
+    scripts_[sha1] = Entry{script, lru_.begin()};
+    evictLocked();
+    return script;
+}
+
+std::shared_ptr<const CompiledScript> ScriptCache::touchLocked(const std::string& sha1) {
+    auto it = scripts_.find(sha1);
+    if (it == scripts_.end()) {
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+    return it->second.script;
+}
+
+void ScriptCache::evictLocked() {
+    while (scripts_.size() > capacity_) {
+        scripts_.erase(lru_.back());
+        lru_.pop_back();
+        evictions_++;
+    }
+}
+
+} // namespace dkv
@@ -1,6 +1,11 @@
 #include "dkv_server.hpp"
+#include "dkv_cached_clock.hpp"
 #include "dkv_memory_allocator.hpp"
+#include "datatypes/dkv_listpack.hpp"
+#include "datatypes/dkv_datatype_string.hpp"
 #include "dkv_logger.hpp"
+#include "dkv_trace.hpp"
+#include "net/dkv_resp.hpp"
 #include "multinode/raft/dkv_raft.hpp"
 #include "multinode/raft/dkv_raft_network.hpp"
 #include "multinode/raft/dkv_raft_statemachine.hpp"
@@ -11,6 +16,10 @@
 #include <sstream>
 #include <chrono>
 #include <mutex>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <future>
 using namespace std;
 
 namespace dkv {
@@ -18,12 +27,14 @@ namespace dkv {
 DKVServer::DKVServer(int port, size_t num_sub_reactors, size_t num_workers) 
     : running_(false), cleanup_running_(false), 
       port_(port), max_memory_(0), num_sub_reactors_(num_sub_reactors), num_workers_(num_workers),
+      storage_segments_(InnerStorage::DEFAULT_SEGMENT_COUNT),
       enable_rdb_(true), rdb_filename_("dump.rdb"), rdb_save_interval_(3600), rdb_save_changes_(1000),
       rdb_changes_(0), last_save_time_(chrono::system_clock::now()), rdb_save_running_(false),
       enable_aof_(false), aof_filename_("appendonly.aof"), aof_fsync_policy_("everysec"),
-      auto_aof_rewrite_percentage_(100), auto_aof_rewrite_min_size_(64 * 1024 * 1024),
+      auto_aof_rewrite_percentage_(100), auto_aof_rewrite_min_size_(64 * 1024 * 1024), aof_rewrite_rate_limit_mb_(0),
       enable_raft_(false), raft_node_id_(0), total_raft_nodes_(1), max_raft_state_(100 * 1024 * 1024),
-      shard_data_dir_("./shard_data"), shard_raft_data_dir_("./shard_raft_data") {
+      shard_data_dir_("./shard_data"), shard_raft_data_dir_("./shard_raft_data"),
+      blocked_clients_([this](const Command& command) { return doCommandNative(command, NO_TX); }) {
     
     // 初始化默认分片配置
     InitializeDefaultShardConfig();
@@ -47,6 +58,11 @@ bool DKVServer::start() {
         return false;
     }
     
+    // 加载持久化数据期间没有客户端和后台线程访问存储，打开恢复模式省去分段锁
+    storage_engine_->setRecoveryMode(true);
+    // AOF重放和RAFT日志要求完整的初始状态，启用它们时仍同步加载RDB
+    const bool background_load = rdb_background_load_ && !enable_aof_ && !enable_raft_;
+
     // 初始化AOF组件
     if (enable_aof_) {
         DKV_LOG_INFO("初始化AOF持久化");
@@ -70,6 +86,7 @@ bool DKVServer::start() {
             // 设置AOF自动重写参数
             aof_persistence_->setAutoRewriteParams(auto_aof_rewrite_percentage_, auto_aof_rewrite_min_size_ / (1024 * 1024));
             DKV_LOG_INFO("AOF自动重写配置: 百分比=", auto_aof_rewrite_percentage_, "%, 最小大小=", auto_aof_rewrite_min_size_ / (1024 * 1024), "MB");
+            aof_persistence_->setRewriteRateLimit(aof_rewrite_rate_limit_mb_ * 1024 * 1024);
             
             // 从AOF文件加载数据
             if (aof_persistence_->loadFromFile(this)) {
@@ -83,14 +100,25 @@ bool DKVServer::start() {
     } else {
         DKV_LOG_INFO("AOF持久化已禁用");
         // 尝试从RDB文件加载数据
-        loadRDBFromConfig();
+        if (!background_load) {
+            loadRDBFromConfig();
+        }
+    }
+    storage_engine_->setRecoveryMode(false);
+    // 后台加载与命令并发写入，需要分段锁，在退出恢复模式之后开始
+    if (background_load) {
+        loadRDBFromConfig(true);
     }
     
     running_ = true;
     cleanup_running_ = true;
+    CachedClock::start();
     
     // 启动清理线程
     cleanup_thread_ = thread(&DKVServer::cleanupExpiredKeys, this);
+    if (mvcc_purge_interval_ms_ > 0) {
+        purge_thread_ = thread(&DKVServer::purgeMVCCVersions, this);
+    }
     
     // 启动RDB自动保存线程
     if (enable_rdb_) {
@@ -104,12 +132,21 @@ bool DKVServer::start() {
         stop();
         return false;
     }
+
+    // 启动监控指标导出，失败时不影响服务
+    if (metrics_port_ > 0) {
+        registerMetrics();
+        metrics_exporter_ = make_unique<MetricsExporter>(*metrics_registry_);
+        if (!metrics_exporter_->start(metrics_port_)) {
+            metrics_exporter_.reset();
+        }
+    }
     
     DKV_LOG_INFO("DKV服务启动成功");
     return true;
 }
 
-void DKVServer::loadRDBFromConfig() {
+void DKVServer::loadRDBFromConfig(bool background) {
     // 检查是否启用了RDB持久化
     if (!enable_rdb_) {
         DKV_LOG_INFO("RDB持久化已禁用");
@@ -120,7 +157,11 @@ void DKVServer::loadRDBFromConfig() {
     string rdb_file = rdb_filename_;
     
     if (storage_engine_ && !rdb_file.empty()) {
-        if (!storage_engine_->loadRDB(rdb_file)) {
+        if (background && storage_engine_->loadRDBInBackground(rdb_file, storage_engine_->getRDBThreads())) {
+            // 文件中的数据尚未全部载入，但都已在文件中，不算作变更
+            last_save_time_ = chrono::system_clock::now();
+            rdb_changes_ = 0;
+        } else if (!storage_engine_->loadRDB(rdb_file)) {
             DKV_LOG_WARNING("无法加载RDB文件 ", rdb_file.c_str(), "，可能是文件不存在或格式不正确");
         } else {
             DKV_LOG_INFO("成功从RDB文件 ", rdb_file.c_str(), " 加载数据");
@@ -141,6 +182,12 @@ void DKVServer::stop() {
     DKV_LOG_INFO("开始停止DKV服务器");
     running_ = false;
     cleanup_running_ = false;
+
+    // 指标读取各组件的状态，先于各组件停止
+    if (metrics_exporter_) {
+        metrics_exporter_->stop();
+        metrics_exporter_.reset();
+    }
     
     // 保存数据到RDB文件
     saveRDBFromConfig();
@@ -168,6 +215,9 @@ void DKVServer::stop() {
     if (cleanup_thread_.joinable()) {
         cleanup_thread_.join();
     }
+    if (purge_thread_.joinable()) {
+        purge_thread_.join();
+    }
     
     // 停止RDB自动保存线程
     DKV_LOG_INFO("等待RDB自动保存线程结束");
@@ -193,6 +243,7 @@ void DKVServer::stop() {
         shard_manager_->Stop();
         shard_manager_.reset();
     }
+    CachedClock::stop();
     
     DKV_LOG_INFO("DKV服务已停止");
 }
@@ -259,6 +310,17 @@ size_t DKVServer::getMaxMemory() const {
 
 void DKVServer::setEvictionPolicy(EvictionPolicy policy) {
     eviction_policy_ = policy;
+    // 不同策略的分数不可比较
+    lock_guard<mutex> lock(eviction_mutex_);
+    eviction_pool_.clear();
+}
+
+void DKVServer::setMaxMemorySamples(size_t samples) {
+    maxmemory_samples_ = max<size_t>(1, samples);
+}
+
+void DKVServer::setMVCCPurgeInterval(uint64_t interval_ms) {
+    mvcc_purge_interval_ms_ = interval_ms;
 }
 
 EvictionPolicy DKVServer::getEvictionPolicy() const {
@@ -277,14 +339,39 @@ TransactionIsolationLevel DKVServer::getTransactionIsolationLevel() const {
     return transaction_isolation_level_;
 }
 
-void recordCommandForAOF(TransactionID tx_id, const Command& command, unique_ptr<dkv::CommandHandler>& command_handler, unique_ptr<dkv::TransactionManager>& transaction_manager) {
-    if (!isReadOnlyCommand(command.type)) {
-        if (tx_id == NO_TX) {
-            command_handler->appendAOFCommand(command);
-        } else {
-            transaction_manager->getTransactionMut(tx_id).push_command(command);
-        }
+void recordCommandForAOF(TransactionID tx_id, const Command& command, dkv::CommandHandler* command_handler, unique_ptr<dkv::TransactionManager>& transaction_manager) {
+    // 脚本中执行的写命令各自记录，脚本本身不记录：重放时不会重复执行，EVALSHA也不依赖脚本缓存
+    // 事务控制命令不记录，事务的写命令在提交时作为一条记录写入
+    // 阻塞命令执行后由recordBlockingCommandForAOF按结果记录
+    if (commandSpec(command.type).hasFlag(CMD_READONLY | CMD_NO_AOF | CMD_TX_CONTROL | CMD_BLOCKING)) {
+        return;
+    }
+    if (tx_id == NO_TX) {
+        TraceSpan span("aof_append");
+        command_handler->appendAOFCommand(command);
+    } else {
+        transaction_manager->getTransactionMut(tx_id).push_command(command);
+    }
+}
+
+// 阻塞命令只在取到元素时记录，并改写为等价的非阻塞命令：列表为空的尝试不写入AOF，重放时也不会等待
+void recordBlockingCommandForAOF(TransactionID tx_id, const Command& command, const Response& response,
+                                 dkv::CommandHandler* command_handler, unique_ptr<dkv::TransactionManager>& transaction_manager) {
+    Command rewritten;
+    switch (command.type) {
+        case CommandType::BLPOP:
+            rewritten = Command(CommandType::LPOP, {response.elements[0]});
+            break;
+        case CommandType::BRPOP:
+            rewritten = Command(CommandType::RPOP, {response.elements[0]});
+            break;
+        case CommandType::BLMOVE:
+            rewritten = Command(CommandType::LMOVE, {command.args.begin(), command.args.begin() + 4});
+            break;
+        default:
+            return;
     }
+    recordCommandForAOF(tx_id, rewritten, command_handler, transaction_manager);
 }
 
 void DKVServer::evictKeys(TransactionID tx_id) {
@@ -293,110 +380,110 @@ void DKVServer::evictKeys(TransactionID tx_id) {
         return;
     }
     
-    // 获取存储引擎的所有键
-    vector<Key> all_keys = storage_engine_->getAllKeys();
-    
-    // 根据不同的淘汰策略选择要淘汰的键
-    vector<Key> keys_to_evict;
-    
-    // 目标内存使用量（低于最大内存限制的一定比例）
-    size_t target_usage = max_memory_ * 0.8; // 目标内存使用量为最大内存的80%
-    size_t current_usage = getMemoryUsage();
-    
-    // 收集符合条件的键
-    vector<Key> eligible_keys;
-    for (const auto& key : all_keys) {
-        // 检查键是否满足淘汰条件
-        bool eligible = false;
-        
-        // 根据策略类型过滤键
-        switch (eviction_policy_) {
-            case EvictionPolicy::VOLATILE_LRU:
-            case EvictionPolicy::VOLATILE_LFU:
-            case EvictionPolicy::VOLATILE_RANDOM:
-            case EvictionPolicy::VOLATILE_TTL:
-                // 只考虑有过期时间的键
-                eligible = storage_engine_->hasExpiration(key);
-                break;
-            case EvictionPolicy::ALLKEYS_LRU:
-            case EvictionPolicy::ALLKEYS_LFU:
-            case EvictionPolicy::ALLKEYS_RANDOM:
-                // 考虑所有键
-                eligible = true;
-                break;
-            default:
-                // NOEVICTION等其他策略不执行淘汰
-                return;
-        }
-        
-        if (eligible) {
-            eligible_keys.push_back(key);
-        }
-    }
-    
-    if (eligible_keys.empty()) {
-        DKV_LOG_WARNING("没有符合条件的键可以淘汰");
-        return;
-    }
-    
-    // 根据策略选择要淘汰的键
+    // 根据策略类型确定候选范围
+    bool volatile_only = false;
+    bool random_pick = false;
     switch (eviction_policy_) {
         case EvictionPolicy::VOLATILE_LRU:
-        case EvictionPolicy::ALLKEYS_LRU:
-            // LRU策略：淘汰最后访问时间最早的键
-            {
-                sort(eligible_keys.begin(), eligible_keys.end(), [this](const Key& a, const Key& b) {
-                    return storage_engine_->getLastAccessed(a) < storage_engine_->getLastAccessed(b);
-                });
-                break;
-            }
         case EvictionPolicy::VOLATILE_LFU:
-        case EvictionPolicy::ALLKEYS_LFU:
-            // LFU策略：淘汰访问频率最低的键
-            {
-                sort(eligible_keys.begin(), eligible_keys.end(), [this](const Key& a, const Key& b) {
-                    return storage_engine_->getAccessFrequency(a) < storage_engine_->getAccessFrequency(b);
-                });
-                break;
-            }
         case EvictionPolicy::VOLATILE_TTL:
-            // TTL策略：淘汰TTL最小的键
-            {
-                sort(eligible_keys.begin(), eligible_keys.end(), [this](const Key& a, const Key& b) {
-                    return storage_engine_->getExpiration(a) < storage_engine_->getExpiration(b);
-                });
-                break;
-            }
+            // 只考虑有过期时间的键
+            volatile_only = true;
+            break;
         case EvictionPolicy::VOLATILE_RANDOM:
+            volatile_only = true;
+            random_pick = true;
+            break;
+        case EvictionPolicy::ALLKEYS_LRU:
+        case EvictionPolicy::ALLKEYS_LFU:
+            // 考虑所有键
+            break;
         case EvictionPolicy::ALLKEYS_RANDOM:
-            // 随机策略：打乱键的顺序
-            {
-                random_shuffle(eligible_keys.begin(), eligible_keys.end());
-                break;
-            }
+            random_pick = true;
+            break;
         default:
+            // NOEVICTION等其他策略不执行淘汰；分层存储按LRU选择移到磁盘的键
+            if (!storage_engine_->tieredEnabled()) {
+                return;
+            }
             break;
     }
+    const bool tiered = storage_engine_->tieredEnabled();
     
-    // 开始淘汰键，直到达到目标内存使用量或没有更多键可淘汰
+    // 按策略计算淘汰分数，分数越大越优先淘汰
+    const auto now = CachedClock::now();
+    auto score = [this, now](const DataItem& item) -> uint64_t {
+        switch (eviction_policy_) {
+            case EvictionPolicy::VOLATILE_LFU:
+            case EvictionPolicy::ALLKEYS_LFU:
+                // 对数计数已按空闲时间衰减
+                return 255 - min<uint64_t>(item.getAccessFrequency(), 255);
+            case EvictionPolicy::VOLATILE_TTL: {
+                auto expire_ms = chrono::duration_cast<chrono::milliseconds>(item.getExpiration().time_since_epoch()).count();
+                return numeric_limits<uint64_t>::max() - static_cast<uint64_t>(max<int64_t>(expire_ms, 0));
+            }
+            default: {
+                auto idle_ms = chrono::duration_cast<chrono::milliseconds>(now - item.getLastAccessed()).count();
+                return static_cast<uint64_t>(max<int64_t>(idle_ms, 0));
+            }
+        }
+    };
+    
+    // 每轮采样少量键，候选池跨轮次和跨命令保留；单次调用的轮数有上限，避免一条写命令承担无界的淘汰开销
     size_t evicted_count = 0;
-    for (const auto& key : eligible_keys) {
-        // 检查是否已经达到目标内存使用量
-        if (current_usage <= target_usage) {
-            break;
+    for (size_t round = 0; round < MAX_EVICTION_ROUNDS && getMemoryUsage() >= max_memory_; ++round) {
+        Key victim;
+        {
+            lock_guard<mutex> lock(eviction_mutex_);
+            size_t sampled = 0;
+            storage_engine_->sampleKeys(maxmemory_samples_, [&](const SharedKey& key, const DataItem& item) {
+                if (sampled >= maxmemory_samples_ || (volatile_only && !item.hasExpiration()) ||
+                    (tiered && item.isSpilled())) {
+                    return;
+                }
+                sampled++;
+                if (random_pick) {
+                    if (victim.empty()) {
+                        victim = key.str();
+                    }
+                } else {
+                    eviction_pool_.offer(key, score(item));
+                }
+            });
+            if (!random_pick) {
+                eviction_pool_.pop(victim);
+            }
+        }
+        if (victim.empty()) {
+            continue;
+        }
+        if (tiered) {
+            // 不删除键，只把值移到磁盘。这是本机内的移动，不写AOF也不经过Raft
+            if (storage_engine_->spill(victim)) {
+                DKV_LOG_DEBUG("移到磁盘: ", victim.c_str());
+                evicted_count++;
+            }
+            continue;
         }
         
-        // 删除键
-        size_t key_size = storage_engine_->getKeySize(key);
-        Command del_cmd(CommandType::DEL, {string(key)});  // todo: generate a batch delete command to avoid waiting for raft commit for too much time
+        // 候选池中的键可能已被删除，DEL返回0时不计入；lazyfree_lazy_eviction时用UNLINK在后台释放
+        Command del_cmd(lazyfree_config_.lazy_eviction ? CommandType::UNLINK : CommandType::DEL, {victim});  // todo: generate a batch delete command to avoid waiting for raft commit for too much time
         Response response = executeCommand(del_cmd, tx_id);
-        if (response.status == ResponseStatus::OK) {
-            DKV_LOG_INFO("淘汰键: ", key.c_str(), " 大小: ", key_size);
-            current_usage -= key_size;
+        if (response.status == ResponseStatus::OK && response.data != "0") {
+            DKV_LOG_DEBUG("淘汰键: ", victim.c_str());
             evicted_count++;
         }
     }
     
+    if (tiered) {
+        DKV_LOG_DEBUG("分层存储本次移到磁盘 ", evicted_count, " 个键");
+        return;
+    }
+    evicted_keys_.fetch_add(evicted_count, std::memory_order_relaxed);
+    if (evicted_count == 0) {
+        DKV_LOG_WARNING("没有符合条件的键可以淘汰");
+        return;
+    }
     DKV_LOG_INFO("执行淘汰策略完成，共淘汰了 ", evicted_count, " 个键");
 }
 
@@ -417,7 +504,155 @@ void DKVServer::setRDBSaveChanges(uint64_t changes) {
     rdb_save_changes_ = changes;
 }
 
+void DKVServer::setRDBThreads(size_t threads) {
+    rdb_threads_ = threads;
+}
+
+void DKVServer::setRDBCompression(RDBCompression compression) {
+    rdb_compression_ = compression;
+}
+
+void DKVServer::setRDBBackgroundLoad(bool enabled) {
+    rdb_background_load_ = enabled;
+}
+
 // AOF持久化配置方法实现
+void DKVServer::setClientOutputLimit(const ClientOutputLimit& limit) {
+    client_output_limit_ = limit;
+}
+
+void DKVServer::setRunToCompletion(bool enabled) {
+    run_to_completion_ = enabled;
+}
+
+void DKVServer::setSlowLane(const SlowLaneConfig& config) {
+    slow_lane_ = config;
+}
+
+void DKVServer::setMetricsPort(int port) {
+    metrics_port_ = port;
+}
+
+int DKVServer::getMetricsPort() const {
+    return metrics_exporter_ ? metrics_exporter_->port() : 0;
+}
+
+void DKVServer::registerMetrics() {
+    metrics_registry_ = make_unique<MetricsRegistry>();
+    MetricsRegistry& registry = *metrics_registry_;
+
+    // 命令计数与耗时，来自延迟统计的直方图
+    registry.addFamily("dkv_commands_total", "Commands executed locally, by command", MetricType::COUNTER,
+                       [this](vector<MetricSample>& samples) {
+        for (size_t i = 0; i < COMMAND_COUNT; ++i) {
+            CommandType type = static_cast<CommandType>(i);
+            uint64_t calls = latency_monitor_.command(type).count();
+            if (calls > 0) {
+                string name = Utils::commandTypeToString(type);
+                transform(name.begin(), name.end(), name.begin(), ::tolower);
+                samples.push_back(MetricSample{"", "cmd=\"" + name + "\"", static_cast<double>(calls)});
+            }
+        }
+    });
+    registry.addFamily("dkv_command_duration_microseconds_total", "Time spent executing commands, by command",
+                       MetricType::COUNTER, [this](vector<MetricSample>& samples) {
+        for (size_t i = 0; i < COMMAND_COUNT; ++i) {
+            CommandType type = static_cast<CommandType>(i);
+            const HdrHistogram& histogram = latency_monitor_.command(type);
+            if (histogram.count() > 0) {
+                string name = Utils::commandTypeToString(type);
+                transform(name.begin(), name.end(), name.begin(), ::tolower);
+                samples.push_back(MetricSample{"", "cmd=\"" + name + "\"", static_cast<double>(histogram.sum())});
+            }
+        }
+    });
+
+    // 工作线程池与连接
+    registry.addGauge("dkv_worker_queue_depth", "Tasks waiting in the worker pool queues", [this]() {
+        return static_cast<double>(worker_pool_->queuedTasks());
+    });
+    registry.addGauge("dkv_worker_slow_queue_depth", "Tasks waiting in the slow command lane", [this]() {
+        return static_cast<double>(worker_pool_->queuedSlowTasks());
+    });
+    registry.addFamily("dkv_connected_clients", "Open client connections, by SubReactor", MetricType::GAUGE,
+                       [this](vector<MetricSample>& samples) {
+        for (size_t i = 0; i < network_server_->reactorCount(); ++i) {
+            samples.push_back(MetricSample{"", "reactor=\"" + to_string(i) + "\"",
+                                           static_cast<double>(network_server_->reactor(i).connectedClients())});
+        }
+    });
+    registry.addCounter("dkv_connections_received_total", "Client connections accepted", [this]() {
+        uint64_t total = 0;
+        for (size_t i = 0; i < network_server_->reactorCount(); ++i) {
+            total += network_server_->reactor(i).connectionsReceived();
+        }
+        return static_cast<double>(total);
+    });
+
+    // 持久化与复制
+    if (aof_persistence_) {
+        registry.addSummary("dkv_aof_fsync_duration_microseconds", "AOF fdatasync latency",
+                            aof_persistence_->fsyncLatency());
+    }
+    if (raft_) {
+        registry.addGauge("dkv_raft_commit_index", "Raft commit index", [this]() {
+            return static_cast<double>(raft_->GetProgress().commitIndex);
+        });
+        registry.addGauge("dkv_raft_commit_lag", "Raft log entries not yet committed", [this]() {
+            RaftProgress progress = raft_->GetProgress();
+            return static_cast<double>(max(0, progress.lastLogIndex - progress.commitIndex));
+        });
+        registry.addGauge("dkv_raft_apply_lag", "Committed Raft log entries not yet applied", [this]() {
+            RaftProgress progress = raft_->GetProgress();
+            return static_cast<double>(max(0, progress.commitIndex - progress.lastApplied));
+        });
+    }
+
+    // MVCC、内存与键空间
+    registry.addGauge("dkv_mvcc_max_chain_length", "Longest MVCC version chain seen by the last purge pass", [this]() {
+        return static_cast<double>(storage_engine_->getMVCCMaxChainLength());
+    });
+    registry.addGauge("dkv_mvcc_history_versions", "MVCC history versions retained after the last purge pass", [this]() {
+        return static_cast<double>(storage_engine_->getMVCCHistoryVersions());
+    });
+    registry.addGauge("dkv_memory_used_bytes", "Bytes allocated through the memory allocator", []() {
+        return static_cast<double>(MemoryAllocator::getInstance().getCurrentUsage());
+    });
+    registry.addGauge("dkv_memory_max_bytes", "Configured maxmemory, 0 means unlimited", [this]() {
+        return static_cast<double>(max_memory_);
+    });
+    registry.addCounter("dkv_evicted_keys_total", "Keys evicted by the maxmemory policy", [this]() {
+        return static_cast<double>(evicted_keys_.load(std::memory_order_relaxed));
+    });
+    registry.addCounter("dkv_expired_keys_total", "Keys removed after expiring", [this]() {
+        return static_cast<double>(storage_engine_->getExpiredKeys());
+    });
+    if (storage_engine_->tieredEnabled()) {
+        registry.addGauge("dkv_tiered_spilled_keys", "Keys whose value lives in the tiered storage log", [this]() {
+            return static_cast<double>(storage_engine_->getTieredStats().spilled_keys);
+        });
+        registry.addCounter("dkv_tiered_loads_total", "Values read back from the tiered storage log", [this]() {
+            return static_cast<double>(storage_engine_->getTieredStats().loads);
+        });
+    }
+}
+
+void DKVServer::setTieredStorage(const TieredConfig& config) {
+    tiered_config_ = config;
+}
+
+void DKVServer::setReusePort(bool enabled) {
+    reuseport_ = enabled;
+}
+
+void DKVServer::setIoBackend(IoBackend backend) {
+    io_backend_ = backend;
+}
+
+void DKVServer::setCpuAffinity(const CpuAffinityConfig& config) {
+    cpu_affinity_ = config;
+}
+
 void DKVServer::setAOFEnabled(bool enabled) {
     enable_aof_ = enabled;
 }
@@ -438,11 +673,8 @@ bool DKVServer::rewriteAOF() {
     
     DKV_LOG_INFO("开始执行AOF重写");
     
-    // 生成临时文件名
-    string temp_filename = aof_filename_ + ".tmp";
-    
     // 执行AOF重写
-    if (aof_persistence_->rewrite(storage_engine_.get(), temp_filename)) {
+    if (aof_persistence_->rewrite(storage_engine_.get())) {
         DKV_LOG_INFO("AOF重写成功");
         return true;
     } else {
@@ -455,16 +687,46 @@ bool DKVServer::initialize() {
     DKV_LOG_INFO("开始初始化DKV服务器");
     
     // 创建存储引擎实例
-    DKV_LOG_DEBUG("创建存储引擎实例");
-    storage_engine_ = make_unique<StorageEngine>();
+    DKV_LOG_DEBUG("创建存储引擎实例，键空间分段数: ", storage_segments_);
+    storage_engine_ = make_unique<StorageEngine>(transaction_isolation_level_, storage_segments_);
+    storage_engine_->setRDBThreads(rdb_threads_);
+    storage_engine_->setRDBCompression(rdb_compression_);
+    storage_engine_->setLazyFreeConfig(lazyfree_config_);
+    if (tiered_config_.enabled) {
+        if (shard_config_ && shard_config_->enable_sharding) {
+            DKV_LOG_WARNING("分片模式下不支持分层存储，忽略tiered_storage");
+        } else if (!storage_engine_->enableTieredStorage(tiered_config_)) {
+            return false;
+        }
+    }
     
     // 创建工作线程池
     DKV_LOG_DEBUG("创建工作线程池，线程数: ", num_workers_);
-    worker_pool_ = make_unique<WorkerThreadPool>(this, num_workers_);
+    // 按SubReactor数量分组，同一SubReactor的任务优先由同组线程执行
+    worker_pool_ = make_unique<WorkerThreadPool>(this, num_workers_, num_sub_reactors_, slow_lane_);
 
     // 创建网络服务实例（使用多线程Reactor模式）
     DKV_LOG_DEBUG("创建网络服务实例，端口: ", port_, ", SubReactor数量: ", num_sub_reactors_);
-    network_server_ = make_unique<NetworkServer>(worker_pool_.get(), port_, num_sub_reactors_);
+    network_server_ = make_unique<NetworkServer>(worker_pool_.get(), port_, num_sub_reactors_, io_backend_);
+    network_server_->setClientOutputLimit(client_output_limit_);
+    network_server_->setReusePort(reuseport_);
+    if (!cpu_affinity_.reactor_cpus.empty() || !cpu_affinity_.worker_cpus.empty() || cpu_affinity_.numa_aware) {
+        vector<size_t> worker_groups;
+        for (size_t i = 0; i < worker_pool_->size(); ++i) {
+            worker_groups.push_back(worker_pool_->groupOf(i));
+        }
+        CpuPlacement placement = planCpuPlacement(cpu_affinity_, num_sub_reactors_, worker_groups, numaNodeCpus());
+        network_server_->setReactorCpus(placement.reactors);
+        for (size_t i = 0; i < placement.workers.size(); ++i) {
+            worker_pool_->pinWorker(i, placement.workers[i]);
+        }
+    }
+    if (run_to_completion_ && (enable_raft_ || (shard_config_ && shard_config_->enable_sharding))) {
+        // 写命令需要等待Raft提交或转发到其他分片，不能阻塞事件循环线程
+        DKV_LOG_WARNING("启用Raft或分片时不支持run-to-completion模式，命令仍交给工作线程池执行");
+    } else {
+        network_server_->setRunToCompletion(run_to_completion_);
+    }
 
     // 创建命令处理器
     DKV_LOG_DEBUG("创建命令处理器");
@@ -473,16 +735,26 @@ bool DKVServer::initialize() {
         nullptr, // AOF持久化稍后初始化
         enable_aof_
     );
+    command_handler_->scriptCache().setCapacity(script_cache_size_);
+    client_tracking_.setMaxKeys(tracking_table_max_keys_);
+    std::vector<SubReactor*> reactors;
+    for (size_t i = 0; i < network_server_->reactorCount(); ++i) {
+        reactors.push_back(&network_server_->reactor(i));
+    }
+    pubsub_.init(reactors);
+    network_server_->setDisconnectListener([this](SubReactor* reactor, uint64_t connection_id) {
+        client_tracking_.disable(reactor, connection_id);
+        pubsub_.removeClient(reactor, connection_id);
+        if (enable_raft_) {
+            lock_guard<mutex> lock(readonly_clients_mutex_);
+            readonly_clients_.erase({reactor, connection_id});
+        }
+    });
+    network_server_->setLatencyMonitor(&latency_monitor_);
     
     // 设置脚本命令执行回调
-    command_handler_->setScriptCommandCallback([this](const std::string& cmd_str, TransactionID tx_id) -> std::string {
-        size_t pos = 0;
-        Command cmd = RESPProtocol::parseCommand(cmd_str, pos);
-        if (cmd.type == CommandType::UNKNOWN) {
-            return "(error) ERR unknown command";
-        }
-        Response resp = doCommandNative(cmd, tx_id);
-        return resp.message.empty() ? resp.data : resp.message;
+    command_handler_->setScriptCommandCallback([this](const Command& cmd, TransactionID tx_id) {
+        return doCommandNative(cmd, tx_id);
     });
     
     // 初始化RAFT组件（如果启用）
@@ -494,6 +766,7 @@ bool DKVServer::initialize() {
         raft_state_machine_->SetCommandHandler(command_handler_.get());
         raft_state_machine_->SetStorageEngine(storage_engine_.get());
         raft_state_machine_->SetDKVServer(this);
+        raft_state_machine_->SetApplyWorkers(raft_apply_workers_);
         
         // 创建RAFT持久化
         raft_persister_ = std::make_shared<RaftFilePersister>(raft_data_dir_);
@@ -503,6 +776,9 @@ bool DKVServer::initialize() {
         
         // 创建RAFT实例
         raft_ = std::make_shared<Raft>(raft_node_id_, raft_peers_, raft_persister_, raft_network_, raft_state_machine_);
+        raft_->SetSnapshotRateLimit(raft_snapshot_rate_limit_);
+        raft_->SetReplicationBatchLimits(raft_max_batch_entries_, raft_max_batch_bytes_);
+        raft_->SetLeaseRead(raft_read_mode_ == RaftReadMode::LEASE);
 
         // 设置RAFT实例到网络组件
         auto tcp_network = std::dynamic_pointer_cast<RaftTcpNetwork>(raft_network_);
@@ -525,6 +801,13 @@ bool DKVServer::initialize() {
         
         // 设置分片配置
         if (shard_manager_) {
+            // 分片的Raft组与服务器自身的Raft共享一个网络传输；未开启RAFT但配置了集群节点时单独创建
+            auto raft_transport = std::dynamic_pointer_cast<RaftTcpNetwork>(raft_network_);
+            if (!raft_transport && !raft_peers_.empty()) {
+                raft_transport = std::make_shared<RaftTcpNetwork>(raft_node_id_, raft_peers_);
+            }
+            shard_manager_->SetRaftTransport(raft_transport, shard_raft_data_dir_);
+            
             // 初始化分片管理器
             if (!shard_manager_->Initialize(*shard_config_)) {
                 DKV_LOG_ERROR("分片管理器初始化失败");
@@ -549,35 +832,435 @@ bool DKVServer::initialize() {
 
 
 Response DKVServer::OnClientCommand(int client_fd, const Command& command) {
-    unique_lock<mutex> serializable_lock(serializable_mutex_, defer_lock);
-    if (transaction_isolation_level_ == TransactionIsolationLevel::SERIALIZABLE) {
-        serializable_lock.lock();
+    auto promise = make_shared<std::promise<Response>>();
+    auto future = promise->get_future();
+    OnClientCommand(client_fd, command, [promise](const Response& response) { promise->set_value(response); });
+    return future.get();
+}
+
+void DKVServer::OnClientCommand(int client_fd, const Command& command, CommandCallback done,
+                                SubReactor* reactor, uint64_t connection_id) {
+    // 参数个数先按命令表检查，奇偶等细节仍由各命令的处理函数检查
+    const CommandSpec& spec = commandSpec(command.type);
+    if (!spec.arityMatches(command.args.size())) {
+        done(Response(ResponseStatus::ERROR, "wrong number of arguments for '" + std::string(spec.name) + "' command"));
+        return;
     }
     int tx_id = NO_TX;
+    WatchedKeys watched_keys;
     if (transaction_isolation_level_ != TransactionIsolationLevel::READ_UNCOMMITTED) {
         shared_lock<shared_mutex> readlock_client_transaction_ids_(transaction_mutex_);
         auto it = client_transaction_ids_.find(client_fd);
         if (it != client_transaction_ids_.end()) {
             tx_id = it->second;
         }
+        if (command.type == CommandType::MULTI || command.type == CommandType::EXEC) {
+            auto watch_it = client_watched_keys_.find(client_fd);
+            if (watch_it != client_watched_keys_.end()) {
+                watched_keys = watch_it->second;
+            }
+        }
     }
-    Response response = executeCommand(command, tx_id);
-    if (response.status == ResponseStatus::OK) {
-        if (command.type == CommandType::MULTI) {
-            tx_id = stoi(response.message);
-            lock_guard writelock_client_transaction_ids_(transaction_mutex_);
-            client_transaction_ids_[client_fd] = tx_id;
-        } else if (command.type == CommandType::EXEC || command.type == CommandType::DISCARD) {
+    if (command.type == CommandType::WATCH || command.type == CommandType::UNWATCH) {
+        done(handleWatchCommand(client_fd, command, tx_id));
+        return;
+    }
+    if (command.type == CommandType::CLIENT) {
+        done(handleClientCommand(command, reactor, client_fd, connection_id));
+        return;
+    }
+    if (command.type == CommandType::READONLY || command.type == CommandType::READWRITE) {
+        done(handleReplicaReadCommand(command, reactor, connection_id));
+        return;
+    }
+    if (command.type == CommandType::SUBSCRIBE || command.type == CommandType::UNSUBSCRIBE ||
+        command.type == CommandType::PSUBSCRIBE || command.type == CommandType::PUNSUBSCRIBE) {
+        done(handleSubscribeCommand(command, reactor, client_fd, connection_id));
+        return;
+    }
+    // 在读取之前登记，读取与修改并发时宁可多发一次通知
+    if (reactor && client_tracking_.clients() > 0 && isReadOnlyCommand(command.type)) {
+        client_tracking_.recordRead(reactor, connection_id, command.keys());
+    }
+    // 命令完成后更新连接的事务状态，Raft写命令在日志应用后才执行这一步
+    CommandType type = command.type;
+    auto finish = [this, client_fd, type, watched_keys, done = std::move(done)](const Response& response) mutable {
+        if (response.status == ResponseStatus::OK && type == CommandType::MULTI) {
+            int new_tx_id = stoi(response.message);
+            if (!watched_keys.keys.empty()) {
+                // 监视的键随事务提交一起检查，与其他事务的提交互斥
+                storage_engine_->getTransactionManager()->getTransactionMut(new_tx_id).set_watched_keys(move(watched_keys));
+            }
             lock_guard writelock_client_transaction_ids_(transaction_mutex_);
-            client_transaction_ids_.erase(client_fd);
+            client_transaction_ids_[client_fd] = new_tx_id;
+        } else if (type == CommandType::EXEC || type == CommandType::DISCARD) {
+            // 提交因冲突失败时事务同样已经结束；与Redis相同，EXEC和DISCARD之后取消所有监视
+            {
+                lock_guard writelock_client_transaction_ids_(transaction_mutex_);
+                client_transaction_ids_.erase(client_fd);
+            }
+            unwatchClient(client_fd);
+        }
+        done(response);
+    };
+    if (isBlockingCommand(command.type) && reactor && tx_id == NO_TX && !enable_raft_ &&
+               !(shard_config_ && shard_config_->enable_sharding)) {
+        executeBlockingCommand(command, reactor, client_fd, connection_id, std::move(finish));
+    } else {
+        bool replica_read = false;
+        if (enable_raft_ && reactor && tx_id == NO_TX && spec.hasFlag(CMD_READONLY)) {
+            lock_guard<mutex> lock(readonly_clients_mutex_);
+            replica_read = readonly_clients_.count({reactor, connection_id}) > 0;
         }
+        executeCommand(command, tx_id, std::move(finish), replica_read);
+    }
+}
+
+void DKVServer::executeBlockingCommand(const Command& command, SubReactor* reactor, int client_fd,
+                                       uint64_t connection_id, CommandCallback done) {
+    Response response = executeCommand(command, NO_TX);
+    std::chrono::milliseconds timeout;
+    if (response.status != ResponseStatus::NOT_FOUND || !BlockedClients::parseTimeout(command.args.back(), timeout)) {
+        done(response);
+        return;
+    }
+    // 等待期间不占用工作线程：同一连接的后续命令暂存在reactor中，直到回调交付回复
+    std::weak_ptr<BlockedClients::Client> client = blocked_clients_.block(command, std::move(done));
+    pushInvalidations();
+    if (timeout.count() > 0) {
+        reactor->addTimer(chrono::steady_clock::now() + timeout, [this, client] { blocked_clients_.timeout(client); });
+    }
+    reactor->setDisconnectHook(client_fd, connection_id, [this, client] { blocked_clients_.cancel(client); });
+}
+
+Response DKVServer::handleWatchCommand(int client_fd, const Command& command, TransactionID tx_id) {
+    if (command.type == CommandType::UNWATCH) {
+        unwatchClient(client_fd);
+        return Response(ResponseStatus::OK, "OK");
+    }
+    if (command.args.empty()) {
+        return Response(ResponseStatus::ERROR, "WATCH命令需要至少1个参数");
     }
+    if (tx_id != NO_TX) {
+        return Response(ResponseStatus::ERROR, "WATCH inside MULTI is not allowed");
+    }
+    if (enable_raft_) {
+        // 监视记录的是本机的提交序号，各节点不同，无法在日志应用时确定地检查
+        return Response(ResponseStatus::ERROR, "WATCH不支持Raft模式");
+    }
+    unique_ptr<TransactionManager>& transaction_manager = storage_engine_->getTransactionManager();
+    lock_guard writelock_client_transaction_ids_(transaction_mutex_);
+    auto it = client_watched_keys_.find(client_fd);
+    if (it == client_watched_keys_.end()) {
+        it = client_watched_keys_.emplace(client_fd, WatchedKeys{transaction_manager->watch(), {}}).first;
+    }
+    // 多次WATCH累加监视的键，沿用最早的监视起点
+    it->second.keys.insert(it->second.keys.end(), command.args.begin(), command.args.end());
+    return Response(ResponseStatus::OK, "OK");
+}
+
+Response DKVServer::handleClientCommand(const Command& command, SubReactor* reactor, int client_fd,
+                                       uint64_t connection_id) {
+    std::vector<std::string> args = command.args;
+    for (auto& arg : args) {
+        std::transform(arg.begin(), arg.end(), arg.begin(), ::toupper);
+    }
+    if (args.size() != 2 || args[0] != "TRACKING" || (args[1] != "ON" && args[1] != "OFF")) {
+        return Response(ResponseStatus::ERROR, "CLIENT命令只支持: CLIENT TRACKING ON|OFF");
+    }
+    if (!reactor) {
+        return Response(ResponseStatus::ERROR, "CLIENT TRACKING需要网络连接");
+    }
+    if (enable_raft_ || (shard_config_ && shard_config_->enable_sharding)) {
+        return Response(ResponseStatus::ERROR, "CLIENT TRACKING不支持Raft和分片模式");
+    }
+    if (args[1] == "ON") {
+        client_tracking_.enable(TrackingClient{reactor, client_fd, connection_id});
+    } else {
+        client_tracking_.disable(reactor, connection_id);
+    }
+    return Response(ResponseStatus::OK, "OK");
+}
+
+Response DKVServer::handleReplicaReadCommand(const Command& command, SubReactor* reactor, uint64_t connection_id) {
+    if (!reactor) {
+        return Response(ResponseStatus::ERROR, "READONLY需要网络连接");
+    }
+    if (!enable_raft_) {
+        return Response(ResponseStatus::ERROR, "READONLY只在Raft模式下可用");
+    }
+    lock_guard<mutex> lock(readonly_clients_mutex_);
+    if (command.type == CommandType::READONLY) {
+        readonly_clients_.insert({reactor, connection_id});
+    } else {
+        readonly_clients_.erase({reactor, connection_id});
+    }
+    return Response(ResponseStatus::OK, "OK");
+}
+
+Response DKVServer::handleSubscribeCommand(const Command& command, SubReactor* reactor, int client_fd,
+                                          uint64_t connection_id) {
+    if (!reactor) {
+        return Response(ResponseStatus::ERROR, "订阅命令需要网络连接");
+    }
+    if (shard_config_ && shard_config_->enable_sharding) {
+        return Response(ResponseStatus::ERROR, "订阅命令不支持分片模式");
+    }
+    const bool pattern = command.type == CommandType::PSUBSCRIBE || command.type == CommandType::PUNSUBSCRIBE;
+    const bool subscribe = command.type == CommandType::SUBSCRIBE || command.type == CommandType::PSUBSCRIBE;
+    const char* kind = command.type == CommandType::SUBSCRIBE     ? "subscribe"
+                       : command.type == CommandType::PSUBSCRIBE  ? "psubscribe"
+                       : command.type == CommandType::UNSUBSCRIBE ? "unsubscribe"
+                                                                  : "punsubscribe";
+    std::vector<std::string> names = command.args;
+    if (!subscribe && names.empty()) {
+        // 不带参数时取消全部订阅
+        names = pattern ? pubsub_.patternsOf(reactor, connection_id) : pubsub_.channelsOf(reactor, connection_id);
+    }
+    // 与Redis相同，每个频道回复一组 [类型, 频道, 订阅总数]
+    std::vector<std::string> reply;
+    for (const auto& name : names) {
+        size_t count;
+        if (subscribe) {
+            count = pattern ? pubsub_.psubscribe(reactor, client_fd, connection_id, name)
+                            : pubsub_.subscribe(reactor, client_fd, connection_id, name);
+        } else {
+            count = pattern ? pubsub_.punsubscribe(reactor, connection_id, name)
+                            : pubsub_.unsubscribe(reactor, connection_id, name);
+        }
+        reply.push_back(kind);
+        reply.push_back(name);
+        reply.push_back(std::to_string(count));
+    }
+    if (reply.empty()) {
+        reply = {kind, "", "0"};
+    }
+    Response response;
+    response.status = ResponseStatus::OK;
+    response.setArray(std::move(reply));
     return response;
 }
 
+void DKVServer::pushInvalidations() {
+    for (auto& invalidation : client_tracking_.takeInvalidations()) {
+        std::string push;
+        RESPWriter writer(push);
+        writer.writeInvalidation(invalidation.flush_all ? nullptr : &invalidation.keys);
+        invalidation.client.reactor->pushToClient(invalidation.client.fd, invalidation.client.connection_id,
+                                                  std::move(push));
+    }
+}
+
+size_t DKVServer::estimateCommandCost(const Command& command) const {
+    if (!storage_engine_) {
+        return 0;
+    }
+    size_t cost = 0;
+    for (const auto& key : command.keys()) {
+        cost += storage_engine_->elementCount(NO_TX, key);
+    }
+    // 按下标取区间时两端都非负，最多返回区间内的元素
+    if ((command.type == CommandType::LRANGE || command.type == CommandType::ZRANGE ||
+         command.type == CommandType::ZREVRANGE) && command.args.size() >= 3) {
+        const string& start_arg = command.args[1];
+        const string& stop_arg = command.args[2];
+        int64_t start = 0;
+        int64_t stop = 0;
+        if (from_chars(start_arg.data(), start_arg.data() + start_arg.size(), start).ec == errc() &&
+            from_chars(stop_arg.data(), stop_arg.data() + stop_arg.size(), stop).ec == errc() &&
+            start >= 0 && stop >= start) {
+            cost = min(cost, static_cast<size_t>(stop - start + 1));
+        }
+    }
+    return cost;
+}
+
+Response DKVServer::handleLatencyCommand(const Command& command) {
+    std::string subcommand = command.args.empty() ? "" : command.args[0];
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    if (subcommand == "HISTOGRAM") {
+        std::vector<CommandType> types;
+        for (size_t i = 1; i < command.args.size(); ++i) {
+            CommandType type = Utils::stringToCommandType(command.args[i]);
+            if (type != CommandType::UNKNOWN) {
+                types.push_back(type);
+            }
+        }
+        Response response;
+        response.status = ResponseStatus::OK;
+        // 指定的命令都不存在时返回空数组，而不是全部命令
+        bool none_known = command.args.size() > 1 && types.empty();
+        response.setArray(none_known ? std::vector<std::string>() : latency_monitor_.histogramReply(types));
+        return response;
+    }
+    if (subcommand == "RESET" && command.args.size() == 1) {
+        latency_monitor_.resetStats();
+        return Response(ResponseStatus::OK, "OK");
+    }
+    return Response(ResponseStatus::ERROR, "LATENCY命令只支持: LATENCY HISTOGRAM [command ...] 和 LATENCY RESET");
+}
+
+Response DKVServer::handleSlowLogCommand(const Command& command) {
+    std::string subcommand = command.args.empty() ? "" : command.args[0];
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    if (subcommand == "GET" && command.args.size() <= 2) {
+        // 与Redis相同，默认返回最近10条
+        size_t count = 10;
+        if (command.args.size() == 2) {
+            try {
+                long long value = std::stoll(command.args[1]);
+                count = value < 0 ? SIZE_MAX : static_cast<size_t>(value);
+            } catch (const std::exception&) {
+                return Response(ResponseStatus::ERROR, "SLOWLOG GET的数量必须是整数");
+            }
+        }
+        std::vector<std::string> entries;
+        for (const auto& entry : latency_monitor_.slowLog(count)) {
+            std::string line = std::to_string(entry.id) + " " + std::to_string(entry.timestamp) + " " +
+                               std::to_string(entry.duration_us);
+            for (const auto& arg : entry.args) {
+                line += " " + arg;
+            }
+            entries.push_back(std::move(line));
+        }
+        Response response;
+        response.status = ResponseStatus::OK;
+        response.setArray(std::move(entries));
+        return response;
+    }
+    if (subcommand == "LEN" && command.args.size() == 1) {
+        return Response(ResponseStatus::OK, "", std::to_string(latency_monitor_.slowLogLen()));
+    }
+    if (subcommand == "RESET" && command.args.size() == 1) {
+        latency_monitor_.resetSlowLog();
+        return Response(ResponseStatus::OK, "OK");
+    }
+    return Response(ResponseStatus::ERROR, "SLOWLOG命令只支持: SLOWLOG GET [count]、SLOWLOG LEN 和 SLOWLOG RESET");
+}
+
+Response DKVServer::handleDebugCommand(const Command& command) {
+    std::vector<std::string> args = command.args;
+    for (size_t i = 0; i < std::min<size_t>(args.size(), 2); ++i) {
+        std::transform(args[i].begin(), args[i].end(), args[i].begin(), ::toupper);
+    }
+    if (args.size() >= 2 && args[0] == "TRACE") {
+        if (args[1] == "SAMPLE" && args.size() == 3) {
+            // 每every批命令追踪一批，0表示关闭
+            uint32_t every = 0;
+            auto result = from_chars(args[2].data(), args[2].data() + args[2].size(), every);
+            if (result.ec != errc() || result.ptr != args[2].data() + args[2].size()) {
+                return Response(ResponseStatus::ERROR, "DEBUG TRACE SAMPLE的参数必须是非负整数");
+            }
+            RequestTracer::setSampleRate(every);
+            return Response(ResponseStatus::OK, "OK");
+        }
+        if (args[1] == "DUMP" && args.size() <= 3) {
+            // 不指定文件时直接返回JSON
+            if (args.size() == 2) {
+                return Response(ResponseStatus::OK, "", RequestTracer::dumpJSON());
+            }
+            if (!RequestTracer::dumpToFile(command.args[2])) {
+                return Response(ResponseStatus::ERROR, "无法写入追踪文件 " + command.args[2]);
+            }
+            return Response(ResponseStatus::OK, "OK");
+        }
+        if (args[1] == "RESET" && args.size() == 2) {
+            RequestTracer::reset();
+            return Response(ResponseStatus::OK, "OK");
+        }
+    }
+    return Response(ResponseStatus::ERROR,
+                    "DEBUG命令只支持: DEBUG TRACE SAMPLE <every>、DEBUG TRACE DUMP [filename] 和 DEBUG TRACE RESET");
+}
+
+Response DKVServer::handleMemoryCommand(const Command& command) {
+    std::string subcommand = command.args[0];
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    if (subcommand == "USAGE" && (command.args.size() == 2 || command.args.size() == 4)) {
+        // 与Redis相同，默认计算集合的前5个元素并外推，SAMPLES 0计算全部元素
+        size_t samples = StorageEngine::MEMORY_USAGE_SAMPLES;
+        if (command.args.size() == 4) {
+            std::string option = command.args[2];
+            std::transform(option.begin(), option.end(), option.begin(), ::toupper);
+            const std::string& text = command.args[3];
+            auto result = from_chars(text.data(), text.data() + text.size(), samples);
+            if (option != "SAMPLES" || result.ec != errc() || result.ptr != text.data() + text.size()) {
+                return Response(ResponseStatus::ERROR, "MEMORY USAGE的SAMPLES参数必须是非负整数");
+            }
+        }
+        std::optional<size_t> bytes = storage_engine_->memoryUsage(command.args[1], samples);
+        if (!bytes) {
+            return Response(ResponseStatus::NOT_FOUND);
+        }
+        return Response(ResponseStatus::OK, "", std::to_string(*bytes));
+    }
+    if (subcommand == "STATS" && command.args.size() == 1) {
+        // 名称、值交替的数组。按类型汇总的部分来自上一轮完整的键空间内存采样，大键为 键 字节数 编码
+        MemorySampleReport report = storage_engine_->getMemorySampleReport();
+        std::vector<std::string> entries = {"allocator.used", std::to_string(getMemoryUsage()),
+                                            "sample.passes", std::to_string(report.passes),
+                                            "sample.finished_at", std::to_string(report.finished_at)};
+        uint64_t keys = 0;
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < MemorySampleReport::TYPE_COUNT; ++i) {
+            const auto& stats = report.types[i];
+            keys += stats.keys;
+            bytes += stats.bytes;
+            if (stats.keys == 0) {
+                continue;
+            }
+            const std::string type = dataTypeName(static_cast<DataType>(i));
+            entries.push_back(type + ".keys");
+            entries.push_back(std::to_string(stats.keys));
+            entries.push_back(type + ".bytes");
+            entries.push_back(std::to_string(stats.bytes));
+            std::string biggest;
+            for (const auto& info : stats.biggest) {
+                if (!biggest.empty()) {
+                    biggest += ", ";
+                }
+                biggest += info.key + " " + std::to_string(info.bytes) + " " + info.encoding;
+            }
+            entries.push_back(type + ".biggest");
+            entries.push_back(std::move(biggest));
+        }
+        entries.push_back("keys.count");
+        entries.push_back(std::to_string(keys));
+        entries.push_back("dataset.bytes");
+        entries.push_back(std::to_string(bytes));
+        Response response;
+        response.status = ResponseStatus::OK;
+        response.setArray(std::move(entries));
+        return response;
+    }
+    return Response(ResponseStatus::ERROR, "MEMORY命令只支持: MEMORY USAGE <key> [SAMPLES count] 和 MEMORY STATS");
+}
+
+void DKVServer::unwatchClient(int client_fd) {
+    uint64_t since;
+    {
+        lock_guard writelock_client_transaction_ids_(transaction_mutex_);
+        auto it = client_watched_keys_.find(client_fd);
+        if (it == client_watched_keys_.end()) {
+            return;
+        }
+        since = it->second.since;
+        client_watched_keys_.erase(it);
+    }
+    storage_engine_->getTransactionManager()->unwatch(since);
+}
+
 Response DKVServer::executeCommand(const Command& command, TransactionID tx_id) {
+    auto promise = make_shared<std::promise<Response>>();
+    auto future = promise->get_future();
+    executeCommand(command, tx_id, [promise](const Response& response) { promise->set_value(response); });
+    return future.get();
+}
+
+void DKVServer::executeCommand(const Command& command, TransactionID tx_id, CommandCallback done, bool replica_read) {
     if (!storage_engine_ || !command_handler_) {
-        return Response(ResponseStatus::ERROR, "Storage engine or command handler not initialized");
+        done(Response(ResponseStatus::ERROR, "Storage engine or command handler not initialized"));
+        return;
     }
 
     if (commandNotAllowedInTx(command.type) && tx_id != NO_TX) {
@@ -586,27 +1269,33 @@ Response DKVServer::executeCommand(const Command& command, TransactionID tx_id)
         Response commit_response = executeCommand(commit_command, tx_id);
         if (commit_response.status != ResponseStatus::OK) {
             DKV_LOG_ERROR("提交事务失败: ", commit_response.message);
-            return commit_response;
+            done(commit_response);
+            return;
         }
         tx_id = NO_TX;
     }
     
     // 检查是否启用了分片功能
     if (shard_config_ && shard_config_->enable_sharding) {
-        // 使用分片管理器处理命令
-        return shard_manager_->HandleCommand(command, tx_id);
+        // 使用分片管理器处理命令，结果由分片的应用线程回调，拆分到多个分片的命令在最后一个分片完成时回调
+        shard_manager_->HandleCommandAsync(command, tx_id, std::move(done));
+        return;
     }
     
-    // 检查是否是只读命令，用于内存管理和Raft集成
-    bool isReadOnly = isReadOnlyCommand(command.type);
+    // 检查是否是只读命令，用于Raft集成
+    const CommandSpec& spec = commandSpec(command.type);
+    bool isReadOnly = spec.hasFlag(CMD_READONLY);
     
-    // 如果不是只读命令，且设置了最大内存限制，则检查内存使用情况
-    if (!isReadOnly && command.type != CommandType::DEL && max_memory_ > 0) {
+    // 如果命令可能占用更多内存，且设置了最大内存限制，则检查内存使用情况；删除类命令在内存达到上限时仍可执行
+    if (spec.hasFlag(CMD_DENY_OOM) && max_memory_ > 0) {
         size_t currentUsage = getMemoryUsage();
         
         // 如果内存使用达到上限，尝试执行淘汰策略
         if (currentUsage >= max_memory_) {
-            if (eviction_policy_ != EvictionPolicy::NOEVICTION) {
+            if (storage_engine_->tieredEnabled()) {
+                // 分层存储时maxmemory是内存中热数据的容量：把冷数据移到磁盘，移不出时也照常执行
+                evictKeys(tx_id);
+            } else if (eviction_policy_ != EvictionPolicy::NOEVICTION) {
                 // 尝试淘汰一些键
                 DKV_LOG_INFO("内存使用已达到上限，尝试执行淘汰策略");
                 evictKeys(tx_id);
@@ -617,15 +1306,25 @@ Response DKVServer::executeCommand(const Command& command, TransactionID tx_id)
                 // 如果淘汰后内存使用仍然达到上限，拒绝执行命令
                 if (currentUsage >= max_memory_) {
                     DKV_LOG_WARNING("执行淘汰策略后内存使用仍达到上限，拒绝执行命令");
-                    return Response(ResponseStatus::ERROR, "OOM command not allowed when used memory > 'maxmemory'");
+                    done(Response(ResponseStatus::ERROR, "OOM command not allowed when used memory > 'maxmemory'"));
+                    return;
                 }
             } else {
                 DKV_LOG_WARNING("内存使用已达到上限，拒绝执行命令");
-                return Response(ResponseStatus::ERROR, "OOM command not allowed when used memory > 'maxmemory'");
+                done(Response(ResponseStatus::ERROR, "OOM command not allowed when used memory > 'maxmemory'"));
+                return;
             }
         }
     }
 
+    // Raft模式下事务中的命令（包括读命令）不在领导者本机执行，只在本机事务中排队；
+    // EXEC时把整个事务作为一条日志复制，应用时依次执行，各命令的结果作为EXEC的回复返回
+    if (enable_raft_ && tx_id != NO_TX && !spec.hasFlag(CMD_TX_CONTROL)) {
+        storage_engine_->getTransactionManager()->getTransactionMut(tx_id).push_command(command);
+        done(Response(ResponseStatus::OK, "QUEUED"));
+        return;
+    }
+
     // 如果启用了Raft，处理写命令的Raft集成
     if (enable_raft_ && !isReadOnly) {
         // 检查当前节点是否是领导者
@@ -634,35 +1333,128 @@ Response DKVServer::executeCommand(const Command& command, TransactionID tx_id)
             int leaderId = raft_->GetCurrentLeaderId();
             if (leaderId == -1) {
                 // 没有已知的领导者，返回错误
-                return Response(ResponseStatus::ERROR, "No known leader, please try again later");
+                done(Response(ResponseStatus::ERROR, "No known leader, please try again later"));
             } else {
                 // 返回当前领导者信息，格式为"MOVED <leaderId>"
-                string leaderInfo = "MOVED " + to_string(leaderId);
-                return Response(ResponseStatus::ERROR, leaderInfo);
+                done(Response(ResponseStatus::ERROR, "MOVED " + to_string(leaderId)));
             }
+            return;
         }
         
-        // 当前节点是领导者，将命令提交到Raft
+        // 本机事务只保存排队的命令：EXEC时结束本机事务，把排队的命令作为一条日志复制，
+        // 各节点（包括领导者）应用时在新事务中执行并提交，领导者用应用时的结果回复EXEC
+        Command raft_command = command;
+        if (tx_id != NO_TX || spec.hasFlag(CMD_TX_CONTROL)) {
+            if (command.type != CommandType::EXEC || tx_id == NO_TX) {
+                executeNative(command, tx_id, std::move(done));
+                return;
+            }
+            unique_ptr<TransactionManager>& transaction_manager = storage_engine_->getTransactionManager();
+            std::vector<Command> commands = transaction_manager->getTransaction(tx_id).get_commands();
+            transaction_manager->rollback(tx_id);
+            if (commands.empty()) {
+                // 空事务不写日志
+                Response response;
+                response.setArray({});
+                done(response);
+                return;
+            }
+            raft_command = RaftCommand::EncodeTransaction(commands);
+            tx_id = NO_TX;
+        }
+
+        // 当前节点是领导者，将命令提交到Raft；日志应用到状态机后由应用线程回调，调用线程不等待
         int index, term;
-        auto raft_cmd = make_shared<RaftCommand>(tx_id, command);
-        bool ok = raft_->StartCommand(raft_cmd, index, term);
+        auto raft_cmd = make_shared<RaftCommand>(tx_id, raft_command);
+        if (uint64_t trace_id = RequestTracer::current()) {
+            // 被追踪的命令记录从提交到应用线程回调之间的耗时，包括复制到多数节点和应用到状态机
+            done = [trace_id, start = RequestTracer::Clock::now(), done = std::move(done)](const Response& response) {
+                RequestTracer::recordAsync(trace_id, "raft_commit", nullptr, start, RequestTracer::Clock::now());
+                done(response);
+            };
+        }
+        bool ok = raft_->StartCommand(raft_cmd, index, term, std::move(done), 5000);
         if (!ok) {
-            // 提交失败，可能是因为在提交过程中失去了领导者地位
-            return Response(ResponseStatus::ERROR, "Failed to commit command to Raft");
+            // 提交失败，可能是因为在提交过程中失去了领导者地位；失败时回调未被登记
+            done(Response(ResponseStatus::ERROR, "Failed to commit command to Raft"));
         }
-        
-        // 等待命令被提交和应用到状态机后再返回结果
-        Response response = raft_->waitForCommandResult(index, term, 5000);
-        return response;
+        return;
     }
-    // 直接操作本机数据
-    return doCommandNative(command, tx_id);
+
+    // 读取数据的命令先经ReadIndex确认本机状态机不落后于读取开始时的提交索引，不写日志。
+    // READONLY连接在跟随者上读取时，落后不超过配置的范围就直接读本机数据，不访问领导者
+    if (enable_raft_ && isReadOnly && raft_read_mode_ != RaftReadMode::LOCAL && !spec.hasFlag(CMD_LOCAL_STATE) &&
+        !(replica_read && raft_->StaleReadAllowed(raft_replica_max_lag_entries_, raft_replica_max_lag_ms_))) {
+        if (!raft_->ReadIndex(5000)) {
+            int leaderId = raft_->GetCurrentLeaderId();
+            if (leaderId == -1 || leaderId == raft_->GetMe()) {
+                done(Response(ResponseStatus::ERROR, "No known leader, please try again later"));
+            } else {
+                done(Response(ResponseStatus::ERROR, "MOVED " + to_string(leaderId)));
+            }
+            return;
+        }
+    }
+    // 分层存储：读命令要访问的值在磁盘上时交给后台线程读取，读取期间不占用工作线程，读入后在该线程上继续执行。
+    // 同一连接的后续命令等读命令完成后才执行；写命令在doCommandNative中同步载入
+    if (isReadOnly && storage_engine_->tieredEnabled() &&
+        storage_engine_->loadSpilledAsync(command.keys(), [this, command, tx_id, done]() {
+            executeNative(command, tx_id, done);
+        })) {
+        return;
+    }
+    executeNative(command, tx_id, std::move(done));
+}
+
+void DKVServer::executeNative(const Command& command, TransactionID tx_id, CommandCallback done) {
+    // 直接操作本机数据，推入元素的命令完成后唤醒阻塞在这些键上的客户端
+    auto start = LatencyMonitor::Clock::now();
+    Response response;
+    {
+        TraceSpan span("execute", commandSpec(command.type).name.data());
+        response = doCommandNative(command, tx_id);
+    }
+    latency_monitor_.recordCommand(command, LatencyMonitor::elapsedUs(start));
+    blocked_clients_.serveReadyKeys();
+    pushInvalidations();
+    done(response);
+}
+
+Response DKVServer::replayCommand(const Command& command) {
+    // 分片模式下命令由分片管理器路由到各分片
+    if (shard_config_ && shard_config_->enable_sharding) {
+        return executeCommand(command, NO_TX);
+    }
+    // 重放的命令已经执行过一次，不再检查内存上限，也不经过Raft
+    return doCommandNative(command, NO_TX);
 }
 
 // 在本机执行指定Command
 Response DKVServer::doCommandNative(const Command& command, TransactionID tx_id) {
-    unique_ptr<TransactionManager> &transaction_manager = storage_engine_->getTransactionManager();
-    recordCommandForAOF(tx_id, command, command_handler_, transaction_manager);
+    return doCommandNative(storage_engine_.get(), command_handler_.get(), command, tx_id);
+}
+
+Response DKVServer::doCommandNative(StorageEngine* storage_engine, CommandHandler* command_handler, const Command& command, TransactionID tx_id) {
+    // 分片自己的存储引擎没有AOF和RDB文件，持久化由分片的Raft日志和快照负责
+    const bool own_engine = storage_engine == storage_engine_.get();
+    if (!own_engine && (command.type == CommandType::SAVE || command.type == CommandType::BGSAVE ||
+                        command.type == CommandType::SHUTDOWN)) {
+        return Response(ResponseStatus::ERROR, "Command not supported on shard storage");
+    }
+    // 值在磁盘上的键先载入，命令只看到原类型的数据项
+    if (storage_engine->tieredEnabled()) {
+        storage_engine->loadSpilled(command.keys());
+    }
+    // RDB后台加载期间，命令访问的键所在的数据块先载入；遍历整个键空间的命令等加载完成
+    if (storage_engine->rdbLoading()) {
+        const std::vector<Key> keys = command.keys();
+        if (keys.empty() && !commandSpec(command.type).hasFlag(CMD_LOCAL_STATE | CMD_TX_CONTROL)) {
+            return Response(ResponseStatus::ERROR, "LOADING DKV is loading the dataset in memory");
+        }
+        storage_engine->loadRDBKeys(keys);
+    }
+    unique_ptr<TransactionManager> &transaction_manager = storage_engine->getTransactionManager();
+    recordCommandForAOF(tx_id, command, command_handler, transaction_manager);
     bool need_inc_dirty = false;
     Response response;
     switch (command.type) {
@@ -687,12 +1479,55 @@ Response DKVServer::doCommandNative(const Command& command, TransactionID tx_id)
         }
         case CommandType::EXEC:
         {
+            // Raft日志中的事务：在一个新事务中依次执行全部命令后提交，整批对读者同时可见，
+            // 各命令的结果按RESP编码后作为数组回复
+            std::vector<std::string> results;
+            const bool raft_batch = tx_id == NO_TX && RaftCommand::IsTransaction(command);
+            if (raft_batch) {
+                std::vector<Command> batch;
+                if (!RaftCommand::DecodeTransaction(command, batch)) {
+                    return Response(ResponseStatus::ERROR, "Corrupted transaction entry");
+                }
+                tx_id = transaction_manager->begin();
+                results.reserve(batch.size());
+                for (const auto& tx_command : batch) {
+                    std::string encoded;
+                    RESPWriter(encoded).writeResponse(doCommandNative(storage_engine, command_handler, tx_command, tx_id));
+                    results.push_back(std::move(encoded));
+                }
+            }
             if (tx_id == NO_TX) {
                 return Response(ResponseStatus::ERROR, "Transaction not started");
             }
-            auto commands = transaction_manager->getTransaction(tx_id).get_commands();
-            // 提交事务
-            transaction_manager->commit(tx_id);
+            const Transaction& tx = transaction_manager->getTransaction(tx_id);
+            auto commands = tx.get_commands();
+            bool watching = !tx.get_watched_keys().keys.empty();
+            // 提交事务，监视的键被修改或可串行化隔离下与并发事务冲突时事务已被回滚
+            if (!transaction_manager->commit(tx_id)) {
+                if (watching) {
+                    // 与Redis相同，监视的键被修改时EXEC返回空回复
+                    return Response(ResponseStatus::NOT_FOUND);
+                }
+                return Response(ResponseStatus::ERROR, "EXECABORT Transaction aborted due to serialization conflict");
+            }
+            // 整个事务的写命令作为一条记录追加，只等待一次落盘
+            if (!commands.empty()) {
+                TraceSpan span("aof_append");
+                command_handler->appendAOFCommands(commands);
+            }
+            // 事务中推入的元素提交后才可见，此时才唤醒阻塞的客户端和通知缓存失效
+            if (own_engine) {
+                for (const auto& tx_command : commands) {
+                    signalListPush(tx_command);
+                    if (!isReadOnlyCommand(tx_command.type)) {
+                        client_tracking_.invalidate(tx_command.keys());
+                    }
+                }
+            }
+            if (raft_batch) {
+                response.setArray(std::move(results));
+                return response;
+            }
             return Response(ResponseStatus::OK, "OK");
         }
         case CommandType::DISCARD:
@@ -705,115 +1540,207 @@ Response DKVServer::doCommandNative(const Command& command, TransactionID tx_id)
             return Response(ResponseStatus::OK, "OK");
         }
         case CommandType::SET:
-            response = command_handler_->handleSetCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleSetCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::GET:
-            response = command_handler_->handleGetCommand(tx_id, command);
+            response = command_handler->handleGetCommand(tx_id, command);
             break;
         case CommandType::DEL:
-            response = command_handler_->handleDelCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleDelCommand(tx_id, command, need_inc_dirty);
+            break;
+        case CommandType::UNLINK:
+            response = command_handler->handleUnlinkCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::EXISTS:
-            response = command_handler_->handleExistsCommand(tx_id, command);
+            response = command_handler->handleExistsCommand(tx_id, command);
+            break;
+        case CommandType::MGET:
+            response = command_handler->handleMGetCommand(tx_id, command);
+            break;
+        case CommandType::MSET:
+            response = command_handler->handleMSetCommand(tx_id, command, need_inc_dirty, false);
+            break;
+        case CommandType::MSETNX:
+            response = command_handler->handleMSetCommand(tx_id, command, need_inc_dirty, true);
             break;
         case CommandType::INCR:
-            response = command_handler_->handleIncrCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleIncrCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::DECR:
-            response = command_handler_->handleDecrCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleDecrCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::EXPIRE:
-            response = command_handler_->handleExpireCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleExpireCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::TTL:
-            response = command_handler_->handleTtlCommand(tx_id, command);
+            response = command_handler->handleTtlCommand(tx_id, command);
             break;
         
         // 哈希命令
         case CommandType::HSET:
-            response = command_handler_->handleHSetCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleHSetCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::HGET:
-            response = command_handler_->handleHGetCommand(tx_id, command);
+            response = command_handler->handleHGetCommand(tx_id, command);
+            break;
+        case CommandType::HMSET:
+            response = command_handler->handleHMSetCommand(tx_id, command, need_inc_dirty);
+            break;
+        case CommandType::HMGET:
+            response = command_handler->handleHMGetCommand(tx_id, command);
             break;
         case CommandType::HGETALL:
-            response = command_handler_->handleHGetAllCommand(tx_id, command);
+            response = command_handler->handleHGetAllCommand(tx_id, command);
             break;
         case CommandType::HDEL:
-            response = command_handler_->handleHDeldCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleHDeldCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::HEXISTS:
-            response = command_handler_->handleHExistsCommand(tx_id, command);
+            response = command_handler->handleHExistsCommand(tx_id, command);
             break;
         case CommandType::HKEYS:
-            response = command_handler_->handleHKeysCommand(tx_id, command);
+            response = command_handler->handleHKeysCommand(tx_id, command);
             break;
         case CommandType::HVALS:
-            response = command_handler_->handleHValsCommand(tx_id, command);
+            response = command_handler->handleHValsCommand(tx_id, command);
             break;
         case CommandType::HLEN:
-            response = command_handler_->handleHLenCommand(tx_id, command);
+            response = command_handler->handleHLenCommand(tx_id, command);
             break;
         
         // 列表命令
         case CommandType::LPUSH:
-            response = command_handler_->handleLPushCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleLPushCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::RPUSH:
-            response = command_handler_->handleRPushCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleRPushCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::LPOP:
-            response = command_handler_->handleLPopCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleLPopCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::RPOP:
-            response = command_handler_->handleRPopCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleRPopCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::LLEN:
-            response = command_handler_->handleLLenCommand(tx_id, command);
+            response = command_handler->handleLLenCommand(tx_id, command);
             break;
         case CommandType::LRANGE:
-            response = command_handler_->handleLRangeCommand(tx_id, command);
+            response = command_handler->handleLRangeCommand(tx_id, command);
+            break;
+        case CommandType::LINDEX:
+            response = command_handler->handleLIndexCommand(tx_id, command);
+            break;
+        case CommandType::LSET:
+            response = command_handler->handleLSetCommand(tx_id, command, need_inc_dirty);
+            break;
+        case CommandType::BLPOP:
+        case CommandType::BRPOP:
+            response = command_handler->handleBlockingPopCommand(tx_id, command, need_inc_dirty,
+                                                                 command.type == CommandType::BLPOP);
+            if (need_inc_dirty) {
+                recordBlockingCommandForAOF(tx_id, command, response, command_handler, transaction_manager);
+            }
+            break;
+        case CommandType::BLMOVE:
+            response = command_handler->handleBLMoveCommand(tx_id, command, need_inc_dirty);
+            if (need_inc_dirty) {
+                recordBlockingCommandForAOF(tx_id, command, response, command_handler, transaction_manager);
+            }
+            break;
+        case CommandType::LMOVE:
+            response = command_handler->handleLMoveCommand(tx_id, command, need_inc_dirty);
             break;
         
         // 集合命令
         case CommandType::SADD:
-            response = command_handler_->handleSAddCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleSAddCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::SREM:
-            response = command_handler_->handleSRemCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleSRemCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::SMEMBERS:
-            response = command_handler_->handleSMembersCommand(tx_id, command);
+            response = command_handler->handleSMembersCommand(tx_id, command);
             break;
         case CommandType::SISMEMBER:
-            response = command_handler_->handleSIsMemberCommand(tx_id, command);
+            response = command_handler->handleSIsMemberCommand(tx_id, command);
             break;
         case CommandType::SCARD:
-            response = command_handler_->handleSCardCommand(tx_id, command);
+            response = command_handler->handleSCardCommand(tx_id, command);
+            break;
+        case CommandType::SINTER:
+            response = command_handler->handleSetOpCommand(tx_id, command, SetOp::INTER);
+            break;
+        case CommandType::SUNION:
+            response = command_handler->handleSetOpCommand(tx_id, command, SetOp::UNION);
+            break;
+        case CommandType::SDIFF:
+            response = command_handler->handleSetOpCommand(tx_id, command, SetOp::DIFF);
+            break;
+        case CommandType::SINTERSTORE:
+            response = command_handler->handleSetOpStoreCommand(tx_id, command, SetOp::INTER, need_inc_dirty);
+            break;
+        case CommandType::SUNIONSTORE:
+            response = command_handler->handleSetOpStoreCommand(tx_id, command, SetOp::UNION, need_inc_dirty);
+            break;
+        case CommandType::SDIFFSTORE:
+            response = command_handler->handleSetOpStoreCommand(tx_id, command, SetOp::DIFF, need_inc_dirty);
+            break;
+        
+        // 游标遍历命令
+        case CommandType::SCAN:
+            response = command_handler->handleScanCommand(command);
+            break;
+        case CommandType::HSCAN:
+            response = command_handler->handleHScanCommand(tx_id, command);
+            break;
+        case CommandType::SSCAN:
+            response = command_handler->handleSScanCommand(tx_id, command);
+            break;
+        case CommandType::ZSCAN:
+            response = command_handler->handleZScanCommand(tx_id, command);
             break;
         
         // 服务器管理命令
         case CommandType::FLUSHDB:
-            response = command_handler_->handleFlushDBCommand(need_inc_dirty);
+            response = command_handler->handleFlushDBCommand(command, need_inc_dirty);
             break;
         case CommandType::DBSIZE:
-            response = command_handler_->handleDBSizeCommand();
+            response = command_handler->handleDBSizeCommand();
             break;
-        case CommandType::INFO:
-            response = command_handler_->handleInfoCommand(
-                getKeyCount(), 
-                getExpiredKeys(), 
-                getTotalKeys(), 
+        case CommandType::INFO: {
+            std::string section = command.args.empty() ? "" : command.args[0];
+            std::transform(section.begin(), section.end(), section.begin(), ::tolower);
+            if (section == "commandstats") {
+                response = Response(ResponseStatus::OK, "", "# Commandstats\r\n" + latency_monitor_.commandStatsInfo());
+                break;
+            }
+            response = command_handler->handleInfoCommand(
+                storage_engine->size(), 
+                storage_engine->getExpiredKeys(), 
+                storage_engine->getTotalKeys(), 
                 getMemoryUsage(), 
                 getMaxMemory());
             break;
+        }
         case CommandType::SHUTDOWN:
-            response = command_handler_->handleShutdownCommand(this);
+            response = command_handler->handleShutdownCommand(this);
+            break;
+        case CommandType::LATENCY:
+            response = handleLatencyCommand(command);
+            break;
+        case CommandType::SLOWLOG:
+            response = handleSlowLogCommand(command);
+            break;
+        case CommandType::DEBUG:
+            response = handleDebugCommand(command);
+            break;
+        case CommandType::MEMORY:
+            response = handleMemoryCommand(command);
             break;
         
         // RDB持久化命令
         case CommandType::SAVE:
-            response = command_handler_->handleSaveCommand(
+            response = command_handler->handleSaveCommand(
                 rdb_filename_);
             if (response.status == ResponseStatus::OK) {
                 last_save_time_ = chrono::system_clock::now();
@@ -821,7 +1748,7 @@ Response DKVServer::doCommandNative(const Command& command, TransactionID tx_id)
             }
             break;
         case CommandType::BGSAVE:
-            response = command_handler_->handleBgSaveCommand(
+            response = command_handler->handleBgSaveCommand(
                 rdb_filename_);
             if (response.status == ResponseStatus::OK) {
                 last_save_time_ = chrono::system_clock::now();
@@ -831,93 +1758,203 @@ Response DKVServer::doCommandNative(const Command& command, TransactionID tx_id)
 
         // 有序集合命令
         case CommandType::ZADD:
-            response = command_handler_->handleZAddCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleZAddCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::ZREM:
-            response = command_handler_->handleZRemCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleZRemCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::ZSCORE:
-            response = command_handler_->handleZScoreCommand(tx_id, command);
+            response = command_handler->handleZScoreCommand(tx_id, command);
             break;
         case CommandType::ZISMEMBER:
-            response = command_handler_->handleZIsMemberCommand(tx_id, command);
+            response = command_handler->handleZIsMemberCommand(tx_id, command);
             break;
         case CommandType::ZRANK:
-            response = command_handler_->handleZRankCommand(tx_id, command);
+            response = command_handler->handleZRankCommand(tx_id, command);
             break;
         case CommandType::ZREVRANK:
-            response = command_handler_->handleZRevRankCommand(tx_id, command);
+            response = command_handler->handleZRevRankCommand(tx_id, command);
             break;
         case CommandType::ZRANGE:
-            response = command_handler_->handleZRangeCommand(tx_id, command);
+            response = command_handler->handleZRangeCommand(tx_id, command);
             break;
         case CommandType::ZREVRANGE:
-            response = command_handler_->handleZRevRangeCommand(tx_id, command);
+            response = command_handler->handleZRevRangeCommand(tx_id, command);
             break;
         case CommandType::ZRANGEBYSCORE:
-            response = command_handler_->handleZRangeByScoreCommand(tx_id, command);
+            response = command_handler->handleZRangeByScoreCommand(tx_id, command);
             break;
         case CommandType::ZREVRANGEBYSCORE:
-            response = command_handler_->handleZRevRangeByScoreCommand(tx_id, command);
+            response = command_handler->handleZRevRangeByScoreCommand(tx_id, command);
             break;
         case CommandType::ZCOUNT:
-            response = command_handler_->handleZCountCommand(tx_id, command);
+            response = command_handler->handleZCountCommand(tx_id, command);
             break;
         case CommandType::ZCARD:
-            response = command_handler_->handleZCardCommand(tx_id, command);
+            response = command_handler->handleZCardCommand(tx_id, command);
+            break;
+        case CommandType::ZUNIONSTORE:
+            response = command_handler->handleZSetOpStoreCommand(tx_id, command, SetOp::UNION, need_inc_dirty);
+            break;
+        case CommandType::ZINTERSTORE:
+            response = command_handler->handleZSetOpStoreCommand(tx_id, command, SetOp::INTER, need_inc_dirty);
+            break;
+        case CommandType::ZRANGESTORE:
+            response = command_handler->handleZRangeStoreCommand(tx_id, command, need_inc_dirty);
             break;
         
         // 位图命令
         case CommandType::SETBIT:
-            response = command_handler_->handleSetBitCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleSetBitCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::GETBIT:
-            response = command_handler_->handleGetBitCommand(tx_id, command);
+            response = command_handler->handleGetBitCommand(tx_id, command);
             break;
         case CommandType::BITCOUNT:
-            response = command_handler_->handleBitCountCommand(tx_id, command);
+            response = command_handler->handleBitCountCommand(tx_id, command);
             break;
         case CommandType::BITOP:
-            response = command_handler_->handleBitOpCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handleBitOpCommand(tx_id, command, need_inc_dirty);
+            break;
+        case CommandType::BITPOS:
+            response = command_handler->handleBitPosCommand(tx_id, command);
+            break;
+        case CommandType::BITFIELD:
+            response = command_handler->handleBitFieldCommand(tx_id, command, need_inc_dirty);
             break;
         
         // HyperLogLog命令
         case CommandType::RESTORE_HLL:
-            response = command_handler_->handleRestoreHLLCommand(command, need_inc_dirty);
+            response = command_handler->handleRestoreHLLCommand(command, need_inc_dirty);
+            break;
+        case CommandType::RESTORE_BATCH:
+            response = command_handler->handleRestoreBatchCommand(command, need_inc_dirty);
             break;
         case CommandType::PFADD:
-            response = command_handler_->handlePFAddCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handlePFAddCommand(tx_id, command, need_inc_dirty);
             break;
         case CommandType::PFCOUNT:
-            response = command_handler_->handlePFCountCommand(tx_id, command);
+            response = command_handler->handlePFCountCommand(tx_id, command);
             break;
         case CommandType::PFMERGE:
-            response = command_handler_->handlePFMergeCommand(tx_id, command, need_inc_dirty);
+            response = command_handler->handlePFMergeCommand(tx_id, command, need_inc_dirty);
+            break;
+
+        // 布隆过滤器命令
+        case CommandType::BF_RESERVE:
+            response = command_handler->handleBFReserveCommand(tx_id, command, need_inc_dirty);
+            break;
+        case CommandType::BF_ADD:
+        case CommandType::BF_MADD:
+            response = command_handler->handleBFAddCommand(tx_id, command, need_inc_dirty);
+            break;
+        case CommandType::BF_EXISTS:
+        case CommandType::BF_MEXISTS:
+            response = command_handler->handleBFExistsCommand(tx_id, command);
+            break;
+        case CommandType::BF_CARD:
+            response = command_handler->handleBFCardCommand(tx_id, command);
+            break;
+        case CommandType::PUBLISH:
+            response = Response(ResponseStatus::OK, "", std::to_string(pubsub_.publish(command.args[0], command.args[1])));
             break;
         case CommandType::EVALX:
-            response = command_handler_->handleEvalXCommand(tx_id, command);
+            response = command_handler->handleEvalXCommand(tx_id, command);
+            break;
+        case CommandType::EVALSHA:
+            response = command_handler->handleEvalShaCommand(tx_id, command);
+            break;
+        case CommandType::SCRIPT:
+            response = command_handler->handleScriptCommand(command);
             break;
         default:
             return Response(ResponseStatus::INVALID_COMMAND);
     }
     
-    // 如果需要增加脏标志，调用incDirty()
-    if (need_inc_dirty) {
+    // 可串行化隔离下记录命令访问的键，供提交时校验冲突
+    transaction_manager->trackCommand(tx_id, command);
+    
+    // 如果需要增加脏标志，调用incDirty()。恢复时重放的数据已经持久化，不计入变更
+    if (need_inc_dirty && own_engine && !storage_engine->inRecoveryMode()) {
         incDirty();
     }
+    if (need_inc_dirty && own_engine && tx_id == NO_TX) {
+        signalListPush(command);
+        if (command.type == CommandType::FLUSHDB) {
+            client_tracking_.invalidateAll();
+        } else {
+            client_tracking_.invalidate(command.keys());
+        }
+    }
     return response;
 }
 
+void DKVServer::signalListPush(const Command& command) {
+    switch (command.type) {
+        case CommandType::LPUSH:
+        case CommandType::RPUSH:
+            blocked_clients_.signalKeyReady(command.args[0]);
+            break;
+        case CommandType::BLMOVE:
+        case CommandType::LMOVE:
+            blocked_clients_.signalKeyReady(command.args[1]);
+            break;
+        default:
+            break;
+    }
+}
+
 void DKVServer::cleanupExpiredKeys() {
+    // 主动过期每100毫秒一个周期。周期内预算用尽仍有到期键时，下一周期的预算加倍，
+    // 最多占用周期的1/4时间；到期键清理完后预算逐步减回默认值
+    const auto cycle_interval = chrono::milliseconds(100);
+    const auto min_budget = chrono::duration_cast<chrono::microseconds>(StorageEngine::EXPIRE_CYCLE_BUDGET);
+    const auto max_budget = chrono::duration_cast<chrono::microseconds>(cycle_interval) / 4;
+    auto budget = min_budget;
+    auto next_memory_sample = chrono::steady_clock::now();
     while (cleanup_running_) {
-        // 使用更短的睡眠时间，以便快速响应停止信号
-        for (int i = 0; i < 60 && cleanup_running_; ++i) {
-            this_thread::sleep_for(chrono::seconds(1));
+        this_thread::sleep_for(cycle_interval);
+        if (!cleanup_running_ || !storage_engine_) {
+            break;
         }
-        
-        if (cleanup_running_ && storage_engine_) {
-            storage_engine_->cleanupExpiredKeys();
-            storage_engine_->cleanupEmptyKey();
+        if (storage_engine_->cleanupExpiredKeys(budget)) {
+            budget = min(budget * 2, max_budget);
+        } else {
+            budget = max(budget / 2, min_budget);
+        }
+        if (active_defrag_) {
+            // 碎片率按slab统计：数据项和容器小块内存都从slab分配，值的字符串缓冲区由malloc管理
+            const SlabAllocator& slab = SlabAllocator::getInstance();
+            const size_t reserved = slab.getReservedBytes();
+            const size_t used = slab.getUsedBytes();
+            if (reserved > used + active_defrag_ignore_bytes_ &&
+                reserved * 100 > used * (100 + static_cast<size_t>(active_defrag_threshold_))) {
+                storage_engine_->activeDefragCycle();
+            }
+        }
+        if (memory_sample_interval_ > 0 && chrono::steady_clock::now() >= next_memory_sample) {
+            // 一轮遍历分摊到多个周期，结束后间隔interval秒再开始下一轮
+            if (!storage_engine_->memorySampleCycle()) {
+                next_memory_sample = chrono::steady_clock::now() + chrono::seconds(memory_sample_interval_);
+            }
+        }
+    }
+}
+
+void DKVServer::purgeMVCCVersions() {
+    while (cleanup_running_) {
+        // 分段睡眠，以便快速响应停止信号
+        for (uint64_t slept = 0; slept < mvcc_purge_interval_ms_ && cleanup_running_; slept += 100) {
+            this_thread::sleep_for(chrono::milliseconds(min<uint64_t>(100, mvcc_purge_interval_ms_ - slept)));
+        }
+        if (!cleanup_running_ || !storage_engine_) {
+            break;
+        }
+        // 有版本被释放时说明积压较多，不等待间隔继续回收，每个周期最多16批，避免持续写入时占满CPU
+        for (int batch = 0; batch < 16 && cleanup_running_; ++batch) {
+            if (storage_engine_->purgeVersions() == 0) {
+                break;
+            }
         }
     }
 }
@@ -931,6 +1968,7 @@ void DKVServer::InitializeDefaultShardConfig() {
     shard_config_->enable_sharding = false; // 默认禁用分片
     shard_config_->num_shards = 1;
     shard_config_->hash_type = HashFunctionType::MD5;
+    shard_config_->routing_mode = ShardRoutingMode::CONSISTENT_HASH;
     shard_config_->num_virtual_nodes = 100;
     shard_config_->heartbeat_interval_ms = 1000;
     shard_config_->migration_batch_size = 1000;
@@ -945,6 +1983,26 @@ void DKVServer::InitializeDefaultShardConfig() {
     shard_raft_data_dir_ = "./shard_raft_data";
 }
 
+// 解析带单位的字节数，支持kb、mb、gb后缀
+static size_t parseMemorySize(string value) {
+    size_t multiplier = 1;
+    if (value.length() > 2) {
+        string unit = value.substr(value.length() - 2);
+        transform(unit.begin(), unit.end(), unit.begin(), ::tolower);
+        if (unit == "kb") {
+            multiplier = 1024;
+        } else if (unit == "mb") {
+            multiplier = 1024 * 1024;
+        } else if (unit == "gb") {
+            multiplier = 1024 * 1024 * 1024;
+        }
+        if (multiplier != 1) {
+            value = value.substr(0, value.length() - 2);
+        }
+    }
+    return stoull(value) * multiplier;
+}
+
 bool DKVServer::parseConfigFile(const string& config_file) {
     ifstream file(config_file);
     if (!file.is_open()) {
@@ -967,6 +2025,107 @@ bool DKVServer::parseConfigFile(const string& config_file) {
                 port_ = stoi(value);
             } else if (key == "maxmemory") {
                 max_memory_ = stoull(value);
+            } else if (key == "maxmemory_policy") {
+                // 内存淘汰策略，取值与Redis相同，如allkeys-lru
+                transform(value.begin(), value.end(), value.begin(), ::tolower);
+                if (value == "noeviction") {
+                    eviction_policy_ = EvictionPolicy::NOEVICTION;
+                } else if (value == "volatile-lru") {
+                    eviction_policy_ = EvictionPolicy::VOLATILE_LRU;
+                } else if (value == "allkeys-lru") {
+                    eviction_policy_ = EvictionPolicy::ALLKEYS_LRU;
+                } else if (value == "volatile-lfu") {
+                    eviction_policy_ = EvictionPolicy::VOLATILE_LFU;
+                } else if (value == "allkeys-lfu") {
+                    eviction_policy_ = EvictionPolicy::ALLKEYS_LFU;
+                } else if (value == "volatile-random") {
+                    eviction_policy_ = EvictionPolicy::VOLATILE_RANDOM;
+                } else if (value == "allkeys-random") {
+                    eviction_policy_ = EvictionPolicy::ALLKEYS_RANDOM;
+                } else if (value == "volatile-ttl") {
+                    eviction_policy_ = EvictionPolicy::VOLATILE_TTL;
+                } else {
+                    DKV_LOG_WARNING("无效的内存淘汰策略: ", value);
+                }
+            } else if (key == "maxmemory_samples") {
+                // 近似淘汰每轮采样的键数
+                setMaxMemorySamples(stoull(value));
+            } else if (key == "memory_debug_tracking") {
+                // 逐块记录内存分配类型，开销较大，仅用于调试
+                MemoryAllocator::getInstance().setDebugTracking(value == "yes" || value == "true" || value == "1");
+            } else if (key == "storage_segments") {
+                // 键空间分段数量，至少为1
+                storage_segments_ = max<size_t>(1, stoull(value));
+            } else if (key == "rdb_threads") {
+                // RDB并行保存/加载的线程数，0表示按CPU核数
+                rdb_threads_ = stoull(value);
+            } else if (key == "rdb_background_load") {
+                // 启动时在后台加载RDB，加载期间即处理命令
+                rdb_background_load_ = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "rdb_compression") {
+                // RDB数据块压缩算法：lzf或none，兼容yes/no
+                if (value == "lzf" || value == "yes") {
+                    rdb_compression_ = RDBCompression::LZF;
+                } else if (value == "none" || value == "no") {
+                    rdb_compression_ = RDBCompression::NONE;
+                } else {
+                    DKV_LOG_WARNING("未知的RDB压缩算法: ", value, "，使用lzf");
+                    rdb_compression_ = RDBCompression::LZF;
+                }
+            } else if (key == "lazyfree_lazy_eviction") {
+                lazyfree_config_.lazy_eviction = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "lazyfree_lazy_expire") {
+                lazyfree_config_.lazy_expire = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "lazyfree_lazy_user_del") {
+                lazyfree_config_.lazy_user_del = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "lazyfree_lazy_user_flush") {
+                lazyfree_config_.lazy_user_flush = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "tiered_storage") {
+                tiered_config_.enabled = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "tiered_storage_path") {
+                tiered_config_.path = value;
+            } else if (key == "tiered_min_spill_size") {
+                tiered_config_.min_spill_size = stoull(value);
+            } else if (key == "tiered_min_idle_ms") {
+                tiered_config_.min_idle_ms = static_cast<uint32_t>(stoul(value));
+            } else if (key == "tracking_table_max_keys") {
+                tracking_table_max_keys_ = max<size_t>(1, stoull(value));
+            } else if (key == "slowlog_log_slower_than") {
+                // 执行耗时不小于该值（微秒）的命令写入慢查询日志，负数表示不记录
+                latency_monitor_.setSlowLogThreshold(stoll(value));
+            } else if (key == "slowlog_max_len") {
+                latency_monitor_.setSlowLogMaxLen(stoull(value));
+            } else if (key == "trace_sample_rate") {
+                // 每N批命令追踪一批各阶段的耗时，0表示关闭，见DEBUG TRACE
+                RequestTracer::setSampleRate(static_cast<uint32_t>(stoul(value)));
+            } else if (key == "script_cache_size") {
+                // 缓存的脚本编译结果数量上限，超出时淘汰最久未使用的脚本
+                script_cache_size_ = max<size_t>(1, stoull(value));
+            } else if (key == "hash_max_listpack_entries") {
+                // 小集合紧凑编码阈值
+                listpackConfig().hash_max_entries = stoull(value);
+            } else if (key == "hash_max_listpack_value") {
+                listpackConfig().hash_max_value = stoull(value);
+            } else if (key == "set_max_listpack_entries") {
+                listpackConfig().set_max_entries = stoull(value);
+            } else if (key == "set_max_listpack_value") {
+                listpackConfig().set_max_value = stoull(value);
+            } else if (key == "set_max_intset_entries") {
+                listpackConfig().set_max_intset_entries = stoull(value);
+            } else if (key == "zset_max_listpack_entries") {
+                listpackConfig().zset_max_entries = stoull(value);
+            } else if (key == "zset_max_listpack_value") {
+                listpackConfig().zset_max_value = stoull(value);
+            } else if (key == "list_max_listpack_size") {
+                listpackConfig().list_max_bytes = stoull(value);
+            } else if (key == "list_compress_depth") {
+                listpackConfig().list_compress_depth = stoull(value);
+            } else if (key == "string_compression") {
+                stringCompressionConfig().enabled = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "string_compression_min_size") {
+                stringCompressionConfig().min_bytes = stoull(value);
+            } else if (key == "string_compression_min_ratio") {
+                stringCompressionConfig().min_ratio = stod(value);
             } else if (key == "enable_rdb") {
                 enable_rdb_ = (value == "yes" || value == "true" || value == "1");
             } else if (key == "rdb_filename") {
@@ -1002,6 +2161,70 @@ bool DKVServer::parseConfigFile(const string& config_file) {
                     }
                 }
                 auto_aof_rewrite_min_size_ = stoi(size_str) * multiplier;
+            } else if (key == "aof_rewrite_rate_limit_mb") {
+                aof_rewrite_rate_limit_mb_ = stoul(value);
+            } else if (key == "reuseport") {
+                // 各SubReactor通过SO_REUSEPORT各自监听并接受连接
+                reuseport_ = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "io_backend") {
+                // epoll 或 io_uring
+                if (value == "io_uring") {
+                    io_backend_ = IoBackend::IO_URING;
+                } else if (value == "epoll") {
+                    io_backend_ = IoBackend::EPOLL;
+                } else {
+                    DKV_LOG_WARNING("无效的网络IO后端: ", value);
+                }
+            } else if (key == "reactor_cpus" || key == "worker_cpus") {
+                // CPU列表，如 0-3,8
+                vector<int>& cpus = key == "reactor_cpus" ? cpu_affinity_.reactor_cpus : cpu_affinity_.worker_cpus;
+                if (!parseCpuList(value, cpus)) {
+                    DKV_LOG_WARNING("无效的CPU列表: ", key, " ", value);
+                }
+            } else if (key == "numa_aware") {
+                cpu_affinity_.numa_aware = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "huge_pages") {
+                // no、transparent 或 explicit
+                if (!PageMemory::parseHugePageMode(value, huge_pages_)) {
+                    DKV_LOG_WARNING("无效的大页模式: ", value);
+                }
+            } else if (key == "numa_arenas") {
+                // slab按NUMA节点分区，线程从所在节点分配
+                numa_arenas_ = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "activedefrag") {
+                active_defrag_ = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "active_defrag_ignore_bytes") {
+                // slab多占用的字节数低于该值时不整理，支持kb/mb/gb后缀
+                active_defrag_ignore_bytes_ = parseMemorySize(value);
+            } else if (key == "active_defrag_threshold") {
+                // slab碎片率超过1+threshold/100时开始整理
+                active_defrag_threshold_ = static_cast<uint32_t>(stoul(value));
+            } else if (key == "memory_sample_interval") {
+                // 键空间内存采样每轮的间隔秒数，0表示关闭
+                memory_sample_interval_ = static_cast<uint32_t>(stoul(value));
+            } else if (key == "metrics_port") {
+                // 监控指标的HTTP导出端口，0表示不启用
+                metrics_port_ = stoi(value);
+            } else if (key == "run_to_completion") {
+                // 在SubReactor线程上直接执行命令，仅耗时命令交给工作线程池
+                run_to_completion_ = (value == "yes" || value == "true" || value == "1");
+            } else if (key == "slow_worker_threads") {
+                // 慢命令线程数，0表示不区分通道
+                slow_lane_.threads = stoul(value);
+            } else if (key == "slow_command_threshold") {
+                // 估计开销（元素个数）达到该值的命令走慢命令通道
+                slow_lane_.threshold = stoull(value);
+            } else if (key == "slow_worker_nice") {
+                // 慢命令线程的nice值增量
+                slow_lane_.nice = stoi(value);
+            } else if (key == "client_output_buffer_limit") {
+                // 格式: client_output_buffer_limit <hard> [<soft> <seconds>]，0表示不限制
+                client_output_limit_.hard_bytes = parseMemorySize(value);
+                string soft, seconds;
+                if (iss >> soft >> seconds && soft[0] != '#') {
+                    client_output_limit_.soft_bytes = parseMemorySize(soft);
+                    client_output_limit_.soft_seconds = stoull(seconds);
+                }
             } else if (key == "transaction_isolation_level") {
                 // 事务隔离等级配置
                 transform(value.begin(), value.end(), value.begin(), ::tolower);
@@ -1014,6 +2237,9 @@ bool DKVServer::parseConfigFile(const string& config_file) {
                 } else if (value == "serializable") {
                     transaction_isolation_level_ = TransactionIsolationLevel::SERIALIZABLE;
                 }
+            } else if (key == "mvcc_purge_interval_ms") {
+                // MVCC历史版本回收间隔，0表示不回收
+                setMVCCPurgeInterval(stoull(value));
             } else if (key == "enable_raft") {
                 // 是否启用RAFT
                 enable_raft_ = (value == "yes" || value == "true" || value == "1");
@@ -1029,6 +2255,36 @@ bool DKVServer::parseConfigFile(const string& config_file) {
             } else if (key == "max_raft_state") {
                 // RAFT日志最大大小
                 max_raft_state_ = stoi(value);
+            } else if (key == "raft_snapshot_rate_limit_mb") {
+                // 向跟随者发送快照的限速（MB/s），0表示不限速
+                raft_snapshot_rate_limit_ = stoull(value) * 1024 * 1024;
+            } else if (key == "raft_read_mode") {
+                // RAFT模式下读命令的一致性：local、readindex、lease
+                if (value == "local") {
+                    raft_read_mode_ = RaftReadMode::LOCAL;
+                } else if (value == "lease") {
+                    raft_read_mode_ = RaftReadMode::LEASE;
+                } else if (value == "readindex") {
+                    raft_read_mode_ = RaftReadMode::READ_INDEX;
+                } else {
+                    DKV_LOG_WARNING("未知的raft_read_mode: ", value, "，使用readindex");
+                    raft_read_mode_ = RaftReadMode::READ_INDEX;
+                }
+            } else if (key == "raft_replica_max_lag_entries") {
+                // READONLY连接在跟随者上读取时已应用索引最多落后的条数，负数表示不检查
+                raft_replica_max_lag_entries_ = stoi(value);
+            } else if (key == "raft_replica_max_lag_ms") {
+                // READONLY连接在跟随者上读取时距最近一次收到领导者消息最多的毫秒数，负数表示不检查
+                raft_replica_max_lag_ms_ = stoi(value);
+            } else if (key == "raft_apply_workers") {
+                // 并行应用已提交日志的线程数，键不冲突的命令分给不同线程，1表示逐条执行
+                raft_apply_workers_ = stoull(value);
+            } else if (key == "raft_max_batch_entries") {
+                // 每个AppendEntries请求最多携带的日志条目数，0表示不限制
+                raft_max_batch_entries_ = stoull(value);
+            } else if (key == "raft_max_batch_bytes") {
+                // 每个AppendEntries请求最多携带的命令字节数，0表示不限制
+                raft_max_batch_bytes_ = stoull(value);
             } else if (key.find("raft_peer_") == 0) {
                 // RAFT集群节点
                 int peer_id = stoi(key.substr(10)); // 从"raft_peer_"后面提取ID
@@ -1072,6 +2328,31 @@ bool DKVServer::parseConfigFile(const string& config_file) {
                 } else if (hash_type == "murmur3") {
                     shard_config_->hash_type = HashFunctionType::MURMUR3;
                 }
+            } else if (key == "shard_routing") {
+                // 键到分片的路由方式
+                if (!shard_config_) {
+                    shard_config_ = std::make_unique<ShardConfig>();
+                    InitializeDefaultShardConfig();
+                }
+                std::string routing = value;
+                transform(routing.begin(), routing.end(), routing.begin(), ::tolower);
+                if (routing == "slot") {
+                    shard_config_->routing_mode = ShardRoutingMode::HASH_SLOT;
+                } else if (routing == "hash") {
+                    shard_config_->routing_mode = ShardRoutingMode::CONSISTENT_HASH;
+                } else {
+                    DKV_LOG_WARNING("未知的分片路由方式: ", value, "，使用一致性哈希");
+                }
+            } else if (key == "shard_cpus") {
+                // 分片的Raft应用线程依次各绑定一个CPU，如 12-15
+                if (!shard_config_) {
+                    shard_config_ = std::make_unique<ShardConfig>();
+                    InitializeDefaultShardConfig();
+                }
+                if (!parseCpuList(value, shard_config_->shard_cpus)) {
+                    DKV_LOG_WARNING("无效的CPU列表: ", value);
+                    shard_config_->shard_cpus.clear();
+                }
             } else if (key == "auto_migration") {
                 // 是否自动迁移数据
                 if (!shard_config_) {
@@ -1119,6 +2400,9 @@ bool DKVServer::parseConfigFile(const string& config_file) {
             }
         }
     }
+    if (huge_pages_ != HugePageMode::OFF || numa_arenas_) {
+        PageMemory::configure(huge_pages_, numa_arenas_);
+    }
     return true;
 }
 
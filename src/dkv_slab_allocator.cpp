@@ -0,0 +1,403 @@
+#include "dkv_slab_allocator.hpp"
+#include "dkv_memory_allocator.hpp"
+#include "dkv_page_memory.hpp"
+#include <sys/mman.h>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+namespace dkv {
+
+namespace {
+
+// 各大小级别的对象大小，均为16的倍数以保证对齐
+constexpr size_t CLASS_SIZES[SlabAllocator::NUM_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512
+};
+
+// 线程本地缓存销毁后置位，之后的分配和释放直接访问slab
+thread_local bool tls_cache_exited = false;
+// 碎片整理期间置位，见SlabAllocator::DefragScope
+thread_local bool tls_defrag = false;
+
+} // namespace
+
+// 线程本地空闲对象缓存，arena为线程第一次使用时所在节点的分区
+struct SlabThreadCache {
+    SlabAllocator::FreeObject* heads[SlabAllocator::NUM_CLASSES] = {};
+    size_t counts[SlabAllocator::NUM_CLASSES] = {};
+    size_t arena = PageMemory::currentNode() % SlabAllocator::MAX_ARENAS;
+
+    ~SlabThreadCache() {
+        // 线程退出时把缓存的对象全部归还所属slab
+        SlabAllocator& allocator = SlabAllocator::getInstance();
+        for (size_t i = 0; i < SlabAllocator::NUM_CLASSES; ++i) {
+            if (heads[i] == nullptr) {
+                continue;
+            }
+            allocator.release(i, heads[i]);
+            heads[i] = nullptr;
+            counts[i] = 0;
+        }
+        tls_cache_exited = true;
+    }
+};
+
+static thread_local SlabThreadCache tls_cache;
+
+SlabAllocator& SlabAllocator::getInstance() {
+    static SlabAllocator* instance = new SlabAllocator();
+    return *instance;
+}
+
+size_t SlabAllocator::classIndex(size_t size) {
+    if (size <= 128) {
+        return size == 0 ? 0 : (size - 1) / 16;
+    }
+    if (size <= 256) {
+        return 8 + (size - 129) / 32;
+    }
+    return 12 + (size - 257) / 64;
+}
+
+size_t SlabAllocator::classSize(size_t index) {
+    return CLASS_SIZES[index];
+}
+
+void SlabAllocator::linkFront(SizeClass& size_class, Slab* slab) {
+    slab->prev = nullptr;
+    slab->next = size_class.partial_head;
+    if (size_class.partial_head) {
+        size_class.partial_head->prev = slab;
+    } else {
+        size_class.partial_tail = slab;
+    }
+    size_class.partial_head = slab;
+    slab->listed = true;
+}
+
+void SlabAllocator::linkBack(SizeClass& size_class, Slab* slab) {
+    slab->next = nullptr;
+    slab->prev = size_class.partial_tail;
+    if (size_class.partial_tail) {
+        size_class.partial_tail->next = slab;
+    } else {
+        size_class.partial_head = slab;
+    }
+    size_class.partial_tail = slab;
+    slab->listed = true;
+}
+
+void SlabAllocator::unlink(SizeClass& size_class, Slab* slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        size_class.partial_head = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    } else {
+        size_class.partial_tail = slab->prev;
+    }
+    slab->prev = nullptr;
+    slab->next = nullptr;
+    slab->listed = false;
+}
+
+SlabAllocator::Slab* SlabAllocator::newSlab(size_t arena_index, size_t index) {
+    char* memory = nullptr;
+    bool mapped = false;
+    if (PageMemory::hugePageMode() != HugePageMode::OFF || PageMemory::numaArenas()) {
+        // 从节点的页内存块中切分，页内存块用完后再映射一块；大页模式下每块正好是一个2MB大页。
+        // 页内存块按2MB对齐，切分出的slab自然按SLAB_SIZE对齐
+        Arena& arena = arenas_[arena_index];
+        std::lock_guard<std::mutex> lock(arena.chunk_mutex);
+        if (!arena.free_slabs.empty()) {
+            memory = arena.free_slabs.back();
+            arena.free_slabs.pop_back();
+        } else {
+            if (arena.chunk_left < SLAB_SIZE) {
+                void* chunk = PageMemory::map(CHUNK_SIZE, static_cast<int>(arena_index));
+                arena.chunk = static_cast<char*>(chunk);
+                arena.chunk_left = chunk ? CHUNK_SIZE : 0;
+            }
+            if (arena.chunk) {
+                memory = arena.chunk;
+                arena.chunk += SLAB_SIZE;
+                arena.chunk_left -= SLAB_SIZE;
+            }
+        }
+        mapped = memory != nullptr;
+    }
+    if (!memory) {
+        memory = static_cast<char*>(std::aligned_alloc(SLAB_SIZE, SLAB_SIZE));
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+    }
+
+    Slab* slab = new (memory) Slab();
+    const size_t object_size = CLASS_SIZES[index];
+    slab->capacity = static_cast<uint32_t>((SLAB_SIZE - SLAB_HEADER_SIZE) / object_size);
+    slab->free_count = slab->capacity;
+    slab->arena = static_cast<uint8_t>(arena_index);
+    slab->index = static_cast<uint8_t>(index);
+    slab->mapped = mapped;
+    FreeObject* head = nullptr;
+    for (size_t i = slab->capacity; i > 0; --i) {
+        FreeObject* object = reinterpret_cast<FreeObject*>(memory + SLAB_HEADER_SIZE + (i - 1) * object_size);
+        object->next = head;
+        head = object;
+    }
+    slab->free_list = head;
+    arenas_[arena_index].classes[index].slab_count.fetch_add(1, std::memory_order_relaxed);
+    return slab;
+}
+
+void SlabAllocator::freeSlab(Slab* slab) {
+    arenas_[slab->arena].classes[slab->index].slab_count.fetch_sub(1, std::memory_order_relaxed);
+    if (!slab->mapped) {
+        std::free(slab);
+        return;
+    }
+    // 页内存块整块映射，不能单独解除映射；归还物理页后留给下一个新slab复用
+    Arena& arena = arenas_[slab->arena];
+    madvise(slab, SLAB_SIZE, MADV_DONTNEED);
+    std::lock_guard<std::mutex> lock(arena.chunk_mutex);
+    arena.free_slabs.push_back(reinterpret_cast<char*>(slab));
+}
+
+SlabAllocator::FreeObject* SlabAllocator::refill(size_t arena, size_t index, size_t want, size_t& count) {
+    SizeClass& size_class = arenas_[arena].classes[index];
+    std::lock_guard<std::mutex> lock(size_class.mutex);
+    FreeObject* head = nullptr;
+    FreeObject* tail = nullptr;
+    count = 0;
+    while (count < want) {
+        Slab* slab = size_class.partial_head;
+        if (!slab) {
+            if (count > 0) {
+                break;
+            }
+            slab = newSlab(arena, index);
+            linkBack(size_class, slab);
+            size_class.empty_slabs++;
+        }
+        if (slab->free_count == slab->capacity) {
+            size_class.empty_slabs--;
+        }
+        // 按地址顺序取出，保持链表顺序
+        while (count < want && slab->free_list) {
+            FreeObject* object = slab->free_list;
+            slab->free_list = object->next;
+            slab->free_count--;
+            object->next = nullptr;
+            if (tail) {
+                tail->next = object;
+            } else {
+                head = object;
+            }
+            tail = object;
+            count++;
+        }
+        if (slab->free_count == 0) {
+            unlink(size_class, slab);
+        }
+    }
+    size_class.used_count.fetch_add(count, std::memory_order_relaxed);
+    return head;
+}
+
+void SlabAllocator::release(size_t index, FreeObject* head) {
+    // 链表中的对象可能来自不同分区，连续属于同一分区时只加一次锁
+    std::unique_lock<std::mutex> lock;
+    SizeClass* locked = nullptr;
+    size_t released = 0;
+    while (head) {
+        FreeObject* object = head;
+        head = head->next;
+        Slab* slab = slabOf(object);
+        SizeClass& size_class = arenas_[slab->arena].classes[index];
+        if (&size_class != locked) {
+            if (locked) {
+                locked->used_count.fetch_sub(released, std::memory_order_relaxed);
+            }
+            lock = std::unique_lock<std::mutex>(size_class.mutex);
+            locked = &size_class;
+            released = 0;
+        }
+        released++;
+        object->next = slab->free_list;
+        slab->free_list = object;
+        slab->free_count++;
+        if (!slab->listed) {
+            // 刚从满变为有空闲，是最满的slab
+            linkFront(size_class, slab);
+        }
+        if (slab->free_count == slab->capacity) {
+            if (size_class.empty_slabs > 0) {
+                unlink(size_class, slab);
+                freeSlab(slab);
+            } else {
+                size_class.empty_slabs++;
+            }
+        }
+    }
+    if (locked) {
+        locked->used_count.fetch_sub(released, std::memory_order_relaxed);
+    }
+}
+
+void* SlabAllocator::allocate(size_t size) {
+    if (size > MAX_SIZE) {
+        return MemoryAllocator::getInstance().allocate(size, "slab_large");
+    }
+    const size_t index = classIndex(size);
+    FreeObject* object = nullptr;
+    if (tls_cache_exited || tls_defrag) {
+        size_t count = 0;
+        object = refill(PageMemory::currentNode() % MAX_ARENAS, index, 1, count);
+    } else {
+        SlabThreadCache& cache = tls_cache;
+        if (cache.heads[index] == nullptr) {
+            cache.heads[index] = refill(cache.arena, index, BATCH_SIZE, cache.counts[index]);
+        }
+        object = cache.heads[index];
+        cache.heads[index] = object->next;
+        cache.counts[index]--;
+    }
+    // 按大小级别计入内存用量
+    MemoryAllocator::getInstance().recordUsage(static_cast<int64_t>(CLASS_SIZES[index]), 1, 0);
+    return object;
+}
+
+void SlabAllocator::deallocate(void* ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+    if (size > MAX_SIZE) {
+        MemoryAllocator::getInstance().deallocate(ptr);
+        return;
+    }
+    const size_t index = classIndex(size);
+    MemoryAllocator::getInstance().recordUsage(-static_cast<int64_t>(CLASS_SIZES[index]), 0, 1);
+    FreeObject* object = static_cast<FreeObject*>(ptr);
+    if (tls_cache_exited || tls_defrag) {
+        object->next = nullptr;
+        release(index, object);
+        return;
+    }
+    SlabThreadCache& cache = tls_cache;
+    object->next = cache.heads[index];
+    cache.heads[index] = object;
+    cache.counts[index]++;
+    // 本地缓存过多时归还一批给slab，避免单线程囤积
+    if (cache.counts[index] > 2 * BATCH_SIZE) {
+        FreeObject* head = cache.heads[index];
+        FreeObject* tail = head;
+        for (size_t i = 1; i < BATCH_SIZE; ++i) {
+            tail = tail->next;
+        }
+        cache.heads[index] = tail->next;
+        cache.counts[index] -= BATCH_SIZE;
+        tail->next = nullptr;
+        release(index, head);
+    }
+}
+
+bool SlabAllocator::shouldRelocate(const void* ptr) const {
+    if (!ptr) {
+        return false;
+    }
+    const Slab* slab = slabOf(ptr);
+    const SizeClass& size_class = arenas_[slab->arena].classes[slab->index];
+    std::lock_guard<std::mutex> lock(size_class.mutex);
+    // 满的slab没有可腾空的空间；表头的slab是下一次分配的来源，搬走只会在同一slab内移动
+    if (!slab->listed || slab == size_class.partial_head) {
+        return false;
+    }
+    const size_t slabs = size_class.slab_count.load(std::memory_order_relaxed);
+    const size_t in_use = slab->capacity - slab->free_count;
+    return in_use * slabs < size_class.used_count.load(std::memory_order_relaxed);
+}
+
+SlabAllocator::DefragScope::DefragScope() : previous_(tls_defrag) {
+    tls_defrag = true;
+}
+
+SlabAllocator::DefragScope::~DefragScope() {
+    tls_defrag = previous_;
+}
+
+size_t SlabAllocator::getSlabCount() const {
+    size_t total = 0;
+    for (size_t node = 0; node < MAX_ARENAS; ++node) {
+        total += getSlabCount(node);
+    }
+    return total;
+}
+
+size_t SlabAllocator::getSlabCount(size_t node) const {
+    size_t total = 0;
+    if (node >= MAX_ARENAS) {
+        return 0;
+    }
+    for (const auto& size_class : arenas_[node].classes) {
+        total += size_class.slab_count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t SlabAllocator::getReservedBytes() const {
+    return getSlabCount() * SLAB_SIZE;
+}
+
+size_t SlabAllocator::getUsedBytes() const {
+    size_t total = 0;
+    for (const auto& arena : arenas_) {
+        for (size_t i = 0; i < NUM_CLASSES; ++i) {
+            total += arena.classes[i].used_count.load(std::memory_order_relaxed) * CLASS_SIZES[i];
+        }
+    }
+    return total;
+}
+
+double SlabAllocator::getFragmentationRatio() const {
+    const size_t used = getUsedBytes();
+    return used == 0 ? 1.0 : static_cast<double>(getReservedBytes()) / static_cast<double>(used);
+}
+
+std::string SlabAllocator::getStats() const {
+    std::ostringstream oss;
+    oss << "# Slab Allocator Stats\n";
+    oss << "slab_count:" << getSlabCount() << "\n";
+    oss << "slab_reserved_bytes:" << getReservedBytes() << "\n";
+    oss << "slab_used_bytes:" << getUsedBytes() << "\n";
+    oss << "slab_classes:";
+    bool first = true;
+    for (size_t i = 0; i < NUM_CLASSES; ++i) {
+        size_t slabs = 0;
+        for (const auto& arena : arenas_) {
+            slabs += arena.classes[i].slab_count.load(std::memory_order_relaxed);
+        }
+        if (slabs == 0) {
+            continue;
+        }
+        if (!first) {
+            oss << ",";
+        }
+        oss << CLASS_SIZES[i] << "B:" << slabs;
+        first = false;
+    }
+    oss << "\n";
+    if (PageMemory::numaArenas()) {
+        for (size_t node = 0; node < PageMemory::nodeCount(); ++node) {
+            oss << "slab_node" << node << "_count:" << getSlabCount(node) << "\n";
+        }
+    }
+    return oss.str();
+}
+
+} // namespace dkv
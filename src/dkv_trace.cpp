@@ -0,0 +1,201 @@
+#include "dkv_trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace dkv {
+
+std::atomic<uint32_t> RequestTracer::sample_every_{0};
+
+namespace {
+
+struct TraceEvent {
+    uint64_t trace_id = 0;
+    const char* name = nullptr;
+    const char* detail = nullptr;
+    RequestTracer::Clock::time_point start{};
+    RequestTracer::Clock::time_point end{};
+    bool async = false;
+};
+
+// 一个线程的环形缓冲区。只有所属线程写入，导出时由其他线程读取，互斥锁基本无竞争
+struct ThreadBuffer {
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    size_t next = 0; // 下一个写入位置，写满后回绕覆盖最旧的事件
+    uint32_t tid = 0;
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    // 线程退出后缓冲区仍保留，其中的事件可以导出
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::atomic<uint64_t> next_trace_id{1};
+    // 导出的时间戳相对于此时刻
+    RequestTracer::Clock::time_point epoch = RequestTracer::Clock::now();
+};
+
+TraceRegistry& registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+ThreadBuffer& threadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        buffer->events.resize(RequestTracer::RING_CAPACITY);
+        buffer->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+        TraceRegistry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+// 距纪元的微秒数，保留纳秒精度
+void appendMicros(std::string& out, RequestTracer::Clock::duration duration) {
+    // 采样前记下的解析开始时间可能略早于纪元
+    int64_t ns = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), 0);
+    char text[32];
+    std::snprintf(text, sizeof(text), "%lld.%03lld", static_cast<long long>(ns / 1000),
+                  static_cast<long long>(ns % 1000));
+    out += text;
+}
+
+void appendEvent(std::string& out, const TraceEvent& event, uint32_t tid, char phase,
+                 RequestTracer::Clock::time_point ts, RequestTracer::Clock::time_point epoch) {
+    out += "{\"name\":\"";
+    out += event.name;
+    out += "\",\"cat\":\"dkv\",\"ph\":\"";
+    out += phase;
+    out += "\",\"ts\":";
+    appendMicros(out, ts - epoch);
+    if (phase == 'X') {
+        out += ",\"dur\":";
+        appendMicros(out, event.end - event.start);
+    } else {
+        // 同一追踪ID的异步事件在Perfetto中显示在同一条轨道上
+        out += ",\"id\":" + std::to_string(event.trace_id);
+    }
+    out += ",\"pid\":1,\"tid\":" + std::to_string(tid);
+    out += ",\"args\":{\"trace_id\":" + std::to_string(event.trace_id);
+    if (event.detail) {
+        out += ",\"detail\":\"";
+        out += event.detail;
+        out += "\"";
+    }
+    out += "}}";
+}
+
+} // namespace
+
+uint64_t RequestTracer::sampleSlow(uint32_t every) {
+    // 各线程分别计数，采样开启时也不争用同一个计数器
+    thread_local uint32_t counter = 0;
+    if (++counter < every) {
+        return 0;
+    }
+    counter = 0;
+    return registry().next_trace_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RequestTracer::record(uint64_t trace_id, const char* name, const char* detail,
+                           Clock::time_point start, Clock::time_point end) {
+    append(trace_id, name, detail, start, end, false);
+}
+
+void RequestTracer::recordAsync(uint64_t trace_id, const char* name, const char* detail,
+                                Clock::time_point start, Clock::time_point end) {
+    append(trace_id, name, detail, start, end, true);
+}
+
+void RequestTracer::append(uint64_t trace_id, const char* name, const char* detail,
+                           Clock::time_point start, Clock::time_point end, bool async) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    TraceEvent& event = buffer.events[buffer.next % RING_CAPACITY];
+    event.trace_id = trace_id;
+    event.name = name;
+    event.detail = detail;
+    event.start = start;
+    event.end = end;
+    event.async = async;
+    buffer.next++;
+}
+
+std::string RequestTracer::dumpJSON() {
+    TraceRegistry& reg = registry();
+    std::vector<std::pair<TraceEvent, uint32_t>> events;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto& buffer : reg.buffers) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            size_t count = std::min(buffer->next, RING_CAPACITY);
+            for (size_t i = buffer->next - count; i < buffer->next; ++i) {
+                events.emplace_back(buffer->events[i % RING_CAPACITY], buffer->tid);
+            }
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const auto& a, const auto& b) {
+        return a.first.start < b.first.start;
+    });
+
+    std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) {
+            out += ",";
+        }
+        first = false;
+    };
+    for (const auto& [event, tid] : events) {
+        if (event.async) {
+            separator();
+            appendEvent(out, event, tid, 'b', event.start, reg.epoch);
+            separator();
+            appendEvent(out, event, tid, 'e', event.end, reg.epoch);
+        } else {
+            separator();
+            appendEvent(out, event, tid, 'X', event.start, reg.epoch);
+        }
+    }
+    out += "]}";
+    return out;
+}
+
+bool RequestTracer::dumpToFile(const std::string& filename) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    file << dumpJSON();
+    return static_cast<bool>(file);
+}
+
+void RequestTracer::reset() {
+    TraceRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->next = 0;
+    }
+}
+
+size_t RequestTracer::eventCount() {
+    TraceRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t total = 0;
+    for (const auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        total += std::min(buffer->next, RING_CAPACITY);
+    }
+    return total;
+}
+
+} // namespace dkv
@@ -1,8 +1,8 @@
 #include "dkv_core.hpp"
 #include <sstream>
+#include <array>
 #include <algorithm>
 #include <cctype>
-#include <unordered_map>
 #include <execinfo.h>
 #include <cxxabi.h>
 #include <iostream>
@@ -12,161 +12,188 @@
 namespace dkv {
 
 // Utils 实现
-CommandType Utils::stringToCommandType(const std::string& cmd) {
-    static const std::unordered_map<std::string, CommandType> command_map = {
-        {"SET", CommandType::SET},
-        {"GET", CommandType::GET},
-        {"DEL", CommandType::DEL},
-        {"EXISTS", CommandType::EXISTS},
-        {"EXPIRE", CommandType::EXPIRE},
-        {"TTL", CommandType::TTL},
-        {"INCR", CommandType::INCR},
-        {"DECR", CommandType::DECR},
-        // 哈希命令
-        {"HSET", CommandType::HSET},
-        {"HGET", CommandType::HGET},
-        {"HGETALL", CommandType::HGETALL},
-        {"HDEL", CommandType::HDEL},
-        {"HEXISTS", CommandType::HEXISTS},
-        {"HKEYS", CommandType::HKEYS},
-        {"HVALS", CommandType::HVALS},
-        {"HLEN", CommandType::HLEN},
-        // 列表命令
-        {"LPUSH", CommandType::LPUSH},
-        {"RPUSH", CommandType::RPUSH},
-        {"LPOP", CommandType::LPOP},
-        {"RPOP", CommandType::RPOP},
-        {"LLEN", CommandType::LLEN},
-        {"LRANGE", CommandType::LRANGE},
-        // 集合命令
-        {"SADD", CommandType::SADD},
-        {"SREM", CommandType::SREM},
-        {"SMEMBERS", CommandType::SMEMBERS},
-        {"SISMEMBER", CommandType::SISMEMBER},
-        {"SCARD", CommandType::SCARD},
-        // 服务器管理命令
-        {"FLUSHDB", CommandType::FLUSHDB},
-        {"DBSIZE", CommandType::DBSIZE},
-        {"INFO", CommandType::INFO},
-        {"SHUTDOWN", CommandType::SHUTDOWN},
-        {"SAVE", CommandType::SAVE},
-        {"BGSAVE", CommandType::BGSAVE},
-        // 有序集合命令
-        {"ZADD", CommandType::ZADD},
-        {"ZREM", CommandType::ZREM},
-        {"ZSCORE", CommandType::ZSCORE},
-        {"ZISMEMBER", CommandType::ZISMEMBER},
-        {"ZRANK", CommandType::ZRANK},
-        {"ZREVRANK", CommandType::ZREVRANK},
-        {"ZRANGE", CommandType::ZRANGE},
-        {"ZREVRANGE", CommandType::ZREVRANGE},
-        {"ZRANGEBYSCORE", CommandType::ZRANGEBYSCORE},
-        {"ZREVRANGEBYSCORE", CommandType::ZREVRANGEBYSCORE},
-        {"ZCOUNT", CommandType::ZCOUNT},
-        {"ZCARD", CommandType::ZCARD},
-        // 位图命令
-        {"SETBIT", CommandType::SETBIT},
-        {"GETBIT", CommandType::GETBIT},
-        {"BITCOUNT", CommandType::BITCOUNT},
-        {"BITOP", CommandType::BITOP},
-        // HyperLogLog命令
-        {"PFADD", CommandType::PFADD},
-        {"PFCOUNT", CommandType::PFCOUNT},
-        {"PFMERGE", CommandType::PFMERGE},
-        // AOF重写专用命令
-        {"RESTORE_HLL", CommandType::RESTORE_HLL},
-        // 事务命令
-        {"MULTI", CommandType::MULTI},
-        {"EXEC", CommandType::EXEC},
-        {"DISCARD", CommandType::DISCARD},
-        // 脚本命令
-        {"EVALX", CommandType::EVALX},
-    };
-    
-    auto it = command_map.find(cmd);
-    return (it != command_map.end()) ? it->second : CommandType::UNKNOWN;
+CommandType Utils::stringToCommandType(std::string_view cmd) {
+    const CommandSpec* spec = findCommand(cmd);
+    return spec ? spec->type : CommandType::UNKNOWN;
 }
 
 std::string Utils::commandTypeToString(CommandType type) {
-    static const std::unordered_map<CommandType, std::string> type_map = {
-        {CommandType::UNKNOWN, "UNKNOWN"},
-        {CommandType::SET, "SET"},
-        {CommandType::GET, "GET"},
-        {CommandType::DEL, "DEL"},
-        {CommandType::EXISTS, "EXISTS"},
-        {CommandType::EXPIRE, "EXPIRE"},
-        {CommandType::TTL, "TTL"},
-        {CommandType::INCR, "INCR"},
-        {CommandType::DECR, "DECR"},
-        // 哈希命令
-        {CommandType::HSET, "HSET"},
-        {CommandType::HGET, "HGET"},
-        {CommandType::HGETALL, "HGETALL"},
-        {CommandType::HDEL, "HDEL"},
-        {CommandType::HEXISTS, "HEXISTS"},
-        {CommandType::HKEYS, "HKEYS"},
-        {CommandType::HVALS, "HVALS"},
-        {CommandType::HLEN, "HLEN"},
-        // 列表命令
-        {CommandType::LPUSH, "LPUSH"},
-        {CommandType::RPUSH, "RPUSH"},
-        {CommandType::LPOP, "LPOP"},
-        {CommandType::RPOP, "RPOP"},
-        {CommandType::LLEN, "LLEN"},
-        {CommandType::LRANGE, "LRANGE"},
-        // 集合命令
-        {CommandType::SADD, "SADD"},
-        {CommandType::SREM, "SREM"},
-        {CommandType::SMEMBERS, "SMEMBERS"},
-        {CommandType::SISMEMBER, "SISMEMBER"},
-        {CommandType::SCARD, "SCARD"},
-        // 服务器管理命令
-        {CommandType::FLUSHDB, "FLUSHDB"},
-        {CommandType::DBSIZE, "DBSIZE"},
-        {CommandType::INFO, "INFO"},
-        {CommandType::SHUTDOWN, "SHUTDOWN"},
-        {CommandType::SAVE, "SAVE"},
-        {CommandType::BGSAVE, "BGSAVE"},
-        // 有序集合命令
-        {CommandType::ZADD, "ZADD"},
-        {CommandType::ZREM, "ZREM"},
-        {CommandType::ZSCORE, "ZSCORE"},
-        {CommandType::ZISMEMBER, "ZISMEMBER"},
-        {CommandType::ZRANK, "ZRANK"},
-        {CommandType::ZREVRANK, "ZREVRANK"},
-        {CommandType::ZRANGE, "ZRANGE"},
-        {CommandType::ZREVRANGE, "ZREVRANGE"},
-        {CommandType::ZRANGEBYSCORE, "ZRANGEBYSCORE"},
-        {CommandType::ZREVRANGEBYSCORE, "ZREVRANGEBYSCORE"},
-        {CommandType::ZCOUNT, "ZCOUNT"},
-        {CommandType::ZCARD, "ZCARD"},
-        // 位图命令
-        {CommandType::SETBIT, "SETBIT"},
-        {CommandType::GETBIT, "GETBIT"},
-        {CommandType::BITCOUNT, "BITCOUNT"},
-        {CommandType::BITOP, "BITOP"},
-        // HyperLogLog命令
-        {CommandType::PFADD, "PFADD"},
-        {CommandType::PFCOUNT, "PFCOUNT"},
-        {CommandType::PFMERGE, "PFMERGE"},
-        // AOF重写专用命令
-        {CommandType::RESTORE_HLL, "RESTORE_HLL"},
-        // 事务命令
-        {CommandType::MULTI, "MULTI"},
-        {CommandType::EXEC, "EXEC"},
-        {CommandType::DISCARD, "DISCARD"},
-        // 脚本命令
-        {CommandType::EVALX, "EVALX"},
-    };
-    
-    auto it = type_map.find(type);
-    return (it != type_map.end()) ? it->second : "UNKNOWN";
+    return std::string(commandSpec(type).name);
 }
 
 Timestamp Utils::getCurrentTime() {
     return std::chrono::system_clock::now();
 }
 
+uint32_t Utils::crc32(const char* data, size_t length, uint32_t crc) {
+    static const auto table = []() {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value >> 1) ^ (0xEDB88320u & (0u - (value & 1u)));
+            }
+            entries[i] = value;
+        }
+        return entries;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+std::string Utils::sha1Hex(const std::string& data) {
+    uint32_t h[5] = {0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u};
+    auto rotl = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    // 补一个0x80，再补0到长度模64余56，最后是64位大端的位长度
+    std::string message = data;
+    const uint64_t bit_length = static_cast<uint64_t>(data.size()) * 8;
+    message.push_back(static_cast<char>(0x80));
+    while (message.size() % 64 != 56) {
+        message.push_back('\0');
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        message.push_back(static_cast<char>((bit_length >> shift) & 0xFF));
+    }
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto* p = reinterpret_cast<const uint8_t*>(message.data() + chunk + i * 4);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999u;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1u;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDCu;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6u;
+            }
+            const uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    static const char hex[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(40);
+    for (uint32_t word : h) {
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            result.push_back(hex[(word >> shift) & 0xF]);
+        }
+    }
+    return result;
+}
+
+namespace {
+
+// 匹配字符类[...]，pos指向'['之后，返回时指向']'之后
+bool matchCharClass(const std::string& pattern, size_t& pos, char c) {
+    bool negate = pos < pattern.size() && pattern[pos] == '^';
+    if (negate) {
+        pos++;
+    }
+    bool matched = false;
+    while (pos < pattern.size() && pattern[pos] != ']') {
+        if (pattern[pos] == '\\' && pos + 1 < pattern.size()) {
+            pos++;
+            matched |= pattern[pos] == c;
+            pos++;
+        } else if (pos + 2 < pattern.size() && pattern[pos + 1] == '-' && pattern[pos + 2] != ']') {
+            char low = pattern[pos];
+            char high = pattern[pos + 2];
+            if (low > high) {
+                std::swap(low, high);
+            }
+            matched |= c >= low && c <= high;
+            pos += 3;
+        } else {
+            matched |= pattern[pos] == c;
+            pos++;
+        }
+    }
+    if (pos < pattern.size()) {
+        pos++;
+    }
+    return matched != negate;
+}
+
+} // namespace
+
+bool Utils::matchPattern(const std::string& pattern, std::string_view str) {
+    size_t p = 0;
+    size_t s = 0;
+    // 最近一个'*'之后的模式位置及其对应的字符串位置，失配时回溯到这里让'*'多吞一个字符
+    size_t star_p = std::string::npos;
+    size_t star_s = 0;
+    while (s < str.size()) {
+        if (p < pattern.size()) {
+            char pc = pattern[p];
+            if (pc == '*') {
+                star_p = ++p;
+                star_s = s;
+                continue;
+            }
+            if (pc == '?') {
+                p++;
+                s++;
+                continue;
+            }
+            if (pc == '[') {
+                size_t next = p + 1;
+                if (matchCharClass(pattern, next, str[s])) {
+                    p = next;
+                    s++;
+                    continue;
+                }
+            } else {
+                if (pc == '\\' && p + 1 < pattern.size()) {
+                    pc = pattern[p + 1];
+                    if (pc == str[s]) {
+                        p += 2;
+                        s++;
+                        continue;
+                    }
+                } else if (pc == str[s]) {
+                    p++;
+                    s++;
+                    continue;
+                }
+            }
+        }
+        if (star_p == std::string::npos) {
+            return false;
+        }
+        p = star_p;
+        s = ++star_s;
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
 bool Utils::isNumeric(const std::string& str) {
     if (str.empty()) {
         return false;
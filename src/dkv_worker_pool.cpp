@@ -3,18 +3,29 @@
 #include "net/dkv_network.hpp"
 #include "dkv_server.hpp"
 #include "dkv_logger.hpp"
+#include "dkv_trace.hpp"
+#include "dkv_cpu_affinity.hpp"
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
 
 namespace dkv {
 
-WorkerThreadPool::WorkerThreadPool(DKVServer* server, size_t num_threads) 
-    : server_(server), stop_(false) {
-    // 创建工作线程 
-    for (size_t i = 0; i < num_threads; ++i) {
-        workers_.emplace_back(&WorkerThreadPool::workerThread, this);
+WorkerThreadPool::WorkerThreadPool(DKVServer* server, size_t num_threads, size_t num_groups,
+                                   const SlowLaneConfig& slow_lane)
+    : server_(server), stop_(false), slow_lane_(slow_lane) {
+    num_workers_ = std::max<size_t>(1, num_threads);
+    num_groups_ = std::min(std::max<size_t>(1, num_groups), num_workers_);
+    for (size_t i = 0; i < num_workers_ + slow_lane_.threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    // 队列全部就绪后再创建工作线程，窃取时会访问其他线程的队列
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::thread(&WorkerThreadPool::workerThread, this, i);
     }
     
-    DKV_LOG_INFO("工作线程池已创建，线程数: ", num_threads);
+    DKV_LOG_INFO("工作线程池已创建，线程数: ", num_workers_, ", 分组数: ", num_groups_,
+                 ", 慢命令线程数: ", slow_lane_.threads);
 }
 
 WorkerThreadPool::~WorkerThreadPool() {
@@ -22,79 +33,338 @@ WorkerThreadPool::~WorkerThreadPool() {
 }
 
 void WorkerThreadPool::enqueue(const CommandTask& task) {
+    enqueue(CommandTask(task));
+}
+
+void WorkerThreadPool::enqueue(CommandTask&& task) {
+    if (stop_.load()) {
+        throw std::runtime_error("线程池已停止，无法添加新任务");
+    }
+    if (!task.batch) {
+        task.slow = slow_lane_.threads > 0 && isSlowBatch(task.commands);
+    }
+    if (task.slow) {
+        enqueueSlow(std::move(task));
+        return;
+    }
+
+    size_t home = homeWorker(task);
+    size_t target = home;
+    bool pushed = workers_[home]->queue.tryPush(std::move(task));
+    // 本地队列已满时依次尝试其他线程，都满时放入溢出队列
+    for (size_t i = 1; !pushed && i < num_workers_; ++i) {
+        target = (home + i) % num_workers_;
+        pushed = workers_[target]->queue.tryPush(std::move(task));
+    }
+    if (!pushed) {
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        overflow_queue_.push(std::move(task));
+        overflow_size_.fetch_add(1);
+        target = home;
+    }
+    notifyAfterPush(target);
+}
+
+void WorkerThreadPool::enqueueSlow(CommandTask&& task) {
     {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        if (stop_.load()) {
-            throw std::runtime_error("线程池已停止，无法添加新任务");
+        std::lock_guard<std::mutex> lock(slow_mutex_);
+        slow_queue_.push_back(std::move(task));
+        slow_size_.fetch_add(1);
+    }
+    // 与waitForWork中的屏障配对，慢命令线程都在忙时由它们执行完当前任务后取走
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (size_t i = num_workers_; i < workers_.size(); ++i) {
+        if (workers_[i]->sleeping.load(std::memory_order_relaxed)) {
+            wakeWorker(i);
+            return;
         }
-        task_queue_.push(task);
     }
-    
-    // 通知一个等待的工作线程
-    condition_.notify_one();
 }
 
-void WorkerThreadPool::stop() {
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        stop_.store(true);
+bool WorkerThreadPool::isSlowBatch(const std::vector<Command>& commands) const {
+    for (const auto& command : commands) {
+        if (isLongRunningCommand(command.type)) {
+            return true;
+        }
+        if (server_ && isSizeCostCommand(command.type) &&
+            server_->estimateCommandCost(command) >= slow_lane_.threshold) {
+            return true;
+        }
     }
+    return false;
+}
+
+void WorkerThreadPool::stop() {
+    stop_.store(true);
     
     // 通知所有工作线程
-    condition_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        wakeWorker(i);
+    }
     
     // 等待所有工作线程完成
     for (auto& worker : workers_) {
-        if (worker.joinable()) {
-            worker.join();
+        if (worker->thread.joinable()) {
+            worker->thread.join();
         }
     }
 }
 
-Response WorkerThreadPool::executeCommand(int client_fd, const Command& command) {
-    if (!server_) {
-        return Response(ResponseStatus::ERROR, "DKV server not initialized");
+size_t WorkerThreadPool::homeWorker(const CommandTask& task) const {
+    size_t group = task.reactor_index % num_groups_;
+    size_t begin = groupBegin(group);
+    size_t end = groupBegin(group + 1);
+    return begin + task.connection_id % (end - begin);
+}
+
+size_t WorkerThreadPool::groupOf(size_t index) const {
+    size_t group = 0;
+    while (group + 1 < num_groups_ && groupBegin(group + 1) <= index) {
+        group++;
     }
-    
-    return server_->OnClientCommand(client_fd, command);
+    return group;
+}
+
+bool WorkerThreadPool::pinWorker(size_t index, const std::vector<int>& cpus) {
+    return pinThread(workers_[index]->thread, cpus);
+}
+
+bool WorkerThreadPool::tryDequeue(size_t index, CommandTask& task) {
+    if (isSlowWorker(index) && slow_size_.load() > 0) {
+        std::lock_guard<std::mutex> lock(slow_mutex_);
+        if (!slow_queue_.empty()) {
+            task = std::move(slow_queue_.front());
+            slow_queue_.pop_front();
+            slow_size_.fetch_sub(1);
+            return true;
+        }
+    }
+    // 同组线程编号相邻，从下一个线程开始依次窃取即优先窃取同组线程
+    for (size_t i = 0; i < num_workers_; ++i) {
+        if (workers_[(index + i) % num_workers_]->queue.tryPop(task)) {
+            return true;
+        }
+    }
+    if (overflow_size_.load() > 0) {
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        if (!overflow_queue_.empty()) {
+            task = std::move(overflow_queue_.front());
+            overflow_queue_.pop();
+            overflow_size_.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerThreadPool::notifyAfterPush(size_t index) {
+    // 与waitForWork中的屏障配对：要么看到线程已休眠并唤醒它，要么线程休眠前看到新任务
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Worker& worker = *workers_[index];
+    if (worker.sleeping.load(std::memory_order_relaxed)) {
+        wakeWorker(index);
+        return;
+    }
+    // 目标线程正忙，积压多于一个任务时才唤醒空闲线程窃取，避免每次入队都唤醒
+    if (idle_workers_.load(std::memory_order_relaxed) == 0 || worker.queue.sizeApprox() <= 1) {
+        return;
+    }
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        size_t peer = (index + i) % workers_.size();
+        if (workers_[peer]->sleeping.load(std::memory_order_relaxed)) {
+            wakeWorker(peer);
+            return;
+        }
+    }
+}
+
+void WorkerThreadPool::wakeWorker(size_t index) {
+    Worker& worker = *workers_[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.wake_pending = true;
+    }
+    worker.condition.notify_one();
+}
+
+void WorkerThreadPool::waitForWork(size_t index) {
+    // 休眠超时，兜底处理未被及时唤醒的窃取机会
+    constexpr auto IDLE_TIMEOUT = std::chrono::milliseconds(50);
+    Worker& worker = *workers_[index];
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    worker.sleeping.store(true, std::memory_order_relaxed);
+    idle_workers_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    worker.condition.wait_for(lock, IDLE_TIMEOUT, [&] {
+        return worker.wake_pending || stop_.load() || !worker.queue.empty() || overflow_size_.load() > 0 ||
+               (isSlowWorker(index) && slow_size_.load() > 0);
+    });
+    worker.wake_pending = false;
+    worker.sleeping.store(false, std::memory_order_relaxed);
+    idle_workers_.fetch_sub(1);
 }
 
-void WorkerThreadPool::workerThread() {
+// 一批命令的执行进度
+// Raft写命令入日志后即返回，结果由应用线程回调，同一批中连续的写命令可以同时等待提交；
+// 读命令和事务控制命令须等前面的命令全部完成后再执行，保证读到本连接之前的写入以及事务状态正确
+struct CommandBatch {
     CommandTask task;
+    std::vector<Response> responses;
+    size_t next = 0;        // 下一条待执行的命令，只由持有执行权的线程访问
+    bool exclusive = false; // 最近提交的命令须独占执行，后续命令等它完成
+    // 未完成的命令数，执行线程另持有一个计数，归零的一方负责继续执行或交付回复
+    std::atomic<size_t> outstanding{0};
+};
+
+namespace {
+
+// 前面的命令尚未完成时能否开始执行：只有不依赖连接状态的写命令可以
+bool canOverlap(CommandType type) {
+    switch (type) {
+        case CommandType::MULTI:
+        case CommandType::EXEC:
+        case CommandType::DISCARD:
+        case CommandType::WATCH:
+        case CommandType::UNWATCH:
+            return false;
+        default:
+            // 阻塞命令等待期间不执行同一连接的后续命令
+            return !isReadOnlyCommand(type) && !isBlockingCommand(type);
+    }
+}
+
+} // namespace
+
+size_t WorkerThreadPool::queuedTasks() const {
+    size_t total = overflow_size_.load(std::memory_order_relaxed) + slow_size_.load(std::memory_order_relaxed);
+    for (const auto& worker : workers_) {
+        total += worker->queue.sizeApprox();
+    }
+    return total;
+}
+
+void WorkerThreadPool::executeTask(CommandTask&& task) {
+    std::shared_ptr<CommandBatch> batch = std::move(task.batch);
+    if (!batch && server_ && task.enqueue_time != std::chrono::steady_clock::time_point{}) {
+        auto now = LatencyMonitor::Clock::now();
+        server_->latencyMonitor().recordStage(LatencyStage::QUEUE, LatencyMonitor::elapsedUs(task.enqueue_time, now));
+        if (task.trace_id != 0) {
+            RequestTracer::recordAsync(task.trace_id, "queue", nullptr, task.enqueue_time, now);
+        }
+    }
+    if (!batch) {
+        batch = std::make_shared<CommandBatch>();
+        batch->responses.resize(task.commands.size());
+        batch->task = std::move(task);
+    }
+    runBatch(batch);
+}
+
+void WorkerThreadPool::runBatch(const std::shared_ptr<CommandBatch>& batch) {
+    const std::vector<Command>& commands = batch->task.commands;
+    // 执行期间存储锁、MVCC、AOF等阶段从线程局部变量取得追踪ID
+    TraceScope trace_scope(batch->task.trace_id);
+    while (true) {
+        batch->outstanding.store(1);
+        while (batch->next < commands.size()) {
+            const Command& command = commands[batch->next];
+            bool exclusive = !canOverlap(command.type);
+            if ((exclusive || batch->exclusive) && batch->outstanding.load() > 1) {
+                break; // 等前面的命令完成后由最后完成的命令重新提交
+            }
+            size_t slot = batch->next++;
+            batch->exclusive = exclusive;
+            if (command.type == CommandType::UNKNOWN || !server_) {
+                if (!server_) {
+                    batch->responses[slot] = Response(ResponseStatus::ERROR, "DKV server not initialized");
+                }
+                continue;
+            }
+            batch->outstanding.fetch_add(1);
+            // 被追踪的命令记录从开始执行到回调之间的耗时，Raft写命令在应用线程上回调
+            auto trace_start = batch->task.trace_id != 0 ? RequestTracer::Clock::now() : RequestTracer::Clock::time_point{};
+            try {
+                server_->OnClientCommand(batch->task.client_fd, command, [this, batch, slot, trace_start](const Response& response) {
+                    if (batch->task.trace_id != 0) {
+                        RequestTracer::recordAsync(batch->task.trace_id, "command",
+                                                   commandSpec(batch->task.commands[slot].type).name.data(),
+                                                   trace_start, RequestTracer::Clock::now());
+                    }
+                    batch->responses[slot] = response;
+                    completeCommand(batch);
+                }, batch->task.sub_reactor, batch->task.connection_id);
+            } catch (const std::exception& e) {
+                DKV_LOG_ERROR("执行命令时出错: ", e.what());
+                completeCommand(batch);
+            }
+        }
+        if (batch->outstanding.fetch_sub(1) != 1) {
+            return; // 还有命令在等待Raft提交，由最后完成的命令继续
+        }
+        if (batch->next == commands.size()) {
+            finishBatch(*batch);
+            return;
+        }
+    }
+}
+
+void WorkerThreadPool::completeCommand(const std::shared_ptr<CommandBatch>& batch) {
+    if (batch->outstanding.fetch_sub(1) != 1) {
+        return;
+    }
+    if (batch->next == batch->task.commands.size()) {
+        finishBatch(*batch);
+        return;
+    }
+    // 在Raft应用线程上完成时不能直接执行后续命令（读命令可能等待应用进度），转交工作线程
+    CommandTask resume;
+    resume.sub_reactor = batch->task.sub_reactor;
+    resume.client_fd = batch->task.client_fd;
+    resume.connection_id = batch->task.connection_id;
+    resume.reactor_index = batch->task.reactor_index;
+    resume.slow = batch->task.slow;
+    resume.batch = batch;
+    try {
+        enqueue(std::move(resume));
+    } catch (const std::exception& e) {
+        DKV_LOG_ERROR("继续执行命令失败: ", e.what());
+    }
+}
+
+void WorkerThreadPool::finishBatch(CommandBatch& batch) {
+    if (batch.task.sub_reactor) {
+        batch.task.sub_reactor->handleCommandResults(batch.task.client_fd, batch.task.connection_id, batch.responses,
+                                                     batch.task.trace_id);
+    }
+}
+
+void WorkerThreadPool::workerThread(size_t index) {
+    // 休眠前自旋尝试的轮数，短暂空闲时不必经过futex
+    constexpr int SPIN_ROUNDS = 64;
+    CommandTask task;
+    if (isSlowWorker(index) && slow_lane_.nice != 0) {
+        setCurrentThreadNice(slow_lane_.nice);
+    }
     
     while (true) {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            
-            // 等待直到有任务或线程池停止
-            condition_.wait(lock, [this] { 
-                return stop_.load() || !task_queue_.empty(); 
-            });
-            
+        bool found = false;
+        for (int round = 0; round < SPIN_ROUNDS && !found; ++round) {
+            found = tryDequeue(index, task);
+            if (!found) {
+                std::this_thread::yield();
+            }
+        }
+        if (!found) {
             // 如果线程池已停止且任务队列为空，则退出
-            if (stop_.load() && task_queue_.empty()) {
+            if (stop_.load()) {
                 break;
             }
-            
-            // 获取任务
-            task = std::move(task_queue_.front());
-            task_queue_.pop();
+            waitForWork(index);
+            continue;
         }
         
-        Response response;
-        try {
-            // 执行命令
-            if (task.command.type != CommandType::UNKNOWN) {
-                response = executeCommand(task.client_fd, task.command);
-            }
-        } catch (const std::exception& e) {
-             DKV_LOG_ERROR("工作线程执行任务时出错: ", e.what());
-        }
-
-        // 调用SubReactor处理结果
-        if (task.sub_reactor) {
-            task.sub_reactor->handleCommandResult(task.client_fd, response);
-        }
+        // 按顺序执行同一连接的一批命令，全部完成后交给SubReactor写出回复
+        executeTask(std::move(task));
     }
 }
 
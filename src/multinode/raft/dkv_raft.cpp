@@ -1,5 +1,7 @@
 #include "multinode/raft/dkv_raft.hpp"
+#include "multinode/raft/dkv_raft_log_codec.hpp"
 #include "dkv_logger.hpp"
+#include "dkv_cpu_affinity.hpp"
 #include "dkv_command_handler.hpp"
 #include "net/dkv_resp.hpp"
 #include <fstream>
@@ -7,21 +9,83 @@
 #include <chrono>
 #include <random>
 #include <algorithm>
+#include <charconv>
 #include <memory>
 using namespace std;
 
 namespace dkv {
 
+Command RaftCommand::EncodeTransaction(const std::vector<Command>& commands) {
+    Command encoded(CommandType::EXEC, {});
+    for (const auto& command : commands) {
+        encoded.args.push_back(to_string(static_cast<int>(command.type)));
+        encoded.args.push_back(to_string(command.args.size()));
+        encoded.args.insert(encoded.args.end(), command.args.begin(), command.args.end());
+    }
+    return encoded;
+}
+
+bool RaftCommand::DecodeTransaction(const Command& command, std::vector<Command>& commands) {
+    auto parse = [](const std::string& text, size_t& value) {
+        auto result = from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == errc() && result.ptr == text.data() + text.size();
+    };
+    commands.clear();
+    const std::vector<std::string>& args = command.args;
+    size_t pos = 0;
+    while (pos < args.size()) {
+        size_t type = 0;
+        size_t argc = 0;
+        if (pos + 2 > args.size() || !parse(args[pos], type) || type >= COMMAND_COUNT ||
+            !parse(args[pos + 1], argc) || argc > args.size() - pos - 2) {
+            return false;
+        }
+        pos += 2;
+        commands.emplace_back(static_cast<CommandType>(type),
+                              std::vector<std::string>(args.begin() + pos, args.begin() + pos + argc));
+        pos += argc;
+    }
+    return true;
+}
+
+std::vector<char> RaftPersister::ReadSnapshotChunk(uint64_t offset, size_t length, uint64_t& total) {
+    std::vector<char> snapshot = ReadSnapshot();
+    total = snapshot.size();
+    if (offset >= total) {
+        return {};
+    }
+    const size_t end = static_cast<size_t>(std::min<uint64_t>(offset + length, total));
+    return std::vector<char>(snapshot.begin() + offset, snapshot.begin() + end);
+}
+
+ReadIndexResponse RaftNetwork::SendReadIndex(int /*serverId*/, const ReadIndexRequest& /*request*/) {
+    return ReadIndexResponse();
+}
+
+bool RaftNetwork::IsPeerAlive(int /*serverId*/, int /*within_ms*/) {
+    return false;
+}
+
 // RAFT构造函数
 Raft::Raft(int me, const std::vector<std::string>& peers, std::shared_ptr<dkv::RaftPersister> persister, std::shared_ptr<RaftNetwork> network, std::shared_ptr<RaftStateMachine> stateMachine)
-    : me_(me), peers_(peers), persister_(persister), network_(network), stateMachine_(stateMachine),
-      state_(RaftState::FOLLOWER), currentTerm_(0), votedFor_(-1),
-      commitIndex_(0), lastApplied_(0), running_(false), max_raft_state_(100 * 1024 * 1024),
-      logStartIndex_(1), currentLeaderId_(-1) {
+    : me_(me), peers_(peers), state_(RaftState::FOLLOWER), currentTerm_(0), votedFor_(-1),
+      commitIndex_(0), lastApplied_(0),
+      snapshotRateLimit_(0), snapshotTokens_(0), snapshotTokensTime_(std::chrono::steady_clock::now()),
+      maxBatchEntries_(RAFT_DEFAULT_MAX_BATCH_ENTRIES), maxBatchBytes_(RAFT_DEFAULT_MAX_BATCH_BYTES),
+      readRound_(0), leaseRead_(false), leaderCommit_(0), quiesceEnabled_(false), quiesced_(false), quiescedLeaderTerm_(-1),
+      pendingSnapshotIndex_(RAFT_INVALID_INDEX), persister_(persister), network_(network), stateMachine_(stateMachine),
+      running_(false), durableIndex_(0), logTruncations_(0), logStartIndex_(1), max_raft_state_(100 * 1024 * 1024),
+      currentLeaderId_(-1) {
     
     // 初始化领导者相关数组
     nextIndex_.resize(peers_.size(), 0);
     matchIndex_.resize(peers_.size(), 0);
+    snapshotSendIndex_.resize(peers_.size(), RAFT_INVALID_INDEX);
+    snapshotSendOffset_.resize(peers_.size(), 0);
+    replicatePending_.resize(peers_.size(), false);
+    ackedRound_.resize(peers_.size(), 0);
+    ackTime_.resize(peers_.size());
+    quiesceAcked_.resize(peers_.size(), false);
     
     // 从持久化恢复状态
     RestoreFromPersist();
@@ -42,6 +106,11 @@ void Raft::Start() {
     }
     
     running_ = true;
+    {
+        // 恢复的日志都已在磁盘上
+        std::lock_guard<std::mutex> lock(mutex_);
+        durableIndex_ = log_.empty() ? (logStartIndex_ - 1) : log_.back().index;
+    }
     
     // 启动RAFT核心线程
     raftThread_ = std::thread([this]() {
@@ -53,11 +122,19 @@ void Raft::Start() {
                 case RaftState::CANDIDATE:
                     StartElection();
                     break;
-                case RaftState::LEADER:
-                    SendHeartbeats();
+                case RaftState::LEADER: {
+                    // 复制线程在没有新日志时发送的AppendEntries即为心跳
                     ReplicateLogs();
+                    // 对齐到心跳间隔的整数倍，同一节点上各Raft组的心跳同时发出，由网络层合并成一个消息
+                    const auto interval = std::chrono::milliseconds(RAFT_DEFAULT_HEARTBEAT_INTERVAL);
+                    const auto sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+                    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval * (sinceEpoch / interval + 1))));
                     break;
+                }
             }
+            // 日志被截断或被快照覆盖的命令不会再被应用，由超时结束
+            ExpireCommandResults(false);
         }
     });
     applyThread_ = std::thread([this]() {
@@ -65,6 +142,17 @@ void Raft::Start() {
             ApplyLogs();
         }
     });
+    walThread_ = std::thread(&Raft::WalLoop, this);
+    for (int i = 0; i < static_cast<int>(peers_.size()); i++) {
+        if (i != me_) {
+            replicatorThreads_.emplace_back(&Raft::ReplicatorLoop, this, i);
+        }
+    }
+}
+
+// 绑定日志应用线程
+bool Raft::PinApplyThread(const std::vector<int>& cpus) {
+    return pinThread(applyThread_, cpus);
 }
 
 // 停止RAFT
@@ -74,6 +162,14 @@ void Raft::Stop() {
     }
     running_ = false;
     apply_cond.notify_one();
+    {
+        // 持锁后再通知，避免复制线程在检查running_与开始等待之间错过通知
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    replicateCond_.notify_all();
+    readCond_.notify_all();
+    walCond_.notify_all();
+    durableCond_.notify_all();
     
     // 等待线程结束
     if (raftThread_.joinable()) {
@@ -82,14 +178,33 @@ void Raft::Stop() {
     if (applyThread_.joinable()) {
         applyThread_.join();
     }
+    if (walThread_.joinable()) {
+        walThread_.join();
+    }
+    if (snapshotThread_.joinable()) {
+        snapshotThread_.join();
+    }
+    for (auto& thread : replicatorThreads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    replicatorThreads_.clear();
+    // 应用线程已退出，尚未完成的异步命令不会再有结果
+    ExpireCommandResults(true);
 }
 
 // 提交命令到RAFT日志
 bool Raft::StartCommand(const shared_ptr<RaftCommand>& raft_cmd, int& index, int& term) {
+    return StartCommand(raft_cmd, index, term, nullptr, 0);
+}
+
+bool Raft::StartCommand(const shared_ptr<RaftCommand>& raft_cmd, int& index, int& term,
+                        CommandCallback&& callback, int timeout_ms) {
     std::unique_lock<std::mutex> lock(mutex_);
     
-    // 如果不是领导者，返回false
-    if (state_ != RaftState::LEADER) {
+    // 如果不是领导者，返回false；停止后登记的回调不会再被完成，同样拒绝
+    if (state_ != RaftState::LEADER || !running_) {
         DKV_LOG_INFOF("[Node {}] 不是领导者，无法提交命令", me_);
         return false;
     }
@@ -102,12 +217,17 @@ bool Raft::StartCommand(const shared_ptr<RaftCommand>& raft_cmd, int& index, int
     entry.term = currentTerm_;
     entry.command = raft_cmd;
     entry.index = log_.size() + logStartIndex_;
+    // 只编码一次，写日志段和发送给各个跟随者都使用这份字节；日志中只保存编码，应用时再解码
+    CompactRaftLogEntry(entry);
     
     // 添加到日志
+    logBytes_ += RaftLogEntryBytes(entry);
     log_.push_back(entry);
+    PublishProgress();
     
-    // 持久化日志
-    PersistLog();
+    // 追加到持久化日志，由刷盘线程与复制并行落盘，并发提交的命令共享一次fdatasync
+    PersistLog({entry});
+    walCond_.notify_one();
     
     // 更新领导者自己的matchIndex
     if (me_ >= 0 && me_ < static_cast<int>(matchIndex_.size())) {
@@ -117,12 +237,22 @@ bool Raft::StartCommand(const shared_ptr<RaftCommand>& raft_cmd, int& index, int
     
     // 返回索引
     index = entry.index;
+    // 有新日志，退出静默
+    quiesced_ = false;
+
+    // 与日志条目在同一临界区内登记回调，应用线程不会先于登记应用这条日志
+    if (callback) {
+        auto result = std::make_shared<CommandResult>();
+        result->expected_term = term;
+        result->callback = std::move(callback);
+        result->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        command_results_[index] = std::move(result);
+    }
     
     DKV_LOG_INFOF("[Node {}] 成功开始命令，索引: {}, 任期: {}, 命令描述: {}", me_, index, term, raft_cmd->db_command.desc());
     
-    // 立即调用ReplicateLogs，确保日志条目能够及时被复制到跟随者
-    lock.unlock();
-    ReplicateLogs();
+    // 唤醒复制线程，不等待本轮复制；复制线程忙时本条日志与后续命令合并到下一个请求
+    NotifyReplicators();
     
     return true;
 }
@@ -151,6 +281,20 @@ int Raft::GetCommitIndex() const {
     return lastApplied_;
 }
 
+RaftProgress Raft::GetProgress() const {
+    RaftProgress progress;
+    progress.lastLogIndex = publishedLastLogIndex_.load(std::memory_order_relaxed);
+    progress.commitIndex = publishedCommitIndex_.load(std::memory_order_relaxed);
+    progress.lastApplied = publishedLastApplied_.load(std::memory_order_relaxed);
+    return progress;
+}
+
+void Raft::PublishProgress() {
+    publishedLastLogIndex_.store(log_.empty() ? logStartIndex_ - 1 : log_.back().index, std::memory_order_relaxed);
+    publishedCommitIndex_.store(commitIndex_, std::memory_order_relaxed);
+    publishedLastApplied_.store(lastApplied_, std::memory_order_relaxed);
+}
+
 // 获取当前节点认为的领导者ID
 int Raft::GetCurrentLeaderId() const {
     std::unique_lock<std::mutex> lock(mutex_);
@@ -187,6 +331,19 @@ Response Raft::waitForCommandResult(int index, int expected_term, int timeout_ms
 void Raft::setCommandResult(int index, int actual_term, const Response& result) {
     std::unique_lock<std::mutex> lock(mutex_);
     auto it = command_results_.find(index);
+    if (it != command_results_.end() && it->second->callback) {
+        auto command_result = std::move(it->second);
+        command_results_.erase(it);
+        lock.unlock();
+        if (command_result->expected_term != actual_term) {
+            DKV_LOG_ERRORF("[Node {}] 命令一致性检查失败：index={}, expected_term={}, actual_term={}",
+                          me_, index, command_result->expected_term, actual_term);
+            command_result->callback(Response(ResponseStatus::ERROR, "Command consistency check failed: term mismatch"));
+        } else {
+            command_result->callback(result);
+        }
+        return;
+    }
     if (it != command_results_.end()) {
         auto command_result = it->second;
         {
@@ -213,6 +370,27 @@ void Raft::setCommandResult(int index, int actual_term, const Response& result)
     }
 }
 
+void Raft::ExpireCommandResults(bool all) {
+    std::vector<std::shared_ptr<CommandResult>> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = command_results_.begin(); it != command_results_.end();) {
+            if (it->second->callback && (all || it->second->deadline <= now)) {
+                expired.push_back(std::move(it->second));
+                it = command_results_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    // 在锁外调用回调，回调中可能再提交新的命令
+    Response response(ResponseStatus::ERROR, all ? "Raft is shutting down" : "Command execution timed out");
+    for (auto& result : expired) {
+        result->callback(response);
+    }
+}
+
 // 处理AppendEntries请求
 AppendEntriesResponse Raft::OnAppendEntries(const AppendEntriesRequest& request) {
     std::unique_lock<std::mutex> lock(mutex_);
@@ -236,9 +414,12 @@ AppendEntriesResponse Raft::OnAppendEntries(const AppendEntriesRequest& request)
     
     // 3. 重置选举计时器
     ResetElectionTimer();
+    lastLeaderContact_ = std::chrono::steady_clock::now();
     
-    // 4. 更新当前领导者ID
+    // 4. 更新当前领导者ID和领导者的提交索引，记录领导者是否已静默
     currentLeaderId_ = request.leaderId;
+    leaderCommit_ = std::max(leaderCommit_, request.leaderCommit);
+    quiescedLeaderTerm_ = request.quiesce ? request.term : -1;
     
     // 5. 检查日志一致性
     if (IsLogConsistent(request.prevLogIndex, request.prevLogTerm)) {
@@ -253,14 +434,38 @@ AppendEntriesResponse Raft::OnAppendEntries(const AppendEntriesRequest& request)
         
         if (index < log_.size()) {
             DKV_LOG_DEBUGF("[Node {}] 删除冲突的日志条目，从索引 {} 开始", me_, index);
+            if (persister_) {
+                persister_->TruncateLogSuffix(log_[index].index);
+            }
+            durableIndex_ = std::min(durableIndex_, log_[index].index - 1);
+            logTruncations_++;
+            for (size_t i = index; i < log_.size(); i++) {
+                logBytes_ -= RaftLogEntryBytes(log_[i]);
+            }
             log_.erase(log_.begin() + index, log_.end());
+            PublishProgress();
         }
         
         // 6. 检查并添加新的日志条目
         if (ValidateAndAppendEntries(request.entries, request.prevLogIndex)) {
             DKV_LOG_DEBUGF("[Node {}] 添加了 {} 个新的日志条目，当前日志数量: {}", me_, request.entries.size(), log_.size());
-            // 7. 持久化日志
-            PersistLog();
+            // 7. 持久化日志，落盘后才能回复成功；等待期间释放锁，并发到达的请求由刷盘线程一起落盘
+            PersistLog(request.entries);
+            const int lastNewIndex = log_.empty() ? logStartIndex_ - 1 : log_.back().index;
+            const uint64_t truncations = logTruncations_;
+            if (running_) {
+                walCond_.notify_one();
+                durableCond_.wait(lock, [this, lastNewIndex]() { return durableIndex_ >= lastNewIndex || !running_; });
+                if (!running_ || currentTerm_ != request.term || logTruncations_ != truncations) {
+                    // 等待期间日志被其他请求改写，这些条目可能已不在日志中，由领导者重试
+                    response.term = currentTerm_;
+                    return response;
+                }
+            } else {
+                // 没有刷盘线程时直接刷盘
+                SyncPersistedLog();
+                durableIndex_ = std::max(durableIndex_, lastNewIndex);
+            }
             
             // 8. 更新提交索引
             if (request.leaderCommit > commitIndex_) {
@@ -269,10 +474,12 @@ AppendEntriesResponse Raft::OnAppendEntries(const AppendEntriesRequest& request)
                 DKV_LOG_INFOF("[Node {}] FOLLOWER更新提交索引从 {} 到 {}", me_, oldCommitIndex, commitIndex_);
                 apply_cond.notify_one();
             }
+            PublishProgress();
             
             // 9. 返回成功
             response.success = true;
-            response.matchIndex = log_.empty() ? logStartIndex_ - 1 : log_.back().index;
+            // 等待期间其他请求追加的条目可能尚未落盘，只确认到本请求等待落盘的位置
+            response.matchIndex = lastNewIndex;
             DKV_LOG_DEBUGF("[Node {}] AppendEntries 请求成功，matchIndex: {}", me_, response.matchIndex);
         } else {
             response.success = false;
@@ -304,6 +511,13 @@ RequestVoteResponse Raft::OnRequestVote(const RequestVoteRequest& request) {
         return response;
     }
     
+    // 开启租约读时，领导者和最短选举超时内收到过领导者消息的节点不投票，保证领导者的租约期间不会选出新领导者
+    if (leaseRead_ && (state_ == RaftState::LEADER ||
+        std::chrono::steady_clock::now() - lastLeaderContact_ < std::chrono::milliseconds(RAFT_MIN_ELECTION_TIMEOUT))) {
+        DKV_LOG_DEBUGF("[Node {}] 领导者仍然有效，拒绝节点 {} 的RequestVote请求", me_, request.candidateId);
+        return response;
+    }
+    
     // 2. 如果请求的任期大于当前任期，更新当前任期和状态
     if (request.term > currentTerm_) {
         DKV_LOG_INFOF("[Node {}] RequestVote请求任期 {} > 当前任期 {}，更新任期和状态为FOLLOWER", me_, request.term, currentTerm_);
@@ -400,7 +614,28 @@ InstallSnapshotResponse Raft::OnInstallSnapshot(const InstallSnapshotRequest& re
     // 更新当前领导者ID
     currentLeaderId_ = request.leaderId;
     
-    // 3. 处理快照
+    // 3. 拼接数据块，offset为0时开始接收新的快照
+    if (request.offset == 0) {
+        pendingSnapshot_.clear();
+        pendingSnapshotIndex_ = request.lastIncludedIndex;
+    }
+    if (request.lastIncludedIndex != pendingSnapshotIndex_ || request.offset != pendingSnapshot_.size()) {
+        // 偏移不连续（断线重连或领导者换了快照），告知已收到的字节数，领导者从这里续传
+        response.nextOffset = request.lastIncludedIndex == pendingSnapshotIndex_ ? pendingSnapshot_.size() : 0;
+        DKV_LOG_DEBUGF("[Node {}] InstallSnapshot数据块偏移 {} 不连续，已收到 {} 字节", me_, request.offset, response.nextOffset);
+        return response;
+    }
+    pendingSnapshot_.insert(pendingSnapshot_.end(), request.snapshot.begin(), request.snapshot.end());
+    response.nextOffset = pendingSnapshot_.size();
+    if (!request.done) {
+        response.success = true;
+        return response;
+    }
+    std::vector<char> snapshot;
+    snapshot.swap(pendingSnapshot_);
+    pendingSnapshotIndex_ = RAFT_INVALID_INDEX;
+    
+    // 4. 处理快照
     int lastIncludedIndex = request.lastIncludedIndex;
     int lastIncludedTerm = request.lastIncludedTerm;
     
@@ -414,20 +649,23 @@ InstallSnapshotResponse Raft::OnInstallSnapshot(const InstallSnapshotRequest& re
         DKV_LOG_DEBUGF("[Node {}] 快照包含的日志比当前日志新，应用快照", me_);
         // 清除所有旧日志
         log_.clear();
+        logBytes_ = 0;
         logStartIndex_ = lastIncludedIndex + 1;
         DKV_LOG_DEBUGF("[Node {}] 清除旧日志，更新logStartIndex={}", me_, logStartIndex_);
         
         // 应用快照到状态机
-        stateMachine_->Restore(request.snapshot);
+        stateMachine_->Restore(snapshot);
         DKV_LOG_DEBUGF("[Node {}] 成功应用快照到状态机", me_);
         
         // 更新lastApplied_和commitIndex_
         lastApplied_ = lastIncludedIndex;
+        readCond_.notify_all();
         commitIndex_ = std::max(commitIndex_, lastIncludedIndex);
         DKV_LOG_INFOF("[Node {}] 更新lastApplied={}，commitIndex={}", me_, lastApplied_, commitIndex_);
         
-        // 持久化快照
-        persister_->SaveSnapshot(request.snapshot);
+        // 持久化快照，之后删除被快照包含的日志
+        persister_->SaveSnapshot(snapshot);
+        persister_->CompactLog(lastIncludedIndex);
         DKV_LOG_DEBUGF("[Node {}] 持久化快照成功", me_);
         
         response.success = true;
@@ -436,7 +674,7 @@ InstallSnapshotResponse Raft::OnInstallSnapshot(const InstallSnapshotRequest& re
         response.success = true;
     }
     
-    // 4. 更新commitIndex_从leaderCommit
+    // 5. 更新commitIndex_从leaderCommit
     if (request.leaderCommit > commitIndex_) {
         int oldCommitIndex = commitIndex_;
         commitIndex_ = std::min(request.leaderCommit, log_.empty() ? logStartIndex_ - 1 : log_.back().index);
@@ -444,6 +682,7 @@ InstallSnapshotResponse Raft::OnInstallSnapshot(const InstallSnapshotRequest& re
         apply_cond.notify_one();
     }
     
+    PublishProgress();
     DKV_LOG_DEBUGF("[Node {}] InstallSnapshot请求处理完成，返回success={}", me_, response.success);
     return response;
 }
@@ -462,9 +701,11 @@ void Raft::Snapshot(int index, const std::vector<char>& snapshot) {
     
     // 1. 保留快照索引及之后的日志
     std::vector<RaftLogEntry> newLog;
-    for (const auto& entry : log_) {
+    for (auto& entry : log_) {
         if (entry.index > index) {
             newLog.push_back(std::move(entry));
+        } else {
+            logBytes_ -= RaftLogEntryBytes(entry);
         }
     }
     
@@ -480,29 +721,14 @@ void Raft::Snapshot(int index, const std::vector<char>& snapshot) {
     // 2. 持久化快照和状态
     persister_->SaveSnapshot(snapshot);
     PersistState();
-    PersistLog();
+    persister_->CompactLog(index);
     
     DKV_LOG_INFOF("[Node {}] 快照创建完成，当前日志数量: {}, 日志起始索引: {}", me_, log_.size(), logStartIndex_);
 }
 
-// 获取持久化字节数，需要加锁再调用
+// 获取持久化字节数，需要加锁再调用；日志大小随条目追加和删除累计，不再逐条计算
 size_t Raft::PersistBytes() const {
-    // 估计持久化数据的大小
-    size_t size = 0;
-    
-    // 状态大小：term + votedFor
-    size += sizeof(currentTerm_);
-    size += sizeof(votedFor_);
-    
-    // 日志大小：每个日志条目包括term + index + command type + args size + args content
-    for (const auto& entry : log_) {
-        size += sizeof(entry.term);
-        size += sizeof(entry.index);
-        if (entry.command) {
-            size += entry.command->db_command.PersistBytes();
-        }
-    }
-    return size;
+    return sizeof(currentTerm_) + sizeof(votedFor_) + logBytes_;
 }
 
 // 重置选举计时器
@@ -546,6 +772,13 @@ void Raft::StartElection() {
     int votes = 1; // 自己的投票
     DKV_LOG_DEBUGF("[Node {}] 开始选举，任期 {}，请求投票给 {} 个节点", me_, currentTerm_, peers_.size() - 1);
     
+    if (peers_.size() == 1) {
+        // 单节点的组只需要自己的投票
+        lock.lock();
+        BecomeLeaderLocked(votes);
+        return;
+    }
+    
     for (int i = 0; i < peers_.size(); i++) {
         if (i == me_) {
             continue;
@@ -575,17 +808,7 @@ void Raft::StartElection() {
             
             // 检查是否获得多数投票
             if (votes > peers_.size() / 2) {
-                // 成为领导者
-                DKV_LOG_INFOF("[Node {}] 获得多数投票 ({}/{})，成为RAFT领导者，任期: {}", me_, votes, peers_.size(), currentTerm_);
-                state_ = RaftState::LEADER;
-                
-                // 初始化领导者相关数组
-                for (size_t j = 0; j < nextIndex_.size(); j++) {
-                    nextIndex_[j] = log_.empty() ? logStartIndex_ : log_.back().index + 1;
-                    matchIndex_[j] = 0;
-                    DKV_LOG_INFOF("[Node {}] 初始化节点 {}: nextIndex={}, matchIndex={}", me_, j, nextIndex_[j], matchIndex_[j]);
-                }
-                
+                BecomeLeaderLocked(votes);
                 lock.unlock();
                 return;
             }
@@ -601,57 +824,19 @@ void Raft::StartElection() {
     // 没有获得多数投票，继续作为候选人
 }
 
-// 发送心跳
-void Raft::SendHeartbeats() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    if (!running_) {
-        return;
-    }
-
-    // 创建AppendEntries请求作为心跳
-    AppendEntriesRequest request;
-    request.term = currentTerm_;
-    request.leaderId = me_;
-    request.prevLogIndex = log_.empty() ? (logStartIndex_ - 1) : log_.back().index;
-    request.prevLogTerm = log_.empty() ? 0 : log_.back().term;
-    request.leaderCommit = commitIndex_;
-    
-    lock.unlock();
-    
-    DKV_LOG_DEBUGF("[Node {}] 发送心跳，任期 {}，commitIndex: {}", me_, request.term, request.leaderCommit);
-    
-    // 发送心跳给所有节点
-    for (int i = 0; i < peers_.size(); i++) {
-        if (i == me_) {
-            continue;
-        }
-        if (!running_ || state_ != RaftState::LEADER) {
-            break;
-        }
-        
-        // 发送请求
-        DKV_LOG_DEBUGF("[Node {}] 向节点 {} 发送心跳，任期 {}", me_, i, request.term);
-        AppendEntriesResponse response = network_->SendAppendEntries(i, request);
-        
-        lock.lock();
-        
-        // 检查响应
-        if (response.term > currentTerm_) {
-            // 更新当前任期和状态
-            DKV_LOG_INFOF("[Node {}] 收到更高任期 {}，转换为FOLLOWER", me_, response.term);
-            currentTerm_ = response.term;
-            state_ = RaftState::FOLLOWER;
-            votedFor_ = -1;
-            PersistState();
-            lock.unlock();
-            return;
-        }
-        
-        lock.unlock();
+// 成为领导者
+void Raft::BecomeLeaderLocked(int votes) {
+    DKV_LOG_INFOF("[Node {}] 获得多数投票 ({}/{})，成为RAFT领导者，任期: {}", me_, votes, peers_.size(), currentTerm_);
+    state_ = RaftState::LEADER;
+    quiesced_ = false;
+    
+    // 初始化领导者相关数组，之前任期的确认不能用于本任期的租约
+    for (size_t j = 0; j < nextIndex_.size(); j++) {
+        nextIndex_[j] = log_.empty() ? logStartIndex_ : log_.back().index + 1;
+        matchIndex_[j] = 0;
+        ackTime_[j] = std::chrono::steady_clock::time_point();
+        DKV_LOG_INFOF("[Node {}] 初始化节点 {}: nextIndex={}, matchIndex={}", me_, j, nextIndex_[j], matchIndex_[j]);
     }
-    
-    // 短暂休眠，避免CPU占用过高
-    std::this_thread::sleep_for(std::chrono::milliseconds(RAFT_DEFAULT_HEARTBEAT_INTERVAL));
 }
 
 // 处理选举超时
@@ -663,7 +848,13 @@ void Raft::HandleElectionTimeout() {
 
     // 检查是否超时
     int64_t now = std::chrono::system_clock::now().time_since_epoch().count() / 1000000;
-    if (now - lastElectionTime_ > electionTimeout_) {
+    if (now - lastElectionTime_ > electionTimeout_ && quiescedLeaderTerm_ == currentTerm_ &&
+        network_->IsPeerAlive(currentLeaderId_, electionTimeout_)) {
+        // 领导者所在组已静默，领导者节点仍然存活，视为收到心跳
+        ResetElectionTimer();
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    } else if (now - lastElectionTime_ > electionTimeout_) {
         // 超时，成为候选人
         DKV_LOG_INFOF("[Node {}] 选举超时，当前时间: {}, 上次选举时间: {}, 超时时间: {}, 成为候选人，当前任期: {}", 
                 me_, now, lastElectionTime_, electionTimeout_, currentTerm_);
@@ -688,54 +879,87 @@ void Raft::ApplyLogs() {
     }
     DKV_LOG_DEBUGF("[Node {}] 开始应用日志，lastApplied={}，commitIndex={}", me_, lastApplied_, commitIndex_);
     
-    // 检查是否有新的日志需要应用
+    // 检查是否有新的日志需要应用；连续的已提交条目成批交给状态机，状态机的锁每批只获取一次
     while (lastApplied_ < commitIndex_) {
-        // 寻找需要应用的日志条目
+        // 寻找需要应用的日志条目，日志索引连续时直接按偏移定位
         int nextIndex = lastApplied_ + 1;
         
         DKV_LOG_DEBUGF("[Node {}] 准备应用日志索引 {}，logStartIndex={}", me_, nextIndex, logStartIndex_);
         
-        // 检查日志是否在当前日志列表中
         bool found_entry = false;
         size_t entryPos = 0;
         
-        if (nextIndex >= logStartIndex_) {
-            for (size_t i = 0; i<log_.size(); i++) {
+        if (nextIndex >= logStartIndex_ && !log_.empty() && nextIndex >= log_.front().index) {
+            entryPos = static_cast<size_t>(nextIndex - log_.front().index);
+            found_entry = entryPos < log_.size() && log_[entryPos].index == nextIndex;
+            for (size_t i = 0; !found_entry && i < log_.size(); i++) {
                 if (log_[i].index == nextIndex) {
                     found_entry = true;
                     entryPos = i;
-                    break;
                 }
             }
         }
         
         if (found_entry) {
-            DKV_LOG_INFOF("[Node {}] 找到日志条目，索引 {}，任期 {}，准备应用到状态机", me_, log_[entryPos].index, log_[entryPos].term);
-            RaftLogEntry entry = log_[entryPos];
+            std::vector<RaftLogEntry> batch;
+            for (size_t i = entryPos; i < log_.size() && batch.size() < RAFT_MAX_APPLY_BATCH; i++) {
+                if (log_[i].index != nextIndex + static_cast<int>(batch.size()) || log_[i].index > commitIndex_) {
+                    break;
+                }
+                batch.push_back(log_[i]);
+            }
+            DKV_LOG_DEBUGF("[Node {}] 应用日志条目 {} 到 {}", me_, batch.front().index, batch.back().index);
             lock.unlock();
-    
-            // 应用命令到状态机
-            Response result = stateMachine_->DoOp(*entry.command);
-
+            
+            // 在锁外解码命令后应用到状态机
+            static const RaftCommand corrupted(NO_TX, Command());
+            std::vector<std::shared_ptr<RaftCommand>> decoded;
+            std::vector<const RaftCommand*> commands;
+            decoded.reserve(batch.size());
+            commands.reserve(batch.size());
+            for (const auto& entry : batch) {
+                decoded.push_back(RaftLogCommandOf(entry));
+                if (!decoded.back()) {
+                    DKV_LOG_ERRORF("[Node {}] 日志条目 {} 解码失败", me_, entry.index);
+                }
+                commands.push_back(decoded.back() ? decoded.back().get() : &corrupted);
+            }
+            std::vector<Response> results;
+            stateMachine_->DoOps(commands, results);
+            
             // 设置命令结果，通知等待的客户端
-            setCommandResult(entry.index, entry.term, result);
+            for (size_t i = 0; i < batch.size(); i++) {
+                setCommandResult(batch[i].index, batch[i].term, results[i]);
+            }
             
             lock.lock();
             
             // 更新应用索引
-            lastApplied_ = nextIndex;
-            DKV_LOG_INFOF("[Node {}] 成功提交日志。索引 {}，任期 {}，更新lastApplied={}", me_, nextIndex, entry.term, lastApplied_);
+            lastApplied_ = batch.back().index;
+            readCond_.notify_all();
+            PublishProgress();
+            DKV_LOG_DEBUGF("[Node {}] 成功应用 {} 条日志，更新lastApplied={}", me_, batch.size(), lastApplied_);
 
             // 检查是否需要创建快照
-            if (max_raft_state_ > 0 && PersistBytes() > max_raft_state_) {
+            if (max_raft_state_ > 0 && !snapshotting_ && PersistBytes() > max_raft_state_) {
                 DKV_LOG_INFOF("[Node {}] 持久化数据大小超过阈值，创建快照，lastApplied={}", me_, lastApplied_);
-                // 创建快照
-                std::vector<char> snapshot = stateMachine_->Snapshot();
-                
-                // 保存快照
-                lock.unlock();
-                Snapshot(lastApplied_, snapshot);
-                lock.lock();
+                // 固定lastApplied_时的状态机内容，快照数据在后台生成，完成后再压缩日志，应用不必等待
+                std::function<std::vector<char>()> generate = stateMachine_->BeginSnapshot();
+                if (generate) {
+                    snapshotting_ = true;
+                    if (snapshotThread_.joinable()) {
+                        snapshotThread_.join();
+                    }
+                    const int index = lastApplied_;
+                    snapshotThread_ = std::thread([this, index, generate]() {
+                        std::vector<char> snapshot = generate();
+                        if (!snapshot.empty()) {
+                            Snapshot(index, snapshot);
+                        }
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        snapshotting_ = false;
+                    });
+                }
             }
         } else {
             // 日志不在当前列表中，可能需要从快照恢复
@@ -759,8 +983,8 @@ void Raft::UpdateCommitIndex() {
     
     // 从当前提交索引+1开始检查
     for (int i = commitIndex_ + 1; i <= (log_.empty() ? (logStartIndex_ - 1) : log_.back().index); i++) {
-        // 统计当前任期的日志条目数量
-        int count = 1; // 自己的投票
+        // 统计当前任期的日志条目数量，自己的日志落盘后才计入
+        int count = durableIndex_ >= i ? 1 : 0;
         
         for (size_t j = 0; j < peers_.size(); j++) {
             if (j == me_) {
@@ -787,13 +1011,41 @@ void Raft::UpdateCommitIndex() {
     if (newCommitIndex > commitIndex_) {
         int oldCommitIndex = commitIndex_;
         commitIndex_ = newCommitIndex;
+        PublishProgress();
         DKV_LOG_INFOF("[Node {}] LEADER更新提交索引从 {} 到 {}", me_, oldCommitIndex, commitIndex_);
         apply_cond.notify_one();
+        readCond_.notify_all();
     } else {
         DKV_LOG_DEBUGF("[Node {}] 无需更新提交索引，保持为 {}", me_, commitIndex_);
     }
 }
 
+void Raft::WalLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        walCond_.wait(lock, [this]() {
+            return !running_ || durableIndex_ < (log_.empty() ? (logStartIndex_ - 1) : log_.back().index);
+        });
+        if (!running_) {
+            break;
+        }
+        const int target = log_.empty() ? (logStartIndex_ - 1) : log_.back().index;
+        const uint64_t truncations = logTruncations_;
+        lock.unlock();
+        SyncPersistedLog();
+        lock.lock();
+        if (truncations == logTruncations_) {
+            durableIndex_ = std::max(durableIndex_, target);
+        }
+        durableCond_.notify_all();
+        if (state_ == RaftState::LEADER) {
+            lock.unlock();
+            UpdateCommitIndex();
+            lock.lock();
+        }
+    }
+}
+
 // 检查日志一致性
 bool Raft::IsLogConsistent(int prevLogIndex, int prevLogTerm) {
     // 如果prevLogIndex小于日志起始索引，认为是一致的
@@ -846,150 +1098,382 @@ bool Raft::ValidateAndAppendEntries(const std::vector<RaftLogEntry>& entries, in
     if (entriesValid) {
         for (const auto& entry : entries) {
             log_.push_back(entry);
+            CompactRaftLogEntry(log_.back());
+            logBytes_ += RaftLogEntryBytes(log_.back());
         }
     }
     
     return entriesValid;
 }
 
-// 复制日志条目到follower
-void Raft::ReplicateLogs() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    
-    DKV_LOG_DEBUGF("[Node {}] 开始复制日志，任期 {}，当前日志数量: {}", me_, currentTerm_, log_.size());
+// 按块向follower发送快照
+bool Raft::SendSnapshotChunks(int server, std::unique_lock<std::mutex>& lock) {
+    const int lastIncludedIndex = logStartIndex_ - 1;
+    if (snapshotSendIndex_[server] != lastIncludedIndex) {
+        // 快照已被新快照替换，从头发送
+        snapshotSendIndex_[server] = lastIncludedIndex;
+        snapshotSendOffset_[server] = 0;
+    }
     
-    for (int i = 0; i < peers_.size(); i++) {
-        if (i == me_) {
+    size_t sentBytes = 0;
+    while (sentBytes < RAFT_SNAPSHOT_MAX_BYTES_PER_ROUND) {
+        // 限速：按距上次补充的时间累积可发送字节数，最多累积一秒；不足一块时等下一轮
+        const size_t rateLimit = snapshotRateLimit_;
+        if (rateLimit > 0) {
+            const auto now = std::chrono::steady_clock::now();
+            const double elapsed = std::chrono::duration<double>(now - snapshotTokensTime_).count();
+            snapshotTokens_ = std::min(static_cast<double>(rateLimit), snapshotTokens_ + elapsed * rateLimit);
+            snapshotTokensTime_ = now;
+            if (snapshotTokens_ < static_cast<double>(std::min(rateLimit, RAFT_SNAPSHOT_CHUNK_SIZE))) {
+                break;
+            }
+        }
+        
+        // 持有锁读取数据块，快照文件只在持有锁时被替换，与lastIncludedIndex一致
+        InstallSnapshotRequest request;
+        request.term = currentTerm_;
+        request.leaderId = me_;
+        request.lastIncludedIndex = lastIncludedIndex;
+        request.lastIncludedTerm = 0;
+        request.leaderCommit = commitIndex_;
+        request.offset = snapshotSendOffset_[server];
+        const size_t chunkSize = rateLimit > 0 ? std::min(rateLimit, RAFT_SNAPSHOT_CHUNK_SIZE) : RAFT_SNAPSHOT_CHUNK_SIZE;
+        uint64_t total = 0;
+        request.snapshot = persister_->ReadSnapshotChunk(request.offset, chunkSize, total);
+        if (request.offset > total) {
+            request.offset = 0;
+            snapshotSendOffset_[server] = 0;
             continue;
         }
-        if (!running_ || state_ != RaftState::LEADER) {
-            break;
+        request.done = request.offset + request.snapshot.size() >= total;
+        if (rateLimit > 0) {
+            snapshotTokens_ -= static_cast<double>(request.snapshot.size());
         }
         
-        DKV_LOG_DEBUGF("[Node {}] 处理节点 {}: nextIndex={}, matchIndex={}, logStartIndex={}", me_, i, nextIndex_[i], matchIndex_[i], logStartIndex_);
+        DKV_LOG_DEBUGF("[Node {}] 向节点 {} 发送快照数据块，lastIncludedIndex={}，偏移 {}，{} 字节，done={}",
+                       me_, server, lastIncludedIndex, request.offset, request.snapshot.size(), request.done);
+        lock.unlock();
+        InstallSnapshotResponse response = network_->SendInstallSnapshot(server, request);
+        lock.lock();
         
-        // 检查follower的nextIndex是否小于日志起始索引
-        if (nextIndex_[i] < logStartIndex_) {
-            // 需要发送InstallSnapshot请求
-            DKV_LOG_DEBUGF("[Node {}] 节点 {} nextIndex={} <= logStartIndex={}，发送InstallSnapshot请求", me_, i, nextIndex_[i], logStartIndex_);
-            
-            // 创建InstallSnapshot请求
-            InstallSnapshotRequest snapshotRequest;
-            snapshotRequest.term = currentTerm_;
-            snapshotRequest.leaderId = me_;
-            snapshotRequest.lastIncludedIndex = logStartIndex_ - 1;
-            snapshotRequest.lastIncludedTerm = 0;
-            snapshotRequest.snapshot = persister_->ReadSnapshot();
-            snapshotRequest.leaderCommit = commitIndex_;
-
-            // 发送InstallSnapshot请求
-            DKV_LOG_DEBUGF("[Node {}] 向节点 {} 发送InstallSnapshot请求，lastIncludedIndex={}", me_, i, snapshotRequest.lastIncludedIndex);
-            lock.unlock();
-            InstallSnapshotResponse snapshotResponse = network_->SendInstallSnapshot(i, snapshotRequest);
-            lock.lock();
-            
-            // 检查响应
-            if (snapshotResponse.term > currentTerm_) {
-                // 更新当前任期和状态
-                DKV_LOG_INFOF("[Node {}] 节点 {} 返回更高任期 {}，转换为FOLLOWER", me_, i, snapshotResponse.term);
-                currentTerm_ = snapshotResponse.term;
-                state_ = RaftState::FOLLOWER;
-                votedFor_ = -1;
-                PersistState();
-                break;
-            }
-            
-            if (state_ != RaftState::LEADER) {
-                DKV_LOG_INFOF("[Node {}] 不再是领导者，停止复制日志", me_);
-                break;
-            }
-            
-            if (snapshotResponse.success) {
-                // 更新nextIndex和matchIndex
-                DKV_LOG_DEBUGF("[Node {}] 节点 {} InstallSnapshot成功，更新nextIndex={}，matchIndex={}", me_, i, logStartIndex_, logStartIndex_ - 1);
-                nextIndex_[i] = logStartIndex_;
-                matchIndex_[i] = logStartIndex_ - 1;
-            } else {
-                DKV_LOG_DEBUGF("[Node {}] 节点 {} InstallSnapshot失败", me_, i);
-            }
-        } else {
-            // 准备发送的日志条目
-            std::vector<RaftLogEntry> entries;
-            int prevLogIndex = 0;
-            int prevLogTerm = 0;
-            
-            // 找到prevLogIndex对应的日志条目
-            for (const auto& entry : log_) {
-                if (entry.index == (nextIndex_[i] - 1)) {
-                    prevLogIndex = entry.index;
-                    prevLogTerm = entry.term;
-                    break;
-                }
-            }
-            
-            // 收集需要发送的日志条目
-            for (const auto& entry : log_) {
-                if (entry.index >= nextIndex_[i]) {
-                    entries.push_back(entry);
-                }
+        // 检查响应
+        if (response.term > currentTerm_) {
+            // 更新当前任期和状态
+            DKV_LOG_INFOF("[Node {}] 节点 {} 返回更高任期 {}，转换为FOLLOWER", me_, server, response.term);
+            currentTerm_ = response.term;
+            state_ = RaftState::FOLLOWER;
+            votedFor_ = -1;
+            PersistState();
+            return false;
+        }
+        if (state_ != RaftState::LEADER) {
+            DKV_LOG_INFOF("[Node {}] 不再是领导者，停止复制日志", me_);
+            return false;
+        }
+        if (snapshotSendIndex_[server] != lastIncludedIndex) {
+            // 发送期间本地创建了新快照，下一轮从头发送
+            break;
+        }
+        
+        if (!response.success) {
+            // 连接失败时保留偏移下一轮续传；跟随者回复偏移不连续时从它已收到的位置续传
+            if (response.term > 0) {
+                snapshotSendOffset_[server] = response.nextOffset;
             }
-            
-            DKV_LOG_DEBUGF("[Node {}] 向节点 {} 发送 {} 条日志，prevLogIndex={}, prevLogTerm={}", me_, i, entries.size(), prevLogIndex, prevLogTerm);
-            
-            // 创建AppendEntries请求
-            AppendEntriesRequest request;
-            request.term = currentTerm_;
-            request.leaderId = me_;
-            request.prevLogIndex = prevLogIndex;
-            request.prevLogTerm = prevLogTerm;
-            request.entries = entries;
-            request.leaderCommit = commitIndex_;
-            
-            auto currentNextIndex = nextIndex_[i];
-            auto currentTerm = currentTerm_;
+            DKV_LOG_DEBUGF("[Node {}] 节点 {} InstallSnapshot失败，下次从偏移 {} 继续", me_, server, snapshotSendOffset_[server]);
+            break;
+        }
+        sentBytes += request.snapshot.size();
+        snapshotSendOffset_[server] = request.offset + request.snapshot.size();
+        if (request.done) {
+            // 更新nextIndex和matchIndex
+            DKV_LOG_DEBUGF("[Node {}] 节点 {} InstallSnapshot成功，更新nextIndex={}，matchIndex={}", me_, server,
+                           lastIncludedIndex + 1, lastIncludedIndex);
+            nextIndex_[server] = std::max(nextIndex_[server], lastIncludedIndex + 1);
+            matchIndex_[server] = std::max(matchIndex_[server], lastIncludedIndex);
+            snapshotSendIndex_[server] = RAFT_INVALID_INDEX;
+            snapshotSendOffset_[server] = 0;
+            break;
+        }
+    }
+    return true;
+}
 
-            // 发送请求
-            lock.unlock();
-            AppendEntriesResponse response = network_->SendAppendEntries(i, request);
-            lock.lock();
-            
-            // 检查响应
-            if (response.term > currentTerm) {
-                // 更新当前任期和状态
-                DKV_LOG_INFOF("[Node {}] 节点 {} 返回更高任期 {}，转换为FOLLOWER", me_, i, response.term);
-                currentTerm_ = response.term;
-                state_ = RaftState::FOLLOWER;
-                votedFor_ = -1;
-                PersistState();
-                break;
-            }
-            
-            if (state_ != RaftState::LEADER) {
-                DKV_LOG_INFOF("[Node {}] 不再是领导者，停止复制日志", me_);
-                break;
-            }
-            
-            if (response.success) {
-                // 更新nextIndex和matchIndex
-                nextIndex_[i] = currentNextIndex + entries.size();
-                matchIndex_[i] = nextIndex_[i] - 1;
-                DKV_LOG_DEBUGF("[Node {}] 节点 {} AppendEntries成功，更新nextIndex={}，matchIndex={}", me_, i, nextIndex_[i], matchIndex_[i]);
-                
-                // 更新提交索引
-                lock.unlock();
-                UpdateCommitIndex();
-                lock.lock();
-            } else {
-                // 减少nextIndex并重试
-                if (nextIndex_[i] > logStartIndex_) {
-                    DKV_LOG_DEBUGF("[Node {}] 节点 {} AppendEntries失败，减少nextIndex从 {} 到 {}", me_, i, nextIndex_[i], nextIndex_[i] - 1);
-                    nextIndex_[i]--;
-                }
-            }
+// 通知复制线程发送一轮AppendEntries
+// 开启静默时，日志全部提交且各跟随者都已复制完成的组只向尚未确认静默的跟随者发送心跳
+void Raft::ReplicateLogs() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int lastLogIndex = log_.empty() ? (logStartIndex_ - 1) : log_.back().index;
+    bool idle = quiesceEnabled_ && commitIndex_ == lastLogIndex;
+    for (int i = 0; idle && i < static_cast<int>(peers_.size()); i++) {
+        if (i != me_ && matchIndex_[i] != lastLogIndex) {
+            idle = false;
+        }
+    }
+    if (!idle) {
+        quiesced_ = false;
+        NotifyReplicators();
+        return;
+    }
+    if (!quiesced_) {
+        DKV_LOG_DEBUGF("[Node {}] 日志已全部提交，进入静默，任期: {}", me_, currentTerm_);
+        quiesced_ = true;
+        std::fill(quiesceAcked_.begin(), quiesceAcked_.end(), false);
+    }
+    for (int i = 0; i < static_cast<int>(peers_.size()); i++) {
+        if (i != me_ && !quiesceAcked_[i]) {
+            replicatePending_[i] = true;
+        }
+    }
+    replicateCond_.notify_all();
+}
+
+void Raft::NotifyReplicators() {
+    std::fill(replicatePending_.begin(), replicatePending_.end(), true);
+    replicateCond_.notify_all();
+}
+
+// 跟随者server的复制线程
+void Raft::ReplicatorLoop(int server) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        replicateCond_.wait(lock, [this, server]() { return !running_ || replicatePending_[server]; });
+        if (!running_) {
+            break;
+        }
+        replicatePending_[server] = false;
+        if (state_ != RaftState::LEADER) {
+            continue;
+        }
+        if (ReplicateTo(server, lock)) {
+            // 本批受大小限制或发送期间有新日志，继续发送下一批
+            replicatePending_[server] = true;
+        }
+    }
+}
+
+// 向跟随者server发送一批日志或快照数据块
+bool Raft::ReplicateTo(int server, std::unique_lock<std::mutex>& lock) {
+    DKV_LOG_DEBUGF("[Node {}] 处理节点 {}: nextIndex={}, matchIndex={}, logStartIndex={}", me_, server, nextIndex_[server], matchIndex_[server], logStartIndex_);
+    
+    // 检查follower的nextIndex是否小于日志起始索引
+    if (nextIndex_[server] < logStartIndex_) {
+        // 需要发送InstallSnapshot请求
+        DKV_LOG_DEBUGF("[Node {}] 节点 {} nextIndex={} <= logStartIndex={}，发送InstallSnapshot请求", me_, server, nextIndex_[server], logStartIndex_);
+        return SendSnapshotChunks(server, lock) && state_ == RaftState::LEADER && nextIndex_[server] >= logStartIndex_;
+    }
+    
+    // 日志是连续的，按索引直接定位prevLogIndex和本批的起点
+    const int lastLogIndex = log_.empty() ? (logStartIndex_ - 1) : log_.back().index;
+    const int nextIndex = std::min(nextIndex_[server], lastLogIndex + 1);
+    AppendEntriesRequest request;
+    request.term = currentTerm_;
+    request.leaderId = me_;
+    request.prevLogIndex = nextIndex - 1;
+    request.prevLogTerm = request.prevLogIndex >= logStartIndex_ ? log_[request.prevLogIndex - logStartIndex_].term : 0;
+    request.leaderCommit = commitIndex_;
+    request.quiesce = quiesced_;
+    
+    // 收集本批日志条目，受条目数和字节数限制，至少一条
+    const size_t maxEntries = maxBatchEntries_;
+    const size_t maxBytes = maxBatchBytes_;
+    size_t batchBytes = 0;
+    for (size_t pos = nextIndex - logStartIndex_; pos < log_.size(); pos++) {
+        const size_t entryBytes = RaftLogEntryBytes(log_[pos]);
+        if (!request.entries.empty() &&
+            ((maxEntries > 0 && request.entries.size() >= maxEntries) || (maxBytes > 0 && batchBytes + entryBytes > maxBytes))) {
+            break;
         }
+        request.entries.push_back(log_[pos]);
+        batchBytes += entryBytes;
+    }
+    
+    DKV_LOG_DEBUGF("[Node {}] 向节点 {} 发送 {} 条日志（{} 字节），prevLogIndex={}, prevLogTerm={}", me_, server, request.entries.size(), batchBytes, request.prevLogIndex, request.prevLogTerm);
+    
+    const int currentTerm = currentTerm_;
+    const int sentEntries = static_cast<int>(request.entries.size());
+    const uint64_t readRound = readRound_;
+    const auto sendTime = std::chrono::steady_clock::now();
+    
+    // 发送请求，发送期间其他跟随者的复制线程并行发送
+    lock.unlock();
+    AppendEntriesResponse response = network_->SendAppendEntries(server, request);
+    lock.lock();
+    
+    // 检查响应
+    if (response.term > currentTerm_) {
+        // 更新当前任期和状态
+        DKV_LOG_INFOF("[Node {}] 节点 {} 返回更高任期 {}，转换为FOLLOWER", me_, server, response.term);
+        currentTerm_ = response.term;
+        state_ = RaftState::FOLLOWER;
+        votedFor_ = -1;
+        PersistState();
+        return false;
+    }
+    
+    if (state_ != RaftState::LEADER || currentTerm_ != currentTerm) {
+        DKV_LOG_INFOF("[Node {}] 不再是领导者，停止复制日志", me_);
+        return false;
+    }
+    
+    // 跟随者接受了本任期（日志不一致的拒绝也说明它承认本任期），记录ReadIndex确认
+    if (response.success || response.term == currentTerm) {
+        ackedRound_[server] = std::max(ackedRound_[server], readRound);
+        ackTime_[server] = std::max(ackTime_[server], sendTime);
+        readCond_.notify_all();
+    }
+    
+    if (!response.success) {
+        // 减少nextIndex，等下一轮重试
+        if (nextIndex_[server] > logStartIndex_) {
+            DKV_LOG_DEBUGF("[Node {}] 节点 {} AppendEntries失败，减少nextIndex从 {} 到 {}", me_, server, nextIndex_[server], nextIndex_[server] - 1);
+            nextIndex_[server]--;
+        }
+        return false;
+    }
+    
+    // 跟随者已收到静默标记和最新的提交索引
+    if (request.quiesce && quiesced_ && request.leaderCommit == commitIndex_) {
+        quiesceAcked_[server] = true;
     }
     
-    DKV_LOG_DEBUGF("[Node {}] 日志复制完成，当前commitIndex={}", me_, commitIndex_);
+    // 更新nextIndex和matchIndex
+    nextIndex_[server] = nextIndex + sentEntries;
+    matchIndex_[server] = nextIndex_[server] - 1;
+    DKV_LOG_DEBUGF("[Node {}] 节点 {} AppendEntries成功，更新nextIndex={}，matchIndex={}", me_, server, nextIndex_[server], matchIndex_[server]);
+    
+    // 多数节点确认后立即推进提交索引，不等待其他跟随者
+    lock.unlock();
+    UpdateCommitIndex();
+    lock.lock();
+    
+    return state_ == RaftState::LEADER && nextIndex_[server] <= (log_.empty() ? (logStartIndex_ - 1) : log_.back().index);
+}
+
+bool Raft::StaleReadAllowed(int max_lag_entries, int max_lag_ms) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_ || state_ != RaftState::FOLLOWER || currentLeaderId_ < 0) {
+        return false;
+    }
+    if (max_lag_ms >= 0 &&
+        std::chrono::steady_clock::now() - lastLeaderContact_ > std::chrono::milliseconds(max_lag_ms)) {
+        return false;
+    }
+    return max_lag_entries < 0 || leaderCommit_ - lastApplied_ <= max_lag_entries;
+}
+
+// 线性一致读
+bool Raft::ReadIndex(int timeout_ms) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+        return false;
+    }
+    
+    int readIndex = 0;
+    if (state_ == RaftState::LEADER) {
+        if (!ConfirmReadIndex(lock, readIndex, deadline)) {
+            return false;
+        }
+    } else {
+        // 跟随者向领导者请求读取索引
+        const int leaderId = currentLeaderId_;
+        if (leaderId < 0 || leaderId == me_) {
+            return false;
+        }
+        ReadIndexRequest request;
+        request.term = currentTerm_;
+        request.followerId = me_;
+        lock.unlock();
+        ReadIndexResponse response = network_->SendReadIndex(leaderId, request);
+        lock.lock();
+        if (!response.success) {
+            DKV_LOG_DEBUGF("[Node {}] 领导者 {} 未能确认读取索引", me_, leaderId);
+            return false;
+        }
+        readIndex = response.readIndex;
+    }
+    
+    // 等待状态机应用到读取索引
+    readCond_.wait_until(lock, deadline, [this, readIndex]() { return !running_ || lastApplied_ >= readIndex; });
+    DKV_LOG_DEBUGF("[Node {}] ReadIndex读取索引 {}，lastApplied={}", me_, readIndex, lastApplied_);
+    return running_ && lastApplied_ >= readIndex;
+}
+
+// 处理跟随者的ReadIndex请求
+ReadIndexResponse Raft::OnReadIndex(const ReadIndexRequest& request) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ReadIndexResponse response;
+    int readIndex = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RAFT_DEFAULT_ELECTION_TIMEOUT);
+    if (state_ == RaftState::LEADER && request.term <= currentTerm_ && ConfirmReadIndex(lock, readIndex, deadline)) {
+        response.success = true;
+        response.readIndex = readIndex;
+    }
+    response.term = currentTerm_;
+    DKV_LOG_DEBUGF("[Node {}] 处理节点 {} 的ReadIndex请求，success={}，readIndex={}", me_, request.followerId, response.success, response.readIndex);
+    return response;
+}
+
+// 领导者确认读取索引
+bool Raft::ConfirmReadIndex(std::unique_lock<std::mutex>& lock, int& readIndex, std::chrono::steady_clock::time_point deadline) {
+    const int term = currentTerm_;
+    auto stillLeader = [this, term]() { return running_ && state_ == RaftState::LEADER && currentTerm_ == term; };
+    
+    // 新领导者要等本任期的日志（或已有的全部日志）提交后，提交索引才不小于任何已提交的日志
+    auto commitIndexCurrent = [this]() {
+        const int lastLogIndex = log_.empty() ? (logStartIndex_ - 1) : log_.back().index;
+        if (commitIndex_ >= lastLogIndex) {
+            return true;
+        }
+        return commitIndex_ >= logStartIndex_ && log_[commitIndex_ - logStartIndex_].term == currentTerm_;
+    };
+    readCond_.wait_until(lock, deadline, [&]() { return !stillLeader() || commitIndexCurrent(); });
+    if (!stillLeader() || !commitIndexCurrent()) {
+        return false;
+    }
+    readIndex = commitIndex_;
+    
+    const int quorum = static_cast<int>(peers_.size() / 2) + 1;
+    if (quorum <= 1) {
+        return true;
+    }
+    // 租约内多数节点不会投票给其他候选人，不需要再确认
+    if (leaseRead_ && std::chrono::steady_clock::now() < QuorumAckTime() + std::chrono::milliseconds(RAFT_LEASE_DURATION)) {
+        return true;
+    }
+    
+    // 发出一轮心跳，等待多数节点确认在这之后发送的请求
+    const uint64_t round = ++readRound_;
+    NotifyReplicators();
+    readCond_.wait_until(lock, deadline, [&]() { return !stillLeader() || ReadAckCount(round) >= quorum; });
+    return stillLeader() && ReadAckCount(round) >= quorum;
+}
+
+int Raft::ReadAckCount(uint64_t round) const {
+    int count = 1; // 自己
+    for (size_t i = 0; i < ackedRound_.size(); i++) {
+        if (static_cast<int>(i) != me_ && ackedRound_[i] >= round) {
+            count++;
+        }
+    }
+    return count;
+}
+
+std::chrono::steady_clock::time_point Raft::QuorumAckTime() const {
+    std::vector<std::chrono::steady_clock::time_point> times;
+    for (size_t i = 0; i < ackTime_.size(); i++) {
+        if (static_cast<int>(i) != me_) {
+            times.push_back(ackTime_[i]);
+        }
+    }
+    // 除自己外还需要quorum-1个节点，取其中最早的确认时间
+    const size_t need = peers_.size() / 2;
+    if (need == 0 || times.size() < need) {
+        return std::chrono::steady_clock::time_point();
+    }
+    std::nth_element(times.begin(), times.begin() + (need - 1), times.end(), std::greater<>());
+    return times[need - 1];
 }
 
 // 持久化状态
@@ -999,10 +1483,17 @@ void Raft::PersistState() {
     }
 }
 
-// 持久化日志
-void Raft::PersistLog() {
+// 追加持久化日志
+void Raft::PersistLog(const std::vector<RaftLogEntry>& entries) {
+    if (persister_) {
+        persister_->AppendLog(entries);
+    }
+}
+
+// 持久化日志刷盘
+void Raft::SyncPersistedLog() {
     if (persister_) {
-        persister_->SaveLog(log_);
+        persister_->SyncLog();
     }
 }
 
@@ -1017,10 +1508,28 @@ void Raft::RestoreFromPersist() {
     currentTerm_ = persister_->ReadTerm();
     votedFor_ = persister_->ReadVotedFor();
     
-    // 读取日志
-    log_ = persister_->ReadLog();
+    // 流式回放日志
+    log_.clear();
+    logBytes_ = 0;
+    int snapshotIndex = persister_->ReplayLog([this](RaftLogEntry&& entry) {
+        CompactRaftLogEntry(entry);
+        logBytes_ += RaftLogEntryBytes(entry);
+        log_.push_back(std::move(entry));
+    });
+    logStartIndex_ = log_.empty() ? snapshotIndex + 1 : log_.front().index;
+    
+    // 日志已被压缩时，先把快照恢复到状态机，之后从快照之后的日志继续应用
+    if (snapshotIndex > 0) {
+        std::vector<char> snapshot = persister_->ReadSnapshot();
+        if (!snapshot.empty()) {
+            stateMachine_->Restore(snapshot);
+        }
+        lastApplied_ = snapshotIndex;
+        commitIndex_ = snapshotIndex;
+    }
+    PublishProgress();
     
-    DKV_LOG_INFOF("[Node {}] 从持久化恢复RAFT状态，任期: {}, 投票给: {}, 日志数量: {}", me_, currentTerm_, votedFor_, log_.size());
+    DKV_LOG_INFOF("[Node {}] 从持久化恢复RAFT状态，任期: {}, 投票给: {}, 日志数量: {}, 日志起始索引: {}", me_, currentTerm_, votedFor_, log_.size(), logStartIndex_);
 }
 
 
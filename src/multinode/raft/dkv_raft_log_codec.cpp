@@ -0,0 +1,130 @@
+#include "multinode/raft/dkv_raft_log_codec.hpp"
+#include <cstring>
+
+namespace dkv {
+
+namespace {
+
+template <typename T>
+void appendValue(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// 解码载荷；decodeCommand为false时只检查格式并解出索引和任期
+bool decodePayload(std::string_view payload, RaftLogEntry& entry, bool decodeCommand) {
+    ByteReader reader(payload);
+    entry.index = reader.read<int32_t>();
+    entry.term = reader.read<int32_t>();
+    const TransactionID txId = reader.read<uint64_t>();
+    Command command;
+    command.type = static_cast<CommandType>(reader.read<int32_t>());
+    const uint32_t argc = reader.read<uint32_t>();
+    if (!reader || argc > reader.remaining() / sizeof(uint32_t)) {
+        return false;
+    }
+    if (decodeCommand) {
+        command.args.resize(argc);
+    }
+    for (uint32_t i = 0; i < argc; i++) {
+        const uint32_t size = reader.read<uint32_t>();
+        std::string_view arg = reader.readBytes(size);
+        if (decodeCommand) {
+            command.args[i] = std::string(arg);
+        }
+    }
+    if (!reader || reader.remaining() != 0) {
+        return false;
+    }
+    if (decodeCommand) {
+        entry.command = std::make_shared<RaftCommand>(txId, std::move(command));
+    } else {
+        entry.command.reset();
+    }
+    return true;
+}
+
+} // namespace
+
+void EncodeRaftLogRecord(std::string& out, const RaftLogEntry& entry) {
+    const size_t start = out.size();
+    out.append(RAFT_LOG_RECORD_HEADER_SIZE, '\0');
+    appendValue<int32_t>(out, entry.index);
+    appendValue<int32_t>(out, entry.term);
+    appendValue<uint64_t>(out, entry.command->tx_id);
+    const Command& command = entry.command->db_command;
+    appendValue<int32_t>(out, static_cast<int32_t>(command.type));
+    appendValue<uint32_t>(out, static_cast<uint32_t>(command.args.size()));
+    for (const auto& arg : command.args) {
+        appendValue<uint32_t>(out, static_cast<uint32_t>(arg.size()));
+        out.append(arg);
+    }
+    const uint32_t length = static_cast<uint32_t>(out.size() - start - RAFT_LOG_RECORD_HEADER_SIZE);
+    const uint32_t crc = Utils::crc32(out.data() + start + RAFT_LOG_RECORD_HEADER_SIZE, length);
+    std::memcpy(&out[start], &length, sizeof(length));
+    std::memcpy(&out[start + sizeof(length)], &crc, sizeof(crc));
+}
+
+void AttachRaftLogRecord(RaftLogEntry& entry) {
+    if (entry.record || !entry.command) {
+        return;
+    }
+    auto record = std::make_shared<std::string>();
+    EncodeRaftLogRecord(*record, entry);
+    entry.record = std::move(record);
+}
+
+const std::string& RaftLogRecordOf(const RaftLogEntry& entry, std::string& scratch) {
+    if (entry.record) {
+        return *entry.record;
+    }
+    scratch.clear();
+    EncodeRaftLogRecord(scratch, entry);
+    return scratch;
+}
+
+bool ReadRaftLogRecord(ByteReader& reader, RaftLogEntry& entry, bool keepRecord) {
+    const uint32_t length = reader.read<uint32_t>();
+    const uint32_t crc = reader.read<uint32_t>();
+    std::string_view payload = reader.readBytes(length);
+    if (!reader || Utils::crc32(payload.data(), payload.size()) != crc || !decodePayload(payload, entry, !keepRecord)) {
+        return false;
+    }
+    if (keepRecord) {
+        // 记录头紧挨在载荷之前
+        entry.record = std::make_shared<const std::string>(payload.data() - RAFT_LOG_RECORD_HEADER_SIZE,
+                                                           payload.size() + RAFT_LOG_RECORD_HEADER_SIZE);
+    } else {
+        entry.record.reset();
+    }
+    return true;
+}
+
+void CompactRaftLogEntry(RaftLogEntry& entry) {
+    AttachRaftLogRecord(entry);
+    if (entry.record) {
+        entry.command.reset();
+    }
+}
+
+std::shared_ptr<RaftCommand> RaftLogCommandOf(const RaftLogEntry& entry) {
+    if (entry.command || !entry.record || entry.record->size() < RAFT_LOG_RECORD_HEADER_SIZE) {
+        return entry.command;
+    }
+    // 记录在写入日志前已经校验过，这里只解码载荷
+    RaftLogEntry decoded;
+    std::string_view payload(entry.record->data() + RAFT_LOG_RECORD_HEADER_SIZE,
+                             entry.record->size() - RAFT_LOG_RECORD_HEADER_SIZE);
+    if (!decodePayload(payload, decoded, true)) {
+        return nullptr;
+    }
+    return decoded.command;
+}
+
+size_t RaftLogEntryBytes(const RaftLogEntry& entry) {
+    if (entry.record) {
+        return entry.record->size();
+    }
+    return entry.command ? RAFT_LOG_RECORD_HEADER_SIZE + 2 * sizeof(int32_t) + entry.command->db_command.PersistBytes() : 0;
+}
+
+} // namespace dkv
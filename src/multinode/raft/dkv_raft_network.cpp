@@ -1,10 +1,16 @@
 #include "multinode/raft/dkv_raft_network.hpp"
+#include "multinode/raft/dkv_raft_log_codec.hpp"
 #include "dkv_logger.hpp"
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <climits>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <endian.h>
 #include <cerrno>
 #include <cstring>
 
@@ -15,6 +21,12 @@ RaftTcpNetwork::RaftTcpNetwork(int me, const std::vector<std::string>& peers) :
     // 初始化连接状态信息
     InitializeConnections();
     
+    // 启动各节点的发送线程
+    senders_running_ = true;
+    for (auto& channel : channels_) {
+        channel.second->sender = std::thread(&RaftTcpNetwork::SenderLoop, this, channel.first);
+    }
+    
     // 启动监听线程
     StartListener();
     
@@ -25,6 +37,9 @@ RaftTcpNetwork::RaftTcpNetwork(int me, const std::vector<std::string>& peers) :
 
 // RAFT TCP网络实现析构函数
 RaftTcpNetwork::~RaftTcpNetwork() {
+    // 停止发送线程
+    StopSenders();
+    
     // 停止连接维护线程
     maintenance_running_ = false;
     maintenance_cv_.notify_one();
@@ -60,6 +75,8 @@ void RaftTcpNetwork::InitializeConnections() {
         conn_info.next_retry_time = std::chrono::steady_clock::now();
         
         connections_[i] = conn_info;
+        rpc_mutexes_[i] = std::make_unique<std::mutex>();
+        channels_[i] = std::make_unique<PeerChannel>();
         DKV_LOG_INFO("初始化连接到节点 ", i, "，地址: ", peers_[i]);
     }
 }
@@ -99,6 +116,16 @@ void RaftTcpNetwork::CheckAndUpdateConnections() {
             
             // 在单独的线程中尝试连接，避免阻塞维护线程
             std::thread([this, serverId]() {
+                // 正在进行的RPC会自行重连，不与其争用连接
+                std::unique_lock<std::mutex> rpc_lock(*rpc_mutexes_[serverId], std::try_to_lock);
+                if (!rpc_lock.owns_lock()) {
+                    std::lock_guard<std::mutex> lock(connections_mutex_);
+                    auto& conn_info = connections_[serverId];
+                    if (conn_info.state == ConnectionState::CONNECTING) {
+                        conn_info.state = ConnectionState::RECONNECTING;
+                    }
+                    return;
+                }
                 bool success = TryConnect(serverId);
                 if (success) {
                     DKV_LOG_INFO("成功连接到节点 ", serverId);
@@ -254,6 +281,16 @@ bool RaftTcpNetwork::TryConnect(int serverId) {
         }
     }
     
+    // 连接建立后恢复阻塞模式，收发由超时限制，避免长时间卡在故障节点上
+    fcntl(sockfd, F_SETFL, flags);
+    struct timeval timeout;
+    timeout.tv_sec = RPC_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (RPC_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int nodelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    
     // 连接成功
     DKV_LOG_INFO("成功连接到节点 ", serverId, " (", ip, ":", port, ")");
     
@@ -298,28 +335,20 @@ std::chrono::steady_clock::time_point RaftTcpNetwork::CalculateNextRetryTime(int
 }
 
 // 检查连接是否有效
+// 空闲的长连接上不应有可读数据：可读说明对端已关闭，或残留了超时请求的响应，都需要重连
 bool RaftTcpNetwork::IsConnectionValid(int sockfd) {
     if (sockfd < 0) {
         return false;
     }
     
-    // 使用select检查套接字是否可写，超时时间为100ms
-    fd_set writefds;
-    struct timeval tv;
-    
-    FD_ZERO(&writefds);
-    FD_SET(sockfd, &writefds);
-    
-    tv.tv_sec = 0;
-    tv.tv_usec = 100000;  // 100ms
-    
-    int ret = select(sockfd + 1, nullptr, &writefds, nullptr, &tv);
-    if (ret < 0) {
+    struct pollfd pfd;
+    pfd.fd = sockfd;
+    pfd.events = POLLIN | POLLOUT;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) < 0) {
         return false;
     }
-    
-    if (ret == 0) {
-        // 超时，连接可能已失效
+    if (pfd.revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL)) {
         return false;
     }
     
@@ -370,14 +399,9 @@ void RaftTcpNetwork::StopListener() {
         return;
     }
     
+    // 监听线程每次epoll_wait最多等待100ms，退出时关闭监听套接字和全部连接
     listener_running_ = false;
     
-    // 关闭监听套接字，唤醒监听线程
-    if (listen_fd_ != -1) {
-        close(listen_fd_);
-        listen_fd_ = -1;
-    }
-    
     // 等待监听线程结束
     if (listener_thread_.joinable()) {
         listener_thread_.join();
@@ -446,175 +470,262 @@ void RaftTcpNetwork::Listen() {
         return;
     }
     
+    // 监听套接字设为非阻塞，由epoll统一等待新连接和各连接上的请求
+    int listen_flags = fcntl(listen_fd_, F_GETFL, 0);
+    fcntl(listen_fd_, F_SETFL, listen_flags | O_NONBLOCK);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        DKV_LOG_ERROR("创建epoll失败: ", strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd_, &ev);
+    
     DKV_LOG_INFO("Raft网络监听已启动，地址: ", self_addr);
     
-    // 接受连接
+    // 每个连接未处理完的输入
+    std::unordered_map<int, std::vector<char>> buffers;
+    auto closeClient = [&](int fd) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        buffers.erase(fd);
+    };
+    
+    constexpr int MAX_EVENTS = 64;
+    struct epoll_event events[MAX_EVENTS];
     while (listener_running_) {
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        int client_fd = accept(listen_fd_, (struct sockaddr*)&client_addr, &client_len);
-        
-        if (client_fd < 0) {
-            if (listener_running_) {
-                DKV_LOG_ERROR("接受连接失败: ", strerror(errno));
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, 100);
+        if (n < 0) {
+            if (errno != EINTR) {
+                DKV_LOG_ERROR("epoll_wait失败: ", strerror(errno));
             }
             continue;
         }
-        
-        // 创建线程处理连接
-        std::thread(&RaftTcpNetwork::HandleConnection, this, client_fd).detach();
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                // 接受所有等待中的连接
+                while (true) {
+                    int client_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (client_fd < 0) {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            DKV_LOG_ERROR("接受连接失败: ", strerror(errno));
+                        }
+                        break;
+                    }
+                    int nodelay = 1;
+                    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+                    struct epoll_event client_ev;
+                    memset(&client_ev, 0, sizeof(client_ev));
+                    client_ev.events = EPOLLIN | EPOLLRDHUP;
+                    client_ev.data.fd = client_fd;
+                    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &client_ev) < 0) {
+                        DKV_LOG_ERROR("注册Raft连接失败: ", strerror(errno));
+                        close(client_fd);
+                        continue;
+                    }
+                    buffers[client_fd];
+                }
+                continue;
+            }
+            if (!HandleReadable(fd, buffers[fd])) {
+                closeClient(fd);
+            }
+        }
     }
     
-    // 关闭监听套接字
+    // 关闭全部连接和监听套接字
+    while (!buffers.empty()) {
+        closeClient(buffers.begin()->first);
+    }
+    close(epoll_fd);
     close(listen_fd_);
     listen_fd_ = -1;
 }
 
-// 处理连接
-void RaftTcpNetwork::HandleConnection(int client_fd) {
-    try {
-        // 接收请求数据
-        std::vector<char> request_data = ReceiveData(client_fd);
-        if (request_data.empty()) {
-            close(client_fd);
-            return;
+// 读取连接上的数据，逐帧处理
+bool RaftTcpNetwork::HandleReadable(int client_fd, std::vector<char>& buffer) {
+    char chunk[64 * 1024];
+    bool closed = false;
+    while (true) {
+        ssize_t n = recv(client_fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            buffer.insert(buffer.end(), chunk, chunk + n);
+            continue;
         }
-        
-        // 解析请求类型（第一个字节）
-        if (request_data.empty()) {
-            close(client_fd);
-            return;
+        if (n == 0) {
+            closed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return false;
+        }
+        break;
+    }
+    
+    // 处理所有完整的帧，剩余的不完整数据留到下次
+    size_t offset = 0;
+    while (buffer.size() - offset >= sizeof(uint32_t)) {
+        uint32_t len = 0;
+        memcpy(&len, buffer.data() + offset, sizeof(len));
+        len = ntohl(len);
+        if (len == 0 || len > MAX_FRAME_SIZE) {
+            DKV_LOG_ERROR("Raft请求帧长度无效: ", len);
+            return false;
+        }
+        if (buffer.size() - offset - sizeof(uint32_t) < len) {
+            break;
         }
+        if (!HandleRequest(client_fd, std::string_view(buffer.data() + offset + sizeof(uint32_t), len))) {
+            return false;
+        }
+        offset += sizeof(uint32_t) + len;
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+    return !closed;
+}
+
+// 处理一帧请求
+// 请求在epoll线程上依次处理，OnAppendEntries等调用本身不做网络等待
+bool RaftTcpNetwork::HandleRequest(int client_fd, std::string_view frame) {
+    try {
+        // 解析请求类型（第一个字节）
+        char request_type = frame[0];
+        std::string_view payload = frame.substr(1);
         
-        char request_type = request_data[0];
-        std::vector<char> payload_data(request_data.begin() + 1, request_data.end());
+        std::vector<char> response_data;
+        if (request_type == 'B') { // 批量AppendEntries请求
+            if (!HandleAppendBatch(payload, response_data)) {
+                DKV_LOG_ERROR("批量AppendEntries请求损坏");
+                return false;
+            }
+            return SendData(client_fd, {{response_data.data(), response_data.size()}});
+        }
         
-        // 获取Raft实例
-        auto raft = raft_.lock();
+        // 其余请求以组ID开头，发往未注册组的请求得到失败响应
+        if (payload.size() < sizeof(uint32_t)) {
+            DKV_LOG_ERROR("Raft请求缺少组ID");
+            return false;
+        }
+        uint32_t groupId = 0;
+        memcpy(&groupId, payload.data(), sizeof(groupId));
+        groupId = ntohl(groupId);
+        payload.remove_prefix(sizeof(groupId));
+        auto raft = FindGroup(groupId);
         if (!raft) {
-            DKV_LOG_ERROR("Raft实例已失效");
-            close(client_fd);
-            return;
+            DKV_LOG_WARNING("Raft组 ", groupId, " 未注册");
         }
         
         // 根据请求类型处理
-        std::vector<char> response_data;
+        std::vector<char> body(payload.begin(), payload.end());
         switch (request_type) {
-            case 'A': { // AppendEntries请求
-                AppendEntriesRequest request = DeserializeAppendEntries(payload_data);
-                AppendEntriesResponse response = raft->OnAppendEntries(request);
-                response_data = SerializeAppendEntriesResponse(response);
-                break;
-            }
             case 'V': { // RequestVote请求
-                RequestVoteRequest request = DeserializeRequestVote(payload_data);
-                RequestVoteResponse response = raft->OnRequestVote(request);
+                RequestVoteRequest request = DeserializeRequestVote(body);
+                RequestVoteResponse response{0, false};
+                if (raft) {
+                    response = raft->OnRequestVote(request);
+                }
                 response_data = SerializeRequestVoteResponse(response);
                 break;
             }
             case 'S': { // InstallSnapshot请求
-                InstallSnapshotRequest request = DeserializeInstallSnapshot(payload_data);
-                InstallSnapshotResponse response = raft->OnInstallSnapshot(request);
+                InstallSnapshotRequest request = DeserializeInstallSnapshot(body);
+                InstallSnapshotResponse response{0, false};
+                if (raft) {
+                    response = raft->OnInstallSnapshot(request);
+                }
                 response_data = SerializeInstallSnapshotResponse(response);
                 break;
             }
+            case 'R': { // ReadIndex请求
+                ReadIndexRequest request = DeserializeReadIndex(body);
+                ReadIndexResponse response;
+                if (raft) {
+                    response = raft->OnReadIndex(request);
+                }
+                response_data = SerializeReadIndexResponse(response);
+                break;
+            }
             default:
                 DKV_LOG_ERROR("未知的请求类型: ", request_type);
-                close(client_fd);
-                return;
+                return false;
         }
         
-        // 发送响应
-        SendData(client_fd, response_data);
-        close(client_fd);
+        // 发送响应，连接保持打开供后续请求使用
+        return SendData(client_fd, {{response_data.data(), response_data.size()}});
     } catch (const std::exception& e) {
-        DKV_LOG_ERROR("处理连接时发生异常: ", e.what());
-        close(client_fd);
+        DKV_LOG_ERROR("处理Raft请求时发生异常: ", e.what());
+        return false;
     }
 }
 
-// 反序列化AppendEntries请求
-AppendEntriesRequest RaftTcpNetwork::DeserializeAppendEntries(const std::vector<char>& data) {
-    AppendEntriesRequest request;
-    
-    if (data.size() < 20) { // 5个uint32_t字段
-        return request;
+// 处理批量AppendEntries：请求数，之后每个请求为 组ID 长度 AppendEntries消息体；
+// 响应为请求数和按相同顺序排列的AppendEntries响应
+bool RaftTcpNetwork::HandleAppendBatch(std::string_view payload, std::vector<char>& response_data) {
+    ByteReader reader(payload);
+    const uint32_t count = ntohl(reader.read<uint32_t>());
+    if (!reader) {
+        return false;
+    }
+    uint32_t responseCount = htonl(count);
+    response_data.assign((char*)&responseCount, (char*)&responseCount + sizeof(responseCount));
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t groupId = ntohl(reader.read<uint32_t>());
+        const uint32_t length = ntohl(reader.read<uint32_t>());
+        std::string_view body = reader.readBytes(length);
+        if (!reader) {
+            return false;
+        }
+        AppendEntriesRequest request;
+        if (!DeserializeAppendEntries(body, request)) {
+            DKV_LOG_ERROR("AppendEntries请求中的日志记录损坏，Raft组 ", groupId);
+            return false;
+        }
+        AppendEntriesResponse response{0, false, 0};
+        if (auto raft = FindGroup(groupId)) {
+            response = raft->OnAppendEntries(request);
+        } else {
+            DKV_LOG_WARNING("Raft组 ", groupId, " 未注册");
+        }
+        std::vector<char> data = SerializeAppendEntriesResponse(response);
+        response_data.insert(response_data.end(), data.begin(), data.end());
+    }
+    return reader.remaining() == 0;
+}
+
+// 反序列化AppendEntries请求：固定字段之后是entriesSize条日志记录
+bool RaftTcpNetwork::DeserializeAppendEntries(std::string_view data, AppendEntriesRequest& request) {
+    if (data.size() < 28) { // 7个uint32_t字段
+        return false;
     }
     
-    size_t offset = 0;
-    
-    // 反序列化term
-    uint32_t term = 0;
-    memcpy(&term, data.data() + offset, sizeof(term));
-    request.term = ntohl(term);
-    offset += sizeof(term);
-    
-    // 反序列化leaderId
-    uint32_t leaderId = 0;
-    memcpy(&leaderId, data.data() + offset, sizeof(leaderId));
-    request.leaderId = ntohl(leaderId);
-    offset += sizeof(leaderId);
-    
-    // 反序列化prevLogIndex
-    uint32_t prevLogIndex = 0;
-    memcpy(&prevLogIndex, data.data() + offset, sizeof(prevLogIndex));
-    request.prevLogIndex = ntohl(prevLogIndex);
-    offset += sizeof(prevLogIndex);
-    
-    // 反序列化prevLogTerm
-    uint32_t prevLogTerm = 0;
-    memcpy(&prevLogTerm, data.data() + offset, sizeof(prevLogTerm));
-    request.prevLogTerm = ntohl(prevLogTerm);
-    offset += sizeof(prevLogTerm);
-    
-    // 反序列化leaderCommit
-    uint32_t leaderCommit = 0;
-    memcpy(&leaderCommit, data.data() + offset, sizeof(leaderCommit));
-    request.leaderCommit = ntohl(leaderCommit);
-    offset += sizeof(leaderCommit);
-    
-    // 反序列化日志条目数量
-    uint32_t entriesSize = 0;
-    memcpy(&entriesSize, data.data() + offset, sizeof(entriesSize));
-    entriesSize = ntohl(entriesSize);
-    offset += sizeof(entriesSize);
-    
-    // 反序列化每个日志条目
-    for (uint32_t i = 0; i < entriesSize && offset < data.size(); i++) {
+    uint32_t fields[7];
+    memcpy(fields, data.data(), sizeof(fields));
+    request.term = ntohl(fields[0]);
+    request.leaderId = ntohl(fields[1]);
+    request.prevLogIndex = ntohl(fields[2]);
+    request.prevLogTerm = ntohl(fields[3]);
+    request.leaderCommit = ntohl(fields[4]);
+    uint32_t entriesSize = ntohl(fields[5]);
+    request.quiesce = ntohl(fields[6]) != 0;
+    
+    // 条目保留收到的记录字节，跟随者写日志段时直接使用
+    ByteReader reader(data.substr(sizeof(fields)));
+    request.entries.clear();
+    request.entries.reserve(std::min<size_t>(entriesSize, reader.remaining() / RAFT_LOG_RECORD_HEADER_SIZE));
+    for (uint32_t i = 0; i < entriesSize; i++) {
         RaftLogEntry entry;
-        
-        // entry.term
-        uint32_t entryTerm = 0;
-        memcpy(&entryTerm, data.data() + offset, sizeof(entryTerm));
-        entry.term = ntohl(entryTerm);
-        offset += sizeof(entryTerm);
-        
-        // entry.index
-        uint32_t entryIndex = 0;
-        memcpy(&entryIndex, data.data() + offset, sizeof(entryIndex));
-        entry.index = ntohl(entryIndex);
-        offset += sizeof(entryIndex);
-        
-        // 反序列化RaftCommand对象
-        TransactionID cmdTxId = 0;
-        memcpy(&cmdTxId, data.data() + offset, sizeof(cmdTxId));
-        cmdTxId = ntohl(cmdTxId);
-        offset += sizeof(cmdTxId);
-        if (offset < data.size()) {
-            std::vector<char> cmd_data(data.begin() + offset, data.end());
-            Command db_cmd;
-            if (db_cmd.deserialize(cmd_data)) {
-                auto raft_cmd = std::make_shared<RaftCommand>(cmdTxId, db_cmd);
-                entry.command = raft_cmd;
-                // 计算命令的序列化大小
-                offset += db_cmd.PersistBytes();
-            }
+        if (!ReadRaftLogRecord(reader, entry, true)) {
+            return false;
         }
-        
-        request.entries.push_back(entry);
+        request.entries.push_back(std::move(entry));
     }
-    
-    return request;
+    return reader.remaining() == 0;
 }
 
 // 反序列化RequestVote请求
@@ -658,7 +769,7 @@ RequestVoteRequest RaftTcpNetwork::DeserializeRequestVote(const std::vector<char
 InstallSnapshotRequest RaftTcpNetwork::DeserializeInstallSnapshot(const std::vector<char>& data) {
     InstallSnapshotRequest request;
     
-    if (data.size() < 24) { // 6个uint32_t字段
+    if (data.size() < 36) { // 5个uint32_t字段、8字节偏移、done标志和数据长度
         return request;
     }
     
@@ -694,6 +805,17 @@ InstallSnapshotRequest RaftTcpNetwork::DeserializeInstallSnapshot(const std::vec
     request.leaderCommit = ntohl(leaderCommit);
     offset += sizeof(leaderCommit);
     
+    // 反序列化数据块偏移和done标志
+    uint64_t chunkOffset = 0;
+    memcpy(&chunkOffset, data.data() + offset, sizeof(chunkOffset));
+    request.offset = be64toh(chunkOffset);
+    offset += sizeof(chunkOffset);
+    
+    uint32_t done = 0;
+    memcpy(&done, data.data() + offset, sizeof(done));
+    request.done = ntohl(done) != 0;
+    offset += sizeof(done);
+    
     // 反序列化快照数据
     uint32_t snapshotSize = 0;
     memcpy(&snapshotSize, data.data() + offset, sizeof(snapshotSize));
@@ -753,114 +875,275 @@ std::vector<char> RaftTcpNetwork::SerializeInstallSnapshotResponse(const Install
     uint32_t success = htonl(response.success ? 1 : 0);
     data.insert(data.end(), (char*)&success, (char*)&success + sizeof(success));
     
+    // 序列化nextOffset
+    uint64_t nextOffset = htobe64(response.nextOffset);
+    data.insert(data.end(), (char*)&nextOffset, (char*)&nextOffset + sizeof(nextOffset));
+    
     return data;
 }
 
 // 发送AppendEntries请求
 AppendEntriesResponse RaftTcpNetwork::SendAppendEntries(int serverId, const AppendEntriesRequest& request) {
-    DKV_LOG_INFO("发送AppendEntries请求到节点 ", serverId);
-    
-    // 1. 序列化请求
-    std::vector<char> requestData = SerializeAppendEntries(request);
-    
-    // 2. 添加请求类型标识 'A' 表示AppendEntries
-    std::vector<char> fullRequestData;
-    fullRequestData.push_back('A');
-    fullRequestData.insert(fullRequestData.end(), requestData.begin(), requestData.end());
-    
-    // 3. 获取连接
-    int sockfd = EstablishConnection(serverId);
-    if (sockfd < 0) {
-        AppendEntriesResponse response;
-        response.term = 0;
-        response.success = false;
-        response.matchIndex = 0;
-        return response;
+    return SendAppendEntries(0, serverId, request);
+}
+
+// 交给节点serverId的发送线程，与同一时间发往该节点的其他组的请求合并发送，等待响应
+AppendEntriesResponse RaftTcpNetwork::SendAppendEntries(uint32_t groupId, int serverId, const AppendEntriesRequest& request) {
+    PendingAppend pending{groupId, &request, {0, false, 0}, false};
+    auto it = channels_.find(serverId);
+    if (it == channels_.end()) {
+        DKV_LOG_ERROR("无效的节点ID: ", serverId);
+        return pending.response;
     }
-    
-    // 4. 发送请求
-    if (!SendData(sockfd, fullRequestData)) {
-        // 发送失败，标记连接为需要重新连接
-        DKV_LOG_ERROR("发送AppendEntries请求到节点 ", serverId, " 失败，关闭连接");
-        CloseConnection(serverId);
-        AppendEntriesResponse response;
-        response.term = 0;
-        response.success = false;
-        response.matchIndex = 0;
-        return response;
+    PeerChannel& channel = *it->second;
+    std::unique_lock<std::mutex> lock(channel.mutex);
+    if (!senders_running_) {
+        return pending.response;
     }
+    channel.queue.push_back(&pending);
+    channel.cv.notify_all();
+    channel.cv.wait(lock, [&pending]() { return pending.done; });
+    return pending.response;
+}
+
+// 发送RequestVote请求
+RequestVoteResponse RaftTcpNetwork::SendRequestVote(int serverId, const RequestVoteRequest& request) {
+    return SendRequestVote(0, serverId, request);
+}
+
+RequestVoteResponse RaftTcpNetwork::SendRequestVote(uint32_t groupId, int serverId, const RequestVoteRequest& request) {
+    DKV_LOG_INFO("发送RequestVote请求到节点 ", serverId, "，Raft组 ", groupId);
     
-    // 5. 接收响应
-    std::vector<char> responseData = ReceiveData(sockfd);
-    if (responseData.empty()) {
-        // 接收失败，标记连接为需要重新连接
-        DKV_LOG_ERROR("接收AppendEntries响应失败，关闭连接");
-        CloseConnection(serverId);
-        AppendEntriesResponse response;
-        response.term = 0;
-        response.success = false;
-        response.matchIndex = 0;
+    uint32_t group = htonl(groupId);
+    std::vector<char> requestData = SerializeRequestVote(request);
+    RequestVoteResponse response;
+    response.term = 0;
+    response.voteGranted = false;
+    std::vector<char> responseData;
+    if (!Call(serverId, 'V', {{&group, sizeof(group)}, {requestData.data(), requestData.size()}}, responseData)) {
         return response;
     }
+    response = DeserializeRequestVoteResponse(responseData);
     
-    // 6. 反序列化响应
-    AppendEntriesResponse response = DeserializeAppendEntriesResponse(responseData);
-    
-    DKV_LOG_INFO("收到AppendEntries响应，节点 ", serverId, "，结果 ", response.success);
+    DKV_LOG_INFO("收到RequestVote响应，节点 ", serverId, "，结果 ", response.voteGranted);
     
     return response;
 }
 
-// 发送RequestVote请求
-RequestVoteResponse RaftTcpNetwork::SendRequestVote(int serverId, const RequestVoteRequest& request) {
-    DKV_LOG_INFO("发送RequestVote请求到节点 ", serverId);
-    
-    // 1. 序列化请求
-    std::vector<char> requestData = SerializeRequestVote(request);
-    
-    // 2. 添加请求类型标识 'V' 表示RequestVote
-    std::vector<char> fullRequestData;
-    fullRequestData.push_back('V');
-    fullRequestData.insert(fullRequestData.end(), requestData.begin(), requestData.end());
+// 在到serverId的连接上完成一次请求与响应
+bool RaftTcpNetwork::Call(int serverId, char type, const std::vector<struct iovec>& body, std::vector<char>& response) {
+    auto mutex_it = rpc_mutexes_.find(serverId);
+    if (mutex_it == rpc_mutexes_.end()) {
+        DKV_LOG_ERROR("无效的节点ID: ", serverId);
+        return false;
+    }
+    std::lock_guard<std::mutex> rpc_lock(*mutex_it->second);
     
-    // 3. 获取连接
     int sockfd = EstablishConnection(serverId);
     if (sockfd < 0) {
-        RequestVoteResponse response;
-        response.term = 0;
-        response.voteGranted = false;
-        return response;
+        return false;
     }
     
-    // 4. 发送请求
-    if (!SendData(sockfd, fullRequestData)) {
+    std::vector<struct iovec> frame;
+    frame.reserve(body.size() + 1);
+    frame.push_back({&type, 1});
+    frame.insert(frame.end(), body.begin(), body.end());
+    if (!SendData(sockfd, frame)) {
         // 发送失败，标记连接为需要重新连接
-        DKV_LOG_ERROR("发送RequestVote请求到节点 ", serverId, " 失败，关闭连接");
+        DKV_LOG_ERROR("发送请求 ", type, " 到节点 ", serverId, " 失败，关闭连接");
         CloseConnection(serverId);
-        RequestVoteResponse response;
-        response.term = 0;
-        response.voteGranted = false;
-        return response;
+        return false;
     }
     
-    // 5. 接收响应
-    std::vector<char> responseData = ReceiveData(sockfd);
-    if (responseData.empty()) {
-        // 接收失败，标记连接为需要重新连接
-        DKV_LOG_ERROR("接收RequestVote响应失败，关闭连接");
+    response = ReceiveData(sockfd);
+    if (response.empty()) {
+        // 接收失败或超时，连接上可能残留迟到的响应，关闭后重新连接
+        DKV_LOG_ERROR("接收节点 ", serverId, " 的响应 ", type, " 失败，关闭连接");
         CloseConnection(serverId);
-        RequestVoteResponse response;
-        response.term = 0;
-        response.voteGranted = false;
-        return response;
+        return false;
+    }
+    channels_.at(serverId)->lastHeard = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return true;
+}
+
+// 注册Raft组
+void RaftTcpNetwork::RegisterGroup(uint32_t groupId, std::shared_ptr<Raft> raft) {
+    std::lock_guard<std::mutex> lock(groups_mutex_);
+    groups_[groupId] = raft;
+}
+
+// 注销Raft组
+void RaftTcpNetwork::UnregisterGroup(uint32_t groupId) {
+    std::lock_guard<std::mutex> lock(groups_mutex_);
+    groups_.erase(groupId);
+}
+
+// 查找Raft组
+std::shared_ptr<Raft> RaftTcpNetwork::FindGroup(uint32_t groupId) {
+    std::lock_guard<std::mutex> lock(groups_mutex_);
+    auto it = groups_.find(groupId);
+    return it == groups_.end() ? nullptr : it->second.lock();
+}
+
+// 节点是否存活：批量帧和其他请求都会刷新最近一次成功的时间
+bool RaftTcpNetwork::IsPeerAlive(int serverId, int within_ms) {
+    auto it = channels_.find(serverId);
+    if (it == channels_.end()) {
+        return false;
+    }
+    const int64_t lastHeard = it->second->lastHeard;
+    const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return lastHeard > 0 && now - lastHeard <= within_ms;
+}
+
+namespace {
+
+// 请求在批量帧中大约占用的字节数，用于限制批量帧大小
+size_t PendingAppendBytes(const AppendEntriesRequest& request) {
+    size_t bytes = 0;
+    for (const auto& entry : request.entries) {
+        bytes += entry.record ? entry.record->size() : RAFT_LOG_RECORD_HEADER_SIZE;
+    }
+    return bytes;
+}
+
+} // namespace
+
+// 节点serverId的发送线程
+// 发送期间到达的请求在下一帧一起发出；空闲一个心跳间隔后发送空批量帧，让对端的静默组确认本节点存活
+void RaftTcpNetwork::SenderLoop(int serverId) {
+    PeerChannel& channel = *channels_.at(serverId);
+    std::unique_lock<std::mutex> lock(channel.mutex);
+    while (senders_running_) {
+        if (channel.queue.empty()) {
+            channel.cv.wait_for(lock, std::chrono::milliseconds(RAFT_DEFAULT_HEARTBEAT_INTERVAL),
+                                [this, &channel]() { return !senders_running_ || !channel.queue.empty(); });
+            if (!senders_running_) {
+                break;
+            }
+            if (channel.queue.empty()) {
+                // 只在连接已建立时探测，断开的连接由维护线程按退避重连
+                bool connected = false;
+                {
+                    std::lock_guard<std::mutex> conn_lock(connections_mutex_);
+                    auto it = connections_.find(serverId);
+                    connected = it != connections_.end() && it->second.state == ConnectionState::CONNECTED;
+                }
+                if (connected) {
+                    lock.unlock();
+                    SendAppendBatch(serverId, {});
+                    lock.lock();
+                }
+                continue;
+            }
+        }
+        
+        // 取出一批请求，至少一个
+        std::vector<PendingAppend*> batch;
+        size_t batchBytes = 0;
+        while (!channel.queue.empty() && (batch.empty() || batchBytes < MAX_BATCH_BYTES)) {
+            batchBytes += PendingAppendBytes(*channel.queue.front()->request);
+            batch.push_back(channel.queue.front());
+            channel.queue.pop_front();
+        }
+        lock.unlock();
+        SendAppendBatch(serverId, batch);
+        lock.lock();
+        for (PendingAppend* pending : batch) {
+            pending->done = true;
+        }
+        channel.cv.notify_all();
     }
     
-    // 6. 反序列化响应
-    RequestVoteResponse response = DeserializeRequestVoteResponse(responseData);
-    
-    DKV_LOG_INFO("收到RequestVote响应，节点 ", serverId, "，结果 ", response.voteGranted);
+    // 未发送的请求以失败结束
+    for (PendingAppend* pending : channel.queue) {
+        pending->done = true;
+    }
+    channel.queue.clear();
+    channel.cv.notify_all();
+}
+
+// 发送一个批量帧：请求数，之后每个请求为 组ID 长度 固定字段 日志记录
+void RaftTcpNetwork::SendAppendBatch(int serverId, const std::vector<PendingAppend*>& batch) {
+    // 每个请求的组ID、长度和固定字段，位置在写出前不再变化
+    std::vector<uint32_t> prefixes(batch.size() * 2);
+    std::vector<std::vector<char>> headers(batch.size());
+    std::vector<std::vector<std::string>> scratch(batch.size());
+    uint32_t count = htonl(static_cast<uint32_t>(batch.size()));
+    std::vector<struct iovec> body;
+    body.push_back({&count, sizeof(count)});
+    for (size_t i = 0; i < batch.size(); i++) {
+        const AppendEntriesRequest& request = *batch[i]->request;
+        headers[i] = SerializeAppendEntriesHeader(request);
+        scratch[i].resize(request.entries.size());
+        body.push_back({&prefixes[2 * i], 2 * sizeof(uint32_t)});
+        body.push_back({headers[i].data(), headers[i].size()});
+        size_t length = headers[i].size();
+        for (size_t j = 0; j < request.entries.size(); j++) {
+            const std::string& record = RaftLogRecordOf(request.entries[j], scratch[i][j]);
+            body.push_back({const_cast<char*>(record.data()), record.size()});
+            length += record.size();
+        }
+        prefixes[2 * i] = htonl(batch[i]->groupId);
+        prefixes[2 * i + 1] = htonl(static_cast<uint32_t>(length));
+    }
     
-    return response;
+    std::vector<char> responseData;
+    if (!Call(serverId, 'B', body, responseData)) {
+        return;
+    }
+    ByteReader reader(std::string_view(responseData.data(), responseData.size()));
+    const uint32_t responseCount = ntohl(reader.read<uint32_t>());
+    if (!reader || responseCount != batch.size() || reader.remaining() != responseCount * 12) {
+        DKV_LOG_ERROR("节点 ", serverId, " 的批量AppendEntries响应无效");
+        return;
+    }
+    for (PendingAppend* pending : batch) {
+        std::string_view data = reader.readBytes(12);
+        pending->response = DeserializeAppendEntriesResponse(std::vector<char>(data.begin(), data.end()));
+    }
+    DKV_LOG_DEBUG("节点 ", serverId, " 完成批量AppendEntries，请求数 ", batch.size());
+}
+
+// 停止发送线程
+void RaftTcpNetwork::StopSenders() {
+    if (!senders_running_) {
+        return;
+    }
+    for (auto& channel : channels_) {
+        // 持锁后再通知，避免发送线程在检查标志与开始等待之间错过通知
+        std::lock_guard<std::mutex> lock(channel.second->mutex);
+        senders_running_ = false;
+        channel.second->cv.notify_all();
+    }
+    for (auto& channel : channels_) {
+        if (channel.second->sender.joinable()) {
+            channel.second->sender.join();
+        }
+    }
+}
+
+// RaftGroupNetwork实现：转发到共享传输，带上组ID
+AppendEntriesResponse RaftGroupNetwork::SendAppendEntries(int serverId, const AppendEntriesRequest& request) {
+    return transport_->SendAppendEntries(groupId_, serverId, request);
+}
+
+RequestVoteResponse RaftGroupNetwork::SendRequestVote(int serverId, const RequestVoteRequest& request) {
+    return transport_->SendRequestVote(groupId_, serverId, request);
+}
+
+InstallSnapshotResponse RaftGroupNetwork::SendInstallSnapshot(int serverId, const InstallSnapshotRequest& request) {
+    return transport_->SendInstallSnapshot(groupId_, serverId, request);
+}
+
+ReadIndexResponse RaftGroupNetwork::SendReadIndex(int serverId, const ReadIndexRequest& request) {
+    return transport_->SendReadIndex(groupId_, serverId, request);
+}
+
+bool RaftGroupNetwork::IsPeerAlive(int serverId, int within_ms) {
+    return transport_->IsPeerAlive(serverId, within_ms);
 }
 
 // 建立连接（复用现有连接或创建新连接）
@@ -909,34 +1192,90 @@ int RaftTcpNetwork::EstablishConnection(int serverId) {
     return -1;
 }
 
-// 发送数据
-bool RaftTcpNetwork::SendData(int sockfd, const std::vector<char>& data) {
-    if (sockfd < 0 || data.empty()) {
+// 发送一帧：帧长度之后依次写出各个片段
+// 用sendmsg一次提交多个片段，部分写入时从中断处继续；非阻塞套接字写满时等待可写
+bool RaftTcpNetwork::SendData(int sockfd, const std::vector<struct iovec>& body) {
+    if (sockfd < 0 || body.empty()) {
         return false;
     }
     
-    // 发送数据长度
-    uint32_t len = htonl(data.size());
-    if (send(sockfd, &len, sizeof(len), 0) != sizeof(len)) {
-        DKV_LOG_ERROR("发送数据长度失败: ", strerror(errno));
+    size_t total = 0;
+    for (const auto& part : body) {
+        total += part.iov_len;
+    }
+    if (total > MAX_FRAME_SIZE) {
+        DKV_LOG_ERROR("Raft消息过大: ", total);
         return false;
     }
+    uint32_t len = htonl(static_cast<uint32_t>(total));
+    std::vector<struct iovec> iov;
+    iov.reserve(body.size() + 1);
+    iov.push_back({&len, sizeof(len)});
+    for (const auto& part : body) {
+        if (part.iov_len > 0) {
+            iov.push_back(part);
+        }
+    }
     
-    // 发送数据内容
-    ssize_t sent = 0;
-    while (sent < (ssize_t)data.size()) {
-        ssize_t n = send(sockfd, data.data() + sent, data.size() - sent, 0);
+    size_t first = 0;
+    while (first < iov.size()) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov.data() + first;
+        msg.msg_iovlen = std::min<size_t>(iov.size() - first, IOV_MAX);
+        ssize_t n = sendmsg(sockfd, &msg, MSG_NOSIGNAL);
         if (n < 0) {
-            DKV_LOG_ERROR("发送数据内容失败: ", strerror(errno));
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd pfd;
+                pfd.fd = sockfd;
+                pfd.events = POLLOUT;
+                pfd.revents = 0;
+                if (poll(&pfd, 1, RPC_TIMEOUT_MS) > 0) {
+                    continue;
+                }
+            }
+            DKV_LOG_ERROR("发送数据失败: ", strerror(errno));
             return false;
         }
-        sent += n;
+        // 跳过已写完的片段，调整写了一部分的片段
+        size_t sent = static_cast<size_t>(n);
+        while (first < iov.size() && sent >= iov[first].iov_len) {
+            sent -= iov[first].iov_len;
+            first++;
+        }
+        if (sent > 0) {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + sent;
+            iov[first].iov_len -= sent;
+        }
     }
     
     return true;
 }
 
-// 接收数据
+namespace {
+
+// 阻塞读取size字节，超时、出错或对端关闭时返回false
+bool RecvAll(int sockfd, char* data, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(sockfd, data + received, size - received, 0);
+        if (n > 0) {
+            received += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// 接收一帧
 std::vector<char> RaftTcpNetwork::ReceiveData(int sockfd) {
     if (sockfd < 0) {
         return {};
@@ -944,79 +1283,38 @@ std::vector<char> RaftTcpNetwork::ReceiveData(int sockfd) {
     
     // 接收数据长度
     uint32_t len = 0;
-    if (recv(sockfd, &len, sizeof(len), 0) != sizeof(len)) {
+    if (!RecvAll(sockfd, reinterpret_cast<char*>(&len), sizeof(len))) {
         DKV_LOG_ERROR("接收数据长度失败: ", strerror(errno));
         return {};
     }
     
     len = ntohl(len);
-    if (len == 0) {
+    if (len == 0 || len > MAX_FRAME_SIZE) {
         return {};
     }
     
     // 接收数据内容
     std::vector<char> data(len);
-    ssize_t received = 0;
-    while (received < (ssize_t)len) {
-        ssize_t n = recv(sockfd, data.data() + received, len - received, 0);
-        if (n < 0) {
-            DKV_LOG_ERROR("接收数据内容失败: ", strerror(errno));
-            return {};
-        }
-        received += n;
+    if (!RecvAll(sockfd, data.data(), len)) {
+        DKV_LOG_ERROR("接收数据内容失败: ", strerror(errno));
+        return {};
     }
     
     return data;
 }
 
-// 序列化AppendEntries请求
-std::vector<char> RaftTcpNetwork::SerializeAppendEntries(const AppendEntriesRequest& request) {
-    std::vector<char> data;
-    
-    // 序列化固定长度字段
-    // term
-    uint32_t term = htonl(request.term);
-    data.insert(data.end(), (char*)&term, (char*)&term + sizeof(term));
-    
-    // leaderId
-    uint32_t leaderId = htonl(request.leaderId);
-    data.insert(data.end(), (char*)&leaderId, (char*)&leaderId + sizeof(leaderId));
-    
-    // prevLogIndex
-    uint32_t prevLogIndex = htonl(request.prevLogIndex);
-    data.insert(data.end(), (char*)&prevLogIndex, (char*)&prevLogIndex + sizeof(prevLogIndex));
-    
-    // prevLogTerm
-    uint32_t prevLogTerm = htonl(request.prevLogTerm);
-    data.insert(data.end(), (char*)&prevLogTerm, (char*)&prevLogTerm + sizeof(prevLogTerm));
-    
-    // leaderCommit
-    uint32_t leaderCommit = htonl(request.leaderCommit);
-    data.insert(data.end(), (char*)&leaderCommit, (char*)&leaderCommit + sizeof(leaderCommit));
-    
-    // 序列化日志条目数量
-    uint32_t entriesSize = htonl(request.entries.size());
-    data.insert(data.end(), (char*)&entriesSize, (char*)&entriesSize + sizeof(entriesSize));
-    
-    // 序列化每个日志条目
-    for (const auto& entry : request.entries) {
-        // entry.term
-        uint32_t entryTerm = htonl(entry.term);
-        data.insert(data.end(), (char*)&entryTerm, (char*)&entryTerm + sizeof(entryTerm));
-        
-        // entry.index
-        uint32_t entryIndex = htonl(entry.index);
-        data.insert(data.end(), (char*)&entryIndex, (char*)&entryIndex + sizeof(entryIndex));
-        
-        // 序列化Command对象
-        // cmdTxId
-        TransactionID cmdTxId = htonl(entry.command->tx_id);
-        data.insert(data.end(), (char*)&cmdTxId, (char*)&cmdTxId + sizeof(cmdTxId));
-
-        entry.command->db_command.serialize(data);
-    }
-    
-    return data;
+// 序列化AppendEntries请求的固定字段：term leaderId prevLogIndex prevLogTerm leaderCommit 条目数 静默标记
+std::vector<char> RaftTcpNetwork::SerializeAppendEntriesHeader(const AppendEntriesRequest& request) {
+    uint32_t fields[7] = {
+        htonl(request.term),
+        htonl(request.leaderId),
+        htonl(request.prevLogIndex),
+        htonl(request.prevLogTerm),
+        htonl(request.leaderCommit),
+        htonl(static_cast<uint32_t>(request.entries.size())),
+        htonl(request.quiesce ? 1 : 0),
+    };
+    return std::vector<char>(reinterpret_cast<char*>(fields), reinterpret_cast<char*>(fields) + sizeof(fields));
 }
 
 // 反序列化AppendEntries响应
@@ -1099,52 +1397,96 @@ RequestVoteResponse RaftTcpNetwork::DeserializeRequestVoteResponse(const std::ve
     return response;
 }
 
-// 发送InstallSnapshot请求
-InstallSnapshotResponse RaftTcpNetwork::SendInstallSnapshot(int serverId, const InstallSnapshotRequest& request) {
-    DKV_LOG_INFO("发送InstallSnapshot请求到节点 ", serverId);
-    
-    // 1. 序列化请求
-    std::vector<char> requestData = SerializeInstallSnapshot(request);
-    
-    // 2. 添加请求类型标识 'S' 表示InstallSnapshot
-    std::vector<char> fullRequestData;
-    fullRequestData.push_back('S');
-    fullRequestData.insert(fullRequestData.end(), requestData.begin(), requestData.end());
-    
-    // 3. 获取连接
-    int sockfd = EstablishConnection(serverId);
-    if (sockfd < 0) {
-        InstallSnapshotResponse response;
-        response.term = 0;
-        response.success = false;
-        return response;
+// 发送ReadIndex请求
+ReadIndexResponse RaftTcpNetwork::SendReadIndex(int serverId, const ReadIndexRequest& request) {
+    return SendReadIndex(0, serverId, request);
+}
+
+ReadIndexResponse RaftTcpNetwork::SendReadIndex(uint32_t groupId, int serverId, const ReadIndexRequest& request) {
+    DKV_LOG_DEBUG("发送ReadIndex请求到节点 ", serverId, "，Raft组 ", groupId);
+    
+    uint32_t group = htonl(groupId);
+    std::vector<char> requestData = SerializeReadIndex(request);
+    std::vector<char> responseData;
+    if (!Call(serverId, 'R', {{&group, sizeof(group)}, {requestData.data(), requestData.size()}}, responseData)) {
+        return ReadIndexResponse();
     }
-    
-    // 4. 发送请求
-    if (!SendData(sockfd, fullRequestData)) {
-        // 发送失败，标记连接为需要重新连接
-        DKV_LOG_ERROR("发送InstallSnapshot请求到节点 ", serverId, " 失败，关闭连接");
-        CloseConnection(serverId);
-        InstallSnapshotResponse response;
-        response.term = 0;
-        response.success = false;
+    return DeserializeReadIndexResponse(responseData);
+}
+
+// 序列化ReadIndex请求：term followerId
+std::vector<char> RaftTcpNetwork::SerializeReadIndex(const ReadIndexRequest& request) {
+    std::vector<char> data;
+    uint32_t term = htonl(request.term);
+    data.insert(data.end(), (char*)&term, (char*)&term + sizeof(term));
+    uint32_t followerId = htonl(request.followerId);
+    data.insert(data.end(), (char*)&followerId, (char*)&followerId + sizeof(followerId));
+    return data;
+}
+
+// 反序列化ReadIndex请求
+ReadIndexRequest RaftTcpNetwork::DeserializeReadIndex(const std::vector<char>& data) {
+    ReadIndexRequest request{0, -1};
+    if (data.size() < 8) { // 2个uint32_t字段
+        return request;
+    }
+    uint32_t term = 0;
+    memcpy(&term, data.data(), sizeof(term));
+    request.term = ntohl(term);
+    uint32_t followerId = 0;
+    memcpy(&followerId, data.data() + sizeof(term), sizeof(followerId));
+    request.followerId = ntohl(followerId);
+    return request;
+}
+
+// 序列化ReadIndex响应：term success readIndex
+std::vector<char> RaftTcpNetwork::SerializeReadIndexResponse(const ReadIndexResponse& response) {
+    std::vector<char> data;
+    uint32_t term = htonl(response.term);
+    data.insert(data.end(), (char*)&term, (char*)&term + sizeof(term));
+    uint32_t success = htonl(response.success ? 1 : 0);
+    data.insert(data.end(), (char*)&success, (char*)&success + sizeof(success));
+    uint32_t readIndex = htonl(response.readIndex);
+    data.insert(data.end(), (char*)&readIndex, (char*)&readIndex + sizeof(readIndex));
+    return data;
+}
+
+// 反序列化ReadIndex响应
+ReadIndexResponse RaftTcpNetwork::DeserializeReadIndexResponse(const std::vector<char>& data) {
+    ReadIndexResponse response;
+    if (data.size() < 12) { // 3个uint32_t字段
         return response;
     }
+    uint32_t term = 0;
+    memcpy(&term, data.data(), sizeof(term));
+    response.term = ntohl(term);
+    uint32_t success = 0;
+    memcpy(&success, data.data() + 4, sizeof(success));
+    response.success = (ntohl(success) != 0);
+    uint32_t readIndex = 0;
+    memcpy(&readIndex, data.data() + 8, sizeof(readIndex));
+    response.readIndex = ntohl(readIndex);
+    return response;
+}
+
+// 发送InstallSnapshot请求
+InstallSnapshotResponse RaftTcpNetwork::SendInstallSnapshot(int serverId, const InstallSnapshotRequest& request) {
+    return SendInstallSnapshot(0, serverId, request);
+}
+
+InstallSnapshotResponse RaftTcpNetwork::SendInstallSnapshot(uint32_t groupId, int serverId, const InstallSnapshotRequest& request) {
+    DKV_LOG_INFO("发送InstallSnapshot请求到节点 ", serverId, "，Raft组 ", groupId);
     
-    // 5. 接收响应
-    std::vector<char> responseData = ReceiveData(sockfd);
-    if (responseData.empty()) {
-        // 接收失败，标记连接为需要重新连接
-        DKV_LOG_ERROR("接收InstallSnapshot响应失败，关闭连接");
-        CloseConnection(serverId);
-        InstallSnapshotResponse response;
-        response.term = 0;
-        response.success = false;
+    uint32_t group = htonl(groupId);
+    std::vector<char> requestData = SerializeInstallSnapshot(request);
+    InstallSnapshotResponse response;
+    response.term = 0;
+    response.success = false;
+    std::vector<char> responseData;
+    if (!Call(serverId, 'S', {{&group, sizeof(group)}, {requestData.data(), requestData.size()}}, responseData)) {
         return response;
     }
-    
-    // 6. 反序列化响应
-    InstallSnapshotResponse response = DeserializeInstallSnapshotResponse(responseData);
+    response = DeserializeInstallSnapshotResponse(responseData);
     
     DKV_LOG_INFO("收到InstallSnapshot响应，节点 ", serverId, "，结果 ", response.success);
     
@@ -1176,6 +1518,12 @@ std::vector<char> RaftTcpNetwork::SerializeInstallSnapshot(const InstallSnapshot
     uint32_t leaderCommit = htonl(request.leaderCommit);
     data.insert(data.end(), (char*)&leaderCommit, (char*)&leaderCommit + sizeof(leaderCommit));
     
+    // 数据块偏移和done标志
+    uint64_t chunkOffset = htobe64(request.offset);
+    data.insert(data.end(), (char*)&chunkOffset, (char*)&chunkOffset + sizeof(chunkOffset));
+    uint32_t done = htonl(request.done ? 1 : 0);
+    data.insert(data.end(), (char*)&done, (char*)&done + sizeof(done));
+    
     // 序列化快照数据
     uint32_t snapshotSize = htonl(request.snapshot.size());
     data.insert(data.end(), (char*)&snapshotSize, (char*)&snapshotSize + sizeof(snapshotSize));
@@ -1206,6 +1554,13 @@ InstallSnapshotResponse RaftTcpNetwork::DeserializeInstallSnapshotResponse(const
     response.success = (success != 0);
     offset += sizeof(success);
     
+    // 反序列化nextOffset
+    if (data.size() >= offset + sizeof(uint64_t)) {
+        uint64_t nextOffset = 0;
+        memcpy(&nextOffset, data.data() + offset, sizeof(nextOffset));
+        response.nextOffset = be64toh(nextOffset);
+    }
+    
     return response;
 }
 
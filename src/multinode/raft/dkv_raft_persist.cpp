@@ -1,44 +1,74 @@
 #include "multinode/raft/dkv_raft_persist.hpp"
+#include "multinode/raft/dkv_raft_log_codec.hpp"
+#include "persist/dkv_mapped_file.hpp"
 #include "dkv_logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace dkv {
 
+namespace {
+
+// 日志段以魔数开头，之后是连续的记录，记录格式见dkv_raft_log_codec.hpp
+const std::string LOG_SEGMENT_PREFIX = "raft_log.";
+constexpr char LOG_SEGMENT_MAGIC[] = "DKVRLOG1";
+constexpr size_t LOG_SEGMENT_MAGIC_SIZE = sizeof(LOG_SEGMENT_MAGIC) - 1;
+
+bool writeAll(int fd, const char* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = ::write(fd, data + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void syncDirectory(const std::string& dir) {
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+} // namespace
+
 // RAFT文件持久化构造函数
-RaftFilePersister::RaftFilePersister(const std::string& dir) : dir_(dir) {
+RaftFilePersister::RaftFilePersister(const std::string& dir)
+    : dir_(dir), logFd_(-1), logLoaded_(false), logDirty_(false), dirDirty_(false), compactIndex_(0), nextSeq_(1) {
     // 初始化文件路径
     stateFilePath_ = dir_ + "/raft_state.txt";
-    logFilePath_ = dir_ + "/raft_log.txt";
+    legacyLogFilePath_ = dir_ + "/raft_log.txt";
+    logMetaFilePath_ = dir_ + "/raft_log_meta.txt";
     snapshotFilePath_ = dir_ + "/raft_snapshot.bin";
 }
 
-// 保存状态
-void RaftFilePersister::SaveState(int term, int votedFor) {
+RaftFilePersister::~RaftFilePersister() {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::ofstream file(stateFilePath_);
-    if (file.is_open()) {
-        file << term << " " << votedFor << std::endl;
-        file.close();
+    syncLocked();
+    if (logFd_ >= 0) {
+        ::close(logFd_);
     }
 }
 
-// 保存日志
-void RaftFilePersister::SaveLog(const std::vector<RaftLogEntry>& log) {
+// 保存状态
+void RaftFilePersister::SaveState(int term, int votedFor) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    std::ofstream file(logFilePath_);
+    std::ofstream file(stateFilePath_);
     if (file.is_open()) {
-        for (const auto& entry : log) {
-            if (!entry.command) {
-                continue;
-            }
-            // 保存索引、任期、命令
-            file << entry.index << " " << entry.term << " " << entry.command->tx_id;
-            entry.command->db_command.write(file);
-            file << std::endl;
-        }
+        file << term << " " << votedFor << std::endl;
         file.close();
     }
 }
@@ -86,33 +116,406 @@ int RaftFilePersister::ReadVotedFor() {
     return -1;
 }
 
-// 读取日志
-std::vector<RaftLogEntry> RaftFilePersister::ReadLog() {
+// 追加日志条目，只写入不刷盘
+void RaftFilePersister::AppendLog(const std::vector<RaftLogEntry>& entries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensureLogLoaded();
+    appendLocked(entries);
+}
+
+// 删除索引>=index的日志条目：整段删除之后的段，所在段截断到该条记录之前
+void RaftFilePersister::TruncateLogSuffix(int index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensureLogLoaded();
+    std::error_code ec;
+    while (!segments_.empty()) {
+        LogSegment& seg = segments_.back();
+        const std::string path = segmentPath(seg.seq);
+        if (seg.firstIndex >= index || (seg.lastIndex == 0 && segments_.size() > 1)) {
+            if (logFd_ >= 0) {
+                ::close(logFd_);
+                logFd_ = -1;
+            }
+            std::filesystem::remove(path, ec);
+            segments_.pop_back();
+            dirDirty_ = true;
+            continue;
+        }
+        if (seg.lastIndex < index) {
+            break;
+        }
+        // 重新扫描该段，找到第一条索引>=index的记录
+        uint64_t offset = seg.size;
+        int lastIndex = 0;
+        MappedFile file;
+        if (file.open(path)) {
+            ByteReader reader(file.view().substr(0, seg.size));
+            reader.seek(LOG_SEGMENT_MAGIC_SIZE);
+            RaftLogEntry entry;
+            while (reader.remaining() > 0) {
+                const size_t recordStart = reader.position();
+                if (!ReadRaftLogRecord(reader, entry)) {
+                    break;
+                }
+                if (entry.index >= index) {
+                    offset = recordStart;
+                    break;
+                }
+                lastIndex = entry.index;
+            }
+        }
+        file.close();
+        if (::truncate(path.c_str(), static_cast<off_t>(offset)) != 0) {
+            DKV_LOG_ERRORF("截断Raft日志段 {} 失败: {}", path, std::strerror(errno));
+            break;
+        }
+        seg.size = offset;
+        seg.lastIndex = lastIndex;
+        if (lastIndex == 0) {
+            seg.firstIndex = 0;
+        }
+        logDirty_ = true;
+        break;
+    }
+    if (logFd_ < 0) {
+        reopenLastSegment();
+    }
+}
+
+// 删除索引<=index的日志条目：先持久化压缩点，再整段删除不含更新条目的段
+void RaftFilePersister::CompactLog(int index) {
     std::lock_guard<std::mutex> lock(mutex_);
+    ensureLogLoaded();
+    if (index <= compactIndex_) {
+        return;
+    }
+    if (!writeCompactIndex(index)) {
+        return;
+    }
+    compactIndex_ = index;
+    std::error_code ec;
+    while (!segments_.empty() && segments_.front().lastIndex <= index) {
+        if (segments_.size() == 1 && logFd_ >= 0) {
+            ::close(logFd_);
+            logFd_ = -1;
+        }
+        std::filesystem::remove(segmentPath(segments_.front().seq), ec);
+        segments_.erase(segments_.begin());
+        dirDirty_ = true;
+    }
+}
+
+// 刷盘已追加的日志。fdatasync在复制的描述符上进行，期间不持有锁，新的追加不必等待刷盘；
+// 期间换段时旧段在关闭前已经刷盘，之后的追加留给下一次SyncLog
+void RaftFilePersister::SyncLog() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (dirDirty_) {
+        syncDirectory(dir_);
+        dirDirty_ = false;
+    }
+    if (!logDirty_ || logFd_ < 0) {
+        return;
+    }
+    int fd = ::dup(logFd_);
+    if (fd < 0) {
+        syncLocked();
+        return;
+    }
+    logDirty_ = false;
+    lock.unlock();
+    bool ok = ::fdatasync(fd) == 0;
+    if (!ok) {
+        DKV_LOG_ERRORF("刷盘Raft日志段失败: {}", std::strerror(errno));
+    }
+    ::close(fd);
+    if (!ok) {
+        lock.lock();
+        logDirty_ = true;
+    }
+}
+
+// 回放日志
+int RaftFilePersister::ReplayLog(const std::function<void(RaftLogEntry&&)>& fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loadSegments(&fn);
+    if (segments_.empty()) {
+        migrateLegacyLog(&fn);
+    }
+    return compactIndex_;
+}
+
+std::string RaftFilePersister::segmentPath(uint64_t seq) const {
+    return dir_ + "/" + LOG_SEGMENT_PREFIX + std::to_string(seq);
+}
+
+void RaftFilePersister::ensureLogLoaded() {
+    if (logLoaded_) {
+        return;
+    }
+    loadSegments(nullptr);
+    if (segments_.empty()) {
+        migrateLegacyLog(nullptr);
+    }
+}
+
+void RaftFilePersister::loadSegments(const std::function<void(RaftLogEntry&&)>* fn) {
+    if (logFd_ >= 0) {
+        ::close(logFd_);
+        logFd_ = -1;
+    }
+    segments_.clear();
+    logLoaded_ = true;
+    compactIndex_ = readCompactIndex();
     
-    std::vector<RaftLogEntry> log;
-    std::ifstream file(logFilePath_);
+    std::vector<uint64_t> seqs;
+    std::error_code ec;
+    for (const auto& file : std::filesystem::directory_iterator(dir_, ec)) {
+        const std::string name = file.path().filename().string();
+        if (name.compare(0, LOG_SEGMENT_PREFIX.size(), LOG_SEGMENT_PREFIX) != 0) {
+            continue;
+        }
+        const std::string suffix = name.substr(LOG_SEGMENT_PREFIX.size());
+        if (suffix.empty() || suffix.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        seqs.push_back(std::stoull(suffix));
+    }
+    std::sort(seqs.begin(), seqs.end());
+    nextSeq_ = seqs.empty() ? 1 : seqs.back() + 1;
     
-    if (file.is_open()) {
-        std::string line;
-        while (getline(file, line)) {
-            std::istringstream iss(line);
-            int index, term;
-            TransactionID txId = 0;
-            if (iss >> index >> term >> txId) {
+    bool corrupted = false;
+    for (uint64_t seq : seqs) {
+        const std::string path = segmentPath(seq);
+        if (corrupted) {
+            // 损坏位置之后的段与前面不再连续，一并删除
+            DKV_LOG_WARNINGF("删除损坏位置之后的Raft日志段 {}", path);
+            std::filesystem::remove(path, ec);
+            dirDirty_ = true;
+            continue;
+        }
+        LogSegment seg;
+        seg.seq = seq;
+        MappedFile file;
+        if (!file.open(path)) {
+            DKV_LOG_ERRORF("打开Raft日志段 {} 失败", path);
+            corrupted = true;
+            continue;
+        }
+        const size_t fileSize = file.size();
+        if (file.view().substr(0, LOG_SEGMENT_MAGIC_SIZE) == std::string_view(LOG_SEGMENT_MAGIC, LOG_SEGMENT_MAGIC_SIZE)) {
+            ByteReader reader(file.view());
+            reader.seek(LOG_SEGMENT_MAGIC_SIZE);
+            file.prefetch(0, fileSize);
+            seg.size = LOG_SEGMENT_MAGIC_SIZE;
+            while (reader.remaining() > 0) {
                 RaftLogEntry entry;
-                entry.index = index;
-                entry.term = term;
-                entry.command = std::make_shared<RaftCommand>(txId, Command());
-                entry.command->db_command.read(iss);
-                
-                log.push_back(entry);
+                // 回放的条目保留记录字节，之后发送给跟随者时不再编码
+                if (!ReadRaftLogRecord(reader, entry, fn != nullptr)) {
+                    corrupted = true;
+                    break;
+                }
+                seg.size = reader.position();
+                if (seg.firstIndex == 0) {
+                    seg.firstIndex = entry.index;
+                }
+                seg.lastIndex = entry.index;
+                if (fn && entry.index > compactIndex_) {
+                    (*fn)(std::move(entry));
+                }
             }
+        } else {
+            corrupted = true;
         }
         file.close();
+        
+        if (seg.size < fileSize) {
+            // 崩溃时未写完的尾部记录，截断后从这里继续追加
+            DKV_LOG_WARNINGF("Raft日志段 {} 在偏移 {} 处不完整或校验失败，截断 {} 字节", path, seg.size, fileSize - seg.size);
+            if (seg.size == 0) {
+                std::filesystem::remove(path, ec);
+                dirDirty_ = true;
+                continue;
+            }
+            if (::truncate(path.c_str(), static_cast<off_t>(seg.size)) != 0) {
+                DKV_LOG_ERRORF("截断Raft日志段 {} 失败: {}", path, std::strerror(errno));
+            }
+            logDirty_ = true;
+        }
+        segments_.push_back(seg);
+    }
+    reopenLastSegment();
+}
+
+void RaftFilePersister::migrateLegacyLog(const std::function<void(RaftLogEntry&&)>* fn) {
+    std::ifstream file(legacyLogFilePath_);
+    if (!file.is_open()) {
+        return;
+    }
+    std::vector<RaftLogEntry> log;
+    std::string line;
+    while (getline(file, line)) {
+        std::istringstream iss(line);
+        int index, term;
+        TransactionID txId = 0;
+        if (iss >> index >> term >> txId) {
+            RaftLogEntry entry;
+            entry.index = index;
+            entry.term = term;
+            entry.command = std::make_shared<RaftCommand>(txId, Command());
+            entry.command->db_command.read(iss);
+            log.push_back(entry);
+        }
+    }
+    file.close();
+    
+    appendLocked(log);
+    syncLocked();
+    if (!log.empty() && logFd_ < 0) {
+        // 转换失败时保留旧文件，下次启动重试
+        return;
+    }
+    DKV_LOG_INFOF("已把旧版Raft日志 {} 转换为日志段，共 {} 条", legacyLogFilePath_, log.size());
+    std::error_code ec;
+    std::filesystem::remove(legacyLogFilePath_, ec);
+    if (fn) {
+        for (auto& entry : log) {
+            if (entry.index > compactIndex_) {
+                (*fn)(std::move(entry));
+            }
+        }
+    }
+}
+
+bool RaftFilePersister::prepareSegment(size_t appendSize) {
+    if (logFd_ >= 0) {
+        const LogSegment& seg = segments_.back();
+        if (seg.lastIndex == 0 || seg.size + appendSize <= LOG_SEGMENT_SIZE) {
+            return true;
+        }
+        // 切换前刷盘旧段，之后的SyncLog只需同步当前段
+        if (logDirty_ && ::fdatasync(logFd_) != 0) {
+            DKV_LOG_ERRORF("刷盘Raft日志段失败: {}", std::strerror(errno));
+        }
+        ::close(logFd_);
+        logFd_ = -1;
     }
     
-    return log;
+    LogSegment seg;
+    seg.seq = nextSeq_++;
+    const std::string path = segmentPath(seg.seq);
+    logFd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (logFd_ < 0) {
+        DKV_LOG_ERRORF("创建Raft日志段 {} 失败: {}", path, std::strerror(errno));
+        return false;
+    }
+    if (!writeAll(logFd_, LOG_SEGMENT_MAGIC, LOG_SEGMENT_MAGIC_SIZE)) {
+        DKV_LOG_ERRORF("写入Raft日志段 {} 失败: {}", path, std::strerror(errno));
+        ::close(logFd_);
+        logFd_ = -1;
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        return false;
+    }
+    seg.size = LOG_SEGMENT_MAGIC_SIZE;
+    segments_.push_back(seg);
+    logDirty_ = true;
+    dirDirty_ = true;
+    return true;
+}
+
+void RaftFilePersister::reopenLastSegment() {
+    if (logFd_ >= 0) {
+        ::close(logFd_);
+        logFd_ = -1;
+    }
+    if (segments_.empty()) {
+        return;
+    }
+    const std::string path = segmentPath(segments_.back().seq);
+    logFd_ = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (logFd_ < 0) {
+        DKV_LOG_ERRORF("打开Raft日志段 {} 失败: {}", path, std::strerror(errno));
+    }
+}
+
+void RaftFilePersister::appendLocked(const std::vector<RaftLogEntry>& entries) {
+    std::string buffer;
+    int firstIndex = 0;
+    int lastIndex = 0;
+    for (const auto& entry : entries) {
+        if (!entry.command) {
+            continue;
+        }
+        if (entry.record) {
+            buffer.append(*entry.record);
+        } else {
+            EncodeRaftLogRecord(buffer, entry);
+        }
+        if (firstIndex == 0) {
+            firstIndex = entry.index;
+        }
+        lastIndex = entry.index;
+    }
+    if (buffer.empty() || !prepareSegment(buffer.size())) {
+        return;
+    }
+    LogSegment& seg = segments_.back();
+    if (!writeAll(logFd_, buffer.data(), buffer.size())) {
+        DKV_LOG_ERRORF("写入Raft日志段 {} 失败: {}", segmentPath(seg.seq), std::strerror(errno));
+        // 去掉写了一半的记录，避免之后的追加接在损坏数据后面
+        if (::ftruncate(logFd_, static_cast<off_t>(seg.size)) != 0) {
+            DKV_LOG_ERRORF("截断Raft日志段 {} 失败: {}", segmentPath(seg.seq), std::strerror(errno));
+        }
+        return;
+    }
+    seg.size += buffer.size();
+    if (seg.firstIndex == 0) {
+        seg.firstIndex = firstIndex;
+    }
+    seg.lastIndex = lastIndex;
+    logDirty_ = true;
+}
+
+void RaftFilePersister::syncLocked() {
+    if (logDirty_ && logFd_ >= 0) {
+        if (::fdatasync(logFd_) != 0) {
+            DKV_LOG_ERRORF("刷盘Raft日志段失败: {}", std::strerror(errno));
+        } else {
+            logDirty_ = false;
+        }
+    }
+    if (dirDirty_) {
+        syncDirectory(dir_);
+        dirDirty_ = false;
+    }
+}
+
+int RaftFilePersister::readCompactIndex() const {
+    std::ifstream file(logMetaFilePath_);
+    int index = 0;
+    if (file.is_open() && file >> index) {
+        return index;
+    }
+    return 0;
+}
+
+// 写入临时文件、fsync后rename替换，再同步目录，保证删除旧段之前压缩点已经落盘
+bool RaftFilePersister::writeCompactIndex(int index) const {
+    const std::string tmpPath = logMetaFilePath_ + ".tmp";
+    const std::string content = std::to_string(index) + "\n";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        DKV_LOG_ERRORF("写入Raft日志压缩点失败: {}", std::strerror(errno));
+        return false;
+    }
+    const bool ok = writeAll(fd, content.data(), content.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmpPath.c_str(), logMetaFilePath_.c_str()) != 0) {
+        DKV_LOG_ERRORF("写入Raft日志压缩点失败: {}", std::strerror(errno));
+        return false;
+    }
+    syncDirectory(dir_);
+    return true;
 }
 
 // 读取快照
@@ -135,4 +538,25 @@ std::vector<char> RaftFilePersister::ReadSnapshot() {
     return snapshot;
 }
 
+std::vector<char> RaftFilePersister::ReadSnapshotChunk(uint64_t offset, size_t length, uint64_t& total) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    std::vector<char> chunk;
+    total = 0;
+    std::ifstream file(snapshotFilePath_, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return chunk;
+    }
+    total = static_cast<uint64_t>(file.tellg());
+    if (offset >= total) {
+        return chunk;
+    }
+    chunk.resize(static_cast<size_t>(std::min<uint64_t>(length, total - offset)));
+    file.seekg(static_cast<std::streamoff>(offset));
+    if (!file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()))) {
+        chunk.clear();
+    }
+    return chunk;
+}
+
 } // namespace dkv
@@ -3,28 +3,63 @@
 #include "net/dkv_resp.hpp"
 #include "dkv_logger.hpp"
 #include "dkv_server.hpp"
-#include <fstream>
-#include <sstream>
+#include <ostream>
+#include <streambuf>
 #include <string>
-#include <cstdio>
+#include <string_view>
 
 namespace dkv {
 
+namespace {
+
+// 追加写入std::vector<char>的输出流缓冲区
+class VectorStreamBuf : public std::streambuf {
+public:
+    explicit VectorStreamBuf(std::vector<char>& out) : out_(out) {}
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            out_.push_back(traits_type::to_char_type(ch));
+        }
+        return traits_type::not_eof(ch);
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        out_.insert(out_.end(), s, s + n);
+        return n;
+    }
+
+private:
+    std::vector<char>& out_;
+};
+
+} // namespace
+
 RaftStateMachineManager::RaftStateMachineManager()
     : commandHandler_(nullptr), storageEngine_(nullptr), dkvServer_(nullptr) {
 }
 
+RaftStateMachineManager::~RaftStateMachineManager() {
+    StopWorkers();
+}
+
 Response RaftStateMachineManager::DoOp(const RaftCommand& raft_cmd) {
     std::lock_guard<std::mutex> lock(mutex_);
-    
+    return Apply(raft_cmd);
+}
+
+Response RaftStateMachineManager::Apply(const RaftCommand& raft_cmd) {
     if (!dkvServer_) {
         DKV_LOG_ERROR("DKVServer未初始化");
         return Response(ResponseStatus::ERROR, "DKVServer not initialized");
     }
     
     try {
-        // 调用DKVServer::executeCommand执行命令
-        Response response = dkvServer_->doCommandNative(raft_cmd.db_command, raft_cmd.tx_id);
+        // 设置了命令处理器和存储引擎时应用到它们上（分片各自的存储引擎），否则应用到服务器的存储引擎
+        Response response = commandHandler_ && storageEngine_
+            ? dkvServer_->doCommandNative(storageEngine_, static_cast<CommandHandler*>(commandHandler_),
+                                          raft_cmd.db_command, raft_cmd.tx_id)
+            : dkvServer_->doCommandNative(raft_cmd.db_command, raft_cmd.tx_id);
         
         DKV_LOG_DEBUGF("执行RAFT命令成功，命令类型: {}, 响应状态: {}", 
                      static_cast<int>(raft_cmd.db_command.type), static_cast<int>(response.status));
@@ -38,6 +73,143 @@ Response RaftStateMachineManager::DoOp(const RaftCommand& raft_cmd) {
     }
 }
 
+void RaftStateMachineManager::DoOps(const std::vector<const RaftCommand*>& commands, std::vector<Response>& results) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    results.assign(commands.size(), Response());
+    if (workers_.size() < 2) {
+        for (size_t i = 0; i < commands.size(); ++i) {
+            results[i] = Apply(*commands[i]);
+        }
+        return;
+    }
+    
+    // 把相邻的可并行命令按键分给各线程，遇到屏障时先执行完之前的一段
+    size_t assigned = 0;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        int worker = WorkerOf(*commands[i]);
+        if (worker >= 0) {
+            workers_[worker]->entries.push_back(i);
+            ++assigned;
+            continue;
+        }
+        if (assigned > 0) {
+            RunSegment(commands, results);
+            assigned = 0;
+        }
+        results[i] = Apply(*commands[i]);
+    }
+    if (assigned > 0) {
+        RunSegment(commands, results);
+    }
+}
+
+int RaftStateMachineManager::WorkerOf(const RaftCommand& command) const {
+    if (command.tx_id != NO_TX) {
+        return -1;
+    }
+    std::vector<Key> keys = command.db_command.keys();
+    if (keys.empty()) {
+        return -1;
+    }
+    std::hash<Key> hasher;
+    size_t worker = hasher(keys[0]) % workers_.size();
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (hasher(keys[i]) % workers_.size() != worker) {
+            return -1;
+        }
+    }
+    return static_cast<int>(worker);
+}
+
+void RaftStateMachineManager::RunSegment(const std::vector<const RaftCommand*>& commands,
+                                         std::vector<Response>& results) {
+    // 只有一个线程分到命令时直接在调用线程上执行，省去线程切换
+    size_t busy = 0;
+    ApplyWorker* only = nullptr;
+    for (auto& worker : workers_) {
+        if (!worker->entries.empty()) {
+            ++busy;
+            only = worker.get();
+        }
+    }
+    if (busy == 1) {
+        for (size_t index : only->entries) {
+            results[index] = Apply(*commands[index]);
+        }
+        only->entries.clear();
+        return;
+    }
+    
+    std::unique_lock<std::mutex> pool_lock(pool_mutex_);
+    segment_commands_ = &commands;
+    segment_results_ = &results;
+    running_workers_ = workers_.size();
+    ++segment_;
+    pool_cond_.notify_all();
+    segment_done_cond_.wait(pool_lock, [this]() { return running_workers_ == 0; });
+    segment_commands_ = nullptr;
+    segment_results_ = nullptr;
+}
+
+void RaftStateMachineManager::WorkerLoop(size_t index) {
+    ApplyWorker& worker = *workers_[index];
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> pool_lock(pool_mutex_);
+    while (true) {
+        pool_cond_.wait(pool_lock, [this, seen]() { return stopping_ || segment_ != seen; });
+        if (stopping_) {
+            return;
+        }
+        seen = segment_;
+        const std::vector<const RaftCommand*>& commands = *segment_commands_;
+        std::vector<Response>& results = *segment_results_;
+        pool_lock.unlock();
+        
+        // 各线程只写自己分到的结果下标，调用线程持有mutex_等待本段完成
+        for (size_t entry : worker.entries) {
+            results[entry] = Apply(*commands[entry]);
+        }
+        worker.entries.clear();
+        
+        pool_lock.lock();
+        if (--running_workers_ == 0) {
+            segment_done_cond_.notify_one();
+        }
+    }
+}
+
+void RaftStateMachineManager::SetApplyWorkers(size_t workers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StopWorkers();
+    if (workers < 2) {
+        return;
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<ApplyWorker>());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_[i]->thread = std::thread([this, i]() { WorkerLoop(i); });
+    }
+    DKV_LOG_INFO("Raft并行应用线程数: ", workers);
+}
+
+void RaftStateMachineManager::StopWorkers() {
+    {
+        std::lock_guard<std::mutex> pool_lock(pool_mutex_);
+        stopping_ = true;
+    }
+    pool_cond_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    workers_.clear();
+    std::lock_guard<std::mutex> pool_lock(pool_mutex_);
+    stopping_ = false;
+    segment_ = 0;
+}
+
 void RaftStateMachineManager::SetDKVServer(DKVServer* server) {
     std::lock_guard<std::mutex> lock(mutex_);
     dkvServer_ = server;
@@ -53,32 +225,13 @@ std::vector<char> RaftStateMachineManager::Snapshot() {
     }
     
     try {
-        // 使用临时文件保存快照
-        std::string temp_snapshot_file = "./temp_raft_snapshot.rdb";
-        
-        // 保存RDB快照
-        if (storageEngine_->saveRDB(temp_snapshot_file)) {
-            // 读取快照文件内容
-            std::ifstream file(temp_snapshot_file, std::ios::binary | std::ios::ate);
-            if (file.is_open()) {
-                std::streamsize size = file.tellg();
-                file.seekg(0, std::ios::beg);
-                
-                std::vector<char> buffer(size);
-                if (file.read(buffer.data(), size)) {
-                    file.close();
-                    
-                    // 删除临时文件
-                    std::remove(temp_snapshot_file.c_str());
-                    
-                    DKV_LOG_INFO("创建快照成功，快照大小: ", buffer.size());
-                    return buffer;
-                }
-                file.close();
-            }
-            
-            // 删除临时文件
-            std::remove(temp_snapshot_file.c_str());
+        // RDB数据直接写入内存缓冲区，一次生成，不经过临时文件
+        std::vector<char> buffer;
+        VectorStreamBuf stream_buf(buffer);
+        std::ostream out(&stream_buf);
+        if (storageEngine_->saveRDBToStream(out)) {
+            DKV_LOG_INFO("创建快照成功，快照大小: ", buffer.size());
+            return buffer;
         }
         
         DKV_LOG_ERROR("创建快照失败");
@@ -89,6 +242,32 @@ std::vector<char> RaftStateMachineManager::Snapshot() {
     }
 }
 
+std::function<std::vector<char>()> RaftStateMachineManager::BeginSnapshot() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (!storageEngine_) {
+        DKV_LOG_ERROR("StorageEngine未初始化");
+        return nullptr;
+    }
+    // 持有mutex_时没有命令在执行，快照内容与已应用的日志一致
+    if (!storageEngine_->beginSnapshot()) {
+        DKV_LOG_WARNING("已有快照在保存，跳过本次快照");
+        return nullptr;
+    }
+    StorageEngine* storage = storageEngine_;
+    return [storage]() {
+        std::vector<char> buffer;
+        VectorStreamBuf stream_buf(buffer);
+        std::ostream out(&stream_buf);
+        if (!storage->saveSnapshot(out)) {
+            DKV_LOG_ERROR("创建快照失败");
+            return std::vector<char>();
+        }
+        DKV_LOG_INFO("创建快照成功，快照大小: ", buffer.size());
+        return buffer;
+    };
+}
+
 void RaftStateMachineManager::Restore(const std::vector<char>& snapshot) {
     std::lock_guard<std::mutex> lock(mutex_);
     
@@ -105,30 +284,11 @@ void RaftStateMachineManager::Restore(const std::vector<char>& snapshot) {
         
         DKV_LOG_INFO("从快照恢复，快照大小: ", snapshot.size());
         
-        // 1. 写入临时文件
-        std::string temp_snapshot_file = "./temp_raft_restore.rdb";
-        std::ofstream file(temp_snapshot_file, std::ios::binary);
-        if (!file.is_open()) {
-            DKV_LOG_ERROR("创建临时快照文件失败: ", temp_snapshot_file);
-            return;
-        }
-        
-        if (file.write(snapshot.data(), snapshot.size())) {
-            file.close();
-            
-            // 2. 从临时文件恢复数据
-            if (storageEngine_->loadRDB(temp_snapshot_file)) {
-                DKV_LOG_INFO("从快照恢复成功");
-            } else {
-                DKV_LOG_ERROR("从快照文件恢复失败: ", temp_snapshot_file);
-            }
-            
-            // 3. 删除临时文件
-            std::remove(temp_snapshot_file.c_str());
+        // 直接从快照缓冲区解析
+        if (storageEngine_->loadRDBFromMemory(std::string_view(snapshot.data(), snapshot.size()))) {
+            DKV_LOG_INFO("从快照恢复成功");
         } else {
-            file.close();
-            DKV_LOG_ERROR("写入临时快照文件失败: ", temp_snapshot_file);
-            std::remove(temp_snapshot_file.c_str());
+            DKV_LOG_ERROR("从快照数据恢复失败");
         }
     } catch (const std::exception& e) {
         DKV_LOG_ERROR("从快照恢复失败: ", e.what());
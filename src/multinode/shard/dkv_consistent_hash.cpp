@@ -1,86 +1,116 @@
 #include "multinode/shard/dkv_consistent_hash.hpp"
 #include <algorithm>
+#include <array>
 #include <cstring>
 #include <stdexcept>
 
 namespace dkv {
 
-// CRC32哈希函数实现
-std::string CRC32Hash(const std::string& key) {
-    unsigned int crc = 0xFFFFFFFF;
-    for (unsigned char c : key) {
-        crc ^= c;
-        for (int i = 0; i < 8; i++) {
+namespace {
+
+// CRC32查找表，按字节计算
+const std::array<uint32_t, 256> CRC32_TABLE = []() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++) {
             crc = (crc >> 1) ^ (0xEDB88320 * (crc & 1));
         }
+        table[i] = crc;
     }
-    crc ^= 0xFFFFFFFF;
-    
-    char buf[9];
-    snprintf(buf, sizeof(buf), "%08x", crc);
-    return std::string(buf);
+    return table;
+}();
+
+inline uint64_t Rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
 }
 
-// Murmur3哈希函数实现
-std::string Murmur3Hash(const std::string& key) {
-    uint32_t h = 0x811C9DC5;
-    const uint32_t c1 = 0xCC9E2D51;
-    const uint32_t c2 = 0x1B873593;
-    const uint32_t r1 = 15;
-    const uint32_t r2 = 13;
-    const uint32_t m = 5;
-    const uint32_t n = 0xE6546B64;
-    
-    size_t len = key.length();
-    const uint8_t* data = reinterpret_cast<const uint8_t*>(key.c_str());
-    size_t i = 0;
-    
-    while (len >= 4) {
-        uint32_t k = *(uint32_t*)(data + i);
-        k *= c1;
-        k = (k << r1) | (k >> (32 - r1));
-        k *= c2;
-        h ^= k;
-        h = (h << r2) | (h >> (32 - r2));
-        h = h * m + n;
-        i += 4;
-        len -= 4;
+inline uint64_t Fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDULL;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+} // namespace
+
+// CRC32哈希函数实现
+uint64_t CRC32Hash(std::string_view key) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (unsigned char c : key) {
+        crc = (crc >> 8) ^ CRC32_TABLE[(crc ^ c) & 0xFF];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+// Murmur3哈希函数实现：MurmurHash3_x64_128（种子0）的前64位
+uint64_t Murmur3Hash(std::string_view key) {
+    const uint64_t c1 = 0x87C37B91114253D5ULL;
+    const uint64_t c2 = 0x4CF5AD432745937FULL;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(key.data());
+    const size_t len = key.size();
+    const size_t nblocks = len / 16;
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    
+    for (size_t i = 0; i < nblocks; i++) {
+        uint64_t k1;
+        uint64_t k2;
+        memcpy(&k1, data + i * 16, sizeof(k1));
+        memcpy(&k2, data + i * 16 + 8, sizeof(k2));
+        
+        k1 *= c1; k1 = Rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = Rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+        k2 *= c2; k2 = Rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = Rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
     }
     
-    uint32_t k = 0;
-    switch (len) {
-        case 3:
-            k ^= data[i + 2] << 16;
-        case 2:
-            k ^= data[i + 1] << 8;
+    const uint8_t* tail = data + nblocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    switch (len & 15) {
+        case 15: k2 ^= uint64_t(tail[14]) << 48; [[fallthrough]];
+        case 14: k2 ^= uint64_t(tail[13]) << 40; [[fallthrough]];
+        case 13: k2 ^= uint64_t(tail[12]) << 32; [[fallthrough]];
+        case 12: k2 ^= uint64_t(tail[11]) << 24; [[fallthrough]];
+        case 11: k2 ^= uint64_t(tail[10]) << 16; [[fallthrough]];
+        case 10: k2 ^= uint64_t(tail[9]) << 8; [[fallthrough]];
+        case 9:
+            k2 ^= uint64_t(tail[8]);
+            k2 *= c2; k2 = Rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+            [[fallthrough]];
+        case 8: k1 ^= uint64_t(tail[7]) << 56; [[fallthrough]];
+        case 7: k1 ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+        case 6: k1 ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+        case 5: k1 ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+        case 4: k1 ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+        case 3: k1 ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+        case 2: k1 ^= uint64_t(tail[1]) << 8; [[fallthrough]];
         case 1:
-            k ^= data[i];
-            k *= c1;
-            k = (k << r1) | (k >> (32 - r1));
-            k *= c2;
-            h ^= k;
+            k1 ^= uint64_t(tail[0]);
+            k1 *= c1; k1 = Rotl64(k1, 31); k1 *= c2; h1 ^= k1;
     }
     
-    h ^= key.length();
-    h ^= h >> 16;
-    h *= 0x85EBCA6B;
-    h ^= h >> 13;
-    h *= 0xC2B2AE35;
-    h ^= h >> 16;
-    
-    char buf[9];
-    snprintf(buf, sizeof(buf), "%08x", h);
-    return std::string(buf);
+    h1 ^= len;
+    h2 ^= len;
+    h1 += h2;
+    h2 += h1;
+    h1 = Fmix64(h1);
+    h2 = Fmix64(h2);
+    h1 += h2;
+    return h1;
 }
 
 // 模板类构造函数实现
 template <typename NodeType>
 ConsistentHash<NodeType>::ConsistentHash(int num_replicas, HashFunctionType hash_type)
-    : num_replicas_(num_replicas), hash_type_(hash_type) {
+    : num_replicas_(num_replicas), hash_type_(hash_type), hash_func_(Murmur3Hash) {
     SetHashFunctionType(hash_type);
 }
 
-// 设置哈希函数类型
+// 设置哈希函数类型，MD5和SHA1没有实现，使用Murmur3
 template <typename NodeType>
 void ConsistentHash<NodeType>::SetHashFunctionType(HashFunctionType hash_type) {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -99,7 +129,7 @@ void ConsistentHash<NodeType>::SetHashFunctionType(HashFunctionType hash_type) {
     }
     
     // 重新构建哈希环
-    RebuildRing();
+    RebuildRingLocked();
 }
 
 // 设置虚拟节点数量
@@ -109,53 +139,15 @@ void ConsistentHash<NodeType>::SetNumReplicas(int num_replicas) {
     num_replicas_ = num_replicas;
     
     // 重新构建哈希环
-    RebuildRing();
-}
-
-// 计算哈希值
-template <typename NodeType>
-std::string ConsistentHash<NodeType>::Hash(const std::string& key) const {
-    return hash_func_(key);
-}
-
-// 生成虚拟节点
-template <typename NodeType>
-void ConsistentHash<NodeType>::GenerateVirtualNodes(const NodeType& node) {
-    std::vector<std::string> virtual_nodes;
-    for (int i = 0; i < num_replicas_; i++) {
-        std::string hash_key = Hash(std::to_string(i) + ":" + std::to_string(node));
-        virtual_nodes.push_back(hash_key);
-        hash_ring_.emplace_back(hash_key, node);
-    }
-    node_to_virtual_[node] = std::move(virtual_nodes);
-}
-
-// 删除节点的虚拟节点
-template <typename NodeType>
-void ConsistentHash<NodeType>::RemoveVirtualNodes(const NodeType& node) {
-    auto it = node_to_virtual_.find(node);
-    if (it != node_to_virtual_.end()) {
-        const std::vector<std::string>& virtual_nodes = it->second;
-        for (const auto& vn : virtual_nodes) {
-            hash_ring_.erase(
-                std::remove_if(hash_ring_.begin(), hash_ring_.end(),
-                    [&vn](const VirtualNode<NodeType>& vnode) {
-                        return vnode.hash_key == vn;
-                    }),
-                hash_ring_.end());
-        }
-        node_to_virtual_.erase(it);
-    }
+    RebuildRingLocked();
 }
 
 // 添加节点
 template <typename NodeType>
 void ConsistentHash<NodeType>::AddNode(const NodeType& node) {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (node_to_virtual_.find(node) == node_to_virtual_.end()) {
-        GenerateVirtualNodes(node);
-        // 重新排序哈希环
-        std::sort(hash_ring_.begin(), hash_ring_.end());
+    if (nodes_.insert(node).second) {
+        RebuildRingLocked();
     }
 }
 
@@ -163,75 +155,80 @@ void ConsistentHash<NodeType>::AddNode(const NodeType& node) {
 template <typename NodeType>
 void ConsistentHash<NodeType>::RemoveNode(const NodeType& node) {
     std::lock_guard<std::mutex> lock(mutex_);
-    RemoveVirtualNodes(node);
-    // 重新排序哈希环
-    std::sort(hash_ring_.begin(), hash_ring_.end());
+    if (nodes_.erase(node) > 0) {
+        RebuildRingLocked();
+    }
 }
 
-// 获取key对应的节点
+// 获取key对应的节点：在发布的哈希环上二分查找第一个位置大于等于键哈希值的虚拟节点
 template <typename NodeType>
-NodeType ConsistentHash<NodeType>::GetNode(const std::string& key) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+NodeType ConsistentHash<NodeType>::GetNode(std::string_view key) const {
+    std::shared_ptr<const HashRing<NodeType>> ring = std::atomic_load(&ring_);
     
-    if (hash_ring_.empty()) {
+    if (!ring || ring->positions.empty()) {
         throw std::runtime_error("Consistent hash ring is empty");
     }
     
-    std::string hash_key = Hash(key);
-    
-    // 查找第一个大于等于hash_key的虚拟节点
-    auto it = std::lower_bound(hash_ring_.begin(), hash_ring_.end(), VirtualNode<NodeType>(hash_key, 0));
+    const uint64_t hash = ring->hash(key);
+    auto it = std::lower_bound(ring->positions.begin(), ring->positions.end(), hash);
     
-    // 如果没找到，返回第一个节点
-    if (it == hash_ring_.end()) {
-        it = hash_ring_.begin();
+    // 如果没找到，回绕到第一个节点
+    if (it == ring->positions.end()) {
+        it = ring->positions.begin();
     }
     
-    return it->physical_node;
+    return ring->nodes[it - ring->positions.begin()];
 }
 
 // 获取所有节点
 template <typename NodeType>
 std::set<NodeType> ConsistentHash<NodeType>::GetAllNodes() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::set<NodeType> nodes;
-    for (const auto& vn : hash_ring_) {
-        nodes.insert(vn.physical_node);
-    }
-    
-    return nodes;
+    return nodes_;
 }
 
 // 获取虚拟节点数量
 template <typename NodeType>
 int ConsistentHash<NodeType>::GetVirtualNodeCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return static_cast<int>(hash_ring_.size());
+    std::shared_ptr<const HashRing<NodeType>> ring = std::atomic_load(&ring_);
+    return ring ? static_cast<int>(ring->positions.size()) : 0;
 }
 
 // 获取物理节点数量
 template <typename NodeType>
 int ConsistentHash<NodeType>::GetPhysicalNodeCount() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return static_cast<int>(node_to_virtual_.size());
+    return static_cast<int>(nodes_.size());
 }
 
 // 重新计算哈希环
 template <typename NodeType>
 void ConsistentHash<NodeType>::RebuildRing() {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    // 清空哈希环
-    hash_ring_.clear();
-    
-    // 重新生成所有虚拟节点
-    for (const auto& pair : node_to_virtual_) {
-        GenerateVirtualNodes(pair.first);
+    RebuildRingLocked();
+}
+
+// 生成所有虚拟节点，排序后发布新的哈希环
+template <typename NodeType>
+void ConsistentHash<NodeType>::RebuildRingLocked() {
+    std::vector<std::pair<uint64_t, NodeType>> virtual_nodes;
+    virtual_nodes.reserve(nodes_.size() * std::max(num_replicas_, 0));
+    for (const auto& node : nodes_) {
+        for (int i = 0; i < num_replicas_; i++) {
+            virtual_nodes.emplace_back(hash_func_(std::to_string(i) + ":" + std::to_string(node)), node);
+        }
     }
-    
-    // 重新排序哈希环
-    std::sort(hash_ring_.begin(), hash_ring_.end());
+    std::sort(virtual_nodes.begin(), virtual_nodes.end());
+    
+    auto ring = std::make_shared<HashRing<NodeType>>();
+    ring->hash = hash_func_;
+    ring->positions.reserve(virtual_nodes.size());
+    ring->nodes.reserve(virtual_nodes.size());
+    for (const auto& vn : virtual_nodes) {
+        ring->positions.push_back(vn.first);
+        ring->nodes.push_back(vn.second);
+    }
+    std::atomic_store(&ring_, std::shared_ptr<const HashRing<NodeType>>(std::move(ring)));
 }
 
 // 显式实例化，支持int类型的节点
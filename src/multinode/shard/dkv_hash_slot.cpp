@@ -0,0 +1,125 @@
+#include "multinode/shard/dkv_hash_slot.hpp"
+#include <algorithm>
+
+namespace dkv {
+
+namespace {
+
+// CRC16查找表，按字节计算
+const std::array<uint16_t, 256> CRC16_TABLE = []() {
+    std::array<uint16_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint16_t crc = static_cast<uint16_t>(i << 8);
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+} // namespace
+
+uint16_t CRC16(std::string_view data) {
+    uint16_t crc = 0;
+    for (unsigned char c : data) {
+        crc = static_cast<uint16_t>((crc << 8) ^ CRC16_TABLE[((crc >> 8) ^ c) & 0xFF]);
+    }
+    return crc;
+}
+
+int KeyHashSlot(std::string_view key) {
+    size_t open = key.find('{');
+    if (open != std::string_view::npos) {
+        size_t close = key.find('}', open + 1);
+        if (close != std::string_view::npos && close > open + 1) {
+            key = key.substr(open + 1, close - open - 1);
+        }
+    }
+    return CRC16(key) & (HASH_SLOT_COUNT - 1);
+}
+
+SlotTable::SlotTable() {
+    for (int slot = 0; slot < HASH_SLOT_COUNT; slot++) {
+        owners_[slot].store(NO_SHARD, std::memory_order_relaxed);
+        targets_[slot].store(NO_SHARD, std::memory_order_relaxed);
+    }
+}
+
+void SlotTable::AssignRange(int begin, int end, int shard_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int slot = std::max(begin, 0); slot <= end && slot < HASH_SLOT_COUNT; slot++) {
+        targets_[slot].store(NO_SHARD, std::memory_order_release);
+        owners_[slot].store(shard_id, std::memory_order_release);
+    }
+}
+
+void SlotTable::AssignEvenly(const std::vector<int>& shard_ids) {
+    if (shard_ids.empty()) {
+        AssignRange(0, HASH_SLOT_COUNT - 1, NO_SHARD);
+        return;
+    }
+    const int count = static_cast<int>(shard_ids.size());
+    for (int i = 0; i < count; i++) {
+        AssignRange(HASH_SLOT_COUNT * i / count, HASH_SLOT_COUNT * (i + 1) / count - 1, shard_ids[i]);
+    }
+}
+
+bool SlotTable::BeginMigration(int slot, int target_shard_id) {
+    if (slot < 0 || slot >= HASH_SLOT_COUNT || target_shard_id == NO_SHARD) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int owner = owners_[slot].load(std::memory_order_relaxed);
+    if (owner == NO_SHARD || owner == target_shard_id ||
+        targets_[slot].load(std::memory_order_relaxed) != NO_SHARD) {
+        return false;
+    }
+    targets_[slot].store(target_shard_id, std::memory_order_release);
+    return true;
+}
+
+bool SlotTable::CompleteMigration(int slot) {
+    if (slot < 0 || slot >= HASH_SLOT_COUNT) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int target = targets_[slot].load(std::memory_order_relaxed);
+    if (target == NO_SHARD) {
+        return false;
+    }
+    // 先切换负责分片再清除迁移目标，查询线程在任何时刻都能找到键所在的分片
+    owners_[slot].store(target, std::memory_order_release);
+    targets_[slot].store(NO_SHARD, std::memory_order_release);
+    return true;
+}
+
+void SlotTable::CancelMigration(int slot) {
+    if (slot < 0 || slot >= HASH_SLOT_COUNT) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    targets_[slot].store(NO_SHARD, std::memory_order_release);
+}
+
+std::vector<int> SlotTable::SlotsOf(int shard_id) const {
+    std::vector<int> slots;
+    for (int slot = 0; slot < HASH_SLOT_COUNT; slot++) {
+        if (GetOwner(slot) == shard_id) {
+            slots.push_back(slot);
+        }
+    }
+    return slots;
+}
+
+std::vector<int> SlotTable::MigratingSlots() const {
+    std::vector<int> slots;
+    for (int slot = 0; slot < HASH_SLOT_COUNT; slot++) {
+        if (GetMigrationTarget(slot) != NO_SHARD) {
+            slots.push_back(slot);
+        }
+    }
+    return slots;
+}
+
+} // namespace dkv
@@ -4,8 +4,13 @@
 #include "multinode/raft/dkv_raft_network.hpp"
 #include "multinode/raft/dkv_raft_statemachine.hpp"
 #include "dkv_server.hpp"
+#include "dkv_command_handler.hpp"
 #include "dkv_utils.hpp"
+#include "dkv_logger.hpp"
+#include "persist/dkv_rdb.hpp"
 #include <algorithm>
+#include <future>
+#include <map>
 #include <sstream>
 #include <chrono>
 
@@ -21,16 +26,23 @@ uint64_t GetCurrentTimestamp() {
 // Shard类实现
 
 // 构造函数
-Shard::Shard(int shard_id, const std::vector<std::string>& raft_peers, 
-             const std::string& raft_data_dir, int max_raft_state)
+Shard::Shard(int shard_id, std::shared_ptr<RaftTcpNetwork> transport,
+             const std::string& raft_data_dir, int max_raft_state, DKVServer* server)
     : shard_id_(shard_id),
       state_(ShardState::INACTIVE),
-      raft_peers_(raft_peers),
+      raft_transport_(transport),
+      raft_group_id_(static_cast<uint32_t>(shard_id) + 1),
+      raft_peers_(transport->GetPeers()),
       raft_data_dir_(raft_data_dir),
       max_raft_state_(max_raft_state),
       key_count_(0),
       memory_usage_(0),
       operations_per_second_(0),
+      latency_p50_us_(0),
+      latency_p99_us_(0),
+      window_start_(GetCurrentTimestamp()),
+      total_ops_(0),
+      window_ops_(0),
       migration_progress_(0),
       last_heartbeat_(0),
       is_migrating_(false),
@@ -41,22 +53,29 @@ Shard::Shard(int shard_id, const std::vector<std::string>& raft_peers,
     
     // 初始化Raft组件
     raft_persister_ = std::make_shared<RaftFilePersister>(shard_raft_dir);
-    raft_network_ = std::make_shared<RaftTcpNetwork>(shard_id_, raft_peers_);
-    raft_state_machine_ = std::make_shared<RaftStateMachineManager>();
+    raft_network_ = std::make_shared<RaftGroupNetwork>(raft_transport_, raft_group_id_);
+    auto state_machine = std::make_shared<RaftStateMachineManager>();
+    if (server) {
+        storage_engine_ = std::make_unique<StorageEngine>(server->getTransactionIsolationLevel());
+        command_handler_ = std::make_unique<CommandHandler>(storage_engine_.get(), nullptr, false);
+        state_machine->SetCommandHandler(command_handler_.get());
+        state_machine->SetStorageEngine(storage_engine_.get());
+        state_machine->SetDKVServer(server);
+    }
+    raft_state_machine_ = state_machine;
     
-    // 创建Raft实例
-    raft_ = std::make_shared<Raft>(shard_id_, raft_peers_, raft_persister_, raft_network_, raft_state_machine_);
+    // 创建Raft实例；分片空闲时静默，不再发送心跳
+    raft_ = std::make_shared<Raft>(raft_transport_->GetMe(), raft_peers_, raft_persister_, raft_network_, raft_state_machine_);
+    raft_->SetQuiesce(true);
     
-    // 设置Raft实例到网络组件
-    auto tcp_network = std::dynamic_pointer_cast<RaftTcpNetwork>(raft_network_);
-    if (tcp_network) {
-        tcp_network->SetRaft(raft_);
-    }
+    // 注册到共享传输
+    raft_transport_->RegisterGroup(raft_group_id_, raft_);
 }
 
 // 析构函数
 Shard::~Shard() {
     Stop();
+    raft_transport_->UnregisterGroup(raft_group_id_);
 }
 
 // 启动分片
@@ -91,33 +110,45 @@ void Shard::Stop() {
     state_ = ShardState::INACTIVE;
 }
 
-// 执行命令
-Response Shard::ExecuteCommand(const Command& command, TransactionID tx_id) {
+// 异步执行命令
+void Shard::ExecuteCommandAsync(const Command& command, TransactionID tx_id, CommandCallback done) {
     // 检查分片状态
     if (state_ != ShardState::ACTIVE) {
-        return Response(ResponseStatus::ERROR, "Shard is not active");
+        done(Response(ResponseStatus::ERROR, "Shard is not active"));
+        return;
     }
     
-    // 创建Raft命令
-    RaftCommand raft_cmd(tx_id, command);
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Key> keys = command.keys();
+    Key hot_key = keys.empty() ? Key() : std::move(keys.front());
     
-    // 提交命令到Raft
+    // 提交到Raft，日志应用后在应用线程上更新统计信息并交出结果，超时由Raft线程完成（10秒）
+    auto raft_cmd = std::make_shared<RaftCommand>(tx_id, command);
     int index, term;
-    bool ok = raft_->StartCommand(raft_cmd, index, term);
+    bool ok = raft_->StartCommand(raft_cmd, index, term, [this, start, hot_key, done](const Response& response) {
+        // 计数和直方图只做原子加，热点键在记录冲突时跳过
+        total_ops_.fetch_add(1, std::memory_order_relaxed);
+        window_ops_.fetch_add(1, std::memory_order_relaxed);
+        latency_.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        if (!hot_key.empty()) {
+            hot_key_sketch_.Offer(hot_key);
+        }
+        done(response);
+    }, 10000);
     
     if (!ok) {
-        return Response(ResponseStatus::ERROR, "Failed to start command");
+        // 失败时回调未被登记
+        done(Response(ResponseStatus::ERROR, "Failed to start command"));
     }
-    
-    // 等待命令结果
-    Response response = raft_->waitForCommandResult(index, term, 10000); // 10秒超时
-    
-    // 更新统计信息
-    {   std::lock_guard<std::mutex> lock(stats_mutex_);
-        operations_per_second_++;
-    }
-    
-    return response;
+}
+
+// 执行命令并等待结果
+Response Shard::ExecuteCommand(const Command& command, TransactionID tx_id) {
+    auto promise = std::make_shared<std::promise<Response>>();
+    auto future = promise->get_future();
+    ExecuteCommandAsync(command, tx_id, [promise](const Response& response) { promise->set_value(response); });
+    return future.get();
 }
 
 // 设置分片状态
@@ -133,26 +164,52 @@ ShardStats Shard::GetStats() const {
     ShardStats stats;
     stats.shard_id = shard_id_;
     stats.state = state_;
-    stats.key_count = key_count_;
+    stats.key_count = storage_engine_ ? storage_engine_->size() : key_count_;
     stats.memory_usage = memory_usage_;
     stats.raft_group_size = static_cast<int>(raft_peers_.size());
     stats.raft_leader_id = raft_->GetCurrentLeaderId();
     stats.operations_per_second = operations_per_second_;
+    stats.total_operations = total_ops_.load(std::memory_order_relaxed);
+    stats.latency_p50_us = latency_p50_us_;
+    stats.latency_p99_us = latency_p99_us_;
+    stats.hot_keys = hot_keys_;
     stats.migration_progress = migration_progress_;
     stats.last_heartbeat = last_heartbeat_;
     
     return stats;
 }
 
+// 绑定Raft应用线程
+bool Shard::PinApplyThread(const std::vector<int>& cpus) {
+    return raft_->PinApplyThread(cpus);
+}
+
+// 存储引擎的后台维护
+void Shard::RunMaintenance() {
+    if (!storage_engine_) {
+        return;
+    }
+    storage_engine_->cleanupExpiredKeys(StorageEngine::EXPIRE_CYCLE_BUDGET);
+    storage_engine_->purgeVersions();
+}
+
 // 执行心跳检查
 bool Shard::Heartbeat() {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     
     // 更新最后心跳时间
-    last_heartbeat_ = GetCurrentTimestamp();
-    
-    // 重置每秒操作数计数
-    operations_per_second_ = 0;
+    const uint64_t now = GetCurrentTimestamp();
+    last_heartbeat_ = now;
+    
+    // 结束当前统计窗口
+    const uint64_t elapsed_ms = std::max<uint64_t>(now - window_start_, 1);
+    operations_per_second_ = window_ops_.exchange(0, std::memory_order_relaxed) * 1000 / elapsed_ms;
+    latency_p50_us_ = latency_.Percentile(50);
+    latency_p99_us_ = latency_.Percentile(99);
+    hot_keys_ = hot_key_sketch_.TopK(HOT_KEYS_REPORTED);
+    latency_.Reset();
+    hot_key_sketch_.Reset();
+    window_start_ = now;
     
     return true;
 }
@@ -202,6 +259,7 @@ uint64_t Shard::GetMigrationProgress() const {
 // 构造函数
 ShardManager::ShardManager(DKVServer* server)
     : server_(server),
+      raft_data_dir_("/tmp/dkv_raft"),
       is_running_(false) {
     // 默认配置
     config_.enable_sharding = false;
@@ -262,7 +320,10 @@ void ShardManager::Stop() {
         return; // 已经停止
     }
     
-    is_running_ = false;
+    {   std::lock_guard<std::mutex> lock(migration_mutex_);
+        is_running_ = false;
+    }
+    migration_cv_.notify_all();
     
     // 停止所有分片
     {   std::lock_guard<std::mutex> lock(shards_mutex_);
@@ -282,6 +343,24 @@ void ShardManager::Stop() {
     }
 }
 
+// 设置分片共享的Raft网络传输
+void ShardManager::SetRaftTransport(std::shared_ptr<RaftTcpNetwork> transport, const std::string& raft_data_dir) {
+    raft_transport_ = transport;
+    raft_data_dir_ = raft_data_dir;
+}
+
+// 按shard_cpus依次为分片的Raft应用线程分配一个CPU
+void ShardManager::PinShard(Shard& shard) {
+    const std::vector<int> cpus = GetConfig().shard_cpus;
+    if (cpus.empty()) {
+        return;
+    }
+    const int cpu = cpus[static_cast<size_t>(shard.GetShardId()) % cpus.size()];
+    if (!shard.PinApplyThread({cpu})) {
+        DKV_LOG_WARNING("分片 ", shard.GetShardId(), " 的应用线程绑定CPU ", cpu, " 失败");
+    }
+}
+
 // 初始化分片
 bool ShardManager::InitializeShards() {
     std::lock_guard<std::mutex> lock(shards_mutex_);
@@ -294,19 +373,22 @@ bool ShardManager::InitializeShards() {
     // 清空现有分片
     shards_.clear();
     
+    // 所有分片的Raft组共享一个传输，到每个节点只有一条连接，心跳和日志按节点合并发送
+    if (!raft_transport_) {
+        std::vector<std::string> raft_peers = {"127.0.0.1:8000", "127.0.0.1:8001", "127.0.0.1:8002"};
+        raft_transport_ = std::make_shared<RaftTcpNetwork>(0, raft_peers);
+    }
+    
     // 创建指定数量的分片
     for (int i = 0; i < config_.num_shards; i++) {
-        // 为每个分片创建Raft组，这里简化处理，使用相同的peers
-        // 在实际生产环境中，应该为每个分片配置独立的Raft peers
-        std::vector<std::string> raft_peers = {"127.0.0.1:8000", "127.0.0.1:8001", "127.0.0.1:8002"};
-        
         // 创建分片
-        auto shard = std::make_shared<Shard>(i, raft_peers, "/tmp/dkv_raft", 100 * 1024 * 1024);
+        auto shard = std::make_shared<Shard>(i, raft_transport_, raft_data_dir_, 100 * 1024 * 1024, server_);
         
         // 启动分片
         if (!shard->Start()) {
             return false;
         }
+        PinShard(*shard);
         
         // 添加到分片映射
         shards_[i] = shard;
@@ -315,67 +397,112 @@ bool ShardManager::InitializeShards() {
     // 更新一致性哈希环
     UpdateConsistentHash();
     
+    // 哈希槽按连续区间平均分配，之后分片增删不会自动移动槽，只通过槽迁移改变
+    std::vector<int> shard_ids;
+    for (int i = 0; i < config_.num_shards; i++) {
+        shard_ids.push_back(i);
+    }
+    slot_table_.AssignEvenly(shard_ids);
+    
     return true;
 }
 
-// 更新一致性哈希环
+// 更新一致性哈希环，调用方持有shards_mutex_
 void ShardManager::UpdateConsistentHash() {
     std::lock_guard<std::mutex> lock(hash_mutex_);
     
-    // 清空现有节点
     consistent_hash_->SetNumReplicas(config_.num_virtual_nodes);
     consistent_hash_->SetHashFunctionType(config_.hash_type);
     
-    // 添加所有分片ID作为节点
-    std::lock_guard<std::mutex> shard_lock(shards_mutex_);
+    // 移除已删除的分片，添加所有分片ID作为节点
+    for (int node : consistent_hash_->GetAllNodes()) {
+        if (shards_.find(node) == shards_.end()) {
+            consistent_hash_->RemoveNode(node);
+        }
+    }
     for (const auto& pair : shards_) {
         consistent_hash_->AddNode(pair.first);
     }
 }
 
-// 处理命令，根据key路由到对应的分片
+// 处理命令并等待结果
 Response ShardManager::HandleCommand(const Command& command, TransactionID tx_id) {
+    auto promise = std::make_shared<std::promise<Response>>();
+    auto future = promise->get_future();
+    HandleCommandAsync(command, tx_id, [promise](const Response& response) { promise->set_value(response); });
+    return future.get();
+}
+
+// 处理命令，根据key路由到对应的分片
+void ShardManager::HandleCommandAsync(const Command& command, TransactionID tx_id, CommandCallback done) {
     // 如果没有启用分片，或者只有一个分片，直接执行
     if (!config_.enable_sharding || config_.num_shards == 1) {
-        std::lock_guard<std::mutex> lock(shards_mutex_);
-        auto it = shards_.begin();
-        if (it != shards_.end()) {
-            return it->second->ExecuteCommand(command, tx_id);
+        std::shared_ptr<Shard> shard;
+        {   std::lock_guard<std::mutex> lock(shards_mutex_);
+            auto it = shards_.begin();
+            if (it != shards_.end()) {
+                shard = it->second;
+            }
         }
-        return Response(ResponseStatus::ERROR, "No shards available");
-    }
-    
-    // 获取命令的key
-    std::string key;
-    if (command.type == CommandType::SET || 
-        command.type == CommandType::GET || 
-        command.type == CommandType::DEL ||
-        command.type == CommandType::EXPIRE ||
-        command.type == CommandType::TTL) {
-        if (command.args.size() > 0) {
-            key = command.args[0];
+        if (!shard) {
+            done(Response(ResponseStatus::ERROR, "No shards available"));
+            return;
         }
+        shard->ExecuteCommandAsync(command, tx_id, std::move(done));
+        return;
     }
     
-    if (key.empty()) {
-        return Response(ResponseStatus::ERROR, "Command requires a key");
+    // 获取命令的所有键
+    const CommandSpec& spec = commandSpec(command.type);
+    std::vector<Key> keys = command.keys();
+    if (keys.empty()) {
+        if (spec.hasFlag(CMD_ALL_SHARDS)) {
+            BroadcastCommand(command, tx_id, std::move(done));
+            return;
+        }
+        done(Response(ResponseStatus::ERROR, "Command requires a key"));
+        return;
     }
     
-    // 获取key对应的分片ID
-    int shard_id = GetShardId(key);
+    // 多个键分布在不同分片上时，可以拆分的命令分发到各分片执行
+    const bool scatterable = spec.hasFlag(CMD_SCATTER);
+    
+    if (config_.routing_mode == ShardRoutingMode::HASH_SLOT) {
+        if (scatterable) {
+            const int slot = KeyHashSlot(keys[0]);
+            for (size_t i = 1; i < keys.size(); i++) {
+                if (KeyHashSlot(keys[i]) != slot) {
+                    ScatterKeys(command, keys, tx_id, std::move(done));
+                    return;
+                }
+            }
+        }
+        HandleSlotCommand(command, keys, tx_id, std::move(done));
+        return;
+    }
     
-    // 获取分片实例
-    std::shared_ptr<Shard> shard;
-    {   std::lock_guard<std::mutex> lock(shards_mutex_);
-        auto it = shards_.find(shard_id);
-        if (it == shards_.end()) {
-            return Response(ResponseStatus::ERROR, "Shard not found");
+    // 获取key对应的分片ID，其余命令的多个键必须属于同一个分片
+    int shard_id = GetShardId(keys[0]);
+    for (size_t i = 1; i < keys.size(); i++) {
+        if (GetShardId(keys[i]) != shard_id) {
+            if (scatterable) {
+                ScatterKeys(command, keys, tx_id, std::move(done));
+                return;
+            }
+            done(Response(ResponseStatus::ERROR, "CROSSSHARD Keys in request don't hash to the same shard"));
+            return;
         }
-        shard = it->second;
+    }
+    
+    // 获取分片实例
+    std::shared_ptr<Shard> shard = GetShard(shard_id);
+    if (!shard) {
+        done(Response(ResponseStatus::ERROR, "Shard not found"));
+        return;
     }
     
     // 执行命令
-    return shard->ExecuteCommand(command, tx_id);
+    shard->ExecuteCommandAsync(command, tx_id, std::move(done));
 }
 
 // 获取key对应的分片ID
@@ -384,10 +511,282 @@ int ShardManager::GetShardId(const std::string& key) const {
         return 0; // 默认返回第一个分片
     }
     
-    std::lock_guard<std::mutex> lock(hash_mutex_);
+    if (config_.routing_mode == ShardRoutingMode::HASH_SLOT) {
+        return slot_table_.GetOwner(KeyHashSlot(key));
+    }
+    
+    // 一致性哈希的查询不加锁
     return consistent_hash_->GetNode(key);
 }
 
+// 按哈希槽路由命令
+void ShardManager::HandleSlotCommand(const Command& command, const std::vector<Key>& keys, TransactionID tx_id, CommandCallback done) {
+    const int slot = KeyHashSlot(keys[0]);
+    for (size_t i = 1; i < keys.size(); i++) {
+        if (KeyHashSlot(keys[i]) != slot) {
+            done(Response(ResponseStatus::ERROR, "CROSSSLOT Keys in request don't hash to the same slot"));
+            return;
+        }
+    }
+    
+    int owner = slot_table_.GetOwner(slot);
+    int target = slot_table_.GetMigrationTarget(slot);
+    if (target == NO_SHARD) {
+        std::shared_ptr<Shard> shard = GetShard(owner);
+        if (!shard) {
+            done(SlotNotServed(slot, owner));
+            return;
+        }
+        shard->ExecuteCommandAsync(command, tx_id, std::move(done));
+        return;
+    }
+    
+    // 槽正在迁移：判断键的位置和执行命令都要在持迁移锁期间完成，搬迁线程才不会在两者之间移走键。
+    // 锁不能跨线程释放，这里同步等待分片的结果，只有迁移中的槽上的命令占用调用线程
+    Response response;
+    {   // 等正在搬迁的批次结束后重新读取，槽可能已经切换
+        std::shared_lock<std::shared_mutex> migration_lock(slot_migration_mutex_);
+        owner = slot_table_.GetOwner(slot);
+        target = slot_table_.GetMigrationTarget(slot);
+        response = ExecuteMigratingSlotCommand(command, keys, slot, owner, target, tx_id);
+    }
+    done(response);
+}
+
+// 持迁移锁时执行槽上的命令：键都还在源分片上时由源分片执行，都不在时转到目标分片（ASK），
+// 部分键已经搬走时无法在一个分片上执行，由客户端稍后重试
+Response ShardManager::ExecuteMigratingSlotCommand(const Command& command, const std::vector<Key>& keys, int slot,
+                                                   int owner, int target, TransactionID tx_id) {
+    std::shared_ptr<Shard> shard = GetShard(owner);
+    if (!shard) {
+        return SlotNotServed(slot, owner);
+    }
+    if (target == NO_SHARD) {
+        return shard->ExecuteCommand(command, tx_id);
+    }
+    
+    Response exists = shard->ExecuteCommand(Command(CommandType::EXISTS, std::vector<std::string>(keys.begin(), keys.end())), tx_id);
+    if (exists.status != ResponseStatus::OK) {
+        return exists;
+    }
+    const size_t present = static_cast<size_t>(std::stoull(exists.data));
+    if (present == keys.size()) {
+        return shard->ExecuteCommand(command, tx_id);
+    }
+    if (present > 0) {
+        return Response(ResponseStatus::ERROR, "TRYAGAIN Multiple keys request during slot migration");
+    }
+    std::shared_ptr<Shard> target_shard = GetShard(target);
+    if (!target_shard) {
+        return Response(ResponseStatus::ERROR, "ASK " + std::to_string(slot) + " " + std::to_string(target));
+    }
+    return target_shard->ExecuteCommand(command, tx_id);
+}
+
+// 槽已分配给不在本节点上的分片
+Response ShardManager::SlotNotServed(int slot, int owner) {
+    if (owner == NO_SHARD) {
+        return Response(ResponseStatus::ERROR, "CLUSTERDOWN Hash slot not served");
+    }
+    return Response(ResponseStatus::ERROR, "MOVED " + std::to_string(slot) + " " + std::to_string(owner));
+}
+
+// 同时发起各子任务。子任务的结果由各自分片的应用线程交回，最后一个完成的子任务合并结果，
+// 总耗时接近最慢的一个分片，等待期间不占用任何线程
+void ShardManager::FanOut(std::vector<SubTask> tasks, std::function<void(std::vector<Response>&)> done) {
+    struct Join {
+        std::vector<Response> results;
+        std::atomic<size_t> remaining;
+        std::function<void(std::vector<Response>&)> done;
+    };
+    if (tasks.empty()) {
+        std::vector<Response> results;
+        done(results);
+        return;
+    }
+    auto join = std::make_shared<Join>();
+    join->results.resize(tasks.size());
+    join->remaining.store(tasks.size(), std::memory_order_relaxed);
+    join->done = std::move(done);
+    for (size_t i = 0; i < tasks.size(); i++) {
+        tasks[i]([join, i](const Response& response) {
+            join->results[i] = response;
+            // 最后一个完成的子任务经acq_rel看到其他子任务写入的结果
+            if (join->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                join->done(join->results);
+            }
+        });
+    }
+}
+
+// 按分片拆分键：哈希槽路由下迁移中的槽单独成组，由HandleSlotCommand处理ASK
+void ShardManager::ScatterKeys(const Command& command, const std::vector<Key>& keys, TransactionID tx_id, CommandCallback done) {
+    // 按命令表中键的间隔拆分参数，MSET的每个键带一个值，子命令按键值对拆分
+    const size_t stride = commandSpec(command.type).key_step;
+    std::map<int, std::vector<size_t>> groups; // 分片ID到键的下标，迁移中的槽记为-(slot + 2)
+    for (size_t i = 0; i < keys.size(); i++) {
+        int group = GetShardId(keys[i]);
+        if (config_.routing_mode == ShardRoutingMode::HASH_SLOT) {
+            const int slot = KeyHashSlot(keys[i]);
+            if (slot_table_.GetMigrationTarget(slot) != NO_SHARD) {
+                group = -(slot + 2);
+            }
+        }
+        groups[group].push_back(i);
+    }
+    
+    std::vector<SubTask> tasks;
+    for (const auto& group : groups) {
+        std::vector<std::string> args;
+        args.reserve(group.second.size() * stride);
+        for (size_t index : group.second) {
+            args.insert(args.end(), command.args.begin() + index * stride, command.args.begin() + (index + 1) * stride);
+        }
+        Command sub_command(command.type, std::move(args));
+        const int group_id = group.first;
+        tasks.push_back([this, sub_command, group_id, tx_id](CommandCallback callback) {
+            if (group_id <= NO_SHARD) {
+                HandleSlotCommand(sub_command, sub_command.keys(), tx_id, std::move(callback));
+                return;
+            }
+            std::shared_ptr<Shard> shard = GetShard(group_id);
+            if (!shard) {
+                callback(Response(ResponseStatus::ERROR, "Shard not found"));
+                return;
+            }
+            shard->ExecuteCommandAsync(sub_command, tx_id, std::move(callback));
+        });
+    }
+    
+    const CommandType type = command.type;
+    const size_t key_count = keys.size();
+    FanOut(std::move(tasks), [type, key_count, groups = std::move(groups), done](std::vector<Response>& responses) {
+        for (const auto& response : responses) {
+            if (response.status != ResponseStatus::OK) {
+                done(response);
+                return;
+            }
+        }
+        if (type == CommandType::MSET) {
+            done(Response(ResponseStatus::OK, "OK"));
+            return;
+        }
+        if (type == CommandType::MGET) {
+            // 按原始键顺序拼回各分片的结果
+            std::vector<std::string> values(key_count);
+            size_t group_index = 0;
+            for (const auto& group : groups) {
+                auto& elements = responses[group_index++].elements;
+                for (size_t i = 0; i < group.second.size() && i < elements.size(); i++) {
+                    values[group.second[i]] = std::move(elements[i]);
+                }
+            }
+            Response response;
+            response.status = ResponseStatus::OK;
+            response.setArray(std::move(values));
+            done(response);
+            return;
+        }
+        uint64_t total = 0;
+        for (const auto& response : responses) {
+            total += std::stoull(response.data);
+        }
+        done(Response(ResponseStatus::OK, "", std::to_string(total)));
+    });
+}
+
+// 在所有分片上执行：DBSIZE求和，FLUSHDB全部成功后返回OK，INFO按分片依次拼接，SCRIPT返回第一个分片的结果
+void ShardManager::BroadcastCommand(const Command& command, TransactionID tx_id, CommandCallback done) {
+    std::vector<std::shared_ptr<Shard>> shards;
+    {   std::lock_guard<std::mutex> lock(shards_mutex_);
+        for (const auto& pair : shards_) {
+            shards.push_back(pair.second);
+        }
+    }
+    std::sort(shards.begin(), shards.end(), [](const std::shared_ptr<Shard>& a, const std::shared_ptr<Shard>& b) {
+        return a->GetShardId() < b->GetShardId();
+    });
+    if (shards.empty()) {
+        done(Response(ResponseStatus::ERROR, "No shards available"));
+        return;
+    }
+    
+    auto shared_command = std::make_shared<const Command>(command);
+    std::vector<SubTask> tasks;
+    for (const auto& shard : shards) {
+        tasks.push_back([shard, shared_command, tx_id](CommandCallback callback) {
+            shard->ExecuteCommandAsync(*shared_command, tx_id, std::move(callback));
+        });
+    }
+    const CommandType type = command.type;
+    FanOut(std::move(tasks), [type, shards, done](std::vector<Response>& responses) {
+        for (const auto& response : responses) {
+            if (response.status != ResponseStatus::OK) {
+                done(response);
+                return;
+            }
+        }
+        
+        switch (type) {
+            case CommandType::DBSIZE: {
+                uint64_t total = 0;
+                for (const auto& response : responses) {
+                    total += std::stoull(response.data);
+                }
+                done(Response(ResponseStatus::OK, "", std::to_string(total)));
+                return;
+            }
+            case CommandType::INFO: {
+                std::string info;
+                for (size_t i = 0; i < shards.size(); i++) {
+                    info += "# Shard " + std::to_string(shards[i]->GetShardId()) + "\r\n" + responses[i].data;
+                }
+                done(Response(ResponseStatus::OK, "", info));
+                return;
+            }
+            default:
+                done(responses.front());
+                return;
+        }
+    });
+}
+
+// 开始槽迁移，键由迁移线程在后台搬迁
+bool ShardManager::MigrateSlot(int slot, int target_shard_id) {
+    if (!GetShard(target_shard_id)) {
+        return false;
+    }
+    const int source_shard_id = slot >= 0 && slot < HASH_SLOT_COUNT ? slot_table_.GetOwner(slot) : NO_SHARD;
+    if (!slot_table_.BeginMigration(slot, target_shard_id)) {
+        return false;
+    }
+    
+    ShardMigrationTask task;
+    task.source_shard_id = source_shard_id;
+    task.target_shard_id = target_shard_id;
+    task.slot = slot;
+    task.total_keys = 0;
+    task.migrated_keys = 0;
+    task.is_completed = false;
+    task.is_failed = false;
+    {   std::lock_guard<std::mutex> lock(migration_mutex_);
+        migration_tasks_.push_back(task);
+    }
+    migration_cv_.notify_one();
+    return true;
+}
+
+// 完成槽迁移，与搬迁批次互斥，切换时没有命令在迁移中的槽上执行
+bool ShardManager::FinishSlotMigration(int slot) {
+    std::unique_lock<std::shared_mutex> lock(slot_migration_mutex_);
+    return slot_table_.CompleteMigration(slot);
+}
+
+// 取消槽迁移
+void ShardManager::CancelSlotMigration(int slot) {
+    slot_table_.CancelMigration(slot);
+}
+
 // 获取分片实例
 std::shared_ptr<Shard> ShardManager::GetShard(int shard_id) const {
     std::lock_guard<std::mutex> lock(shards_mutex_);
@@ -399,21 +798,22 @@ std::shared_ptr<Shard> ShardManager::GetShard(int shard_id) const {
 }
 
 // 添加分片
-bool ShardManager::AddShard(int shard_id, const std::vector<std::string>& raft_peers) {
+bool ShardManager::AddShard(int shard_id) {
     std::lock_guard<std::mutex> lock(shards_mutex_);
     
-    // 检查分片是否已存在
-    if (shards_.find(shard_id) != shards_.end()) {
+    // 检查分片是否已存在；分片管理器启动后才有共享传输
+    if (shards_.find(shard_id) != shards_.end() || !raft_transport_) {
         return false;
     }
     
     // 创建分片
-    auto shard = std::make_shared<Shard>(shard_id, raft_peers, "/tmp/dkv_raft", 100 * 1024 * 1024);
+    auto shard = std::make_shared<Shard>(shard_id, raft_transport_, raft_data_dir_, 100 * 1024 * 1024, server_);
     
     // 启动分片
     if (!shard->Start()) {
         return false;
     }
+    PinShard(*shard);
     
     // 添加到分片映射
     shards_[shard_id] = shard;
@@ -433,11 +833,14 @@ bool ShardManager::AddShard(int shard_id, const std::vector<std::string>& raft_p
 bool ShardManager::RemoveShard(int shard_id) {
     std::lock_guard<std::mutex> lock(shards_mutex_);
     
-    // 检查分片是否存在
+    // 检查分片是否存在；哈希槽路由下还负责槽的分片需要先把槽迁走
     auto it = shards_.find(shard_id);
     if (it == shards_.end()) {
         return false;
     }
+    if (config_.routing_mode == ShardRoutingMode::HASH_SLOT && !slot_table_.SlotsOf(shard_id).empty()) {
+        return false;
+    }
     
     // 停止分片
     it->second->Stop();
@@ -522,46 +925,146 @@ bool ShardManager::TriggerMigration(int source_shard_id, int target_shard_id,
 
 // 获取迁移任务列表
 std::vector<ShardMigrationTask> ShardManager::GetMigrationTasks() const {
-    std::vector<ShardMigrationTask> tasks;
-    
-    // 目前简化实现，实际需要从分片的迁移状态中收集
-    return tasks;
+    std::lock_guard<std::mutex> lock(migration_mutex_);
+    return migration_tasks_;
 }
 
 // 执行健康检查
 void ShardManager::RunHealthCheck() {
-    std::lock_guard<std::mutex> lock(shards_mutex_);
-    
-    for (auto& pair : shards_) {
-        pair.second->Heartbeat();
+    {   std::lock_guard<std::mutex> lock(shards_mutex_);
+        for (auto& pair : shards_) {
+            pair.second->Heartbeat();
+            pair.second->RunMaintenance();
+        }
     }
     
     // 检查故障转移
     CheckFailover();
 }
 
-// 健康检查线程函数
+// 健康检查线程函数，开启自动迁移时每个监控间隔按负载重新平衡一次
 void ShardManager::HealthCheckThread() {
+    uint64_t last_rebalance = GetCurrentTimestamp();
     while (is_running_.load()) {
         // 执行健康检查
         RunHealthCheck();
         
+        const uint64_t now = GetCurrentTimestamp();
+        if (config_.enable_auto_migration && now - last_rebalance >= static_cast<uint64_t>(config_.monitoring_interval_ms)) {
+            RebalanceShards();
+            last_rebalance = now;
+        }
+        
         // 等待心跳间隔
         std::this_thread::sleep_for(std::chrono::milliseconds(config_.heartbeat_interval_ms));
     }
 }
 
-// 迁移线程函数
+// 迁移线程函数，按提交顺序逐个执行槽迁移任务
 void ShardManager::MigrationThread() {
     while (is_running_.load()) {
-        // 检查是否有迁移任务需要执行
-        // 目前简化实现，实际需要从迁移任务队列中获取任务并执行
-        
-        // 等待一段时间
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        size_t task_index;
+        {   std::unique_lock<std::mutex> lock(migration_mutex_);
+            migration_cv_.wait(lock, [this]() {
+                return !is_running_.load() || next_migration_task_ < migration_tasks_.size();
+            });
+            if (!is_running_.load()) {
+                break;
+            }
+            task_index = next_migration_task_++;
+        }
+        RunSlotMigration(task_index);
     }
 }
 
+// 执行一个槽迁移任务
+void ShardManager::RunSlotMigration(size_t task_index) {
+    ShardMigrationTask task;
+    {   std::lock_guard<std::mutex> lock(migration_mutex_);
+        task = migration_tasks_[task_index];
+    }
+    auto finish = [this, task_index](bool failed, const std::string& error) {
+        std::lock_guard<std::mutex> lock(migration_mutex_);
+        migration_tasks_[task_index].is_completed = !failed;
+        migration_tasks_[task_index].is_failed = failed;
+        migration_tasks_[task_index].error_message = error;
+    };
+    
+    std::shared_ptr<Shard> source = GetShard(task.source_shard_id);
+    std::shared_ptr<Shard> target = GetShard(task.target_shard_id);
+    if (!source || !target) {
+        // 还没有键被搬走，取消后槽仍由源分片负责
+        CancelSlotMigration(task.slot);
+        finish(true, "Shard not found");
+        return;
+    }
+    StorageEngine* engine = source->GetStorageEngine();
+    if (!engine || !target->GetStorageEngine()) {
+        // 没有关联服务器的分片没有存储引擎，没有键需要搬迁，只切换槽
+        FinishSlotMigration(task.slot);
+        finish(false, "");
+        return;
+    }
+    
+    const size_t batch_size = static_cast<size_t>(std::max(1, GetConfig().migration_batch_size));
+    int interval_ms = MIGRATION_BATCH_INTERVAL_MS;
+    size_t cursor = 0;
+    do {
+        if (!is_running_.load()) {
+            finish(true, "Shard manager stopped");
+            return;
+        }
+        
+        {   // 搬迁期间持写锁，槽上的命令等这一批写入目标分片并从源分片删除后再执行
+            std::unique_lock<std::shared_mutex> lock(slot_migration_mutex_);
+            std::ostringstream items;
+            std::vector<std::string> keys;
+            try {
+                cursor = engine->scan(cursor, batch_size, [&](const SharedKey& key, const DataItem& item) {
+                    if (KeyHashSlot(key) == task.slot) {
+                        RDBPersistence::writeBatchItem(items, key, item);
+                        keys.push_back(key.str());
+                    }
+                });
+            } catch (const std::exception& e) {
+                // 磁盘上的值读取失败，这一批没有写入目标分片，槽保持迁移状态
+                finish(true, std::string("Serialize batch failed: ") + e.what());
+                return;
+            }
+            if (!keys.empty()) {
+                Response restored = target->ExecuteCommand(
+                    Command(CommandType::RESTORE_BATCH, {RDBPersistence::finishBatch(items.str(), keys.size())}), NO_TX);
+                if (restored.status != ResponseStatus::OK) {
+                    finish(true, "Restore batch failed: " + restored.message);
+                    return;
+                }
+                const size_t count = keys.size();
+                Response deleted = source->ExecuteCommand(Command(CommandType::DEL, std::move(keys)), NO_TX);
+                if (deleted.status != ResponseStatus::OK) {
+                    // 键在两个分片上都有，源分片上的仍然优先，槽保持迁移状态
+                    finish(true, "Delete batch failed: " + deleted.message);
+                    return;
+                }
+                std::lock_guard<std::mutex> task_lock(migration_mutex_);
+                migration_tasks_[task_index].migrated_keys += count;
+            }
+        }
+        
+        // 源分片延迟升高时拉长批次间隔，让出Raft和存储引擎给正常请求
+        if (source->GetStats().latency_p99_us > MIGRATION_P99_LIMIT_US) {
+            interval_ms = std::min(interval_ms * 2, MIGRATION_MAX_BATCH_INTERVAL_MS);
+        } else {
+            interval_ms = std::max(interval_ms / 2, MIGRATION_BATCH_INTERVAL_MS);
+        }
+        std::unique_lock<std::mutex> lock(migration_mutex_);
+        migration_cv_.wait_for(lock, std::chrono::milliseconds(interval_ms), [this]() { return !is_running_.load(); });
+    } while (cursor != 0);
+    
+    FinishSlotMigration(task.slot);
+    finish(false, "");
+    DKV_LOG_INFO("槽 ", task.slot, " 从分片 ", task.source_shard_id, " 迁移到分片 ", task.target_shard_id, " 完成");
+}
+
 // 检查分片是否需要故障转移
 void ShardManager::CheckFailover() {
     std::lock_guard<std::mutex> lock(shards_mutex_);
@@ -599,10 +1102,55 @@ bool ShardManager::FailoverShard(int shard_id) {
     return true;
 }
 
-// 重新平衡分片
+// 重新平衡分片。一致性哈希路由下键的分布由环决定，只更新哈希环；
+// 哈希槽路由下按上一个统计窗口的负载，把最忙分片上的热点键所在的槽迁到最闲的分片
 bool ShardManager::RebalanceShards() {
-    // 简化实现：目前只更新一致性哈希环
-    UpdateConsistentHash();
+    std::vector<ShardStats> stats_list;
+    {   std::lock_guard<std::mutex> lock(shards_mutex_);
+        UpdateConsistentHash();
+        for (const auto& pair : shards_) {
+            stats_list.push_back(pair.second->GetStats());
+        }
+    }
+    if (config_.routing_mode != ShardRoutingMode::HASH_SLOT || stats_list.size() < 2) {
+        return true;
+    }
+    if (static_cast<int>(slot_table_.MigratingSlots().size()) >= config_.max_concurrent_migrations) {
+        return true;
+    }
+    
+    auto by_load = [](const ShardStats& a, const ShardStats& b) { return a.operations_per_second < b.operations_per_second; };
+    const ShardStats& busiest = *std::max_element(stats_list.begin(), stats_list.end(), by_load);
+    const ShardStats& idlest = *std::min_element(stats_list.begin(), stats_list.end(), by_load);
+    uint64_t total_ops = 0;
+    for (const auto& stats : stats_list) {
+        total_ops += stats.operations_per_second;
+    }
+    const uint64_t mean_ops = total_ops / stats_list.size();
+    if (busiest.operations_per_second < REBALANCE_MIN_OPS ||
+        busiest.operations_per_second < mean_ops * REBALANCE_LOAD_RATIO || busiest.hot_keys.empty()) {
+        return true;
+    }
+    
+    // 热点键的每秒操作数按它在热点键计数中的占比估计；迁走后差距缩小才迁移，
+    // 单个键就占了大部分负载时迁移只会把热点换到另一个分片
+    uint64_t hot_total = 0;
+    for (const auto& hot_key : busiest.hot_keys) {
+        hot_total += hot_key.second;
+    }
+    const uint64_t gap = busiest.operations_per_second - idlest.operations_per_second;
+    for (const auto& hot_key : busiest.hot_keys) {
+        const int slot = KeyHashSlot(hot_key.first);
+        const uint64_t slot_ops = busiest.operations_per_second * hot_key.second / hot_total;
+        if (slot_table_.GetOwner(slot) != busiest.shard_id || slot_ops >= gap) {
+            continue;
+        }
+        if (MigrateSlot(slot, idlest.shard_id)) {
+            DKV_LOG_INFO("分片 ", busiest.shard_id, " 负载 ", busiest.operations_per_second, " ops/s，热点槽 ", slot,
+                         " 迁移到分片 ", idlest.shard_id, "（", idlest.operations_per_second, " ops/s）");
+            return true;
+        }
+    }
     return true;
 }
 
@@ -0,0 +1,93 @@
+#include "multinode/shard/dkv_shard_stats.hpp"
+#include <algorithm>
+
+namespace dkv {
+
+void LatencyHistogram::Record(uint64_t micros) {
+    int bucket = 0;
+    while (micros > 0 && bucket < BUCKETS - 1) {
+        micros >>= 1;
+        bucket++;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+    std::array<uint64_t, BUCKETS> counts;
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    // 第rank个请求所在的桶，rank从1开始
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(total * p / 100.0 + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return i == 0 ? 0 : (uint64_t(1) << i) - 1;
+        }
+    }
+    return (uint64_t(1) << (BUCKETS - 1)) - 1;
+}
+
+uint64_t LatencyHistogram::Count() const {
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void HotKeySketch::Offer(std::string_view key) {
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || capacity_ == 0) {
+        return;
+    }
+    auto it = std::find_if(counters_.begin(), counters_.end(),
+                           [key](const Counter& counter) { return counter.key == key; });
+    if (it != counters_.end()) {
+        it->count++;
+        return;
+    }
+    if (counters_.size() < capacity_) {
+        counters_.push_back({std::string(key), 1});
+        return;
+    }
+    auto min_it = std::min_element(counters_.begin(), counters_.end(),
+                                   [](const Counter& a, const Counter& b) { return a.count < b.count; });
+    min_it->key.assign(key.data(), key.size());
+    min_it->count++;
+}
+
+std::vector<std::pair<std::string, uint64_t>> HotKeySketch::TopK(size_t k) const {
+    std::vector<std::pair<std::string, uint64_t>> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result.reserve(counters_.size());
+        for (const auto& counter : counters_) {
+            result.emplace_back(counter.key, counter.count);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    if (result.size() > k) {
+        result.resize(k);
+    }
+    return result;
+}
+
+void HotKeySketch::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.clear();
+}
+
+} // namespace dkv
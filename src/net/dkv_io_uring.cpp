@@ -0,0 +1,197 @@
+#include "net/dkv_io_uring.hpp"
+#include "dkv_logger.hpp"
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace dkv {
+
+namespace {
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+} // namespace
+
+IoUring::~IoUring() {
+    // 先关闭ring取消所有未完成的请求，再释放内核可能写入的缓冲区
+    if (ring_fd_ >= 0) {
+        close(ring_fd_);
+    }
+    if (buf_ring_) {
+        munmap(buf_ring_, buf_ring_size_);
+    }
+    delete[] buffers_;
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+}
+
+bool IoUring::init(unsigned entries) {
+    memset(&params_, 0, sizeof(params_));
+    ring_fd_ = ioUringSetup(entries, &params_);
+    if (ring_fd_ < 0) {
+        DKV_LOG_WARNING("创建io_uring失败: ", strerror(errno));
+        return false;
+    }
+
+    sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params_.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        return false;
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            return false;
+        }
+    }
+    sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<std::atomic<unsigned>*>(sq + params_.sq_off.head);
+    sq_tail_ = reinterpret_cast<std::atomic<unsigned>*>(sq + params_.sq_off.tail);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.array);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params_.sq_off.ring_mask);
+    sq_entries_ = params_.sq_entries;
+    sqe_tail_ = sq_tail_->load(std::memory_order_relaxed);
+
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<std::atomic<unsigned>*>(cq + params_.cq_off.head);
+    cq_tail_ = reinterpret_cast<std::atomic<unsigned>*>(cq + params_.cq_off.tail);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params_.cq_off.cqes);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params_.cq_off.ring_mask);
+    return true;
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    if (sqe_tail_ - sq_head_->load(std::memory_order_acquire) >= sq_entries_) {
+        // 提交队列已满，先交给内核
+        submitAndWait(0);
+        if (sqe_tail_ - sq_head_->load(std::memory_order_acquire) >= sq_entries_) {
+            return nullptr;
+        }
+    }
+    unsigned index = sqe_tail_ & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    sqe_tail_++;
+    return sqe;
+}
+
+int IoUring::submitAndWait(unsigned wait_nr) {
+    sq_tail_->store(sqe_tail_, std::memory_order_release);
+    unsigned to_submit = sqe_tail_ - sq_head_->load(std::memory_order_acquire);
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    if (to_submit == 0 && wait_nr == 0) {
+        return 0;
+    }
+    int ret;
+    do {
+        ret = ioUringEnter(ring_fd_, to_submit, wait_nr, flags);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+bool IoUring::setupBufferRing(uint16_t group, unsigned count, unsigned buffer_size) {
+    buf_ring_size_ = count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring == MAP_FAILED) {
+        return false;
+    }
+    buf_ring_ = static_cast<io_uring_buf_ring*>(ring);
+    // 注册前初始化环，tail从0开始
+    memset(buf_ring_, 0, buf_ring_size_);
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (ioUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        DKV_LOG_WARNING("注册io_uring接收缓冲区失败: ", strerror(errno));
+        return false;
+    }
+
+    buffers_ = new char[static_cast<size_t>(count) * buffer_size];
+    buffer_count_ = count;
+    buffer_size_ = buffer_size;
+    for (unsigned bid = 0; bid < count; ++bid) {
+        recycleBuffer(static_cast<uint16_t>(bid));
+    }
+    return true;
+}
+
+void IoUring::recycleBuffer(uint16_t bid) {
+    // 内核头文件用空结构体声明柔性数组，C++中bufs的偏移不为0，这里直接从环的起始地址索引
+    io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(buf_ring_) + (buf_tail_ & (buffer_count_ - 1));
+    buf->addr = reinterpret_cast<uint64_t>(buffer(bid));
+    buf->len = buffer_size_;
+    buf->bid = bid;
+    buf_tail_++;
+    reinterpret_cast<std::atomic<uint16_t>*>(&buf_ring_->tail)->store(buf_tail_, std::memory_order_release);
+}
+
+bool IoUring::probe() {
+    IoUring ring;
+    if (!ring.init(4) || !(ring.params_.features & IORING_FEAT_NODROP) || !ring.setupBufferRing(0, 2, 64)) {
+        return false;
+    }
+    // 实际发起一次多次触发的recv，确认内核支持
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        return false;
+    }
+    io_uring_sqe* sqe = ring.getSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sv[0];
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    bool supported = false;
+    if (write(sv[1], "x", 1) == 1 && ring.submitAndWait(1) >= 0) {
+        ring.forEachCqe([&](const io_uring_cqe& cqe) {
+            supported = cqe.res == 1 && (cqe.flags & IORING_CQE_F_MORE);
+        });
+    }
+    close(sv[0]);
+    close(sv[1]);
+    return supported;
+}
+
+} // namespace dkv
@@ -11,7 +11,7 @@
 namespace dkv {
 
 // NetworkServer 实现
-NetworkServer::NetworkServer(WorkerThreadPool* worker_pool, int port, size_t num_sub_reactors)
+NetworkServer::NetworkServer(WorkerThreadPool* worker_pool, int port, size_t num_sub_reactors, IoBackend backend)
     : server_fd_(-1), epoll_fd_(-1), running_(false) {
     memset(&server_addr_, 0, sizeof(server_addr_));
     server_addr_.sin_family = AF_INET;
@@ -20,7 +20,7 @@ NetworkServer::NetworkServer(WorkerThreadPool* worker_pool, int port, size_t num
     
     // 创建子Reactor
     for (size_t i = 0; i < num_sub_reactors; ++i) {
-        sub_reactors_.emplace_back(std::make_unique<SubReactor>(worker_pool));
+        sub_reactors_.emplace_back(SubReactor::create(backend, worker_pool, i));
     }
 }
 
@@ -29,7 +29,14 @@ NetworkServer::~NetworkServer() {
 }
 
 bool NetworkServer::start() {
-    if (!initializeServer(server_addr_.sin_port)) {
+    if (reuseport_) {
+        // 各SubReactor各自监听，内核按连接哈希分配，新建连接时不经过主Reactor
+        for (auto& reactor : sub_reactors_) {
+            if (!reactor->listenOn(server_addr_)) {
+                return false;
+            }
+        }
+    } else if (!initializeServer(server_addr_.sin_port)) {
         return false;
     }
     
@@ -45,9 +52,12 @@ bool NetworkServer::start() {
     }
     
     // 启动主事件循环线程（仅处理新连接）
-    main_event_loop_thread_ = std::thread(&NetworkServer::mainEventLoop, this);
+    if (!reuseport_) {
+        main_event_loop_thread_ = std::thread(&NetworkServer::mainEventLoop, this);
+    }
     
-    DKV_LOG_INFO("DKV服务器启动成功（多线程Reactor模式），监听端口: ", ntohs(server_addr_.sin_port));
+    DKV_LOG_INFO("DKV服务器启动成功（多线程Reactor模式", reuseport_ ? "，SO_REUSEPORT" : "",
+                 "），监听端口: ", ntohs(server_addr_.sin_port));
     DKV_LOG_INFO("子Reactor数量: ", sub_reactors_.size());
     
     return true;
@@ -82,6 +92,36 @@ void NetworkServer::stop() {
     DKV_LOG_INFO("DKV网络服务已停止");
 }
 
+void NetworkServer::setClientOutputLimit(const ClientOutputLimit& limit) {
+    for (auto& reactor : sub_reactors_) {
+        reactor->setClientOutputLimit(limit);
+    }
+}
+
+void NetworkServer::setRunToCompletion(bool enabled) {
+    for (auto& reactor : sub_reactors_) {
+        reactor->setRunToCompletion(enabled);
+    }
+}
+
+void NetworkServer::setReactorCpus(const std::vector<std::vector<int>>& cpus) {
+    for (size_t i = 0; i < sub_reactors_.size() && i < cpus.size(); ++i) {
+        sub_reactors_[i]->setCpuAffinity(cpus[i]);
+    }
+}
+
+void NetworkServer::setDisconnectListener(const std::function<void(SubReactor*, uint64_t)>& listener) {
+    for (auto& reactor : sub_reactors_) {
+        reactor->setDisconnectListener(listener);
+    }
+}
+
+void NetworkServer::setLatencyMonitor(LatencyMonitor* monitor) {
+    for (auto& reactor : sub_reactors_) {
+        reactor->setLatencyMonitor(monitor);
+    }
+}
+
 bool NetworkServer::initializeServer(int /*port*/) {
     // 创建socket
     server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
@@ -4,43 +4,81 @@
 #include "net/dkv_resp.hpp"
 #include "dkv_utils.hpp"
 #include "dkv_logger.hpp"
+#include "dkv_trace.hpp"
+#include "dkv_cpu_affinity.hpp"
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <string.h>
 #include <thread>
 #include <chrono>
 #include <random>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
 
 namespace dkv {
 
+namespace {
+// 每次read至少准备的可写空间
+constexpr size_t READ_CHUNK_SIZE = 4 * 1024;
+// 每次writev最多提交的回复数
+constexpr int MAX_IOV = 256;
+} // namespace
+
 // SubReactor实现
-SubReactor::SubReactor(WorkerThreadPool* worker_pool) : 
-    epoll_fd_(-1), 
-    running_(false), 
-    worker_pool_(worker_pool) {
-    
-    // 创建epoll实例
-    epoll_fd_ = epoll_create1(0);
-    if (epoll_fd_ < 0) {
-        DKV_LOG_ERROR("创建epoll失败: ", strerror(errno));
-    }
+SubReactor::SubReactor(WorkerThreadPool* worker_pool, size_t index) :
+    running_(false),
+    worker_pool_(worker_pool),
+    index_(index) {
 }
 
 SubReactor::~SubReactor() {
-    stop();
-    if (epoll_fd_ >= 0) {
-        close(epoll_fd_);
+    // 派生类析构时已经调用stop停止事件循环
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
     }
 }
 
+std::unique_ptr<SubReactor> SubReactor::create(IoBackend backend, WorkerThreadPool* worker_pool, size_t index) {
+    if (backend == IoBackend::IO_URING) {
+        auto reactor = std::make_unique<IoUringSubReactor>(worker_pool, index);
+        if (reactor->init()) {
+            return reactor;
+        }
+        DKV_LOG_WARNING("io_uring不可用，子Reactor ", index, " 使用epoll");
+    }
+    return std::make_unique<EpollSubReactor>(worker_pool, index);
+}
 
 bool SubReactor::start() {
-    if (running_.load() || epoll_fd_ < 0) {
+    if (running_.load()) {
         return false;
     }
-    
+
     running_.store(true);
     event_loop_thread_ = std::thread(&SubReactor::eventLoop, this);
+    pinThread(event_loop_thread_, cpus_);
+    return true;
+}
+
+bool SubReactor::listenOn(const sockaddr_in& addr) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        DKV_LOG_ERROR("创建socket失败: ", strerror(errno));
+        return false;
+    }
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0 ||
+        !setNonBlocking(fd) ||
+        bind(fd, (const struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(fd, 128) < 0 ||
+        !registerListener(fd)) {
+        DKV_LOG_ERROR("子Reactor监听端口失败: ", strerror(errno));
+        close(fd);
+        return false;
+    }
+    listen_fd_ = fd;
     return true;
 }
 
@@ -48,26 +86,59 @@ void SubReactor::stop() {
     if (!running_.load()) {
         return;
     }
-    
+
     running_.store(false);
-    
-    // 唤醒阻塞的epoll_wait
-    int dummy_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (dummy_fd >= 0) {
-        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, dummy_fd, nullptr);
-        close(dummy_fd);
-    }
-    
+    wakeup();
+
     if (event_loop_thread_.joinable()) {
         event_loop_thread_.join();
     }
-    
-    // 清理所有客户端连接
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    for (auto& [fd, client] : clients_) {
-        close(fd);
+
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
     }
-    clients_.clear();
+
+    // 事件循环已退出，清理所有客户端连接，fd由ClientConnection析构时关闭
+    connections_.clear();
+    connected_clients_.store(0, std::memory_order_relaxed);
+    // 尚未处理的新连接直接关闭，其余消息随队列释放
+    mailbox_.consumeAll([](ReactorMessage& message) {
+        if (message.kind == ReactorMessage::Kind::ADD_CLIENT) {
+            close(message.fd);
+        }
+    });
+}
+
+void SubReactor::post(ReactorMessage&& message) {
+    if (mailbox_.push(std::move(message))) {
+        wakeup();
+    }
+}
+
+void SubReactor::drainMailbox() {
+    mailbox_.consumeAll([this](ReactorMessage& message) {
+        switch (message.kind) {
+        case ReactorMessage::Kind::ADD_CLIENT:
+            acceptClient(message.fd, message.addr);
+            break;
+        case ReactorMessage::Kind::REPLIES:
+            deliverReplies(message.fd, message.connection_id, std::move(message.data), message.encode_us,
+                           message.trace_id);
+            break;
+        case ReactorMessage::Kind::PUSH:
+            if (ClientConnection* client = findClient(message.fd, message.connection_id)) {
+                appendOutput(message.fd, client, std::move(message.data));
+            }
+            break;
+        case ReactorMessage::Kind::BROADCAST:
+            deliverBroadcast(message.targets, message.shared);
+            break;
+        case ReactorMessage::Kind::DISCONNECT_HOOK:
+            applyDisconnectHook(message.fd, message.connection_id, std::move(message.hook));
+            break;
+        }
+    });
 }
 
 void SubReactor::addClient(int client_fd, const sockaddr_in& client_addr) {
@@ -76,32 +147,424 @@ void SubReactor::addClient(int client_fd, const sockaddr_in& client_addr) {
         close(client_fd);
         return;
     }
-    
-    if (!addEpollEvent(client_fd, EPOLLIN | EPOLLET)) {
-        DKV_LOG_ERROR("添加客户端事件失败");
-        close(client_fd);
+    if (onEventLoopThread()) {
+        acceptClient(client_fd, client_addr);
         return;
     }
-    
-    std::lock_guard<std::mutex> lock(clients_mutex_);
+    ReactorMessage message;
+    message.kind = ReactorMessage::Kind::ADD_CLIENT;
+    message.fd = client_fd;
+    message.addr = client_addr;
+    post(std::move(message));
+}
+
+void SubReactor::acceptClient(int client_fd, const sockaddr_in& client_addr) {
     auto client = std::make_unique<ClientConnection>(client_fd, client_addr);
-    clients_[client_fd] = std::move(client);
-    
+    client->id = next_connection_id_.fetch_add(1, std::memory_order_relaxed);
+    ClientConnection* raw = client.get();
+    if (connections_.size() <= static_cast<size_t>(client_fd)) {
+        connections_.resize(std::max<size_t>(client_fd + 1, connections_.size() * 2));
+    }
+    connections_[client_fd] = std::move(client);
+
+    // 先登记连接再注册事件，否则首个边沿触发的可读事件可能因找不到连接而丢失
+    if (!registerClient(raw)) {
+        DKV_LOG_ERROR("添加客户端事件失败");
+        connections_[client_fd].reset();
+        return;
+    }
+    connected_clients_.fetch_add(1, std::memory_order_relaxed);
+
     DKV_LOG_INFO("子Reactor添加客户端连接: ", inet_ntoa(client_addr.sin_addr), ":", ntohs(client_addr.sin_port));
 }
 
-void SubReactor::handleCommandResult(int client_fd, const Response& response) {
-    // 发送响应给客户端
-    sendResponse(client_fd, response);
+void SubReactor::handleCommandResults(int client_fd, uint64_t connection_id, const std::vector<Response>& responses,
+                                      uint64_t trace_id) {
+    auto start = LatencyMonitor::Clock::now();
+    // 整批回复直接编码进同一个缓冲区，每批只分配一次
+    std::string replies;
+    RESPWriter writer(replies);
+    for (const auto& response : responses) {
+        writer.writeResponse(response);
+    }
+    uint64_t encode_us = latency_monitor_ ? LatencyMonitor::elapsedUs(start) : 0;
+    if (trace_id != 0) {
+        RequestTracer::record(trace_id, "encode", nullptr, start, RequestTracer::Clock::now());
+    }
+
+    if (onEventLoopThread()) {
+        deliverReplies(client_fd, connection_id, std::move(replies), encode_us, trace_id);
+        return;
+    }
+    ReactorMessage message;
+    message.kind = ReactorMessage::Kind::REPLIES;
+    message.fd = client_fd;
+    message.connection_id = connection_id;
+    message.data = std::move(replies);
+    message.encode_us = encode_us;
+    message.trace_id = trace_id;
+    post(std::move(message));
+}
+
+void SubReactor::deliverReplies(int client_fd, uint64_t connection_id, std::string&& replies, uint64_t encode_us,
+                                uint64_t trace_id) {
+    auto start = LatencyMonitor::Clock::now();
+    ClientConnection* client = findClient(client_fd, connection_id);
+    if (!client) {
+        return; // 连接已关闭
+    }
+    bool ok = appendOutput(client_fd, client, std::move(replies));
+    if (latency_monitor_) {
+        latency_monitor_->recordStage(LatencyStage::WRITE, encode_us + LatencyMonitor::elapsedUs(start));
+    }
+    if (trace_id != 0) {
+        RequestTracer::record(trace_id, "write", nullptr, start, RequestTracer::Clock::now());
+    }
+    if (!ok) {
+        client->pending_commands.clear();
+        client->in_flight = false;
+        return;
+    }
+    // 回复进入输出链后再提交后续命令，保证同一连接的回复顺序
+    client->in_flight = false;
+    if (!client->pending_commands.empty()) {
+        dispatchCommands(client, std::move(client->pending_commands));
+        client->pending_commands.clear();
+    }
+}
+
+void SubReactor::pushToClient(int client_fd, uint64_t connection_id, std::string&& data) {
+    if (onEventLoopThread()) {
+        if (ClientConnection* client = findClient(client_fd, connection_id)) {
+            appendOutput(client_fd, client, std::move(data));
+        }
+        return;
+    }
+    ReactorMessage message;
+    message.kind = ReactorMessage::Kind::PUSH;
+    message.fd = client_fd;
+    message.connection_id = connection_id;
+    message.data = std::move(data);
+    post(std::move(message));
+}
+
+size_t SubReactor::pushToClients(const std::vector<std::pair<int, uint64_t>>& clients,
+                                 const std::shared_ptr<const std::string>& data) {
+    if (onEventLoopThread()) {
+        return deliverBroadcast(clients, data);
+    }
+    // 断开的连接会从订阅表中移除，目标连接数即为接收者数
+    ReactorMessage message;
+    message.kind = ReactorMessage::Kind::BROADCAST;
+    message.targets = clients;
+    message.shared = data;
+    post(std::move(message));
+    return clients.size();
+}
+
+size_t SubReactor::deliverBroadcast(const std::vector<std::pair<int, uint64_t>>& clients,
+                                    const std::shared_ptr<const std::string>& data) {
+    size_t delivered = 0;
+    for (const auto& [client_fd, connection_id] : clients) {
+        ClientConnection* client = findClient(client_fd, connection_id);
+        if (client && appendOutput(client_fd, client, OutputChunk(data))) {
+            delivered++;
+        }
+    }
+    return delivered;
+}
+
+bool SubReactor::appendOutput(int client_fd, ClientConnection* client, OutputChunk&& data) {
+    client->output_bytes += data.size();
+    client->output_chain.push_back(std::move(data));
+    // 已在等待EPOLLOUT时只追加，由事件循环按序写出
+    bool ok = client->want_write || flushOutput(client);
+    if (ok && !exceedsOutputLimit(client)) {
+        return true;
+    }
+    if (ok) {
+        DKV_LOG_WARNING("客户端输出缓冲区超出限制，断开连接: ",
+                        inet_ntoa(client->addr.sin_addr), ":", ntohs(client->addr.sin_port),
+                        " 待发送字节数: ", client->output_bytes);
+    } else {
+        DKV_LOG_ERROR("子Reactor发送响应失败");
+    }
+    // 由随后的可读或挂断事件清理连接，调用方仍持有连接指针
+    shutdown(client_fd, SHUT_RDWR);
+    // 内核仍在使用的输出链须保留到写请求完成
+    if (!client->send_in_flight) {
+        client->output_chain.clear();
+        client->output_offset = 0;
+        client->output_bytes = 0;
+    }
+    return false;
+}
+
+void SubReactor::dispatchCommands(ClientConnection* client, std::vector<Command>&& commands, uint64_t trace_id) {
+    if (client->in_flight) {
+        // 上一批尚未完成，追加到暂存队列
+        if (client->pending_commands.empty()) {
+            client->pending_commands = std::move(commands);
+        } else {
+            client->pending_commands.insert(client->pending_commands.end(),
+                                            std::make_move_iterator(commands.begin()),
+                                            std::make_move_iterator(commands.end()));
+        }
+        return;
+    }
+    CommandTask task;
+    task.sub_reactor = this;
+    task.commands = std::move(commands);
+    task.client_fd = client->fd;
+    task.connection_id = client->id;
+    task.reactor_index = index_;
+    task.enqueue_time = std::chrono::steady_clock::now();
+    task.trace_id = trace_id;
+    try {
+        worker_pool_->enqueue(std::move(task));
+        client->in_flight = true;
+    } catch (const std::exception& e) {
+        DKV_LOG_ERROR("提交命令失败: ", e.what());
+    }
+}
+
+void SubReactor::addTimer(std::chrono::steady_clock::time_point deadline, std::function<void()> callback) {
+    bool earliest;
+    {   std::lock_guard<std::mutex> lock(timers_mutex_);
+        uint64_t seq = next_timer_seq_++;
+        timers_.push(Timer{deadline, seq, std::move(callback)});
+        earliest = timers_.top().seq == seq;
+    }
+    // 新定时器早于事件循环当前等待的期限时唤醒它重新计算
+    if (earliest && !onEventLoopThread()) {
+        wakeup();
+    }
+}
+
+void SubReactor::setDisconnectHook(int client_fd, uint64_t connection_id, std::function<void()> hook) {
+    if (onEventLoopThread()) {
+        applyDisconnectHook(client_fd, connection_id, std::move(hook));
+        return;
+    }
+    ReactorMessage message;
+    message.kind = ReactorMessage::Kind::DISCONNECT_HOOK;
+    message.fd = client_fd;
+    message.connection_id = connection_id;
+    message.hook = std::move(hook);
+    post(std::move(message));
+}
+
+void SubReactor::applyDisconnectHook(int client_fd, uint64_t connection_id, std::function<void()>&& hook) {
+    if (ClientConnection* client = findClient(client_fd, connection_id)) {
+        client->on_disconnect = std::move(hook);
+        return;
+    }
+    hook();
+}
+
+std::chrono::steady_clock::time_point SubReactor::nextTimerDeadline() {
+    std::lock_guard<std::mutex> lock(timers_mutex_);
+    return timers_.empty() ? std::chrono::steady_clock::time_point::max() : timers_.top().deadline;
+}
+
+int SubReactor::timerWaitMs(int max_wait_ms) {
+    auto deadline = nextTimerDeadline();
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        return max_wait_ms;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (deadline <= now) {
+        return 0;
+    }
+    // 向上取整，避免在到期前醒来后空转
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now + std::chrono::microseconds(999));
+    return static_cast<int>(std::min<int64_t>(wait.count(), max_wait_ms));
+}
+
+void SubReactor::runExpiredTimers() {
+    std::vector<std::function<void()>> expired;
+    {   std::lock_guard<std::mutex> lock(timers_mutex_);
+        auto now = std::chrono::steady_clock::now();
+        while (!timers_.empty() && timers_.top().deadline <= now) {
+            expired.push_back(std::move(const_cast<Timer&>(timers_.top()).callback));
+            timers_.pop();
+        }
+    }
+    // 回调会写出回复，不能持有timers_mutex_
+    for (auto& callback : expired) {
+        callback();
+    }
+}
+
+bool SubReactor::processClientBuffer(int client_fd, ClientConnection* client) {
+    auto start = LatencyMonitor::Clock::now();
+    // 本次读取解析出的命令合并为一个任务
+    std::vector<Command> batch;
+    while (!client->read_buffer.empty()) {
+        auto result = client->parser.parse(client->read_buffer.readable(), client->parsed_args);
+        if (result == RESPStreamParser::Result::INCOMPLETE) {
+            break; // 等待更多数据
+        }
+        if (result == RESPStreamParser::Result::ERROR) {
+            DKV_LOG_WARNING("客户端协议错误: ", client->parser.error());
+            std::string reply = RESPProtocol::serializeError(client->parser.error());
+            ssize_t ignored = write(client_fd, reply.data(), reply.size());
+            (void)ignored;
+            handleClientDisconnect(client_fd);
+            return false;
+        }
+
+        // 参数视图指向读缓冲区，构造命令时复制一次，之后即可丢弃已解析的数据
+        if (!client->parsed_args.empty()) {
+            batch.push_back(RESPProtocol::buildCommand(client->parsed_args));
+            DKV_LOG_DEBUG("子Reactor解析到命令: ", Utils::commandTypeToString(batch.back().type));
+        }
+        client->read_buffer.consume(client->parser.consumed());
+    }
+
+    if (batch.empty() || !worker_pool_) {
+        return true;
+    }
+    if (latency_monitor_) {
+        latency_monitor_->recordStage(LatencyStage::PARSE, LatencyMonitor::elapsedUs(start));
+    }
+    // 按采样率追踪本批命令，追踪ID随任务经过后续各阶段；暂存到上一批完成后才提交的命令不追踪
+    const uint64_t trace_id = RequestTracer::sample();
+    if (trace_id != 0) {
+        RequestTracer::record(trace_id, "parse", nullptr, start, RequestTracer::Clock::now());
+    }
+    if (!run_to_completion_ || client->in_flight || !canExecuteInline(batch)) {
+        dispatchCommands(client, std::move(batch), client->in_flight ? 0 : trace_id);
+        return true;
+    }
+    // 占用in_flight，保证执行期间到达的命令排在本批之后
+    client->in_flight = true;
+    CommandTask task;
+    task.connection_id = client->id;
+    task.sub_reactor = this;
+    task.commands = std::move(batch);
+    task.client_fd = client_fd;
+    task.reactor_index = index_;
+    task.trace_id = trace_id;
+    // 直接在事件循环线程上执行，省去与工作线程池之间的两次线程切换；
+    // Raft写命令不在此等待，提交后由应用线程交付回复
+    worker_pool_->executeTask(std::move(task));
+    return true;
+}
+
+bool SubReactor::canExecuteInline(const std::vector<Command>& commands) const {
+    return !worker_pool_->isSlowBatch(commands);
 }
 
-void SubReactor::eventLoop() {
+void SubReactor::handleClientDisconnect(int client_fd) {
+    ClientConnection* client = findClient(client_fd);
+    if (client) {
+        DKV_LOG_INFO("子Reactor客户端断开连接: ",
+                     inet_ntoa(client->addr.sin_addr),
+                     ":",
+                     ntohs(client->addr.sin_port));
+        if (client->on_disconnect) {
+            client->on_disconnect();
+        }
+        if (disconnect_listener_) {
+            disconnect_listener_(this, client->id);
+        }
+        // fd由ClientConnection析构时关闭，避免重复关闭已被复用的fd
+        connections_[client_fd].reset();
+        connected_clients_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void SubReactor::consumeOutput(ClientConnection* client, size_t written) {
+    auto& chain = client->output_chain;
+    client->output_bytes -= written;
+    while (written > 0) {
+        size_t left = chain.front().size() - client->output_offset;
+        if (written >= left) {
+            written -= left;
+            chain.pop_front();
+            client->output_offset = 0;
+        } else {
+            client->output_offset += written;
+            written = 0;
+        }
+    }
+}
+
+bool SubReactor::exceedsOutputLimit(ClientConnection* client) {
+    const ClientOutputLimit& limit = output_limit_;
+    if (limit.hard_bytes > 0 && client->output_bytes > limit.hard_bytes) {
+        return true;
+    }
+    if (limit.soft_bytes == 0 || client->output_bytes <= limit.soft_bytes) {
+        client->over_soft_limit = false;
+        return false;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (!client->over_soft_limit) {
+        client->over_soft_limit = true;
+        client->soft_limit_since = now;
+        return false;
+    }
+    return now - client->soft_limit_since >= std::chrono::seconds(limit.soft_seconds);
+}
+
+bool SubReactor::setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return false;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) >= 0;
+}
+
+// EpollSubReactor实现
+EpollSubReactor::EpollSubReactor(WorkerThreadPool* worker_pool, size_t index) :
+    SubReactor(worker_pool, index),
+    epoll_fd_(-1) {
+
+    // 创建epoll实例
+    epoll_fd_ = epoll_create1(0);
+    if (epoll_fd_ < 0) {
+        DKV_LOG_ERROR("创建epoll失败: ", strerror(errno));
+    }
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0 || !addEpollEvent(wakeup_fd_, EPOLLIN)) {
+        DKV_LOG_ERROR("创建eventfd失败: ", strerror(errno));
+    }
+}
+
+EpollSubReactor::~EpollSubReactor() {
+    stop();
+    if (wakeup_fd_ >= 0) {
+        close(wakeup_fd_);
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+void EpollSubReactor::wakeup() {
+    // 唤醒阻塞的epoll_wait
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeup_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+bool EpollSubReactor::registerListener(int fd) {
+    return addEpollEvent(fd, EPOLLIN);
+}
+
+bool EpollSubReactor::registerClient(ClientConnection* client) {
+    return addEpollEvent(client->fd, EPOLLIN | EPOLLET);
+}
+
+void EpollSubReactor::eventLoop() {
     const int MAX_EVENTS = 1024;
     struct epoll_event events[MAX_EVENTS];
-    
+
     while (running_.load()) {
-        int event_count = epoll_wait(epoll_fd_, events, MAX_EVENTS, 1000);
-        
+        int event_count = epoll_wait(epoll_fd_, events, MAX_EVENTS, timerWaitMs(1000));
+
         if (event_count < 0) {
             if (errno != EINTR) {
                 DKV_LOG_ERROR("epoll_wait失败: ", strerror(errno));
@@ -109,148 +572,157 @@ void SubReactor::eventLoop() {
             }
             continue;
         }
-        
+
         for (int i = 0; i < event_count; ++i) {
             int fd = events[i].data.fd;
-            
+
+            if (fd == listen_fd_) {
+                acceptClients();
+                continue;
+            }
+            if (fd == wakeup_fd_) {
+                uint64_t value;
+                ssize_t ignored = read(wakeup_fd_, &value, sizeof(value));
+                (void)ignored;
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                handleClientWritable(fd);
+            }
             if (events[i].events & (EPOLLIN | EPOLLPRI)) {
                 handleClientData(fd);
             } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
                 handleClientDisconnect(fd);
             }
         }
+        drainMailbox();
+        runExpiredTimers();
     }
 }
 
-void SubReactor::handleClientData(int client_fd) {
-    std::unique_ptr<ClientConnection>* client_ptr = nullptr;
-    
-    // 查找客户端连接
-    { 
-        std::lock_guard<std::mutex> lock(clients_mutex_);
-        auto it = clients_.find(client_fd);
-        if (it == clients_.end()) {
+void EpollSubReactor::acceptClients() {
+    // 尽可能多地接受连接
+    while (true) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int client_fd = accept(listen_fd_, (struct sockaddr*)&client_addr, &client_len);
+        if (client_fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                DKV_LOG_ERROR("接受连接失败: ", strerror(errno));
+            }
             return;
         }
-        client_ptr = &(it->second);
-    }
-    
-    ClientConnection* client = client_ptr->get();
-    
-    // 读取数据
-    char buffer[8192];
-    ssize_t bytes_read;
-    
-    while ((bytes_read = read(client_fd, buffer, sizeof(buffer))) > 0) {
-        client->read_buffer.append(buffer, bytes_read);
-    }
-    
-    if (bytes_read == 0) {
-        handleClientDisconnect(client_fd);
-        return;
+        addClient(client_fd, client_addr);
     }
-    
-    if (bytes_read < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-        DKV_LOG_ERROR("读取客户端数据失败: ", strerror(errno));
-        handleClientDisconnect(client_fd);
+}
+
+void EpollSubReactor::handleClientData(int client_fd) {
+    ClientConnection* client = findClient(client_fd);
+    if (!client) {
         return;
     }
-    
-    // 解析命令
-    size_t pos = 0;
-    while (pos < client->read_buffer.length()) {
-        DKV_LOG_DEBUG("SubReactor::handleClientData 解析命令前: ", client->read_buffer.substr(pos));
-        Command command = RESPProtocol::parseCommand(client->read_buffer, pos);
-        DKV_LOG_DEBUG("SubReactor::handleClientData 解析命令后: ", Utils::commandTypeToString(command.type));
-        for (const auto& arg : command.args) {
-            DKV_LOG_DEBUG("SubReactor::handleClientData 解析命令参数: ", arg);
+
+    // 直接读入连接缓冲区，每次读取后立即解析，流水线请求不会在缓冲区中堆积
+    while (true) {
+        char* space = client->read_buffer.prepareWrite(READ_CHUNK_SIZE);
+        ssize_t bytes_read = read(client_fd, space, client->read_buffer.writableBytes());
+        if (bytes_read > 0) {
+            client->read_buffer.commitWrite(static_cast<size_t>(bytes_read));
+            if (!processClientBuffer(client_fd, client)) {
+                return;
+            }
+            continue;
         }
-        if (command.type == CommandType::UNKNOWN) {
-            break; // 等待更多数据
+        if (bytes_read == 0) {
+            handleClientDisconnect(client_fd);
+            return;
         }
-        
-        DKV_LOG_DEBUG("子Reactor解析到命令: ", Utils::commandTypeToString(command.type));
-        
-        // 创建命令任务并提交到线程池
-        if (worker_pool_) {
-            CommandTask task;
-            task.sub_reactor = this;
-            task.command = command;
-            task.client_fd = client_fd;
-            task.client_read_buffer = client->read_buffer.substr(pos);
-            task.parsed_pos = pos;
-            
-            worker_pool_->enqueue(task);
+        if (errno == EINTR) {
+            continue;
         }
-    }
-    
-    // 移除已处理的数据
-    if (pos > 0) {
-        client->read_buffer.erase(0, pos);
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            DKV_LOG_ERROR("读取客户端数据失败: ", strerror(errno));
+            handleClientDisconnect(client_fd);
+        }
+        return;
     }
 }
 
-void SubReactor::handleClientDisconnect(int client_fd) {
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    handleClientDisconnect_locked(client_fd);
+void EpollSubReactor::handleClientWritable(int client_fd) {
+    ClientConnection* client = findClient(client_fd);
+    if (!client || !client->want_write) {
+        return;
+    }
+    if (!flushOutput(client)) {
+        DKV_LOG_ERROR("子Reactor发送响应失败: ", strerror(errno));
+        handleClientDisconnect(client_fd);
+    }
 }
 
-void SubReactor::handleClientDisconnect_locked(int client_fd) {
-    auto it = clients_.find(client_fd);
-    if (it != clients_.end()) {
-        DKV_LOG_INFO("子Reactor客户端断开连接: ", 
-                     inet_ntoa(it->second->addr.sin_addr), 
-                     ":",
-                     ntohs(it->second->addr.sin_port));
+void EpollSubReactor::handleClientDisconnect(int client_fd) {
+    if (findClient(client_fd)) {
         removeEpollEvent(client_fd);
-        close(client_fd);
-        clients_.erase(it);
     }
+    SubReactor::handleClientDisconnect(client_fd);
 }
 
-void SubReactor::sendResponse(int client_fd, const Response& response) {
-    std::string resp_str;
-    
-    if (response.data.empty()) {
-        resp_str = RESPProtocol::serializeResponse(response);
-    } else {
-        resp_str = RESPProtocol::serializeBulkString(response.data);
-    }
-    
-    ssize_t bytes_sent = write(client_fd, resp_str.c_str(), resp_str.length());
-    if (bytes_sent < 0) {
-        DKV_LOG_ERROR("子Reactor发送响应失败");
-        // 发送失败可能意味着连接已断开，尝试清理
-        handleClientDisconnect(client_fd);
+bool EpollSubReactor::flushOutput(ClientConnection* client) {
+    auto& chain = client->output_chain;
+    while (!chain.empty()) {
+        struct iovec iov[MAX_IOV];
+        int count = 0;
+        for (auto it = chain.begin(); it != chain.end() && count < MAX_IOV; ++it) {
+            size_t skip = (count == 0) ? client->output_offset : 0;
+            iov[count].iov_base = const_cast<char*>(it->data()) + skip;
+            iov[count].iov_len = it->size() - skip;
+            count++;
+        }
+        ssize_t written = writev(client->fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        consumeOutput(client, static_cast<size_t>(written));
     }
-}
 
-bool SubReactor::setNonBlocking(int fd) {
-    int flags = fcntl(fd, F_GETFL, 0);
-    if (flags < 0) {
-        return false;
+    // 写不完时等待socket可写，写完后恢复只监听读事件
+    bool want_write = !chain.empty();
+    if (want_write != client->want_write) {
+        uint32_t events = want_write ? (EPOLLIN | EPOLLOUT | EPOLLET) : (EPOLLIN | EPOLLET);
+        if (!modifyEpollEvent(client->fd, events)) {
+            return false;
+        }
+        client->want_write = want_write;
     }
-    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) >= 0;
+    return true;
 }
 
-bool SubReactor::addEpollEvent(int fd, uint32_t events) {
+bool EpollSubReactor::addEpollEvent(int fd, uint32_t events) {
     struct epoll_event event;
     event.events = events;
     event.data.fd = fd;
     return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) >= 0;
 }
 
-bool SubReactor::modifyEpollEvent(int fd, uint32_t events) {
+bool EpollSubReactor::modifyEpollEvent(int fd, uint32_t events) {
     struct epoll_event event;
     event.events = events;
     event.data.fd = fd;
     return epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) >= 0;
 }
 
-bool SubReactor::removeEpollEvent(int fd) {
+bool EpollSubReactor::removeEpollEvent(int fd) {
     return epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) >= 0;
 }
 
 
 
-} // namespace dkv
\ No newline at end of file
+} // namespace dkv
@@ -0,0 +1,403 @@
+#include "net/dkv_network.hpp"
+#include "dkv_logger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+
+namespace dkv {
+
+namespace {
+constexpr unsigned RING_ENTRIES = 256;
+// 接收缓冲区环：数据到达时内核从中选取一个缓冲区，复制到连接的读缓冲区后立即归还
+constexpr uint16_t BUFFER_GROUP = 0;
+constexpr unsigned BUFFER_COUNT = 512;
+constexpr unsigned BUFFER_SIZE = 4 * 1024;
+// 每次sendmsg最多提交的回复数
+constexpr size_t MAX_IOV = 256;
+
+// user_data布局：高32位为fd，8-31位为连接id的低24位，低8位为请求类型
+enum RequestType : uint64_t {
+    REQ_ACCEPT = 1,
+    REQ_RECV,
+    REQ_SEND,
+    REQ_WAKEUP,
+    REQ_CANCEL,
+    REQ_TIMER
+};
+
+uint64_t makeUserData(int fd, uint64_t connection_id, RequestType type) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32) |
+           ((connection_id & 0xFFFFFF) << 8) | type;
+}
+
+int userDataFd(uint64_t user_data) {
+    return static_cast<int>(user_data >> 32);
+}
+
+uint64_t userDataType(uint64_t user_data) {
+    return user_data & 0xFF;
+}
+
+bool userDataMatches(uint64_t user_data, const ClientConnection* client) {
+    return ((user_data >> 8) & 0xFFFFFF) == (client->id & 0xFFFFFF);
+}
+} // namespace
+
+IoUringSubReactor::IoUringSubReactor(WorkerThreadPool* worker_pool, size_t index) :
+    SubReactor(worker_pool, index) {
+}
+
+IoUringSubReactor::~IoUringSubReactor() {
+    stop();
+    if (wakeup_fd_ >= 0) {
+        close(wakeup_fd_);
+    }
+}
+
+bool IoUringSubReactor::init() {
+    // 内核能力只检查一次
+    static const bool supported = IoUring::probe();
+    if (!supported) {
+        return false;
+    }
+    if (!ring_.init(RING_ENTRIES) || !ring_.setupBufferRing(BUFFER_GROUP, BUFFER_COUNT, BUFFER_SIZE)) {
+        return false;
+    }
+    // 阻塞模式的eventfd，读请求由内核挂起等待而不是立即返回EAGAIN
+    wakeup_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        DKV_LOG_ERROR("创建eventfd失败: ", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void IoUringSubReactor::wakeup() {
+    // 已有未处理的唤醒时不重复写eventfd
+    if (!wakeup_pending_.exchange(true)) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeup_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+bool IoUringSubReactor::registerListener(int fd) {
+    // accept请求在事件循环启动时发起
+    (void)fd;
+    return true;
+}
+
+bool IoUringSubReactor::registerClient(ClientConnection* client) {
+    return armRecv(client);
+}
+
+bool IoUringSubReactor::flushOutput(ClientConnection* client) {
+    // 上一个写请求完成后会接着写出新追加的回复
+    if (client->send_in_flight || client->output_chain.empty()) {
+        return true;
+    }
+    return submitSend(client);
+}
+
+void IoUringSubReactor::eventLoop() {
+    armWakeup();
+    if (listen_fd_ >= 0) {
+        armAccept();
+    }
+
+    while (running_.load()) {
+        armTimer();
+        // 一次系统调用提交本轮产生的全部请求并等待完成事件
+        if (ring_.submitAndWait(1) < 0 && errno != EBUSY) {
+            DKV_LOG_ERROR("io_uring_enter失败: ", strerror(errno));
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ring_.forEachCqe([this](const io_uring_cqe& cqe) {
+            handleCompletion(cqe);
+        });
+        drainMailbox();
+        runExpiredTimers();
+    }
+
+    drainSends();
+}
+
+void IoUringSubReactor::handleCompletion(const io_uring_cqe& cqe) {
+    switch (userDataType(cqe.user_data)) {
+    case REQ_ACCEPT:
+        handleAccept(cqe);
+        break;
+    case REQ_RECV:
+        handleRecv(cqe);
+        break;
+    case REQ_SEND:
+        handleSend(cqe);
+        break;
+    case REQ_WAKEUP:
+        // 先清除标记，本轮处理消息队列之后到达的消息会再次唤醒
+        wakeup_pending_.store(false);
+        if (running_.load()) {
+            armWakeup();
+        }
+        break;
+    case REQ_TIMER:
+        // 较早发起、已被更近的期限取代的超时请求也会到达，只有最近的期限已过时才需要重新发起
+        if (std::chrono::steady_clock::now() >= timer_armed_) {
+            timer_armed_ = std::chrono::steady_clock::time_point::max();
+        }
+        break;
+    default:
+        break; // 取消请求的完成事件
+    }
+}
+
+void IoUringSubReactor::handleAccept(const io_uring_cqe& cqe) {
+    if (cqe.res >= 0) {
+        int client_fd = cqe.res;
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        memset(&client_addr, 0, sizeof(client_addr));
+        getpeername(client_fd, (struct sockaddr*)&client_addr, &client_len);
+        addClient(client_fd, client_addr);
+    } else if (cqe.res != -ECANCELED && cqe.res != -EAGAIN && cqe.res != -EINTR) {
+        DKV_LOG_ERROR("接受连接失败: ", strerror(-cqe.res));
+    }
+    // 多次触发的请求被内核终止后重新发起
+    if (!(cqe.flags & IORING_CQE_F_MORE) && running_.load()) {
+        armAccept();
+    }
+}
+
+void IoUringSubReactor::handleRecv(const io_uring_cqe& cqe) {
+    int client_fd = userDataFd(cqe.user_data);
+    bool has_buffer = cqe.flags & IORING_CQE_F_BUFFER;
+    uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+    ClientConnection* client = findRequestClient(cqe.user_data);
+    if (!client) {
+        if (has_buffer) {
+            ring_.recycleBuffer(bid);
+        }
+        return;
+    }
+
+    if (cqe.res > 0) {
+        client->read_buffer.append(ring_.buffer(bid), static_cast<size_t>(cqe.res));
+        ring_.recycleBuffer(bid);
+        if (!processClientBuffer(client_fd, client)) {
+            return;
+        }
+    } else if (cqe.res == 0) {
+        handleClientDisconnect(client_fd);
+        return;
+    } else if (cqe.res != -ENOBUFS) {
+        // 缓冲区耗尽时重新发起即可，其他错误断开连接
+        if (cqe.res != -ECANCELED) {
+            DKV_LOG_ERROR("读取客户端数据失败: ", strerror(-cqe.res));
+        }
+        handleClientDisconnect(client_fd);
+        return;
+    }
+
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        client = findRequestClient(cqe.user_data);
+        if (client && !armRecv(client)) {
+            handleClientDisconnect(client_fd);
+        }
+    }
+}
+
+void IoUringSubReactor::handleSend(const io_uring_cqe& cqe) {
+    int client_fd = userDataFd(cqe.user_data);
+    auto closing = closing_.find(client_fd);
+    if (closing != closing_.end() && userDataMatches(cqe.user_data, closing->second.get())) {
+        // 连接已断开，写请求结束后才能释放输出链并关闭fd
+        closing_.erase(closing);
+        return;
+    }
+    ClientConnection* client = findRequestClient(cqe.user_data);
+    if (!client) {
+        return;
+    }
+    client->send_in_flight = false;
+
+    if (cqe.res < 0) {
+        if (cqe.res == -EAGAIN || cqe.res == -EINTR) {
+            if (!submitSend(client, true)) {
+                handleClientDisconnect(client_fd);
+            }
+            return;
+        }
+        DKV_LOG_ERROR("子Reactor发送响应失败: ", strerror(-cqe.res));
+        handleClientDisconnect(client_fd);
+        return;
+    }
+    consumeOutput(client, static_cast<size_t>(cqe.res));
+    if (!client->output_chain.empty() && !submitSend(client)) {
+        handleClientDisconnect(client_fd);
+    }
+}
+
+void IoUringSubReactor::handleClientDisconnect(int client_fd) {
+    ClientConnection* client = findClient(client_fd);
+    if (!client) {
+        return;
+    }
+    DKV_LOG_INFO("子Reactor客户端断开连接: ",
+                 inet_ntoa(client->addr.sin_addr),
+                 ":",
+                 ntohs(client->addr.sin_port));
+    if (client->on_disconnect) {
+        client->on_disconnect();
+    }
+    if (disconnect_listener_) {
+        disconnect_listener_(this, client->id);
+    }
+
+    // 取消多次触发的recv请求，请求持有socket的引用，fd关闭后也不会误读复用该fd的新连接
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = makeUserData(client_fd, client->id, REQ_RECV);
+        sqe->user_data = makeUserData(client_fd, client->id, REQ_CANCEL);
+    }
+
+    if (client->send_in_flight) {
+        // 内核仍在读取输出链，关闭socket让写请求尽快结束，完成后再释放
+        shutdown(client_fd, SHUT_RDWR);
+        closing_[client_fd] = std::move(connections_[client_fd]);
+    }
+    connections_[client_fd].reset();
+    connected_clients_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void IoUringSubReactor::drainSends() {
+    while (true) {
+        size_t in_flight = closing_.size();
+        for (auto& client : connections_) {
+            if (client && client->send_in_flight) {
+                shutdown(client->fd, SHUT_RDWR);
+                in_flight++;
+            }
+        }
+        if (in_flight == 0) {
+            return;
+        }
+        if (ring_.submitAndWait(1) < 0 && errno != EBUSY) {
+            return;
+        }
+        ring_.forEachCqe([this](const io_uring_cqe& cqe) {
+            if (userDataType(cqe.user_data) == REQ_SEND) {
+                handleSend(cqe);
+            } else if (cqe.flags & IORING_CQE_F_BUFFER) {
+                ring_.recycleBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+        });
+    }
+}
+
+void IoUringSubReactor::armAccept() {
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) {
+        DKV_LOG_ERROR("io_uring提交队列已满，无法接受连接");
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd_;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = makeUserData(listen_fd_, 0, REQ_ACCEPT);
+}
+
+void IoUringSubReactor::armWakeup() {
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) {
+        DKV_LOG_ERROR("io_uring提交队列已满，无法等待唤醒");
+        return;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeup_fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeup_value_);
+    sqe->len = sizeof(wakeup_value_);
+    sqe->user_data = makeUserData(wakeup_fd_, 0, REQ_WAKEUP);
+}
+
+void IoUringSubReactor::armTimer() {
+    auto deadline = nextTimerDeadline();
+    if (deadline >= timer_armed_) {
+        return;
+    }
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) {
+        DKV_LOG_ERROR("io_uring提交队列已满，无法登记定时器");
+        return;
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+    int64_t ns = std::max<int64_t>(wait.count(), 0);
+    // 相对时间在提交时由内核复制
+    timer_ts_.tv_sec = ns / 1000000000;
+    timer_ts_.tv_nsec = ns % 1000000000;
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(&timer_ts_);
+    sqe->len = 1;
+    sqe->user_data = makeUserData(0, 0, REQ_TIMER);
+    timer_armed_ = deadline;
+}
+
+bool IoUringSubReactor::armRecv(ClientConnection* client) {
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = client->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = makeUserData(client->fd, client->id, REQ_RECV);
+    return true;
+}
+
+bool IoUringSubReactor::submitSend(ClientConnection* client, bool poll_first) {
+    auto& iov = client->send_iov;
+    iov.clear();
+    for (auto it = client->output_chain.begin(); it != client->output_chain.end() && iov.size() < MAX_IOV; ++it) {
+        size_t skip = iov.empty() ? client->output_offset : 0;
+        iov.push_back({const_cast<char*>(it->data()) + skip, it->size() - skip});
+    }
+    if (iov.empty()) {
+        return true;
+    }
+
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) {
+        return false;
+    }
+    client->send_msg = msghdr{};
+    client->send_msg.msg_iov = iov.data();
+    client->send_msg.msg_iovlen = iov.size();
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = client->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&client->send_msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->ioprio = poll_first ? IORING_RECVSEND_POLL_FIRST : 0;
+    sqe->user_data = makeUserData(client->fd, client->id, REQ_SEND);
+    client->send_in_flight = true;
+    return true;
+}
+
+ClientConnection* IoUringSubReactor::findRequestClient(uint64_t user_data) {
+    ClientConnection* client = findClient(userDataFd(user_data));
+    if (!client || !userDataMatches(user_data, client)) {
+        return nullptr;
+    }
+    return client;
+}
+
+} // namespace dkv
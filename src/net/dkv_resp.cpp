@@ -4,215 +4,395 @@
 #include <sstream>
 #include <cstring>
 #include <algorithm>
+#include <charconv>
 
 namespace dkv {
 
 // RESPProtocol 实现
 
-Command RESPProtocol::parseCommand(const std::string& data, size_t& pos) {
-    if (data.empty()) {
-        return Command();
+void RESPStreamParser::reset() {
+    state_ = State::START;
+    pos_ = 0;
+    multibulk_len_ = 0;
+    bulk_len_ = -1;
+    slices_.clear();
+}
+
+RESPStreamParser::Result RESPStreamParser::fail(const char* message) {
+    error_ = message;
+    reset();
+    return Result::ERROR;
+}
+
+size_t RESPStreamParser::findCRLF(std::string_view data, size_t from) {
+    while (from < data.size()) {
+        const void* found = std::memchr(data.data() + from, '\r', data.size() - from);
+        if (!found) {
+            return std::string_view::npos;
+        }
+        size_t cr = static_cast<const char*>(found) - data.data();
+        if (cr + 1 >= data.size()) {
+            return std::string_view::npos;
+        }
+        if (data[cr + 1] == '\n') {
+            return cr;
+        }
+        from = cr + 1;
+    }
+    return std::string_view::npos;
+}
+
+bool RESPStreamParser::parseLength(std::string_view text, int64_t& value) {
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+RESPStreamParser::Result RESPStreamParser::parse(std::string_view data, std::vector<std::string_view>& args) {
+    args.clear();
+    consumed_ = 0;
+    if (state_ == State::START) {
+        if (data.empty()) {
+            return Result::INCOMPLETE;
+        }
+        state_ = data[0] == '*' ? State::MULTIBULK : State::INLINE;
+        pos_ = 0;
+    }
+    return state_ == State::INLINE ? parseInline(data, args) : parseMultibulk(data, args);
+}
+
+RESPStreamParser::Result RESPStreamParser::parseInline(std::string_view data, std::vector<std::string_view>& args) {
+    const void* found = std::memchr(data.data() + pos_, '\n', data.size() - pos_);
+    if (!found) {
+        if (data.size() > MAX_INLINE_LEN) {
+            return fail("Protocol error: too big inline request");
+        }
+        pos_ = data.size();
+        return Result::INCOMPLETE;
+    }
+    size_t newline = static_cast<const char*>(found) - data.data();
+    std::string_view line = data.substr(0, newline);
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
     }
-    
-    // 处理简单字符串命令
-    if (pos < data.length() && data[pos] == '+') {
-        std::string cmd = readUntilCRLF(data, pos);
-        CommandType type = Utils::stringToCommandType(cmd);
-        return Command(type, {});
-    }
-    // 处理数组类型
-    else if (pos < data.length() && data[pos] == '*') {
-        auto args = parseArray(data, pos);
-        if (!args.empty()) {
-            CommandType type = Utils::stringToCommandType(args[0]);
-            std::vector<std::string> command_args(args.begin() + 1, args.end());
-            return Command(type, command_args);
+    splitInline(line, args);
+    consumed_ = newline + 1;
+    reset();
+    return Result::COMPLETE;
+}
+
+void RESPStreamParser::splitInline(std::string_view line, std::vector<std::string_view>& args) {
+    // 按空格切分参数，忽略连续空格
+    size_t start = 0;
+    while (start < line.size()) {
+        size_t end = line.find(' ', start);
+        if (end == std::string_view::npos) {
+            end = line.size();
         }
+        if (end > start) {
+            args.push_back(line.substr(start, end - start));
+        }
+        start = end + 1;
     }
-    // 处理其他类型
-    else if (pos < data.length()) {
-        // 尝试解析为简单命令
-        std::string cmd = readUntilCRLF(data, pos);
-        // 简单的命令解析
-        size_t space_pos = cmd.find(' ');
-        if (space_pos != std::string::npos) {
-            std::string cmd_name = cmd.substr(0, space_pos);
-            CommandType type = Utils::stringToCommandType(cmd_name);
-            
-            // 解析参数
-            std::vector<std::string> args;
-            size_t start = space_pos + 1;
-            while (start < cmd.length()) {
-                size_t end = cmd.find(' ', start);
-                if (end == std::string::npos) {
-                    args.push_back(cmd.substr(start));
-                    break;
+}
+
+RESPStreamParser::Result RESPStreamParser::parseMultibulk(std::string_view data, std::vector<std::string_view>& args) {
+    if (pos_ == 0) {
+        // 读取参数个数
+        size_t cr = findCRLF(data, 1);
+        if (cr == std::string_view::npos) {
+            if (data.size() > MAX_INLINE_LEN) {
+                return fail("Protocol error: too big multibulk count string");
+            }
+            return Result::INCOMPLETE;
+        }
+        if (!parseLength(data.substr(1, cr - 1), multibulk_len_) || multibulk_len_ > MAX_MULTIBULK_LEN) {
+            return fail("Protocol error: invalid multibulk length");
+        }
+        pos_ = cr + 2;
+        if (multibulk_len_ <= 0) {
+            consumed_ = pos_;
+            reset();
+            return Result::COMPLETE;
+        }
+        slices_.reserve(static_cast<size_t>(multibulk_len_));
+    }
+
+    while (static_cast<int64_t>(slices_.size()) < multibulk_len_) {
+        if (bulk_len_ < 0) {
+            // 读取批量字符串长度行
+            if (pos_ >= data.size()) {
+                return Result::INCOMPLETE;
+            }
+            if (data[pos_] != '$') {
+                return fail("Protocol error: expected '$'");
+            }
+            size_t cr = findCRLF(data, pos_ + 1);
+            if (cr == std::string_view::npos) {
+                if (data.size() - pos_ > MAX_INLINE_LEN) {
+                    return fail("Protocol error: too big bulk count string");
                 }
-                args.push_back(cmd.substr(start, end - start));
-                start = end + 1;
+                return Result::INCOMPLETE;
+            }
+            int64_t len = 0;
+            if (!parseLength(data.substr(pos_ + 1, cr - pos_ - 1), len) || len < -1 || len > MAX_BULK_LEN) {
+                return fail("Protocol error: invalid bulk length");
+            }
+            pos_ = cr + 2;
+            if (len == -1) {
+                // 空批量字符串按空参数处理，与serializeBulkString对空串的编码一致
+                slices_.emplace_back(pos_, 0);
+                continue;
             }
-            
-            return Command(type, args);
-        } else {
-            CommandType type = Utils::stringToCommandType(cmd);
-            return Command(type, {});
+            bulk_len_ = len;
         }
+        // 批量字符串内容加CRLF
+        size_t need = static_cast<size_t>(bulk_len_) + 2;
+        if (data.size() - pos_ < need) {
+            return Result::INCOMPLETE;
+        }
+        if (data[pos_ + bulk_len_] != '\r' || data[pos_ + bulk_len_ + 1] != '\n') {
+            return fail("Protocol error: bulk string not terminated by CRLF");
+        }
+        slices_.emplace_back(pos_, static_cast<size_t>(bulk_len_));
+        pos_ += need;
+        bulk_len_ = -1;
+    }
+
+    args.reserve(slices_.size());
+    for (const auto& slice : slices_) {
+        args.emplace_back(data.data() + slice.first, slice.second);
     }
-    
-    return Command();
+    consumed_ = pos_;
+    reset();
+    return Result::COMPLETE;
 }
 
-std::string RESPProtocol::serializeResponse(const Response& response) {
-    switch (response.status) {
-        case ResponseStatus::OK:
-            return serializeSimpleString(response.message.empty() ? "OK" : response.message);
-        case ResponseStatus::ERROR:
-            return serializeError(response.message);
-        case ResponseStatus::NOT_FOUND:
-            return serializeNull();
-        case ResponseStatus::INVALID_COMMAND:
-            return serializeError("Invalid command");
-        default:
-            return serializeError("Unknown error");
+// RESPProtocol 实现
+
+Command RESPProtocol::buildCommand(const std::vector<std::string_view>& args) {
+    if (args.empty()) {
+        return Command();
+    }
+    CommandType type = Utils::stringToCommandType(args[0]);
+    std::vector<std::string> command_args;
+    command_args.reserve(args.size() - 1);
+    for (size_t i = 1; i < args.size(); ++i) {
+        command_args.emplace_back(args[i]);
+    }
+    return Command(type, std::move(command_args));
+}
+
+Command RESPProtocol::parseCommand(std::string_view data, size_t& pos) {
+    if (pos >= data.size()) {
+        return Command();
+    }
+    RESPStreamParser parser;
+    std::vector<std::string_view> args;
+    if (parser.parse(data.substr(pos), args) != RESPStreamParser::Result::COMPLETE) {
+        // 数据不完整或格式错误，余下部分无法继续解析
+        pos = data.size();
+        return Command();
     }
+    pos += parser.consumed();
+    return buildCommand(args);
+}
+
+Command RESPProtocol::parseInlineCommand(std::string_view line) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+        line.remove_suffix(1);
+    }
+    std::vector<std::string_view> args;
+    RESPStreamParser::splitInline(line, args);
+    return buildCommand(args);
+}
+
+std::string RESPProtocol::serializeResponse(const Response& response) {
+    std::string result;
+    RESPWriter(result).writeStatus(response);
+    return result;
 }
 
 std::string RESPProtocol::serializeSimpleString(const std::string& str) {
-    return "+" + str + "\r\n";
+    std::string result;
+    RESPWriter(result).writeSimpleString(str);
+    return result;
 }
 
 std::string RESPProtocol::serializeError(const std::string& error) {
-    return "-" + error + "\r\n";
+    std::string result;
+    RESPWriter(result).writeError(error);
+    return result;
 }
 
 std::string RESPProtocol::serializeInteger(int64_t value) {
-    return ":" + std::to_string(value) + "\r\n";
+    std::string result;
+    RESPWriter(result).writeInteger(value);
+    return result;
 }
 
 std::string RESPProtocol::serializeBulkString(const std::string& str) {
+    std::string result;
+    RESPWriter(result).writeBulkString(str);
+    return result;
+}
+
+std::string RESPProtocol::serializeArray(const std::vector<std::string>& array) {
+    std::string result;
+    RESPWriter(result).writeArray(array);
+    return result;
+}
+
+std::string RESPProtocol::serializeNull() {
+    return std::string(NULL_REPLY);
+}
+
+namespace {
+// 十进制位数，含负号
+size_t decimalDigits(int64_t value) {
+    char buffer[24];
+    return static_cast<size_t>(std::to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer);
+}
+} // namespace
+
+void RESPWriter::writeHeader(char prefix, int64_t value) {
+    char buffer[24];
+    buffer[0] = prefix;
+    char* end = std::to_chars(buffer + 1, buffer + sizeof(buffer) - 2, value).ptr;
+    *end++ = '\r';
+    *end++ = '\n';
+    out_.append(buffer, end - buffer);
+}
+
+void RESPWriter::writeSimpleString(std::string_view str) {
+    out_.push_back('+');
+    out_.append(str);
+    out_.append("\r\n", 2);
+}
+
+void RESPWriter::writeError(std::string_view error) {
+    out_.push_back('-');
+    out_.append(error);
+    out_.append("\r\n", 2);
+}
+
+void RESPWriter::writeInteger(int64_t value) {
+    writeHeader(':', value);
+}
+
+void RESPWriter::writeBulkString(std::string_view str) {
     if (str.empty()) {
-        return "$-1\r\n"; // NULL bulk string
+        writeNull();
+        return;
     }
-    return "$" + std::to_string(str.length()) + "\r\n" + str + "\r\n";
+    writeHeader('$', static_cast<int64_t>(str.size()));
+    out_.append(str);
+    out_.append("\r\n", 2);
 }
 
-std::string RESPProtocol::serializeArray(const std::vector<std::string>& array) {
-    std::string result = "*" + std::to_string(array.size()) + "\r\n";
+void RESPWriter::writeInvalidation(const std::vector<std::string>* keys) {
+    writeHeader('>', 2);
+    writeBulkString("invalidate");
+    if (!keys) {
+        out_.append("_\r\n", 3);
+        return;
+    }
+    writeHeader('*', static_cast<int64_t>(keys->size()));
+    for (const auto& key : *keys) {
+        // 空键也编码为长度为0的批量字符串，不能编码为空值
+        writeHeader('$', static_cast<int64_t>(key.size()));
+        out_.append(key);
+        out_.append("\r\n", 2);
+    }
+}
+
+void RESPWriter::writePubSubMessage(const std::string* pattern, std::string_view channel, std::string_view message) {
+    out_.reserve(out_.size() + 64 + (pattern ? pattern->size() : 0) + channel.size() + message.size());
+    writeHeader('>', pattern ? 4 : 3);
+    writeBulkString(pattern ? "pmessage" : "message");
+    // 空的频道名和消息编码为长度为0的批量字符串，不能编码为空值
+    if (pattern) {
+        writeHeader('$', static_cast<int64_t>(pattern->size()));
+        out_.append(*pattern);
+        out_.append("\r\n", 2);
+    }
+    writeHeader('$', static_cast<int64_t>(channel.size()));
+    out_.append(channel);
+    out_.append("\r\n", 2);
+    writeHeader('$', static_cast<int64_t>(message.size()));
+    out_.append(message);
+    out_.append("\r\n", 2);
+}
+
+void RESPWriter::writeArray(const std::vector<std::string>& array) {
+    out_.reserve(out_.size() + arraySize(array));
+    writeArrayElements(array);
+}
+
+void RESPWriter::writeArrayElements(const std::vector<std::string>& array) {
+    writeHeader('*', static_cast<int64_t>(array.size()));
     for (const auto& item : array) {
-        result += serializeBulkString(item);
+        writeBulkString(item);
     }
-    return result;
 }
 
-std::string RESPProtocol::serializeNull() {
-    return "$-1\r\n";
-}
-
-std::vector<std::string> RESPProtocol::parseArray(const std::string& data, size_t& pos) {
-    std::vector<std::string> result;
-    
-    if (pos >= data.length() || data[pos] != '*') {
-        return result;
-    }
-    
-    pos++; // 跳过 '*'
-    std::string count_str = readUntilCRLF(data, pos);
-    
-    // 处理特殊情况：*-1 表示空数组
-    if (count_str == "-1") {
-        return result; // 返回空数组
-    }
-    
-    int count = std::stoi(count_str);
-    
-    if (count < 0) {
-        return result; // 负数表示错误
-    }
-    
-    result.reserve(count);
-    
-    for (int i = 0; i < count; i++) {
-        if (pos >= data.length()) {
-            break;
-        }
-        
-        if (data[pos] == '+') {
-            pos++; // 跳过 '+'
-            std::string simple_str = readUntilCRLF(data, pos);
-            result.push_back(simple_str);
-        } else if (data[pos] == '-') {
-            pos++; // 跳过 '-'
-            std::string error_str = readUntilCRLF(data, pos);
-            result.push_back(error_str);
-        } else if (data[pos] == ':') {
-            pos++; // 跳过 ':'
-            std::string integer_str = readUntilCRLF(data, pos);
-            result.push_back(integer_str);
-        } else if (data[pos] == '*') {
-            // 嵌套数组
-            auto nested_array = parseArray(data, pos);
-            std::string nested_array_str = "[";
-            for (size_t j = 0; j < nested_array.size(); j++) {
-                nested_array_str += nested_array[j];
-                if (j < nested_array.size() - 1) {
-                    nested_array_str += ", ";
-                }
+void RESPWriter::writeStatus(const Response& response) {
+    switch (response.status) {
+        case ResponseStatus::OK:
+            if (response.message.empty()) {
+                out_.append(RESPProtocol::OK_REPLY);
+            } else {
+                writeSimpleString(response.message);
             }
-            nested_array_str += "]";
-            result.push_back(nested_array_str);
-        } else if (data[pos] == '$') {
-            std::string bulk_str = parseBulkString(data, pos);
-            result.push_back(bulk_str);
-        } else {
-            // 简单字符串
-            std::string simple_str = readUntilCRLF(data, pos);
-            result.push_back(simple_str);
-        }
+            break;
+        case ResponseStatus::ERROR:
+            writeError(response.message);
+            break;
+        case ResponseStatus::NOT_FOUND:
+            writeNull();
+            break;
+        case ResponseStatus::INVALID_COMMAND:
+            writeError("Invalid command");
+            break;
+        default:
+            writeError("Unknown error");
+            break;
     }
-    
-    return result;
 }
 
-std::string RESPProtocol::parseBulkString(const std::string& data, size_t& pos) {
-    if (pos >= data.length() || data[pos] != '$') {
-        return "";
+void RESPWriter::writeResponse(const Response& response) {
+    if (response.is_array) {
+        // 与把编码后的数组放在data中时的回复一致，但元素只编码一次
+        size_t size = arraySize(response.elements);
+        out_.reserve(out_.size() + size + 32);
+        writeHeader('$', static_cast<int64_t>(size));
+        writeArrayElements(response.elements);
+        out_.append("\r\n", 2);
+        return;
     }
-    
-    pos++; // 跳过 '$'
-    std::string length_str = readUntilCRLF(data, pos);
-    int length = std::stoi(length_str);
-    
-    if (length == -1) {
-        return ""; // NULL bulk string
+    if (response.data.empty()) {
+        writeStatus(response);
+        return;
     }
-    
-    if (pos + length >= data.length()) {
-        return "";
+    if (response.data.size() == 1 && (response.data[0] == '0' || response.data[0] == '1')) {
+        out_.append(response.data[0] == '0' ? RESPProtocol::ZERO_REPLY : RESPProtocol::ONE_REPLY);
+        return;
     }
-    
-    std::string result = data.substr(pos, length);
-    pos += length;
-    skipCRLF(data, pos);
-    
-    return result;
+    writeBulkString(response.data);
 }
 
-void RESPProtocol::skipCRLF(const std::string& data, size_t& pos) {
-    if (pos + 1 < data.length() && data[pos] == '\r' && data[pos + 1] == '\n') {
-        pos += 2;
+size_t RESPWriter::bulkStringSize(std::string_view str) {
+    if (str.empty()) {
+        return RESPProtocol::NULL_REPLY.size();
     }
+    return 1 + decimalDigits(static_cast<int64_t>(str.size())) + 2 + str.size() + 2;
 }
 
-std::string RESPProtocol::readUntilCRLF(const std::string& data, size_t& pos) {
-    size_t start = pos;
-    while (pos < data.length() && !(pos + 1 < data.length() && data[pos] == '\r' && data[pos + 1] == '\n')) {
-        pos++;
+size_t RESPWriter::arraySize(const std::vector<std::string>& array) {
+    size_t size = 1 + decimalDigits(static_cast<int64_t>(array.size())) + 2;
+    for (const auto& item : array) {
+        size += bulkStringSize(item);
     }
-    
-    std::string result = data.substr(start, pos - start);
-    skipCRLF(data, pos);
-    
-    return result;
+    return size;
 }
 
-} // namespace dkv
\ No newline at end of file
+} // namespace dkv
@@ -0,0 +1,55 @@
+#include "net/dkv_ring_buffer.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace dkv {
+
+namespace {
+// 容量超过初始容量的倍数时，数据读完后释放内存
+constexpr size_t SHRINK_FACTOR = 4;
+} // namespace
+
+RingBuffer::RingBuffer(size_t initial_capacity)
+    : initial_capacity_(initial_capacity == 0 ? DEFAULT_CAPACITY : initial_capacity) {
+}
+
+char* RingBuffer::prepareWrite(size_t min_bytes) {
+    if (capacity_ - tail_ >= min_bytes) {
+        return data_.get() + tail_;
+    }
+    size_t used = tail_ - head_;
+    if (data_ && capacity_ - used >= min_bytes) {
+        // 未读数据移回开头，只移动尚未解析完的部分
+        std::memmove(data_.get(), data_.get() + head_, used);
+    } else {
+        size_t new_capacity = std::max({capacity_ * 2, initial_capacity_, used + min_bytes});
+        std::unique_ptr<char[]> new_data(new char[new_capacity]);
+        if (used > 0) {
+            std::memcpy(new_data.get(), data_.get() + head_, used);
+        }
+        data_ = std::move(new_data);
+        capacity_ = new_capacity;
+    }
+    head_ = 0;
+    tail_ = used;
+    return data_.get() + tail_;
+}
+
+void RingBuffer::append(const char* data, size_t len) {
+    std::memcpy(prepareWrite(len), data, len);
+    commitWrite(len);
+}
+
+void RingBuffer::consume(size_t n) {
+    head_ += std::min(n, tail_ - head_);
+    if (head_ == tail_) {
+        head_ = 0;
+        tail_ = 0;
+        if (capacity_ > initial_capacity_ * SHRINK_FACTOR) {
+            data_.reset();
+            capacity_ = 0;
+        }
+    }
+}
+
+} // namespace dkv
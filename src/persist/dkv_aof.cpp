@@ -3,33 +3,57 @@
 #include "dkv_logger.hpp"
 #include "dkv_server.hpp"
 #include "dkv_datatypes.hpp"
+#include "persist/dkv_rdb.hpp"
+#include "persist/dkv_mapped_file.hpp"
 #include <filesystem>
 #include <chrono>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace dkv {
 
-AOFPersistence::AOFPersistence() : server_(nullptr),
+namespace {
+
+// 清单中文件的命名：<AOF文件名>.<序号>.base.rdb / <AOF文件名>.<序号>.incr.aof
+std::string aofPartName(const std::string& filename, uint64_t seq, AOFFileInfo::Type type) {
+    std::string prefix = std::filesystem::path(filename).filename().string();
+    return prefix + "." + std::to_string(seq) + (type == AOFFileInfo::Type::BASE ? ".base.rdb" : ".incr.aof");
+}
+
+// 同步目录，使其中的创建和rename落盘
+void syncDirectory(const std::string& path) {
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    int dir_fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+// 文件是否以RDB魔数开头
+bool isRDBFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[5] = {0};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && std::string(magic, sizeof(magic)) == "REDIS";
+}
+
+} // namespace
+
+AOFPersistence::AOFPersistence() : server_(nullptr), aof_fd_(-1),
     enabled_(false), recovering(false), 
-    fsync_policy_(FsyncPolicy::EVERYSEC), running_(false), 
+    fsync_policy_(FsyncPolicy::EVERYSEC), dirty_(false),
+    append_buffer_(APPEND_BUFFER_CAPACITY), running_(false), writer_sleeping_(false),
+    rewriting_(false), rewrite_rate_limit_(0),
     rewrite_check_running_(false),
     auto_rewrite_percentage_(100), auto_rewrite_min_size_mb_(64), last_rewrite_size_(0) {
 }
 
 AOFPersistence::~AOFPersistence() {
-    running_ = false;
-    
-    // 通知并重写检查线程
-    rewrite_check_running_ = false;
-    rewrite_check_cv_.notify_one();
-    
-    if (bg_fsync_thread_.joinable()) {
-        bg_fsync_thread_.join();
-    }
-    
-    if (bg_rewrite_check_thread_.joinable()) {
-        bg_rewrite_check_thread_.join();
-    }
-    
     close();
 }
 
@@ -47,25 +71,58 @@ bool AOFPersistence::initialize(const std::string& filename, FsyncPolicy fsync_p
     filename_ = filename;
     fsync_policy_ = fsync_policy;
     last_fsync_time_ = std::chrono::system_clock::now();
+    dirty_ = false;
+
+    // 读取清单；没有清单时把旧版单文件AOF作为基础文件
+    AOFManifest manifest;
+    bool manifest_changed = false;
+    if (std::filesystem::exists(getManifestFilename())) {
+        if (!readManifest(manifest)) {
+            DKV_LOG_ERROR("Invalid AOF manifest: ", getManifestFilename());
+            return false;
+        }
+    } else {
+        if (std::filesystem::exists(filename_)) {
+            manifest.base.name = std::filesystem::path(filename_).filename().string();
+            manifest.base.type = AOFFileInfo::Type::BASE;
+            DKV_LOG_INFO("Upgrading single-file AOF to manifest, base: ", filename_);
+        }
+        manifest_changed = true;
+    }
+    if (manifest.incrs.empty()) {
+        AOFFileInfo incr;
+        incr.seq = 1;
+        incr.name = aofPartName(filename_, incr.seq, AOFFileInfo::Type::INCR);
+        manifest.incrs.push_back(incr);
+        manifest_changed = true;
+    }
 
-    // 以追加模式打开文件，如果文件不存在则创建
-    aof_file_.open(filename_, std::ios::out | std::ios::app | std::ios::binary);
-    if (!aof_file_.is_open()) {
-        DKV_LOG_ERROR("Failed to open AOF file: ", filename_);
+    // 以追加模式打开当前增量文件，如果文件不存在则创建
+    aof_fd_ = openIncrFile(manifest.incrs.back());
+    if (aof_fd_ < 0) {
         return false;
     }
+    if (manifest_changed && !persistManifest(manifest)) {
+        ::close(aof_fd_);
+        aof_fd_ = -1;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        manifest_ = manifest;
+    }
 
     enabled_ = true;
     
-    // 如果是EVERYSEC策略，启动后台线程
-    if (fsync_policy_ == FsyncPolicy::EVERYSEC) {
-        running_ = true;
-        bg_fsync_thread_ = std::thread(&AOFPersistence::bgFsyncThreadFunc, this);
-    }
+    // 启动写线程
+    running_ = true;
+    writer_thread_ = std::thread(&AOFPersistence::writerThreadFunc, this);
     
     // 启动后台重写检查线程
-    rewrite_check_running_ = true;
-    bg_rewrite_check_thread_ = std::thread(&AOFPersistence::bgRewriteCheckThreadFunc, this);
+    if (!bg_rewrite_check_thread_.joinable()) {
+        rewrite_check_running_ = true;
+        bg_rewrite_check_thread_ = std::thread(&AOFPersistence::bgRewriteCheckThreadFunc, this);
+    }
     
     DKV_LOG_INFO("AOF initialized successfully with file: ", filename_);
     return true;
@@ -73,12 +130,39 @@ bool AOFPersistence::initialize(const std::string& filename, FsyncPolicy fsync_p
 
 void AOFPersistence::close() {
     if (enabled_) {
+        enabled_ = false;
+
+        // 停止重写检查线程，进行中的重写看到enabled_为false后放弃
+        {
+            std::lock_guard<std::mutex> lock(rewrite_check_mutex_);
+            rewrite_check_running_ = false;
+        }
+        rewrite_check_cv_.notify_one();
+        if (bg_rewrite_check_thread_.joinable()) {
+            bg_rewrite_check_thread_.join();
+        }
+        if (rewrite_thread_.joinable()) {
+            rewrite_thread_.join();
+        }
+
+        // 写线程退出前会写完缓冲区中的全部条目
+        running_ = false;
+        wakeWriter();
+        if (writer_thread_.joinable()) {
+            writer_thread_.join();
+        }
+        // 写线程退出后才放入的条目由这里写入，避免等待者永久阻塞
+        std::string batch;
+        std::vector<SyncWaiter*> waiters;
+        while (writeNextBatch(batch, waiters)) {
+        }
+
         std::lock_guard<std::mutex> lock(file_mutex_);
-        if (aof_file_.is_open()) {
-            aof_file_.flush();
-            aof_file_.close();
+        if (aof_fd_ >= 0) {
+            ::fdatasync(aof_fd_);
+            ::close(aof_fd_);
+            aof_fd_ = -1;
         }
-        enabled_ = false;
         DKV_LOG_INFO("AOF closed");
     }
 }
@@ -91,17 +175,7 @@ bool AOFPersistence::appendCommand(const Command& command) {
         return false; // 正在恢复中，忽略写入
     }
 
-    std::lock_guard<std::mutex> lock(file_mutex_);
-    if (!aof_file_.is_open()) {
-        DKV_LOG_ERROR("AOF file is not open");
-        return false;
-    }
-
-    bool result = writeCommandToFile(command);
-    if (result) {
-        fsyncIfNeeded();
-    }
-    return result;
+    return enqueue(serializeCommand(command));
 }
 
 bool AOFPersistence::appendCommands(const std::vector<Command>& commands) {
@@ -112,48 +186,187 @@ bool AOFPersistence::appendCommands(const std::vector<Command>& commands) {
         return false; // 正在恢复中，忽略写入
     }
 
-    std::lock_guard<std::mutex> lock(file_mutex_);
-    if (!aof_file_.is_open()) {
-        DKV_LOG_ERROR("AOF file is not open");
-        return false;
+    // 同一事务的命令作为一个条目放入缓冲区，由一次write写入。多条命令用MULTI/EXEC包围，
+    // 写入中途崩溃时文件末尾只有MULTI没有EXEC，重放时整个事务被丢弃
+    if (commands.empty()) {
+        return true;
+    }
+    std::string serialized;
+    const bool framed = commands.size() > 1;
+    if (framed) {
+        serialized += serializeCommand(Command(CommandType::MULTI, {}));
     }
-
-    bool result = true;
     for (const auto& command : commands) {
-        result &= writeCommandToFile(command);
-        if (!result) return false;
+        serialized += serializeCommand(command);
     }
-    if (result) {
-        fsyncIfNeeded();
+    if (framed) {
+        serialized += serializeCommand(Command(CommandType::EXEC, {}));
     }
-    return result;
+    return enqueue(std::move(serialized));
 }
 
+std::string AOFPersistence::serializeCommand(const Command& command) {
+    // 将命令转换为RESP协议格式的数组
+    std::vector<std::string> command_parts;
+    
+    // 添加命令类型对应的字符串
+    command_parts.push_back(Utils::commandTypeToString(command.type));
 
+    // 添加命令参数
+    command_parts.insert(command_parts.end(), command.args.begin(), command.args.end());
 
-bool AOFPersistence::writeCommandToFile(const Command& command) {
-    try {
-        // 将命令转换为RESP协议格式的数组
-        std::vector<std::string> command_parts;
-        
-        // 添加命令类型对应的字符串
-        command_parts.push_back(Utils::commandTypeToString(command.type));
+    // 序列化为RESP协议格式
+    return RESPProtocol::serializeArray(command_parts);
+}
 
-        // 添加命令参数
-        command_parts.insert(command_parts.end(), command.args.begin(), command.args.end());
+bool AOFPersistence::enqueue(std::string data) {
+    SyncWaiter waiter;
+    const bool wait_durable = fsync_policy_ == FsyncPolicy::ALWAYS;
+    AppendEntry entry{std::move(data), wait_durable ? &waiter : nullptr};
 
-        // 序列化为RESP协议格式
-        std::string serialized = RESPProtocol::serializeArray(command_parts);
+    // 缓冲区满说明写线程落后，唤醒它并让出CPU直到有空位
+    while (!append_buffer_.tryPush(std::move(entry))) {
+        wakeWriter();
+        std::this_thread::yield();
+    }
 
-        // 写入文件
-        aof_file_.write(serialized.c_str(), serialized.size());
-        aof_file_.flush();
+    // 与写线程进入休眠前的检查配对：要么这里看到休眠标志，要么写线程看到新条目
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writer_sleeping_.load()) {
+        wakeWriter();
+    }
 
+    if (!wait_durable) {
         return true;
-    } catch (const std::exception& e) {
-        DKV_LOG_ERROR("Error writing command to AOF: ", e.what());
+    }
+    std::unique_lock<std::mutex> lock(sync_mutex_);
+    sync_cv_.wait(lock, [&waiter] { return waiter.done; });
+    return waiter.ok;
+}
+
+void AOFPersistence::wakeWriter() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    writer_cv_.notify_one();
+}
+
+void AOFPersistence::writerThreadFunc() {
+    DKV_LOG_INFO("AOF writer thread started");
+
+    std::string batch;
+    std::vector<SyncWaiter*> waiters;
+    while (true) {
+        if (writeNextBatch(batch, waiters)) {
+            continue;
+        }
+        if (!running_) {
+            break;
+        }
+        syncIfDue();
+
+        // 缓冲区为空，等待新条目；超时醒来处理EVERYSEC的定时刷盘
+        std::unique_lock<std::mutex> lock(writer_mutex_);
+        writer_sleeping_.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (append_buffer_.empty() && running_) {
+            writer_cv_.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        writer_sleeping_.store(false);
+    }
+
+    DKV_LOG_INFO("AOF writer thread stopped");
+}
+
+bool AOFPersistence::writeNextBatch(std::string& batch, std::vector<SyncWaiter*>& waiters) {
+    batch.clear();
+    waiters.clear();
+
+    AppendEntry entry;
+    size_t count = 0;
+    while (count < WRITE_BATCH_ENTRIES && append_buffer_.tryPop(entry)) {
+        batch += entry.data;
+        if (entry.waiter != nullptr) {
+            waiters.push_back(entry.waiter);
+        }
+        ++count;
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    bool ok = writeToFile(batch, fsync_policy_ == FsyncPolicy::ALWAYS);
+    if (fsync_policy_ == FsyncPolicy::EVERYSEC) {
+        syncIfDue();
+    }
+
+    if (!waiters.empty()) {
+        std::lock_guard<std::mutex> lock(sync_mutex_);
+        for (SyncWaiter* waiter : waiters) {
+            waiter->ok = ok;
+            waiter->done = true;
+        }
+        sync_cv_.notify_all();
+    }
+    return true;
+}
+
+bool AOFPersistence::writeToFile(const std::string& data, bool sync) {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    if (aof_fd_ < 0) {
+        DKV_LOG_ERROR("AOF file is not open");
         return false;
     }
+
+    if (!writeAll(aof_fd_, data.data(), data.size())) {
+        DKV_LOG_ERROR("Error writing to AOF: ", std::strerror(errno));
+        return false;
+    }
+    dirty_ = true;
+
+    if (sync) {
+        auto start = LatencyMonitor::Clock::now();
+        if (::fdatasync(aof_fd_) != 0) {
+            DKV_LOG_ERROR("Error syncing AOF: ", std::strerror(errno));
+            return false;
+        }
+        fsync_latency_.record(LatencyMonitor::elapsedUs(start));
+        dirty_ = false;
+        last_fsync_time_.store(std::chrono::system_clock::now());
+    }
+    return true;
+}
+
+bool AOFPersistence::writeAll(int fd, const char* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = ::write(fd, data + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void AOFPersistence::syncIfDue() {
+    if (fsync_policy_ != FsyncPolicy::EVERYSEC || !dirty_) {
+        return;
+    }
+    auto now = std::chrono::system_clock::now();
+    if (now - last_fsync_time_.load() < std::chrono::seconds(1)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    auto start = LatencyMonitor::Clock::now();
+    if (aof_fd_ >= 0 && ::fdatasync(aof_fd_) == 0) {
+        fsync_latency_.record(LatencyMonitor::elapsedUs(start));
+        dirty_ = false;
+        last_fsync_time_.store(now);
+        DKV_LOG_DEBUG("Background fsync completed");
+    }
 }
 
 bool AOFPersistence::loadFromFile(DKVServer* server) {
@@ -165,244 +378,359 @@ bool AOFPersistence::loadFromFile(DKVServer* server) {
         return false;
     }
 
-    std::ifstream file(filename_, std::ios::in | std::ios::binary);
-    if (!file.is_open()) {
-        DKV_LOG_ERROR("Failed to open AOF file for loading: ", filename_);
+    AOFManifest manifest;
+    {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        manifest = manifest_;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    recovering = true;
+    bool success = true;
+    if (!manifest.base.name.empty()) {
+        const std::string base_path = pathOf(manifest.base.name);
+        // RDB格式的基础文件由RDB加载器并行批量恢复，不经过命令执行路径
+        if (isRDBFile(base_path)) {
+            success = server->getStorageEngine()->loadRDB(base_path);
+        } else {
+            success = replayFile(server, base_path);
+        }
+    }
+    // 只有增量文件需要逐条重放
+    for (const auto& incr : manifest.incrs) {
+        if (!success) {
+            break;
+        }
+        success = replayFile(server, pathOf(incr.name));
+    }
+    recovering = false;
+
+    if (success) {
+        DKV_LOG_INFO("AOF file loaded successfully in ", std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count(), "ms");
+    }
+    return success;
+}
+
+bool AOFPersistence::replayFile(DKVServer* server, const std::string& path) {
+    // 映射整个文件，直接在映射内存上解析命令
+    MappedFile file;
+    if (!file.open(path)) {
+        DKV_LOG_ERROR("Failed to open AOF file for loading: ", path);
         return false;
     }
 
+    // 单键命令按键所在分段分组，每个分段由一个线程按原顺序重放，不同分段并行；
+    // 涉及多个分段或没有键的命令作为屏障，先等已分组的命令重放完，再单独执行
+    StorageEngine* storage_engine = server->getStorageEngine();
+    const size_t segment_count = storage_engine->segmentCount();
+    const size_t thread_count = storage_engine->getRDBThreads();
+    std::vector<std::vector<Command>> pending(segment_count);
+    size_t pending_count = 0;
+    std::atomic<bool> failed{false};
+
+    auto replay = [server, &failed](const Command& command) {
+        try {
+            server->replayCommand(command);
+            DKV_LOG_DEBUG("Executing command from AOF: ", Utils::commandTypeToString(command.type));
+        } catch (const std::exception& e) {
+            DKV_LOG_ERROR("Error replaying AOF command: ", e.what());
+            failed = true;
+        }
+    };
+    auto flush = [&]() {
+        if (pending_count == 0) {
+            return;
+        }
+        auto worker = [&](size_t first) {
+            for (size_t segment = first; segment < segment_count; segment += thread_count) {
+                for (const auto& command : pending[segment]) {
+                    replay(command);
+                }
+                pending[segment].clear();
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < thread_count; ++t) {
+            threads.emplace_back(worker, t);
+        }
+        worker(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        pending_count = 0;
+    };
+
+    // MULTI与EXEC之间的事务命令，读到EXEC时作为屏障整体重放
+    std::vector<Command> transaction;
+    bool in_transaction = false;
+
     try {
-        recovering = true;
-        // 读取文件内容
-        std::string file_content((std::istreambuf_iterator<char>(file)),
-                                std::istreambuf_iterator<char>());
-        
+        const std::string_view content = file.view();
         size_t pos = 0;
-        while (pos < file_content.size()) {
+        size_t prefetched = 0;
+        while (pos < content.size() && !failed) {
+            // 解析位置接近已预读的末尾时，提示内核预读下一个窗口
+            if (pos + REPLAY_PREFETCH_BYTES / 2 >= prefetched) {
+                file.prefetch(prefetched, REPLAY_PREFETCH_BYTES);
+                prefetched += REPLAY_PREFETCH_BYTES;
+            }
             // 解析命令
-            Command command = RESPProtocol::parseCommand(file_content, pos);
+            Command command = RESPProtocol::parseCommand(content, pos);
             if (command.type == CommandType::UNKNOWN) {
                 DKV_LOG_WARNING("Failed to parse command in AOF file at position ", pos);
                 continue;
             }
+            if (command.type == CommandType::MULTI) {
+                in_transaction = true;
+                transaction.clear();
+                continue;
+            }
+            if (command.type == CommandType::EXEC) {
+                if (in_transaction) {
+                    flush();
+                    for (const auto& queued : transaction) {
+                        replay(queued);
+                    }
+                    transaction.clear();
+                    in_transaction = false;
+                }
+                continue;
+            }
+            // 其他事务控制命令对重放没有意义，跳过
+            if (commandSpec(command.type).hasFlag(CMD_TX_CONTROL)) {
+                continue;
+            }
+            if (in_transaction) {
+                transaction.push_back(std::move(command));
+                continue;
+            }
 
-            // 执行命令
-            server->executeCommand(command, NO_TX);
-
-            DKV_LOG_DEBUG("Executing command from AOF: ", Utils::commandTypeToString(command.type));
+            std::vector<Key> keys = command.keys();
+            bool single_segment = !keys.empty();
+            const size_t segment = single_segment ? storage_engine->segmentIndex(keys[0]) : 0;
+            for (size_t i = 1; i < keys.size() && single_segment; ++i) {
+                single_segment = storage_engine->segmentIndex(keys[i]) == segment;
+            }
+            if (single_segment && thread_count > 1) {
+                pending[segment].push_back(std::move(command));
+                if (++pending_count >= REPLAY_BATCH_COMMANDS) {
+                    flush();
+                }
+            } else {
+                flush();
+                replay(command);
+            }
         }
-
-        recovering = false; 
-        DKV_LOG_INFO("AOF file loaded successfully");
-        return true;
+        flush();
+        if (in_transaction) {
+            // 事务写入时崩溃，文件末尾的事务不完整，整体丢弃
+            DKV_LOG_WARNING("Discarding incomplete transaction at the end of AOF file ", path, " (",
+                            transaction.size(), " commands)");
+        }
+        return !failed;
     } catch (const std::exception& e) {
-        recovering = false; 
         DKV_LOG_ERROR("Error loading AOF file: ", e.what());
         return false;
     }
 }
 
-bool AOFPersistence::rewrite(StorageEngine* storage_engine, const std::string& temp_filename) {
+bool AOFPersistence::rewrite(StorageEngine* storage_engine) {
     if (!storage_engine || !enabled_) {
         DKV_LOG_ERROR("Invalid parameters for AOF rewrite");
         return false;
     }
+    if (rewriting_.exchange(true)) {
+        DKV_LOG_WARNING("AOF rewrite already in progress");
+        return false;
+    }
 
+    bool success = false;
     try {
-        // 创建临时文件
-        std::ofstream temp_file(temp_filename, std::ios::out | std::ios::binary);
-        if (!temp_file.is_open()) {
-            DKV_LOG_ERROR("Failed to create temporary file for AOF rewrite: ", temp_filename);
+        success = doRewrite(storage_engine);
+    } catch (const std::exception& e) {
+        DKV_LOG_ERROR("Error during AOF rewrite:", e.what());
+    }
+    rewriting_ = false;
+    return success;
+}
+
+bool AOFPersistence::doRewrite(StorageEngine* storage_engine) {
+    const auto start = std::chrono::steady_clock::now();
+
+    // 先切换到新的增量文件并持久化清单，再固定读取视图：视图之后执行的写入都在新增量文件中。
+    // 此时清单仍列出旧的基础文件和增量文件，重写中途失败或崩溃时可以照常加载
+    AOFFileInfo new_incr;
+    AOFFileInfo new_base;
+    {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        new_incr.seq = manifest_.incrs.back().seq + 1;
+        new_incr.name = aofPartName(filename_, new_incr.seq, AOFFileInfo::Type::INCR);
+        new_base.seq = manifest_.base.seq + 1;
+        new_base.name = aofPartName(filename_, new_base.seq, AOFFileInfo::Type::BASE);
+        new_base.type = AOFFileInfo::Type::BASE;
+
+        std::error_code ec;
+        std::filesystem::remove(pathOf(new_incr.name), ec);
+        int fd = openIncrFile(new_incr);
+        if (fd < 0) {
             return false;
         }
+        AOFManifest next = manifest_;
+        next.incrs.push_back(new_incr);
+        if (!persistManifest(next)) {
+            ::close(fd);
+            std::filesystem::remove(pathOf(new_incr.name), ec);
+            return false;
+        }
+        if (aof_fd_ >= 0) {
+            ::fdatasync(aof_fd_);
+            ::close(aof_fd_);
+        }
+        aof_fd_ = fd;
+        manifest_ = next;
+    }
 
-        // 获取所有键
-        std::vector<Key> keys = storage_engine->keys();
-        
-        // 遍历所有键，将当前状态写入临时文件
-        for (const auto& key : keys) {
-            // 使用公共API检查键是否存在
-            // 使用 0 作为特殊事务 ID，用于 AOF 重写
-            TransactionID tx_id = 0;
-            
-            if (!storage_engine->exists(tx_id, key)) {
-                continue;
-            }
-            
-            DataItem* item = storage_engine->getDataItem(tx_id, key);
-            if (!item) continue;
-            
-            // 根据数据类型执行不同的操作
-            if (dynamic_cast<StringItem*>(item)) {
-                // 处理字符串类型
-                std::string value = storage_engine->get(tx_id, key);
-                if (!value.empty()) {
-                    Command command(CommandType::SET, {key, value});
-                    // 写入临时文件
-                    std::vector<std::string> command_parts;
-                    command_parts.push_back(Utils::commandTypeToString(command.type));
-                    command_parts.insert(command_parts.end(), command.args.begin(), command.args.end());
-                    std::string serialized = RESPProtocol::serializeArray(command_parts);
-                    temp_file.write(serialized.c_str(), serialized.size());
-                    DKV_LOG_DEBUG("Rewriting string key: ", key);
-                }
-            } else if (dynamic_cast<HashItem*>(item)) {
-                // 处理哈希类型
-                std::vector<std::pair<Value, Value>> fields = storage_engine->hgetall(tx_id, key);
-                for (const auto& [field, value] : fields) {
-                    Command command(CommandType::HSET, {key, field, value});
-                    std::vector<std::string> command_parts;
-                    command_parts.push_back(Utils::commandTypeToString(command.type));
-                    command_parts.insert(command_parts.end(), command.args.begin(), command.args.end());
-                    std::string serialized = RESPProtocol::serializeArray(command_parts);
-                    temp_file.write(serialized.c_str(), serialized.size());
-                }
-                DKV_LOG_DEBUG("Rewriting hash key: ", key);
-            } else if (dynamic_cast<ListItem*>(item)) {
-                // 处理列表类型
-                std::vector<Value> elements = storage_engine->lrange(tx_id, key, 0, -1);
-                for (const auto& element : elements) {
-                    Command command(CommandType::RPUSH, {key, element});
-                    std::vector<std::string> command_parts;
-                    command_parts.push_back(Utils::commandTypeToString(command.type));
-                    command_parts.insert(command_parts.end(), command.args.begin(), command.args.end());
-                    std::string serialized = RESPProtocol::serializeArray(command_parts);
-                    temp_file.write(serialized.c_str(), serialized.size());
-                }
-                DKV_LOG_DEBUG("Rewriting list key: ", key);
-            } else if (dynamic_cast<SetItem*>(item)) {
-                // 处理集合类型
-                std::vector<Value> members = storage_engine->smembers(tx_id, key);
-                Command command(CommandType::SADD, {key});
-                command.args.insert(command.args.end(), members.begin(), members.end());
-                std::vector<std::string> command_parts;
-                command_parts.push_back(Utils::commandTypeToString(command.type));
-                command_parts.insert(command_parts.end(), command.args.begin(), command.args.end());
-                std::string serialized = RESPProtocol::serializeArray(command_parts);
-                temp_file.write(serialized.c_str(), serialized.size());
-                DKV_LOG_DEBUG("Rewriting set key: ", key);
-            } else if (dynamic_cast<ZSetItem*>(item)) {
-                // 处理有序集合类型
-                std::vector<std::pair<Value, double>> members_with_scores = storage_engine->zrange(tx_id, key, 0, -1);
-                for (const auto& [member, score] : members_with_scores) {
-                    Command command(CommandType::ZADD, {key, std::to_string(score), member});
-                    std::vector<std::string> command_parts;
-                    command_parts.push_back(Utils::commandTypeToString(command.type));
-                    command_parts.insert(command_parts.end(), command.args.begin(), command.args.end());
-                    std::string serialized = RESPProtocol::serializeArray(command_parts);
-                    temp_file.write(serialized.c_str(), serialized.size());
-                }
-                DKV_LOG_DEBUG("Rewriting zset key: ", key);
-            } else if (dynamic_cast<BitmapItem*>(item)) {
-                // 处理位图类型
-                BitmapItem* bitmap_item = dynamic_cast<BitmapItem*>(item);
-                if (bitmap_item) {
-                    size_t bitmap_size = bitmap_item->size() * 8; // 转换为位数
-                    
-                    // 遍历位图中的每一位
-                    for (size_t offset = 0; offset < bitmap_size; ++offset) {
-                        if (bitmap_item->getBit(offset)) {
-                            // 对于值为1的位，添加SETBIT命令
-                            Command command(CommandType::SETBIT, {key, std::to_string(offset), "1"});
-                            std::vector<std::string> command_parts;
-                            command_parts.push_back(Utils::commandTypeToString(command.type));
-                            command_parts.insert(command_parts.end(), command.args.begin(), command.args.end());
-                            std::string serialized = RESPProtocol::serializeArray(command_parts);
-                            temp_file.write(serialized.c_str(), serialized.size());
-                        }
-                    }
-                    DKV_LOG_DEBUG("Rewriting bitmap key: ", key, " with ", bitmap_item->bitCount(), " bits set");
-                }
-            } else if (dynamic_cast<HyperLogLogItem*>(item)) {
-                // 处理HyperLogLog类型
-                HyperLogLogItem* hll_item = dynamic_cast<HyperLogLogItem*>(item);
-                if (hll_item) {
-                    // 序列化HyperLogLog对象的状态
-                    std::string serialized = hll_item->serialize();
-                    
-                    // 写入特殊命令来恢复HyperLogLog状态
-                    // 注意：这需要在加载时特殊处理
-                    Command command(CommandType::RESTORE_HLL, {key, serialized});
-                    std::vector<std::string> command_parts;
-                    command_parts.push_back(Utils::commandTypeToString(command.type));
-                    command_parts.insert(command_parts.end(), command.args.begin(), command.args.end());
-                    std::string command_serialized = RESPProtocol::serializeArray(command_parts);
-                    temp_file.write(command_serialized.c_str(), command_serialized.size());
-                    
-                    DKV_LOG_DEBUG("Rewriting hyperloglog key: ", key, " with cardinality ", hll_item->count());
-                }
-            }
-            
-            // 如果键有过期时间，添加EXPIRE命令
-            if (item->hasExpiration()) {
-                auto now = Utils::getCurrentTime();
-                auto expire_time = item->getExpiration();
-                auto duration = std::chrono::duration_cast<std::chrono::seconds>(expire_time - now).count();
-                if (duration > 0) {
-                    Command expire_command(CommandType::EXPIRE, {key, std::to_string(duration)});
-                    std::vector<std::string> command_parts;
-                    command_parts.push_back(Utils::commandTypeToString(expire_command.type));
-                    command_parts.insert(command_parts.end(), expire_command.args.begin(), expire_command.args.end());
-                    std::string serialized = RESPProtocol::serializeArray(command_parts);
-                    temp_file.write(serialized.c_str(), serialized.size());
-                }
+    // 以只读事务固定快照的读取视图，由RDB保存并行写出新的基础文件
+    const std::string base_path = pathOf(new_base.name);
+    auto& transaction_manager = storage_engine->getTransactionManager();
+    const TransactionID snapshot_tx = transaction_manager->begin();
+    const ReadView read_view = transaction_manager->getTransaction(snapshot_tx).get_read_view();
+    bool ok = RDBPersistence::saveToFile(storage_engine, base_path, read_view, nullptr, rewrite_rate_limit_.load());
+    transaction_manager->commit(snapshot_tx);
+    if (ok) {
+        int base_fd = ::open(base_path.c_str(), O_RDONLY | O_CLOEXEC);
+        ok = base_fd >= 0 && ::fsync(base_fd) == 0;
+        if (base_fd >= 0) {
+            ::close(base_fd);
+        }
+    }
+    if (!ok || !enabled_) {
+        std::error_code ec;
+        std::filesystem::remove(base_path, ec);
+        return false;
+    }
+
+    // 替换清单：新的基础文件加切换之后的增量文件，之后删除被取代的文件
+    std::vector<std::string> obsolete;
+    {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        AOFManifest next;
+        next.base = new_base;
+        for (const auto& incr : manifest_.incrs) {
+            if (incr.seq >= new_incr.seq) {
+                next.incrs.push_back(incr);
+            } else {
+                obsolete.push_back(incr.name);
             }
         }
+        if (!persistManifest(next)) {
+            std::error_code ec;
+            std::filesystem::remove(base_path, ec);
+            return false;
+        }
+        if (!manifest_.base.name.empty()) {
+            obsolete.push_back(manifest_.base.name);
+        }
+        manifest_ = next;
+    }
+    for (const auto& name : obsolete) {
+        std::error_code ec;
+        std::filesystem::remove(pathOf(name), ec);
+    }
 
-        temp_file.flush();
-        temp_file.close();
+    // 更新上次重写后的文件大小
+    last_rewrite_size_ = getFileSize();
 
-        // 替换原AOF文件
-        std::filesystem::rename(temp_filename, filename_);
+    DKV_LOG_INFO("AOF rewrite completed successfully, base: ", base_path, " in ",
+                 std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(), "ms");
+    return true;
+}
 
-        // 更新上次重写后的文件大小
-        last_rewrite_size_ = getFileSize();
+std::string AOFPersistence::pathOf(const std::string& name) const {
+    return (std::filesystem::path(filename_).parent_path() / name).string();
+}
 
-        DKV_LOG_INFO("AOF rewrite completed successfully");
-        return true;
-    } catch (const std::exception& e) {
-        DKV_LOG_ERROR("Error during AOF rewrite:", e.what());
-        // 清理临时文件
-        try {
-            std::filesystem::remove(temp_filename);
-        } catch (...) {}
+bool AOFPersistence::readManifest(AOFManifest& manifest) const {
+    std::ifstream file(getManifestFilename());
+    if (!file.is_open()) {
         return false;
     }
+
+    // 每行一个文件：file <文件名> seq <序号> type <b|i>
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string file_tag, seq_tag, type_tag, type;
+        AOFFileInfo info;
+        if (!(fields >> file_tag >> info.name >> seq_tag >> info.seq >> type_tag >> type) ||
+            file_tag != "file" || seq_tag != "seq" || type_tag != "type" || type.size() != 1) {
+            return false;
+        }
+        if (type[0] == static_cast<char>(AOFFileInfo::Type::BASE)) {
+            info.type = AOFFileInfo::Type::BASE;
+            manifest.base = info;
+        } else if (type[0] == static_cast<char>(AOFFileInfo::Type::INCR)) {
+            info.type = AOFFileInfo::Type::INCR;
+            manifest.incrs.push_back(info);
+        } else {
+            return false;
+        }
+    }
+    return true;
 }
 
-void AOFPersistence::fsyncIfNeeded() {
-    switch (fsync_policy_) {
-        case FsyncPolicy::ALWAYS:
-            aof_file_.flush();
-            break;
-        case FsyncPolicy::EVERYSEC:
-            // EVERYSEC策略由后台线程处理，这里不做任何操作
-            break;
-        case FsyncPolicy::NEVER:
-        default:
-            // 不做任何操作
-            break;
+bool AOFPersistence::persistManifest(const AOFManifest& manifest) const {
+    std::string content;
+    auto append_line = [&content](const AOFFileInfo& info) {
+        content += "file " + info.name + " seq " + std::to_string(info.seq) + " type " +
+                   static_cast<char>(info.type) + "\n";
+    };
+    if (!manifest.base.name.empty()) {
+        append_line(manifest.base);
+    }
+    for (const auto& incr : manifest.incrs) {
+        append_line(incr);
+    }
+
+    const std::string manifest_path = getManifestFilename();
+    const std::string temp_path = manifest_path + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        DKV_LOG_ERROR("Failed to write AOF manifest: ", temp_path, ": ", std::strerror(errno));
+        return false;
+    }
+    bool ok = writeAll(fd, content.data(), content.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(temp_path.c_str(), manifest_path.c_str()) != 0) {
+        DKV_LOG_ERROR("Failed to write AOF manifest: ", manifest_path, ": ", std::strerror(errno));
+        std::remove(temp_path.c_str());
+        return false;
     }
+    syncDirectory(manifest_path);
+    return true;
 }
 
-void AOFPersistence::bgFsyncThreadFunc() {
-    DKV_LOG_INFO("Background fsync thread started");
-    
-    while (running_) {
-        // 每秒执行一次fsync
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        
-        if (enabled_ && !recovering) {
-            std::lock_guard<std::mutex> lock(file_mutex_);
-            if (aof_file_.is_open()) {
-                aof_file_.flush();
-                last_fsync_time_.store(std::chrono::system_clock::now());
-                DKV_LOG_DEBUG("Background fsync completed");
-            }
-        }
+int AOFPersistence::openIncrFile(const AOFFileInfo& info) const {
+    const std::string path = pathOf(info.name);
+    int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        DKV_LOG_ERROR("Failed to open AOF file: ", path, ": ", std::strerror(errno));
     }
-    
-    DKV_LOG_INFO("Background fsync thread stopped");
+    return fd;
+}
+
+std::string AOFPersistence::getBaseFilename() {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    return manifest_.base.name.empty() ? std::string() : pathOf(manifest_.base.name);
+}
+
+std::string AOFPersistence::getIncrFilename() {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    return manifest_.incrs.empty() ? std::string() : pathOf(manifest_.incrs.back().name);
 }
 
 void AOFPersistence::bgRewriteCheckThreadFunc() {
@@ -441,17 +769,21 @@ void AOFPersistence::asyncRewrite(DKVServer* server) {
         DKV_LOG_ERROR("Invalid parameters for async AOF rewrite");
         return;
     }
+    if (rewriting_) {
+        DKV_LOG_WARNING("AOF rewrite already in progress");
+        return;
+    }
     
-    // 创建并启动新线程执行重写
-    std::thread([this, server]() {
+    // 创建并启动新线程执行重写，线程由close等待结束
+    if (rewrite_thread_.joinable()) {
+        rewrite_thread_.join();
+    }
+    rewrite_thread_ = std::thread([this, server]() {
         DKV_LOG_INFO("Starting async AOF rewrite");
         
         try {
-            // 使用临时文件名
-            std::string temp_filename = filename_ + ".rewrite";
-            
             // 执行重写
-            if (rewrite(server->getStorageEngine(), temp_filename)) {
+            if (rewrite(server->getStorageEngine())) {
                 DKV_LOG_INFO("Async AOF rewrite completed successfully");
             } else {
                 DKV_LOG_ERROR("Async AOF rewrite failed");
@@ -461,7 +793,7 @@ void AOFPersistence::asyncRewrite(DKVServer* server) {
         }
         
         DKV_LOG_INFO("Async AOF rewrite thread completed");
-    }).detach(); // 使用detach使线程在后台独立运行
+    });
 }
 
 void AOFPersistence::setAutoRewriteParams(double percentage, size_t min_size_mb) {
@@ -504,19 +836,21 @@ bool AOFPersistence::shouldRewrite() {
 size_t AOFPersistence::getFileSize() {
     std::lock_guard<std::mutex> lock(file_mutex_);
     
-    // 保存当前文件位置
-    std::streampos current_pos = aof_file_.tellp();
-    
-    // 移动到文件末尾
-    aof_file_.seekp(0, std::ios::end);
-    
-    // 获取文件大小
-    std::streampos size = aof_file_.tellp();
-    
-    // 恢复到原来的位置
-    aof_file_.seekp(current_pos);
-    
-    return static_cast<size_t>(size);
+    size_t total = 0;
+    auto add_size = [this, &total](const std::string& name) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(pathOf(name), ec);
+        if (!ec) {
+            total += static_cast<size_t>(size);
+        }
+    };
+    if (!manifest_.base.name.empty()) {
+        add_size(manifest_.base.name);
+    }
+    for (const auto& incr : manifest_.incrs) {
+        add_size(incr.name);
+    }
+    return total;
 }
 
 } // namespace dkv
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "persist/dkv_mapped_file.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dkv {
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) {
+        // 长度为0的文件不能映射
+        ::close(fd);
+        data_ = fallback_.data();
+        return true;
+    }
+
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+        data_ = static_cast<const char*>(addr);
+        mapped_ = true;
+        madvise(addr, size_, MADV_SEQUENTIAL);
+        ::close(fd);
+        return true;
+    }
+
+    // 无法映射时用大块读取把整个文件读入内存
+    fallback_.resize(size_);
+    size_t done = 0;
+    while (done < size_) {
+        const ssize_t n = ::read(fd, &fallback_[done], size_ - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    if (done != size_) {
+        fallback_.clear();
+        size_ = 0;
+        return false;
+    }
+    data_ = fallback_.data();
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapped_) {
+        munmap(const_cast<char*>(data_), size_);
+        mapped_ = false;
+    }
+    fallback_.clear();
+    fallback_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t length) const {
+    if (!mapped_ || offset >= size_) {
+        return;
+    }
+    // madvise要求起始地址按页对齐
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = offset - offset % page_size;
+    const size_t end = std::min(size_, offset + length);
+    madvise(const_cast<char*>(data_) + begin, end - begin, MADV_WILLNEED);
+}
+
+} // namespace dkv
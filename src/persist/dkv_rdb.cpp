@@ -2,52 +2,180 @@
 #include "dkv_datatypes.hpp"
 #include "dkv_utils.hpp"
 #include "dkv_logger.hpp"
+#include "dkv_lzf.hpp"
 #include <iostream>
 #include <chrono>
 #include <sstream>
 #include <cstring>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 namespace dkv {
 
+namespace {
+
+// 文件头字节数：魔数、版本号、压缩算法
+constexpr uint64_t RDB_HEADER_SIZE = 9 + 2 * sizeof(int64_t);
+
+} // namespace
+
 // 保存数据到RDB文件
-// TODO: RDB保存已提交的事务数据项，如果最新版本未提交，则查询UNDOLOG
-bool RDBPersistence::saveToFile(StorageEngine* storage_engine, const std::string& filename) {
+bool RDBPersistence::saveToFile(StorageEngine* storage_engine, const std::string& filename, const ReadView& read_view,
+                                std::atomic<uint64_t>* saved_keys, size_t max_bytes_per_sec) {
     if (!storage_engine) {
         DKV_LOG_ERROR("Error: Storage engine is null");
         return false;
     }
     
-    std::ofstream file(filename, std::ios::binary);
+    const std::string temp_filename = filename + ".tmp";
+    std::ofstream file(temp_filename, std::ios::binary);
     if (!file.is_open()) {
-        DKV_LOG_ERROR("Error: Failed to open file ", filename.c_str(), " for writing");
+        DKV_LOG_ERROR("Error: Failed to open file ", temp_filename.c_str(), " for writing");
         return false;
     }
     
-    // 写入RDB文件头部
-    if (!writeHeader(file)) {
-        file.close();
+    const bool saved = saveToStream(storage_engine, file, read_view, saved_keys, max_bytes_per_sec);
+    file.close();
+    if (!saved || !file.good() || std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+        DKV_LOG_ERROR("Error: Failed to write RDB file ", filename.c_str());
+        std::remove(temp_filename.c_str());
+        return false;
+    }
+    DKV_LOG_INFO("Successfully saved data to RDB file: ", filename.c_str());
+    return true;
+}
+
+// 保存数据到输出流
+bool RDBPersistence::saveToStream(StorageEngine* storage_engine, std::ostream& file, const ReadView& read_view,
+                                  std::atomic<uint64_t>* saved_keys, size_t max_bytes_per_sec) {
+    if (!storage_engine) {
+        DKV_LOG_ERROR("Error: Storage engine is null");
         return false;
     }
     
-    // 获取所有未过期的键
-    std::vector<Key> keys = storage_engine->keys();
-    
-    // 写入键值对数量
-    writeInt(file, static_cast<int64_t>(keys.size()));
+    // 写入RDB文件头部
+    const RDBCompression compression = storage_engine->getRDBCompression();
+    if (!writeHeader(file, compression)) {
+        return false;
+    }
     
-    // 遍历所有键值对并写入文件
-    for (const auto& key : keys) {
-        DataItem* item = storage_engine->getDataItem(NO_TX, key);
-        if (item) {
-            if (!writeKeyValue(file, key, item)) {
-                file.close();
-                return false;
+    // 数据块按完成顺序追加到输出流，写入与块索引由write_mutex保护。
+    // 输出流不一定支持tellp（如内存或套接字），偏移由写入的字节数累计
+    std::mutex write_mutex;
+    std::vector<RDBChunkInfo> chunks;
+    std::vector<std::vector<uint32_t>> fingerprints; // 各数据块的键指纹，与chunks同序
+    uint64_t offset = RDB_HEADER_SIZE;
+    std::atomic<bool> failed{false};
+    std::atomic<size_t> next_segment{0};
+    const auto start = std::chrono::steady_clock::now();
+    
+    auto worker = [&]() {
+        std::ostringstream chunk;
+        uint64_t chunk_keys = 0;
+        std::vector<uint32_t> chunk_fingerprints;
+        std::string compressed;
+        auto flush_chunk = [&]() {
+            std::string buffer = chunk.str();
+            chunk.str("");
+            RDBChunkInfo info;
+            info.raw_length = buffer.size();
+            // 在写锁外压缩，各线程的压缩并行进行；压缩后不更小时保存原数据
+            if (compression == RDBCompression::LZF && buffer.size() > 1) {
+                compressed.resize(buffer.size() - 1);
+                const size_t len = lzf::compress(buffer.data(), buffer.size(), &compressed[0], compressed.size());
+                if (len > 0) {
+                    compressed.resize(len);
+                    buffer.swap(compressed);
+                }
+            }
+            info.length = buffer.size();
+            info.keys = chunk_keys;
+            info.crc = Utils::crc32(buffer.data(), buffer.size());
+            chunk_keys = 0;
+            std::lock_guard<std::mutex> lock(write_mutex);
+            info.offset = offset;
+            file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            if (!file.good()) {
+                failed = true;
+                return;
             }
+            offset += info.length;
+            chunks.push_back(info);
+            fingerprints.push_back(std::move(chunk_fingerprints));
+            chunk_fingerprints.clear();
+            if (saved_keys) {
+                saved_keys->fetch_add(info.keys);
+            }
+            if (max_bytes_per_sec > 0) {
+                // 持有写锁休眠，所有线程的写入共同受限
+                auto expected = std::chrono::microseconds(offset * 1000000 / max_bytes_per_sec);
+                auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                if (expected > elapsed) {
+                    std::this_thread::sleep_for(expected - elapsed);
+                }
+            }
+        };
+        // 磁盘上的值读取失败时serialize抛出异常，保存失败而不是写出空值
+        try {
+            for (size_t segment = next_segment++; segment < storage_engine->segmentCount() && !failed;
+                 segment = next_segment++) {
+                // 每批只在访问期间持有分段读锁，序列化结果累积到数据块，达到块大小或分段结束时写出
+                size_t cursor = 0;
+                do {
+                    cursor = storage_engine->scanSegment(read_view, segment, cursor, StorageEngine::RDB_SAVE_KEYS_PER_LOCK,
+                                                         [&](const SharedKey& key, const DataItem& item) {
+                        writeKeyValue(chunk, key, item);
+                        chunk_fingerprints.push_back(keyFingerprint(key));
+                        chunk_keys++;
+                    });
+                    if (chunk_keys >= RDB_KEYS_PER_CHUNK || (cursor == 0 && chunk_keys > 0)) {
+                        flush_chunk();
+                    }
+                } while (cursor != 0 && !failed);
+            }
+        } catch (const std::exception& e) {
+            DKV_LOG_ERROR("Error: Failed to serialize RDB data: ", e.what());
+            failed = true;
         }
+    };
+    
+    const size_t thread_count = storage_engine->getRDBThreads();
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
     }
     
-    file.close();
-    DKV_LOG_INFO("Successfully saved data to RDB file: ", filename.c_str());
+    if (!failed) {
+        // 写入键索引、块索引和文件尾
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            chunks[i].key_index_offset = offset;
+            const std::vector<uint32_t>& keys = fingerprints[i];
+            file.write(reinterpret_cast<const char*>(keys.data()), static_cast<std::streamsize>(keys.size() * sizeof(uint32_t)));
+            offset += keys.size() * sizeof(uint32_t);
+        }
+        const uint64_t index_offset = offset;
+        for (const auto& info : chunks) {
+            writeInt(file, static_cast<int64_t>(info.offset));
+            writeInt(file, static_cast<int64_t>(info.length));
+            writeInt(file, static_cast<int64_t>(info.keys));
+            writeInt(file, static_cast<int64_t>(info.crc));
+            writeInt(file, static_cast<int64_t>(info.raw_length));
+            writeInt(file, static_cast<int64_t>(info.key_index_offset));
+        }
+        writeInt(file, static_cast<int64_t>(index_offset));
+        writeInt(file, static_cast<int64_t>(chunks.size()));
+        file.flush();
+    }
+    if (failed || !file.good()) {
+        return false;
+    }
+    DKV_LOG_DEBUG("Saved RDB data, chunks: ", chunks.size(), ", threads: ", thread_count);
     return true;
 }
 
@@ -58,117 +186,310 @@ bool RDBPersistence::loadFromFile(StorageEngine* storage_engine, const std::stri
         return false;
     }
     
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
+    // 映射整个文件，直接在内存上解析
+    MappedFile file;
+    if (!file.open(filename)) {
         DKV_LOG_ERROR("Error: Failed to open file ", filename.c_str(), " for reading");
         return false;
     }
+    // 分块格式由多个线程按块认领，访问不再是整体顺序的，提前预读整个文件
+    file.prefetch(0, file.size());
     
-    // 读取RDB文件头部
-    if (!readHeader(file)) {
-        file.close();
+    const bool success = loadFromMemory(storage_engine, file.view(), filename);
+    if (success) {
+        DKV_LOG_INFO("Successfully loaded data from RDB file: ", filename.c_str());
+    }
+    return success;
+}
+
+// 从内存中的RDB数据加载
+bool RDBPersistence::loadFromMemory(StorageEngine* storage_engine, std::string_view data, const std::string& name) {
+    if (!storage_engine) {
+        DKV_LOG_ERROR("Error: Storage engine is null");
         return false;
     }
     
+    // 读取RDB文件头部
+    ByteReader reader(data);
+    const uint32_t version = readHeader(reader);
+    if (version == RDB_LEGACY_VERSION) {
+        return loadLegacy(reader, storage_engine);
+    }
+    std::vector<RDBChunkInfo> chunks;
+    uint32_t chunked_version = 0;
+    if (version == 0 || !readChunkIndex(data, name, chunked_version, chunks)) {
+        return false;
+    }
+    return loadChunked(data, name, chunks, storage_engine);
+}
+
+bool RDBPersistence::loadLegacy(ByteReader& reader, StorageEngine* storage_engine) {
     // 读取键值对数量
-    int64_t key_count = readInt(file);
+    int64_t key_count = readInt(reader);
     
     // 读取所有键值对
     for (int64_t i = 0; i < key_count; ++i) {
-        if (!readKeyValue(file, storage_engine)) {
-            file.close();
+        if (!readKeyValue(reader, storage_engine)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RDBPersistence::readChunkIndex(std::string_view file, const std::string& name, uint32_t& version,
+                                    std::vector<RDBChunkInfo>& chunks) {
+    ByteReader reader(file);
+    version = readHeader(reader);
+    if (version != RDB_VERSION && version != RDB_COMPRESSED_VERSION && version != RDB_UNCOMPRESSED_VERSION) {
+        return false;
+    }
+    RDBCompression compression = RDBCompression::NONE;
+    if (version != RDB_UNCOMPRESSED_VERSION) {
+        compression = static_cast<RDBCompression>(readInt(reader));
+        if (compression != RDBCompression::NONE && compression != RDBCompression::LZF) {
+            DKV_LOG_ERROR("Error: Unsupported RDB compression ", static_cast<int64_t>(compression), " in ", name.c_str());
             return false;
         }
     }
     
-    file.close();
-    DKV_LOG_INFO("Successfully loaded data from RDB file: ", filename.c_str());
+    // 从文件尾读取块索引
+    const int64_t file_size = static_cast<int64_t>(file.size());
+    const int64_t trailer_size = 2 * static_cast<int64_t>(sizeof(int64_t));
+    // 版本11的索引项多一个原始长度，版本12再多一个键索引偏移
+    const int64_t entry_fields = version == RDB_UNCOMPRESSED_VERSION ? 4 : (version == RDB_COMPRESSED_VERSION ? 5 : 6);
+    const int64_t entry_size = entry_fields * static_cast<int64_t>(sizeof(int64_t));
+    if (file_size < trailer_size) {
+        DKV_LOG_ERROR("Error: Truncated RDB file ", name.c_str());
+        return false;
+    }
+    reader.seek(static_cast<size_t>(file_size - trailer_size));
+    const int64_t index_offset = readInt(reader);
+    const int64_t chunk_count = readInt(reader);
+    if (!reader || index_offset < 0 || chunk_count < 0 ||
+        chunk_count > (file_size - trailer_size) / entry_size ||
+        index_offset + chunk_count * entry_size != file_size - trailer_size) {
+        DKV_LOG_ERROR("Error: Invalid RDB chunk index in ", name.c_str());
+        return false;
+    }
+    chunks.assign(static_cast<size_t>(chunk_count), RDBChunkInfo());
+    reader.seek(static_cast<size_t>(index_offset));
+    for (auto& info : chunks) {
+        info.offset = static_cast<uint64_t>(readInt(reader));
+        info.length = static_cast<uint64_t>(readInt(reader));
+        info.keys = static_cast<uint64_t>(readInt(reader));
+        info.crc = static_cast<uint32_t>(readInt(reader));
+        info.raw_length = entry_fields >= 5 ? static_cast<uint64_t>(readInt(reader)) : info.length;
+        info.key_index_offset = entry_fields >= 6 ? static_cast<uint64_t>(readInt(reader)) : 0;
+        const bool key_index_valid = entry_fields < 6 ||
+            (info.keys <= static_cast<uint64_t>(index_offset) / sizeof(uint32_t) &&
+             info.key_index_offset + info.keys * sizeof(uint32_t) <= static_cast<uint64_t>(index_offset));
+        if (!reader || info.offset + info.length > static_cast<uint64_t>(index_offset) || !key_index_valid ||
+            info.raw_length < info.length || (compression == RDBCompression::NONE && info.raw_length != info.length)) {
+            DKV_LOG_ERROR("Error: Invalid RDB chunk index in ", name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RDBPersistence::parseChunk(std::string_view file, const RDBChunkInfo& info, Timestamp now, std::string& buffer,
+                                std::vector<std::pair<Key, std::unique_ptr<DataItem>>>& items) {
+    // 直接在映射上校验和解析，未压缩的数据块不复制
+    std::string_view data = file.substr(info.offset, info.length);
+    if (Utils::crc32(data.data(), data.size()) != info.crc) {
+        return false;
+    }
+    if (info.raw_length != info.length) {
+        buffer.resize(info.raw_length);
+        if (lzf::decompress(data.data(), data.size(), &buffer[0], buffer.size()) != buffer.size()) {
+            return false;
+        }
+        data = buffer;
+    }
+    ByteReader chunk(data);
+    for (uint64_t k = 0; k < info.keys; ++k) {
+        Key key;
+        std::unique_ptr<DataItem> item;
+        if (!readItem(chunk, key, item)) {
+            return false;
+        }
+        // 保存后已过期的键不再加载
+        if (item->hasExpiration() && item->getExpiration() < now) {
+            continue;
+        }
+        items.emplace_back(std::move(key), std::move(item));
+    }
+    return true;
+}
+
+uint32_t RDBPersistence::keyFingerprint(std::string_view key) {
+    return Utils::crc32(key.data(), key.size());
+}
+
+bool RDBPersistence::loadChunked(std::string_view file, const std::string& filename, const std::vector<RDBChunkInfo>& chunks,
+                                 StorageEngine* storage_engine) {
+    // 第一阶段：各线程认领数据块，读取、校验并解析，按目标分段归类
+    using SegmentItems = std::vector<std::pair<Key, std::unique_ptr<DataItem>>>;
+    const size_t segments = storage_engine->segmentCount();
+    const size_t thread_count = std::max<size_t>(1, std::min(storage_engine->getRDBThreads(), chunks.size()));
+    std::vector<std::vector<SegmentItems>> parsed(thread_count);
+    for (auto& per_thread : parsed) {
+        per_thread.resize(segments);
+    }
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<bool> failed{false};
+    const Timestamp now = Utils::getCurrentTime();
+    
+    auto parse_worker = [&](size_t worker) {
+        std::string raw;
+        SegmentItems items;
+        for (size_t i = next_chunk++; i < chunks.size() && !failed; i = next_chunk++) {
+            if (!parseChunk(file, chunks[i], now, raw, items)) {
+                DKV_LOG_ERROR("Error: RDB chunk ", i, " is corrupted in ", filename.c_str());
+                failed = true;
+                return;
+            }
+            for (auto& pair : items) {
+                const size_t segment = storage_engine->segmentIndex(pair.first);
+                parsed[worker][segment].push_back(std::move(pair));
+            }
+            items.clear();
+        }
+    };
+    
+    // 第二阶段：每个线程把所有线程解析出的、属于自己负责分段的数据项批量写入
+    auto insert_worker = [&](size_t worker) {
+        for (size_t segment = worker; segment < segments; segment += thread_count) {
+            for (auto& per_thread : parsed) {
+                if (!per_thread[segment].empty()) {
+                    storage_engine->loadSegment(segment, per_thread[segment]);
+                }
+            }
+        }
+    };
+    
+    auto run_parallel = [thread_count](const std::function<void(size_t)>& fn) {
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < thread_count; ++i) {
+            threads.emplace_back(fn, i);
+        }
+        fn(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+    
+    run_parallel(parse_worker);
+    if (failed) {
+        return false;
+    }
+    run_parallel(insert_worker);
     return true;
 }
 
 // 写入RDB文件头部
-bool RDBPersistence::writeHeader(std::ofstream& file) {
+bool RDBPersistence::writeHeader(std::ostream& file, RDBCompression compression) {
     // 写入魔数
     file.write(RDB_MAGIC_STRING, strlen(RDB_MAGIC_STRING));
     
     // 写入版本号
     writeInt(file, RDB_VERSION);
     
+    // 写入数据块压缩算法
+    writeInt(file, static_cast<int64_t>(compression));
+    
     return file.good();
 }
 
 // 读取RDB文件头部
-bool RDBPersistence::readHeader(std::ifstream& file) {
+uint32_t RDBPersistence::readHeader(ByteReader& reader) {
     // 读取魔数
-    char magic[10];
-    file.read(magic, 9);
-    magic[9] = '\0';
-    
-    if (strcmp(magic, RDB_MAGIC_STRING) != 0) {
+    const std::string_view magic = reader.readBytes(9);
+    
+    uint32_t expected = 0;
+    if (magic == RDB_MAGIC_STRING) {
+        expected = RDB_VERSION;
+    } else if (magic == RDB_COMPRESSED_MAGIC_STRING) {
+        expected = RDB_COMPRESSED_VERSION;
+    } else if (magic == RDB_UNCOMPRESSED_MAGIC_STRING) {
+        expected = RDB_UNCOMPRESSED_VERSION;
+    } else if (magic == RDB_LEGACY_MAGIC_STRING) {
+        expected = RDB_LEGACY_VERSION;
+    } else {
         DKV_LOG_ERROR("Error: Invalid RDB file format");
-        return false;
+        return 0;
     }
     
     // 读取版本号
-    uint32_t version = static_cast<uint32_t>(readInt(file));
-    if (version != RDB_VERSION) {
-        DKV_LOG_ERROR("Error: Unsupported RDB version: ", version, ", expected:", RDB_VERSION);
-        return false;
+    uint32_t version = static_cast<uint32_t>(readInt(reader));
+    if (version != expected) {
+        DKV_LOG_ERROR("Error: Unsupported RDB version: ", version, ", expected:", expected);
+        return 0;
     }
     
-    return true;
+    return version;
+}
+
+// 写入分片迁移批量数据的键值对
+void RDBPersistence::writeBatchItem(std::ostream& items, std::string_view key, const DataItem& item) {
+    writeKeyValue(items, key, item);
+}
+
+// 组装分片迁移批量数据：魔数 版本号 键数 键值对...
+std::string RDBPersistence::finishBatch(const std::string& items, size_t count) {
+    std::ostringstream out;
+    out.write(RDB_LEGACY_MAGIC_STRING, strlen(RDB_LEGACY_MAGIC_STRING));
+    writeInt(out, RDB_LEGACY_VERSION);
+    writeInt(out, static_cast<int64_t>(count));
+    out.write(items.data(), items.size());
+    return out.str();
 }
 
 // 写入单个键值对
-bool RDBPersistence::writeKeyValue(std::ofstream& file, const Key& key, DataItem* item) {
-    if (!item) {
-        return false;
-    }
-    
+void RDBPersistence::writeKeyValue(std::ostream& file, std::string_view key, const DataItem& item) {
     // 写入数据类型
-    writeInt(file, static_cast<int64_t>(item->getType()));
+    writeInt(file, static_cast<int64_t>(item.getType()));
     
     // 写入键
     writeString(file, key);
     
     // 写入过期时间信息
-    writeInt(file, item->hasExpiration() ? 1 : 0);
-    if (item->hasExpiration()) {
-        auto duration = item->getExpiration().time_since_epoch();
+    writeInt(file, item.hasExpiration() ? 1 : 0);
+    if (item.hasExpiration()) {
+        auto duration = item.getExpiration().time_since_epoch();
         auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
         writeInt(file, seconds);
     }
     
     // 写入序列化的数据
-    std::string serialized_data = item->serialize();
-    writeString(file, serialized_data);
-    
-    return file.good();
+    writeString(file, item.serialize());
 }
 
 // 读取单个键值对
-bool RDBPersistence::readKeyValue(std::ifstream& file, StorageEngine* storage_engine) {
+bool RDBPersistence::readItem(ByteReader& reader, Key& key, std::unique_ptr<DataItem>& item) {
     // 读取数据类型
-    int64_t type_int = readInt(file);
+    int64_t type_int = readInt(reader);
     DataType type = static_cast<DataType>(type_int);
     
     // 读取键
-    std::string key = readString(file);
+    key = readString(reader);
     
     // 读取过期时间信息
-    int64_t has_expiration = readInt(file);
+    int64_t has_expiration = readInt(reader);
     Timestamp expire_time;
     bool has_expire = (has_expiration == 1);
     if (has_expire) {
-        int64_t seconds = readInt(file);
+        int64_t seconds = readInt(reader);
         expire_time = Timestamp(std::chrono::seconds(seconds));
     }
     
     // 读取序列化的数据
-    std::string serialized_data = readString(file);
+    std::string serialized_data = readString(reader);
+    if (!reader) {
+        return false;
+    }
     
     // 根据数据类型创建相应的DataItem并调用deserialize
-    std::unique_ptr<DataItem> item;
     switch (type) {
         case DataType::STRING:
             item = std::make_unique<StringItem>();
@@ -182,7 +503,20 @@ bool RDBPersistence::readKeyValue(std::ifstream& file, StorageEngine* storage_en
         case DataType::SET:
             item = std::make_unique<SetItem>();
             break;
+        case DataType::ZSET:
+            item = std::make_unique<ZSetItem>();
+            break;
+        case DataType::BITMAP:
+            item = std::make_unique<BitmapItem>();
+            break;
+        case DataType::HYPERLOGLOG:
+            item = std::make_unique<HyperLogLogItem>();
+            break;
+        case DataType::BLOOM:
+            item = std::make_unique<BloomFilterItem>();
+            break;
         default:
+            DKV_LOG_ERROR("Error: Failed to create DataItem of type ", static_cast<int>(type));
             return false;
     }
     
@@ -193,11 +527,18 @@ bool RDBPersistence::readKeyValue(std::ifstream& file, StorageEngine* storage_en
     if (has_expire) {
         item->setExpiration(expire_time);
     }
-    
-    if (!item) {
-        DKV_LOG_ERROR("Error: Failed to create DataItem of type ", static_cast<int>(type));
+    return true;
+}
+
+bool RDBPersistence::readKeyValue(ByteReader& reader, StorageEngine* storage_engine) {
+    Key key;
+    std::unique_ptr<DataItem> item;
+    if (!readItem(reader, key, item)) {
         return false;
     }
+    const DataType type = item->getType();
+    const bool has_expire = item->hasExpiration();
+    const Timestamp expire_time = item->getExpiration();
     
     // 将数据项添加到存储引擎
     // 注意：这里需要根据不同的数据类型调用不同的方法
@@ -275,36 +616,35 @@ bool RDBPersistence::readKeyValue(std::ifstream& file, StorageEngine* storage_en
 }
 
 // 写入字符串（长度前缀）
-void RDBPersistence::writeString(std::ofstream& file, const std::string& str) {
+void RDBPersistence::writeString(std::ostream& file, std::string_view str) {
     // 写入字符串长度
     writeInt(file, static_cast<int64_t>(str.length()));
     
     // 写入字符串内容
-    file.write(str.c_str(), str.length());
+    file.write(str.data(), str.length());
 }
 
 // 读取字符串（长度前缀）
-std::string RDBPersistence::readString(std::ifstream& file) {
+std::string RDBPersistence::readString(ByteReader& reader) {
     // 读取字符串长度
-    int64_t length = readInt(file);
-    
-    // 读取字符串内容
-    std::string str(length, '\0');
-    file.read(&str[0], length);
+    int64_t length = readInt(reader);
+    if (!reader || length < 0) {
+        reader.fail();
+        return std::string();
+    }
     
-    return str;
+    // 由映射中的字节直接构造字符串
+    return std::string(reader.readBytes(static_cast<size_t>(length)));
 }
 
 // 写入整数
-void RDBPersistence::writeInt(std::ofstream& file, int64_t value) {
+void RDBPersistence::writeInt(std::ostream& file, int64_t value) {
     file.write(reinterpret_cast<const char*>(&value), sizeof(value));
 }
 
 // 读取整数
-int64_t RDBPersistence::readInt(std::ifstream& file) {
-    int64_t value;
-    file.read(reinterpret_cast<char*>(&value), sizeof(value));
-    return value;
+int64_t RDBPersistence::readInt(ByteReader& reader) {
+    return reader.read<int64_t>();
 }
 
 } // namespace dkv
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "persist/dkv_rdb_loader.hpp"
+#include "storage/dkv_storage.hpp"
+#include "dkv_utils.hpp"
+#include "dkv_logger.hpp"
+#include <algorithm>
+
+namespace dkv {
+
+RDBLoader::RDBLoader(StorageEngine* storage_engine) : storage_engine_(storage_engine) {}
+
+RDBLoader::~RDBLoader() {
+    stopping_ = true;
+    joinThreads();
+}
+
+bool RDBLoader::start(const std::string& filename, size_t threads) {
+    if (!file_.open(filename)) {
+        return false;
+    }
+    uint32_t version = 0;
+    if (!RDBPersistence::readChunkIndex(file_.view(), filename, version, chunks_) || version != RDB_VERSION) {
+        // 旧版本没有键索引，无法按键载入
+        file_.close();
+        chunks_.clear();
+        return false;
+    }
+    filename_ = filename;
+
+    // 汇总各数据块的键指纹，按指纹排序后二分查找
+    for (const auto& info : chunks_) {
+        total_keys_ += info.keys;
+    }
+    key_index_.reserve(total_keys_);
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        ByteReader reader(file_.view());
+        reader.seek(chunks_[i].key_index_offset);
+        for (uint64_t k = 0; k < chunks_[i].keys; ++k) {
+            key_index_.emplace_back(reader.read<uint32_t>(), static_cast<uint32_t>(i));
+        }
+    }
+    std::sort(key_index_.begin(), key_index_.end());
+
+    states_ = std::make_unique<std::atomic<uint8_t>[]>(chunks_.size());
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        states_[i].store(CHUNK_PENDING, std::memory_order_relaxed);
+    }
+    now_ = Utils::getCurrentTime();
+    start_time_ = std::chrono::steady_clock::now();
+    remaining_ = chunks_.size();
+    if (chunks_.empty()) {
+        complete();
+        return true;
+    }
+    loading_ = true;
+    // 按文件顺序读取，提示内核顺序预读
+    file_.prefetch(0, file_.size());
+
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+        threads_.emplace_back(&RDBLoader::backgroundThread, this);
+    }
+    DKV_LOG_INFO("开始后台加载RDB文件 ", filename.c_str(), "，数据块数: ", chunks_.size(), "，键数: ", total_keys_);
+    return true;
+}
+
+void RDBLoader::loadKeys(const std::vector<Key>& keys) {
+    if (!loading()) {
+        return;
+    }
+    // 先在读锁内查出数据块，载入时不持有读锁：载入最后一个数据块的线程要获取写锁释放索引
+    std::vector<uint32_t> pending;
+    {
+        std::shared_lock<std::shared_mutex> lock(index_mutex_);
+        for (const auto& key : keys) {
+            const uint32_t fingerprint = RDBPersistence::keyFingerprint(key);
+            auto it = std::lower_bound(key_index_.begin(), key_index_.end(), std::make_pair(fingerprint, uint32_t(0)));
+            // 指纹相同的其他键所在的数据块也一并载入，不影响正确性
+            for (; it != key_index_.end() && it->first == fingerprint; ++it) {
+                if (states_[it->second].load(std::memory_order_acquire) != CHUNK_LOADED) {
+                    pending.push_back(it->second);
+                }
+            }
+        }
+    }
+    for (uint32_t index : pending) {
+        loadChunk(index, true);
+    }
+}
+
+void RDBLoader::loadChunk(size_t index, bool on_demand) {
+    uint8_t expected = CHUNK_PENDING;
+    if (!states_[index].compare_exchange_strong(expected, CHUNK_LOADING, std::memory_order_acq_rel)) {
+        if (expected == CHUNK_LOADING) {
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            wait_cv_.wait(lock, [&]() { return states_[index].load(std::memory_order_acquire) == CHUNK_LOADED; });
+        }
+        return;
+    }
+
+    const RDBChunkInfo& info = chunks_[index];
+    using SegmentItems = std::vector<std::pair<Key, std::unique_ptr<DataItem>>>;
+    SegmentItems items;
+    std::string buffer;
+    if (!RDBPersistence::parseChunk(file_.view(), info, now_, buffer, items)) {
+        DKV_LOG_ERROR("Error: RDB chunk ", index, " is corrupted in ", filename_.c_str(), ", skipped");
+        failed_chunks_++;
+        items.clear();
+    }
+    // 数据块中的键保存时属于同一分段，分段数改变后按当前分段重新归类
+    std::vector<SegmentItems> segments(storage_engine_->segmentCount());
+    for (auto& pair : items) {
+        segments[storage_engine_->segmentIndex(pair.first)].push_back(std::move(pair));
+    }
+    for (size_t segment = 0; segment < segments.size(); ++segment) {
+        if (!segments[segment].empty()) {
+            storage_engine_->loadSegment(segment, segments[segment]);
+        }
+    }
+    loaded_keys_ += info.keys;
+    loaded_chunks_++;
+    if (on_demand) {
+        demand_chunks_++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        states_[index].store(CHUNK_LOADED, std::memory_order_release);
+    }
+    wait_cv_.notify_all();
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        complete();
+    }
+}
+
+void RDBLoader::complete() {
+    {
+        std::unique_lock<std::shared_mutex> lock(index_mutex_);
+        std::vector<std::pair<uint32_t, uint32_t>>().swap(key_index_);
+    }
+    elapsed_ms_ = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time_).count());
+    loading_.store(false, std::memory_order_release);
+    DKV_LOG_INFO("RDB文件 ", filename_.c_str(), " 后台加载完成，耗时: ", elapsed_ms_.load(), "ms，按需载入的数据块: ",
+                 demand_chunks_.load(), "，跳过的数据块: ", failed_chunks_.load());
+}
+
+void RDBLoader::backgroundThread() {
+    for (size_t i = next_chunk_++; i < chunks_.size() && !stopping_; i = next_chunk_++) {
+        loadChunk(i, false);
+    }
+}
+
+void RDBLoader::finish() {
+    if (loading()) {
+        for (size_t i = 0; i < chunks_.size(); ++i) {
+            loadChunk(i, false);
+        }
+    }
+    joinThreads();
+}
+
+void RDBLoader::joinThreads() {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+    // 所有数据块都已载入，不再读取文件
+    if (!loading()) {
+        file_.close();
+    }
+}
+
+RDBLoadStats RDBLoader::getStats() const {
+    RDBLoadStats stats;
+    stats.loading = loading();
+    stats.total_chunks = chunks_.size();
+    stats.loaded_chunks = loaded_chunks_.load();
+    stats.demand_chunks = demand_chunks_.load();
+    stats.failed_chunks = failed_chunks_.load();
+    stats.total_keys = total_keys_;
+    stats.loaded_keys = loaded_keys_.load();
+    stats.elapsed_ms = stats.loading ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time_).count()) : elapsed_ms_.load();
+    return stats;
+}
+
+} // namespace dkv
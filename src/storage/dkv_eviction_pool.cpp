@@ -0,0 +1,39 @@
+#include "storage/dkv_eviction_pool.hpp"
+#include <algorithm>
+
+namespace dkv {
+
+EvictionPool::EvictionPool(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {
+    entries_.reserve(capacity_ + 1);
+}
+
+void EvictionPool::offer(std::string_view key, uint64_t score) {
+    auto existing = std::find_if(entries_.begin(), entries_.end(), [&key](const std::pair<uint64_t, Key>& entry) {
+        return entry.second == key;
+    });
+    if (existing != entries_.end()) {
+        entries_.erase(existing);
+    } else if (entries_.size() >= capacity_ && score <= entries_.front().first) {
+        return;
+    }
+    auto pos = std::upper_bound(entries_.begin(), entries_.end(), score,
+                                [](uint64_t value, const std::pair<uint64_t, Key>& entry) {
+        return value < entry.first;
+    });
+    entries_.emplace(pos, score, Key(key));
+    if (entries_.size() > capacity_) {
+        // 淘汰分数最低的候选
+        entries_.erase(entries_.begin());
+    }
+}
+
+bool EvictionPool::pop(Key& key) {
+    if (entries_.empty()) {
+        return false;
+    }
+    key = std::move(entries_.back().second);
+    entries_.pop_back();
+    return true;
+}
+
+} // namespace dkv
@@ -0,0 +1,44 @@
+#include "storage/dkv_expire_index.hpp"
+
+namespace dkv {
+
+void ExpireIndex::add(const Key& key, Timestamp expire_time) {
+    auto it = deadlines_.find(key);
+    if (it != deadlines_.end()) {
+        if (it->second == expire_time) {
+            return;
+        }
+        order_.erase({it->second, key});
+        it->second = expire_time;
+    } else {
+        deadlines_.emplace(key, expire_time);
+    }
+    order_.emplace(expire_time, key);
+}
+
+void ExpireIndex::remove(const Key& key) {
+    auto it = deadlines_.find(key);
+    if (it == deadlines_.end()) {
+        return;
+    }
+    order_.erase({it->second, key});
+    deadlines_.erase(it);
+}
+
+bool ExpireIndex::popDue(Timestamp now, Key& key) {
+    // 与DataItem::isExpired一致，过期时间早于now才算到期
+    if (!hasDue(now)) {
+        return false;
+    }
+    auto node = order_.extract(order_.begin());
+    deadlines_.erase(node.value().second);
+    key = std::move(node.value().second);
+    return true;
+}
+
+void ExpireIndex::clear() {
+    order_.clear();
+    deadlines_.clear();
+}
+
+} // namespace dkv
@@ -1,26 +1,50 @@
 #include "storage/dkv_inner_storage.hpp"
 #include "dkv_datatypes.hpp"
+#include "dkv_trace.hpp"
 #include <algorithm>
+#include <functional>
 #include <mutex>
 #include <cassert>
 
 namespace dkv {
 
+InnerStorage::InnerStorage(size_t segment_count) : mvcc_(*this) {
+    if (segment_count == 0) {
+        segment_count = 1;
+    }
+    segments_.reserve(segment_count);
+    for (size_t i = 0; i < segment_count; ++i) {
+        segments_.push_back(std::make_unique<Segment>());
+    }
+}
+
+size_t InnerStorage::segmentIndex(std::string_view key) const {
+    size_t h = std::hash<std::string_view>{}(key);
+    // 混合高位，避免与分段内哈希表的桶分布相关
+    h ^= (h >> 32);
+    h ^= (h >> 16);
+    return h % segments_.size();
+}
+
 // 获取数据项
-DataItem* InnerStorage::get(const Key& key) const {
-    auto it = data_.find(key);
-    return it != data_.end() ? it->second.get() : nullptr;
+DataItem* InnerStorage::get(std::string_view key) const {
+    const DataMap& data = segmentOf(key).data;
+    auto it = data.find(key);
+    return it != data.end() ? it->second.get() : nullptr;
 }
 
-DataItem* InnerStorage::get(const Key& key, const ReadView& read_view) const {
+DataItem* InnerStorage::get(std::string_view key, const ReadView& read_view) const {
     // 使用MVCC获取可见版本
     return mvcc_.get(read_view, key);
 }
 
 bool InnerStorage::set(TransactionID tx_id, const Key& key, std::unique_ptr<DataItem> item) {
+    if (item && item->hasExpiration()) {
+        trackExpiration(key, item->getExpiration());
+    }
     if (tx_id == NO_TX) {
         // 非事务操作，直接存储
-        data_[key] = std::move(item);
+        segmentOf(key).data[key] = std::move(item);
         return true;
     }
     // 事务操作，使用MVCC
@@ -30,93 +54,378 @@ bool InnerStorage::set(TransactionID tx_id, const Key& key, std::unique_ptr<Data
 bool InnerStorage::del(TransactionID tx_id, const Key& key) {
     if (tx_id == NO_TX) {
         // 非事务操作，直接删除
-        return data_.erase(key) > 0;
+        Segment& segment = segmentOf(key);
+        segment.expires.remove(key);
+        return segment.data.erase(key) > 0;
     }
     // 事务操作，使用MVCC
     return mvcc_.del(tx_id, key);
 }
 
-bool InnerStorage::exists(const Key& key) const {
-    auto it = data_.find(key);
-    return it != data_.end() && !it->second->isDeleted();
+std::unique_ptr<DataItem> InnerStorage::detach(const Key& key) {
+    Segment& segment = segmentOf(key);
+    auto it = segment.data.find(key);
+    if (it == segment.data.end()) {
+        return nullptr;
+    }
+    segment.expires.remove(key);
+    std::unique_ptr<DataItem> item = std::move(it->second);
+    segment.data.erase(it);
+    return item;
+}
+
+DataItem* InnerStorage::prepareWrite(TransactionID tx_id, const Key& key, const ReadView& read_view,
+                                     DataType type, UndoLog*& delta) {
+    return mvcc_.prepareWrite(tx_id, key, read_view, type, delta);
 }
 
-bool InnerStorage::exists(const Key& key, const ReadView& read_view) const {
+bool InnerStorage::exists(std::string_view key) const {
+    DataItem* item = get(key);
+    return item != nullptr && !item->isDeleted();
+}
+
+bool InnerStorage::exists(std::string_view key, const ReadView& read_view) const {
     // 事务操作，使用MVCC
     auto item = mvcc_.get(read_view, key);
     return item != nullptr && !item->isDeleted();
 }
 
 std::unique_ptr<DataItem>& InnerStorage::getRefOrInsert(const Key& key) {
-    return data_[key];
+    return segmentOf(key).data[key];
+}
+
+bool InnerStorage::insert_or_assign(const Key& key, std::unique_ptr<DataItem> item) {
+    if (item && item->hasExpiration()) {
+        trackExpiration(key, item->getExpiration());
+    }
+    return segmentOf(key).data.insert_or_assign(key, std::move(item));
 }
 
 // 容器操作
 void InnerStorage::clear() {
-    data_.clear();
+    for (auto& segment : segments_) {
+        segment->data.clear();
+        segment->expires.clear();
+    }
+}
+
+std::vector<std::unique_ptr<InnerStorage::DataMap>> InnerStorage::detachAll() {
+    std::vector<std::unique_ptr<DataMap>> tables;
+    tables.reserve(segments_.size());
+    for (auto& segment : segments_) {
+        auto table = std::make_unique<DataMap>();
+        table->swap(segment->data);
+        segment->expires.clear();
+        tables.push_back(std::move(table));
+    }
+    return tables;
+}
+
+void InnerStorage::trackExpiration(const Key& key, Timestamp expire_time) {
+    segmentOf(key).expires.add(key, expire_time);
 }
 
 size_t InnerStorage::size() const {
-    return data_.size();
+    size_t total = 0;
+    for (const auto& segment : segments_) {
+        total += segment->data.size();
+    }
+    return total;
 }
 
-std::vector<Key> InnerStorage::getAllKeys() const {
-    std::vector<Key> keys;
-    keys.reserve(data_.size());
-    for (const auto& pair : data_) {
-        keys.push_back(pair.first);
+std::vector<SharedKey> InnerStorage::getAllKeys() const {
+    std::vector<SharedKey> keys;
+    keys.reserve(size());
+    for (const auto& segment : segments_) {
+        for (const auto& pair : segment->data) {
+            keys.push_back(pair.first);
+        }
     }
     return keys;
 }
 
-// 迭代器相关操作
-std::unordered_map<Key, std::unique_ptr<DataItem>>::const_iterator InnerStorage::find(const Key& key) const {
-    return data_.find(key);
+bool InnerStorage::rehashStep(size_t index, size_t groups) {
+    return segments_[index]->data.rehashStep(groups);
 }
 
-std::unordered_map<Key, std::unique_ptr<DataItem>>::const_iterator InnerStorage::begin() const {
-    return data_.begin();
+bool InnerStorage::expireStep(size_t index, Timestamp now, size_t max_keys, size_t& expired, LazyFreer* freer) {
+    Segment& segment = *segments_[index];
+    Key key;
+    for (size_t i = 0; i < max_keys && segment.expires.popDue(now, key); ++i) {
+        auto it = segment.data.find(key);
+        if (it == segment.data.end()) {
+            continue;
+        }
+        if (it->second->isExpired()) {
+            if (freer) {
+                freer->free(std::move(it->second));
+            }
+            segment.data.erase(it);
+            expired++;
+        } else if (it->second->hasExpiration()) {
+            // 过期时间已被延长，按新的过期时间重新登记
+            segment.expires.add(key, it->second->getExpiration());
+        }
+    }
+    return segment.expires.hasDue(now);
 }
 
-std::unordered_map<Key, std::unique_ptr<DataItem>>::const_iterator InnerStorage::end() const {
-    return data_.end();
+KeyspaceStats InnerStorage::getKeyspaceStats() const {
+    KeyspaceStats stats;
+    stats.segments = segments_.size();
+    for (const auto& segment : segments_) {
+        auto lock = lockElided() ? std::shared_lock<SegmentMutex>(segment->mutex, std::defer_lock)
+                                 : std::shared_lock<SegmentMutex>(segment->mutex);
+        stats.capacity += segment->data.capacity();
+        if (segment->data.isRehashing()) {
+            stats.rehashing_segments++;
+            stats.rehash_pending_slots += segment->data.rehashPendingSlots();
+        }
+        stats.volatile_keys += segment->expires.size();
+    }
+    return stats;
 }
 
-std::unique_ptr<DataItem>& InnerStorage::operator[](const Key& key) {
-    return data_[key];
+// 锁操作方法
+// 恢复模式下或当前线程持有KeyspaceLock时返回未持有锁的对象
+thread_local const InnerStorage* InnerStorage::keyspace_holder_ = nullptr;
+
+std::unique_lock<SegmentMutex> InnerStorage::wlock(const Key& key) const {
+    if (lockElided()) {
+        // KeyspaceLock持有期间执行的命令同样要先保存快照内容
+        if (keyspace_holder_ == this && capturing()) {
+            captureKey(segmentIndex(key), key);
+        }
+        return std::unique_lock<SegmentMutex>(segmentOf(key).mutex, std::defer_lock);
+    }
+    std::unique_lock<SegmentMutex> lock(segmentOf(key).mutex, std::defer_lock);
+    {
+        TraceSpan span("segment_wlock");
+        lock.lock();
+    }
+    if (capturing()) {
+        captureKey(segmentIndex(key), key);
+    }
+    return lock;
 }
 
-std::unordered_map<Key, std::unique_ptr<DataItem>>::iterator InnerStorage::erase(std::unordered_map<Key, std::unique_ptr<DataItem>>::iterator it) {
-    return data_.erase(it);
+std::shared_lock<SegmentMutex> InnerStorage::rlock(const Key& key) const {
+    if (lockElided()) {
+        return std::shared_lock<SegmentMutex>(segmentOf(key).mutex, std::defer_lock);
+    }
+    TraceSpan span("segment_rlock");
+    return std::shared_lock<SegmentMutex>(segmentOf(key).mutex);
 }
 
-std::unordered_map<Key, std::unique_ptr<DataItem>>::iterator InnerStorage::erase(std::unordered_map<Key, std::unique_ptr<DataItem>>::const_iterator it) {
-    return data_.erase(it);
+std::unique_lock<SegmentMutex> InnerStorage::wlockSegment(size_t index) const {
+    if (lockElided()) {
+        return std::unique_lock<SegmentMutex>(segments_[index]->mutex, std::defer_lock);
+    }
+    TraceSpan span("segment_wlock");
+    return std::unique_lock<SegmentMutex>(segments_[index]->mutex);
 }
 
-std::pair<std::unordered_map<Key, std::unique_ptr<DataItem>>::iterator, bool> InnerStorage::insert_or_assign(const Key& key, std::unique_ptr<DataItem> item) {
-    return data_.insert_or_assign(key, std::move(item));
+std::shared_lock<SegmentMutex> InnerStorage::rlockSegment(size_t index) const {
+    if (lockElided()) {
+        return std::shared_lock<SegmentMutex>(segments_[index]->mutex, std::defer_lock);
+    }
+    TraceSpan span("segment_rlock");
+    return std::shared_lock<SegmentMutex>(segments_[index]->mutex);
 }
 
-// 锁操作方法
-std::unique_lock<std::shared_mutex> InnerStorage::wlock() const {
-    return std::unique_lock<std::shared_mutex>(mutex_);
+namespace {
+// 计算多个键涉及的分段序号，升序去重
+template <typename IndexFn>
+std::vector<size_t> sortedSegmentIndexes(const std::vector<Key>& keys, IndexFn index_of) {
+    std::vector<size_t> indexes;
+    indexes.reserve(keys.size());
+    for (const auto& key : keys) {
+        indexes.push_back(index_of(key));
+    }
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+    return indexes;
 }
+} // namespace
 
-std::shared_lock<std::shared_mutex> InnerStorage::rlock() const {
-    return std::shared_lock<std::shared_mutex>(mutex_);
+std::vector<std::unique_lock<SegmentMutex>> InnerStorage::wlockKeys(const std::vector<Key>& keys) const {
+    std::vector<std::unique_lock<SegmentMutex>> locks;
+    if (!lockElided()) {
+        auto indexes = sortedSegmentIndexes(keys, [this](const Key& key) { return segmentIndex(key); });
+        locks.reserve(indexes.size());
+        for (size_t index : indexes) {
+            TraceSpan span("segment_wlock");
+            locks.emplace_back(segments_[index]->mutex);
+        }
+    } else if (keyspace_holder_ != this) {
+        return locks;
+    }
+    if (capturing()) {
+        for (const auto& key : keys) {
+            captureKey(segmentIndex(key), key);
+        }
+    }
+    return locks;
+}
+
+std::vector<std::shared_lock<SegmentMutex>> InnerStorage::rlockKeys(const std::vector<Key>& keys) const {
+    std::vector<std::shared_lock<SegmentMutex>> locks;
+    if (lockElided()) {
+        return locks;
+    }
+    auto indexes = sortedSegmentIndexes(keys, [this](const Key& key) { return segmentIndex(key); });
+    locks.reserve(indexes.size());
+    for (size_t index : indexes) {
+        TraceSpan span("segment_rlock");
+        locks.emplace_back(segments_[index]->mutex);
+    }
+    return locks;
+}
+
+std::vector<std::unique_lock<SegmentMutex>> InnerStorage::wlockAll() const {
+    std::vector<std::unique_lock<SegmentMutex>> locks;
+    if (!lockElided()) {
+        locks = lockAllSegments();
+    } else if (keyspace_holder_ != this) {
+        return locks;
+    }
+    if (capturing()) {
+        for (size_t index = 0; index < segments_.size(); ++index) {
+            captureSegment(index);
+        }
+    }
+    return locks;
 }
 
-std::unique_lock<std::shared_mutex> InnerStorage::wlock_deferred() const {
-    return std::unique_lock<std::shared_mutex>(mutex_, std::defer_lock);
+std::vector<std::unique_lock<SegmentMutex>> InnerStorage::lockAllSegments() const {
+    std::vector<std::unique_lock<SegmentMutex>> locks;
+    locks.reserve(segments_.size());
+    for (const auto& segment : segments_) {
+        locks.emplace_back(segment->mutex);
+    }
+    return locks;
+}
+
+std::vector<std::shared_lock<SegmentMutex>> InnerStorage::rlockAll() const {
+    std::vector<std::shared_lock<SegmentMutex>> locks;
+    if (lockElided()) {
+        return locks;
+    }
+    locks.reserve(segments_.size());
+    for (const auto& segment : segments_) {
+        locks.emplace_back(segment->mutex);
+    }
+    return locks;
+}
+
+void InnerStorage::captureKey(size_t index, std::string_view key) const {
+    Segment& segment = *segments_[index];
+    if (segment.capture != CaptureState::PENDING) {
+        return;
+    }
+    auto it = segment.data.find(key);
+    SharedKey handle = it != segment.data.end() ? it->first : SharedKey(key);
+    if (segment.emitted.count(handle) > 0 || segment.saved.count(handle) > 0) {
+        return;
+    }
+    // 与RDB遍历相同，只保存读取视图可见且未过期的版本；快照开始后新建的键保存为空，遍历时跳过
+    std::unique_ptr<DataItem> copy;
+    const DataItem* item = it != segment.data.end() && it->second ? mvcc_.get(capture_view_, key) : nullptr;
+    if (item && !item->isExpired() && !item->isDeleted()) {
+        copy = item->clone();
+    }
+    segment.saved.emplace(std::move(handle), std::move(copy));
+}
+
+void InnerStorage::captureSegment(size_t index) const {
+    Segment& segment = *segments_[index];
+    if (segment.capture != CaptureState::PENDING) {
+        return;
+    }
+    for (const auto& pair : segment.data) {
+        captureKey(index, pair.first);
+    }
+}
+
+void InnerStorage::beginCapture(const ReadView& read_view) {
+    auto locks = wlockAll();
+    capture_view_ = read_view;
+    for (auto& segment : segments_) {
+        segment->capture = CaptureState::PENDING;
+    }
+    capture_active_.store(true, std::memory_order_release);
+}
+
+size_t InnerStorage::scanCapture(size_t index, size_t cursor, size_t count,
+                                 const std::function<void(const SharedKey&, const DataItem&)>& fn) const {
+    Segment& segment = *segments_[index];
+    // 游标为数据表游标加1，0留作开始
+    size_t table_cursor = cursor == 0 ? 0 : cursor - 1;
+    {
+        auto lock = rlockSegment(index);
+        size_t outputs = 0;
+        size_t visits = count * 10;
+        do {
+            table_cursor = segment.data.scan(table_cursor, [&](const KeyTable::value_type& pair) {
+                // 已输出的键在rehash后可能再次遍历到，写者保存过的键在最后输出
+                if (!pair.second || segment.emitted.count(pair.first) > 0 || segment.saved.count(pair.first) > 0) {
+                    return;
+                }
+                segment.emitted.insert(pair.first);
+                const DataItem* item = mvcc_.get(capture_view_, pair.first);
+                if (item && !item->isExpired() && !item->isDeleted()) {
+                    fn(pair.first, *item);
+                    outputs++;
+                }
+            });
+        } while (table_cursor != 0 && outputs < count && --visits > 0);
+    }
+    if (table_cursor != 0) {
+        return table_cursor + 1;
+    }
+    // 数据表中的键都已输出或保存，此后写者不再保存本分段
+    SavedItems saved;
+    std::unordered_set<SharedKey> emitted;
+    {
+        auto lock = wlockSegment(index);
+        saved.swap(segment.saved);
+        emitted.swap(segment.emitted);
+        segment.capture = CaptureState::NONE;
+    }
+    for (const auto& pair : saved) {
+        if (pair.second) {
+            fn(pair.first, *pair.second);
+        }
+    }
+    return 0;
+}
+
+void InnerStorage::endCapture() {
+    // 先停止保存，再清除未取走的内容
+    capture_active_.store(false, std::memory_order_release);
+    std::vector<SavedItems> leftover;
+    std::vector<std::unordered_set<SharedKey>> emitted;
+    {
+        auto locks = wlockAll();
+        for (auto& segment : segments_) {
+            leftover.push_back(std::move(segment->saved));
+            segment->saved.clear();
+            emitted.push_back(std::move(segment->emitted));
+            segment->emitted.clear();
+            segment->capture = CaptureState::NONE;
+        }
+        capture_view_ = ReadView();
+    }
 }
 
-std::shared_lock<std::shared_mutex> InnerStorage::rlock_deferred() const {
-    return std::shared_lock<std::shared_mutex>(mutex_, std::defer_lock);
+KeyspaceLock::KeyspaceLock(const InnerStorage& storage)
+    : previous_holder_(InnerStorage::keyspace_holder_),
+      locks_(storage.lockElided() ? std::vector<std::unique_lock<SegmentMutex>>() : storage.lockAllSegments()) {
+    InnerStorage::keyspace_holder_ = &storage;
 }
 
-std::shared_mutex& InnerStorage::getMutex() const {
-    return mutex_;
+KeyspaceLock::~KeyspaceLock() {
+    InnerStorage::keyspace_holder_ = previous_holder_;
 }
 
-} // namespace dkv
\ No newline at end of file
+} // namespace dkv
@@ -0,0 +1,413 @@
+#include "storage/dkv_key_table.hpp"
+#include "dkv_page_memory.hpp"
+#include <cstring>
+#include <functional>
+#include <new>
+#include <cassert>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace dkv {
+
+namespace {
+
+// 组内匹配结果，第i位为1表示第i个槽位匹配
+using GroupMask = uint32_t;
+
+#if defined(__SSE2__)
+inline GroupMask matchByte(const int8_t* group, int8_t value) {
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<GroupMask>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value))));
+}
+
+// 空槽和删除槽的控制字节最高位为1
+inline GroupMask matchEmptyOrDeleted(const int8_t* group) {
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<GroupMask>(_mm_movemask_epi8(ctrl));
+}
+#else
+inline GroupMask matchByte(const int8_t* group, int8_t value) {
+    GroupMask mask = 0;
+    for (size_t i = 0; i < KeyTable::GROUP_WIDTH; ++i) {
+        if (group[i] == value) {
+            mask |= GroupMask(1) << i;
+        }
+    }
+    return mask;
+}
+
+inline GroupMask matchEmptyOrDeleted(const int8_t* group) {
+    GroupMask mask = 0;
+    for (size_t i = 0; i < KeyTable::GROUP_WIDTH; ++i) {
+        if (group[i] < 0) {
+            mask |= GroupMask(1) << i;
+        }
+    }
+    return mask;
+}
+#endif
+
+inline size_t lowestBit(GroupMask mask) {
+    return static_cast<size_t>(__builtin_ctz(mask));
+}
+
+inline int8_t h2Of(size_t hash) {
+    return static_cast<int8_t>(hash & 0x7F);
+}
+
+inline size_t h1Of(size_t hash) {
+    return hash >> 7;
+}
+
+inline size_t reverseBits(size_t v) {
+    size_t r = 0;
+    for (size_t i = 0; i < sizeof(size_t) * 8; ++i, v >>= 1) {
+        r = (r << 1) | (v & 1);
+    }
+    return r;
+}
+
+// 只递增mask覆盖的位，从高位向低位进位
+inline size_t nextCursor(size_t cursor, size_t mask) {
+    cursor |= ~mask;
+    cursor = reverseBits(cursor);
+    cursor++;
+    return reverseBits(cursor);
+}
+
+} // namespace
+
+KeyTable::~KeyTable() {
+    release(old_);
+    release(table_);
+}
+
+size_t KeyTable::hashKey(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+// 按组做三角数探测，组数为2的幂时可遍历所有组
+size_t KeyTable::findIndex(const Table& table, std::string_view key, size_t hash) {
+    if (table.capacity == 0 || table.size == 0) {
+        return table.capacity;
+    }
+    const size_t group_mask = table.capacity / GROUP_WIDTH - 1;
+    const int8_t h2 = h2Of(hash);
+    size_t group = h1Of(hash) & group_mask;
+    for (size_t step = 1; step <= group_mask + 1; ++step) {
+        const size_t base = group * GROUP_WIDTH;
+        const int8_t* ctrl = table.ctrl.get() + base;
+        for (GroupMask mask = matchByte(ctrl, h2); mask != 0; mask &= mask - 1) {
+            size_t index = base + lowestBit(mask);
+            if (table.slots[index].first.view() == key) {
+                return index;
+            }
+        }
+        // 组内存在空槽说明探测链到此结束
+        if (matchByte(ctrl, CTRL_EMPTY) != 0) {
+            break;
+        }
+        group = (group + step) & group_mask;
+    }
+    return table.capacity;
+}
+
+size_t KeyTable::findInsertSlot(const Table& table, size_t hash) {
+    const size_t group_mask = table.capacity / GROUP_WIDTH - 1;
+    size_t group = h1Of(hash) & group_mask;
+    for (size_t step = 1; ; ++step) {
+        const size_t base = group * GROUP_WIDTH;
+        GroupMask mask = matchEmptyOrDeleted(table.ctrl.get() + base);
+        if (mask != 0) {
+            return base + lowestBit(mask);
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+void KeyTable::allocate(Table& table, size_t capacity) {
+    table.ctrl.reset(new int8_t[capacity]);
+    std::memset(table.ctrl.get(), static_cast<unsigned char>(CTRL_EMPTY), capacity);
+    // 大表的槽位数组用大页映射，随机探测时减少TLB未命中；键空间被所有线程访问，不绑定NUMA节点
+    const size_t bytes = sizeof(value_type) * capacity;
+    table.mapped = false;
+    if (PageMemory::hugePageMode() != HugePageMode::OFF && bytes >= PageMemory::HUGE_PAGE_SIZE) {
+        table.slots = static_cast<value_type*>(PageMemory::map(bytes));
+        table.mapped = table.slots != nullptr;
+    }
+    if (!table.mapped) {
+        table.slots = static_cast<value_type*>(::operator new(bytes));
+    }
+    table.capacity = capacity;
+    table.size = 0;
+    table.growth_left = maxLoad(capacity);
+}
+
+void KeyTable::release(Table& table) {
+    for (size_t i = 0; i < table.capacity && table.size > 0; ++i) {
+        if (table.ctrl[i] >= 0) {
+            table.slots[i].~value_type();
+            table.size--;
+        }
+    }
+    if (table.mapped) {
+        PageMemory::unmap(table.slots, sizeof(value_type) * table.capacity);
+    } else {
+        ::operator delete(table.slots);
+    }
+    table.slots = nullptr;
+    table.mapped = false;
+    table.ctrl.reset();
+    table.capacity = 0;
+    table.size = 0;
+    table.growth_left = 0;
+}
+
+void KeyTable::eraseAt(Table& table, size_t index) {
+    table.slots[index].~value_type();
+    const size_t base = index / GROUP_WIDTH * GROUP_WIDTH;
+    // 组内已有空槽时，没有探测链会越过本组，可直接置空
+    if (matchByte(table.ctrl.get() + base, CTRL_EMPTY) != 0) {
+        table.ctrl[index] = CTRL_EMPTY;
+        table.growth_left++;
+    } else {
+        table.ctrl[index] = CTRL_DELETED;
+    }
+    table.size--;
+}
+
+size_t KeyTable::nextFull(size_t from) const {
+    for (; from < table_.capacity; ++from) {
+        if (table_.ctrl[from] >= 0) {
+            return from;
+        }
+    }
+    for (; from < endIndex(); ++from) {
+        if (old_.ctrl[from - table_.capacity] >= 0) {
+            return from;
+        }
+    }
+    return endIndex();
+}
+
+KeyTable::value_type& KeyTable::slotAt(size_t index) const {
+    if (index < table_.capacity) {
+        return table_.slots[index];
+    }
+    return old_.slots[index - table_.capacity];
+}
+
+size_t KeyTable::locate(std::string_view key, size_t hash) const {
+    size_t index = findIndex(table_, key, hash);
+    if (index != table_.capacity) {
+        return index;
+    }
+    if (isRehashing()) {
+        index = findIndex(old_, key, hash);
+        if (index != old_.capacity) {
+            return table_.capacity + index;
+        }
+    }
+    return endIndex();
+}
+
+void KeyTable::eraseIndex(size_t index) {
+    if (index < table_.capacity) {
+        eraseAt(table_, index);
+    } else {
+        eraseAt(old_, index - table_.capacity);
+    }
+}
+
+void KeyTable::startRehash(size_t new_capacity) {
+    // 上一轮迁移未完成时先补完，保证最多只有两张表
+    finishRehash();
+    old_ = std::move(table_);
+    table_ = Table();
+    allocate(table_, new_capacity);
+    migrate_group_ = 0;
+    if (old_.size == 0) {
+        release(old_);
+    }
+}
+
+void KeyTable::finishRehash() {
+    while (rehashStep(old_.capacity / GROUP_WIDTH)) {
+    }
+}
+
+bool KeyTable::rehashStep(size_t groups) {
+    if (!isRehashing()) {
+        return false;
+    }
+    const size_t total_groups = old_.capacity / GROUP_WIDTH;
+    for (size_t n = 0; n < groups && migrate_group_ < total_groups && old_.size > 0; ++n, ++migrate_group_) {
+        const size_t base = migrate_group_ * GROUP_WIDTH;
+        for (size_t i = base; i < base + GROUP_WIDTH; ++i) {
+            if (old_.ctrl[i] < 0) {
+                continue;
+            }
+            size_t hash = hashKey(old_.slots[i].first);
+            size_t index = findInsertSlot(table_, hash);
+            if (table_.ctrl[index] == CTRL_EMPTY) {
+                table_.growth_left--;
+            }
+            table_.ctrl[index] = h2Of(hash);
+            new (&table_.slots[index]) value_type(std::move(old_.slots[i]));
+            table_.size++;
+            old_.slots[i].~value_type();
+            // 迁移后的槽位标记为删除，不截断旧表中其它键的探测链
+            old_.ctrl[i] = CTRL_DELETED;
+            old_.size--;
+        }
+    }
+    if (migrate_group_ >= total_groups || old_.size == 0) {
+        release(old_);
+        migrate_group_ = 0;
+        return false;
+    }
+    return true;
+}
+
+size_t KeyTable::insertNew(SharedKey key, size_t hash) {
+    rehashStep(REHASH_GROUPS_PER_OP);
+    if (table_.growth_left == 0) {
+        // 正常情况下迁移会先于新表写满完成，这里兜底
+        finishRehash();
+    }
+    if (table_.growth_left == 0) {
+        // 删除标记较多时原地重建即可回收空间，否则翻倍扩容
+        if (table_.capacity != 0 && table_.size < maxLoad(table_.capacity) / 2) {
+            startRehash(table_.capacity);
+        } else {
+            startRehash(table_.capacity == 0 ? MIN_CAPACITY : table_.capacity * 2);
+        }
+    }
+    size_t index = findInsertSlot(table_, hash);
+    if (table_.ctrl[index] == CTRL_EMPTY) {
+        table_.growth_left--;
+    }
+    table_.ctrl[index] = h2Of(hash);
+    new (&table_.slots[index]) value_type(std::move(key), nullptr);
+    table_.size++;
+    return index;
+}
+
+KeyTable::iterator KeyTable::find(std::string_view key) {
+    return iterator(this, locate(key, hashKey(key)));
+}
+
+KeyTable::const_iterator KeyTable::find(std::string_view key) const {
+    return const_iterator(this, locate(key, hashKey(key)));
+}
+
+std::unique_ptr<DataItem>& KeyTable::operator[](std::string_view key) {
+    size_t hash = hashKey(key);
+    size_t index = locate(key, hash);
+    if (index == endIndex()) {
+        index = insertNew(SharedKey(key), hash);
+    }
+    return slotAt(index).second;
+}
+
+bool KeyTable::insert_or_assign(std::string_view key, std::unique_ptr<DataItem> item) {
+    size_t hash = hashKey(key);
+    size_t index = locate(key, hash);
+    bool inserted = false;
+    if (index == endIndex()) {
+        index = insertNew(SharedKey(key), hash);
+        inserted = true;
+    }
+    slotAt(index).second = std::move(item);
+    return inserted;
+}
+
+size_t KeyTable::erase(std::string_view key) {
+    size_t index = locate(key, hashKey(key));
+    if (index == endIndex()) {
+        return 0;
+    }
+    eraseIndex(index);
+    rehashStep(REHASH_GROUPS_PER_OP);
+    return 1;
+}
+
+KeyTable::iterator KeyTable::erase(iterator it) {
+    assert(it.index_ < endIndex());
+    eraseIndex(it.index_);
+    return iterator(this, nextFull(it.index_ + 1));
+}
+
+void KeyTable::scanGroup(const Table& table, size_t group, const std::function<void(const value_type&)>& fn) {
+    if (table.size == 0) {
+        return;
+    }
+    const size_t group_mask = table.capacity / GROUP_WIDTH - 1;
+    // 与findIndex相同的探测顺序，主组为group的键都在遇到空槽之前的这段探测链上
+    size_t probe = group;
+    for (size_t step = 1; step <= group_mask + 1; ++step) {
+        const size_t base = probe * GROUP_WIDTH;
+        const int8_t* ctrl = table.ctrl.get() + base;
+        for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+            if (ctrl[i] >= 0 && (h1Of(hashKey(table.slots[base + i].first)) & group_mask) == group) {
+                fn(table.slots[base + i]);
+            }
+        }
+        if (matchByte(ctrl, CTRL_EMPTY) != 0) {
+            break;
+        }
+        probe = (probe + step) & group_mask;
+    }
+}
+
+// 与Redis的dictScan相同：rehash期间先访问小表中游标对应的组，再访问大表中由它扩展出的所有组
+size_t KeyTable::scan(size_t cursor, const std::function<void(const value_type&)>& fn) const {
+    if (table_.capacity == 0) {
+        return 0;
+    }
+    if (!isRehashing()) {
+        const size_t mask = table_.capacity / GROUP_WIDTH - 1;
+        scanGroup(table_, cursor & mask, fn);
+        return nextCursor(cursor, mask);
+    }
+    const Table* small = &old_;
+    const Table* large = &table_;
+    if (small->capacity > large->capacity) {
+        std::swap(small, large);
+    }
+    const size_t small_mask = small->capacity / GROUP_WIDTH - 1;
+    const size_t large_mask = large->capacity / GROUP_WIDTH - 1;
+    scanGroup(*small, cursor & small_mask, fn);
+    do {
+        scanGroup(*large, cursor & large_mask, fn);
+        cursor = nextCursor(cursor, large_mask);
+    } while (cursor & (small_mask ^ large_mask));
+    return cursor;
+}
+
+void KeyTable::clear() {
+    release(old_);
+    release(table_);
+    migrate_group_ = 0;
+}
+
+void KeyTable::swap(KeyTable& other) noexcept {
+    std::swap(table_, other.table_);
+    std::swap(old_, other.old_);
+    std::swap(migrate_group_, other.migrate_group_);
+}
+
+void KeyTable::reserve(size_t n) {
+    finishRehash();
+    size_t new_capacity = table_.capacity == 0 ? MIN_CAPACITY : table_.capacity;
+    while (maxLoad(new_capacity) < n) {
+        new_capacity *= 2;
+    }
+    if (new_capacity != table_.capacity) {
+        startRehash(new_capacity);
+        finishRehash();
+    }
+}
+
+} // namespace dkv
@@ -0,0 +1,93 @@
+#include "storage/dkv_lazy_free.hpp"
+#include "dkv_datatypes.hpp"
+
+namespace dkv {
+
+LazyFreer::~LazyFreer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+size_t LazyFreer::freeEffort(const DataItem& item) {
+    if (item.isSpilled()) {
+        // 值在分层存储的磁盘日志中，内存中只有元数据
+        return 1;
+    }
+    switch (item.getType()) {
+        case DataType::HASH:
+            return static_cast<const HashItem&>(item).size();
+        case DataType::LIST:
+            return static_cast<const ListItem&>(item).size();
+        case DataType::SET:
+            return static_cast<const SetItem&>(item).scard();
+        case DataType::ZSET:
+            return static_cast<const ZSetItem&>(item).zcard();
+        default:
+            // 字符串、位图、HyperLogLog和布隆过滤器的每层都是一整块内存，释放代价与大小无关
+            return 1;
+    }
+}
+
+void LazyFreer::free(std::unique_ptr<DataItem> item) {
+    if (!item || freeEffort(*item) <= LAZYFREE_THRESHOLD) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.push_back(std::move(item));
+    enqueue_locked();
+}
+
+void LazyFreer::free(std::unique_ptr<KeyTable> table) {
+    if (!table || table->empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    tables_.push_back(std::move(table));
+    enqueue_locked();
+}
+
+void LazyFreer::enqueue_locked() {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&LazyFreer::run, this);
+    }
+    cv_.notify_one();
+}
+
+void LazyFreer::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return pending_.load(std::memory_order_relaxed) == 0; });
+}
+
+void LazyFreer::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stopping_ || !items_.empty() || !tables_.empty(); });
+        if (items_.empty() && tables_.empty()) {
+            return;
+        }
+        // 整批取出后在锁外析构，析构期间入队不被阻塞
+        std::vector<std::unique_ptr<DataItem>> items;
+        std::vector<std::unique_ptr<KeyTable>> tables;
+        items.swap(items_);
+        tables.swap(tables_);
+        lock.unlock();
+        const size_t count = items.size() + tables.size();
+        items.clear();
+        tables.clear();
+        lock.lock();
+        freed_.fetch_add(count, std::memory_order_relaxed);
+        pending_.fetch_sub(count, std::memory_order_relaxed);
+        if (pending_.load(std::memory_order_relaxed) == 0) {
+            idle_cv_.notify_all();
+        }
+    }
+}
+
+} // namespace dkv
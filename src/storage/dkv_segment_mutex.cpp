@@ -0,0 +1,156 @@
+#include "storage/dkv_segment_mutex.hpp"
+#include <chrono>
+#include <thread>
+
+namespace dkv {
+
+namespace {
+
+// 写者等待读者退出时的自旋与yield次数
+constexpr size_t SPIN_LIMIT = 64;
+constexpr size_t YIELD_LIMIT = 128;
+
+// 读者槽位，各占一条缓存行
+struct alignas(64) ReaderSlot {
+    std::atomic<const SegmentMutex*> held{nullptr}; // 被动持有的锁
+    size_t depth = 0;                               // 同一把锁的重入次数，只由所属线程访问
+    std::atomic<bool> in_use{false};
+};
+
+// 不析构，保证线程退出时归还槽位仍然安全
+ReaderSlot* readerSlots() {
+    static ReaderSlot* slots = new ReaderSlot[SegmentMutex::MAX_READER_SLOTS];
+    return slots;
+}
+
+// 曾经分配过的最大槽位下标+1，写者只检查此范围
+std::atomic<size_t> slot_high_water{0};
+
+// 线程首次加读锁时分配槽位，线程退出时归还
+class ThreadReaderSlot {
+public:
+    ThreadReaderSlot() {
+        ReaderSlot* slots = readerSlots();
+        for (size_t i = 0; i < SegmentMutex::MAX_READER_SLOTS; ++i) {
+            if (!slots[i].in_use.exchange(true)) {
+                slot_ = &slots[i];
+                size_t high_water = slot_high_water.load();
+                while (high_water < i + 1 && !slot_high_water.compare_exchange_weak(high_water, i + 1)) {
+                }
+                break;
+            }
+        }
+    }
+    ~ThreadReaderSlot() {
+        if (slot_ != nullptr) {
+            slot_->held.store(nullptr, std::memory_order_release);
+            slot_->depth = 0;
+            slot_->in_use.store(false, std::memory_order_release);
+        }
+    }
+    ReaderSlot* get() const { return slot_; }
+
+private:
+    ReaderSlot* slot_ = nullptr;
+};
+
+ReaderSlot* currentReaderSlot() {
+    thread_local ThreadReaderSlot slot;
+    return slot.get();
+}
+
+} // namespace
+
+void SegmentMutex::lock() {
+    mutex_.lock();
+    // 写标志与读者槽位的登记都使用seq_cst：读者先登记再检查写标志，写者先设置写标志再检查槽位，
+    // 两者至少有一方能看到对方
+    writer_.store(true);
+    waitForReaders();
+}
+
+bool SegmentMutex::try_lock() {
+    if (!mutex_.try_lock()) {
+        return false;
+    }
+    writer_.store(true);
+    if (hasReaders()) {
+        writer_.store(false, std::memory_order_release);
+        mutex_.unlock();
+        return false;
+    }
+    return true;
+}
+
+void SegmentMutex::unlock() {
+    writer_.store(false, std::memory_order_release);
+    mutex_.unlock();
+}
+
+void SegmentMutex::lock_shared() {
+    if (!try_lock_shared()) {
+        mutex_.lock_shared();
+    }
+}
+
+bool SegmentMutex::try_lock_shared() {
+    ReaderSlot* slot = currentReaderSlot();
+    if (slot != nullptr) {
+        const SegmentMutex* held = slot->held.load(std::memory_order_relaxed);
+        if (held == this) {
+            slot->depth++;
+            return true;
+        }
+        if (held == nullptr) {
+            slot->held.store(this);
+            if (!writer_.load()) {
+                return true;
+            }
+            slot->held.store(nullptr, std::memory_order_release);
+        }
+    }
+    return mutex_.try_lock_shared();
+}
+
+void SegmentMutex::unlock_shared() {
+    ReaderSlot* slot = currentReaderSlot();
+    if (slot != nullptr && slot->held.load(std::memory_order_relaxed) == this) {
+        if (slot->depth > 0) {
+            slot->depth--;
+        } else {
+            slot->held.store(nullptr, std::memory_order_release);
+        }
+        return;
+    }
+    mutex_.unlock_shared();
+}
+
+bool SegmentMutex::hasReaders() const {
+    ReaderSlot* slots = readerSlots();
+    const size_t count = slot_high_water.load();
+    for (size_t i = 0; i < count; ++i) {
+        if (slots[i].held.load() == this) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SegmentMutex::waitForReaders() const {
+    ReaderSlot* slots = readerSlots();
+    const size_t count = slot_high_water.load();
+    for (size_t i = 0; i < count; ++i) {
+        // 读者临界区很短，先自旋；读者被换出CPU时yield未必能让它运行，之后改为短暂休眠
+        for (size_t spins = 0; slots[i].held.load() == this; ++spins) {
+            if (spins < SPIN_LIMIT) {
+                continue;
+            } else if (spins < YIELD_LIMIT) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+}
+
+} // namespace dkv
@@ -0,0 +1,20 @@
+#include "storage/dkv_shared_key.hpp"
+#include "dkv_slab_allocator.hpp"
+#include <cstring>
+#include <new>
+
+namespace dkv {
+
+SharedKey::SharedKey(std::string_view key) {
+    void* memory = SlabAllocator::getInstance().allocate(sizeof(Rep) + key.size());
+    rep_ = new (memory) Rep{{1}, static_cast<uint32_t>(key.size())};
+    std::memcpy(rep_->bytes(), key.data(), key.size());
+}
+
+void SharedKey::destroy(Rep* rep) {
+    const size_t bytes = sizeof(Rep) + rep->length;
+    rep->~Rep();
+    SlabAllocator::getInstance().deallocate(rep, bytes);
+}
+
+} // namespace dkv
@@ -1,22 +1,31 @@
 #include "storage/dkv_storage.hpp"
 #include "dkv_datatypes.hpp"
+#include "dkv_cached_clock.hpp"
 #include "dkv_memory_allocator.hpp"
 #include "dkv_logger.hpp"
 #include "storage/dkv_inner_storage.hpp"
+#include "persist/dkv_rdb_loader.hpp"
 #include <algorithm>
 #include <mutex>
+#include <random>
+#include <unordered_set>
 #include <cassert>
 using namespace std;
 
 namespace dkv {
 
-StorageEngine::StorageEngine(TransactionIsolationLevel tx_isolation_level) 
-: memory_usage_(0) {
+StorageEngine::StorageEngine(TransactionIsolationLevel tx_isolation_level, size_t segment_count) 
+: inner_storage_(segment_count), memory_usage_(0) {
     DKV_LOG_DEBUG("创建事务管理器，隔离级别: ", static_cast<int>(tx_isolation_level));
     transaction_manager_ = make_unique<TransactionManager>(this, tx_isolation_level);
 }
 
-StorageEngine::~StorageEngine() {}
+StorageEngine::~StorageEngine() {
+    if (rdb_save_thread_.joinable()) {
+        rdb_save_thread_.join();
+    }
+    rdb_loader_.reset();
+}
 
 ReadView StorageEngine::getReadView(TransactionID tx_id) const {
     return transaction_manager_->getReadView(tx_id);
@@ -24,20 +33,20 @@ ReadView StorageEngine::getReadView(TransactionID tx_id) const {
 
 // StorageEngine 实现
 bool StorageEngine::set(TransactionID tx_id, const Key& key, const Value& value) {
-    auto lock = inner_storage_.wlock();
+    auto lock = inner_storage_.wlock(key);
     auto item = createStringItem(value);
     return inner_storage_.set(tx_id, key, std::move(item));
 }
 
 bool StorageEngine::set(TransactionID tx_id, const Key& key, const Value& value, int64_t expire_seconds) {
-    auto lock = inner_storage_.wlock();
+    auto lock = inner_storage_.wlock(key);
     auto expire_time = Utils::getCurrentTime() + std::chrono::seconds(expire_seconds);
     auto item = createStringItem(value, expire_time);
     return inner_storage_.set(tx_id, key, std::move(item));
 }
 
 std::string StorageEngine::get(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     auto item = inner_storage_.get(key, getReadView(tx_id));
     if (!item || item->isExpired()) {
         return "";
@@ -53,13 +62,89 @@ std::string StorageEngine::get(TransactionID tx_id, const Key& key) {
     return "";
 }
 
+std::vector<Value> StorageEngine::mget(TransactionID tx_id, const std::vector<Key>& keys) {
+    auto locks = inner_storage_.rlockKeys(keys);
+    ReadView read_view = getReadView(tx_id);
+    std::vector<Value> values;
+    values.reserve(keys.size());
+    for (const auto& key : keys) {
+        auto item = inner_storage_.get(key, read_view);
+        auto* string_item = item && !item->isExpired() ? dynamic_cast<StringItem*>(item) : nullptr;
+        if (!string_item) {
+            values.emplace_back();
+            continue;
+        }
+        string_item->touch();
+        string_item->incrementFrequency();
+        values.push_back(string_item->getValue());
+    }
+    return values;
+}
+
+bool StorageEngine::mset(TransactionID tx_id, const std::vector<std::pair<Key, Value>>& pairs) {
+    std::vector<Key> keys;
+    keys.reserve(pairs.size());
+    for (const auto& pair : pairs) {
+        keys.push_back(pair.first);
+    }
+    auto locks = inner_storage_.wlockKeys(keys);
+    bool ok = true;
+    for (const auto& pair : pairs) {
+        ok = inner_storage_.set(tx_id, pair.first, createStringItem(pair.second)) && ok;
+    }
+    return ok;
+}
+
+bool StorageEngine::msetnx(TransactionID tx_id, const std::vector<std::pair<Key, Value>>& pairs) {
+    std::vector<Key> keys;
+    keys.reserve(pairs.size());
+    for (const auto& pair : pairs) {
+        keys.push_back(pair.first);
+    }
+    auto locks = inner_storage_.wlockKeys(keys);
+    // 检查与写入在同一批锁内完成，其他客户端看不到只写入了一部分的状态
+    ReadView read_view = getReadView(tx_id);
+    for (const auto& key : keys) {
+        auto item = inner_storage_.get(key, read_view);
+        if (item && !item->isExpired()) {
+            return false;
+        }
+    }
+    for (const auto& pair : pairs) {
+        inner_storage_.set(tx_id, pair.first, createStringItem(pair.second));
+    }
+    return true;
+}
+
 bool StorageEngine::del(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.wlock();
+    if (lazyfree_config_.lazy_user_del) {
+        return unlink(tx_id, key);
+    }
+    auto lock = inner_storage_.wlock(key);
     return inner_storage_.del(tx_id, key);
 }
 
+bool StorageEngine::unlink(TransactionID tx_id, const Key& key) {
+    if (tx_id != NO_TX) {
+        // 事务中的删除只写入删除标记，旧版本由历史版本回收释放
+        auto lock = inner_storage_.wlock(key);
+        return inner_storage_.del(tx_id, key);
+    }
+    std::unique_ptr<DataItem> item;
+    {
+        auto lock = inner_storage_.wlock(key);
+        item = inner_storage_.detach(key);
+    }
+    if (!item) {
+        return false;
+    }
+    // 与del相同，键被摘下即视为删除成功，不论数据项是否已过期
+    lazy_freer_.free(std::move(item));
+    return true;
+}
+
 bool StorageEngine::exists(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     auto item = inner_storage_.get(key, getReadView(tx_id));
     if (!item || item->isExpired()) {
         return false;
@@ -71,8 +156,32 @@ bool StorageEngine::exists(TransactionID tx_id, const Key& key) {
     return true;
 }
 
+size_t StorageEngine::elementCount(TransactionID tx_id, const Key& key) {
+    auto lock = inner_storage_.rlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item) {
+        return 0;
+    }
+    if (auto* hash_item = dynamic_cast<HashItem*>(item)) {
+        return hash_item->size();
+    }
+    if (auto* list_item = dynamic_cast<ListItem*>(item)) {
+        return list_item->size();
+    }
+    if (auto* set_item = dynamic_cast<SetItem*>(item)) {
+        return set_item->scard();
+    }
+    if (auto* zset_item = dynamic_cast<ZSetItem*>(item)) {
+        return zset_item->zcard();
+    }
+    if (auto* bitmap_item = dynamic_cast<BitmapItem*>(item)) {
+        return bitmap_item->size() / 64;
+    }
+    return 1;
+}
+
 bool StorageEngine::expire(TransactionID tx_id, const Key& key, int64_t seconds) {
-    auto lock = inner_storage_.wlock();
+    auto lock = inner_storage_.wlock(key);
     auto item = inner_storage_.get(key, getReadView(tx_id));
     if (!item || item->isExpired()) {
         return false;
@@ -80,11 +189,12 @@ bool StorageEngine::expire(TransactionID tx_id, const Key& key, int64_t seconds)
     
     auto expire_time = Utils::getCurrentTime() + std::chrono::seconds(seconds);
     item->setExpiration(expire_time);
+    inner_storage_.trackExpiration(key, expire_time);
     return true;
 }
 
 int64_t StorageEngine::ttl(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     auto item = inner_storage_.get(key, getReadView(tx_id));
     if (!item || item->isExpired()) {
         return -2; // 键不存在
@@ -101,7 +211,7 @@ int64_t StorageEngine::ttl(TransactionID tx_id, const Key& key) {
 }
 
 int64_t StorageEngine::incr(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.wlock();
+    auto lock = inner_storage_.wlock(key);
     auto item = inner_storage_.get(key, getReadView(tx_id));
     if (!item || item->isExpired()) {
         // 键不存在，创建新的数值项
@@ -115,11 +225,9 @@ int64_t StorageEngine::incr(TransactionID tx_id, const Key& key) {
         return -1; // 不是字符串类型
     }
     
-    // 更新数值
-    std::string current_value = string_item->getValue();
-    if (Utils::isNumeric(current_value)) {
-        int64_t new_value = Utils::stringToInt(current_value) + 1;
-        string_item->setValue(Utils::intToString(new_value));
+    // 整数编码的值直接原地加减
+    int64_t new_value;
+    if (string_item->incrBy(1, new_value)) {
         return new_value;
     }
     
@@ -127,7 +235,7 @@ int64_t StorageEngine::incr(TransactionID tx_id, const Key& key) {
 }
 
 int64_t StorageEngine::decr(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.wlock();
+    auto lock = inner_storage_.wlock(key);
     auto item = inner_storage_.get(key, getReadView(tx_id));
     if (!item || item->isExpired()) {
         // 键不存在，创建新的数值项
@@ -141,43 +249,125 @@ int64_t StorageEngine::decr(TransactionID tx_id, const Key& key) {
         return -1; // 不是字符串类型
     }
     
-    // 更新数值
-    std::string current_value = string_item->getValue();
-    if (Utils::isNumeric(current_value)) {
-        int64_t new_value = Utils::stringToInt(current_value) - 1;
-        string_item->setValue(Utils::intToString(new_value));
+    // 整数编码的值直接原地加减
+    int64_t new_value;
+    if (string_item->incrBy(-1, new_value)) {
         return new_value;
     }
     
     return -1; // 不是数值类型
 }
 
-void StorageEngine::flush() {
-    auto writelock = inner_storage_.wlock();
-    inner_storage_.clear();
-    total_keys_ = 0;
-    expired_keys_ = 0;
+void StorageEngine::flush(bool async) {
+    std::vector<std::unique_ptr<InnerStorage::DataMap>> tables;
+    {
+        auto writelocks = inner_storage_.wlockAll();
+        if (async) {
+            tables = inner_storage_.detachAll();
+        } else {
+            inner_storage_.clear();
+        }
+        total_keys_ = 0;
+        expired_keys_ = 0;
+    }
+    for (auto& table : tables) {
+        lazy_freer_.free(std::move(table));
+    }
 }
 
 size_t StorageEngine::size() const {
-    auto readlock = inner_storage_.rlock();
-    return inner_storage_.size();
+    size_t total = 0;
+    for (size_t i = 0; i < inner_storage_.segmentCount(); ++i) {
+        auto readlock = inner_storage_.rlockSegment(i);
+        total += inner_storage_.segmentData(i).size();
+    }
+    return total;
 }
 
 std::vector<Key> StorageEngine::keys() const {
-    auto readlock = inner_storage_.rlock();
     std::vector<Key> result;
-    result.reserve(inner_storage_.size());
-    
-    for (const auto& pair : inner_storage_) {
-        if (!isKeyExpired(pair.first)) {
-            result.push_back(pair.first);
+    // 逐个分段加锁遍历，避免长时间阻塞整个键空间
+    for (size_t i = 0; i < inner_storage_.segmentCount(); ++i) {
+        auto readlock = inner_storage_.rlockSegment(i);
+        for (const auto& pair : inner_storage_.segmentData(i)) {
+            if (!pair.second->isExpired()) {
+                result.push_back(pair.first.str());
+            }
         }
     }
     
     return result;
 }
 
+size_t StorageEngine::scan(size_t cursor, size_t count, const std::function<void(const SharedKey&, const DataItem&)>& fn) const {
+    return scanImpl(nullptr, cursor, count, fn);
+}
+
+size_t StorageEngine::scan(const ReadView& read_view, size_t cursor, size_t count,
+                           const std::function<void(const SharedKey&, const DataItem&)>& fn) const {
+    return scanImpl(&read_view, cursor, count, fn);
+}
+
+size_t StorageEngine::scanSegment(const ReadView& read_view, size_t segment, size_t cursor, size_t count,
+                                  const std::function<void(const SharedKey&, const DataItem&)>& fn) const {
+    count = std::max<size_t>(count, 1);
+    if (inner_storage_.capturing()) {
+        return inner_storage_.scanCapture(segment, cursor, count, fn);
+    }
+    size_t visits = count * 10;
+    size_t emitted = 0;
+    return scanSegmentImpl(&read_view, segment, cursor, count, emitted, visits, fn);
+}
+
+size_t StorageEngine::scanImpl(const ReadView* read_view, size_t cursor, size_t count,
+                               const std::function<void(const SharedKey&, const DataItem&)>& fn) const {
+    const size_t segments = inner_storage_.segmentCount();
+    size_t segment = cursor % segments;
+    size_t table_cursor = cursor / segments;
+    count = std::max<size_t>(count, 1);
+    size_t visits = count * 10;
+    size_t emitted = 0;
+    while (segment < segments) {
+        table_cursor = scanSegmentImpl(read_view, segment, table_cursor, count, emitted, visits, fn);
+        if (table_cursor != 0) {
+            return table_cursor * segments + segment;
+        }
+        // 当前分段遍历结束，从下一个分段的起点继续
+        segment++;
+        if (emitted >= count || visits == 0) {
+            break;
+        }
+    }
+    return segment < segments ? segment : 0;
+}
+
+size_t StorageEngine::scanSegmentImpl(const ReadView* read_view, size_t segment, size_t table_cursor, size_t count,
+                                      size_t& emitted, size_t& visits,
+                                      const std::function<void(const SharedKey&, const DataItem&)>& fn) const {
+    auto readlock = inner_storage_.rlockSegment(segment);
+    const auto& data = inner_storage_.segmentData(segment);
+    do {
+        table_cursor = data.scan(table_cursor, [&](const KeyTable::value_type& pair) {
+            const DataItem* item = pair.second.get();
+            if (item && read_view) {
+                item = inner_storage_.get(pair.first, *read_view);
+            }
+            if (item && !item->isExpired() && !item->isDeleted()) {
+                fn(pair.first, *item);
+                emitted++;
+            }
+        });
+        visits--;
+    } while (table_cursor != 0 && emitted < count && visits > 0);
+    return table_cursor;
+}
+
+void StorageEngine::sampleKeys(size_t count, const std::function<void(const SharedKey&, const DataItem&)>& fn) const {
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    // 游标中超出分段内哈希表掩码的位会被忽略，任意随机值都是合法的起点
+    scan(static_cast<size_t>(rng()), count, fn);
+}
+
 uint64_t StorageEngine::getTotalKeys() const {
     return total_keys_.load();
 }
@@ -186,6 +376,133 @@ uint64_t StorageEngine::getExpiredKeys() const {
     return expired_keys_.load();
 }
 
+KeyspaceStats StorageEngine::getKeyspaceStats() const {
+    return inner_storage_.getKeyspaceStats();
+}
+
+bool StorageEngine::enableTieredStorage(const TieredConfig& config) {
+    auto tier = std::make_unique<TieredStore>(config);
+    if (!tier->open()) {
+        return false;
+    }
+    tier_ = std::move(tier);
+    return true;
+}
+
+TieredStats StorageEngine::getTieredStats() const {
+    return tier_ ? tier_->stats() : TieredStats{};
+}
+
+bool StorageEngine::spill(const Key& key) {
+    if (!tier_) {
+        return false;
+    }
+    std::unique_ptr<DataItem> evicted;
+    {
+        auto lock = inner_storage_.wlock(key);
+        DataItem* item = inner_storage_.get(key);
+        // 只移出没有历史版本的已提交数据，版本链和回滚都不会访问SpilledItem
+        if (!item || item->isSpilled() || item->isDeleted() || item->isDiscard() || item->getUndoLog() ||
+            item->isExpired() || transaction_manager_->isActive(item->getTransactionId())) {
+            return false;
+        }
+        if (CachedClock::now() - item->getLastAccessed() < std::chrono::milliseconds(tier_->config().min_idle_ms)) {
+            return false;
+        }
+        std::unique_ptr<DataItem> spilled = tier_->spill(*item);
+        if (!spilled) {
+            return false;
+        }
+        std::unique_ptr<DataItem>& slot = inner_storage_.getRefOrInsert(key);
+        evicted = std::move(slot);
+        slot = std::move(spilled);
+    }
+    if (lazyfree_config_.lazy_eviction) {
+        lazy_freer_.free(std::move(evicted));
+    }
+    return true;
+}
+
+size_t StorageEngine::loadSpilled(const std::vector<Key>& keys) {
+    if (!tier_) {
+        return 0;
+    }
+    size_t loaded_count = 0;
+    for (const auto& key : keys) {
+        {
+            // 绝大多数键在内存中，只加读锁检查
+            auto lock = inner_storage_.rlock(key);
+            DataItem* item = inner_storage_.get(key);
+            if (!item || !item->isSpilled()) {
+                continue;
+            }
+        }
+        std::unique_ptr<DataItem> spilled;
+        {
+            auto lock = inner_storage_.wlock(key);
+            DataItem* item = inner_storage_.get(key);
+            if (!item || !item->isSpilled()) {
+                continue;
+            }
+            std::unique_ptr<DataItem> loaded = tier_->load(static_cast<const SpilledItem&>(*item));
+            if (!loaded) {
+                continue;
+            }
+            std::unique_ptr<DataItem>& slot = inner_storage_.getRefOrInsert(key);
+            spilled = std::move(slot);
+            slot = std::move(loaded);
+        }
+        loaded_count++;
+    }
+    return loaded_count;
+}
+
+bool StorageEngine::loadSpilledAsync(const std::vector<Key>& keys, std::function<void()> done) {
+    if (!tier_) {
+        return false;
+    }
+    std::vector<Key> spilled_keys;
+    std::vector<SpillRef> refs;
+    for (const auto& key : keys) {
+        auto lock = inner_storage_.rlock(key);
+        DataItem* item = inner_storage_.get(key);
+        if (item && item->isSpilled()) {
+            spilled_keys.push_back(key);
+            refs.push_back(static_cast<const SpilledItem*>(item)->ref());
+        }
+    }
+    if (spilled_keys.empty()) {
+        return false;
+    }
+    tier_->readAsync(refs, [this, spilled_keys = std::move(spilled_keys), refs, done = std::move(done)](
+                               std::vector<std::string>& data, std::vector<bool>& ok) {
+        for (size_t i = 0; i < spilled_keys.size(); ++i) {
+            if (!ok[i]) {
+                continue; // 命令执行前的同步载入会再试一次
+            }
+            std::unique_ptr<DataItem> spilled;
+            {
+                auto lock = inner_storage_.wlock(spilled_keys[i]);
+                DataItem* item = inner_storage_.get(spilled_keys[i]);
+                // 读取期间键可能已被删除、覆盖或载入；日志偏移不会复用，偏移相同即为同一条记录
+                if (!item || !item->isSpilled() || static_cast<const SpilledItem*>(item)->ref().offset != refs[i].offset) {
+                    continue;
+                }
+                std::unique_ptr<DataItem> loaded = tier_->materialize(static_cast<const SpilledItem&>(*item), data[i]);
+                if (!loaded) {
+                    continue;
+                }
+                std::unique_ptr<DataItem>& slot = inner_storage_.getRefOrInsert(spilled_keys[i]);
+                spilled = std::move(slot);
+                slot = std::move(loaded);
+            }
+            tier_->recordAsyncLoad();
+        }
+        done();
+    });
+    return true;
+}
+
 size_t StorageEngine::getCurrentMemoryUsage() const {
     return MemoryAllocator::getInstance().getCurrentUsage();
 }
@@ -198,72 +515,440 @@ std::string StorageEngine::getMemoryStats() const {
     return MemoryAllocator::getInstance().getStats();
 }
 
-void StorageEngine::cleanupExpiredKeys() {
-    auto writelock = inner_storage_.wlock();
-    
-    auto it = inner_storage_.begin();
-    while (it != inner_storage_.end()) {
-        if (it->second->isExpired()) {
-            it = inner_storage_.erase(it);
-            expired_keys_++;
-        } else {
-            ++it;
+bool StorageEngine::cleanupExpiredKeys(std::chrono::microseconds budget) {
+    const size_t segments = inner_storage_.segmentCount();
+    for (size_t i = 0; i < segments; ++i) {
+        auto writelock = inner_storage_.wlockSegment(i);
+        // 顺带推进渐进式rehash，保证没有写入的分段也能完成迁移
+        inner_storage_.rehashStep(i, REHASH_GROUPS_PER_TICK);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + budget;
+    const size_t start = expire_cursor_.load();
+    for (size_t n = 0; n < segments; ++n) {
+        const size_t segment = (start + n) % segments;
+        bool has_due = true;
+        while (has_due) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                expire_cursor_ = segment;
+                return true;
+            }
+            size_t expired = 0;
+            {
+                auto writelock = inner_storage_.wlockSegment(segment);
+                has_due = inner_storage_.expireStep(segment, CachedClock::now(), EXPIRE_KEYS_PER_BATCH, expired,
+                                                    lazyfree_config_.lazy_expire ? &lazy_freer_ : nullptr);
+            }
+            expired_keys_ += expired;
         }
     }
+    return false;
 }
 
-void StorageEngine::cleanupEmptyKey() {
-    auto writelock = inner_storage_.wlock();
-    
-    auto it = inner_storage_.begin();
-    while (it != inner_storage_.end()) {
-        HashItem* hash_item = dynamic_cast<HashItem*>(it->second.get());
-        if (hash_item) {
-            if (hash_item->size() == 0) {
-                it = inner_storage_.erase(it);
-                total_keys_--;
-            } else {
-                ++it;
-            }
-            continue;
+size_t StorageEngine::purgeVersions(size_t groups) {
+    std::lock_guard<std::mutex> purge_lock(purge_mutex_);
+    if (purge_cursor_ == 0) {
+        purge_pass_rollbacks_ = transaction_manager_->getRolledbackTransactions();
+    }
+    // 本轮开始后才回滚的事务不在purge_pass_rollbacks_中，同样按已丢弃处理，下一轮结束后再清除
+    const auto rolledback_list = transaction_manager_->getRolledbackTransactions();
+    const std::unordered_set<TransactionID> rolledback(rolledback_list.begin(), rolledback_list.end());
+    const TransactionID horizon = transaction_manager_->getPurgeHorizon();
+
+    const size_t segments = inner_storage_.segmentCount();
+    size_t segment = purge_cursor_ % segments;
+    size_t table_cursor = purge_cursor_ / segments;
+    size_t budget = std::max<size_t>(groups, 1);
+    size_t purged = 0;
+    std::vector<SharedKey> keys;
+    while (budget > 0) {
+        {
+            auto writelock = inner_storage_.wlockSegment(segment);
+            auto& data = inner_storage_.segmentData(segment);
+            do {
+                keys.clear();
+                table_cursor = data.scan(table_cursor, [&keys](const KeyTable::value_type& pair) {
+                    keys.push_back(pair.first);
+                });
+                for (const auto& key : keys) {
+                    auto it = data.find(key);
+                    if (it == data.end()) {
+                        continue;
+                    }
+                    PurgeResult result = MVCC::purge(it->second, horizon, rolledback);
+                    purged += result.purged;
+                    if (result.removable) {
+                        data.erase(it);
+                        continue;
+                    }
+                    if (result.chain_length > 1) {
+                        pass_versioned_keys_++;
+                        pass_history_versions_ += result.chain_length - 1;
+                    }
+                    pass_max_chain_length_ = std::max(pass_max_chain_length_, result.chain_length);
+                }
+                budget--;
+            } while (table_cursor != 0 && budget > 0);
         }
-        ListItem* list_item = dynamic_cast<ListItem*>(it->second.get());
-        if (list_item) {
-            if (list_item->empty()) {
-                it = inner_storage_.erase(it);
-                total_keys_--;
-            } else {
-                ++it;
-            }
-            continue;
+        if (table_cursor != 0) {
+            break;
         }
-        SetItem* set_item = dynamic_cast<SetItem*>(it->second.get());
-        if (set_item) {
-            if (set_item->empty()) {
-                it = inner_storage_.erase(it);
-                total_keys_--;
-            } else {
-                ++it;
-            }
+        // 当前分段遍历结束，从下一个分段的起点继续
+        segment++;
+        if (segment == segments) {
+            break;
+        }
+    }
+    purge_stats_.purged_versions += purged;
+
+    if (segment < segments) {
+        purge_cursor_ = table_cursor * segments + segment;
+        return purged;
+    }
+    // 完成一轮遍历：本轮开始前回滚的事务已没有残留版本，不必再计入读取视图
+    transaction_manager_->forgetRolledbackTransactions(purge_pass_rollbacks_);
+    purge_pass_rollbacks_.clear();
+    purge_stats_.purge_passes++;
+    purge_stats_.versioned_keys = pass_versioned_keys_;
+    purge_stats_.history_versions = pass_history_versions_;
+    purge_stats_.max_chain_length = pass_max_chain_length_;
+    mvcc_max_chain_length_.store(pass_max_chain_length_, std::memory_order_relaxed);
+    mvcc_history_versions_.store(pass_history_versions_, std::memory_order_relaxed);
+    pass_versioned_keys_ = 0;
+    pass_history_versions_ = 0;
+    pass_max_chain_length_ = 0;
+    purge_cursor_ = 0;
+    return purged;
+}
+
+MVCCStats StorageEngine::getMVCCStats() const {
+    MVCCStats stats;
+    {
+        std::lock_guard<std::mutex> purge_lock(purge_mutex_);
+        stats = purge_stats_;
+    }
+    stats.purge_horizon = transaction_manager_->getPurgeHorizon();
+    stats.purge_lag = transaction_manager_->peekNextTransactionID() - stats.purge_horizon;
+    stats.pending_rollbacks = transaction_manager_->getRolledbackTransactions().size();
+    return stats;
+}
+
+// 碎片整理按地址找到数据项所在的slab，数据项都必须从slab分配
+static_assert(sizeof(StringItem) <= SlabAllocator::MAX_SIZE && sizeof(HashItem) <= SlabAllocator::MAX_SIZE &&
+              sizeof(ListItem) <= SlabAllocator::MAX_SIZE && sizeof(SetItem) <= SlabAllocator::MAX_SIZE &&
+              sizeof(ZSetItem) <= SlabAllocator::MAX_SIZE && sizeof(BitmapItem) <= SlabAllocator::MAX_SIZE &&
+              sizeof(HyperLogLogItem) <= SlabAllocator::MAX_SIZE &&
+              sizeof(BloomFilterItem) <= SlabAllocator::MAX_SIZE && sizeof(SpilledItem) <= SlabAllocator::MAX_SIZE,
+              "数据项超出slab对象大小上限");
+
+bool StorageEngine::activeDefragCycle(std::chrono::microseconds budget) {
+    std::lock_guard<std::mutex> defrag_lock(defrag_mutex_);
+    SlabAllocator& slab = SlabAllocator::getInstance();
+    const auto deadline = std::chrono::steady_clock::now() + budget;
+    const size_t segments = inner_storage_.segmentCount();
+    size_t segment = defrag_cursor_ % segments;
+    size_t table_cursor = defrag_cursor_ / segments;
+    std::vector<SharedKey> keys;
+    while (true) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            defrag_cursor_ = table_cursor * segments + segment;
+            return true;
+        }
+        {
+            auto writelock = inner_storage_.wlockSegment(segment);
+            auto& data = inner_storage_.segmentData(segment);
+            // 新对象从最满的slab分配，旧对象直接归还所属slab
+            SlabAllocator::DefragScope defrag_scope;
+            size_t groups = DEFRAG_GROUPS_PER_LOCK;
+            do {
+                keys.clear();
+                table_cursor = data.scan(table_cursor, [&keys](const KeyTable::value_type& pair) {
+                    keys.push_back(pair.first);
+                });
+                for (const auto& key : keys) {
+                    auto it = data.find(key);
+                    if (it == data.end() || !it->second) {
+                        continue;
+                    }
+                    DataItem* item = it->second.get();
+                    // 与spill相同，版本链和回滚持有的数据项不能替换
+                    if (item->isSpilled() || item->isDeleted() || item->isDiscard() || item->getUndoLog() ||
+                        transaction_manager_->isActive(item->getTransactionId()) ||
+                        LazyFreer::freeEffort(*item) > DEFRAG_MAX_EFFORT || !slab.shouldRelocate(item)) {
+                        defrag_stats_.skipped++;
+                        continue;
+                    }
+                    // 复制时容器内部的小块内存同样从较满的slab分配
+                    std::unique_ptr<DataItem> relocated = item->clone();
+                    relocated->assignVersion(*item);
+                    relocated->assignAccessStats(*item);
+                    it->second = std::move(relocated);
+                    defrag_stats_.relocated++;
+                }
+            } while (table_cursor != 0 && --groups > 0);
+        }
+        if (table_cursor != 0) {
             continue;
         }
-        ZSetItem* zset_item = dynamic_cast<ZSetItem*>(it->second.get());
-        if (zset_item) {
-            if (zset_item->empty()) {
-                it = inner_storage_.erase(it);
-                total_keys_--;
-            } else {
-                ++it;
-            }
+        // 当前分段遍历结束，从下一个分段的起点继续
+        segment++;
+        if (segment == segments) {
+            defrag_stats_.passes++;
+            defrag_cursor_ = 0;
+            return false;
+        }
+    }
+}
+
+DefragStats StorageEngine::getDefragStats() const {
+    std::lock_guard<std::mutex> defrag_lock(defrag_mutex_);
+    return defrag_stats_;
+}
+
+const char* dataTypeName(DataType type) {
+    switch (type) {
+        case DataType::STRING:
+            return "string";
+        case DataType::HASH:
+            return "hash";
+        case DataType::LIST:
+            return "list";
+        case DataType::SET:
+            return "set";
+        case DataType::ZSET:
+            return "zset";
+        case DataType::BITMAP:
+            return "bitmap";
+        case DataType::HYPERLOGLOG:
+            return "hyperloglog";
+        case DataType::BLOOM:
+            return "bloom";
+    }
+    return "unknown";
+}
+
+namespace {
+
+// 一个键在键空间中占用的内存：槽位与控制字节、键名、各版本的数据项，以及过期时间旁路表中的节点。
+// 键名按分配的大小计算，不含slab对齐的余量
+size_t keyMemoryUsage(size_t key_length, const DataItem& item, size_t samples) {
+    size_t bytes = sizeof(KeyTable::value_type) + 1 + SharedKey::allocatedBytes(key_length) + item.memoryUsage(samples);
+    if (item.hasExpiration()) {
+        bytes += 2 * sizeof(void*) + sizeof(std::pair<const DataItem* const, Timestamp>) + sizeof(size_t);
+    }
+    for (const UndoLog* undo = item.getUndoLog().get(); undo && undo->old_value;
+         undo = undo->old_value->getUndoLog().get()) {
+        bytes += sizeof(UndoLog) + undo->deltas.capacity() * sizeof(UndoDelta) + undo->old_value->memoryUsage(samples);
+    }
+    return bytes;
+}
+
+} // namespace
+
+std::optional<size_t> StorageEngine::memoryUsage(const Key& key, size_t samples) const {
+    // 写者都持有分段写锁，分段读锁已足够，无需再加数据项锁
+    auto readlock = inner_storage_.rlock(key);
+    DataItem* item = inner_storage_.get(key);
+    if (!item || item->isDeleted() || item->isExpired()) {
+        return std::nullopt;
+    }
+    return keyMemoryUsage(key.size(), *item, samples);
+}
+
+bool StorageEngine::memorySampleCycle(std::chrono::microseconds budget) {
+    std::lock_guard<std::mutex> sample_lock(memory_sample_mutex_);
+    const auto deadline = std::chrono::steady_clock::now() + budget;
+    const size_t segments = inner_storage_.segmentCount();
+    size_t segment = memory_sample_cursor_ % segments;
+    size_t table_cursor = memory_sample_cursor_ / segments;
+    MemorySampleReport& pass = memory_sample_pass_;
+    while (true) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            memory_sample_cursor_ = table_cursor * segments + segment;
+            return true;
+        }
+        {
+            auto readlock = inner_storage_.rlockSegment(segment);
+            const auto& data = inner_storage_.segmentData(segment);
+            size_t groups = MEMORY_SAMPLE_GROUPS_PER_LOCK;
+            do {
+                table_cursor = data.scan(table_cursor, [&pass](const KeyTable::value_type& pair) {
+                    const DataItem* item = pair.second.get();
+                    if (!item || item->isDeleted()) {
+                        return;
+                    }
+                    size_t bytes = keyMemoryUsage(pair.first.size(), *item, MEMORY_USAGE_SAMPLES);
+                    auto& stats = pass.types[static_cast<size_t>(item->getType())];
+                    stats.keys++;
+                    stats.bytes += bytes;
+                    // 按字节数降序插入，只保留最大的几个
+                    auto& biggest = stats.biggest;
+                    if (biggest.size() == MemorySampleReport::BIGKEYS_PER_TYPE && biggest.back().bytes >= bytes) {
+                        return;
+                    }
+                    auto pos = std::find_if(biggest.begin(), biggest.end(),
+                                            [bytes](const BigKeyInfo& info) { return info.bytes < bytes; });
+                    biggest.insert(pos, BigKeyInfo{pair.first.str(), bytes, item->encodingName()});
+                    if (biggest.size() > MemorySampleReport::BIGKEYS_PER_TYPE) {
+                        biggest.pop_back();
+                    }
+                });
+            } while (table_cursor != 0 && --groups > 0);
+        }
+        if (table_cursor != 0) {
             continue;
         }
+        // 当前分段遍历结束，从下一个分段的起点继续
+        segment++;
+        if (segment == segments) {
+            pass.passes = memory_sample_report_.passes + 1;
+            pass.finished_at = std::chrono::duration_cast<std::chrono::seconds>(
+                                   std::chrono::system_clock::now().time_since_epoch()).count();
+            memory_sample_report_ = std::move(pass);
+            pass = MemorySampleReport();
+            memory_sample_cursor_ = 0;
+            return false;
+        }
+    }
+}
+
+MemorySampleReport StorageEngine::getMemorySampleReport() const {
+    std::lock_guard<std::mutex> sample_lock(memory_sample_mutex_);
+    return memory_sample_report_;
+}
+
+void StorageEngine::removeIfEmpty(TransactionID tx_id, const Key& key, const DataItem* item) {
+    bool empty = false;
+    switch (item->getType()) {
+        case DataType::HASH:
+            empty = static_cast<const HashItem*>(item)->size() == 0;
+            break;
+        case DataType::LIST:
+            empty = static_cast<const ListItem*>(item)->empty();
+            break;
+        case DataType::SET:
+            empty = static_cast<const SetItem*>(item)->empty();
+            break;
+        case DataType::ZSET:
+            empty = static_cast<const ZSetItem*>(item)->empty();
+            break;
+        default:
+            break;
+    }
+    if (empty) {
+        // 事务中写入删除标记，旧版本连同本次的逆操作留在版本链上，回滚时一并还原
+        inner_storage_.del(tx_id, key);
     }
 }
 
 // 保存数据到RDB文件
 bool StorageEngine::saveRDB(const std::string& filename) {
-    RDBPersistence rdb;
-    return rdb.saveToFile(this, filename);
+    beginRDBSave(true);
+    return doSaveRDB([this, &filename](const ReadView& read_view) {
+        return RDBPersistence::saveToFile(this, filename, read_view, &rdb_saved_keys_);
+    });
+}
+
+bool StorageEngine::saveRDBToStream(std::ostream& out) {
+    beginRDBSave(true);
+    return doSaveRDB([this, &out](const ReadView& read_view) {
+        return RDBPersistence::saveToStream(this, out, read_view, &rdb_saved_keys_);
+    });
+}
+
+bool StorageEngine::saveRDBInBackground(const std::string& filename) {
+    if (!beginRDBSave(false)) {
+        return false;
+    }
+    // 保存标记已被本次占用，上一个后台线程已经结束或即将结束
+    if (rdb_save_thread_.joinable()) {
+        rdb_save_thread_.join();
+    }
+    rdb_save_thread_ = std::thread([this, filename]() {
+        const bool saved = doSaveRDB([this, &filename](const ReadView& read_view) {
+            return RDBPersistence::saveToFile(this, filename, read_view, &rdb_saved_keys_);
+        });
+        if (saved) {
+            DKV_LOG_INFO("异步RDB保存成功");
+        } else {
+            DKV_LOG_ERROR("异步RDB保存失败");
+        }
+    });
+    return true;
+}
+
+bool StorageEngine::beginRDBSave(bool wait) {
+    // 快照须包含文件中的全部数据，后台加载未完成时先在调用线程载入剩余的数据块
+    finishRDBLoad();
+    std::unique_lock<std::mutex> lock(rdb_save_mutex_);
+    if (rdb_saving_ && !wait) {
+        return false;
+    }
+    rdb_save_cv_.wait(lock, [this]() { return !rdb_saving_; });
+    rdb_saving_ = true;
+    rdb_save_stats_.snapshot_keys = 0;
+    rdb_saved_keys_ = 0;
+    return true;
+}
+
+bool StorageEngine::doSaveRDB(const std::function<bool(const ReadView&)>& save) {
+    const auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(rdb_save_mutex_);
+        rdb_save_stats_.snapshot_keys = size();
+    }
+    // 以只读事务固定快照的读取视图，活跃事务会阻止回收水位线越过它，快照需要的历史版本不会被释放
+    const TransactionID snapshot_tx = transaction_manager_->begin();
+    const ReadView read_view = transaction_manager_->getTransaction(snapshot_tx).get_read_view();
+    const bool success = save(read_view);
+    transaction_manager_->commit(snapshot_tx);
+    return endRDBSave(success, start);
+}
+
+bool StorageEngine::beginSnapshot() {
+    if (!beginRDBSave(false)) {
+        return false;
+    }
+    cow_snapshot_start_ = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(rdb_save_mutex_);
+        rdb_save_stats_.snapshot_keys = size();
+    }
+    // 非事务写入直接覆盖最新版本，读取视图不能隔离它们，由按键写时复制保留快照时刻的内容
+    cow_snapshot_tx_ = transaction_manager_->begin();
+    inner_storage_.beginCapture(transaction_manager_->getTransaction(cow_snapshot_tx_).get_read_view());
+    return true;
+}
+
+bool StorageEngine::saveSnapshot(std::ostream& out) {
+    const ReadView read_view = transaction_manager_->getTransaction(cow_snapshot_tx_).get_read_view();
+    const bool success = RDBPersistence::saveToStream(this, out, read_view, &rdb_saved_keys_);
+    inner_storage_.endCapture();
+    transaction_manager_->commit(cow_snapshot_tx_);
+    cow_snapshot_tx_ = NO_TX;
+    return endRDBSave(success, cow_snapshot_start_);
+}
+
+bool StorageEngine::endRDBSave(bool success, std::chrono::steady_clock::time_point start) {
+    std::lock_guard<std::mutex> lock(rdb_save_mutex_);
+    rdb_save_stats_.last_status_ok = success;
+    rdb_save_stats_.last_duration_ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    if (success) {
+        rdb_save_stats_.last_save_time = std::chrono::duration_cast<std::chrono::seconds>(
+            Utils::getCurrentTime().time_since_epoch()).count();
+    }
+    rdb_saving_ = false;
+    rdb_save_cv_.notify_all();
+    return success;
+}
+
+RDBSaveStats StorageEngine::getRDBSaveStats() const {
+    std::lock_guard<std::mutex> lock(rdb_save_mutex_);
+    RDBSaveStats stats = rdb_save_stats_;
+    stats.in_progress = rdb_saving_;
+    stats.saved_keys = rdb_saved_keys_.load();
+    return stats;
 }
 
 // 从RDB文件加载数据
@@ -272,18 +957,49 @@ bool StorageEngine::loadRDB(const std::string& filename) {
     return rdb.loadFromFile(this, filename);
 }
 
+bool StorageEngine::loadRDBFromMemory(std::string_view data) {
+    return RDBPersistence::loadFromMemory(this, data, "<memory>");
+}
+
+bool StorageEngine::loadRDBInBackground(const std::string& filename, size_t threads) {
+    auto loader = std::make_unique<RDBLoader>(this);
+    if (!loader->start(filename, threads)) {
+        return false;
+    }
+    rdb_loader_ = std::move(loader);
+    return true;
+}
+
+bool StorageEngine::rdbLoading() const {
+    return rdb_loader_ && rdb_loader_->loading();
+}
+
+void StorageEngine::loadRDBKeys(const std::vector<Key>& keys) {
+    if (rdb_loader_) {
+        rdb_loader_->loadKeys(keys);
+    }
+}
+
+void StorageEngine::finishRDBLoad() {
+    if (rdb_loader_) {
+        rdb_loader_->finish();
+    }
+}
+
+RDBLoadStats StorageEngine::getRDBLoadStats() const {
+    return rdb_loader_ ? rdb_loader_->getStats() : RDBLoadStats();
+}
+
 bool StorageEngine::isKeyExpired(const Key& key) const {
-    auto it = inner_storage_.find(key);
-    if (it == inner_storage_.end()) {
+    DataItem* item = inner_storage_.get(key);
+    if (!item) {
         return false;
     }
-    return it->second->isExpired();
+    return item->isExpired();
 }
 
 void StorageEngine::removeExpiredKey(const Key& key) {
-    auto it = inner_storage_.find(key);
-    if (it != inner_storage_.end()) {
-        inner_storage_.erase(it);
+    if (inner_storage_.del(NO_TX, key)) {
         expired_keys_++;
     }
 }
@@ -337,8 +1053,9 @@ std::unique_ptr<DataItem> StorageEngine::createBitmapItem(Timestamp expire_time)
 }
 
 bool StorageEngine::hset(TransactionID tx_id, const Key& key, const Value& field, const Value& value) {
-    auto lock = inner_storage_.wlock();
-    DataItem* item = getDataItem(tx_id, key);
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::HASH, delta);
     if (!item || item->isExpired()) {
         // 键不存在，创建新的哈希项
         auto new_hash_item = createHashItem();
@@ -354,12 +1071,73 @@ bool StorageEngine::hset(TransactionID tx_id, const Key& key, const Value& field
         return false; // 键存在但不是哈希类型
     }
     
+    if (delta) {
+        Value old_value;
+        bool existed = hash_item->getField(field, old_value);
+        delta->deltas.push_back(UndoDelta::restoreField(field, old_value, existed));
+    }
     // 更新哈希项
     return hash_item->setField(field, value);
 }
 
+size_t StorageEngine::hmset(TransactionID tx_id, const Key& key, const std::vector<std::pair<Value, Value>>& fields) {
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::HASH, delta);
+    if (!item || item->isExpired()) {
+        // 键不存在，创建新的哈希项
+        auto new_hash_item = createHashItem();
+        auto* hash_item_ptr = dynamic_cast<HashItem*>(new_hash_item.get());
+        if (!hash_item_ptr) {
+            return 0;
+        }
+        size_t added = 0;
+        for (const auto& [field, value] : fields) {
+            added += hash_item_ptr->setField(field, value) ? 1 : 0;
+        }
+        return inner_storage_.set(tx_id, key, std::move(new_hash_item)) ? added : 0;
+    }
+
+    auto* hash_item = dynamic_cast<HashItem*>(item);
+    if (!hash_item) {
+        return 0; // 键存在但不是哈希类型
+    }
+
+    size_t added = 0;
+    for (const auto& [field, value] : fields) {
+        if (delta) {
+            Value old_value;
+            bool existed = hash_item->getField(field, old_value);
+            delta->deltas.push_back(UndoDelta::restoreField(field, old_value, existed));
+        }
+        added += hash_item->setField(field, value) ? 1 : 0;
+    }
+    return added;
+}
+
+std::vector<Value> StorageEngine::hmget(TransactionID tx_id, const Key& key, const std::vector<Value>& fields) {
+    auto lock = inner_storage_.rlock(key);
+    std::vector<Value> values(fields.size());
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        return values;
+    }
+
+    auto* hash_item = dynamic_cast<HashItem*>(item);
+    if (!hash_item) {
+        return values;
+    }
+
+    for (size_t i = 0; i < fields.size(); ++i) {
+        hash_item->getField(fields[i], values[i]);
+    }
+    hash_item->touch();
+    hash_item->incrementFrequency();
+    return values;
+}
+
 std::string StorageEngine::hget(TransactionID tx_id, const Key& key, const Value& field) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     // 使用getDataItem方法获取数据项
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
@@ -382,7 +1160,7 @@ std::string StorageEngine::hget(TransactionID tx_id, const Key& key, const Value
 }
 
 std::vector<std::pair<Value, Value>> StorageEngine::hgetall(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     // 使用getDataItem方法获取数据项
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
@@ -402,9 +1180,10 @@ std::vector<std::pair<Value, Value>> StorageEngine::hgetall(TransactionID tx_id,
 }
 
 bool StorageEngine::hdel(TransactionID tx_id, const Key& key, const Value& field) {
-    auto lock = inner_storage_.wlock();
+    auto lock = inner_storage_.wlock(key);
     // 使用getDataItem方法获取数据项
-    DataItem* item = getDataItem(tx_id, key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::HASH, delta);
     if (!item || item->isExpired()) {
         return false;
     }
@@ -414,12 +1193,22 @@ bool StorageEngine::hdel(TransactionID tx_id, const Key& key, const Value& field
         return false;
     }
     
+    if (delta) {
+        Value old_value;
+        if (!hash_item->getField(field, old_value)) {
+            return false;
+        }
+        delta->deltas.push_back(UndoDelta::restoreField(field, old_value, true));
+    }
     bool result = hash_item->delField(field);
+    if (result) {
+        removeIfEmpty(tx_id, key, hash_item);
+    }
     return result;
 }
 
 bool StorageEngine::hexists(TransactionID tx_id, const Key& key, const Value& field) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return false;
@@ -434,7 +1223,7 @@ bool StorageEngine::hexists(TransactionID tx_id, const Key& key, const Value& fi
 }
 
 std::vector<Value> StorageEngine::hkeys(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return {};
@@ -452,7 +1241,7 @@ std::vector<Value> StorageEngine::hkeys(TransactionID tx_id, const Key& key) {
 }
 
 std::vector<Value> StorageEngine::hvals(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return {};
@@ -470,7 +1259,7 @@ std::vector<Value> StorageEngine::hvals(TransactionID tx_id, const Key& key) {
 }
 
 size_t StorageEngine::hlen(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return 0;
@@ -484,9 +1273,25 @@ size_t StorageEngine::hlen(TransactionID tx_id, const Key& key) {
     return hash_item->size();
 }
 
-size_t StorageEngine::lpush(TransactionID tx_id, const Key& key, const Value& value) {
-    auto lock = inner_storage_.wlock();
+size_t StorageEngine::hscan(TransactionID tx_id, const Key& key, size_t cursor, size_t count, std::vector<std::pair<Value, Value>>& out) {
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        return 0;
+    }
+    
+    auto* hash_item = dynamic_cast<HashItem*>(item);
+    if (!hash_item) {
+        return 0;
+    }
+    
+    return hash_item->scan(cursor, count, out);
+}
+
+size_t StorageEngine::lpush(TransactionID tx_id, const Key& key, const Value& value) {
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::LIST, delta);
     if (!item || item->isExpired()) {
         // 键不存在，创建新的列表项
         auto new_list_item = createListItem();
@@ -505,13 +1310,17 @@ size_t StorageEngine::lpush(TransactionID tx_id, const Key& key, const Value& va
         return 0; // 键存在但不是列表类型
     }
     
+    if (delta) {
+        delta->deltas.push_back(UndoDelta::list(UndoDelta::Op::POP_FRONT));
+    }
     // 更新列表项
     return list_item->lpush(value);
 }
 
 size_t StorageEngine::rpush(TransactionID tx_id, const Key& key, const Value& value) {
-    auto lock = inner_storage_.wlock();
-    DataItem* item = getDataItem(tx_id, key);
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::LIST, delta);
     if (!item || item->isExpired()) {
         // 键不存在，创建新的列表项
         auto new_list_item = createListItem();
@@ -530,13 +1339,17 @@ size_t StorageEngine::rpush(TransactionID tx_id, const Key& key, const Value& va
         return 0; // 键存在但不是列表类型
     }
     
+    if (delta) {
+        delta->deltas.push_back(UndoDelta::list(UndoDelta::Op::POP_BACK));
+    }
     // 更新列表项
     return list_item->rpush(value);
 }
 
 std::string StorageEngine::lpop(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.wlock();
-    DataItem* item = getDataItem(tx_id, key);
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::LIST, delta);
     if (!item || item->isExpired()) {
         return "";
     }
@@ -548,9 +1361,13 @@ std::string StorageEngine::lpop(TransactionID tx_id, const Key& key) {
     
     Value value;
     if (list_item->lpop(value)) {
+        if (delta) {
+            delta->deltas.push_back(UndoDelta::list(UndoDelta::Op::PUSH_FRONT, value));
+        }
         // 更新访问时间和频率
         list_item->touch();
         list_item->incrementFrequency();
+        removeIfEmpty(tx_id, key, list_item);
         return value;
     }
     
@@ -558,8 +1375,9 @@ std::string StorageEngine::lpop(TransactionID tx_id, const Key& key) {
 }
 
 std::string StorageEngine::rpop(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.wlock();
-    DataItem* item = getDataItem(tx_id, key);
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::LIST, delta);
     if (!item || item->isExpired()) {
         return "";
     }
@@ -571,17 +1389,81 @@ std::string StorageEngine::rpop(TransactionID tx_id, const Key& key) {
     
     Value value;
     if (list_item->rpop(value)) {
+        if (delta) {
+            delta->deltas.push_back(UndoDelta::list(UndoDelta::Op::PUSH_BACK, value));
+        }
         // 更新访问时间和频率
         list_item->touch();
         list_item->incrementFrequency();
+        removeIfEmpty(tx_id, key, list_item);
         return value;
     }
     
     return "";
 }
 
+std::string StorageEngine::lmove(TransactionID tx_id, const Key& source, const Key& destination,
+                                 bool from_left, bool to_left) {
+    auto locks = inner_storage_.wlockKeys({source, destination});
+    UndoLog* source_delta = nullptr;
+    DataItem* source_item = getWritableItem(tx_id, source, DataType::LIST, source_delta);
+    auto* source_list = source_item && !source_item->isExpired() ? dynamic_cast<ListItem*>(source_item) : nullptr;
+    if (!source_list || source_list->size() == 0) {
+        return "";
+    }
+
+    // 先检查目标键的类型，不是列表时不弹出元素
+    ListItem* destination_list = source_list;
+    UndoLog* destination_delta = source_delta;
+    if (destination != source) {
+        DataItem* destination_item = getWritableItem(tx_id, destination, DataType::LIST, destination_delta);
+        destination_list = nullptr;
+        if (destination_item && !destination_item->isExpired()) {
+            destination_list = dynamic_cast<ListItem*>(destination_item);
+            if (!destination_list) {
+                return "";
+            }
+        }
+    }
+
+    Value value;
+    if (!(from_left ? source_list->lpop(value) : source_list->rpop(value))) {
+        return "";
+    }
+    if (source_delta) {
+        source_delta->deltas.push_back(UndoDelta::list(from_left ? UndoDelta::Op::PUSH_FRONT : UndoDelta::Op::PUSH_BACK, value));
+    }
+    source_list->touch();
+    source_list->incrementFrequency();
+    if (destination != source) {
+        removeIfEmpty(tx_id, source, source_list);
+    }
+
+    if (!destination_list) {
+        // 目标键不存在，创建新的列表项
+        auto new_list_item = createListItem();
+        auto* list_item_ptr = dynamic_cast<ListItem*>(new_list_item.get());
+        if (to_left) {
+            list_item_ptr->lpush(value);
+        } else {
+            list_item_ptr->rpush(value);
+        }
+        inner_storage_.set(tx_id, destination, std::move(new_list_item));
+        return value;
+    }
+    if (destination_delta) {
+        destination_delta->deltas.push_back(UndoDelta::list(to_left ? UndoDelta::Op::POP_FRONT : UndoDelta::Op::POP_BACK));
+    }
+    if (to_left) {
+        destination_list->lpush(value);
+    } else {
+        destination_list->rpush(value);
+    }
+    return value;
+}
+
 size_t StorageEngine::llen(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return 0;
@@ -596,7 +1478,7 @@ size_t StorageEngine::llen(TransactionID tx_id, const Key& key) {
 }
 
 std::vector<Value> StorageEngine::lrange(TransactionID tx_id, const Key& key, size_t start, size_t stop) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return {};
@@ -610,6 +1492,47 @@ std::vector<Value> StorageEngine::lrange(TransactionID tx_id, const Key& key, si
     return list_item->lrange(start, stop);
 }
 
+bool StorageEngine::lindex(TransactionID tx_id, const Key& key, int64_t index, Value& value) {
+    auto lock = inner_storage_.rlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        return false;
+    }
+    
+    auto* list_item = dynamic_cast<ListItem*>(item);
+    if (!list_item) {
+        return false;
+    }
+    
+    return list_item->lindex(index, value);
+}
+
+bool StorageEngine::lset(TransactionID tx_id, const Key& key, int64_t index, const Value& value) {
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::LIST, delta);
+    if (!item || item->isExpired()) {
+        return false;
+    }
+    
+    auto* list_item = dynamic_cast<ListItem*>(item);
+    if (!list_item) {
+        return false;
+    }
+    
+    Value old_value;
+    if (!list_item->lindex(index, old_value) || !list_item->lset(index, value)) {
+        return false;
+    }
+    if (delta) {
+        delta->deltas.push_back(UndoDelta::list(UndoDelta::Op::RESTORE_INDEX, old_value, index));
+    }
+    // 更新访问时间和频率
+    list_item->touch();
+    list_item->incrementFrequency();
+    return true;
+}
+
 // DataItemFactory 实现
 std::unique_ptr<DataItem> DataItemFactory::create(DataType type, const std::string& data) {
     switch (type) {
@@ -665,8 +1588,9 @@ std::unique_ptr<DataItem> DataItemFactory::create(DataType type, const std::stri
 }
 
 size_t StorageEngine::sadd(TransactionID tx_id, const Key& key, const std::vector<Value>& members) {
-    auto lock = inner_storage_.wlock();
-    DataItem* item = getDataItem(tx_id, key);
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::SET, delta);
     if (!item || item->isExpired()) {
         // 键不存在，创建新的集合项
         auto new_set_item = createSetItem();
@@ -685,13 +1609,21 @@ size_t StorageEngine::sadd(TransactionID tx_id, const Key& key, const std::vecto
         return 0; // 键存在但不是集合类型
     }
     
+    if (delta) {
+        for (const auto& member : members) {
+            if (!set_item->sismember(member)) {
+                delta->deltas.push_back(UndoDelta::restoreMember(member, false));
+            }
+        }
+    }
     // 添加多个元素并返回成功添加的个数
     return set_item->sadd(members);
 }
 
 size_t StorageEngine::srem(TransactionID tx_id, const Key& key, const std::vector<Value>& members) {
-    auto lock = inner_storage_.wlock();
-    DataItem* item = getDataItem(tx_id, key);
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::SET, delta);
     if (!item || item->isExpired()) {
         return 0; // 键不存在
     }
@@ -702,12 +1634,23 @@ size_t StorageEngine::srem(TransactionID tx_id, const Key& key, const std::vecto
         return 0; // 键存在但不是集合类型
     }
     
+    if (delta) {
+        for (const auto& member : members) {
+            if (set_item->sismember(member)) {
+                delta->deltas.push_back(UndoDelta::restoreMember(member, true));
+            }
+        }
+    }
     // 删除多个元素并返回成功删除的个数
-    return set_item->srem(members);
+    size_t removed = set_item->srem(members);
+    if (removed > 0) {
+        removeIfEmpty(tx_id, key, set_item);
+    }
+    return removed;
 }
 
 std::vector<Value> StorageEngine::smembers(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return {};
@@ -722,7 +1665,7 @@ std::vector<Value> StorageEngine::smembers(TransactionID tx_id, const Key& key)
 }
 
 bool StorageEngine::sismember(TransactionID tx_id, const Key& key, const Value& member) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return false;
@@ -737,7 +1680,7 @@ bool StorageEngine::sismember(TransactionID tx_id, const Key& key, const Value&
 }
 
 size_t StorageEngine::scard(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return 0;
@@ -751,6 +1694,69 @@ size_t StorageEngine::scard(TransactionID tx_id, const Key& key) {
     return set_item->scard();
 }
 
+size_t StorageEngine::sscan(TransactionID tx_id, const Key& key, size_t cursor, size_t count, std::vector<Value>& out) {
+    auto lock = inner_storage_.rlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        return 0;
+    }
+    
+    auto* set_item = dynamic_cast<SetItem*>(item);
+    if (!set_item) {
+        return 0;
+    }
+    
+    return set_item->scan(cursor, count, out);
+}
+
+bool StorageEngine::setOp(TransactionID tx_id, SetOp op, const std::vector<Key>& keys, std::vector<Value>& members) {
+    auto locks = inner_storage_.rlockKeys(keys);
+    std::vector<const SetItem*> sets;
+    for (const auto& key : keys) {
+        DataItem* item = getDataItem(tx_id, key);
+        if (!item || item->isExpired()) {
+            sets.push_back(nullptr);
+            continue;
+        }
+        auto* set_item = dynamic_cast<SetItem*>(item);
+        if (!set_item) {
+            return false;
+        }
+        sets.push_back(set_item);
+    }
+    members = SetItem::combine(op, sets)->smembers();
+    return true;
+}
+
+bool StorageEngine::setOpStore(TransactionID tx_id, SetOp op, const Key& destkey, const std::vector<Key>& keys, size_t& count) {
+    std::vector<Key> lock_keys(keys);
+    lock_keys.push_back(destkey);
+    auto locks = inner_storage_.wlockKeys(lock_keys);
+    std::vector<const SetItem*> sets;
+    for (const auto& key : keys) {
+        DataItem* item = getDataItem(tx_id, key);
+        if (!item || item->isExpired()) {
+            sets.push_back(nullptr);
+            continue;
+        }
+        auto* set_item = dynamic_cast<SetItem*>(item);
+        if (!set_item) {
+            return false;
+        }
+        sets.push_back(set_item);
+    }
+    std::unique_ptr<SetItem> result = SetItem::combine(op, sets);
+    count = result->scard();
+    if (count == 0) {
+        // 与Redis相同，结果为空时删除目标键
+        if (getDataItem(tx_id, destkey)) {
+            inner_storage_.del(tx_id, destkey);
+        }
+        return true;
+    }
+    return inner_storage_.set(tx_id, destkey, std::move(result));
+}
+
 DataItem* StorageEngine::getDataItem(TransactionID tx_id, const Key& key) {
     DataItem* item = inner_storage_.get(key, getReadView(tx_id));
     if (!item || item->isExpired()) {
@@ -759,22 +1765,58 @@ DataItem* StorageEngine::getDataItem(TransactionID tx_id, const Key& key) {
     return item;
 }
 
+DataItem* StorageEngine::getWritableItem(TransactionID tx_id, const Key& key, DataType type, UndoLog*& delta) {
+    delta = nullptr;
+    if (tx_id == NO_TX) {
+        return getDataItem(tx_id, key);
+    }
+    DataItem* item = inner_storage_.prepareWrite(tx_id, key, getReadView(tx_id), type, delta);
+    if (!item || item->isExpired()) {
+        return nullptr;
+    }
+    return item;
+}
+
+void StorageEngine::loadSegment(size_t segment, std::vector<std::pair<Key, std::unique_ptr<DataItem>>>& items) {
+    auto writelock = inner_storage_.wlockSegment(segment);
+    size_t added = 0;
+    for (auto& pair : items) {
+        assert(inner_storage_.segmentIndex(pair.first) == segment);
+        if (inner_storage_.insert_or_assign(pair.first, std::move(pair.second))) {
+            added++;
+        }
+    }
+    total_keys_ += added;
+    items.clear();
+}
+
+void StorageEngine::setRDBThreads(size_t threads) {
+    rdb_threads_ = threads;
+}
+
+size_t StorageEngine::getRDBThreads() const {
+    size_t threads = rdb_threads_.load();
+    if (threads == 0) {
+        threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    }
+    // 保存按分段划分任务，线程数不超过分段数
+    return std::min(threads, inner_storage_.segmentCount());
+}
+
 void StorageEngine::setDataItem(const Key& key, std::unique_ptr<DataItem> item) {
     assert(item.get());
-    auto writelock = inner_storage_.wlock();
+    auto writelock = inner_storage_.wlock(key);
 
-    auto it = inner_storage_.find(key);
-    if (it == inner_storage_.end()) {
+    if (inner_storage_.insert_or_assign(key, std::move(item))) {
         // 新键
         total_keys_++;
     }
-    // 更新现有键
-    it = inner_storage_.insert_or_assign(key, std::move(item)).first;
 }
 
 size_t StorageEngine::zadd(TransactionID tx_id, const Key& key, const std::vector<std::pair<Value, double>>& members_with_scores) {
-    auto lock = inner_storage_.wlock();
-    DataItem* item = getDataItem(tx_id, key);
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::ZSET, delta);
     if (!item || item->isExpired()) {
         // 键不存在，创建新的有序集合项
         auto new_zset_item = createZSetItem();
@@ -793,13 +1835,21 @@ size_t StorageEngine::zadd(TransactionID tx_id, const Key& key, const std::vecto
         return 0; // 键存在但不是有序集合类型
     }
     
+    if (delta) {
+        for (const auto& member_with_score : members_with_scores) {
+            double old_score = 0;
+            bool existed = zset_item->zscore(member_with_score.first, old_score);
+            delta->deltas.push_back(UndoDelta::restoreScore(member_with_score.first, old_score, existed));
+        }
+    }
     // 添加多个元素并返回成功添加的个数
     return zset_item->zadd(members_with_scores);
 }
 
 size_t StorageEngine::zrem(TransactionID tx_id, const Key& key, const std::vector<Value>& members) {
-    auto lock = inner_storage_.wlock();
-    DataItem* item = getDataItem(tx_id, key);
+    auto lock = inner_storage_.wlock(key);
+    UndoLog* delta = nullptr;
+    DataItem* item = getWritableItem(tx_id, key, DataType::ZSET, delta);
     if (!item || item->isExpired()) {
         return 0; // 键不存在
     }
@@ -810,12 +1860,24 @@ size_t StorageEngine::zrem(TransactionID tx_id, const Key& key, const std::vecto
         return 0; // 键存在但不是有序集合类型
     }
     
+    if (delta) {
+        for (const auto& member : members) {
+            double old_score = 0;
+            if (zset_item->zscore(member, old_score)) {
+                delta->deltas.push_back(UndoDelta::restoreScore(member, old_score, true));
+            }
+        }
+    }
     // 删除多个元素并返回成功删除的个数
-    return zset_item->zrem(members);
+    size_t removed = zset_item->zrem(members);
+    if (removed > 0) {
+        removeIfEmpty(tx_id, key, zset_item);
+    }
+    return removed;
 }
 
 bool StorageEngine::zscore(TransactionID tx_id, const Key& key, const Value& member, double& score) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return false;
@@ -830,7 +1892,7 @@ bool StorageEngine::zscore(TransactionID tx_id, const Key& key, const Value& mem
 }
 
 bool StorageEngine::zismember(TransactionID tx_id, const Key& key, const Value& member) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return false;
@@ -845,7 +1907,7 @@ bool StorageEngine::zismember(TransactionID tx_id, const Key& key, const Value&
 }
 
 bool StorageEngine::zrank(TransactionID tx_id, const Key& key, const Value& member, size_t& rank) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return false;
@@ -860,7 +1922,7 @@ bool StorageEngine::zrank(TransactionID tx_id, const Key& key, const Value& memb
 }
 
 bool StorageEngine::zrevrank(TransactionID tx_id, const Key& key, const Value& member, size_t& rank) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return false;
@@ -875,7 +1937,7 @@ bool StorageEngine::zrevrank(TransactionID tx_id, const Key& key, const Value& m
 }
 
 std::vector<std::pair<Value, double>> StorageEngine::zrange(TransactionID tx_id, const Key& key, size_t start, size_t stop) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return {};
@@ -890,7 +1952,7 @@ std::vector<std::pair<Value, double>> StorageEngine::zrange(TransactionID tx_id,
 }
 
 std::vector<std::pair<Value, double>> StorageEngine::zrevrange(TransactionID tx_id, const Key& key, size_t start, size_t stop) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return {};
@@ -905,7 +1967,7 @@ std::vector<std::pair<Value, double>> StorageEngine::zrevrange(TransactionID tx_
 }
 
 std::vector<std::pair<Value, double>> StorageEngine::zrangebyscore(TransactionID tx_id, const Key& key, double min, double max) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return {};
@@ -920,7 +1982,7 @@ std::vector<std::pair<Value, double>> StorageEngine::zrangebyscore(TransactionID
 }
 
 std::vector<std::pair<Value, double>> StorageEngine::zrevrangebyscore(TransactionID tx_id, const Key& key, double max, double min) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return {};
@@ -935,7 +1997,7 @@ std::vector<std::pair<Value, double>> StorageEngine::zrevrangebyscore(Transactio
 }
 
 size_t StorageEngine::zcount(TransactionID tx_id, const Key& key, double min, double max) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return 0;
@@ -949,7 +2011,7 @@ size_t StorageEngine::zcount(TransactionID tx_id, const Key& key, double min, do
 }
 
 size_t StorageEngine::zcard(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return 0;
@@ -962,9 +2024,84 @@ size_t StorageEngine::zcard(TransactionID tx_id, const Key& key) {
     return zset_item->zcard();
 }
 
+size_t StorageEngine::zscan(TransactionID tx_id, const Key& key, size_t cursor, size_t count, std::vector<std::pair<Value, double>>& out) {
+    auto lock = inner_storage_.rlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        return 0;
+    }
+    
+    auto* zset_item = dynamic_cast<ZSetItem*>(item);
+    if (!zset_item) {
+        return 0;
+    }
+    return zset_item->scan(cursor, count, out);
+}
+
+bool StorageEngine::zsetOpStore(TransactionID tx_id, SetOp op, const Key& destkey, const std::vector<Key>& keys,
+                                const std::vector<double>& weights, ZSetAggregate aggregate, size_t& count) {
+    std::vector<Key> lock_keys(keys);
+    lock_keys.push_back(destkey);
+    auto locks = inner_storage_.wlockKeys(lock_keys);
+    std::vector<const ZSetItem*> sets;
+    for (const auto& key : keys) {
+        DataItem* item = getDataItem(tx_id, key);
+        if (!item || item->isExpired()) {
+            sets.push_back(nullptr);
+            continue;
+        }
+        auto* zset_item = dynamic_cast<ZSetItem*>(item);
+        if (!zset_item) {
+            return false;
+        }
+        sets.push_back(zset_item);
+    }
+    std::unique_ptr<ZSetItem> result = ZSetItem::combine(op, sets, weights, aggregate);
+    count = result->zcard();
+    if (count == 0) {
+        if (getDataItem(tx_id, destkey)) {
+            inner_storage_.del(tx_id, destkey);
+        }
+        return true;
+    }
+    return inner_storage_.set(tx_id, destkey, std::move(result));
+}
+
+bool StorageEngine::zrangestore(TransactionID tx_id, const Key& destkey, const Key& source, const ZRangeSpec& range, size_t& count) {
+    auto locks = inner_storage_.wlockKeys({source, destkey});
+    std::vector<std::pair<Value, double>> entries;
+    DataItem* item = getDataItem(tx_id, source);
+    if (item && !item->isExpired()) {
+        auto* zset_item = dynamic_cast<ZSetItem*>(item);
+        if (!zset_item) {
+            return false;
+        }
+        if (range.by_score) {
+            entries = range.rev ? zset_item->zrevrangebyscore(range.max, range.min)
+                                : zset_item->zrangebyscore(range.min, range.max);
+        } else {
+            entries = range.rev ? zset_item->zrevrange(range.start, range.stop)
+                                : zset_item->zrange(range.start, range.stop);
+        }
+        if (range.rev) {
+            std::reverse(entries.begin(), entries.end());
+        }
+    }
+    count = entries.size();
+    if (count == 0) {
+        if (getDataItem(tx_id, destkey)) {
+            inner_storage_.del(tx_id, destkey);
+        }
+        return true;
+    }
+    auto result = std::make_unique<ZSetItem>();
+    result->assignSorted(std::move(entries));
+    return inner_storage_.set(tx_id, destkey, std::move(result));
+}
+
 // 位图操作实现
 bool StorageEngine::setBit(TransactionID tx_id, const Key& key, size_t offset, bool value) {
-    auto lock = inner_storage_.wlock();
+    auto lock = inner_storage_.wlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         // 键不存在，创建新的位图项
@@ -988,7 +2125,7 @@ bool StorageEngine::setBit(TransactionID tx_id, const Key& key, size_t offset, b
 }
 
 bool StorageEngine::getBit(TransactionID tx_id, const Key& key, size_t offset) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return false;
@@ -1003,7 +2140,7 @@ bool StorageEngine::getBit(TransactionID tx_id, const Key& key, size_t offset) {
 }
 
 size_t StorageEngine::bitCount(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return 0;
@@ -1018,7 +2155,7 @@ size_t StorageEngine::bitCount(TransactionID tx_id, const Key& key) {
 }
 
 size_t StorageEngine::bitCount(TransactionID tx_id, const Key& key, size_t start, size_t end) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         return 0;
@@ -1032,8 +2169,63 @@ size_t StorageEngine::bitCount(TransactionID tx_id, const Key& key, size_t start
     return bitmap_item->bitCount(start, end);
 }
 
+int64_t StorageEngine::bitPos(TransactionID tx_id, const Key& key, bool bit, size_t start, std::optional<size_t> end) {
+    auto lock = inner_storage_.rlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        return bit ? -1 : 0;
+    }
+    
+    auto* bitmap_item = dynamic_cast<BitmapItem*>(item);
+    if (!bitmap_item) {
+        return -1;
+    }
+    
+    return bitmap_item->bitPos(bit, start, end);
+}
+
+std::vector<std::optional<int64_t>> StorageEngine::bitField(TransactionID tx_id, const Key& key, const std::vector<BitFieldOp>& ops) {
+    const bool read_only = std::all_of(ops.begin(), ops.end(),
+                                       [](const BitFieldOp& op) { return op.type == BitFieldOp::Type::GET; });
+    if (read_only) {
+        auto lock = inner_storage_.rlock(key);
+        DataItem* item = getDataItem(tx_id, key);
+        if (!item || item->isExpired()) {
+            // 不存在的键所有位为0
+            return std::vector<std::optional<int64_t>>(ops.size(), int64_t(0));
+        }
+        auto* bitmap_item = dynamic_cast<BitmapItem*>(item);
+        if (!bitmap_item) {
+            return {};
+        }
+        return bitmap_item->bitField(ops);
+    }
+
+    auto lock = inner_storage_.wlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        // 键不存在，创建新的位图项
+        auto new_bitmap_item = createBitmapItem();
+        auto* bitmap_item_ptr = dynamic_cast<BitmapItem*>(new_bitmap_item.get());
+        auto results = bitmap_item_ptr->bitField(ops);
+        if (!bitmap_item_ptr->empty()) {
+            inner_storage_.set(tx_id, key, std::move(new_bitmap_item));
+        }
+        return results;
+    }
+    
+    auto* bitmap_item = dynamic_cast<BitmapItem*>(item);
+    if (!bitmap_item) {
+        return {}; // 键存在但不是位图类型
+    }
+    
+    return bitmap_item->bitField(ops);
+}
+
 bool StorageEngine::bitOp(TransactionID tx_id, const std::string& operation, const Key& destkey, const std::vector<Key>& keys) {
-    auto lock = inner_storage_.wlock();
+    std::vector<Key> lock_keys(keys);
+    lock_keys.push_back(destkey);
+    auto locks = inner_storage_.wlockKeys(lock_keys);
     // 检查源键是否都存在且未过期且都是位图类型
     std::vector<BitmapItem*> bitmap_items;
     for (const auto& key : keys) {
@@ -1074,19 +2266,18 @@ bool StorageEngine::bitOp(TransactionID tx_id, const std::string& operation, con
 
 // HyperLogLog操作实现
 bool StorageEngine::pfadd(TransactionID tx_id, const Key& key, const std::vector<Value>& elements) {
-    auto lock = inner_storage_.wlock();
+    return pfadd(tx_id, key, elements.data(), elements.size());
+}
+
+bool StorageEngine::pfadd(TransactionID tx_id, const Key& key, const Value* elements, size_t count) {
+    auto lock = inner_storage_.wlock(key);
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
         // 键不存在，创建新的HyperLogLog项
         auto new_hll_item = createHyperLogLogItem();
         auto* hll_item_ptr = dynamic_cast<HyperLogLogItem*>(new_hll_item.get());
         if (hll_item_ptr) {
-            bool modified = false;
-            for (const auto& element : elements) {
-                if (hll_item_ptr->add(element)) {
-                    modified = true;
-                }
-            }
+            bool modified = hll_item_ptr->add(elements, count);
             if (inner_storage_.set(tx_id, key, std::move(new_hll_item))) {
                 return modified;
             }
@@ -1099,18 +2290,11 @@ bool StorageEngine::pfadd(TransactionID tx_id, const Key& key, const std::vector
         return false; // 键存在但不是HyperLogLog类型
     }
     
-    bool modified = false;
-    for (const auto& element : elements) {
-        if (hll_item->add(element)) {
-            modified = true;
-        }
-    }
-    
-    return modified;
+    return hll_item->add(elements, count);
 }
 
 uint64_t StorageEngine::pfcount(TransactionID tx_id, const Key& key) {
-    auto lock = inner_storage_.rlock();
+    auto lock = inner_storage_.rlock(key);
     // 使用getDataItem方法获取数据项，它会处理MVCC
     DataItem* item = getDataItem(tx_id, key);
     if (!item || item->isExpired()) {
@@ -1125,8 +2309,27 @@ uint64_t StorageEngine::pfcount(TransactionID tx_id, const Key& key) {
     return hll_item->count();
 }
 
+uint64_t StorageEngine::pfcount(TransactionID tx_id, const std::vector<Key>& keys) {
+    auto locks = inner_storage_.rlockKeys(keys);
+    std::vector<const HyperLogLogItem*> hll_items;
+    for (const auto& key : keys) {
+        DataItem* item = getDataItem(tx_id, key);
+        if (!item || item->isExpired()) {
+            continue;
+        }
+        auto* hll_item = dynamic_cast<HyperLogLogItem*>(item);
+        if (!hll_item) {
+            return 0;
+        }
+        hll_items.push_back(hll_item);
+    }
+    return HyperLogLogItem::countUnion(hll_items);
+}
+
 bool StorageEngine::pfmerge(TransactionID tx_id, const Key& destkey, const std::vector<Key>& sourcekeys) {
-    auto lock = inner_storage_.wlock();
+    std::vector<Key> lock_keys(sourcekeys);
+    lock_keys.push_back(destkey);
+    auto locks = inner_storage_.wlockKeys(lock_keys);
     // 检查源键是否都存在且未过期且都是HyperLogLog类型
     std::vector<HyperLogLogItem*> hll_items;
     for (const auto& key : sourcekeys) {
@@ -1159,6 +2362,64 @@ bool StorageEngine::pfmerge(TransactionID tx_id, const Key& destkey, const std::
     return false;
 }
 
+// 布隆过滤器操作实现
+bool StorageEngine::bfreserve(TransactionID tx_id, const Key& key, double error_rate, uint64_t capacity, uint32_t expansion) {
+    auto lock = inner_storage_.wlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (item && !item->isExpired()) {
+        return false;
+    }
+    return inner_storage_.set(tx_id, key, std::make_unique<BloomFilterItem>(error_rate, capacity, expansion));
+}
+
+bool StorageEngine::bfadd(TransactionID tx_id, const Key& key, const Value* elements, size_t count, std::vector<int>& results) {
+    auto lock = inner_storage_.wlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        // 键不存在，按默认参数创建
+        auto new_bloom_item = std::make_unique<BloomFilterItem>();
+        new_bloom_item->add(elements, count, results);
+        return inner_storage_.set(tx_id, key, std::move(new_bloom_item));
+    }
+
+    auto* bloom_item = dynamic_cast<BloomFilterItem*>(item);
+    if (!bloom_item) {
+        return false; // 键存在但不是布隆过滤器
+    }
+    bloom_item->add(elements, count, results);
+    return true;
+}
+
+bool StorageEngine::bfexists(TransactionID tx_id, const Key& key, const Value* elements, size_t count, std::vector<bool>& results) {
+    auto lock = inner_storage_.rlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        results.assign(count, false);
+        return true;
+    }
+
+    auto* bloom_item = dynamic_cast<BloomFilterItem*>(item);
+    if (!bloom_item) {
+        return false;
+    }
+    bloom_item->exists(elements, count, results);
+    return true;
+}
+
+uint64_t StorageEngine::bfcard(TransactionID tx_id, const Key& key) {
+    auto lock = inner_storage_.rlock(key);
+    DataItem* item = getDataItem(tx_id, key);
+    if (!item || item->isExpired()) {
+        return 0;
+    }
+
+    auto* bloom_item = dynamic_cast<BloomFilterItem*>(item);
+    if (!bloom_item) {
+        return 0;
+    }
+    return bloom_item->count();
+}
+
 // 创建HyperLogLogItem的工厂方法
 std::unique_ptr<DataItem> StorageEngine::createHyperLogLogItem() {
     return std::unique_ptr<DataItem>(dkv::createHyperLogLogItem());
@@ -1169,74 +2430,64 @@ std::unique_ptr<DataItem> StorageEngine::createHyperLogLogItem(Timestamp expire_
 }
 
 // 淘汰策略相关方法实现
-std::vector<Key> StorageEngine::getAllKeys() const {
-    auto readlock = inner_storage_.rlock();
-    std::vector<Key> result;
-    result.reserve(inner_storage_.size());
-    
-    for (const auto& pair : inner_storage_) {
-        result.push_back(pair.first);
+std::vector<SharedKey> StorageEngine::getAllKeys() const {
+    std::vector<SharedKey> result;
+    for (size_t i = 0; i < inner_storage_.segmentCount(); ++i) {
+        auto readlock = inner_storage_.rlockSegment(i);
+        for (const auto& pair : inner_storage_.segmentData(i)) {
+            result.push_back(pair.first);
+        }
     }
     
     return result;
 }
 
 bool StorageEngine::hasExpiration(const Key& key) const {
-    auto readlock = inner_storage_.rlock();
+    auto readlock = inner_storage_.rlock(key);
     
-    auto it = inner_storage_.find(key);
-    if (it == inner_storage_.end()) {
+    DataItem* item = inner_storage_.get(key);
+    if (!item) {
         return false;
     }
     // hasExpiration is atomic, so we can read it without a lock
-    return it->second->hasExpiration();
+    return item->hasExpiration();
 }
 
 Timestamp StorageEngine::getLastAccessed(const Key& key) const {
-    auto readlock = inner_storage_.rlock();
+    auto readlock = inner_storage_.rlock(key);
     
-    auto it = inner_storage_.find(key);
-    if (it == inner_storage_.end()) {
+    DataItem* item = inner_storage_.get(key);
+    if (!item) {
         return Timestamp::min();
     }
     // getLastAccessed is atomic, so we can read it without a lock
-    return it->second->getLastAccessed();
+    return item->getLastAccessed();
 }
 
 int StorageEngine::getAccessFrequency(const Key& key) const {
-    auto readlock = inner_storage_.rlock();
+    auto readlock = inner_storage_.rlock(key);
     
-    auto it = inner_storage_.find(key);
-    if (it == inner_storage_.end()) {
+    DataItem* item = inner_storage_.get(key);
+    if (!item) {
         return 0;
     }
     // getAccessFrequency is atomic, so we can read it without a lock
-    return it->second->getAccessFrequency();
+    return item->getAccessFrequency();
 }
 
 Timestamp StorageEngine::getExpiration(const Key& key) const {
-    auto readlock = inner_storage_.rlock();
+    auto readlock = inner_storage_.rlock(key);
     
-    auto it = inner_storage_.find(key);
-    if (it == inner_storage_.end() || !it->second->hasExpiration()) {
+    DataItem* item = inner_storage_.get(key);
+    if (!item || !item->hasExpiration()) {
         return Timestamp::max();
     }
     // getExpiration is atomic, so we can read it without a lock
-    return it->second->getExpiration();
+    return item->getExpiration();
 }
 
 size_t StorageEngine::getKeySize(const Key& key) const {
-    auto readlock = inner_storage_.rlock();
-    
-    auto it = inner_storage_.find(key);
-    if (it == inner_storage_.end()) {
-        return 0;
-    }
-    
-    // 估算键的大小，包括键名和值
-    auto keylock = it->second->rlock();
-    size_t size = key.size() + it->second->serialize().size();
-    return size;
+    return memoryUsage(key).value_or(0);
 }
 
 } // namespace dkv
@@ -0,0 +1,307 @@
+#include "storage/dkv_tiered_storage.hpp"
+#include "dkv_datatypes.hpp"
+#include "dkv_logger.hpp"
+#include "net/dkv_io_uring.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <limits>
+#include <stdexcept>
+
+namespace dkv {
+
+namespace {
+
+// 每批异步读取最多提交的记录数，与io_uring队列深度相同
+constexpr unsigned READ_QUEUE_DEPTH = 64;
+
+std::unique_ptr<DataItem> createItem(DataType type) {
+    switch (type) {
+        case DataType::STRING:
+            return std::make_unique<StringItem>();
+        case DataType::HASH:
+            return std::make_unique<HashItem>();
+        case DataType::LIST:
+            return std::make_unique<ListItem>();
+        case DataType::SET:
+            return std::make_unique<SetItem>();
+        case DataType::ZSET:
+            return std::make_unique<ZSetItem>();
+        case DataType::BITMAP:
+            return std::make_unique<BitmapItem>();
+        case DataType::HYPERLOGLOG:
+            return std::make_unique<HyperLogLogItem>();
+        case DataType::BLOOM:
+            return std::make_unique<BloomFilterItem>();
+    }
+    return nullptr;
+}
+
+bool preadAll(int fd, char* buffer, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = ::pread(fd, buffer, length, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buffer += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+SpilledItem::SpilledItem(const DataItem& original, SpillRef ref, TieredStore* store)
+    : DataItem(original), type_(original.getType()), ref_(ref), store_(store) {
+    flags_.fetch_or(FLAG_SPILLED, std::memory_order_relaxed);
+    setTransactionId(original.getTransactionId());
+}
+
+SpilledItem::~SpilledItem() {
+    store_->release(ref_);
+}
+
+std::string SpilledItem::serialize() const {
+    std::string data;
+    if (!store_->read(ref_, data)) {
+        // 返回空串会被当作合法的空值写入RDB或迁移到其他分片
+        throw std::runtime_error("读取分层存储日志失败，偏移: " + std::to_string(ref_.offset));
+    }
+    return data;
+}
+
+void SpilledItem::deserialize(const std::string&) {
+    // 值只能经TieredStore::materialize载入为原类型的数据项
+}
+
+std::unique_ptr<DataItem> SpilledItem::clone() const {
+    return store_->load(*this);
+}
+
+std::unique_ptr<DataItem> SpilledItem::cloneEmpty() const {
+    return createItem(type_);
+}
+
+size_t SpilledItem::memoryUsage(size_t) const {
+    // 值在磁盘日志中，内存里只有元数据
+    return sizeof(SpilledItem);
+}
+
+const char* SpilledItem::encodingName() const {
+    return "spilled";
+}
+
+TieredStore::TieredStore(const TieredConfig& config) : config_(config) {
+}
+
+TieredStore::~TieredStore() {
+    {
+        std::lock_guard<std::mutex> lock(read_mutex_);
+        stopping_ = true;
+    }
+    read_cv_.notify_one();
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        ::unlink(config_.path.c_str());
+    }
+}
+
+bool TieredStore::open() {
+    fd_ = ::open(config_.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        DKV_LOG_ERROR("无法创建分层存储日志文件: ", config_.path);
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<DataItem> TieredStore::spill(const DataItem& item) {
+    const std::string data = item.serialize();
+    // 记录长度为32位，更大的值留在内存
+    if (data.size() < config_.min_spill_size || data.size() >= std::numeric_limits<uint32_t>::max()) {
+        return nullptr;
+    }
+    SpillRef ref;
+    ref.length = static_cast<uint32_t>(data.size());
+    {
+        // 追加写入在锁内分配偏移并写出，保证记录在日志中不重叠
+        std::lock_guard<std::mutex> lock(append_mutex_);
+        ref.offset = end_;
+        const char* buffer = data.data();
+        size_t remaining = data.size();
+        uint64_t offset = ref.offset;
+        while (remaining > 0) {
+            ssize_t n = ::pwrite(fd_, buffer, remaining, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                DKV_LOG_ERROR("写入分层存储日志失败: ", config_.path);
+                return nullptr;
+            }
+            buffer += n;
+            remaining -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+        end_ = offset;
+    }
+    live_records_.fetch_add(1, std::memory_order_relaxed);
+    live_bytes_.fetch_add(ref.length, std::memory_order_relaxed);
+    spills_.fetch_add(1, std::memory_order_relaxed);
+    return std::make_unique<SpilledItem>(item, ref, this);
+}
+
+bool TieredStore::read(const SpillRef& ref, std::string& data) {
+    data.resize(ref.length);
+    if (!preadAll(fd_, &data[0], ref.length, ref.offset)) {
+        load_errors_.fetch_add(1, std::memory_order_relaxed);
+        DKV_LOG_ERROR("读取分层存储日志失败，偏移: ", ref.offset);
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<DataItem> TieredStore::load(const SpilledItem& item) {
+    std::string data;
+    if (!read(item.ref(), data)) {
+        return nullptr;
+    }
+    return materialize(item, data);
+}
+
+std::unique_ptr<DataItem> TieredStore::materialize(const SpilledItem& item, const std::string& data) {
+    std::unique_ptr<DataItem> loaded = createItem(item.getType());
+    if (!loaded) {
+        return nullptr;
+    }
+    loaded->deserialize(data);
+    if (item.hasExpiration()) {
+        loaded->setExpiration(item.getExpiration());
+    }
+    loaded->assignAccessStats(item);
+    loaded->setTransactionId(item.getTransactionId());
+    loads_.fetch_add(1, std::memory_order_relaxed);
+    return loaded;
+}
+
+void TieredStore::release(const SpillRef& ref) {
+    live_records_.fetch_sub(1, std::memory_order_relaxed);
+    live_bytes_.fetch_sub(ref.length, std::memory_order_relaxed);
+    // 只有整块落在记录内的部分会真正释放，失败（文件系统不支持）时只是不回收空间
+    ::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(ref.offset), ref.length);
+}
+
+void TieredStore::readAsync(std::vector<SpillRef> refs, ReadCallback done) {
+    std::lock_guard<std::mutex> lock(read_mutex_);
+    requests_.push_back(ReadRequest{std::move(refs), std::move(done)});
+    if (!reader_.joinable()) {
+        reader_ = std::thread(&TieredStore::readerThread, this);
+    }
+    read_cv_.notify_one();
+}
+
+void TieredStore::readerThread() {
+    // ring只在本线程使用；创建失败（内核不支持或受限）时用pread读取
+    IoUring ring;
+    bool ring_ready = ring.init(READ_QUEUE_DEPTH);
+    std::unique_lock<std::mutex> lock(read_mutex_);
+    while (true) {
+        read_cv_.wait(lock, [this] { return stopping_ || !requests_.empty(); });
+        if (requests_.empty()) {
+            return;
+        }
+        std::vector<ReadRequest> batch;
+        while (!requests_.empty() && batch.size() < READ_QUEUE_DEPTH) {
+            batch.push_back(std::move(requests_.front()));
+            requests_.pop_front();
+        }
+        lock.unlock();
+        ring_ready = readBatch(batch, ring_ready ? &ring : nullptr) && ring_ready;
+        lock.lock();
+    }
+}
+
+bool TieredStore::readBatch(std::vector<ReadRequest>& batch, IoUring* ring) {
+    struct Pending {
+        std::vector<std::string> data;
+        std::vector<bool> ok;
+    };
+    std::vector<Pending> results(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        results[i].data.resize(batch[i].refs.size());
+        results[i].ok.assign(batch[i].refs.size(), false);
+        for (size_t j = 0; j < batch[i].refs.size(); ++j) {
+            results[i].data[j].resize(batch[i].refs[j].length);
+        }
+    }
+
+    bool ring_usable = ring != nullptr;
+    if (ring) {
+        unsigned inflight = 0;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            for (size_t j = 0; j < batch[i].refs.size(); ++j) {
+                io_uring_sqe* sqe = ring->getSqe();
+                if (!sqe) {
+                    continue; // 留给下面的pread
+                }
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = fd_;
+                sqe->off = batch[i].refs[j].offset;
+                sqe->addr = reinterpret_cast<uint64_t>(&results[i].data[j][0]);
+                sqe->len = batch[i].refs[j].length;
+                sqe->user_data = (static_cast<uint64_t>(i) << 32) | j;
+                inflight++;
+            }
+        }
+        while (inflight > 0) {
+            if (ring->submitAndWait(1) < 0) {
+                break;
+            }
+            inflight -= ring->forEachCqe([&](const io_uring_cqe& cqe) {
+                const size_t i = cqe.user_data >> 32;
+                const size_t j = cqe.user_data & 0xFFFFFFFFu;
+                results[i].ok[j] = cqe.res == static_cast<int>(batch[i].refs[j].length);
+            });
+        }
+        if (inflight > 0) {
+            // 提交失败时ring中可能仍有未完成的读取，之后不再使用它
+            ring_usable = false;
+            DKV_LOG_WARNING("io_uring提交失败，分层存储改用pread读取");
+        }
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        for (size_t j = 0; j < batch[i].refs.size(); ++j) {
+            if (!results[i].ok[j]) {
+                // 短读或不支持IORING_OP_READ时补读
+                results[i].ok[j] = read(batch[i].refs[j], results[i].data[j]);
+            }
+        }
+        batch[i].done(results[i].data, results[i].ok);
+    }
+    return ring_usable;
+}
+
+TieredStats TieredStore::stats() const {
+    TieredStats stats;
+    stats.spilled_keys = live_records_.load(std::memory_order_relaxed);
+    stats.live_bytes = live_bytes_.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(append_mutex_);
+        stats.log_bytes = end_;
+    }
+    stats.spills = spills_.load(std::memory_order_relaxed);
+    stats.loads = loads_.load(std::memory_order_relaxed);
+    stats.async_loads = async_loads_.load(std::memory_order_relaxed);
+    stats.load_errors = load_errors_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace dkv
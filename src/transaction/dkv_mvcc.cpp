@@ -1,10 +1,13 @@
 #include "transaction/dkv_mvcc.hpp"
 #include "storage/dkv_storage.hpp"
 #include "dkv_logger.hpp"
+#include "dkv_trace.hpp"
+#include <algorithm>
 #include <vector>
 #include <memory>
 #include <atomic>
 #include <cassert>
+#include <unordered_set>
 using namespace std;
 
 namespace dkv {
@@ -12,38 +15,57 @@ namespace dkv {
 // MVCC类，提供多版本并发控制
 
 // 获取指定事务可见的版本
-DataItem* MVCC::get(const ReadView& read_view, const Key& key) const{
+DataItem* MVCC::get(const ReadView& read_view, std::string_view key) const{
     // 查找键
-    auto it = inner_storage_.find(key);
-    if (it == inner_storage_.end()) {
+    DataItem* entry = inner_storage_.get(key);
+    if (entry == nullptr) {
         return nullptr;
     }
-    const unique_ptr<DataItem>& entry = it->second;
-    assert(entry);
     DKV_LOG_DEBUG("latest version for key ", key, " is writeen by tx ", entry->getTransactionId());
 
     // 检查事务可见性
     if (read_view.isVisible(entry->getTransactionId()) && !entry->isDiscard()) {
-        // 最新版本对事务可见，直接返回
-        return it->second.get();
+        // 最新版本对事务可见，直接返回；删除标记不携带内容
+        return entry->isDeleted() ? nullptr : entry;
     }
     // 最新版本对事务不可见或已删除，需要找历史版本
+    TraceSpan span("mvcc_chain");
     DKV_LOG_DEBUG("Lookup history version for key:", key, " with read_view: ", read_view);
+    // 增量版本的内容由最近一个完整版本依次应用途经的逆操作得到
+    const DataItem* base = entry;
+    vector<UndoLog*> pending;
     UndoLog *undo_log = entry->getUndoLog().get();
-    while(undo_log != nullptr) {
+    while(undo_log != nullptr && undo_log->old_value) {
         const unique_ptr<DataItem>& old_item = undo_log->old_value;
+        const bool is_delta = undo_log->ty == UndoLogType::DELTA;
         if (read_view.isVisible(old_item->getTransactionId()) && !old_item->isDiscard()) {
             // 找到可见的历史版本
             // 如果历史版本是删除状态，返回空指针
-            if (undo_log->old_value->isDeleted()) {
+            if (old_item->isDeleted()) {
                 DKV_LOG_DEBUG("history version for key: {} is deleted", key);
                 return nullptr;
             }
             // 如果历史版本是非删除状态，返回数据项
             DKV_LOG_DEBUG("visible history version for key: {} is tx {}", key, old_item->getTransactionId());
+            if (is_delta) {
+                pending.push_back(undo_log);
+                return materialize(*base, pending);
+            }
             return old_item.get();
         }
         DKV_LOG_DEBUG("history version tx {} for key {} is not visible", old_item->getTransactionId(), key);
+        if (!is_delta) {
+            base = old_item.get();
+            pending.clear();
+        } else {
+            lock_guard<mutex> lock(undo_log->materialize_mutex);
+            if (undo_log->materialized) {
+                base = undo_log->materialized.get();
+                pending.clear();
+            } else {
+                pending.push_back(undo_log);
+            }
+        }
         undo_log = old_item->getUndoLog().get();
     }
     // 没有可见的历史版本，返回空指针
@@ -60,7 +82,8 @@ bool MVCC::set(TransactionID tx_id, const Key& key, unique_ptr<DataItem> item) {
     new_undo_log->ty = UndoLogType::SET;
     new_undo_log->old_value = move(entry);
     if (!new_undo_log->old_value) {
-        new_undo_log->old_value = item->clone();
+        // 新键的上一个版本是不携带内容的删除标记
+        new_undo_log->old_value = item->cloneEmpty();
         new_undo_log->old_value->setDeleted(true);
     }
 
@@ -80,9 +103,8 @@ bool MVCC::del(TransactionID tx_id, const Key& key) {
     new_undo_log->ty = UndoLogType::DELETE;
     new_undo_log->old_value = move(entry);
 
-    // 创建删除标记的虚拟数据项
-    // 使用之前保存到undo_log的旧值来克隆，而不是空的entry
-    unique_ptr<DataItem> virtual_item = new_undo_log->old_value->clone();
+    // 创建删除标记的虚拟数据项，只保留类型，不复制旧值的内容
+    unique_ptr<DataItem> virtual_item = new_undo_log->old_value->cloneEmpty();
     virtual_item->setTransactionId(tx_id);
     virtual_item->setDeleted(true);
     virtual_item->setUndoLog(move(new_undo_log));
@@ -90,6 +112,196 @@ bool MVCC::del(TransactionID tx_id, const Key& key) {
     return true;
 }
 
+DataItem* MVCC::prepareWrite(TransactionID tx_id, const Key& key, const ReadView& read_view,
+                             DataType type, UndoLog*& delta) {
+    delta = nullptr;
+    DataItem* head = inner_storage_.get(key);
+    if (head == nullptr) {
+        return nullptr;
+    }
+    if (!head->isDiscard() && read_view.isVisible(head->getTransactionId())) {
+        if (head->isDeleted() || head->isExpired()) {
+            return nullptr;
+        }
+        if (head->getType() != type) {
+            // 类型不符，由调用方报错
+            return head;
+        }
+        if (head->getTransactionId() == tx_id) {
+            // 当前事务已有版本，继续在其上修改
+            UndoLog* undo_log = head->getUndoLog().get();
+            if (undo_log != nullptr && undo_log->ty == UndoLogType::DELTA) {
+                delta = undo_log;
+            }
+            return head;
+        }
+        // 最新版本已提交：当前事务在其上原地修改，上一个版本只保留元数据，内容由逆操作还原
+        unique_ptr<DataItem> previous = head->cloneEmpty();
+        previous->assignVersion(*head);
+        previous->setUndoLog(move(head->getUndoLog()));
+        unique_ptr<UndoLog> new_undo_log = make_unique<UndoLog>();
+        new_undo_log->ty = UndoLogType::DELTA;
+        new_undo_log->old_value = move(previous);
+        delta = new_undo_log.get();
+        head->setUndoLog(move(new_undo_log));
+        head->setTransactionId(tx_id);
+        return head;
+    }
+    // 最新版本属于其他未提交或已回滚的事务，不能在其上原地修改，复制可见版本作为当前事务的新版本
+    DataItem* visible = get(read_view, key);
+    if (visible == nullptr || visible->isExpired() || visible->getType() != type) {
+        return visible;
+    }
+    set(tx_id, key, visible->clone());
+    return inner_storage_.get(key);
+}
+
+void MVCC::applyUndo(DataItem& item, const vector<UndoDelta>& deltas) {
+    using Op = UndoDelta::Op;
+    Value popped;
+    for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+        const UndoDelta& delta = *it;
+        switch (item.getType()) {
+            case DataType::HASH: {
+                auto& hash_item = static_cast<HashItem&>(item);
+                if (delta.existed) {
+                    hash_item.setField(delta.member, delta.value);
+                } else {
+                    hash_item.delField(delta.member);
+                }
+                break;
+            }
+            case DataType::SET: {
+                auto& set_item = static_cast<SetItem&>(item);
+                if (delta.existed) {
+                    set_item.sadd(delta.member);
+                } else {
+                    set_item.srem(delta.member);
+                }
+                break;
+            }
+            case DataType::ZSET: {
+                auto& zset_item = static_cast<ZSetItem&>(item);
+                if (delta.existed) {
+                    zset_item.zadd(delta.member, delta.score);
+                } else {
+                    zset_item.zrem(delta.member);
+                }
+                break;
+            }
+            case DataType::LIST: {
+                auto& list_item = static_cast<ListItem&>(item);
+                switch (delta.op) {
+                    case Op::POP_FRONT: list_item.lpop(popped); break;
+                    case Op::POP_BACK: list_item.rpop(popped); break;
+                    case Op::PUSH_FRONT: list_item.lpush(delta.value); break;
+                    case Op::PUSH_BACK: list_item.rpush(delta.value); break;
+                    case Op::RESTORE_INDEX: list_item.lset(delta.index, delta.value); break;
+                    default: break;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+void MVCC::rewind(DataItem& item) {
+    unique_ptr<UndoLog> undo_log = move(item.getUndoLog());
+    applyUndo(item, undo_log->deltas);
+    DataItem& previous = *undo_log->old_value;
+    item.assignVersion(previous);
+    item.setUndoLog(move(previous.getUndoLog()));
+}
+
+DataItem* MVCC::materialize(const DataItem& base, const vector<UndoLog*>& pending) {
+    UndoLog& target = *pending.back();
+    lock_guard<mutex> lock(target.materialize_mutex);
+    if (!target.materialized) {
+        unique_ptr<DataItem> content = base.clone();
+        for (const UndoLog* undo_log : pending) {
+            applyUndo(*content, undo_log->deltas);
+        }
+        content->assignVersion(*target.old_value);
+        target.materialized = move(content);
+    }
+    return target.materialized.get();
+}
+
+PurgeResult MVCC::purge(unique_ptr<DataItem>& entry, TransactionID horizon,
+                        const unordered_set<TransactionID>& rolledback) {
+    PurgeResult result;
+    auto discarded = [&rolledback](const DataItem& item) {
+        return item.isDiscard() || rolledback.count(item.getTransactionId()) > 0;
+    };
+    // 摘掉已回滚的最新版本，由它的上一个版本接替
+    while (entry && discarded(*entry)) {
+        const unique_ptr<UndoLog>& head_undo = entry->getUndoLog();
+        if (head_undo && head_undo->ty == UndoLogType::DELTA) {
+            // 增量版本：在原地撤销修改
+            rewind(*entry);
+        } else {
+            unique_ptr<UndoLog> undo_log = move(entry->getUndoLog());
+            entry = undo_log ? move(undo_log->old_value) : nullptr;
+        }
+        result.purged++;
+    }
+    if (!entry) {
+        result.removable = true;
+        return result;
+    }
+
+    DataItem* item = entry.get();
+    result.chain_length = 1;
+    while (true) {
+        unique_ptr<UndoLog>& undo_log = item->getUndoLog();
+        if (item->getTransactionId() < horizon) {
+            // 所有读取视图最多读到这个版本，释放更旧的版本
+            for (UndoLog* old = undo_log.get(); old != nullptr && old->old_value; old = old->old_value->getUndoLog().get()) {
+                result.purged++;
+            }
+            undo_log.reset();
+            break;
+        }
+        if (!undo_log || !undo_log->old_value) {
+            undo_log.reset();
+            break;
+        }
+        DataItem* older = undo_log->old_value.get();
+        if (discarded(*older)) {
+            // 把已回滚的版本从链中摘除
+            const unique_ptr<UndoLog>& older_undo = older->getUndoLog();
+            if (undo_log->ty != UndoLogType::DELTA && older_undo && older_undo->ty == UndoLogType::DELTA) {
+                // 完整版本的上一个版本是增量版本：原地撤销，使其成为上一个版本
+                rewind(*older);
+            } else {
+                unique_ptr<UndoLog> skipped = move(older->getUndoLog());
+                if (skipped && skipped->old_value) {
+                    if (undo_log->ty == UndoLogType::DELTA && skipped->ty == UndoLogType::DELTA) {
+                        // 两段增量合并，先撤销较新的一段
+                        undo_log->deltas.insert(undo_log->deltas.begin(), skipped->deltas.begin(), skipped->deltas.end());
+                    } else {
+                        undo_log->ty = skipped->ty;
+                        undo_log->deltas.clear();
+                    }
+                    undo_log->old_value = move(skipped->old_value);
+                    undo_log->materialized.reset();
+                } else {
+                    undo_log.reset();
+                }
+            }
+            result.purged++;
+            continue;
+        }
+        item = older;
+        result.chain_length++;
+    }
+    // 所有读取视图都只能看到删除标记，键不再需要保留
+    result.removable = result.chain_length == 1 && entry->isDeleted() && entry->getTransactionId() < horizon;
+    return result;
+}
+
 // 检查数据项对指定ReadView是否可见
 bool ReadView::isVisible(TransactionID tx_id) const {
     // 如果数据项的事务ID小于read_view.low，说明事务已提交，则可见
@@ -104,12 +316,8 @@ bool ReadView::isVisible(TransactionID tx_id) const {
     if (tx_id == this->creator) {
         return true;
     }
-    // 如果tx_id在read_view.actives中，说明事务已开始未提交，则不可见
-    if (find(this->actives.begin(), this->actives.end(), tx_id) != this->actives.end()) {
-        return false;
-    }
-    // 否则说明tx_id已提交，则可见
-    return true;
+    // 如果tx_id在read_view.actives中，说明事务已开始未提交或已回滚，则不可见；否则说明已提交，则可见
+    return !(this->actives && binary_search(this->actives->begin(), this->actives->end(), tx_id));
 }
 
 } // namespace dkv
\ No newline at end of file
@@ -12,7 +12,7 @@ Transaction::Transaction(TransactionID transaction_id, ReadView read_view)
 Transaction::~Transaction() {
 }
 
-void Transaction::push_version(const std::string& key, DataItem* item) {
+void Transaction::push_version(const SharedKey& key, DataItem* item) {
     versions_.push_back({key, item});
 }
 
@@ -32,5 +32,17 @@ const ReadView& Transaction::get_read_view() const {
     return read_view_;
 }
 
+void Transaction::record_read(const Key& key) {
+    read_keys_.insert(key);
+}
+
+void Transaction::record_write(const Key& key) {
+    write_keys_.insert(key);
+}
+
+void Transaction::record_keyspace_read() {
+    reads_keyspace_ = true;
+}
+
 
 } // namespace dkv
\ No newline at end of file
@@ -8,18 +8,24 @@ using namespace std;
 namespace dkv {
 
 TransactionManager::TransactionManager(StorageEngine* storage_engine, TransactionIsolationLevel isolation_level)
-    : storage_engine_(storage_engine), isolation_level_(isolation_level) {
+    : storage_engine_(storage_engine), isolation_level_(isolation_level),
+      snapshot_(make_shared<const ActiveSnapshot>(ActiveSnapshot{{}, transaction_id_generator_.load()})) {
 }
 
 TransactionManager::~TransactionManager() {
 }
 
 TransactionID TransactionManager::begin() {
+    // 分配事务ID、登记为活跃事务与发布快照在同一临界区内完成，
+    // 保证快照和getPurgeHorizon看到的下一个事务ID之前的事务要么已登记，要么已结束
+    lock_guard<mutex> lock(active_transactions_mutex_);
     // generate a new transaction id
     TransactionID txid = nextTransactionId();
+    publishSnapshotLocked(txid, {});
     // activate the transaction
-    Transaction new_tx(txid, createReadView(txid));
-    lock_guard<mutex> lock(active_transactions_mutex_);
+    Transaction new_tx(txid, makeReadView(atomic_load(&snapshot_), txid));
+    // 提交序号与快照在同一临界区内读取，序号不大于它的提交都对读取视图可见
+    new_tx.set_start_seq(commit_seq_);
     active_transactions_.insert({txid, new_tx});
     return txid;
 }
@@ -27,31 +33,218 @@ TransactionID TransactionManager::begin() {
 bool TransactionManager::commit(TransactionID txid) {
     lock_guard<mutex> lock(active_transactions_mutex_);
     // deactivate the transaction
-    if (active_transactions_.find(txid) == active_transactions_.end()) {
+    auto it = active_transactions_.find(txid);
+    if (it == active_transactions_.end()) {
         DKV_LOG_ERROR("Transaction {} not found", txid);
         return false;
     }
-    active_transactions_.erase(txid);
+    if (isolation_level_ == TransactionIsolationLevel::SERIALIZABLE && !validateLocked(it->second)) {
+        DKV_LOG_WARNING("Transaction aborted due to serialization conflict: ", txid);
+        rollbackLocked(txid);
+        return false;
+    }
+    if (isWatchedKeysModifiedLocked(it->second.get_watched_keys())) {
+        DKV_LOG_INFO("Transaction aborted because watched keys were modified: ", txid);
+        rollbackLocked(txid);
+        return false;
+    }
+    const bool tracks_commit_seqs = tracksCommitSeqsLocked();
+    if (tracks_commit_seqs && !it->second.get_write_keys().empty()) {
+        recordCommitLocked(it->second.get_write_keys(), false);
+    }
+    active_transactions_.erase(it);
+    publishSnapshotLocked(NO_TX, {txid});
+    if (tracks_commit_seqs) {
+        pruneCommitSeqsLocked();
+    }
     return true;
 }
 
 bool TransactionManager::rollback(TransactionID txid) {
     lock_guard<mutex> lock(active_transactions_mutex_);
-    if (active_transactions_.find(txid) == active_transactions_.end()) {
+    return rollbackLocked(txid);
+}
+
+bool TransactionManager::rollbackLocked(TransactionID txid) {
+    auto it = active_transactions_.find(txid);
+    if (it == active_transactions_.end()) {
         DKV_LOG_ERROR("Transaction {} not found", txid);
         return false;
     }
     // do rollback operations
-    Transaction& tx = active_transactions_.at(txid);
+    Transaction& tx = it->second;
     for (const auto& version : tx.get_versions()) {
         version.item->setDiscard(); // will be purged later
     }
     // deactivate the transaction and push to rollback transactions
-    rollback_transactions_.insert({txid, move(tx)});
-    active_transactions_.erase(txid);
+    {
+        lock_guard<mutex> rollback_lock(rollback_transactions_mutex_);
+        rollback_transactions_.insert({txid, move(tx)});
+    }
+    active_transactions_.erase(it);
     return true;
 }
 
+void TransactionManager::trackCommand(TransactionID txid, const Command& command) {
+    const bool serializable = isolation_level_ == TransactionIsolationLevel::SERIALIZABLE;
+    const bool read_only = isReadOnlyCommand(command.type);
+    if (!serializable && (read_only || (txid == NO_TX && watch_count_.load() == 0))) {
+        // 只有可串行化隔离需要读集合；没有WATCH时非事务写入无需登记
+        return;
+    }
+    const bool whole_keyspace = command.type == CommandType::FLUSHDB || command.type == CommandType::EVALX ||
+                                command.type == CommandType::EVALSHA;
+    const bool reads_keyspace = command.type == CommandType::SCAN || command.type == CommandType::DBSIZE;
+    vector<Key> keys = command.keys();
+    // BITOP、PFMERGE和集合、有序集合运算的*STORE只写入目标键，其余为源键
+    size_t write_count = read_only ? 0 : keys.size();
+    if (command.type == CommandType::BITOP || command.type == CommandType::PFMERGE ||
+        command.type == CommandType::SINTERSTORE || command.type == CommandType::SUNIONSTORE ||
+        command.type == CommandType::SDIFFSTORE || command.type == CommandType::ZUNIONSTORE ||
+        command.type == CommandType::ZINTERSTORE || command.type == CommandType::ZRANGESTORE) {
+        write_count = min<size_t>(write_count, 1);
+    }
+
+    lock_guard<mutex> lock(active_transactions_mutex_);
+    if (txid == NO_TX) {
+        // 非事务命令没有读取视图，读取无需校验；写入已经生效，作为一次提交登记
+        if (!tracksCommitSeqsLocked()) {
+            return;
+        }
+        if (whole_keyspace) {
+            recordCommitLocked({}, true);
+        } else if (write_count > 0) {
+            recordCommitLocked(unordered_set<Key>(keys.begin(), keys.begin() + write_count), false);
+        } else {
+            return;
+        }
+        pruneCommitSeqsLocked();
+        return;
+    }
+    auto it = active_transactions_.find(txid);
+    if (it == active_transactions_.end()) {
+        return;
+    }
+    Transaction& tx = it->second;
+    for (size_t i = 0; i < write_count; ++i) {
+        tx.record_write(keys[i]);
+    }
+    if (!serializable) {
+        return;
+    }
+    if (reads_keyspace) {
+        tx.record_keyspace_read();
+    }
+    for (size_t i = write_count; i < keys.size(); ++i) {
+        tx.record_read(keys[i]);
+    }
+}
+
+uint64_t TransactionManager::watch() {
+    lock_guard<mutex> lock(active_transactions_mutex_);
+    watch_seqs_.insert(commit_seq_);
+    watch_count_.fetch_add(1);
+    return commit_seq_;
+}
+
+void TransactionManager::unwatch(uint64_t since) {
+    lock_guard<mutex> lock(active_transactions_mutex_);
+    auto it = watch_seqs_.find(since);
+    if (it == watch_seqs_.end()) {
+        return;
+    }
+    watch_seqs_.erase(it);
+    watch_count_.fetch_sub(1);
+    if (watch_seqs_.empty() && isolation_level_ != TransactionIsolationLevel::SERIALIZABLE) {
+        // 不再有监视者，停止记录后已有记录也不再需要
+        key_commit_seqs_.clear();
+    }
+}
+
+bool TransactionManager::isWatchedKeysModified(const WatchedKeys& watched_keys) const {
+    lock_guard<mutex> lock(active_transactions_mutex_);
+    return isWatchedKeysModifiedLocked(watched_keys);
+}
+
+bool TransactionManager::isWatchedKeysModifiedLocked(const WatchedKeys& watched_keys) const {
+    if (watched_keys.keys.empty() || commit_seq_ == watched_keys.since) {
+        return false;
+    }
+    for (const auto& key : watched_keys.keys) {
+        if (isModifiedSinceLocked(key, watched_keys.since)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TransactionManager::isModifiedSinceLocked(const Key& key, uint64_t since) const {
+    if (flush_seq_ > since) {
+        return true;
+    }
+    auto it = key_commit_seqs_.find(key);
+    return it != key_commit_seqs_.end() && it->second > since;
+}
+
+bool TransactionManager::validateLocked(const Transaction& tx) const {
+    const uint64_t start_seq = tx.get_start_seq();
+    if (commit_seq_ == start_seq) {
+        // 事务开始后没有任何写入提交
+        return true;
+    }
+    const auto& read_keys = tx.get_read_keys();
+    const auto& write_keys = tx.get_write_keys();
+    if (tx.reads_keyspace()) {
+        return false;
+    }
+    for (const auto& key : read_keys) {
+        if (isModifiedSinceLocked(key, start_seq)) {
+            return false;
+        }
+    }
+    for (const auto& key : write_keys) {
+        if (isModifiedSinceLocked(key, start_seq)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TransactionManager::recordCommitLocked(const unordered_set<Key>& keys, bool whole_keyspace) {
+    ++commit_seq_;
+    if (whole_keyspace) {
+        flush_seq_ = commit_seq_;
+        // 整个键空间都已修改，逐键记录不再需要
+        key_commit_seqs_.clear();
+        return;
+    }
+    for (const auto& key : keys) {
+        key_commit_seqs_[key] = commit_seq_;
+    }
+}
+
+void TransactionManager::pruneCommitSeqsLocked() {
+    if (key_commit_seqs_.size() < key_commit_seqs_prune_threshold_) {
+        return;
+    }
+    uint64_t min_start_seq = commit_seq_;
+    for (const auto& pair : active_transactions_) {
+        min_start_seq = min(min_start_seq, pair.second.get_start_seq());
+    }
+    if (!watch_seqs_.empty()) {
+        min_start_seq = min(min_start_seq, *watch_seqs_.begin());
+    }
+    for (auto it = key_commit_seqs_.begin(); it != key_commit_seqs_.end();) {
+        if (it->second <= min_start_seq) {
+            it = key_commit_seqs_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // 剩余记录仍被长事务需要时放宽阈值，避免每次提交都全量扫描
+    key_commit_seqs_prune_threshold_ = max(KEY_COMMIT_SEQS_PRUNE_THRESHOLD, key_commit_seqs_.size() * 2);
+}
+
 bool TransactionManager::isActive(TransactionID txid) const {
     lock_guard<mutex> lock(active_transactions_mutex_);
     return active_transactions_.find(txid) != active_transactions_.end();
@@ -82,6 +275,31 @@ vector<TransactionID> TransactionManager::getRolledbackTransactions() const {
     return rollback_txids;
 }
 
+void TransactionManager::forgetRolledbackTransactions(const vector<TransactionID>& txids) {
+    if (txids.empty()) {
+        return;
+    }
+    lock_guard<mutex> lock(active_transactions_mutex_);
+    {
+        lock_guard<mutex> rollback_lock(rollback_transactions_mutex_);
+        for (TransactionID txid : txids) {
+            rollback_transactions_.erase(txid);
+        }
+    }
+    publishSnapshotLocked(NO_TX, txids);
+}
+
+TransactionID TransactionManager::getPurgeHorizon() const {
+    lock_guard<mutex> lock(active_transactions_mutex_);
+    // 持锁读取，此前分配的事务ID都已登记为活跃或已结束
+    TransactionID horizon = peekNextTransactionID();
+    for (const auto& pair : active_transactions_) {
+        horizon = min(horizon, pair.first);
+        horizon = min(horizon, pair.second.get_read_view().low);
+    }
+    return horizon;
+}
+
 const Transaction& TransactionManager::getTransaction(TransactionID transaction_id) const {
     return getTransactionImpl(*this, transaction_id);
 }
@@ -91,27 +309,45 @@ Transaction& TransactionManager::getTransactionMut(TransactionID transaction_id)
 }
 
 ReadView TransactionManager::getReadView(TransactionID transaction_id) const {
-    if (isolation_level_ == TransactionIsolationLevel::READ_COMMITTED) {
+    // 非事务读取和读已提交每次读取都创建新的读取视图，其余隔离级别使用事务开始时的读取视图
+    if (transaction_id == NO_TX || isolation_level_ == TransactionIsolationLevel::READ_COMMITTED) {
         return createReadView(transaction_id);
-    } else if (isolation_level_ == TransactionIsolationLevel::READ_UNCOMMITTED) {
-        return getTransaction(transaction_id).get_read_view();
     }
-    exit(1);
+    return getTransaction(transaction_id).get_read_view();
 }
 
 ReadView TransactionManager::createReadView(TransactionID transaction_id) const {
+    return makeReadView(atomic_load(&snapshot_), transaction_id);
+}
+
+ReadView TransactionManager::makeReadView(const shared_ptr<const ActiveSnapshot>& snapshot, TransactionID transaction_id) {
     ReadView read_view;
     read_view.creator = transaction_id;
-    const auto& actives = getActiveTransactions();
-    const auto& rolledback = getRolledbackTransactions();
-    read_view.actives.reserve(actives.size() + rolledback.size());
-    read_view.actives.insert(read_view.actives.end(), actives.begin(), actives.end());
-    read_view.actives.insert(read_view.actives.end(), rolledback.begin(), rolledback.end());
-    auto pmin = min_element(read_view.actives.begin(), read_view.actives.end());
-    read_view.low = (pmin != read_view.actives.end() ? *pmin : 0);
-    read_view.high = peekNextTransactionID();
+    read_view.high = snapshot->high;
+    read_view.low = snapshot->ids.empty() ? snapshot->high : snapshot->ids.front();
+    // 与快照共享所有权，指向其中的事务ID数组
+    read_view.actives = shared_ptr<const vector<TransactionID>>(snapshot, &snapshot->ids);
     return read_view;
 }
 
+void TransactionManager::publishSnapshotLocked(TransactionID added, const vector<TransactionID>& removed) {
+    shared_ptr<const ActiveSnapshot> current = atomic_load(&snapshot_);
+    vector<TransactionID> sorted_removed(removed);
+    sort(sorted_removed.begin(), sorted_removed.end());
+    auto next = make_shared<ActiveSnapshot>();
+    next->ids.reserve(current->ids.size() + 1);
+    for (TransactionID txid : current->ids) {
+        if (!binary_search(sorted_removed.begin(), sorted_removed.end(), txid)) {
+            next->ids.push_back(txid);
+        }
+    }
+    // 新事务ID大于已分配的所有ID，追加后仍然有序
+    if (added != NO_TX) {
+        next->ids.push_back(added);
+    }
+    next->high = peekNextTransactionID();
+    atomic_store(&snapshot_, shared_ptr<const ActiveSnapshot>(move(next)));
+}
+
 
 } // namespace dkv
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+#include "dkv_memory_allocator.hpp"
+#include "dkv_slab_allocator.hpp"
+#include "datatypes/dkv_datatype_string.hpp"
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// 每轮分配后批量释放，模拟数据项的创建与淘汰
+constexpr size_t BATCH = 1024;
+
+void BM_Malloc(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    std::vector<void*> ptrs(BATCH);
+    for (auto _ : state) {
+        for (size_t i = 0; i < BATCH; ++i) {
+            ptrs[i] = std::malloc(size);
+            benchmark::DoNotOptimize(ptrs[i]);
+        }
+        for (size_t i = 0; i < BATCH; ++i) {
+            std::free(ptrs[i]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH);
+}
+
+void BM_MemoryAllocator(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    dkv::MemoryAllocator& allocator = dkv::MemoryAllocator::getInstance();
+    std::vector<void*> ptrs(BATCH);
+    for (auto _ : state) {
+        for (size_t i = 0; i < BATCH; ++i) {
+            ptrs[i] = allocator.allocate(size, "benchmark");
+            benchmark::DoNotOptimize(ptrs[i]);
+        }
+        for (size_t i = 0; i < BATCH; ++i) {
+            allocator.deallocate(ptrs[i]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH);
+}
+
+void BM_SlabAllocator(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    dkv::SlabAllocator& allocator = dkv::SlabAllocator::getInstance();
+    std::vector<void*> ptrs(BATCH);
+    for (auto _ : state) {
+        for (size_t i = 0; i < BATCH; ++i) {
+            ptrs[i] = allocator.allocate(size);
+            benchmark::DoNotOptimize(ptrs[i]);
+        }
+        for (size_t i = 0; i < BATCH; ++i) {
+            allocator.deallocate(ptrs[i], size);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH);
+}
+
+// 数据项对象经DataItem::operator new走slab
+void BM_StringItemCreate(benchmark::State& state) {
+    std::vector<std::unique_ptr<dkv::DataItem>> items(BATCH);
+    for (auto _ : state) {
+        for (size_t i = 0; i < BATCH; ++i) {
+            items[i] = std::make_unique<dkv::StringItem>("value");
+        }
+        for (size_t i = 0; i < BATCH; ++i) {
+            items[i].reset();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH);
+}
+
+} // namespace
+
+BENCHMARK(BM_Malloc)->Arg(16)->Arg(64)->Arg(256)->Arg(512);
+BENCHMARK(BM_MemoryAllocator)->Arg(16)->Arg(64)->Arg(256)->Arg(512);
+BENCHMARK(BM_SlabAllocator)->Arg(16)->Arg(64)->Arg(256)->Arg(512);
+BENCHMARK(BM_StringItemCreate);
+
+BENCHMARK_MAIN();
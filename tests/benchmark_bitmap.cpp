@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+#include "datatypes/dkv_bitmap_kernels.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> makeBitmap(size_t len, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<uint8_t> bitmap(len);
+    for (auto& byte : bitmap) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    return bitmap;
+}
+
+// 参数为位图字节数
+void BM_Popcount(benchmark::State& state, const dkv::BitmapKernels& kernels) {
+    const std::vector<uint8_t> bitmap = makeBitmap(state.range(0), 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernels.popcount(bitmap.data(), bitmap.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * bitmap.size());
+}
+
+// 参数为位图字节数和输入个数，一次遍历合并所有输入
+void BM_CombineAnd(benchmark::State& state, const dkv::BitmapKernels& kernels) {
+    std::vector<std::vector<uint8_t>> inputs;
+    std::vector<const uint8_t*> srcs;
+    for (int64_t i = 0; i < state.range(1); ++i) {
+        inputs.push_back(makeBitmap(state.range(0), i + 1));
+    }
+    for (const auto& input : inputs) {
+        srcs.push_back(input.data());
+    }
+    std::vector<uint8_t> dst(state.range(0));
+    for (auto _ : state) {
+        kernels.combine(dkv::BitmapOp::AND, dst.data(), srcs.data(), srcs.size(), dst.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * dst.size() * srcs.size());
+}
+
+void BM_Invert(benchmark::State& state, const dkv::BitmapKernels& kernels) {
+    const std::vector<uint8_t> src = makeBitmap(state.range(0), 1);
+    std::vector<uint8_t> dst(src.size());
+    for (auto _ : state) {
+        kernels.invert(dst.data(), src.data(), src.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * src.size());
+}
+
+// BITPOS找置位的最坏情况：只有最后一个字节非0
+void BM_Find(benchmark::State& state, const dkv::BitmapKernels& kernels) {
+    std::vector<uint8_t> bitmap(state.range(0), 0);
+    bitmap.back() = 1;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernels.find(bitmap.data(), bitmap.size(), 0x00));
+    }
+    state.SetBytesProcessed(state.iterations() * bitmap.size());
+}
+
+} // namespace
+
+// 为当前CPU支持的每一种实现注册一组基准
+int main(int argc, char** argv) {
+    for (const dkv::BitmapKernels& kernels : dkv::supportedBitmapKernels()) {
+        const std::string name = kernels.name;
+        benchmark::RegisterBenchmark(("BM_Popcount/" + name).c_str(), BM_Popcount, kernels)
+            ->Arg(64 << 10)->Arg(16 << 20);
+        benchmark::RegisterBenchmark(("BM_CombineAnd/" + name).c_str(), BM_CombineAnd, kernels)
+            ->Args({64 << 10, 2})->Args({16 << 20, 4});
+        benchmark::RegisterBenchmark(("BM_Invert/" + name).c_str(), BM_Invert, kernels)->Arg(16 << 20);
+        benchmark::RegisterBenchmark(("BM_Find/" + name).c_str(), BM_Find, kernels)->Arg(16 << 20);
+    }
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
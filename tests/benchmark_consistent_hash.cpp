@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+#include "multinode/shard/dkv_consistent_hash.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+
+// 预先生成的键，循环查询
+constexpr size_t KEY_COUNT = 4096;
+
+std::vector<std::string> makeKeys() {
+    std::vector<std::string> keys;
+    keys.reserve(KEY_COUNT);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        keys.push_back("user:" + std::to_string(i * 7919));
+    }
+    return keys;
+}
+
+void BM_Hash(benchmark::State& state, uint64_t (*hash)(std::string_view)) {
+    const std::vector<std::string> keys = makeKeys();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hash(keys[i++ % KEY_COUNT]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 参数为分片数，每个分片100个虚拟节点；多线程时各线程共享同一个哈希环
+void BM_GetNode(benchmark::State& state, dkv::HashFunctionType hash_type) {
+    static dkv::ConsistentHash<int>* ring = nullptr;
+    if (state.thread_index() == 0) {
+        ring = new dkv::ConsistentHash<int>(100, hash_type);
+        for (int node = 0; node < state.range(0); ++node) {
+            ring->AddNode(node);
+        }
+    }
+    const std::vector<std::string> keys = makeKeys();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ring->GetNode(keys[i++ % KEY_COUNT]));
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        delete ring;
+        ring = nullptr;
+    }
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_Hash, crc32, dkv::CRC32Hash);
+BENCHMARK_CAPTURE(BM_Hash, murmur3, dkv::Murmur3Hash);
+BENCHMARK_CAPTURE(BM_GetNode, crc32, dkv::HashFunctionType::CRC32)->Arg(16)->Arg(64);
+BENCHMARK_CAPTURE(BM_GetNode, murmur3, dkv::HashFunctionType::MURMUR3)->Arg(16)->Arg(64)->Threads(1)->Threads(4);
+
+BENCHMARK_MAIN();
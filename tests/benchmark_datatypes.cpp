@@ -0,0 +1,128 @@
+#include <benchmark/benchmark.h>
+#include "storage/dkv_storage.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+// 经StorageEngine执行的各数据类型常用命令，包括查找键、加锁和类型检查的开销。
+// 位图和HyperLogLog的计算内核另见benchmark_bitmap和benchmark_hyperloglog
+namespace {
+
+std::vector<std::string> makeMembers(size_t count) {
+    std::vector<std::string> members;
+    members.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        members.push_back("member:" + std::to_string(i * 2654435761ULL));
+    }
+    return members;
+}
+
+// 参数为有序集合的成员数，每次更新一个已有成员的分数，成员的排名随之改变
+void BM_ZAdd(benchmark::State& state) {
+    dkv::StorageEngine engine;
+    const auto members = makeMembers(state.range(0));
+    for (size_t i = 0; i < members.size(); ++i) {
+        engine.zadd(dkv::NO_TX, "zset", {{members[i], static_cast<double>(i)}});
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        const double score = static_cast<double>((i * 7919) % members.size());
+        benchmark::DoNotOptimize(engine.zadd(dkv::NO_TX, "zset", {{members[i % members.size()], score}}));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ZAdd)->Arg(128)->Arg(10000)->Arg(100000);
+
+void BM_ZRank(benchmark::State& state) {
+    dkv::StorageEngine engine;
+    const auto members = makeMembers(state.range(0));
+    std::vector<std::pair<dkv::Value, double>> batch;
+    for (size_t i = 0; i < members.size(); ++i) {
+        batch.emplace_back(members[i], static_cast<double>(i));
+    }
+    engine.zadd(dkv::NO_TX, "zset", batch);
+    size_t i = 0;
+    size_t rank = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine.zrank(dkv::NO_TX, "zset", members[i++ % members.size()], rank));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ZRank)->Arg(128)->Arg(10000)->Arg(100000);
+
+// 参数为哈希的字段数，每次覆盖一个已有字段
+void BM_HSet(benchmark::State& state) {
+    dkv::StorageEngine engine;
+    const auto fields = makeMembers(state.range(0));
+    for (const auto& field : fields) {
+        engine.hset(dkv::NO_TX, "hash", field, "value");
+    }
+    const std::string value(32, 'v');
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine.hset(dkv::NO_TX, "hash", fields[i++ % fields.size()], value));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HSet)->Arg(16)->Arg(10000);
+
+// 参数为列表的初始长度，每次LPUSH后RPOP一个元素，列表长度保持不变
+void BM_LPushRPop(benchmark::State& state) {
+    dkv::StorageEngine engine;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        engine.rpush(dkv::NO_TX, "list", "element");
+    }
+    const std::string value(32, 'v');
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine.lpush(dkv::NO_TX, "list", value));
+        benchmark::DoNotOptimize(engine.rpop(dkv::NO_TX, "list"));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_LPushRPop)->Arg(1)->Arg(10000);
+
+// 参数为位图的字节数
+void BM_BitCount(benchmark::State& state) {
+    dkv::StorageEngine engine;
+    const size_t bits = state.range(0) * 8;
+    for (size_t offset = 0; offset < bits; offset += 3) {
+        engine.setBit(dkv::NO_TX, "bitmap", offset, true);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine.bitCount(dkv::NO_TX, "bitmap"));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BitCount)->Arg(1024)->Arg(1024 * 1024);
+
+void BM_SetBit(benchmark::State& state) {
+    dkv::StorageEngine engine;
+    const size_t bits = state.range(0) * 8;
+    engine.setBit(dkv::NO_TX, "bitmap", bits - 1, true);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine.setBit(dkv::NO_TX, "bitmap", (i * 7919) % bits, i & 1));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SetBit)->Arg(1024 * 1024);
+
+// 参数为每次PFADD的元素数
+void BM_PFAdd(benchmark::State& state) {
+    dkv::StorageEngine engine;
+    const auto elements = makeMembers(1 << 16);
+    const size_t batch = state.range(0);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine.pfadd(dkv::NO_TX, "hll", &elements[i], batch));
+        i = (i + batch) % (elements.size() - batch);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_PFAdd)->Arg(1)->Arg(100);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+#include "datatypes/dkv_datatype_hyperloglog.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<dkv::Value> makeElements(size_t count) {
+    std::vector<dkv::Value> elements;
+    elements.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        elements.push_back("user:" + std::to_string(i * 2654435761ULL));
+    }
+    return elements;
+}
+
+// 参数为每次PFADD的元素数，逐个添加
+void BM_PFAddSingle(benchmark::State& state) {
+    const auto elements = makeElements(state.range(0));
+    for (auto _ : state) {
+        dkv::HyperLogLogItem hll;
+        for (const auto& element : elements) {
+            hll.add(element);
+        }
+        benchmark::DoNotOptimize(hll.count());
+    }
+    state.SetItemsProcessed(state.iterations() * elements.size());
+}
+BENCHMARK(BM_PFAddSingle)->Arg(100)->Arg(1000)->Arg(100000);
+
+// 批量添加
+void BM_PFAddBatch(benchmark::State& state) {
+    const auto elements = makeElements(state.range(0));
+    for (auto _ : state) {
+        dkv::HyperLogLogItem hll;
+        hll.add(elements.data(), elements.size());
+        benchmark::DoNotOptimize(hll.count());
+    }
+    state.SetItemsProcessed(state.iterations() * elements.size());
+}
+BENCHMARK(BM_PFAddBatch)->Arg(100)->Arg(1000)->Arg(100000);
+
+// 多个稠密HyperLogLog的并集计数
+void BM_PFCountUnion(benchmark::State& state) {
+    std::vector<dkv::HyperLogLogItem> items(state.range(0));
+    const auto elements = makeElements(20000);
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i].add(elements.data() + i * 1000, 10000);
+    }
+    std::vector<const dkv::HyperLogLogItem*> ptrs;
+    for (const auto& item : items) {
+        ptrs.push_back(&item);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dkv::HyperLogLogItem::countUnion(ptrs));
+    }
+}
+BENCHMARK(BM_PFCountUnion)->Arg(1)->Arg(8);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -1,263 +1,95 @@
+#include <benchmark/benchmark.h>
+#include "transaction/dkv_mvcc.hpp"
 #include "storage/dkv_storage.hpp"
 #include "datatypes/dkv_datatype_string.hpp"
-#include "transaction/dkv_transaction_manager.hpp"
-#include "storage/dkv_simple_storage.h"
 #include <memory>
-#include <vector>
-#include <thread>
-#include <atomic>
-#include <iostream>
 #include <string>
-#include <benchmark/benchmark.h>
-#include <iostream>
-using namespace std;
+#include <vector>
 
-namespace dkv {
+namespace {
 
-// Google Benchmark的通用设置类
-class MVCCBenchmark : public ::benchmark::Fixture {
-public:
-    void SetUp(const ::benchmark::State& state) {
-        inner_storage_ = new SimpleInnerStorage();
-        mvcc_ = new MVCC(*inner_storage_);
-        engine_ = new StorageEngine<SimpleInnerStorage>();
-        tx_manager_ = new TransactionManager(engine_, TransactionIsolationLevel::REPEATABLE_READ);
-        
-        // 初始化一些数据用于GET测试
-        for (int i = 0; i < 1000; ++i) {
-            TransactionID tx_id = tx_manager_->begin();
-            string key = "bench_key_" + to_string(i);
-            auto item = make_unique<StringItem>("value_" + to_string(i));
-            mvcc_->set(tx_id, key, move(item));
-            tx_manager_->commit(tx_id);
+constexpr size_t KEY_COUNT = 64;
+
+// 读取事务开始后每个键又被depth个事务各修改一次，旧读取视图需要沿版本链回溯depth个版本
+struct VersionChains {
+    explicit VersionChains(size_t depth)
+        : mvcc(inner_storage), tx_manager(&engine, dkv::TransactionIsolationLevel::REPEATABLE_READ) {
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            keys.push_back("key:" + std::to_string(i));
+        }
+        write();
+        reader = tx_manager.begin();
+        old_view = tx_manager.createReadView(reader);
+        for (size_t d = 0; d < depth; ++d) {
+            write();
         }
-        clog << "SetUp!" << endl;
-    }
-    
-    void TearDown(const ::benchmark::State& state) {
-        delete tx_manager_;
-        delete engine_;
-        delete mvcc_;
-        delete inner_storage_;
-        clog << "TearDown!" << endl;
     }
-    
-protected:
-    SimpleInnerStorage* inner_storage_;
-    MVCC* mvcc_;
-    StorageEngine* engine_;
-    TransactionManager* tx_manager_;
-};
 
-// 单线程SET操作基准测试
-BENCHMARK_F(MVCCBenchmark, BM_MVCCSet)(benchmark::State& state) {
-    int thread_idx = state.thread_index();
-    
-    for (auto _ : state) {
-        // 每个迭代执行一次SET操作
-        TransactionID tx_id = tx_manager_->begin();
-        string key = "bench_key_" + to_string((thread_idx * 100000 + state.iterations()) % 1000);
-        auto item = make_unique<StringItem>("value_" + to_string(state.iterations()));
-        mvcc_->set(tx_id, key, move(item));
-        tx_manager_->commit(tx_id);
+    ~VersionChains() {
+        tx_manager.commit(reader);
     }
-    
-    // 设置计数器，记录每个线程执行的操作数
-    state.SetItemsProcessed(state.iterations());
-}
 
-// 单线程GET操作基准测试
-BENCHMARK_F(MVCCBenchmark, BM_MVCCGet)(benchmark::State& state) {
-    int thread_idx = state.thread_index();
-    
-    for (auto _ : state) {
-        // 每个迭代执行一次GET操作
-        TransactionID tx_id = tx_manager_->begin();
-        ReadView read_view = mvcc_->createReadView(tx_id, *tx_manager_);
-        string key = "bench_key_" + to_string((thread_idx * 100000 + state.iterations()) % 1000);
-        benchmark::DoNotOptimize(mvcc_->get(read_view, key));
-        tx_manager_->commit(tx_id);
+    void write() {
+        dkv::TransactionID tx_id = tx_manager.begin();
+        for (const auto& key : keys) {
+            mvcc.set(tx_id, key, std::make_unique<dkv::StringItem>("value:" + std::to_string(tx_id)));
+        }
+        tx_manager.commit(tx_id);
     }
-    
-    // 设置计数器，记录每个线程执行的操作数
-    state.SetItemsProcessed(state.iterations());
-}
 
-// 单线程混合操作基准测试
-BENCHMARK_F(MVCCBenchmark, BM_MVCCHybrid)(benchmark::State& state) {
-    int thread_idx = state.thread_index();
-    int successful_ops = 0;
-    
+    dkv::InnerStorage inner_storage;
+    dkv::MVCC mvcc;
+    dkv::StorageEngine engine;
+    dkv::TransactionManager tx_manager;
+    std::vector<std::string> keys;
+    dkv::TransactionID reader = 0;
+    dkv::ReadView old_view;
+};
+
+// 参数为版本链深度，旧读取视图读取最早的版本
+void BM_GetOldVersion(benchmark::State& state) {
+    VersionChains chains(state.range(0));
+    size_t i = 0;
     for (auto _ : state) {
-        TransactionID tx_id = tx_manager_->begin();
-        string key = "bench_key_" + to_string((thread_idx * 100000 + state.iterations()) % 1000);
-        
-        // 随机选择操作类型
-        int op_type = state.iterations() % 3;
-        if (op_type == 0) {
-            // 读取操作
-            ReadView read_view = mvcc_->createReadView(tx_id, *tx_manager_);
-            if (mvcc_->get(read_view, key) != nullptr) {
-                successful_ops++;
-            }
-        } else if (op_type == 1) {
-            // 更新操作
-            auto item = make_unique<StringItem>("updated_value_" + to_string(state.iterations()));
-            if (mvcc_->set(tx_id, key, move(item))) {
-                successful_ops++;
-            }
-        } else {
-            // 删除操作
-            auto virtual_item = make_unique<StringItem>();
-            if (mvcc_->del(tx_id, key, move(virtual_item))) {
-                successful_ops++;
-            }
-        }
-        
-        tx_manager_->commit(tx_id);
+        benchmark::DoNotOptimize(chains.mvcc.get(chains.old_view, chains.keys[i++ % KEY_COUNT]));
     }
-    
-    // 设置计数器，记录成功的操作数
-    state.SetItemsProcessed(successful_ops);
+    state.SetItemsProcessed(state.iterations());
 }
+BENCHMARK(BM_GetOldVersion)->Arg(0)->Arg(16)->Arg(256)->Arg(4096);
 
-// 多线程并发操作基准测试
-BENCHMARK_F(MVCCBenchmark, BM_MVCCConcurrent)(benchmark::State& state) {
-    int thread_idx = state.thread_index();
-    atomic<int> local_successful_ops(0);
-    
+// 同样的版本链，新的读取视图直接读到最新版本，不受链长影响
+void BM_GetLatestVersion(benchmark::State& state) {
+    VersionChains chains(state.range(0));
+    dkv::TransactionID tx_id = chains.tx_manager.begin();
+    dkv::ReadView view = chains.tx_manager.createReadView(tx_id);
+    size_t i = 0;
     for (auto _ : state) {
-        TransactionID tx_id = tx_manager_->begin();
-        string key = "concurrent_key_" + to_string((thread_idx * 10 + state.iterations()) % 1000);
-        
-        // 交替执行不同操作
-        int op_type = state.iterations() % 4;
-        if (op_type == 0) {
-            // 读取操作
-            ReadView read_view = mvcc_->createReadView(tx_id, *tx_manager_);
-            benchmark::DoNotOptimize(mvcc_->get(read_view, key));
-            local_successful_ops++;
-        } else if (op_type == 1 || op_type == 2) {
-            // 更新操作
-            auto item = make_unique<StringItem>("thread_" + to_string(thread_idx) + "_value_" + to_string(state.iterations()));
-            if (mvcc_->set(tx_id, key, move(item))) {
-                local_successful_ops++;
-            }
-        } else {
-            // 删除后立即添加回来
-            auto virtual_item = make_unique<StringItem>();
-            if (mvcc_->del(tx_id, key, move(virtual_item))) {
-                local_successful_ops++;
-                // 立即添加回来
-                auto new_item = make_unique<StringItem>("re_added_value_" + to_string(state.iterations()));
-                if (mvcc_->set(tx_id, key, move(new_item))) {
-                    local_successful_ops++;
-                }
-            }
-        }
-        
-        tx_manager_->commit(tx_id);
+        benchmark::DoNotOptimize(chains.mvcc.get(view, chains.keys[i++ % KEY_COUNT]));
     }
-    
-    // 设置计数器，记录成功的操作数
-    state.SetItemsProcessed(local_successful_ops);
+    state.SetItemsProcessed(state.iterations());
+    chains.tx_manager.commit(tx_id);
 }
+BENCHMARK(BM_GetLatestVersion)->Arg(0)->Arg(4096);
 
-// 设置并发线程数量
-BENCHMARK_REGISTER_F(MVCCBenchmark, BM_MVCCConcurrent)
-    ->ThreadRange(1, 8)
-    ->UseRealTime();
-
-// 不同事务隔离级别性能测试 - 专用的Fixture类
-class MVCCIsolationBenchmark : public ::benchmark::Fixture {
-public:
-    void SetUp(const ::benchmark::State& state) {
-        // 根据参数设置隔离级别
-        TransactionIsolationLevel level = state.range(0) == 0 ? 
-                                          TransactionIsolationLevel::READ_COMMITTED : 
-                                          TransactionIsolationLevel::REPEATABLE_READ;
-        
-        inner_storage_ = new InnerStorage();
-        mvcc_ = new MVCC(*inner_storage_);
-        engine_ = new StorageEngine<SimpleInnerStorage>();
-        tx_manager_ = new TransactionManager(engine_, level);
-        isolation_level_ = level;
-        
-        // 初始化一些数据
-        for (int i = 0; i < 1000; ++i) {
-            TransactionID tx_id = tx_manager_->begin();
-            string key = "iso_key_" + to_string(i);
-            auto item = make_unique<StringItem>("initial_value_" + to_string(i));
-            mvcc_->set(tx_id, key, move(item));
-            tx_manager_->commit(tx_id);
-        }
+// 每次读取都创建读取视图，参数为同时活跃的事务数
+void BM_CreateReadView(benchmark::State& state) {
+    VersionChains chains(0);
+    std::vector<dkv::TransactionID> actives;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        actives.push_back(chains.tx_manager.begin());
     }
-    
-    void TearDown(const ::benchmark::State& state) {
-        delete tx_manager_;
-        delete engine_;
-        delete mvcc_;
-        delete inner_storage_;
-    }
-    
-protected:
-    InnerStorage* inner_storage_;
-    MVCC* mvcc_;
-    StorageEngine* engine_;
-    TransactionManager* tx_manager_;
-    TransactionIsolationLevel isolation_level_;
-};
-
-// 隔离级别性能测试
-BENCHMARK_F(MVCCIsolationBenchmark, BM_MVCCIsolationLevel)(benchmark::State& state) {
+    dkv::TransactionID tx_id = chains.tx_manager.begin();
     for (auto _ : state) {
-        TransactionID tx_id = tx_manager_->begin();
-        string key = "iso_key_" + to_string(state.iterations() % 1000);
-        
-        if (isolation_level_ == TransactionIsolationLevel::READ_COMMITTED) {
-            // READ COMMITTED - 每次读取都创建新的ReadView
-            if (state.iterations() % 2 == 0) {
-                ReadView read_view = mvcc_->createReadView(tx_id, *tx_manager_);
-                benchmark::DoNotOptimize(mvcc_->get(read_view, key));
-            } else {
-                auto item = make_unique<StringItem>("rc_value_" + to_string(state.iterations()));
-                mvcc_->set(tx_id, key, move(item));
-            }
-        } else {
-            // REPEATABLE READ - 在事务开始时创建一次ReadView
-            ReadView read_view = mvcc_->createReadView(tx_id, *tx_manager_);
-            if (state.iterations() % 2 == 0) {
-                benchmark::DoNotOptimize(mvcc_->get(read_view, key));
-            } else {
-                auto item = make_unique<StringItem>("rr_value_" + to_string(state.iterations()));
-                mvcc_->set(tx_id, key, move(item));
-            }
-        }
-        
-        tx_manager_->commit(tx_id);
+        benchmark::DoNotOptimize(chains.tx_manager.createReadView(tx_id));
     }
-    
     state.SetItemsProcessed(state.iterations());
+    chains.tx_manager.commit(tx_id);
+    for (auto active : actives) {
+        chains.tx_manager.commit(active);
+    }
 }
+BENCHMARK(BM_CreateReadView)->Arg(0)->Arg(64);
 
-// 注册不同隔离级别的测试
-BENCHMARK_REGISTER_F(MVCCIsolationBenchmark, BM_MVCCIsolationLevel)
-    ->Args({0}) // READ_COMMITTED
-    ->Args({1}); // REPEATABLE_READ
-
-} // namespace dkv
+} // namespace
 
-int main(int argc, char** argv) {
-    // 初始化Google Benchmark
-    ::benchmark::Initialize(&argc, argv);
-    
-    // 如果没有指定基准测试，显示帮助信息
-    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
-        return 1;
-    }
-    
-    // 运行所有注册的基准测试
-    ::benchmark::RunSpecifiedBenchmarks();
-    
-    return 0;
-}
\ No newline at end of file
+BENCHMARK_MAIN();
@@ -0,0 +1,113 @@
+#include <benchmark/benchmark.h>
+#include "persist/dkv_aof.hpp"
+#include "storage/dkv_storage.hpp"
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace {
+
+const std::string AOF_FILE = "benchmark_persist.aof";
+const std::string RDB_FILE = "benchmark_persist.rdb";
+
+// 删除AOF清单及其列出的基础文件、增量文件
+void removeFiles(const std::string& prefix) {
+    for (const auto& entry : std::filesystem::directory_iterator(".")) {
+        if (entry.path().filename().string().rfind(prefix, 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+// 各线程共享同一个AOF，由0号线程在计时开始前打开、结束后关闭；
+// ALWAYS策略下多个线程的追加共享一次fdatasync
+dkv::AOFPersistence* aof = nullptr;
+
+// 参数为值的字节数
+void BM_AOFAppend(benchmark::State& state, dkv::AOFPersistence::FsyncPolicy policy) {
+    if (state.thread_index() == 0) {
+        removeFiles(AOF_FILE);
+        aof = new dkv::AOFPersistence();
+        aof->initialize(AOF_FILE, policy);
+    }
+    const dkv::Command command(dkv::CommandType::SET,
+                               {"key:" + std::to_string(state.thread_index()), std::string(state.range(0), 'v')});
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(aof->appendCommand(command));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    if (state.thread_index() == 0) {
+        aof->close();
+        delete aof;
+        aof = nullptr;
+        removeFiles(AOF_FILE);
+    }
+}
+
+// 参数为键数，每个键一个64字节的字符串值
+void fill(dkv::StorageEngine& engine, int64_t keys) {
+    const std::string value(64, 'v');
+    for (int64_t i = 0; i < keys; ++i) {
+        engine.set(dkv::NO_TX, "key:" + std::to_string(i), value);
+    }
+}
+
+void BM_RDBSaveToMemory(benchmark::State& state) {
+    dkv::StorageEngine engine;
+    fill(engine, state.range(0));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::ostringstream out;
+        engine.saveRDBToStream(out);
+        bytes = out.tellp();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+void BM_RDBLoadFromMemory(benchmark::State& state) {
+    std::string data;
+    {
+        dkv::StorageEngine engine;
+        fill(engine, state.range(0));
+        std::ostringstream out;
+        engine.saveRDBToStream(out);
+        data = out.str();
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto engine = std::make_unique<dkv::StorageEngine>();
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(engine->loadRDBFromMemory(data));
+        state.PauseTiming();
+        engine.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+// 包含写文件和fsync
+void BM_RDBSaveToFile(benchmark::State& state) {
+    dkv::StorageEngine engine;
+    fill(engine, state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine.saveRDB(RDB_FILE));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(RDB_FILE));
+    std::filesystem::remove(RDB_FILE);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_AOFAppend, never, dkv::AOFPersistence::FsyncPolicy::NEVER)->Arg(64)->Arg(4096);
+BENCHMARK_CAPTURE(BM_AOFAppend, everysec, dkv::AOFPersistence::FsyncPolicy::EVERYSEC)->Arg(64)->Threads(1)->Threads(4);
+BENCHMARK_CAPTURE(BM_AOFAppend, always, dkv::AOFPersistence::FsyncPolicy::ALWAYS)->Arg(64)->Threads(1)->Threads(4)->UseRealTime();
+BENCHMARK(BM_RDBSaveToMemory)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_RDBLoadFromMemory)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_RDBSaveToFile)->Arg(100000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+#include "net/dkv_resp.hpp"
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// 参数为值的字节数，编码一条SET命令
+std::string makeSetCommand(size_t value_size) {
+    const std::string value(value_size, 'v');
+    return "*3\r\n$3\r\nSET\r\n$8\r\nuser:123\r\n$" + std::to_string(value_size) + "\r\n" + value + "\r\n";
+}
+
+// 流水线中的多条命令，每条命令解析后丢弃已消费的字节
+void BM_ParsePipeline(benchmark::State& state) {
+    const size_t commands = 64;
+    std::string input;
+    for (size_t i = 0; i < commands; ++i) {
+        input += makeSetCommand(state.range(0));
+    }
+    dkv::RESPStreamParser parser;
+    std::vector<std::string_view> args;
+    for (auto _ : state) {
+        std::string_view data(input);
+        while (!data.empty()) {
+            if (parser.parse(data, args) != dkv::RESPStreamParser::Result::COMPLETE) {
+                state.SkipWithError("parse failed");
+                return;
+            }
+            benchmark::DoNotOptimize(args.data());
+            data.remove_prefix(parser.consumed());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * commands);
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_ParsePipeline)->Arg(16)->Arg(1024)->Arg(64 * 1024);
+
+// 一条命令分成多次到达，每次只多一个TCP分段
+void BM_ParseFragmented(benchmark::State& state) {
+    const std::string input = makeSetCommand(64 * 1024);
+    const size_t segment = state.range(0);
+    dkv::RESPStreamParser parser;
+    std::vector<std::string_view> args;
+    for (auto _ : state) {
+        size_t available = 0;
+        dkv::RESPStreamParser::Result result = dkv::RESPStreamParser::Result::INCOMPLETE;
+        while (result == dkv::RESPStreamParser::Result::INCOMPLETE) {
+            available = std::min(input.size(), available + segment);
+            result = parser.parse(std::string_view(input.data(), available), args);
+        }
+        benchmark::DoNotOptimize(args.data());
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_ParseFragmented)->Arg(1460)->Arg(16 * 1024);
+
+// 解析并构造Command，包含参数复制
+void BM_BuildCommand(benchmark::State& state) {
+    const std::string input = makeSetCommand(state.range(0));
+    dkv::RESPStreamParser parser;
+    std::vector<std::string_view> args;
+    for (auto _ : state) {
+        parser.parse(input, args);
+        dkv::Command command = dkv::RESPProtocol::buildCommand(args);
+        benchmark::DoNotOptimize(command.args.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BuildCommand)->Arg(16)->Arg(1024);
+
+// 参数为元素个数，对比返回新字符串的serializeArray和直接追加到复用缓冲区的RESPWriter
+std::vector<std::string> makeArray(size_t count) {
+    std::vector<std::string> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        values.push_back("member:" + std::to_string(i));
+    }
+    return values;
+}
+
+void BM_SerializeArray(benchmark::State& state) {
+    const std::vector<std::string> values = makeArray(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dkv::RESPProtocol::serializeArray(values));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SerializeArray)->Arg(1)->Arg(100)->Arg(10000);
+
+void BM_WriterResponse(benchmark::State& state) {
+    dkv::Response response;
+    response.setArray(makeArray(state.range(0)));
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        dkv::RESPWriter(out).writeResponse(response);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_WriterResponse)->Arg(1)->Arg(100)->Arg(10000);
+
+// 常见的单值回复
+void BM_WriterBulkString(benchmark::State& state) {
+    const std::string value(state.range(0), 'v');
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        dkv::RESPWriter(out).writeBulkString(value);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * value.size());
+}
+BENCHMARK(BM_WriterBulkString)->Arg(16)->Arg(1024);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+#include <benchmark/benchmark.h>
+#include "dkv_server.hpp"
+#include "dkv_logger.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+
+namespace {
+
+// 工作线程池模式、run-to-completion模式及io_uring后端的run-to-completion模式各启动一个服务器
+constexpr int POOL_PORT = 6391;
+constexpr int INLINE_PORT = 6392;
+constexpr int URING_PORT = 6393;
+
+const int PORTS[] = {POOL_PORT, INLINE_PORT, URING_PORT};
+const char* const LABELS[] = {"worker-pool", "run-to-completion", "run-to-completion/io_uring"};
+
+const std::string SET_COMMAND = "*3\r\n$3\r\nSET\r\n$7\r\nbench:k\r\n$5\r\nvalue\r\n";
+const std::string SET_REPLY = "+OK\r\n";
+const std::string GET_COMMAND = "*2\r\n$3\r\nGET\r\n$7\r\nbench:k\r\n";
+const std::string GET_REPLY = "$5\r\nvalue\r\n";
+
+int connectTo(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return sock;
+}
+
+// 发送一条命令并等待完整回复，返回是否与预期一致
+bool roundTrip(int sock, const std::string& command, const std::string& reply) {
+    if (send(sock, command.data(), command.size(), 0) != static_cast<ssize_t>(command.size())) {
+        return false;
+    }
+    char buffer[256];
+    size_t received = 0;
+    while (received < reply.size()) {
+        ssize_t n = recv(sock, buffer + received, sizeof(buffer) - received, 0);
+        if (n <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(n);
+    }
+    return reply.compare(0, reply.size(), buffer, received) == 0;
+}
+
+// 单连接逐条请求，每次迭代的耗时即为一次往返延迟
+void runLatency(benchmark::State& state, const std::string& command, const std::string& reply) {
+    int port = PORTS[state.range(0)];
+    int sock = connectTo(port);
+    if (sock < 0 || !roundTrip(sock, SET_COMMAND, SET_REPLY)) {
+        state.SkipWithError("连接服务器失败");
+        if (sock >= 0) {
+            close(sock);
+        }
+        return;
+    }
+    for (auto _ : state) {
+        if (!roundTrip(sock, command, reply)) {
+            state.SkipWithError("回复不符合预期");
+            break;
+        }
+    }
+    close(sock);
+    state.SetLabel(LABELS[state.range(0)]);
+}
+
+void BM_GetLatency(benchmark::State& state) {
+    runLatency(state, GET_COMMAND, GET_REPLY);
+}
+
+void BM_SetLatency(benchmark::State& state) {
+    runLatency(state, SET_COMMAND, SET_REPLY);
+}
+
+} // namespace
+
+BENCHMARK(BM_GetLatency)->Arg(0)->Arg(1)->Arg(2)->UseRealTime();
+BENCHMARK(BM_SetLatency)->Arg(0)->Arg(1)->Arg(2)->UseRealTime();
+
+int main(int argc, char** argv) {
+    dkv::Logger::getInstance().setLogLevel(dkv::LogLevel::WARNING);
+
+    auto startServer = [](int port, bool run_to_completion, dkv::IoBackend backend = dkv::IoBackend::EPOLL) {
+        auto server = std::make_unique<dkv::DKVServer>(port);
+        server->setRDBEnabled(false);
+        server->setAOFEnabled(false);
+        server->setRunToCompletion(run_to_completion);
+        server->setIoBackend(backend);
+        if (!server->start()) {
+            return std::unique_ptr<dkv::DKVServer>();
+        }
+        return server;
+    };
+    auto pool_server = startServer(POOL_PORT, false);
+    auto inline_server = startServer(INLINE_PORT, true);
+    auto uring_server = startServer(URING_PORT, true, dkv::IoBackend::IO_URING);
+    if (!pool_server || !inline_server || !uring_server) {
+        return 1;
+    }
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    uring_server->stop();
+    inline_server->stop();
+    pool_server->stop();
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+#include "storage/dkv_storage.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t KEY_COUNT = 100000;
+
+std::vector<std::string> makeKeys() {
+    std::vector<std::string> keys;
+    keys.reserve(KEY_COUNT);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        keys.push_back("user:" + std::to_string(i * 2654435761ULL));
+    }
+    return keys;
+}
+
+// 各线程共享同一个存储引擎，由0号线程在计时开始前创建、结束后销毁
+dkv::StorageEngine* engine = nullptr;
+
+void setUp(const benchmark::State& state, const std::vector<std::string>& keys) {
+    if (state.thread_index() != 0) {
+        return;
+    }
+    engine = new dkv::StorageEngine(dkv::TransactionIsolationLevel::READ_COMMITTED, state.range(0));
+    for (const auto& key : keys) {
+        engine->set(dkv::NO_TX, key, "value");
+    }
+}
+
+void tearDown(const benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        delete engine;
+        engine = nullptr;
+    }
+}
+
+// 参数为分段数，1个分段时所有线程竞争同一把锁；各线程从不同位置开始遍历键
+void BM_Get(benchmark::State& state) {
+    const std::vector<std::string> keys = makeKeys();
+    setUp(state, keys);
+    size_t i = state.thread_index() * 7919;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine->get(dkv::NO_TX, keys[i++ % KEY_COUNT]));
+    }
+    state.SetItemsProcessed(state.iterations());
+    tearDown(state);
+}
+
+void BM_Set(benchmark::State& state) {
+    const std::vector<std::string> keys = makeKeys();
+    setUp(state, keys);
+    const std::string value(64, 'v');
+    size_t i = state.thread_index() * 7919;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine->set(dkv::NO_TX, keys[i++ % KEY_COUNT], value));
+    }
+    state.SetItemsProcessed(state.iterations());
+    tearDown(state);
+}
+
+// 九成读一成写
+void BM_Mixed(benchmark::State& state) {
+    const std::vector<std::string> keys = makeKeys();
+    setUp(state, keys);
+    const std::string value(64, 'v');
+    size_t i = state.thread_index() * 7919;
+    for (auto _ : state) {
+        const std::string& key = keys[i % KEY_COUNT];
+        if (i++ % 10 == 0) {
+            benchmark::DoNotOptimize(engine->set(dkv::NO_TX, key, value));
+        } else {
+            benchmark::DoNotOptimize(engine->get(dkv::NO_TX, key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    tearDown(state);
+}
+
+} // namespace
+
+BENCHMARK(BM_Get)->Arg(1)->Arg(dkv::InnerStorage::DEFAULT_SEGMENT_COUNT)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Set)->Arg(1)->Arg(dkv::InnerStorage::DEFAULT_SEGMENT_COUNT)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Mixed)->Arg(dkv::InnerStorage::DEFAULT_SEGMENT_COUNT)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -2,10 +2,35 @@
 #include <thread>
 #include <chrono>
 #include <fstream>
+#include <atomic>
+#include <filesystem>
+#include <vector>
 #include "dkv_server.hpp"
 #include "dkv_core.hpp"
+#include "persist/dkv_aof.hpp"
+#include "net/dkv_resp.hpp"
 #include "test_runner.hpp"
 
+// 删除AOF清单及其列出的基础文件、增量文件
+void removeAOFFiles(const std::string& filename) {
+    for (const auto& entry : std::filesystem::directory_iterator(".")) {
+        if (entry.path().filename().string().rfind(filename, 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+// AOF全部文件的总大小
+size_t aofFilesSize(const std::string& filename) {
+    size_t total = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(".")) {
+        if (entry.path().filename().string().rfind(filename + ".", 0) == 0 && entry.is_regular_file()) {
+            total += entry.file_size();
+        }
+    }
+    return total;
+}
+
 // 测试AOF持久化功能
 void testAOF(dkv::TestRunner& runner) {
     std::cout << "开始测试AOF持久化功能..." << std::endl;
@@ -14,7 +39,7 @@ void testAOF(dkv::TestRunner& runner) {
     runner.runTest("测试AOF文件创建和命令追加", []() {
         std::cout << "Prepareing..." << std::endl;
         // 清理之前可能存在的测试文件
-        std::remove("test_aof.aof");
+        removeAOFFiles("test_aof.aof");
 
         // 创建服务器实例（使用非标准端口避免冲突）
         dkv::DKVServer server(6391);
@@ -78,7 +103,7 @@ void testAOF(dkv::TestRunner& runner) {
         std::this_thread::sleep_for(std::chrono::seconds(2));
         
         // 检查AOF文件是否创建
-        std::ifstream file("test_aof.aof");
+        std::ifstream file("test_aof.aof.manifest");
         bool file_exists = file.good();
         file.close();
         assert(file_exists);
@@ -93,7 +118,7 @@ void testAOF(dkv::TestRunner& runner) {
     // 测试AOF文件加载功能
     runner.runTest("测试AOF文件加载功能", []() {
         // 确保测试文件存在
-        std::ifstream file("test_aof.aof");
+        std::ifstream file("test_aof.aof.manifest");
         if (!file.good()) {
             std::cerr << "AOF测试文件不存在，跳过此测试" << std::endl;
             file.close();
@@ -182,8 +207,8 @@ void testAOF(dkv::TestRunner& runner) {
         server_always.setAOFFsyncPolicy("always");
         
         // 清理测试文件
-        std::remove("test_aof_never.aof");
-        std::remove("test_aof_always.aof");
+        removeAOFFiles("test_aof_never.aof");
+        removeAOFFiles("test_aof_always.aof");
         
         // 启动服务器
         if (!server_never.start() || !server_always.start()) {
@@ -201,8 +226,8 @@ void testAOF(dkv::TestRunner& runner) {
         server_always.stop();
         
         // 检查文件是否创建
-        std::ifstream file_never("test_aof_never.aof");
-        std::ifstream file_always("test_aof_always.aof");
+        std::ifstream file_never("test_aof_never.aof.manifest");
+        std::ifstream file_always("test_aof_always.aof.manifest");
         bool files_exist = file_never.good() && file_always.good();
         file_never.close();
         file_always.close();
@@ -210,11 +235,265 @@ void testAOF(dkv::TestRunner& runner) {
         return files_exist;
     });
     
+    // 测试组提交写线程
+    runner.runTest("测试ALWAYS策略下的组提交写入", []() {
+        const std::string filename = "test_aof_group_commit.aof";
+        removeAOFFiles(filename);
+
+        dkv::AOFPersistence aof;
+        ASSERT_TRUE(aof.initialize(filename, dkv::AOFPersistence::FsyncPolicy::ALWAYS));
+        const std::string incr_filename = aof.getIncrFilename();
+
+        // 多个线程并发追加，ALWAYS策略下返回时命令必须已经写入文件
+        const int thread_count = 8;
+        const int commands_per_thread = 200;
+        std::atomic<bool> all_written{true};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&aof, &all_written, &incr_filename, t]() {
+                for (int i = 0; i < commands_per_thread; ++i) {
+                    std::string key = "gc_" + std::to_string(t) + "_" + std::to_string(i);
+                    if (!aof.appendCommand(dkv::Command(dkv::CommandType::SET, {key, "v"}))) {
+                        all_written = false;
+                    }
+                }
+                // 本线程最后一条命令已落盘，文件中必然能找到
+                std::ifstream in(incr_filename, std::ios::binary);
+                std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+                std::string last_key = "gc_" + std::to_string(t) + "_" + std::to_string(commands_per_thread - 1);
+                if (content.find(last_key + "\r\n") == std::string::npos) {
+                    all_written = false;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        ASSERT_TRUE(all_written.load());
+
+        // 事务的多条命令用MULTI/EXEC包围作为一个条目写入
+        ASSERT_TRUE(aof.appendCommands({dkv::Command(dkv::CommandType::SET, {"gc_tx_a", "1"}),
+                                        dkv::Command(dkv::CommandType::SET, {"gc_tx_b", "2"})}));
+        aof.close();
+
+        // 逐条解析文件，命令数与写入数一致且没有交错损坏
+        std::ifstream in(incr_filename, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        size_t pos = 0;
+        int parsed = 0;
+        int framed = 0;
+        while (pos < content.size()) {
+            dkv::Command command = dkv::RESPProtocol::parseCommand(content, pos);
+            if (command.type == dkv::CommandType::MULTI || command.type == dkv::CommandType::EXEC) {
+                ++framed;
+                continue;
+            }
+            if (command.type != dkv::CommandType::SET) {
+                return false;
+            }
+            ASSERT_EQ(command.args.size(), 2u);
+            ++parsed;
+        }
+        ASSERT_EQ(parsed, thread_count * commands_per_thread + 2);
+        ASSERT_EQ(framed, 2);
+
+        removeAOFFiles(filename);
+        return true;
+    });
+
+    // 测试多文件布局下的后台重写
+    runner.runTest("测试后台重写生成RDB基础文件", []() {
+        const std::string filename = "test_aof_bg_rewrite.aof";
+        removeAOFFiles(filename);
+
+        dkv::StorageEngine storage(dkv::TransactionIsolationLevel::REPEATABLE_READ, 8);
+        const int key_count = 2000;
+        for (int i = 0; i < key_count; ++i) {
+            storage.set(dkv::NO_TX, "snap_" + std::to_string(i), std::string(100, 'x'));
+        }
+
+        // ALWAYS策略下追加返回时已写入文件，便于判断命令落在哪个增量文件
+        dkv::AOFPersistence aof;
+        ASSERT_TRUE(aof.initialize(filename, dkv::AOFPersistence::FsyncPolicy::ALWAYS));
+        ASSERT_TRUE(aof.getBaseFilename().empty());
+        const std::string old_incr = aof.getIncrFilename();
+        // 旧增量文件中的内容会被基础文件取代
+        ASSERT_TRUE(aof.appendCommand(dkv::Command(dkv::CommandType::SET, {"stale", "v"})));
+        // 限速使重写持续一段时间，与下面的追加重叠
+        aof.setRewriteRateLimit(1024 * 1024);
+
+        std::atomic<bool> rewrite_ok{false};
+        std::thread rewriter([&]() {
+            rewrite_ok = aof.rewrite(&storage);
+        });
+        // 等待切换到新的增量文件
+        while (aof.getIncrFilename() == old_incr) {
+            std::this_thread::yield();
+        }
+        // 同一时刻只允许一个重写
+        ASSERT_TRUE(!aof.rewrite(&storage));
+
+        // 重写期间及之后的追加都写入新的增量文件
+        int appended = 0;
+        while (aof.isRewriting()) {
+            ASSERT_TRUE(aof.appendCommand(dkv::Command(dkv::CommandType::SET, {"diff_" + std::to_string(appended), "v"})));
+            ++appended;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        rewriter.join();
+        ASSERT_TRUE(rewrite_ok.load());
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(aof.appendCommand(dkv::Command(dkv::CommandType::SET, {"diff_" + std::to_string(appended), "v"})));
+            ++appended;
+        }
+        const std::string base_filename = aof.getBaseFilename();
+        const std::string incr_filename = aof.getIncrFilename();
+        aof.close();
+        ASSERT_TRUE(appended > 10);
+        ASSERT_TRUE(incr_filename != old_incr);
+        ASSERT_TRUE(!std::filesystem::exists(old_incr));
+
+        // 基础文件是RDB格式的快照
+        dkv::StorageEngine loaded(dkv::TransactionIsolationLevel::REPEATABLE_READ, 8);
+        ASSERT_TRUE(loaded.loadRDB(base_filename));
+        ASSERT_EQ(loaded.size(), static_cast<size_t>(key_count));
+
+        // 增量文件按顺序包含重写开始后的全部追加
+        std::ifstream in(incr_filename, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        size_t pos = 0;
+        int next_diff = 0;
+        while (pos < content.size()) {
+            dkv::Command command = dkv::RESPProtocol::parseCommand(content, pos);
+            if (command.type != dkv::CommandType::SET || command.args.size() != 2 ||
+                command.args[0] != "diff_" + std::to_string(next_diff)) {
+                return false;
+            }
+            ++next_diff;
+        }
+        ASSERT_EQ(next_diff, appended);
+
+        // 重新打开时沿用清单中的文件
+        dkv::AOFPersistence reopened;
+        ASSERT_TRUE(reopened.initialize(filename, dkv::AOFPersistence::FsyncPolicy::EVERYSEC));
+        ASSERT_EQ(reopened.getBaseFilename(), base_filename);
+        ASSERT_EQ(reopened.getIncrFilename(), incr_filename);
+        reopened.close();
+
+        removeAOFFiles(filename);
+        return true;
+    });
+
+    // 测试按分段并行重放
+    runner.runTest("测试恢复时按分段并行重放", []() {
+        const std::string filename = "test_aof_replay.aof";
+        removeAOFFiles(filename);
+
+        // 写入顺序相关的命令：同一键的RPUSH/INCR必须按原顺序重放，多键DEL作为屏障
+        const int key_count = 200;
+        const int ops_per_key = 50;
+        {
+            dkv::AOFPersistence aof;
+            ASSERT_TRUE(aof.initialize(filename, dkv::AOFPersistence::FsyncPolicy::NEVER));
+            for (int i = 0; i < ops_per_key; ++i) {
+                for (int k = 0; k < key_count; ++k) {
+                    aof.appendCommand(dkv::Command(dkv::CommandType::RPUSH, {"list_" + std::to_string(k), std::to_string(i)}));
+                    aof.appendCommand(dkv::Command(dkv::CommandType::INCR, {"counter_" + std::to_string(k)}));
+                }
+            }
+            aof.appendCommands({dkv::Command(dkv::CommandType::DEL, {"list_0", "list_1"}),
+                                dkv::Command(dkv::CommandType::RPUSH, {"list_0", "after"})});
+            // 写入中途崩溃的事务只有MULTI没有EXEC，重放时整体丢弃
+            aof.appendCommand(dkv::Command(dkv::CommandType::MULTI, {}));
+            aof.appendCommand(dkv::Command(dkv::CommandType::RPUSH, {"list_2", "torn"}));
+            aof.appendCommand(dkv::Command(dkv::CommandType::INCR, {"counter_2"}));
+            aof.close();
+        }
+
+        dkv::DKVServer server(6398);
+        server.setRDBEnabled(false);
+        server.setAOFEnabled(true);
+        server.setAOFFilename(filename);
+        server.setRDBThreads(4);
+        if (!server.start()) {
+            return false;
+        }
+        dkv::StorageEngine* storage = server.getStorageEngine();
+        ASSERT_TRUE(!storage->inRecoveryMode());
+        bool ok = true;
+        for (int k = 2; k < key_count && ok; ++k) {
+            std::vector<dkv::Value> elements = storage->lrange(dkv::NO_TX, "list_" + std::to_string(k), 0, ops_per_key);
+            ok = elements.size() == static_cast<size_t>(ops_per_key);
+            for (int i = 0; i < ops_per_key && ok; ++i) {
+                ok = elements[i] == std::to_string(i);
+            }
+            ok = ok && storage->get(dkv::NO_TX, "counter_" + std::to_string(k)) == std::to_string(ops_per_key);
+        }
+        ok = ok && storage->lrange(dkv::NO_TX, "list_0", 0, 10) == std::vector<dkv::Value>{"after"};
+        ok = ok && !storage->exists(dkv::NO_TX, "list_1");
+        // 事务控制命令不会在重放时开启事务
+        ok = ok && storage->getTransactionManager()->getActiveTransactions().empty();
+        server.stop();
+        removeAOFFiles(filename);
+        return ok;
+    });
+
+    // 测试阻塞命令只在取到元素时记录，并改写为非阻塞命令
+    runner.runTest("测试阻塞命令改写后写入AOF", []() {
+        const std::string filename = "test_aof_blocking.aof";
+        removeAOFFiles(filename);
+        {
+            dkv::DKVServer server(6423);
+            server.setRDBEnabled(false);
+            server.setAOFEnabled(true);
+            server.setAOFFilename(filename);
+            server.setAOFFsyncPolicy("always");
+            if (!server.start()) {
+                return false;
+            }
+            using dkv::Command;
+            using dkv::CommandType;
+            ASSERT_TRUE(server.executeCommand(Command(CommandType::BLPOP, {"bq", "1"}), dkv::NO_TX).status == dkv::ResponseStatus::NOT_FOUND);
+            server.executeCommand(Command(CommandType::RPUSH, {"bq", "a"}), dkv::NO_TX);
+            server.executeCommand(Command(CommandType::RPUSH, {"bq", "b"}), dkv::NO_TX);
+            server.executeCommand(Command(CommandType::RPUSH, {"bq", "c"}), dkv::NO_TX);
+            ASSERT_TRUE(server.executeCommand(Command(CommandType::BLPOP, {"bq_none", "bq", "0"}), dkv::NO_TX).elements ==
+                        std::vector<std::string>({"bq", "a"}));
+            ASSERT_EQ(server.executeCommand(Command(CommandType::BLMOVE, {"bq", "bq_dst", "LEFT", "RIGHT", "0"}), dkv::NO_TX).data,
+                      std::string("b"));
+            ASSERT_TRUE(server.executeCommand(Command(CommandType::BRPOP, {"bq_none", "0"}), dkv::NO_TX).status == dkv::ResponseStatus::NOT_FOUND);
+            server.stop();
+        }
+        std::string content;
+        for (const auto& entry : std::filesystem::directory_iterator(".")) {
+            if (entry.path().filename().string().rfind(filename + ".", 0) == 0 && entry.is_regular_file()) {
+                std::ifstream in(entry.path(), std::ios::binary);
+                content.append(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            }
+        }
+        ASSERT_TRUE(content.find("LPOP") != std::string::npos && content.find("LMOVE") != std::string::npos);
+        ASSERT_TRUE(content.find("BLPOP") == std::string::npos && content.find("BRPOP") == std::string::npos &&
+                    content.find("BLMOVE") == std::string::npos);
+
+        dkv::DKVServer loaded(6423);
+        loaded.setRDBEnabled(false);
+        loaded.setAOFEnabled(true);
+        loaded.setAOFFilename(filename);
+        if (!loaded.start()) {
+            return false;
+        }
+        dkv::StorageEngine* storage = loaded.getStorageEngine();
+        bool ok = storage->lrange(dkv::NO_TX, "bq", 0, 10) == std::vector<dkv::Value>{"c"} &&
+                  storage->lrange(dkv::NO_TX, "bq_dst", 0, 10) == std::vector<dkv::Value>{"b"};
+        loaded.stop();
+        removeAOFFiles(filename);
+        return ok;
+    });
+
     // 测试AOF重写功能
     runner.runTest("测试AOF重写功能", []() {
         // 清理之前可能存在的测试文件
-        std::remove("test_aof_rewrite.aof");
-        std::remove("test_aof_rewrite_temp.aof");
+        removeAOFFiles("test_aof_rewrite.aof");
         
         // 创建服务器实例
         dkv::DKVServer server(6395);
@@ -267,8 +546,8 @@ void testAOF(dkv::TestRunner& runner) {
         sendCommand("*3\r\n$3\r\nSET\r\n$12\r\nrewrite_key1\r\n$12\r\nrewrite_val1\r\n");
         sendCommand("*3\r\n$3\r\nSET\r\n$12\r\nrewrite_key2\r\n$12\r\nrewrite_val2\r\n");
         sendCommand("*2\r\n$4\r\nINCR\r\n$13\r\nrewrite_count\r\n");
-        sendCommand("*3\r\n$5\r\nLPUSH\r\n$12\r\nrewrite_list\r\n$12\r\nlist_item_1\r\n");
-        sendCommand("*3\r\n$5\r\nLPUSH\r\n$12\r\nrewrite_list\r\n$12\r\nlist_item_2\r\n");
+        sendCommand("*3\r\n$5\r\nLPUSH\r\n$12\r\nrewrite_list\r\n$11\r\nlist_item_1\r\n");
+        sendCommand("*3\r\n$5\r\nLPUSH\r\n$12\r\nrewrite_list\r\n$11\r\nlist_item_2\r\n");
         sendCommand("*4\r\n$4\r\nHSET\r\n$12\r\nrewrite_hash\r\n$5\r\nfield\r\n$5\r\nvalue\r\n");
         // 添加HyperLogLog类型数据
         sendCommand("*3\r\n$5\r\nPFADD\r\n$19\r\nrewrite_hyperloglog\r\n$9\r\nelement_1\r\n");
@@ -279,9 +558,7 @@ void testAOF(dkv::TestRunner& runner) {
         std::this_thread::sleep_for(std::chrono::seconds(2));
 
         // 记录原始AOF文件大小
-        std::ifstream original_file("test_aof_rewrite.aof", std::ios::ate | std::ios::binary);
-        std::streamsize original_size = original_file.tellg();
-        original_file.close();
+        size_t original_size = aofFilesSize("test_aof_rewrite.aof");
         
         // 执行AOF重写
         if (!server.rewriteAOF()) {
@@ -295,9 +572,7 @@ void testAOF(dkv::TestRunner& runner) {
         std::this_thread::sleep_for(std::chrono::seconds(2));
         
         // 记录重写后AOF文件大小
-        std::ifstream rewritten_file("test_aof_rewrite.aof", std::ios::ate | std::ios::binary);
-        std::streamsize rewritten_size = rewritten_file.tellg();
-        rewritten_file.close();
+        size_t rewritten_size = aofFilesSize("test_aof_rewrite.aof");
         
         // 打印文件大小信息
         std::cout << "原始AOF文件大小: " << original_size << " 字节" << std::endl;
@@ -358,7 +633,7 @@ void testAOF(dkv::TestRunner& runner) {
         response = new_sendCommand("*2\r\n$4\r\nLLEN\r\n$12\r\nrewrite_list\r\n");
         ASSERT_CONTAINS(response, "$1\r\n2");
         
-        response = new_sendCommand("*4\r\n$4\r\nHGET\r\n$12\r\nrewrite_hash\r\n$5\r\nfield\r\n");
+        response = new_sendCommand("*3\r\n$4\r\nHGET\r\n$12\r\nrewrite_hash\r\n$5\r\nfield\r\n");
         ASSERT_CONTAINS(response, "$5\r\nvalue");
         
         // 验证HyperLogLog数据是否正确恢复
@@ -370,7 +645,7 @@ void testAOF(dkv::TestRunner& runner) {
         new_server.stop();
         
         // 检查重写后的文件是否存在
-        std::ifstream check_file("test_aof_rewrite.aof");
+        std::ifstream check_file("test_aof_rewrite.aof.manifest");
         bool file_exists = check_file.good();
         check_file.close();
         
@@ -1,8 +1,11 @@
 #include "dkv_core.hpp"
+#include "dkv_cached_clock.hpp"
 #include "storage/dkv_storage.hpp"
 #include "net/dkv_network.hpp"
 #include "dkv_server.hpp"
 #include "datatypes/dkv_datatype_string.hpp"
+#include "dkv_command_handler.hpp"
+#include "net/dkv_resp.hpp"
 #include "test_runner.hpp"
 #include <iostream>
 #include <cassert>
@@ -10,6 +13,7 @@
 #include <vector>
 #include <chrono>
 #include <functional>
+#include <set>
 using namespace std;
 
 namespace dkv {
@@ -40,6 +44,92 @@ bool testUtils() {
     assert(Utils::stringToInt("-456") == -456);
     assert(Utils::intToString(789) == "789");
     
+    // 测试glob模式匹配
+    assert(Utils::matchPattern("*", ""));
+    assert(Utils::matchPattern("user:*", "user:42"));
+    assert(!Utils::matchPattern("user:*", "order:1"));
+    assert(Utils::matchPattern("h?llo", "hello"));
+    assert(!Utils::matchPattern("h?llo", "hllo"));
+    assert(Utils::matchPattern("h[ae]llo", "hallo"));
+    assert(!Utils::matchPattern("h[^e]llo", "hello"));
+    assert(Utils::matchPattern("key[0-9]", "key7"));
+    assert(Utils::matchPattern("a*b*c", "axxbyyc"));
+    assert(!Utils::matchPattern("a*b*c", "axxbyy"));
+    assert(Utils::matchPattern("a\\*", "a*"));
+    assert(!Utils::matchPattern("a\\*", "ab"));
+    
+    return true;
+}
+
+// 测试命令表：名称查找不区分大小写，键的位置和参数个数由命令表给出
+bool testCommandTable() {
+    ASSERT_TRUE(Utils::stringToCommandType("get") == CommandType::GET);
+    ASSERT_TRUE(Utils::stringToCommandType("zRevRangeByScore") == CommandType::ZREVRANGEBYSCORE);
+    ASSERT_TRUE(Utils::stringToCommandType("restore_batch") == CommandType::RESTORE_BATCH);
+    ASSERT_TRUE(Utils::stringToCommandType("GE") == CommandType::UNKNOWN);
+    ASSERT_TRUE(Utils::stringToCommandType("GETX") == CommandType::UNKNOWN);
+    ASSERT_TRUE(Utils::stringToCommandType("") == CommandType::UNKNOWN);
+    ASSERT_TRUE(Utils::stringToCommandType("ZREVRANGEBYSCOREX") == CommandType::UNKNOWN);
+    for (const auto& spec : COMMAND_TABLE) {
+        ASSERT_TRUE(Utils::stringToCommandType(spec.name) == spec.type);
+        ASSERT_EQ(Utils::commandTypeToString(spec.type), std::string(spec.name));
+    }
+    ASSERT_EQ(Utils::commandTypeToString(CommandType::UNKNOWN), "UNKNOWN");
+    static_assert(findCommand("hgetall") == &COMMAND_TABLE[static_cast<size_t>(CommandType::HGETALL)],
+                  "lookup is usable at compile time");
+
+    ASSERT_TRUE(Command(CommandType::GET, {"k"}).keys() == std::vector<Key>({"k"}));
+    ASSERT_TRUE(Command(CommandType::MSET, {"a", "1", "b", "2"}).keys() == std::vector<Key>({"a", "b"}));
+    ASSERT_TRUE(Command(CommandType::BLPOP, {"a", "b", "0"}).keys() == std::vector<Key>({"a", "b"}));
+    ASSERT_TRUE(Command(CommandType::BLMOVE, {"src", "dst", "LEFT", "RIGHT", "0"}).keys() ==
+                std::vector<Key>({"src", "dst"}));
+    ASSERT_TRUE(Command(CommandType::BITOP, {"AND", "dest", "a", "b"}).keys() ==
+                std::vector<Key>({"dest", "a", "b"}));
+    ASSERT_TRUE(Command(CommandType::BLMOVE, {"src"}).keys().empty());
+    ASSERT_TRUE(Command(CommandType::GET, {}).keys().empty());
+    ASSERT_TRUE(Command(CommandType::SCAN, {"0"}).keys().empty());
+
+    ASSERT_TRUE(commandSpec(CommandType::GET).arityMatches(1));
+    ASSERT_TRUE(!commandSpec(CommandType::GET).arityMatches(0));
+    ASSERT_TRUE(!commandSpec(CommandType::GET).arityMatches(2));
+    ASSERT_TRUE(!commandSpec(CommandType::HGET).arityMatches(3));
+    ASSERT_TRUE(commandSpec(CommandType::MSET).arityMatches(4));
+    ASSERT_TRUE(commandSpec(CommandType::BLMOVE).arityMatches(5));
+    ASSERT_TRUE(!commandSpec(CommandType::BLMOVE).arityMatches(6));
+    ASSERT_TRUE(commandSpec(CommandType::DBSIZE).arityMatches(0));
+    ASSERT_TRUE(commandSpec(CommandType::UNKNOWN).arityMatches(3));
+
+    ASSERT_TRUE(isReadOnlyCommand(CommandType::ZRANGE) && !isReadOnlyCommand(CommandType::TTL));
+    ASSERT_TRUE(commandNotAllowedInScript(CommandType::INFO) && commandNotAllowedInScript(CommandType::FLUSHDB));
+    ASSERT_TRUE(!commandNotAllowedInTx(CommandType::INFO));
+    ASSERT_TRUE(isBlockingCommand(CommandType::BRPOP) && !isBlockingCommand(CommandType::RPOP));
+    ASSERT_TRUE(commandSpec(CommandType::SET).hasFlag(CMD_DENY_OOM) && !commandSpec(CommandType::DEL).hasFlag(CMD_DENY_OOM));
+    ASSERT_TRUE(commandSpec(CommandType::MSET).hasFlag(CMD_SCATTER) && commandSpec(CommandType::MSET).key_step == 2);
+    ASSERT_TRUE(!commandSpec(CommandType::MSETNX).hasFlag(CMD_SCATTER));
+    ASSERT_TRUE(commandSpec(CommandType::WATCH).hasFlag(CMD_TX_CONTROL) && commandSpec(CommandType::EVALSHA).hasFlag(CMD_NO_AOF));
+    return true;
+}
+
+// 测试缓存时钟：运行时读取更新线程缓存的时间，全部stop后退回系统时钟
+bool testCachedClock() {
+    ASSERT_FALSE(CachedClock::running());
+    CachedClock::start();
+    CachedClock::start();
+    ASSERT_TRUE(CachedClock::running());
+    auto diff = chrono::duration_cast<chrono::milliseconds>(Utils::getCurrentTime() - CachedClock::now()).count();
+    ASSERT_GE(diff, -1);
+    ASSERT_LT(diff, 100);
+    int64_t before = CachedClock::nowMs();
+    this_thread::sleep_for(chrono::milliseconds(20));
+    ASSERT_GT(CachedClock::nowMs(), before);
+
+    CachedClock::stop();
+    ASSERT_TRUE(CachedClock::running());
+    CachedClock::stop();
+    ASSERT_FALSE(CachedClock::running());
+    diff = chrono::duration_cast<chrono::milliseconds>(Utils::getCurrentTime() - CachedClock::now()).count();
+    ASSERT_GE(diff, -1);
+    ASSERT_LT(diff, 100);
     return true;
 }
 
@@ -87,6 +177,47 @@ bool testStorageEngine() {
     return true;
 }
 
+// 测试批量读写：MGET/MSET/MSETNX/HMGET/HMSET
+bool testBatchCommands() {
+    StorageEngine storage;
+    ASSERT_TRUE(storage.mset(NO_TX, {{"k1", "v1"}, {"k2", "v2"}, {"k3", "v3"}}));
+    std::vector<Value> values = storage.mget(NO_TX, {"k1", "missing", "k3", "k2"});
+    ASSERT_EQ(values.size(), static_cast<size_t>(4));
+    ASSERT_EQ(values[0], "v1");
+    ASSERT_TRUE(values[1].empty());
+    ASSERT_EQ(values[2], "v3");
+    ASSERT_EQ(values[3], "v2");
+
+    // 任一键已存在时MSETNX不写入任何键
+    ASSERT_FALSE(storage.msetnx(NO_TX, {{"k4", "v4"}, {"k1", "x"}}));
+    ASSERT_FALSE(storage.exists(NO_TX, "k4"));
+    ASSERT_EQ(storage.get(NO_TX, "k1"), "v1");
+    ASSERT_TRUE(storage.msetnx(NO_TX, {{"k4", "v4"}, {"k5", "v5"}}));
+    ASSERT_EQ(storage.get(NO_TX, "k5"), "v5");
+
+    ASSERT_EQ(storage.hmset(NO_TX, "h", {{"f1", "a"}, {"f2", "b"}}), static_cast<size_t>(2));
+    ASSERT_EQ(storage.hmset(NO_TX, "h", {{"f2", "c"}, {"f3", "d"}}), static_cast<size_t>(2));
+    values = storage.hmget(NO_TX, "h", {"f1", "f2", "nope", "f3"});
+    ASSERT_EQ(values.size(), static_cast<size_t>(4));
+    ASSERT_EQ(values[0], "a");
+    ASSERT_EQ(values[1], "c");
+    ASSERT_TRUE(values[2].empty());
+    ASSERT_EQ(values[3], "d");
+    // 类型不符时不写入
+    ASSERT_EQ(storage.hmset(NO_TX, "k1", {{"f", "v"}}), static_cast<size_t>(0));
+    // 字符串以外的键在MGET中为空
+    values = storage.mget(NO_TX, {"h", "k1"});
+    ASSERT_TRUE(values[0].empty());
+    ASSERT_EQ(values[1], "v1");
+
+    // 命令键提取：MSET只取键，不取值
+    Command mset(CommandType::MSET, {"a", "1", "b", "2"});
+    std::vector<Key> keys = mset.keys();
+    ASSERT_EQ(keys.size(), static_cast<size_t>(2));
+    ASSERT_EQ(keys[1], "b");
+    return true;
+}
+
 bool testRESPProtocol() {
     // 测试命令解析
     string command_data = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n";
@@ -134,6 +265,134 @@ bool testCommandExecution() {
     return true;
 }
 
+// 测试SCAN系列：游标遍历返回全部键和元素，命令层支持MATCH和COUNT
+// 测试UNLINK与异步FLUSHDB：大集合交给后台线程释放，小值直接释放，清空后引擎仍可使用
+bool testLazyFree() {
+    StorageEngine storage;
+    std::vector<Value> members;
+    for (size_t i = 0; i <= LazyFreer::LAZYFREE_THRESHOLD; ++i) {
+        members.push_back("m" + std::to_string(i));
+    }
+    ASSERT_EQ(storage.sadd(NO_TX, "big", members), members.size());
+    ASSERT_TRUE(storage.set(NO_TX, "small", "v"));
+
+    ASSERT_TRUE(storage.unlink(NO_TX, "big"));
+    ASSERT_FALSE(storage.exists(NO_TX, "big"));
+    ASSERT_FALSE(storage.unlink(NO_TX, "big"));
+    ASSERT_TRUE(storage.unlink(NO_TX, "small"));
+    storage.lazyFreer().drain();
+    ASSERT_EQ(storage.lazyFreer().freedObjects(), 1u);
+    ASSERT_EQ(storage.lazyFreer().pendingObjects(), 0u);
+
+    // lazyfree_lazy_user_del使DEL同样在后台释放
+    LazyFreeConfig config;
+    config.lazy_user_del = true;
+    storage.setLazyFreeConfig(config);
+    storage.sadd(NO_TX, "big", members);
+    ASSERT_TRUE(storage.del(NO_TX, "big"));
+    storage.lazyFreer().drain();
+    ASSERT_EQ(storage.lazyFreer().freedObjects(), 2u);
+
+    for (int i = 0; i < 100; ++i) {
+        storage.set(NO_TX, "key" + std::to_string(i), "v", 100);
+    }
+    storage.flush(true);
+    ASSERT_EQ(storage.size(), 0u);
+    ASSERT_FALSE(storage.exists(NO_TX, "key0"));
+    ASSERT_EQ(storage.ttl(NO_TX, "key1"), -2);
+    ASSERT_TRUE(storage.set(NO_TX, "key0", "again"));
+    ASSERT_EQ(storage.get(NO_TX, "key0"), "again");
+    storage.lazyFreer().drain();
+    ASSERT_TRUE(storage.lazyFreer().freedObjects() > 2);
+    return true;
+}
+
+bool testScanCommands() {
+    StorageEngine storage;
+    const int NUM_KEYS = 2000;
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        storage.set(NO_TX, "user:" + to_string(i), "v");
+    }
+    storage.set(NO_TX, "other", "v");
+
+    set<string> keys;
+    size_t cursor = 0;
+    size_t calls = 0;
+    do {
+        size_t batch = 0;
+        cursor = storage.scan(cursor, 100, [&](const SharedKey& key, const DataItem&) {
+            keys.insert(key.str());
+            batch++;
+        });
+        ASSERT_LE(batch, static_cast<size_t>(1000));
+        calls++;
+    } while (cursor != 0);
+    ASSERT_EQ(keys.size(), static_cast<size_t>(NUM_KEYS + 1));
+    ASSERT_GT(calls, static_cast<size_t>(1));
+
+    // 超过紧凑编码阈值的集合类型按桶分批返回
+    for (int i = 0; i < 1000; ++i) {
+        storage.hset(NO_TX, "hash", "f" + to_string(i), to_string(i));
+        storage.sadd(NO_TX, "set", {"m" + to_string(i)});
+        storage.zadd(NO_TX, "zset", {{"z" + to_string(i), static_cast<double>(i)}});
+    }
+    set<string> fields;
+    cursor = 0;
+    do {
+        vector<pair<Value, Value>> out;
+        cursor = storage.hscan(NO_TX, "hash", cursor, 50, out);
+        for (const auto& pair : out) {
+            ASSERT_EQ(pair.second, pair.first.substr(1));
+            fields.insert(pair.first);
+        }
+    } while (cursor != 0);
+    ASSERT_EQ(fields.size(), static_cast<size_t>(1000));
+
+    set<string> members;
+    cursor = 0;
+    do {
+        vector<Value> out;
+        cursor = storage.sscan(NO_TX, "set", cursor, 50, out);
+        members.insert(out.begin(), out.end());
+    } while (cursor != 0);
+    ASSERT_EQ(members.size(), static_cast<size_t>(1000));
+
+    set<string> zmembers;
+    cursor = 0;
+    do {
+        vector<pair<Value, double>> out;
+        cursor = storage.zscan(NO_TX, "zset", cursor, 50, out);
+        for (const auto& pair : out) {
+            zmembers.insert(pair.first);
+        }
+    } while (cursor != 0);
+    ASSERT_EQ(zmembers.size(), static_cast<size_t>(1000));
+
+    // 命令层：回复为[游标, 元素数组]
+    CommandHandler handler(&storage, nullptr, false);
+    Response response = handler.handleScanCommand(Command(CommandType::SCAN, {"0", "MATCH", "oth*", "COUNT", "10000"}));
+    ASSERT_TRUE(response.is_array);
+    ASSERT_EQ(response.elements.size(), static_cast<size_t>(2));
+    ASSERT_EQ(response.elements[0], string("0"));
+    ASSERT_EQ(response.elements[1], RESPProtocol::serializeArray({"other"}));
+
+    storage.hset(NO_TX, "small", "name", "dkv");
+    response = handler.handleHScanCommand(NO_TX, Command(CommandType::HSCAN, {"small", "0"}));
+    ASSERT_EQ(response.elements[0], string("0"));
+    ASSERT_EQ(response.elements[1], RESPProtocol::serializeArray({"name", "dkv"}));
+
+    response = handler.handleSScanCommand(NO_TX, Command(CommandType::SSCAN, {"missing", "0"}));
+    ASSERT_EQ(response.elements[1], RESPProtocol::serializeArray({}));
+
+    response = handler.handleScanCommand(Command(CommandType::SCAN, {"abc"}));
+    ASSERT_TRUE(response.status == ResponseStatus::ERROR);
+    response = handler.handleScanCommand(Command(CommandType::SCAN, {"0", "COUNT", "0"}));
+    ASSERT_TRUE(response.status == ResponseStatus::ERROR);
+    response = handler.handleZScanCommand(NO_TX, Command(CommandType::ZSCAN, {"zset", "0", "MATCH"}));
+    ASSERT_TRUE(response.status == ResponseStatus::ERROR);
+    return true;
+}
+
 // 集成测试
 bool testIntegration() {
     // 创建数据库服务器
@@ -157,6 +416,67 @@ bool testIntegration() {
     return true;
 }
 
+// WATCH/UNWATCH：监视的键在EXEC之前被其他客户端修改时事务失败
+bool testWatchCommands() {
+    DKVServer server(6397);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    if (!server.start()) {
+        return false;
+    }
+    const int client_a = 1001, client_b = 1002;
+    auto run = [&server](int client, CommandType type, std::vector<std::string> args) {
+        return server.OnClientCommand(client, Command(type, std::move(args)));
+    };
+
+    // 参数个数不对的命令在执行前被拒绝
+    ASSERT_EQ(run(client_a, CommandType::GET, {}).message, "wrong number of arguments for 'GET' command");
+    ASSERT_EQ(run(client_a, CommandType::GET, {"a", "b"}).message, "wrong number of arguments for 'GET' command");
+    ASSERT_TRUE(run(client_a, CommandType::WATCH, {}).status == ResponseStatus::ERROR);
+
+    // 非事务写入使监视失效
+    run(client_a, CommandType::SET, {"counter", "1"});
+    ASSERT_TRUE(run(client_a, CommandType::WATCH, {"counter"}).status == ResponseStatus::OK);
+    run(client_b, CommandType::SET, {"counter", "2"});
+    ASSERT_TRUE(run(client_a, CommandType::MULTI, {}).status == ResponseStatus::OK);
+    ASSERT_TRUE(run(client_a, CommandType::WATCH, {"counter"}).status == ResponseStatus::ERROR);
+    run(client_a, CommandType::SET, {"counter", "10"});
+    ASSERT_TRUE(run(client_a, CommandType::EXEC, {}).status == ResponseStatus::NOT_FOUND);
+    ASSERT_EQ(run(client_a, CommandType::GET, {"counter"}).data, "2");
+
+    // 监视的键未被修改时正常提交，EXEC之后监视已取消
+    ASSERT_TRUE(run(client_a, CommandType::WATCH, {"counter"}).status == ResponseStatus::OK);
+    run(client_a, CommandType::MULTI, {});
+    run(client_a, CommandType::SET, {"counter", "3"});
+    ASSERT_TRUE(run(client_a, CommandType::EXEC, {}).status == ResponseStatus::OK);
+    ASSERT_EQ(run(client_b, CommandType::GET, {"counter"}).data, "3");
+
+    // 其他客户端的事务提交使监视失效，未监视的键不受影响
+    run(client_a, CommandType::WATCH, {"counter", "other"});
+    run(client_b, CommandType::MULTI, {});
+    run(client_b, CommandType::SET, {"unrelated", "x"});
+    ASSERT_TRUE(run(client_b, CommandType::EXEC, {}).status == ResponseStatus::OK);
+    run(client_b, CommandType::MULTI, {});
+    run(client_b, CommandType::SET, {"counter", "4"});
+    ASSERT_TRUE(run(client_b, CommandType::EXEC, {}).status == ResponseStatus::OK);
+    run(client_a, CommandType::MULTI, {});
+    run(client_a, CommandType::SET, {"counter", "100"});
+    ASSERT_TRUE(run(client_a, CommandType::EXEC, {}).status == ResponseStatus::NOT_FOUND);
+    ASSERT_EQ(run(client_a, CommandType::GET, {"counter"}).data, "4");
+
+    // UNWATCH之后的修改不影响提交
+    run(client_a, CommandType::WATCH, {"counter"});
+    ASSERT_TRUE(run(client_a, CommandType::UNWATCH, {}).status == ResponseStatus::OK);
+    run(client_b, CommandType::SET, {"counter", "5"});
+    run(client_a, CommandType::MULTI, {});
+    run(client_a, CommandType::SET, {"counter", "6"});
+    ASSERT_TRUE(run(client_a, CommandType::EXEC, {}).status == ResponseStatus::OK);
+    ASSERT_EQ(run(client_b, CommandType::GET, {"counter"}).data, "6");
+
+    server.stop();
+    return true;
+}
+
 } // namespace dkv
 
 int main() {
@@ -168,9 +488,15 @@ int main() {
     
     // 运行所有测试
     runner.runTest("Utils工具函数", testUtils);
+    runner.runTest("命令表", testCommandTable);
+    runner.runTest("缓存时钟", testCachedClock);
     runner.runTest("StorageEngine操作", testStorageEngine);
+    runner.runTest("批量读写命令", testBatchCommands);
     runner.runTest("RESP协议解析", testRESPProtocol);
     runner.runTest("命令执行", testCommandExecution);
+    runner.runTest("UNLINK与异步FLUSHDB", testLazyFree);
+    runner.runTest("SCAN游标遍历", testScanCommands);
+    runner.runTest("WATCH乐观事务", testWatchCommands);
     runner.runTest("集成测试", testIntegration);
     
     // 打印测试总结
@@ -367,6 +367,83 @@ bool testHighConcurrencyPerformance() {
     return true;
 }
 
+// 测试分段存储下跨分段多键操作的并发安全性（按固定顺序加锁，不应死锁）
+bool testConcurrentMultiKeySegments() {
+    StorageEngine storage(TransactionIsolationLevel::READ_COMMITTED, 8);
+    const int NUM_THREADS = 8;
+    const int OPS_PER_THREAD = 200;
+    const int NUM_KEYS = 16;
+
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        storage.setBit(NO_TX, "bm" + to_string(i), i, true);
+        storage.pfadd(NO_TX, "hll" + to_string(i), {"e" + to_string(i)});
+    }
+
+    vector<thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&storage, t, OPS_PER_THREAD, NUM_KEYS]() {
+            for (int i = 0; i < OPS_PER_THREAD; ++i) {
+                // 不同线程以相反顺序传入键，检验加锁顺序与参数顺序无关
+                int a = (t + i) % NUM_KEYS;
+                int b = (t * 7 + i * 3 + 1) % NUM_KEYS;
+                vector<Key> bm_keys = {"bm" + to_string(a), "bm" + to_string(b)};
+                vector<Key> hll_keys = {"hll" + to_string(b), "hll" + to_string(a)};
+                if (t % 2) {
+                    swap(bm_keys[0], bm_keys[1]);
+                    swap(hll_keys[0], hll_keys[1]);
+                }
+                storage.bitOp(NO_TX, "OR", "bmdest" + to_string(t), bm_keys);
+                storage.pfmerge(NO_TX, "hlldest" + to_string(t), hll_keys);
+                storage.set(NO_TX, "k" + to_string(t) + "_" + to_string(i), "v");
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(storage.size(), static_cast<size_t>(NUM_KEYS * 2 + NUM_THREADS * 2 + NUM_THREADS * OPS_PER_THREAD));
+    ASSERT_EQ(storage.keys().size(), storage.size());
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        ASSERT_GE(storage.bitCount(NO_TX, "bmdest" + to_string(t)), static_cast<size_t>(1));
+        ASSERT_GE(storage.pfcount(NO_TX, "hlldest" + to_string(t)), static_cast<uint64_t>(1));
+    }
+    storage.flush();
+    ASSERT_EQ(storage.size(), static_cast<size_t>(0));
+
+    return true;
+}
+
+// 测试持有整个键空间：本线程的命令不再加锁，其他线程的命令等待释放后才执行
+bool testKeyspaceLock() {
+    StorageEngine storage(TransactionIsolationLevel::READ_COMMITTED, 8);
+    atomic<bool> other_done{false};
+    thread other;
+    {
+        auto keyspace_lock = storage.lockKeyspace();
+        // 持有全部分段锁的线程执行单键、多键和全键空间操作都不会自锁
+        storage.set(NO_TX, "a", "1");
+        storage.incr(NO_TX, "a");
+        storage.mset(NO_TX, {{"b", "2"}, {"c", "3"}});
+        ASSERT_EQ(storage.mget(NO_TX, {"a", "b", "c"}).size(), static_cast<size_t>(3));
+        ASSERT_EQ(storage.size(), static_cast<size_t>(3));
+        storage.getKeyspaceStats();
+
+        other = thread([&storage, &other_done]() {
+            storage.set(NO_TX, "a", "other");
+            other_done = true;
+        });
+        this_thread::sleep_for(chrono::milliseconds(50));
+        ASSERT_FALSE(other_done.load());
+        ASSERT_EQ(storage.get(NO_TX, "a"), "2");
+    }
+    other.join();
+    ASSERT_TRUE(other_done.load());
+    ASSERT_EQ(storage.get(NO_TX, "a"), "other");
+    return true;
+}
+
 } // namespace dkv
 
 int main() {
@@ -384,6 +461,8 @@ int main() {
     runner.runTest("哈希操作并发安全性", testConcurrentHashOperations);
     runner.runTest("列表操作并发安全性", testConcurrentListOperations);
     runner.runTest("高并发性能测试", testHighConcurrencyPerformance);
+    runner.runTest("分段存储多键操作并发安全性", testConcurrentMultiKeySegments);
+    runner.runTest("持有整个键空间", testKeyspaceLock);
     
     // 打印测试总结
     runner.printSummary();
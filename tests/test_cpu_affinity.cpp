@@ -0,0 +1,94 @@
+#include "dkv_cpu_affinity.hpp"
+#include "test_runner.hpp"
+#include <iostream>
+#include <vector>
+
+namespace dkv {
+
+// 测试CPU列表解析
+bool testParseCpuList() {
+    std::vector<int> cpus;
+    ASSERT_TRUE(parseCpuList("0-3,8,10-11", cpus));
+    ASSERT_TRUE(cpus == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+
+    // 重复的CPU只保留一个并排序
+    ASSERT_TRUE(parseCpuList("5,1-2,2", cpus));
+    ASSERT_TRUE(cpus == std::vector<int>({1, 2, 5}));
+
+    ASSERT_TRUE(parseCpuList("", cpus));
+    ASSERT_TRUE(cpus.empty());
+
+    // 格式错误时返回false，原结果不变
+    cpus = {7};
+    ASSERT_FALSE(parseCpuList("3-1", cpus));
+    ASSERT_FALSE(parseCpuList("a-b", cpus));
+    ASSERT_FALSE(parseCpuList("-1", cpus));
+    ASSERT_TRUE(cpus == std::vector<int>({7}));
+    return true;
+}
+
+// 测试指定CPU列表时每个线程依次绑定一个CPU
+bool testPlanExplicitCpus() {
+    CpuAffinityConfig config;
+    config.reactor_cpus = {0, 1};
+    config.worker_cpus = {4, 5, 6};
+    std::vector<size_t> groups = {0, 0, 1, 1};
+    CpuPlacement placement = planCpuPlacement(config, 2, groups, {});
+
+    ASSERT_EQ(placement.reactors.size(), static_cast<size_t>(2));
+    ASSERT_TRUE(placement.reactors[0] == std::vector<int>({0}));
+    ASSERT_TRUE(placement.reactors[1] == std::vector<int>({1}));
+    ASSERT_EQ(placement.workers.size(), static_cast<size_t>(4));
+    ASSERT_TRUE(placement.workers[0] == std::vector<int>({4}));
+    ASSERT_TRUE(placement.workers[2] == std::vector<int>({6}));
+    ASSERT_TRUE(placement.workers[3] == std::vector<int>({4}));
+
+    // 未配置时不绑定
+    placement = planCpuPlacement(CpuAffinityConfig(), 2, groups, {});
+    ASSERT_TRUE(placement.reactors[0].empty());
+    ASSERT_TRUE(placement.workers[0].empty());
+    return true;
+}
+
+// 测试NUMA模式下工作线程与其服务的SubReactor在同一节点
+bool testPlanNumaAware() {
+    std::vector<std::vector<int>> nodes = {{0, 1, 2, 3}, {4, 5, 6, 7}};
+    CpuAffinityConfig config;
+    config.numa_aware = true;
+    config.reactor_cpus = {0, 4};
+    std::vector<size_t> groups = {0, 0, 1, 1};
+    CpuPlacement placement = planCpuPlacement(config, 2, groups, nodes);
+
+    ASSERT_TRUE(placement.reactors[1] == std::vector<int>({4}));
+    for (size_t w = 0; w < groups.size(); ++w) {
+        ASSERT_EQ(placement.workers[w].size(), static_cast<size_t>(1));
+        int cpu = placement.workers[w][0];
+        ASSERT_EQ(static_cast<size_t>(cpu / 4), groups[w]);
+    }
+
+    // 未指定SubReactor的CPU时轮流绑定到各节点
+    config.reactor_cpus.clear();
+    placement = planCpuPlacement(config, 2, groups, nodes);
+    ASSERT_TRUE(placement.reactors[0] == nodes[0]);
+    ASSERT_TRUE(placement.reactors[1] == nodes[1]);
+    ASSERT_GE(placement.workers[2][0], 4);
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 线程绑核功能测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("CPU列表解析", testParseCpuList);
+    runner.runTest("指定CPU列表绑核", testPlanExplicitCpus);
+    runner.runTest("NUMA感知绑核", testPlanNumaAware);
+
+    runner.printSummary();
+
+    return 0;
+}
@@ -2,10 +2,14 @@
 #include "dkv_core.hpp"
 #include "dkv_utils.hpp"
 #include "datatypes/dkv_datatype_bitmap.hpp"
+#include "datatypes/dkv_bitmap_kernels.hpp"
+#include "dkv_server.hpp"
+#include "dkv_logger.hpp"
 #include "test_runner.hpp"
 #include <iostream>
 #include <cassert>
 #include <chrono>
+#include <random>
 using namespace std;
 
 namespace dkv {
@@ -175,6 +179,347 @@ bool testBitmapCommands() {
     return true;
 }
 
+// 测试各SIMD实现与逐字节计算的结果一致，长度覆盖向量宽度的边界
+bool testBitmapKernels() {
+    mt19937_64 rng(42);
+    auto randomBytes = [&rng](size_t len) {
+        vector<uint8_t> bytes(len);
+        for (auto& byte : bytes) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        return bytes;
+    };
+    const vector<size_t> lengths = {0, 1, 7, 8, 31, 32, 33, 63, 64, 65, 127, 1000, 4099, 70000};
+    for (const BitmapKernels& kernels : supportedBitmapKernels()) {
+        for (size_t len : lengths) {
+            const vector<uint8_t> a = randomBytes(len), b = randomBytes(len), c = randomBytes(len);
+            size_t expected = 0;
+            for (uint8_t byte : a) {
+                expected += __builtin_popcount(byte);
+            }
+            ASSERT_EQ(kernels.popcount(a.data(), len), expected);
+            
+            const uint8_t* srcs[] = {a.data(), b.data(), c.data()};
+            vector<uint8_t> out(len);
+            kernels.combine(BitmapOp::AND, out.data(), srcs, 3, len);
+            for (size_t i = 0; i < len; ++i) {
+                ASSERT_EQ(out[i], static_cast<uint8_t>(a[i] & b[i] & c[i]));
+            }
+            kernels.combine(BitmapOp::OR, out.data(), srcs, 3, len);
+            for (size_t i = 0; i < len; ++i) {
+                ASSERT_EQ(out[i], static_cast<uint8_t>(a[i] | b[i] | c[i]));
+            }
+            kernels.combine(BitmapOp::XOR, out.data(), srcs, 3, len);
+            for (size_t i = 0; i < len; ++i) {
+                ASSERT_EQ(out[i], static_cast<uint8_t>(a[i] ^ b[i] ^ c[i]));
+            }
+            kernels.invert(out.data(), a.data(), len);
+            for (size_t i = 0; i < len; ++i) {
+                ASSERT_EQ(out[i], static_cast<uint8_t>(~a[i]));
+            }
+
+            // 只有一个字节不同，位置覆盖向量内和尾部
+            for (uint8_t skip : {uint8_t(0x00), uint8_t(0xff)}) {
+                vector<uint8_t> uniform(len, skip);
+                ASSERT_EQ(kernels.find(uniform.data(), len, skip), len);
+                for (size_t pos : {size_t(0), len / 2, len - 1}) {
+                    if (pos >= len) {
+                        continue;
+                    }
+                    uniform[pos] = static_cast<uint8_t>(skip ^ 0x10);
+                    ASSERT_EQ(kernels.find(uniform.data(), len, skip), pos);
+                    uniform[pos] = skip;
+                }
+            }
+        }
+    }
+    
+    // 长度不同的输入：较短的视为末尾补0
+    const vector<uint8_t> longest = randomBytes(300), middle = randomBytes(100), shortest = randomBytes(37);
+    const vector<const vector<uint8_t>*> srcs = {&middle, &shortest, &longest};
+    vector<uint8_t> out;
+    bitmapCombine(BitmapOp::AND, out, srcs);
+    ASSERT_EQ(out.size(), static_cast<size_t>(300));
+    for (size_t i = 0; i < out.size(); ++i) {
+        ASSERT_EQ(out[i], static_cast<uint8_t>(i < 37 ? longest[i] & middle[i] & shortest[i] : 0));
+    }
+    bitmapCombine(BitmapOp::XOR, out, srcs);
+    for (size_t i = 0; i < out.size(); ++i) {
+        uint8_t expected = longest[i];
+        if (i < 100) expected ^= middle[i];
+        if (i < 37) expected ^= shortest[i];
+        ASSERT_EQ(out[i], expected);
+    }
+    
+    // 目标位图也是输入之一
+    BitmapItem item;
+    item.setBit(3, true);
+    item.setBit(100, true);
+    BitmapItem other;
+    other.setBit(3, true);
+    ASSERT_TRUE(item.bitOpAnd({&item, &other}));
+    ASSERT_EQ(item.bitCount(), static_cast<size_t>(1));
+    ASSERT_EQ(item.size(), static_cast<size_t>(13));
+    ASSERT_EQ(item.bitCount(0, UINT64_MAX), static_cast<size_t>(1));
+    return true;
+}
+
+// 测试稀疏位图的Roaring压缩编码
+bool testBitmapSparse() {
+    // 只在很大的偏移上置位时不分配整块字节数组
+    BitmapItem item;
+    ASSERT_TRUE(item.setBit(4000000000ULL, true));
+    ASSERT_TRUE(item.isSparse());
+    ASSERT_EQ(item.size(), static_cast<size_t>(500000001));
+    ASSERT_TRUE(item.setBit(7, true));
+    ASSERT_TRUE(item.setBit(4000000001ULL, true));
+    ASSERT_FALSE(item.setBit(4000000001ULL, true));
+    ASSERT_TRUE(item.getBit(4000000000ULL));
+    ASSERT_FALSE(item.getBit(3999999999ULL));
+    ASSERT_FALSE(item.getBit(8000000000ULL));
+    ASSERT_EQ(item.bitCount(), static_cast<size_t>(3));
+    ASSERT_EQ(item.bitCount(0, 0), static_cast<size_t>(1));
+    ASSERT_EQ(item.bitCount(1, 499999999), static_cast<size_t>(0));
+    ASSERT_EQ(item.bitCount(500000000, UINT64_MAX), static_cast<size_t>(2));
+    ASSERT_TRUE(item.isSparse());
+
+    // 序列化保持稀疏编码
+    BitmapItem loaded;
+    loaded.deserialize(item.serialize());
+    ASSERT_TRUE(loaded.isSparse());
+    ASSERT_EQ(loaded.size(), item.size());
+    ASSERT_EQ(loaded.bitCount(), static_cast<size_t>(3));
+    ASSERT_TRUE(loaded.getBit(4000000001ULL));
+    BitmapItem copied(loaded);
+    ASSERT_TRUE(copied.isSparse());
+    ASSERT_TRUE(copied.getBit(7));
+
+    // 全部为稀疏输入的位运算
+    BitmapItem other;
+    other.setBit(4000000000ULL, true);
+    other.setBit(100000000ULL, true);
+    BitmapItem result;
+    ASSERT_TRUE(result.bitOpAnd({&item, &other}));
+    ASSERT_TRUE(result.isSparse());
+    ASSERT_EQ(result.bitCount(), static_cast<size_t>(1));
+    ASSERT_TRUE(result.bitOpOr({&item, &other}));
+    ASSERT_EQ(result.bitCount(), static_cast<size_t>(4));
+    ASSERT_TRUE(result.bitOpXor({&item, &other}));
+    ASSERT_EQ(result.bitCount(), static_cast<size_t>(3));
+    ASSERT_FALSE(result.getBit(4000000000ULL));
+    ASSERT_TRUE(result.bitOpNot(&other));
+    ASSERT_TRUE(result.isSparse());
+    ASSERT_EQ(result.bitCount(), static_cast<size_t>(4000000000ULL - 2 + 8));
+    ASSERT_FALSE(result.getBit(100000000ULL));
+    ASSERT_TRUE(result.getBit(4000000007ULL));
+
+    // 稀疏与稠密输入混合
+    BitmapItem dense;
+    dense.setBit(7, true);
+    dense.setBit(9, true);
+    ASSERT_FALSE(dense.isSparse());
+    BitmapItem small;
+    small.setBit(8 << 20, true);
+    small.setBit(7, true);
+    ASSERT_TRUE(small.isSparse());
+    ASSERT_TRUE(result.bitOpOr({&dense, &small}));
+    ASSERT_EQ(result.bitCount(), static_cast<size_t>(3));
+    ASSERT_EQ(result.size(), static_cast<size_t>((1 << 20) + 1));
+    ASSERT_TRUE(result.isSparse());
+
+    // 置位变密后转回稠密编码
+    BitmapItem growing;
+    growing.setBit(1 << 20, true);
+    ASSERT_TRUE(growing.isSparse());
+    for (uint64_t i = 0; i < (1 << 20); i += 3) {
+        growing.setBit(i, true);
+    }
+    ASSERT_FALSE(growing.isSparse());
+    ASSERT_EQ(growing.bitCount(), static_cast<size_t>((1 << 20) / 3 + 2));
+    ASSERT_TRUE(growing.getBit(1 << 20));
+
+    // 与稠密字节数组逐位对照
+    mt19937_64 rng(7);
+    for (int round = 0; round < 20; ++round) {
+        vector<uint8_t> bytes(300000);
+        const int density = round % 4;
+        for (auto& byte : bytes) {
+            byte = density == 0 ? (rng() % 1000 == 0 ? 1 : 0) : density == 1 ? static_cast<uint8_t>(rng()) : 0;
+        }
+        if (density == 2) {
+            std::fill(bytes.begin() + 1000, bytes.begin() + 200000, 0xff);
+        }
+        RoaringBitmap roaring = RoaringBitmap::fromDense(bytes);
+        ASSERT_EQ(roaring.memoryUsage(), RoaringBitmap::estimateMemory(bytes));
+        size_t expected = 0;
+        for (uint8_t byte : bytes) {
+            expected += __builtin_popcount(byte);
+        }
+        ASSERT_EQ(roaring.cardinality(), static_cast<uint64_t>(expected));
+        ASSERT_EQ(roaring.rangeCardinality(8000, 8000 + 8 * 70000),
+                  static_cast<uint64_t>(bitmapKernels().popcount(bytes.data() + 1000, 70000)));
+        for (int i = 0; i < 2000; ++i) {
+            const uint64_t pos = rng() % (bytes.size() * 8);
+            const bool value = rng() % 2;
+            const bool old = (bytes[pos / 8] >> (pos % 8)) & 1;
+            ASSERT_EQ(roaring.set(pos, value), old);
+            bytes[pos / 8] = value ? (bytes[pos / 8] | (1 << (pos % 8))) : (bytes[pos / 8] & ~(1 << (pos % 8)));
+        }
+        std::string payload;
+        roaring.serialize(payload);
+        RoaringBitmap restored;
+        ASSERT_TRUE(restored.deserialize(payload));
+        ASSERT_FALSE(restored.deserialize(payload.substr(0, payload.size() - 1)));
+        ASSERT_TRUE(restored.deserialize(payload));
+        vector<uint8_t> out(bytes.size(), 0);
+        restored.toDense(out);
+        ASSERT_TRUE(out == bytes);
+
+        const RoaringBitmap other_roaring = RoaringBitmap::fromDense(vector<uint8_t>(bytes.rbegin(), bytes.rend()));
+        const RoaringBitmap combined = RoaringBitmap::combine(BitmapOp::XOR, {&restored, &other_roaring});
+        std::fill(out.begin(), out.end(), 0);
+        combined.toDense(out);
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            ASSERT_EQ(out[i], static_cast<uint8_t>(bytes[i] ^ bytes[bytes.size() - 1 - i]));
+        }
+        const RoaringBitmap inverted = RoaringBitmap::invert(restored, bytes.size() * 8 - 3);
+        ASSERT_EQ(inverted.cardinality(), static_cast<uint64_t>(bytes.size() * 8 - 3 - restored.rangeCardinality(0, bytes.size() * 8 - 3)));
+    }
+    return true;
+}
+
+// 测试BITPOS和BITFIELD
+bool testBitmapPosAndField() {
+    for (bool sparse : {false, true}) {
+        BitmapItem item;
+        const uint64_t base = sparse ? 8000000 : 0;
+        if (sparse) {
+            item.setBit(base + 7999, true);
+            item.setBit(base + 7999, false);
+            ASSERT_TRUE(item.isSparse());
+        }
+        // 找置位
+        ASSERT_EQ(item.bitPos(true), -1);
+        item.setBit(base + 300, true);
+        ASSERT_EQ(item.bitPos(true), static_cast<int64_t>(base + 300));
+        ASSERT_EQ(item.bitPos(true, base / 8 + 38), -1);
+        ASSERT_EQ(item.bitPos(true, 0, base / 8 + 36), -1);
+        ASSERT_EQ(item.bitPos(true, 0, base / 8 + 37), static_cast<int64_t>(base + 300));
+        // 找清零位：全部置位且没有end时返回末尾之后的位
+        BitmapItem ones;
+        for (uint64_t i = 0; i < 24; ++i) {
+            ones.setBit(base + i, true);
+        }
+        ASSERT_EQ(ones.bitPos(false, base / 8), static_cast<int64_t>(base + 24));
+        ASSERT_EQ(ones.bitPos(false, base / 8, base / 8 + 2), -1);
+        ones.setBit(base + 13, false);
+        ASSERT_EQ(ones.bitPos(false, base / 8), static_cast<int64_t>(base + 13));
+        ASSERT_EQ(ones.bitPos(false), sparse ? 0 : 13);
+        ASSERT_EQ(item.bitPos(false), 0);
+        ASSERT_EQ(item.isSparse(), sparse);
+    }
+    BitmapItem empty;
+    ASSERT_EQ(empty.bitPos(true), -1);
+    ASSERT_EQ(empty.bitPos(false), 0);
+
+    // 跨越多个字和整块置位的稀疏位图
+    BitmapItem runs;
+    runs.setBit(1 << 24, true);
+    ASSERT_TRUE(runs.isSparse());
+    BitmapItem full;
+    ASSERT_TRUE(full.bitOpNot(&runs));
+    ASSERT_TRUE(full.isSparse());
+    ASSERT_EQ(full.bitPos(false), static_cast<int64_t>(1 << 24));
+    ASSERT_EQ(full.bitPos(true, (1 << 21)), static_cast<int64_t>((1 << 24) + 1));
+
+    // BITFIELD
+    BitmapItem counters;
+    auto op = [](BitFieldOp::Type type, const char* kind, uint64_t offset, int64_t value = 0,
+                 BitFieldOp::Overflow overflow = BitFieldOp::Overflow::WRAP) {
+        BitFieldOp result;
+        result.type = type;
+        result.is_signed = kind[0] == 'i';
+        result.bits = static_cast<uint32_t>(atoi(kind + 1));
+        result.offset = offset;
+        result.value = value;
+        result.overflow = overflow;
+        return result;
+    };
+    using T = BitFieldOp::Type;
+    using O = BitFieldOp::Overflow;
+    auto results = counters.bitField({op(T::SET, "u8", 0, 200), op(T::GET, "u8", 0), op(T::INCRBY, "u8", 0, 100),
+                                      op(T::INCRBY, "u8", 0, 250, O::SAT), op(T::INCRBY, "u8", 0, 1, O::FAIL),
+                                      op(T::GET, "i8", 0), op(T::SET, "i5", 8, -3), op(T::GET, "i5", 8),
+                                      op(T::INCRBY, "i5", 8, -20, O::SAT), op(T::GET, "u4", 0)});
+    ASSERT_EQ(results.size(), static_cast<size_t>(10));
+    ASSERT_EQ(*results[0], 0);
+    ASSERT_EQ(*results[1], 200);
+    ASSERT_EQ(*results[2], 44);
+    ASSERT_EQ(*results[3], 255);
+    ASSERT_FALSE(results[4].has_value());
+    ASSERT_EQ(*results[5], -1);
+    ASSERT_EQ(*results[6], 0);
+    ASSERT_EQ(*results[7], -3);
+    ASSERT_EQ(*results[8], -16);
+    ASSERT_EQ(*results[9], 15);
+    // 最高位在offset处
+    ASSERT_TRUE(counters.getBit(8));
+    ASSERT_EQ(counters.size(), static_cast<size_t>(2));
+    results = counters.bitField({op(T::SET, "i64", 64, INT64_MIN), op(T::INCRBY, "i64", 64, -1),
+                                 op(T::SET, "u63", 200, INT64_MAX), op(T::GET, "u63", 200)});
+    ASSERT_EQ(*results[1], INT64_MAX);
+    ASSERT_EQ(*results[3], INT64_MAX);
+
+    // 存储引擎：不存在的键和只读子命令
+    StorageEngine storage;
+    ASSERT_EQ(storage.bitPos(NO_TX, "missing", true, 0, nullopt), -1);
+    ASSERT_EQ(storage.bitPos(NO_TX, "missing", false, 0, nullopt), 0);
+    results = storage.bitField(NO_TX, "missing", {op(T::GET, "u8", 0)});
+    ASSERT_EQ(*results[0], 0);
+    ASSERT_FALSE(storage.exists(NO_TX, "missing"));
+    results = storage.bitField(NO_TX, "counters", {op(T::INCRBY, "u16", 16 * 5, 7), op(T::INCRBY, "u16", 16 * 5, 7)});
+    ASSERT_EQ(*results[1], 14);
+    ASSERT_EQ(storage.bitPos(NO_TX, "counters", true, 0, nullopt), static_cast<int64_t>(16 * 5 + 12));
+    storage.set(NO_TX, "string", "value");
+    ASSERT_TRUE(storage.bitField(NO_TX, "string", {op(T::GET, "u8", 0)}).empty());
+    return true;
+}
+
+// 测试位偏移的解析：负数、非整数和超过512MB的偏移都报错
+bool testBitOffsetCommands() {
+    DKVServer server(6422);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    if (!server.start()) {
+        return false;
+    }
+    const std::string max_offset = std::to_string(BitmapItem::MAX_BIT_OFFSET);
+    const std::string too_large = std::to_string(BitmapItem::MAX_BIT_OFFSET + 1);
+    Response negative_get = server.executeCommand(Command(CommandType::BITFIELD, {"bf", "GET", "i8", "-1"}), NO_TX);
+    Response negative_index = server.executeCommand(Command(CommandType::BITFIELD, {"bf", "SET", "u8", "#-1", "1"}), NO_TX);
+    Response large_incr = server.executeCommand(Command(CommandType::BITFIELD, {"bf", "INCRBY", "u8", too_large, "1"}), NO_TX);
+    Response large_index = server.executeCommand(Command(CommandType::BITFIELD, {"bf", "GET", "u8", "#" + max_offset}), NO_TX);
+    Response not_integer = server.executeCommand(Command(CommandType::BITFIELD, {"bf", "GET", "u8", "1x"}), NO_TX);
+    Response valid = server.executeCommand(Command(CommandType::BITFIELD, {"bf", "SET", "u8", "#1", "200", "GET", "u8", "8"}), NO_TX);
+    Response setbit_negative = server.executeCommand(Command(CommandType::SETBIT, {"sb", "-1", "1"}), NO_TX);
+    Response setbit_large = server.executeCommand(Command(CommandType::SETBIT, {"sb", too_large, "1"}), NO_TX);
+    Response getbit_large = server.executeCommand(Command(CommandType::GETBIT, {"sb", too_large}), NO_TX);
+    Response getbit_max = server.executeCommand(Command(CommandType::GETBIT, {"sb", max_offset}), NO_TX);
+    server.stop();
+
+    ASSERT_TRUE(negative_get.status == ResponseStatus::ERROR);
+    ASSERT_TRUE(negative_index.status == ResponseStatus::ERROR);
+    ASSERT_TRUE(large_incr.status == ResponseStatus::ERROR);
+    ASSERT_TRUE(large_index.status == ResponseStatus::ERROR);
+    ASSERT_TRUE(not_integer.status == ResponseStatus::ERROR);
+    ASSERT_TRUE(valid.elements == std::vector<std::string>({"0", "200"}));
+    ASSERT_TRUE(setbit_negative.status == ResponseStatus::ERROR);
+    ASSERT_TRUE(setbit_large.status == ResponseStatus::ERROR);
+    ASSERT_TRUE(getbit_large.status == ResponseStatus::ERROR);
+    ASSERT_EQ(getbit_max.data, std::string("0"));
+    return true;
+}
+
 } // namespace dkv
 
 int main() {
@@ -182,10 +527,15 @@ int main() {
     
     cout << "DKV Bitmap功能测试\n" << endl;
     
+    Logger::getInstance().setConsoleOutput(false);
     TestRunner runner;
     
     runner.runTest("BitmapItem基本功能", testBitmapItem);
     runner.runTest("Bitmap命令测试", testBitmapCommands);
+    runner.runTest("Bitmap SIMD实现", testBitmapKernels);
+    runner.runTest("Bitmap稀疏编码", testBitmapSparse);
+    runner.runTest("BITPOS和BITFIELD", testBitmapPosAndField);
+    runner.runTest("位偏移参数检查", testBitOffsetCommands);
     
     runner.printSummary();
     
@@ -0,0 +1,188 @@
+#include "storage/dkv_storage.hpp"
+#include "datatypes/dkv_datatype_bloom.hpp"
+#include "dkv_server.hpp"
+#include "dkv_logger.hpp"
+#include "test_runner.hpp"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace dkv {
+
+// 测试添加与查询：已添加的元素一定存在，重复添加返回已存在
+bool testBloomBasic() {
+    BloomFilterItem bloom;
+    ASSERT_EQ(bloom.add("apple"), static_cast<int>(BloomFilterItem::ADD_ADDED));
+    ASSERT_EQ(bloom.add("apple"), static_cast<int>(BloomFilterItem::ADD_EXISTS));
+    ASSERT_TRUE(bloom.exists("apple"));
+    ASSERT_FALSE(bloom.exists("banana"));
+    ASSERT_EQ(bloom.count(), static_cast<uint64_t>(1));
+    return true;
+}
+
+// 测试误判率与空间：1%误判率下每个元素约1.2字节，超出容量后扩展层数，已添加的元素不丢失
+bool testBloomFalsePositiveRate() {
+    const uint64_t capacity = 10000;
+    BloomFilterItem bloom(0.01, capacity, 2);
+    for (uint64_t i = 0; i < capacity; ++i) {
+        bloom.add("member" + std::to_string(i));
+    }
+    ASSERT_EQ(bloom.layerCount(), static_cast<size_t>(1));
+    ASSERT_TRUE(bloom.bytes() < capacity * 13 / 10);
+
+    int false_positives = 0;
+    const int probes = 100000;
+    for (int i = 0; i < probes; ++i) {
+        if (bloom.exists("absent" + std::to_string(i))) {
+            false_positives++;
+        }
+    }
+    ASSERT_TRUE(false_positives < probes * 2 / 100);
+
+    for (uint64_t i = capacity; i < capacity * 4; ++i) {
+        bloom.add("member" + std::to_string(i));
+    }
+    ASSERT_TRUE(bloom.layerCount() > 1);
+    for (uint64_t i = 0; i < capacity * 4; ++i) {
+        ASSERT_TRUE(bloom.exists("member" + std::to_string(i)));
+    }
+    return true;
+}
+
+// 测试不扩展的过滤器满后拒绝插入
+bool testBloomNonScaling() {
+    BloomFilterItem bloom(0.01, 10, 0);
+    int added = 0;
+    int full = 0;
+    for (int i = 0; i < 100; ++i) {
+        int result = bloom.add("item" + std::to_string(i));
+        added += result == BloomFilterItem::ADD_ADDED;
+        full += result == BloomFilterItem::ADD_FULL;
+    }
+    ASSERT_EQ(added, 10);
+    ASSERT_TRUE(full > 0);
+    ASSERT_EQ(bloom.layerCount(), static_cast<size_t>(1));
+    return true;
+}
+
+// 测试批量添加与查询和逐个操作结果相同
+bool testBloomBatch() {
+    std::vector<Value> elements;
+    for (int i = 0; i < 1000; ++i) {
+        elements.push_back("event" + std::to_string(i % 700));
+    }
+    BloomFilterItem single(0.01, 100, 2);
+    BloomFilterItem batch(0.01, 100, 2);
+    std::vector<int> single_results;
+    for (const auto& element : elements) {
+        single_results.push_back(single.add(element));
+    }
+    std::vector<int> batch_results;
+    batch.add(elements.data(), elements.size(), batch_results);
+    ASSERT_TRUE(batch_results == single_results);
+    ASSERT_EQ(batch.serialize(), single.serialize());
+
+    std::vector<Value> probes = {"event1", "event699", "missing1", "missing2"};
+    std::vector<bool> exists;
+    batch.exists(probes.data(), probes.size(), exists);
+    for (size_t i = 0; i < probes.size(); ++i) {
+        ASSERT_EQ(exists[i], single.exists(probes[i]));
+    }
+    ASSERT_TRUE(exists[0]);
+    ASSERT_TRUE(exists[1]);
+    return true;
+}
+
+// 测试序列化往返与RDB持久化
+bool testBloomPersistence() {
+    BloomFilterItem bloom(0.001, 50, 4);
+    for (int i = 0; i < 300; ++i) {
+        bloom.add("key" + std::to_string(i));
+    }
+    BloomFilterItem restored;
+    restored.deserialize(bloom.serialize());
+    ASSERT_EQ(restored.count(), bloom.count());
+    ASSERT_EQ(restored.layerCount(), bloom.layerCount());
+    ASSERT_EQ(restored.expansion(), static_cast<uint32_t>(4));
+    ASSERT_EQ(restored.serialize(), bloom.serialize());
+
+    const std::string filename = "test_bloom.rdb";
+    {
+        StorageEngine storage;
+        std::vector<Value> elements = {"a", "b", "c"};
+        std::vector<int> results;
+        ASSERT_TRUE(storage.bfadd(NO_TX, "bf", elements.data(), elements.size(), results));
+        ASSERT_TRUE(storage.saveRDB(filename));
+    }
+    StorageEngine loaded;
+    ASSERT_TRUE(loaded.loadRDB(filename));
+    std::remove(filename.c_str());
+    std::vector<Value> probes = {"a", "c", "z"};
+    std::vector<bool> exists;
+    ASSERT_TRUE(loaded.bfexists(NO_TX, "bf", probes.data(), probes.size(), exists));
+    ASSERT_TRUE(exists[0]);
+    ASSERT_TRUE(exists[1]);
+    ASSERT_EQ(loaded.bfcard(NO_TX, "bf"), static_cast<uint64_t>(3));
+    return true;
+}
+
+// 测试BF.*命令
+bool testBloomCommands() {
+    DKVServer server(6408);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    if (!server.start()) {
+        return false;
+    }
+    Response reserve = server.executeCommand(Command(CommandType::BF_RESERVE, {"bf", "0.01", "1000", "NONSCALING"}), NO_TX);
+    Response duplicate = server.executeCommand(Command(CommandType::BF_RESERVE, {"bf", "0.01", "1000"}), NO_TX);
+    Response bad_rate = server.executeCommand(Command(CommandType::BF_RESERVE, {"bf2", "1.5", "1000"}), NO_TX);
+    Response add = server.executeCommand(Command(CommandType::BF_ADD, {"bf", "x"}), NO_TX);
+    Response add_again = server.executeCommand(Command(CommandType::BF_ADD, {"bf", "x"}), NO_TX);
+    Response madd = server.executeCommand(Command(CommandType::BF_MADD, {"bf", "x", "y", "z"}), NO_TX);
+    Response exists = server.executeCommand(Command(CommandType::BF_EXISTS, {"bf", "y"}), NO_TX);
+    Response mexists = server.executeCommand(Command(CommandType::BF_MEXISTS, {"bf", "z", "w"}), NO_TX);
+    Response card = server.executeCommand(Command(CommandType::BF_CARD, {"bf"}), NO_TX);
+    Response auto_created = server.executeCommand(Command(CommandType::BF_ADD, {"bf_auto", "x"}), NO_TX);
+    server.executeCommand(Command(CommandType::SET, {"str", "v"}), NO_TX);
+    Response wrong_type = server.executeCommand(Command(CommandType::BF_ADD, {"str", "x"}), NO_TX);
+    server.stop();
+
+    ASSERT_TRUE(reserve.status == ResponseStatus::OK);
+    ASSERT_TRUE(duplicate.status == ResponseStatus::ERROR);
+    ASSERT_TRUE(bad_rate.status == ResponseStatus::ERROR);
+    ASSERT_EQ(add.data, std::string("1"));
+    ASSERT_EQ(add_again.data, std::string("0"));
+    ASSERT_TRUE(madd.elements == std::vector<std::string>({"0", "1", "1"}));
+    ASSERT_EQ(exists.data, std::string("1"));
+    ASSERT_EQ(mexists.elements.size(), static_cast<size_t>(2));
+    ASSERT_EQ(mexists.elements[0], std::string("1"));
+    ASSERT_EQ(card.data, std::string("3"));
+    ASSERT_EQ(auto_created.data, std::string("1"));
+    ASSERT_TRUE(wrong_type.status == ResponseStatus::ERROR);
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 布隆过滤器测试\n" << std::endl;
+
+    Logger::getInstance().setConsoleOutput(false);
+    TestRunner runner;
+
+    runner.runTest("添加与查询", testBloomBasic);
+    runner.runTest("误判率与扩展", testBloomFalsePositiveRate);
+    runner.runTest("不扩展的过滤器", testBloomNonScaling);
+    runner.runTest("批量添加与查询", testBloomBatch);
+    runner.runTest("序列化与RDB持久化", testBloomPersistence);
+    runner.runTest("BF命令", testBloomCommands);
+
+    Logger::getInstance().setConsoleOutput(true);
+    runner.printSummary();
+
+    return 0;
+}
@@ -84,6 +84,94 @@ bool testHyperLogLogExpiration() {
         return true;
 }
 
+bool testHyperLogLogEncoding() {
+    // 少量元素使用稀疏编码
+    dkv::HyperLogLogItem small;
+    for (int i = 0; i < 100; ++i) {
+        small.add("small" + std::to_string(i));
+    }
+    ASSERT_TRUE(small.isSparse());
+    const uint64_t small_count = small.count();
+    ASSERT_TRUE(small_count >= 95 && small_count <= 105);
+    std::string serialized = small.serialize();
+    ASSERT_TRUE(serialized.size() < 1000);
+    dkv::HyperLogLogItem small_loaded;
+    small_loaded.deserialize(serialized);
+    ASSERT_TRUE(small_loaded.isSparse());
+    ASSERT_TRUE(small_loaded.count() == small_count);
+
+    // 非零寄存器增多后转为6位紧凑的稠密编码，估计值与转换前的算法一致
+    dkv::HyperLogLogItem large;
+    std::vector<std::string> elements;
+    for (int i = 0; i < 20000; ++i) {
+        elements.push_back("large" + std::to_string(i));
+        large.add(elements.back());
+    }
+    ASSERT_TRUE(!large.isSparse());
+    serialized = large.serialize();
+    ASSERT_TRUE(serialized.size() == std::string("HLLDENSE:").size() + dkv::HyperLogLogItem::kDenseBytes);
+    dkv::HyperLogLogItem large_loaded;
+    large_loaded.deserialize(serialized);
+    ASSERT_TRUE(!large_loaded.isSparse());
+    ASSERT_TRUE(large_loaded.count() == large.count());
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(!large_loaded.add(elements[i]));
+    }
+
+    // 早期版本每个寄存器一个字节的格式
+    std::string legacy = "HYPERLOGLOG:" + std::string(dkv::HyperLogLogItem::kRegisterCount, '\0');
+    legacy[std::string("HYPERLOGLOG:").size() + 5] = 3;
+    dkv::HyperLogLogItem legacy_loaded;
+    legacy_loaded.deserialize(legacy);
+    ASSERT_TRUE(legacy_loaded.isSparse());
+    ASSERT_TRUE(legacy_loaded.count() == 1);
+
+    // 并集计数与合并后的计数一致，不修改输入
+    const uint64_t union_count = dkv::HyperLogLogItem::countUnion({&small, &large});
+    dkv::HyperLogLogItem merged;
+    ASSERT_TRUE(merged.merge({&small, &large}));
+    ASSERT_TRUE(!merged.isSparse());
+    ASSERT_TRUE(merged.count() == union_count);
+    ASSERT_TRUE(small.isSparse() && small.count() == small_count);
+    dkv::HyperLogLogItem sparse_merged;
+    ASSERT_TRUE(sparse_merged.merge({&small, &small_loaded}));
+    ASSERT_TRUE(sparse_merged.isSparse());
+    ASSERT_TRUE(sparse_merged.count() == small_count);
+    ASSERT_TRUE(!sparse_merged.merge({&small}));
+
+    // 多个键的PFCOUNT返回并集的基数
+    dkv::StorageEngine storage;
+    storage.pfadd(dkv::NO_TX, "a", {"x", "y", "z"});
+    storage.pfadd(dkv::NO_TX, "b", {"y", "z", "w"});
+    ASSERT_TRUE(storage.pfcount(dkv::NO_TX, std::vector<dkv::Key>{"a", "b", "missing"}) == 4);
+    ASSERT_TRUE(storage.pfcount(dkv::NO_TX, std::vector<dkv::Key>{"missing"}) == 0);
+    
+    std::cout << "HyperLogLog编码测试通过" << std::endl;
+    return true;
+}
+
+bool testHyperLogLogBatchAdd() {
+    // 批量添加与逐个添加得到相同的寄存器，覆盖稀疏编码、转换和稠密编码
+    for (size_t total : {10, 700, 751, 5000, 50000}) {
+        std::vector<dkv::Value> elements;
+        for (size_t i = 0; i < total; ++i) {
+            elements.push_back("event" + std::to_string(i % (total / 2 + 1)));
+        }
+        dkv::HyperLogLogItem single, batch;
+        bool single_modified = false;
+        for (const auto& element : elements) {
+            single_modified = single.add(element) || single_modified;
+        }
+        ASSERT_EQ(batch.add(elements.data(), elements.size()), single_modified);
+        ASSERT_EQ(batch.isSparse(), single.isSparse());
+        ASSERT_EQ(batch.serialize(), single.serialize());
+        ASSERT_EQ(batch.count(), single.count());
+        // 重复添加不修改
+        ASSERT_FALSE(batch.add(elements.data(), elements.size()));
+    }
+    return true;
+}
+
 int main() {
     dkv::TestRunner runner;
     
@@ -92,6 +180,8 @@ int main() {
     runner.runTest("HyperLogLog基础功能测试", testHyperLogLogBasic);
     runner.runTest("HyperLogLog大数据量测试", testHyperLogLogLargeData);
     runner.runTest("HyperLogLog过期测试", testHyperLogLogExpiration);
+    runner.runTest("HyperLogLog编码测试", testHyperLogLogEncoding);
+    runner.runTest("HyperLogLog批量添加测试", testHyperLogLogBatchAdd);
     
     runner.printSummary();
     return 0;
@@ -2,10 +2,21 @@
 #include "dkv_core.hpp"
 #include "dkv_utils.hpp"
 #include "datatypes/dkv_datatype_list.hpp"
+#include "datatypes/dkv_quicklist.hpp"
+#include "dkv_lzf.hpp"
+#include "dkv_server.hpp"
 #include "test_runner.hpp"
 #include <iostream>
 #include <cassert>
 #include <chrono>
+#include <deque>
+#include <random>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
 
 namespace dkv {
 
@@ -114,6 +125,285 @@ bool testListCommands() {
     return true;
 }
 
+// 测试快速列表与deque在随机操作下结果一致，包括跨节点的范围和下标访问
+bool testQuickListRandomOps() {
+    ListpackConfig saved = listpackConfig();
+    for (size_t depth : {0, 1, 2}) {
+        listpackConfig().list_max_bytes = 256;
+        listpackConfig().list_compress_depth = depth;
+        QuickList list;
+        std::deque<Value> reference;
+        std::mt19937 rng(static_cast<unsigned>(42 + depth));
+        for (int i = 0; i < 20000; ++i) {
+            Value value(rng() % 40, static_cast<char>('a' + i % 3));
+            switch (rng() % 6) {
+                case 0:
+                case 1:
+                    list.pushFront(value);
+                    reference.push_front(value);
+                    break;
+                case 2:
+                case 3:
+                    list.pushBack(value);
+                    reference.push_back(value);
+                    break;
+                case 4: {
+                    Value popped;
+                    bool front = rng() % 2 == 0;
+                    bool ok = front ? list.popFront(popped) : list.popBack(popped);
+                    if (!reference.empty()) {
+                        ASSERT_TRUE(ok);
+                        ASSERT_EQ(popped, front ? reference.front() : reference.back());
+                        if (front) {
+                            reference.pop_front();
+                        } else {
+                            reference.pop_back();
+                        }
+                    } else {
+                        ASSERT_FALSE(ok);
+                    }
+                    break;
+                }
+                default:
+                    if (!reference.empty()) {
+                        int64_t index = static_cast<int64_t>(rng() % reference.size());
+                        ASSERT_TRUE(list.set(index - static_cast<int64_t>(reference.size()), value));
+                        reference[static_cast<size_t>(index)] = value;
+                    }
+                    break;
+            }
+            ASSERT_EQ(list.size(), reference.size());
+        }
+
+        Value value;
+        for (size_t i = 0; i < reference.size(); i += 7) {
+            ASSERT_TRUE(list.index(static_cast<int64_t>(i), value));
+            ASSERT_EQ(value, reference[i]);
+        }
+        ASSERT_FALSE(list.index(static_cast<int64_t>(reference.size()), value));
+        size_t start = reference.size() / 3;
+        auto values = list.range(start, reference.size() + 10);
+        ASSERT_EQ(values.size(), reference.size() - start);
+        for (size_t i = 0; i < values.size(); ++i) {
+            ASSERT_EQ(values[i], reference[start + i]);
+        }
+        ASSERT_GT(list.nodeCount(), static_cast<size_t>(1));
+        if (depth == 0) {
+            ASSERT_EQ(list.compressedNodeCount(), static_cast<size_t>(0));
+        } else if (list.nodeCount() > 2 * depth) {
+            ASSERT_GT(list.compressedNodeCount(), static_cast<size_t>(0));
+            ASSERT_LE(list.compressedNodeCount(), list.nodeCount() - 2 * depth);
+        }
+    }
+    listpackConfig() = saved;
+    return true;
+}
+
+// 测试LZF压缩与解压
+bool testLzfRoundTrip() {
+    std::string input;
+    for (int i = 0; i < 2000; ++i) {
+        input += "element:" + std::to_string(i % 50) + ";";
+    }
+    std::string compressed(input.size(), '\0');
+    size_t len = lzf::compress(input.data(), input.size(), &compressed[0], compressed.size());
+    ASSERT_GT(len, static_cast<size_t>(0));
+    ASSERT_LT(len, input.size() / 4);
+    std::string output(input.size(), '\0');
+    ASSERT_EQ(lzf::decompress(compressed.data(), len, &output[0], output.size()), input.size());
+    ASSERT_EQ(output, input);
+
+    // 随机数据无法压缩时返回0
+    std::mt19937 rng(7);
+    std::string noise(1024, '\0');
+    for (auto& c : noise) {
+        c = static_cast<char>(rng());
+    }
+    std::string small(noise.size() - 8, '\0');
+    ASSERT_EQ(lzf::compress(noise.data(), noise.size(), &small[0], small.size()), static_cast<size_t>(0));
+    // 输出空间不足时解压失败
+    ASSERT_EQ(lzf::decompress(compressed.data(), len, &output[0], 10), static_cast<size_t>(0));
+    return true;
+}
+
+// 测试LINDEX和LSET
+bool testListIndexCommands() {
+    StorageEngine storage;
+    for (int i = 0; i < 1000; ++i) {
+        storage.rpush(NO_TX, "list", std::to_string(i));
+    }
+    Value value;
+    ASSERT_TRUE(storage.lindex(NO_TX, "list", 0, value));
+    ASSERT_EQ(value, std::string("0"));
+    ASSERT_TRUE(storage.lindex(NO_TX, "list", -1, value));
+    ASSERT_EQ(value, std::string("999"));
+    ASSERT_TRUE(storage.lindex(NO_TX, "list", 500, value));
+    ASSERT_EQ(value, std::string("500"));
+    ASSERT_FALSE(storage.lindex(NO_TX, "list", 1000, value));
+    ASSERT_FALSE(storage.lindex(NO_TX, "missing", 0, value));
+
+    ASSERT_TRUE(storage.lset(NO_TX, "list", 500, "changed"));
+    ASSERT_TRUE(storage.lindex(NO_TX, "list", 500, value));
+    ASSERT_EQ(value, std::string("changed"));
+    ASSERT_TRUE(storage.lset(NO_TX, "list", -1000, "first"));
+    ASSERT_EQ(storage.lrange(NO_TX, "list", 0, 0)[0], std::string("first"));
+    ASSERT_FALSE(storage.lset(NO_TX, "list", -1001, "x"));
+    ASSERT_FALSE(storage.lset(NO_TX, "missing", 0, "x"));
+    ASSERT_EQ(storage.llen(NO_TX, "list"), static_cast<size_t>(1000));
+    return true;
+}
+
+// 测试LMOVE：两个键在同一批锁内修改
+bool testListMove() {
+    StorageEngine storage;
+    for (const char* value : {"a", "b", "c"}) {
+        storage.rpush(NO_TX, "src", value);
+    }
+    ASSERT_EQ(storage.lmove(NO_TX, "src", "dst", true, false), std::string("a"));
+    ASSERT_EQ(storage.llen(NO_TX, "src"), static_cast<size_t>(2));
+    ASSERT_EQ(storage.lrange(NO_TX, "dst", 0, 0)[0], std::string("a"));
+    // 源和目标相同时旋转列表
+    ASSERT_EQ(storage.lmove(NO_TX, "src", "src", false, true), std::string("c"));
+    ASSERT_TRUE(storage.lrange(NO_TX, "src", 0, 1) == std::vector<Value>({"c", "b"}));
+    // 目标不是列表时不弹出元素
+    storage.set(NO_TX, "str", "value");
+    ASSERT_EQ(storage.lmove(NO_TX, "src", "str", true, true), std::string(""));
+    ASSERT_EQ(storage.llen(NO_TX, "src"), static_cast<size_t>(2));
+    ASSERT_EQ(storage.lmove(NO_TX, "missing", "dst", true, true), std::string(""));
+    return true;
+}
+
+namespace {
+
+// 连接测试服务器的客户端，接收超时为timeout_ms
+int connectClient(int port, int timeout_ms) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    struct timeval tv{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return sock;
+}
+
+void sendRaw(int sock, const std::string& command) {
+    ssize_t ignored = send(sock, command.data(), command.size(), 0);
+    (void)ignored;
+}
+
+// 读取到期望的长度为止，超时返回已读到的内容
+std::string recvReply(int sock, size_t expected) {
+    std::string reply;
+    char buffer[1024];
+    while (reply.size() < expected) {
+        ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        reply.append(buffer, n);
+    }
+    return reply;
+}
+
+// 发送命令并检查回复是否与期望一致
+bool request(int sock, const std::string& command, const std::string& expected) {
+    sendRaw(sock, command);
+    return recvReply(sock, expected.size()) == expected;
+}
+
+} // namespace
+
+// 测试阻塞弹出：等待不占用工作线程，推入时按登记顺序唤醒，超时回复空值，断开连接的等待者不取走元素
+bool testBlockingPop(IoBackend backend, int port) {
+    // 只有一个工作线程，阻塞的命令若占用它，其他客户端的命令将无法执行
+    DKVServer server(port, 1, 1);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    server.setIoBackend(backend);
+    if (!server.start()) {
+        std::cout << "无法启动测试服务器" << std::endl;
+        return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    int first = connectClient(port, 2000);
+    int second = connectClient(port, 2000);
+    int pusher = connectClient(port, 2000);
+    ASSERT_TRUE(first >= 0 && second >= 0 && pusher >= 0);
+
+    auto bulk = [](const std::string& value) {
+        return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    };
+    // 数组回复按惯例编码后放在批量字符串中
+    auto popped = [&](const std::string& key, const std::string& value) {
+        return bulk("*2\r\n" + bulk(key) + bulk(value));
+    };
+    auto expect = [](int sock, const std::string& expected) {
+        return recvReply(sock, expected.size()) == expected;
+    };
+    const std::string nil = "$-1\r\n";
+
+    // 列表非空时立即返回
+    ASSERT_TRUE(request(pusher, "RPUSH bq_ready x\r\n", bulk("1")));
+    sendRaw(first, "BLPOP bq_empty bq_ready 0\r\n");
+    ASSERT_TRUE(expect(first, popped("bq_ready", "x")));
+
+    // 两个客户端依次阻塞，阻塞期间其他客户端照常执行命令；之后的命令排在阻塞命令之后回复
+    sendRaw(first, "BLPOP bq_other bq_fifo 0\r\nGET bq_missing\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sendRaw(second, "BRPOP bq_fifo 0\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(request(pusher, "SET bq_string v\r\n", "+OK\r\n"));
+    ASSERT_TRUE(request(pusher, "RPUSH bq_fifo 1 2\r\n", bulk("2")));
+    ASSERT_TRUE(expect(first, popped("bq_fifo", "1") + nil));
+    ASSERT_TRUE(expect(second, popped("bq_fifo", "2")));
+
+    // 超时由SubReactor的定时器触发
+    auto start = std::chrono::steady_clock::now();
+    sendRaw(first, "BRPOP bq_timeout 0.2\r\n");
+    ASSERT_TRUE(expect(first, nil));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    ASSERT_TRUE(elapsed >= std::chrono::milliseconds(190) && elapsed < std::chrono::milliseconds(1000));
+
+    // BLMOVE唤醒后推入目标键
+    sendRaw(first, "BLMOVE bq_src bq_dst RIGHT LEFT 0\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(request(pusher, "LPUSH bq_src m\r\n", bulk("1")));
+    ASSERT_TRUE(expect(first, bulk("m")));
+    ASSERT_TRUE(request(pusher, "LLEN bq_dst\r\n", bulk("1")));
+
+    // 事务中推入的元素提交后才唤醒
+    sendRaw(first, "BLPOP bq_tx 0\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sendRaw(pusher, "MULTI\r\n");
+    ASSERT_TRUE(recvReply(pusher, 1)[0] == '+');
+    ASSERT_TRUE(request(pusher, "RPUSH bq_tx t\r\n", bulk("1")));
+    char byte;
+    ASSERT_TRUE(recv(first, &byte, 1, MSG_DONTWAIT) < 0);
+    ASSERT_TRUE(request(pusher, "EXEC\r\n", "+OK\r\n"));
+    ASSERT_TRUE(expect(first, popped("bq_tx", "t")));
+
+    // 断开连接的等待者被取消，推入的元素留在列表中
+    sendRaw(second, "BLPOP bq_closed 0\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    close(second);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(request(pusher, "RPUSH bq_closed c\r\n", bulk("1")));
+    ASSERT_TRUE(request(pusher, "LLEN bq_closed\r\n", bulk("1")));
+
+    sendRaw(first, "BLPOP bq_fifo -1\r\n");
+    ASSERT_TRUE(recvReply(first, 1)[0] == '-');
+
+    close(first);
+    close(pusher);
+    server.stop();
+    return true;
+}
+
 } // namespace dkv
 
 int main() {
@@ -125,6 +415,12 @@ int main() {
     
     runner.runTest("ListItem基本功能", testListItem);
     runner.runTest("List命令测试", testListCommands);
+    runner.runTest("快速列表随机操作", testQuickListRandomOps);
+    runner.runTest("LZF压缩解压", testLzfRoundTrip);
+    runner.runTest("LINDEX和LSET", testListIndexCommands);
+    runner.runTest("LMOVE", testListMove);
+    runner.runTest("阻塞弹出(epoll)", [] { return testBlockingPop(IoBackend::EPOLL, 6387); });
+    runner.runTest("阻塞弹出(io_uring)", [] { return testBlockingPop(IoBackend::IO_URING, 6388); });
     
     runner.printSummary();
     
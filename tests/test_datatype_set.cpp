@@ -113,6 +113,46 @@ void testSetMultiElementOperations() {
     std::cout << "集合多元素操作测试通过！" << std::endl;
 }
 
+void testSetOperations() {
+    std::cout << "测试集合运算..." << std::endl;
+    
+    dkv::StorageEngine storage;
+    storage.sadd(dkv::NO_TX, "s1", {"1", "2", "3", "a"});
+    storage.sadd(dkv::NO_TX, "s2", {"2", "3", "4"});
+    storage.sadd(dkv::NO_TX, "s3", {"3", "5"});
+    storage.set(dkv::NO_TX, "str", "value");
+    
+    // 交集：不存在的键视为空集合
+    std::vector<dkv::Value> members;
+    assert(storage.setOp(dkv::NO_TX, dkv::SetOp::INTER, {"s1", "s2", "s3"}, members));
+    assert(members == std::vector<dkv::Value>({"3"}));
+    assert(storage.setOp(dkv::NO_TX, dkv::SetOp::INTER, {"s1", "missing"}, members));
+    assert(members.empty());
+    
+    // 并集与差集
+    assert(storage.setOp(dkv::NO_TX, dkv::SetOp::UNION, {"s1", "s2", "missing"}, members));
+    assert(members.size() == 5);
+    assert(storage.setOp(dkv::NO_TX, dkv::SetOp::DIFF, {"s1", "s2"}, members));
+    assert(members.size() == 2);
+    
+    // 类型错误
+    assert(!storage.setOp(dkv::NO_TX, dkv::SetOp::UNION, {"s1", "str"}, members));
+    
+    // 保存结果，结果为空时删除目标键
+    size_t count = 0;
+    assert(storage.setOpStore(dkv::NO_TX, dkv::SetOp::INTER, "dest", {"s1", "s2"}, count));
+    assert(count == 2);
+    assert(storage.scard(dkv::NO_TX, "dest") == 2);
+    assert(storage.setOpStore(dkv::NO_TX, dkv::SetOp::DIFF, "dest", {"s3", "s1", "s2", "dest"}, count));
+    assert(count == 1);
+    assert(storage.sismember(dkv::NO_TX, "dest", "5"));
+    assert(storage.setOpStore(dkv::NO_TX, dkv::SetOp::INTER, "dest", {"s1", "missing"}, count));
+    assert(count == 0);
+    assert(!storage.exists(dkv::NO_TX, "dest"));
+    
+    std::cout << "集合运算测试通过！" << std::endl;
+}
+
 int main() {
     std::cout << "开始测试集合数据类型..." << std::endl;
     
@@ -121,6 +161,7 @@ int main() {
         testSetExpiration();
         testSetTypeChecking();
         testSetMultiElementOperations();
+        testSetOperations();
         
         std::cout << "所有集合数据类型测试通过！" << std::endl;
         return 0;
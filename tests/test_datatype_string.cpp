@@ -32,6 +32,154 @@ bool testStringItem() {
     return true;
 }
 
+// 测试紧凑头部：过期时间旁路表、LRU时钟和LFU计数
+bool testCompactHeader() {
+    // 头部不再包含读写锁和64位时间字段
+    ASSERT_LE(sizeof(DataItem), static_cast<size_t>(40));
+
+    auto expire_time = Utils::getCurrentTime() + std::chrono::seconds(10);
+    StringItem item("v");
+    ASSERT_FALSE(item.hasExpiration());
+    item.setExpiration(expire_time);
+    ASSERT_TRUE(item.hasExpiration());
+    ASSERT_TRUE(item.getExpiration() == expire_time);
+
+    // 克隆时复制过期时间，两者互不影响
+    std::unique_ptr<DataItem> copy = item.clone();
+    ASSERT_TRUE(copy->getExpiration() == expire_time);
+    item.setExpiration(Timestamp::min());
+    ASSERT_FALSE(item.hasExpiration());
+    ASSERT_TRUE(copy->hasExpiration());
+
+    // LRU时钟为毫秒精度
+    auto before = Utils::getCurrentTime() - std::chrono::milliseconds(2);
+    item.touch();
+    ASSERT_TRUE(item.getLastAccessed() >= before);
+
+    // LFU计数从初值开始，按对数递增并在255饱和
+    ASSERT_EQ(item.getAccessFrequency(), static_cast<uint64_t>(DataItem::LFU_INIT_VAL));
+    for (int i = 0; i < 100000; ++i) {
+        item.incrementFrequency();
+    }
+    uint64_t frequency = item.getAccessFrequency();
+    ASSERT_GT(frequency, static_cast<uint64_t>(DataItem::LFU_INIT_VAL));
+    ASSERT_LT(frequency, static_cast<uint64_t>(255));
+    return true;
+}
+
+// 测试字符串值的编码方式
+bool testStringEncoding() {
+    ASSERT_EQ(sizeof(StringItem), static_cast<size_t>(64));
+
+    StringItem int_item("12345");
+    ASSERT_TRUE(int_item.getEncoding() == StringEncoding::INT);
+    ASSERT_EQ(int_item.getValue(), std::string("12345"));
+    StringItem negative("-9223372036854775808");
+    ASSERT_TRUE(negative.getEncoding() == StringEncoding::INT);
+    ASSERT_EQ(negative.getValue(), std::string("-9223372036854775808"));
+
+    // 非规范形式的整数按字符串保存，保证原样返回
+    ASSERT_TRUE(StringItem("007").getEncoding() == StringEncoding::EMBSTR);
+    ASSERT_TRUE(StringItem("-0").getEncoding() == StringEncoding::EMBSTR);
+    ASSERT_TRUE(StringItem("+1").getEncoding() == StringEncoding::EMBSTR);
+    ASSERT_TRUE(StringItem("9223372036854775808").getEncoding() == StringEncoding::EMBSTR);
+    ASSERT_EQ(StringItem("007").getValue(), std::string("007"));
+
+    std::string short_value(StringItem::EMBSTR_MAX_LEN, 'a');
+    std::string long_value(StringItem::EMBSTR_MAX_LEN + 1, 'b');
+    StringItem item(short_value);
+    ASSERT_TRUE(item.getEncoding() == StringEncoding::EMBSTR);
+    item.setValue(long_value);
+    ASSERT_TRUE(item.getEncoding() == StringEncoding::RAW);
+    ASSERT_EQ(item.getValue(), long_value);
+
+    // 克隆RAW值为深拷贝
+    std::unique_ptr<DataItem> copy = item.clone();
+    item.setValue("42");
+    ASSERT_TRUE(item.getEncoding() == StringEncoding::INT);
+    ASSERT_EQ(static_cast<StringItem*>(copy.get())->getValue(), long_value);
+
+    // 序列化往返保持编码
+    StringItem restored;
+    restored.deserialize(item.serialize());
+    ASSERT_TRUE(restored.getEncoding() == StringEncoding::INT);
+    ASSERT_EQ(restored.getValue(), std::string("42"));
+    return true;
+}
+
+// 测试整数原地加减
+bool testStringIncrBy() {
+    int64_t result = 0;
+    StringItem counter("10");
+    ASSERT_TRUE(counter.incrBy(1, result));
+    ASSERT_EQ(result, static_cast<int64_t>(11));
+    ASSERT_TRUE(counter.incrBy(-20, result));
+    ASSERT_EQ(counter.getValue(), std::string("-9"));
+
+    // 非规范数值沿用原有解析规则，结果转为整数编码
+    StringItem padded("007");
+    ASSERT_TRUE(padded.incrBy(1, result));
+    ASSERT_EQ(padded.getValue(), std::string("8"));
+    ASSERT_TRUE(padded.getEncoding() == StringEncoding::INT);
+
+    StringItem text("abc");
+    ASSERT_FALSE(text.incrBy(1, result));
+    ASSERT_EQ(text.getValue(), std::string("abc"));
+
+    StringItem max_value("9223372036854775807");
+    ASSERT_FALSE(max_value.incrBy(1, result));
+    ASSERT_EQ(max_value.getValue(), std::string("9223372036854775807"));
+    return true;
+}
+
+// 测试长字符串压缩：收益足够时以压缩形式保存，读取、克隆和序列化往返不变
+bool testStringCompression() {
+    StringCompressionConfig& config = stringCompressionConfig();
+    const StringCompressionConfig saved = config;
+    config.enabled = true;
+    config.min_bytes = 64;
+    config.min_ratio = 1.5;
+
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += "field:" + std::to_string(i % 10) + ";";
+    }
+    StringItem item(text, Utils::getCurrentTime() + std::chrono::seconds(100));
+    ASSERT_TRUE(item.getEncoding() == StringEncoding::COMPRESSED);
+    ASSERT_EQ(item.getValue(), text);
+
+    // 压缩形式含':'也能按长度还原，过期时间保留
+    std::string serialized = item.serialize();
+    ASSERT_TRUE(serialized.size() < text.size());
+    StringItem restored;
+    restored.deserialize(serialized);
+    ASSERT_TRUE(restored.getEncoding() == StringEncoding::COMPRESSED);
+    ASSERT_EQ(restored.getValue(), text);
+    ASSERT_TRUE(restored.hasExpiration());
+
+    std::unique_ptr<DataItem> copy = item.clone();
+    item.setValue("short");
+    ASSERT_TRUE(item.getEncoding() == StringEncoding::EMBSTR);
+    ASSERT_EQ(static_cast<StringItem*>(copy.get())->getValue(), text);
+
+    // 压缩收益不足或短于阈值时保持原样
+    std::string random;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 512; ++i) {
+        seed = seed * 1103515245 + 12345;
+        random.push_back(static_cast<char>(seed >> 16));
+    }
+    StringItem incompressible(random);
+    ASSERT_TRUE(incompressible.getEncoding() == StringEncoding::RAW);
+    StringItem below(std::string(40, 'a'));
+    ASSERT_TRUE(below.getEncoding() == StringEncoding::RAW);
+
+    config = saved;
+    StringItem disabled(text);
+    ASSERT_TRUE(disabled.getEncoding() == StringEncoding::RAW);
+    return true;
+}
+
 } // namespace dkv
 
 int main() {
@@ -42,6 +190,10 @@ int main() {
     TestRunner runner;
     
     runner.runTest("StringItem基本功能", testStringItem);
+    runner.runTest("数据项紧凑头部", testCompactHeader);
+    runner.runTest("StringItem编码方式", testStringEncoding);
+    runner.runTest("StringItem整数加减", testStringIncrBy);
+    runner.runTest("StringItem长字符串压缩", testStringCompression);
     
     runner.printSummary();
     
@@ -3,7 +3,11 @@
 #include "storage/dkv_storage.hpp"
 #include "dkv_utils.hpp"
 #include "dkv_logger.hpp"
+#include "datatypes/dkv_datatype_zset.hpp"
 #include <vector>
+#include <map>
+#include <set>
+#include <random>
 #include <string>
 #include <cassert>
 #include <thread>
@@ -323,6 +327,181 @@ void testZAddMultipleMembers() {
     DKV_LOG_INFO("testZAddMultipleMembers passed");
 }
 
+void testSkipListOrderAndRank() {
+    // 测试跳表的排名与范围查询与参考实现一致，同分成员按字典序排列
+    DKV_LOG_INFO("Running testSkipListOrderAndRank");
+
+    ZSetItem zset;
+    std::set<std::pair<double, Value>> reference;
+    std::unordered_map<Value, double> scores;
+    std::mt19937 rng(2024);
+    for (int i = 0; i < 20000; ++i) {
+        Value member = "m" + std::to_string(rng() % 2000);
+        if (rng() % 4 == 0) {
+            auto it = scores.find(member);
+            assert(zset.zrem(member) == (it != scores.end()));
+            if (it != scores.end()) {
+                reference.erase({it->second, member});
+                scores.erase(it);
+            }
+        } else {
+            double score = static_cast<double>(rng() % 100);
+            auto it = scores.find(member);
+            if (it != scores.end()) {
+                reference.erase({it->second, member});
+            }
+            zset.zadd(member, score);
+            reference.insert({score, member});
+            scores[member] = score;
+        }
+    }
+    assert(zset.zcard() == reference.size());
+
+    // 排名与顺序
+    size_t expected_rank = 0;
+    for (const auto& entry : reference) {
+        size_t rank = 0;
+        assert(zset.zrank(entry.second, rank));
+        assert(rank == expected_rank);
+        assert(zset.zrevrank(entry.second, rank));
+        assert(rank == reference.size() - 1 - expected_rank);
+        expected_rank++;
+    }
+    auto all = zset.zrange(0, reference.size());
+    assert(all.size() == reference.size());
+    size_t index = 0;
+    for (const auto& entry : reference) {
+        assert(all[index].first == entry.second && all[index].second == entry.first);
+        index++;
+    }
+
+    // 按排名截取与逆序截取
+    auto middle = zset.zrange(100, 109);
+    auto reversed = zset.zrevrange(reference.size() - 110, reference.size() - 101);
+    assert(middle.size() == 10 && reversed.size() == 10);
+    for (size_t i = 0; i < 10; ++i) {
+        assert(middle[i] == all[100 + i]);
+        assert(reversed[i] == all[109 - i]);
+    }
+
+    // 分数区间
+    for (double min = 0; min < 100; min += 7) {
+        double max = min + 13;
+        size_t expected = 0;
+        for (const auto& entry : reference) {
+            if (entry.first >= min && entry.first <= max) {
+                expected++;
+            }
+        }
+        assert(zset.zcount(min, max) == expected);
+        assert(zset.zrangebyscore(min, max).size() == expected);
+        assert(zset.zrevrangebyscore(max, min).size() == expected);
+    }
+    assert(zset.zcount(200, 300) == 0);
+
+    // 序列化往返保持内容和顺序
+    ZSetItem restored;
+    restored.deserialize(zset.serialize());
+    assert(restored.zrange(0, reference.size()) == all);
+
+    DKV_LOG_INFO("testSkipListOrderAndRank passed");
+}
+
+// 测试ZUNIONSTORE/ZINTERSTORE/ZRANGESTORE：权重、聚合方式、不存在的键与结果为空时删除目标键
+void testZSetStore() {
+    StorageEngine engine;
+    engine.zadd(NO_TX, "za", {{"a", 1}, {"b", 2}, {"c", 3}});
+    engine.zadd(NO_TX, "zb", {{"b", 10}, {"c", 20}, {"d", 30}});
+    engine.set(NO_TX, "str", "value");
+
+    size_t count = 0;
+    assert(engine.zsetOpStore(NO_TX, SetOp::UNION, "out", {"za", "zb", "missing"}, {1, 2, 5}, ZSetAggregate::SUM, count));
+    assert(count == 4);
+    double score = 0;
+    assert(engine.zscore(NO_TX, "out", "b", score) && score == 22);
+    assert(engine.zscore(NO_TX, "out", "d", score) && score == 60);
+    assert(engine.zrange(NO_TX, "out", 0, 0)[0].first == "a");
+
+    assert(engine.zsetOpStore(NO_TX, SetOp::INTER, "out", {"za", "zb"}, {1, 1}, ZSetAggregate::MAX, count));
+    assert(count == 2);
+    assert(engine.zscore(NO_TX, "out", "c", score) && score == 20);
+    assert(!engine.zismember(NO_TX, "out", "a"));
+
+    assert(!engine.zsetOpStore(NO_TX, SetOp::UNION, "out", {"za", "str"}, {1, 1}, ZSetAggregate::SUM, count));
+    assert(engine.zsetOpStore(NO_TX, SetOp::INTER, "out", {"za", "missing"}, {1, 1}, ZSetAggregate::SUM, count));
+    assert(count == 0);
+    assert(!engine.exists(NO_TX, "out"));
+
+    ZRangeSpec range;
+    range.by_score = true;
+    range.rev = true;
+    range.min = 2;
+    range.max = 25;
+    assert(engine.zrangestore(NO_TX, "slice", "zb", range, count));
+    assert(count == 2);
+    assert(engine.zrange(NO_TX, "slice", 0, 1)[1].first == "c");
+    range = ZRangeSpec();
+    range.start = 1;
+    range.stop = 5;
+    assert(engine.zrangestore(NO_TX, "slice", "za", range, count));
+    assert(count == 2);
+    assert(engine.zcard(NO_TX, "slice") == 2);
+
+    DKV_LOG_INFO("testZSetStore passed");
+}
+
+// 测试大输入的并行分段归并与整体载入：结果与逐个累加的参考实现一致，跳表排名正确
+void testZSetCombineLarge() {
+    std::mt19937 rng(42);
+    ZSetItem a;
+    ZSetItem b;
+    std::map<std::string, double> score_a;
+    std::map<std::string, double> score_b;
+    for (int i = 0; i < 200000; ++i) {
+        const std::string member = "m" + std::to_string(rng() % 300000);
+        const double score = static_cast<double>(rng() % 1000);
+        a.zadd(member, score);
+        score_a[member] = score;
+    }
+    for (int i = 0; i < 100000; ++i) {
+        const std::string member = "m" + std::to_string(rng() % 300000);
+        const double score = static_cast<double>(rng() % 1000);
+        b.zadd(member, score);
+        score_b[member] = score;
+    }
+
+    auto united = ZSetItem::combine(SetOp::UNION, {&a, &b}, {1, 3}, ZSetAggregate::SUM);
+    std::map<std::string, double> expected(score_a);
+    for (const auto& [member, score] : score_b) {
+        expected[member] += score * 3;
+    }
+    assert(united->zcard() == expected.size());
+    for (const auto& [member, score] : expected) {
+        double actual = 0;
+        assert(united->zscore(member, actual) && actual == score);
+    }
+    auto all = united->zrange(0, united->zcard());
+    for (size_t i = 1; i < all.size(); ++i) {
+        assert(all[i - 1].second < all[i].second ||
+               (all[i - 1].second == all[i].second && all[i - 1].first < all[i].first));
+    }
+    size_t rank = 0;
+    assert(united->zrank(all[all.size() / 2].first, rank) && rank == all.size() / 2);
+
+    auto common = ZSetItem::combine(SetOp::INTER, {&a, &b}, {1, 1}, ZSetAggregate::MIN);
+    size_t intersection = 0;
+    for (const auto& [member, score] : score_b) {
+        if (score_a.count(member)) {
+            intersection++;
+            double actual = 0;
+            assert(common->zscore(member, actual) && actual == std::min(score, score_a[member]));
+        }
+    }
+    assert(common->zcard() == intersection);
+
+    DKV_LOG_INFO("testZSetCombineLarge passed");
+}
+
 } // namespace dkv
 
 int main() {
@@ -339,6 +518,9 @@ int main() {
         testZCountZCard();
         testExpiration();
         testZAddMultipleMembers();
+        testSkipListOrderAndRank();
+        testZSetStore();
+        testZSetCombineLarge();
         
         std::cout << "所有测试通过！" << std::endl;
         return 0;
@@ -0,0 +1,203 @@
+#include "storage/dkv_eviction_pool.hpp"
+#include "storage/dkv_expire_index.hpp"
+#include "storage/dkv_storage.hpp"
+#include "dkv_server.hpp"
+#include "dkv_logger.hpp"
+#include "test_runner.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <unordered_set>
+
+namespace dkv {
+
+// 测试候选池按分数保留最优候选，取出时分数最高者优先
+bool testEvictionPoolOrdering() {
+    EvictionPool pool(4);
+    ASSERT_TRUE(pool.empty());
+    Key key;
+    ASSERT_FALSE(pool.pop(key));
+
+    pool.offer("a", 10);
+    pool.offer("b", 50);
+    pool.offer("c", 30);
+    pool.offer("d", 20);
+    // 池满时分数不高于最小值的候选被丢弃
+    pool.offer("e", 5);
+    ASSERT_EQ(pool.size(), static_cast<size_t>(4));
+    // 分数更高的候选挤掉最小值
+    pool.offer("f", 40);
+    ASSERT_EQ(pool.size(), static_cast<size_t>(4));
+    // 已在池中的键只更新分数
+    pool.offer("d", 60);
+    ASSERT_EQ(pool.size(), static_cast<size_t>(4));
+
+    ASSERT_TRUE(pool.pop(key));
+    ASSERT_EQ(key, std::string("d"));
+    ASSERT_TRUE(pool.pop(key));
+    ASSERT_EQ(key, std::string("b"));
+    ASSERT_TRUE(pool.pop(key));
+    ASSERT_EQ(key, std::string("f"));
+    ASSERT_TRUE(pool.pop(key));
+    ASSERT_EQ(key, std::string("c"));
+    ASSERT_FALSE(pool.pop(key));
+    return true;
+}
+
+// 测试随机采样：每次只返回少量键，多次采样能覆盖键空间的不同部分
+bool testSampleKeys() {
+    StorageEngine storage;
+    size_t sampled = 0;
+    storage.sampleKeys(5, [&sampled](const SharedKey&, const DataItem&) { sampled++; });
+    ASSERT_EQ(sampled, static_cast<size_t>(0));
+
+    const int NUM_KEYS = 10000;
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        storage.set(NO_TX, "key" + std::to_string(i), "v");
+    }
+    std::unordered_set<std::string> seen;
+    for (int round = 0; round < 200; ++round) {
+        size_t batch = 0;
+        storage.sampleKeys(5, [&](const SharedKey& key, const DataItem&) {
+            seen.insert(key.str());
+            batch++;
+        });
+        ASSERT_GT(batch, static_cast<size_t>(0));
+        ASSERT_LT(batch, static_cast<size_t>(NUM_KEYS / 10));
+    }
+    ASSERT_GT(seen.size(), static_cast<size_t>(500));
+    return true;
+}
+
+// 测试近似LRU淘汰：超过内存上限后写入触发淘汰，最近访问过的键被保留
+bool testApproximateLRUEviction() {
+    DKVServer server(6386);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    server.setEvictionPolicy(EvictionPolicy::ALLKEYS_LRU);
+    server.setMaxMemorySamples(10);
+    if (!server.start()) {
+        return false;
+    }
+    const std::string value(1024, 'x');
+    const int HOT_KEYS = 20;
+    for (int i = 0; i < HOT_KEYS; ++i) {
+        server.executeCommand(Command(CommandType::SET, {"hot" + std::to_string(i), value}), NO_TX);
+    }
+    for (int i = 0; i < 2000; ++i) {
+        server.executeCommand(Command(CommandType::SET, {"cold" + std::to_string(i), value}), NO_TX);
+    }
+    // 拉开冷热键的空闲时长
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (int i = 0; i < HOT_KEYS; ++i) {
+        server.executeCommand(Command(CommandType::GET, {"hot" + std::to_string(i)}), NO_TX);
+    }
+
+    // 上限设为当前用量附近，后续写入需要持续淘汰
+    server.setMaxMemory(server.getMemoryUsage());
+    size_t before = server.getKeyCount();
+    int rejected = 0;
+    for (int i = 0; i < 500; ++i) {
+        Response response = server.executeCommand(Command(CommandType::SET, {"new" + std::to_string(i), value}), NO_TX);
+        if (response.status != ResponseStatus::OK) {
+            rejected++;
+        }
+    }
+    ASSERT_EQ(rejected, 0);
+    ASSERT_LT(server.getKeyCount(), before + 500);
+
+    int hot_alive = 0;
+    for (int i = 0; i < HOT_KEYS; ++i) {
+        Response response = server.executeCommand(Command(CommandType::EXISTS, {"hot" + std::to_string(i)}), NO_TX);
+        if (response.data == "1") {
+            hot_alive++;
+        }
+    }
+    server.stop();
+    // 采样淘汰是近似的，绝大多数热键应当存活
+    ASSERT_GE(hot_alive, HOT_KEYS * 3 / 4);
+    return true;
+}
+
+// 测试过期索引按过期时间取出到期键，重复登记时替换原有的过期时间
+bool testExpireIndexOrdering() {
+    ExpireIndex index;
+    const Timestamp now = Utils::getCurrentTime();
+    Key key;
+    ASSERT_FALSE(index.popDue(now, key));
+
+    index.add("a", now - std::chrono::seconds(1));
+    index.add("b", now - std::chrono::seconds(3));
+    index.add("c", now + std::chrono::seconds(10));
+    index.add("d", now - std::chrono::seconds(2));
+    // 重新登记后按新的过期时间排序
+    index.add("d", now + std::chrono::seconds(20));
+    index.add("e", now - std::chrono::seconds(5));
+    index.remove("e");
+    ASSERT_EQ(index.size(), static_cast<size_t>(4));
+    ASSERT_TRUE(index.hasDue(now));
+
+    ASSERT_TRUE(index.popDue(now, key));
+    ASSERT_EQ(key, std::string("b"));
+    ASSERT_TRUE(index.popDue(now, key));
+    ASSERT_EQ(key, std::string("a"));
+    ASSERT_FALSE(index.popDue(now, key));
+    ASSERT_FALSE(index.hasDue(now));
+    ASSERT_EQ(index.size(), static_cast<size_t>(2));
+    return true;
+}
+
+// 测试主动过期只处理过期索引中的键：到期键被删除，延长过期时间的键和持久键保留
+bool testActiveExpireCycle() {
+    StorageEngine storage;
+    const Timestamp now = Utils::getCurrentTime();
+    const int EXPIRED_KEYS = 1000;
+    for (int i = 0; i < 10000; ++i) {
+        storage.set(NO_TX, "persistent" + std::to_string(i), "v");
+    }
+    for (int i = 0; i < EXPIRED_KEYS; ++i) {
+        storage.setDataItem("expired" + std::to_string(i),
+                            std::make_unique<StringItem>("v", now - std::chrono::seconds(1)));
+    }
+    storage.setDataItem("extended", std::make_unique<StringItem>("v", now + std::chrono::milliseconds(50)));
+    ASSERT_TRUE(storage.expire(NO_TX, "extended", 100));
+    storage.set(NO_TX, "future", "v", 100);
+    ASSERT_EQ(storage.getKeyspaceStats().volatile_keys, static_cast<size_t>(EXPIRED_KEYS + 2));
+
+    // 预算为0时不处理任何键，返回仍有到期键
+    ASSERT_TRUE(storage.cleanupExpiredKeys(std::chrono::microseconds(0)));
+    ASSERT_EQ(storage.getExpiredKeys(), static_cast<uint64_t>(0));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    while (storage.cleanupExpiredKeys(std::chrono::microseconds(200))) {
+    }
+    ASSERT_EQ(storage.getExpiredKeys(), static_cast<uint64_t>(EXPIRED_KEYS));
+    ASSERT_EQ(storage.getKeyspaceStats().volatile_keys, static_cast<size_t>(2));
+    ASSERT_TRUE(storage.exists(NO_TX, "extended"));
+    ASSERT_TRUE(storage.exists(NO_TX, "future"));
+    ASSERT_TRUE(storage.exists(NO_TX, "persistent0"));
+    ASSERT_EQ(storage.size(), static_cast<size_t>(10002));
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 内存淘汰测试\n" << std::endl;
+    Logger::getInstance().setLogLevel(LogLevel::WARNING);
+
+    TestRunner runner;
+
+    runner.runTest("淘汰候选池排序", testEvictionPoolOrdering);
+    runner.runTest("随机采样", testSampleKeys);
+    runner.runTest("近似LRU淘汰", testApproximateLRUEviction);
+    runner.runTest("过期索引排序", testExpireIndexOrdering);
+    runner.runTest("主动过期周期", testActiveExpireCycle);
+
+    runner.printSummary();
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "multinode/shard/dkv_hash_slot.hpp"
+#include "test_runner.hpp"
+#include <iostream>
+
+namespace dkv {
+
+// 测试CRC16和键槽计算与Redis Cluster一致，包括hash tag
+bool testKeyHashSlot() {
+    ASSERT_EQ(CRC16("123456789"), 0x31C3);
+    ASSERT_EQ(KeyHashSlot("foo"), 12182);
+    ASSERT_EQ(KeyHashSlot("bar"), 5061);
+    ASSERT_EQ(KeyHashSlot("{user1000}.following"), KeyHashSlot("user1000"));
+    ASSERT_EQ(KeyHashSlot("{user1000}.followers"), KeyHashSlot("{user1000}.following"));
+    // 空的{}不是hash tag，对整个键计算
+    ASSERT_EQ(KeyHashSlot("foo{}{bar}"), CRC16("foo{}{bar}") % HASH_SLOT_COUNT);
+    // 只取第一个'{'到其后第一个'}'之间的内容
+    ASSERT_EQ(KeyHashSlot("foo{{bar}}zap"), KeyHashSlot("{bar"));
+    ASSERT_EQ(KeyHashSlot("foo{bar}{zap}"), KeyHashSlot("bar"));
+    return true;
+}
+
+// 测试槽的平均分配和迁移：迁移期间槽仍属于源分片，完成后切换到目标分片
+bool testSlotTableMigration() {
+    SlotTable table;
+    ASSERT_EQ(table.GetOwner(0), NO_SHARD);
+    table.AssignEvenly({0, 1, 2});
+    ASSERT_EQ(table.GetOwner(0), 0);
+    ASSERT_EQ(table.GetOwner(HASH_SLOT_COUNT - 1), 2);
+    ASSERT_EQ(table.SlotsOf(0).size() + table.SlotsOf(1).size() + table.SlotsOf(2).size(),
+              static_cast<size_t>(HASH_SLOT_COUNT));
+
+    const int slot = 100;
+    ASSERT_FALSE(table.BeginMigration(slot, 0));
+    ASSERT_TRUE(table.BeginMigration(slot, 2));
+    ASSERT_FALSE(table.BeginMigration(slot, 1));
+    ASSERT_EQ(table.GetOwner(slot), 0);
+    ASSERT_EQ(table.GetMigrationTarget(slot), 2);
+    ASSERT_EQ(table.MigratingSlots().size(), 1u);
+
+    table.CancelMigration(slot);
+    ASSERT_EQ(table.GetMigrationTarget(slot), NO_SHARD);
+    ASSERT_FALSE(table.CompleteMigration(slot));
+
+    ASSERT_TRUE(table.BeginMigration(slot, 2));
+    ASSERT_TRUE(table.CompleteMigration(slot));
+    ASSERT_EQ(table.GetOwner(slot), 2);
+    ASSERT_EQ(table.GetMigrationTarget(slot), NO_SHARD);
+    ASSERT_TRUE(table.MigratingSlots().empty());
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 哈希槽测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("键槽计算", testKeyHashSlot);
+    runner.runTest("槽分配与迁移", testSlotTableMigration);
+
+    runner.printSummary();
+
+    return 0;
+}
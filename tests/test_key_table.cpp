@@ -0,0 +1,264 @@
+#include "storage/dkv_key_table.hpp"
+#include "datatypes/dkv_datatype_string.hpp"
+#include "dkv_page_memory.hpp"
+#include "test_runner.hpp"
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <random>
+
+namespace dkv {
+
+// 测试基本的插入、查找、覆盖与删除
+bool testKeyTableBasic() {
+    KeyTable table;
+    ASSERT_TRUE(table.empty());
+    ASSERT_TRUE(table.find("missing") == table.end());
+
+    ASSERT_TRUE(table.insert_or_assign("k1", std::make_unique<StringItem>("v1")));
+    ASSERT_FALSE(table.insert_or_assign("k1", std::make_unique<StringItem>("v2")));
+    ASSERT_EQ(table.size(), static_cast<size_t>(1));
+
+    auto it = table.find("k1");
+    ASSERT_TRUE(it != table.end());
+    ASSERT_EQ(static_cast<StringItem*>(it->second.get())->getValue(), std::string("v2"));
+
+    // operator[]插入空数据项
+    std::unique_ptr<DataItem>& ref = table["k2"];
+    ASSERT_TRUE(ref == nullptr);
+    ref = std::make_unique<StringItem>("v3");
+    ASSERT_EQ(table.size(), static_cast<size_t>(2));
+
+    ASSERT_EQ(table.erase("k1"), static_cast<size_t>(1));
+    ASSERT_EQ(table.erase("k1"), static_cast<size_t>(0));
+    ASSERT_TRUE(table.find("k1") == table.end());
+    ASSERT_TRUE(table.find("k2") != table.end());
+
+    table.clear();
+    ASSERT_EQ(table.size(), static_cast<size_t>(0));
+    ASSERT_TRUE(table.begin() == table.end());
+    return true;
+}
+
+// 测试扩容与大量随机增删后与unordered_map结果一致
+bool testKeyTableRandomOps() {
+    KeyTable table;
+    std::unordered_map<std::string, std::string> reference;
+    std::mt19937 rng(12345);
+    const int NUM_OPS = 200000;
+    const int KEY_SPACE = 20000;
+
+    for (int i = 0; i < NUM_OPS; ++i) {
+        std::string key = "key:" + std::to_string(rng() % KEY_SPACE);
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(table.erase(key), reference.erase(key));
+        } else {
+            std::string value = std::to_string(i);
+            bool inserted = table.insert_or_assign(key, std::make_unique<StringItem>(value));
+            ASSERT_EQ(inserted, reference.find(key) == reference.end());
+            reference[key] = value;
+        }
+    }
+
+    ASSERT_EQ(table.size(), reference.size());
+    size_t visited = 0;
+    for (const auto& pair : table) {
+        auto ref_it = reference.find(pair.first.str());
+        ASSERT_TRUE(ref_it != reference.end());
+        ASSERT_EQ(static_cast<StringItem*>(pair.second.get())->getValue(), ref_it->second);
+        visited++;
+    }
+    ASSERT_EQ(visited, reference.size());
+    return true;
+}
+
+// 测试遍历过程中按迭代器删除
+bool testKeyTableEraseWhileIterating() {
+    KeyTable table;
+    for (int i = 0; i < 1000; ++i) {
+        table.insert_or_assign(std::to_string(i), std::make_unique<StringItem>(std::to_string(i)));
+    }
+    auto it = table.begin();
+    while (it != table.end()) {
+        if (std::stoi(it->first.str()) % 2 == 0) {
+            it = table.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    ASSERT_EQ(table.size(), static_cast<size_t>(500));
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(table.find(std::to_string(i)) != table.end(), i % 2 == 1);
+    }
+    return true;
+}
+
+// 测试渐进式rehash：扩容后旧表分批迁移，迁移期间查找同时覆盖新旧两张表
+bool testKeyTableIncrementalRehash() {
+    KeyTable table;
+    int inserted = 0;
+    // 插入直到触发一次扩容
+    while (!table.isRehashing()) {
+        table.insert_or_assign("key" + std::to_string(inserted), std::make_unique<StringItem>("v"));
+        inserted++;
+    }
+    ASSERT_GT(table.rehashPendingSlots(), static_cast<size_t>(0));
+    size_t pending = table.rehashPendingSlots();
+
+    // 迁移期间所有键均可查到，遍历结果完整
+    for (int i = 0; i < inserted; ++i) {
+        ASSERT_TRUE(table.find("key" + std::to_string(i)) != table.end());
+    }
+    size_t visited = 0;
+    for (auto it = table.begin(); it != table.end(); ++it) {
+        visited++;
+    }
+    ASSERT_EQ(visited, static_cast<size_t>(inserted));
+
+    // 每次写操作只迁移固定数量的组
+    table.insert_or_assign("extra", std::make_unique<StringItem>("v"));
+    if (table.isRehashing()) {
+        ASSERT_LT(table.rehashPendingSlots(), pending);
+    }
+    while (table.rehashStep(1)) {
+    }
+    ASSERT_FALSE(table.isRehashing());
+    ASSERT_EQ(table.rehashPendingSlots(), static_cast<size_t>(0));
+    ASSERT_EQ(table.size(), static_cast<size_t>(inserted + 1));
+    for (int i = 0; i < inserted; ++i) {
+        ASSERT_TRUE(table.find("key" + std::to_string(i)) != table.end());
+    }
+    return true;
+}
+
+// 测试游标遍历：表不变时每个键恰好返回一次；遍历中途扩容、rehash和删除时，
+// 遍历开始前已存在且未删除的键至少返回一次
+bool testKeyTableScan() {
+    KeyTable table;
+    ASSERT_EQ(table.scan(0, [](const KeyTable::value_type&) {}), static_cast<size_t>(0));
+
+    const int NUM_KEYS = 5000;
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        table.insert_or_assign("key" + std::to_string(i), std::make_unique<StringItem>("v"));
+    }
+    while (table.rehashStep(1)) {
+    }
+    std::unordered_map<std::string, int> seen;
+    size_t cursor = 0;
+    do {
+        cursor = table.scan(cursor, [&seen](const KeyTable::value_type& pair) {
+            seen[pair.first.str()]++;
+        });
+    } while (cursor != 0);
+    ASSERT_EQ(seen.size(), static_cast<size_t>(NUM_KEYS));
+    for (const auto& entry : seen) {
+        ASSERT_EQ(entry.second, 1);
+    }
+
+    // 遍历过程中持续插入触发多次扩容，并删除部分原有键
+    std::unordered_set<std::string> found;
+    std::unordered_set<std::string> erased;
+    int next = NUM_KEYS;
+    int step = 0;
+    cursor = 0;
+    do {
+        cursor = table.scan(cursor, [&found](const KeyTable::value_type& pair) {
+            found.insert(pair.first.str());
+        });
+        for (int i = 0; i < 20; ++i, ++next) {
+            table.insert_or_assign("key" + std::to_string(next), std::make_unique<StringItem>("v"));
+        }
+        if (step % 7 == 0) {
+            std::string key = "key" + std::to_string(step);
+            table.erase(key);
+            erased.insert(key);
+        }
+        step++;
+    } while (cursor != 0);
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        std::string key = "key" + std::to_string(i);
+        if (erased.count(key) == 0) {
+            ASSERT_TRUE(found.count(key) > 0);
+        }
+    }
+    return true;
+}
+
+// 测试大页模式：槽位数组不小于一个大页的表由页内存映射，释放表后归还
+// （其中的数据项由slab分配，slab同样从页内存切分且不归还，只比较表释放前后的差值）
+bool testKeyTableHugePages() {
+    PageMemory::configure(HugePageMode::TRANSPARENT, false);
+    const size_t mapped_before = PageMemory::stats().mapped_bytes;
+    size_t mapped_full = 0;
+    {
+        KeyTable table;
+        const int count = 100000;
+        for (int i = 0; i < count; ++i) {
+            table.insert_or_assign("key" + std::to_string(i), std::make_unique<StringItem>("v"));
+        }
+        while (table.rehashStep(64)) {
+        }
+        mapped_full = PageMemory::stats().mapped_bytes;
+        ASSERT_GT(mapped_full, mapped_before);
+        for (int i = 0; i < count; i += 997) {
+            ASSERT_TRUE(table.find("key" + std::to_string(i)) != table.end());
+        }
+    }
+    ASSERT_TRUE(PageMemory::stats().mapped_bytes + PageMemory::HUGE_PAGE_SIZE <= mapped_full);
+    PageMemory::configure(HugePageMode::OFF, false);
+    return true;
+}
+
+// 测试共享键：槽位只保存句柄，按string_view查找，复制句柄不复制字符串
+bool testKeyTableSharedKeys() {
+    ASSERT_EQ(sizeof(KeyTable::value_type), 2 * sizeof(void*));
+    KeyTable table;
+    const std::string long_key(100, 'k');
+    table.insert_or_assign(long_key, std::make_unique<StringItem>("v"));
+    table.insert_or_assign("short", std::make_unique<StringItem>("w"));
+
+    const char buffer[] = "shortened";
+    auto it = table.find(std::string_view(buffer, 5));
+    ASSERT_TRUE(it != table.end());
+    ASSERT_TRUE(it->first == "short");
+    ASSERT_TRUE(table.find(std::string_view(buffer, 4)) == table.end());
+
+    it = table.find(long_key);
+    ASSERT_TRUE(it != table.end());
+    ASSERT_EQ(it->first.useCount(), static_cast<size_t>(1));
+    SharedKey handle = it->first;
+    ASSERT_EQ(it->first.useCount(), static_cast<size_t>(2));
+    ASSERT_TRUE(handle.data() == it->first.data());
+
+    // 覆盖数据项不替换键，删除后句柄仍然有效
+    table.insert_or_assign(long_key, std::make_unique<StringItem>("v2"));
+    ASSERT_TRUE(table.find(long_key)->first.data() == handle.data());
+    ASSERT_EQ(table.erase(long_key), static_cast<size_t>(1));
+    ASSERT_EQ(handle.useCount(), static_cast<size_t>(1));
+    ASSERT_EQ(handle.str(), long_key);
+    ASSERT_EQ(SharedKey("").size(), static_cast<size_t>(0));
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV KeyTable功能测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("KeyTable基本功能", testKeyTableBasic);
+    runner.runTest("KeyTable随机增删", testKeyTableRandomOps);
+    runner.runTest("KeyTable遍历中删除", testKeyTableEraseWhileIterating);
+    runner.runTest("KeyTable渐进式rehash", testKeyTableIncrementalRehash);
+    runner.runTest("KeyTable游标遍历", testKeyTableScan);
+    runner.runTest("KeyTable大页映射", testKeyTableHugePages);
+    runner.runTest("KeyTable共享键", testKeyTableSharedKeys);
+
+    runner.printSummary();
+
+    return 0;
+}
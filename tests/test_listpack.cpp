@@ -0,0 +1,276 @@
+#include "datatypes/dkv_listpack.hpp"
+#include "datatypes/dkv_datatype_hash.hpp"
+#include "datatypes/dkv_datatype_set.hpp"
+#include "datatypes/dkv_datatype_zset.hpp"
+#include "test_runner.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <algorithm>
+
+namespace dkv {
+
+// 测试条目的追加、插入、删除与双向遍历
+bool testListpackBasic() {
+    Listpack lp;
+    ASSERT_TRUE(lp.empty());
+    ASSERT_TRUE(lp.last() == lp.end());
+
+    lp.append("b");
+    lp.prepend("a");
+    lp.append(std::string(300, 'c')); // 长度需要多字节编码
+    ASSERT_EQ(lp.size(), static_cast<size_t>(3));
+
+    std::vector<std::string> forward;
+    for (size_t pos = lp.begin(); pos != lp.end(); pos = lp.next(pos)) {
+        forward.emplace_back(lp.get(pos));
+    }
+    ASSERT_EQ(forward.size(), static_cast<size_t>(3));
+    ASSERT_EQ(forward[0], std::string("a"));
+    ASSERT_EQ(forward[2], std::string(300, 'c'));
+
+    std::vector<std::string> backward;
+    for (size_t pos = lp.last(); pos != lp.end(); pos = lp.prev(pos)) {
+        backward.emplace_back(lp.get(pos));
+    }
+    std::reverse(backward.begin(), backward.end());
+    ASSERT_TRUE(forward == backward);
+
+    size_t pos = lp.find("b");
+    ASSERT_TRUE(pos != lp.end());
+    pos = lp.replace(pos, "bb");
+    ASSERT_EQ(std::string(lp.get(pos)), std::string("bb"));
+    pos = lp.erase(pos);
+    ASSERT_EQ(std::string(lp.get(pos)), std::string(300, 'c'));
+    ASSERT_EQ(lp.size(), static_cast<size_t>(2));
+    ASSERT_TRUE(lp.find("b") == lp.end());
+
+    ASSERT_EQ(std::string(lp.get(lp.seek(-1))), std::string(300, 'c'));
+    ASSERT_EQ(std::string(lp.get(lp.seek(0))), std::string("a"));
+    ASSERT_TRUE(lp.seek(2) == lp.end());
+    return true;
+}
+
+// 测试随机插入删除后与deque结果一致
+bool testListpackRandomOps() {
+    Listpack lp;
+    std::deque<std::string> reference;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 5000; ++i) {
+        int op = rng() % 4;
+        std::string value(rng() % 200, static_cast<char>('a' + i % 26));
+        if (op == 0 || reference.empty()) {
+            size_t index = reference.empty() ? 0 : rng() % (reference.size() + 1);
+            size_t pos = index == reference.size() ? lp.end() : lp.seek(static_cast<int64_t>(index));
+            lp.insert(pos, value);
+            reference.insert(reference.begin() + index, value);
+        } else if (op == 1) {
+            size_t index = rng() % reference.size();
+            lp.erase(lp.seek(static_cast<int64_t>(index)));
+            reference.erase(reference.begin() + index);
+        } else if (op == 2) {
+            size_t index = rng() % reference.size();
+            lp.replace(lp.seek(static_cast<int64_t>(index)), value);
+            reference[index] = value;
+        } else {
+            lp.append(value);
+            reference.push_back(value);
+        }
+    }
+    ASSERT_EQ(lp.size(), reference.size());
+    size_t index = 0;
+    for (size_t pos = lp.begin(); pos != lp.end(); pos = lp.next(pos), ++index) {
+        ASSERT_EQ(std::string(lp.get(pos)), reference[index]);
+    }
+    return true;
+}
+
+// 测试小集合使用紧凑编码，超过阈值后转换且内容不变
+bool testCompactCollections() {
+    const ListpackConfig& config = listpackConfig();
+
+    HashItem hash;
+    for (size_t i = 0; i < config.hash_max_entries; ++i) {
+        hash.setField("f" + std::to_string(i), "v" + std::to_string(i));
+    }
+    hash.setField("f0", "updated");
+    ASSERT_TRUE(hash.isPacked());
+    ASSERT_EQ(hash.size(), config.hash_max_entries);
+    hash.setField("overflow", "v");
+    ASSERT_FALSE(hash.isPacked());
+    Value value;
+    ASSERT_TRUE(hash.getField("f0", value));
+    ASSERT_EQ(value, std::string("updated"));
+    ASSERT_EQ(hash.size(), config.hash_max_entries + 1);
+
+    HashItem long_value;
+    long_value.setField("f", std::string(config.hash_max_value + 1, 'x'));
+    ASSERT_FALSE(long_value.isPacked());
+
+    // 字段名与值相同时只匹配字段
+    HashItem tricky;
+    tricky.setField("a", "b");
+    ASSERT_FALSE(tricky.existsField("b"));
+    ASSERT_TRUE(tricky.delField("a"));
+    ASSERT_EQ(tricky.size(), static_cast<size_t>(0));
+
+    SetItem set;
+    for (size_t i = 0; i < config.set_max_entries; ++i) {
+        ASSERT_TRUE(set.sadd("m" + std::to_string(i)));
+    }
+    ASSERT_FALSE(set.sadd("m0"));
+    ASSERT_TRUE(set.isPacked());
+    ASSERT_TRUE(set.sadd("overflow"));
+    ASSERT_FALSE(set.isPacked());
+    ASSERT_EQ(set.scard(), config.set_max_entries + 1);
+    ASSERT_TRUE(set.sismember("m0"));
+
+    ZSetItem zset;
+    for (size_t i = 0; i < config.zset_max_entries; ++i) {
+        zset.zadd("m" + std::to_string(i), static_cast<double>(i % 10));
+    }
+    ASSERT_TRUE(zset.isPacked());
+    auto packed_range = zset.zrange(0, zset.zcard());
+    size_t rank = 0;
+    ASSERT_TRUE(zset.zrank("m5", rank));
+    size_t packed_rank = rank;
+    size_t packed_count = zset.zcount(2, 4);
+    auto packed_rev = zset.zrevrange(3, 20);
+    auto packed_by_score = zset.zrevrangebyscore(6, 3);
+
+    ZSetItem copy(zset);
+    copy.zadd("overflow", 100);
+    ASSERT_FALSE(copy.isPacked());
+    ASSERT_TRUE(zset.isPacked());
+    ASSERT_TRUE(copy.zrem("overflow"));
+    // 转换前后排名与范围查询结果一致
+    ASSERT_TRUE(copy.zrange(0, copy.zcard()) == packed_range);
+    ASSERT_TRUE(copy.zrank("m5", rank));
+    ASSERT_EQ(rank, packed_rank);
+    ASSERT_EQ(copy.zcount(2, 4), packed_count);
+    ASSERT_TRUE(copy.zrevrange(3, 20) == packed_rev);
+    ASSERT_TRUE(copy.zrevrangebyscore(6, 3) == packed_by_score);
+
+    // 同分成员按字典序排列
+    ZSetItem small;
+    small.zadd("b", 1);
+    small.zadd("a", 1);
+    small.zadd("c", 0);
+    auto ordered = small.zrange(0, 10);
+    ASSERT_EQ(ordered[0].first, std::string("c"));
+    ASSERT_EQ(ordered[1].first, std::string("a"));
+    ASSERT_EQ(ordered[2].first, std::string("b"));
+    return true;
+}
+
+// 测试整数集合：宽度随元素升级，插入删除后保持有序，交集与逐个查找的结果一致
+bool testIntSet() {
+    IntSet ints;
+    ASSERT_TRUE(ints.insert(5));
+    ASSERT_TRUE(ints.insert(-3));
+    ASSERT_FALSE(ints.insert(5));
+    ASSERT_EQ(ints.width(), static_cast<uint8_t>(2));
+    ASSERT_TRUE(ints.insert(100000));
+    ASSERT_EQ(ints.width(), static_cast<uint8_t>(4));
+    ASSERT_TRUE(ints.insert(-5000000000LL));
+    ASSERT_EQ(ints.width(), static_cast<uint8_t>(8));
+    ASSERT_EQ(ints.get(0), static_cast<int64_t>(-5000000000LL));
+    ASSERT_EQ(ints.get(3), static_cast<int64_t>(100000));
+    ASSERT_TRUE(ints.erase(-3));
+    ASSERT_FALSE(ints.contains(-3));
+    ASSERT_TRUE(ints.contains(5));
+    ASSERT_EQ(ints.size(), static_cast<size_t>(3));
+
+    // 覆盖各种宽度组合和大小比例（含二分查找路径和不足一块的尾部）
+    std::mt19937_64 rng(7);
+    const int64_t ranges[] = {1000, 1000000, 100000000000LL};
+    const size_t sizes[] = {1, 7, 100, 3000};
+    for (int64_t range_a : ranges) {
+        for (int64_t range_b : ranges) {
+            for (size_t size_a : sizes) {
+                for (size_t size_b : sizes) {
+                    IntSet a;
+                    IntSet b;
+                    for (size_t i = 0; i < size_a; ++i) {
+                        a.insert(static_cast<int64_t>(rng() % (2 * range_a)) - range_a);
+                    }
+                    for (size_t i = 0; i < size_b; ++i) {
+                        b.insert(static_cast<int64_t>(rng() % (2 * range_b)) - range_b);
+                    }
+                    std::vector<int64_t> expected;
+                    for (size_t i = 0; i < a.size(); ++i) {
+                        if (b.contains(a.get(i))) {
+                            expected.push_back(a.get(i));
+                        }
+                    }
+                    std::vector<int64_t> actual;
+                    IntSet::intersect(a, b, actual);
+                    ASSERT_TRUE(actual == expected);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// 测试整数集合编码的转换：加入非整数后转为listpack，超过元素个数上限后转为哈希集合，集合运算结果不变
+bool testSetIntSetEncoding() {
+    const ListpackConfig& config = listpackConfig();
+    SetItem set;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(set.sadd(std::to_string(i * 3)));
+    }
+    ASSERT_TRUE(set.getEncoding() == SetEncoding::INTSET);
+    ASSERT_TRUE(set.sismember("30"));
+    ASSERT_FALSE(set.sismember("030"));
+    ASSERT_TRUE(set.sadd("030"));
+    ASSERT_TRUE(set.getEncoding() == SetEncoding::LISTPACK);
+    ASSERT_TRUE(set.sismember("30"));
+    ASSERT_EQ(set.scard(), static_cast<size_t>(101));
+
+    SetItem large;
+    for (size_t i = 0; i <= config.set_max_intset_entries; ++i) {
+        large.sadd(std::to_string(i));
+    }
+    ASSERT_TRUE(large.getEncoding() == SetEncoding::HASHTABLE);
+    ASSERT_EQ(large.scard(), config.set_max_intset_entries + 1);
+
+    SetItem evens;
+    SetItem small;
+    for (int i = 0; i < 200; i += 2) {
+        evens.sadd(std::to_string(i));
+    }
+    small.sadd({"4", "5", "6", "300"});
+    auto inter = SetItem::combine(SetOp::INTER, {&large, &evens, &small});
+    ASSERT_TRUE(inter->smembers() == std::vector<Value>({"4", "6"}));
+    ASSERT_TRUE(SetItem::combine(SetOp::INTER, {&evens, nullptr})->empty());
+    auto diff = SetItem::combine(SetOp::DIFF, {&small, &evens, nullptr});
+    ASSERT_EQ(diff->scard(), static_cast<size_t>(2));
+    ASSERT_TRUE(diff->sismember("5"));
+    ASSERT_TRUE(diff->sismember("300"));
+    auto both = SetItem::combine(SetOp::UNION, {&set, &small});
+    ASSERT_EQ(both->scard(), static_cast<size_t>(104));
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV Listpack功能测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("Listpack基本功能", testListpackBasic);
+    runner.runTest("Listpack随机操作", testListpackRandomOps);
+    runner.runTest("小集合紧凑编码", testCompactCollections);
+    runner.runTest("整数集合", testIntSet);
+    runner.runTest("集合的整数编码与运算", testSetIntSetEncoding);
+
+    runner.printSummary();
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "dkv_load_generator.hpp"
+#include "dkv_logger.hpp"
+#include "dkv_server.hpp"
+#include "test_runner.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace dkv {
+
+namespace {
+
+constexpr int TEST_PORT = 6403;
+
+LoadGenerator::ReplyStatus parse(const std::string& data, size_t& pos, bool& is_error) {
+    pos = 0;
+    return LoadGenerator::parseReply(data, pos, is_error);
+}
+
+} // namespace
+
+// 测试各类回复的解析，包括不完整和嵌套的回复
+bool testParseReply() {
+    using ReplyStatus = LoadGenerator::ReplyStatus;
+    size_t pos = 0;
+    bool is_error = false;
+    bool ok = true;
+    ok = ok && parse("+OK\r\n", pos, is_error) == ReplyStatus::COMPLETE && pos == 5 && !is_error;
+    ok = ok && parse("-ERR wrong\r\n+OK\r\n", pos, is_error) == ReplyStatus::COMPLETE && pos == 12 && is_error;
+    ok = ok && parse("$5\r\nhel", pos, is_error) == ReplyStatus::INCOMPLETE && pos == 0;
+    ok = ok && parse("$-1\r\n", pos, is_error) == ReplyStatus::COMPLETE && pos == 5;
+    ok = ok && parse("*2\r\n$1\r\na\r\n*1\r\n:1\r\n", pos, is_error) == ReplyStatus::COMPLETE && pos == 19;
+    ok = ok && parse("*2\r\n$1\r\na\r\n", pos, is_error) == ReplyStatus::INCOMPLETE;
+    ok = ok && parse("?what\r\n", pos, is_error) == ReplyStatus::INVALID;
+    ok = ok && parse("$abc\r\n", pos, is_error) == ReplyStatus::INVALID;
+    ASSERT_TRUE(ok);
+    return ok;
+}
+
+// 测试命令组合的解析：名称不区分大小写，省略权重时为1，拒绝未知命令和无效权重
+bool testParseMix() {
+    std::vector<CommandMixEntry> mix;
+    std::string error;
+    bool parsed = LoadGenerator::parseMix("GET:9,set,zadd:0", mix, error);
+    bool ok = parsed && mix.size() == 3 && mix[0].name == "get" && mix[0].weight == 9 && mix[1].name == "set" &&
+              mix[1].weight == 1 && mix[2].weight == 0;
+    ok = ok && !LoadGenerator::parseMix("get:1,flushall:1", mix, error) && !error.empty();
+    ok = ok && !LoadGenerator::parseMix("get:x", mix, error);
+    ok = ok && !LoadGenerator::parseMix("", mix, error);
+    ASSERT_TRUE(ok);
+    return ok;
+}
+
+// 测试键的分布：均匀分布没有明显的热点，Zipf分布的最热键占约一成访问
+bool testKeyDistribution() {
+    const uint64_t KEYSPACE = 10000;
+    const int DRAWS = 200000;
+    auto hottest = [&](KeyDistribution distribution, bool& in_range) {
+        KeyGenerator keys(KEYSPACE, distribution, KeyGenerator::DEFAULT_ZIPF_THETA, 42);
+        std::vector<int> counts(KEYSPACE, 0);
+        in_range = true;
+        for (int i = 0; i < DRAWS; ++i) {
+            uint64_t key = keys.next();
+            if (key >= KEYSPACE) {
+                in_range = false;
+                return 0.0;
+            }
+            counts[key]++;
+        }
+        return *std::max_element(counts.begin(), counts.end()) / static_cast<double>(DRAWS);
+    };
+    bool uniform_in_range = false;
+    bool zipf_in_range = false;
+    double uniform_hottest = hottest(KeyDistribution::UNIFORM, uniform_in_range);
+    double zipf_hottest = hottest(KeyDistribution::ZIPFIAN, zipf_in_range);
+    bool ok = uniform_in_range && zipf_in_range && uniform_hottest < 0.001 && zipf_hottest > 0.05;
+    ASSERT_TRUE(ok);
+    return ok;
+}
+
+// 测试对服务器执行混合命令的压测：所有请求都收到回复且没有错误
+bool testRunAgainstServer() {
+    DKVServer server(TEST_PORT, 2, 2);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    if (!server.start()) {
+        return false;
+    }
+    LoadConfig config;
+    config.port = TEST_PORT;
+    config.connections = 4;
+    config.threads = 2;
+    config.pipeline = 8;
+    config.requests = 2000;
+    config.keyspace = 100;
+    config.value_size = 8;
+    config.value_size_max = 128;
+    config.preload = true;
+    std::string error;
+    LoadGenerator::parseMix("get:4,set:2,incr,lpush,rpop,sadd,hset,hget,zadd,pfadd", config.mix, error);
+    LoadGenerator generator(config);
+    LoadReport report;
+    bool ran = generator.run(report);
+
+    uint64_t per_command = 0;
+    for (const auto& command : report.commands) {
+        per_command += command.latency->count();
+    }
+    LoadConfig timed = config;
+    timed.duration_seconds = 0.2;
+    timed.distribution = KeyDistribution::ZIPFIAN;
+    LoadGenerator timed_generator(timed);
+    LoadReport timed_report;
+    bool timed_ran = timed_generator.run(timed_report);
+    server.stop();
+
+    bool ok = ran && report.requests == 2000 && report.errors == 0 && report.failed_connections == 0 &&
+              per_command == 2000 && report.commands.size() == config.mix.size() && report.latency.max() > 0 &&
+              report.format(generator.config()).find("p99.9=") != std::string::npos;
+    ok = ok && timed_ran && timed_report.requests > 0 && timed_report.errors == 0 &&
+         timed_report.elapsed_seconds >= 0.2;
+    ASSERT_TRUE(ok);
+    return ok;
+}
+
+// 测试服务器不可达时返回错误
+bool testConnectFailure() {
+    LoadConfig config;
+    config.port = TEST_PORT;
+    config.connections = 1;
+    LoadGenerator generator(config);
+    LoadReport report;
+    bool ok = !generator.run(report) && !generator.error().empty();
+    ASSERT_TRUE(ok);
+    return ok;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 压测工具测试\n" << std::endl;
+
+    Logger::getInstance().setConsoleOutput(false);
+    TestRunner runner;
+
+    runner.runTest("回复解析", testParseReply);
+    runner.runTest("命令组合解析", testParseMix);
+    runner.runTest("键的分布", testKeyDistribution);
+    runner.runTest("对服务器压测", testRunAgainstServer);
+    runner.runTest("服务器不可达", testConnectFailure);
+
+    Logger::getInstance().setConsoleOutput(true);
+    runner.printSummary();
+
+    return 0;
+}
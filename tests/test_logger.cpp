@@ -0,0 +1,162 @@
+#include "dkv_logger.hpp"
+#include "test_runner.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dkv {
+
+namespace {
+
+const char* LOG_FILE = "test_logger.log";
+
+std::vector<std::string> readLines() {
+    std::vector<std::string> lines;
+    std::ifstream in(LOG_FILE);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+void resetLogFile() {
+    Logger::getInstance().closeLogFile();
+    std::remove(LOG_FILE);
+    Logger::getInstance().setLogFile(LOG_FILE);
+}
+
+} // namespace
+
+// 测试多个线程并发写日志，flush后全部写出且各线程内保持顺序
+bool testAsyncLogging() {
+    resetLogFile();
+    const int THREADS = 4;
+    const int PER_THREAD = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                DKV_LOG_INFO("thread ", t, " seq ", i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    Logger::getInstance().flush();
+
+    std::vector<int> next(THREADS, 0);
+    size_t count = 0;
+    for (const auto& line : readLines()) {
+        size_t pos = line.find("thread ");
+        if (pos == std::string::npos) {
+            continue;
+        }
+        int t = 0;
+        int seq = 0;
+        if (std::sscanf(line.c_str() + pos, "thread %d seq %d", &t, &seq) != 2 || t < 0 || t >= THREADS) {
+            return false;
+        }
+        ASSERT_EQ(seq, next[t]);
+        if (seq != next[t]) {
+            return false;
+        }
+        next[t]++;
+        count++;
+    }
+    ASSERT_EQ(count, static_cast<size_t>(THREADS * PER_THREAD));
+    return count == static_cast<size_t>(THREADS * PER_THREAD);
+}
+
+// 测试错误日志返回前已写出，不需要flush
+bool testErrorWrittenBeforeReturn() {
+    resetLogFile();
+    DKV_LOG_ERROR("error written synchronously");
+    std::vector<std::string> lines = readLines();
+    bool found = !lines.empty() && lines.back().find("error written synchronously") != std::string::npos;
+    ASSERT_TRUE(found);
+    return found;
+}
+
+// 测试DROP策略：缓冲区满时丢弃并计数，写出的条数与丢弃的条数之和等于写入的条数
+bool testDropPolicy() {
+    resetLogFile();
+    Logger& logger = Logger::getInstance();
+    uint64_t dropped_before = logger.droppedCount();
+    logger.setOverflowPolicy(LogOverflowPolicy::DROP);
+    logger.setBufferEntries(4);
+    const int TOTAL = 20000;
+    std::thread producer([] {
+        for (int i = 0; i < TOTAL; ++i) {
+            DKV_LOG_WARNING("drop test ", i);
+        }
+    });
+    producer.join();
+    logger.flush();
+    logger.setOverflowPolicy(LogOverflowPolicy::BLOCK);
+    logger.setBufferEntries(Logger::DEFAULT_BUFFER_ENTRIES);
+
+    size_t written = 0;
+    for (const auto& line : readLines()) {
+        if (line.find("drop test ") != std::string::npos) {
+            written++;
+        }
+    }
+    uint64_t dropped = logger.droppedCount() - dropped_before;
+    ASSERT_EQ(written + dropped, static_cast<uint64_t>(TOTAL));
+    return written + dropped == static_cast<uint64_t>(TOTAL);
+}
+
+// 测试同步模式直接写出，切换模式不丢日志
+bool testSyncMode() {
+    resetLogFile();
+    Logger& logger = Logger::getInstance();
+    DKV_LOG_INFO("before switch");
+    logger.setAsync(false);
+    DKV_LOG_INFO("sync entry");
+    std::vector<std::string> lines = readLines();
+    logger.setAsync(true);
+    bool ok = lines.size() == 2 && lines[0].find("before switch") != std::string::npos &&
+              lines[1].find("sync entry") != std::string::npos;
+    ASSERT_TRUE(ok);
+    return ok;
+}
+
+// 测试编译期去掉的日志等级不求值参数
+bool testCompileTimeStripping() {
+    int evaluated = 0;
+    auto touch = [&evaluated] { return ++evaluated; };
+    DKV_LOG_DEBUG("stripped ", touch());
+    DKV_LOG_INFO("kept ", touch());
+    int expected = DKV_LOG_MIN_LEVEL <= 0 ? 2 : 1;
+    ASSERT_EQ(evaluated, expected);
+    return evaluated == expected;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 异步日志功能测试\n" << std::endl;
+
+    Logger::getInstance().setConsoleOutput(false);
+    TestRunner runner;
+
+    runner.runTest("多线程异步日志", testAsyncLogging);
+    runner.runTest("错误日志同步写出", testErrorWrittenBeforeReturn);
+    runner.runTest("缓冲区满时丢弃", testDropPolicy);
+    runner.runTest("同步模式", testSyncMode);
+    runner.runTest("编译期去掉DEBUG日志", testCompileTimeStripping);
+
+    Logger::getInstance().closeLogFile();
+    std::remove("test_logger.log");
+    Logger::getInstance().setConsoleOutput(true);
+    runner.printSummary();
+
+    return 0;
+}
@@ -93,6 +93,14 @@ void testMaxMemory(dkv::TestRunner& runner) {
                 return exists_response.find("$1\r\n1") != std::string::npos;
             });
             
+            // 不会占用更多内存的写命令在内存限制下仍可执行
+            runner.runTest("验证EXPIRE和LPOP命令在内存限制下仍可执行", [&]() {
+                std::string expire_response = sendMemCommand("EXPIRE key0 1000\r\n");
+                std::string lpop_response = sendMemCommand("LPOP missing_list\r\n");
+                std::cout << "内存限制下EXPIRE响应: " << expire_response << "LPOP响应: " << lpop_response << std::endl;
+                return expire_response.find("OOM") == std::string::npos && lpop_response.find("OOM") == std::string::npos;
+            });
+            
             // 验证INFO命令在内存限制下仍可工作并显示内存使用情况
             runner.runTest("验证INFO命令显示内存使用情况", [&]() {
                 std::string info_response = sendMemCommand("INFO\r\n");
@@ -1,9 +1,12 @@
 #include "dkv_memory_allocator.hpp"
+#include "dkv_page_memory.hpp"
+#include "storage/dkv_storage.hpp"
 #include <iostream>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <cassert>
+#include <thread>
 
 // 简单的测试类，用于测试TrackedDeleter
 class TestClass {
@@ -164,7 +167,163 @@ int main() {
     }
     assert(dkv::MemoryAllocator::getInstance().getTotalDeallocations() == NUM_ALLOCS && "总释放次数应为10");
     
-    std::cout << "\n6. 打印详细统计信息\n";
+    std::cout << "\n6. 测试多线程计数\n";
+    
+    // 各线程的本地计数在线程退出时合并，分配与释放相抵后用量应回到初始值
+    dkv::MemoryAllocator::getInstance().resetStats();
+    {
+        const int NUM_THREADS = 4;
+        const int ALLOCS_PER_THREAD = 10000;
+        std::vector<std::thread> threads;
+        threads.reserve(NUM_THREADS);
+        size_t usage_before = dkv::MemoryAllocator::getInstance().getCurrentUsage();
+        uint64_t allocs_before = dkv::MemoryAllocator::getInstance().getTotalAllocations();
+        for (int t = 0; t < NUM_THREADS; ++t) {
+            threads.emplace_back([ALLOCS_PER_THREAD]() {
+                for (int i = 0; i < ALLOCS_PER_THREAD; ++i) {
+                    void* p = dkv::MemoryAllocator::getInstance().allocate(32, "thread_block");
+                    dkv::MemoryAllocator::getInstance().deallocate(p);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::cout << "多线程分配释放后内存使用量: " << dkv::MemoryAllocator::getInstance().getCurrentUsage() << " 字节\n";
+        assert(dkv::MemoryAllocator::getInstance().getTotalAllocations() >= allocs_before + NUM_THREADS * ALLOCS_PER_THREAD && "线程退出后其分配次数应合并到全局");
+        // 用量只应包含线程对象本身等少量内存
+        assert(dkv::MemoryAllocator::getInstance().getCurrentUsage() < usage_before + 4096 && "分配与释放相抵后用量不应增长");
+    }
+    
+    std::cout << "\n7. 测试调试模式\n";
+    
+    dkv::MemoryAllocator::getInstance().setDebugTracking(true);
+    void* debug_ptr = dkv::MemoryAllocator::getInstance().allocate(128, "debug_block");
+    std::string debug_stats = dkv::MemoryAllocator::getInstance().getStats();
+    assert(debug_stats.find("debug_block:1(128B)") != std::string::npos && "调试模式下应按类型统计内存块");
+    dkv::MemoryAllocator::getInstance().deallocate(debug_ptr);
+    debug_stats = dkv::MemoryAllocator::getInstance().getStats();
+    assert(debug_stats.find("debug_block") == std::string::npos && "释放后调试映射表中不应再有该内存块");
+    dkv::MemoryAllocator::getInstance().setDebugTracking(false);
+    
+    std::cout << "\n8. 测试slab分配器\n";
+    
+    assert(dkv::SlabAllocator::classIndex(1) == 0 && dkv::SlabAllocator::classIndex(16) == 0 && "1~16字节属于第一个大小级别");
+    assert(dkv::SlabAllocator::classSize(dkv::SlabAllocator::classIndex(17)) == 32 && "17字节应向上取整到32字节");
+    assert(dkv::SlabAllocator::classSize(dkv::SlabAllocator::classIndex(200)) == 224 && "200字节应向上取整到224字节");
+    assert(dkv::SlabAllocator::classSize(dkv::SlabAllocator::classIndex(512)) == 512 && "512字节属于最后一个大小级别");
+    {
+        dkv::SlabAllocator& slab = dkv::SlabAllocator::getInstance();
+        std::vector<void*> objects;
+        objects.reserve(1000);
+        size_t usage_before = dkv::MemoryAllocator::getInstance().getCurrentUsage();
+        for (int i = 0; i < 1000; ++i) {
+            void* p = slab.allocate(40);
+            assert(reinterpret_cast<uintptr_t>(p) % 16 == 0 && "slab对象应按16字节对齐");
+            objects.push_back(p);
+        }
+        // 40字节的对象按48字节计入用量，另有少量slab记录表开销
+        size_t usage_allocated = dkv::MemoryAllocator::getInstance().getCurrentUsage();
+        assert(usage_allocated >= usage_before + 1000 * 48 && usage_allocated < usage_before + 1000 * 48 + 1024 && "slab对象应按大小级别计入用量");
+        assert(slab.getSlabCount() >= 1 && "分配后至少有一个slab");
+        for (void* p : objects) {
+            slab.deallocate(p, 40);
+        }
+        assert(dkv::MemoryAllocator::getInstance().getCurrentUsage() == usage_allocated - 1000 * 48 && "释放slab对象后用量应回落");
+        usage_before = dkv::MemoryAllocator::getInstance().getCurrentUsage();
+        
+        // 释放的对象被复用，不再申请新的slab
+        size_t slabs_before = slab.getSlabCount();
+        for (int i = 0; i < 1000; ++i) {
+            objects[i] = slab.allocate(48);
+        }
+        assert(slab.getSlabCount() == slabs_before && "空闲对象应被复用");
+        for (void* p : objects) {
+            slab.deallocate(p, 48);
+        }
+        
+        // 其它线程释放的对象归还到全局空闲链表
+        std::thread worker([&objects]() {
+            for (int i = 0; i < 1000; ++i) {
+                objects[i] = dkv::SlabAllocator::getInstance().allocate(100);
+            }
+        });
+        worker.join();
+        for (void* p : objects) {
+            slab.deallocate(p, 100);
+        }
+        // 仅剩新slab的记录表开销
+        assert(dkv::MemoryAllocator::getInstance().getCurrentUsage() < usage_before + 1024 && "跨线程释放后用量应回落");
+        std::cout << slab.getStats();
+    }
+    
+    std::cout << "\n9. 测试大页与NUMA分区\n";
+    
+    dkv::PageMemory::configure(dkv::HugePageMode::TRANSPARENT, true);
+    assert(dkv::PageMemory::currentNode() < dkv::PageMemory::nodeCount() && "线程所在节点应在节点数之内");
+    {
+        const size_t mapped_before = dkv::PageMemory::stats().mapped_bytes;
+        const size_t bytes = 3 * 1024 * 1024;
+        char* region = static_cast<char*>(dkv::PageMemory::map(bytes, 0));
+        assert(region != nullptr && "页内存映射应成功");
+        assert(reinterpret_cast<uintptr_t>(region) % dkv::PageMemory::HUGE_PAGE_SIZE == 0 && "大页模式下映射应按2MB对齐");
+        assert(dkv::PageMemory::mappedSize(bytes) == 2 * dkv::PageMemory::HUGE_PAGE_SIZE && "大页模式下按2MB取整");
+        assert(dkv::PageMemory::stats().mapped_bytes == mapped_before + 2 * dkv::PageMemory::HUGE_PAGE_SIZE && "映射应计入统计");
+        region[0] = 1;
+        region[bytes - 1] = 2;
+        dkv::PageMemory::unmap(region, bytes);
+        assert(dkv::PageMemory::stats().mapped_bytes == mapped_before && "释放后统计应回落");
+        
+        // 之后的新slab从页内存块中切分
+        std::vector<void*> objects;
+        for (int i = 0; i < 2000; ++i) {
+            objects.push_back(dkv::SlabAllocator::getInstance().allocate(500));
+        }
+        assert(dkv::PageMemory::stats().mapped_bytes >= mapped_before + dkv::SlabAllocator::CHUNK_SIZE && "新slab应来自页内存");
+        for (void* p : objects) {
+            dkv::SlabAllocator::getInstance().deallocate(p, 500);
+        }
+        dkv::PageMemoryStats pages = dkv::PageMemory::stats();
+        std::cout << "huge_pages:" << dkv::PageMemory::hugePageModeName(dkv::PageMemory::hugePageMode())
+                  << " nodes:" << dkv::PageMemory::nodeCount() << " mapped_bytes:" << pages.mapped_bytes
+                  << " huge_page_bytes:" << pages.huge_page_bytes << "\n";
+    }
+    
+    std::cout << "\n10. 测试主动碎片整理\n";
+    
+    {
+        dkv::SlabAllocator& slab = dkv::SlabAllocator::getInstance();
+        dkv::StorageEngine storage;
+        const int keys = 20000;
+        for (int i = 0; i < keys; ++i) {
+            storage.set(dkv::NO_TX, "defrag:" + std::to_string(i), "v" + std::to_string(i));
+        }
+        // 删除大部分键，剩下的数据项分散在各个slab中
+        for (int i = 0; i < keys; ++i) {
+            if (i % 10 != 0) {
+                storage.del(dkv::NO_TX, "defrag:" + std::to_string(i));
+            }
+        }
+        storage.purgeVersions(1 << 20);
+        const size_t slabs_before = slab.getSlabCount();
+        const double ratio_before = slab.getFragmentationRatio();
+        for (int pass = 0; pass < 8; ++pass) {
+            while (storage.activeDefragCycle(std::chrono::seconds(1))) {
+            }
+        }
+        dkv::DefragStats stats = storage.getDefragStats();
+        assert(stats.relocated > 0 && "稀疏slab中的数据项应被搬移");
+        assert(stats.passes == 8 && "每次遍历完整个键空间计为一轮");
+        assert(slab.getSlabCount() < slabs_before && "腾空的slab应归还系统");
+        assert(slab.getFragmentationRatio() < ratio_before && "碎片整理后碎片率应下降");
+        for (int i = 0; i < keys; i += 10) {
+            assert(storage.get(dkv::NO_TX, "defrag:" + std::to_string(i)) == "v" + std::to_string(i) && "搬移后值不变");
+        }
+        std::cout << "slabs:" << slabs_before << "->" << slab.getSlabCount() << " ratio:" << ratio_before << "->"
+                  << slab.getFragmentationRatio() << " relocated:" << stats.relocated << "\n";
+    }
+    
+    std::cout << "\n11. 打印详细统计信息\n";
     std::cout << dkv::MemoryAllocator::getInstance().getStats() << std::endl;
     
     std::cout << "\n=== 所有测试通过! ===\n";
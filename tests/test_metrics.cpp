@@ -0,0 +1,150 @@
+#include "dkv_metrics.hpp"
+#include "dkv_server.hpp"
+#include "test_runner.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace dkv {
+
+namespace {
+
+// 发送一个HTTP请求，返回完整回复
+std::string httpGet(int port, const std::string& request_line) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (sock < 0 || connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        if (sock >= 0) {
+            close(sock);
+        }
+        return "";
+    }
+    struct timeval timeout{2, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string request = request_line + "\r\nHost: localhost\r\n\r\n";
+    send(sock, request.data(), request.size(), 0);
+    std::string response;
+    char buffer[4096];
+    while (true) {
+        ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        response.append(buffer, static_cast<size_t>(n));
+    }
+    close(sock);
+    return response;
+}
+
+bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+} // namespace
+
+// 测试注册表按Prometheus文本格式输出各类指标
+bool testRender() {
+    MetricsRegistry registry;
+    HdrHistogram histogram;
+    histogram.record(10);
+    histogram.record(20);
+    registry.addCounter("test_requests_total", "Requests", []() { return 42.0; });
+    registry.addGauge("test_queue_depth", "Queue depth", []() { return 3.0; });
+    registry.addFamily("test_clients", "Clients", MetricType::GAUGE, [](std::vector<MetricSample>& samples) {
+        samples.push_back(MetricSample{"", "reactor=\"0\"", 1});
+        samples.push_back(MetricSample{"", "reactor=\"1\"", 2});
+    });
+    registry.addSummary("test_latency", "Latency", histogram);
+    std::string text = registry.render();
+    bool ok = contains(text, "# HELP test_requests_total Requests\n# TYPE test_requests_total counter\n"
+                             "test_requests_total 42\n") &&
+              contains(text, "# TYPE test_queue_depth gauge\ntest_queue_depth 3\n") &&
+              contains(text, "test_clients{reactor=\"0\"} 1\ntest_clients{reactor=\"1\"} 2\n") &&
+              contains(text, "# TYPE test_latency summary\n") && contains(text, "test_latency{quantile=\"0.5\"} 10\n") &&
+              contains(text, "test_latency_sum 30\ntest_latency_count 2\n");
+    ASSERT_TRUE(ok);
+    return ok;
+}
+
+// 测试导出端口：GET /metrics返回指标，其他路径和方法返回错误
+bool testExporter() {
+    MetricsRegistry registry;
+    registry.addCounter("test_scrapes_total", "Scrapes", []() { return 7.0; });
+    MetricsExporter exporter(registry);
+    if (!exporter.start(0)) {
+        return false;
+    }
+    std::string metrics = httpGet(exporter.port(), "GET /metrics HTTP/1.1");
+    std::string missing = httpGet(exporter.port(), "GET /other HTTP/1.1");
+    std::string post = httpGet(exporter.port(), "POST /metrics HTTP/1.1");
+    exporter.stop();
+    bool ok = contains(metrics, "HTTP/1.1 200 OK\r\n") && contains(metrics, "text/plain; version=0.0.4") &&
+              contains(metrics, "\r\n\r\n# HELP test_scrapes_total") && contains(metrics, "test_scrapes_total 7\n") &&
+              contains(missing, "HTTP/1.1 404") && contains(post, "HTTP/1.1 405");
+    ASSERT_TRUE(ok);
+    return ok;
+}
+
+// 测试服务器导出的指标反映命令执行和连接
+bool testServerMetrics() {
+    DKVServer server(6401, 2, 2);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    server.setMetricsPort(6402);
+    if (!server.start()) {
+        return false;
+    }
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(6401);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    bool connected = sock >= 0 && connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    if (connected) {
+        const std::string cmd = "SET metrics_key v\r\n";
+        send(sock, cmd.data(), cmd.size(), 0);
+        char buffer[64];
+        while (recv(sock, buffer, sizeof(buffer), 0) < 0 && errno == EINTR) {
+        }
+    }
+    std::string metrics = httpGet(server.getMetricsPort(), "GET /metrics HTTP/1.1");
+    if (sock >= 0) {
+        close(sock);
+    }
+    server.stop();
+    bool ok = connected && server.getMetricsPort() == 0 && contains(metrics, "dkv_commands_total{cmd=\"set\"} 1\n") &&
+              contains(metrics, "dkv_connections_received_total 1\n") &&
+              contains(metrics, "dkv_connected_clients{reactor=") && contains(metrics, "dkv_worker_queue_depth ") &&
+              contains(metrics, "dkv_mvcc_max_chain_length ") && contains(metrics, "dkv_memory_used_bytes ") &&
+              contains(metrics, "dkv_evicted_keys_total 0\n") && contains(metrics, "dkv_expired_keys_total ");
+    ASSERT_TRUE(ok);
+    return ok;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 监控指标导出测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("Prometheus文本格式", testRender);
+    runner.runTest("HTTP导出端口", testExporter);
+    runner.runTest("服务器指标", testServerMetrics);
+
+    runner.printSummary();
+
+    return 0;
+}
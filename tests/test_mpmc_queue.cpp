@@ -0,0 +1,179 @@
+#include "dkv_mpmc_queue.hpp"
+#include "dkv_mpsc_queue.hpp"
+#include "test_runner.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+namespace dkv {
+
+// 测试单线程下的先进先出、满队列与空队列
+bool testMPMCQueueBasic() {
+    BoundedMPMCQueue<std::string> queue(5);
+    ASSERT_EQ(queue.capacity(), static_cast<size_t>(8));
+    ASSERT_TRUE(queue.empty());
+
+    std::string value;
+    ASSERT_FALSE(queue.tryPop(value));
+
+    for (int i = 0; i < 8; ++i) {
+        std::string item = "item" + std::to_string(i);
+        ASSERT_TRUE(queue.tryPush(std::move(item)));
+    }
+    ASSERT_EQ(queue.sizeApprox(), static_cast<size_t>(8));
+
+    // 队列已满时入队失败，元素保持不变
+    std::string extra = "extra";
+    ASSERT_FALSE(queue.tryPush(std::move(extra)));
+    ASSERT_EQ(extra, std::string("extra"));
+
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(queue.tryPop(value));
+        ASSERT_EQ(value, "item" + std::to_string(i));
+    }
+    ASSERT_TRUE(queue.empty());
+    ASSERT_FALSE(queue.tryPop(value));
+
+    // 位置绕回后仍可正常使用
+    for (int round = 0; round < 100; ++round) {
+        std::string item = std::to_string(round);
+        ASSERT_TRUE(queue.tryPush(std::move(item)));
+        ASSERT_TRUE(queue.tryPop(value));
+        ASSERT_EQ(value, std::to_string(round));
+    }
+    return true;
+}
+
+// 测试多生产者多消费者下每个元素恰好被取出一次
+bool testMPMCQueueConcurrent() {
+    const int PRODUCERS = 4;
+    const int CONSUMERS = 4;
+    const int PER_PRODUCER = 100000;
+    BoundedMPMCQueue<int> queue(256);
+    std::vector<std::atomic<int>> seen(PRODUCERS * PER_PRODUCER);
+    for (auto& count : seen) {
+        count.store(0);
+    }
+    std::atomic<int> consumed{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < PER_PRODUCER; ++i) {
+                int value = p * PER_PRODUCER + i;
+                while (!queue.tryPush(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < CONSUMERS; ++c) {
+        threads.emplace_back([&]() {
+            int value;
+            while (consumed.load() < PRODUCERS * PER_PRODUCER) {
+                if (queue.tryPop(value)) {
+                    seen[value].fetch_add(1);
+                    consumed.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_TRUE(queue.empty());
+    for (auto& count : seen) {
+        ASSERT_EQ(count.load(), 1);
+    }
+    return true;
+}
+
+// 测试MPSC队列按入队顺序取出，且只有空队列上的入队返回true
+bool testMPSCQueueBasic() {
+    MPSCQueue<std::string> queue;
+    ASSERT_TRUE(queue.empty());
+    ASSERT_TRUE(queue.push("a"));
+    ASSERT_FALSE(queue.push("b"));
+    ASSERT_FALSE(queue.push("c"));
+
+    std::vector<std::string> taken;
+    size_t count = queue.consumeAll([&](std::string& value) { taken.push_back(std::move(value)); });
+    ASSERT_EQ(count, static_cast<size_t>(3));
+    ASSERT_EQ(taken.size(), static_cast<size_t>(3));
+    ASSERT_EQ(taken[0], std::string("a"));
+    ASSERT_EQ(taken[2], std::string("c"));
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(queue.consumeAll([](std::string&) {}), static_cast<size_t>(0));
+
+    // 取走后再次入队重新需要唤醒
+    ASSERT_TRUE(queue.push("d"));
+    return true;
+}
+
+// 测试多生产者并发入队时每个元素恰好取出一次，且同一生产者的元素保持顺序
+bool testMPSCQueueConcurrent() {
+    const int PRODUCERS = 4;
+    const int PER_PRODUCER = 100000;
+    MPSCQueue<int> queue;
+    std::vector<int> last(PRODUCERS, -1);
+    std::atomic<int> finished{0};
+    bool ordered = true;
+    int consumed = 0;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < PER_PRODUCER; ++i) {
+                queue.push(p * PER_PRODUCER + i);
+            }
+            finished.fetch_add(1);
+        });
+    }
+    auto take = [&](int& value) {
+        int producer = value / PER_PRODUCER;
+        int seq = value % PER_PRODUCER;
+        if (seq != last[producer] + 1) {
+            ordered = false;
+        }
+        last[producer] = seq;
+        consumed++;
+    };
+    while (finished.load() < PRODUCERS) {
+        if (queue.consumeAll(take) == 0) {
+            std::this_thread::yield();
+        }
+    }
+    queue.consumeAll(take);
+    for (auto& thread : producers) {
+        thread.join();
+    }
+
+    ASSERT_TRUE(ordered);
+    ASSERT_EQ(consumed, PRODUCERS * PER_PRODUCER);
+    ASSERT_TRUE(queue.empty());
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 无锁任务队列功能测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("MPMC队列基本功能", testMPMCQueueBasic);
+    runner.runTest("MPMC队列并发读写", testMPMCQueueConcurrent);
+    runner.runTest("MPSC队列基本功能", testMPSCQueueBasic);
+    runner.runTest("MPSC队列并发入队", testMPSCQueueConcurrent);
+
+    runner.printSummary();
+
+    return 0;
+}
@@ -1,7 +1,9 @@
 #include "transaction/dkv_mvcc.hpp"
 #include "storage/dkv_storage.hpp"
 #include "datatypes/dkv_datatype_string.hpp"
+#include "datatypes/dkv_datatype_hash.hpp"
 #include "test_runner.hpp"
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include <iostream>
@@ -117,7 +119,7 @@ bool testMVCCReadViewVisibility() {
     clog << "read_view.low: " << read_view.low << endl;
     clog << "read_view.high: " << read_view.high << endl;
     clog << "active_transactions: " << endl;
-    for (auto tx_id : read_view.actives) {
+    for (auto tx_id : *read_view.actives) {
         clog << tx_id << " ";
     }
     clog << endl;
@@ -191,6 +193,351 @@ bool testMVCCUndoLog() {
     return true;
 }
 
+bool testMVCCReadViewSnapshot() {
+    StorageEngine engine;
+    TransactionManager tx_manager(&engine, TransactionIsolationLevel::READ_COMMITTED);
+    std::vector<TransactionID> tx_ids;
+    for (int i = 0; i < 100; ++i) {
+        tx_ids.push_back(tx_manager.begin());
+    }
+    // 没有事务开始或结束时，读取视图共享同一份活跃事务快照
+    ReadView view1 = tx_manager.createReadView(NO_TX);
+    ReadView view2 = tx_manager.createReadView(tx_ids[10]);
+    ASSERT_TRUE(view1.actives.get() == view2.actives.get());
+    ASSERT_EQ(view1.actives->size(), static_cast<size_t>(100));
+    ASSERT_TRUE(std::is_sorted(view1.actives->begin(), view1.actives->end()));
+    ASSERT_EQ(view1.low, tx_ids.front());
+    ASSERT_FALSE(view1.isVisible(tx_ids[10]));
+    ASSERT_TRUE(view2.isVisible(tx_ids[10]));
+
+    // 提交后发布新快照，已创建的读取视图不受影响
+    tx_manager.commit(tx_ids[10]);
+    tx_manager.rollback(tx_ids[20]);
+    ReadView view3 = tx_manager.createReadView(NO_TX);
+    ASSERT_TRUE(view3.actives.get() != view1.actives.get());
+    ASSERT_FALSE(view1.isVisible(tx_ids[10]));
+    ASSERT_TRUE(view3.isVisible(tx_ids[10]));
+    // 已回滚的事务仍不可见
+    ASSERT_FALSE(view3.isVisible(tx_ids[20]));
+    ASSERT_EQ(view3.actives->size(), static_cast<size_t>(99));
+
+    for (TransactionID tx_id : tx_ids) {
+        if (tx_manager.isActive(tx_id)) {
+            tx_manager.commit(tx_id);
+        }
+    }
+    tx_manager.forgetRolledbackTransactions({tx_ids[20]});
+    ReadView view4 = tx_manager.createReadView(NO_TX);
+    ASSERT_TRUE(view4.actives->empty());
+    ASSERT_EQ(view4.low, view4.high);
+    ASSERT_TRUE(view4.isVisible(tx_ids.back()));
+    ASSERT_FALSE(view4.isVisible(view4.high));
+    return true;
+}
+
+// 版本链长度（含最新版本）
+static size_t chainLength(DataItem* item) {
+    size_t length = 0;
+    while (item != nullptr) {
+        length++;
+        const auto& undo_log = item->getUndoLog();
+        item = undo_log ? undo_log->old_value.get() : nullptr;
+    }
+    return length;
+}
+
+// 第n个版本（0为最新版本）
+static StringItem* versionAt(DataItem* item, size_t n) {
+    for (size_t i = 0; i < n && item != nullptr; ++i) {
+        const auto& undo_log = item->getUndoLog();
+        item = undo_log ? undo_log->old_value.get() : nullptr;
+    }
+    return static_cast<StringItem*>(item);
+}
+
+bool testMVCCPurgeCommitted() {
+    StorageEngine engine;
+    auto& tx_manager = engine.getTransactionManager();
+    for (int i = 0; i < 5; ++i) {
+        TransactionID tx_id = tx_manager->begin();
+        engine.set(tx_id, "purge_key", "v" + std::to_string(i));
+        tx_manager->commit(tx_id);
+    }
+    // 5个版本加首次写入时的删除标记
+    ASSERT_EQ(chainLength(engine.getDataItem(NO_TX, "purge_key")), static_cast<size_t>(6));
+
+    // 没有活跃事务，历史版本全部可以释放
+    ASSERT_EQ(engine.purgeVersions(1 << 20), static_cast<size_t>(5));
+    DataItem* head = engine.getDataItem(NO_TX, "purge_key");
+    ASSERT_EQ(chainLength(head), static_cast<size_t>(1));
+    ASSERT_EQ(versionAt(head, 0)->getValue(), "v4");
+    ASSERT_EQ(engine.get(NO_TX, "purge_key"), "v4");
+
+    MVCCStats stats = engine.getMVCCStats();
+    ASSERT_EQ(stats.purged_versions, static_cast<uint64_t>(5));
+    ASSERT_EQ(stats.purge_passes, static_cast<uint64_t>(1));
+    ASSERT_EQ(stats.history_versions, static_cast<size_t>(0));
+    ASSERT_EQ(stats.max_chain_length, static_cast<size_t>(1));
+    ASSERT_EQ(stats.purge_lag, static_cast<uint64_t>(0));
+
+    // 事务删除并提交后，只剩删除标记的键被整体移除
+    TransactionID tx_id = tx_manager->begin();
+    engine.del(tx_id, "purge_key");
+    tx_manager->commit(tx_id);
+    ASSERT_EQ(engine.size(), static_cast<size_t>(1));
+    engine.purgeVersions(1 << 20);
+    ASSERT_EQ(engine.size(), static_cast<size_t>(0));
+    return true;
+}
+
+bool testMVCCPurgeKeepsVisibleVersions() {
+    StorageEngine engine;
+    auto& tx_manager = engine.getTransactionManager();
+    TransactionID writer1 = tx_manager->begin();
+    engine.set(writer1, "visible_key", "v1");
+    tx_manager->commit(writer1);
+
+    // 长事务的读取视图仍需要v1
+    TransactionID reader = tx_manager->begin();
+    TransactionID writer2 = tx_manager->begin();
+    engine.set(writer2, "visible_key", "v2");
+    tx_manager->commit(writer2);
+
+    MVCCStats stats = engine.getMVCCStats();
+    ASSERT_EQ(stats.purge_horizon, reader);
+    ASSERT_GT(stats.purge_lag, static_cast<uint64_t>(0));
+
+    // 只释放v1之前的删除标记
+    ASSERT_EQ(engine.purgeVersions(1 << 20), static_cast<size_t>(1));
+    DataItem* head = engine.getDataItem(NO_TX, "visible_key");
+    ASSERT_EQ(chainLength(head), static_cast<size_t>(2));
+    ASSERT_EQ(versionAt(head, 0)->getValue(), "v2");
+    ASSERT_EQ(versionAt(head, 1)->getValue(), "v1");
+    stats = engine.getMVCCStats();
+    ASSERT_EQ(stats.versioned_keys, static_cast<size_t>(1));
+    ASSERT_EQ(stats.history_versions, static_cast<size_t>(1));
+    ASSERT_EQ(stats.max_chain_length, static_cast<size_t>(2));
+
+    // 长事务结束后v1也被释放
+    tx_manager->commit(reader);
+    ASSERT_EQ(engine.purgeVersions(1 << 20), static_cast<size_t>(1));
+    ASSERT_EQ(chainLength(engine.getDataItem(NO_TX, "visible_key")), static_cast<size_t>(1));
+    ASSERT_EQ(engine.getMVCCStats().purge_lag, static_cast<uint64_t>(0));
+    return true;
+}
+
+bool testMVCCPurgeRollback() {
+    StorageEngine engine;
+    auto& tx_manager = engine.getTransactionManager();
+    TransactionID writer1 = tx_manager->begin();
+    engine.set(writer1, "rollback_key", "v1");
+    tx_manager->commit(writer1);
+
+    TransactionID writer2 = tx_manager->begin();
+    engine.set(writer2, "rollback_key", "v2");
+    engine.set(writer2, "rollback_only", "x");
+    tx_manager->rollback(writer2);
+    ASSERT_EQ(engine.get(NO_TX, "rollback_key"), "v1");
+    ASSERT_EQ(engine.getMVCCStats().pending_rollbacks, static_cast<size_t>(1));
+
+    // 已回滚的版本被摘除，只由回滚事务写入的键被移除
+    engine.purgeVersions(1 << 20);
+    DataItem* head = engine.getDataItem(NO_TX, "rollback_key");
+    ASSERT_EQ(chainLength(head), static_cast<size_t>(1));
+    ASSERT_EQ(versionAt(head, 0)->getValue(), "v1");
+    ASSERT_FALSE(engine.exists(NO_TX, "rollback_only"));
+    ASSERT_EQ(engine.size(), static_cast<size_t>(1));
+
+    // 完整遍历一轮后回滚事务不再计入读取视图
+    MVCCStats stats = engine.getMVCCStats();
+    ASSERT_EQ(stats.pending_rollbacks, static_cast<size_t>(0));
+    ASSERT_EQ(stats.purge_lag, static_cast<uint64_t>(0));
+    ASSERT_EQ(engine.get(NO_TX, "rollback_key"), "v1");
+    return true;
+}
+
+bool testMVCCDeltaVersions() {
+    // 读未提交级别下事务使用开始时的读取视图，可以观察旧版本
+    StorageEngine engine(TransactionIsolationLevel::READ_UNCOMMITTED);
+    auto& tx_manager = engine.getTransactionManager();
+    const int FIELDS = 1000;
+    TransactionID setup = tx_manager->begin();
+    for (int i = 0; i < FIELDS; ++i) {
+        engine.hset(setup, "big_hash", "f" + std::to_string(i), "v" + std::to_string(i));
+    }
+    engine.rpush(setup, "big_list", "a");
+    engine.rpush(setup, "big_list", "b");
+    engine.rpush(setup, "big_list", "c");
+    engine.sadd(setup, "big_set", {"m0", "m1"});
+    engine.zadd(setup, "big_zset", {{"z0", 1}, {"z1", 2}});
+    tx_manager->commit(setup);
+
+    TransactionID reader = tx_manager->begin();
+    TransactionID writer = tx_manager->begin();
+    engine.hset(writer, "big_hash", "f0", "new");
+    engine.hset(writer, "big_hash", "extra", "x");
+    engine.hdel(writer, "big_hash", "f1");
+    engine.lpush(writer, "big_list", "x");
+    engine.rpop(writer, "big_list");
+    engine.lset(writer, "big_list", 1, "y");
+    engine.sadd(writer, "big_set", {"m2"});
+    engine.srem(writer, "big_set", {"m0"});
+    engine.zadd(writer, "big_zset", {{"z0", 5}});
+    engine.zrem(writer, "big_zset", {"z1"});
+
+    // 写入没有复制整个哈希，上一个版本只保留元数据
+    DataItem* head = engine.getDataItem(writer, "big_hash");
+    ASSERT_TRUE(head != nullptr);
+    ASSERT_TRUE(head->getUndoLog() != nullptr);
+    ASSERT_TRUE(head->getUndoLog()->ty == UndoLogType::DELTA);
+    ASSERT_EQ(static_cast<HashItem*>(head->getUndoLog()->old_value.get())->size(), static_cast<size_t>(0));
+    ASSERT_EQ(head->getUndoLog()->deltas.size(), static_cast<size_t>(3));
+
+    // 写事务看到自己的修改
+    ASSERT_EQ(engine.hget(writer, "big_hash", "f0"), "new");
+    ASSERT_EQ(engine.hlen(writer, "big_hash"), static_cast<size_t>(FIELDS));
+    ASSERT_TRUE(engine.lrange(writer, "big_list", 0, 10) == (std::vector<Value>{"x", "y", "b"}));
+
+    // 旧读取视图通过逆操作还原出原内容，提交前后都一样
+    for (int round = 0; round < 2; ++round) {
+        ASSERT_EQ(engine.hget(reader, "big_hash", "f0"), "v0");
+        ASSERT_EQ(engine.hget(reader, "big_hash", "f1"), "v1");
+        ASSERT_FALSE(engine.hexists(reader, "big_hash", "extra"));
+        ASSERT_EQ(engine.hlen(reader, "big_hash"), static_cast<size_t>(FIELDS));
+        ASSERT_TRUE(engine.lrange(reader, "big_list", 0, 10) == (std::vector<Value>{"a", "b", "c"}));
+        ASSERT_TRUE(engine.sismember(reader, "big_set", "m0"));
+        ASSERT_FALSE(engine.sismember(reader, "big_set", "m2"));
+        double score = 0;
+        ASSERT_TRUE(engine.zscore(reader, "big_zset", "z0", score));
+        ASSERT_EQ(score, 1.0);
+        ASSERT_TRUE(engine.zscore(reader, "big_zset", "z1", score));
+        if (round == 0) {
+            tx_manager->commit(writer);
+        }
+    }
+
+    // 回滚的增量版本在回收时原地撤销
+    TransactionID rolled = tx_manager->begin();
+    engine.hset(rolled, "big_hash", "f0", "rolled");
+    engine.rpush(rolled, "big_list", "z");
+    tx_manager->rollback(rolled);
+    TransactionID later = tx_manager->begin();
+    ASSERT_EQ(engine.hget(later, "big_hash", "f0"), "new");
+    engine.purgeVersions(1 << 20);
+    ASSERT_EQ(engine.hget(later, "big_hash", "f0"), "new");
+    ASSERT_TRUE(engine.lrange(later, "big_list", 0, 10) == (std::vector<Value>{"x", "y", "b"}));
+    ASSERT_EQ(engine.hget(reader, "big_hash", "f0"), "v0");
+    ASSERT_TRUE(engine.lrange(reader, "big_list", 0, 10) == (std::vector<Value>{"a", "b", "c"}));
+
+    tx_manager->commit(reader);
+    tx_manager->commit(later);
+    engine.purgeVersions(1 << 20);
+    TransactionID check = tx_manager->begin();
+    ASSERT_EQ(chainLength(engine.getDataItem(check, "big_hash")), static_cast<size_t>(1));
+    ASSERT_EQ(engine.hget(check, "big_hash", "f0"), "new");
+    ASSERT_FALSE(engine.hexists(check, "big_hash", "f1"));
+    tx_manager->commit(check);
+    return true;
+}
+
+// 删除集合类型的最后一个元素时在同一次写入中删除键，事务中的删除可以回滚，旧读取视图仍能看到原内容
+bool testMVCCEmptyCollectionRemoval() {
+    StorageEngine engine(TransactionIsolationLevel::READ_UNCOMMITTED);
+    auto& tx_manager = engine.getTransactionManager();
+    engine.hset(NO_TX, "empty_hash", "f", "v");
+    ASSERT_TRUE(engine.hdel(NO_TX, "empty_hash", "f"));
+    ASSERT_FALSE(engine.exists(NO_TX, "empty_hash"));
+    engine.rpush(NO_TX, "empty_list", "a");
+    ASSERT_EQ(engine.lpop(NO_TX, "empty_list"), "a");
+    ASSERT_FALSE(engine.exists(NO_TX, "empty_list"));
+    engine.rpush(NO_TX, "move_src", "a");
+    ASSERT_EQ(engine.lmove(NO_TX, "move_src", "move_dst", true, false), "a");
+    ASSERT_FALSE(engine.exists(NO_TX, "move_src"));
+    ASSERT_TRUE(engine.exists(NO_TX, "move_dst"));
+
+    TransactionID setup = tx_manager->begin();
+    engine.sadd(setup, "empty_set", {"m0", "m1"});
+    engine.zadd(setup, "empty_zset", {{"z0", 1}});
+    tx_manager->commit(setup);
+
+    TransactionID reader = tx_manager->begin();
+    TransactionID writer = tx_manager->begin();
+    ASSERT_EQ(engine.srem(writer, "empty_set", {"m0", "m1"}), static_cast<size_t>(2));
+    ASSERT_EQ(engine.zrem(writer, "empty_zset", {"z0"}), static_cast<size_t>(1));
+    ASSERT_FALSE(engine.exists(writer, "empty_set"));
+    ASSERT_FALSE(engine.exists(writer, "empty_zset"));
+    ASSERT_EQ(engine.scard(reader, "empty_set"), static_cast<size_t>(2));
+    ASSERT_EQ(engine.zcard(reader, "empty_zset"), static_cast<size_t>(1));
+    tx_manager->rollback(writer);
+
+    TransactionID later = tx_manager->begin();
+    ASSERT_EQ(engine.scard(later, "empty_set"), static_cast<size_t>(2));
+    ASSERT_EQ(engine.zcard(later, "empty_zset"), static_cast<size_t>(1));
+    tx_manager->commit(later);
+    tx_manager->commit(reader);
+    return true;
+}
+
+// 可串行化隔离：访问不相交键的事务都能提交，读写冲突的事务在提交时回滚
+bool testMVCCSerializableConflicts() {
+    StorageEngine engine(TransactionIsolationLevel::SERIALIZABLE);
+    auto& tx_manager = engine.getTransactionManager();
+    engine.set(NO_TX, "a", "0");
+    engine.set(NO_TX, "b", "0");
+
+    // 不相交的键
+    TransactionID tx1 = tx_manager->begin();
+    TransactionID tx2 = tx_manager->begin();
+    tx_manager->trackCommand(tx1, Command(CommandType::GET, {"a"}));
+    tx_manager->trackCommand(tx1, Command(CommandType::SET, {"a", "1"}));
+    tx_manager->trackCommand(tx2, Command(CommandType::GET, {"b"}));
+    tx_manager->trackCommand(tx2, Command(CommandType::SET, {"b", "1"}));
+    ASSERT_TRUE(tx_manager->commit(tx1));
+    ASSERT_TRUE(tx_manager->commit(tx2));
+
+    // 写偏斜：各自读取对方写入的键，后提交者冲突
+    tx1 = tx_manager->begin();
+    tx2 = tx_manager->begin();
+    tx_manager->trackCommand(tx1, Command(CommandType::GET, {"b"}));
+    tx_manager->trackCommand(tx1, Command(CommandType::SET, {"a", "2"}));
+    tx_manager->trackCommand(tx2, Command(CommandType::GET, {"a"}));
+    tx_manager->trackCommand(tx2, Command(CommandType::SET, {"b", "2"}));
+    ASSERT_TRUE(tx_manager->commit(tx1));
+    ASSERT_FALSE(tx_manager->commit(tx2));
+    ASSERT_FALSE(tx_manager->isActive(tx2));
+    ASSERT_TRUE(tx_manager->isRolledback(tx2));
+
+    // 非事务写入与事务读取冲突，BITOP只写入目标键
+    TransactionID tx3 = tx_manager->begin();
+    TransactionID tx4 = tx_manager->begin();
+    tx_manager->trackCommand(tx3, Command(CommandType::HGET, {"h", "f"}));
+    tx_manager->trackCommand(tx4, Command(CommandType::GET, {"src"}));
+    tx_manager->trackCommand(NO_TX, Command(CommandType::HSET, {"h", "f", "v"}));
+    tx_manager->trackCommand(NO_TX, Command(CommandType::BITOP, {"AND", "dest", "src"}));
+    ASSERT_FALSE(tx_manager->commit(tx3));
+    ASSERT_TRUE(tx_manager->commit(tx4));
+
+    // 遍历键空间的事务与任何写入冲突，只读且无并发写入时可以提交
+    TransactionID tx5 = tx_manager->begin();
+    tx_manager->trackCommand(tx5, Command(CommandType::DBSIZE, {}));
+    ASSERT_TRUE(tx_manager->commit(tx5));
+    TransactionID tx6 = tx_manager->begin();
+    tx_manager->trackCommand(tx6, Command(CommandType::SCAN, {"0"}));
+    tx_manager->trackCommand(NO_TX, Command(CommandType::DEL, {"x", "y"}));
+    ASSERT_FALSE(tx_manager->commit(tx6));
+
+    // 可重复读：事务内读取始终使用开始时的读取视图
+    TransactionID reader = tx_manager->begin();
+    ASSERT_EQ(engine.get(reader, "a"), "0");
+    TransactionID writer = tx_manager->begin();
+    engine.set(writer, "a", "3");
+    ASSERT_TRUE(tx_manager->commit(writer));
+    ASSERT_EQ(engine.get(reader, "a"), "0");
+    ASSERT_EQ(engine.get(NO_TX, "a"), "3");
+    tx_manager->commit(reader);
+    return true;
+}
+
 } // namespace dkv
 
 int main() {
@@ -200,6 +547,13 @@ int main() {
     runner.runTest("MVCCGetAndSet", dkv::testMVCCGetAndSet);
     runner.runTest("MVCCDelete", dkv::testMVCCDelete);
     runner.runTest("MVCCUndoLog", dkv::testMVCCUndoLog);
+    runner.runTest("MVCCReadViewSnapshot", dkv::testMVCCReadViewSnapshot);
+    runner.runTest("MVCCPurgeCommitted", dkv::testMVCCPurgeCommitted);
+    runner.runTest("MVCCPurgeKeepsVisibleVersions", dkv::testMVCCPurgeKeepsVisibleVersions);
+    runner.runTest("MVCCPurgeRollback", dkv::testMVCCPurgeRollback);
+    runner.runTest("MVCCDeltaVersions", dkv::testMVCCDeltaVersions);
+    runner.runTest("MVCCEmptyCollectionRemoval", dkv::testMVCCEmptyCollectionRemoval);
+    runner.runTest("MVCCSerializableConflicts", dkv::testMVCCSerializableConflicts);
     std::cout << "所有MVCC类测试完成!" << std::endl;
     return 0;
 }
\ No newline at end of file
@@ -2,8 +2,12 @@
 #include "multinode/raft/dkv_raft_network.hpp"
 #include "multinode/raft/dkv_raft_statemachine.hpp"
 #include "multinode/raft/dkv_raft_persist.hpp"
+#include "multinode/raft/dkv_raft_log_codec.hpp"
 #include "test_raft_common.h"
 #include "test_runner.hpp"
+#include "dkv_server.hpp"
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <chrono>
@@ -176,6 +180,57 @@ bool testRaftStateMachineManager() {
     return true;
 }
 
+// 测试批量应用：并行应用时同一个键的命令保持日志顺序，屏障命令在之前的命令完成后执行
+bool testRaftParallelApply() {
+    DKVServer server(6410);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    if (!server.start()) {
+        return false;
+    }
+    RaftStateMachineManager sm;
+    sm.SetDKVServer(&server);
+    sm.SetApplyWorkers(4);
+
+    const int lists = 8;
+    const int rounds = 40;
+    vector<RaftCommand> batch;
+    for (int round = 0; round < rounds; round++) {
+        if (round == rounds / 2) {
+            batch.emplace_back(NO_TX, Command(CommandType::DEL, {"list0", "list1"}));
+        }
+        for (int list = 0; list < lists; list++) {
+            batch.emplace_back(NO_TX, Command(CommandType::RPUSH, {"list" + to_string(list), to_string(round)}));
+        }
+    }
+    vector<const RaftCommand*> commands;
+    for (const auto& command : batch) {
+        commands.push_back(&command);
+    }
+    vector<Response> results;
+    sm.DoOps(commands, results);
+    ASSERT_EQ(results.size(), batch.size());
+    // 每条RPUSH返回推入后的列表长度
+    ASSERT_EQ(results[lists * (rounds / 2) - 1].data, to_string(rounds / 2));
+    ASSERT_EQ(results[lists * (rounds / 2)].data, string("2"));
+    ASSERT_EQ(results.back().data, to_string(rounds));
+
+    bool ordered = true;
+    for (int list = 0; list < lists; list++) {
+        Response range = server.executeCommand(Command(CommandType::LRANGE, {"list" + to_string(list), "0", "-1"}), NO_TX);
+        int first = list < 2 ? rounds / 2 : 0;
+        vector<string> expected;
+        for (int round = first; round < rounds; round++) {
+            expected.push_back(to_string(round));
+        }
+        ordered = ordered && range.elements == expected;
+    }
+    sm.SetApplyWorkers(0);
+    server.stop();
+    ASSERT_TRUE(ordered);
+    return true;
+}
+
 // 测试AppendEntries日志验证逻辑
 bool testRaftAppendEntriesValidation() {
     vector<string> peers = {"127.0.0.1:12345"};
@@ -323,6 +378,132 @@ bool testRaftInstallSnapshot() {
     return true;
 }
 
+// 测试按块接收快照：偏移不连续时返回已收到的字节数，最后一块到达后才应用
+bool testRaftInstallSnapshotChunks() {
+    vector<string> peers = {"127.0.0.1:12345"};
+    int me = 0;
+    auto network = make_shared<MockRaftNetwork>();
+    auto state_machine = make_shared<MockRaftStateMachine>(me);
+    std::filesystem::remove_all("./test_raft_chunk_data");
+    std::filesystem::create_directories("./test_raft_chunk_data");
+    auto persister = make_shared<RaftFilePersister>("./test_raft_chunk_data");
+    Raft raft(me, peers, persister, network, state_machine);
+    
+    const string data = "counter=1234567";
+    auto chunk = [&](uint64_t offset, size_t length, bool done) {
+        InstallSnapshotRequest request;
+        request.term = 1;
+        request.leaderId = 0;
+        request.lastIncludedIndex = 5;
+        request.lastIncludedTerm = 1;
+        request.leaderCommit = 5;
+        request.offset = offset;
+        request.done = done;
+        request.snapshot.assign(data.begin() + offset, data.begin() + offset + length);
+        return raft.OnInstallSnapshot(request);
+    };
+    
+    InstallSnapshotResponse response = chunk(0, 5, false);
+    ASSERT_TRUE(response.success);
+    ASSERT_EQ(response.nextOffset, static_cast<uint64_t>(5));
+    // 模拟断线后领导者从错误的偏移续传
+    response = chunk(10, 5, true);
+    ASSERT_FALSE(response.success);
+    ASSERT_EQ(response.nextOffset, static_cast<uint64_t>(5));
+    ASSERT_EQ(state_machine->GetRestoreCalls(), 0);
+    
+    response = chunk(5, 5, false);
+    ASSERT_TRUE(response.success);
+    response = chunk(10, 5, true);
+    ASSERT_TRUE(response.success);
+    ASSERT_EQ(state_machine->GetRestoreCalls(), 1);
+    ASSERT_EQ(state_machine->GetCounter(), 1234567);
+    
+    // 持久化的快照可以按偏移读取
+    uint64_t total = 0;
+    vector<char> part = persister->ReadSnapshotChunk(8, 4, total);
+    ASSERT_EQ(total, static_cast<uint64_t>(data.size()));
+    ASSERT_EQ(string(part.begin(), part.end()), string("1234"));
+    std::filesystem::remove_all("./test_raft_chunk_data");
+    return true;
+}
+
+// 测试分段追加的日志持久化：截断冲突条目、快照压缩、重新打开回放以及损坏尾部的截断
+bool testRaftLogSegments() {
+    const string dir = "./test_raft_wal_data";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto makeEntry = [](int index, int term) {
+        RaftLogEntry entry;
+        entry.index = index;
+        entry.term = term;
+        entry.command = make_shared<RaftCommand>(index, Command(CommandType::SET, {"key" + to_string(index), "value with spaces\n" + to_string(index)}));
+        return entry;
+    };
+    auto replay = [&](vector<RaftLogEntry>& log) {
+        RaftFilePersister persister(dir);
+        log.clear();
+        return persister.ReplayLog([&](RaftLogEntry&& entry) { log.push_back(std::move(entry)); });
+    };
+    
+    {
+        RaftFilePersister persister(dir);
+        persister.AppendLog({makeEntry(1, 1), makeEntry(2, 1), makeEntry(3, 1)});
+        persister.AppendLog({makeEntry(4, 1), makeEntry(5, 1)});
+        // 与领导者冲突，删除索引4之后的条目再追加新任期的条目
+        persister.TruncateLogSuffix(4);
+        persister.AppendLog({makeEntry(4, 2)});
+        persister.CompactLog(2);
+        persister.SyncLog();
+    }
+    
+    vector<RaftLogEntry> log;
+    ASSERT_EQ(replay(log), 2);
+    ASSERT_EQ(log.size(), static_cast<size_t>(2));
+    ASSERT_EQ(log[0].index, 3);
+    ASSERT_EQ(log[1].index, 4);
+    ASSERT_EQ(log[1].term, 2);
+    // 回放的条目只保存编码，命令在需要时解码
+    ASSERT_TRUE(log[1].record != nullptr);
+    ASSERT_TRUE(log[1].command == nullptr);
+    shared_ptr<RaftCommand> command = RaftLogCommandOf(log[1]);
+    ASSERT_TRUE(command != nullptr);
+    ASSERT_EQ(command->tx_id, static_cast<TransactionID>(4));
+    ASSERT_TRUE(command->db_command.type == CommandType::SET);
+    ASSERT_EQ(command->db_command.args[1], string("value with spaces\n4"));
+    ASSERT_EQ(RaftLogEntryBytes(log[1]), log[1].record->size());
+    
+    // 模拟崩溃时写了一半的记录
+    {
+        std::ofstream segment(dir + "/raft_log.1", std::ios::binary | std::ios::app);
+        segment.write("\x40\0\0\0garbage", 11);
+    }
+    ASSERT_EQ(replay(log), 2);
+    ASSERT_EQ(log.size(), static_cast<size_t>(2));
+    
+    // 截断后可以继续追加
+    {
+        RaftFilePersister persister(dir);
+        persister.ReplayLog([](RaftLogEntry&&) {});
+        persister.AppendLog({makeEntry(5, 2)});
+        persister.SyncLog();
+    }
+    ASSERT_EQ(replay(log), 2);
+    ASSERT_EQ(log.size(), static_cast<size_t>(3));
+    ASSERT_EQ(log.back().index, 5);
+    
+    // 压缩到最新索引后整段删除
+    {
+        RaftFilePersister persister(dir);
+        persister.CompactLog(5);
+    }
+    ASSERT_FALSE(std::filesystem::exists(dir + "/raft_log.1"));
+    ASSERT_EQ(replay(log), 5);
+    ASSERT_TRUE(log.empty());
+    std::filesystem::remove_all(dir);
+    return true;
+}
+
 // 测试多个命令连续提交
 bool testRaftContinuousCommands() {
     vector<string> peers = {"127.0.0.1:12345"};
@@ -473,6 +654,389 @@ bool testRaftBasicAgree() {
     return true;
 }
 
+// 测试批量复制：连续提交的命令按批次上限合并到AppendEntries请求中，多数节点确认后提交
+bool testRaftBatchReplication() {
+    RaftTest test(3);
+    test.StartAll();
+    
+    // 等待领导者选举
+    this_thread::sleep_for(chrono::milliseconds(300));
+    int leader = test.CheckOneLeader();
+    ASSERT_TRUE(leader >= 0);
+    auto raft = test.GetRaft(leader);
+    raft->SetReplicationBatchLimits(3, 0);
+    
+    // 不等待复制，连续提交
+    int index = -1;
+    int term = 0;
+    for (int i = 0; i < 10; i++) {
+        Command command(CommandType::SET, {"batch_key" + to_string(i), "value" + to_string(i)});
+        ASSERT_TRUE(raft->StartCommand(RaftCommand(0, command), index, term));
+    }
+    ASSERT_TRUE(test.Wait(index, 3));
+    ASSERT_TRUE(test.GetNetwork(leader)->GetMaxAppendEntries() <= 3);
+    
+    test.StopAll();
+    
+    return true;
+}
+
+// 测试TCP网络：长连接上的二进制帧传输，AppendEntries直接发送编码好的日志记录
+bool testRaftTcpNetwork() {
+    const int servers = 3;
+    vector<string> peers;
+    for (int i = 0; i < servers; i++) {
+        peers.push_back("127.0.0.1:" + to_string(23451 + i));
+    }
+    vector<shared_ptr<RaftTcpNetwork>> networks;
+    vector<shared_ptr<MockRaftStateMachine>> state_machines;
+    vector<shared_ptr<Raft>> rafts;
+    for (int i = 0; i < servers; i++) {
+        auto network = make_shared<RaftTcpNetwork>(i, peers);
+        auto state_machine = make_shared<MockRaftStateMachine>(i);
+        auto persister = make_shared<RaftFilePersister>("./test_raft_tcp_data" + to_string(i));
+        auto raft = make_shared<Raft>(i, peers, persister, network, state_machine);
+        network->SetRaft(raft);
+        networks.push_back(network);
+        state_machines.push_back(state_machine);
+        rafts.push_back(raft);
+    }
+    for (auto& raft : rafts) {
+        raft->Start();
+    }
+    
+    // 等待领导者选举
+    int leader = -1;
+    for (int retry = 0; retry < 50 && leader < 0; retry++) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        for (int i = 0; i < servers; i++) {
+            if (rafts[i]->IsLeader()) {
+                leader = i;
+            }
+        }
+    }
+    ASSERT_TRUE(leader >= 0);
+    
+    // 连续提交，多条日志记录在同一个请求中发送
+    const int count = 50;
+    int index = -1;
+    int term = 0;
+    for (int i = 0; i < count; i++) {
+        Command command(CommandType::SET, {"incr", string(100 + i, 'v')});
+        ASSERT_TRUE(rafts[leader]->StartCommand(RaftCommand(0, command), index, term));
+    }
+    bool applied = false;
+    for (int retry = 0; retry < 100 && !applied; retry++) {
+        this_thread::sleep_for(chrono::milliseconds(50));
+        applied = true;
+        for (int i = 0; i < servers; i++) {
+            applied = applied && state_machines[i]->GetCounter() == count;
+        }
+    }
+    ASSERT_TRUE(applied);
+    
+    for (auto& raft : rafts) {
+        raft->Stop();
+    }
+    return true;
+}
+
+// 测试多个Raft组共享一个网络传输：各组独立选举和复制，请求按节点合并发送；
+// 空闲的组静默后不再发送心跳，跟随者在领导者节点存活时不发起选举，有新命令时恢复复制
+bool testRaftMultiGroupTransport() {
+    const int servers = 3;
+    const int groups = 4;
+    vector<string> peers;
+    for (int i = 0; i < servers; i++) {
+        peers.push_back("127.0.0.1:" + to_string(23461 + i));
+    }
+    vector<shared_ptr<RaftTcpNetwork>> transports;
+    for (int i = 0; i < servers; i++) {
+        transports.push_back(make_shared<RaftTcpNetwork>(i, peers));
+    }
+    vector<vector<shared_ptr<MockRaftStateMachine>>> state_machines(groups);
+    vector<vector<shared_ptr<Raft>>> rafts(groups);
+    for (int g = 0; g < groups; g++) {
+        for (int i = 0; i < servers; i++) {
+            auto network = make_shared<RaftGroupNetwork>(transports[i], g + 1);
+            auto state_machine = make_shared<MockRaftStateMachine>(i);
+            auto persister = make_shared<RaftFilePersister>("./test_raft_group_data" + to_string(g) + "_" + to_string(i));
+            auto raft = make_shared<Raft>(i, peers, persister, network, state_machine);
+            raft->SetQuiesce(true);
+            transports[i]->RegisterGroup(g + 1, raft);
+            state_machines[g].push_back(state_machine);
+            rafts[g].push_back(raft);
+        }
+    }
+    for (auto& group : rafts) {
+        for (auto& raft : group) {
+            raft->Start();
+        }
+    }
+    
+    // 等待各组选出领导者
+    auto findLeaders = [&]() {
+        vector<int> leaders(groups, -1);
+        for (int retry = 0; retry < 50; retry++) {
+            bool all = true;
+            for (int g = 0; g < groups; g++) {
+                leaders[g] = -1;
+                for (int i = 0; i < servers; i++) {
+                    if (rafts[g][i]->IsLeader()) {
+                        leaders[g] = i;
+                    }
+                }
+                all = all && leaders[g] >= 0;
+            }
+            if (all) {
+                break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(100));
+        }
+        return leaders;
+    };
+    auto submitAndWait = [&](const vector<int>& leaders, int count, int expected) {
+        for (int g = 0; g < groups; g++) {
+            for (int i = 0; i < count; i++) {
+                int index = -1;
+                int term = 0;
+                Command command(CommandType::SET, {"incr", "1"});
+                if (!rafts[g][leaders[g]]->StartCommand(RaftCommand(0, command), index, term)) {
+                    return false;
+                }
+            }
+        }
+        for (int retry = 0; retry < 100; retry++) {
+            bool applied = true;
+            for (int g = 0; g < groups; g++) {
+                for (int i = 0; i < servers; i++) {
+                    applied = applied && state_machines[g][i]->GetCounter() == expected;
+                }
+            }
+            if (applied) {
+                return true;
+            }
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+        return false;
+    };
+    
+    vector<int> leaders = findLeaders();
+    for (int g = 0; g < groups; g++) {
+        ASSERT_TRUE(leaders[g] >= 0);
+    }
+    ASSERT_TRUE(submitAndWait(leaders, 10, 10));
+    
+    // 静默超过数个选举超时，领导者和任期都不变
+    vector<int> terms(groups);
+    for (int g = 0; g < groups; g++) {
+        terms[g] = rafts[g][leaders[g]]->GetCurrentTerm();
+    }
+    this_thread::sleep_for(chrono::milliseconds(RAFT_DEFAULT_ELECTION_TIMEOUT * 3));
+    for (int g = 0; g < groups; g++) {
+        ASSERT_TRUE(rafts[g][leaders[g]]->IsLeader());
+        for (int i = 0; i < servers; i++) {
+            ASSERT_EQ(rafts[g][i]->GetCurrentTerm(), terms[g]);
+        }
+    }
+    
+    // 新命令唤醒静默的组
+    ASSERT_TRUE(submitAndWait(leaders, 5, 15));
+    
+    for (auto& group : rafts) {
+        for (auto& raft : group) {
+            raft->Stop();
+        }
+    }
+    return true;
+}
+
+// 测试异步提交：回调在日志应用后按提交顺序触发，停止后不会遗留未调用的回调
+bool testRaftAsyncCommand() {
+    RaftTest test(3);
+    test.StartAll();
+    
+    // 等待领导者选举
+    this_thread::sleep_for(chrono::milliseconds(300));
+    int leader = test.CheckOneLeader();
+    ASSERT_TRUE(leader >= 0);
+    auto raft = test.GetRaft(leader);
+    
+    mutex mu;
+    condition_variable cv;
+    vector<int> completed;
+    int failed = 0;
+    const int count = 20;
+    for (int i = 0; i < count; i++) {
+        int index = -1;
+        int term = 0;
+        auto command = make_shared<RaftCommand>(0, Command(CommandType::SET, {"incr", "1"}));
+        ASSERT_TRUE(raft->StartCommand(command, index, term, [&, i](const Response& response) {
+            lock_guard<mutex> lock(mu);
+            completed.push_back(i);
+            if (response.status != ResponseStatus::OK) {
+                failed++;
+            }
+            cv.notify_all();
+        }, 5000));
+    }
+    {
+        unique_lock<mutex> lock(mu);
+        ASSERT_TRUE(cv.wait_for(lock, chrono::seconds(5), [&] { return completed.size() == static_cast<size_t>(count); }));
+        ASSERT_EQ(failed, 0);
+        for (int i = 0; i < count; i++) {
+            ASSERT_EQ(completed[i], i);
+        }
+    }
+    ASSERT_EQ(test.GetStateMachine(leader)->GetCounter(), count);
+    
+    // 停止时尚未完成的命令同样会收到回调，调用方不会一直等待
+    bool called = false;
+    int index = -1;
+    int term = 0;
+    auto command = make_shared<RaftCommand>(0, Command(CommandType::SET, {"incr", "1"}));
+    ASSERT_TRUE(raft->StartCommand(command, index, term, [&](const Response&) { called = true; }, 60000));
+    test.StopAll();
+    ASSERT_TRUE(called);
+    
+    return true;
+}
+
+// 测试ReadIndex：领导者确认领导地位后读取，跟随者向领导者请求读取索引并等待应用
+bool testRaftReadIndex() {
+    RaftTest test(3);
+    for (int i = 0; i < 3; i++) {
+        test.GetRaft(i)->SetLeaseRead(true);
+    }
+    test.StartAll();
+    
+    // 等待领导者选举
+    this_thread::sleep_for(chrono::milliseconds(300));
+    Command command(CommandType::SET, {"incr", "1"});
+    int index = test.One(command, 3, false);
+    ASSERT_GT(index, 0);
+    
+    int leader = test.CheckOneLeader();
+    ASSERT_TRUE(leader >= 0);
+    ASSERT_TRUE(test.GetRaft(leader)->ReadIndex(1000));
+    // 租约内的读取直接使用提交索引
+    ASSERT_TRUE(test.GetRaft(leader)->ReadIndex(1000));
+    
+    int follower = (leader + 1) % 3;
+    ASSERT_TRUE(test.GetRaft(follower)->ReadIndex(1000));
+    ASSERT_TRUE(test.GetRaft(follower)->GetCommitIndex() >= index);
+    // ReadIndex返回后跟随者已应用写入
+    ASSERT_EQ(test.GetStateMachine(follower)->GetCounter(), 1);
+    
+    test.StopAll();
+    
+    return true;
+}
+
+// 刷盘可以被阻塞的持久化，模拟慢磁盘
+class GatedPersister : public RaftFilePersister {
+public:
+    explicit GatedPersister(const string& dir) : RaftFilePersister(dir) {}
+    void SyncLog() override {
+        unique_lock<mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return open_; });
+        lock.unlock();
+        RaftFilePersister::SyncLog();
+    }
+    void SetOpen(bool open) {
+        lock_guard<mutex> lock(mutex_);
+        open_ = open;
+        cond_.notify_all();
+    }
+private:
+    mutex mutex_;
+    condition_variable cond_;
+    bool open_ = true;
+};
+
+// 测试日志刷盘与复制并行：领导者刷盘慢时两个跟随者落盘即可提交；
+// 领导者和一个跟随者都未落盘时不提交，领导者落盘后计入多数
+bool testRaftWalSync() {
+    vector<shared_ptr<GatedPersister>> persisters;
+    RaftTest test(3, [&persisters](int i) {
+        filesystem::remove_all("./test_raft_wal" + to_string(i));
+        persisters.push_back(make_shared<GatedPersister>("./test_raft_wal" + to_string(i)));
+        return persisters.back();
+    });
+    test.StartAll();
+    this_thread::sleep_for(chrono::milliseconds(300));
+    ASSERT_GT(test.One(Command(CommandType::SET, {"incr", "1"}), 3, false), 0);
+    
+    int leader = test.CheckOneLeader();
+    ASSERT_TRUE(leader >= 0);
+    auto waitCommit = [&](int index) {
+        for (int i = 0; i < 100 && test.GetRaft(leader)->GetCommitIndex() < index; i++) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        return test.GetRaft(leader)->GetCommitIndex() >= index;
+    };
+    
+    int index = 0;
+    int term = 0;
+    persisters[leader]->SetOpen(false);
+    ASSERT_TRUE(test.GetRaft(leader)->StartCommand(
+        make_shared<RaftCommand>(NO_TX, Command(CommandType::SET, {"incr", "2"})), index, term));
+    ASSERT_TRUE(waitCommit(index));
+    
+    persisters[(leader + 1) % 3]->SetOpen(false);
+    ASSERT_TRUE(test.GetRaft(leader)->StartCommand(
+        make_shared<RaftCommand>(NO_TX, Command(CommandType::SET, {"incr", "3"})), index, term));
+    // 阻塞时间短于选举超时，跟随者不会发起选举
+    this_thread::sleep_for(chrono::milliseconds(100));
+    ASSERT_TRUE(test.GetRaft(leader)->GetCommitIndex() < index);
+    persisters[leader]->SetOpen(true);
+    ASSERT_TRUE(waitCommit(index));
+    
+    persisters[(leader + 1) % 3]->SetOpen(true);
+    test.StopAll();
+    for (int i = 0; i < 3; i++) {
+        filesystem::remove_all("./test_raft_wal" + to_string(i));
+    }
+    return true;
+}
+
+// 测试有界陈旧读：跟随者应用到领导者的提交索引后允许直接读取，失去领导者超过时限后拒绝
+bool testRaftStaleRead() {
+    RaftTest test(3);
+    test.StartAll();
+    
+    // 等待领导者选举
+    this_thread::sleep_for(chrono::milliseconds(300));
+    Command command(CommandType::SET, {"incr", "1"});
+    int index = test.One(command, 3, false);
+    ASSERT_GT(index, 0);
+    
+    int leader = test.CheckOneLeader();
+    ASSERT_TRUE(leader >= 0);
+    ASSERT_FALSE(test.GetRaft(leader)->StaleReadAllowed(-1, -1));
+    
+    int follower = (leader + 1) % 3;
+    bool allowed = false;
+    for (int i = 0; i < 100 && !allowed; i++) {
+        allowed = test.GetRaft(follower)->StaleReadAllowed(0, 1000);
+        if (!allowed) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+    }
+    ASSERT_TRUE(allowed);
+    ASSERT_EQ(test.GetStateMachine(follower)->GetCounter(), 1);
+    
+    // 停止其他节点后跟随者收不到领导者的消息
+    test.GetRaft(leader)->Stop();
+    test.GetRaft((leader + 2) % 3)->Stop();
+    this_thread::sleep_for(chrono::milliseconds(100));
+    ASSERT_FALSE(test.GetRaft(follower)->StaleReadAllowed(-1, 50));
+    
+    test.StopAll();
+    
+    return true;
+}
+
 // 测试跟随者故障
 bool testRaftFollowerFailure() {
     RaftTest test(3);
@@ -906,13 +1470,23 @@ int main() {
     runner.runTest("Raft日志复制", testRaftLogReplication);
     runner.runTest("Raft持久化", testRaftPersist);
     runner.runTest("Raft状态机管理器", testRaftStateMachineManager);
+    runner.runTest("Raft批量与并行应用", testRaftParallelApply);
     runner.runTest("AppendEntries日志验证", testRaftAppendEntriesValidation);
     runner.runTest("Raft安装快照", testRaftInstallSnapshot);
+    runner.runTest("Raft分块安装快照", testRaftInstallSnapshotChunks);
+    runner.runTest("Raft分段日志持久化", testRaftLogSegments);
     runner.runTest("Raft连续命令", testRaftContinuousCommands);
     runner.runTest("Raft领导者选举", testRaftLeaderElection);
     runner.runTest("Raft初始选举", testRaftInitialElection);
     runner.runTest("Raft重新选举", testRaftReElection);
     runner.runTest("Raft基本一致性", testRaftBasicAgree);
+    runner.runTest("Raft批量复制", testRaftBatchReplication);
+    runner.runTest("Raft异步提交", testRaftAsyncCommand);
+    runner.runTest("RaftTCP网络", testRaftTcpNetwork);
+    runner.runTest("Raft多组共享网络", testRaftMultiGroupTransport);
+    runner.runTest("RaftReadIndex读", testRaftReadIndex);
+    runner.runTest("Raft有界陈旧读", testRaftStaleRead);
+    runner.runTest("Raft日志刷盘与复制并行", testRaftWalSync);
     runner.runTest("Raft跟随者故障", testRaftFollowerFailure);
     runner.runTest("Raft领导者故障", testRaftLeaderFailure);
     runner.runTest("Raft网络分区恢复", testRaftFailAgree);
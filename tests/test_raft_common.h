@@ -10,12 +10,15 @@
 #include <vector>
 #include <chrono>
 #include <thread>
+#include <mutex>
+#include <algorithm>
 #include <memory>
 #include <cassert>
 #include <random>
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 
 using namespace std;
 
@@ -28,7 +31,9 @@ class MockRaftNetwork;
 // 测试框架类 - 先定义，因为MockRaftNetwork依赖它
 class RaftTest {
 public:
-    RaftTest(int servers) : servers_(servers), max_index_(0) {
+    // make_persister为空时每个节点使用./test_raft_data<i>下的RaftFilePersister
+    RaftTest(int servers, function<shared_ptr<RaftPersister>(int)> make_persister = nullptr)
+        : servers_(servers), max_index_(0) {
         // 初始化Raft实例
         for (int i = 0; i < servers_; i++) {
             vector<string> peers;
@@ -38,7 +43,8 @@ public:
             
             auto network = make_shared<MockRaftNetwork>(this, i);
             auto state_machine = make_shared<MockRaftStateMachine>(i);
-            auto persister = make_shared<RaftFilePersister>("./test_raft_data" + to_string(i));
+            shared_ptr<RaftPersister> persister = make_persister
+                ? make_persister(i) : make_shared<RaftFilePersister>("./test_raft_data" + to_string(i));
             
             auto raft = make_shared<Raft>(i, peers, persister, network, state_machine);
             
@@ -323,8 +329,12 @@ public:
 
     // 发送AppendEntries请求
     AppendEntriesResponse SendAppendEntries(int serverId, const AppendEntriesRequest& request) override {
-        // 记录请求
-        last_append_request_ = request;
+        // 记录请求，各跟随者的复制线程会并发调用
+        {
+            lock_guard<mutex> lock(record_mutex_);
+            last_append_request_ = request;
+            max_append_entries_ = max(max_append_entries_, request.entries.size());
+        }
         // 在测试框架中直接调用目标服务器的OnAppendEntries方法
         if (test_) {
             auto raft = test_->GetRaft(serverId);
@@ -339,7 +349,10 @@ public:
     // 发送RequestVote请求
     RequestVoteResponse SendRequestVote(int serverId, const RequestVoteRequest& request) override {
         // 记录请求
-        last_vote_request_ = request;
+        {
+            lock_guard<mutex> lock(record_mutex_);
+            last_vote_request_ = request;
+        }
         // 在测试框架中直接调用目标服务器的OnRequestVote方法
         if (test_) {
             auto raft = test_->GetRaft(serverId);
@@ -355,7 +368,10 @@ public:
     // 发送InstallSnapshot请求
     InstallSnapshotResponse SendInstallSnapshot(int serverId, const InstallSnapshotRequest& request) override {
         // 记录请求
-        last_snapshot_request_ = request;
+        {
+            lock_guard<mutex> lock(record_mutex_);
+            last_snapshot_request_ = request;
+        }
         // 在测试框架中直接调用目标服务器的OnInstallSnapshot方法
         if (test_) {
             auto raft = test_->GetRaft(serverId);
@@ -367,6 +383,17 @@ public:
         return mock_snapshot_response_;
     }
 
+    // 发送ReadIndex请求
+    ReadIndexResponse SendReadIndex(int serverId, const ReadIndexRequest& request) override {
+        if (test_) {
+            auto raft = test_->GetRaft(serverId);
+            if (raft) {
+                return raft->OnReadIndex(request);
+            }
+        }
+        return ReadIndexResponse();
+    }
+
     // 设置模拟响应
     void SetMockAppendResponse(const AppendEntriesResponse& response) {
         mock_response_ = response;
@@ -384,16 +411,25 @@ public:
 
     // 获取最后一个AppendEntries请求
     AppendEntriesRequest GetLastAppendRequest() const {
+        lock_guard<mutex> lock(record_mutex_);
         return last_append_request_;
     }
 
+    // 获取单个AppendEntries请求携带的最多日志条目数
+    size_t GetMaxAppendEntries() const {
+        lock_guard<mutex> lock(record_mutex_);
+        return max_append_entries_;
+    }
+
     // 获取最后一个RequestVote请求
     RequestVoteRequest GetLastVoteRequest() const {
+        lock_guard<mutex> lock(record_mutex_);
         return last_vote_request_;
     }
 
     // 获取最后一个InstallSnapshot请求
     InstallSnapshotRequest GetLastSnapshotRequest() const {
+        lock_guard<mutex> lock(record_mutex_);
         return last_snapshot_request_;
     }
 
@@ -406,6 +442,8 @@ private:
     AppendEntriesRequest last_append_request_;
     RequestVoteRequest last_vote_request_;
     InstallSnapshotRequest last_snapshot_request_;
+    size_t max_append_entries_ = 0;
+    mutable mutex record_mutex_;
 };
 
 } // namespace dkv
@@ -2,6 +2,8 @@
 #include "multinode/raft/dkv_raft_network.hpp"
 #include "multinode/raft/dkv_raft_statemachine.hpp"
 #include "multinode/raft/dkv_raft_persist.hpp"
+#include "dkv_server.hpp"
+#include "dkv_command_handler.hpp"
 #include "test_raft_common.h"
 #include "test_runner.hpp"
 #include <iostream>
@@ -14,6 +16,7 @@
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
+#include <filesystem>
 
 using namespace std;
 
@@ -131,6 +134,91 @@ bool testRaftStateMachineSnapshot() {
     return true;
 }
 
+// 测试状态机管理器在内存中生成和恢复快照，不产生临时文件
+bool testRaftStateMachineMemorySnapshot() {
+    StorageEngine source(TransactionIsolationLevel::READ_COMMITTED, 8);
+    for (int i = 0; i < 3000; i++) {
+        source.set(NO_TX, "key" + to_string(i), "value" + to_string(i));
+    }
+    source.hset(NO_TX, "hash", "field", "value");
+    
+    RaftStateMachineManager manager;
+    manager.SetStorageEngine(&source);
+    vector<char> snapshot = manager.Snapshot();
+    ASSERT_FALSE(snapshot.empty());
+    ASSERT_FALSE(std::filesystem::exists("./temp_raft_snapshot.rdb"));
+    
+    StorageEngine target(TransactionIsolationLevel::READ_COMMITTED, 5);
+    RaftStateMachineManager restored;
+    restored.SetStorageEngine(&target);
+    restored.Restore(snapshot);
+    ASSERT_FALSE(std::filesystem::exists("./temp_raft_restore.rdb"));
+    ASSERT_EQ(target.size(), static_cast<size_t>(3001));
+    ASSERT_EQ(target.get(NO_TX, "key2999"), string("value2999"));
+    ASSERT_EQ(target.hget(NO_TX, "hash", "field"), string("value"));
+    return true;
+}
+
+// 测试设置了命令处理器的状态机把命令应用到它的存储引擎（分片各自的存储引擎）
+bool testRaftStateMachineShardStorage() {
+    DKVServer server(6420);
+    StorageEngine shard_engine;
+    CommandHandler handler(&shard_engine, nullptr, false);
+    RaftStateMachineManager manager;
+    manager.SetCommandHandler(&handler);
+    manager.SetStorageEngine(&shard_engine);
+    manager.SetDKVServer(&server);
+    
+    Response set = manager.DoOp(RaftCommand(NO_TX, Command(CommandType::SET, {"key", "value"})));
+    ASSERT_TRUE(set.status == ResponseStatus::OK);
+    ASSERT_EQ(shard_engine.get(NO_TX, "key"), string("value"));
+    Response dbsize = manager.DoOp(RaftCommand(NO_TX, Command(CommandType::DBSIZE, {})));
+    ASSERT_EQ(dbsize.data, string("1"));
+    
+    // 分片的存储引擎没有RDB文件
+    Response save = manager.DoOp(RaftCommand(NO_TX, Command(CommandType::SAVE, {})));
+    ASSERT_TRUE(save.status == ResponseStatus::ERROR);
+    return true;
+}
+
+// 测试事务的写命令集合编码为一条日志，应用时在一个事务中执行并提交
+bool testRaftStateMachineTransaction() {
+    DKVServer server(6421);
+    StorageEngine shard_engine;
+    CommandHandler handler(&shard_engine, nullptr, false);
+    RaftStateMachineManager manager;
+    manager.SetCommandHandler(&handler);
+    manager.SetStorageEngine(&shard_engine);
+    manager.SetDKVServer(&server);
+
+    std::vector<Command> commands = {Command(CommandType::SET, {"tx:a", "1"}),
+                                     Command(CommandType::INCR, {"tx:a"}),
+                                     Command(CommandType::HSET, {"tx:h", "f", "v"})};
+    Command encoded = RaftCommand::EncodeTransaction(commands);
+    std::vector<Command> decoded;
+    ASSERT_TRUE(RaftCommand::IsTransaction(encoded));
+    ASSERT_TRUE(RaftCommand::DecodeTransaction(encoded, decoded));
+    ASSERT_EQ(decoded.size(), commands.size());
+    ASSERT_TRUE(decoded[2].type == CommandType::HSET && decoded[2].args == commands[2].args);
+
+    Response exec = manager.DoOp(RaftCommand(NO_TX, encoded));
+    ASSERT_TRUE(exec.status == ResponseStatus::OK);
+    // 回复为应用时各命令的结果
+    ASSERT_TRUE(exec.is_array);
+    ASSERT_EQ(exec.elements.size(), commands.size());
+    ASSERT_EQ(exec.elements[0], string("+OK\r\n"));
+    ASSERT_EQ(exec.elements[1], string("$1\r\n2\r\n"));
+    ASSERT_EQ(shard_engine.get(NO_TX, "tx:a"), string("2"));
+    ASSERT_EQ(shard_engine.hget(NO_TX, "tx:h", "f"), string("v"));
+    ASSERT_TRUE(shard_engine.getTransactionManager()->getActiveTransactions().empty());
+
+    // 参数个数超出剩余参数的编码视为损坏，不执行任何子命令
+    Response corrupted = manager.DoOp(RaftCommand(NO_TX, Command(CommandType::EXEC, {"0", "5", "tx:b"})));
+    ASSERT_TRUE(corrupted.status == ResponseStatus::ERROR);
+    ASSERT_EQ(shard_engine.get(NO_TX, "tx:b"), string(""));
+    return true;
+}
+
 // 测试领导者故障后的状态机一致性
 bool testRaftStateMachineLeaderFailure() {
     RaftTest test(3);
@@ -328,6 +416,9 @@ int main() {
     runner.runTest("Raft状态机基本", testRaftStateMachineBasic);
     runner.runTest("Raft状态机并发", testRaftStateMachineConcurrent);
     runner.runTest("Raft状态机快照", testRaftStateMachineSnapshot);
+    runner.runTest("Raft状态机内存快照", testRaftStateMachineMemorySnapshot);
+    runner.runTest("Raft状态机分片存储引擎", testRaftStateMachineShardStorage);
+    runner.runTest("Raft状态机事务日志", testRaftStateMachineTransaction);
     runner.runTest("Raft状态机领导者故障", testRaftStateMachineLeaderFailure);
     runner.runTest("Raft状态机网络分区", testRaftStateMachinePartition);
     runner.runTest("Raft状态机重启重放", testRaftStateMachineRestartReplay);
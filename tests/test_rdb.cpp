@@ -1,9 +1,14 @@
 #include <iostream>
+#include <atomic>
 #include <cassert>
 #include <thread>
 #include <chrono>
 #include <fstream>
+#include <filesystem>
+#include <sstream>
 #include "dkv_server.hpp"
+#include "persist/dkv_rdb.hpp"
+#include "persist/dkv_rdb_loader.hpp"
 #include "dkv_core.hpp"
 #include "test_runner.hpp"
 
@@ -244,6 +249,347 @@ void testRDB(dkv::TestRunner& runner) {
         return file_exists;
     });
     
+    // 测试快照以开始时的读取视图为准，后台保存同一时刻只有一个
+    runner.runTest("测试快照读取视图与后台保存", []() {
+        const std::string filename = "snapshot_dump.rdb";
+        std::remove(filename.c_str());
+        {
+            dkv::StorageEngine storage(dkv::TransactionIsolationLevel::REPEATABLE_READ);
+            const int NUM_KEYS = 5000;
+            for (int i = 0; i < NUM_KEYS; ++i) {
+                storage.set(dkv::NO_TX, "key" + std::to_string(i), "value" + std::to_string(i));
+            }
+            // 未提交事务的写入不进入快照
+            auto& tx_manager = storage.getTransactionManager();
+            dkv::TransactionID tx = tx_manager->begin();
+            storage.set(tx, "uncommitted", "v");
+            storage.set(tx, "key0", "changed");
+            
+            ASSERT_TRUE(storage.saveRDBInBackground(filename));
+            // 快照进行中再次发起后台保存会被拒绝；第一个快照已完成时则开始新的快照，两种结果都合法
+            storage.saveRDBInBackground(filename);
+            // 同步保存等待进行中的快照完成后执行
+            ASSERT_TRUE(storage.saveRDB(filename));
+            tx_manager->rollback(tx);
+            
+            dkv::RDBSaveStats stats = storage.getRDBSaveStats();
+            ASSERT_FALSE(stats.in_progress);
+            ASSERT_TRUE(stats.last_status_ok);
+            ASSERT_EQ(stats.saved_keys, static_cast<uint64_t>(NUM_KEYS));
+            ASSERT_GT(stats.last_save_time, 0);
+        }
+        
+        dkv::StorageEngine loaded;
+        ASSERT_TRUE(loaded.loadRDB(filename));
+        ASSERT_EQ(loaded.size(), static_cast<size_t>(5000));
+        ASSERT_EQ(loaded.get(dkv::NO_TX, "key0"), std::string("value0"));
+        ASSERT_EQ(loaded.get(dkv::NO_TX, "key4999"), std::string("value4999"));
+        ASSERT_FALSE(loaded.exists(dkv::NO_TX, "uncommitted"));
+        std::remove(filename.c_str());
+        return true;
+    });
+    
+    // 测试分块格式多线程保存和加载，加载端的分段数与保存端不同
+    runner.runTest("测试分块格式并行保存与加载", []() {
+        const std::string filename = "chunked_dump.rdb";
+        const int NUM_KEYS = 20000;
+        {
+            dkv::StorageEngine storage(dkv::TransactionIsolationLevel::READ_COMMITTED, 16);
+            storage.setRDBThreads(4);
+            for (int i = 0; i < NUM_KEYS; ++i) {
+                storage.set(dkv::NO_TX, "key" + std::to_string(i), "value" + std::to_string(i));
+            }
+            storage.hset(dkv::NO_TX, "hash", "field", "value");
+            storage.rpush(dkv::NO_TX, "list", "a");
+            storage.zadd(dkv::NO_TX, "zset", {{"member", 1.5}});
+            storage.set(dkv::NO_TX, "volatile", "v", 100);
+            ASSERT_TRUE(storage.saveRDB(filename));
+        }
+        
+        dkv::StorageEngine loaded(dkv::TransactionIsolationLevel::READ_COMMITTED, 7);
+        loaded.setRDBThreads(3);
+        ASSERT_TRUE(loaded.loadRDB(filename));
+        ASSERT_EQ(loaded.size(), static_cast<size_t>(NUM_KEYS + 4));
+        ASSERT_EQ(loaded.getTotalKeys(), static_cast<uint64_t>(NUM_KEYS + 4));
+        ASSERT_EQ(loaded.get(dkv::NO_TX, "key12345"), std::string("value12345"));
+        ASSERT_EQ(loaded.hget(dkv::NO_TX, "hash", "field"), std::string("value"));
+        ASSERT_EQ(loaded.lrange(dkv::NO_TX, "list", 0, 0).size(), static_cast<size_t>(1));
+        double score = 0;
+        ASSERT_TRUE(loaded.zscore(dkv::NO_TX, "zset", "member", score));
+        ASSERT_EQ(score, 1.5);
+        int64_t ttl = loaded.ttl(dkv::NO_TX, "volatile");
+        ASSERT_GT(ttl, 90);
+        ASSERT_EQ(loaded.getKeyspaceStats().volatile_keys, static_cast<size_t>(1));
+        
+        // 篡改数据块内容后校验失败，不写入任何数据
+        {
+            std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(100);
+            file.put('\x7f');
+        }
+        dkv::StorageEngine corrupted;
+        ASSERT_FALSE(corrupted.loadRDB(filename));
+        ASSERT_EQ(corrupted.size(), static_cast<size_t>(0));
+        std::remove(filename.c_str());
+        return true;
+    });
+    
+    // 测试数据块压缩：文本型的值压缩后文件明显变小，两种格式都能加载
+    runner.runTest("测试RDB数据块压缩", []() {
+        const std::string compressed_file = "compressed_dump.rdb";
+        const std::string plain_file = "plain_dump.rdb";
+        const int NUM_KEYS = 5000;
+        dkv::StorageEngine storage(dkv::TransactionIsolationLevel::READ_COMMITTED, 8);
+        storage.setRDBThreads(2);
+        for (int i = 0; i < NUM_KEYS; ++i) {
+            storage.set(dkv::NO_TX, "key" + std::to_string(i),
+                        "user=name" + std::to_string(i) + ";status=active;role=member;region=default");
+        }
+        storage.setRDBCompression(dkv::RDBCompression::LZF);
+        ASSERT_TRUE(storage.saveRDB(compressed_file));
+        storage.setRDBCompression(dkv::RDBCompression::NONE);
+        ASSERT_TRUE(storage.saveRDB(plain_file));
+        ASSERT_LT(std::filesystem::file_size(compressed_file) * 2, std::filesystem::file_size(plain_file));
+        
+        for (const std::string& filename : {compressed_file, plain_file}) {
+            dkv::StorageEngine loaded(dkv::TransactionIsolationLevel::READ_COMMITTED, 5);
+            loaded.setRDBThreads(2);
+            ASSERT_TRUE(loaded.loadRDB(filename));
+            ASSERT_EQ(loaded.size(), static_cast<size_t>(NUM_KEYS));
+            ASSERT_EQ(loaded.get(dkv::NO_TX, "key4321"),
+                      std::string("user=name4321;status=active;role=member;region=default"));
+        }
+        
+        // 压缩数据块被篡改时校验失败
+        {
+            std::fstream file(compressed_file, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(200);
+            file.put('\x7f');
+        }
+        dkv::StorageEngine corrupted;
+        ASSERT_FALSE(corrupted.loadRDB(compressed_file));
+        ASSERT_EQ(corrupted.size(), static_cast<size_t>(0));
+        std::remove(compressed_file.c_str());
+        std::remove(plain_file.c_str());
+        return true;
+    });
+    
+    // 测试后台加载：访问的键按需载入，之后的修改不被后台加载覆盖
+    runner.runTest("测试RDB后台加载", []() {
+        const std::string filename = "background_dump.rdb";
+        const int NUM_KEYS = 20000;
+        {
+            dkv::StorageEngine storage(dkv::TransactionIsolationLevel::READ_COMMITTED, 16);
+            storage.setRDBThreads(4);
+            for (int i = 0; i < NUM_KEYS; ++i) {
+                storage.set(dkv::NO_TX, "key" + std::to_string(i), "value" + std::to_string(i));
+            }
+            ASSERT_TRUE(storage.saveRDB(filename));
+        }
+
+        dkv::StorageEngine loaded(dkv::TransactionIsolationLevel::READ_COMMITTED, 8);
+        ASSERT_TRUE(loaded.loadRDBInBackground(filename, 1));
+        loaded.loadRDBKeys({"key777", "missing"});
+        ASSERT_EQ(loaded.get(dkv::NO_TX, "key777"), std::string("value777"));
+        loaded.set(dkv::NO_TX, "key777", "changed");
+        loaded.loadRDBKeys({"key778"});
+        ASSERT_TRUE(loaded.del(dkv::NO_TX, "key778"));
+        loaded.finishRDBLoad();
+        ASSERT_FALSE(loaded.rdbLoading());
+        ASSERT_EQ(loaded.size(), static_cast<size_t>(NUM_KEYS - 1));
+        ASSERT_EQ(loaded.get(dkv::NO_TX, "key777"), std::string("changed"));
+        ASSERT_EQ(loaded.get(dkv::NO_TX, "key19999"), std::string("value19999"));
+        dkv::RDBLoadStats stats = loaded.getRDBLoadStats();
+        ASSERT_EQ(stats.total_keys, static_cast<uint64_t>(NUM_KEYS));
+        ASSERT_EQ(stats.loaded_keys, static_cast<uint64_t>(NUM_KEYS));
+        ASSERT_EQ(stats.loaded_chunks, stats.total_chunks);
+        ASSERT_EQ(stats.failed_chunks, static_cast<uint64_t>(0));
+
+        // 文件不存在时返回false，由调用方改为同步加载
+        dkv::StorageEngine missing;
+        ASSERT_FALSE(missing.loadRDBInBackground("no_such_dump.rdb", 1));
+        ASSERT_FALSE(missing.rdbLoading());
+        std::remove(filename.c_str());
+        return true;
+    });
+
+    // 测试仍能加载顺序格式（版本9）的RDB文件
+    runner.runTest("测试加载旧版顺序格式", []() {
+        const std::string filename = "legacy_dump.rdb";
+        {
+            std::ofstream file(filename, std::ios::binary);
+            auto write_int = [&file](int64_t value) {
+                file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+            };
+            auto write_string = [&](const std::string& str) {
+                write_int(static_cast<int64_t>(str.size()));
+                file.write(str.data(), static_cast<std::streamsize>(str.size()));
+            };
+            file.write(dkv::RDB_LEGACY_MAGIC_STRING, 9);
+            write_int(dkv::RDB_LEGACY_VERSION);
+            write_int(2);
+            for (const std::string key : {"old1", "old2"}) {
+                write_int(static_cast<int64_t>(dkv::DataType::STRING));
+                write_string(key);
+                write_int(0);
+                const std::string value = key + "_value";
+                write_string("STRING:" + std::to_string(value.size()) + ":" + value);
+            }
+        }
+        dkv::StorageEngine storage;
+        ASSERT_TRUE(storage.loadRDB(filename));
+        ASSERT_EQ(storage.size(), static_cast<size_t>(2));
+        ASSERT_EQ(storage.get(dkv::NO_TX, "old2"), std::string("old2_value"));
+        std::remove(filename.c_str());
+        return true;
+    });
+    
+    // 测试截断或声明长度越界的文件在映射上解析时被拒绝
+    runner.runTest("测试截断的RDB文件", []() {
+        const std::string filename = "truncated_dump.rdb";
+        {
+            dkv::StorageEngine storage(dkv::TransactionIsolationLevel::READ_COMMITTED, 4);
+            for (int i = 0; i < 1000; ++i) {
+                storage.set(dkv::NO_TX, "key" + std::to_string(i), "value" + std::to_string(i));
+            }
+            ASSERT_TRUE(storage.saveRDB(filename));
+        }
+        const size_t full_size = std::filesystem::file_size(filename);
+        std::filesystem::resize_file(filename, full_size - 5);
+        dkv::StorageEngine truncated;
+        ASSERT_FALSE(truncated.loadRDB(filename));
+        ASSERT_EQ(truncated.size(), static_cast<size_t>(0));
+        
+        // 旧版格式中字符串长度超出文件末尾
+        {
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            auto write_int = [&file](int64_t value) {
+                file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+            };
+            file.write(dkv::RDB_LEGACY_MAGIC_STRING, 9);
+            write_int(dkv::RDB_LEGACY_VERSION);
+            write_int(1);
+            write_int(static_cast<int64_t>(dkv::DataType::STRING));
+            write_int(1 << 30);
+            file.write("key", 3);
+        }
+        dkv::StorageEngine overflow;
+        ASSERT_FALSE(overflow.loadRDB(filename));
+        ASSERT_EQ(overflow.size(), static_cast<size_t>(0));
+        
+        // 空文件
+        std::ofstream(filename, std::ios::binary | std::ios::trunc).close();
+        dkv::StorageEngine empty;
+        ASSERT_FALSE(empty.loadRDB(filename));
+        std::remove(filename.c_str());
+        return true;
+    });
+    
+    // 测试分片迁移的批量数据追加到目标存储引擎，不影响已有的键
+    // 测试写时复制快照：开始后的非事务写入不进入快照，写入不必等待快照保存完成
+    runner.runTest("测试写时复制快照", []() {
+        const int NUM_KEYS = 3000;
+        dkv::StorageEngine storage(dkv::TransactionIsolationLevel::READ_COMMITTED, 8);
+        storage.setRDBThreads(2);
+        for (int i = 0; i < NUM_KEYS; ++i) {
+            storage.set(dkv::NO_TX, "key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        storage.hset(dkv::NO_TX, "hash", "field", "old");
+        
+        ASSERT_TRUE(storage.beginSnapshot());
+        // 快照进行中不能开始另一个快照
+        ASSERT_FALSE(storage.beginSnapshot());
+        for (int i = 0; i < NUM_KEYS; i += 2) {
+            storage.set(dkv::NO_TX, "key" + std::to_string(i), "changed");
+        }
+        storage.del(dkv::NO_TX, "key1");
+        storage.set(dkv::NO_TX, "added", "v");
+        storage.hset(dkv::NO_TX, "hash", "field", "new");
+        
+        std::ostringstream out;
+        ASSERT_TRUE(storage.saveSnapshot(out));
+        ASSERT_EQ(storage.getRDBSaveStats().saved_keys, static_cast<uint64_t>(NUM_KEYS + 1));
+        // 快照结束后写入不再复制，存储引擎中是最新数据
+        storage.set(dkv::NO_TX, "key3", "after");
+        ASSERT_EQ(storage.get(dkv::NO_TX, "key0"), std::string("changed"));
+        ASSERT_EQ(storage.get(dkv::NO_TX, "key3"), std::string("after"));
+        
+        const std::string data = out.str();
+        dkv::StorageEngine loaded;
+        ASSERT_TRUE(loaded.loadRDBFromMemory(data));
+        ASSERT_EQ(loaded.size(), static_cast<size_t>(NUM_KEYS + 1));
+        ASSERT_EQ(loaded.get(dkv::NO_TX, "key0"), std::string("value0"));
+        ASSERT_EQ(loaded.get(dkv::NO_TX, "key1"), std::string("value1"));
+        ASSERT_EQ(loaded.get(dkv::NO_TX, "key3"), std::string("value3"));
+        ASSERT_FALSE(loaded.exists(dkv::NO_TX, "added"));
+        ASSERT_EQ(loaded.hget(dkv::NO_TX, "hash", "field"), std::string("old"));
+        return true;
+    });
+    
+    // 测试保存期间并发写入：覆盖、删除和新建键引起扩容rehash时，快照仍恰好包含开始时刻的每个键一次
+    runner.runTest("测试写时复制快照并发写入", []() {
+        const int NUM_KEYS = 20000;
+        dkv::StorageEngine storage(dkv::TransactionIsolationLevel::READ_COMMITTED, 4);
+        storage.setRDBThreads(2);
+        for (int i = 0; i < NUM_KEYS; ++i) {
+            storage.set(dkv::NO_TX, "key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        
+        ASSERT_TRUE(storage.beginSnapshot());
+        std::atomic<bool> done{false};
+        std::thread writer([&]() {
+            for (int round = 0; !done.load(); ++round) {
+                const int i = round % NUM_KEYS;
+                storage.set(dkv::NO_TX, "key" + std::to_string(i), "changed");
+                storage.del(dkv::NO_TX, "key" + std::to_string((i + 1) % NUM_KEYS));
+                storage.set(dkv::NO_TX, "added" + std::to_string(round), "v");
+            }
+        });
+        std::ostringstream out;
+        const bool saved = storage.saveSnapshot(out);
+        done = true;
+        writer.join();
+        ASSERT_TRUE(saved);
+        ASSERT_EQ(storage.getRDBSaveStats().saved_keys, static_cast<uint64_t>(NUM_KEYS));
+        
+        dkv::StorageEngine loaded;
+        ASSERT_TRUE(loaded.loadRDBFromMemory(out.str()));
+        ASSERT_EQ(loaded.size(), static_cast<size_t>(NUM_KEYS));
+        for (int i = 0; i < NUM_KEYS; ++i) {
+            ASSERT_EQ(loaded.get(dkv::NO_TX, "key" + std::to_string(i)), "value" + std::to_string(i));
+        }
+        return true;
+    });
+    
+    runner.runTest("测试分片迁移批量数据", []() {
+        dkv::StorageEngine source;
+        for (int i = 0; i < 100; ++i) {
+            source.set(dkv::NO_TX, "key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        std::ostringstream items;
+        size_t count = 0;
+        size_t cursor = 0;
+        do {
+            cursor = source.scan(cursor, 16, [&](const dkv::SharedKey& key, const dkv::DataItem& item) {
+                dkv::RDBPersistence::writeBatchItem(items, key, item);
+                count++;
+            });
+        } while (cursor != 0);
+        ASSERT_EQ(count, static_cast<size_t>(100));
+        const std::string batch = dkv::RDBPersistence::finishBatch(items.str(), count);
+
+        dkv::StorageEngine target;
+        target.set(dkv::NO_TX, "existing", "kept");
+        ASSERT_TRUE(dkv::RDBPersistence::loadFromMemory(&target, batch, "batch"));
+        ASSERT_EQ(target.size(), static_cast<size_t>(101));
+        ASSERT_EQ(target.get(dkv::NO_TX, "key42"), std::string("value42"));
+        ASSERT_EQ(target.get(dkv::NO_TX, "existing"), std::string("kept"));
+
+        // 截断的批量数据被拒绝
+        ASSERT_FALSE(dkv::RDBPersistence::loadFromMemory(&target, std::string_view(batch).substr(0, batch.size() - 3), "batch"));
+        return true;
+    });
+
     // 清理测试文件
     std::remove("test_dump.rdb");
     std::remove("auto_dump.rdb");
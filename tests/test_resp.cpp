@@ -0,0 +1,170 @@
+#include "net/dkv_resp.hpp"
+#include "net/dkv_ring_buffer.hpp"
+#include "test_runner.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace dkv {
+
+// 测试完整命令、内联命令与空批量字符串
+bool testParseCompleteFrames() {
+    RESPStreamParser parser;
+    std::vector<std::string_view> args;
+
+    std::string data = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n";
+    ASSERT_TRUE(parser.parse(data, args) == RESPStreamParser::Result::COMPLETE);
+    ASSERT_EQ(parser.consumed(), data.size());
+    ASSERT_EQ(args.size(), static_cast<size_t>(3));
+    ASSERT_EQ(std::string(args[2]), std::string("value"));
+    // 视图直接指向输入数据
+    ASSERT_TRUE(args[1].data() == data.data() + 17);
+
+    std::string inline_data = "GET  key\r\nPING\n";
+    ASSERT_TRUE(parser.parse(inline_data, args) == RESPStreamParser::Result::COMPLETE);
+    ASSERT_EQ(args.size(), static_cast<size_t>(2));
+    ASSERT_EQ(std::string(args[1]), std::string("key"));
+    size_t consumed = parser.consumed();
+    ASSERT_TRUE(parser.parse(std::string_view(inline_data).substr(consumed), args) == RESPStreamParser::Result::COMPLETE);
+    ASSERT_EQ(args.size(), static_cast<size_t>(1));
+    ASSERT_EQ(std::string(args[0]), std::string("PING"));
+
+    std::string null_bulk = "*2\r\n$3\r\nSET\r\n$-1\r\n";
+    ASSERT_TRUE(parser.parse(null_bulk, args) == RESPStreamParser::Result::COMPLETE);
+    ASSERT_EQ(args.size(), static_cast<size_t>(2));
+    ASSERT_TRUE(args[1].empty());
+
+    Command command = RESPProtocol::buildCommand({"SET", "k", "v"});
+    ASSERT_TRUE(command.type == CommandType::SET);
+    ASSERT_EQ(command.args.size(), static_cast<size_t>(2));
+    return true;
+}
+
+// 测试逐字节输入时跨调用保留解析进度
+bool testParseIncremental() {
+    std::string frame = "*2\r\n$4\r\nLLEN\r\n$10\r\nmylist:abc\r\n";
+    std::string stream = frame + frame;
+    RESPStreamParser parser;
+    std::vector<std::string_view> args;
+    std::string buffer;
+    int completed = 0;
+    for (char c : stream) {
+        buffer.push_back(c);
+        auto result = parser.parse(buffer, args);
+        ASSERT_FALSE(result == RESPStreamParser::Result::ERROR);
+        if (result == RESPStreamParser::Result::COMPLETE) {
+            ASSERT_EQ(args.size(), static_cast<size_t>(2));
+            ASSERT_EQ(std::string(args[1]), std::string("mylist:abc"));
+            buffer.erase(0, parser.consumed());
+            completed++;
+        }
+    }
+    ASSERT_EQ(completed, 2);
+    ASSERT_TRUE(buffer.empty());
+    return true;
+}
+
+// 测试协议错误
+bool testParseErrors() {
+    RESPStreamParser parser;
+    std::vector<std::string_view> args;
+    ASSERT_TRUE(parser.parse("*x\r\n", args) == RESPStreamParser::Result::ERROR);
+    ASSERT_FALSE(parser.error().empty());
+    ASSERT_TRUE(parser.parse("*1\r\n+PING\r\n", args) == RESPStreamParser::Result::ERROR);
+    ASSERT_TRUE(parser.parse("*1\r\n$4\r\nPINGXX", args) == RESPStreamParser::Result::ERROR);
+    ASSERT_TRUE(parser.parse("*1\r\n$999999999999\r\n", args) == RESPStreamParser::Result::ERROR);
+    // 出错后可以重新开始解析
+    ASSERT_TRUE(parser.parse("*1\r\n$4\r\nPING\r\n", args) == RESPStreamParser::Result::COMPLETE);
+    return true;
+}
+
+// 测试读缓冲区的复用、搬移与扩容
+bool testRingBuffer() {
+    RingBuffer buffer(64);
+    ASSERT_TRUE(buffer.empty());
+    buffer.append("0123456789", 10);
+    buffer.consume(4);
+    ASSERT_EQ(std::string(buffer.readable()), std::string("456789"));
+
+    // 可写空间不足但总容量足够时，未读数据移回开头而不扩容
+    char* space = buffer.prepareWrite(50);
+    ASSERT_EQ(buffer.capacity(), static_cast<size_t>(64));
+    ASSERT_TRUE(space == buffer.readable().data() + 6);
+    buffer.consume(6);
+    ASSERT_TRUE(buffer.empty());
+
+    // 大请求扩容，读完后释放
+    std::string big(1000, 'x');
+    buffer.append(big.data(), big.size());
+    ASSERT_GE(buffer.capacity(), big.size());
+    ASSERT_EQ(std::string(buffer.readable()), big);
+    buffer.consume(big.size());
+    ASSERT_EQ(buffer.capacity(), static_cast<size_t>(0));
+    return true;
+}
+
+// 测试回复编码器与原有序列化结果一致
+bool testRESPWriter() {
+    std::string out;
+    RESPWriter writer(out);
+    writer.writeSimpleString("PONG");
+    writer.writeError("ERR bad");
+    writer.writeInteger(-42);
+    writer.writeBulkString("hello");
+    writer.writeBulkString("");
+    ASSERT_EQ(out, std::string("+PONG\r\n-ERR bad\r\n:-42\r\n$5\r\nhello\r\n$-1\r\n"));
+
+    std::vector<std::string> array = {"a", "", "long value"};
+    ASSERT_EQ(RESPProtocol::serializeArray(array), std::string("*3\r\n$1\r\na\r\n$-1\r\n$10\r\nlong value\r\n"));
+    ASSERT_EQ(RESPWriter::arraySize(array), RESPProtocol::serializeArray(array).size());
+    ASSERT_EQ(RESPWriter::bulkStringSize(std::string(12345, 'x')), RESPProtocol::serializeBulkString(std::string(12345, 'x')).size());
+    return true;
+}
+
+// 测试命令结果的回复格式：共享常量回复、批量字符串和数组
+bool testWriteResponse() {
+    auto encode = [](const Response& response) {
+        std::string out;
+        RESPWriter(out).writeResponse(response);
+        return out;
+    };
+    ASSERT_EQ(encode(Response(ResponseStatus::OK)), std::string(RESPProtocol::OK_REPLY));
+    ASSERT_EQ(encode(Response(ResponseStatus::NOT_FOUND)), std::string(RESPProtocol::NULL_REPLY));
+    ASSERT_EQ(encode(Response(ResponseStatus::OK, "", "0")), std::string(RESPProtocol::ZERO_REPLY));
+    ASSERT_EQ(encode(Response(ResponseStatus::OK, "", "1")), std::string(RESPProtocol::ONE_REPLY));
+    ASSERT_EQ(encode(Response(ResponseStatus::OK, "", "15")), std::string("$2\r\n15\r\n"));
+    ASSERT_EQ(encode(Response(ResponseStatus::ERROR, "oops")), std::string("-oops\r\n"));
+
+    // 数组回复与先序列化到data再按批量字符串返回的结果一致
+    std::vector<std::string> elements = {"field", "value", ""};
+    Response legacy(ResponseStatus::OK, "", RESPProtocol::serializeArray(elements));
+    Response array(ResponseStatus::OK);
+    array.setArray(std::vector<std::string>(elements));
+    ASSERT_EQ(encode(array), encode(legacy));
+
+    Response empty(ResponseStatus::OK);
+    empty.setArray({});
+    ASSERT_EQ(encode(empty), std::string("$4\r\n*0\r\n\r\n"));
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV RESP解析测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("完整命令解析", testParseCompleteFrames);
+    runner.runTest("增量解析", testParseIncremental);
+    runner.runTest("协议错误", testParseErrors);
+    runner.runTest("读缓冲区", testRingBuffer);
+    runner.runTest("回复编码器", testRESPWriter);
+    runner.runTest("命令结果回复格式", testWriteResponse);
+
+    runner.printSummary();
+
+    return 0;
+}
@@ -2,6 +2,8 @@
 #include "storage/dkv_storage.hpp"
 #include "net/dkv_network.hpp"
 #include "dkv_server.hpp"
+#include "dkv_script_cache.hpp"
+#include "dkv_utils.hpp"
 #include "test_runner.hpp"
 #include <iostream>
 #include <cassert>
@@ -113,6 +115,97 @@ print(r);
     return true;
 }
 
+// 测试脚本缓存：SCRIPT LOAD返回源码的SHA1，EVALSHA执行缓存的编译结果
+bool testScriptCache() {
+    ASSERT_EQ(Utils::sha1Hex(""), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    ASSERT_EQ(Utils::sha1Hex("abc"), "a9993e364706816aba3e25717850c26c9cd0d89d");
+
+    DKVServer server(6385);
+    if (!server.start()) {
+        cout << "无法启动测试服务器" << endl;
+        return false;
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+
+    // 服务器停止时会保存RDB，先清除上次运行留下的计数
+    server.executeCommand(Command(CommandType::DEL, {"script_cache_counter"}), NO_TX);
+    string script = R"(
+command("INCR script_cache_counter");
+)";
+    Response load = server.executeCommand(Command(CommandType::SCRIPT, {"LOAD", base64Encode(script)}), NO_TX);
+    ASSERT_TRUE(load.status == ResponseStatus::OK);
+    ASSERT_EQ(load.data, Utils::sha1Hex(script));
+
+    Response exists = server.executeCommand(Command(CommandType::SCRIPT, {"EXISTS", load.data, "0000"}), NO_TX);
+    ASSERT_EQ(exists.elements.size(), static_cast<size_t>(2));
+    ASSERT_EQ(exists.elements[0], "1");
+    ASSERT_EQ(exists.elements[1], "0");
+
+    for (int i = 0; i < 3; i++) {
+        Response resp = server.executeCommand(Command(CommandType::EVALSHA, {load.data, "0"}), NO_TX);
+        ASSERT_TRUE(resp.status == ResponseStatus::OK);
+    }
+    // 相同源码的EVALX命中SCRIPT LOAD缓存的编译结果
+    Response evalx = server.executeCommand(Command(CommandType::EVALX, {base64Encode(script), "0"}), NO_TX);
+    ASSERT_TRUE(evalx.status == ResponseStatus::OK);
+    Response get = server.executeCommand(Command(CommandType::GET, {"script_cache_counter"}), NO_TX);
+    ASSERT_EQ(get.data, "4");
+
+    Response info = server.executeCommand(Command(CommandType::INFO, {}), NO_TX);
+    ASSERT_CONTAINS(info.data, "script_cache_hits:4\r\n");
+    ASSERT_CONTAINS(info.data, "script_cache_hit_rate:100.00\r\n");
+
+    server.executeCommand(Command(CommandType::SCRIPT, {"FLUSH"}), NO_TX);
+    Response missing = server.executeCommand(Command(CommandType::EVALSHA, {load.data, "0"}), NO_TX);
+    ASSERT_TRUE(missing.status == ResponseStatus::ERROR);
+    ASSERT_CONTAINS(missing.message, "NOSCRIPT");
+
+    server.stop();
+    return true;
+}
+
+// 测试脚本中的命令：持有整个键空间执行，不允许的命令返回错误而不中断脚本
+bool testScriptCommands() {
+    DKVServer server(6386);
+    if (!server.start()) {
+        cout << "无法启动测试服务器" << endl;
+        return false;
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+    server.executeCommand(Command(CommandType::DEL, {"script_counter", "script_info"}), NO_TX);
+
+    string script;
+    for (int i = 0; i < 50; i++) {
+        script += "command(\"INCR script_counter\");\n";
+    }
+    script += "let info: string = command(\"INFO\");\n";
+    script += "command(\"SET script_info \" + info);\n";
+    Response resp = server.executeCommand(Command(CommandType::EVALX, {base64Encode(script), "0"}), NO_TX);
+    ASSERT_TRUE(resp.status == ResponseStatus::OK);
+    ASSERT_EQ(server.executeCommand(Command(CommandType::GET, {"script_counter"}), NO_TX).data, "50");
+    ASSERT_CONTAINS(server.executeCommand(Command(CommandType::GET, {"script_info"}), NO_TX).data, "(error)");
+
+    server.stop();
+    return true;
+}
+
+// 测试缓存容量：超过上限时淘汰最久未使用的脚本
+bool testScriptCacheEviction() {
+    ScriptCache cache(2);
+    string a = cache.load("command(\"GET a\");\n");
+    string b = cache.load("command(\"GET b\");\n");
+    ASSERT_TRUE(cache.find(a) != nullptr); // a变为最近使用
+    string c = cache.load("command(\"GET c\");\n");
+    ASSERT_TRUE(cache.exists(a));
+    ASSERT_FALSE(cache.exists(b));
+    ASSERT_TRUE(cache.exists(c));
+    ScriptCacheStats stats = cache.stats();
+    ASSERT_EQ(stats.scripts, static_cast<size_t>(2));
+    ASSERT_EQ(stats.evictions, static_cast<uint64_t>(1));
+    ASSERT_EQ(stats.hits, static_cast<uint64_t>(1));
+    return true;
+}
+
 bool testEvalXInvalidScript() {
     // 创建DKV服务器实例
     DKVServer server(6384); // 使用不同端口避免冲突
@@ -164,6 +257,9 @@ int main() {
     
     // 运行所有测试
     runner.runTest("EVALX样例脚本", testEvalXSampleScript);
+    runner.runTest("脚本缓存", testScriptCache);
+    runner.runTest("脚本中的命令", testScriptCommands);
+    runner.runTest("脚本缓存淘汰", testScriptCacheEviction);
     // runner.runTest("EVALX无效脚本", testEvalXInvalidScript); // 当前LIB实现会panic，等待更改为返回错误码后恢复此测试
     
     // 打印测试总结
@@ -0,0 +1,96 @@
+#include "storage/dkv_segment_mutex.hpp"
+#include "test_runner.hpp"
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace dkv {
+
+// 测试读锁重入、同时持有多把读锁以及读写互斥
+bool testSegmentMutexBasic() {
+    SegmentMutex a, b;
+    {
+        std::shared_lock<SegmentMutex> r1(a);
+        // 同一线程对同一把锁重复加读锁
+        std::shared_lock<SegmentMutex> r2(a);
+        // 第二把锁退回内部shared_mutex
+        std::shared_lock<SegmentMutex> r3(b);
+        // 持有读锁时写锁获取失败
+        std::thread writer([&]() {
+            ASSERT_FALSE(a.try_lock());
+            ASSERT_FALSE(b.try_lock());
+        });
+        writer.join();
+    }
+    ASSERT_TRUE(a.try_lock());
+    std::thread reader([&]() {
+        ASSERT_FALSE(a.try_lock_shared());
+    });
+    reader.join();
+    a.unlock();
+    ASSERT_TRUE(a.try_lock_shared());
+    a.unlock_shared();
+    ASSERT_TRUE(b.try_lock());
+    b.unlock();
+    return true;
+}
+
+// 并发读写：写者在写锁内修改两个计数器，读者在读锁内看到的两个值总是相等
+bool testSegmentMutexConcurrent() {
+    const int READERS = 6;
+    const int READS = 50000;
+    const int WRITES = 5000;
+    SegmentMutex mutex;
+    long first = 0, second = 0;
+    std::atomic<int> torn{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < READERS; ++i) {
+        threads.emplace_back([&]() {
+            for (int n = 0; n < READS; ++n) {
+                std::shared_lock<SegmentMutex> lock(mutex);
+                if (first != second) {
+                    torn++;
+                }
+            }
+        });
+    }
+    threads.emplace_back([&]() {
+        for (int i = 0; i < WRITES; ++i) {
+            std::unique_lock<SegmentMutex> lock(mutex);
+            first++;
+            if (i % 64 == 0) {
+                // 拉长写者的临界区，让读者有机会与写者交错
+                std::this_thread::yield();
+            }
+            second++;
+        }
+    });
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(torn.load(), 0);
+    ASSERT_EQ(first, static_cast<long>(WRITES));
+    ASSERT_EQ(second, static_cast<long>(WRITES));
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 分段读写锁测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("读锁重入与读写互斥", testSegmentMutexBasic);
+    runner.runTest("并发读写", testSegmentMutexConcurrent);
+
+    runner.printSummary();
+
+    return 0;
+}
@@ -1,9 +1,12 @@
 #include <iostream>
+#include <algorithm>
 #include <cassert>
 #include <thread>
 #include <chrono>
+#include <vector>
 #include "dkv_server.hpp"
 #include "dkv_core.hpp"
+#include "dkv_trace.hpp"
 #include "test_runner.hpp"
 
 // 测试服务器管理命令
@@ -14,6 +17,9 @@ void testServerManagement(dkv::TestRunner& runner) {
     dkv::DKVServer server(6380);
     server.setRDBEnabled(false);
     server.setAOFEnabled(false);
+    dkv::ClientOutputLimit output_limit;
+    output_limit.hard_bytes = 8 * 1024 * 1024;
+    server.setClientOutputLimit(output_limit);
 
     // 启动服务器
     if (!server.start()) {
@@ -47,7 +53,7 @@ void testServerManagement(dkv::TestRunner& runner) {
     // 测试函数：发送命令并接收响应
     auto sendCommand = [sock](const std::string& cmd) -> std::string {
         send(sock, cmd.c_str(), cmd.length(), 0);
-        char buffer[1024] = {0};
+        char buffer[8192] = {0};
         int bytes_read = recv(sock, buffer, sizeof(buffer) - 1, 0);
         return std::string(buffer, bytes_read);
     };
@@ -83,6 +89,116 @@ void testServerManagement(dkv::TestRunner& runner) {
         return dbsize_response.find("$1\r\n0") != std::string::npos;
     });
     
+    runner.runTest("测试UNLINK与FLUSHDB ASYNC", [&]() {
+        sendCommand("SET k1 v1\r\n");
+        sendCommand("SADD s a b c\r\n");
+        std::string unlink_response = sendCommand("UNLINK k1 s missing\r\n");
+        sendCommand("SET k2 v2\r\n");
+        std::string flush_response = sendCommand("FLUSHDB async\r\n");
+        std::string dbsize_response = sendCommand("DBSIZE\r\n");
+        std::string bad_response = sendCommand("FLUSHDB LATER\r\n");
+        return unlink_response.find("2") != std::string::npos && flush_response.find("+OK") != std::string::npos &&
+               dbsize_response.find("$1\r\n0") != std::string::npos && bad_response[0] == '-';
+    });
+    
+    runner.runTest("测试流水线命令按序回复", [&]() {
+        // 一次发送多条命令，回复应按发送顺序合并返回
+        const int count = 200;
+        std::string batch;
+        for (int i = 0; i < count; ++i) {
+            batch += "*2\r\n$4\r\nINCR\r\n$8\r\npipeline\r\n";
+        }
+        send(sock, batch.c_str(), batch.length(), 0);
+
+        std::string expected;
+        for (int i = 1; i <= count; ++i) {
+            std::string value = std::to_string(i);
+            expected += "$" + std::to_string(value.length()) + "\r\n" + value + "\r\n";
+        }
+        std::string received;
+        char buffer[4096];
+        while (received.length() < expected.length()) {
+            int bytes_read = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes_read <= 0) {
+                return false;
+            }
+            received.append(buffer, bytes_read);
+        }
+        return received == expected;
+    });
+
+    // 512KB的大值，用于填满socket发送缓冲区
+    const std::string big_value(512 * 1024, 'x');
+    const std::string get_big = "*2\r\n$3\r\nGET\r\n$3\r\nbig\r\n";
+    const std::string big_reply = "$" + std::to_string(big_value.length()) + "\r\n" + big_value + "\r\n";
+    {
+        std::string set_big = "*3\r\n$3\r\nSET\r\n$3\r\nbig\r\n$" +
+                              std::to_string(big_value.length()) + "\r\n" + big_value + "\r\n";
+        sendCommand(set_big);
+    }
+
+    runner.runTest("测试慢客户端大回复完整写出", [&]() {
+        // 回复总量超过socket缓冲区，客户端延迟读取，剩余部分应在可写后继续写出
+        const int count = 8;
+        std::string batch;
+        for (int i = 0; i < count; ++i) {
+            batch += get_big;
+        }
+        send(sock, batch.c_str(), batch.length(), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        std::string expected;
+        for (int i = 0; i < count; ++i) {
+            expected += big_reply;
+        }
+        std::string received;
+        char buffer[65536];
+        while (received.length() < expected.length()) {
+            int bytes_read = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes_read <= 0) {
+                return false;
+            }
+            received.append(buffer, bytes_read);
+        }
+        return received == expected;
+    });
+
+    runner.runTest("测试输出缓冲区超限断开连接", [&]() {
+        int slow = socket(AF_INET, SOCK_STREAM, 0);
+        if (slow < 0 || connect(slow, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            return false;
+        }
+        struct timeval timeout = {5, 0};
+        setsockopt(slow, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        // 请求32MB回复但不读取，待发送数据超过8MB硬限制后服务器应断开连接
+        const int count = 64;
+        std::string batch;
+        for (int i = 0; i < count; ++i) {
+            batch += get_big;
+        }
+        send(slow, batch.c_str(), batch.length(), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+        size_t total = 0;
+        char buffer[65536];
+        while (true) {
+            int bytes_read = recv(slow, buffer, sizeof(buffer), 0);
+            if (bytes_read <= 0) {
+                break;
+            }
+            total += bytes_read;
+        }
+        close(slow);
+        return total < big_reply.length() * count;
+    });
+
+    // 硬限制只影响超限的连接
+    runner.runTest("验证其他连接不受影响", [&]() {
+        std::string response = sendCommand("DBSIZE\r\n");
+        return response.find("$1\r\n2") != std::string::npos;
+    });
+
     // 关闭连接
     close(sock);
     
@@ -93,6 +209,677 @@ void testServerManagement(dkv::TestRunner& runner) {
     std::cout << "服务器已停止" << std::endl;
 }
 
+// 测试run-to-completion模式：普通命令在SubReactor线程上执行，耗时命令交给工作线程池
+void testRunToCompletion(dkv::TestRunner& runner) {
+    std::cout << "开始测试run-to-completion模式..." << std::endl;
+
+    dkv::DKVServer server(6381);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    server.setRunToCompletion(true);
+    if (!server.start()) {
+        std::cerr << "服务器启动失败" << std::endl;
+        return;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(6381);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (sock < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cerr << "连接服务器失败" << std::endl;
+        if (sock >= 0) {
+            close(sock);
+        }
+        server.stop();
+        return;
+    }
+
+    runner.runTest("测试直接执行与线程池执行的命令按序回复", [&]() {
+        // 分多次发送，FLUSHDB所在的批次交给线程池，其后的命令须等它完成后再执行
+        const int count = 100;
+        std::string incrs;
+        std::string expected;
+        for (int i = 1; i <= count; ++i) {
+            incrs += "*2\r\n$4\r\nINCR\r\n$3\r\nrtc\r\n";
+            std::string value = std::to_string(i);
+            expected += "$" + std::to_string(value.length()) + "\r\n" + value + "\r\n";
+        }
+        std::string flush = "*1\r\n$7\r\nFLUSHDB\r\n";
+        send(sock, incrs.c_str(), incrs.length(), 0);
+        send(sock, flush.c_str(), flush.length(), 0);
+        send(sock, incrs.c_str(), incrs.length(), 0);
+        expected = expected + "+OK\r\n" + expected;
+
+        std::string received;
+        char buffer[4096];
+        while (received.length() < expected.length()) {
+            int bytes_read = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes_read <= 0) {
+                return false;
+            }
+            received.append(buffer, bytes_read);
+        }
+        return received == expected;
+    });
+
+    close(sock);
+    server.stop();
+}
+
+// 测试SO_REUSEPORT模式：各SubReactor各自接受连接
+void testReusePort(dkv::TestRunner& runner) {
+    std::cout << "开始测试SO_REUSEPORT模式..." << std::endl;
+
+    dkv::DKVServer server(6382);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    server.setReusePort(true);
+    if (!server.start()) {
+        std::cerr << "服务器启动失败" << std::endl;
+        return;
+    }
+
+    runner.runTest("测试多个连接由各SubReactor接受并正常执行命令", [&]() {
+        struct sockaddr_in addr;
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(6382);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+        const int count = 32;
+        std::vector<int> socks;
+        bool ok = true;
+        for (int i = 0; i < count && ok; ++i) {
+            int sock = socket(AF_INET, SOCK_STREAM, 0);
+            if (sock < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+                ok = false;
+            }
+            if (sock >= 0) {
+                socks.push_back(sock);
+            }
+        }
+        for (size_t i = 0; i < socks.size() && ok; ++i) {
+            std::string cmd = "*2\r\n$4\r\nINCR\r\n$5\r\nconns\r\n";
+            send(socks[i], cmd.c_str(), cmd.length(), 0);
+            char buffer[64] = {0};
+            int bytes_read = recv(socks[i], buffer, sizeof(buffer) - 1, 0);
+            std::string value = std::to_string(i + 1);
+            std::string expected = "$" + std::to_string(value.length()) + "\r\n" + value + "\r\n";
+            ok = bytes_read > 0 && std::string(buffer, bytes_read) == expected;
+        }
+        for (int sock : socks) {
+            close(sock);
+        }
+        return ok;
+    });
+
+    server.stop();
+}
+
+// 测试io_uring后端，内核不支持时退回epoll，结果应一致
+void testIoUringBackend(dkv::TestRunner& runner) {
+    std::cout << "开始测试io_uring网络后端..." << std::endl;
+
+    dkv::DKVServer server(6383);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    server.setReusePort(true);
+    server.setIoBackend(dkv::IoBackend::IO_URING);
+    if (!server.start()) {
+        std::cerr << "服务器启动失败" << std::endl;
+        return;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(6383);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (sock < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cerr << "连接服务器失败" << std::endl;
+        if (sock >= 0) {
+            close(sock);
+        }
+        server.stop();
+        return;
+    }
+
+    auto receive = [&](size_t length, std::string& received) {
+        char buffer[4096];
+        while (received.length() < length) {
+            int bytes_read = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes_read <= 0) {
+                return false;
+            }
+            received.append(buffer, bytes_read);
+        }
+        return true;
+    };
+
+    runner.runTest("测试流水线命令按序回复", [&]() {
+        const int count = 1000;
+        std::string commands;
+        std::string expected;
+        for (int i = 1; i <= count; ++i) {
+            commands += "*2\r\n$4\r\nINCR\r\n$5\r\nuring\r\n";
+            std::string value = std::to_string(i);
+            expected += "$" + std::to_string(value.length()) + "\r\n" + value + "\r\n";
+        }
+        send(sock, commands.c_str(), commands.length(), 0);
+        std::string received;
+        return receive(expected.length(), received) && received == expected;
+    });
+
+    runner.runTest("测试大于接收缓冲区的请求与回复", [&]() {
+        std::string value(1024 * 1024, 'u');
+        std::string set = "*3\r\n$3\r\nSET\r\n$3\r\nbig\r\n$" + std::to_string(value.length()) + "\r\n" + value + "\r\n";
+        std::string get = "*2\r\n$3\r\nGET\r\n$3\r\nbig\r\n";
+        std::string commands = set + get;
+        size_t sent = 0;
+        while (sent < commands.length()) {
+            ssize_t n = send(sock, commands.data() + sent, commands.length() - sent, 0);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        std::string expected = "+OK\r\n$" + std::to_string(value.length()) + "\r\n" + value + "\r\n";
+        std::string received;
+        return receive(expected.length(), received) && received == expected;
+    });
+
+    close(sock);
+    server.stop();
+}
+
+// 测试CLIENT TRACKING：读过的键被其他连接修改后收到失效通知
+void testClientTracking(dkv::TestRunner& runner) {
+    std::cout << "开始测试客户端缓存失效通知..." << std::endl;
+
+    runner.runTest("测试失效表淘汰记录时通知清空全部缓存", [&]() {
+        dkv::ClientTracking tracking;
+        tracking.setMaxKeys(1);
+        dkv::TrackingClient client{nullptr, 7, 1};
+        tracking.enable(client);
+        tracking.recordRead(nullptr, 1, {"a"});
+        tracking.recordRead(nullptr, 1, {"b"});
+        auto evicted = tracking.takeInvalidations();
+        bool ok = evicted.size() == 1 && evicted[0].flush_all && evicted[0].client.fd == 7 && tracking.keys() == 1;
+        tracking.disable(nullptr, 1);
+        tracking.invalidate({"b"});
+        return ok && tracking.keys() == 0 && tracking.takeInvalidations().empty();
+    });
+
+    dkv::DKVServer server(6389, 2, 2);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    if (!server.start()) {
+        std::cerr << "服务器启动失败" << std::endl;
+        return;
+    }
+
+    auto connectClient = []() {
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(6389);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        if (sock >= 0 && connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(sock);
+            return -1;
+        }
+        // 没有收到预期的通知时不无限等待
+        struct timeval timeout{2, 0};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return sock;
+    };
+    auto request = [](int sock, const std::string& cmd, const std::string& expected) {
+        send(sock, cmd.c_str(), cmd.length(), 0);
+        std::string received;
+        char buffer[1024];
+        while (received.length() < expected.length()) {
+            int bytes_read = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes_read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes_read <= 0) {
+                break;
+            }
+            received.append(buffer, bytes_read);
+        }
+        return received == expected;
+    };
+    const std::string push_k1 = ">2\r\n$10\r\ninvalidate\r\n*1\r\n$2\r\nk1\r\n";
+    const std::string push_flush = ">2\r\n$10\r\ninvalidate\r\n_\r\n";
+
+    int tracker = connectClient();
+    int writer = connectClient();
+    if (tracker < 0 || writer < 0) {
+        std::cerr << "连接服务器失败" << std::endl;
+        server.stop();
+        return;
+    }
+
+    runner.runTest("测试读过的键被修改后收到失效通知", [&]() {
+        return request(writer, "SET k1 v1\r\n", "+OK\r\n") &&
+               request(tracker, "CLIENT TRACKING ON\r\n", "+OK\r\n") &&
+               request(tracker, "GET k1\r\n", "$2\r\nv1\r\n") &&
+               request(writer, "SET k1 v2\r\n", "+OK\r\n") &&
+               request(tracker, "", push_k1);
+    });
+
+    runner.runTest("测试通知后需要再次读取才重新登记", [&]() {
+        // 第一次修改已清除记录，第二次修改不再通知；再次读取后修改重新通知
+        return request(writer, "SET k1 v3\r\n", "+OK\r\n") &&
+               request(tracker, "GET k1\r\n", "$2\r\nv3\r\n") &&
+               request(writer, "DEL k1\r\n", "$1\r\n1\r\n") &&
+               request(tracker, "", push_k1);
+    });
+
+    runner.runTest("测试FLUSHDB通知清空全部缓存", [&]() {
+        return request(tracker, "GET k2\r\n", "$-1\r\n") &&
+               request(writer, "FLUSHDB\r\n", "+OK\r\n") &&
+               request(tracker, "", push_flush);
+    });
+
+    runner.runTest("测试关闭跟踪后不再收到通知", [&]() {
+        bool ok = request(tracker, "GET k1\r\n", "$-1\r\n") &&
+                  request(tracker, "CLIENT TRACKING OFF\r\n", "+OK\r\n") &&
+                  request(writer, "SET k1 v4\r\n", "+OK\r\n");
+        // 之后的回复前没有夹带通知
+        return ok && request(tracker, "GET k1\r\n", "$2\r\nv4\r\n");
+    });
+
+    runner.runTest("测试CLIENT参数错误", [&]() {
+        std::string cmd = "CLIENT KILL x\r\n";
+        send(writer, cmd.c_str(), cmd.length(), 0);
+        char buffer[256];
+        int bytes_read = recv(writer, buffer, sizeof(buffer), 0);
+        return bytes_read > 0 && buffer[0] == '-';
+    });
+
+    close(tracker);
+    close(writer);
+    server.stop();
+}
+
+// 测试发布订阅：模式前缀树匹配，多个SubReactor上的订阅者收到同一条消息
+void testPubSub(dkv::TestRunner& runner) {
+    std::cout << "开始测试发布订阅..." << std::endl;
+
+    runner.runTest("测试模式前缀树匹配", [&]() {
+        dkv::PatternTrie trie;
+        bool ok = trie.add("news.*", {1, 1}) && trie.add("news.*", {2, 2}) && !trie.add("news.*", {1, 1}) &&
+                  trie.add("h?llo", {1, 1}) && trie.add("h[^e]llo", {3, 3}) && trie.add("a\\*b", {1, 1}) &&
+                  trie.add("[a-c]*z", {4, 4});
+        auto matched = [&](const std::string& channel) {
+            std::vector<std::string> patterns;
+            trie.match(channel, [&](const std::string& pattern, const std::vector<dkv::Subscriber>& subscribers) {
+                patterns.push_back(pattern + ":" + std::to_string(subscribers.size()));
+            });
+            std::sort(patterns.begin(), patterns.end());
+            return patterns;
+        };
+        ok = ok && matched("news.sport") == std::vector<std::string>{"news.*:2"} &&
+             matched("hello") == std::vector<std::string>{"h?llo:1"} &&
+             matched("hallo") == std::vector<std::string>{"h?llo:1", "h[^e]llo:1"} &&
+             matched("a*b").size() == 1 && matched("axb").empty() && matched("bxyz").size() == 1 &&
+             matched("dz").empty() && trie.patterns() == 5;
+        ok = ok && trie.remove("news.*", {1, 1}) && !trie.remove("news.*", {1, 1}) &&
+             matched("news.x") == std::vector<std::string>{"news.*:1"} && trie.remove("news.*", {2, 2}) &&
+             matched("news.x").empty() && trie.patterns() == 4;
+        return ok;
+    });
+
+    dkv::DKVServer server(6409, 2, 2);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    if (!server.start()) {
+        std::cerr << "服务器启动失败" << std::endl;
+        return;
+    }
+
+    auto connectClient = []() {
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(6409);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        if (sock >= 0 && connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(sock);
+            return -1;
+        }
+        struct timeval timeout{2, 0};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return sock;
+    };
+    // 发送命令并读取，直到收到的内容以expected结尾
+    auto request = [](int sock, const std::string& cmd, const std::string& expected) {
+        send(sock, cmd.c_str(), cmd.length(), 0);
+        std::string received;
+        char buffer[1024];
+        while (received.length() < expected.length() ||
+               received.compare(received.length() - expected.length(), expected.length(), expected) != 0) {
+            int bytes_read = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes_read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes_read <= 0) {
+                return false;
+            }
+            received.append(buffer, bytes_read);
+        }
+        return true;
+    };
+
+    std::vector<int> subscribers;
+    for (int i = 0; i < 4; ++i) {
+        subscribers.push_back(connectClient());
+    }
+    int pattern_subscriber = connectClient();
+    int publisher = connectClient();
+    if (pattern_subscriber < 0 || publisher < 0 ||
+        std::find(subscribers.begin(), subscribers.end(), -1) != subscribers.end()) {
+        std::cerr << "连接服务器失败" << std::endl;
+        server.stop();
+        return;
+    }
+
+    runner.runTest("测试订阅后所有订阅者收到消息", [&]() {
+        for (int sock : subscribers) {
+            if (!request(sock, "SUBSCRIBE news other\r\n", "$5\r\nother\r\n$1\r\n2\r\n\r\n")) {
+                return false;
+            }
+        }
+        if (!request(pattern_subscriber, "PSUBSCRIBE ne*\r\n", "$3\r\nne*\r\n$1\r\n1\r\n\r\n") ||
+            !request(publisher, "PUBLISH news hello\r\n", "$1\r\n5\r\n")) {
+            return false;
+        }
+        const std::string message = ">3\r\n$7\r\nmessage\r\n$4\r\nnews\r\n$5\r\nhello\r\n";
+        for (int sock : subscribers) {
+            if (!request(sock, "", message)) {
+                return false;
+            }
+        }
+        return request(pattern_subscriber, "", ">4\r\n$8\r\npmessage\r\n$3\r\nne*\r\n$4\r\nnews\r\n$5\r\nhello\r\n");
+    });
+
+    runner.runTest("测试取消订阅与断开连接后不再计入接收者", [&]() {
+        bool ok = request(subscribers[0], "UNSUBSCRIBE news\r\n", "$4\r\nnews\r\n$1\r\n1\r\n\r\n") &&
+                  request(subscribers[1], "UNSUBSCRIBE\r\n", "$1\r\n0\r\n\r\n") &&
+                  request(pattern_subscriber, "PUNSUBSCRIBE\r\n", "$1\r\n0\r\n\r\n");
+        close(subscribers[3]);
+        subscribers.pop_back();
+        // 断开连接由事件循环异步处理，等待其清除订阅
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return ok && request(publisher, "PUBLISH news again\r\n", "$1\r\n1\r\n") &&
+               request(subscribers[2], "", ">3\r\n$7\r\nmessage\r\n$4\r\nnews\r\n$5\r\nagain\r\n");
+    });
+
+    for (int sock : subscribers) {
+        close(sock);
+    }
+    close(pattern_subscriber);
+    close(publisher);
+    server.stop();
+}
+
+// 测试命令延迟统计：直方图分桶、INFO commandstats、LATENCY HISTOGRAM、SLOWLOG和DEBUG TRACE
+void testLatencyStats(dkv::TestRunner& runner) {
+    std::cout << "开始测试命令延迟统计..." << std::endl;
+
+    runner.runTest("测试直方图分桶与分位数", [&]() {
+        using dkv::HdrHistogram;
+        // 每个桶的上界与下一个桶的第一个值相邻，值落在自己的桶内
+        for (size_t i = 0; i + 2 < HdrHistogram::BUCKETS; ++i) {
+            uint64_t upper = HdrHistogram::bucketUpperBound(i);
+            if (HdrHistogram::bucketIndex(upper) != i || HdrHistogram::bucketIndex(upper + 1) != i + 1) {
+                return false;
+            }
+        }
+        HdrHistogram histogram;
+        if (histogram.percentile(99) != 0) {
+            return false;
+        }
+        for (int i = 0; i < 98; i++) {
+            histogram.record(100);
+        }
+        histogram.record(5000);
+        histogram.record(5000);
+        // 相对误差不超过1/16
+        uint64_t p50 = histogram.percentile(50);
+        uint64_t p99 = histogram.percentile(99);
+        auto powers = histogram.cumulativePowersOfTwo();
+        return histogram.count() == 100 && histogram.max() == 5000 && p50 >= 100 && p50 <= 106 &&
+               p99 >= 5000 && p99 <= 5000 && !powers.empty() && powers.back().first == 8192 &&
+               powers.back().second == 100;
+    });
+
+    runner.runTest("测试慢查询日志的长度上限与参数截断", [&]() {
+        dkv::LatencyMonitor monitor;
+        monitor.setSlowLogThreshold(100);
+        monitor.setSlowLogMaxLen(2);
+        std::vector<std::string> args(40, "v");
+        args[0] = std::string(200, 'k');
+        monitor.recordCommand(dkv::Command(dkv::CommandType::GET, {"fast"}), 50);
+        monitor.recordCommand(dkv::Command(dkv::CommandType::GET, {"a"}), 100);
+        monitor.recordCommand(dkv::Command(dkv::CommandType::SET, {"b", "1"}), 200);
+        monitor.recordCommand(dkv::Command(dkv::CommandType::MSET, args), 300);
+        auto entries = monitor.slowLog(10);
+        bool ok = monitor.slowLogLen() == 2 && entries.size() == 2 && entries[0].duration_us == 300 &&
+                  entries[1].args == std::vector<std::string>{"SET", "b", "1"} &&
+                  entries[0].args.size() == dkv::LatencyMonitor::SLOWLOG_MAX_ARGS &&
+                  entries[0].args[1].find("more bytes") != std::string::npos &&
+                  entries[0].args.back() == "... (10 more arguments)";
+        monitor.setSlowLogThreshold(-1);
+        monitor.recordCommand(dkv::Command(dkv::CommandType::GET, {"a"}), 1000000);
+        return ok && monitor.slowLogLen() == 2 && monitor.command(dkv::CommandType::GET).count() == 3;
+    });
+
+    dkv::DKVServer server(6390, 2, 2);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    if (!server.start()) {
+        std::cerr << "服务器启动失败" << std::endl;
+        return;
+    }
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(6390);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (sock < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cerr << "连接服务器失败" << std::endl;
+        if (sock >= 0) {
+            close(sock);
+        }
+        server.stop();
+        return;
+    }
+    struct timeval timeout{2, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    // 发送命令并读取回复，直到回复中出现expected
+    auto request = [sock](const std::string& cmd, const std::string& expected) {
+        send(sock, cmd.c_str(), cmd.length(), 0);
+        std::string received;
+        char buffer[4096];
+        while (received.find(expected) == std::string::npos) {
+            int bytes_read = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes_read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes_read <= 0) {
+                break;
+            }
+            received.append(buffer, bytes_read);
+        }
+        return received;
+    };
+    auto contains = [](const std::string& text, const std::string& part) {
+        return text.find(part) != std::string::npos;
+    };
+
+    runner.runTest("测试INFO commandstats", [&]() {
+        request("SET lat_key v\r\n", "+OK\r\n");
+        request("GET lat_key\r\n", "v\r\n");
+        request("GET lat_key\r\n", "v\r\n");
+        std::string info = request("INFO commandstats\r\n", "latency_stage_write");
+        return contains(info, "# Commandstats") && contains(info, "cmdstat_get:calls=2,") &&
+               contains(info, "cmdstat_set:calls=1,") && contains(info, "latency_percentiles_usec_get:p50=") &&
+               contains(info, "latency_stage_queue:calls=");
+    });
+
+    runner.runTest("测试LATENCY HISTOGRAM", [&]() {
+        std::string reply = request("LATENCY HISTOGRAM get\r\n", "histogram_usec=");
+        std::string unknown = request("LATENCY HISTOGRAM nosuchcmd\r\n", "\r\n");
+        return contains(reply, "get calls=2 histogram_usec=") && !contains(reply, "set calls") &&
+               !contains(unknown, "calls=");
+    });
+
+    runner.runTest("测试SLOWLOG", [&]() {
+        request("SLOWLOG RESET\r\n", "+OK\r\n");
+        server.latencyMonitor().setSlowLogThreshold(0);
+        request("SET slow_key slow_value\r\n", "+OK\r\n");
+        server.latencyMonitor().setSlowLogThreshold(-1);
+        std::string len = request("SLOWLOG LEN\r\n", "\r\n1\r\n");
+        std::string entries = request("SLOWLOG GET\r\n", "slow_value");
+        std::string reset = request("SLOWLOG RESET\r\n", "+OK\r\n");
+        std::string after = request("SLOWLOG LEN\r\n", "\r\n0\r\n");
+        return contains(len, "\r\n1\r\n") && contains(entries, " SET slow_key slow_value") &&
+               contains(reset, "+OK") && contains(after, "\r\n0\r\n");
+    });
+
+    runner.runTest("测试DEBUG TRACE", [&]() {
+        request("DEBUG TRACE RESET\r\n", "+OK\r\n");
+        // 采样关闭时不记录事件
+        request("SET trace_key v\r\n", "+OK\r\n");
+        bool idle = dkv::RequestTracer::eventCount() == 0;
+        request("DEBUG TRACE SAMPLE 1\r\n", "+OK\r\n");
+        request("SET trace_key v\r\n", "+OK\r\n");
+        request("GET trace_key\r\n", "v\r\n");
+        request("DEBUG TRACE SAMPLE 0\r\n", "+OK\r\n");
+        std::string dump = request("DEBUG TRACE DUMP\r\n", "]}\r\n");
+        std::string invalid = request("DEBUG TRACE SAMPLE x\r\n", "\r\n");
+        request("DEBUG TRACE RESET\r\n", "+OK\r\n");
+        return idle && contains(dump, "\"traceEvents\":[") && contains(dump, "\"name\":\"parse\"") &&
+               contains(dump, "\"name\":\"queue\",\"cat\":\"dkv\",\"ph\":\"b\"") &&
+               contains(dump, "\"name\":\"execute\"") && contains(dump, "\"detail\":\"SET\"") &&
+               contains(dump, "\"name\":\"segment_rlock\"") && contains(dump, "\"name\":\"write\"") &&
+               contains(invalid, "-") && dkv::RequestTracer::eventCount() == 0;
+    });
+
+    runner.runTest("测试MEMORY USAGE与内存采样", [&]() {
+        std::vector<std::string> args = {"mem:hash"};
+        for (int i = 0; i < 2000; ++i) {
+            args.push_back("field:" + std::to_string(i));
+            args.push_back(std::string(40, 'v'));
+        }
+        server.executeCommand(dkv::Command(dkv::CommandType::HSET, args), dkv::NO_TX);
+        server.executeCommand(dkv::Command(dkv::CommandType::SET, {"mem:int", "12345"}), dkv::NO_TX);
+        dkv::StorageEngine* storage = server.getStorageEngine();
+        // 字段长度相近，按前几个字段外推的结果接近逐个计算的结果
+        size_t exact = storage->memoryUsage("mem:hash", 0).value_or(0);
+        size_t sampled = storage->memoryUsage("mem:hash").value_or(0);
+        bool estimate_ok = exact > 2000 * 40 && sampled * 10 >= exact * 9 && sampled * 10 <= exact * 11 &&
+                           storage->memoryUsage("mem:int").value_or(0) > 0 && !storage->memoryUsage("mem:none");
+        std::string usage = request("MEMORY USAGE mem:hash SAMPLES 0\r\n", std::to_string(exact) + "\r\n");
+        std::string missing = request("MEMORY USAGE mem:none\r\n", "\r\n");
+        std::string invalid = request("MEMORY USAGE mem:hash SAMPLES x\r\n", "\r\n");
+        // 完整遍历一轮后发布按类型汇总的结果
+        bool finished = !storage->memorySampleCycle(std::chrono::seconds(10));
+        std::string stats = request("MEMORY STATS\r\n", "dataset.bytes\r\n");
+        return estimate_ok && contains(usage, std::to_string(exact)) && contains(missing, "$-1") &&
+               contains(invalid, "-") && finished && contains(stats, "sample.passes\r\n$1\r\n1\r\n") &&
+               contains(stats, "mem:hash " + std::to_string(sampled) + " hashtable") &&
+               contains(stats, "string.keys");
+    });
+
+    close(sock);
+    server.stop();
+}
+
+// 测试慢命令通道：遍历大集合的命令交给慢命令线程，其他连接的小命令不在其后排队
+void testSlowLane(dkv::TestRunner& runner) {
+    std::cout << "开始测试慢命令通道..." << std::endl;
+
+    // 只有一个普通工作线程，不区分通道时GET要等SMEMBERS执行完
+    dkv::DKVServer server(6411, 2, 1);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    dkv::SlowLaneConfig slow_lane;
+    slow_lane.threads = 1;
+    slow_lane.threshold = 10000;
+    server.setSlowLane(slow_lane);
+    if (!server.start()) {
+        std::cerr << "服务器启动失败" << std::endl;
+        return;
+    }
+    std::vector<std::string> members = {"slow:set"};
+    for (int i = 0; i < 500000; ++i) {
+        members.push_back("member:" + std::to_string(i));
+    }
+    server.executeCommand(dkv::Command(dkv::CommandType::SADD, members), dkv::NO_TX);
+    server.executeCommand(dkv::Command(dkv::CommandType::SET, {"slow:small", "v"}), dkv::NO_TX);
+
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(6411);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int big = socket(AF_INET, SOCK_STREAM, 0);
+    int small = socket(AF_INET, SOCK_STREAM, 0);
+    if (big < 0 || small < 0 || connect(big, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        connect(small, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cerr << "连接服务器失败" << std::endl;
+        if (big >= 0) {
+            close(big);
+        }
+        if (small >= 0) {
+            close(small);
+        }
+        server.stop();
+        return;
+    }
+    struct timeval timeout{10, 0};
+    setsockopt(big, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(small, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    auto readUntil = [](int sock, const std::string& suffix) {
+        std::string received;
+        char buffer[65536];
+        while (received.size() < suffix.size() ||
+               received.compare(received.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            int bytes_read = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes_read <= 0) {
+                return false;
+            }
+            received.append(buffer, bytes_read);
+        }
+        return true;
+    };
+
+    runner.runTest("测试大集合的SMEMBERS不挡住其他连接的GET", [&]() {
+        auto start = std::chrono::steady_clock::now();
+        // 回复按序写出，随后SET的回复到达说明SMEMBERS的回复已全部收到
+        std::string slow = "*2\r\n$8\r\nSMEMBERS\r\n$8\r\nslow:set\r\n"
+                           "*3\r\n$3\r\nSET\r\n$9\r\nslow:done\r\n$1\r\n1\r\n";
+        send(big, slow.c_str(), slow.length(), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        std::string get = "*2\r\n$3\r\nGET\r\n$10\r\nslow:small\r\n";
+        send(small, get.c_str(), get.length(), 0);
+        bool get_ok = readUntil(small, "$1\r\nv\r\n");
+        auto get_done = std::chrono::steady_clock::now();
+        bool smembers_ok = readUntil(big, "+OK\r\n");
+        auto smembers_done = std::chrono::steady_clock::now();
+        // GET不等SMEMBERS执行完，耗时远小于SMEMBERS
+        return get_ok && smembers_ok && (get_done - start) * 2 < smembers_done - start;
+    });
+
+    close(big);
+    close(small);
+    server.stop();
+}
+
 int main() {
     dkv::setSignalHandler();
     try {
@@ -100,6 +887,13 @@ int main() {
         
         // 运行服务器管理命令测试
         testServerManagement(runner);
+        testRunToCompletion(runner);
+        testReusePort(runner);
+        testIoUringBackend(runner);
+        testClientTracking(runner);
+        testPubSub(runner);
+        testLatencyStats(runner);
+        testSlowLane(runner);
         
         // 打印测试总结
         runner.printSummary();
@@ -111,9 +111,8 @@ TEST(ShardManagerTest, AddRemoveShard) {
     shard_manager.Start();
     
     // 测试添加分片
-    std::vector<std::string> raft_peers = {"127.0.0.1:8000", "127.0.0.1:8001", "127.0.0.1:8002"};
-    EXPECT_TRUE(shard_manager.AddShard(1, raft_peers));
-    EXPECT_TRUE(shard_manager.AddShard(2, raft_peers));
+    EXPECT_TRUE(shard_manager.AddShard(1));
+    EXPECT_TRUE(shard_manager.AddShard(2));
     
     // 测试获取所有分片统计信息
     auto stats_list = shard_manager.GetAllShardStats();
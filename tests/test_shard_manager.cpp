@@ -0,0 +1,294 @@
+#include "multinode/shard/dkv_shard.hpp"
+#include "multinode/raft/dkv_raft_network.hpp"
+#include "dkv_server.hpp"
+#include "test_runner.hpp"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dkv {
+
+namespace {
+
+// 测试用的分片配置：哈希槽路由，健康检查每100毫秒一次，不自动迁移
+ShardConfig makeShardConfig(int num_shards) {
+    ShardConfig config{};
+    config.enable_sharding = true;
+    config.num_shards = num_shards;
+    config.hash_type = HashFunctionType::MD5;
+    config.routing_mode = ShardRoutingMode::HASH_SLOT;
+    config.num_virtual_nodes = 100;
+    config.heartbeat_interval_ms = 100;
+    config.migration_batch_size = 100;
+    config.max_concurrent_migrations = 1;
+    config.failover_timeout_ms = 5000;
+    config.enable_auto_migration = false;
+    config.health_check_interval_ms = 100;
+    config.monitoring_interval_ms = 1000;
+    return config;
+}
+
+// 分片的Raft持久化目录需要事先存在
+void prepareRaftDirs(const std::string& dir, int num_shards) {
+    std::filesystem::remove_all(dir);
+    for (int i = 0; i < num_shards; i++) {
+        std::filesystem::create_directories(dir + "/shard_" + std::to_string(i));
+    }
+}
+
+// 第nth个路由到shard的键
+std::string keyOnShard(const ShardManager& manager, int shard, int nth) {
+    for (int i = 0;; i++) {
+        std::string key = "key:" + std::to_string(i);
+        if (manager.GetShardId(key) == shard && nth-- == 0) {
+            return key;
+        }
+    }
+}
+
+// 异步执行命令并等待回调，calls记录回调次数；15秒内没有回调时返回错误
+Response runAsync(ShardManager& manager, const Command& command, std::atomic<int>& calls) {
+    auto promise = std::make_shared<std::promise<Response>>();
+    auto future = promise->get_future();
+    calls = 0;
+    manager.HandleCommandAsync(command, NO_TX, [promise, &calls](const Response& response) {
+        if (calls.fetch_add(1) == 0) {
+            promise->set_value(response);
+        }
+    });
+    if (future.wait_for(std::chrono::seconds(15)) != std::future_status::ready) {
+        return Response(ResponseStatus::ERROR, "timeout");
+    }
+    // 留出时间让重复的回调暴露出来
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return future.get();
+}
+
+// 本机上的集群：每个节点一个分片管理器，节点上所有分片的Raft组共享该节点的传输
+class ShardCluster {
+public:
+    ShardCluster(const std::string& dir, int base_port, int nodes, int num_shards)
+        : dir_(dir), nodes_(nodes), num_shards_(num_shards) {
+        std::vector<std::string> peers;
+        for (int node = 0; node < nodes_; node++) {
+            peers.push_back("127.0.0.1:" + std::to_string(base_port + node));
+        }
+        for (int node = 0; node < nodes_; node++) {
+            const std::string node_dir = dir_ + "/node_" + std::to_string(node);
+            prepareRaftDirs(node_dir, num_shards);
+            servers_.push_back(std::make_unique<DKVServer>(base_port + 100 + node));
+            transports_.push_back(std::make_shared<RaftTcpNetwork>(node, peers));
+            managers_.push_back(std::make_unique<ShardManager>(servers_.back().get()));
+            managers_.back()->SetRaftTransport(transports_.back(), node_dir);
+            managers_.back()->Initialize(makeShardConfig(num_shards));
+        }
+    }
+
+    ~ShardCluster() {
+        for (auto& manager : managers_) {
+            manager->Stop();
+        }
+        managers_.clear();
+        for (auto& transport : transports_) {
+            transport->StopListener();
+        }
+        transports_.clear();
+        servers_.clear();
+        std::filesystem::remove_all(dir_);
+    }
+
+    bool Start() {
+        for (auto& manager : managers_) {
+            if (!manager->Start()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 等待每个分片的Raft组选出领导者，返回各分片领导者所在的节点，超时时为-1
+    std::vector<int> WaitForLeaders() const {
+        std::vector<int> leaders(num_shards_, -1);
+        for (int retry = 0; retry < 100; retry++) {
+            bool all = true;
+            for (int shard = 0; shard < num_shards_; shard++) {
+                leaders[shard] = -1;
+                for (int node = 0; node < nodes_; node++) {
+                    if (managers_[node]->GetShard(shard)->GetRaft()->IsLeader()) {
+                        leaders[shard] = node;
+                    }
+                }
+                all = all && leaders[shard] >= 0;
+            }
+            if (all) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return leaders;
+    }
+
+    ShardManager& Manager(int node) { return *managers_[node]; }
+
+private:
+    std::string dir_;
+    int nodes_;
+    int num_shards_;
+    std::vector<std::unique_ptr<DKVServer>> servers_;
+    std::vector<std::shared_ptr<RaftTcpNetwork>> transports_;
+    std::vector<std::unique_ptr<ShardManager>> managers_;
+};
+
+} // namespace
+
+// 测试异步命令处理：广播到各分片的DBSIZE在最后一个分片完成时回调一次，结果为各分片之和
+bool testHandleCommandAsync() {
+    const int num_shards = 2;
+    ShardCluster cluster("./test_shard_async_data", 23491, 1, num_shards);
+    ASSERT_TRUE(cluster.Start());
+    ASSERT_TRUE(cluster.WaitForLeaders() == std::vector<int>({0, 0}));
+    ShardManager& manager = cluster.Manager(0);
+
+    std::atomic<int> calls{0};
+    const int keys_per_shard[num_shards] = {3, 2};
+    for (int shard = 0; shard < num_shards; shard++) {
+        for (int i = 0; i < keys_per_shard[shard]; i++) {
+            Response set = runAsync(manager, Command(CommandType::SET, {keyOnShard(manager, shard, i), "v"}), calls);
+            ASSERT_TRUE(set.status == ResponseStatus::OK);
+            ASSERT_EQ(calls.load(), 1);
+        }
+    }
+    ASSERT_EQ(manager.GetShard(0)->GetStorageEngine()->size(), 3u);
+    ASSERT_EQ(manager.GetShard(1)->GetStorageEngine()->size(), 2u);
+
+    Response dbsize = runAsync(manager, Command(CommandType::DBSIZE, {}), calls);
+    ASSERT_TRUE(dbsize.status == ResponseStatus::OK);
+    ASSERT_EQ(dbsize.data, std::string("5"));
+    ASSERT_EQ(calls.load(), 1);
+    return true;
+}
+
+// 测试多个分片的Raft组共享节点的传输：三节点上的两个组各自选出领导者，
+// 两个组的日志经合并发送的AppendEntries复制到所有节点并应用
+bool testSharedTransportGroups() {
+    const int nodes = 3;
+    const int num_shards = 2;
+    ShardCluster cluster("./test_shard_transport_data", 23493, nodes, num_shards);
+    ASSERT_TRUE(cluster.Start());
+    std::vector<int> leaders = cluster.WaitForLeaders();
+    ASSERT_TRUE(leaders[0] >= 0 && leaders[1] >= 0);
+
+    for (int round = 0; round < 5; round++) {
+        for (int shard = 0; shard < num_shards; shard++) {
+            auto leader = cluster.Manager(leaders[shard]).GetShard(shard);
+            Command set(CommandType::SET, {"group:" + std::to_string(round), "v" + std::to_string(shard)});
+            ASSERT_TRUE(leader->ExecuteCommand(set, NO_TX).status == ResponseStatus::OK);
+        }
+    }
+
+    // 跟随者在之后的AppendEntries中得知提交索引后应用
+    auto applied = [&]() {
+        for (int node = 0; node < nodes; node++) {
+            for (int shard = 0; shard < num_shards; shard++) {
+                StorageEngine* engine = cluster.Manager(node).GetShard(shard)->GetStorageEngine();
+                if (engine->size() != 5 || engine->get(NO_TX, "group:4") != "v" + std::to_string(shard)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    bool all_applied = false;
+    for (int retry = 0; retry < 100 && !all_applied; retry++) {
+        all_applied = applied();
+        if (!all_applied) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    ASSERT_TRUE(all_applied);
+    return true;
+}
+
+// 测试跨分片的多键命令：按分片拆分后并行执行，MGET按原始键顺序合并，DEL和EXISTS求和，
+// 任一分片失败时返回该分片的错误且只回调一次
+bool testScatterKeys() {
+    const int num_shards = 2;
+    ShardCluster cluster("./test_shard_scatter_data", 23497, 1, num_shards);
+    ASSERT_TRUE(cluster.Start());
+    ASSERT_TRUE(cluster.WaitForLeaders() == std::vector<int>({0, 0}));
+    ShardManager& manager = cluster.Manager(0);
+
+    // 两个分片各两个键，所在的槽分属不同分片
+    const std::string a0 = keyOnShard(manager, 0, 0);
+    const std::string a1 = keyOnShard(manager, 0, 1);
+    const std::string b0 = keyOnShard(manager, 1, 0);
+    const std::string b1 = keyOnShard(manager, 1, 1);
+    ASSERT_TRUE(KeyHashSlot(a0) != KeyHashSlot(b0));
+    std::atomic<int> calls{0};
+
+    Response mset = runAsync(manager, Command(CommandType::MSET, {b0, "vb0", a0, "va0", b1, "vb1", a1, "va1"}), calls);
+    ASSERT_TRUE(mset.status == ResponseStatus::OK);
+    ASSERT_EQ(calls.load(), 1);
+    StorageEngine* shard0 = manager.GetShard(0)->GetStorageEngine();
+    StorageEngine* shard1 = manager.GetShard(1)->GetStorageEngine();
+    ASSERT_EQ(shard0->get(NO_TX, a0), std::string("va0"));
+    ASSERT_EQ(shard0->get(NO_TX, a1), std::string("va1"));
+    ASSERT_EQ(shard1->get(NO_TX, b0), std::string("vb0"));
+    ASSERT_EQ(shard1->get(NO_TX, b1), std::string("vb1"));
+    ASSERT_EQ(shard0->size() + shard1->size(), 4u);
+
+    // 结果按请求中键的顺序排列，不存在的键为空
+    const std::string missing = keyOnShard(manager, 1, 2);
+    Response mget = runAsync(manager, Command(CommandType::MGET, {a1, b0, missing, a0, b1}), calls);
+    ASSERT_TRUE(mget.status == ResponseStatus::OK && mget.is_array);
+    ASSERT_TRUE(mget.elements == std::vector<std::string>({"va1", "vb0", "", "va0", "vb1"}));
+    ASSERT_EQ(calls.load(), 1);
+
+    // 重复的键按出现次数计数
+    Response exists = runAsync(manager, Command(CommandType::EXISTS, {a0, b0, missing, a0}), calls);
+    ASSERT_TRUE(exists.status == ResponseStatus::OK);
+    ASSERT_EQ(exists.data, std::string("3"));
+
+    Response del = runAsync(manager, Command(CommandType::DEL, {a0, b0, missing}), calls);
+    ASSERT_TRUE(del.status == ResponseStatus::OK);
+    ASSERT_EQ(del.data, std::string("2"));
+    ASSERT_EQ(calls.load(), 1);
+    exists = runAsync(manager, Command(CommandType::EXISTS, {a0, b0, a1, b1}), calls);
+    ASSERT_EQ(exists.data, std::string("2"));
+
+    // 一个分片不可用时，另一个分片的结果被丢弃，返回不可用分片的错误
+    manager.GetShard(1)->SetState(ShardState::FAILED);
+    mget = runAsync(manager, Command(CommandType::MGET, {a1, b1}), calls);
+    ASSERT_TRUE(mget.status == ResponseStatus::ERROR);
+    ASSERT_EQ(mget.message, std::string("Shard is not active"));
+    ASSERT_EQ(calls.load(), 1);
+    del = runAsync(manager, Command(CommandType::DEL, {b1, a1}), calls);
+    ASSERT_TRUE(del.status == ResponseStatus::ERROR);
+    ASSERT_EQ(calls.load(), 1);
+    manager.GetShard(1)->SetState(ShardState::ACTIVE);
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 分片管理器测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("异步命令合并广播结果", testHandleCommandAsync);
+    runner.runTest("分片组共享传输", testSharedTransportGroups);
+    runner.runTest("跨分片多键命令", testScatterKeys);
+
+    runner.printSummary();
+
+    return 0;
+}
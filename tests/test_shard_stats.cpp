@@ -0,0 +1,85 @@
+#include "multinode/shard/dkv_shard_stats.hpp"
+#include "test_runner.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dkv {
+
+// 测试延迟直方图的分位数落在实际值所在的二进制区间内
+bool testLatencyHistogram() {
+    LatencyHistogram histogram;
+    ASSERT_EQ(histogram.Percentile(99), 0u);
+    for (int i = 0; i < 98; i++) {
+        histogram.Record(100);
+    }
+    histogram.Record(5000);
+    histogram.Record(5000);
+    ASSERT_EQ(histogram.Count(), 100u);
+    // 100微秒在[64, 128)桶，5000微秒在[4096, 8192)桶
+    ASSERT_EQ(histogram.Percentile(50), 127u);
+    ASSERT_EQ(histogram.Percentile(99), 8191u);
+    histogram.Reset();
+    ASSERT_EQ(histogram.Count(), 0u);
+    return true;
+}
+
+// 测试热点键统计：高频键在大量低频键之后仍然排在前面
+bool testHotKeySketch() {
+    HotKeySketch sketch(8);
+    for (int round = 0; round < 100; round++) {
+        sketch.Offer("hot:a");
+        if (round % 2 == 0) {
+            sketch.Offer("hot:b");
+        }
+        sketch.Offer("cold:" + std::to_string(round));
+    }
+    auto top = sketch.TopK(2);
+    ASSERT_EQ(top.size(), 2u);
+    ASSERT_EQ(top[0].first, std::string("hot:a"));
+    ASSERT_GE(top[0].second, 100u);
+    ASSERT_EQ(top[1].first, std::string("hot:b"));
+    sketch.Reset();
+    ASSERT_TRUE(sketch.TopK(2).empty());
+    return true;
+}
+
+// 测试并发记录不丢失直方图计数
+bool testConcurrentRecord() {
+    LatencyHistogram histogram;
+    HotKeySketch sketch;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&histogram, &sketch, t]() {
+            for (int i = 0; i < 10000; i++) {
+                histogram.Record(i);
+                sketch.Offer("key:" + std::to_string(t));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(histogram.Count(), 40000u);
+    ASSERT_LE(sketch.TopK(10).size(), 4u);
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 分片统计测试\n" << std::endl;
+
+    TestRunner runner;
+
+    runner.runTest("延迟直方图", testLatencyHistogram);
+    runner.runTest("热点键统计", testHotKeySketch);
+    runner.runTest("并发记录", testConcurrentRecord);
+
+    runner.printSummary();
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include "storage/dkv_storage.hpp"
+#include "dkv_server.hpp"
+#include "dkv_logger.hpp"
+#include "test_runner.hpp"
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace dkv {
+
+namespace {
+
+TieredConfig testConfig(const std::string& path) {
+    TieredConfig config;
+    config.enabled = true;
+    config.path = path;
+    config.min_spill_size = 16;
+    config.min_idle_ms = 0;
+    return config;
+}
+
+} // namespace
+
+// 测试移出与同步载入：值、类型和过期时间不变，太小的值和已在磁盘上的值不移出
+bool testSpillAndLoad() {
+    StorageEngine storage;
+    ASSERT_TRUE(storage.enableTieredStorage(testConfig("test_tier_spill.log")));
+    const std::string value(200, 'v');
+    storage.set(NO_TX, "str", value);
+    for (int i = 0; i < 20; ++i) {
+        storage.hset(NO_TX, "hash", "field" + std::to_string(i), "value" + std::to_string(i));
+    }
+    storage.expire(NO_TX, "hash", 100);
+    storage.set(NO_TX, "small", "v");
+
+    ASSERT_TRUE(storage.spill("str"));
+    ASSERT_TRUE(storage.spill("hash"));
+    ASSERT_FALSE(storage.spill("str"));
+    ASSERT_FALSE(storage.spill("small"));
+    ASSERT_FALSE(storage.spill("missing"));
+    TieredStats stats = storage.getTieredStats();
+    ASSERT_EQ(stats.spilled_keys, static_cast<size_t>(2));
+    ASSERT_TRUE(stats.live_bytes > value.size());
+
+    // 元数据留在内存，不需要载入
+    ASSERT_EQ(storage.size(), static_cast<size_t>(3));
+    ASSERT_TRUE(storage.ttl(NO_TX, "hash") > 0);
+
+    ASSERT_EQ(storage.loadSpilled({"str", "hash", "small", "missing"}), static_cast<size_t>(2));
+    ASSERT_EQ(storage.get(NO_TX, "str"), value);
+    ASSERT_EQ(storage.hget(NO_TX, "hash", "field7"), std::string("value7"));
+    ASSERT_EQ(storage.hlen(NO_TX, "hash"), static_cast<size_t>(20));
+    ASSERT_TRUE(storage.ttl(NO_TX, "hash") > 0);
+    stats = storage.getTieredStats();
+    ASSERT_EQ(stats.spilled_keys, static_cast<size_t>(0));
+    ASSERT_EQ(stats.live_bytes, static_cast<size_t>(0));
+    ASSERT_EQ(stats.loads, static_cast<uint64_t>(2));
+    return true;
+}
+
+// 测试删除或覆盖磁盘上的值时释放日志记录
+bool testReleaseOnDelete() {
+    StorageEngine storage;
+    ASSERT_TRUE(storage.enableTieredStorage(testConfig("test_tier_release.log")));
+    const std::string value(100, 'x');
+    storage.set(NO_TX, "a", value);
+    storage.set(NO_TX, "b", value);
+    ASSERT_TRUE(storage.spill("a"));
+    ASSERT_TRUE(storage.spill("b"));
+    ASSERT_TRUE(storage.del(NO_TX, "a"));
+    storage.set(NO_TX, "b", "new");
+    TieredStats stats = storage.getTieredStats();
+    ASSERT_EQ(stats.spilled_keys, static_cast<size_t>(0));
+    ASSERT_EQ(stats.live_bytes, static_cast<size_t>(0));
+    ASSERT_TRUE(stats.log_bytes > 2 * value.size());
+    ASSERT_EQ(storage.get(NO_TX, "b"), std::string("new"));
+    return true;
+}
+
+// 测试后台线程异步载入，键都在内存中时不经过后台线程
+bool testAsyncLoad() {
+    StorageEngine storage;
+    ASSERT_TRUE(storage.enableTieredStorage(testConfig("test_tier_async.log")));
+    for (int i = 0; i < 50; ++i) {
+        storage.zadd(NO_TX, "zset", {{"member" + std::to_string(i), static_cast<double>(i)}});
+    }
+    ASSERT_TRUE(storage.spill("zset"));
+
+    std::promise<void> loaded;
+    ASSERT_TRUE(storage.loadSpilledAsync({"zset", "missing"}, [&loaded]() { loaded.set_value(); }));
+    ASSERT_TRUE(loaded.get_future().wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    double score = 0;
+    ASSERT_TRUE(storage.zscore(NO_TX, "zset", "member42", score));
+    ASSERT_EQ(score, 42.0);
+    TieredStats stats = storage.getTieredStats();
+    ASSERT_EQ(stats.async_loads, static_cast<uint64_t>(1));
+    ASSERT_EQ(stats.spilled_keys, static_cast<size_t>(0));
+    ASSERT_FALSE(storage.loadSpilledAsync({"zset"}, []() {}));
+    return true;
+}
+
+// 测试RDB保存直接从日志读取磁盘上的值
+bool testSaveSpilledRDB() {
+    const std::string filename = "test_tier.rdb";
+    {
+        StorageEngine storage;
+        ASSERT_TRUE(storage.enableTieredStorage(testConfig("test_tier_rdb.log")));
+        storage.set(NO_TX, "str", std::string(300, 's'));
+        storage.sadd(NO_TX, "set", {"a", "b", "c", "d", "e", "f", "g", "h"});
+        ASSERT_TRUE(storage.spill("str"));
+        ASSERT_TRUE(storage.spill("set"));
+        ASSERT_TRUE(storage.saveRDB(filename));
+    }
+    StorageEngine restored;
+    ASSERT_TRUE(restored.loadRDB(filename));
+    std::remove(filename.c_str());
+    ASSERT_EQ(restored.get(NO_TX, "str"), std::string(300, 's'));
+    ASSERT_EQ(restored.scard(NO_TX, "set"), static_cast<size_t>(8));
+    return true;
+}
+
+// 测试磁盘上的值读取失败时RDB保存失败，而不是写出空值
+bool testSaveUnreadableSpill() {
+    const std::string filename = "test_tier_bad.rdb";
+    const std::string path = "test_tier_bad.log";
+    StorageEngine storage;
+    ASSERT_TRUE(storage.enableTieredStorage(testConfig(path)));
+    storage.set(NO_TX, "str", std::string(300, 's'));
+    ASSERT_TRUE(storage.spill("str"));
+    ASSERT_EQ(truncate(path.c_str(), 0), 0);
+    ASSERT_FALSE(storage.saveRDB(filename));
+    std::remove(filename.c_str());
+    return true;
+}
+
+// 测试服务器超过maxmemory时把冷数据移到磁盘：写入不被拒绝，键不被删除，读命令照常返回磁盘上的值
+bool testTieredServer() {
+    DKVServer server(6407);
+    server.setRDBEnabled(false);
+    server.setAOFEnabled(false);
+    server.setEvictionPolicy(EvictionPolicy::ALLKEYS_LRU);
+    server.setTieredStorage(testConfig("test_tier_server.log"));
+    if (!server.start()) {
+        return false;
+    }
+    const std::string value(1024, 'x');
+    const int KEYS = 1000;
+    for (int i = 0; i < KEYS / 2; ++i) {
+        server.executeCommand(Command(CommandType::SET, {"key" + std::to_string(i), value}), NO_TX);
+    }
+    server.setMaxMemory(server.getMemoryUsage());
+    int rejected = 0;
+    for (int i = KEYS / 2; i < KEYS; ++i) {
+        Response response = server.executeCommand(Command(CommandType::SET, {"key" + std::to_string(i), value}), NO_TX);
+        if (response.status != ResponseStatus::OK) {
+            rejected++;
+        }
+    }
+    const TieredStats spilled = server.getStorageEngine()->getTieredStats();
+    int found = 0;
+    for (int i = 0; i < KEYS; ++i) {
+        Response response = server.executeCommand(Command(CommandType::GET, {"key" + std::to_string(i)}), NO_TX);
+        if (response.status == ResponseStatus::OK && response.data == value) {
+            found++;
+        }
+    }
+    Response info = server.executeCommand(Command(CommandType::INFO, {}), NO_TX);
+    const TieredStats loaded = server.getStorageEngine()->getTieredStats();
+    const size_t key_count = server.getKeyCount();
+    server.stop();
+
+    ASSERT_EQ(rejected, 0);
+    ASSERT_EQ(key_count, static_cast<size_t>(KEYS));
+    ASSERT_TRUE(spilled.spilled_keys > 0);
+    ASSERT_EQ(found, KEYS);
+    ASSERT_TRUE(loaded.async_loads > 0);
+    ASSERT_TRUE(info.data.find("tiered_spilled_keys:") != std::string::npos);
+    return true;
+}
+
+} // namespace dkv
+
+int main() {
+    using namespace dkv;
+
+    std::cout << "DKV 分层存储测试\n" << std::endl;
+
+    Logger::getInstance().setConsoleOutput(false);
+    TestRunner runner;
+
+    runner.runTest("移出与同步载入", testSpillAndLoad);
+    runner.runTest("删除时释放日志记录", testReleaseOnDelete);
+    runner.runTest("异步载入", testAsyncLoad);
+    runner.runTest("RDB保存磁盘上的值", testSaveSpilledRDB);
+    runner.runTest("磁盘上的值读取失败时RDB保存失败", testSaveUnreadableSpill);
+    runner.runTest("服务器超过内存上限时移到磁盘", testTieredServer);
+
+    Logger::getInstance().setConsoleOutput(true);
+    runner.printSummary();
+
+    return 0;
+}